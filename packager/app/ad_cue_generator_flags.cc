@@ -17,3 +17,9 @@ DEFINE_string(ad_cues,
               "{start_time}[,{duration}][;{start_time}[,{duration}]]..."
               "The start_time represents the start of the cue marker in "
               "seconds relative to the start of the program.");
+DEFINE_uint64(ad_cues_max_buffer_bytes,
+              0,
+              "The maximum size, in bytes, of the samples an input may buffer "
+              "while waiting for a cue to be aligned on a video key frame, "
+              "e.g. when the video has a gap. Once reached, the cue is placed "
+              "at the time of the samples buffered. 0 means no limit.");
@@ -27,6 +27,11 @@ DEFINE_int32(
     "Apply to video streams with 'cbcs' and 'cens' protection schemes only; "
     "ignored otherwise.");
 DEFINE_bool(vp9_subsample_encryption, true, "Enable VP9 subsample encryption.");
+DEFINE_int32(num_encryption_threads,
+             0,
+             "Number of threads shared by all streams to encrypt the samples "
+             "of a segment in parallel. Samples are encrypted sequentially on "
+             "the stream's own thread if it is 0 (default).");
 DEFINE_string(playready_extra_header_data,
               "",
               "Extra XML data to add to PlayReady headers.");
@@ -43,6 +48,14 @@ bool ValueNotGreaterThanTen(const char* flagname, int32_t value) {
   return true;
 }
 
+bool ValueIsNonNegative(const char* flagname, int32_t value) {
+  if (value < 0) {
+    fprintf(stderr, "ERROR: %s must be non-negative.\n", flagname);
+    return false;
+  }
+  return true;
+}
+
 bool ValueIsXml(const char* flagname, const std::string& value) {
   if (value.empty())
     return true;
@@ -56,4 +69,5 @@ bool ValueIsXml(const char* flagname, const std::string& value) {
 
 DEFINE_validator(crypt_byte_block, &ValueNotGreaterThanTen);
 DEFINE_validator(skip_byte_block, &ValueNotGreaterThanTen);
+DEFINE_validator(num_encryption_threads, &ValueIsNonNegative);
 DEFINE_validator(playready_extra_header_data, &ValueIsXml);
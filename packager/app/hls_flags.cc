@@ -30,3 +30,18 @@ DEFINE_int32(hls_media_sequence_number,
               "EXT-X-MEDIA-SEQUENCE value, which allows continuous media "
               "sequence across packager restarts. See #691 for more "
               "information about the reasoning of this and its use cases.");
+DEFINE_bool(hls_can_block_reload,
+            false,
+            "Live and event playlists with low latency chunked output only: "
+            "set if the server delivering the playlists supports blocking "
+            "playlist reload (_HLS_msn and _HLS_part requests), which LL-HLS "
+            "players require. Sets CAN-BLOCK-RELOAD=YES in "
+            "EXT-X-SERVER-CONTROL.");
+DEFINE_double(hls_can_skip_until,
+              0,
+              "Live and event playlists only: if positive, also write the "
+              "delta update of each media playlist, with a '_delta' suffix "
+              "before the '.m3u8' extension, where EXT-X-SKIP replaces the "
+              "segments older than this many seconds (at least six target "
+              "durations) for the server to deliver for the requests with "
+              "_HLS_skip=YES. Sets CAN-SKIP-UNTIL in EXT-X-SERVER-CONTROL.");
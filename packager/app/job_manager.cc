@@ -7,15 +7,25 @@
 #include "packager/app/job_manager.h"
 
 #include "packager/app/libcrypto_threading.h"
+#include "packager/media/base/numa_util.h"
 #include "packager/media/chunking/sync_point_queue.h"
 #include "packager/media/origin/origin_handler.h"
 
 namespace shaka {
 namespace media {
 
-Job::Job(const std::string& name, std::shared_ptr<OriginHandler> work)
+base::TimeDelta ThreadCpuTime() {
+  if (!base::ThreadTicks::IsSupported())
+    return base::TimeDelta();
+  return base::ThreadTicks::Now() - base::ThreadTicks();
+}
+
+Job::Job(const std::string& name,
+         std::shared_ptr<OriginHandler> work,
+         int numa_node)
     : SimpleThread(name),
       work_(std::move(work)),
+      numa_node_(numa_node),
       wait_(base::WaitableEvent::ResetPolicy::MANUAL,
             base::WaitableEvent::InitialState::NOT_SIGNALED) {
   DCHECK(work_);
@@ -26,7 +36,18 @@ void Job::Cancel() {
 }
 
 void Job::Run() {
-  status_ = work_->Run();
+  // Before any sample buffer is allocated, so the buffers are node local.
+  if (numa_node_ >= 0)
+    PinCurrentThreadToNumaNode(numa_node_);
+  const base::TimeDelta start_cpu_time = ThreadCpuTime();
+  {
+    ScopedSampleBufferPool scoped_buffer_pool(&buffer_pool_);
+    status_ = work_->Run();
+  }
+  cpu_time_ = ThreadCpuTime() - start_cpu_time;
+  VLOG(1) << "Sample buffer pool: "
+          << buffer_pool_.hits() << " hits, " << buffer_pool_.misses()
+          << " misses.";
   wait_.Signal();
 }
 
@@ -34,11 +55,23 @@ JobManager::JobManager(std::unique_ptr<SyncPointQueue> sync_points)
     : sync_points_(std::move(sync_points)) {}
 
 void JobManager::Add(const std::string& name,
-                     std::shared_ptr<OriginHandler> handler) {
+                     std::shared_ptr<OriginHandler> handler,
+                     int numa_node) {
+  const int num_numa_nodes = GetNumNumaNodes();
+  if (numa_node >= num_numa_nodes) {
+    LOG(WARNING) << "NUMA node " << numa_node << " of job " << name
+                 << " does not exist; the host has " << num_numa_nodes
+                 << " nodes.";
+    numa_node = -1;
+  }
+  if (numa_node < 0 && numa_aware_placement_ && num_numa_nodes > 1) {
+    numa_node = next_numa_node_;
+    next_numa_node_ = (next_numa_node_ + 1) % num_numa_nodes;
+  }
   // Stores Job entries for delayed construction of Job objects, to avoid
   // setting up SimpleThread until we know all workers can be initialized
   // successfully.
-  job_entries_.push_back({name, std::move(handler)});
+  job_entries_.push_back({name, std::move(handler), numa_node});
 }
 
 Status JobManager::InitializeJobs() {
@@ -50,7 +83,8 @@ Status JobManager::InitializeJobs() {
 
   // Create Job objects after successfully initialized all workers.
   for (const JobEntry& job_entry : job_entries_)
-    jobs_.emplace_back(new Job(job_entry.name, std::move(job_entry.worker)));
+    jobs_.emplace_back(new Job(job_entry.name, std::move(job_entry.worker),
+                               job_entry.numa_node));
   return status;
 }
 
@@ -83,6 +117,7 @@ Status JobManager::RunJobs() {
 
     job->Join();
     status.Update(job->status());
+    cpu_time_ += job->cpu_time();
 
     // Remove the job and the wait from our tracking.
     active_jobs.erase(active_jobs.begin() + done);
@@ -99,6 +134,7 @@ Status JobManager::RunJobs() {
 
   for (auto& job : active_jobs) {
     job->Join();
+    cpu_time_ += job->cpu_time();
   }
 
   return status;
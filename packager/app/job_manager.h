@@ -11,6 +11,8 @@
 #include <vector>
 
 #include "packager/base/threading/simple_thread.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/status.h"
 
 namespace shaka {
@@ -19,11 +21,20 @@ namespace media {
 class OriginHandler;
 class SyncPointQueue;
 
+// @return the CPU time used by the calling thread so far, or zero if it cannot
+//         be measured on the platform.
+base::TimeDelta ThreadCpuTime();
+
 // A job is a single line of work that is expected to run in parallel with
 // other jobs.
 class Job : public base::SimpleThread {
  public:
-  Job(const std::string& name, std::shared_ptr<OriginHandler> work);
+  // @param numa_node is the NUMA node the job's thread is pinned to, so its
+  //        sample buffers are allocated from local memory. A negative value
+  //        means no pinning.
+  Job(const std::string& name,
+      std::shared_ptr<OriginHandler> work,
+      int numa_node = -1);
 
   // Request that the job stops executing. This is only a request and
   // will not block. If you want to wait for the job to complete, use
@@ -38,6 +49,13 @@ class Job : public base::SimpleThread {
   // WaitableEvent you can wait on.
   base::WaitableEvent* wait() { return &wait_; }
 
+  // The pool that samples created on this job's thread draw their buffers
+  // from. Exposed for its hit / miss counters.
+  const SampleBufferPool& buffer_pool() const { return buffer_pool_; }
+
+  // The CPU time used by the job's thread. Only valid once the job completed.
+  base::TimeDelta cpu_time() const { return cpu_time_; }
+
  private:
   Job(const Job&) = delete;
   Job& operator=(const Job&) = delete;
@@ -45,7 +63,10 @@ class Job : public base::SimpleThread {
   void Run() override;
 
   std::shared_ptr<OriginHandler> work_;
+  const int numa_node_;
   Status status_;
+  SampleBufferPool buffer_pool_;
+  base::TimeDelta cpu_time_;
 
   base::WaitableEvent wait_;
 };
@@ -65,7 +86,19 @@ class JobManager {
   // Create a new job entry by specifying the origin handler at the top of the
   // chain and a name for the thread. This will only register the job. To start
   // the job, you need to call |RunJobs|.
-  void Add(const std::string& name, std::shared_ptr<OriginHandler> handler);
+  // @param numa_node is the NUMA node to run the job on. A negative value
+  //        means any node, or the next node in round robin order if
+  //        |set_numa_aware_placement| was enabled.
+  void Add(const std::string& name,
+           std::shared_ptr<OriginHandler> handler,
+           int numa_node = -1);
+
+  // If enabled, the jobs added afterwards without a NUMA node are distributed
+  // round robin over the NUMA nodes of the host. Has no effect on hosts with a
+  // single node.
+  void set_numa_aware_placement(bool numa_aware_placement) {
+    numa_aware_placement_ = numa_aware_placement;
+  }
 
   // Initialize all registered jobs. If any job fails to initialize, this will
   // return the error and it will not be safe to call |RunJobs| as not all jobs
@@ -79,10 +112,14 @@ class JobManager {
 
   // Ask all jobs to stop running. This call is non-blocking and can be used to
   // unblock a call to |RunJobs|.
-  void CancelJobs();
+  virtual void CancelJobs();
 
   SyncPointQueue* sync_points() { return sync_points_.get(); }
 
+  // The CPU time used by the threads running the jobs in |RunJobs|, not
+  // including the helper threads of the jobs, e.g. for I/O.
+  base::TimeDelta cpu_time() const { return cpu_time_; }
+
  protected:
   JobManager(const JobManager&) = delete;
   JobManager& operator=(const JobManager&) = delete;
@@ -90,6 +127,8 @@ class JobManager {
   struct JobEntry {
     std::string name;
     std::shared_ptr<OriginHandler> worker;
+    // The NUMA node to pin the job to, or negative to not pin it.
+    int numa_node;
   };
   // Stores Job entries for delayed construction of Job object.
   std::vector<JobEntry> job_entries_;
@@ -97,6 +136,13 @@ class JobManager {
   // Stored in JobManager so JobManager can cancel |sync_points| when any job
   // fails or is cancelled.
   std::unique_ptr<SyncPointQueue> sync_points_;
+  // Updated by |RunJobs|.
+  base::TimeDelta cpu_time_;
+
+ private:
+  bool numa_aware_placement_ = false;
+  // The node of the next job placed round robin.
+  int next_numa_node_ = 0;
 };
 
 }  // namespace media
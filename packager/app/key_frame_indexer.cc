@@ -0,0 +1,135 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gflags/gflags.h>
+#include <iostream>
+
+#include "packager/app/vlog_flags.h"
+#include "packager/base/at_exit.h"
+#include "packager/base/command_line.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/media/demuxer/key_frame_index.h"
+#include "packager/media/demuxer/key_frame_scanner.h"
+#include "packager/tools/license_notice.h"
+#include "packager/version/version.h"
+
+#if defined(OS_WIN)
+#include <codecvt>
+#include <functional>
+#include <locale>
+#endif  // defined(OS_WIN)
+
+DEFINE_bool(licenses, false, "Dump licenses.");
+DEFINE_string(input, "", "Input media file to index.");
+DEFINE_string(output, "", "Key frame index output file name.");
+
+namespace shaka {
+namespace {
+const char kUsage[] =
+    "Key frame index generation program.\n"
+    "This program scans an MP4 (fragmented), MPEG-2 TS or WebM input for its "
+    "key frames and outputs a key frame index, which lets the packager read "
+    "only the needed part of the input when packaging a time range of it, "
+    "see --vod_shard_start_time and the key_frame_index stream descriptor "
+    "field.\n"
+    "Sample Usage:\n"
+    "%s --input=\"input.ts\" --output=\"input.ts.kfi\"";
+
+enum ExitStatus {
+  kSuccess = 0,
+  kEmptyInputError,
+  kEmptyOutputError,
+  kFailedToScanInputError,
+  kFailedToWriteIndexError,
+};
+
+ExitStatus CheckRequiredFlags() {
+  if (FLAGS_input.empty()) {
+    LOG(ERROR) << "--input is required.";
+    return kEmptyInputError;
+  }
+  if (FLAGS_output.empty()) {
+    LOG(ERROR) << "--output is required.";
+    return kEmptyOutputError;
+  }
+  return kSuccess;
+}
+
+ExitStatus RunKeyFrameIndexer() {
+  media::KeyFrameIndex key_frame_index;
+  Status status = media::ScanKeyFrames(FLAGS_input, &key_frame_index);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to index " << FLAGS_input << ": " << status;
+    return kFailedToScanInputError;
+  }
+  status = key_frame_index.WriteToFile(FLAGS_output);
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return kFailedToWriteIndexError;
+  }
+  LOG(INFO) << "Indexed " << key_frame_index.entries.size()
+            << " key frames of " << FLAGS_input;
+  return kSuccess;
+}
+
+int KeyFrameIndexerMain(int argc, char** argv) {
+  base::AtExitManager exit;
+  // Needed to enable VLOG/DVLOG through --vmodule or --v.
+  base::CommandLine::Init(argc, argv);
+
+  // Set up logging.
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LOG_TO_SYSTEM_DEBUG_LOG;
+  CHECK(logging::InitLogging(log_settings));
+
+  google::SetVersionString(GetPackagerVersion());
+  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_licenses) {
+    for (const char* line : kLicenseNotice)
+      std::cout << line << std::endl;
+    return kSuccess;
+  }
+
+  ExitStatus status = CheckRequiredFlags();
+  if (status != kSuccess) {
+    google::ShowUsageWithFlags("Usage");
+    return status;
+  }
+
+  return RunKeyFrameIndexer();
+}
+
+}  // namespace
+}  // namespace shaka
+
+#if defined(OS_WIN)
+// Windows wmain, which converts wide character arguments to UTF-8.
+int wmain(int argc, wchar_t* argv[], wchar_t* envp[]) {
+  std::unique_ptr<char* [], std::function<void(char**)>> utf8_argv(
+      new char*[argc], [argc](char** utf8_args) {
+        // TODO(tinskip): This leaks, but if this code is enabled, it crashes.
+        // Figure out why. I suspect gflags does something funny with the
+        // argument array.
+        // for (int idx = 0; idx < argc; ++idx)
+        //   delete[] utf8_args[idx];
+        delete[] utf8_args;
+      });
+  std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+  for (int idx = 0; idx < argc; ++idx) {
+    std::string utf8_arg(converter.to_bytes(argv[idx]));
+    utf8_arg += '\0';
+    utf8_argv[idx] = new char[utf8_arg.size()];
+    memcpy(utf8_argv[idx], &utf8_arg[0], utf8_arg.size());
+  }
+  return shaka::KeyFrameIndexerMain(argc, utf8_argv.get());
+}
+#else
+int main(int argc, char** argv) {
+  return shaka::KeyFrameIndexerMain(argc, argv);
+}
+#endif  // !defined(OS_WIN)
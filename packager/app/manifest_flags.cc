@@ -29,6 +29,13 @@ DEFINE_string(default_language,
               "This applies to both audio and text tracks. The default "
               "language for text tracks can be overriden by "
               "'--default_text_language'.");
+DEFINE_double(manifest_update_coalescing_window,
+              0,
+              "For DASH dynamic MPDs and HLS live and event playlists. If "
+              "positive, the manifests are updated by a dedicated thread at "
+              "most once per this many seconds, coalescing the updates of "
+              "all the streams, instead of being written by the muxer thread "
+              "of every new segment. Useful with many renditions.");
 DEFINE_string(default_text_language,
               "",
               "Same as above, but this applies to text tracks only, and "
@@ -9,10 +9,14 @@
 #include "packager/app/mpd_generator_flags.h"
 #include "packager/app/vlog_flags.h"
 #include "packager/base/at_exit.h"
+#include "packager/base/bind.h"
 #include "packager/base/command_line.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/file/file.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/mpd/util/mpd_writer.h"
 #include "packager/tools/license_notice.h"
 #include "packager/version/version.h"
@@ -41,16 +45,38 @@ const char kUsage[] =
     "audio, and 1 text.\n"
     "Sample Usage:\n"
     "%s --input=\"video1.media_info,video2.media_info,audio1.media_info\" "
-    "--output=\"video_audio.mpd\"";
+    "--output=\"video_audio.mpd\"\n"
+    "Many MPDs can be generated in one run with --batch_input, in parallel:\n"
+    "%s --batch_input=\"mpd_list.txt\" --num_threads=8";
 
 enum ExitStatus {
   kSuccess = 0,
   kEmptyInputError,
   kEmptyOutputError,
-  kFailedToWriteMpdToFileError
+  kFailedToWriteMpdToFileError,
+  kInvalidBatchInputError,
+};
+
+// An MPD to generate in batch mode.
+struct BatchEntry {
+  std::string output;
+  std::vector<std::string> input_files;
+  bool success = false;
 };
 
 ExitStatus CheckRequiredFlags() {
+  if (!FLAGS_batch_input.empty()) {
+    if (!FLAGS_input.empty() || !FLAGS_output.empty()) {
+      LOG(ERROR) << "--batch_input cannot be used with --input or --output.";
+      return kInvalidBatchInputError;
+    }
+    if (FLAGS_num_threads < 0) {
+      LOG(ERROR) << "--num_threads should not be negative.";
+      return kInvalidBatchInputError;
+    }
+    return kSuccess;
+  }
+
   if (FLAGS_input.empty()) {
     LOG(ERROR) << "--input is required.";
     return kEmptyInputError;
@@ -64,22 +90,19 @@ ExitStatus CheckRequiredFlags() {
   return kSuccess;
 }
 
-ExitStatus RunMpdGenerator() {
-  DCHECK_EQ(CheckRequiredFlags(), kSuccess);
-  std::vector<std::string> base_urls;
-  typedef std::vector<std::string>::const_iterator Iterator;
-
-  std::vector<std::string> input_files = base::SplitString(
-      FLAGS_input, ",", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
-
-  if (!FLAGS_base_urls.empty()) {
-    base_urls = base::SplitString(FLAGS_base_urls, ",", base::KEEP_WHITESPACE,
-                                  base::SPLIT_WANT_ALL);
-  }
+std::vector<std::string> GetBaseUrls() {
+  if (FLAGS_base_urls.empty())
+    return std::vector<std::string>();
+  return base::SplitString(FLAGS_base_urls, ",", base::KEEP_WHITESPACE,
+                           base::SPLIT_WANT_ALL);
+}
 
+bool WriteMpd(const std::vector<std::string>& base_urls,
+              const std::vector<std::string>& input_files,
+              const std::string& output) {
   MpdWriter mpd_writer;
-  for (Iterator it = base_urls.begin(); it != base_urls.end(); ++it)
-    mpd_writer.AddBaseUrl(*it);
+  for (const std::string& base_url : base_urls)
+    mpd_writer.AddBaseUrl(base_url);
 
   for (const std::string& file : input_files) {
     if (!mpd_writer.AddFile(file)) {
@@ -87,11 +110,87 @@ ExitStatus RunMpdGenerator() {
     }
   }
 
-  if (!mpd_writer.WriteMpdToFile(FLAGS_output.c_str())) {
-    LOG(ERROR) << "Failed to write MPD to " << FLAGS_output;
+  if (!mpd_writer.WriteMpdToFile(output.c_str())) {
+    LOG(ERROR) << "Failed to write MPD to " << output;
+    return false;
+  }
+  return true;
+}
+
+void WriteBatchEntry(const std::vector<std::string>* base_urls,
+                     BatchEntry* entry) {
+  entry->success = WriteMpd(*base_urls, entry->input_files, entry->output);
+}
+
+bool ParseBatchInput(const std::string& batch_input,
+                     std::vector<BatchEntry>* entries) {
+  std::string content;
+  if (!File::ReadFileToString(batch_input.c_str(), &content)) {
+    LOG(ERROR) << "Failed to read " << batch_input;
+    return false;
+  }
+
+  for (const std::string& line :
+       base::SplitString(content, "\n", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    if (line[0] == '#')
+      continue;
+    std::vector<std::string> fields = base::SplitString(
+        line, base::kWhitespaceASCII, base::TRIM_WHITESPACE,
+        base::SPLIT_WANT_NONEMPTY);
+    if (fields.size() != 2) {
+      LOG(ERROR) << "Invalid line in " << batch_input << ": " << line;
+      return false;
+    }
+    BatchEntry entry;
+    entry.output = fields[0];
+    entry.input_files = base::SplitString(fields[1], ",", base::KEEP_WHITESPACE,
+                                          base::SPLIT_WANT_ALL);
+    entries->push_back(std::move(entry));
+  }
+  return true;
+}
+
+// Generates all the MPDs in a single process, so the process startup cost is
+// paid once, and reads the MediaInfo files and writes the MPDs of different
+// entries in parallel.
+ExitStatus RunBatchMpdGenerator() {
+  std::vector<BatchEntry> entries;
+  if (!ParseBatchInput(FLAGS_batch_input, &entries))
+    return kInvalidBatchInputError;
+
+  const std::vector<std::string> base_urls = GetBaseUrls();
+  std::vector<base::Closure> tasks;
+  tasks.reserve(entries.size());
+  for (BatchEntry& entry : entries) {
+    tasks.push_back(base::Bind(&WriteBatchEntry, base::Unretained(&base_urls),
+                               base::Unretained(&entry)));
+  }
+  media::WorkStealingThreadPool pool(FLAGS_num_threads);
+  pool.RunTasksAndWait(tasks);
+
+  size_t num_failures = 0;
+  for (const BatchEntry& entry : entries) {
+    if (!entry.success)
+      ++num_failures;
+  }
+  if (num_failures > 0) {
+    LOG(ERROR) << "Failed to write " << num_failures << " of "
+               << entries.size() << " MPDs.";
     return kFailedToWriteMpdToFileError;
   }
+  return kSuccess;
+}
 
+ExitStatus RunMpdGenerator() {
+  DCHECK_EQ(CheckRequiredFlags(), kSuccess);
+  if (!FLAGS_batch_input.empty())
+    return RunBatchMpdGenerator();
+
+  std::vector<std::string> input_files = base::SplitString(
+      FLAGS_input, ",", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+  if (!WriteMpd(GetBaseUrls(), input_files, FLAGS_output))
+    return kFailedToWriteMpdToFileError;
   return kSuccess;
 }
 
@@ -106,7 +205,7 @@ int MpdMain(int argc, char** argv) {
   CHECK(logging::InitLogging(log_settings));
 
   google::SetVersionString(GetPackagerVersion());
-  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
+  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0], argv[0]));
   google::ParseCommandLineFlags(&argc, &argv, true);
   if (FLAGS_licenses) {
     for (const char* line : kLicenseNotice)
@@ -15,4 +15,15 @@ DEFINE_string(base_urls,
               "",
               "Comma separated BaseURLs for the MPD. The values will be added "
               "as <BaseURL> element(s) immediately under the <MPD> element.");
+DEFINE_string(batch_input,
+              "",
+              "File that lists many MPDs to generate in one run, one per "
+              "line: the MPD output file name, followed by whitespace and a "
+              "comma separated list of MediaInfo input files. Lines starting "
+              "with '#' are ignored. --base_urls applies to every MPD. Cannot "
+              "be used with --input or --output.");
+DEFINE_int32(num_threads,
+             0,
+             "Number of threads generating the MPDs listed in --batch_input. "
+             "A value of zero means the number of processors.");
 #endif  // APP_MPD_GENERATOR_FLAGS_H_
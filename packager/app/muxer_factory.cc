@@ -9,6 +9,8 @@
 #include "packager/base/time/clock.h"
 #include "packager/media/base/muxer.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/event/progress_listener.h"
+#include "packager/media/event/throttled_progress_listener.h"
 #include "packager/media/formats/mp2t/ts_muxer.h"
 #include "packager/media/formats/mp4/mp4_muxer.h"
 #include "packager/media/formats/packed_audio/packed_audio_writer.h"
@@ -19,23 +21,71 @@
 
 namespace shaka {
 namespace media {
+namespace {
+
+// The progress callback is called every
+// |kProgressCallbackIntervalInMilliseconds|, or sooner if the progress advanced
+// by |kProgressCallbackStep|.
+const int64_t kProgressCallbackIntervalInMilliseconds = 500;
+const double kProgressCallbackStep = 0.01;
+
+// Reports the progress of an output to PackagingParams::progress_callback.
+class CallbackProgressListener : public ProgressListener {
+ public:
+  CallbackProgressListener(
+      const std::function<void(const std::string&, double)>& callback,
+      const std::string& output)
+      : callback_(callback), output_(output) {}
+
+  void OnProgress(double progress) override { callback_(output_, progress); }
+
+ private:
+  const std::function<void(const std::string&, double)> callback_;
+  const std::string output_;
+};
+
+}  // namespace
 
 MuxerFactory::MuxerFactory(const PackagingParams& packaging_params)
     : mp4_params_(packaging_params.mp4_output_params),
+      single_threaded_(packaging_params.single_threaded),
       temp_dir_(packaging_params.temp_dir),
       transport_stream_timestamp_offset_ms_(
-          packaging_params.transport_stream_timestamp_offset_ms) {}
+          packaging_params.transport_stream_timestamp_offset_ms),
+      segment_duration_in_seconds_(
+          packaging_params.chunking_params.segment_duration_in_seconds),
+      subsegment_duration_in_seconds_(
+          packaging_params.chunking_params.subsegment_duration_in_seconds),
+      segment_numbers_from_timestamps_(
+          packaging_params.chunking_params.segment_numbers_from_timestamps),
+      progress_callback_(packaging_params.progress_callback) {}
 
 std::shared_ptr<Muxer> MuxerFactory::CreateMuxer(
     MediaContainerName output_format,
     const StreamDescriptor& stream) {
   MuxerOptions options;
   options.mp4_params = mp4_params_;
+  if (single_threaded_)
+    options.mp4_params.finalize_fragments_in_parallel = false;
   options.transport_stream_timestamp_offset_ms =
       transport_stream_timestamp_offset_ms_;
+  options.segment_duration_in_seconds = segment_duration_in_seconds_;
+  options.segment_numbers_from_timestamps = segment_numbers_from_timestamps_;
+  // The low latency chunks are the fragments, which are as long as the
+  // segments if the fragment duration is not set.
+  if (output_format == CONTAINER_MOV &&
+      options.mp4_params.low_latency_chunked_output &&
+      !stream.segment_template.empty() && subsegment_duration_in_seconds_ > 0 &&
+      subsegment_duration_in_seconds_ < segment_duration_in_seconds_) {
+    options.chunk_duration_in_seconds = subsegment_duration_in_seconds_;
+  }
   options.temp_dir = temp_dir_;
   options.output_file_name = stream.output;
   options.segment_template = stream.segment_template;
+  auto first_segment_index_iter =
+      first_segment_indices_.find(stream.segment_template);
+  if (first_segment_index_iter != first_segment_indices_.end())
+    options.first_segment_index = first_segment_index_iter->second;
   options.bandwidth = stream.bandwidth;
 
   std::shared_ptr<Muxer> muxer;
@@ -76,6 +126,22 @@ std::shared_ptr<Muxer> MuxerFactory::CreateMuxer(
   if (clock_) {
     muxer->set_clock(clock_);
   }
+  if (load_shedder_) {
+    muxer->set_load_shedder(load_shedder_);
+  }
+  if (progress_callback_) {
+    std::unique_ptr<ProgressListener> callback_listener(
+        new CallbackProgressListener(progress_callback_,
+                                     stream.output.empty()
+                                         ? stream.segment_template
+                                         : stream.output));
+    muxer->SetProgressListener(
+        std::unique_ptr<ProgressListener>(new ThrottledProgressListener(
+            std::move(callback_listener),
+            base::TimeDelta::FromMilliseconds(
+                kProgressCallbackIntervalInMilliseconds),
+            kProgressCallbackStep)));
+  }
 
   return muxer;
 }
@@ -7,6 +7,8 @@
 #ifndef PACKAGER_APP_MUXER_FACTORY_H_
 #define PACKAGER_APP_MUXER_FACTORY_H_
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 
@@ -23,6 +25,7 @@ struct StreamDescriptor;
 
 namespace media {
 
+class LoadShedder;
 class Muxer;
 class MuxerListener;
 
@@ -46,14 +49,35 @@ class MuxerFactory {
     transport_stream_timestamp_offset_ms_ = offset_ms;
   }
 
+  /// Set the index of the first segment of the muxers created after this
+  /// call, by segment template, to resume the segment numbering of live
+  /// streams.
+  void SetFirstSegmentIndices(
+      const std::map<std::string, uint32_t>& first_segment_indices) {
+    first_segment_indices_ = first_segment_indices;
+  }
+
+  /// Set the LoadShedder of the muxers created after this call.
+  void SetLoadShedder(LoadShedder* load_shedder) {
+    load_shedder_ = load_shedder;
+  }
+
  private:
   MuxerFactory(const MuxerFactory&) = delete;
   MuxerFactory& operator=(const MuxerFactory&) = delete;
 
   const Mp4OutputParams mp4_params_;
+  // Whether the muxers run in the thread of their input only.
+  const bool single_threaded_;
   const std::string temp_dir_;
   uint32_t transport_stream_timestamp_offset_ms_ = 0;
+  const double segment_duration_in_seconds_ = 0;
+  const double subsegment_duration_in_seconds_ = 0;
+  const bool segment_numbers_from_timestamps_ = false;
   base::Clock* clock_ = nullptr;
+  LoadShedder* load_shedder_ = nullptr;
+  std::map<std::string, uint32_t> first_segment_indices_;
+  const std::function<void(const std::string&, double)> progress_callback_;
 };
 
 }  // namespace media
@@ -8,6 +8,8 @@
 
 #include "packager/app/muxer_flags.h"
 
+#include <stdio.h>
+
 DEFINE_double(clear_lead,
               5.0f,
               "Clear lead in seconds if encryption is enabled. Note that we do "
@@ -34,11 +36,79 @@ DEFINE_bool(fragment_sap_aligned,
             true,
             "Force fragments to begin with stream access points. This flag "
             "implies segment_sap_aligned.");
+DEFINE_bool(segment_numbers_from_timestamps,
+            false,
+            "Live only: number the segments, $Number$ and the manifests from "
+            "the input timestamps, i.e. the first segment is numbered with "
+            "its start time divided by --segment_duration, and set the MPD "
+            "availabilityStartTime to the epoch. With inputs timestamped from "
+            "the epoch, redundant packagers of the same input generate "
+            "interchangeable segments and manifests. Not supported with ad "
+            "cues.");
+DEFINE_double(segment_alignment_tolerance,
+              0,
+              "A key frame at most this many seconds before a segment "
+              "boundary starts the new segment, so that slight drifts of the "
+              "key frames of the input do not move the segment boundaries. "
+              "Must be less than half of --segment_duration.");
+DEFINE_double(max_live_lag,
+              0,
+              "Live only: if positive, the outputs are stopped one at a time "
+              "when an output falls behind real time by more than this many "
+              "seconds: the trick play outputs first, then the text outputs, "
+              "then the video renditions from the lowest resolution up. The "
+              "audio outputs and the highest video rendition are kept.");
+DEFINE_double(vod_shard_start_time,
+              0,
+              "VOD only: package the input from the first key frame at or "
+              "after this time, in seconds, to package a long input in "
+              "shards on several machines. Must be a multiple of "
+              "--segment_duration. Requires segment templates with $Time$ "
+              "and init segments; the shards are merged by running "
+              "mpd_generator on their --output_media_info files.");
+DEFINE_double(vod_shard_end_time,
+              0,
+              "VOD only: if positive, package the input up to the first key "
+              "frame at or after this time, in seconds. Must be a multiple of "
+              "--segment_duration. See --vod_shard_start_time.");
 DEFINE_bool(generate_sidx_in_media_segments,
             true,
             "Indicates whether to generate 'sidx' box in media segments. Note "
             "that it is required for DASH on-demand profile (not using segment "
             "template).");
+DEFINE_int32(mp4_reserved_subsegments,
+             0,
+             "MP4 single segment output only: if non-zero, reserve space at "
+             "the beginning of the output for the sidx of up to this many "
+             "subsegments, so the media is written to the output directly "
+             "instead of being copied from a temporary file.");
+DEFINE_bool(mp4_low_latency_chunked_output,
+            false,
+            "MP4 multiple segment output only: write each fragment (CMAF "
+            "chunk) to the segment file as soon as it is finalized, keeping "
+            "the file open across the fragments of the segment, for low "
+            "latency delivery, e.g. with HTTP chunked transfer. Use with "
+            "--fragment_duration shorter than --segment_duration, which is "
+            "then the chunk duration: the live DASH manifest signals the "
+            "segments as available once their first chunk is written "
+            "(availabilityTimeOffset), and the live HLS playlists list the "
+            "chunks as parts (EXT-X-PART). Disables 'sidx' in media "
+            "segments.");
+DEFINE_bool(mp4_finalize_fragments_in_parallel,
+            false,
+            "MP4 output with several streams in one file only: finalize the "
+            "fragments of the streams in parallel once all of them have "
+            "ended, instead of one by one, to shorten the work done at each "
+            "fragment boundary. Ignored with --single_threaded.");
+DEFINE_string(mp4_init_segment_store,
+              "",
+              "MP4 multiple segment output only: if set, write the init "
+              "segments to this directory instead, named after the hash of "
+              "their content, and reference them there from the manifests. An "
+              "init segment already in the directory, e.g. written by another "
+              "job with the same codec configuration and key, is not written "
+              "again. The directory should be addressable from the manifests, "
+              "e.g. relative to them.");
 DEFINE_string(temp_dir,
               "",
               "Specify a directory in which to store temporary (intermediate) "
@@ -53,3 +123,17 @@ DEFINE_int32(transport_stream_timestamp_offset_ms,
              "input. For example, timestamps from ISO-BMFF after adjusted by "
              "EditList could be negative. In transport streams, timestamps are "
              "not allowed to be less than zero.");
+
+namespace {
+
+bool ValueIsNonNegative(const char* flagname, int32_t value) {
+  if (value < 0) {
+    fprintf(stderr, "ERROR: %s must be non-negative.\n", flagname);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+DEFINE_validator(mp4_reserved_subsegments, &ValueIsNonNegative);
@@ -16,7 +16,16 @@ DECLARE_double(segment_duration);
 DECLARE_bool(segment_sap_aligned);
 DECLARE_double(fragment_duration);
 DECLARE_bool(fragment_sap_aligned);
+DECLARE_bool(segment_numbers_from_timestamps);
+DECLARE_double(segment_alignment_tolerance);
+DECLARE_double(max_live_lag);
+DECLARE_double(vod_shard_start_time);
+DECLARE_double(vod_shard_end_time);
 DECLARE_bool(generate_sidx_in_media_segments);
+DECLARE_int32(mp4_reserved_subsegments);
+DECLARE_bool(mp4_low_latency_chunked_output);
+DECLARE_bool(mp4_finalize_fragments_in_parallel);
+DECLARE_string(mp4_init_segment_store);
 DECLARE_string(temp_dir);
 DECLARE_bool(mp4_include_pssh_in_stream);
 DECLARE_int32(transport_stream_timestamp_offset_ms);
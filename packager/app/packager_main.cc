@@ -6,6 +6,7 @@
 
 #include <gflags/gflags.h>
 #include <iostream>
+#include <sstream>
 
 #include "packager/app/ad_cue_generator_flags.h"
 #include "packager/app/crypto_flags.h"
@@ -14,6 +15,7 @@
 #include "packager/app/mpd_flags.h"
 #include "packager/app/muxer_flags.h"
 #include "packager/app/packager_util.h"
+#include "packager/app/packaging_job_queue.h"
 #include "packager/app/playready_key_encryption_flags.h"
 #include "packager/app/protection_system_flags.h"
 #include "packager/app/raw_key_encryption_flags.h"
@@ -27,7 +29,9 @@
 #include "packager/base/strings/string_split.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/file/file.h"
+#include "packager/metrics/async_log_sink.h"
 #include "packager/packager.h"
 #include "packager/tools/license_notice.h"
 
@@ -40,6 +44,17 @@
 DEFINE_bool(dump_stream_info, false, "Dump demuxed stream info.");
 DEFINE_bool(licenses, false, "Dump licenses.");
 DEFINE_bool(quiet, false, "When enabled, LOG(INFO) output is suppressed.");
+DEFINE_bool(async_logging,
+            false,
+            "If enabled, the log messages are buffered per thread and written "
+            "by a background thread, so verbose logging, e.g. with --v or "
+            "--vmodule while debugging live packaging, does not stall the "
+            "packaging threads. Messages logged while the buffer of a thread "
+            "is full are dropped, which is reported in the log.");
+DEFINE_uint64(async_log_buffer_size,
+              1 << 20,
+              "Size, in bytes, of the log buffer of each thread with "
+              "--async_logging.");
 DEFINE_bool(use_fake_clock_for_muxer,
             false,
             "Set to true to use a fake clock for muxer. With this flag set, "
@@ -51,6 +66,153 @@ DEFINE_string(test_packager_version,
 DEFINE_bool(single_threaded,
             false,
             "If enabled, only use one thread when generating content.");
+DEFINE_bool(deterministic_manifests,
+            false,
+            "If enabled, the outputs are registered in the manifests in the "
+            "order of the stream descriptors instead of the order in which "
+            "they start or complete, so the manifests do not change from run "
+            "to run without --single_threaded.");
+DEFINE_int32(num_worker_threads,
+             0,
+             "If positive, run the packaging jobs on a work-stealing pool of "
+             "this many threads instead of one thread per input stream. Every "
+             "job runs on one thread until it ends, so with live inputs or "
+             "cue alignment, packaging fails if there are more jobs than "
+             "threads.");
+DEFINE_bool(numa_aware_jobs,
+            false,
+            "If enabled, the packaging jobs are pinned to the NUMA nodes of "
+            "the host, round robin, so their threads stay on one socket and "
+            "allocate their sample buffers from local memory. The numa_node "
+            "stream descriptor field pins the job of an input to a given "
+            "node instead. Linux only.");
+DEFINE_bool(zero_copy_demux,
+            false,
+            "If enabled, demuxed samples reference the input read buffers "
+            "instead of being copied out. Uses more memory for buffered "
+            "samples but reduces memory bandwidth. Only effective for MP4 "
+            "inputs currently.");
+DEFINE_bool(mmap_input,
+            false,
+            "If enabled, local input files are mapped in memory instead of "
+            "being read. MP4 inputs are then parsed directly from the mapping "
+            "and the samples reference it instead of being copied.");
+DEFINE_bool(mp4_random_access_demux,
+            false,
+            "If enabled, the samples of local non-fragmented MP4 inputs are "
+            "read chunk by chunk in decoding time order using the sample "
+            "tables, instead of reading the files sequentially. This bounds "
+            "the memory usage for poorly interleaved inputs.");
+DEFINE_int32(num_ts_demux_threads,
+             0,
+             "If positive, the elementary streams of MPEG-2 TS inputs, e.g. "
+             "the video, audio and subtitle PIDs of a broadcast capture, are "
+             "parsed in parallel on a pool of this many threads per input.");
+DEFINE_int32(num_webm_demux_threads,
+             0,
+             "If positive, the clusters of WebM inputs with Cues, e.g. a long "
+             "VP9 mezzanine, are parsed in parallel on a pool of this many "
+             "threads per input.");
+DEFINE_int32(num_decryption_threads,
+             0,
+             "If positive, the samples of encrypted MP4 inputs are decrypted "
+             "in parallel on a pool of this many threads per input instead of "
+             "on the demuxer thread, e.g. when repackaging encrypted "
+             "mezzanines.");
+DEFINE_int32(parallel_output_queue_size,
+             0,
+             "If positive, the outputs of a stream, e.g. the outputs of "
+             "different formats or trick play factors, are processed in "
+             "parallel, each on its own thread fed by a queue of up to this "
+             "many messages.");
+DEFINE_int32(pipeline_queue_size,
+             0,
+             "If positive, the demuxing, the processing (chunking and "
+             "encryption) and the muxing of each stream run on separate "
+             "threads, connected by queues of up to this many messages.");
+DEFINE_string(handler_stats_output,
+              "",
+              "If set, the statistics of the media handlers, e.g. the samples "
+              "and bytes processed, the time and CPU time spent and the "
+              "latency percentiles, are written to this file as JSON at the "
+              "end of the run.");
+DEFINE_bool(benchmark_null_output,
+            false,
+            "Discard all the outputs, only counting their bytes, and log the "
+            "time spent per stage (demux, chunk, encrypt, mux and manifest) "
+            "at the end of the run, to measure the compute throughput of the "
+            "packaging without the cost of the storage.");
+DEFINE_double(handler_stats_update_period,
+              0,
+              "If positive and --handler_stats_output is set, the handler "
+              "statistics are also written every this many seconds while "
+              "running.");
+DEFINE_string(metrics_output,
+              "",
+              "If set, the metrics of the process, e.g. the segments and bytes "
+              "written per stream, the segment, manifest and key fetch "
+              "latencies and the occupancy of the output caches, are written "
+              "to this file in the OpenMetrics (Prometheus) text format at "
+              "the end of the run.");
+DEFINE_double(metrics_update_period,
+              0,
+              "If positive and --metrics_output is set, the metrics are also "
+              "written every this many seconds while running, e.g. for the "
+              "textfile collector of the Prometheus node exporter.");
+DEFINE_string(trace_file,
+              "",
+              "If set, trace events of the packaging hot paths, e.g. the "
+              "demuxer reads, the parsing, the sample encryption, the "
+              "fragment finalization, the file I/O and the MPD updates, are "
+              "recorded per thread and written to this file in the Chrome "
+              "trace event format, for chrome://tracing or ui.perfetto.dev.");
+DEFINE_string(checkpoint_file,
+              "",
+              "Live only: if set, the state of the live manifests, i.e. the "
+              "segments in the live window, the media sequence numbers and "
+              "the segment numbering, is written to this file periodically, "
+              "so that a restarted packager can resume the channel with "
+              "--resume_from_checkpoint.");
+DEFINE_double(checkpoint_period,
+              10,
+              "Live only: the period, in seconds, of the writes of "
+              "--checkpoint_file.");
+DEFINE_bool(resume_from_checkpoint,
+            false,
+            "Live only: resume the live manifests from --checkpoint_file, if "
+            "it exists, instead of starting a new presentation. The input "
+            "must continue with the timestamps of the previous run. The "
+            "clear lead is not applied again.");
+DEFINE_bool(job_server,
+            false,
+            "If enabled, run as a long-running packaging server instead of "
+            "packaging the stream descriptors of the command line: jobs are "
+            "read from stdin until EOF, one per line, as whitespace "
+            "separated stream descriptors, optionally with --mpd_output, "
+            "--hls_master_playlist_output and --job_priority=live|vod for the "
+            "job. Live jobs, the default, always start before the pending "
+            "VOD jobs. The content of a job, i.e. its --content_id, "
+            "--program_identifier or --keys, can also be set on its line. The "
+            "other flags apply to every job. The status of every job is "
+            "written to stdout as it completes.");
+DEFINE_string(job_list,
+              "",
+              "If set, --job_server reads the jobs from this file instead of "
+              "stdin, e.g. the titles of a batch.");
+DEFINE_int32(job_server_concurrency,
+             0,
+             "Number of jobs run at the same time by --job_server. A value of "
+             "zero means the number of processors.");
+DEFINE_int32(job_server_max_live_jobs,
+             0,
+             "Maximum number of live jobs run at the same time by "
+             "--job_server, within --job_server_concurrency. A value of zero "
+             "means no limit.");
+DEFINE_int32(job_server_max_vod_jobs,
+             0,
+             "Maximum number of VOD jobs run at the same time by --job_server, "
+             "within --job_server_concurrency, e.g. to keep workers free for "
+             "the live jobs. A value of zero means no limit.");
 
 namespace shaka {
 namespace {
@@ -315,18 +477,79 @@ base::Optional<PackagingParams> GetPackagingParams() {
 
   packaging_params.temp_dir = FLAGS_temp_dir;
   packaging_params.single_threaded = FLAGS_single_threaded;
+  packaging_params.deterministic_manifests = FLAGS_deterministic_manifests;
+  packaging_params.zero_copy_demux = FLAGS_zero_copy_demux;
+  packaging_params.mmap_input = FLAGS_mmap_input;
+  packaging_params.mp4_random_access_demux = FLAGS_mp4_random_access_demux;
+  if (FLAGS_num_worker_threads < 0) {
+    LOG(ERROR) << "--num_worker_threads should not be negative.";
+    return base::nullopt;
+  }
+  packaging_params.num_worker_threads = FLAGS_num_worker_threads;
+  packaging_params.numa_aware_jobs = FLAGS_numa_aware_jobs;
+  if (FLAGS_num_ts_demux_threads < 0) {
+    LOG(ERROR) << "--num_ts_demux_threads should not be negative.";
+    return base::nullopt;
+  }
+  packaging_params.num_ts_demux_threads = FLAGS_num_ts_demux_threads;
+  if (FLAGS_num_webm_demux_threads < 0) {
+    LOG(ERROR) << "--num_webm_demux_threads should not be negative.";
+    return base::nullopt;
+  }
+  packaging_params.num_webm_demux_threads = FLAGS_num_webm_demux_threads;
+  if (FLAGS_num_decryption_threads < 0) {
+    LOG(ERROR) << "--num_decryption_threads should not be negative.";
+    return base::nullopt;
+  }
+  packaging_params.num_decryption_threads = FLAGS_num_decryption_threads;
+  if (FLAGS_parallel_output_queue_size < 0) {
+    LOG(ERROR) << "--parallel_output_queue_size should not be negative.";
+    return base::nullopt;
+  }
+  packaging_params.parallel_output_queue_size =
+      FLAGS_parallel_output_queue_size;
+  if (FLAGS_pipeline_queue_size < 0) {
+    LOG(ERROR) << "--pipeline_queue_size should not be negative.";
+    return base::nullopt;
+  }
+  packaging_params.pipeline_queue_size = FLAGS_pipeline_queue_size;
+  packaging_params.handler_stats_output = FLAGS_handler_stats_output;
+  packaging_params.handler_stats_update_period_in_seconds =
+      FLAGS_handler_stats_update_period;
+  packaging_params.metrics_output = FLAGS_metrics_output;
+  packaging_params.metrics_update_period_in_seconds =
+      FLAGS_metrics_update_period;
+  packaging_params.trace_file = FLAGS_trace_file;
+  packaging_params.benchmark_null_output = FLAGS_benchmark_null_output;
+  LiveCheckpointParams& live_checkpoint_params =
+      packaging_params.live_checkpoint_params;
+  live_checkpoint_params.checkpoint_file = FLAGS_checkpoint_file;
+  live_checkpoint_params.checkpoint_period_in_seconds =
+      FLAGS_checkpoint_period;
+  live_checkpoint_params.resume = FLAGS_resume_from_checkpoint;
 
   AdCueGeneratorParams& ad_cue_generator_params =
       packaging_params.ad_cue_generator_params;
   if (!ParseAdCues(FLAGS_ad_cues, &ad_cue_generator_params.cue_points)) {
     return base::nullopt;
   }
+  ad_cue_generator_params.max_buffered_bytes_per_input =
+      FLAGS_ad_cues_max_buffer_bytes;
 
   ChunkingParams& chunking_params = packaging_params.chunking_params;
   chunking_params.segment_duration_in_seconds = FLAGS_segment_duration;
   chunking_params.subsegment_duration_in_seconds = FLAGS_fragment_duration;
   chunking_params.segment_sap_aligned = FLAGS_segment_sap_aligned;
   chunking_params.subsegment_sap_aligned = FLAGS_fragment_sap_aligned;
+  chunking_params.segment_numbers_from_timestamps =
+      FLAGS_segment_numbers_from_timestamps;
+  chunking_params.segment_alignment_tolerance_in_seconds =
+      FLAGS_segment_alignment_tolerance;
+  packaging_params.load_shedding_params.max_lag_in_seconds = FLAGS_max_live_lag;
+  packaging_params.vod_shard_params.start_time_in_seconds =
+      FLAGS_vod_shard_start_time;
+  packaging_params.vod_shard_params.end_time_in_seconds =
+      FLAGS_vod_shard_end_time;
 
   int num_key_providers = 0;
   EncryptionParams& encryption_params = packaging_params.encryption_params;
@@ -364,6 +587,7 @@ base::Optional<PackagingParams> GetPackagingParams() {
     encryption_params.crypto_period_duration_in_seconds =
         FLAGS_crypto_period_duration;
     encryption_params.vp9_subsample_encryption = FLAGS_vp9_subsample_encryption;
+    encryption_params.num_encryption_threads = FLAGS_num_encryption_threads;
     encryption_params.stream_label_func = std::bind(
         &Packager::DefaultStreamLabelFunction, FLAGS_max_sd_pixels,
         FLAGS_max_hd_pixels, FLAGS_max_uhd1_pixels, std::placeholders::_1);
@@ -379,6 +603,9 @@ base::Optional<PackagingParams> GetPackagingParams() {
       widevine.policy = FLAGS_policy;
       widevine.group_id = FLAGS_group_id_bytes;
       widevine.enable_entitlement_license = FLAGS_enable_entitlement_license;
+      widevine.crypto_period_count = FLAGS_crypto_period_count;
+      widevine.crypto_period_lookahead = FLAGS_crypto_period_lookahead;
+      widevine.fetch_keys_in_background = FLAGS_fetch_keys_in_background;
       if (!GetWidevineSigner(&widevine.signer))
         return base::nullopt;
       break;
@@ -393,6 +620,7 @@ base::Optional<PackagingParams> GetPackagingParams() {
           FLAGS_client_cert_private_key_file;
       playready.client_cert_private_key_password =
           FLAGS_client_cert_private_key_password;
+      playready.fetch_keys_in_background = FLAGS_fetch_keys_in_background;
       break;
     }
     case KeyProvider::kRawKey: {
@@ -441,6 +669,11 @@ base::Optional<PackagingParams> GetPackagingParams() {
   mp4_params.generate_sidx_in_media_segments =
       FLAGS_generate_sidx_in_media_segments;
   mp4_params.include_pssh_in_stream = FLAGS_mp4_include_pssh_in_stream;
+  mp4_params.reserved_subsegments = FLAGS_mp4_reserved_subsegments;
+  mp4_params.low_latency_chunked_output = FLAGS_mp4_low_latency_chunked_output;
+  mp4_params.finalize_fragments_in_parallel =
+      FLAGS_mp4_finalize_fragments_in_parallel;
+  mp4_params.init_segment_store = FLAGS_mp4_init_segment_store;
 
   packaging_params.transport_stream_timestamp_offset_ms =
       FLAGS_transport_stream_timestamp_offset_ms;
@@ -479,6 +712,7 @@ base::Optional<PackagingParams> GetPackagingParams() {
       FLAGS_allow_approximate_segment_timeline;
   mpd_params.allow_codec_switching = FLAGS_allow_codec_switching;
   mpd_params.include_mspr_pro = FLAGS_include_mspr_pro_for_playready;
+  mpd_params.update_coalescing_window = FLAGS_manifest_update_coalescing_window;
 
   HlsParams& hls_params = packaging_params.hls_params;
   if (!GetHlsPlaylistType(FLAGS_hls_playlist_type, &hls_params.playlist_type)) {
@@ -493,6 +727,10 @@ base::Optional<PackagingParams> GetPackagingParams() {
   hls_params.default_language = FLAGS_default_language;
   hls_params.default_text_language = FLAGS_default_text_language;
   hls_params.media_sequence_number = FLAGS_hls_media_sequence_number;
+  hls_params.update_coalescing_window =
+      FLAGS_manifest_update_coalescing_window;
+  hls_params.can_block_reload = FLAGS_hls_can_block_reload;
+  hls_params.can_skip_until = FLAGS_hls_can_skip_until;
 
   TestParams& test_params = packaging_params.test_params;
   test_params.dump_stream_info = FLAGS_dump_stream_info;
@@ -503,6 +741,171 @@ base::Optional<PackagingParams> GetPackagingParams() {
   return packaging_params;
 }
 
+// Reports the completion of the jobs of --job_server.
+class JobServerOutput {
+ public:
+  void Report(int job_id, const Status& status) {
+    base::AutoLock auto_lock(lock_);
+    if (status.ok()) {
+      printf("Job %d completed successfully.\n", job_id);
+    } else {
+      ++num_failures_;
+      printf("Job %d failed: %s\n", job_id, status.ToString().c_str());
+    }
+    fflush(stdout);
+  }
+
+  int num_failures() {
+    base::AutoLock auto_lock(lock_);
+    return num_failures_;
+  }
+
+ private:
+  base::Lock lock_;
+  int num_failures_ = 0;
+};
+
+// Parses a --job_server job line into the parameters of the job. The server
+// flags are not set per job as the running jobs keep reading them.
+bool ParseJob(const std::string& line,
+              PackagingJobQueue::Priority* priority,
+              PackagingParams* packaging_params,
+              std::vector<StreamDescriptor>* stream_descriptors) {
+  const char kMpdOutput[] = "--mpd_output=";
+  const char kHlsMasterPlaylistOutput[] = "--hls_master_playlist_output=";
+  const char kJobPriority[] = "--job_priority=";
+  const char kContentId[] = "--content_id=";
+  const char kProgramIdentifier[] = "--program_identifier=";
+  const char kKeys[] = "--keys=";
+  EncryptionParams& encryption_params = packaging_params->encryption_params;
+  *priority = PackagingJobQueue::kLive;
+  for (const std::string& token :
+       base::SplitString(line, base::kWhitespaceASCII, base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    if (base::StartsWith(token, kMpdOutput, base::CompareCase::SENSITIVE)) {
+      packaging_params->mpd_params.mpd_output =
+          token.substr(sizeof(kMpdOutput) - 1);
+    } else if (base::StartsWith(token, kHlsMasterPlaylistOutput,
+                                base::CompareCase::SENSITIVE)) {
+      packaging_params->hls_params.master_playlist_output =
+          token.substr(sizeof(kHlsMasterPlaylistOutput) - 1);
+    } else if (base::StartsWith(token, kJobPriority,
+                                base::CompareCase::SENSITIVE)) {
+      const std::string priority_name = token.substr(sizeof(kJobPriority) - 1);
+      if (priority_name == "live") {
+        *priority = PackagingJobQueue::kLive;
+      } else if (priority_name == "vod") {
+        *priority = PackagingJobQueue::kVod;
+      } else {
+        LOG(ERROR) << "Unknown job priority " << priority_name
+                   << ", expecting 'live' or 'vod'.";
+        return false;
+      }
+    } else if (base::StartsWith(token, kContentId,
+                                base::CompareCase::SENSITIVE)) {
+      if (encryption_params.key_provider != KeyProvider::kWidevine) {
+        LOG(ERROR) << token << " requires --enable_widevine_encryption.";
+        return false;
+      }
+      encryption_params.widevine.content_id.clear();
+      if (!base::HexStringToBytes(token.substr(sizeof(kContentId) - 1),
+                                  &encryption_params.widevine.content_id)) {
+        LOG(ERROR) << "Invalid hex string for " << token;
+        return false;
+      }
+    } else if (base::StartsWith(token, kProgramIdentifier,
+                                base::CompareCase::SENSITIVE)) {
+      if (encryption_params.key_provider != KeyProvider::kPlayReady) {
+        LOG(ERROR) << token << " requires --enable_playready_encryption.";
+        return false;
+      }
+      encryption_params.playready.program_identifier =
+          token.substr(sizeof(kProgramIdentifier) - 1);
+    } else if (base::StartsWith(token, kKeys, base::CompareCase::SENSITIVE)) {
+      if (encryption_params.key_provider != KeyProvider::kRawKey) {
+        LOG(ERROR) << token << " requires --enable_raw_key_encryption.";
+        return false;
+      }
+      encryption_params.raw_key.key_map.clear();
+      if (!ParseKeys(token.substr(sizeof(kKeys) - 1),
+                     &encryption_params.raw_key)) {
+        LOG(ERROR) << "Failed to parse " << token;
+        return false;
+      }
+    } else if (base::StartsWith(token, "-", base::CompareCase::SENSITIVE)) {
+      LOG(ERROR) << "Flag " << token << " cannot be set per job.";
+      return false;
+    } else {
+      base::Optional<StreamDescriptor> stream_descriptor =
+          ParseStreamDescriptor(token);
+      if (!stream_descriptor)
+        return false;
+      stream_descriptors->push_back(stream_descriptor.value());
+    }
+  }
+  if (stream_descriptors->empty()) {
+    LOG(ERROR) << "No stream descriptor in job: " << line;
+    return false;
+  }
+  return true;
+}
+
+// Runs the jobs read from stdin, or --job_list, on a PackagingJobQueue. A
+// single process serves all the jobs, so the startup cost is paid once and the
+// key server responses and HTTP connections are reused across jobs.
+int RunJobServer(const PackagingParams& server_packaging_params) {
+  if (FLAGS_job_server_concurrency < 0) {
+    LOG(ERROR) << "--job_server_concurrency should not be negative.";
+    return kArgumentValidationFailed;
+  }
+  if (FLAGS_job_server_max_live_jobs < 0 || FLAGS_job_server_max_vod_jobs < 0) {
+    LOG(ERROR) << "--job_server_max_live_jobs and --job_server_max_vod_jobs "
+                  "should not be negative.";
+    return kArgumentValidationFailed;
+  }
+
+  std::istringstream job_list;
+  if (!FLAGS_job_list.empty()) {
+    std::string content;
+    if (!File::ReadFileToString(FLAGS_job_list.c_str(), &content)) {
+      LOG(ERROR) << "Failed to read --job_list " << FLAGS_job_list;
+      return kArgumentValidationFailed;
+    }
+    job_list.str(content);
+  }
+  std::istream& input =
+      FLAGS_job_list.empty() ? std::cin : static_cast<std::istream&>(job_list);
+
+  JobServerOutput output;
+  {
+    PackagingJobQueue job_queue(FLAGS_job_server_concurrency);
+    job_queue.SetMaxConcurrentJobs(PackagingJobQueue::kLive,
+                                   FLAGS_job_server_max_live_jobs);
+    job_queue.SetMaxConcurrentJobs(PackagingJobQueue::kVod,
+                                   FLAGS_job_server_max_vod_jobs);
+    int job_id = 0;
+    std::string line;
+    while (std::getline(input, line)) {
+      if (base::TrimWhitespaceASCII(line, base::TRIM_ALL).empty())
+        continue;
+      ++job_id;
+      PackagingJobQueue::Priority priority;
+      PackagingParams packaging_params = server_packaging_params;
+      std::vector<StreamDescriptor> stream_descriptors;
+      if (!ParseJob(line, &priority, &packaging_params, &stream_descriptors)) {
+        output.Report(job_id,
+                      Status(error::INVALID_ARGUMENT, "Invalid job: " + line));
+        continue;
+      }
+      job_queue.AddJob(priority, packaging_params, stream_descriptors,
+                       [&output, job_id](const Status& status) {
+                         output.Report(job_id, status);
+                       });
+    }
+  }
+  return output.num_failures() == 0 ? kSuccess : kPackagingFailed;
+}
+
 int PackagerMain(int argc, char** argv) {
   // Needed to enable VLOG/DVLOG through --vmodule or --v.
   base::CommandLine::Init(argc, argv);
@@ -520,15 +923,18 @@ int PackagerMain(int argc, char** argv) {
       std::cout << line << std::endl;
     return kSuccess;
   }
-  if (argc < 2) {
+  if (argc < 2 && !FLAGS_job_server) {
     google::ShowUsageWithFlags("Usage");
     return kSuccess;
   }
   if (FLAGS_quiet)
     logging::SetMinLogLevel(logging::LOG_WARNING);
+  if (FLAGS_async_logging)
+    AsyncLogSink::Install(FLAGS_async_log_buffer_size, stderr);
 
-  if (!ValidateWidevineCryptoFlags() || !ValidateRawKeyCryptoFlags() ||
-      !ValidatePRCryptoFlags()) {
+  if (!ValidateWidevineCryptoFlags(FLAGS_job_server) ||
+      !ValidateRawKeyCryptoFlags(FLAGS_job_server) ||
+      !ValidatePRCryptoFlags(FLAGS_job_server)) {
     return kArgumentValidationFailed;
   }
 
@@ -536,6 +942,18 @@ int PackagerMain(int argc, char** argv) {
   if (!packaging_params)
     return kArgumentValidationFailed;
 
+  if (!FLAGS_job_list.empty() && !FLAGS_job_server) {
+    LOG(ERROR) << "--job_list requires --job_server.";
+    return kArgumentValidationFailed;
+  }
+  if (FLAGS_job_server) {
+    if (argc > 1) {
+      LOG(ERROR) << "--job_server reads the stream descriptors from stdin.";
+      return kArgumentValidationFailed;
+    }
+    return RunJobServer(packaging_params.value());
+  }
+
   std::vector<StreamDescriptor> stream_descriptors;
   for (int i = 1; i < argc; ++i) {
     base::Optional<StreamDescriptor> stream_descriptor =
@@ -583,10 +1001,15 @@ int wmain(int argc, wchar_t* argv[], wchar_t* envp[]) {
     utf8_argv[idx] = new char[utf8_arg.size()];
     memcpy(utf8_argv[idx], &utf8_arg[0], utf8_arg.size());
   }
-  return shaka::PackagerMain(argc, utf8_argv.get());
+  const int result = shaka::PackagerMain(argc, utf8_argv.get());
+  shaka::AsyncLogSink::Uninstall();
+  return result;
 }
 #else
 int main(int argc, char** argv) {
-  return shaka::PackagerMain(argc, argv);
+  const int result = shaka::PackagerMain(argc, argv);
+  // Write the pending log messages.
+  shaka::AsyncLogSink::Uninstall();
+  return result;
 }
 #endif  // defined(OS_WIN)
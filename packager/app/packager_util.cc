@@ -73,13 +73,24 @@ std::unique_ptr<KeySource> CreateEncryptionKeySource(
       widevine_key_source->set_group_id(widevine.group_id);
       widevine_key_source->set_enable_entitlement_license(
           widevine.enable_entitlement_license);
+      widevine_key_source->set_crypto_period_count(
+          widevine.crypto_period_count);
+      widevine_key_source->set_crypto_period_lookahead(
+          widevine.crypto_period_lookahead);
+      widevine_key_source->set_key_cache_ttl_in_seconds(
+          encryption_params.key_cache_ttl_in_seconds);
 
-      Status status =
-          widevine_key_source->FetchKeys(widevine.content_id, widevine.policy);
-      if (!status.ok()) {
-        LOG(ERROR) << "Widevine encryption key source failed to fetch keys: "
-                   << status.ToString();
-        return nullptr;
+      if (widevine.fetch_keys_in_background) {
+        widevine_key_source->FetchKeysInBackground(widevine.content_id,
+                                                   widevine.policy);
+      } else {
+        Status status = widevine_key_source->FetchKeys(widevine.content_id,
+                                                       widevine.policy);
+        if (!status.ok()) {
+          LOG(ERROR) << "Widevine encryption key source failed to fetch keys: "
+                     << status.ToString();
+          return nullptr;
+        }
       }
       encryption_key_source = std::move(widevine_key_source);
       break;
@@ -120,12 +131,20 @@ std::unique_ptr<KeySource> CreateEncryptionKeySource(
         if (!playready.ca_file.empty()) {
           playready_key_source->SetCaFile(playready.ca_file);
         }
-        Status status = playready_key_source->FetchKeysWithProgramIdentifier(
-            playready.program_identifier);
-        if (!status.ok()) {
-          LOG(ERROR) << "PlayReady encryption key source failed to fetch keys: "
-                     << status.ToString();
-          return nullptr;
+        playready_key_source->set_key_cache_ttl_in_seconds(
+            encryption_params.key_cache_ttl_in_seconds);
+        if (playready.fetch_keys_in_background) {
+          playready_key_source->FetchKeysInBackground(
+              playready.program_identifier);
+        } else {
+          Status status = playready_key_source->FetchKeysWithProgramIdentifier(
+              playready.program_identifier);
+          if (!status.ok()) {
+            LOG(ERROR)
+                << "PlayReady encryption key source failed to fetch keys: "
+                << status.ToString();
+            return nullptr;
+          }
         }
         encryption_key_source = std::move(playready_key_source);
       } else {
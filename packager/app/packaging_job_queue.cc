@@ -0,0 +1,144 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/packaging_job_queue.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/sys_info.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace {
+
+const char* PriorityName(PackagingJobQueue::Priority priority) {
+  switch (priority) {
+    case PackagingJobQueue::kLive:
+      return "live";
+    case PackagingJobQueue::kVod:
+      return "vod";
+    case PackagingJobQueue::kNumPriorities:
+      break;
+  }
+  NOTREACHED();
+  return "";
+}
+
+}  // namespace
+
+PackagingJobQueue::PackagingJobQueue(size_t max_concurrent_jobs)
+    : job_available_(&lock_) {
+  if (max_concurrent_jobs == 0)
+    max_concurrent_jobs = base::SysInfo::NumberOfProcessors();
+  DCHECK_GT(max_concurrent_jobs, 0u);
+
+  for (size_t i = 0; i < max_concurrent_jobs; ++i) {
+    workers_.emplace_back(new media::ClosureThread(
+        "PackagingJobQueue",
+        base::Bind(&PackagingJobQueue::WorkerLoop, base::Unretained(this))));
+    workers_.back()->Start();
+  }
+}
+
+PackagingJobQueue::~PackagingJobQueue() {
+  {
+    base::AutoLock auto_lock(lock_);
+    stopping_ = true;
+    job_available_.Broadcast();
+  }
+  for (std::unique_ptr<media::ClosureThread>& worker : workers_)
+    worker->Join();
+}
+
+void PackagingJobQueue::SetMaxConcurrentJobs(Priority priority,
+                                             size_t max_concurrent_jobs) {
+  DCHECK_LT(priority, kNumPriorities);
+  base::AutoLock auto_lock(lock_);
+  max_concurrent_jobs_[priority] = max_concurrent_jobs;
+  // A higher limit may let a pending job start.
+  job_available_.Broadcast();
+}
+
+void PackagingJobQueue::AddJob(
+    const PackagingParams& packaging_params,
+    const std::vector<StreamDescriptor>& stream_descriptors,
+    const DoneCallback& done) {
+  AddJob(kLive, packaging_params, stream_descriptors, done);
+}
+
+void PackagingJobQueue::AddJob(
+    Priority priority,
+    const PackagingParams& packaging_params,
+    const std::vector<StreamDescriptor>& stream_descriptors,
+    const DoneCallback& done) {
+  DCHECK_LT(priority, kNumPriorities);
+  base::AutoLock auto_lock(lock_);
+  pending_jobs_[priority].push_back(
+      PendingJob{packaging_params, stream_descriptors, done});
+  job_available_.Signal();
+}
+
+void PackagingJobQueue::WorkerLoop() {
+  base::AutoLock auto_lock(lock_);
+  while (true) {
+    Priority priority;
+    PendingJob job;
+    if (!TakeJob(&priority, &job)) {
+      bool has_pending_jobs = false;
+      for (const std::deque<PendingJob>& pending_jobs : pending_jobs_)
+        has_pending_jobs |= !pending_jobs.empty();
+      // The pending jobs held back by their class limit start as soon as a
+      // running job of the class completes, which signals this worker.
+      if (stopping_ && !has_pending_jobs)
+        return;
+      job_available_.Wait();
+      continue;
+    }
+
+    ++running_jobs_[priority];
+    {
+      base::AutoUnlock auto_unlock(lock_);
+      RunJob(priority, job);
+    }
+    --running_jobs_[priority];
+    job_available_.Broadcast();
+  }
+}
+
+bool PackagingJobQueue::TakeJob(Priority* priority, PendingJob* job) {
+  lock_.AssertAcquired();
+  // The classes are ordered by priority.
+  for (int i = 0; i < kNumPriorities; ++i) {
+    if (pending_jobs_[i].empty())
+      continue;
+    if (max_concurrent_jobs_[i] > 0 &&
+        running_jobs_[i] >= max_concurrent_jobs_[i]) {
+      continue;
+    }
+    *priority = static_cast<Priority>(i);
+    *job = std::move(pending_jobs_[i].front());
+    pending_jobs_[i].pop_front();
+    return true;
+  }
+  return false;
+}
+
+void PackagingJobQueue::RunJob(Priority priority, const PendingJob& job) {
+  Packager packager;
+  Status status =
+      packager.Initialize(job.packaging_params, job.stream_descriptors);
+  if (status.ok())
+    status = packager.Run();
+  Metrics::GetInstance()->IncrementCounter(
+      "shaka_job_cpu_seconds",
+      "CPU time used by the packaging jobs of a priority class, not including "
+      "their I/O threads.",
+      {{"priority", PriorityName(priority)}}, packager.GetCpuTimeInSeconds());
+  job.done(status);
+}
+
+}  // namespace shaka
@@ -0,0 +1,99 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_PACKAGING_JOB_QUEUE_H_
+#define PACKAGER_APP_PACKAGING_JOB_QUEUE_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/packager.h"
+
+namespace shaka {
+namespace media {
+class ClosureThread;
+}  // namespace media
+
+// Runs packaging jobs, each a shaka::Packager instance, on a shared set of
+// worker threads for the lifetime of a long-running process. The jobs share
+// the process-wide state kept warm between them, e.g. the key server
+// responses cached by KeyCache and the open HTTP connections of HttpFile.
+//
+// Every job has a priority class. A free worker always starts the oldest
+// pending live job before any VOD job, and every class can be limited to a
+// number of running jobs, so a backlog of VOD jobs never delays the live
+// jobs. The CPU time of the jobs is exported per class as the
+// shaka_job_cpu_seconds counter of Packager::GetMetrics().
+class PackagingJobQueue {
+ public:
+  enum Priority {
+    kLive,
+    kVod,
+    kNumPriorities,
+  };
+
+  // Called on a worker thread with the status of a job.
+  typedef std::function<void(const Status& status)> DoneCallback;
+
+  // @param max_concurrent_jobs is the number of jobs running at the same
+  //        time. Every job runs its streams on threads of its own. A value of
+  //        zero means the number of processors.
+  explicit PackagingJobQueue(size_t max_concurrent_jobs);
+
+  // Runs the queued jobs and waits for them to complete.
+  ~PackagingJobQueue();
+
+  // Limit the number of jobs of @a priority running at the same time, on top
+  // of the overall limit. A value of zero, the default, means no limit.
+  // Thread safe.
+  void SetMaxConcurrentJobs(Priority priority, size_t max_concurrent_jobs);
+
+  // Queue a live job. Thread safe.
+  // @param done is called when the job completes, or fails to initialize.
+  void AddJob(const PackagingParams& packaging_params,
+              const std::vector<StreamDescriptor>& stream_descriptors,
+              const DoneCallback& done);
+
+  // Queue a job of @a priority. Thread safe.
+  // @param done is called when the job completes, or fails to initialize.
+  void AddJob(Priority priority,
+              const PackagingParams& packaging_params,
+              const std::vector<StreamDescriptor>& stream_descriptors,
+              const DoneCallback& done);
+
+ private:
+  PackagingJobQueue(const PackagingJobQueue&) = delete;
+  PackagingJobQueue& operator=(const PackagingJobQueue&) = delete;
+
+  struct PendingJob {
+    PackagingParams packaging_params;
+    std::vector<StreamDescriptor> stream_descriptors;
+    DoneCallback done;
+  };
+
+  void WorkerLoop();
+  // Takes the next job which may start. Called with |lock_| held.
+  bool TakeJob(Priority* priority, PendingJob* job);
+  static void RunJob(Priority priority, const PendingJob& job);
+
+  base::Lock lock_;
+  // Signaled when a job is queued or completes, or when the queue stops.
+  base::ConditionVariable job_available_;
+  std::deque<PendingJob> pending_jobs_[kNumPriorities];
+  size_t running_jobs_[kNumPriorities] = {};
+  size_t max_concurrent_jobs_[kNumPriorities] = {};
+  bool stopping_ = false;
+
+  std::vector<std::unique_ptr<media::ClosureThread>> workers_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_PACKAGING_JOB_QUEUE_H_
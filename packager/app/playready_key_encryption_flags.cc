@@ -31,7 +31,7 @@ namespace {
 const bool kFlagIsOptional = true;
 }
 
-bool ValidatePRCryptoFlags() {
+bool ValidatePRCryptoFlags(bool content_per_job) {
   bool success = true;
 
   const char playready_label[] = "--enable_playready_encryption";
@@ -41,7 +41,7 @@ bool ValidatePRCryptoFlags() {
     success = false;
   }
   if (!ValidateFlag("program_identifier", FLAGS_program_identifier,
-                    playready_enabled, !kFlagIsOptional, playready_label)) {
+                    playready_enabled, content_per_job, playready_label)) {
     success = false;
   }
   return success;
@@ -24,8 +24,10 @@ DECLARE_string(client_cert_private_key_password);
 namespace shaka {
 
 /// Validate PlayReady encryption flags.
+/// @param content_per_job is true if the program identifier may be set per
+///        job instead, i.e. with --job_server, in which case it is optional.
 /// @return true on success, false otherwise.
-bool ValidatePRCryptoFlags();
+bool ValidatePRCryptoFlags(bool content_per_job);
 
 }  // namespace shaka
 
@@ -48,7 +48,7 @@ DEFINE_hex_bytes(
 
 namespace shaka {
 
-bool ValidateRawKeyCryptoFlags() {
+bool ValidateRawKeyCryptoFlags(bool content_per_job) {
   bool success = true;
 
   if (FLAGS_enable_fixed_key_encryption)
@@ -68,11 +68,11 @@ bool ValidateRawKeyCryptoFlags() {
   // --key_id and --key are associated with --enable_raw_key_encryption and
   // --enable_raw_key_decryption.
   if (FLAGS_keys.empty()) {
-    if (!ValidateFlag("key_id", FLAGS_key_id_bytes, raw_key_crypto, false,
-                      raw_key_crypto_label)) {
+    if (!ValidateFlag("key_id", FLAGS_key_id_bytes, raw_key_crypto,
+                      content_per_job, raw_key_crypto_label)) {
       success = false;
     }
-    if (!ValidateFlag("key", FLAGS_key_bytes, raw_key_crypto, false,
+    if (!ValidateFlag("key", FLAGS_key_bytes, raw_key_crypto, content_per_job,
                       raw_key_crypto_label)) {
       success = false;
     }
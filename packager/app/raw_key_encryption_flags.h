@@ -24,8 +24,10 @@ DECLARE_hex_bytes(pssh);
 namespace shaka {
 
 /// Validate raw encryption/decryption flags.
+/// @param content_per_job is true if the keys may be set per job instead, i.e.
+///        with --job_server, in which case they are optional.
 /// @return true on success, false otherwise.
-bool ValidateRawKeyCryptoFlags();
+bool ValidateRawKeyCryptoFlags(bool content_per_job);
 
 }  // namespace shaka
 
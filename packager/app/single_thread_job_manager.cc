@@ -24,9 +24,12 @@ Status SingleThreadJobManager::InitializeJobs() {
 }
 
 Status SingleThreadJobManager::RunJobs() {
+  ScopedSampleBufferPool scoped_buffer_pool(&buffer_pool_);
+  const base::TimeDelta start_cpu_time = ThreadCpuTime();
   Status status;
   for (const JobEntry& job_entry : job_entries_)
     status.Update(job_entry.worker->Run());
+  cpu_time_ += ThreadCpuTime() - start_cpu_time;
   return status;
 }
 
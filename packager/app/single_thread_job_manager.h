@@ -24,6 +24,12 @@ class SingleThreadJobManager : public JobManager {
 
   Status InitializeJobs() override;
   Status RunJobs() override;
+
+  // All jobs run on the calling thread and share one sample buffer pool.
+  const SampleBufferPool& buffer_pool() const { return buffer_pool_; }
+
+ private:
+  SampleBufferPool buffer_pool_;
 };
 
 }  // namespace media
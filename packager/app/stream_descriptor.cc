@@ -18,11 +18,14 @@ enum FieldType {
   kUnknownField = 0,
   kStreamSelectorField,
   kInputField,
+  kInputFormatField,
+  kKeyFrameIndexField,
   kOutputField,
   kSegmentTemplateField,
   kBandwidthField,
   kLanguageField,
   kCcIndexField,
+  kNumaNodeField,
   kOutputFormatField,
   kHlsNameField,
   kHlsGroupIdField,
@@ -48,6 +51,8 @@ const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
     {"stream", kStreamSelectorField},
     {"input", kInputField},
     {"in", kInputField},
+    {"input_format", kInputFormatField},
+    {"key_frame_index", kKeyFrameIndexField},
     {"output", kOutputField},
     {"out", kOutputField},
     {"init_segment", kOutputField},
@@ -59,6 +64,7 @@ const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
     {"language", kLanguageField},
     {"lang", kLanguageField},
     {"cc_index", kCcIndexField},
+    {"numa_node", kNumaNodeField},
     {"output_format", kOutputFormatField},
     {"format", kOutputFormatField},
     {"hls_name", kHlsNameField},
@@ -144,6 +150,22 @@ base::Optional<StreamDescriptor> ParseStreamDescriptor(
         descriptor.cc_index = index;
         break;
       }
+      case kNumaNodeField: {
+        unsigned node;
+        if (!base::StringToUint(iter->second, &node)) {
+          LOG(ERROR) << "Non-numeric numa_node specified.";
+          return base::nullopt;
+        }
+        descriptor.numa_node = node;
+        break;
+      }
+      case kInputFormatField: {
+        descriptor.input_format = iter->second;
+        break;
+      }
+      case kKeyFrameIndexField:
+        descriptor.key_frame_index = iter->second;
+        break;
       case kOutputFormatField: {
         descriptor.output_format = iter->second;
         break;
@@ -72,6 +72,20 @@ class PackagerApp(object):
       logging.error('%s returned non-0 status', self.packaging_command_line)
     return packaging_result
 
+  def JobServer(self, jobs, flags=None):
+    """Runs packager --job_server with |jobs|, one job per line."""
+    if flags is None:
+      flags = []
+    cmd = [self.packager_binary, '--job_server']
+    cmd.extend(flags)
+    process = subprocess.Popen(
+        cmd,
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        env=self.GetEnv())
+    output, _ = process.communicate('\n'.join(jobs).encode())
+    return process.returncode, output.decode()
+
   def GetCommandLine(self):
     return self.packaging_command_line
 
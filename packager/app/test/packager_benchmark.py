@@ -0,0 +1,325 @@
+#!/usr/bin/python
+#
+# Copyright 2020 Google LLC. All Rights Reserved.
+#
+# Use of this source code is governed by a BSD-style
+# license that can be found in the LICENSE file or at
+# https://developers.google.com/open-source/licenses/bsd
+"""End-to-end throughput benchmarks for the packager binary.
+
+Packages representative inputs from the test data corpus and reports, per
+scenario, the realtime factor (seconds of media packaged per wall clock
+second), the CPU seconds, the peak resident set size and the number of bytes
+written.
+
+Usage (from the output directory, e.g. out/Release):
+  packager_benchmark.py
+  packager_benchmark.py --write_baseline=baseline.json
+  packager_benchmark.py --baseline=baseline.json --threshold=0.1
+
+With --baseline, the run fails if any scenario regresses by more than
+--threshold relative to the baseline. The baseline is machine specific, so it
+should be recorded on the machine that runs the comparison, e.g. once for
+every release on the release bots.
+"""
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+import packager_app
+import test_env
+
+_TEST_DATA_DIR = os.path.join(test_env.SRC_DIR, 'packager', 'media', 'test',
+                              'data')
+
+_KEY_ID = '31323334353637383930313233343536'
+_KEY = '32333435363738393021323334353637'
+
+_ENCRYPTION_FLAGS = [
+    '--enable_raw_key_encryption',
+    '--keys=label=:key_id={0}:key={1}'.format(_KEY_ID, _KEY),
+    '--clear_lead=0',
+]
+
+# The duration of the shared bear-640x360 clip, in seconds.
+_BEAR_DURATION = 2.764
+# The end of the last cue in bear-english.vtt, in seconds.
+_VTT_DURATION = 4.7
+
+
+class Scenario(object):
+  """A packaging command to benchmark."""
+
+  def __init__(self, name, media_duration, streams, flags=None):
+    """Initializes the scenario.
+
+    Args:
+      name: The name of the scenario, used as the key in the baseline file.
+      media_duration: The duration of the input media, in seconds.
+      streams: A function that returns the stream descriptors given the
+          output directory.
+      flags: Extra packager flags. '{out}' is replaced by the output
+          directory.
+    """
+    self.name = name
+    self.media_duration = media_duration
+    self.streams = streams
+    self.flags = flags or []
+
+  def GetCommand(self, out_dir):
+    flags = [flag.replace('{out}', out_dir) for flag in self.flags]
+    return self.streams(out_dir) + flags
+
+
+def _Input(file_name):
+  return os.path.join(_TEST_DATA_DIR, file_name)
+
+
+def _SegmentedStreams(file_name, streams, extension, init=True):
+  """Returns a function generating segmented stream descriptors."""
+
+  def Streams(out_dir):
+    descriptors = []
+    for stream in streams:
+      prefix = os.path.join(out_dir, stream)
+      descriptor = 'input=%s,stream=%s,segment_template=%s-$Number$.%s' % (
+          _Input(file_name), stream, prefix, extension)
+      if init:
+        descriptor += ',init_segment=%s-init.mp4' % prefix
+      descriptors.append(descriptor)
+    return descriptors
+
+  return Streams
+
+
+def _SingleFileStreams(file_name, streams, extension):
+  """Returns a function generating single file stream descriptors."""
+
+  def Streams(out_dir):
+    return [
+        'input=%s,stream=%s,output=%s' %
+        (_Input(file_name), stream,
+         os.path.join(out_dir, '%s.%s' % (stream, extension)))
+        for stream in streams
+    ]
+
+  return Streams
+
+
+_MPD_FLAGS = ['--mpd_output', os.path.join('{out}', 'output.mpd')]
+_HLS_FLAGS = [
+    '--hls_master_playlist_output',
+    os.path.join('{out}', 'output.m3u8')
+]
+
+_SCENARIOS = [
+    Scenario(
+        'mp4-vod-dash', _BEAR_DURATION,
+        _SingleFileStreams('bear-640x360.mp4', ['audio', 'video'], 'mp4'),
+        _MPD_FLAGS),
+    Scenario(
+        'mp4-vod-dash-encrypted', _BEAR_DURATION,
+        _SingleFileStreams('bear-640x360.mp4', ['audio', 'video'], 'mp4'),
+        _MPD_FLAGS + _ENCRYPTION_FLAGS),
+    Scenario(
+        'mp4-live-dash', _BEAR_DURATION,
+        _SegmentedStreams('bear-640x360.mp4', ['audio', 'video'], 'm4s'),
+        _MPD_FLAGS + ['--segment_duration=1']),
+    Scenario(
+        'ts-to-mp4-vod-hls', _BEAR_DURATION,
+        _SingleFileStreams('bear-640x360.ts', ['audio', 'video'], 'mp4'),
+        _HLS_FLAGS + ['--hls_playlist_type=VOD']),
+    Scenario(
+        'ts-live-hls', _BEAR_DURATION,
+        _SegmentedStreams(
+            'bear-640x360.ts', ['audio', 'video'], 'ts', init=False),
+        _HLS_FLAGS + ['--hls_playlist_type=LIVE', '--segment_duration=1']),
+    Scenario(
+        'ts-live-hls-key-rotation', _BEAR_DURATION,
+        _SegmentedStreams(
+            'bear-640x360.ts', ['audio', 'video'], 'ts', init=False),
+        _HLS_FLAGS + _ENCRYPTION_FLAGS + [
+            '--hls_playlist_type=LIVE', '--segment_duration=1',
+            '--crypto_period_duration=1'
+        ]),
+    Scenario(
+        'webm-vod-dash', _BEAR_DURATION,
+        _SingleFileStreams('bear-640x360.webm', ['audio', 'video'], 'webm'),
+        _MPD_FLAGS),
+    Scenario(
+        'webm-vod-dash-encrypted', _BEAR_DURATION,
+        _SingleFileStreams('bear-640x360.webm', ['audio', 'video'], 'webm'),
+        _MPD_FLAGS + _ENCRYPTION_FLAGS),
+    Scenario(
+        'webvtt-to-mp4-dash', _VTT_DURATION,
+        _SingleFileStreams('bear-english.vtt', ['text'], 'mp4'),
+        _MPD_FLAGS),
+]
+
+# The metrics compared with the baseline, and whether a higher value is
+# better.
+_METRICS = [
+    ('realtime_factor', True),
+    ('cpu_seconds', False),
+    ('peak_rss_kb', False),
+    ('bytes_written', False),
+]
+
+
+def _RunAndMeasure(cmd, env):
+  """Runs |cmd| and returns (returncode, cpu_seconds, peak_rss_kb)."""
+  process = subprocess.Popen(cmd, env=env)
+  if not hasattr(os, 'wait4'):
+    # Resource usage of a single child is not available, e.g. on Windows.
+    process.wait()
+    return process.returncode, None, None
+  _, status, usage = os.wait4(process.pid, 0)
+  # Let Popen know that the process has been reaped.
+  process.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+  peak_rss_kb = usage.ru_maxrss
+  if platform.system() == 'Darwin':
+    # ru_maxrss is in bytes on Mac and in kilobytes on Linux.
+    peak_rss_kb //= 1024
+  return process.returncode, usage.ru_utime + usage.ru_stime, peak_rss_kb
+
+
+def _GetDirectorySize(directory):
+  size = 0
+  for root, _, files in os.walk(directory):
+    for file_name in files:
+      size += os.path.getsize(os.path.join(root, file_name))
+  return size
+
+
+def _Median(values):
+  values = sorted(values)
+  middle = len(values) // 2
+  if len(values) % 2:
+    return values[middle]
+  return (values[middle - 1] + values[middle]) / 2.0
+
+
+def RunScenario(packager, scenario, repeat, extra_flags):
+  """Runs |scenario| |repeat| times and returns a dictionary of metrics."""
+  wall_times = []
+  cpu_times = []
+  peak_rss = []
+  bytes_written = 0
+  for _ in range(repeat):
+    out_dir = tempfile.mkdtemp()
+    try:
+      cmd = [packager.packager_binary] + scenario.GetCommand(out_dir)
+      cmd += extra_flags
+      start = time.time()
+      returncode, cpu_seconds, peak_rss_kb = _RunAndMeasure(
+          cmd, packager.GetEnv())
+      wall_times.append(time.time() - start)
+      if returncode != 0:
+        raise RuntimeError('%s failed with %d: %s' %
+                           (scenario.name, returncode, ' '.join(cmd)))
+      if cpu_seconds is not None:
+        cpu_times.append(cpu_seconds)
+        peak_rss.append(peak_rss_kb)
+      bytes_written = _GetDirectorySize(out_dir)
+    finally:
+      shutil.rmtree(out_dir, ignore_errors=True)
+
+  wall_seconds = _Median(wall_times)
+  return {
+      'wall_seconds': wall_seconds,
+      'realtime_factor': scenario.media_duration / max(wall_seconds, 1e-6),
+      'cpu_seconds': _Median(cpu_times) if cpu_times else None,
+      'peak_rss_kb': max(peak_rss) if peak_rss else None,
+      'bytes_written': bytes_written,
+  }
+
+
+def FindRegressions(results, baseline, threshold):
+  """Returns a list of messages for metrics worse than |baseline|."""
+  regressions = []
+  for name, metrics in sorted(results.items()):
+    if name not in baseline:
+      continue
+    for metric, higher_is_better in _METRICS:
+      value = metrics.get(metric)
+      expected = baseline[name].get(metric)
+      if value is None or not expected:
+        continue
+      if higher_is_better:
+        regressed = value < expected / (1.0 + threshold)
+      else:
+        regressed = value > expected * (1.0 + threshold)
+      if regressed:
+        regressions.append('%s: %s is %.4g, baseline is %.4g' %
+                           (name, metric, value, expected))
+  return regressions
+
+
+def _PrintResults(results):
+  print('%-28s %10s %10s %12s %14s' %
+        ('scenario', 'realtime', 'cpu (s)', 'peak rss(kb)', 'bytes written'))
+  for name, metrics in sorted(results.items()):
+    cpu_seconds = metrics['cpu_seconds']
+    peak_rss_kb = metrics['peak_rss_kb']
+    print('%-28s %9.1fx %10s %12s %14d' %
+          (name, metrics['realtime_factor'],
+           '-' if cpu_seconds is None else '%.3f' % cpu_seconds,
+           '-' if peak_rss_kb is None else peak_rss_kb,
+           metrics['bytes_written']))
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=argparse.RawTextHelpFormatter)
+  parser.add_argument('--filter', default='',
+                      help='Only run the scenarios containing this string.')
+  parser.add_argument('--repeat', type=int, default=5,
+                      help='Number of runs per scenario. The median wall '
+                      'clock and CPU times are reported.')
+  parser.add_argument('--single_threaded', action='store_true',
+                      help='Run the packager with --single_threaded.')
+  parser.add_argument('--baseline',
+                      help='JSON file with the results of a previous run to '
+                      'compare with.')
+  parser.add_argument('--threshold', type=float, default=0.1,
+                      help='Fraction a metric may be worse than the baseline '
+                      'before it is reported as a regression.')
+  parser.add_argument('--write_baseline',
+                      help='Write the results of this run to this JSON file.')
+  args = parser.parse_args()
+
+  packager = packager_app.PackagerApp()
+  extra_flags = ['--single_threaded'] if args.single_threaded else []
+
+  results = {}
+  for scenario in _SCENARIOS:
+    if args.filter not in scenario.name:
+      continue
+    results[scenario.name] = RunScenario(packager, scenario,
+                                         max(args.repeat, 1), extra_flags)
+  _PrintResults(results)
+
+  if args.write_baseline:
+    with open(args.write_baseline, 'w') as f:
+      json.dump(results, f, indent=2, sort_keys=True)
+
+  if args.baseline:
+    with open(args.baseline) as f:
+      baseline = json.load(f)
+    regressions = FindRegressions(results, baseline, args.threshold)
+    for regression in regressions:
+      print('REGRESSION ' + regression)
+    if regressions:
+      return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
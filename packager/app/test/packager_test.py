@@ -693,11 +693,76 @@ class PackagerFunctionalTest(PackagerAppTest):
                   '\nExpecting: \n %s\n\nBut seeing: \n%s' %
                   (expected_stream_info, stream_info))
 
+  def testJobServer(self):
+    test_file = os.path.join(self.test_data_dir, 'bear-640x360.mp4')
+    jobs = []
+    for job in ['job1', 'job2']:
+      jobs.append(' '.join([
+          'input=%s,stream=video,output=%s' %
+          (test_file, os.path.join(self.tmp_dir, job + '_video.mp4')),
+          'input=%s,stream=audio,output=%s' %
+          (test_file, os.path.join(self.tmp_dir, job + '_audio.mp4')),
+          '--mpd_output=%s' % os.path.join(self.tmp_dir, job + '.mpd'),
+      ]))
+    jobs.append('input=%s,stream=video' % test_file)
+
+    result, output = self.packager.JobServer(jobs)
+    # The packaging failed status of the last job.
+    self.assertEqual(result, 2)
+    self.assertIn('Job 1 completed successfully.', output)
+    self.assertIn('Job 2 completed successfully.', output)
+    self.assertIn('Job 3 failed', output)
+    for job in ['job1', 'job2']:
+      self.assertTrue(os.path.exists(os.path.join(self.tmp_dir, job + '.mpd')))
+
+  def testJobServerWithJobListAndKeysPerJob(self):
+    test_file = os.path.join(self.test_data_dir, 'bear-640x360.mp4')
+    jobs = []
+    for job in ['title1', 'title2']:
+      jobs.append(' '.join([
+          'input=%s,stream=video,output=%s' %
+          (test_file, os.path.join(self.tmp_dir, job + '_video.mp4')),
+          '--keys=label=:key_id={0}:key={1}'.format(self.encryption_key_id,
+                                                    self.encryption_key),
+      ]))
+    # Without keys.
+    jobs.append('input=%s,stream=video,output=%s' %
+                (test_file, os.path.join(self.tmp_dir, 'title3_video.mp4')))
+    job_list = os.path.join(self.tmp_dir, 'job_list.txt')
+    with open(job_list, 'w') as f:
+      f.write('\n'.join(jobs))
+
+    result, output = self.packager.JobServer(
+        [], ['--job_list=%s' % job_list, '--enable_raw_key_encryption'])
+    self.assertEqual(result, 2)
+    self.assertIn('Job 1 completed successfully.', output)
+    self.assertIn('Job 2 completed successfully.', output)
+    self.assertIn('Job 3 failed', output)
+    for job in ['title1', 'title2']:
+      self.assertTrue(
+          os.path.exists(os.path.join(self.tmp_dir, job + '_video.mp4')))
+
   def testFirstStream(self):
     self.assertPackageSuccess(
         self._GetStreams(['0']), self._GetFlags(output_dash=True))
     self._CheckTestResults('first-stream')
 
+  def testFirstStreamWithWorkerThreadPool(self):
+    flags = self._GetFlags(output_dash=True)
+    flags.remove('--single_threaded')
+    flags.append('--num_worker_threads=2')
+    self.assertPackageSuccess(self._GetStreams(['0']), flags)
+    self._CheckTestResults('first-stream')
+
+  def testVideoAudioWithDeterministicManifests(self):
+    # The outputs are registered in stream descriptor order, video first as in
+    # the single threaded golden manifest.
+    flags = self._GetFlags(output_dash=True)
+    flags.remove('--single_threaded')
+    flags.append('--deterministic_manifests')
+    self.assertPackageSuccess(self._GetStreams(['video', 'audio']), flags)
+    self._CheckTestResults('audio-video')
+
   # Probably one of the most common scenarios is to package audio and video.
   def testAudioVideo(self):
     self.assertPackageSuccess(
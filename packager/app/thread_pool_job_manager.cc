@@ -0,0 +1,163 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/thread_pool_job_manager.h"
+
+#include <string>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/sys_info.h"
+#include "packager/media/base/numa_util.h"
+#include "packager/media/base/sample_buffer_pool.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
+#include "packager/media/chunking/sync_point_queue.h"
+#include "packager/media/origin/origin_handler.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Tracks the completion of the jobs running on the pool.
+class JobTracker {
+ public:
+  JobTracker(const std::vector<std::shared_ptr<OriginHandler>>& workers,
+             const std::vector<int>& numa_nodes,
+             SyncPointQueue* sync_points)
+      : workers_(workers),
+        numa_nodes_(numa_nodes),
+        sync_points_(sync_points),
+        num_running_jobs_(workers.size()),
+        all_done_(&lock_) {}
+
+  void RunJob(size_t job_index) {
+    // The worker thread stays pinned after the job, which is fine as the jobs
+    // pinned to a node run until the end of the packaging.
+    if (numa_nodes_[job_index] >= 0)
+      PinCurrentThreadToNumaNode(numa_nodes_[job_index]);
+    const base::TimeDelta start_cpu_time = ThreadCpuTime();
+    Status job_status;
+    {
+      SampleBufferPool buffer_pool;
+      ScopedSampleBufferPool scoped_buffer_pool(&buffer_pool);
+      job_status = workers_[job_index]->Run();
+    }
+    const base::TimeDelta cpu_time = ThreadCpuTime() - start_cpu_time;
+
+    base::AutoLock auto_lock(lock_);
+    status_.Update(job_status);
+    cpu_time_ += cpu_time;
+    // Cancel the other jobs as soon as one fails, which is what JobManager
+    // does too.
+    if (!job_status.ok())
+      CancelLocked();
+    if (--num_running_jobs_ == 0)
+      all_done_.Signal();
+  }
+
+  Status WaitForAllJobs() {
+    base::AutoLock auto_lock(lock_);
+    while (num_running_jobs_ > 0)
+      all_done_.Wait();
+    return status_;
+  }
+
+  // Only valid once WaitForAllJobs() returned.
+  base::TimeDelta cpu_time() const { return cpu_time_; }
+
+ private:
+  JobTracker(const JobTracker&) = delete;
+  JobTracker& operator=(const JobTracker&) = delete;
+
+  void CancelLocked() {
+    if (cancelled_)
+      return;
+    cancelled_ = true;
+    if (sync_points_)
+      sync_points_->Cancel();
+    for (const std::shared_ptr<OriginHandler>& worker : workers_)
+      worker->Cancel();
+  }
+
+  const std::vector<std::shared_ptr<OriginHandler>>& workers_;
+  const std::vector<int>& numa_nodes_;
+  SyncPointQueue* const sync_points_;
+
+  base::Lock lock_;
+  size_t num_running_jobs_;
+  base::ConditionVariable all_done_;
+  Status status_;
+  base::TimeDelta cpu_time_;
+  bool cancelled_ = false;
+};
+
+}  // namespace
+
+ThreadPoolJobManager::ThreadPoolJobManager(
+    std::unique_ptr<SyncPointQueue> sync_points,
+    size_t num_worker_threads,
+    bool has_live_inputs)
+    : JobManager(std::move(sync_points)),
+      num_worker_threads_(num_worker_threads),
+      has_live_inputs_(has_live_inputs) {}
+
+Status ThreadPoolJobManager::InitializeJobs() {
+  Status status;
+  for (const JobEntry& job_entry : job_entries_)
+    status.Update(job_entry.worker->Initialize());
+  return status;
+}
+
+Status ThreadPoolJobManager::RunJobs() {
+  if (job_entries_.empty())
+    return Status::OK;
+
+  std::vector<std::shared_ptr<OriginHandler>> workers;
+  std::vector<int> numa_nodes;
+  for (const JobEntry& job_entry : job_entries_) {
+    workers.push_back(job_entry.worker);
+    numa_nodes.push_back(job_entry.numa_node);
+  }
+
+  const size_t num_threads = num_worker_threads_ > 0
+                                 ? num_worker_threads_
+                                 : base::SysInfo::NumberOfProcessors();
+  // Every job runs as a single task until it ends. Jobs block on each other
+  // while aligning cue points and live jobs never end, so the jobs that do not
+  // get a thread would never start.
+  if ((sync_points_ || has_live_inputs_) && num_threads < workers.size()) {
+    const std::string reason =
+        sync_points_ ? "Cue alignment" : "Packaging live inputs";
+    LOG(ERROR) << reason << " requires all " << workers.size()
+               << " jobs to run concurrently, but there are only "
+               << num_threads << " worker threads.";
+    return Status(error::INVALID_ARGUMENT,
+                  reason + " requires --num_worker_threads to be at least " +
+                      std::to_string(workers.size()) + ".");
+  }
+
+  JobTracker tracker(workers, numa_nodes, sync_points_.get());
+  WorkStealingThreadPool pool(num_threads);
+  for (size_t i = 0; i < workers.size(); ++i) {
+    pool.PostTask(
+        base::Bind(&JobTracker::RunJob, base::Unretained(&tracker), i));
+  }
+  Status status = tracker.WaitForAllJobs();
+  cpu_time_ += tracker.cpu_time();
+  return status;
+}
+
+void ThreadPoolJobManager::CancelJobs() {
+  if (sync_points_)
+    sync_points_->Cancel();
+  for (const JobEntry& job_entry : job_entries_)
+    job_entry.worker->Cancel();
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,46 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_THREAD_POOL_JOB_MANAGER_H_
+#define PACKAGER_APP_THREAD_POOL_JOB_MANAGER_H_
+
+#include <memory>
+
+#include "packager/app/job_manager.h"
+
+namespace shaka {
+namespace media {
+
+// A subclass of JobManager that runs the jobs as tasks on a fixed size
+// work-stealing thread pool instead of one thread per job. Every job is a
+// single task running until the job ends, so the jobs beyond the number of
+// threads only start once earlier jobs complete.
+class ThreadPoolJobManager : public JobManager {
+ public:
+  // @param sync_points is an optional SyncPointQueue used to synchronize and
+  //        align cue points. JobManager cancels @a sync_points when any job
+  //        fails or is cancelled. It can be NULL.
+  // @param num_worker_threads is the number of worker threads. A value of zero
+  //        means the number of processors.
+  // @param has_live_inputs tells whether some inputs are live. Live jobs never
+  //        end, so RunJobs() fails if there are more jobs than threads.
+  ThreadPoolJobManager(std::unique_ptr<SyncPointQueue> sync_points,
+                       size_t num_worker_threads,
+                       bool has_live_inputs);
+
+  Status InitializeJobs() override;
+  Status RunJobs() override;
+  void CancelJobs() override;
+
+ private:
+  const size_t num_worker_threads_;
+  const bool has_live_inputs_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_THREAD_POOL_JOB_MANAGER_H_
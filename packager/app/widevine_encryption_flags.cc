@@ -58,6 +58,22 @@ DEFINE_int32(crypto_period_duration,
              0,
              "Crypto period duration in seconds. If it is non-zero, key "
              "rotation is enabled.");
+DEFINE_int32(crypto_period_count,
+             10,
+             "Number of crypto periods whose keys are requested in each key "
+             "rotation request to the Widevine key server.");
+DEFINE_int32(crypto_period_lookahead,
+             0,
+             "Number of crypto periods whose keys are fetched ahead of the "
+             "current crypto period when key rotation is enabled. It is at "
+             "least --crypto_period_count. If it is zero, the keys of five "
+             "key rotation requests are fetched ahead.");
+DEFINE_bool(fetch_keys_in_background,
+            false,
+            "Fetch the keys from the Widevine or PlayReady key server in the "
+            "background while the inputs are probed, instead of before "
+            "packaging starts. A failed request is then reported when "
+            "packaging starts.");
 DEFINE_hex_bytes(group_id, "", "Identifier for a group of licenses (hex).");
 DEFINE_bool(enable_entitlement_license,
             false,
@@ -68,7 +84,7 @@ namespace {
 const bool kOptional = true;
 }  // namespace
 
-bool ValidateWidevineCryptoFlags() {
+bool ValidateWidevineCryptoFlags(bool content_per_job) {
   bool success = true;
 
   const bool widevine_crypto =
@@ -104,7 +120,7 @@ bool ValidateWidevineCryptoFlags() {
   if (!ValidateFlag("content_id",
                     FLAGS_content_id_bytes,
                     FLAGS_enable_widevine_encryption,
-                    !kOptional,
+                    content_per_job,
                     widevine_encryption_label)) {
     success = false;
   }
@@ -168,6 +184,14 @@ bool ValidateWidevineCryptoFlags() {
     PrintError("--crypto_period_duration should not be negative.");
     success = false;
   }
+  if (FLAGS_crypto_period_count <= 0) {
+    PrintError("--crypto_period_count should be positive.");
+    success = false;
+  }
+  if (FLAGS_crypto_period_lookahead < 0) {
+    PrintError("--crypto_period_lookahead should not be negative.");
+    success = false;
+  }
   return success;
 }
 
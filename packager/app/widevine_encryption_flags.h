@@ -26,14 +26,19 @@ DECLARE_hex_bytes(aes_signing_key);
 DECLARE_hex_bytes(aes_signing_iv);
 DECLARE_string(rsa_signing_key_path);
 DECLARE_int32(crypto_period_duration);
+DECLARE_int32(crypto_period_count);
+DECLARE_int32(crypto_period_lookahead);
+DECLARE_bool(fetch_keys_in_background);
 DECLARE_hex_bytes(group_id);
 DECLARE_bool(enable_entitlement_license);
 
 namespace shaka {
 
 /// Validate widevine encryption/decryption flags.
+/// @param content_per_job is true if the content id may be set per job
+///        instead, i.e. with --job_server, in which case it is optional.
 /// @return true on success, false otherwise.
-bool ValidateWidevineCryptoFlags();
+bool ValidateWidevineCryptoFlags(bool content_per_job);
 
 }  // namespace shaka
 
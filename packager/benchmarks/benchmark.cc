@@ -0,0 +1,121 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/benchmarks/benchmark.h"
+
+#include <map>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace benchmark {
+namespace {
+
+typedef std::map<std::string, BenchmarkFunction> BenchmarkMap;
+
+// Sorted by name so the benchmarks run and are reported in a stable order.
+BenchmarkMap* GetBenchmarks() {
+  static BenchmarkMap* benchmarks = new BenchmarkMap;
+  return benchmarks;
+}
+
+std::string EscapeJsonString(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+          escaped += base::StringPrintf("\\u%04x", c);
+        else
+          escaped += c;
+        break;
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+State::State(base::TimeDelta min_time) : min_time_(min_time) {}
+
+bool State::KeepRunning() {
+  if (iterations_ == 0)
+    start_time_ = base::TimeTicks::Now();
+  if (iterations_ == next_time_check_) {
+    elapsed_ = base::TimeTicks::Now() - start_time_;
+    if (elapsed_ >= min_time_)
+      return false;
+    next_time_check_ *= 2;
+  }
+  ++iterations_;
+  return true;
+}
+
+BenchmarkRegisterer::BenchmarkRegisterer(const char* name,
+                                         BenchmarkFunction function) {
+  const bool inserted = GetBenchmarks()->emplace(name, function).second;
+  CHECK(inserted) << "Duplicate benchmark " << name;
+}
+
+std::vector<BenchmarkResult> RunBenchmarks(const std::string& filter,
+                                           base::TimeDelta min_time) {
+  std::vector<BenchmarkResult> results;
+  for (const auto& entry : *GetBenchmarks()) {
+    const std::string& name = entry.first;
+    if (!filter.empty() && name.find(filter) == std::string::npos)
+      continue;
+
+    LOG(INFO) << "Running " << name;
+    State state(min_time);
+    entry.second(&state);
+    CHECK_GT(state.iterations(), 0) << name << " never called KeepRunning().";
+
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = state.iterations();
+    result.nanoseconds_per_iteration =
+        state.elapsed().InMicrosecondsF() * 1000 / state.iterations();
+    if (state.bytes_per_iteration() > 0 && state.elapsed().InSecondsF() > 0) {
+      result.bytes_per_second =
+          static_cast<double>(state.bytes_per_iteration()) *
+          state.iterations() / state.elapsed().InSecondsF();
+    }
+    results.push_back(result);
+  }
+  return results;
+}
+
+std::string BenchmarkResultsToJson(const std::vector<BenchmarkResult>& results,
+                                   const std::string& packager_version) {
+  std::string json = "{\n";
+  base::StringAppendF(&json, "  \"packager_version\": \"%s\",\n",
+                      EscapeJsonString(packager_version).c_str());
+  json += "  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& result = results[i];
+    json += i == 0 ? "\n" : ",\n";
+    base::StringAppendF(
+        &json,
+        "    {\"name\": \"%s\", \"iterations\": %lld, "
+        "\"ns_per_iteration\": %.3f, \"bytes_per_second\": %.0f}",
+        EscapeJsonString(result.name).c_str(),
+        static_cast<long long>(result.iterations),
+        result.nanoseconds_per_iteration, result.bytes_per_second);
+  }
+  json += results.empty() ? "]\n" : "\n  ]\n";
+  json += "}\n";
+  return json;
+}
+
+}  // namespace benchmark
+}  // namespace shaka
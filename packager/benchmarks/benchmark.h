@@ -0,0 +1,112 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_BENCHMARKS_BENCHMARK_H_
+#define PACKAGER_BENCHMARKS_BENCHMARK_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace benchmark {
+
+/// Passed to a benchmark, which runs the code to measure in a
+/// `while (state->KeepRunning())` loop. Setup before the loop is not measured.
+class State {
+ public:
+  /// @param min_time is the minimum time to run the measured loop for.
+  explicit State(base::TimeDelta min_time);
+
+  /// @return true if the measured code should be run another time.
+  bool KeepRunning();
+
+  /// Set the number of bytes processed in every iteration. Used to report the
+  /// throughput.
+  void set_bytes_per_iteration(int64_t bytes_per_iteration) {
+    bytes_per_iteration_ = bytes_per_iteration;
+  }
+
+  int64_t iterations() const { return iterations_; }
+  int64_t bytes_per_iteration() const { return bytes_per_iteration_; }
+  base::TimeDelta elapsed() const { return elapsed_; }
+
+ private:
+  State(const State&) = delete;
+  State& operator=(const State&) = delete;
+
+  const base::TimeDelta min_time_;
+  base::TimeTicks start_time_;
+  base::TimeDelta elapsed_;
+  int64_t iterations_ = 0;
+  // The clock is only checked when |iterations_| reaches this, which doubles
+  // every time, to keep the overhead of fast benchmarks low.
+  int64_t next_time_check_ = 1;
+  int64_t bytes_per_iteration_ = 0;
+};
+
+/// Prevents the compiler from optimizing away the computation of @a value.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+  const volatile char* volatile sink =
+      reinterpret_cast<const volatile char*>(&value);
+  (void)sink;
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+typedef void (*BenchmarkFunction)(State* state);
+
+/// Registers a benchmark at static initialization time. Use SHAKA_BENCHMARK
+/// instead of using this class directly.
+class BenchmarkRegisterer {
+ public:
+  BenchmarkRegisterer(const char* name, BenchmarkFunction function);
+};
+
+/// Defines and registers a benchmark, e.g.
+///   SHAKA_BENCHMARK(BM_Foo) {
+///     Foo foo;
+///     while (state->KeepRunning())
+///       foo.Bar();
+///   }
+#define SHAKA_BENCHMARK(name)                                        \
+  static void name(::shaka::benchmark::State* state);                \
+  static ::shaka::benchmark::BenchmarkRegisterer name##_registerer( \
+      #name, &name);                                                 \
+  static void name(::shaka::benchmark::State* state)
+
+struct BenchmarkResult {
+  std::string name;
+  int64_t iterations = 0;
+  double nanoseconds_per_iteration = 0;
+  /// Zero if the benchmark does not report the bytes processed.
+  double bytes_per_second = 0;
+};
+
+/// Runs the registered benchmarks in name order.
+/// @param filter only runs the benchmarks with a name containing it. Runs all
+///        the benchmarks if it is empty.
+/// @param min_time is the minimum time to run every benchmark for.
+/// @return the results in name order.
+std::vector<BenchmarkResult> RunBenchmarks(const std::string& filter,
+                                           base::TimeDelta min_time);
+
+/// Serializes @a results to JSON. The output only depends on the results, with
+/// a fixed field order, so it can be compared across releases.
+/// @param packager_version is the version of the packager being measured.
+std::string BenchmarkResultsToJson(const std::vector<BenchmarkResult>& results,
+                                   const std::string& packager_version);
+
+}  // namespace benchmark
+}  // namespace shaka
+
+#endif  // PACKAGER_BENCHMARKS_BENCHMARK_H_
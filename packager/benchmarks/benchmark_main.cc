@@ -0,0 +1,90 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gflags/gflags.h>
+
+#include <iostream>
+
+#include "packager/base/at_exit.h"
+#include "packager/base/command_line.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/file/file.h"
+#include "packager/version/version.h"
+
+DEFINE_string(benchmark_filter,
+              "",
+              "Only run the benchmarks with a name containing this string. "
+              "Runs all the benchmarks if empty.");
+DEFINE_int32(benchmark_min_time_ms,
+             500,
+             "Minimum time in milliseconds to run every benchmark for.");
+DEFINE_string(benchmark_output,
+              "",
+              "File to write the JSON results to. The results are written to "
+              "stdout if empty.");
+
+namespace shaka {
+namespace {
+
+const char kUsage[] =
+    "Microbenchmarks of the packaging hot paths.\n"
+    "Usage: %s [--benchmark_filter=<substring>] "
+    "[--benchmark_output=<file>]\n";
+
+enum ExitStatus {
+  kSuccess = 0,
+  kArgumentValidationFailed,
+  kNoBenchmarksRun,
+  kFailedToWriteOutput,
+};
+
+int BenchmarkMain(int argc, char** argv) {
+  base::AtExitManager exit;
+  // Needed to enable VLOG/DVLOG through --vmodule or --v.
+  base::CommandLine::Init(argc, argv);
+
+  // Set up logging.
+  logging::LoggingSettings log_settings;
+  log_settings.logging_dest = logging::LOG_TO_SYSTEM_DEBUG_LOG;
+  CHECK(logging::InitLogging(log_settings));
+
+  google::SetVersionString(GetPackagerVersion());
+  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_benchmark_min_time_ms <= 0) {
+    LOG(ERROR) << "--benchmark_min_time_ms must be positive.";
+    return kArgumentValidationFailed;
+  }
+
+  const std::vector<benchmark::BenchmarkResult> results =
+      benchmark::RunBenchmarks(
+          FLAGS_benchmark_filter,
+          base::TimeDelta::FromMilliseconds(FLAGS_benchmark_min_time_ms));
+  if (results.empty()) {
+    LOG(ERROR) << "No benchmark matches '" << FLAGS_benchmark_filter << "'.";
+    return kNoBenchmarksRun;
+  }
+
+  const std::string json =
+      benchmark::BenchmarkResultsToJson(results, GetPackagerVersion());
+  if (FLAGS_benchmark_output.empty()) {
+    std::cout << json;
+  } else if (!File::WriteStringToFile(FLAGS_benchmark_output.c_str(), json)) {
+    LOG(ERROR) << "Failed to write " << FLAGS_benchmark_output;
+    return kFailedToWriteOutput;
+  }
+  return kSuccess;
+}
+
+}  // namespace
+}  // namespace shaka
+
+int main(int argc, char** argv) {
+  return shaka::BenchmarkMain(argc, argv);
+}
@@ -0,0 +1,80 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/benchmarks/benchmark.h"
+
+#include <gtest/gtest.h>
+
+namespace shaka {
+namespace benchmark {
+namespace {
+
+int g_num_runs = 0;
+
+}  // namespace
+
+SHAKA_BENCHMARK(BM_UnittestCountRuns) {
+  state->set_bytes_per_iteration(10);
+  while (state->KeepRunning())
+    ++g_num_runs;
+}
+
+TEST(BenchmarkTest, KeepRunningRunsForMinTime) {
+  const base::TimeDelta kMinTime = base::TimeDelta::FromMilliseconds(10);
+  State state(kMinTime);
+  int64_t iterations = 0;
+  while (state.KeepRunning())
+    ++iterations;
+  EXPECT_EQ(iterations, state.iterations());
+  EXPECT_GE(state.elapsed(), kMinTime);
+}
+
+TEST(BenchmarkTest, RunBenchmarksAppliesFilter) {
+  EXPECT_TRUE(RunBenchmarks("NoSuchBenchmark", base::TimeDelta()).empty());
+
+  g_num_runs = 0;
+  std::vector<BenchmarkResult> results =
+      RunBenchmarks("UnittestCountRuns", base::TimeDelta());
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ("BM_UnittestCountRuns", results[0].name);
+  EXPECT_EQ(g_num_runs, results[0].iterations);
+  EXPECT_GT(results[0].iterations, 0);
+}
+
+TEST(BenchmarkTest, ResultsToJson) {
+  std::vector<BenchmarkResult> results(2);
+  results[0].name = "BM_A";
+  results[0].iterations = 100;
+  results[0].nanoseconds_per_iteration = 12.5;
+  results[0].bytes_per_second = 1000;
+  results[1].name = "BM_B";
+  results[1].iterations = 7;
+  results[1].nanoseconds_per_iteration = 3;
+
+  const char kExpectedJson[] =
+      "{\n"
+      "  \"packager_version\": \"v2.4.0\",\n"
+      "  \"benchmarks\": [\n"
+      "    {\"name\": \"BM_A\", \"iterations\": 100, "
+      "\"ns_per_iteration\": 12.500, \"bytes_per_second\": 1000},\n"
+      "    {\"name\": \"BM_B\", \"iterations\": 7, "
+      "\"ns_per_iteration\": 3.000, \"bytes_per_second\": 0}\n"
+      "  ]\n"
+      "}\n";
+  EXPECT_EQ(kExpectedJson, BenchmarkResultsToJson(results, "v2.4.0"));
+}
+
+TEST(BenchmarkTest, EmptyResultsToJson) {
+  EXPECT_EQ(
+      "{\n"
+      "  \"packager_version\": \"\\\"quoted\\\"\",\n"
+      "  \"benchmarks\": []\n"
+      "}\n",
+      BenchmarkResultsToJson(std::vector<BenchmarkResult>(), "\"quoted\""));
+}
+
+}  // namespace benchmark
+}  // namespace shaka
@@ -0,0 +1,67 @@
+# Copyright 2020 Google LLC. All rights reserved.
+#
+# Use of this source code is governed by a BSD-style
+# license that can be found in the LICENSE file or at
+# https://developers.google.com/open-source/licenses/bsd
+
+{
+  'variables': {
+    'shaka_code': 1,
+  },
+  'targets': [
+    {
+      'target_name': 'benchmark',
+      'type': 'static_library',
+      'sources': [
+        'benchmark.cc',
+        'benchmark.h',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+      ],
+    },
+    {
+      'target_name': 'packager_benchmarks',
+      'type': 'executable',
+      'sources': [
+        'benchmark_main.cc',
+        'buffer_benchmarks.cc',
+        'codec_benchmarks.cc',
+        'crypto_benchmarks.cc',
+        'file_benchmarks.cc',
+        'manifest_benchmarks.cc',
+        'mp4_box_benchmarks.cc',
+        'packager_benchmarks.cc',
+        'queue_benchmarks.cc',
+        'ts_writer_benchmarks.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../file/file.gyp:file',
+        '../hls/hls.gyp:hls_builder',
+        '../media/base/media_base.gyp:media_base',
+        '../media/codecs/codecs.gyp:codecs',
+        '../media/formats/mp2t/mp2t.gyp:mp2t',
+        '../media/formats/mp4/mp4.gyp:mp4',
+        '../mpd/mpd.gyp:mpd_builder',
+        '../packager.gyp:libpackager',
+        '../third_party/boringssl/boringssl.gyp:boringssl',
+        '../third_party/gflags/gflags.gyp:gflags',
+        '../version/version.gyp:version',
+        'benchmark',
+      ],
+    },
+    {
+      'target_name': 'benchmark_unittest',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'benchmark_unittest.cc',
+      ],
+      'dependencies': [
+        '../testing/gtest.gyp:gtest',
+        '../testing/gtest.gyp:gtest_main',
+        'benchmark',
+      ],
+    },
+  ],
+}
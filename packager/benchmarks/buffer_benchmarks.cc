@@ -0,0 +1,94 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/base/logging.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/byte_queue.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kNumValues = 4096;
+
+SHAKA_BENCHMARK(BM_BufferReaderRead4) {
+  const std::vector<uint8_t> buffer(kNumValues * sizeof(uint32_t), 0x5a);
+  state->set_bytes_per_iteration(buffer.size());
+  while (state->KeepRunning()) {
+    BufferReader reader(buffer.data(), buffer.size());
+    uint32_t sum = 0;
+    uint32_t value = 0;
+    while (reader.Read4(&value))
+      sum += value;
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+SHAKA_BENCHMARK(BM_BufferReaderRead8) {
+  const std::vector<uint8_t> buffer(kNumValues * sizeof(uint64_t), 0x5a);
+  state->set_bytes_per_iteration(buffer.size());
+  while (state->KeepRunning()) {
+    BufferReader reader(buffer.data(), buffer.size());
+    uint64_t sum = 0;
+    uint64_t value = 0;
+    while (reader.Read8(&value))
+      sum += value;
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+SHAKA_BENCHMARK(BM_BufferWriterAppendInt32) {
+  state->set_bytes_per_iteration(kNumValues * sizeof(uint32_t));
+  BufferWriter writer;
+  while (state->KeepRunning()) {
+    writer.Clear();
+    for (uint32_t i = 0; i < kNumValues; ++i)
+      writer.AppendInt(i);
+    benchmark::DoNotOptimize(writer.Buffer());
+  }
+  CHECK_EQ(kNumValues * sizeof(uint32_t), writer.Size());
+}
+
+SHAKA_BENCHMARK(BM_BufferWriterAppendArray) {
+  const std::vector<uint8_t> data(1500, 0x5a);
+  const size_t kNumArrays = 64;
+  state->set_bytes_per_iteration(kNumArrays * data.size());
+  BufferWriter writer;
+  while (state->KeepRunning()) {
+    writer.Clear();
+    for (size_t i = 0; i < kNumArrays; ++i)
+      writer.AppendArray(data.data(), data.size());
+    benchmark::DoNotOptimize(writer.Buffer());
+  }
+}
+
+// A parser queue, e.g. of the MP4 parser, which keeps most of a large box
+// queued while the input is pushed in chunks. The queued bytes, just under a
+// power of two, leave little room at the end of the buffer.
+SHAKA_BENCHMARK(BM_ByteQueuePushWithLargeBacklog) {
+  const std::vector<uint8_t> chunk(64 * 1024, 0x5a);
+  const int kBacklogSize = 8 * 1024 * 1024 - 200 * 1024;
+  const size_t kNumChunks = 256;
+  state->set_bytes_per_iteration(kNumChunks * chunk.size());
+  ByteQueue queue;
+  while (state->KeepRunning()) {
+    for (size_t i = 0; i < kNumChunks; ++i) {
+      queue.Push(chunk.data(), chunk.size());
+      const uint8_t* data = nullptr;
+      int size = 0;
+      queue.Peek(&data, &size);
+      if (size > kBacklogSize)
+        queue.Pop(size - kBacklogSize);
+      benchmark::DoNotOptimize(data);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace media
+}  // namespace shaka
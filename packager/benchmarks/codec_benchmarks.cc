@@ -0,0 +1,292 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/media/base/bit_reader.h"
+#include "packager/media/base/bit_writer.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/codecs/aac_audio_specific_config.h"
+#include "packager/media/codecs/av1_parser.h"
+#include "packager/media/codecs/h264_parser.h"
+#include "packager/media/codecs/h265_parser.h"
+#include "packager/media/codecs/h26x_bit_reader.h"
+#include "packager/media/codecs/h26x_byte_scanner.h"
+#include "packager/media/codecs/nal_unit_to_byte_stream_converter.h"
+#include "packager/media/codecs/nalu_reader.h"
+#include "packager/media/codecs/vp9_parser.h"
+#include "packager/media/formats/mp2t/adts_header.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// SPS, PPS and the prefix of a slice with multiple luma weights, from
+// h264_parser_unittest.cc.
+const uint8_t kH264Sps[] = {
+    0x67, 0x64, 0x00, 0x28, 0xAC, 0xB2, 0x00, 0xF0, 0x04, 0x4F,
+    0xCB, 0x80, 0xB5, 0x01, 0x01, 0x01, 0x40, 0x00, 0x00, 0x03,
+    0x00, 0x40, 0x00, 0x00, 0x0F, 0x03, 0xC6, 0x0C, 0x92,
+};
+const uint8_t kH264Pps[] = {
+    0x68, 0xEB, 0xCC, 0xB2, 0x2C,
+};
+const uint8_t kH264Slice[] = {
+    0x41, 0x9A, 0x72, 0x78, 0x43, 0xC9, 0x94, 0xC0, 0x8C, 0xFF, 0xC1, 0x54,
+};
+
+// SPS, PPS and the prefix of an IDR slice from bear-640x360-hevc.mp4, from
+// h265_parser_unittest.cc.
+const uint8_t kH265Sps[] = {
+    0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x3f, 0xa0, 0x05, 0x02, 0x01, 0x69, 0x65, 0x95, 0xe4, 0x93,
+    0x2b, 0xc0, 0x40, 0x40, 0x00, 0x00, 0xfa, 0x40, 0x00, 0x1d, 0x4c, 0x02};
+const uint8_t kH265Pps[] = {0x44, 0x01, 0xc1, 0x73, 0xd1, 0x89};
+const uint8_t kH265Slice[] = {
+    0x26, 0x01, 0xaf, 0x08, 0x4c, 0x2e, 0xa6, 0x56, 0xd9, 0xaf, 0x50, 0xeb,
+    0x94, 0x9a, 0xae, 0x89, 0x29, 0x0e, 0x42, 0x9f, 0xb9, 0x5e, 0x85, 0xd5};
+
+// The temporal delimiter, sequence header and the headers of the frame OBU of
+// av1-I-frame-320x240, up to its single tile.
+const uint8_t kAV1TemporalUnitHeaders[] = {
+    0x12, 0x00, 0x0a, 0x07, 0x18, 0x21, 0xe7, 0xfd, 0xfd, 0x80,
+    0x40, 0x32, 0xf0, 0x09, 0x13, 0x64, 0x0b, 0x21, 0x40, 0x81,
+    0x80, 0x1c, 0xfa, 0xf9, 0x82, 0xe8, 0xdf, 0x9f, 0x02,
+};
+const size_t kAV1TileSize = 0x4e1;
+
+// A superframe of two inter frames, from vp9_parser_unittest.cc.
+const uint8_t kVP9Superframe[] = {
+    0x85, 0x00, 0x81, 0x25, 0x86, 0x0e, 0x09, 0x07, 0x06, 0x47, 0x00, 0x00,
+    0xb4, 0x69, 0x29, 0x1f, 0x69, 0x46, 0x6d, 0xaf, 0x4c, 0x1f, 0xac, 0x8c,
+    0x40, 0x7e, 0xb9, 0x52, 0xe3, 0x6f, 0xe9, 0x82, 0x23, 0x62, 0x9a, 0x40,
+    0xda, 0x87, 0x21, 0x7f, 0x1f, 0xc8, 0xfe, 0x3f, 0xd1, 0xfc, 0x7f, 0xc1,
+    0xbb, 0x3e, 0x77, 0xa4, 0xfc, 0x94, 0xa2, 0xfa, 0xa2, 0x00, 0x7a, 0xc3,
+    0x87, 0x01, 0x02, 0x4b, 0x0a, 0x1c, 0x12, 0x0e, 0x0c, 0x75, 0x00, 0x01,
+    0xa0, 0x69, 0x23, 0x0f, 0xd2, 0xf6, 0xfb, 0xb0, 0x6b, 0xf2, 0xab, 0x57,
+    0xc3, 0x3a, 0xa5, 0x74, 0x4d, 0xb1, 0x48, 0xf4, 0x59, 0x0f, 0xf1, 0x7e,
+    0x2f, 0x89, 0xf9, 0x00, 0xab, 0x7b, 0x01, 0x11, 0xd3, 0x8a, 0xe6, 0x8f,
+    0xab, 0xeb, 0x5f, 0x57, 0xdd, 0x7f, 0x45, 0x31, 0xbb, 0x66, 0xee, 0xf5,
+    0xbc, 0x85, 0xf1, 0xd0, 0x00, 0x7b, 0x80, 0xa7, 0x96, 0xbf, 0x8c, 0x21,
+    0xc9, 0x3c, 0x00, 0x48, 0x00, 0xc9,
+};
+
+// An AudioSpecificConfig with an explicit sampling frequency, from
+// aac_audio_specific_config_unittest.cc.
+const uint8_t kAacAudioSpecificConfig[] = {0x13, 0x08, 0x56, 0xe5,
+                                           0x9d, 0x48, 0x80};
+
+// The header of a 532 byte ADTS frame, from adts_header_unittest.cc.
+const uint8_t kAdtsHeader[] = {0xff, 0xf1, 0x50, 0x80, 0x42, 0x9f, 0xfc};
+const size_t kAdtsFrameSize = 532;
+
+// Builds an Annex B byte stream of |num_nalus| H.264 non-IDR slices of
+// |nalu_size| bytes. The payload has no zero bytes, so the scanners have to
+// look at every byte as with real slice data.
+std::vector<uint8_t> CreateAnnexBStream(size_t num_nalus, size_t nalu_size) {
+  const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+  const uint8_t kNonIdrSliceHeader = 0x41;
+  std::vector<uint8_t> stream;
+  uint32_t seed = 1;
+  for (size_t i = 0; i < num_nalus; ++i) {
+    stream.insert(stream.end(), std::begin(kStartCode), std::end(kStartCode));
+    stream.push_back(kNonIdrSliceHeader);
+    for (size_t j = 1; j < nalu_size; ++j) {
+      seed = seed * 1103515245 + 12345;
+      stream.push_back(static_cast<uint8_t>((seed >> 16) % 255 + 1));
+    }
+  }
+  return stream;
+}
+
+SHAKA_BENCHMARK(BM_NaluReaderAnnexB) {
+  const size_t kNumNalus = 256;
+  const std::vector<uint8_t> stream = CreateAnnexBStream(kNumNalus, 4000);
+  state->set_bytes_per_iteration(stream.size());
+  while (state->KeepRunning()) {
+    NaluReader reader(Nalu::kH264, kIsAnnexbByteStream, stream.data(),
+                      stream.size());
+    Nalu nalu;
+    size_t num_nalus = 0;
+    while (reader.Advance(&nalu) == NaluReader::kOk)
+      ++num_nalus;
+    CHECK_EQ(kNumNalus, num_nalus);
+  }
+}
+
+SHAKA_BENCHMARK(BM_NaluReaderFindStartCode) {
+  // A single large NAL unit, i.e. the worst case for the scanner.
+  const std::vector<uint8_t> stream = CreateAnnexBStream(1, 1 << 20);
+  state->set_bytes_per_iteration(stream.size());
+  while (state->KeepRunning()) {
+    uint64_t offset = 0;
+    uint8_t start_code_size = 0;
+    // Skip the leading start code.
+    CHECK(!NaluReader::FindStartCode(stream.data() + 4, stream.size() - 4,
+                                     &offset, &start_code_size));
+    benchmark::DoNotOptimize(offset);
+  }
+}
+
+SHAKA_BENCHMARK(BM_FindStartCodePrefixManyZeros) {
+  // Zero bytes, and zero pairs in particular, are common in real slice data
+  // and defeat the shortcuts of the scanners.
+  std::vector<uint8_t> data(1 << 20, 0x80);
+  for (size_t i = 0; i + 1 < data.size(); i += 7)
+    data[i] = data[i + 1] = 0x00;
+  state->set_bytes_per_iteration(data.size());
+  while (state->KeepRunning()) {
+    CHECK_EQ(data.size(), FindStartCodePrefix(data.data(), data.size()));
+  }
+}
+
+SHAKA_BENCHMARK(BM_EscapeNalByteSequence) {
+  const std::vector<uint8_t> nalu = CreateAnnexBStream(1, 1 << 20);
+  BufferWriter writer(nalu.size() + 16);
+  state->set_bytes_per_iteration(nalu.size());
+  while (state->KeepRunning()) {
+    writer.Clear();
+    EscapeNalByteSequence(nalu.data() + 4, nalu.size() - 4, &writer);
+    benchmark::DoNotOptimize(writer.Size());
+  }
+}
+
+SHAKA_BENCHMARK(BM_H26xBitReaderReadBytes) {
+  const std::vector<uint8_t> nalu = CreateAnnexBStream(1, 1 << 16);
+  state->set_bytes_per_iteration(nalu.size());
+  while (state->KeepRunning()) {
+    H26xBitReader reader;
+    CHECK(reader.Initialize(nalu.data(), nalu.size()));
+    int value = 0;
+    int sum = 0;
+    while (reader.ReadBits(8, &value))
+      sum += value;
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+SHAKA_BENCHMARK(BM_BitReaderReadBits) {
+  // Field sizes typical of the codec headers.
+  const size_t kFieldSizes[] = {1, 2, 3, 4, 5, 8, 11, 13, 16, 24};
+  const std::vector<uint8_t> data = CreateAnnexBStream(1, 1 << 16);
+  state->set_bytes_per_iteration(data.size());
+  while (state->KeepRunning()) {
+    BitReader reader(data.data(), data.size());
+    uint32_t value = 0;
+    uint32_t sum = 0;
+    for (size_t i = 0;; i = (i + 1) % arraysize(kFieldSizes)) {
+      if (!reader.ReadBits(kFieldSizes[i], &value))
+        break;
+      sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+SHAKA_BENCHMARK(BM_BitWriterWriteBits) {
+  const size_t kNumFields = 1 << 16;
+  std::vector<uint8_t> storage;
+  storage.reserve(kNumFields);
+  state->set_bytes_per_iteration(kNumFields);
+  while (state->KeepRunning()) {
+    storage.clear();
+    BitWriter writer(&storage);
+    // 3 + 5 bits per iteration, i.e. a byte.
+    for (size_t i = 0; i < kNumFields; ++i) {
+      writer.WriteBits(i & 0x7, 3);
+      writer.WriteBits(i & 0x1f, 5);
+    }
+    writer.Flush();
+    benchmark::DoNotOptimize(storage.size());
+  }
+}
+
+SHAKA_BENCHMARK(BM_AACAudioSpecificConfigParse) {
+  const std::vector<uint8_t> data(std::begin(kAacAudioSpecificConfig),
+                                  std::end(kAacAudioSpecificConfig));
+  while (state->KeepRunning()) {
+    AACAudioSpecificConfig aac_audio_specific_config;
+    CHECK(aac_audio_specific_config.Parse(data));
+    benchmark::DoNotOptimize(aac_audio_specific_config.GetNumChannels());
+  }
+}
+
+SHAKA_BENCHMARK(BM_AdtsHeaderParse) {
+  // Parses the header and builds the AudioSpecificConfig of the frame, as for
+  // every frame of an ADTS stream in TS.
+  std::vector<uint8_t> frame(std::begin(kAdtsHeader), std::end(kAdtsHeader));
+  frame.resize(kAdtsFrameSize);
+  std::vector<uint8_t> audio_specific_config;
+  while (state->KeepRunning()) {
+    mp2t::AdtsHeader adts_header;
+    CHECK(adts_header.Parse(frame.data(), frame.size()));
+    audio_specific_config.clear();
+    adts_header.GetAudioSpecificConfig(&audio_specific_config);
+    benchmark::DoNotOptimize(audio_specific_config.size());
+  }
+}
+
+SHAKA_BENCHMARK(BM_H264ParseSliceHeader) {
+  H264Parser parser;
+  int id = 0;
+  Nalu nalu;
+  CHECK(nalu.Initialize(Nalu::kH264, kH264Sps, arraysize(kH264Sps)));
+  CHECK_EQ(H264Parser::kOk, parser.ParseSps(nalu, &id));
+  CHECK(nalu.Initialize(Nalu::kH264, kH264Pps, arraysize(kH264Pps)));
+  CHECK_EQ(H264Parser::kOk, parser.ParsePps(nalu, &id));
+  CHECK(nalu.Initialize(Nalu::kH264, kH264Slice, arraysize(kH264Slice)));
+  while (state->KeepRunning()) {
+    H264SliceHeader slice_header;
+    CHECK_EQ(H264Parser::kOk, parser.ParseSliceHeader(nalu, &slice_header));
+    benchmark::DoNotOptimize(slice_header.header_bit_size);
+  }
+}
+
+SHAKA_BENCHMARK(BM_H265ParseSliceHeader) {
+  H265Parser parser;
+  int id = 0;
+  Nalu nalu;
+  CHECK(nalu.Initialize(Nalu::kH265, kH265Sps, arraysize(kH265Sps)));
+  CHECK_EQ(H265Parser::kOk, parser.ParseSps(nalu, &id));
+  CHECK(nalu.Initialize(Nalu::kH265, kH265Pps, arraysize(kH265Pps)));
+  CHECK_EQ(H265Parser::kOk, parser.ParsePps(nalu, &id));
+  CHECK(nalu.Initialize(Nalu::kH265, kH265Slice, arraysize(kH265Slice)));
+  while (state->KeepRunning()) {
+    H265SliceHeader slice_header;
+    CHECK_EQ(H265Parser::kOk, parser.ParseSliceHeader(nalu, &slice_header));
+    benchmark::DoNotOptimize(slice_header.header_bit_size);
+  }
+}
+
+SHAKA_BENCHMARK(BM_AV1ParseKeyFrames) {
+  // Key frames with in-band sequence headers, as for the encryption of
+  // streams with a key frame in every segment.
+  std::vector<uint8_t> temporal_unit(std::begin(kAV1TemporalUnitHeaders),
+                                     std::end(kAV1TemporalUnitHeaders));
+  temporal_unit.resize(temporal_unit.size() + kAV1TileSize, 0x5a);
+  AV1Parser parser;
+  std::vector<AV1Parser::Tile> tiles;
+  state->set_bytes_per_iteration(temporal_unit.size());
+  while (state->KeepRunning()) {
+    CHECK(parser.Parse(temporal_unit.data(), temporal_unit.size(), &tiles));
+    CHECK_EQ(1u, tiles.size());
+  }
+}
+
+SHAKA_BENCHMARK(BM_VP9ParseSuperframe) {
+  VP9Parser parser;
+  std::vector<VPxFrameInfo> frames;
+  state->set_bytes_per_iteration(arraysize(kVP9Superframe));
+  while (state->KeepRunning()) {
+    CHECK(parser.Parse(kVP9Superframe, arraysize(kVP9Superframe), &frames));
+    CHECK_EQ(2u, frames.size());
+  }
+}
+
+}  // namespace
+}  // namespace media
+}  // namespace shaka
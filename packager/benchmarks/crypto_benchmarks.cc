@@ -0,0 +1,75 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <memory>
+
+#include "packager/base/logging.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/aes_pattern_cryptor.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// A typical video sample size.
+const size_t kSampleSize = 64 * 1024;
+const std::vector<uint8_t> kKey(16, 0x01);
+const std::vector<uint8_t> kIv(16, 0x02);
+
+void RunEncryptionBenchmark(AesCryptor* cryptor, benchmark::State* state) {
+  CHECK(cryptor->InitializeWithIv(kKey, kIv));
+  const std::vector<uint8_t> sample(kSampleSize, 0x5a);
+  std::vector<uint8_t> encrypted_sample(kSampleSize);
+  state->set_bytes_per_iteration(kSampleSize);
+  while (state->KeepRunning()) {
+    CHECK(cryptor->Crypt(sample.data(), sample.size(),
+                         encrypted_sample.data()));
+    cryptor->UpdateIv();
+  }
+  benchmark::DoNotOptimize(encrypted_sample.data());
+}
+
+std::unique_ptr<AesCryptor> CreatePatternCryptor(
+    uint8_t crypt_byte_block,
+    uint8_t skip_byte_block,
+    AesCryptor::ConstantIvFlag constant_iv_flag,
+    std::unique_ptr<AesCryptor> cryptor) {
+  return std::unique_ptr<AesCryptor>(new AesPatternCryptor(
+      crypt_byte_block, skip_byte_block,
+      AesPatternCryptor::kEncryptIfCryptByteBlockRemaining, constant_iv_flag,
+      std::move(cryptor)));
+}
+
+SHAKA_BENCHMARK(BM_AesCtrEncrypt) {
+  AesCtrEncryptor encryptor;
+  RunEncryptionBenchmark(&encryptor, state);
+}
+
+SHAKA_BENCHMARK(BM_AesCbcEncrypt) {
+  AesCbcEncryptor encryptor(kNoPadding);
+  RunEncryptionBenchmark(&encryptor, state);
+}
+
+// 'cens' 1:9 pattern.
+SHAKA_BENCHMARK(BM_AesPatternCtrEncrypt) {
+  std::unique_ptr<AesCryptor> encryptor = CreatePatternCryptor(
+      1, 9, AesCryptor::kDontUseConstantIv,
+      std::unique_ptr<AesCryptor>(new AesCtrEncryptor));
+  RunEncryptionBenchmark(encryptor.get(), state);
+}
+
+// 'cbcs' 1:9 pattern.
+SHAKA_BENCHMARK(BM_AesPatternCbcEncrypt) {
+  std::unique_ptr<AesCryptor> encryptor = CreatePatternCryptor(
+      1, 9, AesCryptor::kUseConstantIv,
+      std::unique_ptr<AesCryptor>(new AesCbcEncryptor(kNoPadding)));
+  RunEncryptionBenchmark(encryptor.get(), state);
+}
+
+}  // namespace
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,39 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/file/io_cache.h"
+#include "packager/media/base/closure_thread.h"
+
+namespace shaka {
+namespace {
+
+void DrainCache(IoCache* cache) {
+  std::vector<uint8_t> buffer(0x10000);
+  while (cache->Read(buffer.data(), buffer.size()) > 0) {
+  }
+}
+
+}  // namespace
+
+SHAKA_BENCHMARK(BM_IoCacheSmallWrites) {
+  // Box headers and small boxes are written a few bytes at a time.
+  const uint8_t kData[16] = {};
+  IoCache cache(1 << 20);
+  media::ClosureThread reader(
+      "IoCacheReader", base::Bind(&DrainCache, base::Unretained(&cache)));
+  reader.Start();
+  state->set_bytes_per_iteration(sizeof(kData));
+  while (state->KeepRunning())
+    cache.Write(kData, sizeof(kData));
+  cache.Close();
+  reader.Join();
+}
+
+}  // namespace shaka
@@ -0,0 +1,151 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <string>
+
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/file/file.h"
+#include "packager/hls/base/media_playlist.h"
+#include "packager/mpd/base/adaptation_set.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/mpd_builder.h"
+#include "packager/mpd/base/period.h"
+#include "packager/mpd/base/representation.h"
+#include "packager/mpd/base/xml/xml_node.h"
+
+namespace shaka {
+namespace {
+
+const uint32_t kTimeScale = 90000;
+// An hour of two second segments.
+const int kNumSegments = 1800;
+// The durations of the segments cycle through these, as with 29.97 fps
+// content, so the segments do not collapse into a single timeline entry.
+const int64_t kSegmentDurations[] = {180180, 180180, 177177};
+const uint64_t kSegmentSize = 1250000;
+
+MediaInfo GetVideoMediaInfo() {
+  MediaInfo media_info;
+  MediaInfo::VideoInfo* video_info = media_info.mutable_video_info();
+  video_info->set_codec("avc1.64001f");
+  video_info->set_time_scale(kTimeScale);
+  video_info->set_frame_duration(3003);
+  video_info->set_width(1280);
+  video_info->set_height(720);
+  video_info->set_pixel_width(1);
+  video_info->set_pixel_height(1);
+  media_info.set_reference_time_scale(kTimeScale);
+  media_info.set_container_type(MediaInfo::CONTAINER_MP4);
+  media_info.set_bandwidth(5000000);
+  media_info.set_init_segment_url("video_init.mp4");
+  media_info.set_segment_template_url("video_$Number$.m4s");
+  return media_info;
+}
+
+SHAKA_BENCHMARK(BM_MediaPlaylistWriteToFile) {
+  HlsParams hls_params;
+  hls::MediaPlaylist media_playlist(hls_params, "video.m3u8", "video",
+                                    "video_group");
+  CHECK(media_playlist.SetMediaInfo(GetVideoMediaInfo()));
+  int64_t start_time = 0;
+  for (int i = 0; i < kNumSegments; ++i) {
+    const int64_t duration =
+        kSegmentDurations[i % arraysize(kSegmentDurations)];
+    media_playlist.AddSegment(
+        "video_" + std::to_string(i + 1) + ".m4s", start_time, duration,
+        0 /* start_byte_offset */, kSegmentSize);
+    start_time += duration;
+  }
+
+  const char kPlaylistPath[] = "memory://video.m3u8";
+  while (state->KeepRunning())
+    CHECK(media_playlist.WriteToFile(kPlaylistPath));
+  int64_t playlist_size = File::GetFileSize(kPlaylistPath);
+  state->set_bytes_per_iteration(playlist_size);
+  File::Delete(kPlaylistPath);
+}
+
+// Builds the Period of the MPD of BM_MpdBuilderToString.
+base::Optional<xml::XmlNode> GetVideoPeriodXml(MpdBuilder* mpd_builder) {
+  const MediaInfo media_info = GetVideoMediaInfo();
+  const double kPeriodStartTimeSeconds = 0.0;
+  Period* period = mpd_builder->GetOrCreatePeriod(kPeriodStartTimeSeconds);
+  AdaptationSet* adaptation_set = period->GetOrCreateAdaptationSet(
+      media_info, false /* content_protection */);
+  CHECK(adaptation_set);
+  Representation* representation =
+      adaptation_set->AddRepresentation(media_info);
+  CHECK(representation);
+  int64_t start_time = 0;
+  for (int i = 0; i < kNumSegments; ++i) {
+    const int64_t duration =
+        kSegmentDurations[i % arraysize(kSegmentDurations)];
+    representation->AddNewSegment(start_time, duration, kSegmentSize);
+    start_time += duration;
+  }
+  return period->GetXml(false /* output_period_duration */);
+}
+
+SHAKA_BENCHMARK(BM_MpdBuilderToString) {
+  MpdOptions mpd_options;
+  mpd_options.dash_profile = DashProfile::kLive;
+  MpdBuilder mpd_builder(mpd_options);
+  const MediaInfo media_info = GetVideoMediaInfo();
+  const double kPeriodStartTimeSeconds = 0.0;
+  AdaptationSet* adaptation_set =
+      mpd_builder.GetOrCreatePeriod(kPeriodStartTimeSeconds)
+          ->GetOrCreateAdaptationSet(media_info,
+                                     false /* content_protection */);
+  CHECK(adaptation_set);
+  Representation* representation =
+      adaptation_set->AddRepresentation(media_info);
+  CHECK(representation);
+  int64_t start_time = 0;
+  for (int i = 0; i < kNumSegments; ++i) {
+    const int64_t duration =
+        kSegmentDurations[i % arraysize(kSegmentDurations)];
+    representation->AddNewSegment(start_time, duration, kSegmentSize);
+    start_time += duration;
+  }
+
+  std::string mpd;
+  while (state->KeepRunning())
+    CHECK(mpd_builder.ToString(&mpd));
+  state->set_bytes_per_iteration(mpd.size());
+}
+
+// BM_XmlNodeToString and BM_XmlNodeToStringWithLibxml compare the direct
+// serialization of the XML to the serialization through a libxml2 document.
+SHAKA_BENCHMARK(BM_XmlNodeToString) {
+  MpdOptions mpd_options;
+  mpd_options.dash_profile = DashProfile::kLive;
+  MpdBuilder mpd_builder(mpd_options);
+  base::Optional<xml::XmlNode> period_xml = GetVideoPeriodXml(&mpd_builder);
+  CHECK(period_xml);
+
+  std::string xml;
+  while (state->KeepRunning())
+    xml = period_xml->ToString("");
+  state->set_bytes_per_iteration(xml.size());
+}
+
+SHAKA_BENCHMARK(BM_XmlNodeToStringWithLibxml) {
+  MpdOptions mpd_options;
+  mpd_options.dash_profile = DashProfile::kLive;
+  MpdBuilder mpd_builder(mpd_options);
+  base::Optional<xml::XmlNode> period_xml = GetVideoPeriodXml(&mpd_builder);
+  CHECK(period_xml);
+
+  std::string xml;
+  while (state->KeepRunning())
+    xml = period_xml->ToStringWithLibxml("");
+  state->set_bytes_per_iteration(xml.size());
+}
+
+}  // namespace
+}  // namespace shaka
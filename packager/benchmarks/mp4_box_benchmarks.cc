@@ -0,0 +1,95 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <memory>
+
+#include "packager/base/logging.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/box_reader.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+// The number of samples in a typical few seconds fragment.
+const uint32_t kNumSamples = 120;
+
+void FillTrackFragmentRun(TrackFragmentRun* trun) {
+  trun->flags = TrackFragmentRun::kDataOffsetPresentMask |
+                TrackFragmentRun::kSampleDurationPresentMask |
+                TrackFragmentRun::kSampleSizePresentMask |
+                TrackFragmentRun::kSampleFlagsPresentMask |
+                TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
+  trun->version = 1;
+  trun->data_offset = 1234;
+  trun->sample_count = kNumSamples;
+  for (uint32_t i = 0; i < kNumSamples; ++i) {
+    trun->sample_durations.push_back(3000);
+    trun->sample_sizes.push_back(5000 + i * 17);
+    trun->sample_flags.push_back(i == 0 ? 0x02000000 : 0x01010000);
+    trun->sample_composition_time_offsets.push_back((i % 3) * 3000 - 3000);
+  }
+}
+
+void FillSampleEncryption(SampleEncryption* senc) {
+  senc->iv_size = 8;
+  senc->flags = SampleEncryption::kUseSubsampleEncryption;
+  senc->sample_encryption_entries.resize(kNumSamples);
+  for (SampleEncryptionEntry& entry : senc->sample_encryption_entries) {
+    entry.initialization_vector.assign(senc->iv_size, 0x11);
+    entry.subsamples.push_back(SubsampleEntry(20, 4000));
+    entry.subsamples.push_back(SubsampleEntry(7, 1000));
+  }
+}
+
+SHAKA_BENCHMARK(BM_Mp4TrackFragmentRunWrite) {
+  TrackFragmentRun trun;
+  FillTrackFragmentRun(&trun);
+  BufferWriter writer;
+  while (state->KeepRunning()) {
+    writer.Clear();
+    trun.Write(&writer);
+    benchmark::DoNotOptimize(writer.Buffer());
+  }
+  state->set_bytes_per_iteration(writer.Size());
+}
+
+SHAKA_BENCHMARK(BM_Mp4TrackFragmentRunParse) {
+  TrackFragmentRun trun;
+  FillTrackFragmentRun(&trun);
+  BufferWriter writer;
+  trun.Write(&writer);
+  state->set_bytes_per_iteration(writer.Size());
+  while (state->KeepRunning()) {
+    bool err = false;
+    std::unique_ptr<BoxReader> reader(
+        BoxReader::ReadBox(writer.Buffer(), writer.Size(), &err));
+    CHECK(reader);
+    TrackFragmentRun parsed_trun;
+    CHECK(parsed_trun.Parse(reader.get()));
+    benchmark::DoNotOptimize(parsed_trun.sample_count);
+  }
+}
+
+SHAKA_BENCHMARK(BM_Mp4SampleEncryptionWrite) {
+  SampleEncryption senc;
+  FillSampleEncryption(&senc);
+  BufferWriter writer;
+  while (state->KeepRunning()) {
+    writer.Clear();
+    senc.Write(&writer);
+    benchmark::DoNotOptimize(writer.Buffer());
+  }
+  state->set_bytes_per_iteration(writer.Size());
+}
+
+}  // namespace
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
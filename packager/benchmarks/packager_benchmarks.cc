@@ -0,0 +1,61 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <string>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+#include "packager/packager.h"
+
+namespace shaka {
+namespace {
+
+// A short clip, like a trailer or an ad creative, for which the fixed costs
+// of a packaging job dominate. The benchmarks run from the repository root.
+const char kTestFile[] = "packager/media/test/data/bear-640x360.mp4";
+const char kInput[] = "memory://benchmark/input.mp4";
+
+std::vector<StreamDescriptor> GetStreamDescriptors() {
+  std::vector<StreamDescriptor> stream_descriptors(2);
+  stream_descriptors[0].input = kInput;
+  stream_descriptors[0].stream_selector = "video";
+  stream_descriptors[0].output = "memory://benchmark/video.mp4";
+  stream_descriptors[1].input = kInput;
+  stream_descriptors[1].stream_selector = "audio";
+  stream_descriptors[1].output = "memory://benchmark/audio.mp4";
+  return stream_descriptors;
+}
+
+}  // namespace
+
+// Measures a whole VOD job from Initialize() to the MPD, with the input and
+// outputs in memory, i.e. the time to package a short clip.
+SHAKA_BENCHMARK(BM_PackagerShortVodJob) {
+  std::string content;
+  CHECK(File::ReadFileToString(kTestFile, &content))
+      << "The benchmarks are expected to run from the repository root.";
+  CHECK(File::WriteStringToFile(kInput, content));
+
+  PackagingParams packaging_params;
+  packaging_params.temp_dir = "memory://benchmark/";
+  packaging_params.chunking_params.segment_duration_in_seconds = 2;
+  packaging_params.mpd_params.mpd_output = "memory://benchmark/output.mpd";
+  const std::vector<StreamDescriptor> stream_descriptors =
+      GetStreamDescriptors();
+
+  state->set_bytes_per_iteration(content.size());
+  while (state->KeepRunning()) {
+    Packager packager;
+    CHECK(packager.Initialize(packaging_params, stream_descriptors).ok());
+    CHECK(packager.Run().ok());
+  }
+  MemoryFile::DeleteAll();
+}
+
+}  // namespace shaka
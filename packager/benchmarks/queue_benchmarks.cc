@@ -0,0 +1,78 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <memory>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/lock_free_queue.h"
+#include "packager/media/base/producer_consumer_queue.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kQueueSize = 64;
+
+// Pushes and pops on the same thread, which measures the cost of the queue
+// operations without any waiting.
+template <class Queue>
+void PushPop(benchmark::State* state) {
+  Queue queue(kQueueSize);
+  std::shared_ptr<int> element(new int(0));
+  std::shared_ptr<int> popped;
+  while (state->KeepRunning()) {
+    CHECK(queue.Push(element, kInfiniteTimeout).ok());
+    CHECK(queue.Pop(&popped, kInfiniteTimeout).ok());
+    benchmark::DoNotOptimize(popped);
+  }
+}
+
+template <class Queue>
+void PushUntilStopped(Queue* queue) {
+  std::shared_ptr<int> element(new int(0));
+  while (queue->Push(element, kInfiniteTimeout).ok()) {
+  }
+}
+
+// Pops the elements pushed by another thread, which measures the cost of
+// handing an element over between two pipeline stages.
+template <class Queue>
+void Handoff(benchmark::State* state) {
+  Queue queue(kQueueSize);
+  ClosureThread producer("Producer",
+                         base::Bind(&PushUntilStopped<Queue>, &queue));
+  producer.Start();
+  std::shared_ptr<int> popped;
+  while (state->KeepRunning()) {
+    CHECK(queue.Pop(&popped, kInfiniteTimeout).ok());
+    benchmark::DoNotOptimize(popped);
+  }
+  queue.Stop();
+  producer.Join();
+}
+
+SHAKA_BENCHMARK(BM_ProducerConsumerQueuePushPop) {
+  PushPop<ProducerConsumerQueue<std::shared_ptr<int>>>(state);
+}
+
+SHAKA_BENCHMARK(BM_LockFreeQueuePushPop) {
+  PushPop<LockFreeQueue<std::shared_ptr<int>>>(state);
+}
+
+SHAKA_BENCHMARK(BM_ProducerConsumerQueueHandoff) {
+  Handoff<ProducerConsumerQueue<std::shared_ptr<int>>>(state);
+}
+
+SHAKA_BENCHMARK(BM_LockFreeQueueHandoff) {
+  Handoff<LockFreeQueue<std::shared_ptr<int>>>(state);
+}
+
+}  // namespace
+}  // namespace media
+}  // namespace shaka
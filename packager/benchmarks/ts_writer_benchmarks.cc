@@ -0,0 +1,54 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <memory>
+
+#include "packager/base/logging.h"
+#include "packager/benchmarks/benchmark.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/formats/mp2t/pes_packet.h"
+#include "packager/media/formats/mp2t/program_map_table_writer.h"
+#include "packager/media/formats/mp2t/ts_writer.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+namespace {
+
+const uint8_t kVideoStreamId = 0xE0;
+
+SHAKA_BENCHMARK(BM_TsWriterPacketization) {
+  // One second of 30 fps video at about 5 Mbps.
+  const size_t kNumFrames = 30;
+  const std::vector<uint8_t> frame(20000, 0x5a);
+  const int64_t kFrameDuration = 3000;
+
+  TsWriter ts_writer(std::unique_ptr<ProgramMapTableWriter>(
+      new VideoProgramMapTableWriter(kCodecH264)));
+  BufferWriter buffer;
+  state->set_bytes_per_iteration(kNumFrames * frame.size());
+  int64_t timestamp = 0;
+  while (state->KeepRunning()) {
+    buffer.Clear();
+    CHECK(ts_writer.NewSegment(&buffer));
+    for (size_t i = 0; i < kNumFrames; ++i) {
+      std::unique_ptr<PesPacket> pes(new PesPacket);
+      pes->set_stream_id(kVideoStreamId);
+      pes->set_pts(timestamp);
+      pes->set_dts(timestamp);
+      pes->set_is_key_frame(i == 0);
+      *pes->mutable_data() = frame;
+      CHECK(ts_writer.AddPesPacket(std::move(pes), &buffer));
+      timestamp += kFrameDuration;
+    }
+    benchmark::DoNotOptimize(buffer.Buffer());
+  }
+}
+
+}  // namespace
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
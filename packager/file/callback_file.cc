@@ -16,6 +16,10 @@ CallbackFile::CallbackFile(const char* file_name, const char* mode)
 CallbackFile::~CallbackFile() {}
 
 bool CallbackFile::Close() {
+  if (callback_params_ && callback_params_->output_sink &&
+      file_mode_[0] == 'w') {
+    DeliverOutput(true);
+  }
   delete this;
   return true;
 }
@@ -29,6 +33,11 @@ int64_t CallbackFile::Read(void* buffer, uint64_t length) {
 }
 
 int64_t CallbackFile::Write(const void* buffer, uint64_t length) {
+  if (callback_params_->output_sink) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer);
+    output_buffer_->insert(output_buffer_->end(), data, data + length);
+    return length;
+  }
   if (!callback_params_->write_func) {
     LOG(ERROR) << "Write function not defined.";
     return -1;
@@ -36,13 +45,29 @@ int64_t CallbackFile::Write(const void* buffer, uint64_t length) {
   return callback_params_->write_func(name_, buffer, length);
 }
 
+int64_t CallbackFile::WriteV(const IoVec* iov, size_t iov_count) {
+  if (!callback_params_->output_sink)
+    return File::WriteV(iov, iov_count);
+  // Grow the buffer once for the whole write.
+  uint64_t length = 0;
+  for (size_t i = 0; i < iov_count; ++i)
+    length += iov[i].length;
+  output_buffer_->reserve(output_buffer_->size() + length);
+  for (size_t i = 0; i < iov_count; ++i)
+    Write(iov[i].buffer, iov[i].length);
+  return length;
+}
+
 int64_t CallbackFile::Size() {
   LOG(INFO) << "CallbackFile does not support Size().";
   return -1;
 }
 
 bool CallbackFile::Flush() {
-  // Do nothing on Flush.
+  // Deliver the data written so far, e.g. a low latency chunk, to the output
+  // sink. Do nothing on Flush otherwise.
+  if (callback_params_->output_sink && !output_buffer_->empty())
+    DeliverOutput(false);
   return true;
 }
 
@@ -62,7 +87,18 @@ bool CallbackFile::Open() {
     LOG(ERROR) << "CallbackFile does not support file mode " << file_mode_;
     return false;
   }
-  return ParseCallbackFileName(file_name(), &callback_params_, &name_);
+  if (!ParseCallbackFileName(file_name(), &callback_params_, &name_))
+    return false;
+  if (callback_params_->output_sink)
+    output_buffer_ = std::make_shared<std::vector<uint8_t>>();
+  return true;
+}
+
+void CallbackFile::DeliverOutput(bool is_complete) {
+  // The buffer is handed over to the sink as is, without another copy.
+  std::shared_ptr<const std::vector<uint8_t>> data = std::move(output_buffer_);
+  output_buffer_ = std::make_shared<std::vector<uint8_t>>();
+  callback_params_->output_sink->OnOutput(name_, std::move(data), is_complete);
 }
 
 }  // namespace shaka
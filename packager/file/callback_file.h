@@ -24,6 +24,7 @@ class CallbackFile : public File {
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
   int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t WriteV(const IoVec* iov, size_t iov_count) override;
   int64_t Size() override;
   bool Flush() override;
   bool Seek(uint64_t position) override;
@@ -39,9 +40,15 @@ class CallbackFile : public File {
   CallbackFile(const CallbackFile&) = delete;
   CallbackFile& operator=(const CallbackFile&) = delete;
 
+  // Delivers |output_buffer_| to |callback_params_->output_sink|.
+  void DeliverOutput(bool is_complete);
+
   const BufferCallbackParams* callback_params_ = nullptr;
   std::string name_;
   std::string file_mode_;
+  // The data written since the last delivery to
+  // |callback_params_->output_sink|.
+  std::shared_ptr<std::vector<uint8_t>> output_buffer_;
 };
 
 }  // namespace shaka
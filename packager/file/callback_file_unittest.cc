@@ -32,6 +32,14 @@ const size_t kSizeLargerThanBufferSize = kBufferSize + 2;
 const char kBufferLabel[] = "some name";
 const int kFileError = -10;
 
+class MockOutputSink : public OutputSink {
+ public:
+  MOCK_METHOD3(OnOutput,
+               void(const std::string& name,
+                    std::shared_ptr<const std::vector<uint8_t>> data,
+                    bool is_complete));
+};
+
 }  // namespace
 
 TEST(CallbackFileTest, ReadSatisfied) {
@@ -163,4 +171,58 @@ TEST(CallbackFileTest, WriteFunctionNotDefined) {
   ASSERT_EQ(-1, writer->Write(kBuffer, kBufferSize));
 }
 
+TEST(CallbackFileTest, WriteToOutputSink) {
+  auto output_sink = std::make_shared<MockOutputSink>();
+  BufferCallbackParams callback_params;
+  callback_params.output_sink = output_sink;
+
+  std::string file_name =
+      File::MakeCallbackFileName(callback_params, kBufferLabel);
+
+  const std::vector<uint8_t> first_chunk(kBuffer, kBuffer + kBufferSize);
+  std::vector<uint8_t> second_chunk(first_chunk);
+  second_chunk.insert(second_chunk.end(), kBuffer, kBuffer + kBufferSize);
+
+  testing::InSequence s;
+  EXPECT_CALL(*output_sink, OnOutput(StrEq(kBufferLabel),
+                                     testing::Pointee(first_chunk), false));
+  EXPECT_CALL(*output_sink, OnOutput(StrEq(kBufferLabel),
+                                     testing::Pointee(second_chunk), true));
+
+  File* writer = File::Open(file_name.c_str(), "w");
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(static_cast<int64_t>(kBufferSize),
+            writer->Write(kBuffer, kBufferSize));
+  ASSERT_TRUE(writer->Flush());
+  // Flushing without new data does not deliver anything.
+  ASSERT_TRUE(writer->Flush());
+  const IoVec iov[] = {{kBuffer, kBufferSize}, {kBuffer, kBufferSize}};
+  ASSERT_EQ(static_cast<int64_t>(2 * kBufferSize), writer->WriteV(iov, 2));
+  ASSERT_TRUE(writer->Close());
+}
+
+TEST(CallbackFileTest, OutputSinkTakesPrecedenceOverWriteFunction) {
+  MockFunction<int64_t(const std::string& name, const void* buffer,
+                       uint64_t length)>
+      mock_write_func;
+  auto output_sink = std::make_shared<MockOutputSink>();
+  BufferCallbackParams callback_params;
+  callback_params.write_func = mock_write_func.AsStdFunction();
+  callback_params.output_sink = output_sink;
+
+  std::string file_name =
+      File::MakeCallbackFileName(callback_params, kBufferLabel);
+
+  EXPECT_CALL(mock_write_func, Call(_, _, _)).Times(0);
+  EXPECT_CALL(*output_sink,
+              OnOutput(StrEq(kBufferLabel),
+                       testing::Pointee(testing::SizeIs(kBufferSize)), true));
+
+  File* writer = File::Open(file_name.c_str(), "w");
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(static_cast<int64_t>(kBufferSize),
+            writer->Write(kBuffer, kBufferSize));
+  ASSERT_TRUE(writer->Close());
+}
+
 }  // namespace shaka
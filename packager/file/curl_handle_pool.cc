@@ -0,0 +1,109 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/curl_handle_pool.h"
+
+#include <gflags/gflags.h>
+
+#include "packager/base/logging.h"
+
+DEFINE_int32(http_max_idle_connections_per_host, 4,
+             "Maximum number of idle HTTP connections kept open per host, to "
+             "be reused by successive uploads to the same host.");
+
+namespace shaka {
+
+std::string GetConnectionKey(const std::string& url) {
+  const size_t kSchemeSeparatorSize = 3;
+  size_t host_start = url.find("://");
+  host_start = host_start == std::string::npos
+                   ? 0
+                   : host_start + kSchemeSeparatorSize;
+  return url.substr(0, url.find('/', host_start));
+}
+
+CurlHandlePool::~CurlHandlePool() {
+  for (auto& entry : idle_handles_) {
+    for (CURL* curl : entry.second)
+      curl_easy_cleanup(curl);
+  }
+  curl_share_cleanup(share_);
+}
+
+CurlHandlePool* CurlHandlePool::Instance() {
+  static CurlHandlePool instance;
+  return &instance;
+}
+
+ScopedCurl CurlHandlePool::Acquire(const std::string& connection_key) {
+  {
+    base::AutoLock auto_lock(lock_);
+    auto iter = idle_handles_.find(connection_key);
+    if (iter != idle_handles_.end() && !iter->second.empty()) {
+      CURL* curl = iter->second.back();
+      iter->second.pop_back();
+      VLOG(2) << "Reusing connection to " << connection_key;
+      return ScopedCurl(curl, &curl_easy_cleanup);
+    }
+  }
+  ScopedCurl curl(curl_easy_init(), &curl_easy_cleanup);
+  if (curl)
+    curl_easy_setopt(curl.get(), CURLOPT_SHARE, share_);
+  return curl;
+}
+
+void CurlHandlePool::Release(const std::string& connection_key,
+                             ScopedCurl curl) {
+  DCHECK(curl);
+  // Reset the options of the previous request. The open connections and
+  // the caches are kept.
+  curl_easy_reset(curl.get());
+  curl_easy_setopt(curl.get(), CURLOPT_SHARE, share_);
+
+  base::AutoLock auto_lock(lock_);
+  warming_up_.erase(connection_key);
+  std::vector<CURL*>& handles = idle_handles_[connection_key];
+  if (handles.size() <
+      static_cast<size_t>(FLAGS_http_max_idle_connections_per_host)) {
+    handles.push_back(curl.release());
+  }
+}
+
+bool CurlHandlePool::StartWarmUp(const std::string& connection_key) {
+  base::AutoLock auto_lock(lock_);
+  auto iter = idle_handles_.find(connection_key);
+  if (iter != idle_handles_.end() && !iter->second.empty())
+    return false;
+  return warming_up_.insert(connection_key).second;
+}
+
+CurlHandlePool::CurlHandlePool() : share_(curl_share_init()) {
+  CHECK(share_) << "curl_share_init() failed.";
+  curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, LockShare);
+  curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, UnlockShare);
+  curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+  // Sharing the connection cache is supported since libcurl 7.57.0.
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+}
+
+void CurlHandlePool::LockShare(CURL* curl,
+                               curl_lock_data data,
+                               curl_lock_access access,
+                               void* user_data) {
+  static_cast<CurlHandlePool*>(user_data)->share_locks_[data].Acquire();
+}
+
+void CurlHandlePool::UnlockShare(CURL* curl,
+                                 curl_lock_data data,
+                                 void* user_data) {
+  static_cast<CurlHandlePool*>(user_data)->share_locks_[data].Release();
+}
+
+}  // namespace shaka
@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_CURL_HANDLE_POOL_H_
+#define PACKAGER_FILE_CURL_HANDLE_POOL_H_
+
+#include <curl/curl.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+using ScopedCurl = std::unique_ptr<CURL, decltype(&curl_easy_cleanup)>;
+
+/// @return "scheme://host[:port]" of @a url, which identifies the connections
+///         that can be used for @a url.
+std::string GetConnectionKey(const std::string& url);
+
+/// A process-wide pool of curl easy handles. The DNS cache, the TLS sessions
+/// and, if supported by libcurl, the connection cache are shared by all the
+/// handles. Idle handles are kept per host with their open connections, so
+/// successive requests to the same host reuse them instead of doing new TCP
+/// and TLS handshakes.
+class CurlHandlePool {
+ public:
+  ~CurlHandlePool();
+
+  static CurlHandlePool* Instance();
+
+  /// @return a handle for requests to @a connection_key, which is an idle
+  ///         handle with an open connection to the host if there is one.
+  ScopedCurl Acquire(const std::string& connection_key);
+
+  /// Return @a curl to the pool after a request to @a connection_key.
+  void Release(const std::string& connection_key, ScopedCurl curl);
+
+  /// Start warming up a connection to @a connection_key, unless there is an
+  /// idle handle for it already, or a warm-up in progress. The caller then
+  /// opens a connection with a handle from Acquire() and releases it.
+  /// @return true if the caller should warm up the connection.
+  bool StartWarmUp(const std::string& connection_key);
+
+ private:
+  class LibCurlInitializer {
+   public:
+    LibCurlInitializer() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+    ~LibCurlInitializer() { curl_global_cleanup(); }
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(LibCurlInitializer);
+  };
+
+  CurlHandlePool();
+
+  static void LockShare(CURL* curl,
+                        curl_lock_data data,
+                        curl_lock_access access,
+                        void* user_data);
+  static void UnlockShare(CURL* curl, curl_lock_data data, void* user_data);
+
+  // Declared first so that libcurl is initialized before, and cleaned up
+  // after, the handles.
+  LibCurlInitializer lib_curl_initializer_;
+  CURLSH* share_;
+  base::Lock share_locks_[CURL_LOCK_DATA_LAST];
+
+  base::Lock lock_;
+  // Connection key -> idle handles.
+  std::map<std::string, std::vector<CURL*>> idle_handles_;
+  // The connection keys with a warm-up in progress.
+  std::set<std::string> warming_up_;
+
+  DISALLOW_COPY_AND_ASSIGN(CurlHandlePool);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_CURL_HANDLE_POOL_H_
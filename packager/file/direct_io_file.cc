@@ -0,0 +1,154 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/direct_io_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace {
+
+// O_DIRECT requires the file offset, the size and the address of the buffer
+// to be aligned to the logical block size of the device, which is at most the
+// page size on the common file systems.
+const uint64_t kAlignment = 4096;
+
+uint64_t AlignUp(uint64_t value) {
+  return (value + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+}  // namespace
+
+void DirectIoFile::AlignedFree::operator()(uint8_t* buffer) const {
+  free(buffer);
+}
+
+DirectIoFile::DirectIoFile(const char* file_name, uint64_t block_size)
+    : File(file_name),
+      block_size_(AlignUp(std::max<uint64_t>(block_size, kAlignment))) {}
+
+bool DirectIoFile::Close() {
+  bool result = true;
+  if (fd_ >= 0) {
+    result = close(fd_) == 0;
+    fd_ = -1;
+  }
+  delete this;
+  return result;
+}
+
+int64_t DirectIoFile::Read(void* buffer, uint64_t length) {
+  DCHECK(buffer != NULL);
+  DCHECK_GE(fd_, 0);
+  uint8_t* data = static_cast<uint8_t*>(buffer);
+  uint64_t bytes_read = 0;
+  while (bytes_read < length) {
+    if (position_ < buffer_offset_ ||
+        position_ >= buffer_offset_ + buffer_size_) {
+      if (!FillBuffer())
+        return bytes_read > 0 ? static_cast<int64_t>(bytes_read) : -1;
+      // End of file.
+      if (position_ >= buffer_offset_ + buffer_size_)
+        break;
+    }
+    const uint64_t offset_in_buffer = position_ - buffer_offset_;
+    const uint64_t size =
+        std::min(length - bytes_read, buffer_size_ - offset_in_buffer);
+    memcpy(data + bytes_read, buffer_.get() + offset_in_buffer, size);
+    bytes_read += size;
+    position_ += size;
+  }
+  return bytes_read;
+}
+
+int64_t DirectIoFile::Write(const void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "DirectIoFile does not support writing.";
+  return -1;
+}
+
+int64_t DirectIoFile::Size() {
+  DCHECK_GE(fd_, 0);
+  struct stat info;
+  if (fstat(fd_, &info) != 0) {
+    PLOG(ERROR) << "Cannot get file size of " << file_name();
+    return -1;
+  }
+  return info.st_size;
+}
+
+bool DirectIoFile::Flush() {
+  return true;
+}
+
+bool DirectIoFile::Seek(uint64_t position) {
+  position_ = position;
+  return true;
+}
+
+bool DirectIoFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+DirectIoFile::~DirectIoFile() {
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+bool DirectIoFile::Open() {
+  fd_ = open(file_name().c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+  if (fd_ < 0 && errno == EINVAL) {
+    LOG(WARNING) << "O_DIRECT is not supported for " << file_name()
+                 << ". Reading through the page cache.";
+    fd_ = open(file_name().c_str(), O_RDONLY | O_CLOEXEC);
+  }
+  if (fd_ < 0) {
+    VLOG(1) << "Failed to open " << file_name() << ", errno " << errno;
+    return false;
+  }
+
+  void* buffer = nullptr;
+  if (posix_memalign(&buffer, kAlignment, block_size_) != 0) {
+    LOG(ERROR) << "Failed to allocate " << block_size_ << " bytes.";
+    return false;
+  }
+  buffer_.reset(static_cast<uint8_t*>(buffer));
+  return true;
+}
+
+bool DirectIoFile::FillBuffer() {
+  buffer_offset_ = position_ / kAlignment * kAlignment;
+  buffer_size_ = 0;
+  while (buffer_size_ < block_size_) {
+    // Only the last read at the end of the file may be short, so the offset
+    // stays aligned.
+    const ssize_t result =
+        pread(fd_, buffer_.get() + buffer_size_, block_size_ - buffer_size_,
+              buffer_offset_ + buffer_size_);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      PLOG(ERROR) << "Failed to read from " << file_name();
+      return false;
+    }
+    if (result == 0)
+      break;
+    buffer_size_ += result;
+    if (buffer_size_ % kAlignment != 0)
+      break;
+  }
+  return true;
+}
+
+}  // namespace shaka
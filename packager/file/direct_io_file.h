@@ -0,0 +1,68 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_DIRECT_IO_FILE_H_
+#define PACKAGER_FILE_DIRECT_IO_FILE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/base/compiler_specific.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Implement DirectIoFile which reads local files with O_DIRECT, bypassing
+/// the page cache. The file is read in aligned blocks into an aligned buffer.
+/// Only read ("r") mode is supported. If the file system does not support
+/// O_DIRECT, the file is read through the page cache in the same way.
+class DirectIoFile : public File {
+ public:
+  /// @param file_name C string containing the name of the file to be accessed.
+  /// @param block_size is the size of the blocks read from the file. It is
+  ///        rounded up to a multiple of the alignment required by O_DIRECT.
+  DirectIoFile(const char* file_name, uint64_t block_size);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~DirectIoFile() override;
+
+  bool Open() override;
+
+ private:
+  struct AlignedFree {
+    void operator()(uint8_t* buffer) const;
+  };
+
+  // Fill the buffer with the block containing |position_|.
+  bool FillBuffer();
+
+  const uint64_t block_size_;
+  int fd_ = -1;
+  std::unique_ptr<uint8_t, AlignedFree> buffer_;
+  // File offset and size of the data in |buffer_|.
+  uint64_t buffer_offset_ = 0;
+  uint64_t buffer_size_ = 0;
+  uint64_t position_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(DirectIoFile);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_DIRECT_IO_FILE_H_
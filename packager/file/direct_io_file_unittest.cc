@@ -0,0 +1,82 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/direct_io_file.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_util.h"
+#include "packager/file/file.h"
+
+DECLARE_bool(input_direct_io);
+DECLARE_uint64(input_readahead_size);
+
+namespace shaka {
+namespace {
+// Not a multiple of the block size or of the alignment.
+const int kDataSize = 3 * 8192 + 123;
+const uint64_t kBlockSize = 8192;
+}  // namespace
+
+class DirectIoFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    data_.resize(kDataSize);
+    for (int i = 0; i < kDataSize; ++i)
+      data_[i] = static_cast<char>(i % 251);
+
+    ASSERT_TRUE(base::CreateTemporaryFile(&test_file_path_));
+    ASSERT_EQ(kDataSize,
+              base::WriteFile(test_file_path_, data_.data(), kDataSize));
+    file_name_ = test_file_path_.AsUTF8Unsafe();
+  }
+
+  void TearDown() override { base::DeleteFile(test_file_path_, false); }
+
+  std::string data_;
+  base::FilePath test_file_path_;
+  std::string file_name_;
+};
+
+TEST_F(DirectIoFileTest, ReadWholeFile) {
+  google::FlagSaver flag_saver;
+  FLAGS_input_direct_io = true;
+  FLAGS_input_readahead_size = kBlockSize;
+
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(file_name_.c_str(), &contents));
+  EXPECT_TRUE(data_ == contents);
+}
+
+TEST_F(DirectIoFileTest, SeekAndRead) {
+  google::FlagSaver flag_saver;
+  FLAGS_input_direct_io = true;
+  FLAGS_input_readahead_size = kBlockSize;
+
+  File* file = File::OpenWithNoBuffering(file_name_.c_str(), "r");
+  ASSERT_TRUE(file != nullptr);
+  EXPECT_EQ(kDataSize, file->Size());
+
+  // Unaligned read across a block boundary.
+  const uint64_t kOffset = kBlockSize - 10;
+  std::string buffer(100, 0);
+  ASSERT_TRUE(file->Seek(kOffset));
+  ASSERT_EQ(100, file->Read(&buffer[0], buffer.size()));
+  EXPECT_EQ(data_.substr(kOffset, 100), buffer);
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(kOffset + 100, position);
+
+  // Backward seek, then read past the end of the file.
+  ASSERT_TRUE(file->Seek(kDataSize - 5));
+  ASSERT_EQ(5, file->Read(&buffer[0], buffer.size()));
+  EXPECT_EQ(data_.substr(kDataSize - 5), buffer.substr(0, 5));
+  EXPECT_EQ(0, file->Read(&buffer[0], buffer.size()));
+  EXPECT_TRUE(file->Close());
+}
+
+}  // namespace shaka
@@ -8,6 +8,15 @@
 
 #include <gflags/gflags.h>
 #include <inttypes.h>
+#if !defined(OS_WIN)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // !defined(OS_WIN)
+#if defined(OS_LINUX)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif  // defined(OS_LINUX)
 #include <algorithm>
 #include <memory>
 #include "packager/base/files/file_util.h"
@@ -15,21 +24,90 @@
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_piece.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
 #include "packager/file/callback_file.h"
 #include "packager/file/file_util.h"
+#include "packager/file/hls_pull_file.h"
+#include "packager/file/io_reactor.h"
 #include "packager/file/local_file.h"
 #include "packager/file/memory_file.h"
+#include "packager/file/multipart_upload_file.h"
+#include "packager/file/null_file.h"
+#include "packager/file/tee_file.h"
 #include "packager/file/threaded_io_file.h"
 #include "packager/file/udp_file.h"
+#if defined(ENABLE_SRT)
+#include "packager/file/srt_file.h"
+#endif  // defined(ENABLE_SRT)
 #include "packager/file/http_file.h"
+#if defined(OS_LINUX)
+#include "packager/file/direct_io_file.h"
+#include "packager/file/uring_file.h"
+#endif  // defined(OS_LINUX)
+#include "packager/metrics/metrics.h"
 
 DEFINE_uint64(io_cache_size,
               32ULL << 20,
               "Size of the threaded I/O cache, in bytes. Specify 0 to disable "
               "threaded I/O.");
+DEFINE_uint64(io_cache_max_size,
+              0,
+              "If larger than --io_cache_size, the I/O cache of each file "
+              "starts at --io_cache_size bytes and grows up to this size, in "
+              "bytes, when the file is written in bursts faster than it is "
+              "read or written, e.g. video segments uploaded over a slow "
+              "connection, and shrinks back when it stays mostly empty. This "
+              "allows a small --io_cache_size for audio and text outputs. The "
+              "time spent waiting for the caches is reported per file by the "
+              "shaka_io_cache_stall_seconds metric.");
 DEFINE_uint64(io_block_size,
               1ULL << 16,
               "Size of the block size used for threaded I/O, in bytes.");
+DEFINE_int32(io_threads,
+             0,
+             "If positive, the threaded I/O of all the output files is done "
+             "by this many shared threads, which write the data of a file "
+             "when there is some, instead of by one thread per open file. "
+             "The HTTP uploads are then all driven by the shared upload event "
+             "loop, except the retried or hedged ones. The input files keep "
+             "one thread each.");
+DEFINE_bool(io_uring,
+            false,
+            "Write local files with io_uring if it is supported by the "
+            "kernel, instead of blocking writes. Threaded I/O is not used for "
+            "these files. Falls back to regular local files otherwise. Linux "
+            "only.");
+DEFINE_bool(io_uring_sync,
+            false,
+            "Sync the data of the local files written with io_uring to "
+            "storage when they are closed. Only used with --io_uring.");
+DEFINE_bool(input_fadvise,
+            false,
+            "Advise the kernel that local input files are read sequentially "
+            "and only once, and drop the data already read from the page "
+            "cache, so large inputs do not evict the page cache of other "
+            "processes. Linux only.");
+DEFINE_uint64(input_readahead_size,
+              0,
+              "If non-zero, ask the kernel to read this many bytes of local "
+              "input files ahead of the current position. With "
+              "--input_direct_io, this is the size of the blocks read from "
+              "the file. Linux only.");
+DEFINE_bool(input_direct_io,
+            false,
+            "Read local input files with O_DIRECT, bypassing the page cache. "
+            "Linux only.");
+DEFINE_string(atomic_write_policy,
+              "rename",
+              "How local files, e.g. the live manifests, are replaced "
+              "atomically: 'rename' writes a temporary file and renames it, "
+              "'rename_fsync' also syncs the temporary file and the directory "
+              "to storage, so the file survives an OS crash, and 'overwrite' "
+              "truncates and writes the file in place, which is faster but "
+              "not atomic, e.g. for manifests served from a RAM disk that no "
+              "reader can see half written. The write durations are exported "
+              "as the shaka_atomic_write_seconds metric.");
+DECLARE_bool(http2_multiplexed_upload);
 
 // Needed for Windows weirdness which somewhere defines CopyFile as CopyFileW.
 #ifdef CopyFile
@@ -42,14 +120,22 @@ const char* kCallbackFilePrefix = "callback://";
 const char* kLocalFilePrefix = "file://";
 const char* kMemoryFilePrefix = "memory://";
 const char* kUdpFilePrefix = "udp://";
+const char* kSrtFilePrefix = "srt://";
 const char* kHttpFilePrefix = "http://";
 const char* kHttpsFilePrefix = "https://";
+const char* kMultipartHttpFilePrefix = "multipart+http://";
+const char* kMultipartHttpsFilePrefix = "multipart+https://";
+const char* kHlsHttpFilePrefix = "hls+http://";
+const char* kHlsHttpsFilePrefix = "hls+https://";
+const char* kTeeFilePrefix = "tee://";
+const char* kNullFilePrefix = "null://";
 
 
 namespace {
 
 typedef File* (*FileFactoryFunction)(const char* file_name, const char* mode);
 typedef bool (*FileDeleteFunction)(const char* file_name);
+typedef void (*FilePrepareWriteFunction)(const char* file_name);
 typedef bool (*FileAtomicWriteFunction)(const char* file_name,
                                         const std::string& contents);
 
@@ -58,13 +144,105 @@ struct FileTypeInfo {
   const FileFactoryFunction factory_function;
   const FileDeleteFunction delete_function;
   const FileAtomicWriteFunction atomic_write_function;
+  const FilePrepareWriteFunction prepare_write_function;
 };
 
+#if defined(OS_LINUX)
+// Copy up to |max_copy| bytes from |source_fd| at |source_position| to
+// |destination_fd| at |destination_position| in the kernel. copy_file_range()
+// shares the extents on the file systems which support reflinks, e.g. XFS and
+// Btrfs, and copies on the server on NFS; sendfile() is used if it is not
+// supported, e.g. across file systems on older kernels. |complete| is set if
+// the copy reached |max_copy| bytes or the end of the source; otherwise the
+// caller copies the rest through a buffer.
+// Returns the number of bytes copied.
+int64_t KernelCopy(int source_fd,
+                   uint64_t source_position,
+                   int destination_fd,
+                   uint64_t destination_position,
+                   int64_t max_copy,
+                   bool* complete) {
+  // Linux copies at most about 2GB per call.
+  const int64_t kMaxChunkSize = 1 << 30;
+  *complete = false;
+  // sendfile() writes at the file position of |destination_fd|.
+  if (lseek(destination_fd, destination_position, SEEK_SET) < 0)
+    return 0;
+
+#if defined(__NR_copy_file_range)
+  bool use_copy_file_range = true;
+#else
+  bool use_copy_file_range = false;
+#endif  // defined(__NR_copy_file_range)
+  int64_t bytes_copied = 0;
+  while (bytes_copied < max_copy) {
+    const size_t size =
+        static_cast<size_t>(std::min(kMaxChunkSize, max_copy - bytes_copied));
+    off_t source_offset = source_position + bytes_copied;
+    ssize_t result = -1;
+#if defined(__NR_copy_file_range)
+    if (use_copy_file_range) {
+      off_t destination_offset = destination_position + bytes_copied;
+      result = syscall(__NR_copy_file_range, source_fd, &source_offset,
+                       destination_fd, &destination_offset, size, 0);
+      if (result < 0 && errno != EINTR && bytes_copied == 0) {
+        VLOG(1) << "copy_file_range failed with errno " << errno
+                << ", using sendfile.";
+        use_copy_file_range = false;
+        continue;
+      }
+    }
+#endif  // defined(__NR_copy_file_range)
+    if (!use_copy_file_range)
+      result = sendfile(destination_fd, source_fd, &source_offset, size);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      VLOG(1) << "Kernel copy stopped after " << bytes_copied
+              << " bytes with errno " << errno << ".";
+      return bytes_copied;
+    }
+    if (result == 0)
+      break;
+    bytes_copied += result;
+  }
+  *complete = true;
+  return bytes_copied;
+}
+#endif  // defined(OS_LINUX)
+
 File* CreateCallbackFile(const char* file_name, const char* mode) {
   return new CallbackFile(file_name, mode);
 }
 
+// Returns true if local files opened in |mode| are written with io_uring.
+bool UseUringFile(const char* mode) {
+#if defined(OS_LINUX)
+  return FLAGS_io_uring && (!strcmp(mode, "w") || !strcmp(mode, "a")) &&
+         UringFile::IsSupported();
+#else
+  return false;
+#endif  // defined(OS_LINUX)
+}
+
 File* CreateLocalFile(const char* file_name, const char* mode) {
+#if defined(OS_LINUX)
+  if (UseUringFile(mode)) {
+    std::unique_ptr<UringFile, FileCloser> file(
+        new UringFile(file_name, mode, FLAGS_io_uring_sync));
+    if (file->InitializeRing())
+      return file.release();
+    // Written synchronously, without the I/O thread of the other local files.
+    LOG(WARNING) << "Failed to set up io_uring for " << file_name
+                 << ", writing it with LocalFile instead.";
+  }
+  if (FLAGS_input_direct_io && !strcmp(mode, "r")) {
+    const uint64_t kDefaultBlockSize = 2 << 20;
+    return new DirectIoFile(file_name, FLAGS_input_readahead_size > 0
+                                           ? FLAGS_input_readahead_size
+                                           : kDefaultBlockSize);
+  }
+#endif  // defined(OS_LINUX)
   return new LocalFile(file_name, mode);
 }
 
@@ -72,32 +250,147 @@ bool DeleteLocalFile(const char* file_name) {
   return LocalFile::Delete(file_name);
 }
 
+enum class AtomicWritePolicy {
+  kRename,
+  kRenameFsync,
+  kOverwrite,
+};
+
+bool ParseAtomicWritePolicy(const std::string& name,
+                            AtomicWritePolicy* policy) {
+  if (name == "rename")
+    *policy = AtomicWritePolicy::kRename;
+  else if (name == "rename_fsync")
+    *policy = AtomicWritePolicy::kRenameFsync;
+  else if (name == "overwrite")
+    *policy = AtomicWritePolicy::kOverwrite;
+  else
+    return false;
+  return true;
+}
+
+// Write |contents| to the local file |file_name|, truncating it first, and
+// sync it to storage if |sync| is set. Sync is not supported on Windows.
+bool WriteLocalFileDirectly(const char* file_name,
+                            const std::string& contents,
+                            bool sync) {
+#if defined(OS_WIN)
+  LOG_IF(WARNING, sync) << "Syncing " << file_name
+                        << " is not supported on Windows.";
+  return File::WriteStringToFile(file_name, contents);
+#else
+  const int fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                      0666);
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to open " << file_name;
+    return false;
+  }
+  const char* data = contents.data();
+  size_t bytes_left = contents.size();
+  bool result = true;
+  while (bytes_left > 0) {
+    const ssize_t bytes_written = write(fd, data, bytes_left);
+    if (bytes_written < 0) {
+      if (errno == EINTR)
+        continue;
+      PLOG(ERROR) << "Failed to write to " << file_name;
+      result = false;
+      break;
+    }
+    data += bytes_written;
+    bytes_left -= bytes_written;
+  }
+  if (result && sync && fsync(fd) != 0) {
+    PLOG(ERROR) << "Failed to sync " << file_name;
+    result = false;
+  }
+  if (close(fd) != 0) {
+    PLOG(ERROR) << "Failed to close " << file_name;
+    result = false;
+  }
+  return result;
+#endif  // defined(OS_WIN)
+}
+
+// Sync the directory |dir_name|, so the files renamed in it survive an OS
+// crash.
+bool SyncLocalDirectory(const std::string& dir_name) {
+#if defined(OS_WIN)
+  return true;
+#else
+  const int fd = open(dir_name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to open directory " << dir_name;
+    return false;
+  }
+  const bool result = fsync(fd) == 0;
+  if (!result)
+    PLOG(ERROR) << "Failed to sync directory " << dir_name;
+  close(fd);
+  return result;
+#endif  // defined(OS_WIN)
+}
+
 bool WriteLocalFileAtomically(const char* file_name,
                               const std::string& contents) {
-  const base::FilePath file_path = base::FilePath::FromUTF8Unsafe(file_name);
-  const std::string dir_name = file_path.DirName().AsUTF8Unsafe();
-  std::string temp_file_name;
-  if (!TempFilePath(dir_name, &temp_file_name))
+  AtomicWritePolicy policy = AtomicWritePolicy::kRename;
+  if (!ParseAtomicWritePolicy(FLAGS_atomic_write_policy, &policy)) {
+    LOG(ERROR) << "Unsupported --atomic_write_policy "
+               << FLAGS_atomic_write_policy << ".";
     return false;
-  if (!File::WriteStringToFile(temp_file_name.c_str(), contents))
-    return false;
-  base::File::Error replace_file_error = base::File::FILE_OK;
-  if (!base::ReplaceFile(base::FilePath::FromUTF8Unsafe(temp_file_name),
-                         file_path, &replace_file_error)) {
-    LOG(ERROR) << "Failed to replace file '" << file_name << "' with '"
-               << temp_file_name << "', error: " << replace_file_error;
+  }
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  const base::FilePath file_path = base::FilePath::FromUTF8Unsafe(file_name);
+  if (!LocalFile::CreateParentDirectories(file_name))
     return false;
+  if (policy == AtomicWritePolicy::kOverwrite) {
+    if (!WriteLocalFileDirectly(file_name, contents, false))
+      return false;
+  } else {
+    const bool sync = policy == AtomicWritePolicy::kRenameFsync;
+    const std::string dir_name = file_path.DirName().AsUTF8Unsafe();
+    std::string temp_file_name;
+    if (!TempFilePath(dir_name, &temp_file_name))
+      return false;
+    if (!WriteLocalFileDirectly(temp_file_name.c_str(), contents, sync))
+      return false;
+    base::File::Error replace_file_error = base::File::FILE_OK;
+    if (!base::ReplaceFile(base::FilePath::FromUTF8Unsafe(temp_file_name),
+                           file_path, &replace_file_error)) {
+      LOG(ERROR) << "Failed to replace file '" << file_name << "' with '"
+                 << temp_file_name << "', error: " << replace_file_error;
+      return false;
+    }
+    if (sync && !SyncLocalDirectory(dir_name))
+      return false;
   }
+  Metrics::GetInstance()->ObserveDuration(
+      "shaka_atomic_write_seconds",
+      "Time to replace local files atomically, e.g. the live manifests, per "
+      "--atomic_write_policy.",
+      {{"policy", FLAGS_atomic_write_policy}},
+      base::TimeTicks::Now() - start_time);
   return true;
 }
 
 File* CreateUdpFile(const char* file_name, const char* mode) {
+  if (strcmp(mode, "r") && strcmp(mode, "w")) {
+    NOTIMPLEMENTED() << "UdpFile only supports read (receive) and write "
+                        "(send) modes.";
+    return NULL;
+  }
+  return new UdpFile(file_name, mode);
+}
+
+#if defined(ENABLE_SRT)
+File* CreateSrtFile(const char* file_name, const char* mode) {
   if (strcmp(mode, "r")) {
-    NOTIMPLEMENTED() << "UdpFile only supports read (receive) mode.";
+    NOTIMPLEMENTED() << "SrtFile only supports read (receive) mode.";
     return NULL;
   }
-  return new UdpFile(file_name);
+  return new SrtFile(file_name);
 }
+#endif  // defined(ENABLE_SRT)
 
 File* CreateHttpsFile(const char* file_name, const char* mode) {
   return new HttpFile(file_name, mode, true);
@@ -107,10 +400,74 @@ File* CreateHttpFile(const char* file_name, const char* mode) {
   return new HttpFile(file_name, mode, false);
 }
 
+void PrepareHttpsWrite(const char* file_name) {
+  HttpFile::WarmUpConnection(file_name, true);
+}
+
+void PrepareHttpWrite(const char* file_name) {
+  HttpFile::WarmUpConnection(file_name, false);
+}
+
+File* CreateHlsPullFile(const char* file_name,
+                        const char* mode,
+                        const char* scheme) {
+  if (strcmp(mode, "r")) {
+    NOTIMPLEMENTED() << "HlsPullFile only supports read mode.";
+    return NULL;
+  }
+  return new HlsPullFile((std::string(scheme) + file_name).c_str());
+}
+
+File* CreateHlsHttpsFile(const char* file_name, const char* mode) {
+  return CreateHlsPullFile(file_name, mode, kHttpsFilePrefix);
+}
+
+File* CreateHlsHttpFile(const char* file_name, const char* mode) {
+  return CreateHlsPullFile(file_name, mode, kHttpFilePrefix);
+}
+
+File* CreateMultipartHttpsFile(const char* file_name, const char* mode) {
+  return new MultipartUploadFile(file_name, mode, true);
+}
+
+File* CreateMultipartHttpFile(const char* file_name, const char* mode) {
+  return new MultipartUploadFile(file_name, mode, false);
+}
+
 File* CreateMemoryFile(const char* file_name, const char* mode) {
   return new MemoryFile(file_name, mode);
 }
 
+File* CreateTeeFile(const char* file_name, const char* mode) {
+  if (strcmp(mode, "w") && strcmp(mode, "a")) {
+    NOTIMPLEMENTED() << "TeeFile only supports write mode.";
+    return NULL;
+  }
+  return new TeeFile(file_name, mode);
+}
+
+bool DeleteTeeFile(const char* file_name) {
+  return TeeFile::Delete(file_name);
+}
+
+bool WriteTeeFileAtomically(const char* file_name,
+                            const std::string& contents) {
+  return TeeFile::WriteFileAtomically(file_name, contents);
+}
+
+File* CreateNullFile(const char* file_name, const char* mode) {
+  return new NullFile(file_name, mode);
+}
+
+bool DeleteNullFile(const char* file_name) {
+  return NullFile::Delete(file_name);
+}
+
+bool WriteNullFileAtomically(const char* file_name,
+                             const std::string& contents) {
+  return NullFile::WriteFileAtomically(file_name, contents);
+}
+
 bool DeleteMemoryFile(const char* file_name) {
   MemoryFile::Delete(file_name);
   return true;
@@ -124,10 +481,22 @@ static const FileTypeInfo kFileTypeInfo[] = {
         &WriteLocalFileAtomically,
     },
     {kUdpFilePrefix, &CreateUdpFile, nullptr, nullptr},
+#if defined(ENABLE_SRT)
+    {kSrtFilePrefix, &CreateSrtFile, nullptr, nullptr},
+#endif  // defined(ENABLE_SRT)
     {kMemoryFilePrefix, &CreateMemoryFile, &DeleteMemoryFile, nullptr},
     {kCallbackFilePrefix, &CreateCallbackFile, nullptr, nullptr},
-    {kHttpFilePrefix, &CreateHttpFile, nullptr, nullptr},
-    {kHttpsFilePrefix, &CreateHttpsFile, nullptr, nullptr},
+    {kHttpFilePrefix, &CreateHttpFile, nullptr, nullptr, &PrepareHttpWrite},
+    {kHttpsFilePrefix, &CreateHttpsFile, nullptr, nullptr, &PrepareHttpsWrite},
+    {kMultipartHttpFilePrefix, &CreateMultipartHttpFile, nullptr, nullptr,
+     &PrepareHttpWrite},
+    {kMultipartHttpsFilePrefix, &CreateMultipartHttpsFile, nullptr, nullptr,
+     &PrepareHttpsWrite},
+    {kHlsHttpFilePrefix, &CreateHlsHttpFile, nullptr, nullptr},
+    {kHlsHttpsFilePrefix, &CreateHlsHttpsFile, nullptr, nullptr},
+    {kTeeFilePrefix, &CreateTeeFile, &DeleteTeeFile, &WriteTeeFileAtomically},
+    {kNullFilePrefix, &CreateNullFile, &DeleteNullFile,
+     &WriteNullFileAtomically},
 };
 
 base::StringPiece GetFileTypePrefix(base::StringPiece file_name) {
@@ -150,6 +519,13 @@ const FileTypeInfo* GetFileTypeInfo(base::StringPiece file_name,
   return &kFileTypeInfo[0];
 }
 
+// Whether |file_name| opened in |mode| is a null file because all the outputs
+// are discarded, see NullFile::set_discard_outputs().
+bool IsDiscardedOutput(const char* file_name, const char* mode) {
+  return NullFile::discard_outputs() &&
+         (strcmp(mode, "r") != 0 || NullFile::Exists(file_name));
+}
+
 }  // namespace
 
 File* File::Create(const char* file_name, const char* mode) {
@@ -162,17 +538,45 @@ File* File::Create(const char* file_name, const char* mode) {
     // Disable caching for memory and callback files.
     return internal_file.release();
   }
+  if (file_type_prefix == kNullFilePrefix ||
+      IsDiscardedOutput(file_name, mode)) {
+    // Null files have no I/O to cache.
+    return internal_file.release();
+  }
+  if (file_type_prefix == kTeeFilePrefix) {
+    // Each of the files of a tee file has its own cache.
+    return internal_file.release();
+  }
+  if (file_type_prefix == kHlsHttpFilePrefix ||
+      file_type_prefix == kHlsHttpsFilePrefix) {
+    // HlsPullFile already buffers the segments fetched ahead.
+    return internal_file.release();
+  }
+  if ((file_type_prefix.empty() || file_type_prefix == kLocalFilePrefix) &&
+      UseUringFile(mode)) {
+    // io_uring writes do not block, so there is no need for an I/O thread.
+    return internal_file.release();
+  }
+  if ((file_type_prefix == kHttpFilePrefix ||
+       file_type_prefix == kHttpsFilePrefix) &&
+      (FLAGS_http2_multiplexed_upload || FLAGS_io_threads > 0)) {
+    // HttpFile already caches the written data, which is sent by the shared
+    // upload event loop, or by an upload thread of its own for the retried
+    // uploads, so there is no need for an I/O thread either.
+    return internal_file.release();
+  }
 
   if (FLAGS_io_cache_size) {
     // Enable threaded I/O for "r", "w", and "a" modes only.
     if (!strcmp(mode, "r")) {
       return new ThreadedIoFile(std::move(internal_file),
                                 ThreadedIoFile::kInputMode, FLAGS_io_cache_size,
-                                FLAGS_io_block_size);
+                                FLAGS_io_cache_max_size, FLAGS_io_block_size);
     } else if (!strcmp(mode, "w") || !strcmp(mode, "a")) {
-      return new ThreadedIoFile(std::move(internal_file),
-                                ThreadedIoFile::kOutputMode,
-                                FLAGS_io_cache_size, FLAGS_io_block_size);
+      return new ThreadedIoFile(
+          std::move(internal_file), ThreadedIoFile::kOutputMode,
+          FLAGS_io_cache_size, FLAGS_io_cache_max_size, FLAGS_io_block_size,
+          FLAGS_io_threads > 0 ? IoReactor::GetInstance() : nullptr);
     }
   }
 
@@ -182,6 +586,8 @@ File* File::Create(const char* file_name, const char* mode) {
 }
 
 File* File::CreateInternalFile(const char* file_name, const char* mode) {
+  if (IsDiscardedOutput(file_name, mode))
+    return new NullFile(file_name, mode);
   base::StringPiece real_file_name;
   const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
   DCHECK(file_type);
@@ -211,6 +617,8 @@ File* File::OpenWithNoBuffering(const char* file_name, const char* mode) {
 }
 
 bool File::Delete(const char* file_name) {
+  if (NullFile::discard_outputs())
+    return NullFile::Delete(file_name);
   base::StringPiece real_file_name;
   const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
   DCHECK(file_type);
@@ -219,6 +627,16 @@ bool File::Delete(const char* file_name) {
              : false;
 }
 
+void File::PrepareForWrite(const char* file_name) {
+  if (NullFile::discard_outputs())
+    return;
+  base::StringPiece real_file_name;
+  const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
+  DCHECK(file_type);
+  if (file_type->prepare_write_function)
+    file_type->prepare_write_function(real_file_name.data());
+}
+
 int64_t File::GetFileSize(const char* file_name) {
   File* file = File::Open(file_name, "r");
   if (!file)
@@ -278,6 +696,8 @@ bool File::WriteStringToFile(const char* file_name,
 bool File::WriteFileAtomically(const char* file_name,
                                const std::string& contents) {
   VLOG(2) << "File::WriteFileAtomically: " << file_name;
+  if (NullFile::discard_outputs())
+    return NullFile::WriteFileAtomically(file_name, contents);
   base::StringPiece real_file_name;
   const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
   DCHECK(file_type);
@@ -331,6 +751,32 @@ bool File::Copy(const char* from_file_name, const char* to_file_name) {
   return true;
 }
 
+bool File::PrepareKernelCopy(int* fd, uint64_t* position) {
+  return false;
+}
+
+bool File::CompleteKernelCopy(uint64_t bytes_copied) {
+  NOTREACHED() << "The file does not support copies in the kernel.";
+  return false;
+}
+
+int64_t File::WriteV(const IoVec* iov, size_t iov_count) {
+  int64_t total_bytes_written = 0;
+  for (size_t i = 0; i < iov_count; ++i) {
+    const uint8_t* buffer = static_cast<const uint8_t*>(iov[i].buffer);
+    uint64_t bytes_left = iov[i].length;
+    while (bytes_left > 0) {
+      const int64_t bytes_written = Write(buffer, bytes_left);
+      if (bytes_written <= 0)
+        return bytes_written < 0 ? bytes_written : -1;
+      buffer += bytes_written;
+      bytes_left -= bytes_written;
+      total_bytes_written += bytes_written;
+    }
+  }
+  return total_bytes_written;
+}
+
 int64_t File::CopyFile(File* source, File* destination) {
   return CopyFile(source, destination, kWholeFile);
 }
@@ -343,9 +789,30 @@ int64_t File::CopyFile(File* source, File* destination, int64_t max_copy) {
 
   VLOG(1) << "File::CopyFile from " << source->file_name() << " to " << destination->file_name();
 
+  int64_t bytes_copied = 0;
+#if defined(OS_LINUX)
+  int source_fd = -1;
+  int destination_fd = -1;
+  uint64_t source_position = 0;
+  uint64_t destination_position = 0;
+  if (source->PrepareKernelCopy(&source_fd, &source_position) &&
+      destination->PrepareKernelCopy(&destination_fd, &destination_position)) {
+    bool complete = false;
+    bytes_copied = KernelCopy(source_fd, source_position, destination_fd,
+                              destination_position, max_copy, &complete);
+    if (bytes_copied > 0 && (!source->CompleteKernelCopy(bytes_copied) ||
+                             !destination->CompleteKernelCopy(bytes_copied))) {
+      LOG(ERROR) << "Failed to update the file positions after copying "
+                 << bytes_copied << " bytes.";
+      return -1;
+    }
+    if (complete)
+      return bytes_copied;
+  }
+#endif  // defined(OS_LINUX)
+
   const int64_t kBufferSize = 0x40000;  // 256KB.
   std::unique_ptr<uint8_t[]> buffer(new uint8_t[kBufferSize]);
-  int64_t bytes_copied = 0;
   while (bytes_copied < max_copy) {
     const int64_t size = std::min(kBufferSize, max_copy - bytes_copied);
     const int64_t bytes_read = source->Read(buffer.get(), size);
@@ -396,6 +863,15 @@ bool File::IsLocalRegularFile(const char* file_name) {
 #endif
 }
 
+bool File::IsSeekableInput(const char* file_name) {
+  base::StringPiece real_file_name;
+  const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
+  DCHECK(file_type);
+  if (file_type->type == kHttpFilePrefix || file_type->type == kHttpsFilePrefix)
+    return true;
+  return IsLocalRegularFile(file_name);
+}
+
 std::string File::MakeCallbackFileName(
     const BufferCallbackParams& callback_params,
     const std::string& name) {
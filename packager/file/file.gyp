@@ -7,6 +7,8 @@
 {
   'variables': {
     'shaka_code': 1,
+    # Build SrtFile for srt:// inputs, which needs libsrt installed.
+    'enable_srt%': 0,
   },
   'targets': [
     {
@@ -15,22 +17,50 @@
       'sources': [
         'callback_file.cc',
         'callback_file.h',
+        'curl_handle_pool.cc',
+        'curl_handle_pool.h',
         'file.cc',
         'file.h',
+        'file_deleter.cc',
+        'file_deleter.h',
         'file_util.cc',
         'file_util.h',
         'file_closer.h',
+        'hls_pull_file.cc',
+        'hls_pull_file.h',
         'http_file.cc',
         'http_file.h',
+        'huge_page_buffer.cc',
+        'huge_page_buffer.h',
         'io_cache.cc',
         'io_cache.h',
+        'io_reactor.cc',
+        'io_reactor.h',
         'local_file.cc',
         'local_file.h',
+        'mapped_file.cc',
+        'mapped_file.h',
         'memory_file.cc',
         'memory_file.h',
+        'multipart_upload_file.cc',
+        'multipart_upload_file.h',
+        'null_file.cc',
+        'null_file.h',
+        'precompressed_file_writer.cc',
+        'precompressed_file_writer.h',
         'public/buffer_callback_params.h',
+        'replay_buffer.cc',
+        'replay_buffer.h',
+        'rtp_jitter_buffer.cc',
+        'rtp_jitter_buffer.h',
+        'srt_options.cc',
+        'srt_options.h',
+        'tee_file.cc',
+        'tee_file.h',
         'threaded_io_file.cc',
         'threaded_io_file.h',
+        'ts_datagram_pacer.cc',
+        'ts_datagram_pacer.h',
         'udp_file.cc',
         'udp_file.h',
         'udp_options.cc',
@@ -38,9 +68,36 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../metrics/metrics.gyp:metrics',
         '../packager.gyp:status',
         '../third_party/gflags/gflags.gyp:gflags',
+        '../third_party/boringssl/boringssl.gyp:boringssl',
         '../third_party/curl/curl.gyp:libcurl',
+        '../third_party/zlib/zlib.gyp:zlib',
+      ],
+      'conditions': [
+        ['OS == "linux"', {
+          'sources': [
+            'direct_io_file.cc',
+            'direct_io_file.h',
+            'uring_file.cc',
+            'uring_file.h',
+          ],
+        }],
+        ['enable_srt == 1', {
+          'sources': [
+            'srt_file.cc',
+            'srt_file.h',
+          ],
+          'defines': [
+            'ENABLE_SRT',
+          ],
+          'link_settings': {
+            'libraries': [
+              '-lsrt',
+            ],
+          },
+        }],
       ],
     },
     {
@@ -48,19 +105,41 @@
       'type': '<(gtest_target_type)',
       'sources': [
         'callback_file_unittest.cc',
+        'file_deleter_unittest.cc',
         'file_unittest.cc',
         'file_util_unittest.cc',
+        'hls_pull_file_unittest.cc',
+        'huge_page_buffer_unittest.cc',
         'io_cache_unittest.cc',
+        'io_reactor_unittest.cc',
+        'mapped_file_unittest.cc',
         'memory_file_unittest.cc',
+        'multipart_upload_file_unittest.cc',
+        'null_file_unittest.cc',
+        'precompressed_file_writer_unittest.cc',
+        'replay_buffer_unittest.cc',
+        'rtp_jitter_buffer_unittest.cc',
+        'srt_options_unittest.cc',
+        'tee_file_unittest.cc',
+        'ts_datagram_pacer_unittest.cc',
         'udp_options_unittest.cc',
         'http_file_unittest.cc',
       ],
+      'conditions': [
+        ['OS == "linux"', {
+          'sources': [
+            'direct_io_file_unittest.cc',
+            'uring_file_unittest.cc',
+          ],
+        }],
+      ],
       'dependencies': [
         '../media/test/media_test.gyp:run_tests_with_atexit_manager',
         '../testing/gmock.gyp:gmock',
         '../testing/gtest.gyp:gtest',
         '../third_party/gflags/gflags.gyp:gflags',
         '../third_party/curl/curl.gyp:libcurl',
+        '../third_party/zlib/zlib.gyp:zlib',
         'file',
       ],
     },
@@ -20,9 +20,22 @@ extern const char* kCallbackFilePrefix;
 extern const char* kLocalFilePrefix;
 extern const char* kMemoryFilePrefix;
 extern const char* kUdpFilePrefix;
+extern const char* kSrtFilePrefix;
 extern const char* kHttpFilePrefix;
+extern const char* kMultipartHttpFilePrefix;
+extern const char* kMultipartHttpsFilePrefix;
+extern const char* kHlsHttpFilePrefix;
+extern const char* kHlsHttpsFilePrefix;
+extern const char* kTeeFilePrefix;
+extern const char* kNullFilePrefix;
 const int64_t kWholeFile = -1;
 
+/// Describes a block of memory to be written with File::WriteV().
+struct IoVec {
+  const void* buffer;
+  uint64_t length;
+};
+
 /// Define an abstract file interface.
 class File {
  public:
@@ -47,6 +60,14 @@ class File {
   /// @return true if successful, false otherwise.
   static bool Delete(const char* file_name);
 
+  /// Prepare for a file to be opened for writing soon, e.g. the next segment
+  /// of a live output, to take setup latency off the write path. For
+  /// http(s):// files, with --http_warm_up_connections, a connection to the
+  /// server is opened in the background. It does nothing for the other types.
+  /// @param file_name is the name of the file, or of another file on the same
+  ///        server, e.g. the segment template.
+  static void PrepareForWrite(const char* file_name);
+
   /// Flush() and de-allocate resources associated with this file, and
   /// delete this File object.  THIS IS THE ONE TRUE WAY TO DEALLOCATE
   /// THIS OBJECT.
@@ -68,6 +89,13 @@ class File {
   /// @return Number of bytes written, or a value < 0 on error.
   virtual int64_t Write(const void* buffer, uint64_t length) = 0;
 
+  /// Write the blocks of data in @a iov one after the other, as if they were
+  /// concatenated. The default implementation calls Write() for every block.
+  /// @param iov points to an array of @a iov_count blocks.
+  /// @param iov_count is the number of blocks in @a iov.
+  /// @return The total number of bytes written, or a value < 0 on error.
+  virtual int64_t WriteV(const IoVec* iov, size_t iov_count);
+
   /// @return Size of the file in bytes. A return value less than zero
   ///         indicates a problem getting the size.
   virtual int64_t Size() = 0;
@@ -90,6 +118,12 @@ class File {
   /// @return true on succcess, false otherwise.
   virtual bool Tell(uint64_t* position) = 0;
 
+  /// Unblock the Read() call in progress, if any, and make it and the next
+  /// reads fail. Used to cancel packaging promptly. Unlike the other methods,
+  /// this can be called from another thread. The default implementation does
+  /// nothing.
+  virtual void Abort() {}
+
   /// @return The file name. Note that the file type prefix has been stripped
   ///         off.
   const std::string& file_name() const { return file_name_; }
@@ -147,6 +181,12 @@ class File {
   /// @return true if `file_name` is a local and regular file.
   static bool IsLocalRegularFile(const char* file_name);
 
+  /// @param file_name is the name of the file to be checked.
+  /// @return true if `file_name` can be seeked when opened for reading, i.e.
+  ///         it is a local and regular file or an http:// or https://
+  ///         resource, which is read with range requests.
+  static bool IsSeekableInput(const char* file_name);
+
   /// Generate callback file name.
   /// NOTE: THE GENERATED NAME IS ONLY VAID WHILE @a callback_params IS VALID.
   /// @param callback_params references BufferCallbackParams, which will be
@@ -177,6 +217,17 @@ class File {
   /// Internal open. Should not be used directly.
   virtual bool Open() = 0;
 
+  /// Used by CopyFile() to copy the data in the kernel, without a user space
+  /// buffer. Flush the data buffered, if any, and get the file descriptor and
+  /// the position the data can be copied from or to directly.
+  /// @return false if the file does not support it, which is the default.
+  virtual bool PrepareKernelCopy(int* fd, uint64_t* position);
+
+  /// Used by CopyFile() after a copy in the kernel, which does not update the
+  /// file position: move the file position past the bytes copied.
+  /// @return true on success, false otherwise.
+  virtual bool CompleteKernelCopy(uint64_t bytes_copied);
+
  private:
   friend class ThreadedIoFile;
 
@@ -0,0 +1,89 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/file_deleter.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/file.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+
+FileDeleter* FileDeleter::GetInstance() {
+  static FileDeleter instance;
+  return &instance;
+}
+
+FileDeleter::FileDeleter() : task_done_(&lock_) {
+  backlog_gauge_id_ = Metrics::GetInstance()->AddGaugeFunction(
+      "shaka_file_deletion_backlog",
+      "Files queued for deletion or being deleted.", {},
+      [this]() { return static_cast<double>(backlog()); });
+}
+
+FileDeleter::~FileDeleter() {
+  Flush();
+  Metrics::GetInstance()->RemoveGaugeFunction(backlog_gauge_id_);
+}
+
+void FileDeleter::Delete(const std::string& file_name) {
+  base::AutoLock scoped_lock(lock_);
+  pending_files_.insert(pending_files_.end(), failed_files_.begin(),
+                        failed_files_.end());
+  failed_files_.clear();
+  pending_files_.push_back(file_name);
+  if (task_running_)
+    return;
+  task_running_ = true;
+  base::WorkerPool::PostTask(
+      FROM_HERE, base::Bind(&FileDeleter::DeleteTask, base::Unretained(this)),
+      true /* task_is_slow */);
+}
+
+void FileDeleter::Flush() {
+  base::AutoLock scoped_lock(lock_);
+  while (task_running_)
+    task_done_.Wait();
+}
+
+size_t FileDeleter::backlog() const {
+  base::AutoLock scoped_lock(lock_);
+  return pending_files_.size() + num_files_in_progress_;
+}
+
+void FileDeleter::DeleteTask() {
+  base::AutoLock scoped_lock(lock_);
+  while (!pending_files_.empty()) {
+    std::deque<std::string> batch;
+    batch.swap(pending_files_);
+    num_files_in_progress_ = batch.size();
+
+    std::vector<std::string> failed_files;
+    {
+      base::AutoUnlock scoped_unlock(lock_);
+      for (const std::string& file_name : batch) {
+        VLOG(2) << "Deleting " << file_name;
+        if (!File::Delete(file_name.c_str())) {
+          LOG(WARNING) << "Failed to delete " << file_name
+                       << "; Will retry later.";
+          failed_files.push_back(file_name);
+        }
+      }
+    }
+
+    failed_files_.insert(failed_files_.end(), failed_files.begin(),
+                         failed_files.end());
+    num_files_in_progress_ = 0;
+  }
+  task_running_ = false;
+  task_done_.Broadcast();
+}
+
+}  // namespace shaka
@@ -0,0 +1,63 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_FILE_DELETER_H_
+#define PACKAGER_FILE_FILE_DELETER_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+/// Deletes files on a background thread, e.g. the segments which fall out of
+/// the live window, so a slow deletion on remote storage does not stall the
+/// caller. The files queued while a batch is deleted are deleted in the next
+/// batch. The files which cannot be deleted are retried with the next batch.
+/// Thread safe.
+class FileDeleter {
+ public:
+  /// @return the process-wide instance.
+  static FileDeleter* GetInstance();
+
+  /// Queue @a file_name for deletion.
+  void Delete(const std::string& file_name);
+
+  /// Wait until the files queued are deleted, or failed to be deleted.
+  void Flush();
+
+  /// @return the number of files queued or being deleted.
+  size_t backlog() const;
+
+ private:
+  FileDeleter();
+  ~FileDeleter();
+
+  FileDeleter(const FileDeleter&) = delete;
+  FileDeleter& operator=(const FileDeleter&) = delete;
+
+  // Delete the files queued, batch by batch, until there are none left.
+  void DeleteTask();
+
+  mutable base::Lock lock_;
+  // Signaled when the background task finishes.
+  base::ConditionVariable task_done_;
+  std::deque<std::string> pending_files_;
+  // The files which failed to be deleted, queued again by the next Delete().
+  std::vector<std::string> failed_files_;
+  size_t num_files_in_progress_ = 0;
+  bool task_running_ = false;
+  int64_t backlog_gauge_id_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_FILE_DELETER_H_
@@ -0,0 +1,51 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/file_deleter.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+namespace {
+
+const int kNumFiles = 20;
+const char kFileNameTemplate[] = "memory://file_deleter_%d";
+
+bool FileExists(const std::string& file_name) {
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name.c_str(), "r"));
+  return file != nullptr;
+}
+
+}  // namespace
+
+TEST(FileDeleterTest, DeletesFiles) {
+  for (int i = 0; i < kNumFiles; ++i) {
+    ASSERT_TRUE(File::WriteStringToFile(
+        base::StringPrintf(kFileNameTemplate, i).c_str(), "content"));
+  }
+
+  FileDeleter* file_deleter = FileDeleter::GetInstance();
+  for (int i = 0; i < kNumFiles; ++i)
+    file_deleter->Delete(base::StringPrintf(kFileNameTemplate, i));
+  file_deleter->Flush();
+
+  EXPECT_EQ(0u, file_deleter->backlog());
+  for (int i = 0; i < kNumFiles; ++i)
+    EXPECT_FALSE(FileExists(base::StringPrintf(kFileNameTemplate, i)));
+}
+
+TEST(FileDeleterTest, FlushWithoutFiles) {
+  FileDeleter::GetInstance()->Flush();
+  EXPECT_EQ(0u, FileDeleter::GetInstance()->backlog());
+}
+
+}  // namespace shaka
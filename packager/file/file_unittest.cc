@@ -10,8 +10,10 @@
 #include "packager/base/files/file_util.h"
 #include "packager/file/file.h"
 
+DECLARE_string(atomic_write_policy);
 DECLARE_uint64(io_cache_size);
 DECLARE_uint64(io_block_size);
+DECLARE_int32(io_threads);
 
 namespace {
 const int kDataSize = 1024;
@@ -90,6 +92,42 @@ TEST_F(LocalFileTest, Copy) {
   base::DeleteFile(temp_dir, true);
 }
 
+TEST_F(LocalFileTest, CopyFile) {
+  ASSERT_EQ(kDataSize,
+            base::WriteFile(test_file_path_, data_.data(), kDataSize));
+  FilePath destination_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&destination_path));
+  const std::string destination_name = destination_path.AsUTF8Unsafe();
+
+  // Copy the middle of the file after some data written, which checks that the
+  // file positions are kept in sync with the copy in the kernel, if any.
+  const int kOffset = 100;
+  const int kCopySize = 500;
+  File* source = File::OpenWithNoBuffering(local_file_name_.c_str(), "r");
+  ASSERT_TRUE(source != nullptr);
+  File* destination = File::Open(destination_name.c_str(), "w");
+  ASSERT_TRUE(destination != nullptr);
+  ASSERT_TRUE(source->Seek(kOffset));
+  ASSERT_EQ(kOffset, destination->Write(data_.data(), kOffset));
+  EXPECT_EQ(kCopySize, File::CopyFile(source, destination, kCopySize));
+  uint64_t position = 0;
+  ASSERT_TRUE(source->Tell(&position));
+  EXPECT_EQ(static_cast<uint64_t>(kOffset + kCopySize), position);
+  ASSERT_TRUE(destination->Tell(&position));
+  EXPECT_EQ(static_cast<uint64_t>(kOffset + kCopySize), position);
+  // Copy the rest of the file.
+  EXPECT_EQ(kDataSize - kOffset - kCopySize,
+            File::CopyFile(source, destination));
+  EXPECT_EQ(kDataSize, destination->Size());
+  EXPECT_TRUE(source->Close());
+  EXPECT_TRUE(destination->Close());
+
+  std::string copied_data;
+  ASSERT_TRUE(File::ReadFileToString(destination_name.c_str(), &copied_data));
+  EXPECT_EQ(data_, copied_data);
+  base::DeleteFile(destination_path, false);
+}
+
 TEST_F(LocalFileTest, Write) {
   // Write file using File API.
   File* file = File::Open(local_file_name_.c_str(), "w");
@@ -133,6 +171,22 @@ TEST_F(LocalFileTest, Read_And_Eof) {
   EXPECT_EQ(data_, read_data);
 }
 
+TEST_F(LocalFileTest, AbortRead) {
+  ASSERT_EQ(kDataSize,
+            base::WriteFile(test_file_path_, data_.data(), kDataSize));
+
+  File* file = File::Open(local_file_name_.c_str(), "r");
+  ASSERT_TRUE(file != NULL);
+  std::string read_data(kDataSize, 0);
+  EXPECT_EQ(kDataSize / 2, file->Read(&read_data[0], kDataSize / 2));
+
+  // The reads fail once aborted, instead of returning the data left.
+  file->Abort();
+  EXPECT_LT(file->Read(&read_data[0], kDataSize), 0);
+  EXPECT_FALSE(file->Seek(0));
+  file->Close();
+}
+
 TEST_F(LocalFileTest, WriteRead) {
   // Write file using File API, using file name directly (without prefix).
   File* file = File::Open(local_file_name_no_prefix_.c_str(), "w");
@@ -174,6 +228,27 @@ TEST_F(LocalFileTest, AtomicWriteRead) {
   EXPECT_EQ(data_, read_data);
 }
 
+TEST_F(LocalFileTest, AtomicWritePolicies) {
+  google::FlagSaver flag_saver;
+  for (const char* policy : {"rename", "rename_fsync", "overwrite"}) {
+    SCOPED_TRACE(policy);
+    FLAGS_atomic_write_policy = policy;
+    // Overwrite a longer file, which checks that it is truncated.
+    ASSERT_TRUE(File::WriteFileAtomically(local_file_name_no_prefix_.c_str(),
+                                          data_ + data_));
+    ASSERT_TRUE(
+        File::WriteFileAtomically(local_file_name_no_prefix_.c_str(), data_));
+    std::string read_data;
+    ASSERT_TRUE(
+        File::ReadFileToString(local_file_name_no_prefix_.c_str(), &read_data));
+    EXPECT_EQ(data_, read_data);
+  }
+
+  FLAGS_atomic_write_policy = "unknown";
+  EXPECT_FALSE(
+      File::WriteFileAtomically(local_file_name_no_prefix_.c_str(), data_));
+}
+
 TEST_F(LocalFileTest, WriteFlushCheckSize) {
   const uint32_t kNumCycles(10);
   const uint32_t kNumWrites(10);
@@ -195,6 +270,39 @@ TEST_F(LocalFileTest, WriteFlushCheckSize) {
   }
 }
 
+TEST_F(LocalFileTest, WriteWithSharedIoThreads) {
+  google::FlagSaver flag_saver;
+  FLAGS_io_threads = 2;
+  // Smaller than the writes, which are then split.
+  FLAGS_io_cache_size = kDataSize / 4;
+  FLAGS_io_block_size = kDataSize / 16;
+
+  const uint32_t kNumFiles(4);
+  const uint32_t kNumWrites(10);
+  std::vector<File*> files;
+  std::vector<std::string> file_names;
+  for (uint32_t file_idx = 0; file_idx < kNumFiles; ++file_idx) {
+    file_names.push_back(local_file_name_no_prefix_ + "." +
+                         std::to_string(file_idx));
+    files.push_back(File::Open(file_names.back().c_str(), "w"));
+    ASSERT_TRUE(files.back() != nullptr);
+  }
+  for (uint32_t write_idx = 0; write_idx < kNumWrites; ++write_idx) {
+    for (File* file : files)
+      EXPECT_EQ(kDataSize, file->Write(data_.data(), kDataSize));
+  }
+  for (File* file : files)
+    EXPECT_TRUE(file->Close());
+
+  for (const std::string& file_name : file_names) {
+    std::string read_data;
+    ASSERT_TRUE(File::ReadFileToString(file_name.c_str(), &read_data));
+    EXPECT_EQ(data_.size() * kNumWrites, read_data.size());
+    EXPECT_EQ(data_, read_data.substr(read_data.size() - kDataSize));
+    EXPECT_TRUE(File::Delete(file_name.c_str()));
+  }
+}
+
 TEST_F(LocalFileTest, IsLocalReguar) {
   ASSERT_EQ(kDataSize,
             base::WriteFile(test_file_path_, data_.data(), kDataSize));
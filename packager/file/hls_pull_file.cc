@@ -0,0 +1,448 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/hls_pull_file.h"
+
+#include <gflags/gflags.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/file_closer.h"
+#include "packager/metrics/metrics.h"
+
+DEFINE_int32(hls_input_parallel_segments, 3,
+             "Number of segments of hls+http:// and hls+https:// inputs "
+             "fetched in parallel ahead of the segment being read.");
+
+namespace shaka {
+namespace {
+
+// The number of segments from the end of a live playlist the stream starts
+// from, the earliest start allowed by the HLS specification.
+const size_t kLiveStartSegments = 3;
+// The number of consecutive failures to load a live playlist before the
+// stream fails.
+const int kMaxPlaylistFailures = 3;
+const int kMaxSegmentFetchAttempts = 2;
+// Used when the playlist has no EXT-X-TARGETDURATION.
+const double kDefaultTargetDurationSeconds = 2;
+const size_t kFetchBufferSize = 64 * 1024;
+
+bool StartsWith(const std::string& line, const char* prefix) {
+  return base::StartsWith(line, prefix, base::CompareCase::SENSITIVE);
+}
+
+// Returns the value of the attribute |name| of the tag |line|, e.g. the URI
+// of "#EXT-X-MAP:URI="init.mp4"", without the quotes.
+std::string GetAttribute(const std::string& line, const std::string& name) {
+  size_t pos = line.find(':');
+  while (pos != std::string::npos && pos < line.size()) {
+    ++pos;
+    if (line.compare(pos, name.size() + 1, name + "=") == 0) {
+      pos += name.size() + 1;
+      if (pos < line.size() && line[pos] == '"') {
+        const size_t end = line.find('"', pos + 1);
+        return line.substr(pos + 1, end - pos - 1);
+      }
+      return line.substr(pos, line.find(',', pos) - pos);
+    }
+    // Skip to the next attribute, ignoring the commas in quoted values.
+    bool quoted = false;
+    for (; pos < line.size(); ++pos) {
+      if (line[pos] == '"')
+        quoted = !quoted;
+      else if (line[pos] == ',' && !quoted)
+        break;
+    }
+  }
+  return "";
+}
+
+std::string ResolveUrl(const std::string& base_url, const std::string& uri) {
+  if (uri.find("://") != std::string::npos)
+    return uri;
+  if (uri[0] == '/') {
+    const size_t scheme_end = base_url.find("://");
+    const size_t host_begin =
+        scheme_end == std::string::npos ? 0 : scheme_end + 3;
+    return base_url.substr(0, base_url.find('/', host_begin)) + uri;
+  }
+  const std::string path = base_url.substr(0, base_url.find('?'));
+  return path.substr(0, path.rfind('/') + 1) + uri;
+}
+
+}  // namespace
+
+struct HlsPullFile::Segment {
+  explicit Segment(const std::string& url) : url(url) {}
+
+  const std::string url;
+  std::string data;
+  bool done = false;
+  bool failed = false;
+};
+
+HlsPullFile::HlsPullFile(const char* playlist_url)
+    : File(playlist_url),
+      playlist_url_(playlist_url),
+      max_fetches_running_(std::max(1, FLAGS_hls_input_parallel_segments)),
+      cancel_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                    base::WaitableEvent::InitialState::NOT_SIGNALED),
+      poller_exit_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                         base::WaitableEvent::InitialState::NOT_SIGNALED),
+      segment_ready_(&lock_) {}
+
+HlsPullFile::~HlsPullFile() {}
+
+bool HlsPullFile::Close() {
+  cancel_event_.Signal();
+  if (poller_started_)
+    poller_exit_event_.Wait();
+  {
+    base::AutoLock auto_lock(lock_);
+    while (num_fetches_running_ > 0)
+      segment_ready_.Wait();
+  }
+  delete this;
+  return true;
+}
+
+int64_t HlsPullFile::Read(void* buffer, uint64_t length) {
+  base::AutoLock auto_lock(lock_);
+  while (!cancel_event_.IsSignaled()) {
+    if (!segments_.empty() && segments_.front()->done) {
+      Segment* segment = segments_.front().get();
+      if (segment->failed && segment->url == init_segment_url_) {
+        LOG(ERROR) << "Cannot read the initialization segment "
+                   << segment->url << ".";
+        return -1;
+      }
+      LOG_IF(WARNING, segment->failed)
+          << "Skipping the segment " << segment->url << " not fetched.";
+      if (segment_offset_ < segment->data.size()) {
+        const uint64_t bytes_read =
+            std::min(length, segment->data.size() - segment_offset_);
+        memcpy(buffer, segment->data.data() + segment_offset_, bytes_read);
+        segment_offset_ += bytes_read;
+        position_ += bytes_read;
+        return bytes_read;
+      }
+      segments_.pop_front();
+      segment_offset_ = 0;
+      --next_segment_to_fetch_;
+      StartFetchesLocked();
+      continue;
+    }
+    if (segments_.empty() && poller_done_)
+      return poller_failed_ ? -1 : 0;
+    segment_ready_.Wait();
+  }
+  return 0;
+}
+
+int64_t HlsPullFile::Write(const void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "HlsPullFile is not writable.";
+  return -1;
+}
+
+int64_t HlsPullFile::Size() {
+  // The size of the stream is not known until it ends.
+  return -1;
+}
+
+bool HlsPullFile::Flush() {
+  NOTIMPLEMENTED() << "HlsPullFile is not writable.";
+  return false;
+}
+
+bool HlsPullFile::Seek(uint64_t position) {
+  VLOG(1) << "HlsPullFile does not support Seek().";
+  return false;
+}
+
+bool HlsPullFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+void HlsPullFile::Abort() {
+  cancel_event_.Signal();
+  base::AutoLock auto_lock(lock_);
+  segment_ready_.Broadcast();
+}
+
+// static
+bool HlsPullFile::ParsePlaylist(const std::string& playlist_url,
+                                const std::string& content,
+                                Playlist* playlist) {
+  *playlist = Playlist();
+  const std::vector<std::string> lines = base::SplitString(
+      content, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  if (lines.empty() || lines[0] != "#EXTM3U") {
+    LOG(ERROR) << playlist_url << " is not an HLS playlist.";
+    return false;
+  }
+
+  // The bandwidth of the EXT-X-STREAM-INF preceding the line, if any.
+  int64_t variant_bandwidth = -1;
+  int64_t max_variant_bandwidth = -1;
+  for (size_t i = 1; i < lines.size(); ++i) {
+    const std::string& line = lines[i];
+    if (line[0] != '#') {
+      const std::string url = ResolveUrl(playlist_url, line);
+      if (variant_bandwidth >= 0) {
+        if (variant_bandwidth > max_variant_bandwidth) {
+          max_variant_bandwidth = variant_bandwidth;
+          playlist->variant_url = url;
+        }
+        variant_bandwidth = -1;
+      } else {
+        playlist->segment_urls.push_back(url);
+      }
+    } else if (StartsWith(line, "#EXT-X-STREAM-INF:")) {
+      if (!base::StringToInt64(GetAttribute(line, "BANDWIDTH"),
+                               &variant_bandwidth)) {
+        variant_bandwidth = 0;
+      }
+    } else if (StartsWith(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+      if (!base::StringToUint64(line.substr(line.find(':') + 1),
+                                &playlist->media_sequence)) {
+        LOG(ERROR) << "Invalid " << line << " in " << playlist_url << ".";
+        return false;
+      }
+    } else if (StartsWith(line, "#EXT-X-TARGETDURATION:")) {
+      base::StringToDouble(line.substr(line.find(':') + 1),
+                           &playlist->target_duration);
+    } else if (StartsWith(line, "#EXT-X-ENDLIST")) {
+      playlist->end_list = true;
+    } else if (StartsWith(line, "#EXT-X-MAP:")) {
+      if (!GetAttribute(line, "BYTERANGE").empty()) {
+        LOG(ERROR) << "Byte ranges are not supported: " << playlist_url << ".";
+        return false;
+      }
+      playlist->init_segment_url =
+          ResolveUrl(playlist_url, GetAttribute(line, "URI"));
+    } else if (StartsWith(line, "#EXT-X-BYTERANGE:")) {
+      LOG(ERROR) << "Byte ranges are not supported: " << playlist_url << ".";
+      return false;
+    } else if (StartsWith(line, "#EXT-X-KEY:") &&
+               GetAttribute(line, "METHOD") != "NONE") {
+      LOG(ERROR) << "Encrypted playlists are not supported: " << playlist_url
+                 << ".";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HlsPullFile::Open() {
+  bool updated = false;
+  if (!LoadPlaylist(&updated))
+    return false;
+  if (end_list_) {
+    base::AutoLock auto_lock(lock_);
+    poller_done_ = true;
+    return true;
+  }
+  poller_started_ = true;
+  base::WorkerPool::PostTask(
+      FROM_HERE, base::Bind(&HlsPullFile::PollPlaylist, base::Unretained(this)),
+      true  // task_is_slow
+  );
+  return true;
+}
+
+bool HlsPullFile::LoadPlaylist(bool* updated) {
+  std::string content;
+  Playlist playlist;
+  if (!FetchUrl(playlist_url_, &content) ||
+      !ParsePlaylist(playlist_url_, content, &playlist)) {
+    return false;
+  }
+  if (!playlist.variant_url.empty()) {
+    if (followed_variant_) {
+      LOG(ERROR) << "Expecting a media playlist at " << playlist_url_ << ".";
+      return false;
+    }
+    LOG(INFO) << "Reading the variant " << playlist.variant_url
+              << " of the master playlist " << playlist_url_ << ".";
+    playlist_url_ = playlist.variant_url;
+    followed_variant_ = true;
+    return LoadPlaylist(updated);
+  }
+  followed_variant_ = true;
+  target_duration_ = base::TimeDelta::FromMilliseconds(static_cast<int64_t>(
+      1000 * (playlist.target_duration > 0 ? playlist.target_duration
+                                           : kDefaultTargetDurationSeconds)));
+  end_list_ = playlist.end_list;
+  *updated = AddSegments(playlist);
+  return true;
+}
+
+bool HlsPullFile::AddSegments(const Playlist& playlist) {
+  const uint64_t first_sequence = playlist.media_sequence;
+  const uint64_t end_sequence = first_sequence + playlist.segment_urls.size();
+  // The media sequence number never decreases, unless the origin restarted the
+  // stream, e.g. after an encoder restart. The segments of the new playlist
+  // would otherwise be taken for segments already read until the new numbers
+  // catch up, stalling the stream.
+  if (has_next_media_sequence_ && first_sequence < media_sequence_) {
+    LOG(WARNING) << "The media sequence of " << playlist_url_
+                 << " went back from " << media_sequence_ << " to "
+                 << first_sequence << ". Resuming from the new playlist.";
+    Metrics::GetInstance()->IncrementCounter(
+        "shaka_hls_input_media_sequence_resets",
+        "Restarts of the media sequence numbers of a live HLS input, after "
+        "which the input resumes from the live edge of the new playlist.",
+        {{"file", file_name()}}, 1);
+    has_next_media_sequence_ = false;
+  }
+  media_sequence_ = first_sequence;
+  if (!has_next_media_sequence_) {
+    next_media_sequence_ =
+        playlist.end_list
+            ? first_sequence
+            : end_sequence - std::min(kLiveStartSegments,
+                                      playlist.segment_urls.size());
+    has_next_media_sequence_ = true;
+  }
+  if (next_media_sequence_ < first_sequence) {
+    LOG(WARNING) << "Segments " << next_media_sequence_ << " to "
+                 << first_sequence - 1 << " of " << playlist_url_
+                 << " expired before they were fetched.";
+    next_media_sequence_ = first_sequence;
+  }
+
+  base::AutoLock auto_lock(lock_);
+  bool added = false;
+  if (!playlist.init_segment_url.empty()) {
+    if (init_segment_url_.empty()) {
+      init_segment_url_ = playlist.init_segment_url;
+      segments_.push_back(std::make_shared<Segment>(init_segment_url_));
+      added = true;
+    } else {
+      LOG_IF(WARNING, playlist.init_segment_url != init_segment_url_)
+          << "Ignoring the new initialization segment "
+          << playlist.init_segment_url << " of " << playlist_url_ << ".";
+    }
+  }
+  for (; next_media_sequence_ < end_sequence; ++next_media_sequence_) {
+    segments_.push_back(std::make_shared<Segment>(
+        playlist.segment_urls[next_media_sequence_ - first_sequence]));
+    added = true;
+  }
+  if (added) {
+    StartFetchesLocked();
+    segment_ready_.Broadcast();
+  }
+  return added;
+}
+
+void HlsPullFile::PollPlaylist() {
+  // A playlist which has changed is reloaded after the target duration, and
+  // after half the target duration otherwise, as recommended by the HLS
+  // specification.
+  base::TimeDelta reload_interval = target_duration_;
+  int num_failures = 0;
+  bool failed = false;
+  while (!cancel_event_.TimedWait(reload_interval)) {
+    bool updated = false;
+    if (LoadPlaylist(&updated)) {
+      num_failures = 0;
+      if (end_list_)
+        break;
+      reload_interval = updated ? target_duration_ : target_duration_ / 2;
+    } else if (++num_failures >= kMaxPlaylistFailures) {
+      LOG(ERROR) << "Failed to reload " << playlist_url_ << " "
+                 << num_failures << " times.";
+      failed = true;
+      break;
+    } else {
+      reload_interval = target_duration_ / 2;
+    }
+  }
+
+  {
+    base::AutoLock auto_lock(lock_);
+    poller_done_ = true;
+    poller_failed_ = failed;
+    segment_ready_.Broadcast();
+  }
+  poller_exit_event_.Signal();
+}
+
+void HlsPullFile::StartFetchesLocked() {
+  lock_.AssertAcquired();
+  if (cancel_event_.IsSignaled())
+    return;
+  // Keep a window of segments ahead, which can be fetched while the segment
+  // fetched last is read.
+  const size_t window_end = std::min<size_t>(
+      segments_.size(), 1 + 2 * static_cast<size_t>(max_fetches_running_));
+  while (next_segment_to_fetch_ < window_end &&
+         num_fetches_running_ < max_fetches_running_) {
+    ++num_fetches_running_;
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&HlsPullFile::FetchSegment, base::Unretained(this),
+                   segments_[next_segment_to_fetch_]),
+        true  // task_is_slow
+    );
+    ++next_segment_to_fetch_;
+  }
+}
+
+void HlsPullFile::FetchSegment(std::shared_ptr<Segment> segment) {
+  std::string data;
+  bool succeeded = false;
+  for (int attempt = 0; attempt < kMaxSegmentFetchAttempts && !succeeded &&
+                        !cancel_event_.IsSignaled();
+       ++attempt) {
+    succeeded = FetchUrl(segment->url, &data);
+  }
+
+  base::AutoLock auto_lock(lock_);
+  segment->data.swap(data);
+  segment->done = true;
+  segment->failed = !succeeded;
+  --num_fetches_running_;
+  StartFetchesLocked();
+  segment_ready_.Broadcast();
+}
+
+bool HlsPullFile::FetchUrl(const std::string& url, std::string* data) {
+  VLOG(2) << "Fetching " << url;
+  data->clear();
+  std::unique_ptr<File, FileCloser> file(File::Open(url.c_str(), "r"));
+  if (!file) {
+    LOG(ERROR) << "Cannot open " << url << ".";
+    return false;
+  }
+  const int64_t size = file->Size();
+  if (size > 0)
+    data->reserve(size);
+  std::unique_ptr<char[]> buffer(new char[kFetchBufferSize]);
+  while (!cancel_event_.IsSignaled()) {
+    const int64_t bytes_read = file->Read(buffer.get(), kFetchBufferSize);
+    if (bytes_read < 0) {
+      LOG(ERROR) << "Failed to read " << url << ".";
+      return false;
+    }
+    if (bytes_read == 0)
+      return true;
+    data->append(buffer.get(), bytes_read);
+  }
+  return false;
+}
+
+}  // namespace shaka
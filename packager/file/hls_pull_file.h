@@ -0,0 +1,136 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HLS_PULL_FILE_H_
+#define PACKAGER_FILE_HLS_PULL_FILE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Implements a File which reads a remote HLS stream, e.g. a third-party live
+/// feed to repackage, as the continuous stream of its segments. The media
+/// playlist is reloaded as the stream goes, and the upcoming segments are
+/// fetched in parallel, --hls_input_parallel_segments of them, reusing the
+/// connections to the origin, so that a slow segment does not delay the
+/// following ones. A master playlist reads its variant of the highest
+/// bandwidth. A live stream starts from the last three segments of the
+/// playlist and ends when the playlist is ended with EXT-X-ENDLIST. If the
+/// origin restarts the media sequence numbers, the stream resumes from the
+/// last three segments of the new playlist.
+class HlsPullFile : public File {
+ public:
+  /// The parts of a playlist used to read the stream.
+  struct Playlist {
+    uint64_t media_sequence = 0;
+    double target_duration = 0;
+    /// The url of the EXT-X-MAP segment, if any.
+    std::string init_segment_url;
+    std::vector<std::string> segment_urls;
+    bool end_list = false;
+    /// The url of the variant of the highest bandwidth of a master playlist.
+    std::string variant_url;
+  };
+
+  /// @param playlist_url is the url of the media or master playlist, e.g.
+  ///        "https://example.com/live/video.m3u8".
+  explicit HlsPullFile(const char* playlist_url);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  void Abort() override;
+  /// @}
+
+  /// Parse the HLS playlist @a content. The urls in the playlist are resolved
+  /// relative to @a playlist_url.
+  /// @return false if the content is not a playlist, or if the stream uses
+  ///         features not supported, i.e. encryption or byte ranges.
+  static bool ParsePlaylist(const std::string& playlist_url,
+                            const std::string& content,
+                            Playlist* playlist);
+
+ protected:
+  ~HlsPullFile() override;
+
+  bool Open() override;
+
+ private:
+  friend class HlsPullFileTest;
+
+  struct Segment;
+
+  HlsPullFile(const HlsPullFile&) = delete;
+  HlsPullFile& operator=(const HlsPullFile&) = delete;
+
+  // Loads |playlist_url_|, following a master playlist to its variant, and
+  // queues its new segments. |updated| is set if segments were added.
+  bool LoadPlaylist(bool* updated);
+  // Queues the segments of |playlist| not queued yet.
+  bool AddSegments(const Playlist& playlist);
+  // Reloads the playlist until it is ended, the file is closed or the
+  // playlist cannot be loaded anymore. Runs on a worker thread.
+  void PollPlaylist();
+  // Requests the segments of the window ahead of the segment being read.
+  void StartFetchesLocked();
+  void FetchSegment(std::shared_ptr<Segment> segment);
+  // Reads the whole content of |url| into |data|.
+  bool FetchUrl(const std::string& url, std::string* data);
+
+  // Only used by Open() and the poller.
+  std::string playlist_url_;
+  bool followed_variant_ = false;
+  bool end_list_ = false;
+  base::TimeDelta target_duration_;
+  bool has_next_media_sequence_ = false;
+  uint64_t next_media_sequence_ = 0;
+  // The EXT-X-MEDIA-SEQUENCE of the playlist loaded last.
+  uint64_t media_sequence_ = 0;
+
+  const int max_fetches_running_;
+  // Signaled when the file is closed or aborted.
+  base::WaitableEvent cancel_event_;
+  // Signaled when PollPlaylist() exits.
+  base::WaitableEvent poller_exit_event_;
+  bool poller_started_ = false;
+
+  base::Lock lock_;
+  // Signaled when a segment is fetched or queued, or the poller exits.
+  base::ConditionVariable segment_ready_;
+  // The segments queued, starting with the segment being read.
+  std::deque<std::shared_ptr<Segment>> segments_;
+  // The url of the EXT-X-MAP segment, queued before the first segment.
+  std::string init_segment_url_;
+  // Index in |segments_| of the next segment to fetch.
+  size_t next_segment_to_fetch_ = 0;
+  int num_fetches_running_ = 0;
+  bool poller_done_ = false;
+  bool poller_failed_ = false;
+  // Position in the segment being read.
+  uint64_t segment_offset_ = 0;
+  uint64_t position_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HLS_PULL_FILE_H_
@@ -0,0 +1,222 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/hls_pull_file.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+
+class HlsPullFileTest : public testing::Test {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  // Opens the playlist at |playlist_url|, e.g. a memory file.
+  static File* OpenPlaylist(const std::string& playlist_url) {
+    HlsPullFile* file = new HlsPullFile(playlist_url.c_str());
+    if (!file->Open()) {
+      file->Close();
+      return nullptr;
+    }
+    return file;
+  }
+
+  // Reads |size| bytes, or up to the end of the stream.
+  static std::string Read(File* file, size_t size) {
+    std::string data(size, '\0');
+    size_t bytes_read = 0;
+    while (bytes_read < size) {
+      const int64_t result = file->Read(&data[bytes_read], size - bytes_read);
+      if (result <= 0)
+        break;
+      bytes_read += result;
+    }
+    data.resize(bytes_read);
+    return data;
+  }
+};
+
+TEST_F(HlsPullFileTest, ParseMediaPlaylist) {
+  const char kPlaylist[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "#EXT-X-TARGETDURATION:4\n"
+      "#EXT-X-MEDIA-SEQUENCE:17\n"
+      "#EXT-X-MAP:URI=\"init.mp4\"\n"
+      "#EXTINF:4.000,\n"
+      "segment_17.m4s\n"
+      "#EXTINF:4.000,\n"
+      "/other/segment_18.m4s\n"
+      "#EXTINF:4.000,\n"
+      "https://cdn.example.com/segment_19.m4s\n"
+      "#EXT-X-ENDLIST\n";
+  HlsPullFile::Playlist playlist;
+  ASSERT_TRUE(HlsPullFile::ParsePlaylist(
+      "https://example.com/live/video.m3u8?token=1", kPlaylist, &playlist));
+  EXPECT_EQ(17u, playlist.media_sequence);
+  EXPECT_EQ(4, playlist.target_duration);
+  EXPECT_EQ("https://example.com/live/init.mp4", playlist.init_segment_url);
+  ASSERT_EQ(3u, playlist.segment_urls.size());
+  EXPECT_EQ("https://example.com/live/segment_17.m4s",
+            playlist.segment_urls[0]);
+  EXPECT_EQ("https://example.com/other/segment_18.m4s",
+            playlist.segment_urls[1]);
+  EXPECT_EQ("https://cdn.example.com/segment_19.m4s", playlist.segment_urls[2]);
+  EXPECT_TRUE(playlist.end_list);
+  EXPECT_TRUE(playlist.variant_url.empty());
+}
+
+TEST_F(HlsPullFileTest, ParseMasterPlaylist) {
+  const char kPlaylist[] =
+      "#EXTM3U\n"
+      "#EXT-X-STREAM-INF:BANDWIDTH=800000,CODECS=\"avc1.4d401e,mp4a.40.2\"\n"
+      "low.m3u8\n"
+      "#EXT-X-STREAM-INF:BANDWIDTH=2400000,CODECS=\"avc1.4d401f,mp4a.40.2\"\n"
+      "high.m3u8\n"
+      "#EXT-X-STREAM-INF:BANDWIDTH=1200000\n"
+      "medium.m3u8\n";
+  HlsPullFile::Playlist playlist;
+  ASSERT_TRUE(HlsPullFile::ParsePlaylist("http://example.com/master.m3u8",
+                                         kPlaylist, &playlist));
+  EXPECT_EQ("http://example.com/high.m3u8", playlist.variant_url);
+  EXPECT_TRUE(playlist.segment_urls.empty());
+}
+
+TEST_F(HlsPullFileTest, ParseEncryptedPlaylistFails) {
+  const char kPlaylist[] =
+      "#EXTM3U\n"
+      "#EXT-X-KEY:METHOD=AES-128,URI=\"key.bin\"\n"
+      "#EXTINF:4.000,\n"
+      "segment_0.ts\n";
+  HlsPullFile::Playlist playlist;
+  EXPECT_FALSE(HlsPullFile::ParsePlaylist("http://example.com/video.m3u8",
+                                          kPlaylist, &playlist));
+}
+
+TEST_F(HlsPullFileTest, ReadsSegmentsInOrder) {
+  ASSERT_TRUE(File::WriteStringToFile("memory://vod/init.mp4", "init"));
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(File::WriteStringToFile(
+        ("memory://vod/segment_" + std::to_string(i) + ".m4s").c_str(),
+        "segment" + std::to_string(i)));
+  }
+  std::string playlist =
+      "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-MAP:URI=\"init.mp4\"\n";
+  for (int i = 0; i < 8; ++i)
+    playlist += "#EXTINF:2.000,\nsegment_" + std::to_string(i) + ".m4s\n";
+  playlist += "#EXT-X-ENDLIST\n";
+  ASSERT_TRUE(File::WriteStringToFile("memory://vod/video.m3u8", playlist));
+
+  std::unique_ptr<File, FileCloser> file(
+      OpenPlaylist("memory://vod/video.m3u8"));
+  ASSERT_TRUE(file);
+  EXPECT_EQ(
+      "initsegment0segment1segment2segment3segment4segment5segment6segment7",
+      Read(file.get(), 1000));
+  uint8_t byte = 0;
+  EXPECT_EQ(0, file->Read(&byte, 1));
+}
+
+TEST_F(HlsPullFileTest, ReadsLivePlaylistUpdates) {
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_TRUE(File::WriteStringToFile(
+        ("memory://live/segment_" + std::to_string(i) + ".ts").c_str(),
+        "segment" + std::to_string(i)));
+  }
+  const std::string kPlaylistStart =
+      "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:1\n";
+  // The stream starts from the last three segments of the playlist.
+  ASSERT_TRUE(File::WriteStringToFile(
+      "memory://live/video.m3u8",
+      kPlaylistStart +
+          "#EXT-X-MEDIA-SEQUENCE:0\n"
+          "#EXTINF:1.000,\nsegment_0.ts\n"
+          "#EXTINF:1.000,\nsegment_1.ts\n"
+          "#EXTINF:1.000,\nsegment_2.ts\n"
+          "#EXTINF:1.000,\nsegment_3.ts\n"));
+
+  std::unique_ptr<File, FileCloser> file(
+      OpenPlaylist("memory://live/video.m3u8"));
+  ASSERT_TRUE(file);
+  EXPECT_EQ("segment1segment2segment3", Read(file.get(), 24));
+
+  ASSERT_TRUE(File::WriteStringToFile(
+      "memory://live/video.m3u8",
+      kPlaylistStart +
+          "#EXT-X-MEDIA-SEQUENCE:2\n"
+          "#EXTINF:1.000,\nsegment_2.ts\n"
+          "#EXTINF:1.000,\nsegment_3.ts\n"
+          "#EXTINF:1.000,\nsegment_4.ts\n"
+          "#EXTINF:1.000,\nsegment_5.ts\n"
+          "#EXT-X-ENDLIST\n"));
+  EXPECT_EQ("segment4segment5", Read(file.get(), 1000));
+}
+
+TEST_F(HlsPullFileTest, ResumesAfterMediaSequenceReset) {
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(File::WriteStringToFile(
+        ("memory://live/segment_" + std::to_string(i) + ".ts").c_str(),
+        "segment" + std::to_string(i)));
+    ASSERT_TRUE(File::WriteStringToFile(
+        ("memory://live/restarted_" + std::to_string(i) + ".ts").c_str(),
+        "restarted" + std::to_string(i)));
+  }
+  const std::string kPlaylistStart =
+      "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:1\n";
+  ASSERT_TRUE(File::WriteStringToFile(
+      "memory://live/video.m3u8",
+      kPlaylistStart +
+          "#EXT-X-MEDIA-SEQUENCE:100\n"
+          "#EXTINF:1.000,\nsegment_0.ts\n"
+          "#EXTINF:1.000,\nsegment_1.ts\n"
+          "#EXTINF:1.000,\nsegment_2.ts\n"
+          "#EXTINF:1.000,\nsegment_3.ts\n"));
+
+  std::unique_ptr<File, FileCloser> file(
+      OpenPlaylist("memory://live/video.m3u8"));
+  ASSERT_TRUE(file);
+  EXPECT_EQ("segment1segment2segment3", Read(file.get(), 24));
+
+  // The origin restarted the stream with new media sequence numbers, lower
+  // than the ones already read.
+  ASSERT_TRUE(File::WriteStringToFile(
+      "memory://live/video.m3u8",
+      kPlaylistStart +
+          "#EXT-X-MEDIA-SEQUENCE:0\n"
+          "#EXTINF:1.000,\nrestarted_0.ts\n"
+          "#EXTINF:1.000,\nrestarted_1.ts\n"
+          "#EXT-X-ENDLIST\n"));
+  EXPECT_EQ("restarted0restarted1", Read(file.get(), 1000));
+}
+
+TEST_F(HlsPullFileTest, AbortUnblocksRead) {
+  ASSERT_TRUE(File::WriteStringToFile("memory://live/video.m3u8",
+                                      "#EXTM3U\n"
+                                      "#EXT-X-TARGETDURATION:10\n"));
+  std::unique_ptr<File, FileCloser> file(
+      OpenPlaylist("memory://live/video.m3u8"));
+  ASSERT_TRUE(file);
+  file->Abort();
+  uint8_t byte = 0;
+  EXPECT_EQ(0, file->Read(&byte, 1));
+}
+
+TEST_F(HlsPullFileTest, OpenFailsWithoutPlaylist) {
+  EXPECT_FALSE(OpenPlaylist("memory://missing/video.m3u8"));
+}
+
+}  // namespace shaka
@@ -7,6 +7,14 @@
 #include "packager/file/http_file.h"
 
 #include <gflags/gflags.h>
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "packager/base/base64.h"
 #include "packager/base/bind.h"
 #include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
@@ -14,6 +22,8 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/base/synchronization/lock.h"
 #include "packager/base/threading/worker_pool.h"
+#include "packager/base/time/time.h"
+#include "packager/file/curl_handle_pool.h"
 
 DEFINE_int32(libcurl_verbosity, 0,
              "Set verbosity level for libcurl.");
@@ -28,7 +38,49 @@ DEFINE_string(https_cert_private_key_file, "",
               "Absolute path to the private Key file.");
 DEFINE_string(https_cert_private_key_password, "",
               "Password to the private key file.");
+DEFINE_bool(http2_multiplexed_upload, false,
+            "If enabled, all HTTP uploads are driven by a single event loop "
+            "thread and multiplexed over one HTTP/2 connection per origin when "
+            "the server supports it, instead of using one connection and one "
+            "blocked worker thread per upload. Requires libcurl 7.68.0 or "
+            "later.");
+DEFINE_int32(http_upload_max_retries, 0,
+             "Maximum number of times a failed HTTP upload is retried, with "
+             "exponential backoff. The uploaded data is retained in memory "
+             "until the upload completes, so it can be sent again.");
+DEFINE_int32(http_upload_retry_backoff_ms, 1000,
+             "Delay before the first retry of a failed HTTP upload, doubled "
+             "for every following retry.");
+DEFINE_string(http_hedge_origin, "",
+              "If set, e.g. to https://backup.example.com, the uploads which "
+              "have not completed --http_hedge_delay_ms after the file is "
+              "closed, or which failed, are also sent to the same path on "
+              "this origin. The first successful upload cancels the other.");
+DEFINE_int32(http_hedge_delay_ms, 2000,
+             "Delay after a file is closed before its upload is hedged to "
+             "--http_hedge_origin.");
+DEFINE_string(http_upload_digest, "",
+              "If set, the digest of every HTTP upload is computed while the "
+              "data is written and sent in a trailer of the chunked PUT "
+              "request, so the origin can verify the upload without the "
+              "segment being read again: 'md5' sends a Content-MD5 trailer "
+              "and 'sha256' a Digest trailer (RFC 3230). Requires libcurl "
+              "7.64.0 or later.");
+DEFINE_bool(http_warm_up_connections, false,
+            "If enabled, a connection to the server of the next segment of "
+            "a live output is opened in the background, with an OPTIONS "
+            "request, when a segment is closed and no connection to the "
+            "server is idle, so that the next upload does not wait for the "
+            "TCP and TLS handshakes.");
+DEFINE_int32(http_input_parallel_requests, 4,
+             "Number of HTTP range requests sent in parallel to read ahead "
+             "of the read position of http:// and https:// inputs.");
+DEFINE_uint64(http_input_block_size, 4 << 20,
+              "Size, in bytes, of the HTTP range requests reading http:// "
+              "and https:// inputs.");
 DECLARE_uint64(io_cache_size);
+DECLARE_uint64(io_cache_max_size);
+DECLARE_int32(io_threads);
 
 namespace shaka {
 
@@ -48,20 +100,366 @@ size_t AppendToString(char* ptr,
   return total_size;
 }
 
+// Reads the data of an upload from a ReplayBuffer.
+struct ReplayReader {
+  ReplayBuffer* buffer;
+  uint64_t position;
+  base::WaitableEvent* cancel_event;
+};
+
+size_t ReplayReadCallback(char* buffer,
+                          size_t size,
+                          size_t nitems,
+                          void* stream) {
+  ReplayReader* reader = static_cast<ReplayReader*>(stream);
+  if (reader->cancel_event->IsSignaled())
+    return CURL_READFUNC_ABORT;
+  const uint64_t length =
+      reader->buffer->Read(reader->position, buffer, size * nitems);
+  reader->position += length;
+  return length;
+}
+
+// Returns the trailer sent with |data|, an HttpFile, at the end of an upload.
+int DigestTrailerCallback(struct curl_slist** trailers, void* data) {
+  const std::string& trailer = static_cast<HttpFile*>(data)->digest_trailer();
+  if (!trailer.empty())
+    *trailers = curl_slist_append(*trailers, trailer.c_str());
+  return 0;  // CURL_TRAILERFUNC_OK.
+}
+
+// Aborts the transfer when |data|, a WaitableEvent, is signaled.
+int CancelProgressCallback(void* data,
+                           curl_off_t download_total,
+                           curl_off_t download_now,
+                           curl_off_t upload_total,
+                           curl_off_t upload_now) {
+  return static_cast<base::WaitableEvent*>(data)->IsSignaled() ? 1 : 0;
+}
+
 }  // namespace
 
-class LibCurlInitializer {
+#if LIBCURL_VERSION_NUM >= 0x074400
+// Drives the multiplexed uploads of all HttpFile instances with a curl multi
+// handle from a single event loop thread. The uploads to the same origin
+// share one HTTP/2 connection when the server supports it.
+class CurlMultiUploader {
  public:
-  LibCurlInitializer() {
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+  typedef base::Callback<void(CURLcode)> DoneCallback;
+
+  // Leaked on purpose: the event loop runs until the process exits.
+  static CurlMultiUploader* Instance() {
+    static CurlMultiUploader* instance = new CurlMultiUploader;
+    return instance;
+  }
+
+  /// Start the transfer of |curl|. |done_cb| is called on the event loop
+  /// thread when it completes.
+  void Add(CURL* curl, const DoneCallback& done_cb) {
+    {
+      base::AutoLock auto_lock(lock_);
+      pending_transfers_[curl] = done_cb;
+    }
+    curl_multi_wakeup(multi_);
   }
 
-  ~LibCurlInitializer() {
-    curl_global_cleanup();
+  /// Resume the transfer of |curl|, which may have been paused by its read
+  /// callback because there was no data to send.
+  void Resume(CURL* curl) {
+    {
+      base::AutoLock auto_lock(lock_);
+      pending_resumes_.insert(curl);
+    }
+    curl_multi_wakeup(multi_);
   }
 
  private:
-  DISALLOW_COPY_AND_ASSIGN(LibCurlInitializer);
+  CurlMultiUploader() : multi_(curl_multi_init()) {
+    CHECK(multi_) << "curl_multi_init() failed.";
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&CurlMultiUploader::Run, base::Unretained(this)),
+        true  // task_is_slow
+    );
+  }
+
+  void Run() {
+    const int kPollTimeoutMs = 1000;
+    while (true) {
+      {
+        base::AutoLock auto_lock(lock_);
+        for (auto& transfer : pending_transfers_) {
+          curl_multi_add_handle(multi_, transfer.first);
+          transfers_[transfer.first] = transfer.second;
+        }
+        pending_transfers_.clear();
+        for (CURL* curl : pending_resumes_) {
+          // The transfer may have completed already.
+          if (transfers_.find(curl) != transfers_.end())
+            curl_easy_pause(curl, CURLPAUSE_CONT);
+        }
+        pending_resumes_.clear();
+      }
+
+      int running_transfers = 0;
+      curl_multi_perform(multi_, &running_transfers);
+
+      int messages_left = 0;
+      while (CURLMsg* message = curl_multi_info_read(multi_, &messages_left)) {
+        if (message->msg != CURLMSG_DONE)
+          continue;
+        CURL* curl = message->easy_handle;
+        const CURLcode result = message->data.result;
+        curl_multi_remove_handle(multi_, curl);
+        DoneCallback done_cb;
+        {
+          base::AutoLock auto_lock(lock_);
+          auto iter = transfers_.find(curl);
+          DCHECK(iter != transfers_.end());
+          done_cb = iter->second;
+          transfers_.erase(iter);
+        }
+        // |curl| may be reused for a new transfer once |done_cb| runs.
+        done_cb.Run(result);
+      }
+
+      curl_multi_poll(multi_, nullptr, 0, kPollTimeoutMs, nullptr);
+    }
+  }
+
+  CURLM* multi_;
+
+  base::Lock lock_;
+  // Transfers to be added to, and resumed in, |multi_| by the event loop.
+  std::map<CURL*, DoneCallback> pending_transfers_;
+  std::set<CURL*> pending_resumes_;
+  // Transfers in |multi_|.
+  std::map<CURL*, DoneCallback> transfers_;
+
+  DISALLOW_COPY_AND_ASSIGN(CurlMultiUploader);
+};
+#endif  // LIBCURL_VERSION_NUM >= 0x074400
+
+// Computes the digest of an upload incrementally, as the data is written.
+class HttpFile::UploadDigest {
+ public:
+  // Returns nullptr if |algorithm| is not supported.
+  static std::unique_ptr<UploadDigest> Create(const std::string& algorithm) {
+    if (algorithm == "md5")
+      return std::unique_ptr<UploadDigest>(
+          new UploadDigest(EVP_md5(), "Content-MD5: "));
+    if (algorithm == "sha256")
+      return std::unique_ptr<UploadDigest>(
+          new UploadDigest(EVP_sha256(), "Digest: sha-256="));
+    return nullptr;
+  }
+
+  ~UploadDigest() { EVP_MD_CTX_free(context_); }
+
+  void Update(const void* data, size_t size) {
+    EVP_DigestUpdate(context_, data, size);
+  }
+
+  // Returns the trailer with the digest of the data.
+  std::string Finish() {
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    EVP_DigestFinal_ex(context_, digest, &digest_size);
+    std::string encoded_digest;
+    base::Base64Encode(
+        std::string(reinterpret_cast<const char*>(digest), digest_size),
+        &encoded_digest);
+    return trailer_prefix_ + encoded_digest;
+  }
+
+  // The name of the trailer, announced in the Trailer header.
+  std::string name() const {
+    return trailer_prefix_.substr(0, trailer_prefix_.find(':'));
+  }
+
+ private:
+  UploadDigest(const EVP_MD* md, const std::string& trailer_prefix)
+      : context_(EVP_MD_CTX_new()), trailer_prefix_(trailer_prefix) {
+    EVP_DigestInit_ex(context_, md, nullptr);
+  }
+
+  UploadDigest(const UploadDigest&) = delete;
+  UploadDigest& operator=(const UploadDigest&) = delete;
+
+  EVP_MD_CTX* const context_;
+  const std::string trailer_prefix_;
+};
+
+// Reads a resource of known size with range requests of
+// --http_input_block_size bytes. Up to --http_input_parallel_requests
+// requests are sent in parallel, for the blocks ahead of the read position.
+class HttpFile::RangeReader {
+ public:
+  RangeReader(HttpFile* file, uint64_t size)
+      : file_(file),
+        size_(size),
+        block_size_(std::max<uint64_t>(1, FLAGS_http_input_block_size)),
+        max_fetches_running_(
+            std::max(1, FLAGS_http_input_parallel_requests)),
+        cancel_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                      base::WaitableEvent::InitialState::NOT_SIGNALED),
+        block_fetched_(&lock_) {}
+
+  ~RangeReader() {
+    Cancel();
+    base::AutoLock auto_lock(lock_);
+    while (num_fetches_running_ > 0)
+      block_fetched_.Wait();
+  }
+
+  uint64_t size() const { return size_; }
+  uint64_t position() const { return position_; }
+
+  int64_t Read(void* buffer, uint64_t length) {
+    uint8_t* data = static_cast<uint8_t*>(buffer);
+    length = std::min(length, size_ - std::min(size_, position_));
+    uint64_t bytes_read = 0;
+    base::AutoLock auto_lock(lock_);
+    while (bytes_read < length) {
+      const uint64_t block_index = position_ / block_size_;
+      std::shared_ptr<Block> block = FindOrFetchBlock(block_index);
+      while (!block->done)
+        block_fetched_.Wait();
+      if (block->failed)
+        return bytes_read > 0 ? static_cast<int64_t>(bytes_read) : -1;
+
+      const uint64_t block_offset = position_ - block_index * block_size_;
+      const uint64_t bytes_to_copy =
+          std::min(length - bytes_read, block->data.size() - block_offset);
+      memcpy(data + bytes_read, block->data.data() + block_offset,
+             bytes_to_copy);
+      bytes_read += bytes_to_copy;
+      position_ += bytes_to_copy;
+    }
+    return bytes_read;
+  }
+
+  void Seek(uint64_t position) {
+    base::AutoLock auto_lock(lock_);
+    position_ = position;
+  }
+
+  // Aborts the requests running and fails the following reads.
+  void Cancel() { cancel_event_.Signal(); }
+
+ private:
+  struct Block {
+    std::string data;
+    bool done = false;
+    bool failed = false;
+  };
+
+  // Returns the block |block_index|, requesting it if needed, and requests
+  // the blocks following it. The blocks before it are not needed anymore.
+  std::shared_ptr<Block> FindOrFetchBlock(uint64_t block_index) {
+    lock_.AssertAcquired();
+    blocks_.erase(blocks_.begin(), blocks_.lower_bound(block_index));
+    if (blocks_.find(block_index) == blocks_.end()) {
+      // Seeked out of the blocks read ahead.
+      blocks_.clear();
+      next_block_to_fetch_ = block_index;
+    }
+    const uint64_t num_blocks = (size_ + block_size_ - 1) / block_size_;
+    // Keep a window of blocks ahead, which can be fetched while the data
+    // fetched last is read.
+    const uint64_t window_end = std::min<uint64_t>(
+        num_blocks, block_index + 2 * max_fetches_running_);
+    while (next_block_to_fetch_ < window_end &&
+           num_fetches_running_ < max_fetches_running_) {
+      std::shared_ptr<Block> block = std::make_shared<Block>();
+      blocks_[next_block_to_fetch_] = block;
+      ++num_fetches_running_;
+      base::WorkerPool::PostTask(
+          FROM_HERE,
+          base::Bind(&RangeReader::FetchBlock, base::Unretained(this),
+                     next_block_to_fetch_, block),
+          true  // task_is_slow
+      );
+      ++next_block_to_fetch_;
+    }
+    // The fetches for the blocks read ahead before a seek may still hold all
+    // the slots.
+    auto iter = blocks_.find(block_index);
+    if (iter == blocks_.end()) {
+      std::shared_ptr<Block> block = std::make_shared<Block>();
+      iter = blocks_.emplace(block_index, block).first;
+      ++num_fetches_running_;
+      base::WorkerPool::PostTask(
+          FROM_HERE,
+          base::Bind(&RangeReader::FetchBlock, base::Unretained(this),
+                     block_index, block),
+          true  // task_is_slow
+      );
+      next_block_to_fetch_ = block_index + 1;
+    }
+    return iter->second;
+  }
+
+  void FetchBlock(uint64_t block_index, std::shared_ptr<Block> block) {
+    const uint64_t begin = block_index * block_size_;
+    const uint64_t end = std::min(size_, begin + block_size_);
+    const std::string& url = file_->resource_url();
+    std::string data;
+    bool succeeded = false;
+    ScopedCurl curl =
+        CurlHandlePool::Instance()->Acquire(file_->connection_key_);
+    if (!curl) {
+      LOG(ERROR) << "curl_easy_init() failed.";
+    } else {
+      VLOG(2) << "Reading " << url << ", range " << begin << "-" << end - 1;
+      file_->SetupRequestBase(curl.get(), GET, url, &data);
+      const std::string range =
+          base::Uint64ToString(begin) + "-" + base::Uint64ToString(end - 1);
+      curl_easy_setopt(curl.get(), CURLOPT_RANGE, range.c_str());
+      curl_easy_setopt(curl.get(), CURLOPT_XFERINFOFUNCTION,
+                       CancelProgressCallback);
+      curl_easy_setopt(curl.get(), CURLOPT_XFERINFODATA, &cancel_event_);
+      curl_easy_setopt(curl.get(), CURLOPT_NOPROGRESS, 0L);
+      const CURLcode res = curl_easy_perform(curl.get());
+      if (!cancel_event_.IsSignaled() &&
+          file_->CheckResult(curl.get(), GET, url, res).ok()) {
+        // A server without range support returns the whole resource.
+        if (data.size() == size_ && size_ != end - begin)
+          data = data.substr(begin, end - begin);
+        succeeded = data.size() == end - begin;
+        LOG_IF(ERROR, !succeeded)
+            << "Unexpected size " << data.size() << " of the range " << begin
+            << "-" << end - 1 << " of " << url << ".";
+      }
+      CurlHandlePool::Instance()->Release(file_->connection_key_,
+                                          std::move(curl));
+    }
+
+    base::AutoLock auto_lock(lock_);
+    block->data.swap(data);
+    block->done = true;
+    block->failed = !succeeded;
+    --num_fetches_running_;
+    block_fetched_.Broadcast();
+  }
+
+  HttpFile* const file_;
+  const uint64_t size_;
+  const uint64_t block_size_;
+  const int max_fetches_running_;
+  // Signaled when the file is closed or aborted.
+  base::WaitableEvent cancel_event_;
+
+  base::Lock lock_;
+  base::ConditionVariable block_fetched_;
+  uint64_t position_ = 0;
+  // Block index -> block, fetched or being fetched.
+  std::map<uint64_t, std::shared_ptr<Block>> blocks_;
+  uint64_t next_block_to_fetch_ = 0;
+  int num_fetches_running_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(RangeReader);
 };
 
 /// Create a HTTP/HTTPS client
@@ -74,19 +472,26 @@ HttpFile::HttpFile(const char* file_name, const char* mode, bool https)
       cert_private_key_file_(FLAGS_https_cert_private_key_file),
       cert_private_key_pass_(FLAGS_https_cert_private_key_password),
       timeout_in_seconds_(0),
-      cache_(FLAGS_io_cache_size),
-      scoped_curl(curl_easy_init(), &curl_easy_cleanup),
+      cache_(FLAGS_io_cache_size, FLAGS_io_cache_max_size),
+      scoped_curl(nullptr, &curl_easy_cleanup),
       task_exit_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                       base::WaitableEvent::InitialState::NOT_SIGNALED) {
+                       base::WaitableEvent::InitialState::NOT_SIGNALED),
+      upload_succeeded_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED),
+      upload_finished_(&upload_lock_) {
   if (https) {
     resource_url_ = "https://" + std::string(file_name);
   } else {
     resource_url_ = "http://" + std::string(file_name);
   }
 
-  static LibCurlInitializer lib_curl_initializer;
-
   // Setup libcurl scope
+  connection_key_ = GetConnectionKey(resource_url_);
+  if (!FLAGS_http_hedge_origin.empty()) {
+    hedge_url_ = FLAGS_http_hedge_origin +
+                 resource_url_.substr(connection_key_.size());
+  }
+  scoped_curl = CurlHandlePool::Instance()->Acquire(connection_key_);
   if (!scoped_curl.get()) {
     LOG(ERROR) << "curl_easy_init() failed.";
     // return Status(error::HTTP_FAILURE, "curl_easy_init() failed.");
@@ -99,19 +504,107 @@ HttpFile::HttpFile(const char* file_name, const char* mode)
 {}
 
 // Destructor
-HttpFile::~HttpFile() {}
+HttpFile::~HttpFile() {
+  // Keep the connection open for the next request to the same host.
+  if (scoped_curl)
+    CurlHandlePool::Instance()->Release(connection_key_,
+                                        std::move(scoped_curl));
+}
+
+// static
+void HttpFile::WarmUpConnection(const char* file_name, bool https) {
+  if (!FLAGS_http_warm_up_connections)
+    return;
+  const std::string url =
+      std::string(https ? "https://" : "http://") + file_name;
+  if (!CurlHandlePool::Instance()->StartWarmUp(GetConnectionKey(url)))
+    return;
+  // Deleted by WarmUp(), which releases the connection to the pool.
+  HttpFile* file = new HttpFile(file_name, "w", https);
+  base::WorkerPool::PostTask(
+      FROM_HERE, base::Bind(&HttpFile::WarmUp, base::Unretained(file)),
+      true  // task_is_slow
+  );
+}
+
+void HttpFile::WarmUp() {
+  VLOG(1) << "Warming up connection to " << connection_key_;
+  std::string response;
+  SetupRequestBase(scoped_curl.get(), GET, resource_url(), &response);
+  // OPTIONS does not change the resource. The response, e.g. 405 Method Not
+  // Allowed, does not matter, only the connection opened.
+  curl_easy_setopt(scoped_curl.get(), CURLOPT_CUSTOMREQUEST, "OPTIONS");
+  curl_easy_setopt(scoped_curl.get(), CURLOPT_FAILONERROR, 0L);
+  const CURLcode res = curl_easy_perform(scoped_curl.get());
+  LOG_IF(WARNING, res != CURLE_OK)
+      << "Failed to warm up connection to " << connection_key_ << ": "
+      << curl_easy_strerror(res);
+  delete this;
+}
 
 bool HttpFile::Open() {
 
   VLOG(1) << "Opening " << resource_url() << " with file mode \"" << file_mode_ << "\".";
 
-  // Ignore read requests as they would truncate the target
-  // file by propagating as zero-length PUT requests.
+  // Read requests must not be propagated as zero-length PUT requests, which
+  // would truncate the target file.
   // See also https://github.com/google/shaka-packager/issues/149#issuecomment-437203701
   if (file_mode_ == "r") {
-    VLOG(1) << "HttpFile only supports write mode, skipping further operations";
     task_exit_event_.Signal();
-    return false;
+    return OpenForReading();
+  }
+
+  if (!FLAGS_http_upload_digest.empty()) {
+    upload_digest_ = UploadDigest::Create(FLAGS_http_upload_digest);
+    if (!upload_digest_) {
+      LOG(ERROR) << "Unsupported --http_upload_digest "
+                 << FLAGS_http_upload_digest << ".";
+      task_exit_event_.Signal();
+      return false;
+    }
+#if LIBCURL_VERSION_NUM < 0x074000
+    LOG(WARNING) << "--http_upload_digest requires libcurl 7.64.0 or later.";
+    upload_digest_.reset();
+#endif
+  }
+
+  const bool replay_upload =
+      FLAGS_http_upload_max_retries > 0 || !hedge_url_.empty();
+  // With --io_threads, the uploads which do not need a worker thread for
+  // their retries share the event loop too.
+  if (FLAGS_http2_multiplexed_upload ||
+      (FLAGS_io_threads > 0 && !replay_upload)) {
+#if LIBCURL_VERSION_NUM >= 0x074400
+    LOG_IF(WARNING, replay_upload)
+        << "Failed uploads are not retried nor hedged with "
+           "--http2_multiplexed_upload.";
+    multiplexed_ = true;
+    SetupRequestBase(scoped_curl.get(), PUT, resource_url(), &response_body_);
+    SetupRequestData(scoped_curl.get(), std::string());
+    curl_easy_setopt(scoped_curl.get(), CURLOPT_READFUNCTION,
+                     MultiplexedReadCallback);
+    curl_easy_setopt(scoped_curl.get(), CURLOPT_READDATA, this);
+    if (FLAGS_http2_multiplexed_upload) {
+      curl_easy_setopt(scoped_curl.get(), CURLOPT_HTTP_VERSION,
+                       CURL_HTTP_VERSION_2TLS);
+      // Wait for an existing connection to the origin to multiplex on
+      // instead of opening a new one.
+      curl_easy_setopt(scoped_curl.get(), CURLOPT_PIPEWAIT, 1L);
+    }
+    CurlMultiUploader::Instance()->Add(
+        scoped_curl.get(),
+        base::Bind(&HttpFile::OnMultiplexedUploadDone, base::Unretained(this)));
+    return true;
+#else
+    LOG(WARNING) << "The shared upload event loop requires libcurl 7.68.0 "
+                    "or later. Uploading " << resource_url()
+                 << " on its own connection.";
+#endif
+  }
+
+  if (replay_upload) {
+    replay_buffer_.reset(new ReplayBuffer);
+    num_uploads_running_ = 1;
   }
 
   // Run progressive upload in separate thread.
@@ -123,23 +616,203 @@ bool HttpFile::Open() {
   return true;
 }
 
+bool HttpFile::OpenForReading() {
+  // Request the size of the resource, which is needed to seek, e.g. to a
+  // trailing 'moov' box.
+  SetupRequestBase(scoped_curl.get(), GET, resource_url(), &response_body_);
+  curl_easy_setopt(scoped_curl.get(), CURLOPT_NOBODY, 1L);
+  const CURLcode res = curl_easy_perform(scoped_curl.get());
+  if (!CheckResult(scoped_curl.get(), GET, resource_url(), res).ok())
+    return false;
+  curl_off_t content_length = -1;
+  curl_easy_getinfo(scoped_curl.get(), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                    &content_length);
+  if (content_length < 0) {
+    // E.g. a live stream, such as low latency CMAF, sent with chunked transfer
+    // encoding. It is parsed as it arrives instead of in blocks.
+    VLOG(1) << "Streaming " << resource_url() << " of unknown size.";
+    streaming_read_ = true;
+    // Signaled once the request completes.
+    task_exit_event_.Reset();
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&HttpFile::CurlStreamingGet, base::Unretained(this)),
+        true  // task_is_slow
+    );
+    return true;
+  }
+  VLOG(1) << "Reading " << resource_url() << ", size " << content_length;
+  range_reader_.reset(new RangeReader(this, content_length));
+  return true;
+}
+
+void HttpFile::CurlStreamingGet() {
+  std::string unused_response;
+  SetupRequestBase(scoped_curl.get(), GET, resource_url(), &unused_response);
+  curl_easy_setopt(scoped_curl.get(), CURLOPT_WRITEFUNCTION,
+                   StreamingWriteCallback);
+  curl_easy_setopt(scoped_curl.get(), CURLOPT_WRITEDATA, this);
+  const CURLcode res = curl_easy_perform(scoped_curl.get());
+  // The request is aborted by Close() or Abort() closing the cache.
+  if (!(res == CURLE_WRITE_ERROR && cache_.closed()) &&
+      !CheckResult(scoped_curl.get(), GET, resource_url(), res).ok()) {
+    streaming_read_failed_.store(true);
+  }
+  // Read() returns the rest of the data, then the end of the stream.
+  cache_.Close();
+  task_exit_event_.Signal();
+}
+
+// static
+size_t HttpFile::StreamingWriteCallback(char* buffer,
+                                        size_t size,
+                                        size_t nitems,
+                                        void* stream) {
+  HttpFile* file = static_cast<HttpFile*>(stream);
+  // Blocks while the cache is full, until it is read or closed. Returning
+  // less than the size received aborts the request.
+  return file->cache_.Write(buffer, size * nitems);
+}
+
 void HttpFile::CurlPut() {
+  if (replay_buffer_) {
+    OnUploadFinished(UploadWithRetries(scoped_curl.get(), resource_url()));
+    return;
+  }
   // Setup libcurl handle with HTTP PUT upload transfer mode.
   std::string request_body;
   Request(PUT, resource_url(), request_body, &response_body_);
 }
 
+void HttpFile::HedgedPut() {
+  const std::string connection_key = GetConnectionKey(hedge_url_);
+  ScopedCurl curl = CurlHandlePool::Instance()->Acquire(connection_key);
+  if (!curl) {
+    OnUploadFinished(Status(error::HTTP_FAILURE, "curl_easy_init() failed."));
+    return;
+  }
+  const Status status = UploadWithRetries(curl.get(), hedge_url_);
+  CurlHandlePool::Instance()->Release(connection_key, std::move(curl));
+  OnUploadFinished(status);
+}
+
+Status HttpFile::UploadWithRetries(CURL* curl, const std::string& url) {
+  base::TimeDelta backoff =
+      base::TimeDelta::FromMilliseconds(FLAGS_http_upload_retry_backoff_ms);
+  for (int attempt = 0;; ++attempt) {
+    VLOG(1) << "Uploading " << url << ", attempt " << attempt + 1;
+    std::string response;
+    SetupRequestBase(curl, PUT, url, &response);
+    SetupRequestData(curl, std::string());
+    // Read from the beginning of the retained data.
+    ReplayReader reader = {replay_buffer_.get(), 0, &upload_succeeded_event_};
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, ReplayReadCallback);
+    curl_easy_setopt(curl, CURLOPT_READDATA, &reader);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, CancelProgressCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &upload_succeeded_event_);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    const CURLcode res = curl_easy_perform(curl);
+    if (upload_succeeded_event_.IsSignaled()) {
+      VLOG(1) << "Upload to " << url << " is not needed anymore.";
+      return Status::OK;
+    }
+    const Status status = CheckResult(curl, PUT, url, res);
+    if (status.ok() || attempt >= FLAGS_http_upload_max_retries)
+      return status;
+
+    LOG(WARNING) << "Retrying upload to " << url << " in "
+                 << backoff.InMilliseconds() << " ms.";
+    // Stop waiting early if the other upload of the file succeeds.
+    if (upload_succeeded_event_.TimedWait(backoff))
+      return Status::OK;
+    backoff *= 2;
+  }
+}
+
+void HttpFile::OnUploadFinished(const Status& status) {
+  base::AutoLock auto_lock(upload_lock_);
+  if (status.ok())
+    upload_succeeded_event_.Signal();
+  --num_uploads_running_;
+  upload_finished_.Signal();
+}
+
+bool HttpFile::CloseReplayedUpload() {
+  // The trailer is read by libcurl once the end of the data is reached.
+  if (upload_digest_)
+    digest_trailer_ = upload_digest_->Finish();
+  replay_buffer_->Close();
+
+  base::AutoLock auto_lock(upload_lock_);
+  if (!hedge_url_.empty()) {
+    const base::TimeTicks hedge_time =
+        base::TimeTicks::Now() +
+        base::TimeDelta::FromMilliseconds(FLAGS_http_hedge_delay_ms);
+    while (num_uploads_running_ > 0 && !upload_succeeded_event_.IsSignaled()) {
+      const base::TimeDelta delay = hedge_time - base::TimeTicks::Now();
+      if (delay <= base::TimeDelta())
+        break;
+      upload_finished_.TimedWait(delay);
+    }
+    // The upload to the primary origin is slow or failed.
+    if (!upload_succeeded_event_.IsSignaled()) {
+      LOG(WARNING) << "Hedging upload of " << resource_url() << " to "
+                   << hedge_url_;
+      ++num_uploads_running_;
+      base::WorkerPool::PostTask(
+          FROM_HERE, base::Bind(&HttpFile::HedgedPut, base::Unretained(this)),
+          true  // task_is_slow
+      );
+    }
+  }
+  while (num_uploads_running_ > 0)
+    upload_finished_.Wait();
+  return upload_succeeded_event_.IsSignaled();
+}
+
 bool HttpFile::Close() {
   VLOG(1) << "Closing " << resource_url() << ".";
+  if (range_reader_) {
+    range_reader_.reset();
+    delete this;
+    return true;
+  }
+  if (streaming_read_) {
+    cache_.Close();
+    task_exit_event_.Wait();
+    delete this;
+    return true;
+  }
+  if (replay_buffer_) {
+    const bool result = CloseReplayedUpload();
+    delete this;
+    return result;
+  }
+  if (upload_digest_)
+    digest_trailer_ = upload_digest_->Finish();
   cache_.Close();
+  ResumeMultiplexedUpload();
   task_exit_event_.Wait();
   delete this;
   return true;
 }
 
 int64_t HttpFile::Read(void* buffer, uint64_t length) {
-  LOG(WARNING) << "HttpFile does not support Read().";
-  return -1;
+  if (streaming_read_) {
+    // Returns the data received so far, up to |length|, without waiting for
+    // more.
+    const uint64_t bytes_read = cache_.Read(buffer, length);
+    if (bytes_read == 0 && streaming_read_failed_.load())
+      return -1;
+    streaming_read_position_ += bytes_read;
+    return bytes_read;
+  }
+  if (!range_reader_) {
+    LOG(WARNING) << "HttpFile does not support Read() in write mode.";
+    return -1;
+  }
+  return range_reader_->Read(buffer, length);
 }
 
 int64_t HttpFile::Write(const void* buffer, uint64_t length) {
@@ -147,12 +820,18 @@ int64_t HttpFile::Write(const void* buffer, uint64_t length) {
 
   VLOG(2) << "Writing to " << url << ", length=" << length;
 
-  // TODO: Implement retrying with exponential backoff, see
-  // "widevine_key_source.cc"
   Status status;
 
+  if (upload_digest_)
+    upload_digest_->Update(buffer, length);
+
+  if (replay_buffer_)
+    return replay_buffer_->Write(buffer, length);
+
   uint64_t bytes_written = cache_.Write(buffer, length);
   VLOG(3) << "PUT CHUNK bytes_written: " << bytes_written;
+  if (read_paused_.exchange(false))
+    ResumeMultiplexedUpload();
   return bytes_written;
 
   // Debugging based on response status
@@ -173,23 +852,56 @@ int64_t HttpFile::Write(const void* buffer, uint64_t length) {
 }
 
 int64_t HttpFile::Size() {
-  VLOG(1) << "HttpFile does not support Size().";
-  return -1;
+  if (streaming_read_)
+    return -1;
+  if (!range_reader_) {
+    VLOG(1) << "HttpFile does not support Size() in write mode.";
+    return -1;
+  }
+  return range_reader_->size();
 }
 
 bool HttpFile::Flush() {
-  // Do nothing on Flush.
+  // The data is uploaded progressively with chunked transfer encoding. Wait
+  // until the data written so far has been passed on to libcurl, e.g. for a
+  // low latency chunk to be sent without waiting for the rest of the file.
+  // The data in |replay_buffer_| can be read by libcurl right away.
+  if (!replay_buffer_)
+    cache_.WaitUntilEmptyOrClosed();
   return true;
 }
 
 bool HttpFile::Seek(uint64_t position) {
-  VLOG(1) << "HttpFile does not support Seek().";
-  return false;
+  if (streaming_read_) {
+    VLOG(1) << "HttpFile does not support Seek() on a stream of unknown size.";
+    return false;
+  }
+  if (!range_reader_) {
+    VLOG(1) << "HttpFile does not support Seek() in write mode.";
+    return false;
+  }
+  range_reader_->Seek(position);
+  return true;
 }
 
 bool HttpFile::Tell(uint64_t* position) {
-  VLOG(1) << "HttpFile does not support Tell().";
-  return false;
+  if (streaming_read_) {
+    *position = streaming_read_position_;
+    return true;
+  }
+  if (!range_reader_) {
+    VLOG(1) << "HttpFile does not support Tell() in write mode.";
+    return false;
+  }
+  *position = range_reader_->position();
+  return true;
+}
+
+void HttpFile::Abort() {
+  if (range_reader_)
+    range_reader_->Cancel();
+  if (streaming_read_)
+    cache_.Close();
 }
 
 // Perform HTTP request
@@ -204,14 +916,42 @@ Status HttpFile::Request(HttpMethod http_method,
   VLOG(1) << "Sending request to URL " << url;
 
   // Setup HTTP method and libcurl options
-  SetupRequestBase(http_method, url, response);
+  SetupRequestBase(scoped_curl.get(), http_method, url, response);
 
   // Setup HTTP request headers and body
-  SetupRequestData(data);
+  SetupRequestData(scoped_curl.get(), data);
 
   // Perform HTTP request
   CURLcode res = curl_easy_perform(scoped_curl.get());
+  Status status = CheckResult(scoped_curl.get(), http_method, url, res);
+  // Unblock Write() and Flush() if the upload failed.
+  cache_.Close();
+
+  // Signal task completion
+  task_exit_event_.Signal();
+
+  // Return request status to caller
+  return status;
+}
+
+void HttpFile::OnMultiplexedUploadDone(CURLcode res) {
+  CheckResult(scoped_curl.get(), PUT, resource_url(), res);
+  // Unblock Write() and Flush() if the upload failed.
+  cache_.Close();
+  task_exit_event_.Signal();
+}
+
+void HttpFile::ResumeMultiplexedUpload() {
+#if LIBCURL_VERSION_NUM >= 0x074400
+  if (multiplexed_)
+    CurlMultiUploader::Instance()->Resume(scoped_curl.get());
+#endif
+}
 
+Status HttpFile::CheckResult(CURL* curl,
+                             HttpMethod http_method,
+                             const std::string& url,
+                             CURLcode res) {
   // Assume successful request
   Status status = Status::OK;
 
@@ -223,7 +963,7 @@ Status HttpFile::Request(HttpMethod http_method,
         url.c_str(), curl_easy_strerror(res));
     if (res == CURLE_HTTP_RETURNED_ERROR) {
       long response_code = 0;
-      curl_easy_getinfo(scoped_curl.get(), CURLINFO_RESPONSE_CODE, &response_code);
+      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
       error_message +=
           base::StringPrintf(" Response code: %ld.", response_code);
     }
@@ -236,16 +976,12 @@ Status HttpFile::Request(HttpMethod http_method,
         res == CURLE_OPERATION_TIMEDOUT ? error::TIME_OUT : error::HTTP_FAILURE,
         error_message);
   }
-
-  // Signal task completion
-  task_exit_event_.Signal();
-
-  // Return request status to caller
   return status;
 }
 
 // Configure curl_ handle with reasonable defaults
-void HttpFile::SetupRequestBase(HttpMethod http_method,
+void HttpFile::SetupRequestBase(CURL* curl,
+                                HttpMethod http_method,
                                 const std::string& url,
                                 std::string* response) {
   response->clear();
@@ -253,56 +989,58 @@ void HttpFile::SetupRequestBase(HttpMethod http_method,
   // Configure HTTP request method/verb
   switch (http_method) {
     case GET:
-      curl_easy_setopt(scoped_curl.get(), CURLOPT_HTTPGET, 1L);
+      curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
       break;
     case POST:
-      curl_easy_setopt(scoped_curl.get(), CURLOPT_POST, 1L);
+      curl_easy_setopt(curl, CURLOPT_POST, 1L);
       break;
     case PUT:
-      curl_easy_setopt(scoped_curl.get(), CURLOPT_PUT, 1L);
+      curl_easy_setopt(curl, CURLOPT_PUT, 1L);
       break;
     case PATCH:
-      curl_easy_setopt(scoped_curl.get(), CURLOPT_CUSTOMREQUEST, "PATCH");
+      curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
       break;
   }
 
   // Configure HTTP request
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
   if (user_agent_.empty()) {
-    curl_easy_setopt(scoped_curl.get(), CURLOPT_USERAGENT, kUserAgentString);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgentString);
   } else {
-    curl_easy_setopt(scoped_curl.get(), CURLOPT_USERAGENT, user_agent_.data());
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent_.data());
   }
 
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_TIMEOUT, timeout_in_seconds_);
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_FAILONERROR, 1L);
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_WRITEFUNCTION, AppendToString);
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_WRITEDATA, response);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_in_seconds_);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  // Keep the idle pooled connections alive between requests.
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
 
   // HTTPS
   if (!cert_private_key_file_.empty() && !cert_file_.empty()) {
-    curl_easy_setopt(scoped_curl.get(), CURLOPT_SSLKEY,
+    curl_easy_setopt(curl, CURLOPT_SSLKEY,
                      cert_private_key_file_.data());
 
     if (!cert_private_key_pass_.empty()) {
-      curl_easy_setopt(scoped_curl.get(), CURLOPT_KEYPASSWD,
+      curl_easy_setopt(curl, CURLOPT_KEYPASSWD,
                        cert_private_key_pass_.data());
     }
 
-    curl_easy_setopt(scoped_curl.get(), CURLOPT_SSLKEYTYPE, "PEM");
-    curl_easy_setopt(scoped_curl.get(), CURLOPT_SSLCERTTYPE, "PEM");
-    curl_easy_setopt(scoped_curl.get(), CURLOPT_SSLCERT, cert_file_.data());
+    curl_easy_setopt(curl, CURLOPT_SSLKEYTYPE, "PEM");
+    curl_easy_setopt(curl, CURLOPT_SSLCERTTYPE, "PEM");
+    curl_easy_setopt(curl, CURLOPT_SSLCERT, cert_file_.data());
   }
   if (!ca_file_.empty()) {
     // Host validation needs to be off when using self-signed certificates.
-    curl_easy_setopt(scoped_curl.get(), CURLOPT_SSL_VERIFYHOST, 0L);
-    curl_easy_setopt(scoped_curl.get(), CURLOPT_CAINFO, ca_file_.data());
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_CAINFO, ca_file_.data());
   }
 
   // Propagate log level indicated by "--libcurl_verbosity" to libcurl.
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_VERBOSE, FLAGS_libcurl_verbosity);
+  curl_easy_setopt(curl, CURLOPT_VERBOSE, FLAGS_libcurl_verbosity);
 
 }
 
@@ -321,8 +1059,37 @@ size_t read_callback(char* buffer, size_t size, size_t nitems, void* stream) {
   return length;
 }
 
+// Called on the event loop thread of the multiplexed uploads, which must not
+// block waiting for data. The transfer is paused instead and resumed by the
+// next Write() or by Close().
+size_t HttpFile::MultiplexedReadCallback(char* buffer,
+                                         size_t size,
+                                         size_t nitems,
+                                         void* stream) {
+  HttpFile* file = static_cast<HttpFile*>(stream);
+  IoCache* cache = &file->cache_;
+  // Check |closed()| first: the cache is closed after the last write.
+  bool closed = cache->closed();
+  if (cache->BytesCached() == 0) {
+    if (closed)
+      return 0;
+    // Check again after publishing the pause, as Write() checks the flag
+    // after writing.
+    file->read_paused_.store(true);
+    closed = cache->closed();
+    if (cache->BytesCached() == 0) {
+      if (!closed)
+        return CURL_READFUNC_PAUSE;
+      file->read_paused_.store(false);
+      return 0;
+    }
+    file->read_paused_.store(false);
+  }
+  return cache->Read(buffer, size * nitems);
+}
+
 // Configure curl_ handle for HTTP PUT upload
-void HttpFile::SetupRequestData(const std::string& data) {
+void HttpFile::SetupRequestData(CURL* curl, const std::string& data) {
 
   // TODO: Sanity checks.
   // if (method == POST || method == PUT || method == PATCH)
@@ -336,13 +1103,24 @@ void HttpFile::SetupRequestData(const std::string& data) {
   // Don't stop on 200 OK responses.
   headers = curl_slist_append(headers, "Expect:");
 
+#if LIBCURL_VERSION_NUM >= 0x074000
+  // The handles are reused, so the trailer callback is always set.
+  if (upload_digest_) {
+    headers = curl_slist_append(
+        headers, ("Trailer: " + upload_digest_->name()).c_str());
+  }
+  curl_easy_setopt(curl, CURLOPT_TRAILERFUNCTION,
+                   upload_digest_ ? DigestTrailerCallback : nullptr);
+  curl_easy_setopt(curl, CURLOPT_TRAILERDATA, this);
+#endif
+
   // Enable progressive upload with chunked transfer encoding.
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_READFUNCTION, read_callback);
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_READDATA, &cache_);
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_UPLOAD, 1L);
+  curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
+  curl_easy_setopt(curl, CURLOPT_READDATA, &cache_);
+  curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
 
   // Add HTTP request headers.
-  curl_easy_setopt(scoped_curl.get(), CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 }
 
 // Return HTTP request method (verb) as string
@@ -8,18 +8,25 @@
 #define PACKAGER_FILE_HTTP_H_
 
 #include <curl/curl.h>
+#include <atomic>
 #include <memory>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/base/synchronization/waitable_event.h"
+#include "packager/file/curl_handle_pool.h"
 #include "packager/file/file.h"
 #include "packager/file/io_cache.h"
+#include "packager/file/replay_buffer.h"
 #include "packager/status.h"
 
 namespace shaka {
-using ScopedCurl = std::unique_ptr<CURL, decltype(&curl_easy_cleanup)>;
-
-/// HttpFile delegates write calls to HTTP PUT requests.
+/// HttpFile delegates write calls to HTTP PUT requests. In read mode, the
+/// resource is read with HTTP range requests, several of them in parallel
+/// ahead of the read position, and can be seeked. A resource of unknown size,
+/// e.g. a live stream sent with chunked transfer encoding, is read with a
+/// single request instead, and the data is returned as soon as it arrives.
 ///
 /// About how to use this, please visit the corresponding documentation [1,2].
 ///
@@ -46,11 +53,25 @@ class HttpFile : public File {
   bool Flush() override;
   bool Seek(uint64_t position) override;
   bool Tell(uint64_t* position) override;
+  void Abort() override;
   /// @}
 
+  /// Open a connection to the server of @a file_name in the background,
+  /// with --http_warm_up_connections, unless one is idle already, so that
+  /// the next upload to the server does not wait for the connection setup.
+  /// @param file_name is the url of a resource on the server, without the
+  ///        scheme.
+  /// @param https is true for an https:// url.
+  static void WarmUpConnection(const char* file_name, bool https);
+
   /// @return The full resource url
   const std::string& resource_url() const { return resource_url_; }
 
+  /// @return The trailer with the digest of the data uploaded, e.g.
+  ///         "Content-MD5: <base64 digest>", with --http_upload_digest, once
+  ///         the file is being closed. Empty otherwise.
+  const std::string& digest_trailer() const { return digest_trailer_; }
+
  protected:
   // Destructor
   ~HttpFile() override;
@@ -65,6 +86,9 @@ class HttpFile : public File {
     PATCH,
   };
 
+  class RangeReader;
+  class UploadDigest;
+
   HttpFile(const HttpFile&) = delete;
   HttpFile& operator=(const HttpFile&) = delete;
 
@@ -74,18 +98,61 @@ class HttpFile : public File {
                  const std::string& data,
                  std::string* response);
 
-  void SetupRequestBase(HttpMethod http_method,
+  void SetupRequestBase(CURL* curl,
+                        HttpMethod http_method,
                         const std::string& url,
                         std::string* response);
 
-  void SetupRequestData(const std::string& data);
+  void SetupRequestData(CURL* curl, const std::string& data);
+
+  // Check the result |res| of a request, logging and returning the error.
+  Status CheckResult(CURL* curl,
+                     HttpMethod http_method,
+                     const std::string& url,
+                     CURLcode res);
+
+  // Read mode, where the size of the resource is requested on Open() and the
+  // data is read by |range_reader_|.
+  bool OpenForReading();
+
+  // Streaming read mode, for the resources of unknown size: the data of a
+  // single GET request is received in |cache_| and returned by Read().
+  void CurlStreamingGet();
+  static size_t StreamingWriteCallback(char* buffer,
+                                       size_t size,
+                                       size_t nitems,
+                                       void* stream);
 
   void CurlPut();
 
+  // Send an OPTIONS request, which opens the connection of |scoped_curl| to
+  // the server, then delete this. Run by WarmUpConnection().
+  void WarmUp();
+
+  // Replayed upload mode (--http_upload_max_retries, --http_hedge_origin),
+  // where the data is retained in |replay_buffer_| so failed uploads can be
+  // retried and slow uploads hedged without writing the data again.
+  void HedgedPut();
+  Status UploadWithRetries(CURL* curl, const std::string& url);
+  void OnUploadFinished(const Status& status);
+  bool CloseReplayedUpload();
+
+  // Multiplexed upload mode (--http2_multiplexed_upload or --io_threads),
+  // where the request is driven by a shared event loop instead of a worker
+  // thread.
+  static size_t MultiplexedReadCallback(char* buffer,
+                                        size_t size,
+                                        size_t nitems,
+                                        void* stream);
+  void OnMultiplexedUploadDone(CURLcode res);
+  void ResumeMultiplexedUpload();
+
   std::string method_as_text(HttpMethod method);
 
   std::string file_mode_;
   std::string resource_url_;
+  // Identifies the connections which can be reused for |resource_url_|.
+  std::string connection_key_;
   std::string user_agent_;
   std::string ca_file_;
   std::string cert_file_;
@@ -96,9 +163,31 @@ class HttpFile : public File {
   IoCache cache_;
   ScopedCurl scoped_curl;
   std::string response_body_;
+  bool multiplexed_ = false;
+  // Set when the multiplexed upload is paused waiting for data.
+  std::atomic<bool> read_paused_{false};
 
   // Signaled when the "curl easy perform" task completes.
   base::WaitableEvent task_exit_event_;
+
+  // Computes the digest of the data written, with --http_upload_digest.
+  std::unique_ptr<UploadDigest> upload_digest_;
+  std::string digest_trailer_;
+
+  std::unique_ptr<RangeReader> range_reader_;
+  bool streaming_read_ = false;
+  // Set if the streaming read request failed.
+  std::atomic<bool> streaming_read_failed_{false};
+  uint64_t streaming_read_position_ = 0;
+
+  std::unique_ptr<ReplayBuffer> replay_buffer_;
+  // |resource_url_| on the hedging origin.
+  std::string hedge_url_;
+  // Signaled when an upload succeeds, which cancels the other uploads.
+  base::WaitableEvent upload_succeeded_event_;
+  base::Lock upload_lock_;
+  base::ConditionVariable upload_finished_;
+  int num_uploads_running_ = 0;
 };
 
 }  // namespace shaka
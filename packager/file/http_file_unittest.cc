@@ -1,6 +1,7 @@
 #include "packager/file/http_file.h"
 #include <gtest/gtest.h>
 #include <memory>
+#include "packager/file/curl_handle_pool.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
 
@@ -22,4 +23,51 @@ TEST_F(HttpFileTest, PutChunkedTranser) {
   writer.release()->Close();
 }
 
+// Flush() returns once the data written so far is passed on to libcurl, so
+// each low latency chunk is sent without waiting for the rest of the file.
+TEST_F(HttpFileTest, FlushChunkedTransfer) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open("http://127.0.0.1:8080/test_chunks", "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+  ASSERT_TRUE(writer->Flush());
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+  ASSERT_TRUE(writer->Flush());
+  ASSERT_TRUE(writer.release()->Close());
+}
+
+TEST_F(HttpFileTest, ReadWithRangeRequests) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open("http://127.0.0.1:8080/test_in", "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+  ASSERT_TRUE(writer.release()->Close());
+
+  std::unique_ptr<File, FileCloser> reader(
+      File::OpenWithNoBuffering("http://127.0.0.1:8080/test_in", "r"));
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(kWriteBufferSize, reader->Size());
+  ASSERT_TRUE(reader->Seek(2));
+  uint8_t read_buffer[kWriteBufferSize];
+  ASSERT_EQ(kWriteBufferSize - 2, reader->Read(read_buffer, kWriteBufferSize));
+  EXPECT_EQ(0, memcmp(kWriteBuffer + 2, read_buffer, kWriteBufferSize - 2));
+  uint64_t position = 0;
+  ASSERT_TRUE(reader->Tell(&position));
+  EXPECT_EQ(static_cast<uint64_t>(kWriteBufferSize), position);
+}
+
+// A connection is only warmed up if none is idle nor being warmed up.
+TEST_F(HttpFileTest, WarmUpOnlyWithoutIdleConnection) {
+  CurlHandlePool* pool = CurlHandlePool::Instance();
+  const std::string connection_key = "http://warm-up.test";
+  EXPECT_TRUE(pool->StartWarmUp(connection_key));
+  EXPECT_FALSE(pool->StartWarmUp(connection_key));
+  pool->Release(connection_key, pool->Acquire(connection_key));
+  EXPECT_FALSE(pool->StartWarmUp(connection_key));
+
+  ScopedCurl curl = pool->Acquire(connection_key);
+  EXPECT_TRUE(pool->StartWarmUp(connection_key));
+  pool->Release(connection_key, std::move(curl));
+}
+
 }  // namespace shaka
@@ -0,0 +1,203 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/huge_page_buffer.h"
+
+#include <gflags/gflags.h>
+#include <stdio.h>
+#if defined(OS_LINUX)
+#include <sys/mman.h>
+#endif  // defined(OS_LINUX)
+
+#include <atomic>
+#include <string>
+#include <utility>
+
+#include "packager/base/logging.h"
+#include "packager/metrics/metrics.h"
+
+namespace {
+
+bool ValueIsHugePageMode(const char* flagname, const std::string& value) {
+  if (value.empty() || value == "none" || value == "transparent" ||
+      value == "explicit") {
+    return true;
+  }
+  fprintf(stderr,
+          "ERROR: %s must be one of none, transparent or explicit.\n",
+          flagname);
+  return false;
+}
+
+}  // namespace
+
+DEFINE_string(huge_pages,
+              "none",
+              "Back the large buffers accessed sequentially, i.e. the I/O "
+              "caches, the demuxer read buffers and the sample buffer pools, "
+              "with huge pages to reduce the TLB misses at high throughput. "
+              "One of 'none', 'transparent' (madvise(MADV_HUGEPAGE)) or "
+              "'explicit' (MAP_HUGETLB, which needs reserved huge pages and "
+              "falls back to transparent huge pages). Linux only.");
+DEFINE_validator(huge_pages, &ValueIsHugePageMode);
+
+namespace shaka {
+namespace {
+
+// The bytes backed by each mode, exported as gauges.
+class HugePageStats {
+ public:
+  static HugePageStats* GetInstance() {
+    static HugePageStats instance;
+    return &instance;
+  }
+
+  void Add(HugePageMode mode, int64_t bytes) {
+    if (mode == HugePageMode::kTransparent)
+      transparent_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    else if (mode == HugePageMode::kExplicit)
+      explicit_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void AddFallback() {
+    Metrics::GetInstance()->IncrementCounter(
+        "shaka_huge_page_fallbacks",
+        "Explicit huge page allocations backed by transparent huge pages "
+        "instead, e.g. because not enough huge pages are reserved.",
+        {}, 1);
+  }
+
+ private:
+  HugePageStats() {
+    const char kHelp[] = "Bytes of the buffers backed by huge pages.";
+    Metrics::GetInstance()->AddGaugeFunction(
+        "shaka_huge_page_bytes", kHelp, {{"backing", "transparent"}}, [this]() {
+          return static_cast<double>(
+              transparent_bytes_.load(std::memory_order_relaxed));
+        });
+    Metrics::GetInstance()->AddGaugeFunction(
+        "shaka_huge_page_bytes", kHelp, {{"backing", "explicit"}}, [this]() {
+          return static_cast<double>(
+              explicit_bytes_.load(std::memory_order_relaxed));
+        });
+  }
+
+  std::atomic<int64_t> transparent_bytes_{0};
+  std::atomic<int64_t> explicit_bytes_{0};
+};
+
+size_t RoundUpToHugePage(size_t size) {
+  return (size + HugePageBuffer::kHugePageSize - 1) &
+         ~(HugePageBuffer::kHugePageSize - 1);
+}
+
+#if defined(OS_LINUX)
+// Map |mapped_size| bytes aligned on a huge page. Returns nullptr on failure.
+uint8_t* MapAligned(size_t mapped_size) {
+  const size_t size = mapped_size + HugePageBuffer::kHugePageSize;
+  void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED)
+    return nullptr;
+  uint8_t* begin = static_cast<uint8_t*>(mapping);
+  uint8_t* aligned = reinterpret_cast<uint8_t*>(RoundUpToHugePage(
+      reinterpret_cast<uintptr_t>(begin)));
+  // Unmap the unaligned head and tail.
+  if (aligned > begin)
+    munmap(begin, aligned - begin);
+  uint8_t* end = aligned + mapped_size;
+  if (begin + size > end)
+    munmap(end, begin + size - end);
+  return aligned;
+}
+#endif  // defined(OS_LINUX)
+
+}  // namespace
+
+HugePageBuffer::HugePageBuffer(size_t size)
+    : HugePageBuffer(size, GetDefaultMode()) {}
+
+HugePageBuffer::HugePageBuffer(size_t size, HugePageMode mode) : size_(size) {
+#if defined(OS_LINUX)
+  if (mode != HugePageMode::kNone && size >= kHugePageSize) {
+    const size_t mapped_size = RoundUpToHugePage(size);
+    if (mode == HugePageMode::kExplicit) {
+      void* mapping =
+          mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (mapping != MAP_FAILED) {
+        data_ = static_cast<uint8_t*>(mapping);
+      } else {
+        VLOG(1) << "Cannot map " << mapped_size
+                << " bytes of explicit huge pages, falling back to "
+                   "transparent huge pages.";
+        HugePageStats::GetInstance()->AddFallback();
+        mode = HugePageMode::kTransparent;
+      }
+    }
+    if (mode == HugePageMode::kTransparent) {
+      data_ = MapAligned(mapped_size);
+      if (data_ && madvise(data_, mapped_size, MADV_HUGEPAGE) != 0)
+        VPLOG(1) << "madvise(MADV_HUGEPAGE) failed";
+    }
+    if (data_) {
+      mapped_size_ = mapped_size;
+      mode_ = mode;
+      HugePageStats::GetInstance()->Add(mode_, mapped_size_);
+      return;
+    }
+    PLOG(WARNING) << "Cannot map " << mapped_size << " bytes.";
+  }
+#endif  // defined(OS_LINUX)
+  data_ = new uint8_t[size];
+}
+
+HugePageBuffer::~HugePageBuffer() {
+  Free();
+}
+
+HugePageBuffer::HugePageBuffer(HugePageBuffer&& other) {
+  swap(other);
+}
+
+HugePageBuffer& HugePageBuffer::operator=(HugePageBuffer&& other) {
+  HugePageBuffer(std::move(other)).swap(*this);
+  return *this;
+}
+
+void HugePageBuffer::swap(HugePageBuffer& other) {
+  std::swap(data_, other.data_);
+  std::swap(size_, other.size_);
+  std::swap(mapped_size_, other.mapped_size_);
+  std::swap(mode_, other.mode_);
+}
+
+// static
+HugePageMode HugePageBuffer::GetDefaultMode() {
+  if (FLAGS_huge_pages == "transparent")
+    return HugePageMode::kTransparent;
+  if (FLAGS_huge_pages == "explicit")
+    return HugePageMode::kExplicit;
+  return HugePageMode::kNone;
+}
+
+void HugePageBuffer::Free() {
+  if (!data_)
+    return;
+#if defined(OS_LINUX)
+  if (mapped_size_ > 0) {
+    HugePageStats::GetInstance()->Add(mode_,
+                                      -static_cast<int64_t>(mapped_size_));
+    munmap(data_, mapped_size_);
+    data_ = nullptr;
+    return;
+  }
+#endif  // defined(OS_LINUX)
+  delete[] data_;
+  data_ = nullptr;
+}
+
+}  // namespace shaka
@@ -0,0 +1,77 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HUGE_PAGE_BUFFER_H_
+#define PACKAGER_FILE_HUGE_PAGE_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace shaka {
+
+/// How the large buffers that are accessed sequentially, e.g. the I/O caches,
+/// the demuxer read buffers and the sample buffer pools, are backed.
+enum class HugePageMode {
+  /// Regular heap allocations.
+  kNone,
+  /// Anonymous mappings aligned on huge pages and advised with
+  /// MADV_HUGEPAGE, which the kernel backs with transparent huge pages when
+  /// it can.
+  kTransparent,
+  /// Mappings of explicit huge pages, MAP_HUGETLB, which need huge pages to be
+  /// reserved, e.g. with /proc/sys/vm/nr_hugepages. Falls back to
+  /// kTransparent when none is available.
+  kExplicit,
+};
+
+/// A fixed size, uninitialized buffer, backed by huge pages if it is at least
+/// one huge page large and huge pages are enabled by --huge_pages. Only Linux
+/// supports huge pages. The bytes backed by huge pages are exported as the
+/// gauge shaka_huge_page_bytes{backing="transparent|explicit"}, and the
+/// explicit huge page allocations that fell back as the counter
+/// shaka_huge_page_fallbacks_total.
+class HugePageBuffer {
+ public:
+  static const size_t kHugePageSize = 2 << 20;
+
+  HugePageBuffer() = default;
+  /// Allocate @a size bytes with the mode set by --huge_pages.
+  explicit HugePageBuffer(size_t size);
+  HugePageBuffer(size_t size, HugePageMode mode);
+  ~HugePageBuffer();
+
+  HugePageBuffer(HugePageBuffer&& other);
+  HugePageBuffer& operator=(HugePageBuffer&& other);
+
+  void swap(HugePageBuffer& other);
+
+  uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  uint8_t& operator[](size_t index) const { return data_[index]; }
+
+  /// @return the mode the buffer is actually backed with.
+  HugePageMode mode() const { return mode_; }
+
+  /// @return the mode set by --huge_pages.
+  static HugePageMode GetDefaultMode();
+
+ private:
+  HugePageBuffer(const HugePageBuffer&) = delete;
+  HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+
+  void Free();
+
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  // The size of the mapping, a multiple of kHugePageSize, if the buffer is not
+  // a heap allocation.
+  size_t mapped_size_ = 0;
+  HugePageMode mode_ = HugePageMode::kNone;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HUGE_PAGE_BUFFER_H_
@@ -0,0 +1,68 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/huge_page_buffer.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <utility>
+
+namespace shaka {
+namespace {
+const size_t kLargeSize = HugePageBuffer::kHugePageSize + 100;
+}  // namespace
+
+TEST(HugePageBufferTest, DefaultIsNotBackedByHugePages) {
+  HugePageBuffer buffer(kLargeSize);
+  ASSERT_TRUE(buffer.data());
+  EXPECT_EQ(kLargeSize, buffer.size());
+  EXPECT_EQ(HugePageMode::kNone, buffer.mode());
+}
+
+TEST(HugePageBufferTest, SmallBufferIsNotBackedByHugePages) {
+  HugePageBuffer buffer(100, HugePageMode::kTransparent);
+  ASSERT_TRUE(buffer.data());
+  EXPECT_EQ(HugePageMode::kNone, buffer.mode());
+}
+
+TEST(HugePageBufferTest, Transparent) {
+  HugePageBuffer buffer(kLargeSize, HugePageMode::kTransparent);
+  ASSERT_TRUE(buffer.data());
+  EXPECT_EQ(kLargeSize, buffer.size());
+  memset(buffer.data(), 0x5a, buffer.size());
+  EXPECT_EQ(0x5a, buffer[kLargeSize - 1]);
+#if defined(OS_LINUX)
+  EXPECT_EQ(HugePageMode::kTransparent, buffer.mode());
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(buffer.data()) %
+                    HugePageBuffer::kHugePageSize);
+#endif  // defined(OS_LINUX)
+}
+
+TEST(HugePageBufferTest, ExplicitFallsBackToTransparent) {
+  // Whether explicit huge pages are reserved depends on the host.
+  HugePageBuffer buffer(kLargeSize, HugePageMode::kExplicit);
+  ASSERT_TRUE(buffer.data());
+  memset(buffer.data(), 0x5a, buffer.size());
+#if defined(OS_LINUX)
+  EXPECT_NE(HugePageMode::kNone, buffer.mode());
+#endif  // defined(OS_LINUX)
+}
+
+TEST(HugePageBufferTest, Move) {
+  HugePageBuffer buffer(kLargeSize, HugePageMode::kTransparent);
+  uint8_t* data = buffer.data();
+  HugePageBuffer moved(std::move(buffer));
+  EXPECT_EQ(data, moved.data());
+  EXPECT_EQ(kLargeSize, moved.size());
+  EXPECT_FALSE(buffer.data());
+
+  HugePageBuffer other(10);
+  other = std::move(moved);
+  EXPECT_EQ(data, other.data());
+}
+
+}  // namespace shaka
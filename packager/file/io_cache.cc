@@ -11,25 +11,38 @@
 #include <algorithm>
 
 #include "packager/base/logging.h"
+#include "packager/base/threading/platform_thread.h"
 
 namespace shaka {
+namespace {
+
+// A cache larger than its minimum size shrinks by half if it stays filled
+// below a quarter of its size for this long.
+const int64_t kShrinkCheckIntervalSeconds = 30;
+const uint64_t kShrinkOccupancyDivisor = 4;
+
+}  // namespace
 
 using base::AutoLock;
-using base::AutoUnlock;
-
-IoCache::IoCache(uint64_t cache_size)
-    : cache_size_(cache_size),
-      read_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                  base::WaitableEvent::InitialState::NOT_SIGNALED),
-      write_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                   base::WaitableEvent::InitialState::NOT_SIGNALED),
-      // Make the buffer one byte larger than the cache so that when the
-      // condition r_ptr == w_ptr is unambiguous (buffer empty).
-      circular_buffer_(cache_size + 1),
-      end_ptr_(&circular_buffer_[0] + cache_size + 1),
-      r_ptr_(circular_buffer_.data()),
-      w_ptr_(circular_buffer_.data()),
-      closed_(false) {}
+
+IoCache::IoCache(uint64_t cache_size, uint64_t max_cache_size)
+    : min_cache_size_(cache_size),
+      max_cache_size_(std::max(cache_size, max_cache_size)),
+      cache_size_(cache_size),
+      circular_buffer_(cache_size),
+      read_pos_(0),
+      write_pos_(0),
+      closed_(false),
+      reading_(false),
+      resizing_(false),
+      stall_time_us_(0),
+      data_available_(&lock_),
+      space_available_(&lock_),
+      resize_done_(&lock_),
+      num_data_waiters_(0),
+      num_space_waiters_(0) {
+  DCHECK_GT(cache_size, 0u);
+}
 
 IoCache::~IoCache() {
   Close();
@@ -38,28 +51,30 @@ IoCache::~IoCache() {
 uint64_t IoCache::Read(void* buffer, uint64_t size) {
   DCHECK(buffer);
 
-  AutoLock lock(lock_);
-  while (!closed_ && (BytesCachedInternal() == 0)) {
-    AutoUnlock unlock(lock_);
-    write_event_.Wait();
-  }
+  const uint64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+  uint64_t write_pos = write_pos_.load(std::memory_order_acquire);
+  if (write_pos == read_pos)
+    write_pos = WaitForData(read_pos);
+
+  size = std::min(size, write_pos - read_pos);
+  if (size == 0)
+    return 0;
 
-  size = std::min(size, BytesCachedInternal());
-  uint64_t first_chunk_size(
-      std::min(size, static_cast<uint64_t>(end_ptr_ - r_ptr_)));
-  memcpy(buffer, r_ptr_, first_chunk_size);
-  r_ptr_ += first_chunk_size;
-  DCHECK_GE(end_ptr_, r_ptr_);
-  if (r_ptr_ == end_ptr_)
-    r_ptr_ = &circular_buffer_[0];
+  // The data up to |write_pos| is kept if the cache is resized before
+  // BeginRead() returns, but its offset changes.
+  BeginRead();
+  const uint64_t cache_size = cache_size_.load(std::memory_order_relaxed);
+  const uint64_t offset = read_pos % cache_size;
+  uint64_t first_chunk_size(std::min(size, cache_size - offset));
+  memcpy(buffer, &circular_buffer_[offset], first_chunk_size);
   uint64_t second_chunk_size(size - first_chunk_size);
   if (second_chunk_size) {
-    memcpy(static_cast<uint8_t*>(buffer) + first_chunk_size, r_ptr_,
-           second_chunk_size);
-    r_ptr_ += second_chunk_size;
-    DCHECK_GT(end_ptr_, r_ptr_);
+    memcpy(static_cast<uint8_t*>(buffer) + first_chunk_size,
+           circular_buffer_.data(), second_chunk_size);
   }
-  read_event_.Signal();
+  read_pos_.store(read_pos + size);
+  EndRead();
+  NotifySpaceAvailable();
   return size;
 }
 
@@ -69,88 +84,203 @@ uint64_t IoCache::Write(const void* buffer, uint64_t size) {
   const uint8_t* r_ptr(static_cast<const uint8_t*>(buffer));
   uint64_t bytes_left(size);
   while (bytes_left) {
-    AutoLock lock(lock_);
-    while (!closed_ && (BytesFreeInternal() == 0)) {
-      AutoUnlock unlock(lock_);
-      VLOG(1) << "Circular buffer is full, which can happen if data arrives "
-                 "faster than being consumed by packager. Ignore if it is not "
-                 "live packaging. Otherwise, try increasing --io_cache_size.";
-      read_event_.Wait();
-    }
-    if (closed_)
+    if (closed_.load(std::memory_order_acquire))
       return 0;
 
-    uint64_t write_size(std::min(bytes_left, BytesFreeInternal()));
-    uint64_t first_chunk_size(
-        std::min(write_size, static_cast<uint64_t>(end_ptr_ - w_ptr_)));
-    memcpy(w_ptr_, r_ptr, first_chunk_size);
-    w_ptr_ += first_chunk_size;
-    DCHECK_GE(end_ptr_, w_ptr_);
-    if (w_ptr_ == end_ptr_)
-      w_ptr_ = &circular_buffer_[0];
+    const uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    uint64_t read_pos = read_pos_.load(std::memory_order_acquire);
+    if (write_pos == read_pos)
+      emptied_ = true;
+    MaybeShrink(write_pos - read_pos);
+    // Only the writer resizes the cache, so |cache_size_| cannot change below.
+    const uint64_t cache_size = cache_size_.load(std::memory_order_relaxed);
+    if (write_pos - read_pos == cache_size) {
+      if (emptied_ && cache_size < max_cache_size_) {
+        emptied_ = false;
+        Resize(std::min(cache_size * 2, max_cache_size_));
+        // Do not shrink the cache before it had a chance to absorb a burst.
+        peak_bytes_cached_ = cache_size;
+        shrink_check_time_ = base::TimeTicks::Now();
+        continue;
+      }
+      read_pos = WaitForSpace(write_pos);
+      if (closed_.load(std::memory_order_acquire))
+        return 0;
+    }
+
+    uint64_t write_size(
+        std::min(bytes_left, cache_size - (write_pos - read_pos)));
+    const uint64_t offset = write_pos % cache_size;
+    uint64_t first_chunk_size(std::min(write_size, cache_size - offset));
+    memcpy(&circular_buffer_[offset], r_ptr, first_chunk_size);
     r_ptr += first_chunk_size;
     uint64_t second_chunk_size(write_size - first_chunk_size);
     if (second_chunk_size) {
-      memcpy(w_ptr_, r_ptr, second_chunk_size);
-      w_ptr_ += second_chunk_size;
-      DCHECK_GT(end_ptr_, w_ptr_);
+      memcpy(circular_buffer_.data(), r_ptr, second_chunk_size);
       r_ptr += second_chunk_size;
     }
     bytes_left -= write_size;
-    write_event_.Signal();
+    write_pos_.store(write_pos + write_size);
+    NotifyDataAvailable();
   }
   return size;
 }
 
 void IoCache::Clear() {
-  AutoLock lock(lock_);
-  r_ptr_ = w_ptr_ = circular_buffer_.data();
+  read_pos_.store(write_pos_.load());
   // Let any writers know that there is room in the cache.
-  read_event_.Signal();
+  NotifySpaceAvailable();
 }
 
 void IoCache::Close() {
   AutoLock lock(lock_);
-  closed_ = true;
-  read_event_.Signal();
-  write_event_.Signal();
+  closed_.store(true);
+  data_available_.Broadcast();
+  space_available_.Broadcast();
 }
 
 void IoCache::Reopen() {
   AutoLock lock(lock_);
   CHECK(closed_);
-  r_ptr_ = w_ptr_ = circular_buffer_.data();
-  closed_ = false;
-  read_event_.Reset();
-  write_event_.Reset();
+  read_pos_.store(0);
+  write_pos_.store(0);
+  closed_.store(false);
+  emptied_ = true;
+  peak_bytes_cached_ = 0;
 }
 
 uint64_t IoCache::BytesCached() {
-  AutoLock lock(lock_);
-  return BytesCachedInternal();
+  // Load the read position first, so it is not ahead of the write position.
+  const uint64_t read_pos = read_pos_.load();
+  return write_pos_.load() - read_pos;
 }
 
 uint64_t IoCache::BytesFree() {
+  return cache_size() - BytesCached();
+}
+
+void IoCache::WaitUntilEmptyOrClosed() {
+  AutoLock lock(lock_);
+  ++num_space_waiters_;
+  while (!closed_.load() && read_pos_.load() != write_pos_.load())
+    space_available_.Wait();
+  --num_space_waiters_;
+}
+
+uint64_t IoCache::WaitForData(uint64_t read_pos) {
+  AutoLock lock(lock_);
+  // The writer checks |num_data_waiters_| after updating |write_pos_|, so
+  // either it sees the waiter or the check below sees the new data.
+  ++num_data_waiters_;
+  uint64_t write_pos = write_pos_.load();
+  while (!closed_.load() && write_pos == read_pos) {
+    data_available_.Wait();
+    write_pos = write_pos_.load();
+  }
+  --num_data_waiters_;
+  return write_pos;
+}
+
+uint64_t IoCache::WaitForSpace(uint64_t write_pos) {
+  const base::TimeTicks start_time = base::TimeTicks::Now();
   AutoLock lock(lock_);
-  return BytesFreeInternal();
+  ++num_space_waiters_;
+  const uint64_t cache_size = cache_size_.load();
+  uint64_t read_pos = read_pos_.load();
+  while (!closed_.load() && write_pos - read_pos == cache_size) {
+    VLOG(1) << "Circular buffer is full, which can happen if data arrives "
+               "faster than being consumed by packager. Ignore if it is not "
+               "live packaging. Otherwise, try increasing --io_cache_size or "
+               "--io_cache_max_size.";
+    space_available_.Wait();
+    read_pos = read_pos_.load();
+  }
+  --num_space_waiters_;
+  stall_time_us_ += (base::TimeTicks::Now() - start_time).InMicroseconds();
+  return read_pos;
 }
 
-uint64_t IoCache::BytesCachedInternal() {
-  return (r_ptr_ <= w_ptr_)
-             ? w_ptr_ - r_ptr_
-             : (end_ptr_ - r_ptr_) + (w_ptr_ - circular_buffer_.data());
+void IoCache::NotifyDataAvailable() {
+  if (num_data_waiters_.load() == 0)
+    return;
+  AutoLock lock(lock_);
+  data_available_.Signal();
 }
 
-uint64_t IoCache::BytesFreeInternal() {
-  return cache_size_ - BytesCachedInternal();
+void IoCache::NotifySpaceAvailable() {
+  if (num_space_waiters_.load() == 0)
+    return;
+  AutoLock lock(lock_);
+  // The writer and WaitUntilEmptyOrClosed() may both be waiting.
+  space_available_.Broadcast();
 }
 
-void IoCache::WaitUntilEmptyOrClosed() {
+void IoCache::BeginRead() {
+  while (true) {
+    reading_.store(true);
+    if (!resizing_.load())
+      return;
+    // Let Resize(), which waits for |reading_| to be reset, complete.
+    reading_.store(false);
+    AutoLock lock(lock_);
+    while (resizing_.load())
+      resize_done_.Wait();
+  }
+}
+
+void IoCache::EndRead() {
+  reading_.store(false);
+}
+
+void IoCache::Resize(uint64_t new_size) {
+  resizing_.store(true);
+  // The reader copies at most one read, so it is done shortly.
+  while (reading_.load())
+    base::PlatformThread::YieldCurrentThread();
+
+  // The reader cannot update |read_pos_| until |resizing_| is reset.
+  const uint64_t old_size = cache_size_.load(std::memory_order_relaxed);
+  const uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+  uint64_t pos = read_pos_.load();
+  DCHECK_LE(write_pos - pos, new_size);
+  HugePageBuffer new_buffer(new_size);
+  while (pos < write_pos) {
+    const uint64_t old_offset = pos % old_size;
+    const uint64_t new_offset = pos % new_size;
+    const uint64_t chunk_size = std::min(
+        {write_pos - pos, old_size - old_offset, new_size - new_offset});
+    memcpy(&new_buffer[new_offset], &circular_buffer_[old_offset], chunk_size);
+    pos += chunk_size;
+  }
+  circular_buffer_.swap(new_buffer);
+  cache_size_.store(new_size);
+  VLOG(1) << "Resized I/O cache from " << old_size << " to " << new_size
+          << " bytes.";
+
   AutoLock lock(lock_);
-  while (!closed_ && BytesCachedInternal()) {
-    AutoUnlock unlock(lock_);
-    read_event_.Wait();
+  resizing_.store(false);
+  resize_done_.Broadcast();
+}
+
+void IoCache::MaybeShrink(uint64_t bytes_cached) {
+  const uint64_t cache_size = cache_size_.load(std::memory_order_relaxed);
+  if (cache_size <= min_cache_size_)
+    return;
+
+  peak_bytes_cached_ = std::max(peak_bytes_cached_, bytes_cached);
+  const base::TimeTicks now = base::TimeTicks::Now();
+  if (shrink_check_time_.is_null()) {
+    shrink_check_time_ = now;
+    return;
+  }
+  if (now - shrink_check_time_ <
+      base::TimeDelta::FromSeconds(kShrinkCheckIntervalSeconds)) {
+    return;
   }
+  if (peak_bytes_cached_ * kShrinkOccupancyDivisor <= cache_size)
+    Resize(std::max(cache_size / 2, min_cache_size_));
+  peak_bytes_cached_ = bytes_cached;
+  shrink_check_time_ = now;
 }
 
 }  // namespace shaka
@@ -8,17 +8,34 @@
 #define PACKAGER_FILE_IO_CACHE_H_
 
 #include <stdint.h>
-#include <vector>
+#include <atomic>
 #include "packager/base/macros.h"
+#include "packager/base/synchronization/condition_variable.h"
 #include "packager/base/synchronization/lock.h"
-#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/time/time.h"
+#include "packager/file/huge_page_buffer.h"
 
 namespace shaka {
 
-/// Declaration of class which implements a thread-safe circular buffer.
+/// Declaration of class which implements a thread-safe circular buffer, with
+/// one thread reading and one thread writing. Reads and writes do not take a
+/// lock unless they have to wait for the cache to become non-empty or
+/// non-full.
+///
+/// The cache may grow and shrink between two sizes. The writer grows it
+/// instead of waiting for free space when the reader emptied it since it last
+/// grew, i.e. the reader is as fast as the writer on average and the cache is
+/// just too small for the bursts of the writer, e.g. video segments uploaded
+/// over a slow connection. A cache full although it does not empty, e.g. an
+/// output written faster than the connection can take, does not grow, as it
+/// would not stall less. The writer shrinks a cache which stays mostly empty
+/// back towards its minimum size.
 class IoCache {
  public:
-  explicit IoCache(uint64_t cache_size);
+  /// @param cache_size is the initial and minimum size of the cache.
+  /// @param max_cache_size is the maximum size of the cache. The cache has a
+  ///        fixed size if it is not larger than @a cache_size.
+  explicit IoCache(uint64_t cache_size, uint64_t max_cache_size = 0);
   ~IoCache();
 
   /// Read data from the cache. This function may block until there is data in
@@ -38,7 +55,7 @@ class IoCache {
   ///         closed.
   uint64_t Write(const void* buffer, uint64_t size);
 
-  /// Empties the cache.
+  /// Empties the cache. Must not be called while another thread is reading.
   void Clear();
 
   /// Close the cache. This will call any blocking calls to unblock, and the
@@ -46,9 +63,10 @@ class IoCache {
   void Close();
 
   /// @return true if the cache is closed, false otherwise.
-  bool closed() { return closed_; }
+  bool closed() { return closed_.load(); }
 
-  /// Reopens the cache. Any data still in the cache will be lost.
+  /// Reopens the cache. Any data still in the cache will be lost. Must not be
+  /// called while another thread is reading or writing.
   void Reopen();
 
   /// Returns the number of bytes in the cache.
@@ -62,19 +80,69 @@ class IoCache {
   /// Waits until the cache is empty or has been closed.
   void WaitUntilEmptyOrClosed();
 
- private:
-  uint64_t BytesCachedInternal();
-  uint64_t BytesFreeInternal();
+  /// @return the current size of the cache.
+  uint64_t cache_size() { return cache_size_.load(std::memory_order_relaxed); }
+
+  /// @return the time spent by the writer waiting for free space since the
+  ///         cache was created.
+  base::TimeDelta stall_time() {
+    return base::TimeDelta::FromMicroseconds(stall_time_us_.load());
+  }
 
-  const uint64_t cache_size_;
+ private:
+  // Block until there is data after |read_pos| or the cache is closed.
+  // Returns the write position.
+  uint64_t WaitForData(uint64_t read_pos);
+  // Block until there is free space before |write_pos| or the cache is closed.
+  // Returns the read position.
+  uint64_t WaitForSpace(uint64_t write_pos);
+  // Wake up the threads blocked in the calls above, if any.
+  void NotifyDataAvailable();
+  void NotifySpaceAvailable();
+  // The reader copies the data of |circular_buffer_| between these calls,
+  // which exclude Resize().
+  void BeginRead();
+  void EndRead();
+  // Called by the writer to grow or shrink the cache, keeping its data.
+  void Resize(uint64_t new_size);
+  // Called by the writer before each write, with the number of bytes
+  // cached, to shrink the cache if it has stayed mostly empty.
+  void MaybeShrink(uint64_t bytes_cached);
+
+  const uint64_t min_cache_size_;
+  const uint64_t max_cache_size_;
+  // Only the writer updates |cache_size_| and |circular_buffer_|, in
+  // Resize(), while the reader is not copying data.
+  std::atomic<uint64_t> cache_size_;
+  HugePageBuffer circular_buffer_;
+  // The number of bytes read from and written to the cache since it was
+  // opened. The data is at |circular_buffer_| offset |pos| % |cache_size_|.
+  // Only the reader updates |read_pos_| and only the writer |write_pos_|.
+  std::atomic<uint64_t> read_pos_;
+  std::atomic<uint64_t> write_pos_;
+  std::atomic<bool> closed_;
+  // Set by the reader while it copies data, and by the writer while it
+  // resizes the cache. Each sets its own flag before checking the other one.
+  std::atomic<bool> reading_;
+  std::atomic<bool> resizing_;
+  std::atomic<int64_t> stall_time_us_;
+
+  // Used by the writer only. Whether the cache has been empty since it last
+  // grew, and the peak number of bytes cached since |shrink_check_time_|.
+  bool emptied_ = true;
+  uint64_t peak_bytes_cached_ = 0;
+  base::TimeTicks shrink_check_time_;
+
+  // Only used to block when the cache is empty or full. The waiter counts are
+  // checked after updating the positions, so the condition variables are only
+  // signaled if there is a thread waiting.
   base::Lock lock_;
-  base::WaitableEvent read_event_;
-  base::WaitableEvent write_event_;
-  std::vector<uint8_t> circular_buffer_;
-  const uint8_t* end_ptr_;
-  uint8_t* r_ptr_;
-  uint8_t* w_ptr_;
-  bool closed_;
+  base::ConditionVariable data_available_;
+  base::ConditionVariable space_available_;
+  // Signaled when |resizing_| is reset.
+  base::ConditionVariable resize_done_;
+  std::atomic<int> num_data_waiters_;
+  std::atomic<int> num_space_waiters_;
 
   DISALLOW_COPY_AND_ASSIGN(IoCache);
 };
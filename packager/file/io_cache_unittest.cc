@@ -35,6 +35,17 @@ class ClosureThread : public base::SimpleThread {
   const base::Closure task_;
 };
 
+namespace {
+
+void ReadFromCache(IoCache* cache, uint64_t size) {
+  std::vector<uint8_t> read_buffer(kBlockSize);
+  uint64_t bytes_read = 0;
+  while (bytes_read < size)
+    bytes_read += cache->Read(read_buffer.data(), kBlockSize);
+}
+
+}  // namespace
+
 class IoCacheTest : public testing::Test {
  public:
   void WriteToCache(const std::vector<uint8_t>& test_buffer,
@@ -272,4 +283,92 @@ TEST_F(IoCacheTest, LargeRead) {
   cache_->Close();
 }
 
+TEST_F(IoCacheTest, LotsOfSmallWrites) {
+  const uint64_t kNumWrites(kCacheSize * 100);
+  const uint64_t kSmallWriteSize(3);
+
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kSmallWriteSize, &write_buffer);
+  WriteToCacheThreaded(write_buffer, kNumWrites, 0, true);
+
+  uint64_t bytes_read(0);
+  std::vector<uint8_t> read_buffer(kBlockSize);
+  while (uint64_t size = cache_->Read(read_buffer.data(), kBlockSize)) {
+    for (uint64_t i = 0; i < size; ++i)
+      ASSERT_EQ(write_buffer[(bytes_read + i) % kSmallWriteSize],
+                read_buffer[i]);
+    bytes_read += size;
+  }
+  EXPECT_EQ(kNumWrites * kSmallWriteSize, bytes_read);
+}
+
+TEST_F(IoCacheTest, WaitUntilEmpty) {
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kCacheSize, &write_buffer);
+  EXPECT_EQ(kCacheSize, cache_->Write(write_buffer.data(), kCacheSize));
+  EXPECT_EQ(0u, cache_->BytesFree());
+
+  ClosureThread reader_thread(
+      "ReaderThread",
+      base::Bind(&ReadFromCache, cache_.get(), kCacheSize));
+  reader_thread.Start();
+  cache_->WaitUntilEmptyOrClosed();
+  EXPECT_EQ(0u, cache_->BytesCached());
+  reader_thread.Join();
+}
+
+// A closed cache, e.g. after a failed upload, does not block the waiter.
+TEST_F(IoCacheTest, WaitUntilClosed) {
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kBlockSize, &write_buffer);
+  EXPECT_EQ(kBlockSize, cache_->Write(write_buffer.data(), kBlockSize));
+
+  ClosureThread closer_thread(
+      "CloserThread",
+      base::Bind(&IoCache::Close, base::Unretained(cache_.get())));
+  closer_thread.Start();
+  cache_->WaitUntilEmptyOrClosed();
+  EXPECT_TRUE(cache_->closed());
+  EXPECT_EQ(kBlockSize, cache_->BytesCached());
+  closer_thread.Join();
+}
+
+TEST_F(IoCacheTest, GrowsInsteadOfWaitingAfterEmptied) {
+  cache_.reset(new IoCache(kCacheSize, 4 * kCacheSize));
+
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(2 * kCacheSize, &write_buffer);
+  EXPECT_EQ(2 * kCacheSize,
+            cache_->Write(write_buffer.data(), write_buffer.size()));
+  EXPECT_EQ(2 * kCacheSize, cache_->cache_size());
+  EXPECT_EQ(0u, cache_->BytesFree());
+
+  std::vector<uint8_t> read_buffer(write_buffer.size());
+  EXPECT_EQ(write_buffer.size(),
+            cache_->Read(read_buffer.data(), read_buffer.size()));
+  EXPECT_EQ(write_buffer, read_buffer);
+  EXPECT_EQ(base::TimeDelta(), cache_->stall_time());
+}
+
+TEST_F(IoCacheTest, GrowWhileReading) {
+  cache_.reset(new IoCache(kCacheSize, 16 * kCacheSize));
+  const uint64_t kWriteSize = 3 * kCacheSize + 7;
+  const uint64_t kNumWrites = 100;
+
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kWriteSize, &write_buffer);
+  WriteToCacheThreaded(write_buffer, kNumWrites, 0, true);
+
+  uint64_t bytes_read(0);
+  std::vector<uint8_t> read_buffer(kBlockSize - 3);
+  while (uint64_t size =
+             cache_->Read(read_buffer.data(), read_buffer.size())) {
+    for (uint64_t i = 0; i < size; ++i)
+      ASSERT_EQ(write_buffer[(bytes_read + i) % kWriteSize], read_buffer[i]);
+    bytes_read += size;
+  }
+  EXPECT_EQ(kNumWrites * kWriteSize, bytes_read);
+  EXPECT_GE(16 * kCacheSize, cache_->cache_size());
+}
+
 }  // namespace shaka
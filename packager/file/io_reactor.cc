@@ -0,0 +1,90 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/io_reactor.h"
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/metrics/metrics.h"
+
+DECLARE_int32(io_threads);
+
+namespace shaka {
+
+IoReactor::IoReactor(int num_threads)
+    : task_available_(&lock_), thread_exited_(&lock_) {
+  DCHECK_GT(num_threads, 0);
+  num_threads_running_ = num_threads;
+  for (int i = 0; i < num_threads; ++i) {
+    base::WorkerPool::PostTask(
+        FROM_HERE, base::Bind(&IoReactor::Run, base::Unretained(this)),
+        true /* task_is_slow */);
+  }
+}
+
+IoReactor::~IoReactor() {
+  base::AutoLock auto_lock(lock_);
+  stopping_ = true;
+  task_available_.Broadcast();
+  while (num_threads_running_ > 0)
+    thread_exited_.Wait();
+  if (backlog_gauge_id_ >= 0)
+    Metrics::GetInstance()->RemoveGaugeFunction(backlog_gauge_id_);
+}
+
+IoReactor* IoReactor::GetInstance() {
+  // Leaked on purpose: the threads run until the process exits.
+  static IoReactor* instance = [] {
+    IoReactor* reactor = new IoReactor(std::max(1, FLAGS_io_threads));
+    reactor->backlog_gauge_id_ = Metrics::GetInstance()->AddGaugeFunction(
+        "shaka_io_reactor_backlog",
+        "I/O tasks of the files queued or running on the shared I/O threads.",
+        {}, [reactor]() { return static_cast<double>(reactor->backlog()); });
+    return reactor;
+  }();
+  return instance;
+}
+
+void IoReactor::PostTask(const base::Closure& task) {
+  base::AutoLock auto_lock(lock_);
+  DCHECK(!stopping_);
+  tasks_.push_back(task);
+  task_available_.Signal();
+}
+
+size_t IoReactor::backlog() const {
+  base::AutoLock auto_lock(lock_);
+  return tasks_.size() + num_tasks_running_;
+}
+
+void IoReactor::Run() {
+  base::AutoLock auto_lock(lock_);
+  while (true) {
+    while (tasks_.empty() && !stopping_)
+      task_available_.Wait();
+    if (tasks_.empty())
+      break;
+    base::Closure task = tasks_.front();
+    tasks_.pop_front();
+    ++num_tasks_running_;
+    {
+      base::AutoUnlock auto_unlock(lock_);
+      task.Run();
+    }
+    --num_tasks_running_;
+  }
+  --num_threads_running_;
+  thread_exited_.Signal();
+}
+
+}  // namespace shaka
@@ -0,0 +1,59 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_IO_REACTOR_H_
+#define PACKAGER_FILE_IO_REACTOR_H_
+
+#include <deque>
+
+#include "packager/base/callback.h"
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+/// Runs the I/O tasks of all the open files from a fixed set of threads, with
+/// --io_threads, instead of one blocked thread per open file. The tasks are
+/// posted when a file has work to do, e.g. data to write, and return once the
+/// work is done instead of waiting for more.
+class IoReactor {
+ public:
+  /// Starts @a num_threads threads.
+  explicit IoReactor(int num_threads);
+  /// Runs the tasks still queued and stops the threads.
+  ~IoReactor();
+
+  /// @return The instance shared by the files, with --io_threads threads.
+  ///         It runs until the process exits.
+  static IoReactor* GetInstance();
+
+  /// Runs @a task on one of the threads. The task should not block for long,
+  /// e.g. to wait for data, as it holds the thread from the other files.
+  void PostTask(const base::Closure& task);
+
+  /// @return The number of tasks queued or running.
+  size_t backlog() const;
+
+ private:
+  void Run();
+
+  mutable base::Lock lock_;
+  base::ConditionVariable task_available_;
+  base::ConditionVariable thread_exited_;
+  std::deque<base::Closure> tasks_;
+  int num_tasks_running_ = 0;
+  int num_threads_running_ = 0;
+  bool stopping_ = false;
+  // Id of the gauge reporting |backlog()|, for the shared instance only.
+  int backlog_gauge_id_ = -1;
+
+  DISALLOW_COPY_AND_ASSIGN(IoReactor);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_IO_REACTOR_H_
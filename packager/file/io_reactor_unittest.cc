@@ -0,0 +1,61 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/io_reactor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include "packager/base/bind.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace {
+
+void Increment(std::atomic<int>* counter) {
+  ++*counter;
+}
+
+void SignalAndWait(base::WaitableEvent* to_signal,
+                   base::WaitableEvent* to_wait) {
+  to_signal->Signal();
+  to_wait->Wait();
+}
+
+}  // namespace
+
+TEST(IoReactorTest, RunsQueuedTasksBeforeStopping) {
+  const int kNumTasks = 100;
+  std::atomic<int> counter(0);
+  {
+    IoReactor reactor(2);
+    for (int i = 0; i < kNumTasks; ++i)
+      reactor.PostTask(base::Bind(&Increment, &counter));
+  }
+  EXPECT_EQ(kNumTasks, counter.load());
+}
+
+TEST(IoReactorTest, RunsTasksOnSeveralThreads) {
+  base::WaitableEvent first_running(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  base::WaitableEvent second_running(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  IoReactor reactor(2);
+  // Each task waits for the other, so they only complete if they run at the
+  // same time.
+  reactor.PostTask(
+      base::Bind(&SignalAndWait, &first_running, &second_running));
+  reactor.PostTask(
+      base::Bind(&SignalAndWait, &second_running, &first_running));
+  EXPECT_TRUE(first_running.TimedWait(base::TimeDelta::FromSeconds(10)));
+  EXPECT_TRUE(second_running.TimedWait(base::TimeDelta::FromSeconds(10)));
+}
+
+}  // namespace shaka
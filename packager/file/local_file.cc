@@ -6,15 +6,28 @@
 
 #include "packager/file/local_file.h"
 
+#include <gflags/gflags.h>
 #include <stdio.h>
 #if defined(OS_WIN)
 #include <windows.h>
 #else
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #endif  // defined(OS_WIN)
+
+#include <algorithm>
+#include <vector>
+
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
+#include "packager/metrics/trace_event.h"
+
+DECLARE_bool(input_fadvise);
+DECLARE_uint64(input_readahead_size);
 
 namespace shaka {
 namespace {
@@ -112,6 +125,7 @@ bool LocalFile::Close() {
 }
 
 int64_t LocalFile::Read(void* buffer, uint64_t length) {
+  SHAKA_TRACE_EVENT("file", "LocalFile::Read");
   DCHECK(buffer != NULL);
   DCHECK(internal_file_ != NULL);
   size_t bytes_read = fread(buffer, sizeof(char), length, internal_file_);
@@ -120,11 +134,15 @@ int64_t LocalFile::Read(void* buffer, uint64_t length) {
   if (bytes_read == 0 && ferror(internal_file_) != 0) {
     return -1;
   }
+  if (advise_reads_) {
+    read_position_ += bytes_read;
+    AdviseReadPosition();
+  }
   return bytes_read;
 }
 
 int64_t LocalFile::Write(const void* buffer, uint64_t length) {
-
+  SHAKA_TRACE_EVENT("file", "LocalFile::Write");
   base::FilePath file_path(base::FilePath::FromUTF8Unsafe(file_name()));
   VLOG(2) << "Writing to " << file_path.AsUTF8Unsafe() << ", length=" << length;
 
@@ -139,6 +157,60 @@ int64_t LocalFile::Write(const void* buffer, uint64_t length) {
   return bytes_written;
 }
 
+int64_t LocalFile::WriteV(const IoVec* iov, size_t iov_count) {
+  SHAKA_TRACE_EVENT("file", "LocalFile::WriteV");
+#if defined(OS_WIN)
+  return File::WriteV(iov, iov_count);
+#else
+  DCHECK(internal_file_ != NULL);
+  // Write the blocks with writev() directly, instead of copying them into the
+  // stdio buffer. Flush the buffer first to keep the data in order.
+  if (fflush(internal_file_) != 0)
+    return -1;
+
+  std::vector<struct iovec> iovecs;
+  iovecs.reserve(iov_count);
+  for (size_t i = 0; i < iov_count; ++i) {
+    if (iov[i].length == 0)
+      continue;
+    struct iovec entry;
+    entry.iov_base = const_cast<void*>(iov[i].buffer);
+    entry.iov_len = iov[i].length;
+    iovecs.push_back(entry);
+  }
+
+  const int fd = fileno(internal_file_);
+  int64_t total_bytes_written = 0;
+  size_t index = 0;
+  while (index < iovecs.size()) {
+    const int count =
+        static_cast<int>(std::min<size_t>(iovecs.size() - index, IOV_MAX));
+    ssize_t bytes_written = writev(fd, &iovecs[index], count);
+    if (bytes_written < 0) {
+      if (errno == EINTR)
+        continue;
+      PLOG(ERROR) << "Failed to write to " << file_name();
+      return -1;
+    }
+    total_bytes_written += bytes_written;
+    // Skip the blocks written and adjust the block partially written, if any.
+    while (bytes_written > 0) {
+      struct iovec& entry = iovecs[index];
+      if (static_cast<size_t>(bytes_written) < entry.iov_len) {
+        entry.iov_base = static_cast<uint8_t*>(entry.iov_base) + bytes_written;
+        entry.iov_len -= bytes_written;
+        break;
+      }
+      bytes_written -= entry.iov_len;
+      ++index;
+    }
+  }
+  VLOG(2) << "WriteV " << iov_count << " blocks to " << file_name()
+          << " return " << total_bytes_written;
+  return total_bytes_written;
+#endif  // defined(OS_WIN)
+}
+
 int64_t LocalFile::Size() {
   DCHECK(internal_file_ != NULL);
 
@@ -163,6 +235,8 @@ bool LocalFile::Flush() {
 }
 
 bool LocalFile::Seek(uint64_t position) {
+  read_position_ = position;
+  next_advice_position_ = 0;
 #if defined(OS_WIN)
   return _fseeki64(internal_file_, static_cast<__int64>(position), SEEK_SET) ==
          0;
@@ -190,18 +264,84 @@ bool LocalFile::Open() {
 
   // Create upper level directories for write mode.
   if (file_mode_.find("w") != std::string::npos) {
-    // The function returns true if the directories already exist.
-    if (!shaka::CreateDirectory(file_path.DirName())) {
+    if (!CreateParentDirectories(file_name().c_str()))
       return false;
-    }
   }
 
   internal_file_ = base::OpenFile(file_path, file_mode_.c_str());
-  return (internal_file_ != NULL);
+  if (!internal_file_)
+    return false;
+
+#if defined(OS_LINUX)
+  // The hints only apply to files opened for reading only.
+  if (file_mode_ == "rb" &&
+      (FLAGS_input_fadvise || FLAGS_input_readahead_size > 0)) {
+    advise_reads_ = true;
+    if (FLAGS_input_fadvise) {
+      posix_fadvise(fileno(internal_file_), 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    AdviseReadPosition();
+  }
+#endif  // defined(OS_LINUX)
+  return true;
+}
+
+bool LocalFile::PrepareKernelCopy(int* fd, uint64_t* position) {
+#if defined(OS_WIN)
+  return false;
+#else
+  DCHECK(internal_file_ != NULL);
+  // The writes to a file opened for appending ignore the position.
+  if (file_mode_.find("a") != std::string::npos)
+    return false;
+  if (!Flush() || !Tell(position))
+    return false;
+  *fd = fileno(internal_file_);
+  return true;
+#endif  // defined(OS_WIN)
+}
+
+bool LocalFile::CompleteKernelCopy(uint64_t bytes_copied) {
+  uint64_t position = 0;
+  // The stdio position is not aware of the copy, which used explicit offsets.
+  return Tell(&position) && Seek(position + bytes_copied);
+}
+
+void LocalFile::AdviseReadPosition() {
+#if defined(OS_LINUX)
+  if (read_position_ < next_advice_position_)
+    return;
+  const int fd = fileno(internal_file_);
+  if (FLAGS_input_readahead_size > 0) {
+    posix_fadvise(fd, read_position_, FLAGS_input_readahead_size,
+                  POSIX_FADV_WILLNEED);
+  }
+  // POSIX_FADV_NOREUSE is a no-op on Linux, so drop the pages already read
+  // from the page cache instead, which keeps a file read once from evicting
+  // the pages other processes use.
+  if (FLAGS_input_fadvise && read_position_ > dropped_position_) {
+    posix_fadvise(fd, dropped_position_, read_position_ - dropped_position_,
+                  POSIX_FADV_DONTNEED);
+    dropped_position_ = read_position_;
+  }
+  // Hint again when half of the read ahead data is consumed.
+  const uint64_t kDefaultAdviceInterval = 8 << 20;
+  const uint64_t advice_interval =
+      FLAGS_input_readahead_size > 0
+          ? std::max<uint64_t>(FLAGS_input_readahead_size / 2, 1)
+          : kDefaultAdviceInterval;
+  next_advice_position_ = read_position_ + advice_interval;
+#endif  // defined(OS_LINUX)
 }
 
 bool LocalFile::Delete(const char* file_name) {
   return base::DeleteFile(base::FilePath::FromUTF8Unsafe(file_name), false);
 }
 
+bool LocalFile::CreateParentDirectories(const char* file_name) {
+  // The function returns true if the directories already exist.
+  return shaka::CreateDirectory(
+      base::FilePath::FromUTF8Unsafe(file_name).DirName());
+}
+
 }  // namespace shaka
@@ -29,6 +29,7 @@ class LocalFile : public File {
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
   int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t WriteV(const IoVec* iov, size_t iov_count) override;
   int64_t Size() override;
   bool Flush() override;
   bool Seek(uint64_t position) override;
@@ -40,14 +41,30 @@ class LocalFile : public File {
   /// @return true if successful, or false otherwise.
   static bool Delete(const char* file_name);
 
+  /// Create the missing parent directories of a local file.
+  /// @param file_name is the path of the file.
+  /// @return true if successful or if the directories already exist, false
+  ///         otherwise.
+  static bool CreateParentDirectories(const char* file_name);
+
  protected:
   ~LocalFile() override;
 
   bool Open() override;
+  bool PrepareKernelCopy(int* fd, uint64_t* position) override;
+  bool CompleteKernelCopy(uint64_t bytes_copied) override;
 
  private:
+  // Give the kernel page cache hints for the data read so far, if enabled
+  // with --input_fadvise or --input_readahead_size.
+  void AdviseReadPosition();
+
   std::string file_mode_;
   FILE* internal_file_;
+  bool advise_reads_ = false;
+  uint64_t read_position_ = 0;
+  uint64_t next_advice_position_ = 0;
+  uint64_t dropped_position_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(LocalFile);
 };
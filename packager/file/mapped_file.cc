@@ -0,0 +1,129 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/mapped_file.h"
+
+#if !defined(OS_WIN)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(OS_WIN)
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace {
+
+#if !defined(OS_WIN)
+// Unmaps the file when the last reference to its content is released.
+class Unmapper {
+ public:
+  explicit Unmapper(size_t size) : size_(size) {}
+  void operator()(const uint8_t* data) const {
+    munmap(const_cast<uint8_t*>(data), size_);
+  }
+
+ private:
+  size_t size_;
+};
+#endif  // !defined(OS_WIN)
+
+}  // namespace
+
+MappedFile::MappedFile(const char* file_name) : File(file_name) {}
+
+MappedFile* MappedFile::Map(const char* file_name) {
+  std::string real_file_name(file_name);
+  if (real_file_name.compare(0, strlen(kLocalFilePrefix), kLocalFilePrefix) ==
+      0) {
+    real_file_name = real_file_name.substr(strlen(kLocalFilePrefix));
+  }
+  MappedFile* file = new MappedFile(real_file_name.c_str());
+  if (!file->Open()) {
+    delete file;
+    return NULL;
+  }
+  return file;
+}
+
+bool MappedFile::Close() {
+  delete this;
+  return true;
+}
+
+int64_t MappedFile::Read(void* buffer, uint64_t length) {
+  DCHECK(buffer != NULL);
+  if (position_ >= size_)
+    return 0;
+  const uint64_t bytes_read = std::min(length, size_ - position_);
+  memcpy(buffer, data_.get() + position_, bytes_read);
+  position_ += bytes_read;
+  return bytes_read;
+}
+
+int64_t MappedFile::Write(const void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "MappedFile does not support writing.";
+  return -1;
+}
+
+int64_t MappedFile::Size() {
+  return size_;
+}
+
+bool MappedFile::Flush() {
+  return true;
+}
+
+bool MappedFile::Seek(uint64_t position) {
+  position_ = position;
+  return true;
+}
+
+bool MappedFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+MappedFile::~MappedFile() {}
+
+bool MappedFile::Open() {
+#if defined(OS_WIN)
+  LOG(WARNING) << "Memory mapped files are not supported on Windows.";
+  return false;
+#else
+  const int fd = open(file_name().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to open " << file_name();
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0) {
+    LOG(ERROR) << "Cannot map " << file_name() << ", not a non-empty file.";
+    close(fd);
+    return false;
+  }
+  size_ = info.st_size;
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the file descriptor is closed.
+  close(fd);
+  if (data == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to map " << file_name();
+    return false;
+  }
+  // The file is expected to be read mostly sequentially.
+  madvise(data, size_, MADV_SEQUENTIAL);
+  data_.reset(static_cast<const uint8_t*>(data), Unmapper(size_));
+  return true;
+#endif  // defined(OS_WIN)
+}
+
+}  // namespace shaka
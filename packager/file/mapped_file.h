@@ -0,0 +1,65 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_MAPPED_FILE_H_
+#define PACKAGER_FILE_MAPPED_FILE_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "packager/base/compiler_specific.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Implement MappedFile which maps a local file in memory for reading. Besides
+/// the File interface, the whole file content is available with data(), which
+/// stays valid as long as a reference to it is kept, even after the file is
+/// closed.
+class MappedFile : public File {
+ public:
+  /// Map a local file in memory.
+  /// @param file_name is the path of the local file, optionally prefixed with
+  ///        "file://".
+  /// @return The opened file, or NULL if the file cannot be mapped, e.g. on
+  ///         platforms without mmap support.
+  static MappedFile* Map(const char* file_name);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+  /// @return The content of the file.
+  std::shared_ptr<const uint8_t> data() const { return data_; }
+  /// @return The size of the file.
+  uint64_t size() const { return size_; }
+
+ protected:
+  ~MappedFile() override;
+
+  bool Open() override;
+
+ private:
+  explicit MappedFile(const char* file_name);
+
+  std::shared_ptr<const uint8_t> data_;
+  uint64_t size_ = 0;
+  uint64_t position_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_MAPPED_FILE_H_
@@ -0,0 +1,66 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/mapped_file.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_util.h"
+
+namespace shaka {
+namespace {
+const char kData[] = "mapped file content";
+const int kDataSize = sizeof(kData) - 1;
+}  // namespace
+
+class MappedFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateTemporaryFile(&test_file_path_));
+    ASSERT_EQ(kDataSize, base::WriteFile(test_file_path_, kData, kDataSize));
+    file_name_ = test_file_path_.AsUTF8Unsafe();
+  }
+
+  void TearDown() override { base::DeleteFile(test_file_path_, false); }
+
+  base::FilePath test_file_path_;
+  std::string file_name_;
+};
+
+TEST_F(MappedFileTest, DataOutlivesFile) {
+  MappedFile* file = MappedFile::Map(file_name_.c_str());
+  ASSERT_TRUE(file != nullptr);
+  EXPECT_EQ(static_cast<uint64_t>(kDataSize), file->size());
+  std::shared_ptr<const uint8_t> data = file->data();
+  EXPECT_TRUE(file->Close());
+  EXPECT_EQ(std::string(kData),
+            std::string(reinterpret_cast<const char*>(data.get()), kDataSize));
+}
+
+TEST_F(MappedFileTest, SeekAndRead) {
+  MappedFile* file =
+      MappedFile::Map((std::string(kLocalFilePrefix) + file_name_).c_str());
+  ASSERT_TRUE(file != nullptr);
+  EXPECT_EQ(kDataSize, file->Size());
+
+  char buffer[kDataSize] = {};
+  ASSERT_TRUE(file->Seek(7));
+  ASSERT_EQ(4, file->Read(buffer, 4));
+  EXPECT_EQ("file", std::string(buffer, 4));
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(11u, position);
+
+  EXPECT_EQ(kDataSize - 11, file->Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(0, file->Read(buffer, sizeof(buffer)));
+  EXPECT_TRUE(file->Close());
+}
+
+TEST_F(MappedFileTest, MissingFile) {
+  EXPECT_EQ(nullptr, MappedFile::Map((file_name_ + ".missing").c_str()));
+}
+
+}  // namespace shaka
@@ -9,16 +9,74 @@
 #include <string.h>  // for memcpy
 
 #include <algorithm>
+#include <functional>
 #include <map>
 #include <memory>
-#include <set>
 
 #include "packager/base/logging.h"
+#include "packager/base/strings/string_piece.h"
 #include "packager/base/synchronization/lock.h"
 
 namespace shaka {
+
+// The content of a memory file.
+class MemoryFileData {
+ public:
+  uint64_t size() const { return size_; }
+
+  // Copy |length| bytes at |position|, which must be in the file.
+  void Read(uint64_t position, uint8_t* buffer, uint64_t length) const {
+    DCHECK_LE(position + length, size_);
+    while (length > 0) {
+      const std::vector<uint8_t>& chunk =
+          *chunks_[position / MemoryFile::kChunkSize];
+      const size_t offset = position % MemoryFile::kChunkSize;
+      const size_t bytes_to_copy = static_cast<size_t>(
+          std::min<uint64_t>(length, chunk.size() - offset));
+      memcpy(buffer, chunk.data() + offset, bytes_to_copy);
+      buffer += bytes_to_copy;
+      position += bytes_to_copy;
+      length -= bytes_to_copy;
+    }
+  }
+
+  // Write |length| bytes at |position|, which must not be after the end of
+  // the file. Only the last chunk written to grows.
+  void Write(uint64_t position, const uint8_t* data, uint64_t length) {
+    DCHECK_LE(position, size_);
+    while (length > 0) {
+      const size_t index = position / MemoryFile::kChunkSize;
+      if (index == chunks_.size())
+        chunks_.push_back(std::make_shared<std::vector<uint8_t>>());
+      std::vector<uint8_t>& chunk = *chunks_[index];
+      const size_t offset = position % MemoryFile::kChunkSize;
+      const size_t bytes_to_copy = static_cast<size_t>(
+          std::min<uint64_t>(length, MemoryFile::kChunkSize - offset));
+      if (chunk.size() < offset + bytes_to_copy)
+        chunk.resize(offset + bytes_to_copy);
+      memcpy(chunk.data() + offset, data, bytes_to_copy);
+      data += bytes_to_copy;
+      position += bytes_to_copy;
+      length -= bytes_to_copy;
+    }
+    size_ = std::max(size_, position);
+  }
+
+  void GetContent(MemoryFile::Content* content) const {
+    content->assign(chunks_.begin(), chunks_.end());
+  }
+
+ private:
+  std::vector<std::shared_ptr<std::vector<uint8_t>>> chunks_;
+  uint64_t size_ = 0;
+};
+
 namespace {
 
+// The number of independently locked parts of the file system, so the files
+// are opened and closed concurrently, e.g. by the threads of the muxers.
+const size_t kNumShards = 16;
+
 // A helper filesystem object.  This holds the data for the memory files.
 class FileSystem {
  public:
@@ -30,88 +88,127 @@ class FileSystem {
   }
 
   void Delete(const std::string& file_name) {
-    base::AutoLock auto_lock(lock_);
+    Shard& shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard.lock);
 
-    if (open_files_.find(file_name) != open_files_.end()) {
+    if (shard.open_files.find(file_name) != shard.open_files.end()) {
       LOG(ERROR) << "File '" << file_name
                  << "' is still open. Deleting an open MemoryFile is not "
                     "allowed. Exit without deleting the file.";
       return;
     }
 
-    files_.erase(file_name);
+    shard.files.erase(file_name);
   }
 
   void DeleteAll() {
-    base::AutoLock auto_lock(lock_);
-    if (!open_files_.empty()) {
-      LOG(ERROR) << "There are still files open. Deleting an open MemoryFile "
-                    "is not allowed. Exit without deleting the file.";
-      return;
+    std::vector<std::unique_ptr<base::AutoLock>> auto_locks;
+    for (Shard& shard : shards_)
+      auto_locks.emplace_back(new base::AutoLock(shard.lock));
+    for (const Shard& shard : shards_) {
+      if (!shard.open_files.empty()) {
+        LOG(ERROR) << "There are still files open. Deleting an open "
+                      "MemoryFile is not allowed. Exit without deleting the "
+                      "file.";
+        return;
+      }
     }
-    files_.clear();
+    for (Shard& shard : shards_)
+      shard.files.clear();
   }
 
-  std::vector<uint8_t>* Open(const std::string& file_name,
-                             const std::string& mode) {
-    base::AutoLock auto_lock(lock_);
+  std::shared_ptr<MemoryFileData> Open(const std::string& file_name,
+                                       const std::string& mode) {
+    Shard& shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard.lock);
 
-    if (open_files_.find(file_name) != open_files_.end()) {
+    if (shard.open_files.find(file_name) != shard.open_files.end()) {
       NOTIMPLEMENTED() << "File '" << file_name
                        << "' is already open. MemoryFile does not support "
                           "open the same file before it is closed.";
       return nullptr;
     }
 
-    auto iter = files_.find(file_name);
+    std::shared_ptr<MemoryFileData> file;
     if (mode == "r") {
-      if (iter == files_.end())
+      auto iter = shard.files.find(file_name);
+      if (iter == shard.files.end())
         return nullptr;
+      file = iter->second;
     } else if (mode == "w") {
-      if (iter != files_.end())
-        iter->second.clear();
+      // The content returned by GetContent() before is left untouched.
+      file = std::make_shared<MemoryFileData>();
+      shard.files[file_name] = file;
     } else {
       NOTIMPLEMENTED() << "File mode '" << mode
                        << "' not supported by MemoryFile";
       return nullptr;
     }
 
-    open_files_[file_name] = mode;
-    return &files_[file_name];
+    shard.open_files[file_name] = mode;
+    return file;
   }
 
   bool Close(const std::string& file_name) {
-    base::AutoLock auto_lock(lock_);
+    Shard& shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard.lock);
 
-    auto iter = open_files_.find(file_name);
-    if (iter == open_files_.end()) {
+    auto iter = shard.open_files.find(file_name);
+    if (iter == shard.open_files.end()) {
       LOG(ERROR) << "Cannot close file '" << file_name
                  << "' which is not open.";
       return false;
     }
 
-    open_files_.erase(iter);
+    shard.open_files.erase(iter);
+    return true;
+  }
+
+  bool GetContent(const std::string& file_name, MemoryFile::Content* content) {
+    Shard& shard = GetShard(file_name);
+    base::AutoLock auto_lock(shard.lock);
+
+    auto open_iter = shard.open_files.find(file_name);
+    if (open_iter != shard.open_files.end() && open_iter->second != "r") {
+      LOG(ERROR) << "Cannot get the content of file '" << file_name
+                 << "' which is open for writing.";
+      return false;
+    }
+    auto iter = shard.files.find(file_name);
+    if (iter == shard.files.end())
+      return false;
+    iter->second->GetContent(content);
     return true;
   }
 
  private:
+  struct Shard {
+    // Filename to file data map.
+    std::map<std::string, std::shared_ptr<MemoryFileData>> files;
+    // Filename to file open modes map.
+    std::map<std::string, std::string> open_files;
+
+    base::Lock lock;
+  };
+
   FileSystem(const FileSystem&) = delete;
   FileSystem& operator=(const FileSystem&) = delete;
 
   FileSystem() = default;
 
-  // Filename to file data map.
-  std::map<std::string, std::vector<uint8_t>> files_;
-  // Filename to file open modes map.
-  std::map<std::string, std::string> open_files_;
+  Shard& GetShard(const std::string& file_name) {
+    return shards_[std::hash<std::string>()(file_name) % kNumShards];
+  }
 
-  base::Lock lock_;
+  Shard shards_[kNumShards];
 };
 
 }  // namespace
 
+const size_t MemoryFile::kChunkSize;
+
 MemoryFile::MemoryFile(const std::string& file_name, const std::string& mode)
-    : File(file_name), mode_(mode), file_(NULL), position_(0) {}
+    : File(file_name), mode_(mode), position_(0) {}
 
 MemoryFile::~MemoryFile() {}
 
@@ -129,25 +226,13 @@ int64_t MemoryFile::Read(void* buffer, uint64_t length) {
     return 0;
 
   const uint64_t bytes_to_read = std::min(length, size - position_);
-  memcpy(buffer, &(*file_)[position_], bytes_to_read);
+  file_->Read(position_, reinterpret_cast<uint8_t*>(buffer), bytes_to_read);
   position_ += bytes_to_read;
   return bytes_to_read;
 }
 
 int64_t MemoryFile::Write(const void* buffer, uint64_t length) {
-  // If length is zero, we won't resize the buffer and it is possible for
-  // |position| to equal the length of the buffer. This will cause a segfault
-  // when indexing into the buffer for the memcpy.
-  if (length == 0) {
-    return 0;
-  }
-
-  const uint64_t size = Size();
-  if (size < position_ + length) {
-    file_->resize(position_ + length);
-  }
-
-  memcpy(&(*file_)[position_], buffer, length);
+  file_->Write(position_, reinterpret_cast<const uint8_t*>(buffer), length);
   position_ += length;
   return length;
 }
@@ -191,4 +276,12 @@ void MemoryFile::Delete(const std::string& file_name) {
   FileSystem::Instance()->Delete(file_name);
 }
 
+bool MemoryFile::GetContent(const std::string& file_name, Content* content) {
+  DCHECK(content);
+  base::StringPiece name(file_name);
+  if (name.starts_with(kMemoryFilePrefix))
+    name.remove_prefix(strlen(kMemoryFilePrefix));
+  return FileSystem::Instance()->GetContent(name.as_string(), content);
+}
+
 }  // namespace shaka
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -16,10 +17,19 @@
 
 namespace shaka {
 
-/// Implements a File that is stored in memory.  This should be only used for
-/// testing, since this does not support larger files.
+class MemoryFileData;
+
+/// Implements a File that is stored in memory, e.g. for testing or to get the
+/// outputs of the packager without writing them to storage. The files are
+/// stored in fixed size chunks, which are not copied as the files grow.
 class MemoryFile : public File {
  public:
+  /// The content of a memory file, in chunks of up to kChunkSize bytes.
+  typedef std::vector<std::shared_ptr<const std::vector<uint8_t>>> Content;
+
+  /// The maximum size of a chunk of the content of a file.
+  static const size_t kChunkSize = 64 * 1024;
+
   MemoryFile(const std::string& file_name, const std::string& mode);
 
   /// @name File implementation overrides.
@@ -40,6 +50,13 @@ class MemoryFile : public File {
   /// Deletes the memory file data with the given file_name.  Any objects open
   /// with that file name will be in an undefined state.
   static void Delete(const std::string& file_name);
+  /// Gets the content of a memory file without copying it. The content is
+  /// not modified afterwards, even if the file is written to or deleted.
+  /// @param file_name is the name of the file, with or without the
+  ///        "memory://" prefix.
+  /// @param content gets the chunks of the file, in order.
+  /// @return false if the file does not exist or is open for writing.
+  static bool GetContent(const std::string& file_name, Content* content);
 
  protected:
   ~MemoryFile() override;
@@ -47,7 +64,7 @@ class MemoryFile : public File {
 
  private:
   std::string mode_;
-  std::vector<uint8_t>* file_;
+  std::shared_ptr<MemoryFileData> file_;
   uint64_t position_;
 
   DISALLOW_COPY_AND_ASSIGN(MemoryFile);
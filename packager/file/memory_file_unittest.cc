@@ -5,6 +5,7 @@
 #include "packager/file/memory_file.h"
 #include <gtest/gtest.h>
 #include <memory>
+#include <vector>
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
 
@@ -109,4 +110,62 @@ TEST_F(MemoryFileTest, WriteExistingFileDeletes) {
   EXPECT_EQ(0, file2->Size());
 }
 
+TEST_F(MemoryFileTest, SpansChunks) {
+  std::vector<uint8_t> data(MemoryFile::kChunkSize * 2 + 123);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8_t>(i * 7);
+
+  std::unique_ptr<File, FileCloser> writer(File::Open("memory://file1", "w"));
+  ASSERT_TRUE(writer);
+  // Write in pieces which do not line up with the chunks.
+  const size_t kPieceSize = 1000;
+  for (size_t pos = 0; pos < data.size(); pos += kPieceSize) {
+    const size_t size = std::min(kPieceSize, data.size() - pos);
+    ASSERT_EQ(static_cast<int64_t>(size), writer->Write(&data[pos], size));
+  }
+  // Overwrite across a chunk boundary.
+  const uint8_t kOverwrite[] = {0xff, 0xfe, 0xfd, 0xfc};
+  ASSERT_TRUE(writer->Seek(MemoryFile::kChunkSize - 2));
+  ASSERT_EQ(4, writer->Write(kOverwrite, sizeof(kOverwrite)));
+  memcpy(&data[MemoryFile::kChunkSize - 2], kOverwrite, sizeof(kOverwrite));
+  EXPECT_EQ(static_cast<int64_t>(data.size()), writer->Size());
+  writer.release()->Close();
+
+  std::unique_ptr<File, FileCloser> reader(File::Open("memory://file1", "r"));
+  ASSERT_TRUE(reader);
+  std::vector<uint8_t> read_data(data.size() + 1);
+  ASSERT_EQ(static_cast<int64_t>(data.size()),
+            reader->Read(read_data.data(), read_data.size()));
+  read_data.pop_back();
+  EXPECT_EQ(data, read_data);
+}
+
+TEST_F(MemoryFileTest, GetContent) {
+  std::vector<uint8_t> data(MemoryFile::kChunkSize + 10, 1);
+  ASSERT_TRUE(File::WriteStringToFile(
+      "memory://file1", std::string(data.begin(), data.end())));
+
+  MemoryFile::Content content;
+  ASSERT_TRUE(MemoryFile::GetContent("memory://file1", &content));
+  ASSERT_EQ(2u, content.size());
+  EXPECT_EQ(MemoryFile::kChunkSize, content[0]->size());
+  EXPECT_EQ(10u, content[1]->size());
+
+  // The content is not affected by later writes.
+  ASSERT_TRUE(File::WriteStringToFile("memory://file1", "abc"));
+  EXPECT_EQ(10u, content[1]->size());
+  ASSERT_TRUE(MemoryFile::GetContent("file1", &content));
+  ASSERT_EQ(1u, content.size());
+  EXPECT_EQ("abc", std::string(content[0]->begin(), content[0]->end()));
+}
+
+TEST_F(MemoryFileTest, GetContentFailures) {
+  MemoryFile::Content content;
+  EXPECT_FALSE(MemoryFile::GetContent("memory://file1", &content));
+
+  std::unique_ptr<File, FileCloser> writer(File::Open("memory://file1", "w"));
+  ASSERT_TRUE(writer);
+  EXPECT_FALSE(MemoryFile::GetContent("memory://file1", &content));
+}
+
 }  // namespace shaka
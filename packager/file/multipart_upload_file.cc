@@ -0,0 +1,423 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/multipart_upload_file.h"
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/base/time/time.h"
+#include "packager/file/curl_handle_pool.h"
+
+DEFINE_uint64(multipart_upload_part_size, 8 << 20,
+              "Size, in bytes, of the parts of the multipart uploads to "
+              "multipart+http:// and multipart+https:// outputs. Object "
+              "storages usually require at least 5 MiB.");
+DEFINE_int32(multipart_upload_parallel_parts, 4,
+             "Maximum number of parts of a multipart upload uploaded in "
+             "parallel.");
+DEFINE_string(object_storage_authorization, "",
+              "Value of the Authorization header of the multipart upload "
+              "requests, e.g. 'Bearer <token>' for Google Cloud Storage.");
+DECLARE_string(user_agent);
+DECLARE_string(https_ca_file);
+DECLARE_int32(http_upload_max_retries);
+DECLARE_int32(http_upload_retry_backoff_ms);
+
+namespace shaka {
+
+namespace {
+
+const char kUserAgentString[] = "shaka-packager-uploader/0.1";
+
+size_t AppendToString(char* ptr,
+                      size_t size,
+                      size_t nmemb,
+                      std::string* response) {
+  const size_t total_size = size * nmemb;
+  response->append(ptr, total_size);
+  return total_size;
+}
+
+// Keeps the value of the ETag header in |etag|.
+size_t ParseETagHeader(char* ptr, size_t size, size_t nmemb, void* etag) {
+  const size_t total_size = size * nmemb;
+  const base::StringPiece header(ptr, total_size);
+  const char kETagHeader[] = "ETag:";
+  if (base::StartsWith(header, kETagHeader,
+                       base::CompareCase::INSENSITIVE_ASCII)) {
+    *static_cast<std::string*>(etag) =
+        base::TrimWhitespaceASCII(header.substr(strlen(kETagHeader)),
+                                  base::TRIM_ALL)
+            .as_string();
+  }
+  return total_size;
+}
+
+// Aborts the transfer when |data|, a WaitableEvent, is signaled.
+int CancelProgressCallback(void* data,
+                           curl_off_t download_total,
+                           curl_off_t download_now,
+                           curl_off_t upload_total,
+                           curl_off_t upload_now) {
+  return static_cast<base::WaitableEvent*>(data)->IsSignaled() ? 1 : 0;
+}
+
+// Returns the text of the |element| XML element of |xml|, or an empty string.
+std::string GetXmlElementText(const std::string& xml,
+                              const std::string& element) {
+  const std::string start_tag = "<" + element + ">";
+  const size_t start = xml.find(start_tag);
+  if (start == std::string::npos)
+    return "";
+  const size_t text_start = start + start_tag.size();
+  const size_t end = xml.find("</" + element + ">", text_start);
+  if (end == std::string::npos)
+    return "";
+  return xml.substr(text_start, end - text_start);
+}
+
+}  // namespace
+
+MultipartUploadFile::MultipartUploadFile(const char* file_name,
+                                         const char* mode,
+                                         bool https)
+    : File(file_name),
+      file_mode_(mode),
+      resource_url_((https ? "https://" : "http://") + std::string(file_name)),
+      connection_key_(GetConnectionKey(resource_url_)),
+      part_size_(std::max<uint64_t>(1, FLAGS_multipart_upload_part_size)),
+      max_parts_running_(std::max(1, FLAGS_multipart_upload_parallel_parts)),
+      cancel_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                    base::WaitableEvent::InitialState::NOT_SIGNALED),
+      part_uploaded_(&lock_) {}
+
+MultipartUploadFile::~MultipartUploadFile() {}
+
+bool MultipartUploadFile::Open() {
+  if (file_mode_ != "w") {
+    LOG(ERROR) << "MultipartUploadFile only supports write mode.";
+    return false;
+  }
+  std::string response;
+  if (!SendRequest("POST", "uploads", "", &response, nullptr).ok())
+    return false;
+  upload_id_ = GetXmlElementText(response, "UploadId");
+  if (upload_id_.empty()) {
+    LOG(ERROR) << "No UploadId in the response to the initiation of the "
+                  "multipart upload of "
+               << resource_url_ << ": " << response;
+    return false;
+  }
+  VLOG(1) << "Started multipart upload " << upload_id_ << " of "
+          << resource_url_;
+  return true;
+}
+
+bool MultipartUploadFile::Close() {
+  VLOG(1) << "Closing " << resource_url_ << ".";
+  // The first part is uploaded last unless it was uploaded already and left
+  // unchanged since.
+  if (!first_part_uploaded_ || first_part_modified_)
+    StartPartUpload(1, std::make_shared<std::string>(first_part_));
+  if (!current_part_.empty()) {
+    StartPartUpload(current_part_index_ + 1,
+                    std::make_shared<std::string>(std::move(current_part_)));
+  }
+  bool upload_failed = false;
+  {
+    base::AutoLock auto_lock(lock_);
+    while (!parts_running_.empty())
+      part_uploaded_.Wait();
+    upload_failed = upload_failed_;
+  }
+  bool result = false;
+  if (upload_failed)
+    AbortUpload();
+  else
+    result = CompleteUpload();
+  delete this;
+  return result;
+}
+
+int64_t MultipartUploadFile::Read(void* buffer, uint64_t length) {
+  LOG(WARNING) << "MultipartUploadFile does not support Read().";
+  return -1;
+}
+
+int64_t MultipartUploadFile::Write(const void* buffer, uint64_t length) {
+  {
+    base::AutoLock auto_lock(lock_);
+    if (upload_failed_)
+      return -1;
+  }
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_left = length;
+  while (bytes_left > 0) {
+    const uint64_t part_index = position_ / part_size_;
+    const uint64_t part_offset = position_ % part_size_;
+    std::string* part = nullptr;
+    if (part_index == 0) {
+      part = &first_part_;
+    } else if (part_index == current_part_index_) {
+      part = &current_part_;
+    } else {
+      LOG(ERROR) << "Cannot write to " << resource_url_ << " at "
+                 << position_ << ", in a part already uploaded.";
+      return -1;
+    }
+    const uint64_t bytes_to_write =
+        std::min(bytes_left, part_size_ - part_offset);
+    if (part_offset + bytes_to_write > part->size())
+      part->resize(part_offset + bytes_to_write);
+    memcpy(&(*part)[part_offset], data, bytes_to_write);
+    data += bytes_to_write;
+    bytes_left -= bytes_to_write;
+    position_ += bytes_to_write;
+    size_ = std::max(size_, position_);
+    if (part_index == 0 && first_part_uploaded_)
+      first_part_modified_ = true;
+
+    // Upload the part being written once it is full.
+    const bool part_full = part_offset + bytes_to_write == part_size_;
+    if (part_full && position_ == size_ && part_index == current_part_index_) {
+      if (part_index == 0) {
+        first_part_uploaded_ = true;
+        first_part_modified_ = false;
+        StartPartUpload(1, std::make_shared<std::string>(first_part_));
+      } else {
+        StartPartUpload(
+            part_index + 1,
+            std::make_shared<std::string>(std::move(current_part_)));
+        current_part_.clear();
+      }
+      ++current_part_index_;
+    }
+  }
+  return length;
+}
+
+int64_t MultipartUploadFile::Size() {
+  return size_;
+}
+
+bool MultipartUploadFile::Flush() {
+  // The parts are uploaded as soon as they are full. The object is only
+  // available once the upload is completed anyway.
+  return true;
+}
+
+bool MultipartUploadFile::Seek(uint64_t position) {
+  // Only the first part and the part being written can be written.
+  if (position > size_ ||
+      (position >= part_size_ &&
+       position < current_part_index_ * part_size_)) {
+    VLOG(1) << "MultipartUploadFile cannot seek to " << position
+            << ", in a part already uploaded.";
+    return false;
+  }
+  position_ = position;
+  return true;
+}
+
+bool MultipartUploadFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+void MultipartUploadFile::Abort() {
+  cancel_event_.Signal();
+  base::AutoLock auto_lock(lock_);
+  upload_failed_ = true;
+}
+
+void MultipartUploadFile::InjectRequestFunctionForTesting(
+    RequestFunction request_function) {
+  request_function_ = std::move(request_function);
+}
+
+Status MultipartUploadFile::SendRequest(const std::string& method,
+                                        const std::string& query,
+                                        const std::string& body,
+                                        std::string* response,
+                                        std::string* etag) {
+  const std::string url =
+      resource_url_ +
+      (resource_url_.find('?') == std::string::npos ? "?" : "&") + query;
+  if (request_function_)
+    return request_function_(method, url, body, response, etag);
+  return SendCurlRequest(method, url, body, response, etag);
+}
+
+Status MultipartUploadFile::SendCurlRequest(const std::string& method,
+                                            const std::string& url,
+                                            const std::string& body,
+                                            std::string* response,
+                                            std::string* etag) {
+  ScopedCurl scoped_curl = CurlHandlePool::Instance()->Acquire(connection_key_);
+  if (!scoped_curl)
+    return Status(error::HTTP_FAILURE, "curl_easy_init() failed.");
+  CURL* curl = scoped_curl.get();
+
+  response->clear();
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+  if (method != "DELETE") {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.data());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     static_cast<curl_off_t>(body.size()));
+  }
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, FLAGS_user_agent.empty()
+                                                ? kUserAgentString
+                                                : FLAGS_user_agent.c_str());
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+  if (etag) {
+    etag->clear();
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, ParseETagHeader);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, etag);
+  }
+  if (!FLAGS_https_ca_file.empty())
+    curl_easy_setopt(curl, CURLOPT_CAINFO, FLAGS_https_ca_file.c_str());
+  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, CancelProgressCallback);
+  curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &cancel_event_);
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+  struct curl_slist* headers = nullptr;
+  headers = curl_slist_append(headers, method == "PUT"
+                                           ? "Content-Type: "
+                                             "application/octet-stream"
+                                           : "Content-Type: application/xml");
+  if (!FLAGS_object_storage_authorization.empty()) {
+    headers = curl_slist_append(
+        headers,
+        ("Authorization: " + FLAGS_object_storage_authorization).c_str());
+  }
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+  const CURLcode res = curl_easy_perform(curl);
+  Status status;
+  if (res != CURLE_OK) {
+    std::string error_message = method + " request for " + url +
+                                " failed. Reason: " + curl_easy_strerror(res) +
+                                ".";
+    if (res == CURLE_HTTP_RETURNED_ERROR) {
+      long response_code = 0;
+      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+      error_message +=
+          " Response code: " + base::Int64ToString(response_code) + ".";
+    }
+    LOG(ERROR) << error_message;
+    status = Status(
+        res == CURLE_OPERATION_TIMEDOUT ? error::TIME_OUT : error::HTTP_FAILURE,
+        error_message);
+  }
+  curl_slist_free_all(headers);
+  CurlHandlePool::Instance()->Release(connection_key_, std::move(scoped_curl));
+  return status;
+}
+
+void MultipartUploadFile::StartPartUpload(int part_number,
+                                          std::shared_ptr<std::string> data) {
+  base::AutoLock auto_lock(lock_);
+  // The first part is uploaded again on Close() if it was rewritten.
+  while (parts_running_.size() >= static_cast<size_t>(max_parts_running_) ||
+         parts_running_.count(part_number) > 0) {
+    part_uploaded_.Wait();
+  }
+  parts_running_.insert(part_number);
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&MultipartUploadFile::UploadPart, base::Unretained(this),
+                 part_number, data),
+      true  // task_is_slow
+  );
+}
+
+void MultipartUploadFile::UploadPart(int part_number,
+                                     std::shared_ptr<std::string> data) {
+  const std::string query = "partNumber=" + base::IntToString(part_number) +
+                            "&uploadId=" + upload_id_;
+  base::TimeDelta backoff =
+      base::TimeDelta::FromMilliseconds(FLAGS_http_upload_retry_backoff_ms);
+  std::string etag;
+  Status status;
+  for (int attempt = 0;; ++attempt) {
+    VLOG(2) << "Uploading part " << part_number << " of " << resource_url_
+            << ", size " << data->size() << ", attempt " << attempt + 1;
+    std::string response;
+    status = SendRequest("PUT", query, *data, &response, &etag);
+    if (status.ok() && etag.empty()) {
+      status = Status(error::HTTP_FAILURE,
+                      "No ETag in the response to the upload of part " +
+                          base::IntToString(part_number) + " of " +
+                          resource_url_);
+      LOG(ERROR) << status;
+    }
+    if (status.ok() || attempt >= FLAGS_http_upload_max_retries ||
+        cancel_event_.IsSignaled()) {
+      break;
+    }
+    LOG(WARNING) << "Retrying upload of part " << part_number << " of "
+                 << resource_url_ << " in " << backoff.InMilliseconds()
+                 << " ms.";
+    // Stop waiting early if the upload is aborted.
+    if (cancel_event_.TimedWait(backoff))
+      break;
+    backoff *= 2;
+  }
+
+  base::AutoLock auto_lock(lock_);
+  if (status.ok())
+    etags_[part_number] = etag;
+  else
+    upload_failed_ = true;
+  parts_running_.erase(part_number);
+  part_uploaded_.Broadcast();
+}
+
+bool MultipartUploadFile::CompleteUpload() {
+  std::string body = "<CompleteMultipartUpload>";
+  for (const auto& part : etags_) {
+    body += "<Part><PartNumber>" + base::IntToString(part.first) +
+            "</PartNumber><ETag>" + part.second + "</ETag></Part>";
+  }
+  body += "</CompleteMultipartUpload>";
+  std::string response;
+  const Status status =
+      SendRequest("POST", "uploadId=" + upload_id_, body, &response, nullptr);
+  // The completion can fail after the response headers are sent, with an
+  // Error element in the response body.
+  if (!status.ok() || response.find("<Error>") != std::string::npos) {
+    LOG(ERROR) << "Failed to complete the multipart upload of "
+               << resource_url_ << ": " << response;
+    AbortUpload();
+    return false;
+  }
+  VLOG(1) << "Completed multipart upload of " << resource_url_ << " in "
+          << etags_.size() << " parts, size " << size_;
+  return true;
+}
+
+void MultipartUploadFile::AbortUpload() {
+  LOG(WARNING) << "Aborting multipart upload of " << resource_url_;
+  // The requests of the parts are not needed anymore, but the request
+  // aborting the upload must not be cancelled.
+  cancel_event_.Reset();
+  std::string response;
+  SendRequest("DELETE", "uploadId=" + upload_id_, "", &response, nullptr);
+}
+
+}  // namespace shaka
@@ -0,0 +1,134 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_MULTIPART_UPLOAD_FILE_H_
+#define PACKAGER_FILE_MULTIPART_UPLOAD_FILE_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/file/file.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+/// Uploads a file to an object storage, e.g. Amazon S3 or Google Cloud
+/// Storage, with the S3 multipart upload API. The parts of
+/// --multipart_upload_part_size bytes are uploaded in parallel as the data is
+/// written, each of them retried on failure, and the upload is completed on
+/// Close().
+/// The file can be seeked back to its first part, e.g. to write the header of
+/// a single segment MP4 output once the media is written. The first part is
+/// retained until the file is closed and uploaded again, which replaces it,
+/// if it is rewritten after being uploaded.
+class MultipartUploadFile : public File {
+ public:
+  /// @param file_name is the url of the object, without the scheme.
+  /// @param mode is the file access mode. Only "w" is supported.
+  /// @param https is true to use https instead of http.
+  MultipartUploadFile(const char* file_name, const char* mode, bool https);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  void Abort() override;
+  /// @}
+
+  /// @return The url of the object.
+  const std::string& resource_url() const { return resource_url_; }
+
+ protected:
+  ~MultipartUploadFile() override;
+
+  bool Open() override;
+
+ private:
+  friend class MultipartUploadFileTest;
+
+  // Sends a |method| request to |url| with |body|, and returns the response
+  // body in |response| and the ETag header of the response in |etag|, if not
+  // null. Called concurrently for the parts.
+  typedef std::function<Status(const std::string& method,
+                               const std::string& url,
+                               const std::string& body,
+                               std::string* response,
+                               std::string* etag)>
+      RequestFunction;
+
+  MultipartUploadFile(const MultipartUploadFile&) = delete;
+  MultipartUploadFile& operator=(const MultipartUploadFile&) = delete;
+
+  // Testing injection, to send the requests to a fake object storage.
+  void InjectRequestFunctionForTesting(RequestFunction request_function);
+
+  // Sends a |method| request to |resource_url_| followed by |query|. See
+  // RequestFunction for the other parameters.
+  Status SendRequest(const std::string& method,
+                     const std::string& query,
+                     const std::string& body,
+                     std::string* response,
+                     std::string* etag);
+  Status SendCurlRequest(const std::string& method,
+                         const std::string& url,
+                         const std::string& body,
+                         std::string* response,
+                         std::string* etag);
+
+  // Starts the upload of |data| as part |part_number|, once fewer than
+  // --multipart_upload_parallel_parts parts are being uploaded and the
+  // previous upload of the same part, if any, has completed.
+  void StartPartUpload(int part_number, std::shared_ptr<std::string> data);
+  void UploadPart(int part_number, std::shared_ptr<std::string> data);
+  bool CompleteUpload();
+  void AbortUpload();
+
+  const std::string file_mode_;
+  const std::string resource_url_;
+  const std::string connection_key_;
+  const uint64_t part_size_;
+  const int max_parts_running_;
+  std::string upload_id_;
+  RequestFunction request_function_;
+
+  uint64_t position_ = 0;
+  uint64_t size_ = 0;
+  // The first part, retained until the file is closed.
+  std::string first_part_;
+  bool first_part_uploaded_ = false;
+  // Set when |first_part_| is written after it was uploaded.
+  bool first_part_modified_ = false;
+  // The part being written, after the first part.
+  std::string current_part_;
+  uint64_t current_part_index_ = 0;
+
+  // Signaled when the upload is aborted, which cancels the part uploads.
+  base::WaitableEvent cancel_event_;
+  base::Lock lock_;
+  base::ConditionVariable part_uploaded_;
+  // The numbers of the parts being uploaded. A part is not uploaded again
+  // before its previous upload completes, so the object storage keeps the
+  // data of the last upload, whose ETag is in |etags_|.
+  std::set<int> parts_running_;
+  bool upload_failed_ = false;
+  // Part number -> ETag of the uploaded parts.
+  std::map<int, std::string> etags_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_MULTIPART_UPLOAD_FILE_H_
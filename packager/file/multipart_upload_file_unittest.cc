@@ -0,0 +1,294 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/multipart_upload_file.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/time/time.h"
+
+DECLARE_uint64(multipart_upload_part_size);
+DECLARE_int32(http_upload_max_retries);
+DECLARE_int32(http_upload_retry_backoff_ms);
+
+namespace shaka {
+namespace {
+
+const char kObjectName[] = "storage.example.com/bucket/object.mp4";
+const char kUploadId[] = "upload-1";
+const uint64_t kPartSize = 4;
+
+// Returns the value of the |name| parameter of the query of |url|.
+std::string GetQueryParameter(const std::string& url, const std::string& name) {
+  const std::string key = name + "=";
+  size_t start = url.find("?" + key);
+  if (start == std::string::npos)
+    start = url.find("&" + key);
+  if (start == std::string::npos)
+    return "";
+  start += key.size() + 1;
+  const size_t end = url.find('&', start);
+  return url.substr(start, end == std::string::npos ? end : end - start);
+}
+
+// An object storage implementing the S3 multipart upload API in memory.
+class FakeObjectStorage {
+ public:
+  struct Request {
+    std::string method;
+    std::string url;
+    std::string body;
+  };
+
+  Status HandleRequest(const std::string& method,
+                       const std::string& url,
+                       const std::string& body,
+                       std::string* response,
+                       std::string* etag) {
+    {
+      base::AutoLock auto_lock(lock_);
+      requests_.push_back({method, url, body});
+    }
+    if (method == "POST" && GetQueryParameter(url, "uploadId").empty()) {
+      *response = "<InitiateMultipartUploadResult><UploadId>" +
+                  std::string(kUploadId) +
+                  "</UploadId></InitiateMultipartUploadResult>";
+      return Status::OK;
+    }
+    if (method == "POST") {
+      *response = complete_response_;
+      return Status::OK;
+    }
+    if (method == "DELETE")
+      return Status::OK;
+
+    int part_number = 0;
+    EXPECT_TRUE(base::StringToInt(GetQueryParameter(url, "partNumber"),
+                                  &part_number));
+    EXPECT_EQ(kUploadId, GetQueryParameter(url, "uploadId"));
+    int attempt = 0;
+    {
+      base::AutoLock auto_lock(lock_);
+      attempt = ++num_attempts_[part_number];
+      if (!parts_uploading_.insert(part_number).second)
+        overlapping_uploads_ = true;
+    }
+    // Keeps the upload running for a while, so another upload of the part
+    // would overlap with it.
+    if (part_number == slow_part_number_ && attempt == 1)
+      base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(50));
+
+    base::AutoLock auto_lock(lock_);
+    parts_uploading_.erase(part_number);
+    if (attempt <= num_failures_[part_number])
+      return Status(error::HTTP_FAILURE, "Injected failure.");
+    parts_[part_number] = body;
+    *etag = "\"" + base::IntToString(part_number) + "-" +
+            base::IntToString(attempt) + "\"";
+    return Status::OK;
+  }
+
+  // Fails the first |num_failures| uploads of |part_number|.
+  void FailPartUploads(int part_number, int num_failures) {
+    num_failures_[part_number] = num_failures;
+  }
+
+  void set_slow_part_number(int part_number) {
+    slow_part_number_ = part_number;
+  }
+
+  void set_complete_response(const std::string& response) {
+    complete_response_ = response;
+  }
+
+  // Only valid once the file is closed.
+  const std::map<int, std::string>& parts() const { return parts_; }
+  int num_attempts(int part_number) { return num_attempts_[part_number]; }
+  bool overlapping_uploads() const { return overlapping_uploads_; }
+
+  // Returns the body of the request completing the upload, or an empty string.
+  std::string GetCompleteRequestBody() const {
+    for (const Request& request : requests_) {
+      if (request.method == "POST" &&
+          !GetQueryParameter(request.url, "uploadId").empty()) {
+        return request.body;
+      }
+    }
+    return "";
+  }
+
+  bool HasRequest(const std::string& method) const {
+    for (const Request& request : requests_) {
+      if (request.method == method)
+        return true;
+    }
+    return false;
+  }
+
+ private:
+  base::Lock lock_;
+  std::vector<Request> requests_;
+  std::map<int, std::string> parts_;
+  std::map<int, int> num_attempts_;
+  std::map<int, int> num_failures_;
+  std::set<int> parts_uploading_;
+  bool overlapping_uploads_ = false;
+  int slow_part_number_ = 0;
+  std::string complete_response_ = "<CompleteMultipartUploadResult/>";
+};
+
+}  // namespace
+
+class MultipartUploadFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_multipart_upload_part_size = kPartSize;
+    FLAGS_http_upload_max_retries = 2;
+    FLAGS_http_upload_retry_backoff_ms = 1;
+  }
+
+  // Opens a file uploading to |storage_|.
+  File* OpenFile() {
+    MultipartUploadFile* file =
+        new MultipartUploadFile(kObjectName, "w", false /* https */);
+    file->InjectRequestFunctionForTesting(
+        [this](const std::string& method, const std::string& url,
+               const std::string& body, std::string* response,
+               std::string* etag) {
+          return storage_.HandleRequest(method, url, body, response, etag);
+        });
+    if (!file->Open()) {
+      file->Close();
+      return nullptr;
+    }
+    return file;
+  }
+
+  static bool Write(File* file, const std::string& data) {
+    return file->Write(data.data(), data.size()) ==
+           static_cast<int64_t>(data.size());
+  }
+
+  google::FlagSaver flag_saver_;
+  FakeObjectStorage storage_;
+};
+
+TEST_F(MultipartUploadFileTest, SplitsDataIntoParts) {
+  File* file = OpenFile();
+  ASSERT_TRUE(file);
+  ASSERT_TRUE(Write(file, "012345"));
+  ASSERT_TRUE(Write(file, "6789"));
+  EXPECT_EQ(10, file->Size());
+  ASSERT_TRUE(file->Close());
+
+  const std::map<int, std::string> kExpectedParts = {
+      {1, "0123"}, {2, "4567"}, {3, "89"}};
+  EXPECT_EQ(kExpectedParts, storage_.parts());
+  EXPECT_EQ(
+      "<CompleteMultipartUpload>"
+      "<Part><PartNumber>1</PartNumber><ETag>\"1-1\"</ETag></Part>"
+      "<Part><PartNumber>2</PartNumber><ETag>\"2-1\"</ETag></Part>"
+      "<Part><PartNumber>3</PartNumber><ETag>\"3-1\"</ETag></Part>"
+      "</CompleteMultipartUpload>",
+      storage_.GetCompleteRequestBody());
+  EXPECT_FALSE(storage_.HasRequest("DELETE"));
+}
+
+TEST_F(MultipartUploadFileTest, UploadsFirstPartOnCloseIfNotFull) {
+  File* file = OpenFile();
+  ASSERT_TRUE(file);
+  ASSERT_TRUE(Write(file, "01"));
+  ASSERT_TRUE(file->Close());
+
+  const std::map<int, std::string> kExpectedParts = {{1, "01"}};
+  EXPECT_EQ(kExpectedParts, storage_.parts());
+  EXPECT_EQ(1, storage_.num_attempts(1));
+}
+
+TEST_F(MultipartUploadFileTest, UploadsRewrittenFirstPartAgain) {
+  // The first upload of the first part is still running when the file is
+  // closed.
+  storage_.set_slow_part_number(1);
+  File* file = OpenFile();
+  ASSERT_TRUE(file);
+  ASSERT_TRUE(Write(file, "01234567"));
+  ASSERT_TRUE(file->Seek(0));
+  ASSERT_TRUE(Write(file, "ab"));
+  // Only the first part and the part being written can be written.
+  EXPECT_FALSE(file->Seek(kPartSize));
+  ASSERT_TRUE(file->Close());
+
+  // The second upload starts once the first one completed, so the rewritten
+  // part is kept and completed with its ETag.
+  const std::map<int, std::string> kExpectedParts = {{1, "ab23"},
+                                                     {2, "4567"}};
+  EXPECT_EQ(kExpectedParts, storage_.parts());
+  EXPECT_EQ(2, storage_.num_attempts(1));
+  EXPECT_FALSE(storage_.overlapping_uploads());
+  EXPECT_NE(std::string::npos,
+            storage_.GetCompleteRequestBody().find(
+                "<PartNumber>1</PartNumber><ETag>\"1-2\"</ETag>"));
+}
+
+TEST_F(MultipartUploadFileTest, RetriesFailedPartUploads) {
+  storage_.FailPartUploads(2, 2);
+  File* file = OpenFile();
+  ASSERT_TRUE(file);
+  ASSERT_TRUE(Write(file, "0123456789"));
+  ASSERT_TRUE(file->Close());
+
+  EXPECT_EQ(3, storage_.num_attempts(2));
+  EXPECT_EQ("4567", storage_.parts().at(2));
+  EXPECT_NE(std::string::npos,
+            storage_.GetCompleteRequestBody().find(
+                "<PartNumber>2</PartNumber><ETag>\"2-3\"</ETag>"));
+}
+
+TEST_F(MultipartUploadFileTest, AbortsIfPartUploadFails) {
+  storage_.FailPartUploads(2, 3);
+  File* file = OpenFile();
+  ASSERT_TRUE(file);
+  ASSERT_TRUE(Write(file, "0123456789"));
+  EXPECT_FALSE(file->Close());
+
+  EXPECT_EQ(3, storage_.num_attempts(2));
+  EXPECT_TRUE(storage_.GetCompleteRequestBody().empty());
+  EXPECT_TRUE(storage_.HasRequest("DELETE"));
+}
+
+TEST_F(MultipartUploadFileTest, AbortsIfCompletionFails) {
+  // The completion can fail after the response headers were sent.
+  storage_.set_complete_response("<Error><Code>InternalError</Code></Error>");
+  File* file = OpenFile();
+  ASSERT_TRUE(file);
+  ASSERT_TRUE(Write(file, "0123456789"));
+  EXPECT_FALSE(file->Close());
+
+  EXPECT_FALSE(storage_.GetCompleteRequestBody().empty());
+  EXPECT_TRUE(storage_.HasRequest("DELETE"));
+}
+
+TEST_F(MultipartUploadFileTest, WriteFailsOnceAborted) {
+  File* file = OpenFile();
+  ASSERT_TRUE(file);
+  ASSERT_TRUE(Write(file, "01"));
+  file->Abort();
+  EXPECT_FALSE(Write(file, "23"));
+  EXPECT_FALSE(file->Close());
+  EXPECT_TRUE(storage_.HasRequest("DELETE"));
+}
+
+}  // namespace shaka
@@ -0,0 +1,165 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/null_file.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace {
+
+std::atomic<bool> g_discard_outputs{false};
+std::atomic<uint64_t> g_total_bytes_written{0};
+
+// The sizes of the null files, by name.
+class NullFileSizes {
+ public:
+  static NullFileSizes* GetInstance() {
+    static NullFileSizes instance;
+    return &instance;
+  }
+
+  bool Get(const std::string& file_name, uint64_t* size) {
+    base::AutoLock scoped_lock(lock_);
+    auto iter = sizes_.find(file_name);
+    if (iter == sizes_.end())
+      return false;
+    *size = iter->second;
+    return true;
+  }
+
+  void Set(const std::string& file_name, uint64_t size) {
+    base::AutoLock scoped_lock(lock_);
+    sizes_[file_name] = size;
+  }
+
+  bool Erase(const std::string& file_name) {
+    base::AutoLock scoped_lock(lock_);
+    return sizes_.erase(file_name) > 0;
+  }
+
+  void Clear() {
+    base::AutoLock scoped_lock(lock_);
+    sizes_.clear();
+  }
+
+ private:
+  base::Lock lock_;
+  std::map<std::string, uint64_t> sizes_;
+};
+
+}  // namespace
+
+NullFile::NullFile(const char* file_name, const char* mode)
+    : File(file_name), mode_(mode) {}
+
+NullFile::~NullFile() {}
+
+bool NullFile::Close() {
+  if (mode_ != "r")
+    NullFileSizes::GetInstance()->Set(file_name(), size_);
+  delete this;
+  return true;
+}
+
+int64_t NullFile::Read(void* buffer, uint64_t length) {
+  if (mode_ != "r") {
+    NOTIMPLEMENTED() << "NullFile is not readable in mode " << mode_;
+    return -1;
+  }
+  const uint64_t bytes_read =
+      std::min(length, size_ - std::min(size_, position_));
+  memset(buffer, 0, bytes_read);
+  position_ += bytes_read;
+  return bytes_read;
+}
+
+int64_t NullFile::Write(const void* buffer, uint64_t length) {
+  if (mode_ == "r") {
+    NOTIMPLEMENTED() << "NullFile is not writable in mode " << mode_;
+    return -1;
+  }
+  position_ += length;
+  size_ = std::max(size_, position_);
+  g_total_bytes_written.fetch_add(length, std::memory_order_relaxed);
+  return length;
+}
+
+int64_t NullFile::Size() {
+  return size_;
+}
+
+bool NullFile::Flush() {
+  return true;
+}
+
+bool NullFile::Seek(uint64_t position) {
+  position_ = position;
+  return true;
+}
+
+bool NullFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+bool NullFile::Open() {
+  if (mode_ == "r")
+    return NullFileSizes::GetInstance()->Get(file_name(), &size_);
+  if (mode_ == "a")
+    NullFileSizes::GetInstance()->Get(file_name(), &size_);
+  position_ = size_;
+  return true;
+}
+
+// static
+void NullFile::set_discard_outputs(bool discard_outputs) {
+  g_discard_outputs.store(discard_outputs);
+}
+
+// static
+bool NullFile::discard_outputs() {
+  return g_discard_outputs.load();
+}
+
+// static
+bool NullFile::Exists(const char* file_name) {
+  uint64_t size = 0;
+  return NullFileSizes::GetInstance()->Get(file_name, &size);
+}
+
+// static
+bool NullFile::Delete(const char* file_name) {
+  NullFileSizes::GetInstance()->Erase(file_name);
+  return true;
+}
+
+// static
+bool NullFile::WriteFileAtomically(const char* file_name,
+                                   const std::string& contents) {
+  NullFileSizes::GetInstance()->Set(file_name, contents.size());
+  g_total_bytes_written.fetch_add(contents.size(), std::memory_order_relaxed);
+  return true;
+}
+
+// static
+void NullFile::DeleteAll() {
+  NullFileSizes::GetInstance()->Clear();
+}
+
+// static
+uint64_t NullFile::total_bytes_written() {
+  return g_total_bytes_written.load(std::memory_order_relaxed);
+}
+
+}  // namespace shaka
@@ -0,0 +1,73 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_NULL_FILE_H_
+#define PACKAGER_FILE_NULL_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Implements a File which discards the data written to it and only counts
+/// the bytes, e.g. to measure the compute throughput of the packaging without
+/// the cost of the storage. The sizes of the files are remembered, so a file
+/// written and then read back, e.g. a temporary file, reads as zeros.
+class NullFile : public File {
+ public:
+  /// @param file_name is the name of the file, without the "null://" prefix.
+  /// @param mode C string containing a file access mode, "r", "w" or "a".
+  NullFile(const char* file_name, const char* mode);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+  /// Discard all the outputs of the process, i.e. the files opened for
+  /// writing, written atomically or deleted, as if their names had the
+  /// "null://" prefix. The files written since are read back as null files;
+  /// the other files are still read normally.
+  static void set_discard_outputs(bool discard_outputs);
+  static bool discard_outputs();
+
+  /// @return whether @a file_name was written as a null file and not deleted.
+  static bool Exists(const char* file_name);
+  static bool Delete(const char* file_name);
+  static bool WriteFileAtomically(const char* file_name,
+                                  const std::string& contents);
+  /// Forget all the files. Used in tests.
+  static void DeleteAll();
+
+  /// @return the number of bytes written to all the null files.
+  static uint64_t total_bytes_written();
+
+ protected:
+  ~NullFile() override;
+
+  bool Open() override;
+
+ private:
+  NullFile(const NullFile&) = delete;
+  NullFile& operator=(const NullFile&) = delete;
+
+  const std::string mode_;
+  uint64_t position_ = 0;
+  uint64_t size_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_NULL_FILE_H_
@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/null_file.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+
+class NullFileTest : public testing::Test {
+ protected:
+  void TearDown() override {
+    NullFile::set_discard_outputs(false);
+    NullFile::DeleteAll();
+    MemoryFile::DeleteAll();
+  }
+};
+
+TEST_F(NullFileTest, CountsBytes) {
+  const uint64_t bytes_written = NullFile::total_bytes_written();
+  std::unique_ptr<File, FileCloser> file(File::Open("null://output", "w"));
+  ASSERT_TRUE(file);
+  ASSERT_EQ(10, file->Write("0123456789", 10));
+  // Rewrite the beginning, e.g. the header of a single segment MP4 output.
+  ASSERT_TRUE(file->Seek(0));
+  ASSERT_EQ(2, file->Write("ab", 2));
+  EXPECT_EQ(10, file->Size());
+  ASSERT_TRUE(file.release()->Close());
+  EXPECT_EQ(bytes_written + 12, NullFile::total_bytes_written());
+}
+
+TEST_F(NullFileTest, ReadsBackZeros) {
+  ASSERT_TRUE(File::WriteStringToFile("null://temp", "0123"));
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString("null://temp", &content));
+  EXPECT_EQ(std::string(4, '\0'), content);
+
+  ASSERT_TRUE(File::Delete("null://temp"));
+  EXPECT_FALSE(File::ReadFileToString("null://temp", &content));
+}
+
+TEST_F(NullFileTest, DiscardOutputs) {
+  ASSERT_TRUE(File::WriteStringToFile("memory://input", "input"));
+  NullFile::set_discard_outputs(true);
+
+  ASSERT_TRUE(File::WriteStringToFile("memory://output", "output"));
+  ASSERT_TRUE(File::WriteFileAtomically("memory://manifest", "manifest"));
+  // The inputs are still read.
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString("memory://input", &content));
+  EXPECT_EQ("input", content);
+  // The outputs are read back as null files.
+  content.clear();
+  ASSERT_TRUE(File::ReadFileToString("memory://output", &content));
+  EXPECT_EQ(std::string(6, '\0'), content);
+
+  NullFile::set_discard_outputs(false);
+  EXPECT_FALSE(File::ReadFileToString("memory://output", &content));
+  EXPECT_FALSE(File::ReadFileToString("memory://manifest", &content));
+}
+
+}  // namespace shaka
@@ -0,0 +1,149 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/precompressed_file_writer.h"
+
+#include <gflags/gflags.h>
+#include <zlib.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/file.h"
+#include "packager/metrics/metrics.h"
+
+DEFINE_bool(gzip_manifests,
+            false,
+            "Also write the gzip variant of the MPD and of the HLS playlists, "
+            "with a '.gz' suffix, for the server to deliver them "
+            "precompressed. They are compressed on a background thread, so "
+            "they may be written shortly after the manifests.");
+
+namespace shaka {
+namespace {
+
+const char kGzipSuffix[] = ".gz";
+// Adding 16 to the window bits writes a gzip header and trailer instead of a
+// zlib wrapper.
+const int kGzipWindowBits = 15 + 16;
+const int kDefaultMemLevel = 8;
+const size_t kChunkSize = 64 * 1024;
+
+}  // namespace
+
+PrecompressedFileWriter* PrecompressedFileWriter::GetInstance() {
+  static PrecompressedFileWriter instance;
+  return &instance;
+}
+
+PrecompressedFileWriter::PrecompressedFileWriter() : task_done_(&lock_) {
+  backlog_gauge_id_ = Metrics::GetInstance()->AddGaugeFunction(
+      "shaka_precompressed_manifest_backlog",
+      "Manifests queued for compression or being compressed.", {},
+      [this]() { return static_cast<double>(backlog()); });
+}
+
+PrecompressedFileWriter::~PrecompressedFileWriter() {
+  Flush();
+  Metrics::GetInstance()->RemoveGaugeFunction(backlog_gauge_id_);
+  if (stream_) {
+    deflateEnd(stream_);
+    delete stream_;
+  }
+}
+
+void PrecompressedFileWriter::Write(const std::string& file_name,
+                                    const std::string& content) {
+  if (!FLAGS_gzip_manifests)
+    return;
+  base::AutoLock scoped_lock(lock_);
+  pending_files_[file_name] = content;
+  if (task_running_)
+    return;
+  task_running_ = true;
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&PrecompressedFileWriter::WriteTask, base::Unretained(this)),
+      true /* task_is_slow */);
+}
+
+void PrecompressedFileWriter::Flush() {
+  base::AutoLock scoped_lock(lock_);
+  while (task_running_)
+    task_done_.Wait();
+}
+
+size_t PrecompressedFileWriter::backlog() const {
+  base::AutoLock scoped_lock(lock_);
+  return pending_files_.size() + num_files_in_progress_;
+}
+
+bool PrecompressedFileWriter::Compress(const std::string& content,
+                                       std::string* compressed) {
+  DCHECK(compressed);
+  base::AutoLock scoped_lock(stream_lock_);
+  if (!stream_) {
+    stream_ = new z_stream();
+    if (deflateInit2(stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     kGzipWindowBits, kDefaultMemLevel,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      LOG(ERROR) << "Failed to initialize the deflate stream.";
+      delete stream_;
+      stream_ = nullptr;
+      return false;
+    }
+  } else if (deflateReset(stream_) != Z_OK) {
+    LOG(ERROR) << "Failed to reset the deflate stream.";
+    return false;
+  }
+
+  compressed->clear();
+  stream_->next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+  stream_->avail_in = static_cast<uInt>(content.size());
+  int result = Z_OK;
+  while (result == Z_OK) {
+    const size_t offset = compressed->size();
+    compressed->resize(offset + kChunkSize);
+    stream_->next_out = reinterpret_cast<Bytef*>(&(*compressed)[offset]);
+    stream_->avail_out = static_cast<uInt>(kChunkSize);
+    result = deflate(stream_, Z_FINISH);
+    compressed->resize(offset + kChunkSize - stream_->avail_out);
+  }
+  if (result != Z_STREAM_END) {
+    LOG(ERROR) << "Failed to compress: " << result;
+    return false;
+  }
+  return true;
+}
+
+void PrecompressedFileWriter::WriteTask() {
+  base::AutoLock scoped_lock(lock_);
+  while (!pending_files_.empty()) {
+    std::map<std::string, std::string> batch;
+    batch.swap(pending_files_);
+    num_files_in_progress_ = batch.size();
+    {
+      base::AutoUnlock scoped_unlock(lock_);
+      std::string compressed;
+      for (const auto& file : batch) {
+        const std::string file_name = file.first + kGzipSuffix;
+        VLOG(2) << "Writing " << file_name;
+        if (!Compress(file.second, &compressed) ||
+            !File::WriteFileAtomically(file_name.c_str(), compressed)) {
+          LOG(WARNING) << "Failed to write " << file_name;
+        }
+      }
+    }
+    num_files_in_progress_ = 0;
+  }
+  task_running_ = false;
+  task_done_.Broadcast();
+}
+
+}  // namespace shaka
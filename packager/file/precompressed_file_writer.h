@@ -0,0 +1,74 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_PRECOMPRESSED_FILE_WRITER_H_
+#define PACKAGER_FILE_PRECOMPRESSED_FILE_WRITER_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+struct z_stream_s;
+
+namespace shaka {
+
+/// Writes the gzip variants of the manifests, with a ".gz" suffix, with
+/// --gzip_manifests, so that the server can deliver them precompressed
+/// instead of compressing them for each request. They are compressed on a
+/// background thread with the same deflate stream. Only the latest content
+/// queued for a file is compressed, e.g. if a live manifest is updated again
+/// before its previous update is compressed. Thread safe.
+class PrecompressedFileWriter {
+ public:
+  /// @return the process-wide instance.
+  static PrecompressedFileWriter* GetInstance();
+
+  /// Queue @a content to be compressed and written to @a file_name with a
+  /// ".gz" suffix, with --gzip_manifests. Does nothing otherwise.
+  void Write(const std::string& file_name, const std::string& content);
+
+  /// Wait until the files queued are written, or failed to be written.
+  void Flush();
+
+  /// @return the number of files queued or being written.
+  size_t backlog() const;
+
+  /// Compress @a content in the gzip format.
+  /// @return true on success.
+  bool Compress(const std::string& content, std::string* compressed);
+
+ private:
+  PrecompressedFileWriter();
+  ~PrecompressedFileWriter();
+
+  PrecompressedFileWriter(const PrecompressedFileWriter&) = delete;
+  PrecompressedFileWriter& operator=(const PrecompressedFileWriter&) = delete;
+
+  // Compress and write the files queued, batch by batch, until there are none
+  // left.
+  void WriteTask();
+
+  mutable base::Lock lock_;
+  // Signaled when the background task finishes.
+  base::ConditionVariable task_done_;
+  // File name -> latest content queued.
+  std::map<std::string, std::string> pending_files_;
+  size_t num_files_in_progress_ = 0;
+  bool task_running_ = false;
+  int64_t backlog_gauge_id_ = 0;
+
+  // The deflate stream reused by Compress().
+  base::Lock stream_lock_;
+  z_stream_s* stream_ = nullptr;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_PRECOMPRESSED_FILE_WRITER_H_
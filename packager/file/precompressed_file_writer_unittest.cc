@@ -0,0 +1,97 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/precompressed_file_writer.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include "packager/file/file.h"
+
+DECLARE_bool(gzip_manifests);
+
+namespace shaka {
+namespace {
+
+const char kFileName[] = "memory://precompressed_manifest.mpd";
+const char kCompressedFileName[] = "memory://precompressed_manifest.mpd.gz";
+
+// Decompresses gzip |compressed| into |content|.
+bool Decompress(const std::string& compressed, std::string* content) {
+  z_stream stream = {};
+  // 15 + 16 window bits only accept the gzip format.
+  if (inflateInit2(&stream, 15 + 16) != Z_OK)
+    return false;
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(
+      compressed.data()));
+  stream.avail_in = static_cast<uInt>(compressed.size());
+  content->clear();
+  int result = Z_OK;
+  char buffer[1024];
+  while (result == Z_OK) {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    result = inflate(&stream, Z_NO_FLUSH);
+    content->append(buffer, sizeof(buffer) - stream.avail_out);
+  }
+  inflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+std::string CreateContent(const std::string& line) {
+  std::string content;
+  for (int i = 0; i < 1000; ++i)
+    content += line + std::to_string(i) + "\n";
+  return content;
+}
+
+}  // namespace
+
+TEST(PrecompressedFileWriterTest, CompressRoundTrip) {
+  PrecompressedFileWriter* writer = PrecompressedFileWriter::GetInstance();
+  const std::string content = CreateContent("<S t=\"0\" d=\"90000\"/>");
+  std::string compressed;
+  ASSERT_TRUE(writer->Compress(content, &compressed));
+  EXPECT_LT(compressed.size(), content.size());
+
+  std::string decompressed;
+  ASSERT_TRUE(Decompress(compressed, &decompressed));
+  EXPECT_EQ(content, decompressed);
+
+  // The deflate stream is reused for the next file.
+  ASSERT_TRUE(writer->Compress("", &compressed));
+  ASSERT_TRUE(Decompress(compressed, &decompressed));
+  EXPECT_EQ("", decompressed);
+}
+
+TEST(PrecompressedFileWriterTest, WritesLatestContent) {
+  FLAGS_gzip_manifests = true;
+  PrecompressedFileWriter* writer = PrecompressedFileWriter::GetInstance();
+  writer->Write(kFileName, CreateContent("first"));
+  writer->Write(kFileName, CreateContent("second"));
+  writer->Flush();
+  FLAGS_gzip_manifests = false;
+  EXPECT_EQ(0u, writer->backlog());
+
+  std::string compressed;
+  ASSERT_TRUE(File::ReadFileToString(kCompressedFileName, &compressed));
+  std::string decompressed;
+  ASSERT_TRUE(Decompress(compressed, &decompressed));
+  EXPECT_EQ(CreateContent("second"), decompressed);
+  ASSERT_TRUE(File::Delete(kCompressedFileName));
+}
+
+TEST(PrecompressedFileWriterTest, DisabledWithoutFlag) {
+  PrecompressedFileWriter* writer = PrecompressedFileWriter::GetInstance();
+  writer->Write(kFileName, CreateContent("content"));
+  writer->Flush();
+
+  std::string compressed;
+  EXPECT_FALSE(File::ReadFileToString(kCompressedFileName, &compressed));
+}
+
+}  // namespace shaka
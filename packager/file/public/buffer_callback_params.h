@@ -7,10 +7,36 @@
 #ifndef PACKAGER_FILE_PUBLIC_BUFFER_CALLBACK_PARAMS_H_
 #define PACKAGER_FILE_PUBLIC_BUFFER_CALLBACK_PARAMS_H_
 
+#include <stdint.h>
+
 #include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace shaka {
 
+/// Receives the outputs of the packager in memory, in buffers which are not
+/// copied again once delivered.
+class OutputSink {
+ public:
+  virtual ~OutputSink() = default;
+
+  /// Called with the data written to an output since the previous call. The
+  /// data is delivered when the output is flushed, e.g. for each chunk with
+  /// low latency chunked output, and when it is closed, with @a is_complete
+  /// set. Segments are usually delivered whole, and manifests always are, on
+  /// each update. Called on the threads writing the outputs, possibly
+  /// concurrently for different outputs.
+  /// @param name is the name of the output, i.e. the file name without the
+  ///        callback prefix.
+  /// @param data is the data, which may be empty if @a is_complete is set.
+  /// @param is_complete is set on the last call for the output.
+  virtual void OnOutput(const std::string& name,
+                        std::shared_ptr<const std::vector<uint8_t>> data,
+                        bool is_complete) = 0;
+};
+
 /// Buffer callback params.
 struct BufferCallbackParams {
   /// If this function is specified, packager treats @a StreamDescriptor.input
@@ -28,6 +54,10 @@ struct BufferCallbackParams {
   std::function<
       int64_t(const std::string& name, const void* buffer, uint64_t size)>
       write_func;
+  /// If this is set, the outputs are handled as with @a write_func, but the
+  /// data is delivered to the sink in whole buffers instead of on each write.
+  /// Takes precedence over @a write_func.
+  std::shared_ptr<OutputSink> output_sink;
 };
 
 }  // namespace shaka
@@ -0,0 +1,64 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/replay_buffer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+
+using base::AutoLock;
+
+ReplayBuffer::ReplayBuffer() : data_available_(&lock_) {}
+
+ReplayBuffer::~ReplayBuffer() {
+  Close();
+}
+
+uint64_t ReplayBuffer::Write(const void* buffer, uint64_t size) {
+  DCHECK(buffer);
+  AutoLock lock(lock_);
+  if (closed_)
+    return 0;
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  data_.insert(data_.end(), data, data + size);
+  data_available_.Broadcast();
+  return size;
+}
+
+uint64_t ReplayBuffer::Read(uint64_t position, void* buffer, uint64_t size) {
+  DCHECK(buffer);
+  AutoLock lock(lock_);
+  while (!closed_ && position >= data_.size())
+    data_available_.Wait();
+  if (position >= data_.size())
+    return 0;
+  size = std::min(size, data_.size() - position);
+  memcpy(buffer, data_.data() + position, size);
+  return size;
+}
+
+void ReplayBuffer::Close() {
+  AutoLock lock(lock_);
+  closed_ = true;
+  data_available_.Broadcast();
+}
+
+bool ReplayBuffer::closed() {
+  AutoLock lock(lock_);
+  return closed_;
+}
+
+uint64_t ReplayBuffer::size() {
+  AutoLock lock(lock_);
+  return data_.size();
+}
+
+}  // namespace shaka
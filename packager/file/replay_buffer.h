@@ -0,0 +1,67 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_REPLAY_BUFFER_H_
+#define PACKAGER_FILE_REPLAY_BUFFER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+/// Declaration of class which implements a thread-safe append-only buffer.
+/// Unlike IoCache, the data is retained after it is read, so it can be read
+/// again from the beginning, e.g. to retry a failed upload, and it can be read
+/// by multiple readers, each keeping its own position.
+class ReplayBuffer {
+ public:
+  ReplayBuffer();
+  ~ReplayBuffer();
+
+  /// Append data to the buffer.
+  /// @param buffer is a buffer containing the data to be appended.
+  /// @param size is the size of the data to be appended.
+  /// @return the amount of data appended, which will equal @a size, or 0 if
+  ///         the buffer has been closed.
+  uint64_t Write(const void* buffer, uint64_t size);
+
+  /// Read data from the buffer. This function may block until there is data
+  /// at @a position.
+  /// @param position is the position of the data to read.
+  /// @param buffer is a buffer into which to read the data.
+  /// @param size is the size of @a buffer.
+  /// @return the number of bytes read into @a buffer, or 0 if the call
+  ///         unblocked because the buffer has been closed and there is no
+  ///         data at @a position.
+  uint64_t Read(uint64_t position, void* buffer, uint64_t size);
+
+  /// Close the buffer, indicating that no more data will be written. This
+  /// will cause any blocking Read() calls to unblock.
+  void Close();
+
+  /// @return true if the buffer is closed, false otherwise.
+  bool closed();
+
+  /// @return the number of bytes in the buffer.
+  uint64_t size();
+
+ private:
+  base::Lock lock_;
+  base::ConditionVariable data_available_;
+  std::vector<uint8_t> data_;
+  bool closed_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(ReplayBuffer);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_REPLAY_BUFFER_H_
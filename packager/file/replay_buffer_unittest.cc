@@ -0,0 +1,81 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/replay_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/simple_thread.h"
+
+namespace shaka {
+namespace {
+
+const uint8_t kData[] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+class DelayedWriter : public base::SimpleThread {
+ public:
+  explicit DelayedWriter(ReplayBuffer* buffer)
+      : base::SimpleThread("DelayedWriter"), buffer_(buffer) {}
+
+  void Run() override {
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(10));
+    buffer_->Write(kData, sizeof(kData));
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(10));
+    buffer_->Close();
+  }
+
+ private:
+  ReplayBuffer* buffer_;
+};
+
+}  // namespace
+
+TEST(ReplayBufferTest, ReadTwice) {
+  ReplayBuffer buffer;
+  EXPECT_EQ(sizeof(kData), buffer.Write(kData, sizeof(kData)));
+  EXPECT_EQ(sizeof(kData), buffer.size());
+  buffer.Close();
+
+  for (int i = 0; i < 2; ++i) {
+    uint8_t read_data[sizeof(kData) * 2] = {};
+    EXPECT_EQ(sizeof(kData), buffer.Read(0, read_data, sizeof(read_data)));
+    EXPECT_EQ(0, memcmp(kData, read_data, sizeof(kData)));
+    EXPECT_EQ(0u, buffer.Read(sizeof(kData), read_data, sizeof(read_data)));
+  }
+}
+
+TEST(ReplayBufferTest, ReadAtPosition) {
+  ReplayBuffer buffer;
+  buffer.Write(kData, sizeof(kData));
+  uint8_t read_data[3] = {};
+  EXPECT_EQ(3u, buffer.Read(2, read_data, sizeof(read_data)));
+  EXPECT_EQ(0, memcmp(kData + 2, read_data, sizeof(read_data)));
+  EXPECT_EQ(2u, buffer.Read(6, read_data, sizeof(read_data)));
+  EXPECT_EQ(0, memcmp(kData + 6, read_data, 2));
+}
+
+TEST(ReplayBufferTest, ReadBlocksUntilWriteOrClose) {
+  ReplayBuffer buffer;
+  DelayedWriter writer(&buffer);
+  writer.Start();
+
+  uint8_t read_data[sizeof(kData)] = {};
+  EXPECT_EQ(sizeof(kData), buffer.Read(0, read_data, sizeof(read_data)));
+  EXPECT_EQ(0, memcmp(kData, read_data, sizeof(kData)));
+  EXPECT_EQ(0u, buffer.Read(sizeof(kData), read_data, sizeof(read_data)));
+  EXPECT_TRUE(buffer.closed());
+  writer.Join();
+}
+
+TEST(ReplayBufferTest, WriteAfterClose) {
+  ReplayBuffer buffer;
+  buffer.Close();
+  EXPECT_EQ(0u, buffer.Write(kData, sizeof(kData)));
+  EXPECT_EQ(0u, buffer.size());
+}
+
+}  // namespace shaka
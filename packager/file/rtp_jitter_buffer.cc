@@ -0,0 +1,225 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/rtp_jitter_buffer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace {
+
+const size_t kRtpHeaderSize = 12;
+const int kRtpVersion = 2;
+// The size of the SMPTE 2022-1 FEC header, which follows the RTP header.
+const size_t kFecHeaderSize = 16;
+
+uint16_t ReadUint16(const uint8_t* data) {
+  return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+// Find the payload of an RTP packet, i.e. skip the header, the CSRCs and the
+// header extension, and remove the padding.
+bool ParseRtpPacket(const uint8_t* packet,
+                    size_t size,
+                    uint16_t* sequence_number,
+                    const uint8_t** payload,
+                    size_t* payload_size) {
+  if (size < kRtpHeaderSize || (packet[0] >> 6) != kRtpVersion)
+    return false;
+  const bool has_padding = (packet[0] & 0x20) != 0;
+  const bool has_extension = (packet[0] & 0x10) != 0;
+  const size_t csrc_count = packet[0] & 0x0f;
+  *sequence_number = ReadUint16(packet + 2);
+
+  size_t header_size = kRtpHeaderSize + csrc_count * 4;
+  if (has_extension) {
+    if (size < header_size + 4)
+      return false;
+    header_size += 4 + ReadUint16(packet + header_size + 2) * 4;
+  }
+  if (size < header_size)
+    return false;
+  size_t padding_size = 0;
+  if (has_padding) {
+    padding_size = packet[size - 1];
+    if (padding_size == 0 || size < header_size + padding_size)
+      return false;
+  }
+  *payload = packet + header_size;
+  *payload_size = size - header_size - padding_size;
+  return true;
+}
+
+}  // namespace
+
+RtpJitterBuffer::RtpJitterBuffer(size_t max_packets)
+    : max_packets_(std::max<size_t>(max_packets, 1)) {}
+
+RtpJitterBuffer::~RtpJitterBuffer() {}
+
+bool RtpJitterBuffer::AddPacket(const uint8_t* packet, size_t size) {
+  uint16_t sequence_number = 0;
+  const uint8_t* payload = nullptr;
+  size_t payload_size = 0;
+  if (!ParseRtpPacket(packet, size, &sequence_number, &payload,
+                      &payload_size)) {
+    return false;
+  }
+
+  if (next_sequence_number_ < 0)
+    next_sequence_number_ = sequence_number;
+  int64_t extended_sequence_number = ExtendSequenceNumber(sequence_number);
+  if (extended_sequence_number < next_sequence_number_) {
+    // A duplicate, or a packet which arrived after its gap was skipped.
+    if (++num_late_packets_ <= max_packets_)
+      return true;
+    LOG(WARNING) << "Restarting the RTP stream at sequence number "
+                 << sequence_number << ".";
+    payloads_.clear();
+    fec_packets_.clear();
+    next_sequence_number_ = sequence_number;
+    extended_sequence_number = sequence_number;
+  }
+  num_late_packets_ = 0;
+  // A duplicate packet is not inserted again.
+  payloads_.emplace(extended_sequence_number,
+                    std::vector<uint8_t>(payload, payload + payload_size));
+  return true;
+}
+
+bool RtpJitterBuffer::AddFecPacket(const uint8_t* packet, size_t size) {
+  uint16_t fec_sequence_number = 0;
+  const uint8_t* payload = nullptr;
+  size_t payload_size = 0;
+  if (!ParseRtpPacket(packet, size, &fec_sequence_number, &payload,
+                      &payload_size) ||
+      payload_size < kFecHeaderSize) {
+    return false;
+  }
+
+  FecPacket fec_packet;
+  const uint16_t sequence_number_base = ReadUint16(payload);
+  fec_packet.length_recovery = ReadUint16(payload + 2);
+  fec_packet.offset = payload[13];
+  fec_packet.num_packets = payload[14];
+  if (fec_packet.offset == 0 || fec_packet.num_packets == 0)
+    return false;
+  // There is no packet to recover before the first packet.
+  if (next_sequence_number_ < 0)
+    return true;
+
+  fec_packet.sequence_number_base = ExtendSequenceNumber(sequence_number_base);
+  const int64_t last_sequence_number =
+      fec_packet.sequence_number_base +
+      (fec_packet.num_packets - 1) * fec_packet.offset;
+  if (last_sequence_number < next_sequence_number_)
+    return true;
+  fec_packet.payload.assign(payload + kFecHeaderSize, payload + payload_size);
+  fec_packets_.push_back(std::move(fec_packet));
+  return true;
+}
+
+size_t RtpJitterBuffer::ReadPayloads(uint8_t* buffer, size_t size) {
+  size_t bytes_read = 0;
+  while (true) {
+    auto it = payloads_.lower_bound(next_sequence_number_);
+    if (it == payloads_.end()) {
+      flushing_ = false;
+      break;
+    }
+    if (it->first != next_sequence_number_) {
+      if (RecoverPacket(next_sequence_number_))
+        continue;
+      // Wait for the missing packets, unless there are too many packets
+      // after them already.
+      const int64_t num_packets_after_gap =
+          payloads_.rbegin()->first - next_sequence_number_;
+      if (!flushing_ &&
+          num_packets_after_gap < static_cast<int64_t>(max_packets_)) {
+        break;
+      }
+      VLOG(1) << "Skipping the RTP packets " << next_sequence_number_
+              << " to " << it->first - 1 << ".";
+      lost_packets_ += it->first - next_sequence_number_;
+      next_sequence_number_ = it->first;
+    }
+    const std::vector<uint8_t>& payload = it->second;
+    if (bytes_read + payload.size() > size)
+      break;
+    if (!payload.empty())
+      memcpy(buffer + bytes_read, payload.data(), payload.size());
+    bytes_read += payload.size();
+    ++next_sequence_number_;
+  }
+  RemoveOldPackets();
+  return bytes_read;
+}
+
+void RtpJitterBuffer::Flush() {
+  flushing_ = true;
+}
+
+int64_t RtpJitterBuffer::ExtendSequenceNumber(uint16_t sequence_number) const {
+  const int16_t difference = static_cast<int16_t>(
+      sequence_number - static_cast<uint16_t>(next_sequence_number_));
+  return next_sequence_number_ + difference;
+}
+
+bool RtpJitterBuffer::RecoverPacket(int64_t sequence_number) {
+  for (const FecPacket& fec_packet : fec_packets_) {
+    const int64_t distance = sequence_number - fec_packet.sequence_number_base;
+    if (distance < 0 || distance % fec_packet.offset != 0 ||
+        distance / fec_packet.offset >= fec_packet.num_packets) {
+      continue;
+    }
+
+    // The payload is the XOR of the FEC payload and of the payloads of the
+    // other packets protected, and so is its length.
+    std::vector<uint8_t> payload = fec_packet.payload;
+    uint16_t length = fec_packet.length_recovery;
+    bool recoverable = true;
+    for (int i = 0; i < fec_packet.num_packets && recoverable; ++i) {
+      const int64_t protected_sequence_number =
+          fec_packet.sequence_number_base + i * fec_packet.offset;
+      if (protected_sequence_number == sequence_number)
+        continue;
+      auto it = payloads_.find(protected_sequence_number);
+      if (it == payloads_.end() || it->second.size() > payload.size()) {
+        recoverable = false;
+        break;
+      }
+      length ^= static_cast<uint16_t>(it->second.size());
+      for (size_t j = 0; j < it->second.size(); ++j)
+        payload[j] ^= it->second[j];
+    }
+    if (!recoverable || length > payload.size())
+      continue;
+
+    payload.resize(length);
+    payloads_.emplace(sequence_number, std::move(payload));
+    ++recovered_packets_;
+    return true;
+  }
+  return false;
+}
+
+void RtpJitterBuffer::RemoveOldPackets() {
+  const int64_t oldest_sequence_number =
+      next_sequence_number_ - static_cast<int64_t>(max_packets_);
+  payloads_.erase(payloads_.begin(),
+                  payloads_.lower_bound(oldest_sequence_number));
+  fec_packets_.remove_if([this](const FecPacket& fec_packet) {
+    return fec_packet.sequence_number_base +
+               (fec_packet.num_packets - 1) * fec_packet.offset <
+           next_sequence_number_;
+  });
+}
+
+}  // namespace shaka
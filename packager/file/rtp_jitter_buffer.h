@@ -0,0 +1,98 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_RTP_JITTER_BUFFER_H_
+#define PACKAGER_FILE_RTP_JITTER_BUFFER_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <vector>
+
+namespace shaka {
+
+/// Reorders the packets of an RTP stream, e.g. of MPEG-2 TS over RTP as
+/// specified in SMPTE 2022-2, and recovers the lost packets from the SMPTE
+/// 2022-1 FEC packets, if any. The payloads are released in sequence number
+/// order as soon as there is no gap before them, so the buffer only adds
+/// latency when packets are reordered or lost. Not thread safe.
+class RtpJitterBuffer {
+ public:
+  /// @param max_packets is the maximum number of packets buffered after a
+  ///        gap, i.e. the latency added, in packets, by a lost packet, before
+  ///        the gap is skipped. The FEC packets can only recover the packets
+  ///        within this window.
+  explicit RtpJitterBuffer(size_t max_packets);
+  ~RtpJitterBuffer();
+
+  /// Add an RTP packet.
+  /// @return false if @a packet is not a valid RTP packet.
+  bool AddPacket(const uint8_t* packet, size_t size);
+
+  /// Add an SMPTE 2022-1 FEC packet, including its RTP header.
+  /// @return false if @a packet is not a valid FEC packet.
+  bool AddFecPacket(const uint8_t* packet, size_t size);
+
+  /// Release the payloads of the packets which are ready, in order. The
+  /// payloads are not split, the ones which do not fit in @a buffer are
+  /// released by the next call.
+  /// @return the number of bytes written to @a buffer.
+  size_t ReadPayloads(uint8_t* buffer, size_t size);
+
+  /// Skip the gaps in the packets buffered, e.g. when the stream stops, so all
+  /// of them are released by the next ReadPayloads() calls.
+  void Flush();
+
+  /// @return the number of packets lost, i.e. skipped.
+  uint64_t lost_packets() const { return lost_packets_; }
+  /// @return the number of packets recovered from the FEC packets.
+  uint64_t recovered_packets() const { return recovered_packets_; }
+
+ private:
+  struct FecPacket {
+    // The sequence number of the first packet protected.
+    int64_t sequence_number_base = 0;
+    // The distance between the sequence numbers of the packets protected.
+    int offset = 0;
+    // The number of packets protected.
+    int num_packets = 0;
+    uint16_t length_recovery = 0;
+    std::vector<uint8_t> payload;
+  };
+
+  RtpJitterBuffer(const RtpJitterBuffer&) = delete;
+  RtpJitterBuffer& operator=(const RtpJitterBuffer&) = delete;
+
+  // Map a 16-bit RTP sequence number to the closest sequence number, without
+  // wrap around, to |next_sequence_number_|.
+  int64_t ExtendSequenceNumber(uint16_t sequence_number) const;
+  // Recover the payload of the packet with |sequence_number| from a FEC
+  // packet, if the other packets it protects have been received.
+  bool RecoverPacket(int64_t sequence_number);
+  // Remove the packets and FEC packets which are no longer needed.
+  void RemoveOldPackets();
+
+  const size_t max_packets_;
+  // The sequence number of the next payload to release, or -1 until the first
+  // packet is received.
+  int64_t next_sequence_number_ = -1;
+  // Sequence number -> payload, of the packets to release and, for the FEC
+  // recovery, of the last |max_packets_| packets released.
+  std::map<int64_t, std::vector<uint8_t>> payloads_;
+  std::list<FecPacket> fec_packets_;
+  // The number of consecutive packets received after being skipped, which
+  // restarts the stream once they outnumber |max_packets_|, e.g. when the
+  // sender restarts with new sequence numbers.
+  size_t num_late_packets_ = 0;
+  bool flushing_ = false;
+  uint64_t lost_packets_ = 0;
+  uint64_t recovered_packets_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_RTP_JITTER_BUFFER_H_
@@ -0,0 +1,215 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/rtp_jitter_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace shaka {
+namespace {
+
+const size_t kMaxPackets = 4;
+const size_t kPayloadSize = 8;
+const size_t kRtpHeaderSize = 12;
+const size_t kFecHeaderSize = 16;
+
+// The payload of the packet |sequence_number| is filled with the low byte of
+// |sequence_number|.
+std::vector<uint8_t> MakePacket(uint16_t sequence_number) {
+  std::vector<uint8_t> packet(kRtpHeaderSize + kPayloadSize,
+                              static_cast<uint8_t>(sequence_number));
+  packet[0] = 0x80;
+  packet[1] = 33;  // MP2T.
+  packet[2] = sequence_number >> 8;
+  packet[3] = sequence_number & 0xff;
+  return packet;
+}
+
+// Makes the FEC packet protecting |num_packets| packets starting at
+// |sequence_number_base|, |offset| apart.
+std::vector<uint8_t> MakeFecPacket(uint16_t sequence_number_base,
+                                   uint8_t offset,
+                                   uint8_t num_packets) {
+  std::vector<uint8_t> packet(kRtpHeaderSize + kFecHeaderSize + kPayloadSize);
+  packet[0] = 0x80;
+  packet[1] = 96;
+  packet[kRtpHeaderSize] = sequence_number_base >> 8;
+  packet[kRtpHeaderSize + 1] = sequence_number_base & 0xff;
+  packet[kRtpHeaderSize + 13] = offset;
+  packet[kRtpHeaderSize + 14] = num_packets;
+  uint16_t length_recovery = 0;
+  for (uint8_t i = 0; i < num_packets; ++i) {
+    const uint16_t sequence_number = sequence_number_base + i * offset;
+    length_recovery ^= kPayloadSize;
+    for (size_t j = 0; j < kPayloadSize; ++j)
+      packet[kRtpHeaderSize + kFecHeaderSize + j] ^=
+          static_cast<uint8_t>(sequence_number);
+  }
+  packet[kRtpHeaderSize + 2] = length_recovery >> 8;
+  packet[kRtpHeaderSize + 3] = length_recovery & 0xff;
+  return packet;
+}
+
+}  // namespace
+
+class RtpJitterBufferTest : public testing::Test {
+ public:
+  RtpJitterBufferTest() : jitter_buffer_(kMaxPackets) {}
+
+ protected:
+  void AddPacket(uint16_t sequence_number) {
+    const std::vector<uint8_t> packet = MakePacket(sequence_number);
+    ASSERT_TRUE(jitter_buffer_.AddPacket(packet.data(), packet.size()));
+  }
+
+  // @return the first byte of each payload released.
+  std::vector<uint8_t> ReadPayloads() {
+    uint8_t buffer[100 * kPayloadSize];
+    const size_t size = jitter_buffer_.ReadPayloads(buffer, sizeof(buffer));
+    EXPECT_EQ(0u, size % kPayloadSize);
+    std::vector<uint8_t> payloads;
+    for (size_t i = 0; i < size; i += kPayloadSize)
+      payloads.push_back(buffer[i]);
+    return payloads;
+  }
+
+  RtpJitterBuffer jitter_buffer_;
+};
+
+TEST_F(RtpJitterBufferTest, InOrder) {
+  AddPacket(10);
+  AddPacket(11);
+  EXPECT_EQ(std::vector<uint8_t>({10, 11}), ReadPayloads());
+  AddPacket(12);
+  EXPECT_EQ(std::vector<uint8_t>({12}), ReadPayloads());
+  EXPECT_EQ(0u, jitter_buffer_.lost_packets());
+}
+
+TEST_F(RtpJitterBufferTest, Reordered) {
+  AddPacket(10);
+  AddPacket(12);
+  EXPECT_EQ(std::vector<uint8_t>({10}), ReadPayloads());
+  AddPacket(13);
+  EXPECT_EQ(std::vector<uint8_t>(), ReadPayloads());
+  AddPacket(11);
+  EXPECT_EQ(std::vector<uint8_t>({11, 12, 13}), ReadPayloads());
+  EXPECT_EQ(0u, jitter_buffer_.lost_packets());
+}
+
+TEST_F(RtpJitterBufferTest, Duplicate) {
+  AddPacket(10);
+  AddPacket(10);
+  EXPECT_EQ(std::vector<uint8_t>({10}), ReadPayloads());
+  AddPacket(10);
+  AddPacket(11);
+  EXPECT_EQ(std::vector<uint8_t>({11}), ReadPayloads());
+}
+
+TEST_F(RtpJitterBufferTest, LostPacketSkipped) {
+  AddPacket(10);
+  for (uint16_t sequence_number = 12; sequence_number < 12 + kMaxPackets - 1;
+       ++sequence_number) {
+    AddPacket(sequence_number);
+  }
+  EXPECT_EQ(std::vector<uint8_t>({10}), ReadPayloads());
+  // The packet 11 is skipped once kMaxPackets packets are waiting for it.
+  AddPacket(12 + kMaxPackets - 1);
+  EXPECT_EQ(std::vector<uint8_t>({12, 13, 14, 15}), ReadPayloads());
+  EXPECT_EQ(1u, jitter_buffer_.lost_packets());
+  // It is dropped if it arrives later.
+  AddPacket(11);
+  EXPECT_EQ(std::vector<uint8_t>(), ReadPayloads());
+}
+
+TEST_F(RtpJitterBufferTest, Flush) {
+  AddPacket(10);
+  AddPacket(12);
+  EXPECT_EQ(std::vector<uint8_t>({10}), ReadPayloads());
+  jitter_buffer_.Flush();
+  EXPECT_EQ(std::vector<uint8_t>({12}), ReadPayloads());
+  EXPECT_EQ(1u, jitter_buffer_.lost_packets());
+  // The gaps are only skipped until the packets buffered are released.
+  AddPacket(14);
+  EXPECT_EQ(std::vector<uint8_t>(), ReadPayloads());
+}
+
+TEST_F(RtpJitterBufferTest, SequenceNumberWrapAround) {
+  AddPacket(0xfffe);
+  AddPacket(0);
+  AddPacket(0xffff);
+  AddPacket(1);
+  EXPECT_EQ(std::vector<uint8_t>({0xfe, 0xff, 0, 1}), ReadPayloads());
+}
+
+TEST_F(RtpJitterBufferTest, Restart) {
+  AddPacket(1000);
+  EXPECT_EQ(std::vector<uint8_t>({1000 & 0xff}), ReadPayloads());
+  // The sender restarts with lower sequence numbers, which are dropped until
+  // they outnumber kMaxPackets.
+  for (uint16_t sequence_number = 10; sequence_number < 10 + kMaxPackets;
+       ++sequence_number) {
+    AddPacket(sequence_number);
+  }
+  EXPECT_EQ(std::vector<uint8_t>(), ReadPayloads());
+  AddPacket(10 + kMaxPackets);
+  AddPacket(11 + kMaxPackets);
+  EXPECT_EQ(std::vector<uint8_t>({10 + kMaxPackets, 11 + kMaxPackets}),
+            ReadPayloads());
+}
+
+TEST_F(RtpJitterBufferTest, FecRecovery) {
+  // A row FEC packet protecting 10 to 12, and a column FEC packet protecting
+  // 13 and 15.
+  const std::vector<uint8_t> row_fec_packet = MakeFecPacket(10, 1, 3);
+  const std::vector<uint8_t> column_fec_packet = MakeFecPacket(13, 2, 2);
+
+  AddPacket(10);
+  ASSERT_TRUE(jitter_buffer_.AddFecPacket(row_fec_packet.data(),
+                                          row_fec_packet.size()));
+  AddPacket(12);
+  EXPECT_EQ(std::vector<uint8_t>({10, 11, 12}), ReadPayloads());
+
+  ASSERT_TRUE(jitter_buffer_.AddFecPacket(column_fec_packet.data(),
+                                          column_fec_packet.size()));
+  AddPacket(14);
+  AddPacket(15);
+  EXPECT_EQ(std::vector<uint8_t>({13, 14, 15}), ReadPayloads());
+  EXPECT_EQ(2u, jitter_buffer_.recovered_packets());
+  EXPECT_EQ(0u, jitter_buffer_.lost_packets());
+}
+
+TEST_F(RtpJitterBufferTest, FecRecoveryNeedsTheOtherPackets) {
+  const std::vector<uint8_t> fec_packet = MakeFecPacket(10, 1, 3);
+  AddPacket(10);
+  ASSERT_TRUE(jitter_buffer_.AddFecPacket(fec_packet.data(), fec_packet.size()));
+  AddPacket(13);
+  EXPECT_EQ(std::vector<uint8_t>({10}), ReadPayloads());
+  EXPECT_EQ(0u, jitter_buffer_.recovered_packets());
+}
+
+TEST_F(RtpJitterBufferTest, PayloadNotSplit) {
+  AddPacket(10);
+  AddPacket(11);
+  uint8_t buffer[kPayloadSize + 1];
+  EXPECT_EQ(kPayloadSize, jitter_buffer_.ReadPayloads(buffer, sizeof(buffer)));
+  EXPECT_EQ(10, buffer[0]);
+  EXPECT_EQ(kPayloadSize, jitter_buffer_.ReadPayloads(buffer, sizeof(buffer)));
+  EXPECT_EQ(11, buffer[0]);
+}
+
+TEST_F(RtpJitterBufferTest, InvalidPackets) {
+  std::vector<uint8_t> packet = MakePacket(10);
+  EXPECT_FALSE(jitter_buffer_.AddPacket(packet.data(), kRtpHeaderSize - 1));
+  packet[0] = 0x40;  // Version 1.
+  EXPECT_FALSE(jitter_buffer_.AddPacket(packet.data(), packet.size()));
+  // A FEC packet without FEC header.
+  packet = MakePacket(10);
+  EXPECT_FALSE(jitter_buffer_.AddFecPacket(packet.data(), packet.size()));
+}
+
+}  // namespace shaka
@@ -0,0 +1,274 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/srt_file.h"
+
+#include <netdb.h>
+#include <srt/srt.h>
+
+#include <memory>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/file/srt_options.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+
+namespace {
+
+const int64_t kMetricsIntervalMs = 1000;
+
+bool StartSrt() {
+  // srt_startup() is only needed once per process.
+  static const bool started = srt_startup() != SRT_ERROR;
+  return started;
+}
+
+bool SetSocketFlag(SRTSOCKET socket,
+                   SRT_SOCKOPT option,
+                   const void* value,
+                   int size,
+                   const char* name) {
+  if (srt_setsockflag(socket, option, value, size) == SRT_ERROR) {
+    LOG(ERROR) << "Failed to set the SRT option " << name << ": "
+               << srt_getlasterror_str();
+    return false;
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+SrtFile::SrtFile(const char* address_and_port)
+    : File(address_and_port), socket_(SRT_INVALID_SOCK) {}
+
+SrtFile::~SrtFile() {
+  // Also closes the socket of a file which failed to open.
+  const SRTSOCKET socket = socket_.exchange(SRT_INVALID_SOCK);
+  if (socket != SRT_INVALID_SOCK)
+    srt_close(socket);
+}
+
+bool SrtFile::Close() {
+  delete this;
+  return true;
+}
+
+int64_t SrtFile::Read(void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  // A message cannot be split across reads, and returning 0 would look like
+  // the end of the stream.
+  if (length < static_cast<uint64_t>(SRT_LIVE_MAX_PLSIZE)) {
+    LOG(ERROR) << "Buffer of " << length << " bytes is too small to read a "
+               << SRT_LIVE_MAX_PLSIZE << " byte message from " << file_name();
+    return -1;
+  }
+
+  char* data = static_cast<char*>(buffer);
+  uint64_t bytes_read = 0;
+  // Wait for the first message, then receive the messages already there,
+  // which arrive in bursts, e.g. after a retransmission.
+  while (length - bytes_read >= SRT_LIVE_MAX_PLSIZE) {
+    if (bytes_read > 0 && !HasMessagesAvailable())
+      break;
+    const SRTSOCKET socket = socket_.load();
+    if (socket == SRT_INVALID_SOCK)
+      return bytes_read > 0 ? static_cast<int64_t>(bytes_read) : -1;
+    const int result =
+        srt_recvmsg(socket, data + bytes_read, SRT_LIVE_MAX_PLSIZE);
+    if (result == SRT_ERROR) {
+      if (bytes_read > 0)
+        break;
+      // Abort() closes the socket, which unblocks the receive.
+      LOG_IF(ERROR, socket_.load() != SRT_INVALID_SOCK)
+          << "Failed to receive from " << file_name() << ": "
+          << srt_getlasterror_str();
+      return -1;
+    }
+    if (result == 0)
+      break;
+    bytes_read += result;
+  }
+  ReportSrtMetrics();
+  return bytes_read;
+}
+
+int64_t SrtFile::Write(const void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "SrtFile only supports read mode.";
+  return -1;
+}
+
+int64_t SrtFile::Size() {
+  return -1;
+}
+
+bool SrtFile::Flush() {
+  NOTIMPLEMENTED() << "SrtFile only supports read mode.";
+  return false;
+}
+
+bool SrtFile::Seek(uint64_t position) {
+  VLOG(1) << "SrtFile does not support Seek().";
+  return false;
+}
+
+bool SrtFile::Tell(uint64_t* position) {
+  return false;
+}
+
+void SrtFile::Abort() {
+  const SRTSOCKET socket = socket_.exchange(SRT_INVALID_SOCK);
+  if (socket != SRT_INVALID_SOCK)
+    srt_close(socket);
+}
+
+bool SrtFile::Open() {
+  DCHECK_EQ(SRT_INVALID_SOCK, socket_.load());
+
+  std::unique_ptr<SrtOptions> options =
+      SrtOptions::ParseFromString(file_name());
+  if (!options)
+    return false;
+
+  if (!StartSrt()) {
+    LOG(ERROR) << "Failed to start libsrt: " << srt_getlasterror_str();
+    return false;
+  }
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (options->address().empty())
+    hints.ai_flags = AI_PASSIVE;
+  struct addrinfo* address_info = nullptr;
+  const std::string port = base::UintToString(options->port());
+  const int gai_error = getaddrinfo(
+      options->address().empty() ? nullptr : options->address().c_str(),
+      port.c_str(), &hints, &address_info);
+  if (gai_error != 0) {
+    LOG(ERROR) << "Cannot resolve " << options->address() << ": "
+               << gai_strerror(gai_error);
+    return false;
+  }
+  std::unique_ptr<struct addrinfo, decltype(&freeaddrinfo)> scoped_address(
+      address_info, &freeaddrinfo);
+
+  const SRTSOCKET socket = srt_create_socket();
+  if (socket == SRT_INVALID_SOCK) {
+    LOG(ERROR) << "Could not create SRT socket: " << srt_getlasterror_str();
+    return false;
+  }
+  // Set now so that Abort() can interrupt the connection.
+  socket_.store(socket);
+
+  const int latency_ms = options->latency_ms();
+  if (latency_ms >= 0 && !SetSocketFlag(socket, SRTO_LATENCY, &latency_ms,
+                                        sizeof(latency_ms), "latency")) {
+    return false;
+  }
+  if (!options->passphrase().empty() &&
+      !SetSocketFlag(socket, SRTO_PASSPHRASE, options->passphrase().data(),
+                     options->passphrase().size(), "passphrase")) {
+    return false;
+  }
+  if (!options->stream_id().empty() &&
+      !SetSocketFlag(socket, SRTO_STREAMID, options->stream_id().data(),
+                     options->stream_id().size(), "streamid")) {
+    return false;
+  }
+
+  if (options->mode() == SrtOptions::Mode::kCaller) {
+    if (srt_connect(socket, address_info->ai_addr,
+                    static_cast<int>(address_info->ai_addrlen)) ==
+        SRT_ERROR) {
+      LOG(ERROR) << "Cannot connect to " << file_name() << ": "
+                 << srt_getlasterror_str();
+      return false;
+    }
+  } else {
+    if (srt_bind(socket, address_info->ai_addr,
+                 static_cast<int>(address_info->ai_addrlen)) == SRT_ERROR ||
+        srt_listen(socket, 1) == SRT_ERROR) {
+      LOG(ERROR) << "Cannot listen on " << file_name() << ": "
+                 << srt_getlasterror_str();
+      return false;
+    }
+    struct sockaddr_storage peer_address;
+    int peer_address_size = sizeof(peer_address);
+    const SRTSOCKET data_socket =
+        srt_accept(socket, reinterpret_cast<struct sockaddr*>(&peer_address),
+                   &peer_address_size);
+    // The options of the listening socket are inherited by |data_socket|.
+    if (socket_.exchange(data_socket) == SRT_INVALID_SOCK) {
+      // Aborted while waiting for the sender, which closed |socket|.
+      if (data_socket != SRT_INVALID_SOCK)
+        srt_close(data_socket);
+      socket_.store(SRT_INVALID_SOCK);
+      return false;
+    }
+    srt_close(socket);
+    if (data_socket == SRT_INVALID_SOCK) {
+      LOG(ERROR) << "Cannot accept the sender on " << file_name() << ": "
+                 << srt_getlasterror_str();
+      return false;
+    }
+  }
+  last_metrics_time_ = base::TimeTicks::Now();
+  return true;
+}
+
+bool SrtFile::HasMessagesAvailable() {
+  int num_packets = 0;
+  int size = sizeof(num_packets);
+  return srt_getsockflag(socket_.load(), SRTO_RCVDATA, &num_packets, &size) !=
+             SRT_ERROR &&
+         num_packets > 0;
+}
+
+void SrtFile::ReportSrtMetrics() {
+  const base::TimeTicks now = base::TimeTicks::Now();
+  if (now - last_metrics_time_ <
+      base::TimeDelta::FromMilliseconds(kMetricsIntervalMs)) {
+    return;
+  }
+  last_metrics_time_ = now;
+
+  SRT_TRACEBSTATS stats;
+  // The interval counters are cleared, so they count the packets since the
+  // last report.
+  if (srt_bstats(socket_.load(), &stats, 1) == SRT_ERROR)
+    return;
+  const MetricLabels labels = {{"file", file_name()}};
+  Metrics* metrics = Metrics::GetInstance();
+  metrics->SetGauge("shaka_srt_rtt_seconds",
+                    "Round trip time of the link of an SRT input.", labels,
+                    stats.msRTT / 1000);
+  metrics->SetGauge("shaka_srt_receive_buffer_seconds",
+                    "Duration of the data buffered by the receiver of an SRT "
+                    "input, within its latency budget.",
+                    labels, stats.msRcvBuf / 1000.0);
+  if (stats.pktRcvLoss > 0) {
+    metrics->IncrementCounter(
+        "shaka_srt_lost_packets",
+        "Packets of an SRT input detected as lost, before retransmission.",
+        labels, stats.pktRcvLoss);
+  }
+  if (stats.pktRcvRetrans > 0) {
+    metrics->IncrementCounter("shaka_srt_retransmitted_packets",
+                              "Retransmitted packets received by an SRT input.",
+                              labels, stats.pktRcvRetrans);
+  }
+  if (stats.pktRcvDrop > 0) {
+    metrics->IncrementCounter(
+        "shaka_srt_dropped_packets",
+        "Packets of an SRT input dropped because they were not received "
+        "within the latency budget.",
+        labels, stats.pktRcvDrop);
+  }
+}
+
+}  // namespace shaka
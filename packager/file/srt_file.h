@@ -0,0 +1,64 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_SRT_FILE_H_
+#define PACKAGER_FILE_SRT_FILE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Implements SrtFile, which receives an MPEG-2 TS stream over SRT, see
+/// SrtOptions, with libsrt. The messages available are received together,
+/// so the input thread fills the I/O cache in large blocks. The statistics of
+/// the link, i.e. the round trip time and the packets lost, retransmitted and
+/// dropped, are reported in the metrics. Only built with enable_srt=1.
+class SrtFile : public File {
+ public:
+  /// @param address_and_port C string containing the address of the stream to
+  ///        receive. It should be of the form "<ip_address>:<port>[?options]".
+  explicit SrtFile(const char* address_and_port);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  void Abort() override;
+  /// @}
+
+ protected:
+  ~SrtFile() override;
+
+  bool Open() override;
+
+ private:
+  SrtFile(const SrtFile&) = delete;
+  SrtFile& operator=(const SrtFile&) = delete;
+
+  // Whether messages are waiting in the receive buffer of |socket_|.
+  bool HasMessagesAvailable();
+  // Records the statistics of the link in the metrics, at most once a second.
+  void ReportSrtMetrics();
+
+  // SRTSOCKET, which is an int.
+  std::atomic<int> socket_;
+  base::TimeTicks last_metrics_time_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_SRT_FILE_H_
@@ -0,0 +1,120 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/srt_options.h"
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+
+namespace shaka {
+
+namespace {
+
+enum FieldType {
+  kUnknownField = 0,
+  kLatencyField,
+  kModeField,
+  kPassphraseField,
+  kStreamIdField,
+};
+
+struct FieldNameToTypeMapping {
+  const char* field_name;
+  FieldType field_type;
+};
+
+const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
+    {"latency", kLatencyField},
+    {"mode", kModeField},
+    {"passphrase", kPassphraseField},
+    {"streamid", kStreamIdField},
+};
+
+FieldType GetFieldType(const std::string& field_name) {
+  for (size_t idx = 0; idx < arraysize(kFieldNameTypeMappings); ++idx) {
+    if (field_name == kFieldNameTypeMappings[idx].field_name)
+      return kFieldNameTypeMappings[idx].field_type;
+  }
+  return kUnknownField;
+}
+
+}  // namespace
+
+std::unique_ptr<SrtOptions> SrtOptions::ParseFromString(
+    base::StringPiece srt_url) {
+  std::unique_ptr<SrtOptions> options(new SrtOptions);
+
+  const size_t question_mark_pos = srt_url.find('?');
+  base::StringPiece address_str = srt_url.substr(0, question_mark_pos);
+
+  if (question_mark_pos != base::StringPiece::npos) {
+    base::StringPiece options_str = srt_url.substr(question_mark_pos + 1);
+
+    base::StringPairs pairs;
+    if (!base::SplitStringIntoKeyValuePairs(options_str, '=', '&', &pairs)) {
+      LOG(ERROR) << "Invalid srt options name/value pairs " << options_str;
+      return nullptr;
+    }
+    for (const auto& pair : pairs) {
+      switch (GetFieldType(pair.first)) {
+        case kLatencyField:
+          if (!base::StringToInt(pair.second, &options->latency_ms_) ||
+              options->latency_ms_ < 0) {
+            LOG(ERROR) << "Invalid srt option for latency field "
+                       << pair.second;
+            return nullptr;
+          }
+          break;
+        case kModeField:
+          if (pair.second == "caller") {
+            options->mode_ = Mode::kCaller;
+          } else if (pair.second == "listener") {
+            options->mode_ = Mode::kListener;
+          } else {
+            LOG(ERROR) << "Invalid srt option for mode field " << pair.second;
+            return nullptr;
+          }
+          break;
+        case kPassphraseField:
+          // libsrt requires passphrases of 10 to 79 characters.
+          if (pair.second.size() < 10 || pair.second.size() > 79) {
+            LOG(ERROR) << "Invalid srt option for passphrase field, which "
+                          "should have 10 to 79 characters.";
+            return nullptr;
+          }
+          options->passphrase_ = pair.second;
+          break;
+        case kStreamIdField:
+          options->stream_id_ = pair.second;
+          break;
+        default:
+          LOG(ERROR) << "Unknown field in srt options (\"" << pair.first
+                     << "\").";
+          return nullptr;
+      }
+    }
+  }
+
+  const size_t colon_pos = address_str.find(':');
+  unsigned port_value = 0;
+  if (colon_pos == base::StringPiece::npos ||
+      !base::StringToUint(address_str.substr(colon_pos + 1), &port_value) ||
+      port_value == 0 || port_value > 65535) {
+    LOG(ERROR) << "Malformed address:port SRT url " << address_str;
+    return nullptr;
+  }
+  options->address_ = address_str.substr(0, colon_pos).as_string();
+  options->port_ = port_value;
+  if (options->address_.empty() && options->mode_ == Mode::kCaller) {
+    LOG(ERROR) << "Missing address in SRT url " << address_str
+               << " in caller mode.";
+    return nullptr;
+  }
+  return options;
+}
+
+}  // namespace shaka
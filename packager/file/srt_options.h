@@ -0,0 +1,63 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_SRT_OPTIONS_H_
+#define PACKAGER_FILE_SRT_OPTIONS_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/base/strings/string_piece.h"
+
+namespace shaka {
+
+/// Options parsed from SRT url string of the form: srt://ip:port[?options]
+class SrtOptions {
+ public:
+  enum class Mode {
+    /// Connect to the sender at the address.
+    kCaller,
+    /// Wait for the sender to connect to the port, on the address if any.
+    kListener,
+  };
+
+  ~SrtOptions() = default;
+
+  /// Parse from SRT url.
+  /// @param srt_url is the url of the form srt://ip:port[?options], without
+  ///        the "srt://" prefix.
+  /// @returns a SrtOptions object on success, nullptr otherwise.
+  static std::unique_ptr<SrtOptions> ParseFromString(base::StringPiece srt_url);
+
+  const std::string& address() const { return address_; }
+  uint16_t port() const { return port_; }
+  Mode mode() const { return mode_; }
+  int latency_ms() const { return latency_ms_; }
+  const std::string& passphrase() const { return passphrase_; }
+  const std::string& stream_id() const { return stream_id_; }
+
+ private:
+  SrtOptions() = default;
+
+  // IP Address, which may be empty in listener mode.
+  std::string address_;
+  uint16_t port_ = 0;
+  Mode mode_ = Mode::kCaller;
+  // The latency budget of the link in milliseconds, i.e. how long the
+  // receiver waits for the lost packets to be retransmitted. -1 to use the
+  // default of libsrt, 120 ms.
+  int latency_ms_ = -1;
+  // Decrypts the stream, if not empty.
+  std::string passphrase_;
+  // Identifies the stream to the sender, if not empty.
+  std::string stream_id_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_SRT_OPTIONS_H_
@@ -0,0 +1,60 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/srt_options.h"
+
+#include <gtest/gtest.h>
+
+namespace shaka {
+
+TEST(SrtOptionsTest, AddressAndPort) {
+  auto options = SrtOptions::ParseFromString("10.1.2.3:9000");
+  ASSERT_TRUE(options);
+  EXPECT_EQ("10.1.2.3", options->address());
+  EXPECT_EQ(9000u, options->port());
+  // The below fields are not set.
+  EXPECT_EQ(SrtOptions::Mode::kCaller, options->mode());
+  EXPECT_EQ(-1, options->latency_ms());
+  EXPECT_EQ("", options->passphrase());
+  EXPECT_EQ("", options->stream_id());
+}
+
+TEST(SrtOptionsTest, InvalidAddressAndPort) {
+  EXPECT_FALSE(SrtOptions::ParseFromString("10.1.2.3"));
+  EXPECT_FALSE(SrtOptions::ParseFromString("10.1.2.3:"));
+  EXPECT_FALSE(SrtOptions::ParseFromString("10.1.2.3:0"));
+  EXPECT_FALSE(SrtOptions::ParseFromString("10.1.2.3:888888"));
+  // The address is only optional in listener mode.
+  EXPECT_FALSE(SrtOptions::ParseFromString(":9000"));
+}
+
+TEST(SrtOptionsTest, Listener) {
+  auto options = SrtOptions::ParseFromString(":9000?mode=listener");
+  ASSERT_TRUE(options);
+  EXPECT_EQ("", options->address());
+  EXPECT_EQ(9000u, options->port());
+  EXPECT_EQ(SrtOptions::Mode::kListener, options->mode());
+}
+
+TEST(SrtOptionsTest, AllOptions) {
+  auto options = SrtOptions::ParseFromString(
+      "10.1.2.3:9000?mode=caller&latency=250&passphrase=0123456789"
+      "&streamid=live/channel1");
+  ASSERT_TRUE(options);
+  EXPECT_EQ(SrtOptions::Mode::kCaller, options->mode());
+  EXPECT_EQ(250, options->latency_ms());
+  EXPECT_EQ("0123456789", options->passphrase());
+  EXPECT_EQ("live/channel1", options->stream_id());
+}
+
+TEST(SrtOptionsTest, InvalidOptions) {
+  EXPECT_FALSE(SrtOptions::ParseFromString("10.1.2.3:9000?mode=rendezvous"));
+  EXPECT_FALSE(SrtOptions::ParseFromString("10.1.2.3:9000?latency=-1"));
+  EXPECT_FALSE(SrtOptions::ParseFromString("10.1.2.3:9000?passphrase=short"));
+  EXPECT_FALSE(SrtOptions::ParseFromString("10.1.2.3:9000?unknown=1"));
+}
+
+}  // namespace shaka
@@ -0,0 +1,141 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/tee_file.h"
+
+#include <string.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_split.h"
+
+namespace shaka {
+
+namespace {
+
+std::vector<std::string> SplitFileNames(const char* file_names) {
+  return base::SplitString(file_names, std::string(1, TeeFile::kSeparator),
+                           base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+}
+
+}  // namespace
+
+TeeFile::TeeFile(const char* file_names, const char* mode)
+    : File(file_names), mode_(mode) {}
+
+TeeFile::~TeeFile() {}
+
+bool TeeFile::Close() {
+  bool result = true;
+  for (auto& file : files_) {
+    const std::string file_name = file->file_name();
+    if (!file.release()->Close()) {
+      LOG(ERROR) << "Failed to close " << file_name;
+      result = false;
+    }
+  }
+  delete this;
+  return result;
+}
+
+int64_t TeeFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "TeeFile only supports write mode.";
+  return -1;
+}
+
+int64_t TeeFile::Write(const void* buffer, uint64_t length) {
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  for (auto& file : files_) {
+    uint64_t bytes_written = 0;
+    while (bytes_written < length) {
+      const int64_t result =
+          file->Write(data + bytes_written, length - bytes_written);
+      if (result <= 0) {
+        LOG(ERROR) << "Failed to write to " << file->file_name();
+        return result < 0 ? result : -1;
+      }
+      bytes_written += result;
+    }
+  }
+  position_ += length;
+  if (position_ > size_)
+    size_ = position_;
+  return length;
+}
+
+int64_t TeeFile::Size() {
+  return size_;
+}
+
+bool TeeFile::Flush() {
+  bool result = true;
+  for (auto& file : files_)
+    result &= file->Flush();
+  return result;
+}
+
+bool TeeFile::Seek(uint64_t position) {
+  for (auto& file : files_) {
+    if (!file->Seek(position))
+      return false;
+  }
+  position_ = position;
+  return true;
+}
+
+bool TeeFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = position_;
+  return true;
+}
+
+void TeeFile::Abort() {
+  for (auto& file : files_)
+    file->Abort();
+}
+
+bool TeeFile::Delete(const char* file_names) {
+  bool result = true;
+  for (const std::string& file_name : SplitFileNames(file_names))
+    result &= File::Delete(file_name.c_str());
+  return result;
+}
+
+bool TeeFile::WriteFileAtomically(const char* file_names,
+                                  const std::string& contents) {
+  bool result = true;
+  for (const std::string& file_name : SplitFileNames(file_names))
+    result &= File::WriteFileAtomically(file_name.c_str(), contents);
+  return result;
+}
+
+std::string TeeFile::GetFirstFileName(const std::string& file_name) {
+  if (file_name.compare(0, strlen(kTeeFilePrefix), kTeeFilePrefix) != 0)
+    return file_name;
+  const std::vector<std::string> file_names =
+      SplitFileNames(file_name.c_str() + strlen(kTeeFilePrefix));
+  return file_names.empty() ? file_name : file_names.front();
+}
+
+bool TeeFile::Open() {
+  const std::vector<std::string> file_names =
+      SplitFileNames(file_name().c_str());
+  if (file_names.empty()) {
+    LOG(ERROR) << "No file to write in tee://" << file_name();
+    return false;
+  }
+  for (const std::string& name : file_names) {
+    std::unique_ptr<File, FileCloser> file(
+        File::Open(name.c_str(), mode_.c_str()));
+    if (!file) {
+      LOG(ERROR) << "Failed to open " << name;
+      return false;
+    }
+    files_.push_back(std::move(file));
+  }
+  return true;
+}
+
+}  // namespace shaka
@@ -0,0 +1,76 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_TEE_FILE_H_
+#define PACKAGER_FILE_TEE_FILE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+/// Implements a File which writes the same data to several files, e.g. a
+/// single muxer output to a local archive and to an HTTP origin with
+/// "tee://archive/video.mp4|https://origin/video.mp4". Each of the files is
+/// opened with File::Open(), so it is written asynchronously through an I/O
+/// cache of its own and a slow destination does not hold up the others until
+/// its cache is full. Output only.
+class TeeFile : public File {
+ public:
+  /// The separator of the file names.
+  static const char kSeparator = '|';
+
+  /// @param file_names is the names of the files, separated by kSeparator,
+  ///        without the "tee://" prefix.
+  /// @param mode C string containing a file access mode, "w" or "a".
+  TeeFile(const char* file_names, const char* mode);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  void Abort() override;
+  /// @}
+
+  /// Delete each of the files.
+  /// @return true if all of them are deleted.
+  static bool Delete(const char* file_names);
+  /// Write @a contents to each of the files with File::WriteFileAtomically().
+  /// @return true if all of them are written.
+  static bool WriteFileAtomically(const char* file_names,
+                                  const std::string& contents);
+  /// @return the first file name of @a file_name if it is a tee file name,
+  ///         i.e. the file referenced by the manifests, or @a file_name
+  ///         otherwise.
+  static std::string GetFirstFileName(const std::string& file_name);
+
+ protected:
+  ~TeeFile() override;
+
+  bool Open() override;
+
+ private:
+  TeeFile(const TeeFile&) = delete;
+  TeeFile& operator=(const TeeFile&) = delete;
+
+  const std::string mode_;
+  std::vector<std::unique_ptr<File, FileCloser>> files_;
+  uint64_t position_ = 0;
+  uint64_t size_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_TEE_FILE_H_
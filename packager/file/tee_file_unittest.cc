@@ -0,0 +1,76 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/tee_file.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+namespace {
+
+const char kTeeFileName[] = "tee://memory://file1|memory://file2";
+const char kFileNames[][16] = {"memory://file1", "memory://file2"};
+
+}  // namespace
+
+class TeeFileTest : public testing::Test {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+};
+
+TEST_F(TeeFileTest, WritesToEachFile) {
+  std::unique_ptr<File, FileCloser> file(File::Open(kTeeFileName, "w"));
+  ASSERT_TRUE(file);
+  const std::string kData = "0123456789";
+  ASSERT_EQ(static_cast<int64_t>(kData.size()),
+            file->Write(kData.data(), kData.size()));
+  // Rewrite the beginning, e.g. the header of a single segment MP4 output.
+  ASSERT_TRUE(file->Seek(0));
+  ASSERT_EQ(2, file->Write("ab", 2));
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(2u, position);
+  EXPECT_EQ(static_cast<int64_t>(kData.size()), file->Size());
+  ASSERT_TRUE(file.release()->Close());
+
+  for (const char* file_name : kFileNames) {
+    std::string contents;
+    ASSERT_TRUE(File::ReadFileToString(file_name, &contents));
+    EXPECT_EQ("ab23456789", contents) << file_name;
+  }
+}
+
+TEST_F(TeeFileTest, FailsIfAFileCannotBeOpened) {
+  EXPECT_FALSE(File::Open(kTeeFileName, "r"));
+  EXPECT_FALSE(File::Open("tee://memory://file1|udp://invalid", "w"));
+}
+
+TEST_F(TeeFileTest, DeletesEachFile) {
+  ASSERT_TRUE(File::WriteFileAtomically(kTeeFileName, "contents"));
+  for (const char* file_name : kFileNames) {
+    std::string contents;
+    ASSERT_TRUE(File::ReadFileToString(file_name, &contents));
+    EXPECT_EQ("contents", contents);
+  }
+
+  ASSERT_TRUE(File::Delete(kTeeFileName));
+  for (const char* file_name : kFileNames)
+    EXPECT_FALSE(File::Open(file_name, "r"));
+}
+
+TEST_F(TeeFileTest, GetFirstFileName) {
+  EXPECT_EQ("memory://file1", TeeFile::GetFirstFileName(kTeeFileName));
+  EXPECT_EQ("dir/file.mp4", TeeFile::GetFirstFileName("dir/file.mp4"));
+}
+
+}  // namespace shaka
@@ -6,21 +6,35 @@
 
 #include "packager/file/threaded_io_file.h"
 
+#include <algorithm>
+
 #include "packager/base/bind.h"
 #include "packager/base/bind_helpers.h"
 #include "packager/base/location.h"
 #include "packager/base/threading/worker_pool.h"
+#include "packager/file/io_reactor.h"
+#include "packager/metrics/metrics.h"
 
 namespace shaka {
+namespace {
+
+// The number of blocks written by a Drain() task before it yields the
+// reactor thread to the other files.
+const int kMaxBlocksPerDrain = 16;
+
+}  // namespace
 
 ThreadedIoFile::ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                                Mode mode,
                                uint64_t io_cache_size,
-                               uint64_t io_block_size)
+                               uint64_t io_cache_max_size,
+                               uint64_t io_block_size,
+                               IoReactor* reactor)
     : File(internal_file->file_name()),
       internal_file_(std::move(internal_file)),
       mode_(mode),
-      cache_(io_cache_size),
+      cache_(io_cache_size, io_cache_max_size),
+      io_cache_size_(io_cache_size),
       io_buffer_(io_block_size),
       position_(0),
       size_(0),
@@ -30,7 +44,11 @@ ThreadedIoFile::ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                             base::WaitableEvent::InitialState::NOT_SIGNALED),
       internal_file_error_(0),
       task_exit_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                       base::WaitableEvent::InitialState::NOT_SIGNALED) {
+                       base::WaitableEvent::InitialState::NOT_SIGNALED),
+      // The inputs block on their source, e.g. a socket, so they keep their
+      // own thread.
+      reactor_(mode == kOutputMode ? reactor : nullptr),
+      drain_done_(&drain_lock_) {
   DCHECK(internal_file_);
 }
 
@@ -45,6 +63,28 @@ bool ThreadedIoFile::Open() {
   position_ = 0;
   size_ = internal_file_->Size();
 
+  metrics_labels_ = {{"file", file_name()},
+                     {"mode", mode_ == kOutputMode ? "output" : "input"}};
+  Metrics* metrics = Metrics::GetInstance();
+  cache_gauge_ids_.push_back(metrics->AddGaugeFunction(
+      "shaka_io_cache_bytes", "Bytes buffered in the I/O cache of a file.",
+      metrics_labels_,
+      [this]() { return static_cast<double>(cache_.BytesCached()); }));
+  cache_gauge_ids_.push_back(metrics->AddGaugeFunction(
+      "shaka_io_cache_size_bytes",
+      "Size of the I/O cache of a file, which may grow up to "
+      "--io_cache_max_size.",
+      metrics_labels_,
+      [this]() { return static_cast<double>(cache_.cache_size()); }));
+  cache_gauge_ids_.push_back(metrics->AddGaugeFunction(
+      "shaka_io_cache_stall_seconds",
+      "Time spent waiting for free space in the I/O cache of a file, e.g. to "
+      "tune --io_cache_size and --io_cache_max_size.",
+      metrics_labels_,
+      [this]() { return cache_.stall_time().InSecondsF(); }));
+
+  if (reactor_)
+    return true;
   base::WorkerPool::PostTask(
       FROM_HERE,
       base::Bind(&ThreadedIoFile::TaskHandler, base::Unretained(this)),
@@ -59,8 +99,13 @@ bool ThreadedIoFile::Close() {
   if (mode_ == kOutputMode)
     result = Flush();
 
+  for (int id : cache_gauge_ids_)
+    Metrics::GetInstance()->RemoveGaugeFunction(id);
   cache_.Close();
-  task_exit_event_.Wait();
+  if (reactor_)
+    WaitUntilDrained();
+  else
+    task_exit_event_.Wait();
 
   result &= internal_file_.release()->Close();
   delete this;
@@ -77,7 +122,12 @@ int64_t ThreadedIoFile::Read(void* buffer, uint64_t length) {
   if (internal_file_error_.load(std::memory_order_relaxed))
     return internal_file_error_.load(std::memory_order_relaxed);
 
+  if (aborted_)
+    return -1;
   uint64_t bytes_read = cache_.Read(buffer, length);
+  // Abort() closes the cache, which unblocks the read.
+  if (aborted_)
+    return -1;
   position_ += bytes_read;
 
   return bytes_read;
@@ -90,7 +140,24 @@ int64_t ThreadedIoFile::Write(const void* buffer, uint64_t length) {
   if (internal_file_error_.load(std::memory_order_relaxed))
     return internal_file_error_.load(std::memory_order_relaxed);
 
-  uint64_t bytes_written = cache_.Write(buffer, length);
+  uint64_t bytes_written = 0;
+  if (reactor_) {
+    // Schedule the drain after every write of at most the size of the cache,
+    // so the cache cannot fill up with no drain to empty it.
+    const uint8_t* data = static_cast<const uint8_t*>(buffer);
+    while (bytes_written < length) {
+      const uint64_t write_size =
+          std::min(length - bytes_written, io_cache_size_);
+      RecordCacheWrite(write_size);
+      if (cache_.Write(data + bytes_written, write_size) == 0)
+        break;
+      bytes_written += write_size;
+      ScheduleDrain();
+    }
+  } else {
+    RecordCacheWrite(length);
+    bytes_written = cache_.Write(buffer, length);
+  }
   position_ += bytes_written;
   if (position_ > size_)
     size_ = position_;
@@ -111,6 +178,13 @@ bool ThreadedIoFile::Flush() {
   if (internal_file_error_.load(std::memory_order_relaxed))
     return false;
 
+  if (reactor_) {
+    WaitUntilDrained();
+    if (internal_file_error_.load(std::memory_order_relaxed))
+      return false;
+    return internal_file_->Flush();
+  }
+
   flushing_ = true;
   cache_.Close();
   flush_complete_event_.Wait();
@@ -127,6 +201,8 @@ bool ThreadedIoFile::Seek(uint64_t position) {
   } else {
     // Reading. Close cache, wait for thread task to exit, seek, and re-post
     // the task.
+    if (aborted_)
+      return false;
     cache_.Close();
     task_exit_event_.Wait();
     bool result = internal_file_->Seek(position);
@@ -156,6 +232,35 @@ bool ThreadedIoFile::Tell(uint64_t* position) {
   return true;
 }
 
+void ThreadedIoFile::Abort() {
+  // Closing the cache in output mode would flush it.
+  if (mode_ != kInputMode)
+    return;
+  aborted_ = true;
+  // Unblocks the read in progress, and stops the input thread at its next
+  // write to the cache.
+  cache_.Close();
+  internal_file_->Abort();
+}
+
+bool ThreadedIoFile::PrepareKernelCopy(int* fd, uint64_t* position) {
+  // In input mode, the file position of the internal file is ahead of the
+  // data read, which is cached.
+  if (mode_ != kOutputMode)
+    return false;
+  return Flush() && internal_file_->PrepareKernelCopy(fd, position);
+}
+
+bool ThreadedIoFile::CompleteKernelCopy(uint64_t bytes_copied) {
+  DCHECK_EQ(kOutputMode, mode_);
+  if (!internal_file_->CompleteKernelCopy(bytes_copied))
+    return false;
+  position_ += bytes_copied;
+  if (position_ > size_)
+    size_ = position_;
+  return true;
+}
+
 void ThreadedIoFile::TaskHandler() {
   if (mode_ == kInputMode)
     RunInInputMode();
@@ -177,6 +282,7 @@ void ThreadedIoFile::RunInInputMode() {
       cache_.Close();
       return;
     }
+    RecordCacheWrite(read_result);
     if (cache_.Write(&io_buffer_[0], read_result) == 0) {
       return;
     }
@@ -198,23 +304,96 @@ void ThreadedIoFile::RunInOutputMode() {
         return;
       }
     } else {
-      uint64_t bytes_written(0);
-      while (bytes_written < write_bytes) {
-        int64_t write_result = internal_file_->Write(
-            &io_buffer_[bytes_written], write_bytes - bytes_written);
-        if (write_result < 0) {
-          internal_file_error_.store(write_result, std::memory_order_relaxed);
-          cache_.Close();
-          if (flushing_) {
-            flushing_ = false;
-            flush_complete_event_.Signal();
-          }
-          return;
+      if (!WriteToInternalFile(write_bytes)) {
+        if (flushing_) {
+          flushing_ = false;
+          flush_complete_event_.Signal();
         }
-        bytes_written += write_result;
+        return;
       }
     }
   }
 }
 
+bool ThreadedIoFile::WriteToInternalFile(uint64_t length) {
+  uint64_t bytes_written(0);
+  while (bytes_written < length) {
+    int64_t write_result = internal_file_->Write(&io_buffer_[bytes_written],
+                                                 length - bytes_written);
+    if (write_result < 0) {
+      internal_file_error_.store(write_result, std::memory_order_relaxed);
+      // Unblocks the writer.
+      cache_.Close();
+      return false;
+    }
+    bytes_written += write_result;
+  }
+  return true;
+}
+
+void ThreadedIoFile::ScheduleDrain() {
+  {
+    base::AutoLock auto_lock(drain_lock_);
+    if (drain_scheduled_)
+      return;
+    drain_scheduled_ = true;
+  }
+  reactor_->PostTask(
+      base::Bind(&ThreadedIoFile::Drain, base::Unretained(this)));
+}
+
+void ThreadedIoFile::Drain() {
+  DCHECK(reactor_);
+  // This is the only reader of |cache_|, so the reads below do not block.
+  for (int i = 0; i < kMaxBlocksPerDrain && cache_.BytesCached() > 0 &&
+                  !internal_file_error_.load(std::memory_order_relaxed);
+       ++i) {
+    const uint64_t write_bytes =
+        cache_.Read(&io_buffer_[0], io_buffer_.size());
+    if (!WriteToInternalFile(write_bytes))
+      break;
+  }
+  {
+    base::AutoLock auto_lock(drain_lock_);
+    // The writer schedules a drain after writing to |cache_|, so either it
+    // sees |drain_scheduled_| reset or the check below sees its data.
+    const bool has_more_data =
+        cache_.BytesCached() > 0 &&
+        !internal_file_error_.load(std::memory_order_relaxed);
+    if (!has_more_data) {
+      drain_scheduled_ = false;
+      drain_done_.Broadcast();
+      return;
+    }
+  }
+  // Yield to the other files.
+  reactor_->PostTask(
+      base::Bind(&ThreadedIoFile::Drain, base::Unretained(this)));
+}
+
+void ThreadedIoFile::WaitUntilDrained() {
+  ScheduleDrain();
+  base::AutoLock auto_lock(drain_lock_);
+  while (drain_scheduled_)
+    drain_done_.Wait();
+}
+
+void ThreadedIoFile::RecordCacheWrite(uint64_t length) {
+  Metrics* metrics = Metrics::GetInstance();
+  metrics->IncrementCounter(
+      "shaka_io_bytes",
+      "Bytes read from an input or written to an output through the I/O "
+      "cache, e.g. to compute the bitrate of a live input.",
+      metrics_labels_, static_cast<double>(length));
+  // For inputs, the data may be dropped upstream while waiting, e.g. by the
+  // kernel for UDP inputs once the socket receive buffer is full.
+  if (cache_.BytesFree() < length) {
+    metrics->IncrementCounter(
+        "shaka_io_cache_stalls",
+        "Writes to the I/O cache of a file which waited for free space, i.e. "
+        "the file was not read from or written to fast enough.",
+        metrics_labels_, 1);
+  }
+}
+
 }  // namespace shaka
@@ -9,22 +9,35 @@
 
 #include <atomic>
 #include <memory>
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/base/synchronization/waitable_event.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
 #include "packager/file/io_cache.h"
+#include "packager/metrics/metrics.h"
 
 namespace shaka {
 
+class IoReactor;
+
 /// Declaration of class which implements a thread-safe circular buffer.
 class ThreadedIoFile : public File {
  public:
   enum Mode { kInputMode, kOutputMode };
 
+  /// @param io_cache_size is the initial and minimum size of the I/O cache.
+  /// @param io_cache_max_size is the size up to which the I/O cache may grow
+  ///        if the file is written in bursts, see IoCache.
+  /// @param reactor is optional. If set, in output mode, the data is written
+  ///        to @a internal_file by tasks posted to @a reactor when there is
+  ///        data to write, instead of by a thread of the file.
   ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                  Mode mode,
                  uint64_t io_cache_size,
-                 uint64_t io_block_size);
+                 uint64_t io_cache_max_size,
+                 uint64_t io_block_size,
+                 IoReactor* reactor = nullptr);
 
   /// @name File implementation overrides.
   /// @{
@@ -35,12 +48,15 @@ class ThreadedIoFile : public File {
   bool Flush() override;
   bool Seek(uint64_t position) override;
   bool Tell(uint64_t* position) override;
+  void Abort() override;
   /// @}
 
  protected:
   ~ThreadedIoFile() override;
 
   bool Open() override;
+  bool PrepareKernelCopy(int* fd, uint64_t* position) override;
+  bool CompleteKernelCopy(uint64_t bytes_copied) override;
 
  private:
   // Internal task handler implementation. Will dispatch to either
@@ -48,19 +64,44 @@ class ThreadedIoFile : public File {
   void TaskHandler();
   void RunInInputMode();
   void RunInOutputMode();
+  // Write |length| bytes of |io_buffer_| to |internal_file_|, recording the
+  // error in |internal_file_error_| on failure.
+  bool WriteToInternalFile(uint64_t length);
+  // Output mode with |reactor_|: write the data of |cache_| from a task
+  // posted to |reactor_|, scheduled by ScheduleDrain() if there is none.
+  void ScheduleDrain();
+  void Drain();
+  // Wait until |cache_| is written to |internal_file_| or there is an error.
+  void WaitUntilDrained();
+  // Record a write of |length| bytes to |cache_| in the metrics, before it is
+  // made, including whether it has to wait for free space in the cache.
+  void RecordCacheWrite(uint64_t length);
 
   std::unique_ptr<File, FileCloser> internal_file_;
   const Mode mode_;
   IoCache cache_;
+  const uint64_t io_cache_size_;
   std::vector<uint8_t> io_buffer_;
   uint64_t position_;
   uint64_t size_;
   std::atomic<bool> eof_;
+  std::atomic<bool> aborted_{false};
   bool flushing_;
   base::WaitableEvent flush_complete_event_;
   std::atomic<int32_t> internal_file_error_;
   // Signalled when thread task exits.
   base::WaitableEvent task_exit_event_;
+  IoReactor* const reactor_;
+  base::Lock drain_lock_;
+  // Signalled when |drain_scheduled_| is reset.
+  base::ConditionVariable drain_done_;
+  // Set while a Drain() task is posted or running.
+  bool drain_scheduled_ = false;
+  // Ids of the gauges reporting the occupancy, size and stall time of
+  // |cache_|.
+  std::vector<int> cache_gauge_ids_;
+  // Labels of the metrics of this file.
+  MetricLabels metrics_labels_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadedIoFile);
 };
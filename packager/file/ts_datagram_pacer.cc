@@ -0,0 +1,174 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/ts_datagram_pacer.h"
+
+#include <string.h>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+
+namespace {
+
+const size_t kTsPacketSize = 188;
+const uint8_t kSyncByte = 0x47;
+// The PCR is a 33-bit base in 90 kHz units, times 300, plus an extension in
+// 27 MHz units.
+const uint64_t kPcrClockRate = 27000000;
+const uint64_t kPcrWrapAround = (1ull << 33) * 300;
+// PCRs further apart are treated as a discontinuity, e.g. a timestamp jump in
+// the input. The spec requires a PCR at least every 100 ms.
+const uint64_t kMaxPcrInterval = kPcrClockRate;
+const uint64_t kMicrosecondsPerSecond = 1000000;
+
+// Gets the PCR of |packet| in 27 MHz ticks.
+// @return false if the packet has no PCR.
+bool GetPcr(const uint8_t* packet, uint64_t* pcr) {
+  if (packet[0] != kSyncByte)
+    return false;
+  const bool has_adaptation_field = (packet[3] & 0x20) != 0;
+  const uint8_t adaptation_field_length = packet[4];
+  const bool has_pcr_flag = (packet[5] & 0x10) != 0;
+  if (!has_adaptation_field || adaptation_field_length < 7 || !has_pcr_flag)
+    return false;
+  const uint64_t pcr_base = (static_cast<uint64_t>(packet[6]) << 25) |
+                            (static_cast<uint64_t>(packet[7]) << 17) |
+                            (static_cast<uint64_t>(packet[8]) << 9) |
+                            (static_cast<uint64_t>(packet[9]) << 1) |
+                            (packet[10] >> 7);
+  const uint64_t pcr_extension = ((packet[10] & 0x01) << 8) | packet[11];
+  *pcr = pcr_base * 300 + pcr_extension;
+  return true;
+}
+
+}  // namespace
+
+TsDatagramPacer::TsDatagramPacer() {}
+
+TsDatagramPacer::~TsDatagramPacer() {}
+
+void TsDatagramPacer::AddData(const uint8_t* data, size_t size) {
+  if (!partial_packet_.empty()) {
+    const size_t bytes_needed = kTsPacketSize - partial_packet_.size();
+    if (size < bytes_needed) {
+      partial_packet_.insert(partial_packet_.end(), data, data + size);
+      return;
+    }
+    partial_packet_.insert(partial_packet_.end(), data, data + bytes_needed);
+    AddPacket(partial_packet_.data());
+    partial_packet_.clear();
+    data += bytes_needed;
+    size -= bytes_needed;
+  }
+  for (; size >= kTsPacketSize; data += kTsPacketSize, size -= kTsPacketSize)
+    AddPacket(data);
+  partial_packet_.assign(data, data + size);
+}
+
+void TsDatagramPacer::Flush() {
+  const size_t num_packets =
+      num_scheduled_packets_ + pending_packets_.size() / kTsPacketSize;
+  SchedulePendingPackets(EstimateDuration(num_packets), num_packets);
+  if (!partial_packet_.empty()) {
+    AddToDatagram(partial_packet_.data(), partial_packet_.size(),
+                  last_pcr_send_time_);
+    partial_packet_.clear();
+  }
+  if (!current_datagram_.payload.empty()) {
+    datagrams_.push_back(std::move(current_datagram_));
+    current_datagram_ = Datagram();
+  }
+}
+
+bool TsDatagramPacer::GetNextDatagram(Datagram* datagram) {
+  DCHECK(datagram);
+  if (datagrams_.empty())
+    return false;
+  *datagram = std::move(datagrams_.front());
+  datagrams_.pop_front();
+  return true;
+}
+
+void TsDatagramPacer::AddPacket(const uint8_t* packet) {
+  uint64_t pcr = 0;
+  if (GetPcr(packet, &pcr)) {
+    if (has_pcr_) {
+      // The packets of the PCR interval, including the ones scheduled on
+      // Flush().
+      const size_t num_packets =
+          num_scheduled_packets_ + pending_packets_.size() / kTsPacketSize;
+      const uint64_t pcr_interval =
+          (pcr + kPcrWrapAround - last_pcr_) % kPcrWrapAround;
+      base::TimeDelta interval;
+      if (pcr_interval > 0 && pcr_interval <= kMaxPcrInterval) {
+        interval = base::TimeDelta::FromMicroseconds(
+            pcr_interval * kMicrosecondsPerSecond / kPcrClockRate);
+        if (num_packets > 0) {
+          last_interval_ = interval;
+          last_interval_packets_ = num_packets;
+        }
+      } else {
+        VLOG(1) << "PCR discontinuity from " << last_pcr_ << " to " << pcr
+                << ". Keeping the previous mux rate.";
+        interval = EstimateDuration(num_packets);
+      }
+      SchedulePendingPackets(interval, num_packets);
+      last_pcr_send_time_ += interval;
+      num_scheduled_packets_ = 0;
+    }
+    has_pcr_ = true;
+    last_pcr_ = pcr;
+  }
+
+  if (!has_pcr_) {
+    // Nothing to pace the packets before the first PCR with.
+    AddToDatagram(packet, kTsPacketSize, last_pcr_send_time_);
+    return;
+  }
+  pending_packets_.insert(pending_packets_.end(), packet,
+                          packet + kTsPacketSize);
+}
+
+base::TimeDelta TsDatagramPacer::EstimateDuration(size_t num_packets) const {
+  if (last_interval_packets_ == 0)
+    return base::TimeDelta();
+  return base::TimeDelta::FromMicroseconds(
+      last_interval_.InMicroseconds() * static_cast<int64_t>(num_packets) /
+      static_cast<int64_t>(last_interval_packets_));
+}
+
+void TsDatagramPacer::SchedulePendingPackets(base::TimeDelta interval,
+                                             size_t num_packets) {
+  const size_t num_pending_packets = pending_packets_.size() / kTsPacketSize;
+  DCHECK_LE(num_scheduled_packets_ + num_pending_packets, num_packets);
+  for (size_t i = 0; i < num_pending_packets; ++i) {
+    const int64_t index = static_cast<int64_t>(num_scheduled_packets_ + i);
+    const base::TimeDelta offset = base::TimeDelta::FromMicroseconds(
+        interval.InMicroseconds() * index / static_cast<int64_t>(num_packets));
+    AddToDatagram(pending_packets_.data() + i * kTsPacketSize, kTsPacketSize,
+                  last_pcr_send_time_ + offset);
+  }
+  num_scheduled_packets_ += num_pending_packets;
+  pending_packets_.clear();
+}
+
+void TsDatagramPacer::AddToDatagram(const uint8_t* data,
+                                    size_t size,
+                                    base::TimeDelta send_time) {
+  std::vector<uint8_t>& payload = current_datagram_.payload;
+  if (payload.empty()) {
+    current_datagram_.send_time = send_time;
+    payload.reserve(kTsPacketsPerDatagram * kTsPacketSize);
+  }
+  payload.insert(payload.end(), data, data + size);
+  if (payload.size() >= kTsPacketsPerDatagram * kTsPacketSize) {
+    datagrams_.push_back(std::move(current_datagram_));
+    current_datagram_ = Datagram();
+  }
+}
+
+}  // namespace shaka
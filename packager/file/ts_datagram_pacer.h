@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_TS_DATAGRAM_PACER_H_
+#define PACKAGER_FILE_TS_DATAGRAM_PACER_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// Packs an MPEG-2 TS stream into datagrams of seven TS packets, as usual for
+/// MPEG-2 TS over UDP, and schedules them at the stream's mux rate. The TS
+/// packets between two PCRs are spread evenly over the PCR interval, so a
+/// segment written at once is sent over its duration instead of in a burst.
+/// The packets after the last PCR are scheduled when the next PCR is added,
+/// or at the rate of the last PCR interval on Flush(). Not thread safe.
+class TsDatagramPacer {
+ public:
+  struct Datagram {
+    std::vector<uint8_t> payload;
+    /// The time to send the datagram at, relative to the start of the stream.
+    base::TimeDelta send_time;
+  };
+
+  /// The number of TS packets of a full datagram.
+  static const size_t kTsPacketsPerDatagram = 7;
+
+  TsDatagramPacer();
+  ~TsDatagramPacer();
+
+  /// Add TS data. It does not have to end at a TS packet boundary.
+  void AddData(const uint8_t* data, size_t size);
+
+  /// Schedule the data added which is still waiting for a PCR, and release the
+  /// datagram partially filled, e.g. when the stream ends.
+  void Flush();
+
+  /// Get the next datagram scheduled, in send time order.
+  /// @return false if there is none.
+  bool GetNextDatagram(Datagram* datagram);
+
+ private:
+  TsDatagramPacer(const TsDatagramPacer&) = delete;
+  TsDatagramPacer& operator=(const TsDatagramPacer&) = delete;
+
+  void AddPacket(const uint8_t* packet);
+  // @return the duration of |num_packets| at the rate of the last PCR
+  //         interval.
+  base::TimeDelta EstimateDuration(size_t num_packets) const;
+  // Schedule the packets of |pending_packets_|, the last ones of the
+  // |num_packets| of the PCR interval, over |interval|.
+  void SchedulePendingPackets(base::TimeDelta interval, size_t num_packets);
+  // Add |size| bytes to the current datagram, scheduled at |send_time| if
+  // they are its first bytes.
+  void AddToDatagram(const uint8_t* data,
+                     size_t size,
+                     base::TimeDelta send_time);
+
+  // The bytes of the TS packet split by the last AddData() call.
+  std::vector<uint8_t> partial_packet_;
+  // The TS packets since the last PCR, including the one with the PCR, which
+  // are not scheduled yet.
+  std::vector<uint8_t> pending_packets_;
+  // The TS packets since the last PCR scheduled on Flush().
+  size_t num_scheduled_packets_ = 0;
+  bool has_pcr_ = false;
+  // The last PCR, in 27 MHz ticks, and its send time.
+  uint64_t last_pcr_ = 0;
+  base::TimeDelta last_pcr_send_time_;
+  // The duration and number of TS packets of the last PCR interval, i.e. the
+  // mux rate.
+  base::TimeDelta last_interval_;
+  size_t last_interval_packets_ = 0;
+  Datagram current_datagram_;
+  std::deque<Datagram> datagrams_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_TS_DATAGRAM_PACER_H_
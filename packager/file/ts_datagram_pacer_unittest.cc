@@ -0,0 +1,173 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/ts_datagram_pacer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace shaka {
+namespace {
+
+const size_t kTsPacketSize = 188;
+const size_t kDatagramSize =
+    TsDatagramPacer::kTsPacketsPerDatagram * kTsPacketSize;
+
+// Makes a TS packet filled with |fill|, with a PCR if |pcr_base| is not
+// negative.
+std::vector<uint8_t> MakePacket(int64_t pcr_base, uint8_t fill) {
+  std::vector<uint8_t> packet(kTsPacketSize, fill);
+  packet[0] = 0x47;
+  packet[1] = 0x00;
+  packet[2] = 0x50;
+  if (pcr_base < 0) {
+    packet[3] = 0x10;  // Payload only.
+    return packet;
+  }
+  packet[3] = 0x30;  // Adaptation field and payload.
+  packet[4] = 7;     // Adaptation field length.
+  packet[5] = 0x10;  // PCR flag.
+  packet[6] = static_cast<uint8_t>(pcr_base >> 25);
+  packet[7] = static_cast<uint8_t>(pcr_base >> 17);
+  packet[8] = static_cast<uint8_t>(pcr_base >> 9);
+  packet[9] = static_cast<uint8_t>(pcr_base >> 1);
+  packet[10] = static_cast<uint8_t>(((pcr_base & 1) << 7) | 0x7E);
+  packet[11] = 0;
+  return packet;
+}
+
+// Adds |num_packets| TS packets, the first one with |pcr_base|.
+void AddPcrInterval(int64_t pcr_base,
+                    size_t num_packets,
+                    TsDatagramPacer* pacer) {
+  std::vector<uint8_t> data = MakePacket(pcr_base, 0);
+  for (size_t i = 1; i < num_packets; ++i) {
+    const std::vector<uint8_t> packet = MakePacket(-1, 0);
+    data.insert(data.end(), packet.begin(), packet.end());
+  }
+  pacer->AddData(data.data(), data.size());
+}
+
+std::vector<TsDatagramPacer::Datagram> GetDatagrams(TsDatagramPacer* pacer) {
+  std::vector<TsDatagramPacer::Datagram> datagrams;
+  TsDatagramPacer::Datagram datagram;
+  while (pacer->GetNextDatagram(&datagram))
+    datagrams.push_back(std::move(datagram));
+  return datagrams;
+}
+
+}  // namespace
+
+TEST(TsDatagramPacerTest, PacketsBeforeFirstPcr) {
+  TsDatagramPacer pacer;
+  for (size_t i = 0; i < TsDatagramPacer::kTsPacketsPerDatagram; ++i) {
+    const std::vector<uint8_t> packet =
+        MakePacket(-1, static_cast<uint8_t>(i));
+    pacer.AddData(packet.data(), packet.size());
+  }
+  const std::vector<TsDatagramPacer::Datagram> datagrams =
+      GetDatagrams(&pacer);
+  ASSERT_EQ(1u, datagrams.size());
+  ASSERT_EQ(kDatagramSize, datagrams[0].payload.size());
+  EXPECT_EQ(base::TimeDelta(), datagrams[0].send_time);
+  EXPECT_EQ(6, datagrams[0].payload[kDatagramSize - 1]);
+}
+
+TEST(TsDatagramPacerTest, SpreadsPacketsOverPcrInterval) {
+  TsDatagramPacer pacer;
+  // 14 packets over 100 ms, i.e. two datagrams 50 ms apart.
+  AddPcrInterval(0, 14, &pacer);
+  EXPECT_TRUE(GetDatagrams(&pacer).empty());
+  AddPcrInterval(9000, 14, &pacer);
+
+  const std::vector<TsDatagramPacer::Datagram> datagrams =
+      GetDatagrams(&pacer);
+  ASSERT_EQ(2u, datagrams.size());
+  EXPECT_EQ(base::TimeDelta(), datagrams[0].send_time);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(50), datagrams[1].send_time);
+
+  // The last interval is sent at the same rate on Flush().
+  pacer.Flush();
+  const std::vector<TsDatagramPacer::Datagram> flushed_datagrams =
+      GetDatagrams(&pacer);
+  ASSERT_EQ(2u, flushed_datagrams.size());
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(100),
+            flushed_datagrams[0].send_time);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(150),
+            flushed_datagrams[1].send_time);
+}
+
+TEST(TsDatagramPacerTest, DataSplitAcrossPackets) {
+  TsDatagramPacer pacer;
+  std::vector<uint8_t> data;
+  for (size_t i = 0; i < TsDatagramPacer::kTsPacketsPerDatagram; ++i) {
+    const std::vector<uint8_t> packet =
+        MakePacket(-1, static_cast<uint8_t>(i));
+    data.insert(data.end(), packet.begin(), packet.end());
+  }
+  // Splits the packets at odd positions.
+  const size_t kChunkSize = 100;
+  for (size_t offset = 0; offset < data.size(); offset += kChunkSize) {
+    pacer.AddData(data.data() + offset,
+                  std::min(kChunkSize, data.size() - offset));
+  }
+  const std::vector<TsDatagramPacer::Datagram> datagrams =
+      GetDatagrams(&pacer);
+  ASSERT_EQ(1u, datagrams.size());
+  EXPECT_EQ(data, datagrams[0].payload);
+}
+
+TEST(TsDatagramPacerTest, FlushPartialDatagram) {
+  TsDatagramPacer pacer;
+  const std::vector<uint8_t> packet = MakePacket(-1, 0);
+  pacer.AddData(packet.data(), packet.size());
+  // Not a whole TS packet.
+  pacer.AddData(packet.data(), 10);
+  EXPECT_TRUE(GetDatagrams(&pacer).empty());
+
+  pacer.Flush();
+  const std::vector<TsDatagramPacer::Datagram> datagrams =
+      GetDatagrams(&pacer);
+  ASSERT_EQ(1u, datagrams.size());
+  EXPECT_EQ(kTsPacketSize + 10, datagrams[0].payload.size());
+}
+
+TEST(TsDatagramPacerTest, PcrDiscontinuityKeepsMuxRate) {
+  TsDatagramPacer pacer;
+  AddPcrInterval(0, 7, &pacer);
+  AddPcrInterval(9000, 7, &pacer);
+  // The PCR jumps back, so the last interval is sent at the previous rate.
+  AddPcrInterval(0, 7, &pacer);
+  AddPcrInterval(9000, 7, &pacer);
+
+  const std::vector<TsDatagramPacer::Datagram> datagrams =
+      GetDatagrams(&pacer);
+  ASSERT_EQ(3u, datagrams.size());
+  EXPECT_EQ(base::TimeDelta(), datagrams[0].send_time);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(100), datagrams[1].send_time);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(200), datagrams[2].send_time);
+}
+
+TEST(TsDatagramPacerTest, PcrWrapAround) {
+  TsDatagramPacer pacer;
+  const int64_t kMaxPcrBase = (1ll << 33) - 1;
+  AddPcrInterval(kMaxPcrBase - 8998, 7, &pacer);
+  AddPcrInterval(1, 7, &pacer);
+
+  const std::vector<TsDatagramPacer::Datagram> datagrams =
+      GetDatagrams(&pacer);
+  ASSERT_EQ(1u, datagrams.size());
+  pacer.Flush();
+  const std::vector<TsDatagramPacer::Datagram> flushed_datagrams =
+      GetDatagrams(&pacer);
+  ASSERT_EQ(1u, flushed_datagrams.size());
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(100),
+            flushed_datagrams[0].send_time);
+}
+
+}  // namespace shaka
@@ -18,12 +18,18 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <strings.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <unistd.h>
 #define INVALID_SOCKET -1
 #define EINTR_CODE EINTR
 
+// SO_RXQ_OVFL has been supported since kernel version 2.6.33.
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+
 // IP_MULTICAST_ALL has been supported since kernel version 2.6.31 but we may be
 // building on a machine that is older than that.
 #ifndef IP_MULTICAST_ALL
@@ -32,15 +38,42 @@
 
 #endif  // defined(OS_WIN)
 
+#include <algorithm>
 #include <limits>
 
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
 #include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/rtp_jitter_buffer.h"
 #include "packager/file/udp_options.h"
+#include "packager/metrics/metrics.h"
 
 namespace shaka {
 
 namespace {
 
+// The maximum size of a UDP datagram.
+const size_t kMaxDatagramSize = 65535;
+
+#if defined(__linux__)
+// The maximum number of datagrams received with a single recvmmsg() call.
+const size_t kMaxDatagramsPerRead = 64;
+#endif  // defined(__linux__)
+
+// The maximum number of datagrams sent with a single sendmmsg() call.
+const size_t kMaxDatagramsPerWrite = 64;
+// The paced datagrams due within this interval are sent together.
+const int64_t kPacingIntervalMs = 2;
+// The paced datagrams sent later than this, e.g. after the input stalled, are
+// not sent in a burst to catch up. The pacing restarts from them instead.
+const int64_t kMaxSendDelayMs = 200;
+// The maximum number of paced datagrams queued, about 40 MB. Write() waits
+// for the datagrams to be sent beyond that, e.g. when a file is sent in real
+// time.
+const size_t kMaxQueuedDatagrams = 32768;
+
 bool IsIpv4MulticastAddress(const struct in_addr& addr) {
   return (ntohl(addr.s_addr) & 0xf0000000) == 0xe0000000;
 }
@@ -55,16 +88,35 @@ int GetSocketErrorCode() {
 
 }  // anonymous namespace
 
-UdpFile::UdpFile(const char* file_name)
-    : File(file_name), socket_(INVALID_SOCKET) {}
+UdpFile::UdpFile(const char* file_name, const char* mode)
+    : File(file_name),
+      socket_(INVALID_SOCKET),
+      fec_sockets_{INVALID_SOCKET, INVALID_SOCKET},
+      file_mode_(mode),
+      datagram_queued_(&lock_),
+      datagram_sent_(&lock_) {}
 
 UdpFile::~UdpFile() {}
 
 bool UdpFile::Close() {
+  if (pacer_) {
+    Flush();
+    base::AutoLock auto_lock(lock_);
+    closing_ = true;
+    datagram_queued_.Signal();
+    while (sender_running_)
+      datagram_sent_.Wait();
+  }
   if (socket_ != INVALID_SOCKET) {
     close(socket_);
     socket_ = INVALID_SOCKET;
   }
+  for (SOCKET& fec_socket : fec_sockets_) {
+    if (fec_socket != INVALID_SOCKET) {
+      close(fec_socket);
+      fec_socket = INVALID_SOCKET;
+    }
+  }
   delete this;
 #if defined(OS_WIN)
   if (wsa_started_)
@@ -75,24 +127,339 @@ bool UdpFile::Close() {
 
 int64_t UdpFile::Read(void* buffer, uint64_t length) {
   DCHECK(buffer);
-  DCHECK_GE(length, 65535u)
+  DCHECK_GE(length, kMaxDatagramSize)
       << "Buffer may be too small to read entire datagram.";
 
-  if (socket_ == INVALID_SOCKET)
+  if (socket_ == INVALID_SOCKET || pacer_)
     return -1;
 
+  if (jitter_buffer_)
+    return ReadRtpPayloads(reinterpret_cast<uint8_t*>(buffer), length);
+  return ReceiveDatagrams(reinterpret_cast<uint8_t*>(buffer), length, nullptr);
+}
+
+int64_t UdpFile::ReceiveDatagrams(uint8_t* buffer,
+                                  uint64_t length,
+                                  std::vector<size_t>* datagram_sizes) {
+  if (datagram_sizes)
+    datagram_sizes->clear();
+#if defined(__linux__)
+  return ReceiveDatagramsInBatch(buffer, length, datagram_sizes);
+#else
   int64_t result;
   do {
     result =
         recvfrom(socket_, reinterpret_cast<char*>(buffer), length, 0, NULL, 0);
   } while (result == -1 && GetSocketErrorCode() == EINTR_CODE);
 
+  if (result >= 0 && datagram_sizes)
+    datagram_sizes->push_back(result);
   return result;
+#endif  // defined(__linux__)
+}
+
+int64_t UdpFile::ReadRtpPayloads(uint8_t* buffer, uint64_t length) {
+  while (true) {
+    const size_t bytes_read = jitter_buffer_->ReadPayloads(buffer, length);
+    ReportRtpMetrics();
+    if (bytes_read > 0)
+      return bytes_read;
+
+    ReceiveFecPackets();
+    const int64_t result =
+        ReceiveDatagrams(rtp_buffer_.data(), rtp_buffer_.size(),
+                         &datagram_sizes_);
+    if (result < 0) {
+      // Release the packets left, e.g. when the stream stops and the receive
+      // times out, before reporting the error.
+      jitter_buffer_->Flush();
+      const size_t bytes_flushed = jitter_buffer_->ReadPayloads(buffer, length);
+      ReportRtpMetrics();
+      return bytes_flushed > 0 ? bytes_flushed : result;
+    }
+    const uint8_t* datagram = rtp_buffer_.data();
+    for (size_t datagram_size : datagram_sizes_) {
+      if (!jitter_buffer_->AddPacket(datagram, datagram_size))
+        VLOG(1) << "Ignoring an invalid RTP packet in " << file_name();
+      datagram += datagram_size;
+    }
+  }
+}
+
+void UdpFile::ReceiveFecPackets() {
+  for (SOCKET fec_socket : fec_sockets_) {
+    if (fec_socket == INVALID_SOCKET)
+      continue;
+    // Receive the FEC packets already there, without waiting.
+    while (true) {
+      fd_set read_fds;
+      FD_ZERO(&read_fds);
+      FD_SET(fec_socket, &read_fds);
+      struct timeval no_timeout = {0, 0};
+      if (select(static_cast<int>(fec_socket) + 1, &read_fds, NULL, NULL,
+                 &no_timeout) <= 0) {
+        break;
+      }
+      const int64_t size =
+          recvfrom(fec_socket, reinterpret_cast<char*>(rtp_buffer_.data()),
+                   rtp_buffer_.size(), 0, NULL, 0);
+      if (size <= 0)
+        break;
+      if (!jitter_buffer_->AddFecPacket(rtp_buffer_.data(), size))
+        VLOG(1) << "Ignoring an invalid FEC packet in " << file_name();
+    }
+  }
+}
+
+void UdpFile::ReportRtpMetrics() {
+  Metrics* metrics = Metrics::GetInstance();
+  const uint64_t lost_packets = jitter_buffer_->lost_packets();
+  if (lost_packets > reported_lost_packets_) {
+    metrics->IncrementCounter(
+        "shaka_rtp_lost_packets",
+        "RTP packets of a UDP input which were lost, i.e. neither received in "
+        "time nor recovered from the FEC packets.",
+        {{"file", file_name()}}, lost_packets - reported_lost_packets_);
+    reported_lost_packets_ = lost_packets;
+  }
+  const uint64_t recovered_packets = jitter_buffer_->recovered_packets();
+  if (recovered_packets > reported_recovered_packets_) {
+    metrics->IncrementCounter(
+        "shaka_rtp_recovered_packets",
+        "RTP packets of a UDP input recovered from the FEC packets.",
+        {{"file", file_name()}},
+        recovered_packets - reported_recovered_packets_);
+    reported_recovered_packets_ = recovered_packets;
+  }
+}
+
+#if defined(__linux__)
+int64_t UdpFile::ReceiveDatagramsInBatch(uint8_t* buffer,
+                                         uint64_t length,
+                                         std::vector<size_t>* datagram_sizes) {
+  // Receive as many datagrams as there are in the socket with a single system
+  // call, into slots of twice the size of the largest datagram seen. The
+  // datagrams of a stream are usually all of the same size, e.g. seven TS
+  // packets, so the buffer holds many of them.
+  const size_t slot_size =
+      largest_datagram_size_ > 0
+          ? std::min(kMaxDatagramSize, 2 * largest_datagram_size_)
+          : kMaxDatagramSize;
+  const size_t num_slots = static_cast<size_t>(std::max<uint64_t>(
+      1, std::min<uint64_t>(kMaxDatagramsPerRead, length / slot_size)));
+  struct iovec iovecs[kMaxDatagramsPerRead];
+  struct mmsghdr messages[kMaxDatagramsPerRead];
+  // Room for the SO_RXQ_OVFL drop counts.
+  uint8_t controls[kMaxDatagramsPerRead][CMSG_SPACE(sizeof(uint32_t))];
+  memset(messages, 0, sizeof(messages[0]) * num_slots);
+  for (size_t i = 0; i < num_slots; ++i) {
+    iovecs[i].iov_base = buffer + i * slot_size;
+    iovecs[i].iov_len =
+        i + 1 < num_slots ? slot_size : length - i * slot_size;
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+    messages[i].msg_hdr.msg_control = controls[i];
+    messages[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+  }
+
+  // Only wait, or time out, for the first datagram.
+  int num_datagrams;
+  do {
+    num_datagrams =
+        recvmmsg(socket_, messages, num_slots, MSG_WAITFORONE, NULL);
+  } while (num_datagrams == -1 && GetSocketErrorCode() == EINTR_CODE);
+  if (num_datagrams < 0)
+    return -1;
+
+  // Pack the datagrams at the front of the buffer.
+  uint64_t bytes_read = 0;
+  for (int i = 0; i < num_datagrams; ++i) {
+    const size_t datagram_size = messages[i].msg_len;
+    if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      LOG(WARNING) << "A datagram larger than " << iovecs[i].iov_len
+                   << " bytes was truncated in " << file_name()
+                   << ". Receiving datagrams of up to " << kMaxDatagramSize
+                   << " bytes from now on.";
+      largest_datagram_size_ = kMaxDatagramSize;
+    }
+    memmove(buffer + bytes_read, iovecs[i].iov_base, datagram_size);
+    bytes_read += datagram_size;
+    if (datagram_sizes)
+      datagram_sizes->push_back(datagram_size);
+    largest_datagram_size_ = std::max(largest_datagram_size_, datagram_size);
+  }
+
+  // The number of datagrams dropped by the kernel since the socket was opened,
+  // e.g. because the receive buffer was full, is attached to the datagrams
+  // received after the first drop.
+  uint32_t dropped_datagrams = dropped_datagrams_;
+  for (int i = 0; i < num_datagrams; ++i) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&messages[i].msg_hdr); cmsg;
+         cmsg = CMSG_NXTHDR(&messages[i].msg_hdr, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+        uint32_t count;
+        memcpy(&count, CMSG_DATA(cmsg), sizeof(count));
+        dropped_datagrams = std::max(dropped_datagrams, count);
+      }
+    }
+  }
+  if (dropped_datagrams > dropped_datagrams_) {
+    LOG(WARNING) << dropped_datagrams - dropped_datagrams_
+                 << " datagrams were dropped by the kernel in " << file_name()
+                 << ". Consider increasing the receive buffer size.";
+    Metrics::GetInstance()->IncrementCounter(
+        "shaka_udp_dropped_datagrams",
+        "Datagrams of a UDP input dropped by the kernel, e.g. because the "
+        "socket receive buffer was full.",
+        {{"file", file_name()}}, dropped_datagrams - dropped_datagrams_);
+    dropped_datagrams_ = dropped_datagrams;
+  }
+  return bytes_read;
 }
+#endif  // defined(__linux__)
 
 int64_t UdpFile::Write(const void* buffer, uint64_t length) {
-  NOTIMPLEMENTED();
-  return -1;
+  if (socket_ == INVALID_SOCKET || !pacer_)
+    return -1;
+
+  pacer_->AddData(reinterpret_cast<const uint8_t*>(buffer), length);
+  SendOrQueueDatagrams();
+  return length;
+}
+
+void UdpFile::SendOrQueueDatagrams() {
+  TsDatagramPacer::Datagram datagram;
+  if (!pace_) {
+    std::vector<TsDatagramPacer::Datagram> datagrams;
+    while (pacer_->GetNextDatagram(&datagram))
+      datagrams.push_back(std::move(datagram));
+    SendDatagrams(datagrams);
+    return;
+  }
+
+  base::AutoLock auto_lock(lock_);
+  while (pacer_->GetNextDatagram(&datagram)) {
+    while (send_queue_.size() >= kMaxQueuedDatagrams)
+      datagram_sent_.Wait();
+    send_queue_.push_back(std::move(datagram));
+    datagram_queued_.Signal();
+  }
+}
+
+void UdpFile::SendTask() {
+  const base::TimeDelta kPacingInterval =
+      base::TimeDelta::FromMilliseconds(kPacingIntervalMs);
+  const base::TimeDelta kMaxSendDelay =
+      base::TimeDelta::FromMilliseconds(kMaxSendDelayMs);
+  // The time to send the datagrams with a zero send time at.
+  base::TimeTicks start_time;
+  std::vector<TsDatagramPacer::Datagram> batch;
+
+  base::AutoLock auto_lock(lock_);
+  while (true) {
+    while (send_queue_.empty() && !closing_)
+      datagram_queued_.Wait();
+    if (send_queue_.empty())
+      break;
+
+    const base::TimeTicks now = base::TimeTicks::Now();
+    const base::TimeDelta next_send_time = send_queue_.front().send_time;
+    if (start_time.is_null() ||
+        now - (start_time + next_send_time) > kMaxSendDelay) {
+      start_time = now - next_send_time;
+    }
+    const base::TimeTicks due_time = start_time + next_send_time;
+    if (due_time > now + kPacingInterval) {
+      // Woken up early if more datagrams are queued, so check again.
+      datagram_queued_.TimedWait(due_time - now);
+      continue;
+    }
+
+    while (!send_queue_.empty() && batch.size() < kMaxDatagramsPerWrite &&
+           start_time + send_queue_.front().send_time <=
+               now + kPacingInterval) {
+      batch.push_back(std::move(send_queue_.front()));
+      send_queue_.pop_front();
+    }
+    sending_ = true;
+    {
+      base::AutoUnlock auto_unlock(lock_);
+      SendDatagrams(batch);
+    }
+    sending_ = false;
+    batch.clear();
+    datagram_sent_.Broadcast();
+  }
+  sender_running_ = false;
+  datagram_sent_.Broadcast();
+}
+
+void UdpFile::SendDatagrams(
+    const std::vector<TsDatagramPacer::Datagram>& datagrams) {
+  struct sockaddr_in destination = {0};
+  destination.sin_family = AF_INET;
+  destination.sin_addr.s_addr = destination_address_;
+  destination.sin_port = destination_port_;
+
+#if defined(__linux__)
+  // Send the datagrams in batches, with a single system call each.
+  struct iovec iovecs[kMaxDatagramsPerWrite];
+  struct mmsghdr messages[kMaxDatagramsPerWrite];
+  size_t num_sent = 0;
+  while (num_sent < datagrams.size()) {
+    const size_t num_messages =
+        std::min(kMaxDatagramsPerWrite, datagrams.size() - num_sent);
+    memset(messages, 0, sizeof(messages[0]) * num_messages);
+    for (size_t i = 0; i < num_messages; ++i) {
+      const std::vector<uint8_t>& payload = datagrams[num_sent + i].payload;
+      iovecs[i].iov_base = const_cast<uint8_t*>(payload.data());
+      iovecs[i].iov_len = payload.size();
+      messages[i].msg_hdr.msg_name = &destination;
+      messages[i].msg_hdr.msg_namelen = sizeof(destination);
+      messages[i].msg_hdr.msg_iov = &iovecs[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    const int result = sendmmsg(socket_, messages, num_messages, 0);
+    if (result > 0) {
+      num_sent += result;
+    } else if (result < 0 && GetSocketErrorCode() == EINTR_CODE) {
+      continue;
+    } else {
+      // Skip the datagram which could not be sent.
+      ReportSendError();
+      ++num_sent;
+    }
+  }
+#else
+  for (const TsDatagramPacer::Datagram& datagram : datagrams) {
+    int64_t result;
+    do {
+      result = sendto(socket_,
+                      reinterpret_cast<const char*>(datagram.payload.data()),
+                      datagram.payload.size(), 0,
+                      reinterpret_cast<const struct sockaddr*>(&destination),
+                      sizeof(destination));
+    } while (result == -1 && GetSocketErrorCode() == EINTR_CODE);
+    if (result < 0)
+      ReportSendError();
+  }
+#endif  // defined(__linux__)
+}
+
+void UdpFile::ReportSendError() {
+  if (send_errors_++ == 0) {
+    LOG(WARNING) << "Failed to send a datagram to " << file_name()
+                 << ", error = " << GetSocketErrorCode()
+                 << ". Consider increasing the send buffer size.";
+  } else {
+    VLOG(1) << "Failed to send a datagram to " << file_name()
+            << ", error = " << GetSocketErrorCode();
+  }
+  Metrics::GetInstance()->IncrementCounter(
+      "shaka_udp_send_errors",
+      "Datagrams of a UDP output which could not be sent, e.g. because the "
+      "socket send buffer was full.",
+      {{"file", file_name()}}, 1);
 }
 
 int64_t UdpFile::Size() {
@@ -103,8 +470,15 @@ int64_t UdpFile::Size() {
 }
 
 bool UdpFile::Flush() {
-  NOTIMPLEMENTED();
-  return false;
+  if (socket_ == INVALID_SOCKET || !pacer_)
+    return false;
+
+  pacer_->Flush();
+  SendOrQueueDatagrams();
+  base::AutoLock auto_lock(lock_);
+  while (!send_queue_.empty() || sending_)
+    datagram_sent_.Wait();
+  return true;
 }
 
 bool UdpFile::Seek(uint64_t position) {
@@ -140,40 +514,26 @@ class ScopedSocket {
   DISALLOW_COPY_AND_ASSIGN(ScopedSocket);
 };
 
-bool UdpFile::Open() {
-#if defined(OS_WIN)
-  WSADATA wsa_data;
-  int wsa_error = WSAStartup(MAKEWORD(2, 2), &wsa_data);
-  if (wsa_error != 0) {
-    LOG(ERROR) << "Winsock start up failed with error " << wsa_error;
-    return false;
-  }
-  wsa_started_ = true;
-#endif  // defined(OS_WIN)
-
-  DCHECK_EQ(INVALID_SOCKET, socket_);
-
-  std::unique_ptr<UdpOptions> options =
-      UdpOptions::ParseFromString(file_name());
-  if (!options)
-    return false;
+namespace {
 
+// Open a socket receiving the stream at |port|, or return INVALID_SOCKET.
+SOCKET OpenSocket(const UdpOptions& options, uint16_t port) {
   ScopedSocket new_socket(socket(AF_INET, SOCK_DGRAM, 0));
   if (new_socket.get() == INVALID_SOCKET) {
     LOG(ERROR) << "Could not allocate socket, error = " << GetSocketErrorCode();
-    return false;
+    return INVALID_SOCKET;
   }
 
   struct in_addr local_in_addr = {0};
-  if (inet_pton(AF_INET, options->address().c_str(), &local_in_addr) != 1) {
-    LOG(ERROR) << "Malformed IPv4 address " << options->address();
-    return false;
+  if (inet_pton(AF_INET, options.address().c_str(), &local_in_addr) != 1) {
+    LOG(ERROR) << "Malformed IPv4 address " << options.address();
+    return INVALID_SOCKET;
   }
 
   struct sockaddr_in local_sock_addr = {0};
   // TODO(kqyang): Support IPv6.
   local_sock_addr.sin_family = AF_INET;
-  local_sock_addr.sin_port = htons(options->port());
+  local_sock_addr.sin_port = htons(port);
   const bool is_multicast = IsIpv4MulticastAddress(local_in_addr);
   if (is_multicast) {
     local_sock_addr.sin_addr.s_addr = htonl(INADDR_ANY);
@@ -181,7 +541,7 @@ bool UdpFile::Open() {
     local_sock_addr.sin_addr = local_in_addr;
   }
 
-  if (options->reuse()) {
+  if (options.reuse()) {
     const int optval = 1;
     if (setsockopt(new_socket.get(), SOL_SOCKET, SO_REUSEADDR,
                    reinterpret_cast<const char*>(&optval),
@@ -189,7 +549,7 @@ bool UdpFile::Open() {
       LOG(ERROR) << "Could not apply the SO_REUSEADDR property to the UDP "
                     "socket, error = "
                  << GetSocketErrorCode();
-      return false;
+      return INVALID_SOCKET;
     }
   }
 
@@ -197,27 +557,27 @@ bool UdpFile::Open() {
            reinterpret_cast<struct sockaddr*>(&local_sock_addr),
            sizeof(local_sock_addr)) < 0) {
     LOG(ERROR) << "Could not bind UDP socket, error = " << GetSocketErrorCode();
-    return false;
+    return INVALID_SOCKET;
   }
 
   if (is_multicast) {
-    if (options->is_source_specific_multicast()) {
+    if (options.is_source_specific_multicast()) {
       struct ip_mreq_source source_multicast_group;
 
       source_multicast_group.imr_multiaddr = local_in_addr;
       if (inet_pton(AF_INET,
-                    options->interface_address().c_str(),
+                    options.interface_address().c_str(),
                     &source_multicast_group.imr_interface) != 1) {
         LOG(ERROR) << "Malformed IPv4 interface address "
-                   << options->interface_address();
-        return false;
+                   << options.interface_address();
+        return INVALID_SOCKET;
       }
       if (inet_pton(AF_INET,
-                    options->source_address().c_str(),
+                    options.source_address().c_str(),
                     &source_multicast_group.imr_sourceaddr) != 1) {
         LOG(ERROR) << "Malformed IPv4 source specific multicast address "
-                   << options->source_address();
-        return false;
+                   << options.source_address();
+        return INVALID_SOCKET;
       }
 
       if (setsockopt(new_socket.get(),
@@ -227,7 +587,7 @@ bool UdpFile::Open() {
                      sizeof(source_multicast_group)) < 0) {
         LOG(ERROR) << "Failed to join multicast group, error = "
                    << GetSocketErrorCode();
-        return false;
+        return INVALID_SOCKET;
       }
     } else {
       // this is a v2 join without a specific source.
@@ -235,11 +595,11 @@ bool UdpFile::Open() {
 
       multicast_group.imr_multiaddr = local_in_addr;
 
-      if (inet_pton(AF_INET, options->interface_address().c_str(),
+      if (inet_pton(AF_INET, options.interface_address().c_str(),
                     &multicast_group.imr_interface) != 1) {
         LOG(ERROR) << "Malformed IPv4 interface address "
-                   << options->interface_address();
-        return false;
+                   << options.interface_address();
+        return INVALID_SOCKET;
       }
 
       if (setsockopt(new_socket.get(), IPPROTO_IP, IP_ADD_MEMBERSHIP,
@@ -247,7 +607,7 @@ bool UdpFile::Open() {
                      sizeof(multicast_group)) < 0) {
         LOG(ERROR) << "Failed to join multicast group, error = "
                    << GetSocketErrorCode();
-        return false;
+        return INVALID_SOCKET;
       }
   }
 
@@ -261,36 +621,148 @@ bool UdpFile::Open() {
         GetSocketErrorCode() != ENOPROTOOPT) {
       LOG(ERROR) << "Failed to disable IP_MULTICAST_ALL option, error = "
                  << GetSocketErrorCode();
-      return false;
+      return INVALID_SOCKET;
     }
 #endif  // #if defined(__linux__)
   }
 
   // Set timeout if needed.
-  if (options->timeout_us() != 0) {
+  if (options.timeout_us() != 0) {
     struct timeval tv;
-    tv.tv_sec = options->timeout_us() / 1000000;
-    tv.tv_usec = options->timeout_us() % 1000000;
+    tv.tv_sec = options.timeout_us() / 1000000;
+    tv.tv_usec = options.timeout_us() % 1000000;
     if (setsockopt(new_socket.get(), SOL_SOCKET, SO_RCVTIMEO,
                    reinterpret_cast<const char*>(&tv), sizeof(tv)) < 0) {
       LOG(ERROR) << "Failed to set socket timeout, error = "
                  << GetSocketErrorCode();
-      return false;
+      return INVALID_SOCKET;
     }
   }
 
-  if (options->buffer_size() > 0) {
-    const int receive_buffer_size = options->buffer_size();
+  if (options.buffer_size() > 0) {
+    const int receive_buffer_size = options.buffer_size();
     if (setsockopt(new_socket.get(), SOL_SOCKET, SO_RCVBUF,
                    reinterpret_cast<const char*>(&receive_buffer_size),
                    sizeof(receive_buffer_size)) < 0) {
       LOG(ERROR) << "Failed to set the maximum receive buffer size, error = "
                  << GetSocketErrorCode();
+      return INVALID_SOCKET;
+    }
+  }
+
+#if defined(__linux__)
+  // Report the number of datagrams dropped by the kernel with the datagrams.
+  const int optval_one = 1;
+  if (setsockopt(new_socket.get(), SOL_SOCKET, SO_RXQ_OVFL,
+                 reinterpret_cast<const char*>(&optval_one),
+                 sizeof(optval_one)) < 0) {
+    LOG(WARNING) << "Failed to enable the SO_RXQ_OVFL option, the datagrams "
+                    "dropped will not be counted, error = "
+                 << GetSocketErrorCode();
+  }
+#endif  // defined(__linux__)
+
+  return new_socket.release();
+}
+
+}  // namespace
+
+bool UdpFile::OpenOutput(const UdpOptions& options) {
+  ScopedSocket new_socket(socket(AF_INET, SOCK_DGRAM, 0));
+  if (new_socket.get() == INVALID_SOCKET) {
+    LOG(ERROR) << "Could not allocate socket, error = " << GetSocketErrorCode();
+    return false;
+  }
+
+  struct in_addr destination_in_addr = {0};
+  if (inet_pton(AF_INET, options.address().c_str(), &destination_in_addr) !=
+      1) {
+    LOG(ERROR) << "Malformed IPv4 address " << options.address();
+    return false;
+  }
+
+  if (IsIpv4MulticastAddress(destination_in_addr) &&
+      options.interface_address() != "0.0.0.0") {
+    struct in_addr interface_in_addr = {0};
+    if (inet_pton(AF_INET, options.interface_address().c_str(),
+                  &interface_in_addr) != 1) {
+      LOG(ERROR) << "Malformed IPv4 interface address "
+                 << options.interface_address();
+      return false;
+    }
+    if (setsockopt(new_socket.get(), IPPROTO_IP, IP_MULTICAST_IF,
+                   reinterpret_cast<const char*>(&interface_in_addr),
+                   sizeof(interface_in_addr)) < 0) {
+      LOG(ERROR) << "Failed to set the multicast interface, error = "
+                 << GetSocketErrorCode();
+      return false;
+    }
+  }
+
+  if (options.buffer_size() > 0) {
+    const int send_buffer_size = options.buffer_size();
+    if (setsockopt(new_socket.get(), SOL_SOCKET, SO_SNDBUF,
+                   reinterpret_cast<const char*>(&send_buffer_size),
+                   sizeof(send_buffer_size)) < 0) {
+      LOG(ERROR) << "Failed to set the maximum send buffer size, error = "
+                 << GetSocketErrorCode();
       return false;
     }
   }
 
+  destination_address_ = destination_in_addr.s_addr;
+  destination_port_ = htons(options.port());
   socket_ = new_socket.release();
+  pacer_.reset(new TsDatagramPacer);
+  pace_ = options.pace();
+  if (pace_) {
+    sender_running_ = true;
+    base::WorkerPool::PostTask(
+        FROM_HERE, base::Bind(&UdpFile::SendTask, base::Unretained(this)),
+        true /* task_is_slow */);
+  }
+  return true;
+}
+
+bool UdpFile::Open() {
+#if defined(OS_WIN)
+  WSADATA wsa_data;
+  int wsa_error = WSAStartup(MAKEWORD(2, 2), &wsa_data);
+  if (wsa_error != 0) {
+    LOG(ERROR) << "Winsock start up failed with error " << wsa_error;
+    return false;
+  }
+  wsa_started_ = true;
+#endif  // defined(OS_WIN)
+
+  DCHECK_EQ(INVALID_SOCKET, socket_);
+
+  std::unique_ptr<UdpOptions> options =
+      UdpOptions::ParseFromString(file_name());
+  if (!options)
+    return false;
+
+  if (file_mode_ == "w")
+    return OpenOutput(*options);
+
+  socket_ = OpenSocket(*options, options->port());
+  if (socket_ == INVALID_SOCKET)
+    return false;
+
+  if (options->fec()) {
+    // The column and row FEC packets are sent to the ports two and four above
+    // the media port.
+    for (size_t i = 0; i < arraysize(fec_sockets_); ++i) {
+      fec_sockets_[i] = OpenSocket(*options, options->port() + 2 * (i + 1));
+      if (fec_sockets_[i] == INVALID_SOCKET)
+        return false;
+    }
+  }
+  if (options->rtp()) {
+    jitter_buffer_.reset(
+        new RtpJitterBuffer(options->jitter_buffer_packets()));
+    rtp_buffer_.resize(kMaxDatagramSize);
+  }
   return true;
 }
 
@@ -9,10 +9,16 @@
 
 #include <stdint.h>
 
+#include <deque>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/file/file.h"
+#include "packager/file/ts_datagram_pacer.h"
 
 #if defined(OS_WIN)
 #include <winsock2.h>
@@ -22,12 +28,19 @@ typedef int SOCKET;
 
 namespace shaka {
 
-/// Implements UdpFile, which receives UDP unicast and multicast streams.
+class RtpJitterBuffer;
+class UdpOptions;
+
+/// Implements UdpFile, which receives UDP unicast and multicast streams, and
+/// optionally RTP streams, see UdpOptions. In write mode, it sends an MPEG-2
+/// TS stream in datagrams of seven TS packets, optionally paced at the mux
+/// rate of the stream.
 class UdpFile : public File {
  public:
-  /// @param file_name C string containing the address of the stream to receive.
-  ///        It should be of the form "<ip_address>:<port>".
-  explicit UdpFile(const char* address_and_port);
+  /// @param address_and_port C string containing the address of the stream to
+  ///        receive or send. It should be of the form "<ip_address>:<port>".
+  /// @param mode C string containing the file access mode, "r" or "w".
+  UdpFile(const char* address_and_port, const char* mode);
 
   /// @name File implementation overrides.
   /// @{
@@ -46,7 +59,68 @@ class UdpFile : public File {
   bool Open() override;
 
  private:
+  // Receives the datagrams available in the socket, up to the size of the
+  // buffer, packed at the front of the buffer. Waits for the first datagram.
+  // @param datagram_sizes, if not null, gets the sizes of the datagrams.
+  int64_t ReceiveDatagrams(uint8_t* buffer,
+                           uint64_t length,
+                           std::vector<size_t>* datagram_sizes);
+  // Reads the payloads of the RTP packets released by |jitter_buffer_|.
+  int64_t ReadRtpPayloads(uint8_t* buffer, uint64_t length);
+  // Adds the FEC packets already received to |jitter_buffer_|.
+  void ReceiveFecPackets();
+  // Records the RTP packets lost and recovered in the metrics.
+  void ReportRtpMetrics();
+
+  // Opens the socket sending the stream.
+  bool OpenOutput(const UdpOptions& options);
+  // Sends the datagrams released by |pacer_|, or queues them for SendTask()
+  // if they are paced.
+  void SendOrQueueDatagrams();
+  // Sends the datagrams queued when they are due, until the file is closed.
+  void SendTask();
+  void SendDatagrams(const std::vector<TsDatagramPacer::Datagram>& datagrams);
+  void ReportSendError();
+
+#if defined(__linux__)
+  // Implements ReceiveDatagrams() with a single recvmmsg() call.
+  int64_t ReceiveDatagramsInBatch(uint8_t* buffer,
+                                  uint64_t length,
+                                  std::vector<size_t>* datagram_sizes);
+
+  // The size of the largest datagram received, used to size the slots of the
+  // batched receives.
+  size_t largest_datagram_size_ = 0;
+  // The number of datagrams dropped by the kernel which have been reported.
+  uint32_t dropped_datagrams_ = 0;
+#endif  // defined(__linux__)
+
   SOCKET socket_;
+  // The sockets receiving the column and row FEC packets, if any.
+  SOCKET fec_sockets_[2];
+  // Only used for RTP streams.
+  std::unique_ptr<RtpJitterBuffer> jitter_buffer_;
+  std::vector<uint8_t> rtp_buffer_;
+  std::vector<size_t> datagram_sizes_;
+  uint64_t reported_lost_packets_ = 0;
+  uint64_t reported_recovered_packets_ = 0;
+
+  // Only used in write mode.
+  const std::string file_mode_;
+  std::unique_ptr<TsDatagramPacer> pacer_;
+  // The destination, in network byte order.
+  uint32_t destination_address_ = 0;
+  uint16_t destination_port_ = 0;
+  bool pace_ = false;
+  uint64_t send_errors_ = 0;
+  // The paced datagrams waiting to be sent by SendTask().
+  base::Lock lock_;
+  base::ConditionVariable datagram_queued_;
+  base::ConditionVariable datagram_sent_;
+  std::deque<TsDatagramPacer::Datagram> send_queue_;
+  bool sending_ = false;
+  bool closing_ = false;
+  bool sender_running_ = false;
 #if defined(OS_WIN)
   // For Winsock in Windows.
   bool wsa_started_ = false;
@@ -23,9 +23,13 @@ namespace {
 enum FieldType {
   kUnknownField = 0,
   kBufferSizeField,
+  kFecField,
   kInterfaceAddressField,
+  kJitterBufferField,
   kMulticastSourceField,
+  kPaceField,
   kReuseField,
+  kRtpField,
   kTimeoutField,
 };
 
@@ -36,8 +40,12 @@ struct FieldNameToTypeMapping {
 
 const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
     {"buffer_size", kBufferSizeField},
+    {"fec", kFecField},
     {"interface", kInterfaceAddressField},
+    {"jitter_buffer", kJitterBufferField},
+    {"pace", kPaceField},
     {"reuse", kReuseField},
+    {"rtp", kRtpField},
     {"source", kMulticastSourceField},
     {"timeout", kTimeoutField},
 };
@@ -96,13 +104,40 @@ std::unique_ptr<UdpOptions> UdpOptions::ParseFromString(
             return nullptr;
           }
           break;
+        case kFecField: {
+          int fec_value = 0;
+          if (!base::StringToInt(pair.second, &fec_value)) {
+            LOG(ERROR) << "Invalid udp option for fec field " << pair.second;
+            return nullptr;
+          }
+          options->fec_ = fec_value > 0;
+          break;
+        }
         case kInterfaceAddressField:
           options->interface_address_ = pair.second;
           break;
+        case kJitterBufferField:
+          if (!base::StringToUint(pair.second,
+                                  &options->jitter_buffer_packets_) ||
+              options->jitter_buffer_packets_ == 0) {
+            LOG(ERROR) << "Invalid udp option for jitter_buffer field "
+                       << pair.second;
+            return nullptr;
+          }
+          break;
         case kMulticastSourceField:
           options->source_address_ = pair.second;
           options->is_source_specific_multicast_ = true;
           break;
+        case kPaceField: {
+          int pace_value = 0;
+          if (!base::StringToInt(pair.second, &pace_value)) {
+            LOG(ERROR) << "Invalid udp option for pace field " << pair.second;
+            return nullptr;
+          }
+          options->pace_ = pace_value > 0;
+          break;
+        }
         case kReuseField: {
           int reuse_value = 0;
           if (!base::StringToInt(pair.second, &reuse_value)) {
@@ -112,6 +147,15 @@ std::unique_ptr<UdpOptions> UdpOptions::ParseFromString(
           options->reuse_ = reuse_value > 0;
           break;
         }
+        case kRtpField: {
+          int rtp_value = 0;
+          if (!base::StringToInt(pair.second, &rtp_value)) {
+            LOG(ERROR) << "Invalid udp option for rtp field " << pair.second;
+            return nullptr;
+          }
+          options->rtp_ = rtp_value > 0;
+          break;
+        }
         case kTimeoutField:
           if (!base::StringToUint(pair.second, &options->timeout_us_)) {
             LOG(ERROR) << "Invalid udp option for timeout field "
@@ -127,6 +171,10 @@ std::unique_ptr<UdpOptions> UdpOptions::ParseFromString(
     }
   }
 
+  // FEC is only used with RTP.
+  if (options->fec_)
+    options->rtp_ = true;
+
   if (!FLAGS_udp_interface_address.empty()) {
     LOG(WARNING) << "--udp_interface_address is deprecated. Consider switching "
                     "to udp options instead, something like "
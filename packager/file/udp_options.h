@@ -31,6 +31,10 @@ class UdpOptions {
     return is_source_specific_multicast_;
   }
   int buffer_size() const { return buffer_size_; }
+  bool rtp() const { return rtp_; }
+  bool fec() const { return fec_; }
+  unsigned jitter_buffer_packets() const { return jitter_buffer_packets_; }
+  bool pace() const { return pace_; }
 
  private:
   UdpOptions() = default;
@@ -52,6 +56,18 @@ class UdpOptions {
   // by the underlying operating system ('sysctl net.core.rmem_max' on Linux
   // returns the maximum receive memory size).
   int buffer_size_ = 0;
+  // Receive RTP packets, e.g. MPEG-2 TS over RTP as specified in SMPTE 2022-2,
+  // instead of raw UDP payloads.
+  bool rtp_ = false;
+  // Receive the SMPTE 2022-1 FEC packets on the ports two and four above the
+  // media port, to recover the RTP packets lost. Implies |rtp_|.
+  bool fec_ = false;
+  // Maximum number of RTP packets buffered to wait for a packet reordered or
+  // lost.
+  unsigned jitter_buffer_packets_ = 256;
+  // Send the TS packets of a UDP output at the mux rate of the stream, given
+  // by its PCRs, instead of as soon as they are written.
+  bool pace_ = false;
 };
 
 }  // namespace shaka
@@ -122,4 +122,38 @@ TEST_F(UdpOptionsTest, BufferSize) {
   EXPECT_EQ(1234, options->buffer_size());
 }
 
+TEST_F(UdpOptionsTest, Rtp) {
+  auto options = UdpOptions::ParseFromString("224.1.2.30:88");
+  EXPECT_FALSE(options->rtp());
+  EXPECT_FALSE(options->fec());
+  EXPECT_EQ(256u, options->jitter_buffer_packets());
+
+  options = UdpOptions::ParseFromString("224.1.2.30:88?rtp=1&jitter_buffer=64");
+  EXPECT_TRUE(options->rtp());
+  EXPECT_FALSE(options->fec());
+  EXPECT_EQ(64u, options->jitter_buffer_packets());
+}
+
+TEST_F(UdpOptionsTest, FecImpliesRtp) {
+  auto options = UdpOptions::ParseFromString("224.1.2.30:88?fec=1");
+  EXPECT_TRUE(options->rtp());
+  EXPECT_TRUE(options->fec());
+}
+
+TEST_F(UdpOptionsTest, InvalidJitterBuffer) {
+  ASSERT_FALSE(
+      UdpOptions::ParseFromString("224.1.2.30:88?rtp=1&jitter_buffer=0"));
+  ASSERT_FALSE(
+      UdpOptions::ParseFromString("224.1.2.30:88?rtp=1&jitter_buffer=a"));
+}
+
+TEST_F(UdpOptionsTest, Pace) {
+  auto options = UdpOptions::ParseFromString("224.1.2.30:88");
+  EXPECT_FALSE(options->pace());
+
+  options = UdpOptions::ParseFromString("224.1.2.30:88?pace=1");
+  EXPECT_TRUE(options->pace());
+  ASSERT_FALSE(UdpOptions::ParseFromString("224.1.2.30:88?pace=a"));
+}
+
 }  // namespace shaka
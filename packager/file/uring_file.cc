@@ -0,0 +1,473 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/uring_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "packager/base/logging.h"
+#include "packager/file/local_file.h"
+
+// Older C libraries do not define the io_uring syscall numbers. They are only
+// the same on the architectures using the common syscall table; Alpha and MIPS,
+// for instance, have their own, so io_uring is left unsupported there.
+#if (defined(__x86_64__) && !defined(__ILP32__)) || defined(__i386__) || \
+    defined(__aarch64__) || defined(__arm__) || defined(__riscv) ||      \
+    defined(__powerpc__) || defined(__s390__)
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#endif
+
+namespace shaka {
+namespace {
+
+const size_t kBlockSize = 256 * 1024;
+// This is also the maximum number of operations in flight.
+const size_t kNumBlocks = 16;
+const uint64_t kSyncUserData = ~0ULL;
+
+int IoUringSetup(uint32_t num_entries, struct io_uring_params* params) {
+#if defined(__NR_io_uring_setup)
+  return static_cast<int>(syscall(__NR_io_uring_setup, num_entries, params));
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+int IoUringEnter(int fd,
+                 uint32_t to_submit,
+                 uint32_t min_complete,
+                 uint32_t flags) {
+#if defined(__NR_io_uring_enter)
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+}  // namespace
+
+/// A minimal io_uring wrapper, which only supports the operations UringFile
+/// needs. Submission and completion happen on the same thread.
+class UringFile::Ring {
+ public:
+  Ring() {}
+
+  ~Ring() {
+    if (sqes_ != MAP_FAILED)
+      munmap(sqes_, sqes_size_);
+    if (cq_ring_ != MAP_FAILED)
+      munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_ != MAP_FAILED)
+      munmap(sq_ring_, sq_ring_size_);
+    if (fd_ >= 0)
+      close(fd_);
+  }
+
+  bool Initialize(uint32_t num_entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd_ = IoUringSetup(num_entries, &params);
+    if (fd_ < 0) {
+      VLOG(1) << "io_uring_setup failed with errno " << errno;
+      return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED ||
+        sqes_ == MAP_FAILED) {
+      PLOG(ERROR) << "Failed to map io_uring.";
+      return false;
+    }
+
+    uint8_t* sq_ring = static_cast<uint8_t*>(sq_ring_);
+    sq_head_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = *sq_tail_;
+
+    uint8_t* cq_ring = static_cast<uint8_t*>(cq_ring_);
+    cq_head_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+    iovecs_.resize(num_entries);
+    return true;
+  }
+
+  /// Queue a write of @a data to @a fd at @a offset. @a index identifies the
+  /// operation in the completion and must be less than the number of entries.
+  bool QueueWrite(int fd,
+                  const void* data,
+                  size_t size,
+                  uint64_t offset,
+                  size_t index) {
+    // Use writev, which is supported since the first io_uring kernel. The
+    // iovec must stay valid until the operation completes.
+    DCHECK_LT(index, iovecs_.size());
+    iovecs_[index].iov_base = const_cast<void*>(data);
+    iovecs_[index].iov_len = size;
+    struct io_uring_sqe* sqe = GetSqe();
+    if (!sqe)
+      return false;
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(&iovecs_[index]);
+    sqe->len = 1;
+    sqe->user_data = index;
+    return true;
+  }
+
+  /// Queue a fdatasync of @a fd, which starts after all the operations
+  /// already queued complete.
+  bool QueueSync(int fd, uint64_t user_data) {
+    struct io_uring_sqe* sqe = GetSqe();
+    if (!sqe)
+      return false;
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->flags = IOSQE_IO_DRAIN;
+    sqe->fd = fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sqe->user_data = user_data;
+    return true;
+  }
+
+  /// Submit the queued operations and wait for at least @a min_complete
+  /// operations to complete.
+  bool Submit(uint32_t min_complete) {
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    while (to_submit_ > 0 || min_complete > 0) {
+      const int result =
+          IoUringEnter(fd_, to_submit_, min_complete,
+                       min_complete > 0 ? IORING_ENTER_GETEVENTS : 0);
+      if (result < 0) {
+        if (errno == EINTR)
+          continue;
+        PLOG(ERROR) << "io_uring_enter failed.";
+        return false;
+      }
+      to_submit_ -= std::min<uint32_t>(to_submit_, result);
+      min_complete = 0;
+    }
+    return true;
+  }
+
+  /// Pop the next completion, if any.
+  /// @return false if there is no completion available.
+  bool PopCompletion(uint64_t* user_data, int32_t* result) {
+    const uint32_t head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+      return false;
+    const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    *user_data = cqe.user_data;
+    *result = cqe.res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+ private:
+  Ring(const Ring&) = delete;
+  Ring& operator=(const Ring&) = delete;
+
+  struct io_uring_sqe* GetSqe() {
+    const uint32_t head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) {
+      LOG(ERROR) << "io_uring submission queue is full.";
+      return nullptr;
+    }
+    const uint32_t index = sqe_tail_ & sq_mask_;
+    struct io_uring_sqe* sqe = &static_cast<struct io_uring_sqe*>(sqes_)[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sqe_tail_;
+    ++to_submit_;
+    return sqe;
+  }
+
+  int fd_ = -1;
+  void* sq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = MAP_FAILED;
+  size_t cq_ring_size_ = 0;
+  void* sqes_ = MAP_FAILED;
+  size_t sqes_size_ = 0;
+
+  uint32_t* sq_head_ = nullptr;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t* sq_array_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  uint32_t sq_entries_ = 0;
+  // Local copy of the submission queue tail, published in Submit().
+  uint32_t sqe_tail_ = 0;
+  uint32_t to_submit_ = 0;
+
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  uint32_t cq_mask_ = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+
+  std::vector<struct iovec> iovecs_;
+};
+
+UringFile::UringFile(const char* file_name, const char* mode, bool sync_on_close)
+    : File(file_name), file_mode_(mode), sync_on_close_(sync_on_close) {}
+
+bool UringFile::IsSupported() {
+  // Probe with the size the files use, so a low RLIMIT_MEMLOCK on kernels
+  // before 5.12, which charge the rings to it, disables io_uring up front.
+  static const bool kIsSupported = []() {
+    Ring ring;
+    return ring.Initialize(kNumBlocks);
+  }();
+  return kIsSupported;
+}
+
+bool UringFile::InitializeRing() {
+  if (ring_)
+    return true;
+  std::unique_ptr<Ring> ring(new Ring);
+  if (!ring->Initialize(kNumBlocks))
+    return false;
+  ring_ = std::move(ring);
+  return true;
+}
+
+bool UringFile::Close() {
+  bool result = true;
+  if (fd_ >= 0) {
+    result = Flush();
+    if (result && sync_on_close_) {
+      result = ring_->QueueSync(fd_, kSyncUserData) && ring_->Submit(0);
+      if (result) {
+        ++num_in_flight_;
+        result = WaitForAllCompletions();
+      }
+    }
+    if (close(fd_) != 0)
+      result = false;
+    fd_ = -1;
+  }
+  if (!result)
+    LOG(ERROR) << "Failed to close " << file_name() << ", errno " << error_;
+  delete this;
+  return result;
+}
+
+int64_t UringFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "UringFile does not support reading.";
+  return -1;
+}
+
+int64_t UringFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(buffer != NULL);
+  DCHECK_GE(fd_, 0);
+  if (error_ != 0)
+    return -1;
+
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_left = length;
+  while (bytes_left > 0) {
+    Block& block = blocks_[current_block_];
+    const size_t space = kBlockSize - block.data.size();
+    if (space == 0) {
+      if (!SubmitCurrentBlock())
+        return -1;
+      continue;
+    }
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(space, bytes_left));
+    block.data.insert(block.data.end(), data, data + size);
+    data += size;
+    bytes_left -= size;
+  }
+  return length;
+}
+
+int64_t UringFile::Size() {
+  if (!Flush())
+    return -1;
+  struct stat info;
+  if (fstat(fd_, &info) != 0) {
+    PLOG(ERROR) << "Cannot get file size of " << file_name();
+    return -1;
+  }
+  return info.st_size;
+}
+
+bool UringFile::Flush() {
+  DCHECK_GE(fd_, 0);
+  return SubmitCurrentBlock() && WaitForAllCompletions();
+}
+
+bool UringFile::Seek(uint64_t position) {
+  // Wait for the pending writes, so writes to overlapping ranges are not
+  // reordered.
+  if (!Flush())
+    return false;
+  position_ = position;
+  return true;
+}
+
+bool UringFile::Tell(uint64_t* position) {
+  *position = position_ + blocks_[current_block_].data.size();
+  return true;
+}
+
+UringFile::~UringFile() {
+  // The file is not closed if Open() failed half way.
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+bool UringFile::Open() {
+  if (!IsSupported())
+    return false;
+
+  int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+  if (file_mode_ == "w") {
+    flags |= O_TRUNC;
+    if (!LocalFile::CreateParentDirectories(file_name().c_str()))
+      return false;
+  } else if (file_mode_ != "a") {
+    LOG(ERROR) << "UringFile does not support mode " << file_mode_;
+    return false;
+  }
+
+  fd_ = open(file_name().c_str(), flags, 0666);
+  if (fd_ < 0) {
+    PLOG(ERROR) << "Failed to open " << file_name();
+    return false;
+  }
+  if (file_mode_ == "a") {
+    struct stat info;
+    if (fstat(fd_, &info) != 0)
+      return false;
+    position_ = info.st_size;
+  }
+
+  if (!InitializeRing())
+    return false;
+  blocks_.resize(kNumBlocks);
+  for (Block& block : blocks_)
+    block.data.reserve(kBlockSize);
+  return true;
+}
+
+bool UringFile::SubmitCurrentBlock() {
+  if (error_ != 0)
+    return false;
+  Block& block = blocks_[current_block_];
+  if (block.data.empty())
+    return true;
+  block.file_offset = position_;
+  block.bytes_written = 0;
+  position_ += block.data.size();
+  if (!SubmitBlock(current_block_))
+    return false;
+
+  current_block_ = (current_block_ + 1) % blocks_.size();
+  while (blocks_[current_block_].in_flight) {
+    if (!WaitForCompletions())
+      return false;
+  }
+  return error_ == 0;
+}
+
+bool UringFile::SubmitBlock(size_t index) {
+  Block& block = blocks_[index];
+  DCHECK_LT(block.bytes_written, block.data.size());
+  if (!ring_->QueueWrite(fd_, block.data.data() + block.bytes_written,
+                         block.data.size() - block.bytes_written,
+                         block.file_offset + block.bytes_written, index) ||
+      !ring_->Submit(0)) {
+    error_ = EIO;
+    return false;
+  }
+  block.in_flight = true;
+  ++num_in_flight_;
+  return true;
+}
+
+bool UringFile::WaitForCompletions() {
+  DCHECK_GT(num_in_flight_, 0u);
+  if (!ring_->Submit(1)) {
+    error_ = EIO;
+    return false;
+  }
+
+  uint64_t user_data = 0;
+  int32_t result = 0;
+  while (ring_->PopCompletion(&user_data, &result)) {
+    --num_in_flight_;
+    if (user_data == kSyncUserData) {
+      if (result < 0 && error_ == 0)
+        error_ = -result;
+      continue;
+    }
+
+    Block& block = blocks_[user_data];
+    block.in_flight = false;
+    if (result == -EINTR || result == -EAGAIN) {
+      if (!SubmitBlock(user_data))
+        return false;
+      continue;
+    }
+    if (result <= 0) {
+      if (error_ == 0)
+        error_ = result < 0 ? -result : EIO;
+      block.data.clear();
+      continue;
+    }
+    block.bytes_written += result;
+    // Submit the rest of the block on short writes.
+    if (block.bytes_written < block.data.size()) {
+      if (!SubmitBlock(user_data))
+        return false;
+      continue;
+    }
+    block.data.clear();
+  }
+  return true;
+}
+
+bool UringFile::WaitForAllCompletions() {
+  while (num_in_flight_ > 0) {
+    if (!WaitForCompletions())
+      return false;
+  }
+  return error_ == 0;
+}
+
+}  // namespace shaka
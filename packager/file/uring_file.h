@@ -0,0 +1,97 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_URING_FILE_H_
+#define PACKAGER_FILE_URING_FILE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/compiler_specific.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Implement UringFile which writes local files through io_uring (Linux 5.1+).
+/// Written data is collected in blocks, which are submitted to the kernel
+/// without waiting for them to complete, so the calling thread does not block
+/// in write syscalls. Only write ("w") and append ("a") modes are supported;
+/// use UringFile::IsSupported() to check if the running kernel supports it.
+class UringFile : public File {
+ public:
+  /// @param file_name C string containing the name of the file to be accessed.
+  /// @param mode C string containing a file access mode, "w" or "a".
+  /// @param sync_on_close indicates whether the file data is synced to storage
+  ///        when the file is closed.
+  UringFile(const char* file_name, const char* mode, bool sync_on_close);
+
+  /// @return true if io_uring is available, false otherwise. The result is
+  ///         computed once.
+  static bool IsSupported();
+
+  /// Set up the io_uring instance of the file, which Open() does otherwise.
+  /// The rings are charged to RLIMIT_MEMLOCK on kernels before 5.12, so this
+  /// can fail even if IsSupported() is true once many files are open.
+  /// @return true on success, false otherwise.
+  bool InitializeRing();
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~UringFile() override;
+
+  bool Open() override;
+
+ private:
+  class Ring;
+
+  struct Block {
+    std::vector<uint8_t> data;
+    // Number of bytes written to the file so far.
+    uint64_t bytes_written = 0;
+    uint64_t file_offset = 0;
+    bool in_flight = false;
+  };
+
+  // Submit the current block, if it is not empty, and pick the next one.
+  bool SubmitCurrentBlock();
+  // Submit the unwritten part of |blocks_[index]|.
+  bool SubmitBlock(size_t index);
+  // Wait until one or more submitted operations complete and process them.
+  bool WaitForCompletions();
+  // Wait until all the submitted operations complete.
+  bool WaitForAllCompletions();
+
+  std::string file_mode_;
+  const bool sync_on_close_;
+  int fd_ = -1;
+  std::unique_ptr<Ring> ring_;
+  std::vector<Block> blocks_;
+  size_t current_block_ = 0;
+  size_t num_in_flight_ = 0;
+  // File offset of the current block.
+  uint64_t position_ = 0;
+  // The first error (errno) returned by a completed operation.
+  int error_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(UringFile);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_URING_FILE_H_
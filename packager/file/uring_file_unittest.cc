@@ -0,0 +1,90 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/uring_file.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "packager/base/files/file_util.h"
+#include "packager/base/logging.h"
+#include "packager/file/file.h"
+
+DECLARE_bool(io_uring);
+DECLARE_bool(io_uring_sync);
+
+namespace shaka {
+namespace {
+// Larger than all the blocks of UringFile together.
+const size_t kDataSize = 5 * 1024 * 1024 + 7;
+}  // namespace
+
+class UringFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    data_.resize(kDataSize);
+    for (size_t i = 0; i < kDataSize; ++i)
+      data_[i] = static_cast<char>(i % 251);
+
+    ASSERT_TRUE(base::CreateTemporaryFile(&test_file_path_));
+    file_name_ = test_file_path_.AsUTF8Unsafe();
+  }
+
+  void TearDown() override { base::DeleteFile(test_file_path_, false); }
+
+  std::string data_;
+  base::FilePath test_file_path_;
+  std::string file_name_;
+};
+
+TEST_F(UringFileTest, WriteSeekAndAppend) {
+  if (!UringFile::IsSupported()) {
+    LOG(WARNING) << "io_uring is not supported. Skipping the test.";
+    return;
+  }
+  google::FlagSaver flag_saver;
+  FLAGS_io_uring = true;
+  FLAGS_io_uring_sync = true;
+
+  File* file = File::Open(file_name_.c_str(), "w");
+  ASSERT_TRUE(file != nullptr);
+  // Write in odd sized chunks.
+  const size_t kChunkSize = 100001;
+  for (size_t pos = 0; pos < kDataSize; pos += kChunkSize) {
+    const size_t size = std::min(kChunkSize, kDataSize - pos);
+    ASSERT_EQ(static_cast<int64_t>(size), file->Write(&data_[pos], size));
+  }
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(kDataSize, position);
+  EXPECT_EQ(static_cast<int64_t>(kDataSize), file->Size());
+
+  // Overwrite the beginning of the file.
+  const std::string kHeader = "header";
+  ASSERT_TRUE(file->Seek(0));
+  ASSERT_EQ(static_cast<int64_t>(kHeader.size()),
+            file->Write(kHeader.data(), kHeader.size()));
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(kHeader.size(), position);
+  ASSERT_TRUE(file->Close());
+
+  const std::string kTrailer = "trailer";
+  file = File::Open(file_name_.c_str(), "a");
+  ASSERT_TRUE(file != nullptr);
+  ASSERT_EQ(static_cast<int64_t>(kTrailer.size()),
+            file->Write(kTrailer.data(), kTrailer.size()));
+  ASSERT_TRUE(file->Close());
+
+  std::string expected_contents = data_ + kTrailer;
+  expected_contents.replace(0, kHeader.size(), kHeader);
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(file_name_.c_str(), &contents));
+  EXPECT_TRUE(expected_contents == contents);
+}
+
+}  // namespace shaka
@@ -7,6 +7,7 @@
 #ifndef PACKAGER_HLS_BASE_HLS_NOTIFIER_H_
 #define PACKAGER_HLS_BASE_HLS_NOTIFIER_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -14,6 +15,9 @@
 #include "packager/mpd/base/media_info.pb.h"
 
 namespace shaka {
+
+class ManifestCheckpoint;
+
 namespace hls {
 
 // TODO(rkuroiwa): Consider merging this with MpdNotifier.
@@ -65,6 +69,23 @@ class HlsNotifier {
                                 uint64_t start_byte_offset,
                                 uint64_t size) = 0;
 
+  /// Called on every chunk written before its segment is complete, with low
+  /// latency chunked output.
+  /// @param stream_id is the value set by NotifyNewStream().
+  /// @param segment_name is the name of the segment containing the chunk.
+  /// @param start_time is the start time of the chunk in timescale units
+  ///        passed in @a media_info.
+  /// @param duration is also in terms of timescale.
+  /// @param start_byte_offset is the offset of the chunk in the segment.
+  /// @param size is the size in bytes.
+  /// @return true on success, false otherwise.
+  virtual bool NotifyNewChunk(uint32_t stream_id,
+                              const std::string& segment_name,
+                              uint64_t start_time,
+                              uint64_t duration,
+                              uint64_t start_byte_offset,
+                              uint64_t size) = 0;
+
   /// Called on every key frame. For Video only.
   /// @param stream_id is the value set by NotifyNewStream().
   /// @param timestamp is the timesamp of the key frame in timescale units
@@ -100,6 +121,24 @@ class HlsNotifier {
   /// @return true on success, false otherwise.
   virtual bool Flush() = 0;
 
+  /// Run @a callback once the playlists are written with the updates notified
+  /// so far, e.g. to measure when a new segment is advertised. Call it after
+  /// the update. Notifiers which do not track their writes drop the callback,
+  /// which is the default.
+  virtual void RunAfterFlush(std::function<void()> callback) {}
+
+  /// Saves the state of the live Media Playlists, so that a restarted
+  /// packager can resume them with ResumeFromCheckpoint(). Does nothing by
+  /// default.
+  /// @param[out] checkpoint gets the state of the Media Playlists.
+  virtual void SaveCheckpoint(ManifestCheckpoint* checkpoint) {}
+
+  /// Resumes the live Media Playlists from the state saved by
+  /// SaveCheckpoint() in a previous run. Must be called before any stream is
+  /// added. The entries of a new stream are restored if its playlist name
+  /// matches one of @a checkpoint. Does nothing by default.
+  virtual void ResumeFromCheckpoint(const ManifestCheckpoint& checkpoint) {}
+
   /// @return The HLS parameters.
   const HlsParams& hls_params() const { return hls_params_; }
 
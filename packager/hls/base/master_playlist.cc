@@ -15,6 +15,7 @@
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
+#include "packager/file/precompressed_file_writer.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/hls/base/tag.h"
 #include "packager/version/version.h"
@@ -505,6 +506,7 @@ bool MasterPlaylist::WriteMasterPlaylist(
     LOG(ERROR) << "Failed to write master playlist to: " << file_path;
     return false;
   }
+  PrecompressedFileWriter::GetInstance()->Write(file_path, content);
   written_playlist_ = content;
   return true;
 }
@@ -180,6 +180,30 @@ TEST_F(MasterPlaylistTest, WriteMasterPlaylistOneVideo) {
   ASSERT_EQ(expected, actual);
 }
 
+TEST_F(MasterPlaylistTest, WriteMasterPlaylistOnlyWhenChanged) {
+  const uint64_t kMaxBitrate = 435889;
+  const uint64_t kAvgBitrate = 235889;
+  const char kBaseUrl[] = "http://myplaylistdomain.com/";
+
+  std::unique_ptr<MockMediaPlaylist> mock_playlist =
+      CreateVideoPlaylist("media1.m3u8", "avc1", kMaxBitrate, kAvgBitrate);
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(kBaseUrl, test_output_dir_,
+                                                   {mock_playlist.get()}));
+  ASSERT_TRUE(File::Delete(master_playlist_path_.c_str()));
+
+  // The playlist is not written again if it has not changed.
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(kBaseUrl, test_output_dir_,
+                                                   {mock_playlist.get()}));
+  std::string actual;
+  EXPECT_FALSE(File::ReadFileToString(master_playlist_path_.c_str(), &actual));
+
+  std::unique_ptr<MockMediaPlaylist> updated_playlist =
+      CreateVideoPlaylist("media1.m3u8", "avc1", kMaxBitrate, kAvgBitrate + 1);
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(
+      kBaseUrl, test_output_dir_, {updated_playlist.get()}));
+  EXPECT_TRUE(File::ReadFileToString(master_playlist_path_.c_str(), &actual));
+}
+
 TEST_F(MasterPlaylistTest, 
        WriteMasterPlaylistOneVideoWithIndependentSegments) {
   const uint64_t kMaxBitrate = 435889;
@@ -10,12 +10,16 @@
 
 #include <algorithm>
 #include <cmath>
+#include <iterator>
 #include <memory>
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
+#include "packager/file/file_deleter.h"
+#include "packager/file/precompressed_file_writer.h"
 #include "packager/hls/base/tag.h"
 #include "packager/media/base/language_utils.h"
 #include "packager/media/base/muxer_util.h"
@@ -101,13 +105,28 @@ void AppendExtXMap(const MediaInfo& media_info, std::string* out) {
   }
 }
 
+// The delta update of the playlist written to |file_path|, which the server
+// delivers for the playlist requests with _HLS_skip=YES.
+std::string GetDeltaUpdateFilePath(const std::string& file_path) {
+  const char kExtension[] = ".m3u8";
+  if (base::EndsWith(file_path, kExtension, base::CompareCase::SENSITIVE)) {
+    return file_path.substr(0, file_path.size() - strlen(kExtension)) +
+           "_delta" + kExtension;
+  }
+  return file_path + "_delta";
+}
+
 std::string CreatePlaylistHeader(
     const MediaInfo& media_info,
     uint32_t target_duration,
     HlsPlaylistType type,
     MediaPlaylist::MediaPlaylistStreamType stream_type,
     uint32_t media_sequence_number,
-    int discontinuity_sequence_number) {
+    int discontinuity_sequence_number,
+    double part_target_duration,
+    bool can_block_reload,
+    double can_skip_until,
+    bool delta_update) {
   const std::string version = GetPackagerVersion();
   std::string version_line;
   if (!version.empty()) {
@@ -116,13 +135,30 @@ std::string CreatePlaylistHeader(
                            GetPackagerProjectUrl().c_str(), version.c_str());
   }
 
-  // 6 is required for EXT-X-MAP without EXT-X-I-FRAMES-ONLY.
+  // 6 is required for EXT-X-MAP without EXT-X-I-FRAMES-ONLY, 9 for EXT-X-SKIP.
   std::string header = base::StringPrintf(
       "#EXTM3U\n"
-      "#EXT-X-VERSION:6\n"
+      "#EXT-X-VERSION:%d\n"
       "%s"
       "#EXT-X-TARGETDURATION:%d\n",
-      version_line.c_str(), target_duration);
+      delta_update ? 9 : 6, version_line.c_str(), target_duration);
+
+  // Low latency playlists, with the parts of the segments being written.
+  // Players stay at least three part durations from the live edge.
+  if (part_target_duration > 0 || can_skip_until > 0) {
+    Tag tag("#EXT-X-SERVER-CONTROL", &header);
+    if (part_target_duration > 0 && can_block_reload)
+      tag.AddString("CAN-BLOCK-RELOAD", "YES");
+    if (can_skip_until > 0)
+      tag.AddFloat("CAN-SKIP-UNTIL", can_skip_until);
+    if (part_target_duration > 0)
+      tag.AddFloat("PART-HOLD-BACK", 3 * part_target_duration);
+    header += "\n";
+  }
+  if (part_target_duration > 0) {
+    base::StringAppendF(&header, "#EXT-X-PART-INF:PART-TARGET=%.3f\n",
+                        part_target_duration);
+  }
 
   switch (type) {
     case HlsPlaylistType::kVod:
@@ -173,11 +209,17 @@ class SegmentInfoEntry : public HlsEntry {
                    uint64_t previous_segment_end_offset);
 
   std::string ToString() override;
+  const std::string& file_name() const { return file_name_; }
   int64_t start_time() const { return start_time_; }
   double duration_seconds() const { return duration_seconds_; }
   void set_duration_seconds(double duration_seconds) {
     duration_seconds_ = duration_seconds;
   }
+  uint64_t start_byte_offset() const { return start_byte_offset_; }
+  uint64_t segment_file_size() const { return segment_file_size_; }
+  uint64_t previous_segment_end_offset() const {
+    return previous_segment_end_offset_;
+  }
 
  private:
   SegmentInfoEntry(const SegmentInfoEntry&) = delete;
@@ -234,6 +276,14 @@ class EncryptionInfoEntry : public HlsEntry {
                       const std::string& key_format_versions);
 
   std::string ToString() override;
+  MediaPlaylist::EncryptionMethod method() const { return method_; }
+  const std::string& url() const { return url_; }
+  const std::string& key_id() const { return key_id_; }
+  const std::string& iv() const { return iv_; }
+  const std::string& key_format() const { return key_format_; }
+  const std::string& key_format_versions() const {
+    return key_format_versions_;
+  }
 
  private:
   EncryptionInfoEntry(const EncryptionInfoEntry&) = delete;
@@ -245,6 +295,8 @@ class EncryptionInfoEntry : public HlsEntry {
   const std::string iv_;
   const std::string key_format_;
   const std::string key_format_versions_;
+  // The tag, rendered once since the entry does not change.
+  std::string tag_string_;
 };
 
 EncryptionInfoEntry::EncryptionInfoEntry(MediaPlaylist::EncryptionMethod method,
@@ -262,8 +314,9 @@ EncryptionInfoEntry::EncryptionInfoEntry(MediaPlaylist::EncryptionMethod method,
       key_format_versions_(key_format_versions) {}
 
 std::string EncryptionInfoEntry::ToString() {
-  std::string tag_string;
-  Tag tag("#EXT-X-KEY", &tag_string);
+  if (!tag_string_.empty())
+    return tag_string_;
+  Tag tag("#EXT-X-KEY", &tag_string_);
 
   if (method_ == MediaPlaylist::EncryptionMethod::kSampleAes) {
     tag.AddString("METHOD", "SAMPLE-AES");
@@ -291,7 +344,7 @@ std::string EncryptionInfoEntry::ToString() {
     tag.AddQuotedString("KEYFORMAT", key_format_);
   }
 
-  return tag_string;
+  return tag_string_;
 }
 
 class DiscontinuityEntry : public HlsEntry {
@@ -410,6 +463,19 @@ void MediaPlaylist::AddSegment(const std::string& file_name,
                                int64_t duration,
                                uint64_t start_byte_offset,
                                uint64_t size) {
+  // Number the segments like the muxer, see media::SegmentIndexer.
+  if (!media_sequence_number_set_ &&
+      hls_params_.segment_numbers_from_timestamps) {
+    DCHECK_GT(time_scale_, 0u);
+    // The muxer fails on the segment first.
+    LOG_IF(ERROR, !media::GetTimelineSegmentIndex(
+                      start_time, time_scale_,
+                      hls_params_.target_segment_duration,
+                      &media_sequence_number_))
+        << "The media sequence number does not fit in 32 bits.";
+  }
+  media_sequence_number_set_ = true;
+
   if (stream_type_ == MediaPlaylistStreamType::kVideoIFramesOnly) {
     if (key_frames_.empty())
       return;
@@ -433,6 +499,24 @@ void MediaPlaylist::AddSegment(const std::string& file_name,
                              size);
 }
 
+void MediaPlaylist::AddPart(const std::string& file_name,
+                            int64_t start_time,
+                            int64_t duration,
+                            uint64_t start_byte_offset,
+                            uint64_t size) {
+  if (hls_params_.playlist_type == HlsPlaylistType::kVod ||
+      stream_type_ == MediaPlaylistStreamType::kVideoIFramesOnly ||
+      time_scale_ == 0) {
+    return;
+  }
+  const double part_duration_seconds =
+      static_cast<double>(duration) / time_scale_;
+  longest_part_duration_seconds_ =
+      std::max(longest_part_duration_seconds_, part_duration_seconds);
+  parts_.push_back(
+      {file_name, part_duration_seconds, start_byte_offset, size});
+}
+
 void MediaPlaylist::AddKeyFrame(int64_t timestamp,
                                 uint64_t start_byte_offset,
                                 uint64_t size) {
@@ -469,26 +553,187 @@ void MediaPlaylist::AddPlacementOpportunity() {
   entries_.emplace_back(new PlacementOpportunityEntry());
 }
 
+void MediaPlaylist::SaveCheckpoint(MediaPlaylistCheckpoint* checkpoint) const {
+  checkpoint->set_media_sequence_number(media_sequence_number_);
+  checkpoint->set_discontinuity_sequence_number(
+      discontinuity_sequence_number_);
+  uint32_t num_segments = 0;
+  for (const auto& entry : entries_) {
+    MediaPlaylistCheckpoint::Entry* saved_entry = checkpoint->add_entries();
+    switch (entry->type()) {
+      case HlsEntry::EntryType::kExtInf: {
+        const SegmentInfoEntry* segment_info =
+            static_cast<const SegmentInfoEntry*>(entry.get());
+        saved_entry->set_type(MediaPlaylistCheckpoint::Entry::SEGMENT);
+        saved_entry->set_file_name(segment_info->file_name());
+        saved_entry->set_start_time(segment_info->start_time());
+        saved_entry->set_duration_seconds(segment_info->duration_seconds());
+        saved_entry->set_start_byte_offset(segment_info->start_byte_offset());
+        saved_entry->set_segment_file_size(segment_info->segment_file_size());
+        saved_entry->set_previous_segment_end_offset(
+            segment_info->previous_segment_end_offset());
+        ++num_segments;
+        break;
+      }
+      case HlsEntry::EntryType::kExtKey: {
+        const EncryptionInfoEntry* encryption_info =
+            static_cast<const EncryptionInfoEntry*>(entry.get());
+        saved_entry->set_type(MediaPlaylistCheckpoint::Entry::ENCRYPTION);
+        saved_entry->set_method(static_cast<int>(encryption_info->method()));
+        saved_entry->set_url(encryption_info->url());
+        saved_entry->set_key_id(encryption_info->key_id());
+        saved_entry->set_iv(encryption_info->iv());
+        saved_entry->set_key_format(encryption_info->key_format());
+        saved_entry->set_key_format_versions(
+            encryption_info->key_format_versions());
+        break;
+      }
+      case HlsEntry::EntryType::kExtDiscontinuity:
+        saved_entry->set_type(MediaPlaylistCheckpoint::Entry::DISCONTINUITY);
+        break;
+      case HlsEntry::EntryType::kExtPlacementOpportunity:
+        saved_entry->set_type(
+            MediaPlaylistCheckpoint::Entry::PLACEMENT_OPPORTUNITY);
+        break;
+    }
+  }
+  // The segments of I-Frames only playlists are the segments of the main
+  // playlist, which already numbers them.
+  if (stream_type_ != MediaPlaylistStreamType::kVideoIFramesOnly) {
+    checkpoint->set_next_segment_index(
+        media_sequence_number_ - hls_params_.media_sequence_number +
+        num_segments);
+  }
+}
+
+void MediaPlaylist::RestoreCheckpoint(
+    const MediaPlaylistCheckpoint& checkpoint) {
+  entries_.clear();
+  serialized_entries_.clear();
+  serialized_entries_size_ = 0;
+  current_buffer_depth_ = 0;
+  media_sequence_number_ = checkpoint.media_sequence_number();
+  media_sequence_number_set_ = true;
+  discontinuity_sequence_number_ = checkpoint.discontinuity_sequence_number();
+  for (const MediaPlaylistCheckpoint::Entry& entry : checkpoint.entries()) {
+    switch (entry.type()) {
+      case MediaPlaylistCheckpoint::Entry::SEGMENT:
+        entries_.emplace_back(new SegmentInfoEntry(
+            entry.file_name(), entry.start_time(), entry.duration_seconds(),
+            use_byte_range_, entry.start_byte_offset(),
+            entry.segment_file_size(), entry.previous_segment_end_offset()));
+        longest_segment_duration_seconds_ = std::max(
+            longest_segment_duration_seconds_, entry.duration_seconds());
+        bandwidth_estimator_.AddBlock(entry.segment_file_size(),
+                                      entry.duration_seconds());
+        current_buffer_depth_ += entry.duration_seconds();
+        previous_segment_end_offset_ =
+            entry.start_byte_offset() + entry.segment_file_size() - 1;
+        break;
+      case MediaPlaylistCheckpoint::Entry::ENCRYPTION:
+        entries_.emplace_back(new EncryptionInfoEntry(
+            static_cast<EncryptionMethod>(entry.method()), entry.url(),
+            entry.key_id(), entry.iv(), entry.key_format(),
+            entry.key_format_versions()));
+        // The discontinuity before the first EXT-X-KEY, if any, is restored
+        // with the other entries.
+        inserted_discontinuity_tag_ = true;
+        break;
+      case MediaPlaylistCheckpoint::Entry::DISCONTINUITY:
+        entries_.emplace_back(new DiscontinuityEntry());
+        break;
+      case MediaPlaylistCheckpoint::Entry::PLACEMENT_OPPORTUNITY:
+        entries_.emplace_back(new PlacementOpportunityEntry());
+        break;
+    }
+  }
+  UpdateHistoryMemoryUsage();
+}
+
 bool MediaPlaylist::WriteToFile(const std::string& file_path) {
   if (!target_duration_set_) {
     SetTargetDuration(ceil(GetLongestSegmentDuration()));
   }
 
+  // The part target duration should not change, so the configured chunk
+  // duration is used unless a part is longer.
+  const double part_target_duration =
+      longest_part_duration_seconds_ > 0
+          ? std::max(media_info_.chunk_duration_seconds(),
+                     longest_part_duration_seconds_)
+          : 0.0;
+  // Delta updates are for the playlists which are reloaded, and skip at most
+  // the segments older than six target durations, as required.
+  const double can_skip_until =
+      hls_params_.playlist_type != HlsPlaylistType::kVod &&
+              hls_params_.can_skip_until > 0
+          ? std::max(hls_params_.can_skip_until, 6.0 * target_duration_)
+          : 0.0;
   std::string content = CreatePlaylistHeader(
       media_info_, target_duration_, hls_params_.playlist_type, stream_type_,
-      media_sequence_number_, discontinuity_sequence_number_);
-
-  for (const auto& entry : entries_)
-    base::StringAppendF(&content, "%s\n", entry->ToString().c_str());
+      media_sequence_number_, discontinuity_sequence_number_,
+      part_target_duration, hls_params_.can_block_reload, can_skip_until,
+      false /* delta_update */);
+
+  // Only the entries added since the previous write are serialized.
+  auto iter = SerializeFinalEntries();
+  UpdateHistoryMemoryUsage();
+
+  // The entries which can still change, and the parts, end both playlists.
+  std::string final_entries;
+  // |iter| is the last SegmentInfoEntry, if any, which is preceded by its
+  // parts.
+  if (iter != entries_.end())
+    AppendParts(last_segment_parts_, &final_entries);
+  for (; iter != entries_.end(); ++iter)
+    base::StringAppendF(&final_entries, "%s\n", (*iter)->ToString().c_str());
+  AppendParts(parts_, &final_entries);
+  // Hint the next part of the segment being written, which the players can
+  // request before it is written.
+  if (!parts_.empty()) {
+    const PartInfo& last_part = parts_.back();
+    Tag tag("#EXT-X-PRELOAD-HINT", &final_entries);
+    tag.AddString("TYPE", "PART");
+    tag.AddQuotedString("URI", last_part.segment_file_name);
+    tag.AddNumber("BYTERANGE-START",
+                  last_part.start_byte_offset + last_part.size);
+    final_entries += "\n";
+  }
 
   if (hls_params_.playlist_type == HlsPlaylistType::kVod) {
-    content += "#EXT-X-ENDLIST\n";
+    final_entries += "#EXT-X-ENDLIST\n";
   }
 
+  content.reserve(content.size() + serialized_entries_size_ +
+                  final_entries.size());
+  for (const std::string& serialized_entry : serialized_entries_)
+    content += serialized_entry;
+  content += final_entries;
+
   if (!File::WriteFileAtomically(file_path.c_str(), content)) {
     LOG(ERROR) << "Failed to write playlist to: " << file_path;
     return false;
   }
+  PrecompressedFileWriter::GetInstance()->Write(file_path, content);
+  if (can_skip_until > 0) {
+    std::string delta_update = CreatePlaylistHeader(
+        media_info_, target_duration_, hls_params_.playlist_type, stream_type_,
+        media_sequence_number_, discontinuity_sequence_number_,
+        part_target_duration, hls_params_.can_block_reload, can_skip_until,
+        true /* delta_update */);
+    AppendDeltaUpdateEntries(can_skip_until, &delta_update);
+    delta_update += final_entries;
+    const std::string delta_update_file_path =
+        GetDeltaUpdateFilePath(file_path);
+    if (!File::WriteFileAtomically(delta_update_file_path.c_str(),
+                                   delta_update)) {
+      LOG(ERROR) << "Failed to write playlist delta update to: "
+                 << delta_update_file_path;
+      return false;
+    }
+    PrecompressedFileWriter::GetInstance()->Write(delta_update_file_path,
+                                                  delta_update);
+  }
   return true;
 }
 
@@ -624,6 +869,9 @@ void MediaPlaylist::AddSegmentInfoEntry(const std::string& segment_file_name,
       segment_file_name, start_time, segment_duration_seconds, use_byte_range_,
       start_byte_offset, size, previous_segment_end_offset_));
   previous_segment_end_offset_ = start_byte_offset + size - 1;
+  last_segment_parts_.swap(parts_);
+  parts_.clear();
+  UpdateHistoryMemoryUsage();
 }
 
 void MediaPlaylist::AdjustLastSegmentInfoEntryDuration(int64_t next_timestamp) {
@@ -642,8 +890,13 @@ void MediaPlaylist::AdjustLastSegmentInfoEntryDuration(int64_t next_timestamp) {
           next_timestamp_seconds -
           static_cast<double>(segment_info->start_time()) / time_scale_;
       // It could be negative if timestamp messed up.
-      if (segment_duration_seconds > 0)
+      if (segment_duration_seconds > 0) {
+        // Keep the depth of the sliding window in sync with the adjusted
+        // duration, e.g. when the key frame spans segments without key frames.
+        current_buffer_depth_ +=
+            segment_duration_seconds - segment_info->duration_seconds();
         segment_info->set_duration_seconds(segment_duration_seconds);
+      }
       longest_segment_duration_seconds_ =
           std::max(longest_segment_duration_seconds_, segment_duration_seconds);
       break;
@@ -677,17 +930,26 @@ void MediaPlaylist::SlideWindow() {
   //    #EXTINF      <3>
   //    #EXTINF      <4>
   std::list<std::unique_ptr<HlsEntry>> ext_x_keys;
+  // The serialized |ext_x_keys|, for the ones already serialized.
+  std::deque<std::string> serialized_ext_x_keys;
   // Consecutive key entries are either fully removed or not removed at all.
   // Keep track of entry types so we know if it is consecutive key entries.
   HlsEntry::EntryType prev_entry_type = HlsEntry::EntryType::kExtInf;
 
+  size_t num_removed_entries = 0;
   std::list<std::unique_ptr<HlsEntry>>::iterator last = entries_.begin();
-  for (; last != entries_.end(); ++last) {
+  for (; last != entries_.end(); ++last, ++num_removed_entries) {
     HlsEntry::EntryType entry_type = last->get()->type();
     if (entry_type == HlsEntry::EntryType::kExtKey) {
-      if (prev_entry_type != HlsEntry::EntryType::kExtKey)
+      if (prev_entry_type != HlsEntry::EntryType::kExtKey) {
         ext_x_keys.clear();
+        serialized_ext_x_keys.clear();
+      }
       ext_x_keys.push_back(std::move(*last));
+      if (num_removed_entries < serialized_entries_.size()) {
+        serialized_ext_x_keys.push_back(
+            serialized_entries_[num_removed_entries]);
+      }
     } else if (entry_type == HlsEntry::EntryType::kExtDiscontinuity) {
       ++discontinuity_sequence_number_;
     } else {
@@ -708,10 +970,128 @@ void MediaPlaylist::SlideWindow() {
     }
     prev_entry_type = entry_type;
   }
+  // The serialized entries are the first ones, so whatever is serialized of
+  // the removed entries is at the front of |serialized_entries_|.
+  const bool last_serialized_entry_removed =
+      num_removed_entries >= serialized_entries_.size();
+  const size_t num_removed_serialized_entries =
+      std::min(num_removed_entries, serialized_entries_.size());
+  for (size_t i = 0; i < num_removed_serialized_entries; ++i) {
+    serialized_entries_size_ -= serialized_entries_.front().size();
+    serialized_entries_.pop_front();
+  }
   entries_.erase(entries_.begin(), last);
-  // Add key entries back.
-  entries_.insert(entries_.begin(), std::make_move_iterator(ext_x_keys.begin()),
-                  std::make_move_iterator(ext_x_keys.end()));
+
+  // Add key entries back, with their serialization.
+  auto first_ext_x_key = entries_.insert(
+      entries_.begin(), std::make_move_iterator(ext_x_keys.begin()),
+      std::make_move_iterator(ext_x_keys.end()));
+  for (auto iter = serialized_ext_x_keys.rbegin();
+       iter != serialized_ext_x_keys.rend(); ++iter) {
+    serialized_entries_size_ += iter->size();
+    serialized_entries_.push_front(std::move(*iter));
+  }
+  if (last_serialized_entry_removed && !serialized_ext_x_keys.empty()) {
+    last_serialized_entry_ =
+        std::next(first_ext_x_key, serialized_ext_x_keys.size() - 1);
+  }
+}
+
+std::list<std::unique_ptr<HlsEntry>>::iterator
+MediaPlaylist::SerializeFinalEntries() {
+  // Only the last SegmentInfoEntry can still change. It is usually at or near
+  // the back, so the search is short.
+  auto final_end = entries_.end();
+  for (auto iter = entries_.rbegin(); iter != entries_.rend(); ++iter) {
+    if ((*iter)->type() == HlsEntry::EntryType::kExtInf) {
+      final_end = std::prev(iter.base());
+      break;
+    }
+  }
+
+  auto iter = serialized_entries_.empty() ? entries_.begin()
+                                          : std::next(last_serialized_entry_);
+  for (; iter != final_end; ++iter) {
+    serialized_entries_.push_back((*iter)->ToString() + "\n");
+    serialized_entries_size_ += serialized_entries_.back().size();
+    last_serialized_entry_ = iter;
+  }
+  return iter;
+}
+
+void MediaPlaylist::AppendDeltaUpdateEntries(double can_skip_until,
+                                             std::string* out) const {
+  // The skipped segments are the ones followed by at least |can_skip_until|
+  // seconds of segments. The last SegmentInfoEntry, which is not serialized,
+  // is never skipped.
+  double remaining_duration = 0;
+  for (const auto& entry : entries_) {
+    if (entry->type() == HlsEntry::EntryType::kExtInf) {
+      remaining_duration +=
+          static_cast<const SegmentInfoEntry*>(entry.get())->duration_seconds();
+    }
+  }
+
+  size_t num_skipped_segments = 0;
+  // The entries before |first_entry| are replaced by EXT-X-SKIP.
+  size_t first_entry = 0;
+  // The last consecutive EXT-X-KEYs skipped, which also apply to the segments
+  // after the skipped ones.
+  size_t first_skipped_key = 0;
+  size_t num_skipped_keys = 0;
+  size_t index = 0;
+  for (auto iter = entries_.begin();
+       iter != entries_.end() && index < serialized_entries_.size();
+       ++iter, ++index) {
+    const HlsEntry::EntryType entry_type = (*iter)->type();
+    if (entry_type == HlsEntry::EntryType::kExtKey) {
+      if (first_skipped_key + num_skipped_keys != index) {
+        first_skipped_key = index;
+        num_skipped_keys = 0;
+      }
+      ++num_skipped_keys;
+    } else if (entry_type == HlsEntry::EntryType::kExtInf) {
+      const double duration_seconds =
+          static_cast<const SegmentInfoEntry*>(iter->get())
+              ->duration_seconds();
+      if (remaining_duration - duration_seconds < can_skip_until)
+        break;
+      remaining_duration -= duration_seconds;
+      ++num_skipped_segments;
+      first_entry = index + 1;
+    }
+  }
+
+  if (num_skipped_segments > 0) {
+    base::StringAppendF(out, "#EXT-X-SKIP:SKIPPED-SEGMENTS=%zu\n",
+                        num_skipped_segments);
+    // Keys after the last skipped segment are written with the other entries.
+    if (first_skipped_key < first_entry) {
+      for (size_t i = first_skipped_key;
+           i < first_skipped_key + num_skipped_keys; ++i) {
+        *out += serialized_entries_[i];
+      }
+    }
+  }
+  for (size_t i = first_entry; i < serialized_entries_.size(); ++i)
+    *out += serialized_entries_[i];
+}
+
+// static
+void MediaPlaylist::AppendParts(const std::vector<PartInfo>& parts,
+                                std::string* out) {
+  for (size_t i = 0; i < parts.size(); ++i) {
+    const PartInfo& part = parts[i];
+    Tag tag("#EXT-X-PART", out);
+    tag.AddFloat("DURATION", part.duration_seconds);
+    tag.AddQuotedString("URI", part.segment_file_name);
+    // Segments start with a key frame.
+    if (i == 0)
+      tag.AddString("INDEPENDENT", "YES");
+    tag.AddQuotedNumberPair("BYTERANGE", part.size, '@',
+                            part.start_byte_offset);
+    out->append("\n");
+  }
 }
 
 void MediaPlaylist::RemoveOldSegment(int64_t start_time) {
@@ -725,15 +1105,20 @@ void MediaPlaylist::RemoveOldSegment(int64_t start_time) {
                             media_sequence_number_, media_info_.bandwidth()));
   while (segments_to_be_removed_.size() >
          hls_params_.preserved_segments_outside_live_window) {
-    VLOG(2) << "Deleting " << segments_to_be_removed_.front();
-    if (!File::Delete(segments_to_be_removed_.front().c_str())) {
-      LOG(WARNING) << "Failed to delete " << segments_to_be_removed_.front()
-                   << "; Will retry later.";
-      break;
-    }
+    FileDeleter::GetInstance()->Delete(segments_to_be_removed_.front());
     segments_to_be_removed_.pop_front();
   }
 }
 
+void MediaPlaylist::UpdateHistoryMemoryUsage() {
+  // SegmentInfoEntry is the largest and by far the most common entry.
+  uint64_t bytes = entries_.size() * sizeof(SegmentInfoEntry) +
+                   serialized_entries_size_ +
+                   key_frames_.capacity() * sizeof(KeyFrameInfo);
+  for (const std::string& segment_name : segments_to_be_removed_)
+    bytes += sizeof(segment_name) + segment_name.capacity();
+  history_memory_usage_.Set(bytes);
+}
+
 }  // namespace hls
 }  // namespace shaka
@@ -7,6 +7,7 @@
 #ifndef PACKAGER_HLS_BASE_MEDIA_PLAYLIST_H_
 #define PACKAGER_HLS_BASE_MEDIA_PLAYLIST_H_
 
+#include <deque>
 #include <list>
 #include <memory>
 #include <string>
@@ -14,7 +15,9 @@
 
 #include "packager/base/macros.h"
 #include "packager/hls/public/hls_params.h"
+#include "packager/metrics/memory_usage.h"
 #include "packager/mpd/base/bandwidth_estimator.h"
+#include "packager/mpd/base/manifest_checkpoint.pb.h"
 #include "packager/mpd/base/media_info.pb.h"
 
 namespace shaka {
@@ -118,6 +121,22 @@ class MediaPlaylist {
                           uint64_t start_byte_offset,
                           uint64_t size);
 
+  /// Add a part (EXT-X-PART) of the segment being written, for low latency
+  /// live playlists. Parts must be added in order, before the containing
+  /// segment. Only the parts of the segment being written and of the last
+  /// segment are listed, followed by an EXT-X-PRELOAD-HINT for the next part
+  /// of the segment being written.
+  /// @param file_name is the file name of the segment containing the part.
+  /// @param start_time is in terms of the timescale of the media.
+  /// @param duration is in terms of the timescale of the media.
+  /// @param start_byte_offset is the offset of the part in the segment.
+  /// @param size is size in bytes.
+  virtual void AddPart(const std::string& file_name,
+                       int64_t start_time,
+                       int64_t duration,
+                       uint64_t start_byte_offset,
+                       uint64_t size);
+
   /// Keyframes must be added in order. It is also called before the containing
   /// segment being called.
   /// @param timestamp is the timestamp of the key frame in timescale of the
@@ -150,8 +169,21 @@ class MediaPlaylist {
   /// https://support.google.com/dfp_premium/answer/7295798?hl=en.
   virtual void AddPlacementOpportunity();
 
+  /// Save the entries of this playlist, to resume it after a restart.
+  /// @param[out] checkpoint is filled with the entries and the sequence
+  ///             numbers of this playlist.
+  virtual void SaveCheckpoint(MediaPlaylistCheckpoint* checkpoint) const;
+
+  /// Replace the entries of this playlist with the ones of @a checkpoint. It
+  /// must be called after SetMediaInfo() and before adding any segment.
+  /// @param checkpoint is a checkpoint saved by SaveCheckpoint().
+  virtual void RestoreCheckpoint(const MediaPlaylistCheckpoint& checkpoint);
+
   /// Write the playlist to |file_path|.
   /// This does not close the file.
+  /// With HlsParams::can_skip_until, the delta update of a live or event
+  /// playlist is also written, from the same serialized entries, to
+  /// |file_path| with a "_delta" suffix before the ".m3u8" extension.
   /// If target duration is not set explicitly, this will try to find the target
   /// duration. Note that target duration cannot be changed. So calling this
   /// without explicitly setting the target duration and before adding any
@@ -231,6 +263,14 @@ class MediaPlaylist {
   }
 
  private:
+  // A part (EXT-X-PART) of a segment.
+  struct PartInfo {
+    std::string segment_file_name;
+    double duration_seconds;
+    uint64_t start_byte_offset;
+    uint64_t size;
+  };
+
   // Add a SegmentInfoEntry (#EXTINF).
   void AddSegmentInfoEntry(const std::string& segment_file_name,
                            int64_t start_time,
@@ -243,10 +283,24 @@ class MediaPlaylist {
   // Remove elements from |entries_| for live profile. Increments
   // |sequence_number_| by the number of segments removed.
   void SlideWindow();
+  // Append the entries before the last SegmentInfoEntry that are not yet in
+  // |serialized_entries_| to it.
+  // Returns the first entry that is not serialized.
+  std::list<std::unique_ptr<HlsEntry>>::iterator SerializeFinalEntries();
+  // Append the serialized entries of the delta update of the playlist to
+  // |out|: EXT-X-SKIP in place of the segments followed by at least
+  // |can_skip_until| seconds of segments, the EXT-X-KEYs which still apply
+  // and the entries after the skipped segments.
+  void AppendDeltaUpdateEntries(double can_skip_until, std::string* out) const;
+  // Append the EXT-X-PART tags of |parts| to |out|.
+  static void AppendParts(const std::vector<PartInfo>& parts,
+                          std::string* out);
   // Remove the segment specified by |start_time|. The actual deletion can
   // happen at a later time depending on the value of
   // |preserved_segment_outside_live_window| in |hls_params_|.
   void RemoveOldSegment(int64_t start_time);
+  // Update |history_memory_usage_| after the entries change.
+  void UpdateHistoryMemoryUsage();
 
   const HlsParams& hls_params_;
   // Mainly for MasterPlaylist to use these values.
@@ -261,6 +315,10 @@ class MediaPlaylist {
   std::string language_;
   std::vector<std::string> characteristics_;
   uint32_t media_sequence_number_ = 0;
+  // Set once the first segment is added or a checkpoint is restored, as
+  // |media_sequence_number_| is derived from the first segment with
+  // HlsParams::segment_numbers_from_timestamps.
+  bool media_sequence_number_set_ = false;
   bool inserted_discontinuity_tag_ = false;
   int discontinuity_sequence_number_ = 0;
 
@@ -280,19 +338,39 @@ class MediaPlaylist {
   // TODO(kqyang): This could be managed better by a separate class, than having
   // all them managed in MediaPlaylist.
   std::list<std::unique_ptr<HlsEntry>> entries_;
+  // The serialized entries of |entries_| up to |last_serialized_entry_|, one
+  // per entry, so that a write only serializes the entries added since the
+  // previous write, and entries removed from the front by SlideWindow() are
+  // dropped without serializing the others again. The last SegmentInfoEntry
+  // is never cached since its duration can still be adjusted.
+  std::deque<std::string> serialized_entries_;
+  // The total size of |serialized_entries_|.
+  size_t serialized_entries_size_ = 0;
+  std::list<std::unique_ptr<HlsEntry>>::iterator last_serialized_entry_;
   double current_buffer_depth_ = 0;
   // A list to hold the file names of the segments to be removed temporarily.
   // Once a file is actually removed, it is removed from the list.
   std::list<std::string> segments_to_be_removed_;
-
-  // Used by kVideoIFrameOnly playlists to track the i-frames (key frames).
+  // Accounts for the memory used by |entries_|, |serialized_entries_|,
+  // |segments_to_be_removed_| and |key_frames_|.
+  MemoryUsage history_memory_usage_{"hls_segment_history"};
+
+  // The parts of the segment being written and of the last segment, listed
+  // before their EXTINF.
+  std::vector<PartInfo> parts_;
+  std::vector<PartInfo> last_segment_parts_;
+  double longest_part_duration_seconds_ = 0.0;
+
+  // Used by kVideoIFrameOnly playlists to track the i-frames (key frames) of
+  // the segment being written. They are added as entries, which slide out of
+  // the live window like the segments, when the segment is added. The
+  // capacity is reused from segment to segment.
   struct KeyFrameInfo {
     int64_t timestamp;
     uint64_t start_byte_offset;
     uint64_t size;
-    std::string segment_file_name;
   };
-  std::list<KeyFrameInfo> key_frames_;
+  std::vector<KeyFrameInfo> key_frames_;
 
   DISALLOW_COPY_AND_ASSIGN(MediaPlaylist);
 };
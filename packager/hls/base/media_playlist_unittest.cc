@@ -10,8 +10,10 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/file/file_deleter.h"
 #include "packager/file/file_test_util.h"
 #include "packager/hls/base/media_playlist.h"
+#include "packager/metrics/memory_usage.h"
 #include "packager/version/version.h"
 
 namespace shaka {
@@ -712,6 +714,264 @@ TEST_F(LiveMediaPlaylistTest, TimeShifted) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+// The key frame spanning a segment without key frames slides out of the window
+// with its adjusted duration.
+TEST_F(LiveMediaPlaylistTest, IFramesTimeShifted) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  media_playlist_->AddKeyFrame(0, 1000, 2345);
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  media_playlist_->AddSegment("file2.ts", 10 * kTimeScale, 10 * kTimeScale,
+                              kZeroByteOffset, kMBytes);
+  for (int i = 2; i < 5; ++i) {
+    media_playlist_->AddKeyFrame(i * 10 * kTimeScale, 1000, 2345);
+    media_playlist_->AddSegment(base::StringPrintf("file%d.ts", i + 1),
+                                i * 10 * kTimeScale, 10 * kTimeScale,
+                                kZeroByteOffset, kMBytes);
+  }
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:20\n"
+      "#EXT-X-MEDIA-SEQUENCE:1\n"
+      "#EXT-X-I-FRAMES-ONLY\n"
+      "#EXTINF:10.000,\n"
+      "#EXT-X-BYTERANGE:2345@1000\n"
+      "file3.ts\n"
+      "#EXTINF:10.000,\n"
+      "#EXT-X-BYTERANGE:2345@1000\n"
+      "file4.ts\n"
+      "#EXTINF:10.000,\n"
+      "#EXT-X-BYTERANGE:2345@1000\n"
+      "file5.ts\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
+TEST_F(LiveMediaPlaylistTest, SegmentNumbersFromTimestamps) {
+  mutable_hls_params()->segment_numbers_from_timestamps = true;
+  mutable_hls_params()->target_segment_duration = 10;
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  // The first segment is the 101st of the timeline.
+  media_playlist_->AddSegment("file100.ts", 1000 * kTimeScale, 10 * kTimeScale,
+                              kZeroByteOffset, kMBytes);
+  media_playlist_->AddSegment("file101.ts", 1010 * kTimeScale, 10 * kTimeScale,
+                              kZeroByteOffset, kMBytes);
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:10\n"
+      "#EXT-X-MEDIA-SEQUENCE:100\n"
+      "#EXTINF:10.000,\n"
+      "file100.ts\n"
+      "#EXTINF:10.000,\n"
+      "file101.ts\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
+TEST_F(LiveMediaPlaylistTest, TimeShiftedMemoryUsageBounded) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  const char kSubsystem[] = "hls_segment_history";
+
+  uint64_t steady_state_bytes = 0;
+  for (int i = 0; i < 100; ++i) {
+    media_playlist_->AddSegment(base::StringPrintf("file%03d.ts", i),
+                                i * 5 * kTimeScale, 5 * kTimeScale,
+                                kZeroByteOffset, kMBytes);
+    EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+    // The window is full after kTimeShiftBufferDepth seconds.
+    if (i == 10)
+      steady_state_bytes = MemoryUsage::GetSubsystemBytes(kSubsystem);
+    else if (i > 10)
+      EXPECT_EQ(steady_state_bytes, MemoryUsage::GetSubsystemBytes(kSubsystem));
+  }
+  EXPECT_GT(steady_state_bytes, 0u);
+}
+
+TEST_F(LiveMediaPlaylistTest, TimeShiftedWrittenIncrementally) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  media_playlist_->AddSegment("file2.ts", 10 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  const char kExpectedOutput1[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:20\n"
+      "#EXTINF:10.000,\n"
+      "file1.ts\n"
+      "#EXTINF:20.000,\n"
+      "file2.ts\n";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput1);
+
+  media_playlist_->AddSegment("file3.ts", 30 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  const char kExpectedOutput2[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:20\n"
+      "#EXT-X-MEDIA-SEQUENCE:1\n"
+      "#EXTINF:20.000,\n"
+      "file2.ts\n"
+      "#EXTINF:20.000,\n"
+      "file3.ts\n";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput2);
+}
+
+TEST_F(LiveMediaPlaylistTest, Parts) {
+  valid_video_media_info_.set_chunk_duration_seconds(1);
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+
+  media_playlist_->AddPart("file1.ts", 0, kTimeScale, kZeroByteOffset, kMBytes);
+  media_playlist_->AddPart("file1.ts", kTimeScale, kTimeScale, kMBytes,
+                           kMBytes);
+  media_playlist_->AddSegment("file1.ts", 0, 2 * kTimeScale, kZeroByteOffset,
+                              2 * kMBytes);
+  media_playlist_->AddPart("file2.ts", 2 * kTimeScale, kTimeScale,
+                           kZeroByteOffset, kMBytes);
+  const char kExpectedOutput1[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=3.000\n"
+      "#EXT-X-PART-INF:PART-TARGET=1.000\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file1.ts\",INDEPENDENT=YES,"
+      "BYTERANGE=\"1000000@0\"\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file1.ts\","
+      "BYTERANGE=\"1000000@1000000\"\n"
+      "#EXTINF:2.000,\n"
+      "file1.ts\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file2.ts\",INDEPENDENT=YES,"
+      "BYTERANGE=\"1000000@0\"\n"
+      "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"file2.ts\","
+      "BYTERANGE-START=1000000\n";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput1);
+
+  // Only the parts of the last segment are kept.
+  media_playlist_->AddPart("file2.ts", 3 * kTimeScale, kTimeScale, kMBytes,
+                           kMBytes);
+  media_playlist_->AddSegment("file2.ts", 2 * kTimeScale, 2 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  const char kExpectedOutput2[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=3.000\n"
+      "#EXT-X-PART-INF:PART-TARGET=1.000\n"
+      "#EXTINF:2.000,\n"
+      "file1.ts\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file2.ts\",INDEPENDENT=YES,"
+      "BYTERANGE=\"1000000@0\"\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file2.ts\","
+      "BYTERANGE=\"1000000@1000000\"\n"
+      "#EXTINF:2.000,\n"
+      "file2.ts\n";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput2);
+}
+
+TEST_F(LiveMediaPlaylistTest, PartsWithBlockingReload) {
+  mutable_hls_params()->can_block_reload = true;
+  valid_video_media_info_.set_chunk_duration_seconds(1);
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  media_playlist_->SetTargetDuration(2);
+
+  media_playlist_->AddPart("file1.ts", 0, kTimeScale, kZeroByteOffset, kMBytes);
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=3.000\n"
+      "#EXT-X-PART-INF:PART-TARGET=1.000\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file1.ts\",INDEPENDENT=YES,"
+      "BYTERANGE=\"1000000@0\"\n"
+      "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"file1.ts\","
+      "BYTERANGE-START=1000000\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
+TEST_F(LiveMediaPlaylistTest, DeltaUpdate) {
+  // At least six target durations are kept.
+  mutable_hls_params()->can_skip_until = 1;
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  media_playlist_->SetTargetDuration(2);
+
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://example.com", "",
+      "0x12345678", "com.widevine", "");
+  const int kNumSegments = 9;
+  for (int i = 0; i < kNumSegments; ++i) {
+    media_playlist_->AddSegment(base::StringPrintf("file%d.ts", i + 1),
+                                2 * i * kTimeScale, 2 * kTimeScale,
+                                kZeroByteOffset, kMBytes);
+  }
+  const char kKey[] =
+      "#EXT-X-KEY:METHOD=SAMPLE-AES,"
+      "URI=\"http://example.com\",IV=0x12345678,KEYFORMAT=\"com.widevine\"\n";
+  std::string segments[kNumSegments];
+  for (int i = 0; i < kNumSegments; ++i)
+    segments[i] = base::StringPrintf("#EXTINF:2.000,\nfile%d.ts\n", i + 1);
+
+  std::string expected_output =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=12.000\n";
+  expected_output += kKey;
+  for (int i = 0; i < kNumSegments; ++i)
+    expected_output += segments[i];
+
+  // The first three segments are followed by at least 12 seconds of segments.
+  std::string expected_delta_update =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:9\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=12.000\n"
+      "#EXT-X-SKIP:SKIPPED-SEGMENTS=3\n";
+  expected_delta_update += kKey;
+  for (int i = 3; i < kNumSegments; ++i)
+    expected_delta_update += segments[i];
+
+  EXPECT_TRUE(media_playlist_->WriteToFile("memory://media.m3u8"));
+  ASSERT_FILE_STREQ("memory://media.m3u8", expected_output);
+  ASSERT_FILE_STREQ("memory://media_delta.m3u8", expected_delta_update);
+}
+
 TEST_F(LiveMediaPlaylistTest, TimeShiftedWithEncryptionInfo) {
   ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
 
@@ -819,6 +1079,123 @@ TEST_F(LiveMediaPlaylistTest, TimeShiftedWithEncryptionInfoShifted) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+// Same as above, but with the playlist written after each segment, so that
+// the entries removed by the sliding window are already serialized.
+TEST_F(LiveMediaPlaylistTest,
+       TimeShiftedWithEncryptionInfoShiftedWrittenIncrementally) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  // The target duration is otherwise set by the first write.
+  media_playlist_->SetTargetDuration(20);
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://example.com", "",
+      "0x12345678", "com.widevine", "1/2/4");
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://mydomain.com",
+      "0xfedc", "0x12345678", "com.widevine.someother", "1");
+
+  media_playlist_->AddSegment("file2.ts", 10 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://example.com", "",
+      "0x22345678", "com.widevine", "1/2/4");
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://mydomain.com",
+      "0xfedd", "0x22345678", "com.widevine.someother", "1");
+
+  media_playlist_->AddSegment("file3.ts", 30 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://example.com", "",
+      "0x32345678", "com.widevine", "1/2/4");
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://mydomain.com",
+      "0xfede", "0x32345678", "com.widevine.someother", "1");
+
+  media_playlist_->AddSegment("file4.ts", 50 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:20\n"
+      "#EXT-X-MEDIA-SEQUENCE:2\n"
+      "#EXT-X-DISCONTINUITY-SEQUENCE:1\n"
+      "#EXT-X-KEY:METHOD=SAMPLE-AES,"
+      "URI=\"http://example.com\",IV=0x22345678,KEYFORMATVERSIONS=\"1/2/4\","
+      "KEYFORMAT=\"com.widevine\"\n"
+      "#EXT-X-KEY:METHOD=SAMPLE-AES,"
+      "URI=\"http://mydomain.com\",KEYID=0xfedd,IV=0x22345678,"
+      "KEYFORMATVERSIONS=\"1\","
+      "KEYFORMAT=\"com.widevine.someother\"\n"
+      "#EXTINF:20.000,\n"
+      "file3.ts\n"
+      "#EXT-X-KEY:METHOD=SAMPLE-AES,"
+      "URI=\"http://example.com\",IV=0x32345678,KEYFORMATVERSIONS=\"1/2/4\","
+      "KEYFORMAT=\"com.widevine\"\n"
+      "#EXT-X-KEY:METHOD=SAMPLE-AES,"
+      "URI=\"http://mydomain.com\",KEYID=0xfede,IV=0x32345678,"
+      "KEYFORMATVERSIONS=\"1\","
+      "KEYFORMAT=\"com.widevine.someother\"\n"
+      "#EXTINF:20.000,\n"
+      "file4.ts\n";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
+// A playlist restored from a checkpoint continues like the original one.
+TEST_F(LiveMediaPlaylistTest, RestoreCheckpoint) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://example.com", "",
+      "0x12345678", "com.widevine", "1/2/4");
+  media_playlist_->AddSegment("file2.ts", 10 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  media_playlist_->AddSegment("file3.ts", 30 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+
+  MediaPlaylistCheckpoint checkpoint;
+  media_playlist_->SaveCheckpoint(&checkpoint);
+  EXPECT_EQ(3u, checkpoint.next_segment_index());
+
+  MediaPlaylist restored_playlist(hls_params_, default_file_name_,
+                                  default_name_, default_group_id_);
+  ASSERT_TRUE(restored_playlist.SetMediaInfo(valid_video_media_info_));
+  restored_playlist.RestoreCheckpoint(checkpoint);
+
+  for (MediaPlaylist* playlist : {media_playlist_.get(), &restored_playlist}) {
+    playlist->AddEncryptionInfo(MediaPlaylist::EncryptionMethod::kSampleAes,
+                                "http://example.com", "", "0x22345678",
+                                "com.widevine", "1/2/4");
+    playlist->AddSegment("file4.ts", 50 * kTimeScale, 20 * kTimeScale,
+                         kZeroByteOffset, 2 * kMBytes);
+  }
+  EXPECT_EQ(media_playlist_->GetLongestSegmentDuration(),
+            restored_playlist.GetLongestSegmentDuration());
+  EXPECT_EQ(media_playlist_->MaxBitrate(), restored_playlist.MaxBitrate());
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  const char kRestoredMemoryFilePath[] = "memory://restored_media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  EXPECT_TRUE(restored_playlist.WriteToFile(kRestoredMemoryFilePath));
+  std::string expected_output;
+  ASSERT_TRUE(File::ReadFileToString(kMemoryFilePath, &expected_output));
+  ASSERT_FILE_STREQ(kRestoredMemoryFilePath, expected_output);
+}
+
 class EventMediaPlaylistTest : public MediaPlaylistMultiSegmentTest {
  protected:
   EventMediaPlaylistTest()
@@ -946,6 +1323,65 @@ TEST_F(IFrameMediaPlaylistTest, MultiSegment) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+// The duration of the last entry is adjusted after it is written.
+TEST_F(IFrameMediaPlaylistTest, MultiSegmentWrittenIncrementally) {
+  valid_video_media_info_.set_reference_time_scale(90000);
+  valid_video_media_info_.set_segment_template_url("file$Number$.ts");
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  media_playlist_->SetTargetDuration(25);
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+
+  media_playlist_->AddKeyFrame(0, 1000, 2345);
+  media_playlist_->AddKeyFrame(2 * kTimeScale, 5000, 6345);
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  const char kExpectedOutput1[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:25\n"
+      "#EXT-X-PLAYLIST-TYPE:VOD\n"
+      "#EXT-X-I-FRAMES-ONLY\n"
+      "#EXTINF:2.000,\n"
+      "#EXT-X-BYTERANGE:2345@1000\n"
+      "file1.ts\n"
+      "#EXTINF:8.000,\n"
+      "#EXT-X-BYTERANGE:6345@5000\n"
+      "file1.ts\n"
+      "#EXT-X-ENDLIST\n";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput1);
+
+  media_playlist_->AddKeyFrame(11 * kTimeScale, 1000, 2345);
+  media_playlist_->AddKeyFrame(15 * kTimeScale, 3345, 12345);
+  media_playlist_->AddSegment("file2.ts", 10 * kTimeScale, 30 * kTimeScale,
+                              kZeroByteOffset, 5 * kMBytes);
+  const char kExpectedOutput2[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:25\n"
+      "#EXT-X-PLAYLIST-TYPE:VOD\n"
+      "#EXT-X-I-FRAMES-ONLY\n"
+      "#EXTINF:2.000,\n"
+      "#EXT-X-BYTERANGE:2345@1000\n"
+      "file1.ts\n"
+      "#EXTINF:9.000,\n"
+      "#EXT-X-BYTERANGE:6345@5000\n"
+      "file1.ts\n"
+      "#EXTINF:4.000,\n"
+      "#EXT-X-BYTERANGE:2345@1000\n"
+      "file2.ts\n"
+      "#EXTINF:25.000,\n"
+      "#EXT-X-BYTERANGE:12345\n"
+      "file2.ts\n"
+      "#EXT-X-ENDLIST\n";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput2);
+}
+
 TEST_F(IFrameMediaPlaylistTest, MultiSegmentWithPlacementOpportunity) {
   valid_video_media_info_.set_reference_time_scale(90000);
   valid_video_media_info_.set_segment_template_url("file$Number$.ts");
@@ -1037,6 +1473,7 @@ class MediaPlaylistDeleteSegmentsTest
   }
 
   bool SegmentDeleted(const std::string& segment_name) {
+    FileDeleter::GetInstance()->Flush();
     std::unique_ptr<File, FileCloser> file_closer(
         File::Open(segment_name.c_str(), "r"));
     return file_closer.get() == nullptr;
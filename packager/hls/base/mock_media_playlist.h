@@ -30,6 +30,12 @@ class MockMediaPlaylist : public MediaPlaylist {
                     int64_t duration,
                     uint64_t start_byte_offset,
                     uint64_t size));
+  MOCK_METHOD5(AddPart,
+               void(const std::string& file_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t start_byte_offset,
+                    uint64_t size));
   MOCK_METHOD3(AddKeyFrame,
                void(int64_t timestamp,
                     uint64_t start_byte_offset,
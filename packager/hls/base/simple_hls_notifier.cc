@@ -10,16 +10,21 @@
 #include <cmath>
 
 #include "packager/base/base64.h"
+#include "packager/base/bind.h"
 #include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
 #include "packager/base/optional.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/file/tee_file.h"
 #include "packager/hls/base/media_playlist.h"
+#include "packager/media/base/auto_lock_all.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/proto_json_util.h"
 #include "packager/media/base/widevine_pssh_data.pb.h"
+#include "packager/metrics/metrics.h"
 
 DEFINE_bool(enable_legacy_widevine_hls_signaling,
             false,
@@ -39,6 +44,8 @@ const char kUriBase64Prefix[] = "data:text/plain;base64,";
 const char kUriFairPlayPrefix[] = "skd://";
 const char kWidevineDashIfIopUUID[] =
     "urn:uuid:edef8ba9-79d6-4ace-a3c8-27dcd51d21ed";
+// The key URIs are kept for a few key rotation periods of all the streams.
+const size_t kMaxCachedKeyUris = 64;
 
 bool IsWidevineSystemId(const std::vector<uint8_t>& system_id) {
   return system_id.size() == arraysize(media::kWidevineSystemId) &&
@@ -80,7 +87,8 @@ std::string VectorToString(const std::vector<uint8_t>& v) {
 std::string MakePathRelative(const std::string& media_path,
                              const FilePath& parent_path) {
   FilePath relative_path;
-  const FilePath child_path = FilePath::FromUTF8Unsafe(media_path);
+  const FilePath child_path =
+      FilePath::FromUTF8Unsafe(TeeFile::GetFirstFileName(media_path));
   const bool is_child =
       parent_path.AppendRelativePath(child_path, &relative_path);
   if (!is_child)
@@ -218,41 +226,15 @@ void NotifyEncryptionToMediaPlaylist(
       key_format, key_format_version);
 }
 
-// Creates JSON format and the format similar to MPD.
-bool HandleWidevineKeyFormats(
-    MediaPlaylist::EncryptionMethod encryption_method,
-    const std::vector<uint8_t>& key_id,
-    const std::vector<uint8_t>& iv,
-    const std::vector<uint8_t>& protection_system_specific_data,
-    MediaPlaylist* media_playlist) {
-  if (FLAGS_enable_legacy_widevine_hls_signaling &&
-      encryption_method == MediaPlaylist::EncryptionMethod::kSampleAes) {
-    // This format allows SAMPLE-AES only.
-    std::string key_uri_data;
-    if (!WidevinePsshToJson(protection_system_specific_data, key_id,
-                            &key_uri_data)) {
-      return false;
-    }
-    std::string key_uri_data_base64 =
-        Base64EncodeData(kUriBase64Prefix, key_uri_data);
-    NotifyEncryptionToMediaPlaylist(encryption_method, key_uri_data_base64,
-                                    std::vector<uint8_t>(), iv, "com.widevine",
-                                    "1", media_playlist);
-  }
-
-  std::string pssh_as_string(
-      reinterpret_cast<const char*>(protection_system_specific_data.data()),
-      protection_system_specific_data.size());
-  std::string key_uri_data_base64 =
-      Base64EncodeData(kUriBase64Prefix, pssh_as_string);
-  NotifyEncryptionToMediaPlaylist(encryption_method, key_uri_data_base64,
-                                  key_id, iv, kWidevineDashIfIopUUID, "1",
-                                  media_playlist);
-  return true;
+void RecordPlaylistWriteTime(const char* type, base::TimeTicks start_time) {
+  Metrics::GetInstance()->ObserveDuration(
+      "shaka_manifest_write_seconds", "Time to generate and write manifests.",
+      {{"type", type}}, base::TimeTicks::Now() - start_time);
 }
 
 bool WriteMediaPlaylist(const std::string& output_dir,
                         MediaPlaylist* playlist) {
+  const base::TimeTicks start_time = base::TimeTicks::Now();
   std::string file_path =
       FilePath::FromUTF8Unsafe(output_dir)
           .Append(FilePath::FromUTF8Unsafe(playlist->file_name()))
@@ -261,6 +243,20 @@ bool WriteMediaPlaylist(const std::string& output_dir,
     LOG(ERROR) << "Failed to write playlist " << file_path;
     return false;
   }
+  RecordPlaylistWriteTime("hls_media", start_time);
+  return true;
+}
+
+bool WriteMasterPlaylist(const std::string& base_url,
+                         const std::string& output_dir,
+                         const std::list<MediaPlaylist*>& playlists,
+                         MasterPlaylist* master_playlist) {
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  if (!master_playlist->WriteMasterPlaylist(base_url, output_dir, playlists)) {
+    LOG(ERROR) << "Failed to write master playlist.";
+    return false;
+  }
+  RecordPlaylistWriteTime("hls_master", start_time);
   return true;
 }
 
@@ -292,6 +288,14 @@ SimpleHlsNotifier::SimpleHlsNotifier(const HlsParams& hls_params)
       new MasterPlaylist(master_playlist_path.BaseName().AsUTF8Unsafe(),
                          default_audio_langauge, default_text_language, 
                          hls_params.is_independent_segments));
+  if (hls_params.update_coalescing_window > 0 &&
+      hls_params.playlist_type != HlsPlaylistType::kVod) {
+    update_runner_.reset(new media::CoalescingTaskRunner(
+        "HlsWriter",
+        base::TimeDelta::FromSecondsD(hls_params.update_coalescing_window),
+        base::Bind(&SimpleHlsNotifier::WriteUpdatedPlaylists,
+                   base::Unretained(this))));
+  }
 }
 
 SimpleHlsNotifier::~SimpleHlsNotifier() {}
@@ -321,6 +325,21 @@ bool SimpleHlsNotifier::NotifyNewStream(const MediaInfo& media_info,
     return false;
   }
 
+  MediaPlaylistCheckpoint playlist_checkpoint;
+  bool resumed = false;
+  {
+    base::AutoLock auto_lock(stream_map_lock_);
+    auto checkpoint_iter =
+        playlist_checkpoints_.find(media_playlist->file_name());
+    if (checkpoint_iter != playlist_checkpoints_.end()) {
+      playlist_checkpoint.Swap(&checkpoint_iter->second);
+      playlist_checkpoints_.erase(checkpoint_iter);
+      resumed = true;
+    }
+  }
+  if (resumed)
+    media_playlist->RestoreCheckpoint(playlist_checkpoint);
+
   MediaPlaylist::EncryptionMethod encryption_method =
       MediaPlaylist::EncryptionMethod::kNone;
   if (media_info.protected_content().has_protection_scheme()) {
@@ -336,24 +355,23 @@ bool SimpleHlsNotifier::NotifyNewStream(const MediaInfo& media_info,
     encryption_method = enc_method.value();
   }
 
-  base::AutoLock auto_lock(lock_);
+  std::unique_ptr<StreamEntry> stream(new StreamEntry);
+  stream->media_playlist = std::move(media_playlist);
+  stream->encryption_method = encryption_method;
+  stream->segment_template = media_info.segment_template();
+  base::AutoLock auto_lock(stream_map_lock_);
   *stream_id = sequence_number_++;
-  media_playlists_.push_back(media_playlist.get());
-  stream_map_[*stream_id].reset(
-      new StreamEntry{std::move(media_playlist), encryption_method});
+  stream_map_[*stream_id] = std::move(stream);
   return true;
 }
 
 bool SimpleHlsNotifier::NotifySampleDuration(uint32_t stream_id,
                                              uint32_t sample_duration) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->SetSampleDuration(sample_duration);
+  base::AutoLock stream_lock(stream->lock);
+  stream->media_playlist->SetSampleDuration(sample_duration);
   return true;
 }
 
@@ -363,22 +381,24 @@ bool SimpleHlsNotifier::NotifyNewSegment(uint32_t stream_id,
                                          uint64_t duration,
                                          uint64_t start_byte_offset,
                                          uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
+  MediaPlaylist* media_playlist = stream->media_playlist.get();
+  uint32_t longest_segment_duration = 0;
+  {
+    base::AutoLock stream_lock(stream->lock);
+    const std::string& segment_url =
+        GenerateSegmentUrl(segment_name, hls_params().base_url,
+                           master_playlist_dir_, media_playlist->file_name());
+    media_playlist->AddSegment(segment_url, start_time, duration,
+                               start_byte_offset, size);
+    longest_segment_duration = static_cast<uint32_t>(
+        ceil(media_playlist->GetLongestSegmentDuration()));
   }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  const std::string& segment_url =
-      GenerateSegmentUrl(segment_name, hls_params().base_url,
-                         master_playlist_dir_, media_playlist->file_name());
-  media_playlist->AddSegment(segment_url, start_time, duration,
-                             start_byte_offset, size);
 
+  base::AutoLock auto_lock(lock_);
   // Update target duration.
-  uint32_t longest_segment_duration =
-      static_cast<uint32_t>(ceil(media_playlist->GetLongestSegmentDuration()));
   bool target_duration_updated = false;
   if (longest_segment_duration > target_duration_) {
     target_duration_ = longest_segment_duration;
@@ -386,52 +406,97 @@ bool SimpleHlsNotifier::NotifyNewSegment(uint32_t stream_id,
   }
 
   // Update the playlists when there is new segments in live mode.
-  if (hls_params().playlist_type == HlsPlaylistType::kLive ||
-      hls_params().playlist_type == HlsPlaylistType::kEvent) {
-    // Update all playlists if target duration is updated.
+  if (hls_params().playlist_type != HlsPlaylistType::kLive &&
+      hls_params().playlist_type != HlsPlaylistType::kEvent) {
+    return true;
+  }
+  const std::vector<StreamEntry*> streams = GetStreamEntries();
+  if (update_runner_) {
     if (target_duration_updated) {
-      for (MediaPlaylist* playlist : media_playlists_) {
-        playlist->SetTargetDuration(target_duration_);
-        if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
-          return false;
+      for (StreamEntry* updated_stream : streams) {
+        base::AutoLock stream_lock(updated_stream->lock);
+        updated_stream->media_playlist->SetTargetDuration(target_duration_);
+        updated_streams_.insert(updated_stream);
       }
     } else {
-      if (!WriteMediaPlaylist(master_playlist_dir_, media_playlist.get()))
+      updated_streams_.insert(stream);
+    }
+    update_runner_->Request();
+    return true;
+  }
+  // Update all playlists if target duration is updated.
+  if (target_duration_updated) {
+    for (StreamEntry* updated_stream : streams) {
+      base::AutoLock stream_lock(updated_stream->lock);
+      updated_stream->media_playlist->SetTargetDuration(target_duration_);
+      if (!WriteMediaPlaylist(master_playlist_dir_,
+                              updated_stream->media_playlist.get())) {
         return false;
+      }
     }
-    if (!master_playlist_->WriteMasterPlaylist(
-            hls_params().base_url, master_playlist_dir_, media_playlists_)) {
-      LOG(ERROR) << "Failed to write master playlist.";
+  } else {
+    base::AutoLock stream_lock(stream->lock);
+    if (!WriteMediaPlaylist(master_playlist_dir_, media_playlist))
       return false;
+  }
+  media::AutoLockAll stream_locks(GetStreamLocks(streams));
+  return WriteMasterPlaylistLocked(streams);
+}
+
+bool SimpleHlsNotifier::NotifyNewChunk(uint32_t stream_id,
+                                       const std::string& segment_name,
+                                       uint64_t start_time,
+                                       uint64_t duration,
+                                       uint64_t start_byte_offset,
+                                       uint64_t size) {
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
+    return false;
+  MediaPlaylist* media_playlist = stream->media_playlist.get();
+  {
+    base::AutoLock stream_lock(stream->lock);
+    const std::string& segment_url =
+        GenerateSegmentUrl(segment_name, hls_params().base_url,
+                           master_playlist_dir_, media_playlist->file_name());
+    media_playlist->AddPart(segment_url, start_time, duration,
+                            start_byte_offset, size);
+  }
+
+  // Only the media playlist is updated with the new part in live mode.
+  if (hls_params().playlist_type != HlsPlaylistType::kLive &&
+      hls_params().playlist_type != HlsPlaylistType::kEvent) {
+    return true;
+  }
+  if (update_runner_) {
+    {
+      base::AutoLock auto_lock(lock_);
+      updated_streams_.insert(stream);
     }
+    update_runner_->Request();
+    return true;
   }
-  return true;
+  base::AutoLock stream_lock(stream->lock);
+  return WriteMediaPlaylist(master_playlist_dir_, media_playlist);
 }
 
 bool SimpleHlsNotifier::NotifyKeyFrame(uint32_t stream_id,
                                        uint64_t timestamp,
                                        uint64_t start_byte_offset,
                                        uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->AddKeyFrame(timestamp, start_byte_offset, size);
+  base::AutoLock stream_lock(stream->lock);
+  stream->media_playlist->AddKeyFrame(timestamp, start_byte_offset, size);
   return true;
 }
 
 bool SimpleHlsNotifier::NotifyCueEvent(uint32_t stream_id, uint64_t timestamp) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->AddPlacementOpportunity();
+  base::AutoLock stream_lock(stream->lock);
+  stream->media_playlist->AddPlacementOpportunity();
   return true;
 }
 
@@ -441,17 +506,14 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     const std::vector<uint8_t>& system_id,
     const std::vector<uint8_t>& iv,
     const std::vector<uint8_t>& protection_system_specific_data) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream = GetStreamEntry(stream_id);
+  if (!stream)
     return false;
-  }
+  base::AutoLock stream_lock(stream->lock);
 
-  std::unique_ptr<MediaPlaylist>& media_playlist =
-      stream_iterator->second->media_playlist;
+  std::unique_ptr<MediaPlaylist>& media_playlist = stream->media_playlist;
   const MediaPlaylist::EncryptionMethod encryption_method =
-      stream_iterator->second->encryption_method;
+      stream->encryption_method;
   LOG_IF(WARNING, encryption_method == MediaPlaylist::EncryptionMethod::kNone)
       << "Got encryption notification but the encryption method is NONE";
   if (IsWidevineSystemId(system_id)) {
@@ -468,8 +530,13 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     if (key_uri.empty()) {
       // Use key_id as the key_uri. The player needs to have custom logic to
       // convert it to the actual key uri.
-      std::string key_uri_data = VectorToString(key_id);
-      key_uri = Base64EncodeData(kUriBase64Prefix, key_uri_data);
+      const std::string key_uri_data = VectorToString(key_id);
+      GetKeyUri("identity:" + key_uri_data,
+                [&key_uri_data](std::string* key_uri) {
+                  *key_uri = Base64EncodeData(kUriBase64Prefix, key_uri_data);
+                  return true;
+                },
+                &key_uri);
     }
     NotifyEncryptionToMediaPlaylist(encryption_method, key_uri, empty_key_id,
                                     iv, "identity", "", media_playlist.get());
@@ -480,8 +547,13 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     if (key_uri.empty()) {
       // Use key_id as the key_uri. The player needs to have custom logic to
       // convert it to the actual key uri.
-      std::string key_uri_data = VectorToString(key_id);
-      key_uri = Base64EncodeData(kUriFairPlayPrefix, key_uri_data);
+      const std::string key_uri_data = VectorToString(key_id);
+      GetKeyUri("fairplay:" + key_uri_data,
+                [&key_uri_data](std::string* key_uri) {
+                  *key_uri = Base64EncodeData(kUriFairPlayPrefix, key_uri_data);
+                  return true;
+                },
+                &key_uri);
     }
 
     // FairPlay defines IV to be carried with the key, not the playlist.
@@ -497,20 +569,203 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
   return true;
 }
 
-bool SimpleHlsNotifier::Flush() {
-  base::AutoLock auto_lock(lock_);
-  for (MediaPlaylist* playlist : media_playlists_) {
-    playlist->SetTargetDuration(target_duration_);
-    if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
+// Creates JSON format and the format similar to MPD.
+bool SimpleHlsNotifier::HandleWidevineKeyFormats(
+    MediaPlaylist::EncryptionMethod encryption_method,
+    const std::vector<uint8_t>& key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<uint8_t>& protection_system_specific_data,
+    MediaPlaylist* media_playlist) {
+  const std::string pssh_as_string =
+      VectorToString(protection_system_specific_data);
+  if (FLAGS_enable_legacy_widevine_hls_signaling &&
+      encryption_method == MediaPlaylist::EncryptionMethod::kSampleAes) {
+    // This format allows SAMPLE-AES only.
+    std::string key_uri_data_base64;
+    if (!GetKeyUri("widevine-json:" + VectorToString(key_id) + pssh_as_string,
+                   [&](std::string* key_uri) {
+                     std::string key_uri_data;
+                     if (!WidevinePsshToJson(protection_system_specific_data,
+                                             key_id, &key_uri_data)) {
+                       return false;
+                     }
+                     *key_uri = Base64EncodeData(kUriBase64Prefix,
+                                                 key_uri_data);
+                     return true;
+                   },
+                   &key_uri_data_base64)) {
       return false;
+    }
+    NotifyEncryptionToMediaPlaylist(encryption_method, key_uri_data_base64,
+                                    std::vector<uint8_t>(), iv, "com.widevine",
+                                    "1", media_playlist);
   }
-  if (!master_playlist_->WriteMasterPlaylist(
-          hls_params().base_url, master_playlist_dir_, media_playlists_)) {
-    LOG(ERROR) << "Failed to write master playlist.";
+
+  std::string key_uri_data_base64;
+  GetKeyUri("widevine:" + pssh_as_string,
+            [&pssh_as_string](std::string* key_uri) {
+              *key_uri = Base64EncodeData(kUriBase64Prefix, pssh_as_string);
+              return true;
+            },
+            &key_uri_data_base64);
+  NotifyEncryptionToMediaPlaylist(encryption_method, key_uri_data_base64,
+                                  key_id, iv, kWidevineDashIfIopUUID, "1",
+                                  media_playlist);
+  return true;
+}
+
+bool SimpleHlsNotifier::GetKeyUri(
+    const std::string& cache_key,
+    const std::function<bool(std::string* key_uri)>& generate,
+    std::string* key_uri) {
+  {
+    base::AutoLock auto_lock(key_uris_lock_);
+    auto iter = key_uris_.find(cache_key);
+    if (iter != key_uris_.end()) {
+      *key_uri = iter->second;
+      return true;
+    }
+  }
+  // Generated without holding the lock. Streams racing on the same key
+  // generate the same URI.
+  if (!generate(key_uri))
     return false;
+  base::AutoLock auto_lock(key_uris_lock_);
+  if (key_uris_.size() >= kMaxCachedKeyUris)
+    key_uris_.clear();
+  key_uris_[cache_key] = *key_uri;
+  return true;
+}
+
+bool SimpleHlsNotifier::Flush() {
+  std::vector<std::function<void()>> flush_callbacks;
+  {
+    base::AutoLock auto_lock(lock_);
+    updated_streams_.clear();
+    const std::vector<StreamEntry*> streams = GetStreamEntries();
+    media::AutoLockAll stream_locks(GetStreamLocks(streams));
+    for (StreamEntry* stream : streams) {
+      stream->media_playlist->SetTargetDuration(target_duration_);
+      if (!WriteMediaPlaylist(master_playlist_dir_,
+                              stream->media_playlist.get())) {
+        return false;
+      }
+    }
+    if (!WriteMasterPlaylistLocked(streams))
+      return false;
+    flush_callbacks.swap(flush_callbacks_);
   }
+  for (const auto& callback : flush_callbacks)
+    callback();
   return true;
 }
 
+void SimpleHlsNotifier::RunAfterFlush(std::function<void()> callback) {
+  if (hls_params().playlist_type == HlsPlaylistType::kVod)
+    return;
+  // Without coalescing, the playlists are written on the update already.
+  if (!update_runner_) {
+    callback();
+    return;
+  }
+  base::AutoLock auto_lock(lock_);
+  flush_callbacks_.push_back(std::move(callback));
+}
+
+void SimpleHlsNotifier::SaveCheckpoint(ManifestCheckpoint* checkpoint) {
+  base::AutoLock auto_lock(lock_);
+  const std::vector<StreamEntry*> streams = GetStreamEntries();
+  media::AutoLockAll stream_locks(GetStreamLocks(streams));
+  for (StreamEntry* stream : streams) {
+    MediaPlaylistCheckpoint* playlist_checkpoint =
+        checkpoint->add_media_playlists();
+    playlist_checkpoint->set_playlist_name(
+        stream->media_playlist->file_name());
+    playlist_checkpoint->set_segment_template(stream->segment_template);
+    stream->media_playlist->SaveCheckpoint(playlist_checkpoint);
+  }
+}
+
+void SimpleHlsNotifier::ResumeFromCheckpoint(
+    const ManifestCheckpoint& checkpoint) {
+  base::AutoLock auto_lock(stream_map_lock_);
+  DCHECK(stream_map_.empty());
+  for (const MediaPlaylistCheckpoint& playlist_checkpoint :
+       checkpoint.media_playlists()) {
+    playlist_checkpoints_[playlist_checkpoint.playlist_name()] =
+        playlist_checkpoint;
+  }
+}
+
+SimpleHlsNotifier::StreamEntry* SimpleHlsNotifier::GetStreamEntry(
+    uint32_t stream_id) {
+  base::AutoLock auto_lock(stream_map_lock_);
+  auto stream_iterator = stream_map_.find(stream_id);
+  if (stream_iterator == stream_map_.end()) {
+    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+    return nullptr;
+  }
+  return stream_iterator->second.get();
+}
+
+std::vector<SimpleHlsNotifier::StreamEntry*>
+SimpleHlsNotifier::GetStreamEntries() {
+  base::AutoLock auto_lock(stream_map_lock_);
+  std::vector<StreamEntry*> streams;
+  streams.reserve(stream_map_.size());
+  for (auto& stream_pair : stream_map_)
+    streams.push_back(stream_pair.second.get());
+  return streams;
+}
+
+std::vector<base::Lock*> SimpleHlsNotifier::GetStreamLocks(
+    const std::vector<StreamEntry*>& streams) {
+  std::vector<base::Lock*> locks;
+  locks.reserve(streams.size());
+  for (StreamEntry* stream : streams)
+    locks.push_back(&stream->lock);
+  return locks;
+}
+
+bool SimpleHlsNotifier::WriteMasterPlaylistLocked(
+    const std::vector<StreamEntry*>& streams) {
+  lock_.AssertAcquired();
+  std::list<MediaPlaylist*> media_playlists;
+  for (StreamEntry* stream : streams)
+    media_playlists.push_back(stream->media_playlist.get());
+  return WriteMasterPlaylist(hls_params().base_url, master_playlist_dir_,
+                             media_playlists, master_playlist_.get());
+}
+
+void SimpleHlsNotifier::WriteUpdatedPlaylists() {
+  std::set<StreamEntry*> updated_streams;
+  // The callbacks registered so far, whose updates are written by this run.
+  std::vector<std::function<void()>> flush_callbacks;
+  {
+    base::AutoLock auto_lock(lock_);
+    updated_streams.swap(updated_streams_);
+    flush_callbacks.swap(flush_callbacks_);
+  }
+  if (updated_streams.empty()) {
+    for (const auto& callback : flush_callbacks)
+      callback();
+    return;
+  }
+  // Only the stream being written is locked, so the notifications, including
+  // the ones of the stream once it is written, are not blocked on I/O.
+  for (StreamEntry* stream : updated_streams) {
+    base::AutoLock stream_lock(stream->lock);
+    WriteMediaPlaylist(master_playlist_dir_, stream->media_playlist.get());
+  }
+  {
+    base::AutoLock auto_lock(lock_);
+    const std::vector<StreamEntry*> streams = GetStreamEntries();
+    media::AutoLockAll stream_locks(GetStreamLocks(streams));
+    WriteMasterPlaylistLocked(streams);
+  }
+  for (const auto& callback : flush_callbacks)
+    callback();
+}
+
 }  // namespace hls
 }  // namespace shaka
@@ -7,9 +7,11 @@
 #ifndef PACKAGER_HLS_BASE_SIMPLE_HLS_NOTIFIER_H_
 #define PACKAGER_HLS_BASE_SIMPLE_HLS_NOTIFIER_H_
 
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -19,6 +21,8 @@
 #include "packager/hls/base/master_playlist.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/hls/public/hls_params.h"
+#include "packager/media/base/coalescing_task_runner.h"
+#include "packager/mpd/base/manifest_checkpoint.pb.h"
 
 namespace shaka {
 namespace hls {
@@ -57,6 +61,12 @@ class SimpleHlsNotifier : public HlsNotifier {
                         uint64_t duration,
                         uint64_t start_byte_offset,
                         uint64_t size) override;
+  bool NotifyNewChunk(uint32_t stream_id,
+                      const std::string& segment_name,
+                      uint64_t start_time,
+                      uint64_t duration,
+                      uint64_t start_byte_offset,
+                      uint64_t size) override;
   bool NotifyKeyFrame(uint32_t stream_id,
                       uint64_t timestamp,
                       uint64_t start_byte_offset,
@@ -69,6 +79,11 @@ class SimpleHlsNotifier : public HlsNotifier {
       const std::vector<uint8_t>& iv,
       const std::vector<uint8_t>& protection_system_specific_data) override;
   bool Flush() override;
+  /// The callbacks of a VOD stream are dropped, as its playlists are only
+  /// written when it ends.
+  void RunAfterFlush(std::function<void()> callback) override;
+  void SaveCheckpoint(ManifestCheckpoint* checkpoint) override;
+  void ResumeFromCheckpoint(const ManifestCheckpoint& checkpoint) override;
   /// }@
 
  private:
@@ -77,21 +92,88 @@ class SimpleHlsNotifier : public HlsNotifier {
   struct StreamEntry {
     std::unique_ptr<MediaPlaylist> media_playlist;
     MediaPlaylist::EncryptionMethod encryption_method;
+    // The segment template of the stream, saved in the checkpoints so that
+    // the packager resumes the segment numbering of the stream.
+    std::string segment_template;
+    // Guards |media_playlist|. The notifications of the stream only hold this
+    // lock, except NotifyNewSegment(), which may update the other playlists.
+    base::Lock lock;
   };
 
+  // Find the entry of a stream. |stream_map_lock_| is only held during the
+  // lookup. The entries are never removed, so the result stays valid.
+  // @return the entry, or null if |stream_id| is unknown.
+  StreamEntry* GetStreamEntry(uint32_t stream_id);
+
+  // @return the entries of all the streams, in stream ID order, which is also
+  //         the order of the playlists in the master playlist.
+  std::vector<StreamEntry*> GetStreamEntries();
+
+  // @return the locks of |streams|, in the same order.
+  static std::vector<base::Lock*> GetStreamLocks(
+      const std::vector<StreamEntry*>& streams);
+
+  // Write the master playlist. |lock_| and the locks of all the entries in
+  // |streams| must be held.
+  bool WriteMasterPlaylistLocked(const std::vector<StreamEntry*>& streams);
+
+  // Write the playlists updated since the last write, and the master
+  // playlist. Run by |update_runner_|.
+  void WriteUpdatedPlaylists();
+
+  // Add the Widevine EXT-X-KEY tags of an encryption update to
+  // |media_playlist|.
+  bool HandleWidevineKeyFormats(
+      MediaPlaylist::EncryptionMethod encryption_method,
+      const std::vector<uint8_t>& key_id,
+      const std::vector<uint8_t>& iv,
+      const std::vector<uint8_t>& protection_system_specific_data,
+      MediaPlaylist* media_playlist);
+
+  // Get the key URI of |cache_key|, generated with |generate| unless it was
+  // generated by an earlier encryption update, e.g. of another stream with the
+  // same key in the key rotation period.
+  // @return false if |generate| fails.
+  bool GetKeyUri(const std::string& cache_key,
+                 const std::function<bool(std::string* key_uri)>& generate,
+                 std::string* key_uri);
+
   std::string master_playlist_dir_;
-  uint32_t target_duration_ = 0;
 
   std::unique_ptr<MediaPlaylistFactory> media_playlist_factory_;
-  std::unique_ptr<MasterPlaylist> master_playlist_;
 
+  // Guards |stream_map_|, |sequence_number_| and |playlist_checkpoints_|.
+  // It is never held while acquiring another lock.
+  base::Lock stream_map_lock_;
   // Maps to unique_ptr because StreamEntry also holds unique_ptr
   std::map<uint32_t, std::unique_ptr<StreamEntry>> stream_map_;
-  std::list<MediaPlaylist*> media_playlists_;
-
   uint32_t sequence_number_ = 0;
+  // The playlists to restore, by playlist file name, set by
+  // ResumeFromCheckpoint(). An entry is removed once its stream is added.
+  std::map<std::string, MediaPlaylistCheckpoint> playlist_checkpoints_;
 
+  // Guards the members below and serializes the writes of the playlists.
+  // Acquired before the locks of the streams, which are acquired in stream ID
+  // order.
   base::Lock lock_;
+  uint32_t target_duration_ = 0;
+  std::unique_ptr<MasterPlaylist> master_playlist_;
+  // The streams whose playlists are written on the next run of
+  // |update_runner_|.
+  std::set<StreamEntry*> updated_streams_;
+  // The callbacks to run once the playlists are written, see RunAfterFlush().
+  std::vector<std::function<void()>> flush_callbacks_;
+
+  // Guards |key_uris_|. It is never held while acquiring another lock.
+  base::Lock key_uris_lock_;
+  // The key URIs generated by the encryption updates, which are the same for
+  // all the streams sharing a key, e.g. the base64 encoded PSSHs, by system ID
+  // and key. Cleared once it holds more than a few key rotation periods.
+  std::map<std::string, std::string> key_uris_;
+
+  // Not null if the playlist updates are coalesced. Declared last so it is
+  // stopped before the other members are destroyed.
+  std::unique_ptr<media::CoalescingTaskRunner> update_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleHlsNotifier);
 };
@@ -121,6 +121,10 @@ class SimpleHlsNotifierTest : public ::testing::Test {
     return notifier.stream_map_.size();
   }
 
+  size_t NumCachedKeyUris(const SimpleHlsNotifier& notifier) {
+    return notifier.key_uris_.size();
+  }
+
   uint32_t SetupStream(const std::string& protection_scheme,
                        MockMediaPlaylist* mock_media_playlist,
                        SimpleHlsNotifier* notifier) {
@@ -301,6 +305,49 @@ TEST_F(SimpleHlsNotifierTest, NotifyEncryptionUpdateIdentityKey) {
       stream_id, key_id, common_system_id_, iv, dummy_pssh_data));
 }
 
+// The key URI of a key is generated once and reused by the following
+// encryption updates with the same key, e.g. of the other streams.
+TEST_F(SimpleHlsNotifierTest, NotifyEncryptionUpdateReusesKeyUri) {
+  // Pointer released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist =
+      new MockMediaPlaylist("playlist.m3u8", "", "");
+  SimpleHlsNotifier notifier(hls_params_);
+  const uint32_t stream_id =
+      SetupStream(kSampleAesProtectionScheme, mock_media_playlist, &notifier);
+
+  const std::vector<uint8_t> key_id(16, 0x23);
+  const std::vector<uint8_t> next_key_id(16, 0x24);
+  const std::vector<uint8_t> iv(16, 0x45);
+  const std::vector<uint8_t> dummy_pssh_data(10, 'p');
+
+  std::string expected_key_uri_base64;
+  base::Base64Encode(std::string(key_id.begin(), key_id.end()),
+                     &expected_key_uri_base64);
+  std::string expected_next_key_uri_base64;
+  base::Base64Encode(std::string(next_key_id.begin(), next_key_id.end()),
+                     &expected_next_key_uri_base64);
+
+  EXPECT_CALL(*mock_media_playlist,
+              AddEncryptionInfo(
+                  _, StrEq("data:text/plain;base64," + expected_key_uri_base64),
+                  StrEq(""), _, StrEq("identity"), _))
+      .Times(2);
+  EXPECT_CALL(
+      *mock_media_playlist,
+      AddEncryptionInfo(
+          _, StrEq("data:text/plain;base64," + expected_next_key_uri_base64),
+          StrEq(""), _, StrEq("identity"), _));
+
+  EXPECT_TRUE(notifier.NotifyEncryptionUpdate(
+      stream_id, key_id, common_system_id_, iv, dummy_pssh_data));
+  EXPECT_TRUE(notifier.NotifyEncryptionUpdate(
+      stream_id, key_id, common_system_id_, iv, dummy_pssh_data));
+  EXPECT_EQ(1u, NumCachedKeyUris(notifier));
+  EXPECT_TRUE(notifier.NotifyEncryptionUpdate(
+      stream_id, next_key_id, common_system_id_, iv, dummy_pssh_data));
+  EXPECT_EQ(2u, NumCachedKeyUris(notifier));
+}
+
 // Verify that the encryption scheme set in MediaInfo is passed to
 // MediaPlaylist::AddEncryptionInfo().
 TEST_F(SimpleHlsNotifierTest, EncryptionScheme) {
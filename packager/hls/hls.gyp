@@ -29,7 +29,9 @@
         '../file/file.gyp:file',
         '../media/base/media_base.gyp:media_base',
         '../media/base/media_base.gyp:widevine_pssh_data_proto',
+        '../metrics/metrics.gyp:metrics',
         '../mpd/mpd.gyp:manifest_base',
+        '../mpd/mpd.gyp:manifest_checkpoint_proto',
         '../mpd/mpd.gyp:media_info_proto',
         '../third_party/gflags/gflags.gyp:gflags',
       ],
@@ -47,6 +49,7 @@
       'dependencies': [
         '../base/base.gyp:base',
         '../media/test/media_test.gyp:run_tests_with_atexit_manager',
+        '../mpd/mpd.gyp:manifest_checkpoint_proto',
         '../mpd/mpd.gyp:media_info_proto',
         '../testing/gmock.gyp:gmock',
         '../testing/gtest.gyp:gtest',
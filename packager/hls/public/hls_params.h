@@ -62,6 +62,28 @@ struct HlsParams {
   /// Custom EXT-X-MEDIA-SEQUENCE value to allow continuous media playback
   /// across packager restarts. See #691 for details.
   uint32_t media_sequence_number = 0;
+  /// For live and event playlists only. If positive, the playlist updates
+  /// after new segments are written by a dedicated thread, at most once per
+  /// this many seconds, instead of by the muxer thread of every segment. The
+  /// playlists are then up to this much behind the segments.
+  double update_coalescing_window = 0;
+  /// For live and event playlists with low latency chunked output only. Set if
+  /// the server delivering the playlists supports blocking playlist reload,
+  /// i.e. holds the requests with _HLS_msn and _HLS_part until the playlist
+  /// contains the requested segment or part. Sets CAN-BLOCK-RELOAD=YES in
+  /// EXT-X-SERVER-CONTROL.
+  bool can_block_reload = false;
+  /// For live and event playlists only. If positive, a delta update of each
+  /// media playlist is also written, where EXT-X-SKIP replaces the segments
+  /// older than this many seconds, at least six target durations, from the
+  /// end of the playlist, for the server to deliver for the playlist requests
+  /// with _HLS_skip=YES. Sets CAN-SKIP-UNTIL in EXT-X-SERVER-CONTROL.
+  double can_skip_until = 0;
+  /// For live and event playlists only. Set EXT-X-MEDIA-SEQUENCE from the
+  /// timestamp of the first segment, like the segment numbers of the muxers
+  /// with ChunkingParams::segment_numbers_from_timestamps. It will be
+  /// populated from ChunkingParams.
+  bool segment_numbers_from_timestamps = false;
 };
 
 }  // namespace shaka
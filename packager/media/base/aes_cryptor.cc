@@ -10,11 +10,16 @@
 #include <openssl/crypto.h>
 #include <openssl/err.h>
 #include <openssl/rand.h>
+#include <string.h>
 
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/decrypt_config.h"
 
 namespace {
 
@@ -24,6 +29,61 @@ bool IsIvSizeValid(size_t iv_size) {
   return iv_size == 8 || iv_size == 16;
 }
 
+// The cache is cleared when it is full. Rotated keys are not used again after
+// their crypto period, so there is no point in evicting them one by one.
+const size_t kMaxCachedKeySchedules = 1024;
+
+// The expanded AES key schedules, shared by all the cryptors. Thread safe.
+class KeyScheduleCache {
+ public:
+  static KeyScheduleCache* GetInstance() {
+    static KeyScheduleCache instance;
+    return &instance;
+  }
+
+  void GetKeySchedule(const std::vector<uint8_t>& key,
+                      bool for_decryption,
+                      AES_KEY* aes_key) {
+    std::pair<bool, std::vector<uint8_t>> cache_key(for_decryption, key);
+    {
+      base::AutoLock scoped_lock(lock_);
+      auto it = key_schedules_.find(cache_key);
+      if (it != key_schedules_.end()) {
+        *aes_key = it->second;
+        return;
+      }
+    }
+
+    const int result =
+        for_decryption
+            ? AES_set_decrypt_key(key.data(), key.size() * 8, aes_key)
+            : AES_set_encrypt_key(key.data(), key.size() * 8, aes_key);
+    CHECK_EQ(result, 0);
+
+    base::AutoLock scoped_lock(lock_);
+    if (key_schedules_.size() >= kMaxCachedKeySchedules)
+      Clear();
+    key_schedules_.emplace(std::move(cache_key), *aes_key);
+  }
+
+ private:
+  KeyScheduleCache() {}
+  ~KeyScheduleCache() {
+    base::AutoLock scoped_lock(lock_);
+    Clear();
+  }
+
+  // Clear the cache, and the key material in it.
+  void Clear() {
+    for (auto& entry : key_schedules_)
+      OPENSSL_cleanse(&entry.second, sizeof(entry.second));
+    key_schedules_.clear();
+  }
+
+  base::Lock lock_;
+  std::map<std::pair<bool, std::vector<uint8_t>>, AES_KEY> key_schedules_;
+};
+
 }  // namespace
 
 namespace shaka {
@@ -38,6 +98,11 @@ AesCryptor::AesCryptor(ConstantIvFlag constant_iv_flag)
 
 AesCryptor::~AesCryptor() {}
 
+void AesCryptor::SetKey(const std::vector<uint8_t>& key, bool for_decryption) {
+  KeyScheduleCache::GetInstance()->GetKeySchedule(key, for_decryption,
+                                                  mutable_aes_key());
+}
+
 bool AesCryptor::Crypt(const std::vector<uint8_t>& text,
                        std::vector<uint8_t>* crypt_text) {
   // Save text size to make it work for in-place conversion, since the
@@ -67,6 +132,35 @@ bool AesCryptor::Crypt(const std::string& text, std::string* crypt_text) {
   return true;
 }
 
+bool AesCryptor::CryptSubsamples(const uint8_t* text,
+                                 size_t text_size,
+                                 const std::vector<SubsampleEntry>& subsamples,
+                                 uint8_t* crypt_text) {
+  if (subsamples.empty())
+    return Crypt(text, text_size, crypt_text);
+
+  const uint8_t* const text_end = text + text_size;
+  for (const SubsampleEntry& subsample : subsamples) {
+    if (subsample.clear_bytes + subsample.cipher_bytes >
+        static_cast<size_t>(text_end - text)) {
+      LOG(ERROR) << "Subsamples overflow sample buffer.";
+      return false;
+    }
+    if (subsample.clear_bytes > 0 && crypt_text != text)
+      memcpy(crypt_text, text, subsample.clear_bytes);
+    text += subsample.clear_bytes;
+    crypt_text += subsample.clear_bytes;
+    if (subsample.cipher_bytes > 0) {
+      size_t crypt_text_size = subsample.cipher_bytes;
+      if (!Crypt(text, subsample.cipher_bytes, crypt_text, &crypt_text_size))
+        return false;
+      text += subsample.cipher_bytes;
+      crypt_text += subsample.cipher_bytes;
+    }
+  }
+  return true;
+}
+
 bool AesCryptor::SetIv(const std::vector<uint8_t>& iv) {
   if (!IsIvSizeValid(iv.size())) {
     LOG(ERROR) << "Invalid IV size: " << iv.size();
@@ -107,6 +201,13 @@ void AesCryptor::UpdateIv() {
   SetIvInternal();
 }
 
+void AesCryptor::AdvanceIv(size_t num_crypt_bytes) {
+  if (constant_iv_flag_ == kUseConstantIv)
+    return;
+  num_crypt_bytes_ += num_crypt_bytes;
+  UpdateIv();
+}
+
 bool AesCryptor::GenerateRandomIv(FourCC protection_scheme,
                                   std::vector<uint8_t>* iv) {
   // ISO/IEC 23001-7:2016 10.1 and 10.3 For 'cenc' and 'cens'
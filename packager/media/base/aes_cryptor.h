@@ -20,6 +20,8 @@ typedef struct aes_key_st AES_KEY;
 namespace shaka {
 namespace media {
 
+struct SubsampleEntry;
+
 // AES cryptor interface. Inherited by various AES encryptor and decryptor
 // implementations.
 class AesCryptor {
@@ -68,6 +70,20 @@ class AesCryptor {
   }
   /// @}
 
+  /// Crypt the protected regions of a sample in one call. The clear bytes of
+  /// @a subsamples are copied to @a crypt_text, unless in place, and the
+  /// cipher bytes are crypted as with one Crypt() call per subsample, i.e.
+  /// the constant iv, if used, is reset for every subsample.
+  /// @param subsamples describes the regions of @a text. The whole @a text is
+  ///        crypted if it is empty.
+  /// @param crypt_text should have at least @a text_size bytes. It can be the
+  ///        same address as @a text.
+  /// @return false if @a subsamples overflow @a text or on crypt errors.
+  bool CryptSubsamples(const uint8_t* text,
+                       size_t text_size,
+                       const std::vector<SubsampleEntry>& subsamples,
+                       uint8_t* crypt_text);
+
   /// Set IV. SetIv() implementation guarantees that the iv passed to SetIv()
   /// is set to iv() and then calls SetIvInternal().
   /// @return true if successful, false if the input is invalid.
@@ -78,6 +94,12 @@ class AesCryptor {
   /// This is used by encryptors only. It is a NOP if using kUseConstantIv.
   void UpdateIv();
 
+  /// Update IV for next sample as if @a num_crypt_bytes bytes had been passed
+  /// to Crypt() with the current IV. This allows computing the IV of every
+  /// sample without encrypting them, e.g. to encrypt them in parallel with
+  /// separate cryptors. It is a NOP if using kUseConstantIv.
+  void AdvanceIv(size_t num_crypt_bytes);
+
   /// @return The current iv.
   const std::vector<uint8_t>& iv() const { return iv_; }
 
@@ -95,6 +117,13 @@ class AesCryptor {
   const AES_KEY* aes_key() const { return aes_key_.get(); }
   AES_KEY* mutable_aes_key() { return aes_key_.get(); }
 
+  /// Set the AES key schedule of @a key, for encryption or decryption. The
+  /// schedules are cached and shared by all the cryptors of the process, so
+  /// a key used by many streams, e.g. at key rotation boundaries, is only
+  /// expanded once.
+  /// @param key is a 128, 192 or 256 bit AES key.
+  void SetKey(const std::vector<uint8_t>& key, bool for_decryption);
+
  private:
   // Internal implementation of crypt function.
   // |text| points to the input text.
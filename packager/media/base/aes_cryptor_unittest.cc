@@ -6,12 +6,14 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <memory>
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/media/base/aes_decryptor.h"
 #include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/decrypt_config.h"
 
 namespace {
 
@@ -215,6 +217,41 @@ TEST_F(AesCtrEncryptorTest, UnsupportedIV) {
   ASSERT_FALSE(encryptor_.InitializeWithIv(key_, iv));
 }
 
+TEST_F(AesCtrEncryptorTest, CryptSubsamples) {
+  const std::vector<SubsampleEntry> subsamples = {{4, 20}, {8, 32}};
+  std::vector<uint8_t> encrypted(plaintext_.size());
+  ASSERT_TRUE(encryptor_.CryptSubsamples(plaintext_.data(), plaintext_.size(),
+                                         subsamples, encrypted.data()));
+
+  // The cipher bytes are encrypted as a single stream.
+  std::vector<uint8_t> cipher_bytes(plaintext_.begin() + 4,
+                                    plaintext_.begin() + 24);
+  cipher_bytes.insert(cipher_bytes.end(), plaintext_.begin() + 32,
+                      plaintext_.end());
+  AesCtrEncryptor encryptor;
+  ASSERT_TRUE(encryptor.InitializeWithIv(key_, iv_));
+  ASSERT_TRUE(encryptor.Crypt(cipher_bytes, &cipher_bytes));
+  std::vector<uint8_t> expected = plaintext_;
+  std::copy(cipher_bytes.begin(), cipher_bytes.begin() + 20,
+            expected.begin() + 4);
+  std::copy(cipher_bytes.begin() + 20, cipher_bytes.end(),
+            expected.begin() + 32);
+  EXPECT_EQ(expected, encrypted);
+
+  // In place decryption.
+  ASSERT_TRUE(decryptor_.SetIv(iv_));
+  ASSERT_TRUE(decryptor_.CryptSubsamples(encrypted.data(), encrypted.size(),
+                                         subsamples, encrypted.data()));
+  EXPECT_EQ(plaintext_, encrypted);
+}
+
+TEST_F(AesCtrEncryptorTest, CryptSubsamplesOverflow) {
+  const std::vector<SubsampleEntry> subsamples = {{4, 20}, {8, 33}};
+  std::vector<uint8_t> encrypted(plaintext_.size());
+  EXPECT_FALSE(encryptor_.CryptSubsamples(plaintext_.data(), plaintext_.size(),
+                                          subsamples, encrypted.data()));
+}
+
 // Subsample test cases.
 struct SubsampleTestCase {
   const uint8_t* subsample_sizes;
@@ -293,6 +330,20 @@ TEST_P(AesCtrEncryptorIvTest, IvTest) {
   EXPECT_EQ(iv_expected, encryptor.iv());
 }
 
+TEST_P(AesCtrEncryptorIvTest, AdvanceIvTest) {
+  std::vector<uint8_t> key(16, 1);
+  std::vector<uint8_t> iv_test(GetParam().iv_test,
+                               GetParam().iv_test + GetParam().iv_size);
+  std::vector<uint8_t> iv_expected(GetParam().iv_expected,
+                                   GetParam().iv_expected + GetParam().iv_size);
+
+  AesCtrEncryptor encryptor;
+  ASSERT_TRUE(encryptor.InitializeWithIv(key, iv_test));
+  // Same as encrypting |kTextSizeInBytes| bytes followed by UpdateIv().
+  encryptor.AdvanceIv(kTextSizeInBytes);
+  EXPECT_EQ(iv_expected, encryptor.iv());
+}
+
 namespace {
 // As recommended in ISO/IEC FDIS 23001-7: CENC spec,
 // For 64-bit (8-byte) IV_Sizes, initialization vectors for subsequent samples
@@ -456,6 +507,41 @@ TEST_F(AesCbcTest, Aes192CbcPkcs5) {
   TestEncryptDecrypt(plaintext, expected_ciphertext);
 }
 
+TEST_F(AesCbcTest, KeysAlternatedAcrossCryptors) {
+  // The key schedules are shared by the cryptors, e.g. with key rotation.
+  const std::string kKey = "192bitsIsTwentyFourByte!";
+  const std::string kIv = "Sweet Sixteen IV";
+  const std::string kPlaintext = "Small text";
+  const std::string kExpectedCiphertextHex = "78DE5D7C2714FC5C61346C5416F6C89A";
+
+  const std::vector<uint8_t> plaintext(kPlaintext.begin(), kPlaintext.end());
+  std::vector<uint8_t> expected_ciphertext;
+  ASSERT_TRUE(
+      base::HexStringToBytes(kExpectedCiphertextHex, &expected_ciphertext));
+  for (int i = 0; i < 2; ++i) {
+    key_.assign(kKey.begin(), kKey.end());
+    iv_.assign(kIv.begin(), kIv.end());
+    TestEncryptDecrypt(plaintext, expected_ciphertext);
+
+    // Another key in between.
+    key_.assign(kAesKey, kAesKey + arraysize(kAesKey));
+    iv_.assign(kAesIv, kAesIv + arraysize(kAesIv));
+    ASSERT_TRUE(encryptor_->InitializeWithIv(key_, iv_));
+    ASSERT_TRUE(decryptor_->InitializeWithIv(key_, iv_));
+    std::vector<uint8_t> encrypted;
+    ASSERT_TRUE(encryptor_->Crypt(plaintext, &encrypted));
+    EXPECT_NE(expected_ciphertext, encrypted);
+    std::vector<uint8_t> decrypted;
+    ASSERT_TRUE(decryptor_->Crypt(encrypted, &decrypted));
+    EXPECT_EQ(plaintext, decrypted);
+
+    encryptor_.reset(
+        new AesCbcEncryptor(kPkcs5Padding, AesCryptor::kUseConstantIv));
+    decryptor_.reset(
+        new AesCbcDecryptor(kPkcs5Padding, AesCryptor::kUseConstantIv));
+  }
+}
+
 TEST_F(AesCbcTest, NoPaddingNoChainAcrossCalls) {
   const uint8_t kPlaintext[] = {
       0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
@@ -44,8 +44,7 @@ bool AesCbcDecryptor::InitializeWithIv(const std::vector<uint8_t>& key,
     return false;
   }
 
-  CHECK_EQ(AES_set_decrypt_key(key.data(), key.size() * 8, mutable_aes_key()),
-           0);
+  SetKey(key, true /* for_decryption */);
   return SetIv(iv);
 }
 
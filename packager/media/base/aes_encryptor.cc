@@ -8,18 +8,19 @@
 
 #include <openssl/aes.h>
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 
 namespace {
 
-// Increment an 8-byte counter by 1. Return true if overflowed.
-bool Increment64(uint8_t* counter) {
+// Read an 8-byte big endian counter.
+uint64_t ReadUint64(const uint8_t* counter) {
   DCHECK(counter);
-  for (int i = 7; i >= 0; --i) {
-    if (++counter[i] != 0)
-      return false;
-  }
-  return true;
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i)
+    value = (value << 8) | counter[i];
+  return value;
 }
 
 // AES defines three key sizes: 128, 192 and 256 bits.
@@ -43,8 +44,7 @@ bool AesEncryptor::InitializeWithIv(const std::vector<uint8_t>& key,
     return false;
   }
 
-  CHECK_EQ(AES_set_encrypt_key(key.data(), key.size() * 8, mutable_aes_key()),
-           0);
+  SetKey(key, false /* for_decryption */);
   return SetIv(iv);
 }
 
@@ -74,18 +74,37 @@ bool AesCtrEncryptor::CryptInternal(const uint8_t* plaintext,
   }
   *ciphertext_size = plaintext_size;
 
-  for (size_t i = 0; i < plaintext_size; ++i) {
-    if (block_offset_ == 0) {
-      AES_encrypt(&counter_[0], &encrypted_counter_[0], aes_key());
-      // As mentioned in ISO/IEC 23001-7:2016 CENC spec, of the 16 byte counter
-      // block, bytes 8 to 15 (i.e. the least significant bytes) are used as a
-      // simple 64 bit unsigned integer that is incremented by one for each
-      // subsequent block of sample data processed and is kept in network byte
-      // order.
-      Increment64(&counter_[8]);
+  // As mentioned in ISO/IEC 23001-7:2016 CENC spec, of the 16 byte counter
+  // block, bytes 8 to 15 (i.e. the least significant bytes) are used as a
+  // simple 64 bit unsigned integer that is incremented by one for each
+  // subsequent block of sample data processed and is kept in network byte
+  // order. AES_ctr128_encrypt, which uses the hardware AES instructions when
+  // available, increments the whole 128 bit counter instead, so the input is
+  // split where the 64 bit counter wraps around.
+  while (plaintext_size > 0) {
+    size_t crypt_size = plaintext_size;
+    const uint64_t blocks_before_wrap = 0 - ReadUint64(&counter_[8]);
+    const size_t partial_block_size =
+        block_offset_ == 0 ? 0 : AES_BLOCK_SIZE - block_offset_;
+    if (blocks_before_wrap != 0 &&
+        blocks_before_wrap <= plaintext_size / AES_BLOCK_SIZE) {
+      crypt_size = std::min(
+          plaintext_size,
+          partial_block_size +
+              static_cast<size_t>(blocks_before_wrap) * AES_BLOCK_SIZE);
     }
-    ciphertext[i] = plaintext[i] ^ encrypted_counter_[block_offset_];
-    block_offset_ = (block_offset_ + 1) % AES_BLOCK_SIZE;
+
+    uint8_t counter_high[8];
+    memcpy(counter_high, &counter_[0], sizeof(counter_high));
+    unsigned int block_offset = block_offset_;
+    AES_ctr128_encrypt(plaintext, ciphertext, crypt_size, aes_key(),
+                       &counter_[0], &encrypted_counter_[0], &block_offset);
+    block_offset_ = block_offset;
+    memcpy(&counter_[0], counter_high, sizeof(counter_high));
+
+    plaintext += crypt_size;
+    ciphertext += crypt_size;
+    plaintext_size -= crypt_size;
   }
   return true;
 }
@@ -134,7 +153,8 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
                     internal_iv_.data(), AES_ENCRYPT);
   } else if (padding_scheme_ == kCtsPadding) {
     // Don't have a full block, leave unencrypted.
-    memcpy(ciphertext, plaintext, plaintext_size);
+    if (ciphertext != plaintext)
+      memcpy(ciphertext, plaintext, plaintext_size);
     return true;
   }
   if (residual_block_size == 0 && padding_scheme_ != kPkcs5Padding) {
@@ -144,7 +164,10 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
 
   if (padding_scheme_ == kNoPadding) {
     // The residual block is left unencrypted.
-    memcpy(ciphertext + cbc_size, plaintext + cbc_size, residual_block_size);
+    if (ciphertext != plaintext) {
+      memcpy(ciphertext + cbc_size, plaintext + cbc_size,
+             residual_block_size);
+    }
     return true;
   }
 
@@ -12,6 +12,13 @@
 
 namespace shaka {
 namespace media {
+namespace {
+
+// Upper bound of the bytes gathered for a single call to the underlying
+// cryptor, to bound the memory used by |gathered_bytes_|.
+const size_t kMaxGatheredBytes = 64 * 1024;
+
+}  // namespace
 
 AesPatternCryptor::AesPatternCryptor(uint8_t crypt_byte_block,
                                      uint8_t skip_byte_block,
@@ -49,43 +56,78 @@ bool AesPatternCryptor::CryptInternal(const uint8_t* text,
   }
   *crypt_text_size = text_size;
 
-  while (text_size > 0) {
-    const size_t crypt_byte_size = crypt_byte_block_ * AES_BLOCK_SIZE;
-
-    if (text_size <= crypt_byte_size) {
-      const bool need_encrypt =
-          encryption_mode_ != kSkipIfCryptByteBlockRemaining &&
-          text_size >= AES_BLOCK_SIZE;
-      if (need_encrypt) {
-        // The partial pattern SHALL be followed with the partial 16-byte block
-        // remains unencrypted.
-        const size_t aligned_crypt_byte_size =
-            text_size / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
-        if (!cryptor_->Crypt(text, aligned_crypt_byte_size, crypt_text))
-          return false;
-        text += aligned_crypt_byte_size;
-        text_size -= aligned_crypt_byte_size;
-        crypt_text += aligned_crypt_byte_size;
-      }
-
-      // The remaining bytes are not encrypted.
-      memcpy(crypt_text, text, text_size);
-      return true;
+  // Copy the whole input once so the skipped blocks and the trailing partial
+  // block need no further treatment. Nothing to copy if done in place.
+  if (crypt_text != text)
+    memcpy(crypt_text, text, text_size);
+
+  // The underlying cryptor chains the encrypted blocks across the skipped
+  // blocks, so the encrypted blocks of the pattern are gathered and encrypted
+  // in as few calls as possible, which gives the AES hardware instructions
+  // (selected at runtime by BoringSSL) long runs to work on.
+  const size_t crypt_byte_size = crypt_byte_block_ * AES_BLOCK_SIZE;
+  const size_t pattern_size =
+      (crypt_byte_block_ + skip_byte_block_) * AES_BLOCK_SIZE;
+  crypt_ranges_.clear();
+  size_t num_gathered_bytes = 0;
+  for (size_t offset = 0; offset < text_size; offset += pattern_size) {
+    const size_t remaining_size = text_size - offset;
+    size_t size = crypt_byte_size;
+    if (remaining_size <= crypt_byte_size) {
+      // The partial pattern SHALL be followed with the partial 16-byte block
+      // remains unencrypted.
+      if (encryption_mode_ == kSkipIfCryptByteBlockRemaining)
+        break;
+      size = remaining_size / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
     }
 
-    if (!cryptor_->Crypt(text, crypt_byte_size, crypt_text))
-      return false;
-    text += crypt_byte_size;
-    text_size -= crypt_byte_size;
-    crypt_text += crypt_byte_size;
-
-    const size_t skip_byte_size = std::min(
-        static_cast<size_t>(skip_byte_block_ * AES_BLOCK_SIZE), text_size);
-    memcpy(crypt_text, text, skip_byte_size);
-    text += skip_byte_size;
-    text_size -= skip_byte_size;
-    crypt_text += skip_byte_size;
+    if (size == 0) {
+      // Nothing to encrypt in a 0:N pattern.
+      continue;
+    }
+    if (!crypt_ranges_.empty() &&
+        crypt_ranges_.back().first + crypt_ranges_.back().second == offset) {
+      // Contiguous with the previous range, i.e. there is no skip block.
+      crypt_ranges_.back().second += size;
+    } else {
+      crypt_ranges_.push_back(std::make_pair(offset, size));
+    }
+    num_gathered_bytes += size;
+    if (num_gathered_bytes >= kMaxGatheredBytes) {
+      if (!CryptRanges(crypt_text))
+        return false;
+      num_gathered_bytes = 0;
+    }
+  }
+  return CryptRanges(crypt_text);
+}
+
+bool AesPatternCryptor::CryptRanges(uint8_t* crypt_text) {
+  if (crypt_ranges_.empty())
+    return true;
+
+  if (crypt_ranges_.size() == 1) {
+    uint8_t* data = crypt_text + crypt_ranges_.front().first;
+    const size_t size = crypt_ranges_.front().second;
+    crypt_ranges_.clear();
+    return cryptor_->Crypt(data, size, data);
+  }
+
+  gathered_bytes_.clear();
+  for (const std::pair<size_t, size_t>& range : crypt_ranges_) {
+    gathered_bytes_.insert(gathered_bytes_.end(), crypt_text + range.first,
+                           crypt_text + range.first + range.second);
+  }
+  if (!cryptor_->Crypt(gathered_bytes_.data(), gathered_bytes_.size(),
+                       gathered_bytes_.data())) {
+    return false;
+  }
+  const uint8_t* source = gathered_bytes_.data();
+  for (const std::pair<size_t, size_t>& range : crypt_ranges_) {
+    memcpy(crypt_text + range.first, source, range.second);
+    source += range.second;
   }
+  crypt_ranges_.clear();
   return true;
 }
 
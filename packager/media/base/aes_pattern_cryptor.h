@@ -7,6 +7,8 @@
 #include "packager/media/base/aes_cryptor.h"
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "packager/base/macros.h"
 
@@ -68,10 +70,18 @@ class AesPatternCryptor : public AesCryptor {
                      size_t* crypt_text_size) override;
   void SetIvInternal() override;
 
+  // Encrypts the bytes of |crypt_text| in |crypt_ranges_| in place with a
+  // single call to |cryptor_|, and clears |crypt_ranges_|.
+  bool CryptRanges(uint8_t* crypt_text);
+
   uint8_t crypt_byte_block_;
   const uint8_t skip_byte_block_;
   const PatternEncryptionMode encryption_mode_;
   std::unique_ptr<AesCryptor> cryptor_;
+  // (offset, size) of the ranges to be encrypted, and the scratch buffer they
+  // are gathered in. Kept across calls to avoid reallocations.
+  std::vector<std::pair<size_t, size_t>> crypt_ranges_;
+  std::vector<uint8_t> gathered_bytes_;
 
   DISALLOW_COPY_AND_ASSIGN(AesPatternCryptor);
 };
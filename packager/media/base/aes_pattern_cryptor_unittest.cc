@@ -7,13 +7,18 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/aes_pattern_cryptor.h"
 #include "packager/media/base/mock_aes_cryptor.h"
 
 using ::testing::_;
+using ::testing::Combine;
 using ::testing::Invoke;
 using ::testing::Return;
+using ::testing::Values;
 
 namespace {
 const uint8_t kCryptByteBlock = 2u;
@@ -208,5 +213,166 @@ TEST(SampleAesPatternCryptor, MoreThan16Bytes) {
   ASSERT_TRUE(pattern_cryptor.Crypt("0123456789abcdef012", &crypt_text));
 }
 
+namespace {
+
+const size_t kAesBlockSize = 16u;
+const std::vector<uint8_t> kKey(16, 'k');
+const std::vector<uint8_t> kIv(16, 'i');
+
+std::unique_ptr<AesCryptor> CreateCryptor(bool use_cbc) {
+  std::unique_ptr<AesCryptor> cryptor;
+  if (use_cbc)
+    cryptor.reset(new AesCbcEncryptor(kNoPadding));
+  else
+    cryptor.reset(new AesCtrEncryptor);
+  EXPECT_TRUE(cryptor->InitializeWithIv(kKey, kIv));
+  return cryptor;
+}
+
+// Encrypts the pattern one crypt byte block range at a time, which is what
+// AesPatternCryptor used to do. Used to verify AesPatternCryptor with real
+// cryptors and as the baseline of the performance test.
+bool ReferencePatternCrypt(uint8_t crypt_byte_block,
+                           uint8_t skip_byte_block,
+                           AesCryptor* cryptor,
+                           const uint8_t* text,
+                           size_t text_size,
+                           uint8_t* crypt_text) {
+  if (crypt_byte_block == 0 && skip_byte_block == 0)
+    crypt_byte_block = 1;
+  const size_t crypt_byte_size = crypt_byte_block * kAesBlockSize;
+  const size_t skip_byte_size = skip_byte_block * kAesBlockSize;
+  while (text_size > 0) {
+    if (text_size <= crypt_byte_size) {
+      const size_t aligned_size = text_size / kAesBlockSize * kAesBlockSize;
+      if (aligned_size > 0 && !cryptor->Crypt(text, aligned_size, crypt_text))
+        return false;
+      memcpy(crypt_text + aligned_size, text + aligned_size,
+             text_size - aligned_size);
+      return true;
+    }
+    if (!cryptor->Crypt(text, crypt_byte_size, crypt_text))
+      return false;
+    text += crypt_byte_size;
+    crypt_text += crypt_byte_size;
+    text_size -= crypt_byte_size;
+
+    const size_t size = std::min(skip_byte_size, text_size);
+    memcpy(crypt_text, text, size);
+    text += size;
+    crypt_text += size;
+    text_size -= size;
+  }
+  return true;
+}
+
+std::vector<uint8_t> GetTestText(size_t size) {
+  std::vector<uint8_t> text(size);
+  for (size_t i = 0; i < size; ++i)
+    text[i] = static_cast<uint8_t>(i * 7);
+  return text;
+}
+
+}  // namespace
+
+// Parameters: crypt_byte_block, skip_byte_block and whether CBC (otherwise
+// CTR) is used for the encrypted blocks.
+class AesPatternCryptorEncryptionTest
+    : public ::testing::TestWithParam<std::tr1::tuple<uint8_t, uint8_t, bool>> {
+ public:
+  void SetUp() override {
+    crypt_byte_block_ = std::tr1::get<0>(GetParam());
+    skip_byte_block_ = std::tr1::get<1>(GetParam());
+    use_cbc_ = std::tr1::get<2>(GetParam());
+  }
+
+ protected:
+  uint8_t crypt_byte_block_ = 0;
+  uint8_t skip_byte_block_ = 0;
+  bool use_cbc_ = false;
+};
+
+TEST_P(AesPatternCryptorEncryptionTest, SameAsBlockByBlockEncryption) {
+  // The last size is larger than what is gathered in a single call.
+  const size_t kTextSizes[] = {0, 15, 16, 17, 160, 1000, 0x30000 + 7};
+  for (size_t text_size : kTextSizes) {
+    const std::vector<uint8_t> text = GetTestText(text_size);
+
+    std::vector<uint8_t> expected_crypt_text(text_size);
+    std::unique_ptr<AesCryptor> reference_cryptor = CreateCryptor(use_cbc_);
+    ASSERT_TRUE(ReferencePatternCrypt(
+        crypt_byte_block_, skip_byte_block_, reference_cryptor.get(),
+        text.data(), text.size(), expected_crypt_text.data()));
+
+    AesPatternCryptor pattern_cryptor(
+        crypt_byte_block_, skip_byte_block_,
+        AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+        AesCryptor::kDontUseConstantIv, CreateCryptor(use_cbc_));
+    ASSERT_TRUE(pattern_cryptor.SetIv(kIv));
+    std::vector<uint8_t> crypt_text;
+    ASSERT_TRUE(pattern_cryptor.Crypt(text, &crypt_text));
+    EXPECT_EQ(expected_crypt_text, crypt_text) << "size " << text_size;
+
+    // In place.
+    AesPatternCryptor in_place_pattern_cryptor(
+        crypt_byte_block_, skip_byte_block_,
+        AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+        AesCryptor::kDontUseConstantIv, CreateCryptor(use_cbc_));
+    ASSERT_TRUE(in_place_pattern_cryptor.SetIv(kIv));
+    std::vector<uint8_t> buffer = text;
+    ASSERT_TRUE(in_place_pattern_cryptor.Crypt(buffer.data(), buffer.size(),
+                                               buffer.data()));
+    EXPECT_EQ(expected_crypt_text, buffer) << "size " << text_size;
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Patterns,
+                        AesPatternCryptorEncryptionTest,
+                        Combine(Values(0, 1, 5, 10),
+                                Values(0, 1, 5, 9),
+                                Values(true, false)));
+
+class AesPatternCryptorPerformanceTest : public ::testing::Test {
+ public:
+  void SetUp() override { text_ = GetTestText(0x10000); }
+
+ protected:
+  std::vector<uint8_t> text_;
+};
+
+// Compares the pattern cryptor with block-by-block encryption for cbcs 1:9.
+TEST_F(AesPatternCryptorPerformanceTest, Cbcs) {
+  const int kNumIterations = 0x100;
+  const uint8_t kCbcsCryptByteBlock = 1;
+  const uint8_t kCbcsSkipByteBlock = 9;
+  std::vector<uint8_t> crypt_text(text_.size());
+
+  std::unique_ptr<AesCryptor> reference_cryptor = CreateCryptor(true);
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumIterations; ++i) {
+    ASSERT_TRUE(reference_cryptor->SetIv(kIv));
+    ASSERT_TRUE(ReferencePatternCrypt(
+        kCbcsCryptByteBlock, kCbcsSkipByteBlock, reference_cryptor.get(),
+        text_.data(), text_.size(), crypt_text.data()));
+  }
+  const base::TimeDelta reference_time = base::TimeTicks::Now() - start;
+
+  AesPatternCryptor pattern_cryptor(
+      kCbcsCryptByteBlock, kCbcsSkipByteBlock,
+      AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+      AesCryptor::kUseConstantIv, CreateCryptor(true));
+  ASSERT_TRUE(pattern_cryptor.SetIv(kIv));
+  start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumIterations; ++i) {
+    ASSERT_TRUE(pattern_cryptor.Crypt(text_.data(), text_.size(),
+                                      crypt_text.data()));
+  }
+  const base::TimeDelta pattern_time = base::TimeTicks::Now() - start;
+
+  LOG(INFO) << "Block by block: " << reference_time.InMillisecondsF()
+            << " ms, AesPatternCryptor: " << pattern_time.InMillisecondsF()
+            << " ms.";
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -0,0 +1,92 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/async_queue_handler.h"
+
+#include "packager/base/bind.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+
+AsyncQueueHandler::AsyncQueueHandler(size_t queue_size)
+    : queue_(queue_size),
+      thread_("AsyncQueueHandler",
+              base::Bind(&AsyncQueueHandler::DispatchTask,
+                         base::Unretained(this))),
+      flushed_(base::WaitableEvent::ResetPolicy::MANUAL,
+               base::WaitableEvent::InitialState::NOT_SIGNALED) {
+  DCHECK_GT(queue_size, 0u);
+}
+
+AsyncQueueHandler::~AsyncQueueHandler() {
+  queue_.Stop();
+  if (thread_.HasBeenStarted() && !thread_.HasBeenJoined())
+    thread_.Join();
+  StreamData* stream_data = nullptr;
+  while (queue_.TryPop(&stream_data))
+    delete stream_data;
+}
+
+Status AsyncQueueHandler::InitializeInternal() {
+  if (num_input_streams() != 1 || next_output_stream_index() != 1) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Expecting exactly one input and one output.");
+  }
+  thread_.Start();
+  return Status::OK;
+}
+
+Status AsyncQueueHandler::Process(std::unique_ptr<StreamData> stream_data) {
+  RETURN_IF_ERROR(downstream_status());
+  RETURN_IF_ERROR(queue_.Push(stream_data.get(), kInfiniteTimeout));
+  stream_data.release();
+  return Status::OK;
+}
+
+Status AsyncQueueHandler::OnFlushRequest(size_t input_stream_index) {
+  RETURN_IF_ERROR(queue_.Push(nullptr, kInfiniteTimeout));
+  flushed_.Wait();
+  Status status = flush_status_;
+  status.Update(downstream_status());
+  return status;
+}
+
+void AsyncQueueHandler::DispatchTask() {
+  while (true) {
+    StreamData* queued_stream_data = nullptr;
+    if (!queue_.Pop(&queued_stream_data, kInfiniteTimeout).ok())
+      return;
+    std::unique_ptr<StreamData> stream_data(queued_stream_data);
+    if (queue_.Stopped())
+      return;
+
+    if (!stream_data) {
+      flush_status_ = FlushAllDownstreams();
+      flushed_.Signal();
+      return;
+    }
+
+    // Keep draining the queue after an error so Process() does not block.
+    if (!downstream_status().ok())
+      continue;
+
+    // The stream index of the single input and output is the same.
+    Status status = Dispatch(std::move(stream_data));
+    if (!status.ok()) {
+      base::AutoLock scoped_lock(lock_);
+      downstream_status_.Update(status);
+    }
+  }
+}
+
+Status AsyncQueueHandler::downstream_status() {
+  base::AutoLock scoped_lock(lock_);
+  return downstream_status_;
+}
+
+}  // namespace media
+}  // namespace shaka
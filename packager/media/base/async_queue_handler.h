@@ -0,0 +1,61 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_ASYNC_QUEUE_HANDLER_H_
+#define PACKAGER_MEDIA_BASE_ASYNC_QUEUE_HANDLER_H_
+
+#include <memory>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/lock_free_queue.h"
+#include "packager/media/base/media_handler.h"
+
+namespace shaka {
+namespace media {
+
+/// A single input, single output handler which passes the messages through a
+/// bounded queue to a thread of its own, which sends them downstream. Inserted
+/// between two handlers, it lets the upstream and the downstream handlers run
+/// concurrently. Process() blocks when the queue is full, so a slow downstream
+/// handler slows down the upstream handlers.
+class AsyncQueueHandler : public MediaHandler {
+ public:
+  /// @param queue_size is the maximum number of messages queued. It should be
+  ///        positive.
+  explicit AsyncQueueHandler(size_t queue_size);
+  ~AsyncQueueHandler() override;
+
+ private:
+  AsyncQueueHandler(const AsyncQueueHandler&) = delete;
+  AsyncQueueHandler& operator=(const AsyncQueueHandler&) = delete;
+
+  Status InitializeInternal() override;
+  Status Process(std::unique_ptr<StreamData> stream_data) override;
+  Status OnFlushRequest(size_t input_stream_index) override;
+
+  // Sends the queued messages downstream, until a flush or stop.
+  void DispatchTask();
+  Status downstream_status();
+
+  // A null message requests a flush. The messages are owned by the queue
+  // while they are queued: they are released to it by Process() and deleted
+  // by the destructor if they are never dispatched.
+  LockFreeQueue<StreamData*> queue_;
+  ClosureThread thread_;
+  // Signaled after the downstream handler is flushed.
+  base::WaitableEvent flushed_;
+  Status flush_status_;
+  base::Lock lock_;
+  // The first error returned by the downstream handler.
+  Status downstream_status_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_ASYNC_QUEUE_HANDLER_H_
@@ -0,0 +1,100 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/async_queue_handler.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+using ::testing::InSequence;
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kStreamIndex = 0;
+const size_t kInputs = 1;
+const size_t kOutputs = 1;
+const size_t kInput = 0;
+const size_t kOutput = 0;
+const size_t kQueueSize = 2;
+const uint32_t kTimeScale = 1000;
+const int64_t kDuration = 100;
+const bool kKeyFrame = true;
+const bool kEncrypted = true;
+const int kNumSamples = 20;
+
+// Fails to process all the samples after the first one.
+class FailingOutputHandler : public MediaHandler {
+ private:
+  Status InitializeInternal() override { return Status::OK; }
+  Status Process(std::unique_ptr<StreamData> stream_data) override {
+    if (stream_data->stream_data_type == StreamDataType::kMediaSample &&
+        num_samples_++ > 0) {
+      return Status(error::MUXER_FAILURE, "Failed.");
+    }
+    return Status::OK;
+  }
+
+  int num_samples_ = 0;
+};
+
+}  // namespace
+
+class AsyncQueueHandlerTest : public MediaHandlerTestBase {};
+
+TEST_F(AsyncQueueHandlerTest, PassesAllMessagesInOrder) {
+  ASSERT_OK(SetUpAndInitializeGraph(
+      std::make_shared<AsyncQueueHandler>(kQueueSize), kInputs, kOutputs));
+
+  {
+    InSequence s;
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsStreamInfo(kStreamIndex, kTimeScale, !kEncrypted,
+                                       _)));
+    for (int i = 0; i < kNumSamples; ++i) {
+      EXPECT_CALL(*Output(kOutput),
+                  OnProcess(IsMediaSample(kStreamIndex, i * kDuration,
+                                          kDuration, !kEncrypted, kKeyFrame)));
+    }
+    EXPECT_CALL(*Output(kOutput), OnFlush(kStreamIndex));
+  }
+
+  ASSERT_OK(Input(kInput)->Dispatch(
+      StreamData::FromStreamInfo(kStreamIndex, GetAudioStreamInfo(kTimeScale))));
+  for (int i = 0; i < kNumSamples; ++i) {
+    ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, kKeyFrame))));
+  }
+  // Returns after the output is flushed.
+  ASSERT_OK(Input(kInput)->FlushAllDownstreams());
+}
+
+TEST_F(AsyncQueueHandlerTest, ReturnsDownstreamError) {
+  auto input = std::make_shared<FakeInputMediaHandler>();
+  ASSERT_OK(MediaHandler::Chain({input,
+                                 std::make_shared<AsyncQueueHandler>(kQueueSize),
+                                 std::make_shared<FailingOutputHandler>()}));
+  ASSERT_OK(input->Initialize());
+
+  Status status;
+  // The error is returned by a later call, after the failed sample has been
+  // dispatched downstream.
+  for (int i = 0; i < kNumSamples && status.ok(); ++i) {
+    status = input->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, kKeyFrame)));
+  }
+  if (status.ok())
+    status = input->FlushAllDownstreams();
+  EXPECT_EQ(error::MUXER_FAILURE, status.error_code());
+}
+
+}  // namespace media
+}  // namespace shaka
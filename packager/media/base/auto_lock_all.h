@@ -0,0 +1,43 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_AUTO_LOCK_ALL_H_
+#define PACKAGER_MEDIA_BASE_AUTO_LOCK_ALL_H_
+
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace media {
+
+/// Like base::AutoLock, but for a group of locks, e.g. the locks of all the
+/// streams of a manifest. The locks are acquired in the given order and
+/// released in the reverse order; all the users of a group of locks must use
+/// the same order to avoid deadlocks.
+class AutoLockAll {
+ public:
+  explicit AutoLockAll(const std::vector<base::Lock*>& locks) : locks_(locks) {
+    for (base::Lock* lock : locks_)
+      lock->Acquire();
+  }
+
+  ~AutoLockAll() {
+    for (auto it = locks_.rbegin(); it != locks_.rend(); ++it)
+      (*it)->Release();
+  }
+
+ private:
+  const std::vector<base::Lock*> locks_;
+
+  DISALLOW_COPY_AND_ASSIGN(AutoLockAll);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_AUTO_LOCK_ALL_H_
@@ -4,109 +4,135 @@
 
 #include "packager/media/base/bit_reader.h"
 
-#include <algorithm>
+#include <string.h>
+
+#include "packager/base/sys_byteorder.h"
 
 namespace shaka {
 namespace media {
+namespace {
+// The largest read served from the cache in one go. RefillCache() keeps at
+// least this many bits cached as long as the stream has them.
+const size_t kMaxCachedRead = 56;
+}  // namespace
 
 BitReader::BitReader(const uint8_t* data, size_t size)
-    : data_(data),
+    : initial_data_(data),
       initial_size_(size),
+      data_(data),
       bytes_left_(size),
-      num_remaining_bits_in_curr_byte_(0) {
+      cache_(0),
+      num_cached_bits_(0) {
   DCHECK(data_ != NULL && bytes_left_ > 0);
-
-  UpdateCurrByte();
 }
 
 BitReader::~BitReader() {}
 
 bool BitReader::SkipBits(size_t num_bits) {
-  // Skip any bits in the current byte waiting to be processed, then
-  // process full bytes until less than 8 bits remaining.
-  if (num_bits > num_remaining_bits_in_curr_byte_) {
-    num_bits -= num_remaining_bits_in_curr_byte_;
-    num_remaining_bits_in_curr_byte_ = 0;
-
-    size_t num_bytes = num_bits / 8;
-    num_bits %= 8;
-    if (bytes_left_ < num_bytes) {
-      bytes_left_ = 0;
-      return false;
-    }
-    bytes_left_ -= num_bytes;
-    data_ += num_bytes;
-    UpdateCurrByte();
-
-    // If there is no more data remaining, only return true if we
-    // skipped all that were requested.
-    if (num_remaining_bits_in_curr_byte_ == 0)
-      return (num_bits == 0);
+  if (num_bits > bits_available()) {
+    SetEndOfStream();
+    return false;
+  }
+  if (num_bits <= num_cached_bits_) {
+    ConsumeCachedBits(num_bits);
+    return true;
   }
 
-  // Less than 8 bits remaining to skip. Use ReadBitsInternal to verify
-  // that the remaining bits we need exist, and adjust them as necessary
-  // for subsequent operations.
-  uint64_t not_needed;
-  return ReadBitsInternal(num_bits, &not_needed);
+  // Drop the cache, then skip the whole bytes directly in the stream.
+  num_bits -= num_cached_bits_;
+  cache_ = 0;
+  num_cached_bits_ = 0;
+  const size_t num_bytes = num_bits / 8;
+  data_ += num_bytes;
+  bytes_left_ -= num_bytes;
+  num_bits %= 8;
+  if (num_bits > 0) {
+    RefillCache();
+    ConsumeCachedBits(num_bits);
+  }
+  return true;
 }
 
 void BitReader::SkipToNextByte() {
-  // Already aligned.
-  if (num_remaining_bits_in_curr_byte_ == 8)
-    return;
-
-  num_remaining_bits_in_curr_byte_ = 0;
-  UpdateCurrByte();
+  // |cache_| always ends at a byte boundary of the stream.
+  ConsumeCachedBits(num_cached_bits_ % 8);
 }
 
 bool BitReader::SkipBytes(size_t num_bytes) {
   if (num_bytes == 0)
     return true;
-  if (num_remaining_bits_in_curr_byte_ != 8)
+  if (num_cached_bits_ % 8 != 0)
     return false;
-
-  data_ += num_bytes - 1;  // One additional byte in curr_byte_.
-  if (num_bytes > bytes_left_ + 1)
+  if (num_bytes > bits_available() / 8)
     return false;
-  bytes_left_ -= num_bytes - 1;
-  num_remaining_bits_in_curr_byte_ = 0;
-  UpdateCurrByte();
-  return true;
+  return SkipBits(num_bytes * 8);
 }
 
 bool BitReader::ReadBitsInternal(size_t num_bits, uint64_t* out) {
   DCHECK_LE(num_bits, 64u);
 
-  *out = 0;
-
-  while (num_remaining_bits_in_curr_byte_ != 0 && num_bits != 0) {
-    size_t bits_to_take = std::min(num_remaining_bits_in_curr_byte_, num_bits);
-
-    *out <<= bits_to_take;
-    *out += curr_byte_ >> (num_remaining_bits_in_curr_byte_ - bits_to_take);
-    num_bits -= bits_to_take;
-    num_remaining_bits_in_curr_byte_ -= bits_to_take;
-    curr_byte_ &= (1 << num_remaining_bits_in_curr_byte_) - 1;
-
-    if (num_remaining_bits_in_curr_byte_ == 0)
-      UpdateCurrByte();
+  if (num_bits > bits_available()) {
+    *out = 0;
+    SetEndOfStream();
+    return false;
+  }
+  if (num_bits == 0) {
+    *out = 0;
+    return true;
+  }
+  if (num_bits > kMaxCachedRead) {
+    // Read the high part, then the low 32 bits. Both succeed as the stream
+    // has enough bits.
+    uint64_t high = 0;
+    uint64_t low = 0;
+    ReadBitsInternal(num_bits - 32, &high);
+    ReadBitsInternal(32, &low);
+    *out = (high << 32) | low;
+    return true;
   }
 
-  return num_bits == 0;
+  if (num_cached_bits_ < num_bits)
+    RefillCache();
+  DCHECK_GE(num_cached_bits_, num_bits);
+  *out = cache_ >> (64 - num_bits);
+  ConsumeCachedBits(num_bits);
+  return true;
 }
 
-void BitReader::UpdateCurrByte() {
-  DCHECK_EQ(num_remaining_bits_in_curr_byte_, 0u);
-
-  if (bytes_left_ == 0)
+void BitReader::RefillCache() {
+  if (bytes_left_ >= sizeof(uint64_t)) {
+    // Load the next word and keep as many whole bytes as fit. The extra bits
+    // below them are the bits which follow in the stream, so they are
+    // overwritten with the same values by the next refill.
+    uint64_t word;
+    memcpy(&word, data_, sizeof(word));
+    cache_ |= base::NetToHost64(word) >> num_cached_bits_;
+    const size_t num_bytes = (64 - num_cached_bits_) / 8;
+    data_ += num_bytes;
+    bytes_left_ -= num_bytes;
+    num_cached_bits_ += num_bytes * 8;
     return;
+  }
+  // Close to the end of the stream.
+  while (num_cached_bits_ <= kMaxCachedRead && bytes_left_ > 0) {
+    cache_ |= static_cast<uint64_t>(*data_) << (56 - num_cached_bits_);
+    ++data_;
+    --bytes_left_;
+    num_cached_bits_ += 8;
+  }
+}
+
+void BitReader::ConsumeCachedBits(size_t num_bits) {
+  DCHECK_LE(num_bits, num_cached_bits_);
+  cache_ = num_bits < 64 ? cache_ << num_bits : 0;
+  num_cached_bits_ -= num_bits;
+}
 
-  // Load a new byte and advance pointers.
-  curr_byte_ = *data_;
-  ++data_;
-  --bytes_left_;
-  num_remaining_bits_in_curr_byte_ = 8;
+void BitReader::SetEndOfStream() {
+  data_ += bytes_left_;
+  bytes_left_ = 0;
+  cache_ = 0;
+  num_cached_bits_ = 0;
 }
 
 }  // namespace media
@@ -8,12 +8,15 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 
 namespace shaka {
 namespace media {
 
-/// A class to read bit streams.
+/// A class to read bit streams. The bits are read through a 64-bit cache,
+/// refilled a word at a time.
 class BitReader {
  public:
   /// Initialize the BitReader object to read a data buffer.
@@ -86,40 +89,51 @@ class BitReader {
   bool SkipBytes(size_t num_bytes);
 
   /// @return The number of bits available for reading.
-  size_t bits_available() const {
-    return 8 * bytes_left_ + num_remaining_bits_in_curr_byte_;
-  }
+  size_t bits_available() const { return 8 * bytes_left_ + num_cached_bits_; }
 
   /// @return The current bit position.
   size_t bit_position() const { return 8 * initial_size_ - bits_available(); }
 
-  /// @return A pointer to the current byte.
-  const uint8_t* current_byte_ptr() const { return data_ - 1; }
+  /// @return A pointer to the current byte, i.e. the byte of the next bit to
+  ///         read, or the last byte at the end of the stream.
+  const uint8_t* current_byte_ptr() const {
+    return initial_data_ + std::min(bit_position() / 8, initial_size_ - 1);
+  }
 
  private:
   // Help function used by ReadBits to avoid inlining the bit reading logic.
   bool ReadBitsInternal(size_t num_bits, uint64_t* out);
 
-  // Advance to the next byte, loading it into curr_byte_.
-  // If the num_remaining_bits_in_curr_byte_ is 0 after this function returns,
-  // the stream has reached the end.
-  void UpdateCurrByte();
+  // Load bytes into the cache so that it holds at least 57 bits, or all the
+  // bits left in the stream.
+  void RefillCache();
 
-  // Pointer to the next unread (not in curr_byte_) byte in the stream.
-  const uint8_t* data_;
+  // Drop |num_bits| from the cache. |num_bits| should not be larger than
+  // |num_cached_bits_|.
+  void ConsumeCachedBits(size_t num_bits);
+
+  // Enter the state where further reads fail, after a read beyond the end.
+  void SetEndOfStream();
+
+  // Beginning of the input data.
+  const uint8_t* initial_data_;
 
   // Initial size of the input data.
   size_t initial_size_;
 
-  // Bytes left in the stream (without the curr_byte_).
+  // Pointer to the next byte in the stream which is not in |cache_|.
+  const uint8_t* data_;
+
+  // Bytes left in the stream (without the bytes in |cache_|).
   size_t bytes_left_;
 
-  // Contents of the current byte; first unread bit starting at position
-  // 8 - num_remaining_bits_in_curr_byte_ from MSB.
-  uint8_t curr_byte_;
+  // The cached bits, first unread bit at the MSB. The bits below the
+  // |num_cached_bits_| cached bits, if any, are the bits which follow in the
+  // stream, which lets RefillCache() load a whole word without masking.
+  uint64_t cache_;
 
-  // Number of bits remaining in curr_byte_
-  size_t num_remaining_bits_in_curr_byte_;
+  // Number of bits in |cache_|.
+  size_t num_cached_bits_;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(BitReader);
@@ -114,5 +114,42 @@ TEST(BitReaderTest, SkipToNextByteTestUnaligned) {
   EXPECT_EQ(8u, reader.bit_position());
 }
 
+TEST(BitReaderTest, ReadAcrossCacheRefills) {
+  uint8_t buffer[61];
+  for (size_t i = 0; i < sizeof(buffer); ++i)
+    buffer[i] = static_cast<uint8_t>(i * 37 + 11);
+  const size_t kNumBits = sizeof(buffer) * 8;
+
+  // Reads of every size from 1 to 64 bits, compared to the bits read one at a
+  // time.
+  BitReader reader(buffer, sizeof(buffer));
+  size_t position = 0;
+  for (size_t num_bits = 1; position + num_bits <= kNumBits;
+       num_bits = num_bits % 64 + 1) {
+    uint64_t expected = 0;
+    for (size_t i = position; i < position + num_bits; ++i)
+      expected = (expected << 1) | ((buffer[i / 8] >> (7 - i % 8)) & 1);
+    uint64_t value = 0;
+    ASSERT_TRUE(reader.ReadBits(num_bits, &value));
+    EXPECT_EQ(expected, value) << "at bit " << position;
+    position += num_bits;
+    EXPECT_EQ(position, reader.bit_position());
+  }
+  EXPECT_EQ(kNumBits - position, reader.bits_available());
+}
+
+TEST(BitReaderTest, CurrentBytePtr) {
+  uint8_t buffer[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  BitReader reader(buffer, sizeof(buffer));
+  EXPECT_EQ(buffer, reader.current_byte_ptr());
+  EXPECT_TRUE(reader.SkipBits(12));
+  EXPECT_EQ(buffer + 1, reader.current_byte_ptr());
+  EXPECT_TRUE(reader.SkipBits(76));
+  EXPECT_EQ(buffer + 11, reader.current_byte_ptr());
+  EXPECT_TRUE(reader.SkipBits(8));
+  // The last byte at the end of the stream.
+  EXPECT_EQ(buffer + 11, reader.current_byte_ptr());
+}
+
 }  // namespace media
 }  // namespace shaka
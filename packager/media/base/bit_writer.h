@@ -32,22 +32,26 @@ class BitWriter {
   ///        be zero.
   void WriteBits(uint32_t bits, size_t number_of_bits);
 
-  /// Write pending bits, and align bitstream with extra zero bits.
+  /// Write pending bits, and align bitstream with extra zero bits. The bits
+  /// are buffered until then, so @a storage is only complete after Flush().
   void Flush();
 
   /// @return last written position, in bits.
-  size_t BitPos() const { return BytePos() * 8 + num_bits_; }
+  size_t BitPos() const {
+    return (storage_->size() - initial_storage_size_) * 8 + num_bits_;
+  }
 
   /// @return last written position, in bytes.
-  size_t BytePos() const { return storage_->size() - initial_storage_size_; }
+  size_t BytePos() const { return BitPos() / 8; }
 
  private:
   BitWriter(const BitWriter&) = delete;
   BitWriter& operator=(const BitWriter&) = delete;
 
-  // Accumulator for unwritten bits.
+  // Accumulator for unwritten bits, first bit at the MSB. The bits are written
+  // to |storage_| 32 at a time.
   uint64_t bits_ = 0;
-  // Number of unwritten bits.
+  // Number of unwritten bits, less than 32 between the calls.
   int num_bits_ = 0;
   // Buffer contains the written bits.
   std::vector<uint8_t>* const storage_ = nullptr;
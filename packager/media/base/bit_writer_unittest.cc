@@ -58,5 +58,20 @@ TEST(BitWriterTest, Test) {
                                          0x00, 0x00, 0x98}));
 }
 
+TEST(BitWriterTest, ManyWrites) {
+  std::vector<uint8_t> storage = {0xff};
+  BitWriter writer(&storage);
+  for (int i = 0; i < 16; ++i)
+    writer.WriteBits(0x5, 3);
+  writer.WriteBits(0xabcdef, 24);
+  EXPECT_EQ(72u, writer.BitPos());
+  EXPECT_EQ(9u, writer.BytePos());
+  writer.Flush();
+  EXPECT_EQ(72u, writer.BitPos());
+
+  EXPECT_THAT(storage, ElementsAreArray({0xff, 0xb6, 0xdb, 0x6d, 0xb6, 0xdb,
+                                         0x6d, 0xab, 0xcd, 0xef}));
+}
+
 }  // namespace media
 }  // namespace shaka
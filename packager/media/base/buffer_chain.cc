@@ -0,0 +1,64 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/buffer_chain.h"
+
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/file/file.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+
+BufferChain::BufferChain() {}
+
+BufferChain::~BufferChain() {}
+
+void BufferChain::AppendBuffer(std::unique_ptr<BufferWriter> buffer) {
+  DCHECK(buffer);
+  if (buffer->Size() == 0)
+    return;
+  size_ += buffer->Size();
+  buffers_.push_back(std::move(buffer));
+}
+
+void BufferChain::PrependBuffer(std::unique_ptr<BufferWriter> buffer) {
+  DCHECK(buffer);
+  if (buffer->Size() == 0)
+    return;
+  size_ += buffer->Size();
+  buffers_.push_front(std::move(buffer));
+}
+
+void BufferChain::Clear() {
+  buffers_.clear();
+  size_ = 0;
+}
+
+Status BufferChain::WriteToFile(File* file) {
+  DCHECK(file);
+  DCHECK(!buffers_.empty());
+  VLOG(1) << "BufferChain::WriteToFile " << file->file_name() << " with "
+          << size_ << " octets in " << buffers_.size() << " buffers";
+
+  std::vector<IoVec> iov;
+  iov.reserve(buffers_.size());
+  for (const std::unique_ptr<BufferWriter>& buffer : buffers_)
+    iov.push_back({buffer->Buffer(), buffer->Size()});
+
+  const int64_t size_written = file->WriteV(iov.data(), iov.size());
+  if (size_written < 0 || static_cast<size_t>(size_written) != size_) {
+    return Status(error::FILE_FAILURE,
+                  "Fail to write to file in BufferChain");
+  }
+  Clear();
+  return Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,56 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_BUFFER_CHAIN_H_
+#define PACKAGER_MEDIA_BASE_BUFFER_CHAIN_H_
+
+#include <deque>
+#include <memory>
+
+#include "packager/base/macros.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+class File;
+
+namespace media {
+
+class BufferWriter;
+
+/// An ordered list of buffers which are written to a file with a single
+/// scatter-gather File::WriteV() call, so the buffers do not need to be
+/// copied into one contiguous buffer first.
+class BufferChain {
+ public:
+  BufferChain();
+  ~BufferChain();
+
+  /// Append @a buffer to the end of the chain. Empty buffers are dropped.
+  void AppendBuffer(std::unique_ptr<BufferWriter> buffer);
+  /// Insert @a buffer at the beginning of the chain. Empty buffers are
+  /// dropped.
+  void PrependBuffer(std::unique_ptr<BufferWriter> buffer);
+
+  void Clear();
+  /// @return The total size of the buffers in the chain.
+  size_t Size() const { return size_; }
+
+  /// Write all the buffers in the chain to @a file and clear the chain.
+  /// @return OK on success.
+  Status WriteToFile(File* file);
+
+ private:
+  std::deque<std::unique_ptr<BufferWriter>> buffers_;
+  size_t size_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferChain);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_BUFFER_CHAIN_H_
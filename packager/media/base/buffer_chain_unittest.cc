@@ -0,0 +1,60 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/buffer_chain.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kOutputFile[] = "memory://output";
+const uint8_t kData1[] = {0x01, 0x02, 0x03};
+const uint8_t kData2[] = {0x04, 0x05};
+const uint8_t kData3[] = {0x06};
+
+std::unique_ptr<BufferWriter> CreateBuffer(const uint8_t* data, size_t size) {
+  std::unique_ptr<BufferWriter> buffer(new BufferWriter);
+  buffer->AppendArray(data, size);
+  return buffer;
+}
+
+}  // namespace
+
+TEST(BufferChainTest, WriteToFile) {
+  BufferChain chain;
+  chain.AppendBuffer(CreateBuffer(kData2, sizeof(kData2)));
+  chain.AppendBuffer(CreateBuffer(kData3, sizeof(kData3)));
+  chain.AppendBuffer(std::unique_ptr<BufferWriter>(new BufferWriter));
+  chain.PrependBuffer(CreateBuffer(kData1, sizeof(kData1)));
+  EXPECT_EQ(sizeof(kData1) + sizeof(kData2) + sizeof(kData3), chain.Size());
+
+  std::unique_ptr<File, FileCloser> file(File::Open(kOutputFile, "w"));
+  ASSERT_TRUE(file);
+  ASSERT_OK(chain.WriteToFile(file.get()));
+  EXPECT_EQ(0u, chain.Size());
+
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(kOutputFile, &contents));
+  const std::string kExpectedContents = "\x01\x02\x03\x04\x05\x06";
+  EXPECT_EQ(kExpectedContents, contents);
+}
+
+TEST(BufferChainTest, Clear) {
+  BufferChain chain;
+  chain.AppendBuffer(CreateBuffer(kData1, sizeof(kData1)));
+  chain.Clear();
+  EXPECT_EQ(0u, chain.Size());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -19,24 +19,6 @@ bool BufferReader::Read1(uint8_t* v) {
   return true;
 }
 
-bool BufferReader::Read2(uint16_t* v) {
-  return Read(v);
-}
-bool BufferReader::Read2s(int16_t* v) {
-  return Read(v);
-}
-bool BufferReader::Read4(uint32_t* v) {
-  return Read(v);
-}
-bool BufferReader::Read4s(int32_t* v) {
-  return Read(v);
-}
-bool BufferReader::Read8(uint64_t* v) {
-  return Read(v);
-}
-bool BufferReader::Read8s(int64_t* v) {
-  return Read(v);
-}
 bool BufferReader::ReadNBytesInto8(uint64_t* v, size_t num_bytes) {
   return ReadNBytes(v, num_bytes);
 }
@@ -81,11 +63,6 @@ bool BufferReader::SkipBytes(size_t num_bytes) {
   return true;
 }
 
-template <typename T>
-bool BufferReader::Read(T* v) {
-  return ReadNBytes(v, sizeof(*v));
-}
-
 template <typename T>
 bool BufferReader::ReadNBytes(T* v, size_t num_bytes) {
   DCHECK(v != NULL);
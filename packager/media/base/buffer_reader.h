@@ -8,12 +8,15 @@
 #define PACKAGER_MEDIA_BASE_BUFFER_READER_H_
 
 #include <stdint.h>
+#include <string.h>
 
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
 #include "packager/base/macros.h"
+#include "packager/base/sys_byteorder.h"
 
 namespace shaka {
 namespace media {
@@ -32,7 +35,9 @@ class BufferReader {
   bool HasBytes(size_t count) { return pos() + count <= size(); }
 
   /// Read a value from the stream, performing endian correction, and advance
-  /// the stream pointer.
+  /// the stream pointer. They are inline, with a single bounds check and load
+  /// for the size known at compile time, since the boxes are parsed a field at
+  /// a time.
   /// @return false if there are not enough bytes in the buffer.
   /// @{
   bool Read1(uint8_t* v) WARN_UNUSED_RESULT;
@@ -72,6 +77,9 @@ class BufferReader {
   // Internal implementation of multi-byte reads.
   template <typename T>
   bool Read(T* t) WARN_UNUSED_RESULT;
+  static uint16_t NetToHost(uint16_t v) { return base::NetToHost16(v); }
+  static uint32_t NetToHost(uint32_t v) { return base::NetToHost32(v); }
+  static uint64_t NetToHost(uint64_t v) { return base::NetToHost64(v); }
   template <typename T>
   bool ReadNBytes(T* t, size_t num_bytes) WARN_UNUSED_RESULT;
 
@@ -82,6 +90,37 @@ class BufferReader {
   DISALLOW_COPY_AND_ASSIGN(BufferReader);
 };
 
+inline bool BufferReader::Read2(uint16_t* v) {
+  return Read(v);
+}
+inline bool BufferReader::Read2s(int16_t* v) {
+  return Read(v);
+}
+inline bool BufferReader::Read4(uint32_t* v) {
+  return Read(v);
+}
+inline bool BufferReader::Read4s(int32_t* v) {
+  return Read(v);
+}
+inline bool BufferReader::Read8(uint64_t* v) {
+  return Read(v);
+}
+inline bool BufferReader::Read8s(int64_t* v) {
+  return Read(v);
+}
+
+template <typename T>
+bool BufferReader::Read(T* v) {
+  typedef typename std::make_unsigned<T>::type UnsignedT;
+  if (!HasBytes(sizeof(*v)))
+    return false;
+  UnsignedT value;
+  memcpy(&value, buf_ + pos_, sizeof(value));
+  pos_ += sizeof(value);
+  *v = static_cast<T>(NetToHost(value));
+  return true;
+}
+
 }  // namespace media
 }  // namespace shaka
 
@@ -6,6 +6,8 @@
 
 #include "packager/media/base/buffer_writer.h"
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/base/sys_byteorder.h"
 #include "packager/file/file.h"
@@ -22,28 +24,6 @@ BufferWriter::BufferWriter(size_t reserved_size_in_bytes) {
 }
 BufferWriter::~BufferWriter() {}
 
-void BufferWriter::AppendInt(uint8_t v) {
-  buf_.push_back(v);
-}
-void BufferWriter::AppendInt(uint16_t v) {
-  AppendInternal(base::HostToNet16(v));
-}
-void BufferWriter::AppendInt(uint32_t v) {
-  AppendInternal(base::HostToNet32(v));
-}
-void BufferWriter::AppendInt(uint64_t v) {
-  AppendInternal(base::HostToNet64(v));
-}
-void BufferWriter::AppendInt(int16_t v) {
-  AppendInternal(base::HostToNet16(v));
-}
-void BufferWriter::AppendInt(int32_t v) {
-  AppendInternal(base::HostToNet32(v));
-}
-void BufferWriter::AppendInt(int64_t v) {
-  AppendInternal(base::HostToNet64(v));
-}
-
 void BufferWriter::AppendNBytes(uint64_t v, size_t num_bytes) {
   DCHECK_GE(sizeof(v), num_bytes);
   v = base::HostToNet64(v);
@@ -67,6 +47,20 @@ void BufferWriter::AppendBuffer(const BufferWriter& buffer) {
   buf_.insert(buf_.end(), buffer.buf_.begin(), buffer.buf_.end());
 }
 
+uint8_t* BufferWriter::Extend(size_t num_bytes) {
+  const size_t size = buf_.size();
+  buf_.resize(size + num_bytes);
+  return buf_.data() + size;
+}
+
+void BufferWriter::Reserve(size_t num_bytes) {
+  const size_t required_capacity = buf_.size() + num_bytes;
+  if (required_capacity <= buf_.capacity())
+    return;
+  // Keep the growth geometric, for the many small reservations in a row.
+  buf_.reserve(std::max(required_capacity, buf_.capacity() * 2));
+}
+
 Status BufferWriter::WriteToFile(File* file) {
   DCHECK(file);
   DCHECK(!buf_.empty());
@@ -86,10 +80,5 @@ Status BufferWriter::WriteToFile(File* file) {
   return Status::OK;
 }
 
-template <typename T>
-void BufferWriter::AppendInternal(T v) {
-  AppendArray(reinterpret_cast<uint8_t*>(&v), sizeof(T));
-}
-
 }  // namespace media
 }  // namespace shaka
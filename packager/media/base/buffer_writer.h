@@ -7,9 +7,13 @@
 #ifndef PACKAGER_MEDIA_BASE_BUFFER_WRITER_H_
 #define PACKAGER_MEDIA_BASE_BUFFER_WRITER_H_
 
+#include <stdint.h>
+
+#include <string>
 #include <vector>
 
 #include "packager/base/macros.h"
+#include "packager/base/sys_byteorder.h"
 #include "packager/status.h"
 
 namespace shaka {
@@ -32,14 +36,16 @@ class BufferWriter {
 
   /// These convenience functions append the integers (in network byte order,
   /// i.e. big endian) of various size and signedness to the end of the buffer.
+  /// They are inline, with the size known at compile time, since the boxes
+  /// are written a field at a time.
   /// @{
-  void AppendInt(uint8_t v);
-  void AppendInt(uint16_t v);
-  void AppendInt(uint32_t v);
-  void AppendInt(uint64_t v);
-  void AppendInt(int16_t v);
-  void AppendInt(int32_t v);
-  void AppendInt(int64_t v);
+  void AppendInt(uint8_t v) { buf_.push_back(v); }
+  void AppendInt(uint16_t v) { AppendInternal(base::HostToNet16(v)); }
+  void AppendInt(uint32_t v) { AppendInternal(base::HostToNet32(v)); }
+  void AppendInt(uint64_t v) { AppendInternal(base::HostToNet64(v)); }
+  void AppendInt(int16_t v) { AppendInternal(base::HostToNet16(v)); }
+  void AppendInt(int32_t v) { AppendInternal(base::HostToNet32(v)); }
+  void AppendInt(int64_t v) { AppendInternal(base::HostToNet64(v)); }
   /// @}
 
   /// Append the least significant @a num_bytes of @a v to buffer.
@@ -55,6 +61,16 @@ class BufferWriter {
   void Swap(BufferWriter* buffer) { buf_.swap(buffer->buf_); }
   void SwapBuffer(std::vector<uint8_t>* buffer) { buf_.swap(*buffer); }
 
+  /// Grow the buffer by @a num_bytes, which are then written directly through
+  /// the returned pointer, e.g. for fixed size packets.
+  /// @return a pointer to the new bytes, valid until the next modification of
+  ///         the buffer.
+  uint8_t* Extend(size_t num_bytes);
+
+  /// Reserve room for @a num_bytes more bytes, e.g. before writing a box of
+  /// known size, so the appends that follow do not reallocate the buffer.
+  void Reserve(size_t num_bytes);
+
   void Clear() { buf_.clear(); }
   size_t Size() const { return buf_.size(); }
   /// @return Underlying buffer. Behavior is undefined if the buffer size is 0.
@@ -67,9 +83,12 @@ class BufferWriter {
   Status WriteToFile(File* file);
 
  private:
-  // Internal implementation of multi-byte write.
+  // Internal implementation of multi-byte write. |v| is in network byte order.
   template <typename T>
-  void AppendInternal(T v);
+  void AppendInternal(T v) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&v);
+    buf_.insert(buf_.end(), data, data + sizeof(v));
+  }
 
   std::vector<uint8_t> buf_;
 
@@ -170,6 +170,28 @@ TEST_F(BufferWriterTest, Clear) {
   ASSERT_EQ(0u, writer_->Size());
 }
 
+TEST_F(BufferWriterTest, Reserve) {
+  BufferWriter writer(0);
+  writer.AppendInt(kuint8);
+  writer.Reserve(4 * sizeof(kuint64));
+  const uint8_t* buffer = writer.Buffer();
+  for (int i = 0; i < 4; ++i)
+    writer.AppendInt(kuint64);
+  // Not reallocated.
+  EXPECT_EQ(buffer, writer.Buffer());
+  EXPECT_EQ(1 + 4 * sizeof(kuint64), writer.Size());
+}
+
+TEST_F(BufferWriterTest, Extend) {
+  writer_->AppendInt(kuint16);
+  uint8_t* data = writer_->Extend(2);
+  data[0] = 0x12;
+  data[1] = 0x34;
+  EXPECT_EQ(sizeof(kuint16) + 2, writer_->Size());
+  EXPECT_EQ(0x12, writer_->Buffer()[2]);
+  EXPECT_EQ(0x34, writer_->Buffer()[3]);
+}
+
 TEST_F(BufferWriterTest, WriteToFile) {
   base::FilePath path;
   ASSERT_TRUE(base::CreateTemporaryFile(&path));
@@ -26,33 +26,29 @@ void ByteQueue::Reset() {
   used_ = 0;
 }
 
+void ByteQueue::Reserve(int size) {
+  DCHECK_GE(size, 0);
+  if (static_cast<size_t>(size) > size_)
+    Grow(size);
+}
+
 void ByteQueue::Push(const uint8_t* data, int size) {
   DCHECK(data);
 
   size_t size_needed = used_ + size;
 
-  // Check to see if we need a bigger buffer.
-  if (size_needed > size_) {
-    size_t new_size = 2 * size_;
-    while (size_needed > new_size && new_size > size_)
-      new_size *= 2;
-
-    // Sanity check to make sure we didn't overflow.
-    CHECK_GT(new_size, size_);
-
-    std::unique_ptr<uint8_t[]> new_buffer(new uint8_t[new_size]);
-
-    // Copy the data from the old buffer to the start of the new one.
-    if (used_ > 0)
-      memcpy(new_buffer.get(), front(), used_);
-
-    buffer_.reset(new_buffer.release());
-    size_ = new_size;
-    offset_ = 0;
-  } else if ((offset_ + used_ + size) > size_) {
-    // The buffer is big enough, but we need to move the data in the queue.
-    memmove(buffer_.get(), front(), used_);
-    offset_ = 0;
+  if (offset_ + size_needed > size_) {
+    // Move the queued bytes to the start of the buffer only if they are no
+    // more than the popped bytes before them, so that each byte pushed is
+    // moved at most once on average. Otherwise, e.g. when most of a large box
+    // is still queued, moving the bytes again on every push would copy the
+    // queue over and over, so the buffer grows instead.
+    if (size_needed <= size_ && offset_ >= static_cast<size_t>(used_)) {
+      memmove(buffer_.get(), front(), used_);
+      offset_ = 0;
+    } else {
+      Grow(size_needed);
+    }
   }
 
   memcpy(front() + used_, data, size);
@@ -79,6 +75,25 @@ void ByteQueue::Pop(int count) {
   }
 }
 
+void ByteQueue::Grow(size_t size_needed) {
+  size_t new_size = 2 * size_;
+  while (size_needed > new_size && new_size > size_)
+    new_size *= 2;
+
+  // Sanity check to make sure we didn't overflow.
+  CHECK_GT(new_size, size_);
+
+  std::unique_ptr<uint8_t[]> new_buffer(new uint8_t[new_size]);
+
+  // Copy the data from the old buffer to the start of the new one.
+  if (used_ > 0)
+    memcpy(new_buffer.get(), front(), used_);
+
+  buffer_.reset(new_buffer.release());
+  size_ = new_size;
+  offset_ = 0;
+}
+
 uint8_t* ByteQueue::front() const {
   return buffer_.get() + offset_;
 }
@@ -24,9 +24,14 @@ class ByteQueue {
   ByteQueue();
   ~ByteQueue();
 
-  /// Reset the queue to the empty state.
+  /// Reset the queue to the empty state. The buffer is kept, so a queue
+  /// that is reused for data of similar sizes stops allocating once it has
+  /// grown to the largest size it held.
   void Reset();
 
+  /// Make sure the queue can hold @a size bytes without reallocating.
+  void Reserve(int size);
+
   /// Append new bytes to the end of the queue.
   void Push(const uint8_t* data, int size);
 
@@ -38,7 +43,15 @@ class ByteQueue {
   /// @param count specifies number of bytes to be popped.
   void Pop(int count);
 
+  /// @return The number of bytes the queue can hold without reallocating, i.e.
+  ///         the high-water mark of the queue.
+  size_t capacity() const { return size_; }
+
  private:
+  // Reallocates |buffer_| to hold at least |size_needed| bytes, moving the
+  // queued bytes to its start.
+  void Grow(size_t size_needed);
+
   // Returns a pointer to the front of the queue.
   uint8_t* front() const;
 
@@ -0,0 +1,100 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/media/base/byte_queue.h"
+
+namespace shaka {
+namespace media {
+
+TEST(ByteQueueTest, PushAndPop) {
+  std::vector<uint8_t> data(3000);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8_t>(i);
+
+  ByteQueue queue;
+  queue.Push(data.data(), 2000);
+  queue.Pop(1500);
+  queue.Push(data.data() + 2000, 1000);
+
+  const uint8_t* buf;
+  int size;
+  queue.Peek(&buf, &size);
+  ASSERT_EQ(1500, size);
+  EXPECT_EQ(std::vector<uint8_t>(data.begin() + 1500, data.end()),
+            std::vector<uint8_t>(buf, buf + size));
+}
+
+TEST(ByteQueueTest, ResetKeepsCapacity) {
+  std::vector<uint8_t> data(5000);
+  ByteQueue queue;
+  queue.Push(data.data(), data.size());
+  const size_t capacity = queue.capacity();
+  EXPECT_GE(capacity, data.size());
+
+  queue.Reset();
+  EXPECT_EQ(capacity, queue.capacity());
+  queue.Push(data.data(), data.size());
+  EXPECT_EQ(capacity, queue.capacity());
+}
+
+TEST(ByteQueueTest, Reserve) {
+  std::vector<uint8_t> data(9000, 0x5a);
+  ByteQueue queue;
+  queue.Push(data.data(), 100);
+  queue.Pop(10);
+  queue.Reserve(10000);
+  const size_t capacity = queue.capacity();
+  EXPECT_GE(capacity, 10000u);
+
+  // Reserving less than the capacity does nothing.
+  queue.Reserve(10);
+  EXPECT_EQ(capacity, queue.capacity());
+
+  // The queued bytes are kept.
+  const uint8_t* buf;
+  int size;
+  queue.Peek(&buf, &size);
+  ASSERT_EQ(90, size);
+  EXPECT_EQ(std::vector<uint8_t>(90, 0x5a),
+            std::vector<uint8_t>(buf, buf + size));
+
+  queue.Push(data.data(), 9000);
+  EXPECT_EQ(capacity, queue.capacity());
+}
+
+// The queued bytes are moved to the start of the buffer only if the popped
+// bytes before them are at least as many; the buffer grows otherwise.
+TEST(ByteQueueTest, MovesQueuedBytesOnlyIfFewerThanPoppedBytes) {
+  std::vector<uint8_t> data(4000);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8_t>(i);
+
+  ByteQueue queue;
+  queue.Push(data.data(), 1000);
+  const size_t capacity = queue.capacity();
+  queue.Pop(900);
+  queue.Push(data.data() + 1000, 500);
+  EXPECT_EQ(capacity, queue.capacity());
+
+  queue.Pop(100);
+  queue.Push(data.data() + 1500, capacity - 500);
+  EXPECT_GT(queue.capacity(), capacity);
+
+  const uint8_t* buf;
+  int size;
+  queue.Peek(&buf, &size);
+  ASSERT_EQ(static_cast<int>(capacity), size);
+  EXPECT_EQ(std::vector<uint8_t>(data.begin() + 1000,
+                                 data.begin() + 1000 + capacity),
+            std::vector<uint8_t>(buf, buf + size));
+}
+
+}  // namespace media
+}  // namespace shaka
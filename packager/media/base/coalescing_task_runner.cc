@@ -0,0 +1,75 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/coalescing_task_runner.h"
+
+#include "packager/base/bind.h"
+#include "packager/media/base/closure_thread.h"
+
+namespace shaka {
+namespace media {
+
+CoalescingTaskRunner::CoalescingTaskRunner(const std::string& name_prefix,
+                                           base::TimeDelta window,
+                                           const base::Closure& task)
+    : window_(window), task_(task), condition_(&lock_) {
+  thread_.reset(new ClosureThread(
+      name_prefix,
+      base::Bind(&CoalescingTaskRunner::RunLoop, base::Unretained(this))));
+  thread_->Start();
+}
+
+CoalescingTaskRunner::~CoalescingTaskRunner() {
+  Stop();
+}
+
+void CoalescingTaskRunner::Request() {
+  base::AutoLock scoped_lock(lock_);
+  if (stopped_ || pending_)
+    return;
+  pending_ = true;
+  condition_.Signal();
+}
+
+void CoalescingTaskRunner::Stop() {
+  {
+    base::AutoLock scoped_lock(lock_);
+    if (stopped_)
+      return;
+    stopped_ = true;
+    condition_.Signal();
+  }
+  thread_->Join();
+}
+
+void CoalescingTaskRunner::RunLoop() {
+  base::AutoLock scoped_lock(lock_);
+  while (true) {
+    while (!pending_ && !stopped_)
+      condition_.Wait();
+    if (!pending_)
+      return;
+
+    // Wait for the end of the window, unless stopped, to coalesce the requests
+    // made in the meantime.
+    const base::TimeTicks end_time = base::TimeTicks::Now() + window_;
+    while (!stopped_) {
+      const base::TimeDelta remaining = end_time - base::TimeTicks::Now();
+      if (remaining <= base::TimeDelta())
+        break;
+      condition_.TimedWait(remaining);
+    }
+
+    pending_ = false;
+    {
+      base::AutoUnlock scoped_unlock(lock_);
+      task_.Run();
+    }
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
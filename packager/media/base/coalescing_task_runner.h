@@ -0,0 +1,65 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_COALESCING_TASK_RUNNER_H_
+#define PACKAGER_MEDIA_BASE_COALESCING_TASK_RUNNER_H_
+
+#include <memory>
+#include <string>
+
+#include "packager/base/callback.h"
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+
+class ClosureThread;
+
+/// Runs a task on a dedicated thread when requested, coalescing the requests:
+/// the task runs once, @a window after the first request, for all the
+/// requests made in the meantime. Requests made while the task runs schedule
+/// another run. Used to write manifests at most once per window, off the
+/// threads that update them. Thread safe.
+class CoalescingTaskRunner {
+ public:
+  /// @param name_prefix is the name prefix of the thread.
+  /// @param window is the time to wait for more requests before running.
+  /// @param task is run on the thread of the runner.
+  CoalescingTaskRunner(const std::string& name_prefix,
+                       base::TimeDelta window,
+                       const base::Closure& task);
+  /// Calls Stop().
+  ~CoalescingTaskRunner();
+
+  /// Request the task to run. Does not block.
+  void Request();
+
+  /// Run the pending request, if any, without waiting for the end of its
+  /// window, and stop the thread. Later requests are ignored.
+  void Stop();
+
+ private:
+  void RunLoop();
+
+  const base::TimeDelta window_;
+  const base::Closure task_;
+
+  base::Lock lock_;
+  base::ConditionVariable condition_;
+  bool pending_ = false;
+  bool stopped_ = false;
+  std::unique_ptr<ClosureThread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(CoalescingTaskRunner);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_COALESCING_TASK_RUNNER_H_
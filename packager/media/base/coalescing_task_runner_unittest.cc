@@ -0,0 +1,85 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/coalescing_task_runner.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+
+#include "packager/base/bind.h"
+#include "packager/base/threading/platform_thread.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kThreadNamePrefix[] = "TestCoalescingTaskRunner";
+const int kWindowMs = 20;
+const int kNumRequests = 10;
+
+}  // namespace
+
+class CoalescingTaskRunnerTest : public ::testing::Test {
+ protected:
+  void CreateRunner(base::TimeDelta window) {
+    runner_.reset(new CoalescingTaskRunner(
+        kThreadNamePrefix, window,
+        base::Bind(&CoalescingTaskRunnerTest::Task, base::Unretained(this))));
+  }
+
+  void Task() { ++num_runs_; }
+
+  // Sleep long enough for a pending request to run.
+  void WaitForWindow() {
+    base::PlatformThread::Sleep(
+        base::TimeDelta::FromMilliseconds(5 * kWindowMs));
+  }
+
+  std::atomic<int> num_runs_{0};
+  std::unique_ptr<CoalescingTaskRunner> runner_;
+};
+
+TEST_F(CoalescingTaskRunnerTest, NoRequest) {
+  CreateRunner(base::TimeDelta::FromMilliseconds(kWindowMs));
+  runner_->Stop();
+  EXPECT_EQ(0, num_runs_);
+}
+
+TEST_F(CoalescingTaskRunnerTest, CoalescesRequests) {
+  CreateRunner(base::TimeDelta::FromMilliseconds(kWindowMs));
+  for (int i = 0; i < kNumRequests; ++i)
+    runner_->Request();
+  WaitForWindow();
+  EXPECT_EQ(1, num_runs_);
+
+  runner_->Request();
+  WaitForWindow();
+  EXPECT_EQ(2, num_runs_);
+}
+
+TEST_F(CoalescingTaskRunnerTest, StopRunsPendingRequest) {
+  CreateRunner(base::TimeDelta::FromHours(1));
+  runner_->Request();
+  runner_->Stop();
+  EXPECT_EQ(1, num_runs_);
+
+  // Ignored after Stop().
+  runner_->Request();
+  runner_.reset();
+  EXPECT_EQ(1, num_runs_);
+}
+
+TEST_F(CoalescingTaskRunnerTest, DestructorRunsPendingRequest) {
+  CreateRunner(base::TimeDelta::FromHours(1));
+  runner_->Request();
+  runner_.reset();
+  EXPECT_EQ(1, num_runs_);
+}
+
+}  // namespace media
+}  // namespace shaka
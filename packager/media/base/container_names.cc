@@ -1682,6 +1682,11 @@ MediaContainerName DetermineContainer(const uint8_t* buffer, int buffer_size) {
   if (CheckWebVtt(buffer, buffer_size))
       return CONTAINER_WEBVTT;
 
+  // The TTML check parses the whole content, but only when it starts with an
+  // XML declaration, so do it before scanning the buffer for start codes.
+  if (CheckTtml(buffer, buffer_size))
+    return CONTAINER_TTML;
+
   // Additional checks that may scan a portion of the buffer.
   if (CheckMpeg2ProgramStream(buffer, buffer_size))
     return CONTAINER_MPEG2PS;
@@ -1716,11 +1721,6 @@ MediaContainerName DetermineContainer(const uint8_t* buffer, int buffer_size) {
       return CONTAINER_EAC3;
   }
 
-  // To do a TTML check, it parses the XML which requires scanning
-  // the whole content.
-  if (CheckTtml(buffer, buffer_size))
-    return CONTAINER_TTML;
-
   return CONTAINER_UNKNOWN;
 }
 
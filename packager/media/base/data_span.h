@@ -0,0 +1,30 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_DATA_SPAN_H_
+#define PACKAGER_MEDIA_BASE_DATA_SPAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace shaka {
+namespace media {
+
+/// A piece of data assembled from pieces of other buffers without copying
+/// them, e.g. a byte stream made of the NAL units of a sample and the start
+/// codes between them.
+/// The piece is the @a size bytes at @a data. If @a data is null, the piece is
+/// the next @a size bytes of a buffer that goes along with the spans, which
+/// holds the bytes that are not in any other buffer, in order.
+struct DataSpan {
+  const uint8_t* data;
+  size_t size;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_DATA_SPAN_H_
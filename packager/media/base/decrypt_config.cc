@@ -10,27 +10,53 @@ namespace shaka {
 namespace media {
 
 DecryptConfig::DecryptConfig(const std::vector<uint8_t>& key_id,
-                             const std::vector<uint8_t>& iv,
-                             const std::vector<SubsampleEntry>& subsamples)
-    : DecryptConfig(key_id, iv, subsamples, FOURCC_cenc, 0, 0) {}
+                             std::vector<uint8_t> iv,
+                             std::vector<SubsampleEntry> subsamples)
+    : DecryptConfig(key_id,
+                    std::move(iv),
+                    std::move(subsamples),
+                    FOURCC_cenc,
+                    0,
+                    0) {}
 
 DecryptConfig::DecryptConfig(const std::vector<uint8_t>& key_id,
-                             const std::vector<uint8_t>& iv,
-                             const std::vector<SubsampleEntry>& subsamples,
+                             std::vector<uint8_t> iv,
+                             std::vector<SubsampleEntry> subsamples,
                              FourCC protection_scheme,
                              uint8_t crypt_byte_block,
                              uint8_t skip_byte_block)
-    : key_id_(key_id),
-      iv_(iv),
-      subsamples_(subsamples),
+    : DecryptConfig(std::make_shared<const std::vector<uint8_t>>(key_id),
+                    std::move(iv),
+                    std::move(subsamples),
+                    protection_scheme,
+                    crypt_byte_block,
+                    skip_byte_block) {}
+
+DecryptConfig::DecryptConfig(
+    std::shared_ptr<const std::vector<uint8_t>> key_id,
+    std::vector<uint8_t> iv,
+    std::vector<SubsampleEntry> subsamples,
+    FourCC protection_scheme,
+    uint8_t crypt_byte_block,
+    uint8_t skip_byte_block)
+    : key_id_(std::move(key_id)),
+      iv_(std::move(iv)),
+      subsamples_(std::move(subsamples)),
       protection_scheme_(protection_scheme),
       crypt_byte_block_(crypt_byte_block),
       skip_byte_block_(skip_byte_block) {
-  CHECK_GT(key_id.size(), 0u);
+  CHECK(key_id_);
+  CHECK_GT(key_id_->size(), 0u);
 }
 
 DecryptConfig::~DecryptConfig() {}
 
+std::unique_ptr<DecryptConfig> DecryptConfig::Clone() const {
+  return std::unique_ptr<DecryptConfig>(
+      new DecryptConfig(key_id_, iv_, subsamples_, protection_scheme_,
+                        crypt_byte_block_, skip_byte_block_));
+}
+
 size_t DecryptConfig::GetTotalSizeOfSubsamples() const {
   size_t size = 0;
   for (const SubsampleEntry& subsample : subsamples_)
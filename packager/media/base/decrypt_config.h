@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -49,8 +50,8 @@ class DecryptConfig {
   ///        as described in SubsampleEntry. A decrypted buffer will be equal
   ///        in size to the sum of the subsample sizes.
   DecryptConfig(const std::vector<uint8_t>& key_id,
-                const std::vector<uint8_t>& iv,
-                const std::vector<SubsampleEntry>& subsamples);
+                std::vector<uint8_t> iv,
+                std::vector<SubsampleEntry> subsamples);
 
   /// Create a general decrypt config with possible pattern-based encryption.
   /// @param key_id is the ID that references the decryption key.
@@ -65,14 +66,27 @@ class DecryptConfig {
   /// @param skip_byte_block indicates number of unencrypted blocks (16-byte)
   ///        in pattern based encryption, 'cens' and 'cbcs'. Ignored otherwise.
   DecryptConfig(const std::vector<uint8_t>& key_id,
-                const std::vector<uint8_t>& iv,
-                const std::vector<SubsampleEntry>& subsamples,
+                std::vector<uint8_t> iv,
+                std::vector<SubsampleEntry> subsamples,
+                FourCC protection_scheme,
+                uint8_t crypt_byte_block,
+                uint8_t skip_byte_block);
+
+  /// Same as above, but shares @a key_id, e.g. with the decrypt configs of
+  /// the other samples encrypted with the same key, instead of copying it for
+  /// every sample.
+  DecryptConfig(std::shared_ptr<const std::vector<uint8_t>> key_id,
+                std::vector<uint8_t> iv,
+                std::vector<SubsampleEntry> subsamples,
                 FourCC protection_scheme,
                 uint8_t crypt_byte_block,
                 uint8_t skip_byte_block);
 
   ~DecryptConfig();
 
+  /// @return a copy of this decrypt config, which shares its key id.
+  std::unique_ptr<DecryptConfig> Clone() const;
+
   /// @param clear_bytes is the size of clear bytes in the subsample to be
   ///        added.
   /// @param cipher_bytes is the size of cipher bytes in the subsample to be
@@ -84,7 +98,7 @@ class DecryptConfig {
   /// @return The total size of subsamples.
   size_t GetTotalSizeOfSubsamples() const;
 
-  const std::vector<uint8_t>& key_id() const { return key_id_; }
+  const std::vector<uint8_t>& key_id() const { return *key_id_; }
   const std::vector<uint8_t>& iv() const { return iv_; }
   const std::vector<SubsampleEntry>& subsamples() const { return subsamples_; }
   FourCC protection_scheme() const { return protection_scheme_; }
@@ -92,7 +106,8 @@ class DecryptConfig {
   uint8_t skip_byte_block() const { return skip_byte_block_; }
 
  private:
-  const std::vector<uint8_t> key_id_;
+  // Shared by the decrypt configs with the same key id.
+  const std::shared_ptr<const std::vector<uint8_t>> key_id_;
 
   // Initialization vector.
   const std::vector<uint8_t> iv_;
@@ -44,91 +44,91 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
     return false;
   }
 
-  // Get the decryptor object.
-  AesCryptor* decryptor = nullptr;
-  auto found = decryptor_map_.find(decrypt_config->key_id());
-  if (found == decryptor_map_.end()) {
-    // Create new AesDecryptor based on decryption mode.
-    EncryptionKey key;
-    Status status(key_source_->GetKey(decrypt_config->key_id(), &key));
-    if (!status.ok()) {
-      LOG(ERROR) << "Error retrieving decryption key: " << status;
-      return false;
-    }
+  std::unique_ptr<AesCryptor> decryptor = AcquireDecryptor(*decrypt_config);
+  if (!decryptor)
+    return false;
+  const bool result = Decrypt(decrypt_config, encrypted_buffer, buffer_size,
+                              decrypted_buffer, decryptor.get());
+  ReleaseDecryptor(decrypt_config->key_id(), std::move(decryptor));
+  return result;
+}
 
-    std::unique_ptr<AesCryptor> aes_decryptor;
-    switch (decrypt_config->protection_scheme()) {
-      case FOURCC_cenc:
-        aes_decryptor.reset(new AesCtrDecryptor);
-        break;
-      case FOURCC_cbc1:
-        aes_decryptor.reset(new AesCbcDecryptor(kNoPadding));
-        break;
-      case FOURCC_cens:
-        aes_decryptor.reset(new AesPatternCryptor(
-            decrypt_config->crypt_byte_block(),
-            decrypt_config->skip_byte_block(),
-            AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
-            AesCryptor::kDontUseConstantIv,
-            std::unique_ptr<AesCryptor>(new AesCtrDecryptor())));
-        break;
-      case FOURCC_cbcs:
-        aes_decryptor.reset(new AesPatternCryptor(
-            decrypt_config->crypt_byte_block(),
-            decrypt_config->skip_byte_block(),
-            AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
-            AesCryptor::kUseConstantIv,
-            std::unique_ptr<AesCryptor>(new AesCbcDecryptor(kNoPadding))));
-        break;
-      default:
-        LOG(ERROR) << "Unsupported protection scheme: "
-                   << decrypt_config->protection_scheme();
-        return false;
+std::unique_ptr<AesCryptor> DecryptorSource::AcquireDecryptor(
+    const DecryptConfig& decrypt_config) {
+  {
+    base::AutoLock scoped_lock(lock_);
+    auto found = decryptor_map_.find(decrypt_config.key_id());
+    if (found != decryptor_map_.end() && !found->second.empty()) {
+      std::unique_ptr<AesCryptor> decryptor = std::move(found->second.back());
+      found->second.pop_back();
+      return decryptor;
     }
+  }
 
-    if (!aes_decryptor->InitializeWithIv(key.key, decrypt_config->iv())) {
-      LOG(ERROR) << "Failed to initialize AesDecryptor for decryption.";
-      return false;
-    }
-    decryptor = aes_decryptor.get();
-    decryptor_map_[decrypt_config->key_id()] = std::move(aes_decryptor);
-  } else {
-    decryptor = found->second.get();
+  // Create new AesDecryptor based on decryption mode.
+  EncryptionKey key;
+  Status status(key_source_->GetKey(decrypt_config.key_id(), &key));
+  if (!status.ok()) {
+    LOG(ERROR) << "Error retrieving decryption key: " << status;
+    return nullptr;
   }
+
+  std::unique_ptr<AesCryptor> aes_decryptor;
+  switch (decrypt_config.protection_scheme()) {
+    case FOURCC_cenc:
+      aes_decryptor.reset(new AesCtrDecryptor);
+      break;
+    case FOURCC_cbc1:
+      aes_decryptor.reset(new AesCbcDecryptor(kNoPadding));
+      break;
+    case FOURCC_cens:
+      aes_decryptor.reset(new AesPatternCryptor(
+          decrypt_config.crypt_byte_block(), decrypt_config.skip_byte_block(),
+          AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+          AesCryptor::kDontUseConstantIv,
+          std::unique_ptr<AesCryptor>(new AesCtrDecryptor())));
+      break;
+    case FOURCC_cbcs:
+      aes_decryptor.reset(new AesPatternCryptor(
+          decrypt_config.crypt_byte_block(), decrypt_config.skip_byte_block(),
+          AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+          AesCryptor::kUseConstantIv,
+          std::unique_ptr<AesCryptor>(new AesCbcDecryptor(kNoPadding))));
+      break;
+    default:
+      LOG(ERROR) << "Unsupported protection scheme: "
+                 << decrypt_config.protection_scheme();
+      return nullptr;
+  }
+
+  if (!aes_decryptor->InitializeWithIv(key.key, decrypt_config.iv())) {
+    LOG(ERROR) << "Failed to initialize AesDecryptor for decryption.";
+    return nullptr;
+  }
+  return aes_decryptor;
+}
+
+void DecryptorSource::ReleaseDecryptor(const std::vector<uint8_t>& key_id,
+                                       std::unique_ptr<AesCryptor> decryptor) {
+  base::AutoLock scoped_lock(lock_);
+  decryptor_map_[key_id].push_back(std::move(decryptor));
+}
+
+bool DecryptorSource::Decrypt(const DecryptConfig* decrypt_config,
+                              const uint8_t* encrypted_buffer,
+                              size_t buffer_size,
+                              uint8_t* decrypted_buffer,
+                              AesCryptor* decryptor) {
   if (!decryptor->SetIv(decrypt_config->iv())) {
     LOG(ERROR) << "Invalid initialization vector.";
     return false;
   }
 
-  if (decrypt_config->subsamples().empty()) {
-    // Sample not encrypted using subsample encryption. Decrypt whole.
-    if (!decryptor->Crypt(encrypted_buffer, buffer_size, decrypted_buffer)) {
-      LOG(ERROR) << "Error during bulk sample decryption.";
-      return false;
-    }
-    return true;
-  }
-
-  // Subsample decryption.
-  const std::vector<SubsampleEntry>& subsamples = decrypt_config->subsamples();
-  const uint8_t* current_ptr = encrypted_buffer;
-  const uint8_t* const buffer_end = encrypted_buffer + buffer_size;
-  for (const auto& subsample : subsamples) {
-    if ((current_ptr + subsample.clear_bytes + subsample.cipher_bytes) >
-        buffer_end) {
-      LOG(ERROR) << "Subsamples overflow sample buffer.";
-      return false;
-    }
-    memcpy(decrypted_buffer, current_ptr, subsample.clear_bytes);
-    current_ptr += subsample.clear_bytes;
-    decrypted_buffer += subsample.clear_bytes;
-    if (!decryptor->Crypt(current_ptr, subsample.cipher_bytes,
-                          decrypted_buffer)) {
-      LOG(ERROR) << "Error decrypting subsample buffer.";
-      return false;
-    }
-    current_ptr += subsample.cipher_bytes;
-    decrypted_buffer += subsample.cipher_bytes;
+  if (!decryptor->CryptSubsamples(encrypted_buffer, buffer_size,
+                                  decrypt_config->subsamples(),
+                                  decrypted_buffer)) {
+    LOG(ERROR) << "Error during sample decryption.";
+    return false;
   }
   return true;
 }
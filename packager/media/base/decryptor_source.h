@@ -11,6 +11,7 @@
 #include <memory>
 #include <vector>
 
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/aes_decryptor.h"
 #include "packager/media/base/decrypt_config.h"
 #include "packager/media/base/key_source.h"
@@ -19,6 +20,9 @@ namespace shaka {
 namespace media {
 
 /// DecryptorSource wraps KeySource and is responsible for decryptor management.
+/// DecryptSampleBuffer() is thread safe: the decryptors of a key are reused
+/// across samples, and a sample decrypted while the decryptors of its key are
+/// all in use gets a new one.
 class DecryptorSource {
  public:
   /// Constructs a DecryptorSource object.
@@ -41,8 +45,23 @@ class DecryptorSource {
                            uint8_t* decrypted_buffer);
 
  private:
+  // Take an idle decryptor of the key of |decrypt_config|, or create one.
+  std::unique_ptr<AesCryptor> AcquireDecryptor(
+      const DecryptConfig& decrypt_config);
+  // Return |decryptor|, of the key |key_id|, to the idle decryptors.
+  void ReleaseDecryptor(const std::vector<uint8_t>& key_id,
+                        std::unique_ptr<AesCryptor> decryptor);
+  bool Decrypt(const DecryptConfig* decrypt_config,
+               const uint8_t* encrypted_buffer,
+               size_t buffer_size,
+               uint8_t* decrypted_buffer,
+               AesCryptor* decryptor);
+
   KeySource* key_source_;
-  std::map<std::vector<uint8_t>, std::unique_ptr<AesCryptor>> decryptor_map_;
+  base::Lock lock_;
+  // Key id -> idle decryptors.
+  std::map<std::vector<uint8_t>, std::vector<std::unique_ptr<AesCryptor>>>
+      decryptor_map_;
 
   DISALLOW_COPY_AND_ASSIGN(DecryptorSource);
 };
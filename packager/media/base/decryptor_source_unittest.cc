@@ -9,9 +9,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/base/bind.h"
 #include "packager/base/macros.h"
 #include "packager/media/base/raw_key_source.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 
+using ::testing::AtLeast;
 using ::testing::Return;
 using ::testing::SetArgPointee;
 using ::testing::StrictMock;
@@ -51,6 +54,19 @@ const uint8_t kBuffer2[] = {0x05, 0x02};
 // Expected decrypted buffer with the above kMockKey and kIv2.
 const uint8_t kExpectedDecryptedBuffer2[] = {0x20, 0x62};
 
+void DecryptFullSample(DecryptorSource* decryptor_source,
+                       const DecryptConfig* decrypt_config,
+                       bool* result) {
+  std::vector<uint8_t> decrypted_buffer(arraysize(kBuffer));
+  *result =
+      decryptor_source->DecryptSampleBuffer(decrypt_config, kBuffer,
+                                            arraysize(kBuffer),
+                                            decrypted_buffer.data()) &&
+      decrypted_buffer ==
+          std::vector<uint8_t>(std::begin(kExpectedDecryptedBuffer),
+                               std::end(kExpectedDecryptedBuffer));
+}
+
 class MockKeySource : public RawKeySource {
  public:
   MOCK_METHOD2(GetKey,
@@ -177,6 +193,32 @@ TEST_F(DecryptorSourceTest, DecryptFailedIfGetKeyFailed) {
       &decrypted_buffer_[0]));
 }
 
+TEST_F(DecryptorSourceTest, ConcurrentDecryption) {
+  EncryptionKey encryption_key;
+  encryption_key.key.assign(kMockKey, kMockKey + arraysize(kMockKey));
+  // The decryptors are reused once they are released, so the key is only
+  // retrieved for the samples decrypted concurrently.
+  EXPECT_CALL(mock_key_source_, GetKey(key_id_, _))
+      .Times(AtLeast(1))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<1>(encryption_key), Return(Status::OK)));
+
+  const DecryptConfig decrypt_config(
+      key_id_, std::vector<uint8_t>(kIv, kIv + arraysize(kIv)),
+      std::vector<SubsampleEntry>());
+  const size_t kNumSamples = 64;
+  bool results[kNumSamples] = {};
+  std::vector<base::Closure> tasks;
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    tasks.push_back(base::Bind(&DecryptFullSample, &decryptor_source_,
+                               &decrypt_config, &results[i]));
+  }
+  WorkStealingThreadPool thread_pool(4);
+  thread_pool.RunTasksAndWait(tasks);
+  for (size_t i = 0; i < kNumSamples; ++i)
+    EXPECT_TRUE(results[i]) << "sample " << i;
+}
+
 TEST_F(DecryptorSourceTest, EncryptedBufferAndDecryptedBufferOverlap) {
   DecryptConfig decrypt_config(key_id_,
                                std::vector<uint8_t>(kIv, kIv + arraysize(kIv)),
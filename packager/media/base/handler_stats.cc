@@ -0,0 +1,194 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/handler_stats.h"
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kNumLinearBuckets = 16;
+const size_t kNumBucketsPerPowerOfTwo = 8;
+// log2(kNumLinearBuckets) and log2(kNumBucketsPerPowerOfTwo).
+const int kLinearBits = 4;
+const int kSubBucketBits = 3;
+const size_t kNumLatencyBuckets =
+    kNumLinearBuckets + (63 - kLinearBits) * kNumBucketsPerPowerOfTwo;
+
+int HighestBit(int64_t value) {
+  int bit = 0;
+  while (value >>= 1)
+    ++bit;
+  return bit;
+}
+
+std::string EscapeJsonString(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+          escaped += base::StringPrintf("\\u%04x", c);
+        else
+          escaped += c;
+        break;
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+HandlerStats::HandlerStats(const std::string& name)
+    : name_(name), latency_histogram_(kNumLatencyBuckets, 0) {}
+
+HandlerStats::~HandlerStats() {}
+
+void HandlerStats::RecordProcess(bool is_sample,
+                                 int64_t num_bytes,
+                                 base::TimeDelta time,
+                                 base::TimeDelta cpu_time) {
+  const size_t bucket = LatencyBucket(time.InMicroseconds());
+  base::AutoLock scoped_lock(lock_);
+  ++num_messages_;
+  if (is_sample)
+    ++num_samples_;
+  num_bytes_ += num_bytes;
+  total_time_ += time;
+  total_cpu_time_ += cpu_time;
+  max_latency_ = std::max(max_latency_, time);
+  ++latency_histogram_[bucket];
+}
+
+void HandlerStats::RecordFlush(base::TimeDelta time, base::TimeDelta cpu_time) {
+  base::AutoLock scoped_lock(lock_);
+  total_time_ += time;
+  total_cpu_time_ += cpu_time;
+}
+
+HandlerStats::Snapshot HandlerStats::GetSnapshot() const {
+  Snapshot snapshot;
+  snapshot.name = name_;
+  base::AutoLock scoped_lock(lock_);
+  snapshot.num_messages = num_messages_;
+  snapshot.num_samples = num_samples_;
+  snapshot.num_bytes = num_bytes_;
+  snapshot.total_time = total_time_;
+  snapshot.total_cpu_time = total_cpu_time_;
+  snapshot.p50_latency = LatencyPercentile(0.5);
+  snapshot.p99_latency = LatencyPercentile(0.99);
+  snapshot.max_latency = max_latency_;
+  return snapshot;
+}
+
+size_t HandlerStats::LatencyBucket(int64_t latency_us) {
+  if (latency_us <= 0)
+    return 0;
+  if (latency_us < static_cast<int64_t>(kNumLinearBuckets))
+    return latency_us;
+  const int highest_bit = HighestBit(latency_us);
+  const size_t sub_bucket = (latency_us >> (highest_bit - kSubBucketBits)) &
+                            (kNumBucketsPerPowerOfTwo - 1);
+  return kNumLinearBuckets +
+         (highest_bit - kLinearBits) * kNumBucketsPerPowerOfTwo + sub_bucket;
+}
+
+int64_t HandlerStats::LatencyBucketUpperBound(size_t bucket) {
+  if (bucket < kNumLinearBuckets)
+    return bucket;
+  const int highest_bit = static_cast<int>((bucket - kNumLinearBuckets) /
+                                           kNumBucketsPerPowerOfTwo) +
+                          kLinearBits;
+  const int64_t sub_bucket =
+      (bucket - kNumLinearBuckets) % kNumBucketsPerPowerOfTwo;
+  return ((kNumBucketsPerPowerOfTwo + sub_bucket + 1)
+          << (highest_bit - kSubBucketBits)) -
+         1;
+}
+
+base::TimeDelta HandlerStats::LatencyPercentile(double percentile) const {
+  lock_.AssertAcquired();
+  if (num_messages_ == 0)
+    return base::TimeDelta();
+  const int64_t target = std::max<int64_t>(
+      1, static_cast<int64_t>(percentile * num_messages_ + 0.5));
+  int64_t count = 0;
+  for (size_t bucket = 0; bucket < latency_histogram_.size(); ++bucket) {
+    count += latency_histogram_[bucket];
+    if (count >= target) {
+      return std::min(max_latency_, base::TimeDelta::FromMicroseconds(
+                                        LatencyBucketUpperBound(bucket)));
+    }
+  }
+  NOTREACHED();
+  return max_latency_;
+}
+
+HandlerStatsRegistry::HandlerStatsRegistry() {}
+
+HandlerStatsRegistry::~HandlerStatsRegistry() {}
+
+std::shared_ptr<HandlerStats> HandlerStatsRegistry::Create(
+    const std::string& name) {
+  std::shared_ptr<HandlerStats> stats(new HandlerStats(name));
+  base::AutoLock scoped_lock(lock_);
+  stats_.push_back(stats);
+  return stats;
+}
+
+std::vector<HandlerStats::Snapshot> HandlerStatsRegistry::GetSnapshots()
+    const {
+  std::vector<std::shared_ptr<HandlerStats>> stats;
+  {
+    base::AutoLock scoped_lock(lock_);
+    stats = stats_;
+  }
+  std::vector<HandlerStats::Snapshot> snapshots;
+  for (const std::shared_ptr<HandlerStats>& handler_stats : stats)
+    snapshots.push_back(handler_stats->GetSnapshot());
+  return snapshots;
+}
+
+std::string HandlerStatsRegistry::ToJson() const {
+  const std::vector<HandlerStats::Snapshot> snapshots = GetSnapshots();
+
+  std::string json = "{\n  \"handlers\": [";
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    const HandlerStats::Snapshot& snapshot = snapshots[i];
+    json += i == 0 ? "\n" : ",\n";
+    base::StringAppendF(
+        &json,
+        "    {\"name\": \"%s\", \"messages\": %lld, \"samples\": %lld, "
+        "\"bytes\": %lld, \"time_us\": %lld, \"cpu_time_us\": %lld, "
+        "\"p50_latency_us\": %lld, \"p99_latency_us\": %lld, "
+        "\"max_latency_us\": %lld}",
+        EscapeJsonString(snapshot.name).c_str(),
+        static_cast<long long>(snapshot.num_messages),
+        static_cast<long long>(snapshot.num_samples),
+        static_cast<long long>(snapshot.num_bytes),
+        static_cast<long long>(snapshot.total_time.InMicroseconds()),
+        static_cast<long long>(snapshot.total_cpu_time.InMicroseconds()),
+        static_cast<long long>(snapshot.p50_latency.InMicroseconds()),
+        static_cast<long long>(snapshot.p99_latency.InMicroseconds()),
+        static_cast<long long>(snapshot.max_latency.InMicroseconds()));
+  }
+  json += snapshots.empty() ? "]\n}\n" : "\n  ]\n}\n";
+  return json;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,114 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_HANDLER_STATS_H_
+#define PACKAGER_MEDIA_BASE_HANDLER_STATS_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+
+/// Statistics of the Process and flush calls of a MediaHandler. The times are
+/// the time spent in the handler itself, i.e. excluding the time spent in the
+/// instrumented downstream handlers it dispatches to. Thread safe.
+class HandlerStats {
+ public:
+  /// A snapshot of the statistics.
+  struct Snapshot {
+    std::string name;
+    /// Number of messages processed, of all types.
+    int64_t num_messages = 0;
+    /// Number of media and text samples processed.
+    int64_t num_samples = 0;
+    /// Number of bytes of the media samples processed.
+    int64_t num_bytes = 0;
+    base::TimeDelta total_time;
+    /// The CPU time of the handler, if supported on the platform.
+    base::TimeDelta total_cpu_time;
+    /// Percentiles of the time per message. They are exact within 12.5%.
+    base::TimeDelta p50_latency;
+    base::TimeDelta p99_latency;
+    base::TimeDelta max_latency;
+  };
+
+  /// @param name identifies the handler in the output.
+  explicit HandlerStats(const std::string& name);
+  ~HandlerStats();
+
+  /// Record a Process call.
+  /// @param is_sample indicates whether the message is a media or text sample.
+  /// @param num_bytes is the size of the sample data, if any.
+  /// @param time is the (self) time of the call.
+  /// @param cpu_time is the (self) CPU time of the call.
+  void RecordProcess(bool is_sample,
+                     int64_t num_bytes,
+                     base::TimeDelta time,
+                     base::TimeDelta cpu_time);
+
+  /// Record a flush call. It only contributes to the total times.
+  void RecordFlush(base::TimeDelta time, base::TimeDelta cpu_time);
+
+  Snapshot GetSnapshot() const;
+
+  const std::string& name() const { return name_; }
+
+ private:
+  // Latencies are bucketed in microseconds: values below 16 have a bucket
+  // each, larger values have 8 buckets per power of two.
+  static size_t LatencyBucket(int64_t latency_us);
+  static int64_t LatencyBucketUpperBound(size_t bucket);
+  base::TimeDelta LatencyPercentile(double percentile) const;
+
+  const std::string name_;
+  mutable base::Lock lock_;
+  int64_t num_messages_ = 0;
+  int64_t num_samples_ = 0;
+  int64_t num_bytes_ = 0;
+  base::TimeDelta total_time_;
+  base::TimeDelta total_cpu_time_;
+  base::TimeDelta max_latency_;
+  std::vector<int64_t> latency_histogram_;
+
+  DISALLOW_COPY_AND_ASSIGN(HandlerStats);
+};
+
+/// Owns the statistics of the handlers of a packaging graph.
+class HandlerStatsRegistry {
+ public:
+  HandlerStatsRegistry();
+  ~HandlerStatsRegistry();
+
+  /// Create the statistics of a handler.
+  /// @param name identifies the handler in the output. Handlers may share a
+  ///        name, e.g. the muxers of different outputs of the same stream.
+  std::shared_ptr<HandlerStats> Create(const std::string& name);
+
+  /// @return the statistics of all the handlers, in creation order.
+  std::vector<HandlerStats::Snapshot> GetSnapshots() const;
+
+  /// @return the statistics of all the handlers as JSON, in creation order.
+  std::string ToJson() const;
+
+ private:
+  mutable base::Lock lock_;
+  std::vector<std::shared_ptr<HandlerStats>> stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(HandlerStatsRegistry);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_HANDLER_STATS_H_
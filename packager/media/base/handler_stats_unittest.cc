@@ -0,0 +1,176 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/handler_stats.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kStreamIndex = 0;
+const uint32_t kTimeScale = 1000;
+const int64_t kDuration = 1000;
+const bool kKeyFrame = true;
+const uint8_t kData[] = {1, 2, 3, 4, 5};
+const int kSleepTimeMs = 5;
+
+base::TimeDelta Microseconds(int64_t value) {
+  return base::TimeDelta::FromMicroseconds(value);
+}
+
+// Passes the messages through, optionally sleeping in every Process call.
+class PassThroughHandler : public MediaHandler {
+ public:
+  explicit PassThroughHandler(base::TimeDelta sleep_time)
+      : sleep_time_(sleep_time) {}
+
+ private:
+  Status InitializeInternal() override { return Status::OK; }
+
+  Status Process(std::unique_ptr<StreamData> stream_data) override {
+    if (sleep_time_ > base::TimeDelta())
+      base::PlatformThread::Sleep(sleep_time_);
+    return Dispatch(std::move(stream_data));
+  }
+
+  const base::TimeDelta sleep_time_;
+};
+
+}  // namespace
+
+TEST(HandlerStatsTest, Empty) {
+  HandlerStats stats("handler");
+  const HandlerStats::Snapshot snapshot = stats.GetSnapshot();
+  EXPECT_EQ("handler", snapshot.name);
+  EXPECT_EQ(0, snapshot.num_messages);
+  EXPECT_EQ(base::TimeDelta(), snapshot.p50_latency);
+  EXPECT_EQ(base::TimeDelta(), snapshot.p99_latency);
+}
+
+TEST(HandlerStatsTest, Counts) {
+  HandlerStats stats("handler");
+  stats.RecordProcess(true, 100, Microseconds(10), Microseconds(8));
+  stats.RecordProcess(false, 0, Microseconds(20), Microseconds(15));
+  stats.RecordFlush(Microseconds(30), Microseconds(25));
+
+  const HandlerStats::Snapshot snapshot = stats.GetSnapshot();
+  EXPECT_EQ(2, snapshot.num_messages);
+  EXPECT_EQ(1, snapshot.num_samples);
+  EXPECT_EQ(100, snapshot.num_bytes);
+  EXPECT_EQ(Microseconds(60), snapshot.total_time);
+  EXPECT_EQ(Microseconds(48), snapshot.total_cpu_time);
+  // Flushes do not count as messages.
+  EXPECT_EQ(Microseconds(20), snapshot.max_latency);
+}
+
+TEST(HandlerStatsTest, Percentiles) {
+  HandlerStats stats("handler");
+  // 1us, 2us, ..., 1000us.
+  for (int64_t i = 1; i <= 1000; ++i)
+    stats.RecordProcess(true, 0, Microseconds(i), Microseconds(i));
+
+  const HandlerStats::Snapshot snapshot = stats.GetSnapshot();
+  EXPECT_GE(snapshot.p50_latency, Microseconds(500));
+  EXPECT_LE(snapshot.p50_latency, Microseconds(500 * 9 / 8));
+  EXPECT_GE(snapshot.p99_latency, Microseconds(990));
+  EXPECT_LE(snapshot.p99_latency, Microseconds(1000));
+  EXPECT_EQ(Microseconds(1000), snapshot.max_latency);
+}
+
+TEST(HandlerStatsTest, SmallLatenciesAreExact) {
+  HandlerStats stats("handler");
+  for (int i = 0; i < 99; ++i)
+    stats.RecordProcess(true, 0, Microseconds(3), Microseconds(3));
+  stats.RecordProcess(true, 0, Microseconds(12), Microseconds(12));
+
+  const HandlerStats::Snapshot snapshot = stats.GetSnapshot();
+  EXPECT_EQ(Microseconds(3), snapshot.p50_latency);
+  EXPECT_EQ(Microseconds(3), snapshot.p99_latency);
+  EXPECT_EQ(Microseconds(12), snapshot.max_latency);
+}
+
+TEST(HandlerStatsRegistryTest, ToJson) {
+  HandlerStatsRegistry registry;
+  EXPECT_EQ("{\n  \"handlers\": []\n}\n", registry.ToJson());
+
+  registry.Create("first")->RecordProcess(true, 5, Microseconds(2),
+                                          Microseconds(1));
+  registry.Create("second \"quoted\"");
+  EXPECT_EQ(
+      "{\n"
+      "  \"handlers\": [\n"
+      "    {\"name\": \"first\", \"messages\": 1, \"samples\": 1, "
+      "\"bytes\": 5, \"time_us\": 2, \"cpu_time_us\": 1, "
+      "\"p50_latency_us\": 2, \"p99_latency_us\": 2, \"max_latency_us\": 2},\n"
+      "    {\"name\": \"second \\\"quoted\\\"\", \"messages\": 0, "
+      "\"samples\": 0, \"bytes\": 0, \"time_us\": 0, \"cpu_time_us\": 0, "
+      "\"p50_latency_us\": 0, \"p99_latency_us\": 0, \"max_latency_us\": 0}\n"
+      "  ]\n"
+      "}\n",
+      registry.ToJson());
+}
+
+class HandlerStatsGraphTest : public MediaHandlerTestBase {};
+
+TEST_F(HandlerStatsGraphTest, ExcludesDownstreamTime) {
+  HandlerStatsRegistry registry;
+  std::shared_ptr<HandlerStats> upstream_stats = registry.Create("upstream");
+  std::shared_ptr<HandlerStats> downstream_stats =
+      registry.Create("downstream");
+
+  std::shared_ptr<MediaHandler> upstream =
+      std::make_shared<PassThroughHandler>(base::TimeDelta());
+  std::shared_ptr<MediaHandler> downstream =
+      std::make_shared<PassThroughHandler>(
+          base::TimeDelta::FromMilliseconds(kSleepTimeMs));
+  upstream->set_stats(upstream_stats);
+  downstream->set_stats(downstream_stats);
+  std::shared_ptr<FakeInputMediaHandler> input =
+      std::make_shared<FakeInputMediaHandler>();
+  std::shared_ptr<CachingMediaHandler> output =
+      std::make_shared<CachingMediaHandler>();
+  ASSERT_OK(MediaHandler::Chain({input, upstream, downstream, output}));
+  ASSERT_OK(input->Initialize());
+
+  ASSERT_OK(input->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+  for (int64_t timestamp = 0; timestamp < 2 * kDuration;
+       timestamp += kDuration) {
+    ASSERT_OK(input->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(timestamp, kDuration, kKeyFrame, kData,
+                                     sizeof(kData)))));
+  }
+  ASSERT_OK(input->FlushAllDownstreams());
+  EXPECT_EQ(3u, output->Cache().size());
+
+  const HandlerStats::Snapshot upstream_snapshot =
+      upstream_stats->GetSnapshot();
+  const HandlerStats::Snapshot downstream_snapshot =
+      downstream_stats->GetSnapshot();
+  EXPECT_EQ(3, upstream_snapshot.num_messages);
+  EXPECT_EQ(2, upstream_snapshot.num_samples);
+  EXPECT_EQ(static_cast<int64_t>(2 * sizeof(kData)),
+            upstream_snapshot.num_bytes);
+  EXPECT_EQ(3, downstream_snapshot.num_messages);
+
+  EXPECT_GE(downstream_snapshot.total_time,
+            base::TimeDelta::FromMilliseconds(3 * kSleepTimeMs));
+  EXPECT_GE(downstream_snapshot.p50_latency,
+            base::TimeDelta::FromMilliseconds(kSleepTimeMs));
+  // The sleeps of the downstream handler are not charged to the upstream
+  // handler.
+  EXPECT_LT(upstream_snapshot.total_time,
+            base::TimeDelta::FromMilliseconds(kSleepTimeMs));
+}
+
+}  // namespace media
+}  // namespace shaka
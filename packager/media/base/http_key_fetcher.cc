@@ -9,10 +9,14 @@
 #include <curl/curl.h>
 #include <gflags/gflags.h>
 
+#include <vector>
+
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+#include "packager/metrics/metrics.h"
 
 DEFINE_bool(disable_peer_verification,
             false,
@@ -30,6 +34,8 @@ const char kXmlContentTypeHeader[] = "Content-Type: text/xml; charset=UTF-8";
 const char kJsonContentTypeHeader[] = "Content-Type: application/json";
 
 const int kMinLogLevelForCurlDebugFunction = 2;
+// Maximum number of idle connections kept open by a fetcher.
+const size_t kMaxIdleCurlHandles = 4;
 
 int CurlDebugFunction(CURL* /* handle */,
                       curl_infotype type,
@@ -84,13 +90,18 @@ int CurlDebugFunction(CURL* /* handle */,
 // Scoped CURL implementation which cleans up itself when goes out of scope.
 class ScopedCurl {
  public:
-  ScopedCurl() { ptr_ = curl_easy_init(); }
+  explicit ScopedCurl(CURL* ptr) : ptr_(ptr) {}
   ~ScopedCurl() {
     if (ptr_)
       curl_easy_cleanup(ptr_);
   }
 
   CURL* get() { return ptr_; }
+  CURL* release() {
+    CURL* ptr = ptr_;
+    ptr_ = nullptr;
+    return ptr;
+  }
 
  private:
   CURL* ptr_;
@@ -105,6 +116,19 @@ size_t AppendToString(char* ptr, size_t size, size_t nmemb, std::string* respons
   return total_size;
 }
 
+class ScopedCurlSlist {
+ public:
+  ScopedCurlSlist() : ptr_(nullptr) {}
+  ~ScopedCurlSlist() { curl_slist_free_all(ptr_); }
+
+  void Append(const char* header) { ptr_ = curl_slist_append(ptr_, header); }
+  curl_slist* get() { return ptr_; }
+
+ private:
+  curl_slist* ptr_;
+  DISALLOW_COPY_AND_ASSIGN(ScopedCurlSlist);
+};
+
 class LibCurlInitializer {
  public:
   LibCurlInitializer() : initialized_(false) {
@@ -130,14 +154,100 @@ class LibCurlInitializer {
   DISALLOW_COPY_AND_ASSIGN(LibCurlInitializer);
 };
 
+void InitializeLibCurl() {
+  static LibCurlInitializer lib_curl_initializer;
+}
+
 }  // namespace
 
 namespace media {
 
-HttpKeyFetcher::HttpKeyFetcher() : timeout_in_seconds_(0) {}
+// Keeps the idle curl handles of a fetcher, together with their open
+// connections, so the later requests to the same server skip the DNS lookup
+// and the TCP and TLS handshakes. The handles share the DNS cache and the TLS
+// sessions, so new connections to a known server skip the DNS lookup and
+// resume the TLS session.
+class HttpKeyFetcher::CurlHandleCache {
+ public:
+  CurlHandleCache() {
+    InitializeLibCurl();
+    share_ = curl_share_init();
+    if (share_) {
+      curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, LockShare);
+      curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, UnlockShare);
+      curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+      curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+      curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    } else {
+      LOG(WARNING) << "curl_share_init() failed.";
+    }
+  }
+
+  ~CurlHandleCache() {
+    for (CURL* curl : idle_handles_)
+      curl_easy_cleanup(curl);
+    if (share_)
+      curl_share_cleanup(share_);
+  }
+
+  /// @return an idle handle if there is one, a new handle otherwise. Returns
+  ///         nullptr if a new handle cannot be created.
+  CURL* Acquire() {
+    {
+      base::AutoLock scoped_lock(lock_);
+      if (!idle_handles_.empty()) {
+        CURL* curl = idle_handles_.back();
+        idle_handles_.pop_back();
+        return curl;
+      }
+    }
+    CURL* curl = curl_easy_init();
+    if (curl && share_)
+      curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+    return curl;
+  }
+
+  /// Keep |curl|, which completed a request successfully, for later requests.
+  void Release(CURL* curl) {
+    // Reset the options of the request. The connection is kept open.
+    curl_easy_reset(curl);
+    if (share_)
+      curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+
+    base::AutoLock scoped_lock(lock_);
+    if (idle_handles_.size() < kMaxIdleCurlHandles) {
+      idle_handles_.push_back(curl);
+      return;
+    }
+    curl_easy_cleanup(curl);
+  }
+
+ private:
+  static void LockShare(CURL* curl,
+                        curl_lock_data data,
+                        curl_lock_access access,
+                        void* user_data) {
+    static_cast<CurlHandleCache*>(user_data)->share_locks_[data].Acquire();
+  }
+
+  static void UnlockShare(CURL* curl, curl_lock_data data, void* user_data) {
+    static_cast<CurlHandleCache*>(user_data)->share_locks_[data].Release();
+  }
+
+  base::Lock lock_;
+  std::vector<CURL*> idle_handles_;
+  CURLSH* share_;
+  base::Lock share_locks_[CURL_LOCK_DATA_LAST];
+
+  DISALLOW_COPY_AND_ASSIGN(CurlHandleCache);
+};
+
+HttpKeyFetcher::HttpKeyFetcher()
+    : timeout_in_seconds_(0), curl_handle_cache_(new CurlHandleCache) {}
 
 HttpKeyFetcher::HttpKeyFetcher(uint32_t timeout_in_seconds)
-    : timeout_in_seconds_(timeout_in_seconds) {}
+    : timeout_in_seconds_(timeout_in_seconds),
+      curl_handle_cache_(new CurlHandleCache) {}
 
 HttpKeyFetcher::~HttpKeyFetcher() {}
 
@@ -162,9 +272,8 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
                                      const std::string& data,
                                      std::string* response) {
   DCHECK(method == GET || method == POST);
-  static LibCurlInitializer lib_curl_initializer;
 
-  ScopedCurl scoped_curl;
+  ScopedCurl scoped_curl(curl_handle_cache_->Acquire());
   CURL* curl = scoped_curl.get();
   if (!curl) {
     LOG(ERROR) << "curl_easy_init() failed.";
@@ -177,6 +286,7 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
   curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_in_seconds_);
   curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
 
@@ -201,19 +311,19 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
     curl_easy_setopt(curl, CURLOPT_CAINFO, ca_file_.data());
   }
+  ScopedCurlSlist headers;
   if (method == POST) {
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
     curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, data.size());
 
-    curl_slist* chunk = nullptr;
     if (data.find("soap:Envelope") != std::string::npos) {
       // Adds Http headers for SOAP requests.
-      chunk = curl_slist_append(chunk, kXmlContentTypeHeader);
-      chunk = curl_slist_append(chunk, kSoapActionHeader);
+      headers.Append(kXmlContentTypeHeader);
+      headers.Append(kSoapActionHeader);
     } else {
-      chunk = curl_slist_append(chunk, kJsonContentTypeHeader);
+      headers.Append(kJsonContentTypeHeader);
     }
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.get());
   }
 
   if (VLOG_IS_ON(kMinLogLevelForCurlDebugFunction)) {
@@ -221,7 +331,12 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
     curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
   }
 
+  const base::TimeTicks start_time = base::TimeTicks::Now();
   CURLcode res = curl_easy_perform(curl);
+  Metrics::GetInstance()->ObserveDuration(
+      "shaka_key_fetch_seconds", "Time spent in key server requests.",
+      {{"result", res == CURLE_OK ? "success" : "failure"}},
+      base::TimeTicks::Now() - start_time);
   if (res != CURLE_OK) {
     std::string error_message = base::StringPrintf(
         "curl_easy_perform() failed: %s.", curl_easy_strerror(res));
@@ -236,6 +351,7 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
         res == CURLE_OPERATION_TIMEDOUT ? error::TIME_OUT : error::HTTP_FAILURE,
         error_message);
   }
+  curl_handle_cache_->Release(scoped_curl.release());
   return Status::OK;
 }
 
@@ -11,6 +11,8 @@
 #ifndef PACKAGER_MEDIA_BASE_HTTP_KEY_FETCHER_H_
 #define PACKAGER_MEDIA_BASE_HTTP_KEY_FETCHER_H_
 
+#include <memory>
+
 #include "packager/base/compiler_specific.h"
 #include "packager/media/base/key_fetcher.h"
 #include "packager/status.h"
@@ -23,6 +25,9 @@ namespace media {
 /// environment once constructed, but it may not be safe to create a
 /// HttpKeyFetcher object when any other thread is running due to use of
 /// curl_global_init.
+/// The connections are kept open after the requests and reused by the later
+/// requests to the same server. Requests from different threads run
+/// concurrently, each on its own connection.
 class HttpKeyFetcher : public KeyFetcher {
  public:
   /// Creates a fetcher with no timeout.
@@ -72,6 +77,8 @@ class HttpKeyFetcher : public KeyFetcher {
   }
 
  private:
+  class CurlHandleCache;
+
   enum HttpMethod {
     GET,
     POST,
@@ -87,6 +94,7 @@ class HttpKeyFetcher : public KeyFetcher {
   std::string client_cert_file_;
   std::string client_cert_private_key_file_;
   std::string client_cert_private_key_password_;
+  std::unique_ptr<CurlHandleCache> curl_handle_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(HttpKeyFetcher);
 };
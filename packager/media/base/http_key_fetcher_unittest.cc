@@ -61,6 +61,17 @@ TEST(DISABLED_HttpKeyFetcherTest, HttpFetchKeys) {
   EXPECT_EQ(kExpectedPostResponse, response);
 }
 
+TEST(DISABLED_HttpKeyFetcherTest, MultipleFetches) {
+  // The later fetches reuse the connection of the first one.
+  HttpKeyFetcher fetcher;
+  for (int i = 0; i < 3; ++i) {
+    std::string response;
+    ASSERT_OK(fetcher.FetchKeys(kTestUrl, kPostData, &response));
+    base::RemoveChars(response, "\r\n\t ", &response);
+    EXPECT_EQ(kExpectedPostResponse, response);
+  }
+}
+
 TEST(DISABLED_HttpKeyFetcherTest, InvalidUrl) {
   const char kHttpNotFound[] = "404";
   HttpKeyFetcher fetcher;
@@ -0,0 +1,74 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/init_segment_store.h"
+
+#include <openssl/sha.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/file/file.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace media {
+
+InitSegmentStore::InitSegmentStore(const std::string& store_dir)
+    : store_dir_(store_dir) {}
+
+std::string InitSegmentStore::GetFileName(const uint8_t* data,
+                                          size_t size,
+                                          const std::string& extension) const {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(data, size, digest);
+  std::string file_name = store_dir_;
+  if (!file_name.empty() && file_name.back() != '/')
+    file_name += '/';
+  file_name += base::ToLowerASCII(base::HexEncode(digest, sizeof(digest)));
+  if (!extension.empty())
+    file_name += "." + extension;
+  return file_name;
+}
+
+Status InitSegmentStore::Store(const uint8_t* data,
+                               size_t size,
+                               const std::string& extension,
+                               std::string* file_name,
+                               bool* already_stored) const {
+  DCHECK(file_name);
+  *file_name = GetFileName(data, size, extension);
+
+  // The name is the hash of the content, so a file of the same size is the
+  // same init segment, written by this or another job.
+  const bool stored =
+      File::GetFileSize(file_name->c_str()) == static_cast<int64_t>(size);
+  if (already_stored)
+    *already_stored = stored;
+  Metrics::GetInstance()->IncrementCounter(
+      stored ? "shaka_init_segment_store_hits"
+             : "shaka_init_segment_store_misses",
+      stored ? "Number of init segments found in the init segment store."
+             : "Number of init segments written to the init segment store.",
+      MetricLabels(), 1);
+  if (stored) {
+    VLOG(1) << "Init segment already stored as " << *file_name;
+    return Status::OK;
+  }
+
+  // Written atomically where supported, as concurrent jobs may store the same
+  // init segment.
+  if (!File::WriteFileAtomically(
+          file_name->c_str(),
+          std::string(reinterpret_cast<const char*>(data), size))) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot write the init segment to " + *file_name);
+  }
+  return Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,57 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_INIT_SEGMENT_STORE_H_
+#define PACKAGER_MEDIA_BASE_INIT_SEGMENT_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// Content-addressed store of init segments, shared by the jobs writing to
+/// the same directory. Many outputs have byte-identical init segments, e.g.
+/// the renditions of a catalog with the same codec configuration and key, so
+/// an init segment is written once, named after the hash of its content, and
+/// referenced by all the manifests.
+class InitSegmentStore {
+ public:
+  /// @param store_dir is the directory of the store, which may be any file
+  ///        type supporting reads, e.g. a local directory. It should be
+  ///        addressable from the manifests, e.g. relative to them.
+  explicit InitSegmentStore(const std::string& store_dir);
+
+  /// @return the name of the init segment with @a data in the store.
+  /// @param extension is the extension of the file name, e.g. "mp4".
+  std::string GetFileName(const uint8_t* data,
+                          size_t size,
+                          const std::string& extension) const;
+
+  /// Store the init segment @a data, unless it is already in the store.
+  /// @param[out] file_name is set to the name of the init segment in the
+  ///             store on success.
+  /// @param[out] already_stored, if not null, is set to true if the init
+  ///             segment was already in the store and was not written again.
+  /// @return OK on success, an error status otherwise.
+  Status Store(const uint8_t* data,
+               size_t size,
+               const std::string& extension,
+               std::string* file_name,
+               bool* already_stored) const;
+
+ private:
+  const std::string store_dir_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_INIT_SEGMENT_STORE_H_
@@ -0,0 +1,69 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/init_segment_store.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint8_t kInitSegment[] = {'f', 't', 'y', 'p', 'm', 'o', 'o', 'v'};
+const uint8_t kOtherInitSegment[] = {'f', 't', 'y', 'p'};
+
+}  // namespace
+
+class InitSegmentStoreTest : public testing::Test {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  InitSegmentStore store_{"memory://store"};
+};
+
+TEST_F(InitSegmentStoreTest, StoresOnce) {
+  std::string file_name;
+  bool already_stored = true;
+  ASSERT_TRUE(store_
+                  .Store(kInitSegment, sizeof(kInitSegment), "mp4", &file_name,
+                         &already_stored)
+                  .ok());
+  EXPECT_FALSE(already_stored);
+  EXPECT_EQ(0u, file_name.find("memory://store/"));
+  EXPECT_EQ(".mp4", file_name.substr(file_name.size() - 4));
+
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(file_name.c_str(), &content));
+  EXPECT_EQ(std::string(std::begin(kInitSegment), std::end(kInitSegment)),
+            content);
+
+  // Another job storing the same init segment gets the same name.
+  std::string second_file_name;
+  ASSERT_TRUE(store_
+                  .Store(kInitSegment, sizeof(kInitSegment), "mp4",
+                         &second_file_name, &already_stored)
+                  .ok());
+  EXPECT_TRUE(already_stored);
+  EXPECT_EQ(file_name, second_file_name);
+}
+
+TEST_F(InitSegmentStoreTest, NamedAfterContent) {
+  const std::string file_name =
+      store_.GetFileName(kInitSegment, sizeof(kInitSegment), "mp4");
+  EXPECT_EQ(file_name,
+            InitSegmentStore("memory://store/")
+                .GetFileName(kInitSegment, sizeof(kInitSegment), "mp4"));
+  EXPECT_NE(file_name, store_.GetFileName(kOtherInitSegment,
+                                          sizeof(kOtherInitSegment), "mp4"));
+  // "memory://store/" and 64 hex digits of the SHA-256 hash.
+  EXPECT_EQ(15u + 64u + 4u, file_name.size());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,253 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/key_cache.h"
+
+#include <openssl/aead.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/file/file.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kNonceSize = 12;
+
+const EVP_AEAD* GetAead(size_t key_size) {
+  switch (key_size) {
+    case 16:
+      return EVP_aead_aes_128_gcm();
+    case 32:
+      return EVP_aead_aes_256_gcm();
+    default:
+      return nullptr;
+  }
+}
+
+std::string GetPersistentEntryFileName(const std::string& directory,
+                                       const std::string& key) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(key.data()), key.size(), digest);
+  std::string file_name = directory;
+  if (file_name.back() != '/')
+    file_name += '/';
+  return file_name +
+         base::ToLowerASCII(base::HexEncode(digest, sizeof(digest)));
+}
+
+// The file contains the nonce followed by the sealed expiration time, in
+// microseconds since the Unix epoch, and response. The key of the entry is the
+// additional data, so an entry is not read back for another key.
+bool ReadPersistentEntry(const std::string& directory,
+                         const std::vector<uint8_t>& encryption_key,
+                         const std::string& key,
+                         std::string* response,
+                         base::TimeDelta* time_to_live) {
+  const std::string file_name = GetPersistentEntryFileName(directory, key);
+  std::string contents;
+  if (!File::ReadFileToString(file_name.c_str(), &contents))
+    return false;
+  if (contents.size() < kNonceSize) {
+    LOG(WARNING) << "Ignoring truncated key cache entry " << file_name;
+    return false;
+  }
+
+  bssl::ScopedEVP_AEAD_CTX ctx;
+  if (!EVP_AEAD_CTX_init(ctx.get(), GetAead(encryption_key.size()),
+                         encryption_key.data(), encryption_key.size(),
+                         EVP_AEAD_DEFAULT_TAG_LENGTH, nullptr)) {
+    return false;
+  }
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(contents.data());
+  std::vector<uint8_t> plaintext(contents.size() - kNonceSize);
+  size_t plaintext_size = 0;
+  if (!EVP_AEAD_CTX_open(ctx.get(), plaintext.data(), &plaintext_size,
+                         plaintext.size(), data, kNonceSize, data + kNonceSize,
+                         contents.size() - kNonceSize,
+                         reinterpret_cast<const uint8_t*>(key.data()),
+                         key.size())) {
+    LOG(WARNING) << "Ignoring key cache entry " << file_name
+                 << " which cannot be decrypted.";
+    return false;
+  }
+
+  BufferReader reader(plaintext.data(), plaintext_size);
+  int64_t expiration_time_us = 0;
+  if (!reader.Read8s(&expiration_time_us))
+    return false;
+  const base::TimeDelta remaining =
+      base::Time::UnixEpoch() +
+      base::TimeDelta::FromMicroseconds(expiration_time_us) -
+      base::Time::Now();
+  if (remaining <= base::TimeDelta()) {
+    VLOG(1) << "Persisted key cache entry expired: " << key;
+    return false;
+  }
+  response->assign(plaintext.begin() + reader.pos(),
+                   plaintext.begin() + plaintext_size);
+  *time_to_live = remaining;
+  return true;
+}
+
+void WritePersistentEntry(const std::string& directory,
+                          const std::vector<uint8_t>& encryption_key,
+                          const std::string& key,
+                          const std::string& response,
+                          base::TimeDelta time_to_live) {
+  BufferWriter plaintext;
+  plaintext.AppendInt(static_cast<int64_t>(
+      (base::Time::Now() + time_to_live - base::Time::UnixEpoch())
+          .InMicroseconds()));
+  plaintext.AppendString(response);
+
+  bssl::ScopedEVP_AEAD_CTX ctx;
+  if (!EVP_AEAD_CTX_init(ctx.get(), GetAead(encryption_key.size()),
+                         encryption_key.data(), encryption_key.size(),
+                         EVP_AEAD_DEFAULT_TAG_LENGTH, nullptr)) {
+    return;
+  }
+  std::vector<uint8_t> contents(kNonceSize + plaintext.Size() +
+                                EVP_AEAD_max_overhead(EVP_AEAD_CTX_aead(
+                                    ctx.get())));
+  RAND_bytes(contents.data(), kNonceSize);
+  size_t ciphertext_size = 0;
+  if (!EVP_AEAD_CTX_seal(ctx.get(), contents.data() + kNonceSize,
+                         &ciphertext_size, contents.size() - kNonceSize,
+                         contents.data(), kNonceSize, plaintext.Buffer(),
+                         plaintext.Size(),
+                         reinterpret_cast<const uint8_t*>(key.data()),
+                         key.size())) {
+    return;
+  }
+
+  // Written atomically where supported, as concurrent processes may persist
+  // the same entry.
+  const std::string file_name = GetPersistentEntryFileName(directory, key);
+  if (!File::WriteFileAtomically(
+          file_name.c_str(),
+          std::string(contents.begin(),
+                      contents.begin() + kNonceSize + ciphertext_size))) {
+    LOG(WARNING) << "Cannot write key cache entry " << file_name;
+  }
+}
+
+}  // namespace
+
+KeyCache* KeyCache::GetInstance() {
+  static KeyCache instance;
+  return &instance;
+}
+
+Status KeyCache::Get(const std::string& key,
+                     base::TimeDelta time_to_live,
+                     const FetchFunction& fetch,
+                     std::string* response,
+                     bool* cache_hit) {
+  DCHECK(response);
+  if (cache_hit)
+    *cache_hit = false;
+
+  base::AutoLock scoped_lock(lock_);
+  while (true) {
+    auto iter = entries_.find(key);
+    if (iter == entries_.end())
+      break;
+    if (iter->second.in_flight) {
+      fetch_done_.Wait();
+      continue;
+    }
+    if (iter->second.expiration_time > base::TimeTicks::Now()) {
+      VLOG(1) << "Key cache hit: " << key;
+      *response = iter->second.response;
+      if (cache_hit)
+        *cache_hit = true;
+      return Status::OK;
+    }
+    entries_.erase(iter);
+    break;
+  }
+  entries_[key].in_flight = true;
+
+  const std::string directory = persistent_store_directory_;
+  const std::vector<uint8_t> encryption_key = persistent_store_key_;
+  base::TimeDelta entry_time_to_live = time_to_live;
+  Status status;
+  {
+    base::AutoUnlock scoped_unlock(lock_);
+    if (!directory.empty() &&
+        ReadPersistentEntry(directory, encryption_key, key, response,
+                            &entry_time_to_live)) {
+      VLOG(1) << "Persisted key cache hit: " << key;
+      if (cache_hit)
+        *cache_hit = true;
+    } else {
+      status = fetch(response);
+      if (status.ok() && !directory.empty() && time_to_live > base::TimeDelta())
+        WritePersistentEntry(directory, encryption_key, key, *response,
+                             time_to_live);
+    }
+  }
+
+  const base::TimeTicks now = base::TimeTicks::Now();
+  if (status.ok()) {
+    Entry& entry = entries_[key];
+    entry.in_flight = false;
+    entry.response = *response;
+    entry.expiration_time = now + entry_time_to_live;
+  } else {
+    entries_.erase(key);
+  }
+  RemoveExpiredEntries(now);
+  fetch_done_.Broadcast();
+  return status;
+}
+
+void KeyCache::Clear() {
+  base::AutoLock scoped_lock(lock_);
+  for (auto iter = entries_.begin(); iter != entries_.end();) {
+    if (iter->second.in_flight)
+      ++iter;
+    else
+      iter = entries_.erase(iter);
+  }
+}
+
+bool KeyCache::SetPersistentStore(const std::string& directory,
+                                  const std::vector<uint8_t>& encryption_key) {
+  if (!directory.empty() && !GetAead(encryption_key.size())) {
+    LOG(ERROR) << "The key cache encryption key must be 16 or 32 bytes, got "
+               << encryption_key.size() << " bytes.";
+    return false;
+  }
+  base::AutoLock scoped_lock(lock_);
+  persistent_store_directory_ = directory;
+  persistent_store_key_ = encryption_key;
+  return true;
+}
+
+KeyCache::KeyCache() : fetch_done_(&lock_) {}
+
+KeyCache::~KeyCache() {}
+
+void KeyCache::RemoveExpiredEntries(base::TimeTicks now) {
+  lock_.AssertAcquired();
+  for (auto iter = entries_.begin(); iter != entries_.end();) {
+    if (!iter->second.in_flight && iter->second.expiration_time <= now)
+      iter = entries_.erase(iter);
+    else
+      ++iter;
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,96 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_KEY_CACHE_H_
+#define PACKAGER_MEDIA_BASE_KEY_CACHE_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// A process-wide cache of key server responses, shared by the key sources of
+/// all the packager instances in the process. Entries expire after a time to
+/// live. Concurrent fetches of the same entry are deduplicated: only one of
+/// the callers fetches the response, while the others wait for its result.
+/// Optionally, the responses are also persisted to a directory, encrypted, so
+/// that later processes re-packaging the same content skip the fetches.
+class KeyCache {
+ public:
+  /// Fetches the response into |response|. Returns OK on success.
+  typedef std::function<Status(std::string* response)> FetchFunction;
+
+  /// @return the process-wide instance.
+  static KeyCache* GetInstance();
+
+  /// Get the response cached with |key|, or fetch it with |fetch| if there is
+  /// no unexpired response. Failed fetches are not cached; callers waiting on
+  /// a failed fetch retry it themselves.
+  /// @param key identifies the request, e.g. the server url and the request.
+  /// @param time_to_live is how long a fetched response is cached.
+  /// @param fetch fetches the response on a cache miss. It is called without
+  ///        holding the cache lock.
+  /// @param[out] response contains the response on success.
+  /// @param[out] cache_hit, if not null, is set to true if the response was
+  ///        not fetched by this call, false otherwise.
+  /// @return OK on success, the error returned by @a fetch otherwise.
+  Status Get(const std::string& key,
+             base::TimeDelta time_to_live,
+             const FetchFunction& fetch,
+             std::string* response,
+             bool* cache_hit);
+
+  /// Remove all the entries, except the ones being fetched.
+  void Clear();
+
+  /// Also keep the responses in @a directory, one file per entry named after
+  /// the hash of its key, encrypted and authenticated with AES-GCM. The files
+  /// keep the expiration time of the entries. An empty @a directory disables
+  /// the persistent store.
+  /// @param directory is the directory of the entries, on any File type.
+  /// @param encryption_key is the AES key of the entries, 16 or 32 bytes.
+  /// @return false if @a encryption_key has an invalid size.
+  bool SetPersistentStore(const std::string& directory,
+                          const std::vector<uint8_t>& encryption_key);
+
+ private:
+  struct Entry {
+    bool in_flight = false;
+    std::string response;
+    base::TimeTicks expiration_time;
+  };
+
+  KeyCache();
+  ~KeyCache();
+
+  // Remove the expired entries.
+  void RemoveExpiredEntries(base::TimeTicks now);
+
+  base::Lock lock_;
+  std::string persistent_store_directory_;
+  std::vector<uint8_t> persistent_store_key_;
+  // Signaled when an in-flight fetch completes.
+  base::ConditionVariable fetch_done_;
+  std::map<std::string, Entry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyCache);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_KEY_CACHE_H_
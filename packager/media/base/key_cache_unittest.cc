@@ -0,0 +1,201 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/key_cache.h"
+
+#include <gtest/gtest.h>
+#include <openssl/sha.h>
+#include <string.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kKey[] = "key";
+const char kResponse[] = "response";
+const int64_t kTimeToLiveInSeconds = 60;
+const char kPersistentStoreDirectory[] = "memory://key_cache";
+const uint8_t kPersistentStoreKey[] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+
+}  // namespace
+
+class KeyCacheTest : public ::testing::Test {
+ public:
+  KeyCacheTest()
+      : fetch_started_(base::WaitableEvent::ResetPolicy::MANUAL,
+                       base::WaitableEvent::InitialState::NOT_SIGNALED),
+        fetch_released_(base::WaitableEvent::ResetPolicy::MANUAL,
+                        base::WaitableEvent::InitialState::SIGNALED) {}
+
+  void SetUp() override { KeyCache::GetInstance()->Clear(); }
+  void TearDown() override {
+    KeyCache::GetInstance()->Clear();
+    ASSERT_TRUE(
+        KeyCache::GetInstance()->SetPersistentStore("", std::vector<uint8_t>()));
+    MemoryFile::DeleteAll();
+  }
+
+  Status Fetch(std::string* response) {
+    ++num_fetches_;
+    fetch_started_.Signal();
+    fetch_released_.Wait();
+    *response = kResponse;
+    return fetch_status_;
+  }
+
+  Status Get(base::TimeDelta time_to_live,
+             std::string* response,
+             bool* cache_hit) {
+    return KeyCache::GetInstance()->Get(
+        kKey, time_to_live,
+        [this](std::string* response) { return Fetch(response); }, response,
+        cache_hit);
+  }
+
+  void GetInThread() {
+    std::string response;
+    ASSERT_OK(Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds),
+                  &response, nullptr));
+    EXPECT_EQ(kResponse, response);
+  }
+
+ protected:
+  base::WaitableEvent fetch_started_;
+  base::WaitableEvent fetch_released_;
+  Status fetch_status_;
+  int num_fetches_ = 0;
+};
+
+TEST_F(KeyCacheTest, CacheHit) {
+  std::string response;
+  bool cache_hit = true;
+  ASSERT_OK(Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds), &response,
+                &cache_hit));
+  EXPECT_EQ(kResponse, response);
+  EXPECT_FALSE(cache_hit);
+
+  response.clear();
+  ASSERT_OK(Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds), &response,
+                &cache_hit));
+  EXPECT_EQ(kResponse, response);
+  EXPECT_TRUE(cache_hit);
+  EXPECT_EQ(1, num_fetches_);
+}
+
+TEST_F(KeyCacheTest, Expired) {
+  std::string response;
+  bool cache_hit = true;
+  ASSERT_OK(Get(base::TimeDelta(), &response, &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  ASSERT_OK(Get(base::TimeDelta(), &response, &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  EXPECT_EQ(2, num_fetches_);
+}
+
+TEST_F(KeyCacheTest, FailedFetchIsNotCached) {
+  fetch_status_ = Status(error::SERVER_ERROR, "");
+  std::string response;
+  EXPECT_EQ(error::SERVER_ERROR,
+            Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds), &response,
+                nullptr)
+                .error_code());
+
+  fetch_status_ = Status::OK;
+  bool cache_hit = true;
+  ASSERT_OK(Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds), &response,
+                &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  EXPECT_EQ(2, num_fetches_);
+}
+
+TEST_F(KeyCacheTest, ConcurrentFetchesAreDeduplicated) {
+  fetch_released_.Reset();
+  ClosureThread thread1(
+      "KeyCacheTest1",
+      base::Bind(&KeyCacheTest::GetInThread, base::Unretained(this)));
+  ClosureThread thread2(
+      "KeyCacheTest2",
+      base::Bind(&KeyCacheTest::GetInThread, base::Unretained(this)));
+  thread1.Start();
+  fetch_started_.Wait();
+  thread2.Start();
+  fetch_released_.Signal();
+  thread1.Join();
+  thread2.Join();
+  EXPECT_EQ(1, num_fetches_);
+}
+
+TEST_F(KeyCacheTest, PersistentStore) {
+  const std::vector<uint8_t> encryption_key(std::begin(kPersistentStoreKey),
+                                            std::end(kPersistentStoreKey));
+  ASSERT_TRUE(KeyCache::GetInstance()->SetPersistentStore(
+      kPersistentStoreDirectory, encryption_key));
+  std::string response;
+  bool cache_hit = true;
+  ASSERT_OK(Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds), &response,
+                &cache_hit));
+  EXPECT_FALSE(cache_hit);
+
+  // As if re-packaging in another process.
+  KeyCache::GetInstance()->Clear();
+  response.clear();
+  ASSERT_OK(Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds), &response,
+                &cache_hit));
+  EXPECT_EQ(kResponse, response);
+  EXPECT_TRUE(cache_hit);
+  EXPECT_EQ(1, num_fetches_);
+}
+
+TEST_F(KeyCacheTest, PersistentStoreIsEncrypted) {
+  std::vector<uint8_t> encryption_key(std::begin(kPersistentStoreKey),
+                                      std::end(kPersistentStoreKey));
+  ASSERT_TRUE(KeyCache::GetInstance()->SetPersistentStore(
+      kPersistentStoreDirectory, encryption_key));
+  std::string response;
+  ASSERT_OK(Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds), &response,
+                nullptr));
+
+  // The entries are named after the hash of their key.
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(kKey), strlen(kKey), digest);
+  const std::string file_name =
+      std::string(kPersistentStoreDirectory) + "/" +
+      base::ToLowerASCII(base::HexEncode(digest, sizeof(digest)));
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(file_name.c_str(), &contents));
+  EXPECT_EQ(std::string::npos, contents.find(kResponse));
+
+  // Not readable with another key.
+  encryption_key[0] ^= 1;
+  ASSERT_TRUE(KeyCache::GetInstance()->SetPersistentStore(
+      kPersistentStoreDirectory, encryption_key));
+  KeyCache::GetInstance()->Clear();
+  bool cache_hit = true;
+  ASSERT_OK(Get(base::TimeDelta::FromSeconds(kTimeToLiveInSeconds), &response,
+                &cache_hit));
+  EXPECT_FALSE(cache_hit);
+  EXPECT_EQ(2, num_fetches_);
+}
+
+TEST_F(KeyCacheTest, PersistentStoreInvalidKey) {
+  EXPECT_FALSE(KeyCache::GetInstance()->SetPersistentStore(
+      kPersistentStoreDirectory, std::vector<uint8_t>(10)));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -13,5 +13,7 @@ KeySource::KeySource() = default;
 
 KeySource::~KeySource() = default;
 
+void KeySource::Cancel() {}
+
 }  // namespace media
 }  // namespace shaka
@@ -91,6 +91,11 @@ class KeySource {
                                     const std::string& stream_label,
                                     EncryptionKey* key) = 0;
 
+  /// Unblock the calls waiting for keys which are not available yet, which
+  /// then fail, as do the next ones. Used to cancel packaging promptly. Can be
+  /// called from any thread. The default implementation does nothing.
+  virtual void Cancel();
+
  private:
   DISALLOW_COPY_AND_ASSIGN(KeySource);
 };
@@ -0,0 +1,99 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/load_shedder.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/video_stream_info.h"
+
+namespace shaka {
+namespace media {
+
+LoadShedder::LoadShedder(base::TimeDelta max_lag,
+                         const ShedCallback& shed_callback)
+    : max_lag_(max_lag), shed_callback_(shed_callback) {
+  DCHECK_GT(max_lag_, base::TimeDelta());
+}
+
+LoadShedder::~LoadShedder() {}
+
+int LoadShedder::AddOutput(const std::string& name, const StreamInfo& info) {
+  Output output{name, kNeverShed, 0, false};
+  if (info.stream_type() == kStreamText) {
+    output.rank = kText;
+  } else if (info.stream_type() == kStreamVideo) {
+    const VideoStreamInfo& video_info =
+        static_cast<const VideoStreamInfo&>(info);
+    output.rank = video_info.trick_play_factor() > 0 ? kTrickPlay : kVideo;
+    output.pixels = static_cast<uint64_t>(video_info.width()) *
+                    video_info.height();
+  }
+
+  base::AutoLock auto_lock(lock_);
+  outputs_.push_back(output);
+  return static_cast<int>(outputs_.size() - 1);
+}
+
+void LoadShedder::ReportLag(int output_id,
+                            base::TimeDelta lag,
+                            base::Time now) {
+  if (lag <= max_lag_)
+    return;
+
+  std::string lagging_output;
+  std::string shed_output;
+  {
+    base::AutoLock auto_lock(lock_);
+    DCHECK_LT(static_cast<size_t>(output_id), outputs_.size());
+    // Let the lag settle after the previous output was shed.
+    if (!last_shed_time_.is_null() && now - last_shed_time_ < max_lag_)
+      return;
+    const int index = NextOutputToShed();
+    if (index < 0)
+      return;
+    outputs_[index].shed = true;
+    last_shed_time_ = now;
+    lagging_output = outputs_[output_id].name;
+    shed_output = outputs_[index].name;
+  }
+
+  LOG(WARNING) << "Output " << lagging_output << " lags by "
+               << lag.InSecondsF() << " seconds. Stopping output "
+               << shed_output << ".";
+  if (shed_callback_)
+    shed_callback_(shed_output, lag.InSecondsF());
+}
+
+bool LoadShedder::IsShed(int output_id) const {
+  base::AutoLock auto_lock(lock_);
+  DCHECK_LT(static_cast<size_t>(output_id), outputs_.size());
+  return outputs_[output_id].shed;
+}
+
+int LoadShedder::NextOutputToShed() const {
+  lock_.AssertAcquired();
+  int next = -1;
+  int num_video_outputs = 0;
+  for (size_t i = 0; i < outputs_.size(); ++i) {
+    const Output& output = outputs_[i];
+    if (output.shed || output.rank == kNeverShed)
+      continue;
+    if (output.rank == kVideo)
+      ++num_video_outputs;
+    if (next < 0 || output.rank < outputs_[next].rank ||
+        (output.rank == outputs_[next].rank &&
+         output.pixels < outputs_[next].pixels)) {
+      next = static_cast<int>(i);
+    }
+  }
+  // Keep the highest video rendition.
+  if (next >= 0 && outputs_[next].rank == kVideo && num_video_outputs < 2)
+    return -1;
+  return next;
+}
+
+}  // namespace media
+}  // namespace shaka
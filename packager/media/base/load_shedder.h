@@ -0,0 +1,85 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_LOAD_SHEDDER_H_
+#define PACKAGER_MEDIA_BASE_LOAD_SHEDDER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+
+class StreamInfo;
+
+/// Decides which outputs of a live job to stop when the job falls behind real
+/// time, see LoadSheddingParams. The muxers report the lag of their output at
+/// every segment and stop writing once their output is shed. Thread safe.
+class LoadShedder {
+ public:
+  typedef std::function<void(const std::string& output, double lag_in_seconds)>
+      ShedCallback;
+
+  /// @param max_lag is the lag above which an output is shed, at most once
+  ///        every @a max_lag.
+  /// @param shed_callback is called, if set, when an output is shed.
+  LoadShedder(base::TimeDelta max_lag, const ShedCallback& shed_callback);
+  ~LoadShedder();
+
+  /// Register an output.
+  /// @param name identifies the output in the logs and the callback.
+  /// @param info is the stream of the output.
+  /// @return the id of the output.
+  int AddOutput(const std::string& name, const StreamInfo& info);
+
+  /// Report the lag of an output, which may shed an output, not necessarily
+  /// this one.
+  /// @param now is the wall clock time of the report.
+  void ReportLag(int output_id, base::TimeDelta lag, base::Time now);
+
+  /// @return true if the output was shed.
+  bool IsShed(int output_id) const;
+
+ private:
+  LoadShedder(const LoadShedder&) = delete;
+  LoadShedder& operator=(const LoadShedder&) = delete;
+
+  // The outputs are shed by increasing rank, then by increasing number of
+  // pixels.
+  enum Rank {
+    kTrickPlay,
+    kText,
+    kVideo,
+    kNeverShed,
+  };
+
+  struct Output {
+    std::string name;
+    Rank rank;
+    uint64_t pixels;
+    bool shed;
+  };
+
+  // @return the index of the next output to shed, or -1 if there is none.
+  // Called with |lock_| held.
+  int NextOutputToShed() const;
+
+  const base::TimeDelta max_lag_;
+  const ShedCallback shed_callback_;
+
+  mutable base::Lock lock_;
+  std::vector<Output> outputs_;
+  base::Time last_shed_time_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_LOAD_SHEDDER_H_
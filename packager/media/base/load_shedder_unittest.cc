@@ -0,0 +1,129 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/load_shedder.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/text_stream_info.h"
+#include "packager/media/base/video_stream_info.h"
+
+using ::testing::_;
+using ::testing::MockFunction;
+using ::testing::StrEq;
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int kTrackId = 1;
+const uint32_t kTimeScale = 1000;
+const uint64_t kDuration = 0;
+const base::TimeDelta kMaxLag = base::TimeDelta::FromSeconds(4);
+const base::TimeDelta kSmallLag = base::TimeDelta::FromSeconds(1);
+const base::TimeDelta kLargeLag = base::TimeDelta::FromSeconds(5);
+
+VideoStreamInfo GetVideoStreamInfo(uint16_t width,
+                                   uint16_t height,
+                                   uint32_t trick_play_factor) {
+  return VideoStreamInfo(
+      kTrackId, kTimeScale, kDuration, kCodecH264,
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus, "avc1",
+      nullptr, 0, width, height, 1, 1, 0, trick_play_factor, 4, "", false);
+}
+
+AudioStreamInfo GetAudioStreamInfo() {
+  return AudioStreamInfo(kTrackId, kTimeScale, kDuration, kCodecAAC, "mp4a",
+                         nullptr, 0, 16, 2, 44100, 0, 0, 0, 0, "", false);
+}
+
+TextStreamInfo GetTextStreamInfo() {
+  return TextStreamInfo(kTrackId, kTimeScale, kDuration, kCodecWebVtt, "wvtt",
+                        "", 0, 0, "");
+}
+
+}  // namespace
+
+class LoadShedderTest : public ::testing::Test {
+ protected:
+  LoadShedderTest()
+      : load_shedder_(kMaxLag, shed_callback_.AsStdFunction()),
+        now_(base::Time::Now()) {}
+
+  // Reports a large lag once the previous shed settled.
+  void ReportLargeLag(int output_id) {
+    now_ += kMaxLag;
+    load_shedder_.ReportLag(output_id, kLargeLag, now_);
+  }
+
+  MockFunction<void(const std::string& output, double lag_in_seconds)>
+      shed_callback_;
+  LoadShedder load_shedder_;
+  base::Time now_;
+};
+
+TEST_F(LoadShedderTest, NoShedBelowMaxLag) {
+  const int video_sd = load_shedder_.AddOutput(
+      "video_sd", GetVideoStreamInfo(640, 360, 0));
+  load_shedder_.AddOutput("video_hd", GetVideoStreamInfo(1280, 720, 0));
+
+  EXPECT_CALL(shed_callback_, Call(_, _)).Times(0);
+  load_shedder_.ReportLag(video_sd, kSmallLag, now_);
+  load_shedder_.ReportLag(video_sd, kMaxLag, now_);
+  EXPECT_FALSE(load_shedder_.IsShed(video_sd));
+}
+
+TEST_F(LoadShedderTest, ShedOrder) {
+  const int audio = load_shedder_.AddOutput("audio", GetAudioStreamInfo());
+  const int video_hd =
+      load_shedder_.AddOutput("video_hd", GetVideoStreamInfo(1280, 720, 0));
+  const int text = load_shedder_.AddOutput("text", GetTextStreamInfo());
+  const int video_sd =
+      load_shedder_.AddOutput("video_sd", GetVideoStreamInfo(640, 360, 0));
+  const int trick_play =
+      load_shedder_.AddOutput("trick_play", GetVideoStreamInfo(640, 360, 4));
+
+  {
+    ::testing::InSequence in_sequence;
+    EXPECT_CALL(shed_callback_,
+                Call(StrEq("trick_play"), kLargeLag.InSecondsF()));
+    EXPECT_CALL(shed_callback_, Call(StrEq("text"), kLargeLag.InSecondsF()));
+    EXPECT_CALL(shed_callback_,
+                Call(StrEq("video_sd"), kLargeLag.InSecondsF()));
+  }
+
+  ReportLargeLag(audio);
+  EXPECT_TRUE(load_shedder_.IsShed(trick_play));
+  EXPECT_FALSE(load_shedder_.IsShed(text));
+  ReportLargeLag(audio);
+  EXPECT_TRUE(load_shedder_.IsShed(text));
+  ReportLargeLag(video_hd);
+  EXPECT_TRUE(load_shedder_.IsShed(video_sd));
+
+  // The audio and the highest video rendition are kept.
+  ReportLargeLag(audio);
+  EXPECT_FALSE(load_shedder_.IsShed(audio));
+  EXPECT_FALSE(load_shedder_.IsShed(video_hd));
+}
+
+TEST_F(LoadShedderTest, WaitForLagToSettle) {
+  load_shedder_.AddOutput("text", GetTextStreamInfo());
+  const int trick_play =
+      load_shedder_.AddOutput("trick_play", GetVideoStreamInfo(640, 360, 4));
+
+  EXPECT_CALL(shed_callback_, Call(StrEq("trick_play"), _));
+  load_shedder_.ReportLag(trick_play, kLargeLag, now_);
+  // Too early to shed another output.
+  load_shedder_.ReportLag(trick_play, kLargeLag, now_ + kSmallLag);
+
+  EXPECT_CALL(shed_callback_, Call(StrEq("text"), _));
+  load_shedder_.ReportLag(trick_play, kLargeLag, now_ + kMaxLag);
+}
+
+}  // namespace media
+}  // namespace shaka
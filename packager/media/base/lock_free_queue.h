@@ -0,0 +1,317 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_LOCK_FREE_QUEUE_H_
+#define PACKAGER_MEDIA_BASE_LOCK_FREE_QUEUE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/timer/elapsed_timer.h"
+#include "packager/media/base/producer_consumer_queue.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// A bounded multi-producer multi-consumer queue. Push and Pop do not take any
+/// lock as long as the queue is neither full nor empty: an element is handed
+/// over through a slot of a ring buffer, which is claimed with a single atomic
+/// compare-and-swap (Dmitry Vyukov's bounded MPMC queue). Only a caller that
+/// has to wait blocks on a condition variable, after spinning briefly.
+/// It has the same Push / Pop / Stop semantics as ProducerConsumerQueue, but
+/// it does not track element positions, so there is no Peek.
+template <class T>
+class LockFreeQueue {
+ public:
+  /// @param capacity is the maximum number of elements that the queue can hold
+  ///        at once. It must not be zero. It is rounded up to a power of two.
+  explicit LockFreeQueue(size_t capacity);
+
+  ~LockFreeQueue() {}
+
+  /// Push an element to the back of the queue. If the queue has reached its
+  /// capacity limit, block until spare capacity is available or time out or
+  /// stopped.
+  /// @param element refers the element to be pushed.
+  /// @param timeout_ms indicates timeout in milliseconds. A value of zero means
+  ///        return immediately. A negative value means waiting indefinitely.
+  /// @return OK if the element was pushed successfully, STOPPED if Stop has
+  ///         has been called, TIME_OUT if times out.
+  Status Push(const T& element, int64_t timeout_ms);
+
+  /// Pop an element from the front of the queue. If the queue is empty, block
+  /// for an element to be available to be consumed or time out or stopped.
+  /// @param[out] element receives the popped element.
+  /// @param timeout_ms indicates timeout in milliseconds. A value of zero means
+  ///        return immediately. A negative value means waiting indefinitely.
+  /// @return STOPPED if Stop has been called and the queue is completely empty,
+  ///         TIME_OUT if times out, OK otherwise.
+  Status Pop(T* element, int64_t timeout_ms);
+
+  /// Push an element without blocking.
+  /// @return true if the element was pushed, false if the queue is full.
+  ///         The element is pushed even if the queue has been stopped.
+  bool TryPush(const T& element);
+
+  /// Pop an element without blocking.
+  /// @return true if an element was popped, false if the queue is empty.
+  bool TryPop(T* element);
+
+  /// Terminate Pop requests once the queue drains entirely.
+  /// Also terminate all waiting and future Push requests immediately.
+  /// Stop cannot stall.
+  void Stop() {
+    stop_requested_.store(true);
+    base::AutoLock l(lock_);
+    not_empty_cv_.Broadcast();
+    not_full_cv_.Broadcast();
+  }
+
+  /// @return true if there are no elements in the queue.
+  bool Empty() const { return Size() == 0; }
+
+  /// @return The number of elements in the queue. The value may be outdated
+  ///         as soon as it is returned if other threads access the queue.
+  size_t Size() const {
+    const size_t dequeue_pos = dequeue_pos_.load(std::memory_order_acquire);
+    const size_t enqueue_pos = enqueue_pos_.load(std::memory_order_acquire);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+
+  /// @return The maximum number of elements that the queue can hold at once.
+  size_t capacity() const { return mask_ + 1; }
+
+  /// @return true if the queue has been stopped using Stop(). This allows
+  ///         producers to check if they can add new elements to the queue.
+  bool Stopped() const { return stop_requested_.load(); }
+
+ private:
+  struct Cell {
+    // Equals to the position of the next push into this cell when the cell is
+    // free, or to the position plus one when it holds an element.
+    std::atomic<size_t> sequence;
+    T element;
+  };
+
+  // Keeps the positions, which are updated by producers and consumers
+  // respectively, on separate cache lines.
+  static const size_t kCacheLineSize = 64;
+  // Number of failed attempts before a caller blocks on a condition variable.
+  static const int kNumSpins = 64;
+
+  // Call |try_operation| until it succeeds, stopped, or |timeout_ms| passes.
+  // |num_waiters| and |cv| are the waiter count and the condition variable of
+  // the operation.
+  template <class Operation>
+  Status Wait(const Operation& try_operation,
+              bool fail_if_stopped,
+              int64_t timeout_ms,
+              const char* timeout_message,
+              std::atomic<int>* num_waiters,
+              base::ConditionVariable* cv);
+
+  // Wake up a waiter, if there is any.
+  void Notify(std::atomic<int>* num_waiters, base::ConditionVariable* cv);
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  char padding0_[kCacheLineSize];
+  std::atomic<size_t> enqueue_pos_;
+  char padding1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeue_pos_;
+  char padding2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+
+  std::atomic<bool> stop_requested_;
+  // Number of producers (consumers) blocked or about to block on
+  // |not_full_cv_| (|not_empty_cv_|).
+  std::atomic<int> num_waiting_producers_;
+  std::atomic<int> num_waiting_consumers_;
+  // Only used to block and wake up waiters.
+  base::Lock lock_;
+  base::ConditionVariable not_empty_cv_;
+  base::ConditionVariable not_full_cv_;
+
+  DISALLOW_COPY_AND_ASSIGN(LockFreeQueue);
+};
+
+// Implementations of non-inline functions.
+template <class T>
+LockFreeQueue<T>::LockFreeQueue(size_t capacity)
+    : mask_([capacity]() {
+        DCHECK_GT(capacity, 0u);
+        // The algorithm needs at least two cells.
+        size_t rounded_capacity = 2;
+        while (rounded_capacity < capacity)
+          rounded_capacity *= 2;
+        return rounded_capacity - 1;
+      }()),
+      cells_(new Cell[mask_ + 1]),
+      enqueue_pos_(0),
+      dequeue_pos_(0),
+      stop_requested_(false),
+      num_waiting_producers_(0),
+      num_waiting_consumers_(0),
+      not_empty_cv_(&lock_),
+      not_full_cv_(&lock_) {
+  for (size_t i = 0; i <= mask_; ++i)
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <class T>
+bool LockFreeQueue<T>::TryPush(const T& element) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Cell* cell = nullptr;
+  while (true) {
+    cell = &cells_[pos & mask_];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff =
+        static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The cell still holds the element pushed one round earlier.
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  cell->element = element;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template <class T>
+bool LockFreeQueue<T>::TryPop(T* element) {
+  DCHECK(element);
+  size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+  Cell* cell = nullptr;
+  while (true) {
+    cell = &cells_[pos & mask_];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff =
+        static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The cell has not been pushed into yet.
+      return false;
+    } else {
+      pos = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  *element = std::move(cell->element);
+  // Do not keep resources referenced by the popped element alive.
+  cell->element = T();
+  cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+  return true;
+}
+
+template <class T>
+Status LockFreeQueue<T>::Push(const T& element, int64_t timeout_ms) {
+  Status status = Wait([this, &element]() { return TryPush(element); },
+                       true, timeout_ms, "Time out on pushing.",
+                       &num_waiting_producers_, &not_full_cv_);
+  if (!status.ok())
+    return status;
+  Notify(&num_waiting_consumers_, &not_empty_cv_);
+  return Status::OK;
+}
+
+template <class T>
+Status LockFreeQueue<T>::Pop(T* element, int64_t timeout_ms) {
+  DCHECK(element);
+  Status status = Wait([this, element]() { return TryPop(element); }, false,
+                       timeout_ms, "Time out on popping.",
+                       &num_waiting_consumers_, &not_empty_cv_);
+  if (!status.ok())
+    return status;
+  Notify(&num_waiting_producers_, &not_full_cv_);
+  return Status::OK;
+}
+
+template <class T>
+template <class Operation>
+Status LockFreeQueue<T>::Wait(const Operation& try_operation,
+                              bool fail_if_stopped,
+                              int64_t timeout_ms,
+                              const char* timeout_message,
+                              std::atomic<int>* num_waiters,
+                              base::ConditionVariable* cv) {
+  const Status kStoppedStatus(error::STOPPED, "");
+  // A Pop after Stop still returns the remaining elements, so for Pop the
+  // queue is checked for stop only after the operation has failed.
+  for (int i = 0; i < kNumSpins; ++i) {
+    if (fail_if_stopped && Stopped())
+      return kStoppedStatus;
+    if (try_operation())
+      return Status::OK;
+    if (!fail_if_stopped && Stopped() && !try_operation())
+      return kStoppedStatus;
+    if (timeout_ms == 0)
+      return Status(error::TIME_OUT, timeout_message);
+    base::PlatformThread::YieldCurrentThread();
+  }
+
+  base::ElapsedTimer timer;
+  base::AutoLock l(lock_);
+  num_waiters->fetch_add(1);
+  // Pairs with the fence in Notify(): either the operation below sees the
+  // change made by the notifier, or the notifier sees this waiter.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  Status status = Status::OK;
+  while (true) {
+    if (fail_if_stopped && Stopped()) {
+      status = kStoppedStatus;
+      break;
+    }
+    if (try_operation())
+      break;
+    if (!fail_if_stopped && Stopped() && !try_operation()) {
+      status = kStoppedStatus;
+      break;
+    }
+    if (timeout_ms < 0) {
+      cv->Wait();
+      continue;
+    }
+    const int64_t elapsed_ms = timer.Elapsed().InMilliseconds();
+    if (elapsed_ms >= timeout_ms) {
+      status = Status(error::TIME_OUT, timeout_message);
+      break;
+    }
+    cv->TimedWait(base::TimeDelta::FromMilliseconds(timeout_ms - elapsed_ms));
+  }
+  num_waiters->fetch_sub(1);
+  return status;
+}
+
+template <class T>
+void LockFreeQueue<T>::Notify(std::atomic<int>* num_waiters,
+                              base::ConditionVariable* cv) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (num_waiters->load(std::memory_order_relaxed) == 0)
+    return;
+  base::AutoLock l(lock_);
+  cv->Signal();
+}
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_LOCK_FREE_QUEUE_H_
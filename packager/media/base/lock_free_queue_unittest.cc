@@ -0,0 +1,241 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/timer/elapsed_timer.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/lock_free_queue.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace {
+const size_t kCapacity = 8u;
+const int64_t kTimeout = 100;  // 0.1s.
+const size_t kNumThreads = 4u;
+const size_t kNumElementsPerThread = 10000u;
+}  // namespace
+
+namespace media {
+
+TEST(LockFreeQueueTest, CheckEmpty) {
+  LockFreeQueue<int> queue(kCapacity);
+  EXPECT_EQ(0u, queue.Size());
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(LockFreeQueueTest, CapacityRoundedUpToPowerOfTwo) {
+  EXPECT_EQ(2u, LockFreeQueue<int>(1).capacity());
+  EXPECT_EQ(8u, LockFreeQueue<int>(8).capacity());
+  EXPECT_EQ(16u, LockFreeQueue<int>(9).capacity());
+}
+
+TEST(LockFreeQueueTest, PushPop) {
+  LockFreeQueue<size_t> queue(kCapacity);
+  // Go around the ring a few times.
+  for (size_t round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < kCapacity; ++i)
+      ASSERT_OK(queue.Push(i, kInfiniteTimeout));
+
+    EXPECT_EQ(kCapacity, queue.Size());
+    EXPECT_FALSE(queue.Empty());
+
+    for (size_t i = 0; i < kCapacity; ++i) {
+      size_t val;
+      ASSERT_OK(queue.Pop(&val, kInfiniteTimeout));
+      EXPECT_EQ(i, val);
+    }
+    EXPECT_TRUE(queue.Empty());
+  }
+}
+
+TEST(LockFreeQueueTest, TryPushTryPop) {
+  LockFreeQueue<size_t> queue(kCapacity);
+  size_t val;
+  EXPECT_FALSE(queue.TryPop(&val));
+  for (size_t i = 0; i < kCapacity; ++i)
+    ASSERT_TRUE(queue.TryPush(i));
+  EXPECT_FALSE(queue.TryPush(kCapacity));
+
+  ASSERT_TRUE(queue.TryPop(&val));
+  EXPECT_EQ(0u, val);
+  EXPECT_TRUE(queue.TryPush(kCapacity));
+}
+
+TEST(LockFreeQueueTest, PopReleasesElement) {
+  LockFreeQueue<std::shared_ptr<int>> queue(kCapacity);
+  std::shared_ptr<int> element(new int(1));
+  ASSERT_OK(queue.Push(element, kInfiniteTimeout));
+  EXPECT_EQ(2, element.use_count());
+
+  std::shared_ptr<int> popped;
+  ASSERT_OK(queue.Pop(&popped, kInfiniteTimeout));
+  popped.reset();
+  EXPECT_EQ(1, element.use_count());
+}
+
+TEST(LockFreeQueueTest, PushWithTimeout) {
+  std::unique_ptr<base::ElapsedTimer> timer;
+  LockFreeQueue<size_t> queue(kCapacity);
+
+  for (size_t i = 0; i < kCapacity; ++i) {
+    timer.reset(new base::ElapsedTimer());
+    ASSERT_OK(queue.Push(i, kTimeout));
+    // Expect Push to return without waiting for timeout.
+    EXPECT_LT(timer->Elapsed().InMilliseconds(), kTimeout);
+  }
+
+  timer.reset(new base::ElapsedTimer());
+  ASSERT_EQ(error::TIME_OUT, queue.Push(0, kTimeout).error_code());
+  EXPECT_GE(timer->Elapsed().InMilliseconds(), kTimeout);
+  ASSERT_EQ(error::TIME_OUT, queue.Push(0, 0).error_code());
+}
+
+TEST(LockFreeQueueTest, PopWithTimeout) {
+  std::unique_ptr<base::ElapsedTimer> timer;
+  LockFreeQueue<size_t> queue(kCapacity);
+
+  for (size_t i = 0; i < kCapacity; ++i)
+    ASSERT_OK(queue.Push(i, kInfiniteTimeout));
+
+  size_t val;
+  for (size_t i = 0; i < kCapacity; ++i) {
+    timer.reset(new base::ElapsedTimer());
+    ASSERT_OK(queue.Pop(&val, kTimeout));
+    // Expect Pop to return without waiting for timeout.
+    EXPECT_LT(timer->Elapsed().InMilliseconds(), kTimeout);
+    EXPECT_EQ(i, val);
+  }
+
+  timer.reset(new base::ElapsedTimer());
+  ASSERT_EQ(error::TIME_OUT, queue.Pop(&val, kTimeout).error_code());
+  EXPECT_GE(timer->Elapsed().InMilliseconds(), kTimeout);
+  ASSERT_EQ(error::TIME_OUT, queue.Pop(&val, 0).error_code());
+}
+
+TEST(LockFreeQueueTest, CheckStop) {
+  LockFreeQueue<size_t> queue(kCapacity);
+  ASSERT_FALSE(queue.Stopped());
+  ASSERT_OK(queue.Push(1, kInfiniteTimeout));
+
+  queue.Stop();
+  ASSERT_TRUE(queue.Stopped());
+  ASSERT_EQ(error::STOPPED, queue.Push(2, kInfiniteTimeout).error_code());
+
+  // The remaining element can still be popped.
+  size_t val;
+  ASSERT_OK(queue.Pop(&val, kInfiniteTimeout));
+  EXPECT_EQ(1u, val);
+  ASSERT_EQ(error::STOPPED, queue.Pop(&val, kInfiniteTimeout).error_code());
+}
+
+class MultiThreadLockFreeQueueTest : public ::testing::Test {
+ public:
+  MultiThreadLockFreeQueueTest() : queue_(kCapacity) {}
+
+  void PushTask(size_t thread_index) {
+    for (size_t i = 0; i < kNumElementsPerThread; ++i) {
+      ASSERT_OK(queue_.Push(thread_index * kNumElementsPerThread + i,
+                            kInfiniteTimeout));
+    }
+  }
+
+  void PopTask(std::vector<size_t>* popped) {
+    size_t val;
+    while (queue_.Pop(&val, kInfiniteTimeout).ok())
+      popped->push_back(val);
+  }
+
+  void WaitAndStopTask(base::WaitableEvent* event) {
+    event->Wait();
+    queue_.Stop();
+  }
+
+ protected:
+  LockFreeQueue<size_t> queue_;
+};
+
+TEST_F(MultiThreadLockFreeQueueTest, MultipleProducersMultipleConsumers) {
+  std::vector<std::unique_ptr<ClosureThread>> producers;
+  std::vector<std::unique_ptr<ClosureThread>> consumers;
+  std::vector<std::vector<size_t>> popped(kNumThreads);
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    consumers.emplace_back(new ClosureThread(
+        "PopThread", base::Bind(&MultiThreadLockFreeQueueTest::PopTask,
+                                base::Unretained(this), &popped[i])));
+    consumers.back()->Start();
+  }
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    producers.emplace_back(new ClosureThread(
+        "PushThread", base::Bind(&MultiThreadLockFreeQueueTest::PushTask,
+                                 base::Unretained(this), i)));
+    producers.back()->Start();
+  }
+  for (auto& producer : producers)
+    producer->Join();
+  queue_.Stop();
+  for (auto& consumer : consumers)
+    consumer->Join();
+
+  // Every element is popped exactly once, and the elements pushed by the same
+  // producer are popped in order.
+  std::vector<bool> seen(kNumThreads * kNumElementsPerThread, false);
+  for (const std::vector<size_t>& values : popped) {
+    std::vector<size_t> last_per_producer(kNumThreads, 0);
+    std::vector<bool> has_last(kNumThreads, false);
+    for (size_t value : values) {
+      ASSERT_LT(value, seen.size());
+      EXPECT_FALSE(seen[value]);
+      seen[value] = true;
+      const size_t producer = value / kNumElementsPerThread;
+      if (has_last[producer])
+        EXPECT_LT(last_per_producer[producer], value);
+      last_per_producer[producer] = value;
+      has_last[producer] = true;
+    }
+  }
+  for (bool value_seen : seen)
+    EXPECT_TRUE(value_seen);
+}
+
+TEST_F(MultiThreadLockFreeQueueTest, StopWakesUpBlockedPop) {
+  base::WaitableEvent event(base::WaitableEvent::ResetPolicy::MANUAL,
+                            base::WaitableEvent::InitialState::NOT_SIGNALED);
+  ClosureThread thread(
+      "StopThread", base::Bind(&MultiThreadLockFreeQueueTest::WaitAndStopTask,
+                               base::Unretained(this), &event));
+  thread.Start();
+  event.Signal();
+
+  size_t val;
+  EXPECT_EQ(error::STOPPED, queue_.Pop(&val, kInfiniteTimeout).error_code());
+  thread.Join();
+}
+
+TEST_F(MultiThreadLockFreeQueueTest, StopWakesUpBlockedPush) {
+  for (size_t i = 0; i < kCapacity; ++i)
+    ASSERT_OK(queue_.Push(i, kInfiniteTimeout));
+
+  base::WaitableEvent event(base::WaitableEvent::ResetPolicy::MANUAL,
+                            base::WaitableEvent::InitialState::NOT_SIGNALED);
+  ClosureThread thread(
+      "StopThread", base::Bind(&MultiThreadLockFreeQueueTest::WaitAndStopTask,
+                               base::Unretained(this), &event));
+  thread.Start();
+  event.Signal();
+
+  EXPECT_EQ(error::STOPPED,
+            queue_.Push(kCapacity, kInfiniteTimeout).error_code());
+  thread.Join();
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -21,16 +21,21 @@
         'aes_encryptor.h',
         'aes_pattern_cryptor.cc',
         'aes_pattern_cryptor.h',
+        'async_queue_handler.cc',
+        'async_queue_handler.h',
         'audio_stream_info.cc',
         'audio_stream_info.h',
         'audio_timestamp_helper.cc',
         'audio_timestamp_helper.h',
+        'auto_lock_all.h',
         'bit_reader.cc',
         'bit_reader.h',
         'bit_writer.cc',
         'bit_writer.h',
         'buffer_reader.cc',
         'buffer_reader.h',
+        'buffer_chain.cc',
+        'buffer_chain.h',
         'buffer_writer.cc',
         'buffer_writer.h',
         'byte_queue.cc',
@@ -39,20 +44,29 @@
         'cc_stream_filter.h',
         'closure_thread.cc',
         'closure_thread.h',
+        'coalescing_task_runner.cc',
+        'coalescing_task_runner.h',
         'common_pssh_generator.cc',
         'common_pssh_generator.h',
         'container_names.cc',
         'container_names.h',
+        'data_span.h',
         'decrypt_config.cc',
         'decrypt_config.h',
         'decryptor_source.cc',
         'decryptor_source.h',
         'encryption_config.h',
         'fourccs.h',
+        'handler_stats.cc',
+        'handler_stats.h',
         'http_key_fetcher.cc',
         'http_key_fetcher.h',
         'id3_tag.cc',
         'id3_tag.h',
+        'init_segment_store.cc',
+        'init_segment_store.h',
+        'key_cache.cc',
+        'key_cache.h',
         'key_fetcher.cc',
         'key_fetcher.h',
         'key_source.cc',
@@ -60,6 +74,9 @@
         'language_utils.cc',
         'language_utils.h',
         'limits.h',
+        'load_shedder.cc',
+        'load_shedder.h',
+        'lock_free_queue.h',
         'macros.h',
         'media_handler.cc',
         'media_handler.h',
@@ -74,6 +91,8 @@
         'muxer_util.h',
         'network_util.cc',
         'network_util.h',
+        'numa_util.cc',
+        'numa_util.h',
         'offset_byte_queue.cc',
         'offset_byte_queue.h',
         'playready_key_source.cc',
@@ -98,6 +117,8 @@
         'request_signer.h',
         'rsa_key.cc',
         'rsa_key.h',
+        'sample_buffer_pool.cc',
+        'sample_buffer_pool.h',
         'stream_info.cc',
         'stream_info.h',
         'text_muxer.cc',
@@ -117,12 +138,16 @@
         'widevine_key_source.cc',
         'widevine_key_source.h',
         'widevine_pssh_generator.cc',
-        'widevine_pssh_generator.h'
+        'widevine_pssh_generator.h',
+        'work_stealing_thread_pool.cc',
+        'work_stealing_thread_pool.h',
       ],
       'dependencies': [
         'widevine_common_encryption_proto',
         'widevine_pssh_data_proto',
         '../../base/base.gyp:base',
+        '../../file/file.gyp:file',
+        '../../metrics/metrics.gyp:metrics',
         '../../packager.gyp:status',
         '../../third_party/boringssl/boringssl.gyp:boringssl',
         '../../third_party/curl/curl.gyp:libcurl',
@@ -173,22 +198,34 @@
       'sources': [
         'aes_cryptor_unittest.cc',
         'aes_pattern_cryptor_unittest.cc',
+        'async_queue_handler_unittest.cc',
         'audio_timestamp_helper_unittest.cc',
         'bit_reader_unittest.cc',
         'bit_writer_unittest.cc',
+        'buffer_chain_unittest.cc',
         'buffer_writer_unittest.cc',
+        'byte_queue_unittest.cc',
         'closure_thread_unittest.cc',
+        'coalescing_task_runner_unittest.cc',
         'container_names_unittest.cc',
         'decryptor_source_unittest.cc',
+        'handler_stats_unittest.cc',
         'http_key_fetcher_unittest.cc',
         'id3_tag_unittest.cc',
+        'init_segment_store_unittest.cc',
+        'key_cache_unittest.cc',
+        'load_shedder_unittest.cc',
+        'lock_free_queue_unittest.cc',
+        'muxer_unittest.cc',
         'muxer_util_unittest.cc',
+        'numa_util_unittest.cc',
         'offset_byte_queue_unittest.cc',
         'producer_consumer_queue_unittest.cc',
         'protection_system_specific_info_unittest.cc',
         'pssh_generator_unittest.cc',
         'raw_key_source_unittest.cc',
         'rsa_key_unittest.cc',
+        'sample_buffer_pool_unittest.cc',
         'status_test_util_unittest.cc',
         'test/fake_prng.cc',  # For rsa_key_unittest
         'test/fake_prng.h',   # For rsa_key_unittest
@@ -196,14 +233,18 @@
         'test/rsa_test_data.h',   # For rsa_key_unittest
         'video_util_unittest.cc',
         'widevine_key_source_unittest.cc',
+        'work_stealing_thread_pool_unittest.cc',
       ],
       'dependencies': [
         '../../file/file.gyp:file',
+        '../../metrics/metrics.gyp:metrics',
         '../../testing/gmock.gyp:gmock',
         '../../testing/gtest.gyp:gtest',
         '../../third_party/boringssl/boringssl.gyp:boringssl',
+        '../../third_party/gflags/gflags.gyp:gflags',
         '../test/media_test.gyp:media_test_support',
         'media_base',
+        'media_handler_test_base',
       ],
     },
   ],
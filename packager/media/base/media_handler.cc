@@ -6,10 +6,78 @@
 
 #include "packager/media/base/media_handler.h"
 
+#include "packager/base/time/time.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
 namespace media {
+namespace {
+
+// The maximum number of StreamData kept for reuse per thread. The messages
+// are often released on another thread than the one which allocated them,
+// e.g. after an AsyncQueueHandler, so the free lists are bounded.
+const size_t kMaxFreeStreamData = 256;
+
+// Set once the free list of the thread is destroyed, so the StreamData
+// released later at thread exit go back to the heap.
+thread_local bool g_stream_data_free_list_destroyed = false;
+
+struct StreamDataFreeList {
+  ~StreamDataFreeList() {
+    for (size_t i = 0; i < size; ++i)
+      ::operator delete(blocks[i]);
+    size = 0;
+    g_stream_data_free_list_destroyed = true;
+  }
+
+  void* blocks[kMaxFreeStreamData];
+  size_t size = 0;
+};
+
+thread_local StreamDataFreeList g_stream_data_free_list;
+
+base::ThreadTicks ThreadNow() {
+  return base::ThreadTicks::IsSupported() ? base::ThreadTicks::Now()
+                                          : base::ThreadTicks();
+}
+
+// Measures a Process or flush call of an instrumented handler. The time spent
+// in the nested calls of instrumented downstream handlers on the same thread
+// is subtracted, so a handler is only charged for its own work.
+class CallTimer;
+thread_local CallTimer* g_current_call_timer = nullptr;
+
+class CallTimer {
+ public:
+  CallTimer()
+      : parent_(g_current_call_timer),
+        start_time_(base::TimeTicks::Now()),
+        start_cpu_time_(ThreadNow()) {
+    g_current_call_timer = this;
+  }
+
+  // Should be called exactly once.
+  void Stop(base::TimeDelta* self_time, base::TimeDelta* self_cpu_time) {
+    const base::TimeDelta time = base::TimeTicks::Now() - start_time_;
+    const base::TimeDelta cpu_time = ThreadNow() - start_cpu_time_;
+    g_current_call_timer = parent_;
+    if (parent_) {
+      parent_->child_time_ += time;
+      parent_->child_cpu_time_ += cpu_time;
+    }
+    *self_time = time - child_time_;
+    *self_cpu_time = cpu_time - child_cpu_time_;
+  }
+
+ private:
+  CallTimer* const parent_;
+  const base::TimeTicks start_time_;
+  const base::ThreadTicks start_cpu_time_;
+  base::TimeDelta child_time_;
+  base::TimeDelta child_cpu_time_;
+};
+
+}  // namespace
 
 std::string StreamDataTypeToString(StreamDataType type) {
   switch (type) {
@@ -91,6 +159,27 @@ bool MediaHandler::ValidateOutputStreamIndex(size_t stream_index) const {
   return stream_index < num_input_streams_;
 }
 
+void* StreamData::operator new(size_t size) {
+  if (size == sizeof(StreamData) && !g_stream_data_free_list_destroyed) {
+    StreamDataFreeList& free_list = g_stream_data_free_list;
+    if (free_list.size > 0)
+      return free_list.blocks[--free_list.size];
+  }
+  return ::operator new(size);
+}
+
+void StreamData::operator delete(void* ptr, size_t size) {
+  if (ptr && size == sizeof(StreamData) &&
+      !g_stream_data_free_list_destroyed) {
+    StreamDataFreeList& free_list = g_stream_data_free_list;
+    if (free_list.size < kMaxFreeStreamData) {
+      free_list.blocks[free_list.size++] = ptr;
+      return;
+    }
+  }
+  ::operator delete(ptr);
+}
+
 Status MediaHandler::Dispatch(std::unique_ptr<StreamData> stream_data) const {
   size_t output_stream_index = stream_data->stream_index;
   auto handler_it = output_handlers_.find(output_stream_index);
@@ -99,7 +188,7 @@ Status MediaHandler::Dispatch(std::unique_ptr<StreamData> stream_data) const {
                   "No output handler exist at the specified index.");
   }
   stream_data->stream_index = handler_it->second.second;
-  return handler_it->second.first->Process(std::move(stream_data));
+  return CallProcess(handler_it->second.first.get(), std::move(stream_data));
 }
 
 Status MediaHandler::FlushDownstream(size_t output_stream_index) {
@@ -108,17 +197,68 @@ Status MediaHandler::FlushDownstream(size_t output_stream_index) {
     return Status(error::NOT_FOUND,
                   "No output handler exist at the specified index.");
   }
-  return handler_it->second.first->OnFlushRequest(handler_it->second.second);
+  return CallOnFlushRequest(handler_it->second.first.get(),
+                            handler_it->second.second);
 }
 
 Status MediaHandler::FlushAllDownstreams() {
   for (const auto& pair : output_handlers_) {
-    Status status = pair.second.first->OnFlushRequest(pair.second.second);
+    Status status =
+        CallOnFlushRequest(pair.second.first.get(), pair.second.second);
     if (!status.ok()) {
       return status;
     }
   }
   return Status::OK;
 }
+
+Status MediaHandler::CallProcess(MediaHandler* handler,
+                                 std::unique_ptr<StreamData> stream_data) {
+  if (!handler->stats_)
+    return handler->Process(std::move(stream_data));
+
+  const bool is_sample =
+      stream_data->stream_data_type == StreamDataType::kMediaSample ||
+      stream_data->stream_data_type == StreamDataType::kTextSample;
+  const int64_t num_bytes =
+      stream_data->stream_data_type == StreamDataType::kMediaSample
+          ? stream_data->media_sample->data_size()
+          : 0;
+  CallTimer timer;
+  Status status = handler->Process(std::move(stream_data));
+  base::TimeDelta time;
+  base::TimeDelta cpu_time;
+  timer.Stop(&time, &cpu_time);
+  handler->stats_->RecordProcess(is_sample, num_bytes, time, cpu_time);
+  return status;
+}
+
+Status MediaHandler::CallWithStats(const std::function<Status()>& work) {
+  if (!stats_)
+    return work();
+
+  CallTimer timer;
+  Status status = work();
+  base::TimeDelta time;
+  base::TimeDelta cpu_time;
+  timer.Stop(&time, &cpu_time);
+  stats_->RecordFlush(time, cpu_time);
+  return status;
+}
+
+Status MediaHandler::CallOnFlushRequest(MediaHandler* handler,
+                                        size_t input_stream_index) {
+  if (!handler->stats_)
+    return handler->OnFlushRequest(input_stream_index);
+
+  CallTimer timer;
+  Status status = handler->OnFlushRequest(input_stream_index);
+  base::TimeDelta time;
+  base::TimeDelta cpu_time;
+  timer.Stop(&time, &cpu_time);
+  handler->stats_->RecordFlush(time, cpu_time);
+  return status;
+}
+
 }  // namespace media
 }  // namespace shaka
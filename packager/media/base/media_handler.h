@@ -7,10 +7,12 @@
 #ifndef PACKAGER_MEDIA_BASE_MEDIA_HANDLER_H_
 #define PACKAGER_MEDIA_BASE_MEDIA_HANDLER_H_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <utility>
 
+#include "packager/media/base/handler_stats.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/base/text_sample.h"
@@ -75,6 +77,11 @@ struct StreamData {
   std::shared_ptr<const Scte35Event> scte35_event;
   std::shared_ptr<const CueEvent> cue_event;
 
+  // A StreamData is allocated for every message sent downstream, so they are
+  // recycled through a small per-thread free list instead of the heap.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   static std::unique_ptr<StreamData> FromStreamInfo(
       size_t stream_index,
       std::shared_ptr<const StreamInfo> stream_info) {
@@ -174,6 +181,14 @@ class MediaHandler {
 
   static Status Chain(const std::vector<std::shared_ptr<MediaHandler>>& list);
 
+  /// Record the statistics of the Process and flush calls of this handler.
+  /// Should be called before the handler receives any data.
+  /// @param stats receives the statistics. Null disables the instrumentation,
+  ///        which is the default.
+  void set_stats(std::shared_ptr<HandlerStats> stats) {
+    stats_ = std::move(stats);
+  }
+
  protected:
   /// Internal implementation of initialize. Note that it should only initialize
   /// the MediaHandler itself. Downstream handlers are handled in Initialize().
@@ -257,10 +272,22 @@ class MediaHandler {
     return output_handlers_;
   }
 
+  /// Call @a work, e.g. the main loop of an origin handler, which does not
+  /// receive Process calls, recording its time as a flush call in the
+  /// statistics of this handler if it is instrumented.
+  Status CallWithStats(const std::function<Status()>& work);
+
  private:
   MediaHandler(const MediaHandler&) = delete;
   MediaHandler& operator=(const MediaHandler&) = delete;
 
+  // Call handler->Process() or handler->OnFlushRequest(), recording the
+  // statistics of the call if the handler is instrumented.
+  static Status CallProcess(MediaHandler* handler,
+                            std::unique_ptr<StreamData> stream_data);
+  static Status CallOnFlushRequest(MediaHandler* handler,
+                                   size_t input_stream_index);
+
   bool initialized_ = false;
   // Number of input streams.
   size_t num_input_streams_ = 0;
@@ -270,6 +297,7 @@ class MediaHandler {
   // map.
   std::map<size_t, std::pair<std::shared_ptr<MediaHandler>, size_t>>
       output_handlers_;
+  std::shared_ptr<HandlerStats> stats_;
 };
 
 }  // namespace media
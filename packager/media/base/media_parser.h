@@ -76,6 +76,21 @@ class MediaParser {
   /// @return true if successful.
   virtual bool Parse(const uint8_t* buf, int size) WARN_UNUSED_RESULT = 0;
 
+  /// Same as Parse(), but the data is in a ref-counted chunk which the parser
+  /// may keep a reference to. Parsers supporting it emit samples that share
+  /// memory with @a chunk instead of copying the sample data out.
+  /// @return true if successful.
+  virtual bool ParseChunk(std::shared_ptr<const uint8_t> chunk,
+                          int size) WARN_UNUSED_RESULT {
+    return Parse(chunk.get(), size);
+  }
+
+  /// Tells the parser that the samples of a track are discarded, e.g. because
+  /// the track is not selected. The parser may skip the track, but it may still
+  /// emit some samples of the track, e.g. queued ones.
+  /// @param track_id is the ID of the track, as in its StreamInfo.
+  virtual void DisableTrack(uint32_t track_id) {}
+
  private:
   DISALLOW_COPY_AND_ASSIGN(MediaParser);
 };
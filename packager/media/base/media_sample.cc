@@ -10,6 +10,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/media/base/sample_buffer_pool.h"
 
 namespace shaka {
 namespace media {
@@ -26,11 +27,8 @@ MediaSample::MediaSample(const uint8_t* data,
 
   SetData(data, data_size);
   if (side_data) {
-    std::shared_ptr<uint8_t> shared_side_data(new uint8_t[side_data_size],
-                                              std::default_delete<uint8_t[]>());
-    memcpy(shared_side_data.get(), side_data, side_data_size);
-    side_data_ = std::move(shared_side_data);
-    side_data_size_ = side_data_size;
+    side_data_ = std::make_shared<const std::vector<uint8_t>>(
+        side_data, side_data + side_data_size);
   }
 }
 
@@ -87,16 +85,11 @@ std::shared_ptr<MediaSample> MediaSample::Clone() const {
   new_media_sample->is_encrypted_ = is_encrypted_;
   new_media_sample->data_ = data_;
   new_media_sample->data_size_ = data_size_;
+  new_media_sample->data_writable_ = data_writable_;
   new_media_sample->side_data_ = side_data_;
-  new_media_sample->side_data_size_ = side_data_size_;
-  new_media_sample->config_id_ = config_id_;
-  if (decrypt_config_) {
-    new_media_sample->decrypt_config_.reset(new DecryptConfig(
-        decrypt_config_->key_id(), decrypt_config_->iv(),
-        decrypt_config_->subsamples(), decrypt_config_->protection_scheme(),
-        decrypt_config_->crypt_byte_block(),
-        decrypt_config_->skip_byte_block()));
-  }
+  new_media_sample->video_slice_header_sizes_ = video_slice_header_sizes_;
+  if (decrypt_config_)
+    new_media_sample->decrypt_config_ = decrypt_config_->Clone();
   return new_media_sample;
 }
 
@@ -104,11 +97,64 @@ void MediaSample::TransferData(std::shared_ptr<uint8_t> data,
                                size_t data_size) {
   data_ = std::move(data);
   data_size_ = data_size;
+  data_headroom_ = 0;
+  data_writable_ = true;
+  video_slice_header_sizes_.clear();
+}
+
+void MediaSample::TransferData(std::shared_ptr<uint8_t> buffer,
+                               size_t headroom,
+                               size_t data_size) {
+  uint8_t* data = buffer.get() + headroom;
+  data_ = std::shared_ptr<const uint8_t>(std::move(buffer), data);
+  data_size_ = data_size;
+  data_headroom_ = headroom;
+  data_writable_ = true;
+  video_slice_header_sizes_.clear();
+}
+
+void MediaSample::PrependData(const uint8_t* data, size_t data_size) {
+  video_slice_header_sizes_.clear();
+  if (data_size <= data_headroom_) {
+    // The headroom was allocated writable in TransferData().
+    uint8_t* new_data = const_cast<uint8_t*>(data_.get()) - data_size;
+    memcpy(new_data, data, data_size);
+    data_ = std::shared_ptr<const uint8_t>(std::move(data_), new_data);
+    data_size_ += data_size;
+    data_headroom_ -= data_size;
+    return;
+  }
+  const size_t new_data_size = data_size + data_size_;
+  std::shared_ptr<uint8_t> new_data = SampleBufferPool::Allocate(new_data_size);
+  memcpy(new_data.get(), data, data_size);
+  memcpy(new_data.get() + data_size, data_.get(), data_size_);
+  data_ = std::move(new_data);
+  data_size_ = new_data_size;
+  data_headroom_ = 0;
+  data_writable_ = true;
+}
+
+void MediaSample::ShareData(std::shared_ptr<const uint8_t> owner,
+                            const uint8_t* data,
+                            size_t data_size) {
+  // Aliasing constructor: shares ownership of |owner| but points to |data|.
+  data_ = std::shared_ptr<const uint8_t>(std::move(owner), data);
+  data_size_ = data_size;
+  data_headroom_ = 0;
+  data_writable_ = false;
+  video_slice_header_sizes_.clear();
+}
+
+uint8_t* MediaSample::writable_data() {
+  DCHECK(!end_of_stream());
+  if (!data_writable_ || data_.use_count() != 1)
+    return nullptr;
+  // Allocated writable in TransferData() and not shared.
+  return const_cast<uint8_t*>(data_.get());
 }
 
 void MediaSample::SetData(const uint8_t* data, size_t data_size) {
-  std::shared_ptr<uint8_t> shared_data(new uint8_t[data_size],
-                                       std::default_delete<uint8_t[]>());
+  std::shared_ptr<uint8_t> shared_data = SampleBufferPool::Allocate(data_size);
   memcpy(shared_data.get(), data, data_size);
   TransferData(std::move(shared_data), data_size);
 }
@@ -121,7 +167,7 @@ std::string MediaSample::ToString() const {
       "\n "
       "is_key_frame: %s\n size: %zu\n side_data_size: %zu\n",
       dts_, pts_, duration_, is_key_frame_ ? "true" : "false", data_size_,
-      side_data_size_);
+      side_data_size());
 }
 
 }  // namespace media
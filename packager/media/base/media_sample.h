@@ -72,6 +72,30 @@ class MediaSample {
   /// @param data_size is the size of the data to be transferred.
   void TransferData(std::shared_ptr<uint8_t> data, size_t data_size);
 
+  /// Transfer data to this media sample, keeping free bytes in front of it so
+  /// that PrependData() does not copy the data. No data copying is involved.
+  /// @param buffer points to the buffer to be transferred.
+  /// @param headroom is the number of free bytes at the start of @a buffer.
+  /// @param data_size is the size of the data, which follows the headroom.
+  void TransferData(std::shared_ptr<uint8_t> buffer,
+                    size_t headroom,
+                    size_t data_size);
+
+  /// Insert bytes in front of the data. The bytes are written in the headroom
+  /// if it is large enough, otherwise the data is copied to a new buffer.
+  /// @param data points to the bytes to be inserted.
+  /// @param data_size is the number of bytes to be inserted.
+  void PrependData(const uint8_t* data, size_t data_size);
+
+  /// Make this media sample a view into a buffer owned by somebody else. No
+  /// data copying is involved. The sample keeps @a owner alive.
+  /// @param owner is the ref-counted buffer that contains @a data.
+  /// @param data points to the sample data inside @a owner.
+  /// @param data_size is the size of the sample data.
+  void ShareData(std::shared_ptr<const uint8_t> owner,
+                 const uint8_t* data,
+                 size_t data_size);
+
   /// Set the data in this media sample. Note that this method involves data
   /// copying.
   /// @param data points to the data to be copied.
@@ -124,9 +148,28 @@ class MediaSample {
     return data_size_;
   }
 
-  const uint8_t* side_data() const { return side_data_.get(); }
+  /// @return the number of free bytes in front of the data, which only this
+  ///         sample may write to.
+  size_t data_headroom() const { return data_headroom_; }
+
+  /// @return the data for modifying it in place, e.g. to encrypt it, if the
+  ///         data was transferred to this sample and no other sample shares
+  ///         it, null otherwise. The caller must be the only user of the
+  ///         sample.
+  uint8_t* writable_data();
+
+  /// @return the data, sharing its ownership, for the users that keep
+  ///         pointers into the data after the sample is released.
+  const std::shared_ptr<const uint8_t>& shared_data() const {
+    DCHECK(!end_of_stream());
+    return data_;
+  }
+
+  const uint8_t* side_data() const {
+    return side_data_ ? side_data_->data() : nullptr;
+  }
 
-  size_t side_data_size() const { return side_data_size_; }
+  size_t side_data_size() const { return side_data_ ? side_data_->size() : 0; }
 
   const DecryptConfig* decrypt_config() const { return decrypt_config_.get(); }
 
@@ -145,9 +188,15 @@ class MediaSample {
   // If there's no data in this buffer, it represents end of stream.
   bool end_of_stream() const { return data_size_ == 0; }
 
-  const std::string& config_id() const { return config_id_; }
-  void set_config_id(const std::string& config_id) {
-    config_id_ = config_id;
+  /// @return the sizes of the slice headers, excluding the NAL unit headers,
+  ///         of the video slice NAL units of an H.264 / H.265 sample, in
+  ///         order, if already known from parsing the sample. They are
+  ///         cleared when the data is replaced.
+  const std::vector<size_t>& video_slice_header_sizes() const {
+    return video_slice_header_sizes_;
+  }
+  void set_video_slice_header_sizes(std::vector<size_t> sizes) {
+    video_slice_header_sizes_ = std::move(sizes);
   }
 
  protected:
@@ -162,31 +211,39 @@ class MediaSample {
   MediaSample();
 
  private:
+  // The fields are ordered to avoid padding, as many samples may be queued,
+  // e.g. while the streams are aligned.
+
   // Decoding time stamp.
   int64_t dts_ = 0;
   // Presentation time stamp.
   int64_t pts_ = 0;
   int64_t duration_ = 0;
-  bool is_key_frame_ = false;
-  // is sample encrypted ?
-  bool is_encrypted_ = false;
 
   // Main buffer data.
   std::shared_ptr<const uint8_t> data_;
   size_t data_size_ = 0;
+  // The free bytes in front of |data_|. Not shared with the clones.
+  size_t data_headroom_ = 0;
   // Contain additional buffers to complete the main one. Needed by WebM
   // http://www.matroska.org/technical/specs/index.html BlockAdditional[A5].
-  // Not used by mp4 and other containers.
-  std::shared_ptr<const uint8_t> side_data_;
-  size_t side_data_size_ = 0;
+  // Not used by mp4 and other containers, so it is null for most samples.
+  std::shared_ptr<const std::vector<uint8_t>> side_data_;
 
-  // Text specific fields.
-  // For now this is the cue identifier for WebVTT.
-  std::string config_id_;
+  // Video specific fields. Saves parsing the slice headers again when
+  // generating the subsamples.
+  std::vector<size_t> video_slice_header_sizes_;
 
   // Decrypt configuration.
   std::unique_ptr<DecryptConfig> decrypt_config_;
 
+  bool is_key_frame_ = false;
+  // is sample encrypted ?
+  bool is_encrypted_ = false;
+  // Whether |data_| was allocated writable, i.e. transferred to the sample
+  // rather than shared with the buffer of a parser.
+  bool data_writable_ = false;
+
   DISALLOW_COPY_AND_ASSIGN(MediaSample);
 };
 
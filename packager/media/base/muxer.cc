@@ -8,8 +8,10 @@
 
 #include <algorithm>
 
+#include "packager/media/base/load_shedder.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/metrics/metrics.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -19,7 +21,8 @@ const bool kInitialEncryptionInfo = true;
 const int64_t kStartTime = 0;
 }  // namespace
 
-Muxer::Muxer(const MuxerOptions& options) : options_(options) {
+Muxer::Muxer(const MuxerOptions& options)
+    : options_(options), metrics_label_(GetMetricsStreamLabel(options)) {
   // "$" is only allowed if the output file name is a template, which is used to
   // support one file per Representation per Period when there are Ad Cues.
   if (options_.output_file_name.find("$") != std::string::npos)
@@ -42,10 +45,20 @@ void Muxer::SetProgressListener(
 }
 
 Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
+  // A shed output is not updated anymore.
+  if (shed_)
+    return Status::OK;
+
   Status status;
   switch (stream_data->stream_data_type) {
     case StreamDataType::kStreamInfo:
       streams_.push_back(std::move(stream_data->stream_info));
+      if (load_shedder_ && load_shedder_output_id_ < 0) {
+        load_shedder_output_id_ = load_shedder_->AddOutput(
+            options_.output_file_name.empty() ? options_.segment_template
+                                              : options_.output_file_name,
+            *streams_.back());
+      }
       return ReinitializeMuxer(kStartTime);
     case StreamDataType::kSegmentInfo: {
       const auto& segment_info = *stream_data->segment_info;
@@ -65,12 +78,39 @@ Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
           muxer_listener_->OnEncryptionStart();
         }
       }
-      return FinalizeSegment(stream_data->stream_index, segment_info);
+      if (muxer_listener_ && !segment_info.is_subsegment &&
+          !last_sample_time_.is_null()) {
+        muxer_listener_->OnSegmentEnd(last_sample_time_);
+      }
+      const base::TimeTicks start_time = base::TimeTicks::Now();
+      status = FinalizeSegment(stream_data->stream_index, segment_info);
+      Metrics::GetInstance()->ObserveDuration(
+          "shaka_segment_finalize_seconds",
+          "Time spent finalizing and writing (sub)segments.",
+          {{"stream", metrics_label_}}, base::TimeTicks::Now() - start_time);
+      if (status.ok() && load_shedder_ && !segment_info.is_subsegment) {
+        ReportLag(stream_data->stream_index, segment_info);
+        shed_ = load_shedder_->IsShed(load_shedder_output_id_);
+      }
+      return status;
     }
     case StreamDataType::kMediaSample:
-      return AddMediaSample(stream_data->stream_index,
-                            *stream_data->media_sample);
+      last_sample_time_ = base::TimeTicks::Now();
+      if (load_shedder_) {
+        OnSampleTime(stream_data->stream_index,
+                     stream_data->media_sample->pts());
+      }
+      return AddSharedMediaSample(stream_data->stream_index,
+                                  stream_data->media_sample);
     case StreamDataType::kTextSample:
+      // The heartbeats are only used to chunk sparse text streams.
+      if (stream_data->text_sample->is_heartbeat())
+        return Status::OK;
+      last_sample_time_ = base::TimeTicks::Now();
+      if (load_shedder_) {
+        OnSampleTime(stream_data->stream_index,
+                     stream_data->text_sample->start_time());
+      }
       return AddTextSample(stream_data->stream_index,
                            *stream_data->text_sample);
     case StreamDataType::kCueEvent:
@@ -107,10 +147,46 @@ Status Muxer::AddMediaSample(size_t stream_id, const MediaSample& sample) {
   return Status::OK;
 }
 
+Status Muxer::AddSharedMediaSample(size_t stream_id,
+                                   std::shared_ptr<const MediaSample> sample) {
+  return AddMediaSample(stream_id, *sample);
+}
+
 Status Muxer::AddTextSample(size_t stream_id, const TextSample& sample) {
   return Status::OK;
 }
 
+void Muxer::OnSampleTime(size_t stream_id, int64_t timestamp) {
+  if (first_sample_timestamp_)
+    return;
+  first_sample_timestamp_ = timestamp;
+  first_sample_wall_time_ = clock_ ? clock_->Now() : base::Time::Now();
+}
+
+void Muxer::ReportLag(size_t stream_id, const SegmentInfo& segment_info) {
+  if (!first_sample_timestamp_)
+    return;
+  const int64_t time_scale = streams_[stream_id]->time_scale();
+  // Only the media time elapsed since the first sample is converted, as the
+  // timestamps of a live input, e.g. since the epoch, would overflow in
+  // microseconds.
+  const int64_t media_time_elapsed = segment_info.start_timestamp +
+                                     segment_info.duration -
+                                     first_sample_timestamp_.value();
+  const base::Time now = clock_ ? clock_->Now() : base::Time::Now();
+  // The samples of a real-time input arrive at the pace of the wall clock, so
+  // the output keeps up as long as its media time advances as fast.
+  const base::TimeDelta lag =
+      (now - first_sample_wall_time_) -
+      base::TimeDelta::FromSecondsD(static_cast<double>(media_time_elapsed) /
+                                    time_scale);
+  Metrics::GetInstance()->SetGauge(
+      "shaka_output_lag_seconds",
+      "How far a live output fell behind real time at its last segment.",
+      {{"stream", metrics_label_}}, lag.InSecondsF());
+  load_shedder_->ReportLag(load_shedder_output_id_, lag, now);
+}
+
 Status Muxer::ReinitializeMuxer(int64_t timestamp) {
   if (muxer_listener_ && streams_.back()->is_encrypted()) {
     const EncryptionConfig& encryption_config =
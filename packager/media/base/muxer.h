@@ -12,7 +12,9 @@
 #include <memory>
 #include <vector>
 
+#include "packager/base/optional.h"
 #include "packager/base/time/clock.h"
+#include "packager/base/time/time.h"
 #include "packager/media/base/media_handler.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/event/muxer_listener.h"
@@ -22,6 +24,7 @@
 namespace shaka {
 namespace media {
 
+class LoadShedder;
 class MediaSample;
 
 /// Muxer is responsible for taking elementary stream samples and producing
@@ -58,6 +61,13 @@ class Muxer : public MediaHandler {
     clock_ = clock;
   }
 
+  /// Set the LoadShedder of a live job. The muxer then reports the lag of its
+  /// output at every segment and stops writing once the output is shed.
+  /// @param load_shedder is not owned and should outlive the muxer.
+  void set_load_shedder(LoadShedder* load_shedder) {
+    load_shedder_ = load_shedder;
+  }
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
@@ -87,6 +97,12 @@ class Muxer : public MediaHandler {
   // handle media samples will need to replace this.
   virtual Status AddMediaSample(size_t stream_id, const MediaSample& sample);
 
+  // Add a new media sample, which the muxer may hold on to and add later
+  // together with the following samples. Calls AddMediaSample() by default.
+  virtual Status AddSharedMediaSample(
+      size_t stream_id,
+      std::shared_ptr<const MediaSample> sample);
+
   // Add a new text sample.  This does nothing by default; so subclasses that
   // handle text samples will need to replace this.
   virtual Status AddTextSample(size_t stream_id, const TextSample& sample);
@@ -100,6 +116,12 @@ class Muxer : public MediaHandler {
   // |timestamp| may be used to set the output file name.
   Status ReinitializeMuxer(int64_t timestamp);
 
+  // Records the first sample time of the output, from which the lag is
+  // computed.
+  void OnSampleTime(size_t stream_id, int64_t timestamp);
+  // Reports the lag of the output at the end of a segment to |load_shedder_|.
+  void ReportLag(size_t stream_id, const SegmentInfo& segment_info);
+
   MuxerOptions options_;
   std::vector<std::shared_ptr<const StreamInfo>> streams_;
   std::vector<uint8_t> current_key_id_;
@@ -115,6 +137,20 @@ class Muxer : public MediaHandler {
   // be a template. In this case, there will be NumAdCues + 1 files generated.
   std::string output_file_template_;
   size_t output_file_index_ = 0;
+  // Identifies the output in the metrics.
+  std::string metrics_label_;
+  // When the last sample entered the muxer, from which the latency of the
+  // segment it ends is measured.
+  base::TimeTicks last_sample_time_;
+
+  // Load shedding of live jobs, see set_load_shedder().
+  LoadShedder* load_shedder_ = nullptr;
+  int load_shedder_output_id_ = -1;
+  bool shed_ = false;
+  // The timestamp of the first sample, in the stream time scale, and when it
+  // entered the muxer.
+  base::Optional<int64_t> first_sample_timestamp_;
+  base::Time first_sample_wall_time_;
 };
 
 }  // namespace media
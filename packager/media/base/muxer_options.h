@@ -39,6 +39,28 @@ struct MuxerOptions {
   /// Optional.
   std::string segment_template;
 
+  /// The target duration of the segments, in seconds. Only used to estimate
+  /// the number of segments, e.g. to reserve space for the WebM Cues. Zero if
+  /// unknown.
+  double segment_duration_in_seconds = 0;
+
+  /// The target duration of the chunks the segments are written in, in
+  /// seconds, with @b Mp4OutputParams.low_latency_chunked_output. Zero if the
+  /// segments are not written in chunks.
+  double chunk_duration_in_seconds = 0;
+
+  /// The index of the first segment generated with @b segment_template, for
+  /// the $Number$ identifier, e.g. to resume the numbering of a live stream
+  /// after a restart.
+  uint32_t first_segment_index = 0;
+
+  /// Number the segments generated with @b segment_template from the timeline
+  /// index of the first segment, i.e. its start time divided by
+  /// @b segment_duration_in_seconds, instead of from
+  /// @b first_segment_index, so that redundant packagers of the same input
+  /// generate the same segment names.
+  bool segment_numbers_from_timestamps = false;
+
   /// Specify temporary directory for intermediate files.
   std::string temp_dir;
 
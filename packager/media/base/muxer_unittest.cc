@@ -0,0 +1,119 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/muxer.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/time/clock.h"
+#include "packager/media/base/load_shedder.h"
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/metrics/metrics.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kInputCount = 1;
+const size_t kOutputCount = 0;
+const size_t kStreamIndex = 0;
+const uint32_t kTimeScale = 90000;
+const int64_t kSampleDuration = 3000;
+const int64_t kSamplesPerSegment = 60;
+const int64_t kSegmentDuration = kSampleDuration * kSamplesPerSegment;
+// The timestamps of a live input stamped with the time since the epoch, which
+// overflow int64_t once in microseconds.
+const int64_t kEpochTimestamp = INT64_C(1600000000) * kTimeScale;
+const char kLagMetric[] = "shaka_output_lag_seconds";
+
+class TestClock : public base::Clock {
+ public:
+  explicit TestClock(const base::Time& t) : time_(t) {}
+  ~TestClock() override {}
+  base::Time Now() override { return time_; }
+
+  void Advance(base::TimeDelta delta) { time_ += delta; }
+
+ private:
+  base::Time time_;
+};
+
+class FakeMuxer : public Muxer {
+ public:
+  explicit FakeMuxer(const MuxerOptions& options) : Muxer(options) {}
+
+ private:
+  Status InitializeMuxer() override { return Status::OK; }
+  Status Finalize() override { return Status::OK; }
+  Status AddMediaSample(size_t stream_id, const MediaSample& sample) override {
+    return Status::OK;
+  }
+  Status FinalizeSegment(size_t stream_id,
+                         const SegmentInfo& segment_info) override {
+    return Status::OK;
+  }
+};
+
+}  // namespace
+
+class MuxerTest : public MediaHandlerTestBase {
+ protected:
+  MuxerTest()
+      : clock_(base::Time::Now()),
+        load_shedder_(base::TimeDelta::FromSeconds(10),
+                      LoadShedder::ShedCallback()) {}
+
+  void SetUp() override {
+    MuxerOptions muxer_options;
+    muxer_options.segment_template = "memory://output/video_$Number$.m4s";
+    std::shared_ptr<Muxer> muxer = std::make_shared<FakeMuxer>(muxer_options);
+    muxer->set_clock(&clock_);
+    muxer->set_load_shedder(&load_shedder_);
+    ASSERT_OK(SetUpAndInitializeGraph(muxer, kInputCount, kOutputCount));
+    ASSERT_OK(Input(kStreamIndex)
+                  ->Dispatch(StreamData::FromStreamInfo(
+                      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+  }
+
+  // Dispatches the samples of the segment starting at |start_timestamp|, then
+  // advances the clock by |wall_time| and ends the segment.
+  Status DispatchSegment(int64_t start_timestamp, base::TimeDelta wall_time) {
+    for (int64_t i = 0; i < kSamplesPerSegment; ++i) {
+      Status status = Input(kStreamIndex)
+                          ->Dispatch(StreamData::FromMediaSample(
+                              kStreamIndex,
+                              GetMediaSample(
+                                  start_timestamp + i * kSampleDuration,
+                                  kSampleDuration, i == 0 /* is_keyframe */)));
+      if (!status.ok())
+        return status;
+    }
+    clock_.Advance(wall_time);
+    return Input(kStreamIndex)
+        ->Dispatch(StreamData::FromSegmentInfo(
+            kStreamIndex,
+            GetSegmentInfo(start_timestamp, kSegmentDuration,
+                           false /* is_subsegment */)));
+  }
+
+  TestClock clock_;
+  LoadShedder load_shedder_;
+};
+
+TEST_F(MuxerTest, ReportsLagWithEpochTimestamps) {
+  // The first segment of 2 seconds took 3 seconds.
+  ASSERT_OK(DispatchSegment(kEpochTimestamp, base::TimeDelta::FromSeconds(3)));
+  EXPECT_NEAR(1.0, Metrics::GetInstance()->GetSum(kLagMetric), 0.001);
+
+  // The second one took 1.5 seconds.
+  ASSERT_OK(DispatchSegment(kEpochTimestamp + kSegmentDuration,
+                            base::TimeDelta::FromMilliseconds(1500)));
+  EXPECT_NEAR(0.5, Metrics::GetInstance()->GetSum(kLagMetric), 0.001);
+}
+
+}  // namespace media
+}  // namespace shaka
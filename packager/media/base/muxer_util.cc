@@ -8,6 +8,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 
@@ -15,6 +17,7 @@
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_split.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/media/base/muxer_options.h"
 #include "packager/media/base/video_stream_info.h"
 
 namespace shaka {
@@ -163,5 +166,63 @@ std::string GetSegmentName(const std::string& segment_template,
   return segment_name;
 }
 
+std::string GetMetricsStreamLabel(const MuxerOptions& options) {
+  return options.segment_template.empty() ? options.output_file_name
+                                          : options.segment_template;
+}
+
+bool GetTimelineSegmentIndex(int64_t start_time,
+                             uint32_t time_scale,
+                             double segment_duration_in_seconds,
+                             uint32_t* segment_index) {
+  DCHECK_GT(time_scale, 0u);
+  DCHECK_GT(segment_duration_in_seconds, 0);
+  const double start_time_in_seconds =
+      static_cast<double>(start_time) / time_scale;
+  const double index = std::max(
+      0.0, std::round(start_time_in_seconds / segment_duration_in_seconds));
+  // The conversion of a double out of the range of uint32_t is undefined.
+  if (index > kMaxTimelineSegmentIndex) {
+    *segment_index = kMaxTimelineSegmentIndex;
+    return false;
+  }
+  *segment_index = static_cast<uint32_t>(index);
+  return true;
+}
+
+SegmentIndexer::SegmentIndexer(const MuxerOptions& options)
+    : from_timestamps_(options.segment_numbers_from_timestamps),
+      segment_duration_in_seconds_(options.segment_duration_in_seconds),
+      next_index_(options.first_segment_index) {
+  DCHECK(!from_timestamps_ || segment_duration_in_seconds_ > 0);
+}
+
+Status SegmentIndexer::Next(int64_t start_time,
+                            uint32_t time_scale,
+                            uint32_t* segment_index) {
+  // The next segments are counted from the first one rather than numbered
+  // from their timestamps, so that the numbers stay contiguous across gaps
+  // in the input, as required by $Number$ with a DASH SegmentTimeline.
+  if (from_timestamps_ && first_segment_ &&
+      !GetTimelineSegmentIndex(start_time, time_scale,
+                               segment_duration_in_seconds_, &next_index_)) {
+    return Status(error::MUXER_FAILURE,
+                  "The segment number of the segment at " +
+                      std::to_string(start_time / time_scale) +
+                      " seconds does not fit in 32 bits with a segment "
+                      "duration of " +
+                      std::to_string(segment_duration_in_seconds_) +
+                      " seconds. Use a longer segment duration or disable "
+                      "--segment_numbers_from_timestamps.");
+  }
+  first_segment_ = false;
+  if (next_index_ > kMaxTimelineSegmentIndex) {
+    return Status(error::MUXER_FAILURE,
+                  "The segment number does not fit in 32 bits.");
+  }
+  *segment_index = next_index_++;
+  return Status::OK;
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -17,6 +17,7 @@ namespace shaka {
 namespace media {
 
 class StreamInfo;
+struct MuxerOptions;
 
 /// Validates the segment template against segment URL construction rule
 /// specified in ISO/IEC 23009-1:2012 5.3.9.4.4.
@@ -37,6 +38,54 @@ std::string GetSegmentName(const std::string& segment_template,
                            uint32_t segment_index,
                            uint32_t bandwidth);
 
+/// @return the label identifying the output of a muxer in the metrics, i.e.
+///         the segment template, or the output file name if there is no
+///         segment template.
+std::string GetMetricsStreamLabel(const MuxerOptions& options);
+
+/// Get the index of the segment starting at @a start_time on the timeline of
+/// the segments of @a segment_duration_in_seconds starting at timestamp zero,
+/// i.e. the nearest multiple of the segment duration, so that a segment
+/// starting slightly after or before its boundary, e.g. on the next key frame,
+/// gets the index of the boundary.
+/// @param start_time is the start time of the segment.
+/// @param time_scale is the time scale of @a start_time.
+/// @param segment_duration_in_seconds is the target segment duration.
+/// @param[out] segment_index is the index of the segment, clamped to
+///             kMaxTimelineSegmentIndex.
+/// @return false if the index is above kMaxTimelineSegmentIndex, e.g. for
+///         timestamps since the epoch with a short segment duration.
+bool GetTimelineSegmentIndex(int64_t start_time,
+                             uint32_t time_scale,
+                             double segment_duration_in_seconds,
+                             uint32_t* segment_index);
+
+/// The largest segment index, whose $Number$ still fits in 32 bits.
+const uint32_t kMaxTimelineSegmentIndex = 0xFFFFFFFE;
+
+/// Generates the indices of the segments of a segment template, for the
+/// $Number$ identifier. The segments are numbered from
+/// @b MuxerOptions.first_segment_index, or, with
+/// @b MuxerOptions.segment_numbers_from_timestamps, from the timeline index of
+/// the first segment, see GetTimelineSegmentIndex(), so that packagers of the
+/// same input number the segments the same way whenever they start.
+class SegmentIndexer {
+ public:
+  explicit SegmentIndexer(const MuxerOptions& options);
+
+  /// @param start_time is the start time of the segment.
+  /// @param time_scale is the time scale of @a start_time.
+  /// @param[out] segment_index is the index of the next segment.
+  /// @return An error if the index does not fit in 32 bits.
+  Status Next(int64_t start_time, uint32_t time_scale, uint32_t* segment_index);
+
+ private:
+  const bool from_timestamps_;
+  const double segment_duration_in_seconds_;
+  bool first_segment_ = true;
+  uint32_t next_index_;
+};
+
 }  // namespace media
 }  // namespace shaka
 
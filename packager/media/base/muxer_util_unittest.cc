@@ -6,7 +6,9 @@
 
 #include <gtest/gtest.h>
 
+#include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/status_test_util.h"
 
 namespace shaka {
 namespace media {
@@ -153,5 +155,84 @@ TEST(MuxerUtilTest, GetSegmentNameLargeTime) {
                            kBandwidth));
 }
 
+TEST(MuxerUtilTest, GetTimelineSegmentIndex) {
+  const uint32_t kTimeScale = 90000;
+  const double kSegmentDuration = 6;
+  uint32_t segment_index = 0;
+  EXPECT_TRUE(GetTimelineSegmentIndex(0, kTimeScale, kSegmentDuration,
+                                      &segment_index));
+  EXPECT_EQ(0u, segment_index);
+  EXPECT_TRUE(GetTimelineSegmentIndex(12 * kTimeScale, kTimeScale,
+                                      kSegmentDuration, &segment_index));
+  EXPECT_EQ(2u, segment_index);
+  // Rounded to the nearest boundary.
+  EXPECT_TRUE(GetTimelineSegmentIndex(11.9 * kTimeScale, kTimeScale,
+                                      kSegmentDuration, &segment_index));
+  EXPECT_EQ(2u, segment_index);
+  EXPECT_TRUE(GetTimelineSegmentIndex(12.1 * kTimeScale, kTimeScale,
+                                      kSegmentDuration, &segment_index));
+  EXPECT_EQ(2u, segment_index);
+  EXPECT_TRUE(GetTimelineSegmentIndex(-90000, kTimeScale, kSegmentDuration,
+                                      &segment_index));
+  EXPECT_EQ(0u, segment_index);
+  // Epoch timestamps.
+  const int64_t kEpochTimestamp = 1601599836LL * kTimeScale;
+  EXPECT_TRUE(GetTimelineSegmentIndex(kEpochTimestamp, kTimeScale,
+                                      kSegmentDuration, &segment_index));
+  EXPECT_EQ(266933306u, segment_index);
+}
+
+TEST(MuxerUtilTest, GetTimelineSegmentIndexOverflow) {
+  const uint32_t kTimeScale = 90000;
+  // The index of an epoch timestamp exceeds 32 bits below about 0.4 seconds.
+  const double kSegmentDuration = 0.1;
+  const int64_t kEpochTimestamp = 1601599836LL * kTimeScale;
+  uint32_t segment_index = 0;
+  EXPECT_FALSE(GetTimelineSegmentIndex(kEpochTimestamp, kTimeScale,
+                                       kSegmentDuration, &segment_index));
+  EXPECT_EQ(kMaxTimelineSegmentIndex, segment_index);
+}
+
+TEST(MuxerUtilTest, SegmentIndexer) {
+  const uint32_t kTimeScale = 1000;
+  MuxerOptions options;
+  options.segment_duration_in_seconds = 2;
+  options.first_segment_index = 5;
+  SegmentIndexer indexer(options);
+  uint32_t segment_index = 0;
+  ASSERT_OK(indexer.Next(10000, kTimeScale, &segment_index));
+  EXPECT_EQ(5u, segment_index);
+  ASSERT_OK(indexer.Next(12000, kTimeScale, &segment_index));
+  EXPECT_EQ(6u, segment_index);
+}
+
+TEST(MuxerUtilTest, SegmentIndexerFromTimestamps) {
+  const uint32_t kTimeScale = 1000;
+  MuxerOptions options;
+  options.segment_duration_in_seconds = 2;
+  options.segment_numbers_from_timestamps = true;
+  SegmentIndexer indexer(options);
+  uint32_t segment_index = 0;
+  ASSERT_OK(indexer.Next(9950, kTimeScale, &segment_index));
+  EXPECT_EQ(5u, segment_index);
+  ASSERT_OK(indexer.Next(12000, kTimeScale, &segment_index));
+  EXPECT_EQ(6u, segment_index);
+  // The numbers stay contiguous across gaps.
+  ASSERT_OK(indexer.Next(20000, kTimeScale, &segment_index));
+  EXPECT_EQ(7u, segment_index);
+}
+
+TEST(MuxerUtilTest, SegmentIndexerFromTimestampsOverflow) {
+  const uint32_t kTimeScale = 90000;
+  MuxerOptions options;
+  options.segment_duration_in_seconds = 0.1;
+  options.segment_numbers_from_timestamps = true;
+  SegmentIndexer indexer(options);
+  uint32_t segment_index = 0;
+  EXPECT_EQ(error::MUXER_FAILURE,
+            indexer.Next(1601599836LL * kTimeScale, kTimeScale, &segment_index)
+                .error_code());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -0,0 +1,102 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/numa_util.h"
+
+#if defined(OS_LINUX)
+#include <sched.h>
+#endif  // defined(OS_LINUX)
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+#if defined(OS_LINUX)
+const char kNumaNodeDir[] = "/sys/devices/system/node";
+#endif  // defined(OS_LINUX)
+
+}  // namespace
+
+bool ParseCpuList(const std::string& cpu_list, std::vector<int>* cpus) {
+  DCHECK(cpus);
+  cpus->clear();
+  for (const std::string& range :
+       base::SplitString(cpu_list, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    const size_t dash = range.find('-');
+    unsigned first = 0;
+    unsigned last = 0;
+    if (!base::StringToUint(range.substr(0, dash), &first))
+      return false;
+    if (dash == std::string::npos) {
+      last = first;
+    } else if (!base::StringToUint(range.substr(dash + 1), &last) ||
+               last < first) {
+      return false;
+    }
+    for (unsigned cpu = first; cpu <= last; ++cpu)
+      cpus->push_back(cpu);
+  }
+  return !cpus->empty();
+}
+
+int GetNumNumaNodes() {
+#if defined(OS_LINUX)
+  std::string online;
+  std::vector<int> nodes;
+  if (base::ReadFileToString(
+          base::FilePath(kNumaNodeDir).Append("online"), &online) &&
+      ParseCpuList(online, &nodes)) {
+    return nodes.back() + 1;
+  }
+#endif  // defined(OS_LINUX)
+  return 1;
+}
+
+bool PinCurrentThreadToNumaNode(int node) {
+#if defined(OS_LINUX)
+  std::string cpu_list;
+  std::vector<int> cpus;
+  if (!base::ReadFileToString(
+          base::FilePath(kNumaNodeDir)
+              .Append(base::StringPrintf("node%d", node))
+              .Append("cpulist"),
+          &cpu_list) ||
+      !ParseCpuList(cpu_list, &cpus)) {
+    LOG(WARNING) << "Cannot get the CPUs of NUMA node " << node << ".";
+    return false;
+  }
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &cpu_set);
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    PLOG(WARNING) << "Cannot pin the thread to NUMA node " << node << ".";
+    return false;
+  }
+  VLOG(1) << "Pinned the thread to NUMA node " << node << ", CPUs "
+          << base::TrimWhitespaceASCII(cpu_list, base::TRIM_ALL) << ".";
+  return true;
+#else
+  LOG(WARNING) << "Pinning threads to NUMA nodes is not supported on this "
+                  "platform.";
+  return false;
+#endif  // defined(OS_LINUX)
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,35 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_NUMA_UTIL_H_
+#define PACKAGER_MEDIA_BASE_NUMA_UTIL_H_
+
+#include <string>
+#include <vector>
+
+namespace shaka {
+namespace media {
+
+/// Parse a Linux CPU list, e.g. "0-3,8,10-11".
+/// @param[out] cpus gets the CPU indexes of @a cpu_list, in order.
+/// @return true on success.
+bool ParseCpuList(const std::string& cpu_list, std::vector<int>* cpus);
+
+/// @return the number of NUMA nodes of the host, or 1 if it cannot be
+///         determined, e.g. on platforms other than Linux.
+int GetNumNumaNodes();
+
+/// Restrict the calling thread to the CPUs of a NUMA node. Memory is allocated
+/// from the node a thread runs on when it is first touched, so the buffers the
+/// thread allocates and fills afterwards, e.g. by its SampleBufferPool, are
+/// node local.
+/// @return true on success. Always false on platforms other than Linux.
+bool PinCurrentThreadToNumaNode(int node);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_NUMA_UTIL_H_
@@ -0,0 +1,38 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/numa_util.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::ElementsAre;
+
+namespace shaka {
+namespace media {
+
+TEST(NumaUtilTest, ParseCpuList) {
+  std::vector<int> cpus;
+  ASSERT_TRUE(ParseCpuList("0-3,8,10-11\n", &cpus));
+  EXPECT_THAT(cpus, ElementsAre(0, 1, 2, 3, 8, 10, 11));
+  ASSERT_TRUE(ParseCpuList("5", &cpus));
+  EXPECT_THAT(cpus, ElementsAre(5));
+}
+
+TEST(NumaUtilTest, ParseInvalidCpuList) {
+  std::vector<int> cpus;
+  EXPECT_FALSE(ParseCpuList("", &cpus));
+  EXPECT_FALSE(ParseCpuList("a-3", &cpus));
+  EXPECT_FALSE(ParseCpuList("3-1", &cpus));
+  EXPECT_FALSE(ParseCpuList("1-", &cpus));
+}
+
+TEST(NumaUtilTest, HasAtLeastOneNode) {
+  EXPECT_GE(GetNumNumaNodes(), 1);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -9,11 +9,15 @@
 #include <algorithm>
 
 #include "packager/base/base64.h"
+#include "packager/base/bind.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/timer/elapsed_timer.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/http_key_fetcher.h"
+#include "packager/media/base/key_cache.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/status_macros.h"
@@ -24,6 +28,10 @@ namespace media {
 namespace {
 
 const uint32_t kHttpFetchTimeout = 60;  // In seconds
+// Number of times to retry requesting keys in case of a time out, with an
+// exponential backoff starting at |kFirstRetryDelayMilliseconds|.
+const int kNumTransientErrorRetries = 5;
+const int kFirstRetryDelayMilliseconds = 1000;
 const std::string kAcquireLicenseRequest =
     "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
     "<soap:Envelope xmlns=\"http://schemas.xmlsoap.org/soap/envelope/\" "
@@ -71,6 +79,8 @@ PlayReadyKeySource::PlayReadyKeySource(const std::string& server_url,
           protection_systems == ProtectionSystem::kNone ||
           has_flag(protection_systems, ProtectionSystem::kPlayReady)),
       encryption_key_(new EncryptionKey),
+      background_fetch_done_(base::WaitableEvent::ResetPolicy::MANUAL,
+                             base::WaitableEvent::InitialState::SIGNALED),
       server_url_(server_url) {}
 
 PlayReadyKeySource::PlayReadyKeySource(
@@ -81,12 +91,17 @@ PlayReadyKeySource::PlayReadyKeySource(
     ProtectionSystem protection_systems)
     // PlayReady PSSH is retrived from PlayReady server response.
     : encryption_key_(new EncryptionKey),
+      background_fetch_done_(base::WaitableEvent::ResetPolicy::MANUAL,
+                             base::WaitableEvent::InitialState::SIGNALED),
       server_url_(server_url),
       client_cert_file_(client_cert_file),
       client_cert_private_key_file_(client_cert_private_key_file),
       client_cert_private_key_password_(client_cert_private_key_password) {}
 
-PlayReadyKeySource::~PlayReadyKeySource() = default;
+PlayReadyKeySource::~PlayReadyKeySource() {
+  if (background_fetch_thread_)
+    background_fetch_thread_->Join();
+}
 
 Status RetrieveTextInXMLElement(const std::string& element,
                                 const std::string& xml,
@@ -173,21 +188,63 @@ Status PlayReadyKeySource::FetchKeysWithProgramIdentifier(
   std::string acquire_license_request = kAcquireLicenseRequest;
   base::ReplaceFirstSubstringAfterOffset(
       &acquire_license_request, 0, "$0", program_identifier);
-  std::string acquire_license_response;
-  Status status = key_fetcher.FetchKeys(server_url_, acquire_license_request,
-                                        &acquire_license_response);
-  VLOG(1) << "Server response: " << acquire_license_response;
-  RETURN_IF_ERROR(status);
+  auto fetch = [this, &key_fetcher, &acquire_license_request,
+                &encryption_key](std::string* acquire_license_response) {
+    Status status;
+    int64_t sleep_duration = kFirstRetryDelayMilliseconds;
+    for (int i = 0; i < kNumTransientErrorRetries; ++i) {
+      status = key_fetcher.FetchKeys(server_url_, acquire_license_request,
+                                     acquire_license_response);
+      if (status.error_code() != error::TIME_OUT)
+        break;
+      // Exponential backoff.
+      if (i != kNumTransientErrorRetries - 1) {
+        LOG(WARNING) << "PlayReady key request timed out, retrying.";
+        base::PlatformThread::Sleep(
+            base::TimeDelta::FromMilliseconds(sleep_duration));
+        sleep_duration *= 2;
+      }
+    }
+    VLOG(1) << "Server response: " << *acquire_license_response;
+    RETURN_IF_ERROR(status);
+    // Only cache valid responses.
+    return SetKeyInformationFromServerResponse(
+        *acquire_license_response, generate_playready_protection_system_,
+        encryption_key.get());
+  };
 
-  RETURN_IF_ERROR(SetKeyInformationFromServerResponse(
-      acquire_license_response, generate_playready_protection_system_,
-      encryption_key.get()));
+  std::string acquire_license_response;
+  if (key_cache_ttl_in_seconds_ > 0) {
+    bool cache_hit = false;
+    RETURN_IF_ERROR(KeyCache::GetInstance()->Get(
+        server_url_ + "\n" + acquire_license_request,
+        base::TimeDelta::FromSeconds(key_cache_ttl_in_seconds_), fetch,
+        &acquire_license_response, &cache_hit));
+    if (cache_hit) {
+      RETURN_IF_ERROR(SetKeyInformationFromServerResponse(
+          acquire_license_response, generate_playready_protection_system_,
+          encryption_key.get()));
+    }
+  } else {
+    RETURN_IF_ERROR(fetch(&acquire_license_response));
+  }
 
   // PlayReady does not specify different streams.
   encryption_key_ = std::move(encryption_key);
   return Status::OK;
 }
 
+void PlayReadyKeySource::FetchKeysInBackground(
+    const std::string& program_identifier) {
+  DCHECK(!background_fetch_thread_);
+  background_fetch_done_.Reset();
+  background_fetch_thread_.reset(new ClosureThread(
+      "KeyFetchThread",
+      base::Bind(&PlayReadyKeySource::FetchKeysInBackgroundTask,
+                 base::Unretained(this), program_identifier)));
+  background_fetch_thread_->Start();
+}
+
 Status PlayReadyKeySource::FetchKeys(EmeInitDataType init_data_type,
                                      const std::vector<uint8_t>& init_data) {
   // Do nothing for PlayReady encryption/decryption.
@@ -200,6 +257,7 @@ Status PlayReadyKeySource::GetKey(const std::string& stream_label,
   // key_id and key.  Add the ability to encrypt each stream_label using a
   // different key_id and key.
   DCHECK(key);
+  RETURN_IF_ERROR(WaitForBackgroundFetch());
   DCHECK(encryption_key_);
   *key = *encryption_key_;
   return Status::OK;
@@ -210,6 +268,7 @@ Status PlayReadyKeySource::GetKey(const std::vector<uint8_t>& key_id,
   // TODO(robinconnell): Currently all tracks are encrypted using the same
   // key_id and key.  Add the ability to encrypt using multiple key_id/keys.
   DCHECK(key);
+  RETURN_IF_ERROR(WaitForBackgroundFetch());
   DCHECK(encryption_key_);
   *key = *encryption_key_;
   return Status::OK;
@@ -220,9 +279,25 @@ Status PlayReadyKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
                                               const std::string& stream_label,
                                               EncryptionKey* key) {
   // TODO(robinconnell): Implement key rotation.
+  RETURN_IF_ERROR(WaitForBackgroundFetch());
   *key = *encryption_key_;
   return Status::OK;
 }
 
+void PlayReadyKeySource::FetchKeysInBackgroundTask(
+    const std::string& program_identifier) {
+  base::ElapsedTimer timer;
+  background_fetch_status_ = FetchKeysWithProgramIdentifier(program_identifier);
+  VLOG(1) << "Fetched the keys in the background in "
+          << timer.Elapsed().InMillisecondsF() << " ms: "
+          << background_fetch_status_;
+  background_fetch_done_.Signal();
+}
+
+Status PlayReadyKeySource::WaitForBackgroundFetch() {
+  background_fetch_done_.Wait();
+  return background_fetch_status_;
+}
+
 }  // namespace media
 }  // namespace shaka
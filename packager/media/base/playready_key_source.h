@@ -11,6 +11,8 @@
 #include <string>
 #include <vector>
 
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/key_source.h"
 
 namespace shaka {
@@ -54,6 +56,13 @@ class PlayReadyKeySource : public KeySource {
   /// @}
   virtual Status FetchKeysWithProgramIdentifier(const std::string& program_identifier);
 
+  /// Same as FetchKeysWithProgramIdentifier(), but fetches the keys on a
+  /// background thread and returns immediately, so the request overlaps with
+  /// the input probing. GetKey() and GetCryptoPeriodKey() wait for the keys,
+  /// and return the error of the request if it failed.
+  /// @param program_identifier identifies the program to fetch the keys of.
+  void FetchKeysInBackground(const std::string& program_identifier);
+
   /// Creates a new PlayReadyKeySource from the given data.
   /// Returns null if the strings are invalid.
   /// Note: GetKey on the created key source will always return the same key
@@ -65,20 +74,34 @@ class PlayReadyKeySource : public KeySource {
   void SetCaFile(const std::string& ca_file) {
     ca_file_ = ca_file;
   }
+  /// Set how long the key server responses are kept in the process-wide
+  /// KeyCache, which is shared with the other key sources requesting the same
+  /// keys from the same server. The cache is not used if it is zero.
+  void set_key_cache_ttl_in_seconds(uint32_t key_cache_ttl_in_seconds) {
+    key_cache_ttl_in_seconds_ = key_cache_ttl_in_seconds;
+  }
 
  private:
   Status GetKeyInternal();
   Status GetCryptoPeriodKeyInternal();
+  void FetchKeysInBackgroundTask(const std::string& program_identifier);
+  Status WaitForBackgroundFetch();
 
   // Indicates whether PlayReady protection system should be generated.
   bool generate_playready_protection_system_ = true;
 
   std::unique_ptr<EncryptionKey> encryption_key_;
+  // Not null if FetchKeysInBackground() is called.
+  std::unique_ptr<ClosureThread> background_fetch_thread_;
+  // Signaled, unless a request of FetchKeysInBackground() is in flight.
+  base::WaitableEvent background_fetch_done_;
+  Status background_fetch_status_;
   std::string server_url_;
   std::string ca_file_;
   std::string client_cert_file_;
   std::string client_cert_private_key_file_;
   std::string client_cert_private_key_password_;
+  uint32_t key_cache_ttl_in_seconds_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(PlayReadyKeySource);
 };
@@ -0,0 +1,313 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/sample_buffer_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/huge_page_buffer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Buffers are bucketed in power of two size classes from 2^kMinSizeClassBits
+// to 2^kMaxSizeClassBits. Larger requests bypass the pool.
+const size_t kMinSizeClassBits = 8;
+const size_t kMaxSizeClassBits = 26;
+const size_t kNumSizeClasses = kMaxSizeClassBits - kMinSizeClassBits + 1;
+const size_t kNotPooled = kNumSizeClasses;
+
+size_t GetSizeClass(size_t size) {
+  size_t size_class = 0;
+  while ((size_t{1} << (size_class + kMinSizeClassBits)) < size) {
+    if (++size_class == kNumSizeClasses)
+      return kNotPooled;
+  }
+  return size_class;
+}
+
+size_t GetSizeClassBytes(size_t size_class) {
+  return size_t{1} << (size_class + kMinSizeClassBits);
+}
+
+thread_local SampleBufferPool* g_current_pool = nullptr;
+
+}  // namespace
+
+class SampleBufferPool::Core : public std::enable_shared_from_this<Core> {
+ public:
+  explicit Core(size_t max_cached_bytes)
+      : max_cached_bytes_(max_cached_bytes),
+        huge_page_mode_(HugePageBuffer::GetDefaultMode()),
+        free_lists_(kNumSizeClasses),
+        slab_free_(kNumSizeClasses),
+        slab_end_(kNumSizeClasses) {}
+
+  ~Core() {
+    for (auto& control_blocks : free_control_blocks_) {
+      for (void* control_block : control_blocks.second)
+        ::operator delete(control_block);
+    }
+    // The buffers carved from |slabs_| are freed with them.
+    if (huge_page_mode_ != HugePageMode::kNone)
+      return;
+    for (std::vector<uint8_t*>& free_list : free_lists_) {
+      for (uint8_t* buffer : free_list)
+        delete[] buffer;
+    }
+  }
+
+  std::shared_ptr<uint8_t> Acquire(size_t size) {
+    const size_t size_class = GetSizeClass(size);
+    if (size_class == kNotPooled) {
+      misses_++;
+      if (huge_page_mode_ != HugePageMode::kNone) {
+        std::shared_ptr<HugePageBuffer> buffer =
+            std::allocate_shared<HugePageBuffer>(
+                ControlBlockAllocator<HugePageBuffer>(shared_from_this()),
+                size, huge_page_mode_);
+        return std::shared_ptr<uint8_t>(buffer, buffer->data());
+      }
+      return MakeBuffer(new uint8_t[size], kNotPooled);
+    }
+
+    uint8_t* buffer = nullptr;
+    {
+      base::AutoLock auto_lock(lock_);
+      std::vector<uint8_t*>& free_list = free_lists_[size_class];
+      if (!free_list.empty()) {
+        buffer = free_list.back();
+        free_list.pop_back();
+        cached_bytes_ -= GetSizeClassBytes(size_class);
+      }
+    }
+    if (buffer) {
+      hits_++;
+    } else {
+      misses_++;
+      buffer = huge_page_mode_ == HugePageMode::kNone
+                   ? new uint8_t[GetSizeClassBytes(size_class)]
+                   : AllocateFromSlab(size_class);
+    }
+    return MakeBuffer(buffer, size_class);
+  }
+
+  void Release(uint8_t* buffer, size_t size_class) {
+    if (size_class == kNotPooled) {
+      delete[] buffer;
+      return;
+    }
+    const size_t bytes = GetSizeClassBytes(size_class);
+    {
+      base::AutoLock auto_lock(lock_);
+      // A buffer carved from a slab cannot be freed on its own, so it is
+      // always kept.
+      if (cached_bytes_ + bytes <= max_cached_bytes_ ||
+          huge_page_mode_ != HugePageMode::kNone) {
+        free_lists_[size_class].push_back(buffer);
+        cached_bytes_ += bytes;
+        return;
+      }
+    }
+    delete[] buffer;
+  }
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+  size_t cached_bytes() const {
+    base::AutoLock auto_lock(lock_);
+    return cached_bytes_;
+  }
+
+ private:
+  Core(const Core&) = delete;
+  Core& operator=(const Core&) = delete;
+
+  // Owns a buffer, which is released to the pool when the last reference to
+  // it is dropped. It lives in the control block of the shared_ptr.
+  class PooledBuffer {
+   public:
+    PooledBuffer(Core* core, uint8_t* data, size_t size_class)
+        : core_(core), data_(data), size_class_(size_class) {}
+    ~PooledBuffer() { core_->Release(data_, size_class_); }
+
+    uint8_t* data() const { return data_; }
+
+   private:
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    Core* const core_;
+    uint8_t* const data_;
+    const size_t size_class_;
+  };
+
+  // Allocates the control blocks of the shared_ptrs of the buffers from the
+  // free lists of the pool, so a pool hit does not allocate at all. It keeps
+  // the pool alive until the control block is freed.
+  template <typename T>
+  class ControlBlockAllocator {
+   public:
+    typedef T value_type;
+
+    explicit ControlBlockAllocator(std::shared_ptr<Core> core)
+        : core_(std::move(core)) {}
+    template <typename U>
+    ControlBlockAllocator(const ControlBlockAllocator<U>& other)
+        : core_(other.core()) {}
+
+    T* allocate(size_t n) {
+      return static_cast<T*>(core_->AllocateControlBlock(n * sizeof(T)));
+    }
+    void deallocate(T* control_block, size_t n) {
+      core_->FreeControlBlock(control_block, n * sizeof(T));
+    }
+
+    const std::shared_ptr<Core>& core() const { return core_; }
+
+    template <typename U>
+    bool operator==(const ControlBlockAllocator<U>& other) const {
+      return core_ == other.core();
+    }
+    template <typename U>
+    bool operator!=(const ControlBlockAllocator<U>& other) const {
+      return core_ != other.core();
+    }
+
+   private:
+    std::shared_ptr<Core> core_;
+  };
+
+  std::shared_ptr<uint8_t> MakeBuffer(uint8_t* data, size_t size_class) {
+    std::shared_ptr<PooledBuffer> buffer = std::allocate_shared<PooledBuffer>(
+        ControlBlockAllocator<PooledBuffer>(shared_from_this()), this, data,
+        size_class);
+    return std::shared_ptr<uint8_t>(buffer, data);
+  }
+
+  void* AllocateControlBlock(size_t size) {
+    {
+      base::AutoLock auto_lock(lock_);
+      for (auto& control_blocks : free_control_blocks_) {
+        if (control_blocks.first == size && !control_blocks.second.empty()) {
+          void* control_block = control_blocks.second.back();
+          control_blocks.second.pop_back();
+          return control_block;
+        }
+      }
+    }
+    return ::operator new(size);
+  }
+
+  // The control blocks are always kept: there is one per outstanding buffer
+  // and they are small.
+  void FreeControlBlock(void* control_block, size_t size) {
+    base::AutoLock auto_lock(lock_);
+    for (auto& control_blocks : free_control_blocks_) {
+      if (control_blocks.first == size) {
+        control_blocks.second.push_back(control_block);
+        return;
+      }
+    }
+    free_control_blocks_.emplace_back(size,
+                                      std::vector<void*>(1, control_block));
+  }
+
+  // Carve a buffer of |size_class| from the huge page slab of the class, or
+  // from a new slab if it is full. The buffers of at least a huge page get a
+  // slab of their own.
+  uint8_t* AllocateFromSlab(size_t size_class) {
+    const size_t bytes = GetSizeClassBytes(size_class);
+    base::AutoLock auto_lock(lock_);
+    if (slab_end_[size_class] - slab_free_[size_class] <
+        static_cast<ptrdiff_t>(bytes)) {
+      const size_t slab_size =
+          std::max(bytes, size_t{HugePageBuffer::kHugePageSize});
+      slabs_.emplace_back(slab_size, huge_page_mode_);
+      slab_free_[size_class] = slabs_.back().data();
+      slab_end_[size_class] = slabs_.back().data() + slabs_.back().size();
+    }
+    uint8_t* buffer = slab_free_[size_class];
+    slab_free_[size_class] += bytes;
+    return buffer;
+  }
+
+  const size_t max_cached_bytes_;
+  // If not kNone, the pooled buffers are carved from |slabs_|, which are
+  // backed by huge pages.
+  const HugePageMode huge_page_mode_;
+
+  mutable base::Lock lock_;
+  std::vector<std::vector<uint8_t*>> free_lists_;
+  size_t cached_bytes_ = 0;
+  std::deque<HugePageBuffer> slabs_;
+  // The unused part of the current slab of each size class.
+  std::vector<uint8_t*> slab_free_;
+  std::vector<uint8_t*> slab_end_;
+  // The free control blocks, by size. There are only a couple of sizes, one
+  // per type of buffer.
+  std::vector<std::pair<size_t, std::vector<void*>>> free_control_blocks_;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+SampleBufferPool::SampleBufferPool(size_t max_cached_bytes)
+    : core_(new Core(max_cached_bytes)) {}
+
+SampleBufferPool::~SampleBufferPool() {
+  DCHECK_NE(g_current_pool, this);
+}
+
+std::shared_ptr<uint8_t> SampleBufferPool::Acquire(size_t size) {
+  return core_->Acquire(size);
+}
+
+uint64_t SampleBufferPool::hits() const {
+  return core_->hits();
+}
+
+uint64_t SampleBufferPool::misses() const {
+  return core_->misses();
+}
+
+size_t SampleBufferPool::cached_bytes() const {
+  return core_->cached_bytes();
+}
+
+// static
+std::shared_ptr<uint8_t> SampleBufferPool::Allocate(size_t size) {
+  if (g_current_pool)
+    return g_current_pool->Acquire(size);
+  return std::shared_ptr<uint8_t>(new uint8_t[size],
+                                  std::default_delete<uint8_t[]>());
+}
+
+// static
+SampleBufferPool* SampleBufferPool::Current() {
+  return g_current_pool;
+}
+
+ScopedSampleBufferPool::ScopedSampleBufferPool(SampleBufferPool* pool)
+    : previous_pool_(g_current_pool) {
+  g_current_pool = pool;
+}
+
+ScopedSampleBufferPool::~ScopedSampleBufferPool() {
+  g_current_pool = previous_pool_;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,81 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_SAMPLE_BUFFER_POOL_H_
+#define PACKAGER_MEDIA_BASE_SAMPLE_BUFFER_POOL_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+namespace shaka {
+namespace media {
+
+/// A thread safe pool of sample payload buffers. Buffers are grouped in power
+/// of two size classes and returned to the pool when the last reference is
+/// released, so steady-state packaging does not hit the heap for every sample.
+/// Buffers may outlive the pool; they are freed directly in that case.
+/// If --huge_pages is enabled, the buffers are carved from slabs backed by
+/// huge pages, which are only freed with the pool, so the released buffers
+/// are kept regardless of the maximum number of cached bytes.
+class SampleBufferPool {
+ public:
+  static const size_t kDefaultMaxCachedBytes = 64 * 1024 * 1024;
+
+  /// @param max_cached_bytes is the maximum number of bytes kept in the free
+  ///        lists. Buffers released beyond this limit are freed.
+  explicit SampleBufferPool(size_t max_cached_bytes = kDefaultMaxCachedBytes);
+  ~SampleBufferPool();
+
+  /// Get a buffer of at least @a size bytes. The returned buffer goes back to
+  /// the pool when the last reference to it is dropped.
+  std::shared_ptr<uint8_t> Acquire(size_t size);
+
+  /// @return the number of Acquire calls served from the free lists.
+  uint64_t hits() const;
+  /// @return the number of Acquire calls that allocated from the heap.
+  uint64_t misses() const;
+  /// @return the number of bytes currently kept in the free lists.
+  size_t cached_bytes() const;
+
+  /// Allocate a sample buffer of @a size bytes from the pool installed on the
+  /// current thread by ScopedSampleBufferPool, or from the heap if there is
+  /// none.
+  static std::shared_ptr<uint8_t> Allocate(size_t size);
+
+  /// @return the pool installed on the current thread, can be NULL.
+  static SampleBufferPool* Current();
+
+ private:
+  friend class ScopedSampleBufferPool;
+
+  SampleBufferPool(const SampleBufferPool&) = delete;
+  SampleBufferPool& operator=(const SampleBufferPool&) = delete;
+
+  // The free lists live in |core_| which is shared with the outstanding
+  // buffers, so a buffer released after the pool is gone is still safe.
+  class Core;
+  std::shared_ptr<Core> core_;
+};
+
+/// Installs a SampleBufferPool for the current thread for the lifetime of this
+/// object. Restores the previously installed pool on destruction.
+class ScopedSampleBufferPool {
+ public:
+  explicit ScopedSampleBufferPool(SampleBufferPool* pool);
+  ~ScopedSampleBufferPool();
+
+ private:
+  ScopedSampleBufferPool(const ScopedSampleBufferPool&) = delete;
+  ScopedSampleBufferPool& operator=(const ScopedSampleBufferPool&) = delete;
+
+  SampleBufferPool* previous_pool_ = nullptr;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_SAMPLE_BUFFER_POOL_H_
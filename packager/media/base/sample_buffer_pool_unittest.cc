@@ -0,0 +1,107 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/sample_buffer_pool.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "packager/media/base/media_sample.h"
+
+DECLARE_string(huge_pages);
+
+namespace shaka {
+namespace media {
+namespace {
+const uint8_t kData[] = {0x01, 0x02, 0x03, 0x04, 0x05};
+}  // namespace
+
+TEST(SampleBufferPoolTest, ReleasedBufferIsReused) {
+  SampleBufferPool pool;
+  uint8_t* first_buffer = nullptr;
+  {
+    std::shared_ptr<uint8_t> buffer = pool.Acquire(1000);
+    first_buffer = buffer.get();
+  }
+  EXPECT_EQ(0u, pool.hits());
+  EXPECT_EQ(1u, pool.misses());
+  EXPECT_EQ(1024u, pool.cached_bytes());
+
+  // Same size class.
+  std::shared_ptr<uint8_t> buffer = pool.Acquire(800);
+  EXPECT_EQ(first_buffer, buffer.get());
+  EXPECT_EQ(1u, pool.hits());
+  EXPECT_EQ(1u, pool.misses());
+  EXPECT_EQ(0u, pool.cached_bytes());
+}
+
+TEST(SampleBufferPoolTest, DifferentSizeClassMisses) {
+  SampleBufferPool pool;
+  pool.Acquire(100);
+  pool.Acquire(5000);
+  EXPECT_EQ(0u, pool.hits());
+  EXPECT_EQ(2u, pool.misses());
+}
+
+TEST(SampleBufferPoolTest, MaxCachedBytes) {
+  SampleBufferPool pool(1024);
+  {
+    std::shared_ptr<uint8_t> buffer1 = pool.Acquire(1024);
+    std::shared_ptr<uint8_t> buffer2 = pool.Acquire(1024);
+  }
+  EXPECT_EQ(1024u, pool.cached_bytes());
+}
+
+TEST(SampleBufferPoolTest, BufferOutlivesPool) {
+  std::shared_ptr<uint8_t> buffer;
+  {
+    SampleBufferPool pool;
+    buffer = pool.Acquire(64);
+  }
+  memset(buffer.get(), 0, 64);
+  buffer.reset();
+}
+
+TEST(SampleBufferPoolTest, MediaSampleUsesCurrentPool) {
+  SampleBufferPool pool;
+  EXPECT_EQ(nullptr, SampleBufferPool::Current());
+  {
+    ScopedSampleBufferPool scoped_pool(&pool);
+    EXPECT_EQ(&pool, SampleBufferPool::Current());
+
+    MediaSample::CopyFrom(kData, sizeof(kData), true);
+    std::shared_ptr<MediaSample> sample =
+        MediaSample::CopyFrom(kData, sizeof(kData), true);
+    EXPECT_EQ(0, memcmp(kData, sample->data(), sizeof(kData)));
+  }
+  EXPECT_EQ(nullptr, SampleBufferPool::Current());
+  EXPECT_EQ(1u, pool.hits());
+  EXPECT_EQ(1u, pool.misses());
+}
+
+TEST(SampleBufferPoolTest, HugePageSlabs) {
+  google::FlagSaver flag_saver;
+  FLAGS_huge_pages = "transparent";
+  SampleBufferPool pool(1024);
+  std::shared_ptr<uint8_t> buffer1 = pool.Acquire(1000);
+  std::shared_ptr<uint8_t> buffer2 = pool.Acquire(1000);
+  // Carved from the same slab.
+  EXPECT_EQ(buffer1.get() + 1024, buffer2.get());
+  memset(buffer2.get(), 0, 1024);
+
+  // Kept beyond the maximum cached bytes, as the slab is not freed.
+  buffer1.reset();
+  buffer2.reset();
+  EXPECT_EQ(2048u, pool.cached_bytes());
+
+  std::shared_ptr<uint8_t> large_buffer = pool.Acquire(size_t{1} << 27);
+  memset(large_buffer.get(), 0, 1024);
+  EXPECT_EQ(3u, pool.misses());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -12,7 +12,8 @@
 namespace shaka {
 namespace media {
 
-TextMuxer::TextMuxer(const MuxerOptions& options) : Muxer(options) {}
+TextMuxer::TextMuxer(const MuxerOptions& options)
+    : Muxer(options), segment_indexer_(options) {}
 TextMuxer::~TextMuxer() {}
 
 Status TextMuxer::InitializeMuxer() {
@@ -75,8 +76,10 @@ Status TextMuxer::FinalizeSegment(size_t stream_id,
 
   const std::string& segment_template = options().segment_template;
   DCHECK(!segment_template.empty());
-  const uint32_t index = segment_index_++;
   const uint64_t start = segment_info.start_timestamp;
+  uint32_t index = 0;
+  RETURN_IF_ERROR(
+      segment_indexer_.Next(start, streams()[0]->time_scale(), &index));
   const uint64_t duration = segment_info.duration;
   const uint32_t bandwidth = options().bandwidth;
 
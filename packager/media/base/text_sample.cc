@@ -31,6 +31,14 @@ TextSample::TextSample(const std::string& id,
       settings_(settings),
       body_(body) {}
 
+std::shared_ptr<TextSample> TextSample::CreateHeartbeat(int64_t time) {
+  const std::string kNoId;
+  std::shared_ptr<TextSample> heartbeat = std::make_shared<TextSample>(
+      kNoId, time, time, TextSettings(), TextFragment());
+  heartbeat->is_heartbeat_ = true;
+  return heartbeat;
+}
+
 int64_t TextSample::EndTime() const {
   return start_time_ + duration_;
 }
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -120,6 +121,12 @@ class TextSample {
              const TextSettings& settings,
              const TextFragment& body);
 
+  /// Create a heartbeat, i.e. a sample without a cue which only signals that
+  /// the input has reached @a time, e.g. the time of the video of a sparse
+  /// text stream, so the text segments can be emitted without waiting for the
+  /// next cue.
+  static std::shared_ptr<TextSample> CreateHeartbeat(int64_t time);
+
   const std::string& id() const { return id_; }
   int64_t start_time() const { return start_time_; }
   int64_t duration() const { return duration_; }
@@ -130,6 +137,8 @@ class TextSample {
   int32_t sub_stream_index() const { return sub_stream_index_; }
   void set_sub_stream_index(int32_t idx) { sub_stream_index_ = idx; }
 
+  bool is_heartbeat() const { return is_heartbeat_; }
+
  private:
   // Allow the compiler generated copy constructor and assignment operator
   // intentionally. Since the text data is typically small, the performance
@@ -141,6 +150,7 @@ class TextSample {
   const TextSettings settings_;
   const TextFragment body_;
   int32_t sub_stream_index_ = -1;
+  bool is_heartbeat_ = false;
 };
 
 }  // namespace media
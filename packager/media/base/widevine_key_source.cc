@@ -8,10 +8,14 @@
 
 #include <gflags/gflags.h>
 
+#include <algorithm>
+
 #include "packager/base/base64.h"
 #include "packager/base/bind.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/timer/elapsed_timer.h"
 #include "packager/media/base/http_key_fetcher.h"
+#include "packager/media/base/key_cache.h"
 #include "packager/media/base/network_util.h"
 #include "packager/media/base/producer_consumer_queue.h"
 #include "packager/media/base/protection_system_ids.h"
@@ -21,6 +25,7 @@
 #include "packager/media/base/rcheck.h"
 #include "packager/media/base/request_signer.h"
 #include "packager/media/base/widevine_common_encryption.pb.h"
+#include "packager/status_macros.h"
 
 DEFINE_string(video_feature,
               "",
@@ -40,6 +45,12 @@ const int kFirstRetryDelayMilliseconds = 1000;
 // Default crypto period count, which is the number of keys to fetch on every
 // key rotation enabled request.
 const int kDefaultCryptoPeriodCount = 10;
+// Default number of key rotation requests whose keys are fetched ahead of the
+// latest requested crypto period.
+const int kDefaultLookaheadRequestCount = 5;
+// GetCryptoPeriodKey() calls which wait longer than this for the keys are
+// counted as stalls.
+const int kStallThresholdMilliseconds = 1;
 const int kGetKeyTimeoutInSeconds = 5 * 60;  // 5 minutes.
 const int kKeyFetchTimeoutInSeconds = 60;  // 1 minute.
 
@@ -81,6 +92,36 @@ ProtectionSystemSpecificInfo ProtectionSystemInfoFromPsshProto(
   }
 }
 
+// Return true if |response| is properly formatted and has an OK status.
+// |transient_error| is set to true if the server returned a transient error.
+bool IsResponseOk(const std::string& response, bool* transient_error) {
+  DCHECK(transient_error);
+  *transient_error = false;
+
+  SignedModularDrmResponse signed_response_proto;
+  if (!JsonStringToMessage(response, &signed_response_proto)) {
+    LOG(ERROR) << "Failed to convert JSON to proto: " << response;
+    return false;
+  }
+
+  CommonEncryptionResponse response_proto;
+  if (!JsonStringToMessage(signed_response_proto.response(), &response_proto)) {
+    LOG(ERROR) << "Failed to convert JSON to proto: "
+               << signed_response_proto.response();
+    return false;
+  }
+
+  if (response_proto.status() != CommonEncryptionResponse::OK) {
+    LOG(ERROR) << "Received non-OK license response: " << response;
+    // Server may return INTERNAL_ERROR intermittently, which is a transient
+    // error and the next client request may succeed without problem.
+    *transient_error =
+        (response_proto.status() == CommonEncryptionResponse::INTERNAL_ERROR);
+    return false;
+  }
+  return true;
+}
+
 }  // namespace
 
 WidevineKeySource::WidevineKeySource(const std::string& server_url,
@@ -100,11 +141,15 @@ WidevineKeySource::WidevineKeySource(const std::string& server_url,
       crypto_period_count_(kDefaultCryptoPeriodCount),
       protection_scheme_(protection_scheme),
       start_key_production_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                            base::WaitableEvent::InitialState::NOT_SIGNALED) {
+                            base::WaitableEvent::InitialState::NOT_SIGNALED),
+      background_fetch_done_(base::WaitableEvent::ResetPolicy::MANUAL,
+                             base::WaitableEvent::InitialState::SIGNALED) {
   key_production_thread_.Start();
 }
 
 WidevineKeySource::~WidevineKeySource() {
+  if (background_fetch_thread_)
+    background_fetch_thread_->Join();
   if (key_pool_)
     key_pool_->Stop();
   if (key_production_thread_.HasBeenStarted()) {
@@ -113,6 +158,15 @@ WidevineKeySource::~WidevineKeySource() {
     start_key_production_.Signal();
     key_production_thread_.Join();
   }
+  if (num_key_rotation_requests_ > 0) {
+    LOG(INFO) << "Key rotation: " << num_key_rotation_requests_
+              << " requests, latency average "
+              << (total_request_latency_ / num_key_rotation_requests_)
+                     .InMillisecondsF()
+              << " ms, max " << max_request_latency_.InMillisecondsF()
+              << " ms; " << num_stalls_ << " stalls, "
+              << total_stall_time_.InMillisecondsF() << " ms in total.";
+  }
 }
 
 Status WidevineKeySource::FetchKeys(const std::vector<uint8_t>& content_id,
@@ -130,6 +184,18 @@ Status WidevineKeySource::FetchKeys(const std::vector<uint8_t>& content_id,
   return FetchKeysInternal(!kEnableKeyRotation, 0, false);
 }
 
+void WidevineKeySource::FetchKeysInBackground(
+    const std::vector<uint8_t>& content_id,
+    const std::string& policy) {
+  DCHECK(!background_fetch_thread_);
+  background_fetch_done_.Reset();
+  background_fetch_thread_.reset(new ClosureThread(
+      "KeyFetchThread",
+      base::Bind(&WidevineKeySource::FetchKeysInBackgroundTask,
+                 base::Unretained(this), content_id, policy)));
+  background_fetch_thread_->Start();
+}
+
 Status WidevineKeySource::FetchKeys(EmeInitDataType init_data_type,
                                     const std::vector<uint8_t>& init_data) {
   std::vector<uint8_t> pssh_data;
@@ -195,6 +261,7 @@ Status WidevineKeySource::FetchKeys(EmeInitDataType init_data_type,
 Status WidevineKeySource::GetKey(const std::string& stream_label,
                                  EncryptionKey* key) {
   DCHECK(key);
+  RETURN_IF_ERROR(WaitForBackgroundFetch());
   if (encryption_key_map_.find(stream_label) == encryption_key_map_.end()) {
     return Status(error::INTERNAL_ERROR,
                   "Cannot find key for '" + stream_label + "'.");
@@ -206,6 +273,7 @@ Status WidevineKeySource::GetKey(const std::string& stream_label,
 Status WidevineKeySource::GetKey(const std::vector<uint8_t>& key_id,
                                  EncryptionKey* key) {
   DCHECK(key);
+  RETURN_IF_ERROR(WaitForBackgroundFetch());
   for (const auto& pair : encryption_key_map_) {
     if (pair.second->key_id == key_id) {
       *key = *pair.second;
@@ -221,9 +289,12 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
                                              const std::string& stream_label,
                                              EncryptionKey* key) {
   DCHECK(key_production_thread_.HasBeenStarted());
+  RETURN_IF_ERROR(WaitForBackgroundFetch());
   // TODO(kqyang): This is not elegant. Consider refactoring later.
   {
     base::AutoLock scoped_lock(lock_);
+    if (cancelled_)
+      return Status(error::CANCELLED, "Key fetching cancelled.");
     if (!key_production_started_) {
       crypto_period_duration_in_seconds_ = crypto_period_duration_in_seconds;
       // Another client may have a slightly smaller starting crypto period
@@ -231,7 +302,15 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
       first_crypto_period_index_ =
           crypto_period_index ? crypto_period_index - 1 : 0;
       DCHECK(!key_pool_);
-      const size_t queue_size = crypto_period_count_ * 10;
+      DCHECK_GT(crypto_period_count_, 0u);
+      // The key pool keeps the keys of up to |lookahead| crypto periods before
+      // and after the latest requested one, so the producer fetches up to
+      // |lookahead| periods ahead.
+      const size_t lookahead =
+          crypto_period_lookahead_
+              ? std::max(crypto_period_lookahead_, crypto_period_count_)
+              : crypto_period_count_ * kDefaultLookaheadRequestCount;
+      const size_t queue_size = lookahead * 2;
       key_pool_.reset(
           new EncryptionKeyQueue(queue_size, first_crypto_period_index_));
       start_key_production_.Signal();
@@ -245,6 +324,15 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
   return GetKeyInternal(crypto_period_index, stream_label, key);
 }
 
+void WidevineKeySource::Cancel() {
+  cancelled_ = true;
+  // |key_pool_| is created under |lock_|. Stopping it unblocks the calls
+  // waiting for the keys of the next crypto periods, and the key production.
+  base::AutoLock scoped_lock(lock_);
+  if (key_pool_)
+    key_pool_->Stop();
+}
+
 void WidevineKeySource::set_signer(std::unique_ptr<RequestSigner> signer) {
   signer_ = std::move(signer);
 }
@@ -261,10 +349,22 @@ Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
   DCHECK(key);
 
   std::shared_ptr<EncryptionKeyMap> encryption_key_map;
+  base::ElapsedTimer timer;
   Status status = key_pool_->Peek(crypto_period_index, &encryption_key_map,
                                   kGetKeyTimeoutInSeconds * 1000);
+  const base::TimeDelta wait_time = timer.Elapsed();
+  if (wait_time.InMilliseconds() >= kStallThresholdMilliseconds) {
+    // The first crypto period always waits for the first request.
+    VLOG(1) << "Waited " << wait_time.InMillisecondsF()
+            << " ms for the keys of crypto period " << crypto_period_index;
+    base::AutoLock scoped_lock(stats_lock_);
+    ++num_stalls_;
+    total_stall_time_ += wait_time;
+  }
   if (!status.ok()) {
     if (status.error_code() == error::STOPPED) {
+      if (cancelled_)
+        return Status(error::CANCELLED, "Key fetching cancelled.");
       CHECK(!common_encryption_request_status_.ok());
       return common_encryption_request_status_;
     }
@@ -285,50 +385,109 @@ void WidevineKeySource::FetchKeysTask() {
   if (!key_pool_ || key_pool_->Stopped())
     return;
 
-  Status status = FetchKeysInternal(kEnableKeyRotation,
-                                    first_crypto_period_index_,
-                                    false);
-  while (status.ok()) {
-    first_crypto_period_index_ += crypto_period_count_;
-    status = FetchKeysInternal(kEnableKeyRotation,
-                               first_crypto_period_index_,
+  Status status;
+  while (true) {
+    base::ElapsedTimer timer;
+    status = FetchKeysInternal(kEnableKeyRotation, first_crypto_period_index_,
                                false);
+    if (!status.ok())
+      break;
+    // Includes the time blocked pushing the keys to a full key pool.
+    const base::TimeDelta latency = timer.Elapsed();
+    VLOG(1) << "Fetched the keys of crypto periods "
+            << first_crypto_period_index_ << " to "
+            << first_crypto_period_index_ + crypto_period_count_ - 1 << " in "
+            << latency.InMillisecondsF() << " ms.";
+    {
+      base::AutoLock scoped_lock(stats_lock_);
+      ++num_key_rotation_requests_;
+      total_request_latency_ += latency;
+      max_request_latency_ = std::max(max_request_latency_, latency);
+    }
+    first_crypto_period_index_ += crypto_period_count_;
   }
   common_encryption_request_status_ = status;
   key_pool_->Stop();
 }
 
+void WidevineKeySource::FetchKeysInBackgroundTask(
+    const std::vector<uint8_t>& content_id,
+    const std::string& policy) {
+  base::ElapsedTimer timer;
+  background_fetch_status_ = FetchKeys(content_id, policy);
+  VLOG(1) << "Fetched the keys in the background in "
+          << timer.Elapsed().InMillisecondsF() << " ms: "
+          << background_fetch_status_;
+  background_fetch_done_.Signal();
+}
+
+Status WidevineKeySource::WaitForBackgroundFetch() {
+  background_fetch_done_.Wait();
+  return background_fetch_status_;
+}
+
 Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
                                             uint32_t first_crypto_period_index,
                                             bool widevine_classic) {
   CommonEncryptionRequest request;
   FillRequest(enable_key_rotation, first_crypto_period_index, &request);
 
+  std::string raw_response;
+  Status status;
+  if (key_cache_ttl_in_seconds_ > 0) {
+    // The request contains the content id, the policy and the crypto periods
+    // among others, so packager instances requesting the same keys share the
+    // response.
+    const std::string cache_key =
+        server_url_ + "\n" + (signer_ ? signer_->signer_name() : "") + "\n" +
+        MessageToJsonString(request);
+    status = KeyCache::GetInstance()->Get(
+        cache_key, base::TimeDelta::FromSeconds(key_cache_ttl_in_seconds_),
+        [this, &request](std::string* response) {
+          return FetchResponse(request, response);
+        },
+        &raw_response, nullptr);
+  } else {
+    status = FetchResponse(request, &raw_response);
+  }
+  if (!status.ok())
+    return status;
+
+  bool transient_error = false;
+  if (!ExtractEncryptionKey(enable_key_rotation, widevine_classic,
+                            raw_response, &transient_error)) {
+    return Status(
+        error::SERVER_ERROR,
+        "Failed to extract encryption key from '" + raw_response + "'.");
+  }
+  return Status::OK;
+}
+
+Status WidevineKeySource::FetchResponse(const CommonEncryptionRequest& request,
+                                        std::string* raw_response) {
   std::string message;
   Status status = GenerateKeyMessage(request, &message);
   if (!status.ok())
     return status;
   VLOG(1) << "Message: " << message;
 
-  std::string raw_response;
   int64_t sleep_duration = kFirstRetryDelayMilliseconds;
 
   // Perform client side retries if seeing server transient error to workaround
   // server limitation.
   for (int i = 0; i < kNumTransientErrorRetries; ++i) {
-    status = key_fetcher_->FetchKeys(server_url_, message, &raw_response);
+    status = key_fetcher_->FetchKeys(server_url_, message, raw_response);
     if (status.ok()) {
-      VLOG(1) << "Retry [" << i << "] Response:" << raw_response;
+      VLOG(1) << "Retry [" << i << "] Response:" << *raw_response;
 
       bool transient_error = false;
-      if (ExtractEncryptionKey(enable_key_rotation, widevine_classic,
-                               raw_response, &transient_error))
+      if (IsResponseOk(*raw_response, &transient_error))
         return Status::OK;
 
       if (!transient_error) {
         return Status(
             error::SERVER_ERROR,
-            "Failed to extract encryption key from '" + raw_response + "'.");
+            "Failed to extract encryption key from '" + *raw_response + "'.");
       }
     } else if (status.error_code() != error::TIME_OUT) {
       return status;
@@ -426,7 +585,8 @@ bool WidevineKeySource::ExtractEncryptionKey(
   }
 
   RCHECK(enable_key_rotation
-             ? response_proto.tracks_size() >= crypto_period_count_
+             ? static_cast<uint32_t>(response_proto.tracks_size()) >=
+                   crypto_period_count_
              : response_proto.tracks_size() >= 1);
 
   uint32_t current_crypto_period_index = first_crypto_period_index_;
@@ -7,9 +7,11 @@
 #ifndef PACKAGER_MEDIA_BASE_WIDEVINE_KEY_SOURCE_H_
 #define PACKAGER_MEDIA_BASE_WIDEVINE_KEY_SOURCE_H_
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/time/time.h"
 #include "packager/media/base/closure_thread.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/key_source.h"
@@ -51,6 +53,7 @@ class WidevineKeySource : public KeySource {
                             uint32_t crypto_period_duration_in_seconds,
                             const std::string& stream_label,
                             EncryptionKey* key) override;
+  void Cancel() override;
   /// @}
 
   /// Fetch keys for CENC from the key server.
@@ -60,6 +63,15 @@ class WidevineKeySource : public KeySource {
   Status FetchKeys(const std::vector<uint8_t>& content_id,
                    const std::string& policy);
 
+  /// Same as FetchKeys() above, but fetches the keys on a background thread
+  /// and returns immediately, so the request overlaps with the input probing.
+  /// GetKey() and GetCryptoPeriodKey() wait for the keys, and return the
+  /// error of the request if it failed.
+  /// @param content_id the unique id identify the content.
+  /// @param policy specifies the DRM content rights.
+  void FetchKeysInBackground(const std::vector<uint8_t>& content_id,
+                             const std::string& policy);
+
   /// Set signer for the key source.
   /// @param signer signs the request message.
   void set_signer(std::unique_ptr<RequestSigner> signer);
@@ -74,6 +86,24 @@ class WidevineKeySource : public KeySource {
   void set_enable_entitlement_license(bool enable_entitlement_license) {
     enable_entitlement_license_ = enable_entitlement_license;
   }
+  /// Set the number of crypto periods requested in each key rotation request.
+  /// Must be called before the first GetCryptoPeriodKey() call.
+  void set_crypto_period_count(uint32_t crypto_period_count) {
+    crypto_period_count_ = crypto_period_count;
+  }
+  /// Set the number of crypto periods, after the latest requested one, whose
+  /// keys are fetched ahead of time. If zero, the keys of five requests are
+  /// fetched ahead. Must be called before the first GetCryptoPeriodKey()
+  /// call.
+  void set_crypto_period_lookahead(uint32_t crypto_period_lookahead) {
+    crypto_period_lookahead_ = crypto_period_lookahead;
+  }
+  /// Set how long the key server responses are kept in the process-wide
+  /// KeyCache, which is shared with the other key sources requesting the same
+  /// keys from the same server. The cache is not used if it is zero.
+  void set_key_cache_ttl_in_seconds(uint32_t key_cache_ttl_in_seconds) {
+    key_cache_ttl_in_seconds_ = key_cache_ttl_in_seconds;
+  }
 
  private:
   typedef ProducerConsumerQueue<std::shared_ptr<EncryptionKeyMap>>
@@ -87,11 +117,24 @@ class WidevineKeySource : public KeySource {
   // The closure task to fetch keys repeatedly.
   void FetchKeysTask();
 
+  // The closure task of FetchKeysInBackground().
+  void FetchKeysInBackgroundTask(const std::vector<uint8_t>& content_id,
+                                 const std::string& policy);
+
+  // Wait for the keys requested by FetchKeysInBackground(), if any.
+  // @return the status of the request.
+  Status WaitForBackgroundFetch();
+
   // Fetch keys from server.
   Status FetchKeysInternal(bool enable_key_rotation,
                            uint32_t first_crypto_period_index,
                            bool widevine_classic);
 
+  // Sign |request| and send it to the server, retrying on transient errors.
+  // |raw_response| contains a response with an OK status on success.
+  Status FetchResponse(const CommonEncryptionRequest& request,
+                       std::string* raw_response);
+
   // Fill |request| with necessary fields for Widevine encryption request.
   // |request| should not be NULL.
   void FillRequest(bool enable_key_rotation,
@@ -116,6 +159,11 @@ class WidevineKeySource : public KeySource {
   bool generate_widevine_protection_system_ = true;
 
   ClosureThread key_production_thread_;
+  // Not null if FetchKeysInBackground() is called.
+  std::unique_ptr<ClosureThread> background_fetch_thread_;
+  // Signaled, unless a request of FetchKeysInBackground() is in flight.
+  base::WaitableEvent background_fetch_done_;
+  Status background_fetch_status_;
   // The fetcher object used to fetch keys from the license service.
   // It is initialized to a default fetcher on class initialization.
   // Can be overridden using set_key_fetcher for testing or other purposes.
@@ -124,10 +172,13 @@ class WidevineKeySource : public KeySource {
   std::unique_ptr<RequestSigner> signer_;
   std::unique_ptr<CommonEncryptionRequest> common_encryption_request_;
 
-  const int crypto_period_count_;
+  uint32_t crypto_period_count_;
+  uint32_t crypto_period_lookahead_ = 0;
+  uint32_t key_cache_ttl_in_seconds_ = 0;
   FourCC protection_scheme_ = FOURCC_NULL;
   base::Lock lock_;
   bool key_production_started_ = false;
+  std::atomic<bool> cancelled_{false};
   base::WaitableEvent start_key_production_;
   uint32_t first_crypto_period_index_ = 0;
   uint32_t crypto_period_duration_in_seconds_ = 0;
@@ -137,6 +188,16 @@ class WidevineKeySource : public KeySource {
   EncryptionKeyMap encryption_key_map_;  // For non key rotation request.
   Status common_encryption_request_status_;
 
+  // Key rotation statistics, logged on destruction.
+  base::Lock stats_lock_;
+  uint32_t num_key_rotation_requests_ = 0;
+  base::TimeDelta total_request_latency_;
+  base::TimeDelta max_request_latency_;
+  // Number and duration of GetCryptoPeriodKey() calls which had to wait for
+  // the keys to be fetched.
+  uint32_t num_stalls_ = 0;
+  base::TimeDelta total_stall_time_;
+
   DISALLOW_COPY_AND_ASSIGN(WidevineKeySource);
 };
 
@@ -367,6 +367,29 @@ TEST_F(WidevineKeySourceTest, NoRetryOnUnknownError) {
             widevine_key_source_->FetchKeys(content_id_, kPolicy).error_code());
 }
 
+TEST_F(WidevineKeySourceTest, FetchKeysInBackground) {
+  std::string mock_response = base::StringPrintf(
+      kHttpResponseFormat, Base64Encode(GenerateMockLicenseResponse()).c_str());
+
+  EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+
+  CreateWidevineKeySource();
+  widevine_key_source_->FetchKeysInBackground(content_id_, kPolicy);
+  VerifyKeys(!kClassic, !kHasIv);
+}
+
+TEST_F(WidevineKeySourceTest, FetchKeysInBackgroundFailure) {
+  EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+      .WillOnce(Return(Status(error::HTTP_FAILURE, "")));
+
+  CreateWidevineKeySource();
+  widevine_key_source_->FetchKeysInBackground(content_id_, kPolicy);
+  EncryptionKey encryption_key;
+  EXPECT_EQ(error::HTTP_FAILURE,
+            widevine_key_source_->GetKey("SD", &encryption_key).error_code());
+}
+
 TEST_F(WidevineKeySourceTest, CheckIv) {
   std::string mock_response = base::StringPrintf(
       kHttpResponseFormat,
@@ -655,6 +678,78 @@ TEST_P(WidevineKeySourceParameterizedTest, KeyRotationTest) {
   EXPECT_EQ(error::INVALID_ARGUMENT, status.error_code());
 }
 
+TEST_P(WidevineKeySourceParameterizedTest, KeyRotationWithLookaheadTest) {
+  const uint32_t kFirstCryptoPeriodIndex = 8;
+  const uint32_t kCryptoPeriodCount = 4;
+  const uint32_t kCryptoPeriodLookahead = 8;
+  const uint32_t kCryptoPeriodSeconds = 100;
+  // Array of indexes to be checked.
+  const uint32_t kCryptoPeriodIndexes[] = {kFirstCryptoPeriodIndex, 12, 18};
+  // Derived from kCryptoPeriodIndexes: ceiling((18 - 8 + 1) / 4).
+  const uint32_t kCryptoIterations = 3;
+
+  // Generate expectations in sequence.
+  InSequence dummy;
+
+  // Expecting a non-key rotation enabled request on FetchKeys().
+  EXPECT_CALL(*mock_request_signer_, GenerateSignature(_, _))
+      .WillOnce(Return(true));
+  std::string mock_response = base::StringPrintf(
+      kHttpResponseFormat, Base64Encode(GenerateMockLicenseResponse()).c_str());
+  EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+
+  for (uint32_t i = 0; i < kCryptoIterations; ++i) {
+    uint32_t first_crypto_period_index =
+        kFirstCryptoPeriodIndex - 1 + i * kCryptoPeriodCount;
+    std::string expected_message = base::StringPrintf(
+        kCryptoPeriodRequestMessageFormat, Base64Encode(kContentId).c_str(),
+        kPolicy, first_crypto_period_index, kCryptoPeriodCount,
+        kCryptoPeriodSeconds, GetExpectedProtectionScheme().c_str());
+    EXPECT_CALL(*mock_request_signer_, GenerateSignature(expected_message, _))
+        .WillOnce(DoAll(SetArgPointee<1>(kMockSignature), Return(true)));
+
+    std::string mock_response = base::StringPrintf(
+        kHttpResponseFormat,
+        Base64Encode(GenerateMockKeyRotationLicenseResponse(
+                         first_crypto_period_index, kCryptoPeriodCount))
+            .c_str());
+    EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+        .WillOnce(DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+  }
+  // Fail future requests.
+  EXPECT_CALL(*mock_request_signer_, GenerateSignature(_, _))
+      .WillRepeatedly(Return(false));
+
+  CreateWidevineKeySource();
+  widevine_key_source_->set_signer(std::move(mock_request_signer_));
+  widevine_key_source_->set_crypto_period_count(kCryptoPeriodCount);
+  widevine_key_source_->set_crypto_period_lookahead(kCryptoPeriodLookahead);
+  ASSERT_OK(widevine_key_source_->FetchKeys(content_id_, kPolicy));
+
+  EncryptionKey encryption_key;
+  const std::string kStreamLabels[] = {"SD", "HD", "UHD1", "UHD2", "AUDIO"};
+  for (size_t i = 0; i < arraysize(kCryptoPeriodIndexes); ++i) {
+    for (const std::string& stream_label : kStreamLabels) {
+      ASSERT_OK(widevine_key_source_->GetCryptoPeriodKey(
+          kCryptoPeriodIndexes[i], kCryptoPeriodSeconds, stream_label,
+          &encryption_key));
+      EXPECT_EQ(GetMockKey(stream_label, kCryptoPeriodIndexes[i]),
+                ToString(encryption_key.key));
+    }
+  }
+
+  // Only |kCryptoPeriodLookahead| crypto periods before the last requested
+  // one are kept.
+  Status status = widevine_key_source_->GetCryptoPeriodKey(
+      18 - kCryptoPeriodLookahead - 1, kCryptoPeriodSeconds, kStreamLabels[0],
+      &encryption_key);
+  EXPECT_EQ(error::INVALID_ARGUMENT, status.error_code());
+  ASSERT_OK(widevine_key_source_->GetCryptoPeriodKey(
+      18 - kCryptoPeriodLookahead, kCryptoPeriodSeconds, kStreamLabels[0],
+      &encryption_key));
+}
+
 INSTANTIATE_TEST_CASE_P(WidevineKeySourceInstance,
                         WidevineKeySourceParameterizedTest,
                         Combine(Bool(),
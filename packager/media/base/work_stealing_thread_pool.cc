@@ -0,0 +1,222 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/work_stealing_thread_pool.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/sys_info.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/closure_thread.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Identifies the pool and the worker the current thread belongs to, if any.
+thread_local const WorkStealingThreadPool* g_current_pool = nullptr;
+thread_local size_t g_current_worker_index = 0;
+
+}  // namespace
+
+// Counts down the tasks of a PostTasks() batch.
+class WorkStealingThreadPool::TaskBatch {
+ public:
+  explicit TaskBatch(size_t count) : count_(count), done_(&lock_) {}
+
+  void CountDown() {
+    base::AutoLock auto_lock(lock_);
+    if (--count_ == 0)
+      done_.Broadcast();
+  }
+
+  bool IsDone() {
+    base::AutoLock auto_lock(lock_);
+    return count_ == 0;
+  }
+
+  // Wait until the batch is done or for a short while, whichever is first.
+  void TimedWait() {
+    const base::TimeDelta kMaxWaitTime = base::TimeDelta::FromMilliseconds(1);
+    base::AutoLock auto_lock(lock_);
+    if (count_ > 0)
+      done_.TimedWait(kMaxWaitTime);
+  }
+
+ private:
+  TaskBatch(const TaskBatch&) = delete;
+  TaskBatch& operator=(const TaskBatch&) = delete;
+
+  base::Lock lock_;
+  size_t count_;
+  base::ConditionVariable done_;
+};
+
+namespace {
+
+// |batch| is held by the task so the handle can be released without waiting.
+void RunAndCountDown(
+    const base::Closure& task,
+    const std::shared_ptr<WorkStealingThreadPool::TaskBatch>& batch) {
+  task.Run();
+  batch->CountDown();
+}
+
+}  // namespace
+
+WorkStealingThreadPool::WorkStealingThreadPool(size_t num_threads)
+    : task_available_(&lock_), task_posted_(&lock_) {
+  if (num_threads == 0)
+    num_threads = base::SysInfo::NumberOfProcessors();
+  DCHECK_GT(num_threads, 0u);
+
+  for (size_t i = 0; i < num_threads; ++i)
+    workers_.emplace_back(new Worker);
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_[i]->thread.reset(new ClosureThread(
+        "WorkStealingThreadPool",
+        base::Bind(&WorkStealingThreadPool::WorkerLoop, base::Unretained(this),
+                   i)));
+    workers_[i]->thread->Start();
+  }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    base::AutoLock auto_lock(lock_);
+    stopping_ = true;
+    task_available_.Broadcast();
+  }
+  for (std::unique_ptr<Worker>& worker : workers_)
+    worker->thread->Join();
+}
+
+void WorkStealingThreadPool::PostTask(const base::Closure& task) {
+  if (g_current_pool == this) {
+    Worker* worker = workers_[g_current_worker_index].get();
+    base::AutoLock auto_lock(worker->lock);
+    worker->tasks.push_front(task);
+  } else {
+    Worker* worker = workers_[next_worker_++ % workers_.size()].get();
+    base::AutoLock auto_lock(worker->lock);
+    worker->tasks.push_back(task);
+  }
+
+  base::AutoLock auto_lock(lock_);
+  // Only running tasks may post new tasks once the pool is being destroyed.
+  DCHECK(!stopping_ || g_current_pool == this);
+  ++num_pending_tasks_;
+  ++num_posted_tasks_;
+  task_available_.Signal();
+  task_posted_.Broadcast();
+}
+
+void WorkStealingThreadPool::RunTasksAndWait(
+    const std::vector<base::Closure>& tasks) {
+  Wait(PostTasks(tasks).get());
+}
+
+std::shared_ptr<WorkStealingThreadPool::TaskBatch>
+WorkStealingThreadPool::PostTasks(const std::vector<base::Closure>& tasks) {
+  std::shared_ptr<TaskBatch> batch(new TaskBatch(tasks.size()));
+  for (const base::Closure& task : tasks)
+    PostTask(base::Bind(&RunAndCountDown, task, batch));
+  return batch;
+}
+
+void WorkStealingThreadPool::Wait(TaskBatch* batch) {
+  DCHECK(batch);
+  // Help out instead of blocking a thread, which also avoids deadlocks when
+  // called from a worker. Tasks of the batch may be running on other workers
+  // when there is nothing left to take, so wait for them in small steps.
+  while (!batch->IsDone()) {
+    if (!RunPendingTask())
+      batch->TimedWait();
+  }
+}
+
+bool WorkStealingThreadPool::RunPendingTask() {
+  {
+    base::AutoLock auto_lock(lock_);
+    if (num_pending_tasks_ == 0)
+      return false;
+    --num_pending_tasks_;
+  }
+  const size_t worker_index =
+      g_current_pool == this ? g_current_worker_index : 0;
+  base::Closure task;
+  TakeReservedTask(worker_index, &task);
+  task.Run();
+  return true;
+}
+
+void WorkStealingThreadPool::WorkerLoop(size_t worker_index) {
+  g_current_pool = this;
+  g_current_worker_index = worker_index;
+
+  while (true) {
+    {
+      base::AutoLock auto_lock(lock_);
+      while (num_pending_tasks_ == 0 && !stopping_)
+        task_available_.Wait();
+      if (num_pending_tasks_ == 0)
+        break;
+      --num_pending_tasks_;
+    }
+
+    base::Closure task;
+    TakeReservedTask(worker_index, &task);
+    task.Run();
+  }
+
+  g_current_pool = nullptr;
+}
+
+void WorkStealingThreadPool::TakeReservedTask(size_t worker_index,
+                                              base::Closure* task) {
+  // The reserved task may be taken by another worker between the scans, in
+  // which case the one left for us was pushed to a deque already scanned.
+  // Its PostTask() bumps |num_posted_tasks_| after the push, so wait for that
+  // instead of scanning again right away.
+  while (true) {
+    uint64_t num_posted_tasks;
+    {
+      base::AutoLock auto_lock(lock_);
+      num_posted_tasks = num_posted_tasks_;
+    }
+    if (TakeTask(worker_index, task))
+      return;
+    base::AutoLock auto_lock(lock_);
+    while (num_posted_tasks_ == num_posted_tasks)
+      task_posted_.Wait();
+  }
+}
+
+bool WorkStealingThreadPool::TakeTask(size_t worker_index,
+                                      base::Closure* task) {
+  {
+    Worker* worker = workers_[worker_index].get();
+    base::AutoLock auto_lock(worker->lock);
+    if (!worker->tasks.empty()) {
+      *task = worker->tasks.front();
+      worker->tasks.pop_front();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker* victim = workers_[(worker_index + i) % workers_.size()].get();
+    base::AutoLock auto_lock(victim->lock);
+    if (!victim->tasks.empty()) {
+      *task = victim->tasks.back();
+      victim->tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace media
+}  // namespace shaka
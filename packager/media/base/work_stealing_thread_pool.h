@@ -0,0 +1,101 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_WORK_STEALING_THREAD_POOL_H_
+#define PACKAGER_MEDIA_BASE_WORK_STEALING_THREAD_POOL_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "packager/base/callback.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace media {
+
+class ClosureThread;
+
+/// A fixed size thread pool. Every worker owns a task deque. Tasks posted from
+/// a worker go to the front of its own deque and are run LIFO for locality;
+/// tasks posted from other threads are distributed round robin. An idle worker
+/// steals the oldest task from the back of another worker's deque.
+class WorkStealingThreadPool {
+ public:
+  /// Tracks the completion of the tasks posted by PostTasks().
+  class TaskBatch;
+
+  /// @param num_threads is the number of worker threads. A value of zero means
+  ///        the number of processors.
+  explicit WorkStealingThreadPool(size_t num_threads);
+
+  /// Runs all the tasks already posted and joins the worker threads.
+  ~WorkStealingThreadPool();
+
+  /// Post a task to be run on one of the worker threads. Thread safe.
+  void PostTask(const base::Closure& task);
+
+  /// Run @a tasks on the pool and block until all of them have completed. The
+  /// calling thread runs pending tasks of the pool while waiting, so it is
+  /// safe to call from a task running on the pool.
+  void RunTasksAndWait(const std::vector<base::Closure>& tasks);
+
+  /// Post @a tasks to be run on the pool without waiting for them. Thread
+  /// safe.
+  /// @return the batch of @a tasks, to pass to Wait().
+  std::shared_ptr<TaskBatch> PostTasks(const std::vector<base::Closure>& tasks);
+
+  /// Block until all the tasks of @a batch have completed. Like
+  /// RunTasksAndWait(), the calling thread runs pending tasks of the pool
+  /// while waiting.
+  void Wait(TaskBatch* batch);
+
+  size_t num_threads() const { return workers_.size(); }
+
+ private:
+  WorkStealingThreadPool(const WorkStealingThreadPool&) = delete;
+  WorkStealingThreadPool& operator=(const WorkStealingThreadPool&) = delete;
+
+  struct Worker {
+    base::Lock lock;
+    std::deque<base::Closure> tasks;
+    std::unique_ptr<ClosureThread> thread;
+  };
+
+  void WorkerLoop(size_t worker_index);
+  // Pop a task from the front of the worker's own deque, or steal one from the
+  // back of another deque. Returns false if all deques are empty.
+  bool TakeTask(size_t worker_index, base::Closure* task);
+  // Take the task reserved by decrementing |num_pending_tasks_|, blocking
+  // until it is in a deque the scan can find.
+  void TakeReservedTask(size_t worker_index, base::Closure* task);
+  // Reserve and run one pending task on the calling thread. Returns false if
+  // there is no pending task.
+  bool RunPendingTask();
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_worker_{0};
+
+  // Protects |num_pending_tasks_|, |num_posted_tasks_| and |stopping_|. There
+  // is one reserved task in the deques for every unit of |num_pending_tasks_|
+  // taken by a worker.
+  base::Lock lock_;
+  base::ConditionVariable task_available_;
+  // Broadcast on every post, for the threads waiting for a reserved task.
+  base::ConditionVariable task_posted_;
+  size_t num_pending_tasks_ = 0;
+  uint64_t num_posted_tasks_ = 0;
+  bool stopping_ = false;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_WORK_STEALING_THREAD_POOL_H_
@@ -0,0 +1,111 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/work_stealing_thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/bind.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kNumThreads = 4;
+
+void Increment(std::atomic<int>* counter) {
+  ++*counter;
+}
+
+void PostIncrements(WorkStealingThreadPool* pool,
+                    int num_tasks,
+                    std::atomic<int>* counter) {
+  for (int i = 0; i < num_tasks; ++i)
+    pool->PostTask(base::Bind(&Increment, counter));
+}
+
+void RunIncrementsAndWait(WorkStealingThreadPool* pool,
+                          int num_tasks,
+                          std::atomic<int>* counter) {
+  std::vector<base::Closure> tasks(num_tasks, base::Bind(&Increment, counter));
+  pool->RunTasksAndWait(tasks);
+}
+
+}  // namespace
+
+TEST(WorkStealingThreadPoolTest, RunsAllTasks) {
+  const int kNumTasks = 1000;
+  std::atomic<int> counter(0);
+  {
+    WorkStealingThreadPool pool(kNumThreads);
+    EXPECT_EQ(kNumThreads, pool.num_threads());
+    PostIncrements(&pool, kNumTasks, &counter);
+  }
+  EXPECT_EQ(kNumTasks, counter);
+}
+
+TEST(WorkStealingThreadPoolTest, TasksPostedFromWorkers) {
+  const int kNumOuterTasks = 10;
+  const int kNumInnerTasks = 100;
+  std::atomic<int> counter(0);
+  {
+    WorkStealingThreadPool pool(kNumThreads);
+    for (int i = 0; i < kNumOuterTasks; ++i) {
+      pool.PostTask(
+          base::Bind(&PostIncrements, &pool, kNumInnerTasks, &counter));
+    }
+  }
+  EXPECT_EQ(kNumOuterTasks * kNumInnerTasks, counter);
+}
+
+TEST(WorkStealingThreadPoolTest, RunTasksAndWait) {
+  const int kNumTasks = 100;
+  std::atomic<int> counter(0);
+  WorkStealingThreadPool pool(kNumThreads);
+  RunIncrementsAndWait(&pool, kNumTasks, &counter);
+  EXPECT_EQ(kNumTasks, counter);
+}
+
+TEST(WorkStealingThreadPoolTest, NestedRunTasksAndWait) {
+  const int kNumOuterTasks = 16;
+  const int kNumInnerTasks = 10;
+  std::atomic<int> counter(0);
+  WorkStealingThreadPool pool(2);
+  std::vector<base::Closure> tasks(
+      kNumOuterTasks,
+      base::Bind(&RunIncrementsAndWait, &pool, kNumInnerTasks, &counter));
+  // The outer tasks block the workers while waiting for the inner tasks.
+  pool.RunTasksAndWait(tasks);
+  EXPECT_EQ(kNumOuterTasks * kNumInnerTasks, counter);
+}
+
+TEST(WorkStealingThreadPoolTest, PostTasksAndWait) {
+  const int kNumBatches = 3;
+  const int kNumTasks = 100;
+  std::atomic<int> counters[kNumBatches];
+  WorkStealingThreadPool pool(kNumThreads);
+  std::vector<std::shared_ptr<WorkStealingThreadPool::TaskBatch>> batches;
+  for (int i = 0; i < kNumBatches; ++i) {
+    counters[i] = 0;
+    std::vector<base::Closure> tasks(kNumTasks,
+                                     base::Bind(&Increment, &counters[i]));
+    batches.push_back(pool.PostTasks(tasks));
+  }
+  for (int i = 0; i < kNumBatches; ++i) {
+    pool.Wait(batches[i].get());
+    EXPECT_EQ(kNumTasks, counters[i]);
+  }
+  // A batch without tasks is done.
+  pool.Wait(pool.PostTasks(std::vector<base::Closure>()).get());
+}
+
+TEST(WorkStealingThreadPoolTest, DefaultNumThreads) {
+  WorkStealingThreadPool pool(0);
+  EXPECT_GT(pool.num_threads(), 0u);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -21,6 +21,8 @@
         'sync_point_queue.h',
         'text_chunker.cc',
         'text_chunker.h',
+        'time_range_handler.cc',
+        'time_range_handler.h',
       ],
       'dependencies': [
         '../base/media_base.gyp:media_base',
@@ -32,7 +34,9 @@
       'sources': [
         'chunking_handler_unittest.cc',
         'cue_alignment_handler_unittest.cc',
+        'sync_point_queue_unittest.cc',
         'text_chunker_unittest.cc',
+        'time_range_handler_unittest.cc',
       ],
       'dependencies': [
         '../../testing/gtest.gyp:gtest',
@@ -70,6 +70,8 @@ Status ChunkingHandler::OnStreamInfo(std::shared_ptr<const StreamInfo> info) {
       chunking_params_.segment_duration_in_seconds * time_scale_;
   subsegment_duration_ =
       chunking_params_.subsegment_duration_in_seconds * time_scale_;
+  segment_alignment_tolerance_ =
+      chunking_params_.segment_alignment_tolerance_in_seconds * time_scale_;
   return DispatchStreamInfo(kStreamIndex, std::move(info));
 }
 
@@ -96,9 +98,13 @@ Status ChunkingHandler::OnMediaSample(
   const bool can_start_new_segment =
       sample->is_key_frame() || !chunking_params_.segment_sap_aligned;
   if (can_start_new_segment) {
+    // A key frame slightly before a segment boundary belongs to the segment
+    // after the boundary.
+    const int64_t aligned_timestamp = timestamp + segment_alignment_tolerance_;
     const int64_t segment_index =
-        timestamp < cue_offset_ ? 0
-                                : (timestamp - cue_offset_) / segment_duration_;
+        aligned_timestamp < cue_offset_
+            ? 0
+            : (aligned_timestamp - cue_offset_) / segment_duration_;
     if (!segment_start_time_ ||
         IsNewSegmentIndex(segment_index, current_segment_index_)) {
       current_segment_index_ = segment_index;
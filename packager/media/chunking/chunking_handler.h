@@ -36,6 +36,11 @@ namespace media {
 ///
 /// This algorithm will make sure the chunks from different video streams are
 /// aligned if they have aligned GoPs.
+///
+/// The SegmentInfo ending a segment is dispatched as soon as the sample
+/// starting the next segment is seen, before that sample. With
+/// PackagingParams::pipeline_queue_size, the muxer runs on its own thread, so
+/// the segment is finalized while the next samples are chunked and encrypted.
 class ChunkingHandler : public MediaHandler {
  public:
   explicit ChunkingHandler(const ChunkingParams& chunking_params);
@@ -72,6 +77,8 @@ class ChunkingHandler : public MediaHandler {
   // Segment and subsegment duration in stream's time scale.
   int64_t segment_duration_ = 0;
   int64_t subsegment_duration_ = 0;
+  // Segment alignment tolerance in stream's time scale.
+  int64_t segment_alignment_tolerance_ = 0;
 
   // Current segment index, useful to determine where to do chunking.
   int64_t current_segment_index_ = -1;
@@ -155,6 +155,33 @@ TEST_F(ChunkingHandlerTest, VideoAndSubsegmentAndNonzeroStart) {
                         kDuration, !kEncrypted, _)));
 }
 
+TEST_F(ChunkingHandlerTest, SegmentAlignmentTolerance) {
+  ChunkingParams chunking_params;
+  chunking_params.segment_duration_in_seconds = 1;
+  chunking_params.segment_alignment_tolerance_in_seconds = 0.1;
+  SetUpChunkingHandler(1, chunking_params);
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetAudioStreamInfo(kTimeScale1))));
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, kKeyFrame))));
+  }
+  EXPECT_THAT(
+      GetOutputStreamDataVector(),
+      ElementsAre(
+          IsStreamInfo(kStreamIndex, kTimeScale1, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 0, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, kDuration, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 2 * kDuration, kDuration, !kEncrypted, _),
+          // The key frame @ 900 is within the tolerance of the boundary @ 1000.
+          IsSegmentInfo(kStreamIndex, 0, kDuration * 3, !kIsSubsegment,
+                        !kEncrypted),
+          IsMediaSample(kStreamIndex, 3 * kDuration, kDuration, !kEncrypted, _),
+          IsMediaSample(kStreamIndex, 4 * kDuration, kDuration, !kEncrypted,
+                        _)));
+}
+
 TEST_F(ChunkingHandlerTest, CueEvent) {
   ChunkingParams chunking_params;
   chunking_params.segment_duration_in_seconds = 1;
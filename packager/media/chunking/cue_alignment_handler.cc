@@ -8,6 +8,8 @@
 
 #include <algorithm>
 
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/metrics/metrics.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -60,6 +62,14 @@ double TextEndTimeInSeconds(const StreamInfo& info, const StreamData& data) {
   return static_cast<double>(scaled_time) / time_scale;
 }
 
+// The size counted against the buffer limit.
+uint64_t GetSampleSize(const StreamData& data) {
+  if (data.media_sample)
+    return data.media_sample->data_size();
+  DCHECK(data.text_sample);
+  return data.text_sample->body().body.size();
+}
+
 Status GetNextCue(double hint,
                   SyncPointQueue* sync_points,
                   std::shared_ptr<const CueEvent>* out_cue) {
@@ -77,9 +87,40 @@ Status GetNextCue(double hint,
 CueAlignmentHandler::CueAlignmentHandler(SyncPointQueue* sync_points)
     : sync_points_(sync_points) {}
 
+CueAlignmentHandler::~CueAlignmentHandler() {
+  for (int gauge_id : gauge_ids_)
+    Metrics::GetInstance()->RemoveGaugeFunction(gauge_id);
+}
+
 Status CueAlignmentHandler::InitializeInternal() {
   sync_points_->AddThread();
-  stream_states_.resize(num_input_streams());
+  // The stream states are not movable, so they are not resized.
+  stream_states_ = std::vector<StreamState>(num_input_streams());
+
+  if (!metrics_input_.empty()) {
+    Metrics* metrics = Metrics::GetInstance();
+    for (size_t i = 0; i < stream_states_.size(); ++i) {
+      const StreamState* stream = &stream_states_[i];
+      const MetricLabels labels = {{"input", metrics_input_},
+                                   {"stream", base::SizeTToString(i)}};
+      gauge_ids_.push_back(metrics->AddGaugeFunction(
+          "shaka_cue_alignment_buffered_samples",
+          "Samples of a stream buffered while waiting for a sync point.",
+          labels,
+          [stream]() {
+            return static_cast<double>(stream->num_buffered_samples.load(
+                std::memory_order_relaxed));
+          }));
+      gauge_ids_.push_back(metrics->AddGaugeFunction(
+          "shaka_cue_alignment_buffered_bytes",
+          "Bytes of the samples of a stream buffered while waiting for a "
+          "sync point.",
+          labels, [stream]() {
+            return static_cast<double>(
+                stream->buffered_bytes.load(std::memory_order_relaxed));
+          }));
+    }
+  }
 
   // Get the first hint for the stream. Use a negative hint so that if there is
   // suppose to be a sync point at zero, we will still respect it.
@@ -116,16 +157,14 @@ Status CueAlignmentHandler::OnFlushRequest(size_t stream_index) {
 
   // Do a once over all the streams to ensure that their states are as we expect
   // them. Video and non-video streams have different allowances here. Video
-  // should absolutely have no cues or samples where as non-video streams may
-  // have cues or samples.
+  // should absolutely have no samples, and no cues unless they were promoted
+  // by ForcePromotion(), where as non-video streams may have cues or samples.
   for (StreamState& stream : stream_states_) {
     DCHECK(stream.to_be_flushed);
 
     if (stream.info->stream_type() == kStreamVideo) {
       DCHECK_EQ(stream.samples.size(), 0u)
           << "Video streams should not store samples";
-      DCHECK_EQ(stream.cues.size(), 0u)
-          << "Video streams should not store cues";
     }
   }
 
@@ -195,9 +234,15 @@ Status CueAlignmentHandler::OnVideoSample(std::unique_ptr<StreamData> sample) {
     }
 
     RETURN_IF_ERROR(UseNewSyncPoint(std::move(next_sync)));
-    DCHECK_EQ(stream.cues.size(), 1u);
-    RETURN_IF_ERROR(Dispatch(std::move(stream.cues.front())));
-    stream.cues.pop_front();
+    DCHECK_GE(stream.cues.size(), 1u);
+  }
+
+  // The cues promoted by ForcePromotion() are only inserted at the next key
+  // frame.
+  if (is_key_frame) {
+    for (auto& cue : stream.cues)
+      RETURN_IF_ERROR(Dispatch(std::move(cue)));
+    stream.cues.clear();
   }
 
   return Dispatch(std::move(sample));
@@ -241,7 +286,7 @@ Status CueAlignmentHandler::OnSample(std::unique_ptr<StreamData> sample) {
 
   const size_t stream_index = sample->stream_index;
 
-  if (sample->text_sample) {
+  if (sample->text_sample && !sample->text_sample->is_heartbeat()) {
     StreamState& stream = stream_states_[stream_index];
     stream.max_text_sample_end_time_seconds =
         std::max(stream.max_text_sample_end_time_seconds,
@@ -291,7 +336,15 @@ Status CueAlignmentHandler::AcceptSample(std::unique_ptr<StreamData> sample,
   // the sample to the queue.
   const size_t stream_index = sample->stream_index;
 
-  stream->samples.push_back(std::move(sample));
+  // Only the latest heartbeat waiting for the next sync point matters, so a
+  // sparse text stream does not fill its buffer with them.
+  if (sample->text_sample && sample->text_sample->is_heartbeat() &&
+      !stream->samples.empty() && stream->samples.back()->text_sample &&
+      stream->samples.back()->text_sample->is_heartbeat()) {
+    stream->samples.pop_back();
+    stream->num_buffered_samples.fetch_sub(1, std::memory_order_relaxed);
+  }
+  PushSample(std::move(sample), stream);
 
   if (stream->samples.size() > kMaxBufferSize) {
     LOG(ERROR) << "Stream " << stream_index << " has buffered "
@@ -301,7 +354,55 @@ Status CueAlignmentHandler::AcceptSample(std::unique_ptr<StreamData> sample,
                   "Streams are not properly multiplexed.");
   }
 
-  return RunThroughSamples(stream);
+  RETURN_IF_ERROR(RunThroughSamples(stream));
+  if (max_buffered_bytes_ > 0 && buffered_bytes_ > max_buffered_bytes_ &&
+      !stream->samples.empty()) {
+    return ForcePromotion(stream);
+  }
+  return Status::OK;
+}
+
+void CueAlignmentHandler::PushSample(std::unique_ptr<StreamData> sample,
+                                     StreamState* stream) {
+  const uint64_t size = GetSampleSize(*sample);
+  stream->samples.push_back(std::move(sample));
+  stream->num_buffered_samples.fetch_add(1, std::memory_order_relaxed);
+  stream->buffered_bytes.fetch_add(size, std::memory_order_relaxed);
+  buffered_bytes_ += size;
+}
+
+Status CueAlignmentHandler::DispatchFrontSample(StreamState* stream) {
+  DCHECK(!stream->samples.empty());
+  std::unique_ptr<StreamData> sample = std::move(stream->samples.front());
+  stream->samples.pop_front();
+
+  const uint64_t size = GetSampleSize(*sample);
+  stream->num_buffered_samples.fetch_sub(1, std::memory_order_relaxed);
+  stream->buffered_bytes.fetch_sub(size, std::memory_order_relaxed);
+  DCHECK_GE(buffered_bytes_, size);
+  buffered_bytes_ -= size;
+  return Dispatch(std::move(sample));
+}
+
+Status CueAlignmentHandler::ForcePromotion(StreamState* stream) {
+  const double time = TimeInSeconds(*stream->info, *stream->samples.front());
+  LOG(WARNING) << "Promoting the cue at " << time << "s after buffering "
+               << buffered_bytes_ << " bytes, the max is "
+               << max_buffered_bytes_ << ".";
+  if (!metrics_input_.empty()) {
+    Metrics::GetInstance()->IncrementCounter(
+        "shaka_cue_alignment_forced_promotions",
+        "Cues promoted because an input buffered too many samples while "
+        "waiting for the sync point.",
+        {{"input", metrics_input_}}, 1);
+  }
+
+  std::shared_ptr<const CueEvent> cue = sync_points_->PromoteAt(time);
+  // The cue may have been promoted by another input in the meantime, in which
+  // case it is available without blocking.
+  if (!cue)
+    RETURN_IF_ERROR(GetNextCue(hint_, sync_points_, &cue));
+  return UseNewSyncPoint(std::move(cue));
 }
 
 Status CueAlignmentHandler::RunThroughSamples(StreamState* stream) {
@@ -313,8 +414,7 @@ Status CueAlignmentHandler::RunThroughSamples(StreamState* stream) {
         TimeInSeconds(*stream->info, *stream->samples.front());
 
     if (sample_time < cue_time) {
-      RETURN_IF_ERROR(Dispatch(std::move(stream->samples.front())));
-      stream->samples.pop_front();
+      RETURN_IF_ERROR(DispatchFrontSample(stream));
     } else {
       RETURN_IF_ERROR(Dispatch(std::move(stream->cues.front())));
       stream->cues.pop_front();
@@ -326,8 +426,7 @@ Status CueAlignmentHandler::RunThroughSamples(StreamState* stream) {
   // downstream.
   while (stream->samples.size() &&
          TimeInSeconds(*stream->info, *stream->samples.front()) < hint_) {
-    RETURN_IF_ERROR(Dispatch(std::move(stream->samples.front())));
-    stream->samples.pop_front();
+    RETURN_IF_ERROR(DispatchFrontSample(stream));
   }
 
   return Status::OK;
@@ -7,7 +7,10 @@
 #ifndef PACKAGER_MEDIA_CHUNKING_CUE_ALIGNMENT_HANDLER_
 #define PACKAGER_MEDIA_CHUNKING_CUE_ALIGNMENT_HANDLER_
 
+#include <atomic>
 #include <list>
+#include <string>
+#include <vector>
 
 #include "packager/media/base/media_handler.h"
 #include "packager/media/chunking/sync_point_queue.h"
@@ -25,7 +28,19 @@ namespace media {
 class CueAlignmentHandler : public MediaHandler {
  public:
   explicit CueAlignmentHandler(SyncPointQueue* sync_points);
-  ~CueAlignmentHandler() = default;
+  ~CueAlignmentHandler() override;
+
+  /// Set the maximum size of the samples buffered by all the streams while
+  /// they wait for a sync point, e.g. when the video has a gap. Once it is
+  /// reached, the pending cue is promoted at the time of the samples buffered
+  /// rather than at a video key frame. 0, the default, means no limit.
+  void set_max_buffered_bytes(uint64_t max_buffered_bytes) {
+    max_buffered_bytes_ = max_buffered_bytes;
+  }
+
+  /// Set the name of the input, which enables the gauges of the samples
+  /// buffered by each stream.
+  void set_metrics_input(const std::string& input) { metrics_input_ = input; }
 
  private:
   CueAlignmentHandler(const CueAlignmentHandler&) = delete;
@@ -37,6 +52,10 @@ class CueAlignmentHandler : public MediaHandler {
     // Cached samples that cannot be dispatched. All the samples should be at or
     // after |hint|.
     std::list<std::unique_ptr<StreamData>> samples;
+    // The number of samples in |samples| and their size. They are also read by
+    // the gauges.
+    std::atomic<size_t> num_buffered_samples{0};
+    std::atomic<uint64_t> buffered_bytes{0};
     // If set, the stream is pending to be flushed.
     bool to_be_flushed = false;
     // Only set for text stream.
@@ -69,12 +88,27 @@ class CueAlignmentHandler : public MediaHandler {
   Status AcceptSample(std::unique_ptr<StreamData> sample,
                       StreamState* stream_state);
 
+  // Buffer a sample, or dispatch the first sample buffered.
+  void PushSample(std::unique_ptr<StreamData> sample, StreamState* stream);
+  Status DispatchFrontSample(StreamState* stream);
+
+  // Promote the pending cue at the time of the first sample buffered by
+  // |stream|, once |max_buffered_bytes_| are buffered.
+  Status ForcePromotion(StreamState* stream);
+
   // Dispatch all samples and cues (in the correct order) for the given stream.
   Status RunThroughSamples(StreamState* stream);
 
   SyncPointQueue* const sync_points_ = nullptr;
   std::vector<StreamState> stream_states_;
 
+  uint64_t max_buffered_bytes_ = 0;
+  // The size of the samples buffered by all the streams.
+  uint64_t buffered_bytes_ = 0;
+
+  std::string metrics_input_;
+  std::vector<int> gauge_ids_;
+
   // A common hint used by all streams. When a new cue is given to all streams,
   // the hint will be updated. The hint will always be larger than any cue. The
   // hint represents the min time in seconds for the next cue appear. The hints
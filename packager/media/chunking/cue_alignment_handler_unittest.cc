@@ -609,6 +609,163 @@ TEST_F(CueAlignmentHandlerTest, TextAudioVideoInputWithCues) {
   ASSERT_OK(FlushAll({kTextStream, kAudioStream, kVideoStream}));
 }
 
+TEST_F(CueAlignmentHandlerTest, TextHeartbeatsWaitingForCueAreMerged) {
+  const size_t kTwoInputs = 2;
+  const size_t kTwoOutputs = 2;
+  const size_t kTextStream = 0;
+  const size_t kVideoStream = 1;
+
+  const int64_t kSampleDuration = 1000;
+  const int64_t kSample0Start = 0;
+  const int64_t kSample1Start = kSample0Start + kSampleDuration;
+  const int64_t kSample2Start = kSample1Start + kSampleDuration;
+
+  const double kSample2StartInSeconds =
+      static_cast<double>(kSample2Start) / kMsTimeScale;
+
+  // The heartbeats after the hint wait for the video to promote the cue.
+  const int64_t kHeartbeat0Time = kSample1Start + 200;
+  const int64_t kHeartbeat1Time = kSample1Start + 400;
+  const int64_t kHeartbeat2Time = kSample1Start + 600;
+
+  auto sync_points =
+      CreateSyncPoints({static_cast<double>(kSample1Start) / kMsTimeScale});
+  auto handler = std::make_shared<CueAlignmentHandler>(sync_points.get());
+  ASSERT_OK(SetUpAndInitializeGraph(handler, kTwoInputs, kTwoOutputs));
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kTextStream),
+                OnProcess(IsStreamInfo(_, kMsTimeScale, _, _)));
+    // Only the latest heartbeat is kept.
+    EXPECT_CALL(*Output(kTextStream),
+                OnProcess(IsTextSample(_, _, kHeartbeat2Time,
+                                       kHeartbeat2Time)));
+    // The cue is after the last text sample, so it is ignored.
+    EXPECT_CALL(*Output(kTextStream), OnFlush(_));
+  }
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kVideoStream),
+                OnProcess(IsStreamInfo(_, kMsTimeScale, _, _)));
+    EXPECT_CALL(
+        *Output(kVideoStream),
+        OnProcess(IsMediaSample(_, kSample0Start, kSampleDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kVideoStream),
+        OnProcess(IsMediaSample(_, kSample1Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kVideoStream),
+                OnProcess(IsCueEvent(_, kSample2StartInSeconds)));
+    EXPECT_CALL(
+        *Output(kVideoStream),
+        OnProcess(IsMediaSample(_, kSample2Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kVideoStream), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchTextInfo(kTextStream));
+  ASSERT_OK(DispatchVideoInfo(kVideoStream));
+
+  ASSERT_OK(DispatchMediaSample(kVideoStream, kSample0Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kVideoStream, kSample1Start, kSampleDuration,
+                                !kKeyFrame));
+  for (int64_t time : {kHeartbeat0Time, kHeartbeat1Time, kHeartbeat2Time}) {
+    ASSERT_OK(Input(kTextStream)
+                  ->Dispatch(StreamData::FromTextSample(
+                      kStreamIndex, TextSample::CreateHeartbeat(time))));
+  }
+  ASSERT_OK(DispatchMediaSample(kVideoStream, kSample2Start, kSampleDuration,
+                                kKeyFrame));
+
+  ASSERT_OK(FlushAll({kTextStream, kVideoStream}));
+}
+
+TEST_F(CueAlignmentHandlerTest, CuePromotedWhenBufferIsFull) {
+  const size_t kTwoInputs = 2;
+  const size_t kTwoOutputs = 2;
+  const size_t kAudioStream = 0;
+  const size_t kVideoStream = 1;
+
+  const int64_t kSampleDuration = 1000;
+  const int64_t kSample0Start = 0;
+  const int64_t kSample1Start = kSample0Start + kSampleDuration;
+  const int64_t kSample2Start = kSample1Start + kSampleDuration;
+  const int64_t kSample3Start = kSample2Start + kSampleDuration;
+
+  // Two audio samples fill the buffer, so the cue is promoted at the middle
+  // of the first one buffered.
+  const uint64_t kMaxBufferedBytes = 10;
+  const double kPromotedCueTimeInSeconds =
+      static_cast<double>(kSample1Start + kSampleDuration / 2) / kMsTimeScale;
+
+  auto sync_points =
+      CreateSyncPoints({static_cast<double>(kSample1Start) / kMsTimeScale});
+  auto handler = std::make_shared<CueAlignmentHandler>(sync_points.get());
+  handler->set_max_buffered_bytes(kMaxBufferedBytes);
+  ASSERT_OK(SetUpAndInitializeGraph(handler, kTwoInputs, kTwoOutputs));
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kAudioStream),
+                OnProcess(IsStreamInfo(_, kMsTimeScale, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample0Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kAudioStream),
+                OnProcess(IsCueEvent(_, kPromotedCueTimeInSeconds)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample1Start, kSampleDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample2Start, kSampleDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample3Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kAudioStream), OnFlush(_));
+  }
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kVideoStream),
+                OnProcess(IsStreamInfo(_, kMsTimeScale, _, _)));
+    EXPECT_CALL(
+        *Output(kVideoStream),
+        OnProcess(IsMediaSample(_, kSample0Start, kSampleDuration, _, _)));
+    // The cue is inserted at the next key frame.
+    EXPECT_CALL(*Output(kVideoStream),
+                OnProcess(IsCueEvent(_, kPromotedCueTimeInSeconds)));
+    EXPECT_CALL(
+        *Output(kVideoStream),
+        OnProcess(IsMediaSample(_, kSample2Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kVideoStream), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchAudioInfo(kAudioStream));
+  ASSERT_OK(DispatchVideoInfo(kVideoStream));
+
+  ASSERT_OK(DispatchMediaSample(kVideoStream, kSample0Start, kSampleDuration,
+                                kKeyFrame));
+  // The video has a gap.
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample0Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample1Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample2Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kVideoStream, kSample2Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample3Start, kSampleDuration,
+                                kKeyFrame));
+
+  ASSERT_OK(FlushAll({kAudioStream, kVideoStream}));
+}
+
 // TODO(kqyang): Add more tests, in particular, multi-thread tests.
 
 }  // namespace media
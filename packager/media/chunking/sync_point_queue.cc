@@ -36,10 +36,17 @@ void SyncPointQueue::Cancel() {
 }
 
 double SyncPointQueue::GetHint(double time_in_seconds) {
-  base::AutoLock auto_lock(lock_);
+  // The promoted cues are checked first, which does not need the lock.
+  const std::shared_ptr<const CueMap> promoted_cues = promoted();
+  auto iter = promoted_cues->upper_bound(time_in_seconds);
+  if (iter != promoted_cues->end())
+    return iter->first;
 
-  auto iter = promoted_.upper_bound(time_in_seconds);
-  if (iter != promoted_.end())
+  base::AutoLock auto_lock(lock_);
+  // A cue may have been promoted in the meantime.
+  const std::shared_ptr<const CueMap> latest_promoted_cues = promoted();
+  iter = latest_promoted_cues->upper_bound(time_in_seconds);
+  if (iter != latest_promoted_cues->end())
     return iter->first;
 
   iter = unpromoted_.upper_bound(time_in_seconds);
@@ -53,12 +60,19 @@ double SyncPointQueue::GetHint(double time_in_seconds) {
 
 std::shared_ptr<const CueEvent> SyncPointQueue::GetNext(
     double hint_in_seconds) {
+  // Find the promoted cue that would line up with our hint, which is the first
+  // cue that is not less than |hint_in_seconds|. It is usually promoted already
+  // by a video stream, in which case the lock is not needed.
+  std::shared_ptr<const CueMap> promoted_cues = promoted();
+  auto iter = promoted_cues->lower_bound(hint_in_seconds);
+  if (iter != promoted_cues->end())
+    return iter->second;
+
   base::AutoLock auto_lock(lock_);
   while (!cancelled_) {
-    // Find the promoted cue that would line up with our hint, which is the
-    // first cue that is not less than |hint_in_seconds|.
-    auto iter = promoted_.lower_bound(hint_in_seconds);
-    if (iter != promoted_.end()) {
+    promoted_cues = promoted();
+    iter = promoted_cues->lower_bound(hint_in_seconds);
+    if (iter != promoted_cues->end()) {
       return iter->second;
     }
 
@@ -96,15 +110,15 @@ std::shared_ptr<const CueEvent> SyncPointQueue::PromoteAtNoLocking(
   lock_.AssertAcquired();
 
   // It is possible that |time_in_seconds| has been promoted.
-  auto iter = promoted_.find(time_in_seconds);
-  if (iter != promoted_.end())
-    return iter->second;
+  auto promoted_iter = promoted_->find(time_in_seconds);
+  if (promoted_iter != promoted_->end())
+    return promoted_iter->second;
 
   // Find the unpromoted cue that would work for the given time, which is the
   // first cue that is not greater than |time_in_seconds|.
   // So find the the first cue that is greater than |time_in_seconds| first and
   // then get the previous one.
-  iter = unpromoted_.upper_bound(time_in_seconds);
+  auto iter = unpromoted_.upper_bound(time_in_seconds);
   // The first cue in |unpromoted_| should not be greater than
   // |time_in_seconds|. It could happen only if it has been promoted at a
   // different timestamp, which can only be the result of unaligned GOPs.
@@ -116,14 +130,19 @@ std::shared_ptr<const CueEvent> SyncPointQueue::PromoteAtNoLocking(
   std::shared_ptr<CueEvent> cue = prev_iter->second;
   cue->time_in_seconds = time_in_seconds;
 
-  promoted_[time_in_seconds] = cue;
+  // Publish a new snapshot: the readers of the previous one are not affected.
+  std::shared_ptr<CueMap> promoted_cues = std::make_shared<CueMap>(*promoted_);
+  (*promoted_cues)[time_in_seconds] = cue;
+  std::atomic_store(&promoted_,
+                    std::shared_ptr<const CueMap>(std::move(promoted_cues)));
   // Remove all unpromoted cues up to the cue that was just promoted.
   // User may provide multiple cue points at the same or similar timestamps. The
   // extra unused cues are simply ignored.
   unpromoted_.erase(unpromoted_.begin(), iter);
 
-  // Wake up other threads that may be waiting.
-  sync_condition_.Broadcast();
+  // Wake up the threads waiting for a promotion, if any.
+  if (waiting_thread_count_ > 0)
+    sync_condition_.Broadcast();
   return std::move(cue);
 }
 
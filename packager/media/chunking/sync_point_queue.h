@@ -16,7 +16,9 @@ namespace media {
 
 struct CueEvent;
 
-/// A synchronized queue for cue points.
+/// A synchronized queue for cue points. The promoted cues are published as an
+/// immutable snapshot, so the threads find them without locking; only the
+/// promotions and the threads waiting for one take the lock.
 class SyncPointQueue {
  public:
   explicit SyncPointQueue(const AdCueGeneratorParams& params);
@@ -60,14 +62,23 @@ class SyncPointQueue {
   // functions that have locks.
   std::shared_ptr<const CueEvent> PromoteAtNoLocking(double time_in_seconds);
 
+  typedef std::map<double, std::shared_ptr<CueEvent>> CueMap;
+
+  // @return the current snapshot of the promoted cues.
+  std::shared_ptr<const CueMap> promoted() const {
+    return std::atomic_load(&promoted_);
+  }
+
   base::Lock lock_;
   base::ConditionVariable sync_condition_;
   size_t thread_count_ = 0;
   size_t waiting_thread_count_ = 0;
   bool cancelled_ = false;
 
-  std::map<double, std::shared_ptr<CueEvent>> unpromoted_;
-  std::map<double, std::shared_ptr<CueEvent>> promoted_;
+  CueMap unpromoted_;
+  // Replaced, under |lock_|, by a new snapshot for every promotion, and read
+  // without locking.
+  std::shared_ptr<const CueMap> promoted_ = std::make_shared<CueMap>();
 };
 
 }  // namespace media
@@ -0,0 +1,106 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/chunking/sync_point_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <thread>
+
+#include "packager/media/base/media_handler.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const double kCue1Time = 1;
+const double kCue2Time = 3;
+
+AdCueGeneratorParams CreateParams() {
+  AdCueGeneratorParams params;
+  for (double cue_time : {kCue1Time, kCue2Time}) {
+    Cuepoint cue;
+    cue.start_time_in_seconds = cue_time;
+    params.cue_points.push_back(cue);
+  }
+  return params;
+}
+
+}  // namespace
+
+TEST(SyncPointQueueTest, GetHint) {
+  SyncPointQueue sync_points(CreateParams());
+  EXPECT_EQ(kCue1Time, sync_points.GetHint(-1));
+  EXPECT_EQ(kCue2Time, sync_points.GetHint(kCue1Time));
+  EXPECT_EQ(std::numeric_limits<double>::max(),
+            sync_points.GetHint(kCue2Time));
+  EXPECT_FALSE(sync_points.HasMore(sync_points.GetHint(kCue2Time)));
+}
+
+TEST(SyncPointQueueTest, PromoteAt) {
+  const double kPromotedTime = 1.5;
+
+  SyncPointQueue sync_points(CreateParams());
+  std::shared_ptr<const CueEvent> cue = sync_points.PromoteAt(kPromotedTime);
+  ASSERT_TRUE(cue);
+  EXPECT_EQ(kPromotedTime, cue->time_in_seconds);
+  // The hints now use the promoted time.
+  EXPECT_EQ(kPromotedTime, sync_points.GetHint(-1));
+  EXPECT_EQ(kCue2Time, sync_points.GetHint(kPromotedTime));
+
+  // The same cue is returned for the same time.
+  EXPECT_EQ(cue, sync_points.PromoteAt(kPromotedTime));
+  // There is no cue left to promote before the second cue.
+  EXPECT_FALSE(sync_points.PromoteAt(kPromotedTime + 0.5));
+}
+
+TEST(SyncPointQueueTest, GetNextPromotesWhenAllThreadsWait) {
+  SyncPointQueue sync_points(CreateParams());
+  sync_points.AddThread();
+
+  std::shared_ptr<const CueEvent> cue = sync_points.GetNext(kCue1Time);
+  ASSERT_TRUE(cue);
+  EXPECT_EQ(kCue1Time, cue->time_in_seconds);
+  // The promoted cue is found without waiting.
+  EXPECT_EQ(cue, sync_points.GetNext(kCue1Time));
+}
+
+TEST(SyncPointQueueTest, GetNextWaitsForPromotion) {
+  const double kPromotedTime = 1.2;
+
+  SyncPointQueue sync_points(CreateParams());
+  sync_points.AddThread();
+  sync_points.AddThread();
+
+  std::shared_ptr<const CueEvent> cue;
+  std::thread waiting_thread(
+      [&sync_points, &cue]() { cue = sync_points.GetNext(kCue1Time); });
+  std::shared_ptr<const CueEvent> promoted_cue =
+      sync_points.PromoteAt(kPromotedTime);
+  waiting_thread.join();
+
+  ASSERT_TRUE(cue);
+  EXPECT_EQ(promoted_cue, cue);
+  EXPECT_EQ(kPromotedTime, cue->time_in_seconds);
+}
+
+TEST(SyncPointQueueTest, CancelUnblocksGetNext) {
+  SyncPointQueue sync_points(CreateParams());
+  sync_points.AddThread();
+  sync_points.AddThread();
+
+  std::shared_ptr<const CueEvent> cue = std::make_shared<CueEvent>();
+  std::thread waiting_thread(
+      [&sync_points, &cue]() { cue = sync_points.GetNext(kCue1Time); });
+  sync_points.Cancel();
+  waiting_thread.join();
+
+  EXPECT_FALSE(cue);
+}
+
+}  // namespace media
+}  // namespace shaka
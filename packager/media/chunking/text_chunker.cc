@@ -90,7 +90,10 @@ Status TextChunker::OnTextSample(std::shared_ptr<const TextSample> sample) {
     RETURN_IF_ERROR(DispatchSegment(segment_duration_));
   }
 
-  samples_in_current_segment_.push_back(std::move(sample));
+  // A heartbeat only advances the segments, so a sparse stream gets its empty
+  // segments as the input progresses rather than when its next cue comes in.
+  if (!sample->is_heartbeat())
+    samples_in_current_segment_.push_back(std::move(sample));
 
   return Status::OK;
 }
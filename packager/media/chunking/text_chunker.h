@@ -17,7 +17,9 @@ namespace media {
 // Media handler for taking a single stream of text samples and inserting
 // segment info based on a fixed segment duration and on cue events. The
 // only time a segment's duration will not match the fixed segment duration
-// is when a cue event is seen.
+// is when a cue event is seen. The heartbeat samples, see
+// TextSample::CreateHeartbeat(), end the segments they are past without being
+// dispatched themselves.
 class TextChunker : public MediaHandler {
  public:
   explicit TextChunker(double segment_duration_in_seconds);
@@ -668,5 +668,63 @@ TEST_F(TextChunkerTest, SampleSpanningMultipleCues) {
   ASSERT_OK(Input(kInput)->FlushAllDownstreams());
 }
 
+// Verify that the heartbeats end the segments they are past without being
+// dispatched.
+//
+// Segment Duration = 100 MS
+//
+// TIME (ms):0     5     1     1     2     2     3
+//                 0     0     5     0     5     0
+//                       0     0     0     0     0
+// SAMPLES  :[--A--]
+// HEARTBEAT:                        ^           ^
+// SEGMENTS :            ^           ^           ^
+//
+TEST_F(TextChunkerTest, HeartbeatsEndSegments) {
+  const double kSegmentDurationSec = 0.1;
+  const int64_t kSegmentDurationMs = 100;
+
+  const int64_t kSegment0Start = 0;
+  const int64_t kSegment1Start = 100;
+  const int64_t kSegment2Start = 200;
+
+  const int64_t kSampleAStart = 0;
+  const int64_t kSampleAEnd = 50;
+
+  const int64_t kHeartbeat0Time = 200;
+  const int64_t kHeartbeat1Time = 300;
+
+  ASSERT_OK(Init(kSegmentDurationSec));
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kOutput), OnProcess(IsStreamInfo(_, _, _, _)));
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsTextSample(_, _, kSampleAStart, kSampleAEnd)));
+    EXPECT_CALL(
+        *Output(kOutput),
+        OnProcess(IsSegmentInfo(_, kSegment0Start, kSegmentDurationMs, _, _)));
+    EXPECT_CALL(
+        *Output(kOutput),
+        OnProcess(IsSegmentInfo(_, kSegment1Start, kSegmentDurationMs, _, _)));
+    EXPECT_CALL(
+        *Output(kOutput),
+        OnProcess(IsSegmentInfo(_, kSegment2Start, kSegmentDurationMs, _, _)));
+    EXPECT_CALL(*Output(kOutput), OnFlush(kStreamIndex));
+  }
+
+  ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetTextStreamInfo(kMsTimeScale))));
+  ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromTextSample(
+      kStreamIndex,
+      GetTextSample(kNoId, kSampleAStart, kSampleAEnd, kNoPayload))));
+  ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromTextSample(
+      kStreamIndex, TextSample::CreateHeartbeat(kHeartbeat0Time))));
+  ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromTextSample(
+      kStreamIndex, TextSample::CreateHeartbeat(kHeartbeat1Time))));
+  ASSERT_OK(Input(kInput)->FlushAllDownstreams());
+}
+
 }  // namespace media
 }  // namespace shaka
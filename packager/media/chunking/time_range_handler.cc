@@ -0,0 +1,69 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/chunking/time_range_handler.h"
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+namespace {
+const size_t kStreamIndex = 0;
+}  // namespace
+
+TimeRangeHandler::TimeRangeHandler(const VodShardParams& vod_shard_params)
+    : vod_shard_params_(vod_shard_params) {}
+
+Status TimeRangeHandler::InitializeInternal() {
+  return Status::OK;
+}
+
+Status TimeRangeHandler::Process(std::unique_ptr<StreamData> stream_data) {
+  DCHECK_EQ(stream_data->stream_index, kStreamIndex);
+  switch (stream_data->stream_data_type) {
+    case StreamDataType::kStreamInfo: {
+      const uint32_t time_scale = stream_data->stream_info->time_scale();
+      start_time_ = vod_shard_params_.start_time_in_seconds * time_scale;
+      if (vod_shard_params_.end_time_in_seconds > 0)
+        end_time_ = vod_shard_params_.end_time_in_seconds * time_scale;
+      return Dispatch(std::move(stream_data));
+    }
+    case StreamDataType::kMediaSample:
+      return OnMediaSample(std::move(stream_data));
+    case StreamDataType::kCueEvent: {
+      const double time_in_seconds = stream_data->cue_event->time_in_seconds;
+      const bool in_range =
+          time_in_seconds >= vod_shard_params_.start_time_in_seconds &&
+          (vod_shard_params_.end_time_in_seconds <= 0 ||
+           time_in_seconds < vod_shard_params_.end_time_in_seconds);
+      return in_range ? Dispatch(std::move(stream_data)) : Status::OK;
+    }
+    default:
+      return Dispatch(std::move(stream_data));
+  }
+}
+
+Status TimeRangeHandler::OnMediaSample(
+    std::unique_ptr<StreamData> stream_data) {
+  const MediaSample& sample = *stream_data->media_sample;
+  if (ended_)
+    return Status::OK;
+  if (sample.is_key_frame()) {
+    if (end_time_ && sample.pts() >= end_time_.value()) {
+      VLOG(1) << "Time range ends at " << sample.pts();
+      ended_ = true;
+      return Status::OK;
+    }
+    if (!started_ && sample.pts() >= start_time_) {
+      VLOG(1) << "Time range starts at " << sample.pts();
+      started_ = true;
+    }
+  }
+  return started_ ? Dispatch(std::move(stream_data)) : Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,58 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_CHUNKING_TIME_RANGE_HANDLER_H_
+#define PACKAGER_MEDIA_CHUNKING_TIME_RANGE_HANDLER_H_
+
+#include "packager/base/optional.h"
+#include "packager/media/base/media_handler.h"
+#include "packager/media/public/vod_shard_params.h"
+
+namespace shaka {
+namespace media {
+
+/// TimeRangeHandler passes on the samples of a time range of the stream, see
+/// VodShardParams. The range starts at the first key frame with a
+/// presentation timestamp at or after the start time, and ends before the
+/// first key frame at or after the end time. The samples are in decoding
+/// order, so the samples following the first key frame in decoding order
+/// belong to the range even if they are presented before it, just as the
+/// ChunkingHandler puts them in the segment of that key frame.
+/// The cue events in the range are passed on; the others are dropped so that
+/// a cue is only in one range.
+/// This handler is a one-in one-out handler.
+class TimeRangeHandler : public MediaHandler {
+ public:
+  explicit TimeRangeHandler(const VodShardParams& vod_shard_params);
+  ~TimeRangeHandler() override = default;
+
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status InitializeInternal() override;
+  Status Process(std::unique_ptr<StreamData> stream_data) override;
+  /// @}
+
+ private:
+  TimeRangeHandler(const TimeRangeHandler&) = delete;
+  TimeRangeHandler& operator=(const TimeRangeHandler&) = delete;
+
+  Status OnMediaSample(std::unique_ptr<StreamData> stream_data);
+
+  const VodShardParams vod_shard_params_;
+
+  // The range boundaries in the stream's time scale. |end_time_| is not set if
+  // the range ends with the stream.
+  int64_t start_time_ = 0;
+  base::Optional<int64_t> end_time_;
+  bool started_ = false;
+  bool ended_ = false;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_CHUNKING_TIME_RANGE_HANDLER_H_
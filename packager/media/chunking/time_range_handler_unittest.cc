@@ -0,0 +1,121 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/chunking/time_range_handler.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/status_macros.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+using ::testing::InSequence;
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kStreamIndex = 0;
+const size_t kInputs = 1;
+const size_t kOutputs = 1;
+const size_t kInput = 0;
+const size_t kOutput = 0;
+const uint32_t kTimeScale = 1000;
+const int64_t kDuration = 100;
+const bool kEncrypted = true;
+// A key frame every 400 ms.
+const int kGopSize = 4;
+const int kNumSamples = 24;
+
+}  // namespace
+
+class TimeRangeHandlerTest : public MediaHandlerTestBase {
+ protected:
+  void SetUpHandler(double start_time_in_seconds, double end_time_in_seconds) {
+    VodShardParams params;
+    params.start_time_in_seconds = start_time_in_seconds;
+    params.end_time_in_seconds = end_time_in_seconds;
+    ASSERT_OK(SetUpAndInitializeGraph(std::make_shared<TimeRangeHandler>(params),
+                                      kInputs, kOutputs));
+  }
+
+  Status DispatchVideo() {
+    RETURN_IF_ERROR(Input(kInput)->Dispatch(StreamData::FromStreamInfo(
+        kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+    for (int i = 0; i < kNumSamples; ++i) {
+      RETURN_IF_ERROR(Input(kInput)->Dispatch(StreamData::FromMediaSample(
+          kStreamIndex,
+          GetMediaSample(i * kDuration, kDuration, i % kGopSize == 0))));
+    }
+    return Input(kInput)->FlushAllDownstreams();
+  }
+
+  void ExpectSamples(int first_sample, int end_sample) {
+    for (int i = first_sample; i < end_sample; ++i) {
+      EXPECT_CALL(*Output(kOutput),
+                  OnProcess(IsMediaSample(kStreamIndex, i * kDuration,
+                                          kDuration, !kEncrypted,
+                                          i % kGopSize == 0)));
+    }
+  }
+};
+
+TEST_F(TimeRangeHandlerTest, StartsAndEndsAtKeyFrames) {
+  SetUpHandler(0.5, 1.3);
+
+  InSequence s;
+  EXPECT_CALL(*Output(kOutput), OnProcess(IsStreamInfo(kStreamIndex, kTimeScale,
+                                                       !kEncrypted, _)));
+  // The range starts at the key frame at 800 ms and ends before the key frame
+  // at 1600 ms.
+  ExpectSamples(8, 16);
+  EXPECT_CALL(*Output(kOutput), OnFlush(kStreamIndex));
+
+  ASSERT_OK(DispatchVideo());
+}
+
+// The range [0, 1.2) and the range starting at 1.2 cover the stream.
+TEST_F(TimeRangeHandlerTest, FirstRange) {
+  SetUpHandler(0, 1.2);
+
+  InSequence s;
+  EXPECT_CALL(*Output(kOutput), OnProcess(IsStreamInfo(_, _, _, _)));
+  ExpectSamples(0, 12);
+  EXPECT_CALL(*Output(kOutput), OnFlush(kStreamIndex));
+
+  ASSERT_OK(DispatchVideo());
+}
+
+TEST_F(TimeRangeHandlerTest, LastRange) {
+  SetUpHandler(1.2, 0);
+
+  InSequence s;
+  EXPECT_CALL(*Output(kOutput), OnProcess(IsStreamInfo(_, _, _, _)));
+  ExpectSamples(12, kNumSamples);
+  EXPECT_CALL(*Output(kOutput), OnFlush(kStreamIndex));
+
+  ASSERT_OK(DispatchVideo());
+}
+
+TEST_F(TimeRangeHandlerTest, DropsCueEventsOutsideTheRange) {
+  SetUpHandler(1, 2);
+
+  InSequence s;
+  EXPECT_CALL(*Output(kOutput), OnProcess(IsStreamInfo(_, _, _, _)));
+  EXPECT_CALL(*Output(kOutput), OnProcess(IsCueEvent(kStreamIndex, 1.5)));
+
+  ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetAudioStreamInfo(kTimeScale))));
+  for (double time_in_seconds : {0.5, 1.5, 2.0}) {
+    ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromCueEvent(
+        kStreamIndex, GetCueEvent(time_in_seconds))));
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
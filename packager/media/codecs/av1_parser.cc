@@ -259,14 +259,15 @@ bool AV1Parser::Parse(const uint8_t* data,
 
   BitReader reader(data, data_size);
   while (reader.bits_available() > 0) {
-    if (!ParseOpenBitstreamUnit(&reader, tiles))
+    if (!ParseOpenBitstreamUnit(data, &reader, tiles))
       return false;
   }
   return true;
 }
 
 // 5.3.1. General OBU syntax.
-bool AV1Parser::ParseOpenBitstreamUnit(BitReader* reader,
+bool AV1Parser::ParseOpenBitstreamUnit(const uint8_t* data,
+                                       BitReader* reader,
                                        std::vector<Tile>* tiles) {
   ObuHeader obu_header;
   RCHECK(ParseObuHeader(reader, &obu_header));
@@ -281,9 +282,23 @@ bool AV1Parser::ParseOpenBitstreamUnit(BitReader* reader,
 
   const size_t start_position = reader->bit_position();
   switch (obu_header.obu_type) {
-    case OBU_SEQUENCE_HEADER:
+    case OBU_SEQUENCE_HEADER: {
+      // The sequence header is usually repeated before every key frame, and
+      // parsing the same sequence header again does not change the state.
+      DCHECK_EQ(0u, start_position % 8);
+      const uint8_t* obu_data = data + start_position / 8;
+      RCHECK(obu_size <= reader->bits_available() / 8);
+      if (!sequence_header_obu_.empty() &&
+          sequence_header_obu_.size() == obu_size &&
+          std::equal(obu_data, obu_data + obu_size,
+                     sequence_header_obu_.begin())) {
+        RCHECK(reader->SkipBits(obu_size * 8));
+        return true;
+      }
+      sequence_header_obu_.clear();
       RCHECK(ParseSequenceHeaderObu(reader));
       break;
+    }
     case OBU_FRAME_HEADER:
     case OBU_REDUNDENT_FRAME_HEADER:
       RCHECK(ParseFrameHeaderObu(obu_header, reader));
@@ -309,6 +324,10 @@ bool AV1Parser::ParseOpenBitstreamUnit(BitReader* reader,
     RCHECK(payload_bits <= obu_size * 8);
     RCHECK(ParseTrailingBits(obu_size * 8 - payload_bits, reader));
   }
+  if (obu_header.obu_type == OBU_SEQUENCE_HEADER) {
+    const uint8_t* obu_data = data + start_position / 8;
+    sequence_header_obu_.assign(obu_data, obu_data + obu_size);
+  }
   return true;
 }
 
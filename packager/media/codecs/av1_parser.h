@@ -195,7 +195,9 @@ class AV1Parser {
     bool subsampling_y = false;
   };
 
-  bool ParseOpenBitstreamUnit(BitReader* reader, std::vector<Tile>* tiles);
+  bool ParseOpenBitstreamUnit(const uint8_t* data,
+                              BitReader* reader,
+                              std::vector<Tile>* tiles);
   bool ParseObuHeader(BitReader* reader, ObuHeader* obu_header);
   bool ParseObuExtensionHeader(BitReader* reader,
                                ObuExtensionHeader* obu_extension_header);
@@ -277,6 +279,9 @@ class AV1Parser {
   int GetQIndex(bool ignore_delta_q, int segment_id);
 
   SequenceHeaderObu sequence_header_;
+  // The payload of the last sequence header OBU parsed, to skip the identical
+  // sequence header OBUs which follow.
+  std::vector<uint8_t> sequence_header_obu_;
   FrameHeaderObu frame_header_;
   static constexpr int kNumRefFrames = 8;
   ReferenceFrame reference_frames_[kNumRefFrames];
@@ -30,5 +30,26 @@ TEST(AV1ParserTest, ParseIFrameSuccess) {
   EXPECT_THAT(tiles, ElementsAre(AV1Parser::Tile{0x1d, 0x4e1}));
 }
 
+TEST(AV1ParserTest, ParseRepeatedSequenceHeader) {
+  const std::vector<uint8_t> buffer = ReadTestDataFile("av1-I-frame-320x240");
+
+  AV1Parser parser;
+  std::vector<AV1Parser::Tile> tiles;
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  // The identical sequence header of the next temporal unit is skipped.
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  EXPECT_THAT(tiles, ElementsAre(AV1Parser::Tile{0x1d, 0x4e1}));
+}
+
+TEST(AV1ParserTest, ParseTruncatedSequenceHeader) {
+  const std::vector<uint8_t> buffer = ReadTestDataFile("av1-I-frame-320x240");
+
+  AV1Parser parser;
+  std::vector<AV1Parser::Tile> tiles;
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  // The temporal delimiter and the first bytes of the sequence header.
+  EXPECT_FALSE(parser.Parse(buffer.data(), 6, &tiles));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -43,8 +43,12 @@
         'h265_parser.h',
         'h26x_bit_reader.cc',
         'h26x_bit_reader.h',
+        'h26x_byte_scanner.cc',
+        'h26x_byte_scanner.h',
         'h26x_byte_to_unit_stream_converter.cc',
         'h26x_byte_to_unit_stream_converter.h',
+        'h26x_parameter_set_cache.cc',
+        'h26x_parameter_set_cache.h',
         'hevc_decoder_configuration_record.cc',
         'hevc_decoder_configuration_record.h',
         'hls_audio_util.cc',
@@ -86,6 +90,8 @@
         'h265_byte_to_unit_stream_converter_unittest.cc',
         'h265_parser_unittest.cc',
         'h26x_bit_reader_unittest.cc',
+        'h26x_byte_scanner_unittest.cc',
+        'h26x_parameter_set_cache_unittest.cc',
         'hevc_decoder_configuration_record_unittest.cc',
         'hls_audio_util_unittest.cc',
         'nal_unit_to_byte_stream_converter_unittest.cc',
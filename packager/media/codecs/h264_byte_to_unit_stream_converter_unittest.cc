@@ -138,5 +138,72 @@ TEST(H264ByteToUnitStreamConverter, NaluConversionWithSpsExtension) {
             std::end(kExpectedDecoderConfig)), decoder_config);          
 }
 
+TEST(H264ByteToUnitStreamConverter, ConvertInPlace) {
+  const uint8_t kByteStream[] = {
+      0x00, 0x00, 0x00, 0x01,  // Start code
+      0x09, 0xF0,              // AUD
+      0x00, 0x00, 0x00, 0x01,  // Start code
+      0x68, 0xFE, 0xFD, 0xFC,  // PPS
+      0x00, 0x00, 0x00, 0x01,  // Start code
+      0x06, 0xFD, 0x78, 0xA4,  // SEI
+      0x00, 0x00, 0x00, 0x01,  // Start code
+      0x65, 0x88, 0x84, 0x00, 0x21,  // IDR slice
+  };
+  const uint8_t kExpectedUnitStream[] = {
+      0x00, 0x00, 0x00, 0x04, 0x68, 0xFE, 0xFD, 0xFC,
+      0x00, 0x00, 0x00, 0x04, 0x06, 0xFD, 0x78, 0xA4,
+      0x00, 0x00, 0x00, 0x05, 0x65, 0x88, 0x84, 0x00, 0x21,
+  };
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithParameterSetNalus);
+  std::vector<uint8_t> frame(std::begin(kByteStream), std::end(kByteStream));
+  size_t frame_size = 0;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStream(
+      frame.data(), frame.size(), frame.data(), &frame_size));
+  frame.resize(frame_size);
+  EXPECT_EQ(std::vector<uint8_t>(std::begin(kExpectedUnitStream),
+                                 std::end(kExpectedUnitStream)),
+            frame);
+}
+
+TEST(H264ByteToUnitStreamConverter, ConvertWithoutCopyMatchesCopy) {
+  // Without the parameter sets, a NAL unit following a 3-byte start code may
+  // still fit.
+  const uint8_t kByteStream[] = {
+      0x00, 0x00, 0x00, 0x01,  // Start code
+      0x67, 0x64, 0x00, 0x1E,  // SPS
+      0x00, 0x00, 0x01,        // 3-byte start code
+      0x65, 0x88, 0x84,        // IDR slice
+  };
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus);
+  std::vector<uint8_t> expected_output_frame;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStream(
+      kByteStream, sizeof(kByteStream), &expected_output_frame));
+  std::vector<uint8_t> output_frame(sizeof(kByteStream));
+  size_t output_frame_size = 0;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStream(
+      kByteStream, sizeof(kByteStream), output_frame.data(),
+      &output_frame_size));
+  output_frame.resize(output_frame_size);
+  EXPECT_EQ(expected_output_frame, output_frame);
+}
+
+TEST(H264ByteToUnitStreamConverter, ConvertWithoutCopyDoesNotFit) {
+  // The frame has 3-byte start codes, so the converted frame is larger.
+  std::vector<uint8_t> input_frame =
+      ReadTestDataFile("avc-byte-stream-frame.h264");
+  ASSERT_FALSE(input_frame.empty());
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithParameterSetNalus);
+  std::vector<uint8_t> output_frame(input_frame.size());
+  size_t output_frame_size = 0;
+  EXPECT_FALSE(converter.ConvertByteStreamToNalUnitStream(
+      input_frame.data(), input_frame.size(), output_frame.data(),
+      &output_frame_size));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -586,6 +586,10 @@ H264Parser::Result H264Parser::ParseSps(const Nalu& nalu, int* sps_id) {
 
   *sps_id = -1;
 
+  // SPSes are usually repeated in-band, e.g. before every IDR.
+  if (sps_cache_.Find(nalu, sps_id))
+    return kOk;
+
   std::unique_ptr<H264Sps> sps(new H264Sps());
 
   READ_BITS_OR_RETURN(8, &sps->profile_idc);
@@ -693,6 +697,10 @@ H264Parser::Result H264Parser::ParseSps(const Nalu& nalu, int* sps_id) {
   // If an SPS with the same id already exists, replace it.
   *sps_id = sps->seq_parameter_set_id;
   active_SPSes_[*sps_id] = std::move(sps);
+  sps_cache_.Insert(nalu, *sps_id);
+  // The PPSes are parsed based on their SPS.
+  pps_cache_.Clear();
+  ++parameter_sets_version_;
 
   return kOk;
 }
@@ -707,6 +715,9 @@ H264Parser::Result H264Parser::ParsePps(const Nalu& nalu, int* pps_id) {
 
   *pps_id = -1;
 
+  if (pps_cache_.Find(nalu, pps_id))
+    return kOk;
+
   std::unique_ptr<H264Pps> pps(new H264Pps());
 
   READ_UE_OR_RETURN(&pps->pic_parameter_set_id);
@@ -766,6 +777,8 @@ H264Parser::Result H264Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   // If a PPS with the same id already exists, replace it.
   *pps_id = pps->pic_parameter_set_id;
   active_PPSes_[*pps_id] = std::move(pps);
+  pps_cache_.Insert(nalu, *pps_id);
+  ++parameter_sets_version_;
 
   return kOk;
 }
@@ -14,6 +14,7 @@
 #include <memory>
 
 #include "packager/media/codecs/h26x_bit_reader.h"
+#include "packager/media/codecs/h26x_parameter_set_cache.h"
 #include "packager/media/codecs/nalu_reader.h"
 
 namespace shaka {
@@ -261,9 +262,15 @@ class H264Parser {
   // of the parsed structure in |*pps_id|/|*sps_id|.
   // To get a pointer to a given SPS/PPS structure, use GetSps()/GetPps(),
   // passing the returned |*sps_id|/|*pps_id| as parameter.
+  // An SPS/PPS identical to the one stored with the same id is not parsed
+  // again.
   Result ParseSps(const Nalu& nalu, int* sps_id);
   Result ParsePps(const Nalu& nalu, int* pps_id);
 
+  // Return the number of SPSes/PPSes stored so far, which changes whenever a
+  // new or different SPS/PPS is parsed, but not when one is repeated.
+  uint64_t parameter_sets_version() const { return parameter_sets_version_; }
+
   // Return a pointer to SPS/PPS with given |sps_id|/|pps_id| or NULL if not
   // present.
   const H264Sps* GetSps(int sps_id);
@@ -326,6 +333,9 @@ class H264Parser {
   typedef std::map<int, std::unique_ptr<H264Pps>> PpsById;
   SpsById active_SPSes_;
   PpsById active_PPSes_;
+  H26xParameterSetCache sps_cache_;
+  H26xParameterSetCache pps_cache_;
+  uint64_t parameter_sets_version_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(H264Parser);
 };
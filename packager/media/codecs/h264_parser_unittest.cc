@@ -124,6 +124,36 @@ TEST(H264ParserTest, SliceHeaderSize) {
   EXPECT_EQ(30u, slice_header.header_bit_size);
 }
 
+// The parameter sets repeated in-band are not parsed again.
+TEST(H264ParserTest, RepeatedParameterSets) {
+  H264Parser parser;
+  int sps_id = -1;
+  int pps_id = -1;
+  Nalu sps_nalu;
+  Nalu pps_nalu;
+  ASSERT_TRUE(sps_nalu.Initialize(Nalu::kH264, kSps, arraysize(kSps)));
+  ASSERT_TRUE(pps_nalu.Initialize(Nalu::kH264, kPps, arraysize(kPps)));
+  ASSERT_EQ(H264Parser::kOk, parser.ParseSps(sps_nalu, &sps_id));
+  ASSERT_EQ(H264Parser::kOk, parser.ParsePps(pps_nalu, &pps_id));
+  const uint64_t version = parser.parameter_sets_version();
+
+  int id = -1;
+  ASSERT_EQ(H264Parser::kOk, parser.ParseSps(sps_nalu, &id));
+  EXPECT_EQ(sps_id, id);
+  ASSERT_EQ(H264Parser::kOk, parser.ParsePps(pps_nalu, &id));
+  EXPECT_EQ(pps_id, id);
+  EXPECT_EQ(version, parser.parameter_sets_version());
+
+  // A new SPS invalidates the PPSes parsed with the previous one.
+  Nalu sps2_nalu;
+  ASSERT_TRUE(sps2_nalu.Initialize(Nalu::kH264, kSps2, arraysize(kSps2)));
+  ASSERT_EQ(H264Parser::kOk, parser.ParseSps(sps2_nalu, &id));
+  EXPECT_NE(version, parser.parameter_sets_version());
+  const uint64_t version2 = parser.parameter_sets_version();
+  ASSERT_EQ(H264Parser::kOk, parser.ParsePps(pps_nalu, &id));
+  EXPECT_NE(version2, parser.parameter_sets_version());
+}
+
 TEST(H264ParserTest, PredWeightTable) {
   H264Parser parser;
   int unused_id;
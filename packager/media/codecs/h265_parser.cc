@@ -407,6 +407,9 @@ H265Parser::Result H265Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   H26xBitReader* br = &reader;
 
   *pps_id = -1;
+  if (pps_cache_.Find(nalu, pps_id))
+    return kOk;
+
   std::unique_ptr<H265Pps> pps(new H265Pps);
 
   TRUE_OR_RETURN(br->ReadUE(&pps->pic_parameter_set_id));
@@ -502,6 +505,8 @@ H265Parser::Result H265Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   // This will replace any existing PPS instance.
   *pps_id = pps->pic_parameter_set_id;
   active_ppses_[*pps_id] = std::move(pps);
+  pps_cache_.Insert(nalu, *pps_id);
+  ++parameter_sets_version_;
 
   return kOk;
 }
@@ -516,6 +521,10 @@ H265Parser::Result H265Parser::ParseSps(const Nalu& nalu, int* sps_id) {
 
   *sps_id = -1;
 
+  // SPSes are usually repeated in-band, e.g. before every IRAP picture.
+  if (sps_cache_.Find(nalu, sps_id))
+    return kOk;
+
   std::unique_ptr<H265Sps> sps(new H265Sps);
 
   TRUE_OR_RETURN(br->ReadBits(4, &sps->video_parameter_set_id));
@@ -619,6 +628,8 @@ H265Parser::Result H265Parser::ParseSps(const Nalu& nalu, int* sps_id) {
   // This will replace any existing SPS instance.
   *sps_id = sps->seq_parameter_set_id;
   active_spses_[*sps_id] = std::move(sps);
+  sps_cache_.Insert(nalu, *sps_id);
+  ++parameter_sets_version_;
 
   return kOk;
 }
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "packager/media/codecs/h26x_bit_reader.h"
+#include "packager/media/codecs/h26x_parameter_set_cache.h"
 
 namespace shaka {
 namespace media {
@@ -302,11 +303,18 @@ class H265Parser {
 
   /// Parses a PPS element.  This object is owned and managed by this class.
   /// The unique ID of the parsed PPS is stored in |*pps_id| if kOk is returned.
+  /// A PPS identical to the one stored with the same ID is not parsed again.
   Result ParsePps(const Nalu& nalu, int* pps_id);
   /// Parses a SPS element.  This object is owned and managed by this class.
   /// The unique ID of the parsed SPS is stored in |*sps_id| if kOk is returned.
+  /// A SPS identical to the one stored with the same ID is not parsed again.
   Result ParseSps(const Nalu& nalu, int* sps_id);
 
+  /// @return the number of SPSes and PPSes stored so far, which changes
+  ///         whenever a new or different SPS or PPS is parsed, but not when
+  ///         one is repeated.
+  uint64_t parameter_sets_version() const { return parameter_sets_version_; }
+
   /// @return a pointer to the PPS with the given ID, or NULL if none exists.
   const H265Pps* GetPps(int pps_id);
   /// @return a pointer to the SPS with the given ID, or NULL if none exists.
@@ -359,6 +367,9 @@ class H265Parser {
 
   SpsById active_spses_;
   PpsById active_ppses_;
+  H26xParameterSetCache sps_cache_;
+  H26xParameterSetCache pps_cache_;
+  uint64_t parameter_sets_version_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(H265Parser);
 };
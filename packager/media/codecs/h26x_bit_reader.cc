@@ -4,6 +4,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/media/codecs/h26x_bit_reader.h"
+#include "packager/media/codecs/h26x_byte_scanner.h"
 
 namespace shaka {
 namespace media {
@@ -21,7 +22,7 @@ H26xBitReader::H26xBitReader()
       bytes_left_(0),
       curr_byte_(0),
       num_remaining_bits_in_curr_byte_(0),
-      prev_two_bytes_(0),
+      next_emulation_prevention_byte_(NULL),
       emulation_prevention_bytes_(0) {}
 
 H26xBitReader::~H26xBitReader() {}
@@ -35,9 +36,8 @@ bool H26xBitReader::Initialize(const uint8_t* data, off_t size) {
   data_ = data;
   bytes_left_ = size;
   num_remaining_bits_in_curr_byte_ = 0;
-  // Initially set to 0xffff to accept all initial two-byte sequences.
-  prev_two_bytes_ = 0xffff;
   emulation_prevention_bytes_ = 0;
+  UpdateNextEmulationPreventionByte();
 
   return true;
 }
@@ -48,13 +48,13 @@ bool H26xBitReader::UpdateCurrByte() {
 
   // Emulation prevention three-byte detection.
   // If a sequence of 0x000003 is found, skip (ignore) the last byte (0x03).
-  if (*data_ == 0x03 && (prev_two_bytes_ & 0xffff) == 0) {
+  if (data_ == next_emulation_prevention_byte_) {
     // Detected 0x000003, skip last byte.
     ++data_;
     --bytes_left_;
     ++emulation_prevention_bytes_;
     // Need another full three bytes before we can detect the sequence again.
-    prev_two_bytes_ = 0xffff;
+    UpdateNextEmulationPreventionByte();
 
     if (bytes_left_ < 1)
       return false;
@@ -65,11 +65,15 @@ bool H26xBitReader::UpdateCurrByte() {
   --bytes_left_;
   num_remaining_bits_in_curr_byte_ = 8;
 
-  prev_two_bytes_ = (prev_two_bytes_ << 8) | curr_byte_;
-
   return true;
 }
 
+void H26xBitReader::UpdateNextEmulationPreventionByte() {
+  const size_t offset = FindEmulationPreventionSequence(data_, bytes_left_);
+  next_emulation_prevention_byte_ =
+      offset < static_cast<size_t>(bytes_left_) ? data_ + offset + 2 : NULL;
+}
+
 // Read |num_bits| (1 to 31 inclusive) from the stream and return them
 // in |out|, with first bit in the stream as MSB in |out| at position
 // (|num_bits| - 1).
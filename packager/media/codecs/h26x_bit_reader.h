@@ -72,6 +72,10 @@ class H26xBitReader {
   // Return false on end of stream.
   bool UpdateCurrByte();
 
+  // Find the emulation prevention byte (0x03 of 0x000003) following |data_|,
+  // starting a new sequence at |data_|.
+  void UpdateNextEmulationPreventionByte();
+
   // Pointer to the next unread (not in curr_byte_) byte in the stream.
   const uint8_t* data_;
 
@@ -85,9 +89,10 @@ class H26xBitReader {
   // Number of bits remaining in curr_byte_
   int num_remaining_bits_in_curr_byte_;
 
-  // Used in emulation prevention three byte detection (see spec).
-  // Initially set to 0xffff to accept all initial two-byte sequences.
-  int prev_two_bytes_;
+  // Used in emulation prevention three byte detection (see spec). The whole
+  // stream is scanned ahead for the sequence rather than tracking the
+  // previous bytes one at a time. NULL if there is none left.
+  const uint8_t* next_emulation_prevention_byte_;
 
   // Number of emulation preventation bytes (0x000003) we met.
   size_t emulation_prevention_bytes_;
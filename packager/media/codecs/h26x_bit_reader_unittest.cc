@@ -4,7 +4,9 @@
 
 #include <gtest/gtest.h>
 
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/codecs/h26x_bit_reader.h"
+#include "packager/media/codecs/nal_unit_to_byte_stream_converter.h"
 
 namespace shaka {
 namespace media {
@@ -130,5 +132,50 @@ TEST(H26xBitReaderTest, StopBitOccupyFullByte) {
   EXPECT_FALSE(reader.HasMoreRBSPData());
 }
 
+TEST(H26xBitReaderTest, SkipEmulationPreventionBytes) {
+  H26xBitReader reader;
+  // The 0x03 following an emulation prevention byte is not one.
+  const unsigned char data[] = {0x00, 0x00, 0x03, 0x01, 0x00,
+                                0x00, 0x03, 0x03, 0xff};
+  const unsigned char rbsp[] = {0x00, 0x00, 0x01, 0x00, 0x00, 0x03, 0xff};
+  int value = 0;
+
+  EXPECT_TRUE(reader.Initialize(data, sizeof(data)));
+  for (size_t i = 0; i < sizeof(rbsp); ++i) {
+    EXPECT_TRUE(reader.ReadBits(8, &value));
+    EXPECT_EQ(rbsp[i], value);
+  }
+  EXPECT_EQ(2u, reader.NumEmulationPreventionBytesRead());
+  EXPECT_FALSE(reader.ReadBits(1, &value));
+}
+
+TEST(H26xBitReaderTest, ReadEscapedSequence) {
+  // Random bytes which are mostly 0x00 to 0x03.
+  std::vector<uint8_t> rbsp(2000);
+  uint32_t seed = 1;
+  for (uint8_t& value : rbsp) {
+    seed = seed * 1103515245 + 12345;
+    value = static_cast<uint8_t>((seed >> 16) % 16 < 12 ? (seed >> 20) % 4
+                                                        : seed >> 24);
+  }
+  // Avoid the trailing 0x03 appended to a trailing zero byte.
+  rbsp.back() = 0x80;
+
+  BufferWriter writer;
+  EscapeNalByteSequence(rbsp.data(), rbsp.size(), &writer);
+  ASSERT_GT(writer.Size(), rbsp.size());
+
+  H26xBitReader reader;
+  ASSERT_TRUE(reader.Initialize(writer.Buffer(), writer.Size()));
+  int value = 0;
+  for (size_t i = 0; i < rbsp.size(); ++i) {
+    ASSERT_TRUE(reader.ReadBits(8, &value));
+    ASSERT_EQ(rbsp[i], value) << "at " << i;
+  }
+  EXPECT_EQ(writer.Size() - rbsp.size(),
+            reader.NumEmulationPreventionBytesRead());
+  EXPECT_EQ(0, reader.NumBitsLeft());
+}
+
 }  // namespace media
 }  // namespace shaka
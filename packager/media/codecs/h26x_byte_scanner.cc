@@ -0,0 +1,157 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/codecs/h26x_byte_scanner.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SHAKA_BYTE_SCANNER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHAKA_BYTE_SCANNER_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SHAKA_BYTE_SCANNER_NEON
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace shaka {
+namespace media {
+namespace {
+
+#if defined(SHAKA_BYTE_SCANNER_AVX2) || defined(SHAKA_BYTE_SCANNER_SSE2)
+// |mask| must not be zero.
+inline size_t CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// The sequences searched for are two zero bytes followed by a byte for which
+// (byte & |third_byte_mask|) == |third_byte_value|.
+struct ZeroZeroPattern {
+  uint8_t third_byte_mask;
+  uint8_t third_byte_value;
+
+  bool IsThirdByte(uint8_t byte) const {
+    return (byte & third_byte_mask) == third_byte_value;
+  }
+};
+
+const ZeroZeroPattern kStartCodePrefixPattern = {0xFF, 0x01};
+// 00 00 00, 00 00 01, 00 00 02 and 00 00 03.
+const ZeroZeroPattern kEscapeSequencePattern = {0xFC, 0x00};
+const ZeroZeroPattern kEmulationPreventionPattern = {0xFF, 0x03};
+
+// Scans from |pos| one byte at a time, but skips three bytes whenever the
+// third byte of the candidate is not zero, as no sequence can then start at
+// the two following positions either.
+inline size_t FindScalar(const uint8_t* data,
+                         size_t data_size,
+                         size_t pos,
+                         const ZeroZeroPattern& pattern) {
+  while (pos + 3 <= data_size) {
+    const uint8_t third_byte = data[pos + 2];
+    if (pattern.IsThirdByte(third_byte) && data[pos] == 0x00 &&
+        data[pos + 1] == 0x00) {
+      return pos;
+    }
+    pos += third_byte == 0x00 ? 1 : 3;
+  }
+  return data_size;
+}
+
+inline size_t Find(const uint8_t* data,
+                   size_t data_size,
+                   const ZeroZeroPattern& pattern) {
+  size_t pos = 0;
+
+  // Compare the bytes at [pos, pos + 2] for all the candidates of a block at
+  // once, which needs the block size plus two bytes of input.
+#if defined(SHAKA_BYTE_SCANNER_AVX2)
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i mask = _mm256_set1_epi8(pattern.third_byte_mask);
+  const __m256i value = _mm256_set1_epi8(pattern.third_byte_value);
+  while (pos + 32 + 2 <= data_size) {
+    const uint8_t* p = data + pos;
+    const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i b1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+    const __m256i b2 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+    const __m256i match = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpeq_epi8(b0, zero),
+                         _mm256_cmpeq_epi8(b1, zero)),
+        _mm256_cmpeq_epi8(_mm256_and_si256(b2, mask), value));
+    const uint32_t match_mask =
+        static_cast<uint32_t>(_mm256_movemask_epi8(match));
+    if (match_mask)
+      return pos + CountTrailingZeros(match_mask);
+    pos += 32;
+  }
+#elif defined(SHAKA_BYTE_SCANNER_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask = _mm_set1_epi8(pattern.third_byte_mask);
+  const __m128i value = _mm_set1_epi8(pattern.third_byte_value);
+  while (pos + 16 + 2 <= data_size) {
+    const uint8_t* p = data + pos;
+    const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+    const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+    const __m128i match = _mm_and_si128(
+        _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+        _mm_cmpeq_epi8(_mm_and_si128(b2, mask), value));
+    const uint32_t match_mask = static_cast<uint32_t>(_mm_movemask_epi8(match));
+    if (match_mask)
+      return pos + CountTrailingZeros(match_mask);
+    pos += 16;
+  }
+#elif defined(SHAKA_BYTE_SCANNER_NEON)
+  const uint8x16_t zero = vdupq_n_u8(0);
+  const uint8x16_t mask = vdupq_n_u8(pattern.third_byte_mask);
+  const uint8x16_t value = vdupq_n_u8(pattern.third_byte_value);
+  while (pos + 16 + 2 <= data_size) {
+    const uint8_t* p = data + pos;
+    const uint8x16_t match =
+        vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(p), zero),
+                          vceqq_u8(vld1q_u8(p + 1), zero)),
+                 vceqq_u8(vandq_u8(vld1q_u8(p + 2), mask), value));
+    // There is no movemask on NEON. Matches are rare, so let the scalar scan
+    // locate it within the block.
+    if (vmaxvq_u8(match))
+      return FindScalar(data, pos + 16 + 2, pos, pattern);
+    pos += 16;
+  }
+#endif
+
+  return FindScalar(data, data_size, pos, pattern);
+}
+
+}  // namespace
+
+size_t FindStartCodePrefix(const uint8_t* data, size_t data_size) {
+  return Find(data, data_size, kStartCodePrefixPattern);
+}
+
+size_t FindEscapeSequence(const uint8_t* data, size_t data_size) {
+  return Find(data, data_size, kEscapeSequencePattern);
+}
+
+size_t FindEmulationPreventionSequence(const uint8_t* data, size_t data_size) {
+  return Find(data, data_size, kEmulationPreventionPattern);
+}
+
+}  // namespace media
+}  // namespace shaka
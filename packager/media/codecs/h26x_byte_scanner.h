@@ -0,0 +1,33 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_CODECS_H26X_BYTE_SCANNER_H_
+#define PACKAGER_MEDIA_CODECS_H26X_BYTE_SCANNER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace shaka {
+namespace media {
+
+/// Finds the first three-byte start code prefix (00 00 01) in @a data. Checks
+/// 16 or 32 bytes at a time with SSE2, AVX2 or NEON when available.
+/// @return the offset of the prefix, or @a data_size if there is none.
+size_t FindStartCodePrefix(const uint8_t* data, size_t data_size);
+
+/// Finds the first 00 00 0x sequence, x being 0 to 3, in @a data. These are
+/// the sequences that need an emulation prevention byte in a NAL unit.
+/// @return the offset of the sequence, or @a data_size if there is none.
+size_t FindEscapeSequence(const uint8_t* data, size_t data_size);
+
+/// Finds the first emulation prevention sequence (00 00 03) in @a data.
+/// @return the offset of the sequence, or @a data_size if there is none.
+size_t FindEmulationPreventionSequence(const uint8_t* data, size_t data_size);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_CODECS_H26X_BYTE_SCANNER_H_
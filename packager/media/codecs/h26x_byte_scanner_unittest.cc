@@ -0,0 +1,123 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/codecs/h26x_byte_scanner.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace shaka {
+namespace media {
+namespace {
+
+size_t ReferenceFind(const uint8_t* data,
+                     size_t data_size,
+                     uint8_t min_third_byte,
+                     uint8_t max_third_byte) {
+  for (size_t i = 0; i + 3 <= data_size; ++i) {
+    if (data[i] == 0x00 && data[i + 1] == 0x00 &&
+        data[i + 2] >= min_third_byte && data[i + 2] <= max_third_byte) {
+      return i;
+    }
+  }
+  return data_size;
+}
+
+size_t ReferenceFindStartCodePrefix(const uint8_t* data, size_t data_size) {
+  return ReferenceFind(data, data_size, 0x01, 0x01);
+}
+
+// Random bytes which are mostly 0x00 to 0x03, so there are many partial
+// matches.
+std::vector<uint8_t> CreateTestData(size_t size, uint32_t seed) {
+  std::vector<uint8_t> data(size);
+  for (uint8_t& value : data) {
+    seed = seed * 1103515245 + 12345;
+    const uint32_t random = (seed >> 16) % 8;
+    value = random < 5 ? 0x00
+                       : random < 7 ? static_cast<uint8_t>(seed >> 24) % 4
+                                    : static_cast<uint8_t>(seed >> 24);
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST(H26xByteScannerTest, FindStartCodePrefix) {
+  const uint8_t kData[] = {0x12, 0x00, 0x00, 0x00, 0x00, 0x01, 0x67};
+  EXPECT_EQ(3u, FindStartCodePrefix(kData, sizeof(kData)));
+  EXPECT_EQ(0u, FindStartCodePrefix(kData + 3, sizeof(kData) - 3));
+  // Truncated prefix.
+  EXPECT_EQ(5u, FindStartCodePrefix(kData, 5));
+  EXPECT_EQ(0u, FindStartCodePrefix(kData, 0));
+}
+
+TEST(H26xByteScannerTest, FindEscapeSequence) {
+  const uint8_t kData[] = {0x00, 0x00, 0x04, 0x00, 0x00, 0x02, 0x00, 0x00};
+  EXPECT_EQ(3u, FindEscapeSequence(kData, sizeof(kData)));
+  EXPECT_EQ(3u, FindEscapeSequence(kData + 5, sizeof(kData) - 5));
+  EXPECT_EQ(2u, FindEscapeSequence(kData + 6, sizeof(kData) - 6));
+}
+
+TEST(H26xByteScannerTest, FindEmulationPreventionSequence) {
+  const uint8_t kData[] = {0x00, 0x00, 0x01, 0x00, 0x00, 0x03, 0x01};
+  EXPECT_EQ(3u, FindEmulationPreventionSequence(kData, sizeof(kData)));
+  EXPECT_EQ(5u, FindEmulationPreventionSequence(kData, 5));
+}
+
+TEST(H26xByteScannerTest, FindStartCodePrefixAtEveryPosition) {
+  const size_t kSize = 100;
+  for (size_t pos = 0; pos + 3 <= kSize; ++pos) {
+    std::vector<uint8_t> data(kSize, 0xFF);
+    data[pos] = 0x00;
+    data[pos + 1] = 0x00;
+    data[pos + 2] = 0x01;
+    EXPECT_EQ(pos, FindStartCodePrefix(data.data(), data.size()));
+    // Truncating the data just before the end of the prefix.
+    EXPECT_EQ(pos + 2, FindStartCodePrefix(data.data(), pos + 2));
+  }
+}
+
+TEST(H26xByteScannerTest, SameAsReference) {
+  for (uint32_t seed = 1; seed <= 50; ++seed) {
+    const std::vector<uint8_t> data = CreateTestData(1000, seed);
+    for (size_t start = 0; start < 40; ++start) {
+      for (size_t end = data.size() - 40; end <= data.size(); ++end) {
+        const uint8_t* p = data.data() + start;
+        const size_t size = end - start;
+        ASSERT_EQ(ReferenceFindStartCodePrefix(p, size),
+                  FindStartCodePrefix(p, size))
+            << "seed " << seed << " start " << start << " end " << end;
+        ASSERT_EQ(ReferenceFind(p, size, 0x00, 0x03),
+                  FindEscapeSequence(p, size))
+            << "seed " << seed << " start " << start << " end " << end;
+        ASSERT_EQ(ReferenceFind(p, size, 0x03, 0x03),
+                  FindEmulationPreventionSequence(p, size))
+            << "seed " << seed << " start " << start << " end " << end;
+      }
+    }
+  }
+}
+
+TEST(H26xByteScannerTest, AllPrefixesFound) {
+  const std::vector<uint8_t> data = CreateTestData(10000, 1234);
+  size_t pos = 0;
+  size_t expected_pos = 0;
+  while (true) {
+    const size_t found =
+        pos + FindStartCodePrefix(data.data() + pos, data.size() - pos);
+    expected_pos = pos + ReferenceFindStartCodePrefix(data.data() + pos,
+                                                     data.size() - pos);
+    ASSERT_EQ(expected_pos, found);
+    if (found == data.size())
+      break;
+    pos = found + 1;
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
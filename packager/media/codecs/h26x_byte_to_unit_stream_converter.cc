@@ -7,6 +7,7 @@
 #include "packager/media/codecs/h26x_byte_to_unit_stream_converter.h"
 
 #include <gflags/gflags.h>
+#include <string.h>
 #include <limits>
 
 #include "packager/base/logging.h"
@@ -79,6 +80,50 @@ bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStream(
   return true;
 }
 
+bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStream(
+    const uint8_t* input_frame,
+    size_t input_frame_size,
+    uint8_t* output_frame,
+    size_t* output_frame_size) {
+  DCHECK(input_frame);
+  DCHECK(output_frame);
+  DCHECK(output_frame_size);
+
+  Nalu nalu;
+  NaluReader reader(type_, kIsAnnexbByteStream, input_frame, input_frame_size);
+  if (!reader.StartsWithStartCode()) {
+    LOG(ERROR) << "H.26x byte stream frame did not begin with start code.";
+    return false;
+  }
+
+  size_t output_size = 0;
+  while (reader.Advance(&nalu) == NaluReader::kOk) {
+    const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
+    DCHECK_LE(nalu_size, std::numeric_limits<uint32_t>::max());
+
+    if (ProcessNalu(nalu))
+      continue;
+
+    // The output must not overtake the NAL units not read yet, for the
+    // conversion in place. That holds if the length fits in the start code.
+    const size_t nalu_offset = nalu.data() - input_frame;
+    if (output_size + kUnitStreamNaluLengthSize > nalu_offset)
+      return false;
+
+    uint8_t* output = output_frame + output_size;
+    output[0] = static_cast<uint8_t>(nalu_size >> 24);
+    output[1] = static_cast<uint8_t>(nalu_size >> 16);
+    output[2] = static_cast<uint8_t>(nalu_size >> 8);
+    output[3] = static_cast<uint8_t>(nalu_size);
+    // The ranges overlap if converting in place.
+    memmove(output + kUnitStreamNaluLengthSize, nalu.data(), nalu_size);
+    output_size += kUnitStreamNaluLengthSize + nalu_size;
+  }
+
+  *output_frame_size = output_size;
+  return true;
+}
+
 void H26xByteToUnitStreamConverter::WarnIfNotMatch(
     int nalu_type,
     const uint8_t* nalu_ptr,
@@ -47,6 +47,27 @@ class H26xByteToUnitStreamConverter {
                                         size_t input_frame_size,
                                         std::vector<uint8_t>* output_frame);
 
+  /// Converts a whole byte stream encoded video frame to NAL unit stream
+  /// format without an intermediate buffer, e.g. directly into the sample
+  /// buffer. The output is never larger than the input if every start code
+  /// is 4 bytes long, as a start code is replaced with the 4-byte length of
+  /// its NAL unit. The conversion fails if a NAL unit does not fit, e.g. with
+  /// 3-byte start codes, in which case the copying version above should be
+  /// used.
+  /// @param input_frame is a buffer containing a whole H.26x frame in byte
+  ///        stream format.
+  /// @param input_frame_size is the size of the H.26x frame, in bytes.
+  /// @param output_frame is a buffer of at least @a input_frame_size bytes
+  ///        which receives the converted frame. It can be @a input_frame to
+  ///        convert the frame in place.
+  /// @param output_frame_size receives the size of the converted frame.
+  /// @return true if successful, false if the frame is invalid or does not
+  ///         fit. The content of @a output_frame is undefined then.
+  bool ConvertByteStreamToNalUnitStream(const uint8_t* input_frame,
+                                        size_t input_frame_size,
+                                        uint8_t* output_frame,
+                                        size_t* output_frame_size);
+
   /// Creates either an AVCDecoderConfigurationRecord or a
   /// HEVCDecoderConfigurationRecord from the units extracted from the byte
   /// stream.
@@ -0,0 +1,53 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/codecs/h26x_parameter_set_cache.h"
+
+#include "packager/media/codecs/nalu_reader.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+std::string GetContent(const Nalu& nalu) {
+  return std::string(reinterpret_cast<const char*>(nalu.data()),
+                     nalu.header_size() + nalu.payload_size());
+}
+
+}  // namespace
+
+H26xParameterSetCache::H26xParameterSetCache() {}
+
+H26xParameterSetCache::~H26xParameterSetCache() {}
+
+bool H26xParameterSetCache::Find(const Nalu& nalu, int* id) const {
+  auto it = id_by_content_.find(GetContent(nalu));
+  if (it == id_by_content_.end())
+    return false;
+  *id = it->second;
+  return true;
+}
+
+void H26xParameterSetCache::Insert(const Nalu& nalu, int id) {
+  std::string content = GetContent(nalu);
+  auto it = content_by_id_.find(id);
+  if (it != content_by_id_.end()) {
+    id_by_content_.erase(it->second);
+    it->second = content;
+  } else {
+    content_by_id_[id] = content;
+  }
+  // The id is part of the content, so the content maps to a single id.
+  id_by_content_[std::move(content)] = id;
+}
+
+void H26xParameterSetCache::Clear() {
+  id_by_content_.clear();
+  content_by_id_.clear();
+}
+
+}  // namespace media
+}  // namespace shaka
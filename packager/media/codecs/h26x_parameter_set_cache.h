@@ -0,0 +1,53 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_CODECS_H26X_PARAMETER_SET_CACHE_H_
+#define PACKAGER_MEDIA_CODECS_H26X_PARAMETER_SET_CACHE_H_
+
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace shaka {
+namespace media {
+
+class Nalu;
+
+/// Remembers the content of the H.264 / H.265 parameter set NAL units stored
+/// by a parser, by id, so the ones repeated in-band, e.g. before every key
+/// frame, are not parsed again.
+class H26xParameterSetCache {
+ public:
+  H26xParameterSetCache();
+  ~H26xParameterSetCache();
+
+  /// Find the parameter set stored with the same content as @a nalu.
+  /// @param[out] id is set to the id of the parameter set, if found.
+  /// @return true if found.
+  bool Find(const Nalu& nalu, int* id) const;
+
+  /// Record that @a nalu has been parsed and stored as the parameter set
+  /// @a id, replacing the previous parameter set with the same id, if any.
+  void Insert(const Nalu& nalu, int id);
+
+  /// Forget all the parameter sets, e.g. when the parameter sets they depend
+  /// on change.
+  void Clear();
+
+ private:
+  H26xParameterSetCache(const H26xParameterSetCache&) = delete;
+  H26xParameterSetCache& operator=(const H26xParameterSetCache&) = delete;
+
+  // Content -> id, hashed.
+  std::unordered_map<std::string, int> id_by_content_;
+  // Id -> content, to drop the content replaced.
+  std::map<int, std::string> content_by_id_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_CODECS_H26X_PARAMETER_SET_CACHE_H_
@@ -0,0 +1,70 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/codecs/h26x_parameter_set_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/macros.h"
+#include "packager/media/codecs/nalu_reader.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint8_t kPps1[] = {0x68, 0xEB, 0xCC, 0xB2, 0x2C};
+const uint8_t kPps2[] = {0x68, 0xCE, 0x3C, 0x80};
+const uint8_t kPps3[] = {0x68, 0xCE, 0x38, 0x80};
+
+}  // namespace
+
+class H26xParameterSetCacheTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_TRUE(nalu1_.Initialize(Nalu::kH264, kPps1, arraysize(kPps1)));
+    ASSERT_TRUE(nalu2_.Initialize(Nalu::kH264, kPps2, arraysize(kPps2)));
+    ASSERT_TRUE(nalu3_.Initialize(Nalu::kH264, kPps3, arraysize(kPps3)));
+  }
+
+ protected:
+  H26xParameterSetCache cache_;
+  Nalu nalu1_;
+  Nalu nalu2_;
+  Nalu nalu3_;
+};
+
+TEST_F(H26xParameterSetCacheTest, FindInserted) {
+  int id = -1;
+  EXPECT_FALSE(cache_.Find(nalu1_, &id));
+  cache_.Insert(nalu1_, 0);
+  cache_.Insert(nalu2_, 1);
+  ASSERT_TRUE(cache_.Find(nalu1_, &id));
+  EXPECT_EQ(0, id);
+  ASSERT_TRUE(cache_.Find(nalu2_, &id));
+  EXPECT_EQ(1, id);
+  EXPECT_FALSE(cache_.Find(nalu3_, &id));
+}
+
+TEST_F(H26xParameterSetCacheTest, ReplacedById) {
+  cache_.Insert(nalu1_, 0);
+  cache_.Insert(nalu2_, 0);
+  int id = -1;
+  EXPECT_FALSE(cache_.Find(nalu1_, &id));
+  ASSERT_TRUE(cache_.Find(nalu2_, &id));
+  EXPECT_EQ(0, id);
+}
+
+TEST_F(H26xParameterSetCacheTest, Clear) {
+  cache_.Insert(nalu1_, 0);
+  cache_.Clear();
+  int id = -1;
+  EXPECT_FALSE(cache_.Find(nalu1_, &id));
+  cache_.Insert(nalu1_, 0);
+  EXPECT_TRUE(cache_.Find(nalu1_, &id));
+}
+
+}  // namespace media
+}  // namespace shaka
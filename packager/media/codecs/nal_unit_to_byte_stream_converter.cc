@@ -13,6 +13,7 @@
 #include "packager/media/base/buffer_reader.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/macros.h"
+#include "packager/media/codecs/h26x_byte_scanner.h"
 #include "packager/media/codecs/nalu_reader.h"
 
 namespace shaka {
@@ -50,6 +51,21 @@ void AppendNalu(const Nalu& nalu,
   }
 }
 
+// Adds the bytes appended to |inserted_data| since it was |old_size| bytes to
+// |spans|, as a null span.
+void AddInsertedSpan(size_t old_size,
+                     const BufferWriter& inserted_data,
+                     std::vector<DataSpan>* spans) {
+  const size_t size = inserted_data.Size() - old_size;
+  if (size == 0)
+    return;
+  if (!spans->empty() && !spans->back().data) {
+    spans->back().size += size;
+    return;
+  }
+  spans->push_back({nullptr, size});
+}
+
 void AddAccessUnitDelimiter(BufferWriter* buffer_writer) {
   buffer_writer->AppendInt(static_cast<uint8_t>(Nalu::H264_AUD));
   // For now, primary_pic_type is 7 which is "anything".
@@ -61,38 +77,29 @@ void AddAccessUnitDelimiter(BufferWriter* buffer_writer) {
 void EscapeNalByteSequence(const uint8_t* input,
                            size_t input_size,
                            BufferWriter* output_writer) {
-  // Keep track of consecutive zeros that it has seen (not including the current
-  // byte), so that the algorithm doesn't need to go back to check the same
-  // bytes.
-  int consecutive_zero_count = 0;
-  for (size_t i = 0; i < input_size; ++i) {
-    if (consecutive_zero_count <= 1) {
-      output_writer->AppendInt(input[i]);
-    } else if (consecutive_zero_count == 2) {
-      if (input[i] == 0 || input[i] == 1 || input[i] == 2 || input[i] == 3) {
-        // Must be escaped.
-        output_writer->AppendInt(kEmulationPreventionByte);
-      }
-
-      output_writer->AppendInt(input[i]);
-      // Note that input[i] can be 0.
-      // 00 00 00 00 00 00 should become
-      // 00 00 03 00 00 03 00 00 03
-      // So consecutive_zero_count is reset here and incremented below if
-      // input[i] is 0.
-      consecutive_zero_count = 0;
+  // Copy the bytes between the sequences that must be escaped in bulk. The
+  // search restarts at the byte following the two zeros of an escaped
+  // sequence, as that byte can be the first zero of the next sequence, e.g.
+  // 00 00 00 00 00 00 should become
+  // 00 00 03 00 00 03 00 00 03
+  size_t pos = 0;
+  while (pos < input_size) {
+    const size_t escape_pos =
+        pos + FindEscapeSequence(input + pos, input_size - pos);
+    if (escape_pos == input_size) {
+      output_writer->AppendArray(input + pos, input_size - pos);
+      break;
     }
-
-    consecutive_zero_count = input[i] == 0 ? consecutive_zero_count + 1 : 0;
+    // Must be escaped.
+    output_writer->AppendArray(input + pos, escape_pos + 2 - pos);
+    output_writer->AppendInt(kEmulationPreventionByte);
+    pos = escape_pos + 2;
   }
 
   // ISO 14496-10 Section 7.4.1.1 mentions that if the last byte is 0 (which
   // only happens if RBSP has cabac_zero_word), 0x03 must be appended.
-  if (consecutive_zero_count > 0) {
-    DCHECK_GT(input_size, 0u);
-    DCHECK_EQ(input[input_size - 1], 0u);
+  if (input_size > 0 && input[input_size - 1] == 0)
     output_writer->AppendInt(kEmulationPreventionByte);
-  }
 }
 
 // This functions creates a new subsample entry (|clear_bytes|, |cipher_bytes|)
@@ -266,15 +273,45 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStream(
       nullptr);  // Skip subsample update.
 }
 
+bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
+    const uint8_t* sample,
+    size_t sample_size,
+    bool is_key_frame,
+    bool escape_encrypted_nalu,
+    std::vector<uint8_t>* output,
+    std::vector<SubsampleEntry>* subsamples) {
+  std::vector<uint8_t> inserted_data;
+  std::vector<DataSpan> spans;
+  if (!ConvertUnitToByteStreamSpans(sample, sample_size, is_key_frame,
+                                    escape_encrypted_nalu, &inserted_data,
+                                    &spans, subsamples)) {
+    return false;
+  }
+
+  BufferWriter buffer_writer(sample_size + inserted_data.size());
+  const uint8_t* next_inserted_byte = inserted_data.data();
+  for (const DataSpan& span : spans) {
+    if (span.data) {
+      buffer_writer.AppendArray(span.data, span.size);
+    } else {
+      buffer_writer.AppendArray(next_inserted_byte, span.size);
+      next_inserted_byte += span.size;
+    }
+  }
+  buffer_writer.SwapBuffer(output);
+  return true;
+}
+
 // This ignores all AUD, SPS, and PPS in the sample. Instead uses the data
 // parsed in Initialize(). However, if the SPS and PPS are different to
 // those parsed in Initialized(), they are kept.
-bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
+bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamSpans(
     const uint8_t* sample,
     size_t sample_size,
     bool is_key_frame,
     bool escape_encrypted_nalu,
-    std::vector<uint8_t>* output,
+    std::vector<uint8_t>* inserted_data,
+    std::vector<DataSpan>* spans,
     std::vector<SubsampleEntry>* subsamples) {
   if (!sample || sample_size == 0) {
     LOG(WARNING) << "Sample is empty.";
@@ -282,12 +319,15 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
   }
 
   std::vector<SubsampleEntry> temp_subsamples;
+  std::vector<DataSpan> temp_spans;
 
-  BufferWriter buffer_writer(sample_size);
+  // Only the bytes that are not in |sample| are written to |buffer_writer|.
+  BufferWriter buffer_writer;
   buffer_writer.AppendArray(kNaluStartCode, arraysize(kNaluStartCode));
   AddAccessUnitDelimiter(&buffer_writer);
   if (is_key_frame)
     buffer_writer.AppendVector(decoder_configuration_in_byte_stream_);
+  AddInsertedSpan(0, buffer_writer, &temp_spans);
 
   if (subsamples && !subsamples->empty()) {
     // The inserted part in buffer_writer is all clear. Add a corresponding
@@ -351,8 +391,16 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
             }
           }
         }
+        const size_t old_inserted_size = buffer_writer.Size();
         buffer_writer.AppendArray(kNaluStartCode, arraysize(kNaluStartCode));
-        AppendNalu(nalu, nalu_length_size_, escape_data, &buffer_writer);
+        if (escape_data) {
+          AppendNalu(nalu, nalu_length_size_, escape_data, &buffer_writer);
+          AddInsertedSpan(old_inserted_size, buffer_writer, &temp_spans);
+        } else {
+          AddInsertedSpan(old_inserted_size, buffer_writer, &temp_spans);
+          temp_spans.push_back(
+              {nalu.data(), nalu.header_size() + nalu.payload_size()});
+        }
 
         if (subsamples && !subsamples->empty()) {
           temp_subsamples.emplace_back(
@@ -393,7 +441,8 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
     return false;
   }
 
-  buffer_writer.SwapBuffer(output);
+  buffer_writer.SwapBuffer(inserted_data);
+  spans->swap(temp_spans);
   if (subsamples && !subsamples->empty()) {
     if (next_subsample_id < subsamples->size()) {
       LOG(ERROR)
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "packager/base/macros.h"
+#include "packager/media/base/data_span.h"
 #include "packager/media/base/decrypt_config.h"
 #include "packager/media/codecs/avc_decoder_configuration_record.h"
 
@@ -80,6 +81,24 @@ class NalUnitToByteStreamConverter {
       std::vector<uint8_t>* output,
       std::vector<SubsampleEntry>* subsamples);
 
+  /// Same as ConvertUnitToByteStreamWithSubsamples(), but without copying the
+  /// NAL units that go to the byte stream unchanged. The byte stream is the
+  /// concatenation of @a spans, which point into @a sample, or, for the null
+  /// spans, into @a inserted_data: the start codes, the parameter sets from
+  /// the decoder configuration and the escaped NAL units.
+  /// @param[out] inserted_data is set to the bytes of the null spans, in
+  ///             order, on success.
+  /// @param[out] spans is set to the spans of the byte stream, on success.
+  ///             They are valid for as long as @a sample is.
+  virtual bool ConvertUnitToByteStreamSpans(
+      const uint8_t* sample,
+      size_t sample_size,
+      bool is_key_frame,
+      bool escape_encrypted_nalu,
+      std::vector<uint8_t>* inserted_data,
+      std::vector<DataSpan>* spans,
+      std::vector<SubsampleEntry>* subsamples);
+
  private:
   friend class NalUnitToByteStreamConverterTest;
 
@@ -302,6 +302,50 @@ TEST(NalUnitToByteStreamConverterTest, NonKeyFrameSample) {
             output);
 }
 
+// The NAL units that are not escaped are not copied.
+TEST(NalUnitToByteStreamConverterTest, ConvertUnitToByteStreamSpans) {
+  const uint8_t kNonKeyFrameStream[] = {
+      0x00, 0x00, 0x00, 0x03,  // Size 3 NALU.
+      0x06,                    // NAL unit type.
+      0x33, 0x88,
+      0x00, 0x00, 0x00, 0x02,  // Size 2 NALU.
+      0x01,                    // NAL unit type.
+      0x44,
+  };
+  NalUnitToByteStreamConverter converter;
+  EXPECT_TRUE(
+      converter.Initialize(kTestAVCDecoderConfigurationRecord,
+                           arraysize(kTestAVCDecoderConfigurationRecord)));
+
+  std::vector<uint8_t> inserted_data;
+  std::vector<DataSpan> spans;
+  EXPECT_TRUE(converter.ConvertUnitToByteStreamSpans(
+      kNonKeyFrameStream, arraysize(kNonKeyFrameStream), !kIsKeyFrame,
+      kEscapeEncryptedNalu, &inserted_data, &spans, nullptr));
+
+  const uint8_t kExpectedInsertedData[] = {
+      0x00, 0x00, 0x00, 0x01,  // Start code.
+      0x09,                    // AUD type.
+      0xF0,                    // Anything.
+      0x00, 0x00, 0x00, 0x01,  // Start code.
+      0x00, 0x00, 0x00, 0x01,  // Start code.
+  };
+  EXPECT_EQ(std::vector<uint8_t>(
+                kExpectedInsertedData,
+                kExpectedInsertedData + arraysize(kExpectedInsertedData)),
+            inserted_data);
+
+  ASSERT_EQ(4u, spans.size());
+  EXPECT_EQ(nullptr, spans[0].data);
+  EXPECT_EQ(10u, spans[0].size);
+  EXPECT_EQ(kNonKeyFrameStream + 4, spans[1].data);
+  EXPECT_EQ(3u, spans[1].size);
+  EXPECT_EQ(nullptr, spans[2].data);
+  EXPECT_EQ(4u, spans[2].size);
+  EXPECT_EQ(kNonKeyFrameStream + 11, spans[3].data);
+  EXPECT_EQ(2u, spans[3].size);
+}
+
 // Bug found during unit testing.
 // The zeros aren't contiguous but the escape byte was inserted.
 TEST(NalUnitToByteStreamConverterTest, DispersedZeros) {
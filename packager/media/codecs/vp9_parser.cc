@@ -457,6 +457,7 @@ bool VP9Parser::Parse(const uint8_t* data,
                       std::vector<VPxFrameInfo>* vpx_frames) {
   DCHECK(data);
   DCHECK(vpx_frames);
+  RCHECK(data_size > 0);
   RCHECK(ParseIfSuperframeIndex(data, data_size, vpx_frames));
 
   for (auto& vpx_frame : *vpx_frames) {
@@ -60,6 +60,13 @@ TEST(VP9ParserTest, Superframe) {
   ASSERT_FALSE(parser.Parse(data, arraysize(data), &frames));
 }
 
+TEST(VP9ParserTest, EmptySample) {
+  const uint8_t kData[] = {0x00};
+  VP9Parser parser;
+  std::vector<VPxFrameInfo> frames;
+  EXPECT_FALSE(parser.Parse(kData, 0, &frames));
+}
+
 TEST(VP9ParserTest, KeyframeChroma420) {
   const uint8_t kData[] = {
       0x82, 0x49, 0x83, 0x42, 0x00, 0x01, 0xf0, 0x00, 0x74, 0x04, 0x38, 0x24,
@@ -10,7 +10,12 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <deque>
+#include <map>
 
+#include "packager/base/bind.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/common_pssh_generator.h"
@@ -19,10 +24,13 @@
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/playready_pssh_generator.h"
 #include "packager/media/base/protection_system_ids.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/base/widevine_pssh_generator.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/media/crypto/aes_encryptor_factory.h"
 #include "packager/media/crypto/subsample_generator.h"
+#include "packager/metrics/trace_event.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -31,6 +39,9 @@ namespace media {
 namespace {
 // The encryption handler only supports a single output.
 const size_t kStreamIndex = 0;
+// The default number of (sub)segments being encrypted in parallel before the
+// oldest one is waited for and dispatched.
+const size_t kDefaultMaxSegmentRangesInFlight = 2;
 
 // The default KID, KEY and IV for key rotation are all 0s.
 // They are placeholders and are not really being used to encrypt data.
@@ -112,52 +123,183 @@ void FillPsshGenerators(
   }
 }
 
-void AddProtectionSystemIfNotExist(
-    const ProtectionSystemSpecificInfo& pssh_info,
-    EncryptionConfig* encryption_config) {
-  for (const auto& info : encryption_config->key_system_info) {
-    if (info.system_id == pssh_info.system_id)
+// Caches the generated protection system info, so the streams encrypted with
+// the same keys, e.g. the renditions sharing a crypto period with key
+// rotation, generate the PSSH boxes once.
+class ProtectionSystemInfoCache {
+ public:
+  static ProtectionSystemInfoCache* Instance() {
+    static ProtectionSystemInfoCache instance;
+    return &instance;
+  }
+
+  bool Get(const std::string& cache_key,
+           std::vector<ProtectionSystemSpecificInfo>* infos) {
+    base::AutoLock scoped_lock(lock_);
+    auto iter = entries_.find(cache_key);
+    if (iter == entries_.end())
+      return false;
+    *infos = iter->second;
+    return true;
+  }
+
+  void Put(const std::string& cache_key,
+           const std::vector<ProtectionSystemSpecificInfo>& infos) {
+    base::AutoLock scoped_lock(lock_);
+    if (!entries_.emplace(cache_key, infos).second)
       return;
+    insertion_order_.push_back(cache_key);
+    // Only the recent crypto periods are needed.
+    if (insertion_order_.size() > kMaxEntries) {
+      entries_.erase(insertion_order_.front());
+      insertion_order_.pop_front();
+    }
   }
-  encryption_config->key_system_info.push_back(pssh_info);
+
+ private:
+  static const size_t kMaxEntries = 64;
+
+  ProtectionSystemInfoCache() = default;
+
+  base::Lock lock_;
+  std::map<std::string, std::vector<ProtectionSystemSpecificInfo>> entries_;
+  std::deque<std::string> insertion_order_;
+};
+
+void AppendToCacheKey(const std::vector<uint8_t>& data,
+                      std::string* cache_key) {
+  cache_key->append(std::to_string(data.size()));
+  cache_key->push_back(':');
+  cache_key->append(data.begin(), data.end());
 }
 
-Status FillProtectionSystemInfo(const EncryptionParams& encryption_params,
-                                const EncryptionKey& encryption_key,
-                                EncryptionConfig* encryption_config) {
-  // If generating dummy keys for key rotation, don't generate PSSH info.
-  if (encryption_key.key_ids.empty())
+// Returns a key identifying the protection system info generated for
+// |encryption_key| with |encryption_params|.
+std::string GetProtectionSystemInfoCacheKey(
+    const EncryptionParams& encryption_params,
+    const EncryptionKey& encryption_key) {
+  std::string cache_key = base::StringPrintf(
+      "%u:%u:%d:", static_cast<uint32_t>(encryption_params.protection_systems),
+      encryption_params.protection_scheme,
+      encryption_params.key_provider == KeyProvider::kRawKey &&
+          !encryption_params.raw_key.pssh.empty());
+  cache_key.append(encryption_params.playready_extra_header_data);
+  cache_key.push_back(':');
+  for (const std::vector<uint8_t>& key_id : encryption_key.key_ids)
+    AppendToCacheKey(key_id, &cache_key);
+  // Used by the generators which do not support multiple keys.
+  AppendToCacheKey(encryption_key.key_id, &cache_key);
+  AppendToCacheKey(encryption_key.key, &cache_key);
+  return cache_key;
+}
+
+// Generates the protection system info for |encryption_key|, including the
+// systems without a PSSH. The result is cached.
+Status GenerateProtectionSystemInfo(
+    const EncryptionParams& encryption_params,
+    const EncryptionKey& encryption_key,
+    std::vector<ProtectionSystemSpecificInfo>* infos) {
+  const std::string cache_key =
+      GetProtectionSystemInfoCacheKey(encryption_params, encryption_key);
+  if (ProtectionSystemInfoCache::Instance()->Get(cache_key, infos))
     return Status::OK;
 
   std::vector<std::unique_ptr<PsshGenerator>> pssh_generators;
   std::vector<std::vector<uint8_t>> no_pssh_systems;
   FillPsshGenerators(encryption_params, &pssh_generators, &no_pssh_systems);
 
-  encryption_config->key_system_info = encryption_key.key_system_info;
   for (const auto& pssh_generator : pssh_generators) {
     const bool support_multiple_keys = pssh_generator->SupportMultipleKeys();
+    ProtectionSystemSpecificInfo info;
     if (support_multiple_keys) {
-      ProtectionSystemSpecificInfo info;
       RETURN_IF_ERROR(pssh_generator->GeneratePsshFromKeyIds(
           encryption_key.key_ids, &info));
-      AddProtectionSystemIfNotExist(info, encryption_config);
     } else {
-      ProtectionSystemSpecificInfo info;
       RETURN_IF_ERROR(pssh_generator->GeneratePsshFromKeyIdAndKey(
           encryption_key.key_id, encryption_key.key, &info));
-      AddProtectionSystemIfNotExist(info, encryption_config);
     }
+    infos->push_back(info);
   }
 
   for (const auto& no_pssh_system : no_pssh_systems) {
     ProtectionSystemSpecificInfo info;
     info.system_id = no_pssh_system;
-    AddProtectionSystemIfNotExist(info, encryption_config);
+    infos->push_back(info);
+  }
+
+  ProtectionSystemInfoCache::Instance()->Put(cache_key, *infos);
+  return Status::OK;
+}
+
+void AddProtectionSystemIfNotExist(
+    const ProtectionSystemSpecificInfo& pssh_info,
+    EncryptionConfig* encryption_config) {
+  for (const auto& info : encryption_config->key_system_info) {
+    if (info.system_id == pssh_info.system_id)
+      return;
   }
+  encryption_config->key_system_info.push_back(pssh_info);
+}
 
+Status FillProtectionSystemInfo(const EncryptionParams& encryption_params,
+                                const EncryptionKey& encryption_key,
+                                EncryptionConfig* encryption_config) {
+  // If generating dummy keys for key rotation, don't generate PSSH info.
+  if (encryption_key.key_ids.empty())
+    return Status::OK;
+
+  std::vector<ProtectionSystemSpecificInfo> infos;
+  RETURN_IF_ERROR(
+      GenerateProtectionSystemInfo(encryption_params, encryption_key, &infos));
+
+  encryption_config->key_system_info = encryption_key.key_system_info;
+  for (const auto& info : infos)
+    AddProtectionSystemIfNotExist(info, encryption_config);
   return Status::OK;
 }
 
+// Returns the number of bytes passed to the encryptor for the sample.
+size_t GetNumCryptBytes(const MediaSample& clear_sample,
+                        const std::vector<SubsampleEntry>& subsamples) {
+  if (subsamples.empty())
+    return clear_sample.data_size();
+  size_t num_crypt_bytes = 0;
+  for (const SubsampleEntry& subsample : subsamples)
+    num_crypt_bytes += subsample.cipher_bytes;
+  return num_crypt_bytes;
+}
+
+// Encrypts |clear_sample| with |encryptor| into |dest|, which should have at
+// least the size of the sample.
+bool EncryptSampleData(const MediaSample& clear_sample,
+                       const std::vector<SubsampleEntry>& subsamples,
+                       AesCryptor* encryptor,
+                       uint8_t* dest) {
+  DCHECK(encryptor);
+  DCHECK(dest);
+  return encryptor->CryptSubsamples(clear_sample.data(),
+                                    clear_sample.data_size(), subsamples, dest);
+}
+
+// Returns |*sample| as a mutable sample, taking it, if its data can be
+// encrypted in place, i.e. if neither the sample nor its data are shared and
+// it has |headroom| free bytes in front of its data. Returns null otherwise.
+// This saves copying the clear bytes, which are most of the bytes of the video
+// samples with the pattern encryption.
+std::shared_ptr<MediaSample> TakeSampleForInPlaceEncryption(
+    size_t headroom,
+    std::shared_ptr<const MediaSample>* sample) {
+  if (sample->use_count() != 1 || (*sample)->data_headroom() < headroom)
+    return nullptr;
+  // Nobody else sees the sample, so it can be modified.
+  std::shared_ptr<MediaSample> mutable_sample =
+      std::const_pointer_cast<MediaSample>(*sample);
+  if (!mutable_sample->writable_data())
+    return nullptr;
+  sample->reset();
+  return mutable_sample;
+}
+
 }  // namespace
 
 EncryptionHandler::EncryptionHandler(const EncryptionParams& encryption_params,
@@ -168,9 +310,16 @@ EncryptionHandler::EncryptionHandler(const EncryptionParams& encryption_params,
       key_source_(key_source),
       subsample_generator_(
           new SubsampleGenerator(encryption_params.vp9_subsample_encryption)),
-      encryptor_factory_(new AesEncryptorFactory) {}
-
-EncryptionHandler::~EncryptionHandler() = default;
+      encryptor_factory_(new AesEncryptorFactory),
+      max_segment_ranges_in_flight_(kDefaultMaxSegmentRangesInFlight) {}
+
+EncryptionHandler::~EncryptionHandler() {
+  // The tasks in flight refer to the segment ranges.
+  for (const auto& segment_range : segment_ranges_) {
+    if (segment_range->batch)
+      encryption_thread_pool_->Wait(segment_range->batch.get());
+  }
+}
 
 Status EncryptionHandler::InitializeInternal() {
   if (!encryption_params_.stream_label_func) {
@@ -184,6 +333,13 @@ Status EncryptionHandler::InitializeInternal() {
 }
 
 Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
+  // Samples waiting for parallel encryption go out before anything else, but
+  // segment infos, which follow them once encrypted.
+  if (stream_data->stream_data_type != StreamDataType::kMediaSample &&
+      stream_data->stream_data_type != StreamDataType::kSegmentInfo) {
+    RETURN_IF_ERROR(EncryptPendingSamples());
+  }
+
   switch (stream_data->stream_data_type) {
     case StreamDataType::kStreamInfo:
       return ProcessStreamInfo(*stream_data->stream_info);
@@ -203,6 +359,12 @@ Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
           remaining_clear_lead_ -= segment_info->duration;
       }
 
+      if (encryption_thread_pool_) {
+        PostSegmentRange(std::move(segment_info));
+        while (segment_ranges_.size() > max_segment_ranges_in_flight_)
+          RETURN_IF_ERROR(DispatchSegmentRange());
+        return Status::OK;
+      }
       return DispatchSegmentInfo(kStreamIndex, segment_info);
     }
     case StreamDataType::kMediaSample:
@@ -225,6 +387,7 @@ Status EncryptionHandler::ProcessStreamInfo(const StreamInfo& clear_info) {
   std::shared_ptr<StreamInfo> stream_info = clear_info.Clone();
   RETURN_IF_ERROR(
       subsample_generator_->Initialize(protection_scheme_, *stream_info));
+  subsample_generator_stateless_ = subsample_generator_->IsStateless();
 
   remaining_clear_lead_ =
       encryption_params_.clear_lead_in_seconds * stream_info->time_scale();
@@ -264,12 +427,17 @@ Status EncryptionHandler::ProcessStreamInfo(const StreamInfo& clear_info) {
 Status EncryptionHandler::ProcessMediaSample(
     std::shared_ptr<const MediaSample> clear_sample) {
   DCHECK(clear_sample);
+  SHAKA_TRACE_EVENT("encryption", "EncryptionHandler::ProcessMediaSample");
 
   // Process the frame even if the frame is not encrypted as the next
-  // (encrypted) frame may be dependent on this clear frame.
+  // (encrypted) frame may be dependent on this clear frame, unless the
+  // generator does not keep any state.
   std::vector<SubsampleEntry> subsamples;
-  RETURN_IF_ERROR(subsample_generator_->GenerateSubsamples(
-      clear_sample->data(), clear_sample->data_size(), &subsamples));
+  if (remaining_clear_lead_ <= 0 || !subsample_generator_stateless_) {
+    RETURN_IF_ERROR(subsample_generator_->GenerateSubsamples(
+        clear_sample->data(), clear_sample->data_size(),
+        clear_sample->video_slice_header_sizes(), &subsamples));
+  }
 
   // Need to setup the encryptor for new segments even if this segment does not
   // need to be encrypted, so we can signal encryption metadata earlier to
@@ -296,46 +464,58 @@ Status EncryptionHandler::ProcessMediaSample(
   // Since there is no encryption needed right now, send the clear copy
   // downstream so we can save the costs of copying it.
   if (remaining_clear_lead_ > 0) {
+    RETURN_IF_ERROR(EncryptPendingSamples());
     return DispatchMediaSample(kStreamIndex, std::move(clear_sample));
   }
 
-  std::shared_ptr<uint8_t> cipher_sample_data(
-      new uint8_t[clear_sample->data_size()], std::default_delete<uint8_t[]>());
+  // Finish initializing the sample before sending it downstream. We must
+  // wait until now to finish the initialization as we will lose access to
+  // |decrypt_config| once we set it.
+  std::unique_ptr<DecryptConfig> decrypt_config(
+      new DecryptConfig(key_id_, encryptor_->iv(), subsamples,
+                        protection_scheme_, crypt_byte_block_,
+                        skip_byte_block_));
+
+  if (encryption_thread_pool_) {
+    // The IV of every sample only depends on the sizes of the samples before
+    // it, so the samples can be encrypted later with separate cryptors.
+    PendingSample pending_sample;
+    pending_sample.cipher_sample =
+        TakeSampleForInPlaceEncryption(sample_headroom_, &clear_sample);
+    if (pending_sample.cipher_sample)
+      pending_sample.clear_sample = pending_sample.cipher_sample;
+    else
+      pending_sample.clear_sample = std::move(clear_sample);
+    pending_sample.subsamples = std::move(subsamples);
+    pending_sample.key = encryption_key_;
+    pending_sample.iv = encryptor_->iv();
+    pending_sample.decrypt_config = std::move(decrypt_config);
+    encryptor_->AdvanceIv(GetNumCryptBytes(*pending_sample.clear_sample,
+                                           pending_sample.subsamples));
+    pending_samples_.push_back(std::move(pending_sample));
+    return Status::OK;
+  }
 
-  const uint8_t* source = clear_sample->data();
-  uint8_t* dest = cipher_sample_data.get();
-  if (!subsamples.empty()) {
-    size_t total_size = 0;
-    for (const SubsampleEntry& subsample : subsamples) {
-      if (subsample.clear_bytes > 0) {
-        memcpy(dest, source, subsample.clear_bytes);
-        source += subsample.clear_bytes;
-        dest += subsample.clear_bytes;
-        total_size += subsample.clear_bytes;
-      }
-      if (subsample.cipher_bytes > 0) {
-        EncryptBytes(source, subsample.cipher_bytes, dest);
-        source += subsample.cipher_bytes;
-        dest += subsample.cipher_bytes;
-        total_size += subsample.cipher_bytes;
-      }
+  std::shared_ptr<MediaSample> cipher_sample =
+      TakeSampleForInPlaceEncryption(sample_headroom_, &clear_sample);
+  if (cipher_sample) {
+    if (!EncryptSampleData(*cipher_sample, subsamples, encryptor_.get(),
+                           cipher_sample->writable_data())) {
+      return Status(error::ENCRYPTION_FAILURE, "Failed to encrypt sample.");
     }
-    DCHECK_EQ(total_size, clear_sample->data_size());
   } else {
-    EncryptBytes(source, clear_sample->data_size(), dest);
-  }
-
-  std::shared_ptr<MediaSample> cipher_sample(clear_sample->Clone());
-  cipher_sample->TransferData(std::move(cipher_sample_data),
-                              clear_sample->data_size());
+    std::shared_ptr<uint8_t> cipher_sample_data = SampleBufferPool::Allocate(
+        sample_headroom_ + clear_sample->data_size());
+    if (!EncryptSampleData(*clear_sample, subsamples, encryptor_.get(),
+                           cipher_sample_data.get() + sample_headroom_)) {
+      return Status(error::ENCRYPTION_FAILURE, "Failed to encrypt sample.");
+    }
 
-  // Finish initializing the sample before sending it downstream. We must
-  // wait until now to finish the initialization as we will lose access to
-  // |decrypt_config| once we set it.
+    cipher_sample = clear_sample->Clone();
+    cipher_sample->TransferData(std::move(cipher_sample_data),
+                                sample_headroom_, clear_sample->data_size());
+  }
   cipher_sample->set_is_encrypted(true);
-  std::unique_ptr<DecryptConfig> decrypt_config(new DecryptConfig(
-      encryption_config_->key_id, encryptor_->iv(), subsamples,
-      protection_scheme_, crypt_byte_block_, skip_byte_block_));
   cipher_sample->set_decrypt_config(std::move(decrypt_config));
 
   encryptor_->UpdateIv();
@@ -343,6 +523,116 @@ Status EncryptionHandler::ProcessMediaSample(
   return DispatchMediaSample(kStreamIndex, std::move(cipher_sample));
 }
 
+void EncryptionHandler::PostSegmentRange(
+    std::shared_ptr<SegmentInfo> segment_info) {
+  std::unique_ptr<SegmentRange> segment_range(new SegmentRange);
+  segment_range->samples.swap(pending_samples_);
+  segment_range->segment_info = std::move(segment_info);
+
+  // Allocate the output buffers on this thread so they come from the buffer
+  // pool of the job.
+  std::vector<PendingSample>& samples = segment_range->samples;
+  for (PendingSample& pending_sample : samples) {
+    if (pending_sample.cipher_sample)
+      continue;
+    pending_sample.cipher_sample_data = SampleBufferPool::Allocate(
+        sample_headroom_ + pending_sample.clear_sample->data_size());
+  }
+
+  // Split the samples in contiguous ranges, a few per thread to balance the
+  // load as sample sizes vary a lot (e.g. key frames).
+  const size_t kRangesPerThread = 4;
+  const size_t num_ranges = std::min(
+      samples.size(), encryption_thread_pool_->num_threads() * kRangesPerThread);
+  std::vector<base::Closure> tasks;
+  for (size_t i = 0; i < num_ranges; ++i) {
+    const size_t begin = samples.size() * i / num_ranges;
+    const size_t end = samples.size() * (i + 1) / num_ranges;
+    tasks.push_back(base::Bind(&EncryptionHandler::EncryptSampleRange,
+                               base::Unretained(this),
+                               base::Unretained(segment_range.get()), begin,
+                               end));
+  }
+  if (!tasks.empty())
+    segment_range->batch = encryption_thread_pool_->PostTasks(tasks);
+  segment_ranges_.push_back(std::move(segment_range));
+}
+
+Status EncryptionHandler::DispatchSegmentRange() {
+  DCHECK(!segment_ranges_.empty());
+  std::unique_ptr<SegmentRange> segment_range =
+      std::move(segment_ranges_.front());
+  segment_ranges_.pop_front();
+  if (segment_range->batch)
+    encryption_thread_pool_->Wait(segment_range->batch.get());
+
+  for (PendingSample& pending_sample : segment_range->samples) {
+    if (pending_sample.encryption_failed)
+      return Status(error::ENCRYPTION_FAILURE, "Failed to encrypt sample.");
+
+    std::shared_ptr<MediaSample> cipher_sample =
+        std::move(pending_sample.cipher_sample);
+    if (!cipher_sample) {
+      const MediaSample& clear_sample = *pending_sample.clear_sample;
+      cipher_sample = clear_sample.Clone();
+      cipher_sample->TransferData(std::move(pending_sample.cipher_sample_data),
+                                  sample_headroom_, clear_sample.data_size());
+    }
+    pending_sample.clear_sample.reset();
+    cipher_sample->set_is_encrypted(true);
+    cipher_sample->set_decrypt_config(
+        std::move(pending_sample.decrypt_config));
+    RETURN_IF_ERROR(DispatchMediaSample(kStreamIndex, std::move(cipher_sample)));
+  }
+  if (segment_range->segment_info) {
+    return DispatchSegmentInfo(kStreamIndex,
+                               std::move(segment_range->segment_info));
+  }
+  return Status::OK;
+}
+
+Status EncryptionHandler::EncryptPendingSamples() {
+  if (!pending_samples_.empty())
+    PostSegmentRange(nullptr);
+  while (!segment_ranges_.empty())
+    RETURN_IF_ERROR(DispatchSegmentRange());
+  return Status::OK;
+}
+
+void EncryptionHandler::EncryptSampleRange(SegmentRange* segment_range,
+                                           size_t begin,
+                                           size_t end) {
+  std::unique_ptr<AesCryptor> encryptor;
+  const std::vector<uint8_t>* encryptor_key = nullptr;
+  for (size_t i = begin; i < end; ++i) {
+    PendingSample& pending_sample = segment_range->samples[i];
+    // Samples in a range share the key unless key rotation kicks in.
+    if (!encryptor || *encryptor_key != pending_sample.key) {
+      encryptor = encryptor_factory_->CreateEncryptor(
+          protection_scheme_, crypt_byte_block_, skip_byte_block_, codec_,
+          pending_sample.key, pending_sample.iv);
+      encryptor_key = &pending_sample.key;
+    } else if (!encryptor->SetIv(pending_sample.iv)) {
+      encryptor.reset();
+    }
+    uint8_t* dest = pending_sample.cipher_sample
+                        ? pending_sample.cipher_sample->writable_data()
+                        : pending_sample.cipher_sample_data.get() +
+                              sample_headroom_;
+    if (!encryptor ||
+        !EncryptSampleData(*pending_sample.clear_sample,
+                           pending_sample.subsamples, encryptor.get(), dest)) {
+      // Signals the failure to DispatchSegmentRange().
+      pending_sample.encryption_failed = true;
+    }
+  }
+}
+
+Status EncryptionHandler::OnFlushRequest(size_t input_stream_index) {
+  RETURN_IF_ERROR(EncryptPendingSamples());
+  return MediaHandler::OnFlushRequest(input_stream_index);
+}
+
 void EncryptionHandler::SetupProtectionPattern(StreamType stream_type) {
   if (stream_type == kStreamVideo &&
       IsPatternEncryptionScheme(protection_scheme_)) {
@@ -364,6 +654,7 @@ bool EncryptionHandler::CreateEncryptor(const EncryptionKey& encryption_key) {
   if (!encryptor)
     return false;
   encryptor_ = std::move(encryptor);
+  encryption_key_ = encryption_key.key;
 
   encryption_config_.reset(new EncryptionConfig);
   encryption_config_->protection_scheme = protection_scheme_;
@@ -379,20 +670,12 @@ bool EncryptionHandler::CreateEncryptor(const EncryptionKey& encryption_key) {
   }
 
   encryption_config_->key_id = encryption_key.key_id;
+  key_id_ = std::make_shared<const std::vector<uint8_t>>(encryption_key.key_id);
   const auto status = FillProtectionSystemInfo(
       encryption_params_, encryption_key, encryption_config_.get());
   return status.ok();
 }
 
-void EncryptionHandler::EncryptBytes(const uint8_t* source,
-                                     size_t source_size,
-                                     uint8_t* dest) {
-  DCHECK(source);
-  DCHECK(dest);
-  DCHECK(encryptor_);
-  CHECK(encryptor_->Crypt(source, source_size, dest));
-}
-
 void EncryptionHandler::InjectSubsampleGeneratorForTesting(
     std::unique_ptr<SubsampleGenerator> generator) {
   subsample_generator_ = std::move(generator);
@@ -7,8 +7,13 @@
 #ifndef PACKAGER_MEDIA_CRYPTO_ENCRYPTION_HANDLER_H_
 #define PACKAGER_MEDIA_CRYPTO_ENCRYPTION_HANDLER_H_
 
+#include <deque>
+#include <vector>
+
+#include "packager/media/base/decrypt_config.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_handler.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/media/public/crypto_params.h"
 
 namespace shaka {
@@ -26,11 +31,39 @@ class EncryptionHandler : public MediaHandler {
 
   ~EncryptionHandler() override;
 
+  /// Encrypt the samples of a (sub)segment in parallel on @a thread_pool
+  /// instead of one by one on the calling thread. The samples are dispatched
+  /// in order once the (sub)segment is complete. A few (sub)segments are
+  /// encrypted at the same time, so the encryption of a (sub)segment overlaps
+  /// with the processing of the next ones.
+  /// @param thread_pool is the pool to run the encryption on. It can be NULL,
+  ///        which disables parallel encryption. It must outlive the handler.
+  void set_encryption_thread_pool(WorkStealingThreadPool* thread_pool) {
+    encryption_thread_pool_ = thread_pool;
+  }
+
+  /// Set the number of (sub)segments still being encrypted in parallel when a
+  /// (sub)segment ends. Only applies with an encryption thread pool. The
+  /// oldest (sub)segment is dispatched once this many (sub)segments follow it,
+  /// which delays it by as many (sub)segment durations. Defaults to 2.
+  /// @param max_segments is the number of (sub)segments. 0 dispatches every
+  ///        (sub)segment as soon as it is encrypted, e.g. for live outputs.
+  void set_max_segment_ranges_in_flight(size_t max_segments) {
+    max_segment_ranges_in_flight_ = max_segments;
+  }
+
+  /// Reserve free bytes in front of the data of the encrypted samples, so the
+  /// muxer can insert a per sample header without copying the samples, e.g.
+  /// the signal byte and IV of the encrypted WebM frames.
+  /// @param headroom is the number of bytes to reserve.
+  void set_sample_headroom(size_t headroom) { sample_headroom_ = headroom; }
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
   Status InitializeInternal() override;
   Status Process(std::unique_ptr<StreamData> stream_data) override;
+  Status OnFlushRequest(size_t input_stream_index) override;
   /// @}
 
  private:
@@ -43,6 +76,15 @@ class EncryptionHandler : public MediaHandler {
   Status ProcessStreamInfo(const StreamInfo& stream_info);
   // Processes media sample and encrypts it if needed.
   Status ProcessMediaSample(std::shared_ptr<const MediaSample> clear_sample);
+  // Starts encrypting |pending_samples_| on |encryption_thread_pool_|, as a
+  // segment range to dispatch with |segment_info|, which can be NULL, once
+  // encrypted.
+  void PostSegmentRange(std::shared_ptr<SegmentInfo> segment_info);
+  // Waits for the oldest segment range in flight and dispatches it.
+  Status DispatchSegmentRange();
+  // Encrypts |pending_samples_| and dispatches them, after the segment ranges
+  // in flight.
+  Status EncryptPendingSamples();
 
   void SetupProtectionPattern(StreamType stream_type);
   bool CreateEncryptor(const EncryptionKey& encryption_key);
@@ -51,10 +93,6 @@ class EncryptionHandler : public MediaHandler {
   bool SampleAesEncryptEac3Frame(const uint8_t* source,
                                  size_t source_size,
                                  uint8_t* dest);
-  // Encrypt an array with size |source_size|. |dest| should have at
-  // least |source_size| bytes.
-  void EncryptBytes(const uint8_t* source, size_t source_size, uint8_t* dest);
-
   // An E-AC3 frame comprises of one or more syncframes. This function extracts
   // the syncframe sizes from the source bytes.
   // Returns false if the frame is not well formed.
@@ -75,6 +113,11 @@ class EncryptionHandler : public MediaHandler {
   // Current encryption config and encryptor.
   std::shared_ptr<EncryptionConfig> encryption_config_;
   std::unique_ptr<AesCryptor> encryptor_;
+  // The key of |encryptor_|.
+  std::vector<uint8_t> encryption_key_;
+  // The key id of |encryption_config_|, shared by the decrypt configs of the
+  // samples.
+  std::shared_ptr<const std::vector<uint8_t>> key_id_;
   Codec codec_ = kUnknownCodec;
   // Remaining clear lead in the stream's time scale.
   int64_t remaining_clear_lead_ = 0;
@@ -85,11 +128,49 @@ class EncryptionHandler : public MediaHandler {
   bool check_new_crypto_period_ = false;
 
   std::unique_ptr<SubsampleGenerator> subsample_generator_;
+  // Whether |subsample_generator_| keeps no state across samples, so the
+  // samples in the clear lead are not parsed. Resolved once per stream.
+  bool subsample_generator_stateless_ = true;
   std::unique_ptr<AesEncryptorFactory> encryptor_factory_;
   // Number of encrypted blocks (16-byte-block) in pattern based encryption.
   uint8_t crypt_byte_block_ = 0;
   /// Number of unencrypted blocks (16-byte-block) in pattern based encryption.
   uint8_t skip_byte_block_ = 0;
+
+  // A sample waiting to be encrypted in parallel, with everything needed to
+  // encrypt it independently of the samples before it.
+  struct PendingSample {
+    std::shared_ptr<const MediaSample> clear_sample;
+    std::vector<SubsampleEntry> subsamples;
+    std::vector<uint8_t> key;
+    std::vector<uint8_t> iv;
+    std::unique_ptr<DecryptConfig> decrypt_config;
+    // Set if |clear_sample| is encrypted in place, in which case it is
+    // |cipher_sample| and |cipher_sample_data| is not used.
+    std::shared_ptr<MediaSample> cipher_sample;
+    // Output of the encryption. Reset if the encryption failed.
+    std::shared_ptr<uint8_t> cipher_sample_data;
+    bool encryption_failed = false;
+  };
+  // The samples of a (sub)segment, and the segment info which follows them,
+  // being encrypted on |encryption_thread_pool_|.
+  struct SegmentRange {
+    std::vector<PendingSample> samples;
+    std::shared_ptr<SegmentInfo> segment_info;
+    std::shared_ptr<WorkStealingThreadPool::TaskBatch> batch;
+  };
+  // Encrypts the samples of |segment_range| in [begin, end). Runs on a worker
+  // thread.
+  void EncryptSampleRange(SegmentRange* segment_range,
+                          size_t begin,
+                          size_t end);
+
+  WorkStealingThreadPool* encryption_thread_pool_ = nullptr;
+  size_t max_segment_ranges_in_flight_;
+  size_t sample_headroom_ = 0;
+  std::vector<PendingSample> pending_samples_;
+  // Oldest first.
+  std::deque<std::unique_ptr<SegmentRange>> segment_ranges_;
 };
 
 }  // namespace media
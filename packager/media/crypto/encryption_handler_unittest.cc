@@ -14,8 +14,10 @@
 #include "packager/media/base/mock_aes_cryptor.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/media/base/raw_key_source.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/media/crypto/aes_encryptor_factory.h"
 #include "packager/media/crypto/subsample_generator.h"
+#include "packager/status_macros.h"
 #include "packager/status_test_util.h"
 
 namespace shaka {
@@ -77,9 +79,10 @@ class MockSubsampleGenerator : public SubsampleGenerator {
 
   MOCK_METHOD2(Initialize,
                Status(FourCC protection_scheme, const StreamInfo& stream_info));
-  MOCK_METHOD3(GenerateSubsamples,
+  MOCK_METHOD4(GenerateSubsamples,
                Status(const uint8_t* frame,
                       size_t frame_size,
+                      const std::vector<size_t>& video_slice_header_sizes,
                       std::vector<SubsampleEntry>* subsamples));
 };
 
@@ -126,6 +129,8 @@ class EncryptionHandlerTest : public MediaHandlerGraphTestBase {
     return encryption_handler_->Process(std::move(stream_data));
   }
 
+  Status Flush() { return encryption_handler_->OnFlushRequest(kStreamIndex); }
+
   EncryptionKey GetMockEncryptionKey() {
     EncryptionKey encryption_key;
     encryption_key.key_id.assign(kKeyId, kKeyId + sizeof(kKeyId));
@@ -138,9 +143,9 @@ class EncryptionHandlerTest : public MediaHandlerGraphTestBase {
   void InjectSubsamples(const std::vector<SubsampleEntry>& subsamples) {
     std::unique_ptr<MockSubsampleGenerator> mock_generator(
         new MockSubsampleGenerator);
-    EXPECT_CALL(*mock_generator, GenerateSubsamples(_, _, _))
+    EXPECT_CALL(*mock_generator, GenerateSubsamples(_, _, _, _))
         .WillRepeatedly(
-            DoAll(SetArgPointee<2>(subsamples), Return(Status::OK)));
+            DoAll(SetArgPointee<3>(subsamples), Return(Status::OK)));
 
     encryption_handler_->InjectSubsampleGeneratorForTesting(
         std::move(mock_generator));
@@ -559,6 +564,222 @@ TEST_P(EncryptionHandlerSubsampleTest, SubsampleTest) {
   EXPECT_EQ(GetParam().subsamples, decrypt_config.subsamples());
 }
 
+TEST_F(EncryptionHandlerTest, EncryptsUnsharedSamplesInPlace) {
+  std::unique_ptr<MockAesCryptor> mock_encryptor(new MockAesCryptor);
+  EXPECT_CALL(*mock_encryptor, CryptInternal(_, _, _, _))
+      .WillRepeatedly(Invoke(MockEncrypt));
+  ASSERT_TRUE(mock_encryptor->SetIv(
+      std::vector<uint8_t>(std::begin(kIv), std::end(kIv))));
+  std::unique_ptr<MockAesEncryptorFactory> mock_encryptor_factory(
+      new MockAesEncryptorFactory);
+  EXPECT_CALL(*mock_encryptor_factory, CreateEncryptor(_, _, _, _, _, _))
+      .WillOnce(Return(ByMove(std::move(mock_encryptor))));
+  InjectEncryptorFactoryForTesting(std::move(mock_encryptor_factory));
+  InjectSubsamples({{6, 4}});
+
+  EXPECT_CALL(mock_key_source_, GetKey(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale, kCodecH264))));
+
+  // A sample still held upstream is left untouched.
+  std::shared_ptr<MediaSample> shared_sample =
+      GetMediaSample(0, kSampleDuration, kIsKeyFrame, kData, kDataSize);
+  ASSERT_OK(Process(StreamData::FromMediaSample(kStreamIndex, shared_sample)));
+  EXPECT_EQ(std::vector<uint8_t>(std::begin(kData), std::end(kData)),
+            std::vector<uint8_t>(
+                shared_sample->data(),
+                shared_sample->data() + shared_sample->data_size()));
+
+  std::shared_ptr<MediaSample> sample = GetMediaSample(
+      kSampleDuration, kSampleDuration, kIsKeyFrame, kData, kDataSize);
+  const uint8_t* sample_data = sample->data();
+  ASSERT_OK(
+      Process(StreamData::FromMediaSample(kStreamIndex, std::move(sample))));
+
+  const auto& output_stream_data = GetOutputStreamDataVector();
+  ASSERT_EQ(3u, output_stream_data.size());
+  const MediaSample& copied_sample = *output_stream_data[1]->media_sample;
+  const MediaSample& in_place_sample = *output_stream_data[2]->media_sample;
+  EXPECT_NE(shared_sample->data(), copied_sample.data());
+  EXPECT_EQ(sample_data, in_place_sample.data());
+  const std::vector<uint8_t> expected_output = {
+      0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x16, 0x17, 0x18, 0x19};
+  EXPECT_EQ(expected_output,
+            std::vector<uint8_t>(
+                copied_sample.data(),
+                copied_sample.data() + copied_sample.data_size()));
+  EXPECT_EQ(expected_output,
+            std::vector<uint8_t>(
+                in_place_sample.data(),
+                in_place_sample.data() + in_place_sample.data_size()));
+  EXPECT_TRUE(in_place_sample.is_encrypted());
+}
+
+class EncryptionHandlerThreadPoolTest
+    : public EncryptionHandlerTest,
+      public WithParamInterface<FourCC> {
+ public:
+  // Encrypts segments of samples of varying sizes and returns the output.
+  std::vector<std::shared_ptr<const MediaSample>> EncryptSegments(
+      WorkStealingThreadPool* thread_pool) {
+    EncryptionParams encryption_params;
+    encryption_params.protection_scheme = GetParam();
+    encryption_params.clear_lead_in_seconds = 0;
+    SetUpEncryptionHandler(encryption_params);
+    encryption_handler_->set_encryption_thread_pool(thread_pool);
+
+    EXPECT_CALL(mock_key_source_, GetKey(_, _))
+        .WillOnce(DoAll(SetArgPointee<1>(GetMockEncryptionKey()),
+                        Return(Status::OK)));
+    EXPECT_OK(Process(StreamData::FromStreamInfo(
+        kStreamIndex, GetVideoStreamInfo(kTimeScale, kCodecH264))));
+
+    // More segments than encrypted in parallel.
+    const int kNumSegments = 4;
+    const int kNumSamplesPerSegment = 20;
+    for (int i = 0; i < kNumSegments * kNumSamplesPerSegment; ++i) {
+      std::vector<uint8_t> data(100 + i % kNumSamplesPerSegment * 37);
+      for (size_t j = 0; j < data.size(); ++j)
+        data[j] = static_cast<uint8_t>(i + j);
+      EXPECT_OK(Process(StreamData::FromMediaSample(
+          kStreamIndex,
+          GetMediaSample(i * kSampleDuration, kSampleDuration, kIsKeyFrame,
+                         data.data(), data.size()))));
+      if ((i + 1) % kNumSamplesPerSegment == 0) {
+        const int64_t segment_duration =
+            kNumSamplesPerSegment * kSampleDuration;
+        EXPECT_OK(Process(StreamData::FromSegmentInfo(
+            kStreamIndex,
+            GetSegmentInfo((i + 1) * kSampleDuration - segment_duration,
+                           segment_duration, !kIsSubsegment))));
+      }
+    }
+    EXPECT_OK(Flush());
+
+    // Every segment info goes out after the samples of its segment.
+    std::vector<std::shared_ptr<const MediaSample>> samples;
+    for (const auto& stream_data : GetOutputStreamDataVector()) {
+      if (stream_data->media_sample) {
+        samples.push_back(stream_data->media_sample);
+      } else if (stream_data->segment_info) {
+        EXPECT_EQ(samples.back()->dts() + kSampleDuration,
+                  stream_data->segment_info->start_timestamp +
+                      stream_data->segment_info->duration);
+        EXPECT_EQ(0u, samples.size() % kNumSamplesPerSegment);
+      }
+    }
+    EXPECT_EQ(kNumSegments * kNumSamplesPerSegment,
+              static_cast<int>(samples.size()));
+    EXPECT_EQ(StreamDataType::kSegmentInfo,
+              GetOutputStreamDataVector().back()->stream_data_type);
+    ClearOutputStreamDataVector();
+    Mock::VerifyAndClearExpectations(&mock_key_source_);
+    return samples;
+  }
+};
+
+TEST_P(EncryptionHandlerThreadPoolTest, SameOutputAsSequentialEncryption) {
+  const size_t kNumThreads = 3;
+  const auto expected_samples = EncryptSegments(nullptr);
+  WorkStealingThreadPool thread_pool(kNumThreads);
+  const auto samples = EncryptSegments(&thread_pool);
+
+  ASSERT_EQ(expected_samples.size(), samples.size());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const MediaSample& expected_sample = *expected_samples[i];
+    const MediaSample& sample = *samples[i];
+    EXPECT_EQ(expected_sample.dts(), sample.dts());
+    EXPECT_TRUE(sample.is_encrypted());
+    EXPECT_EQ(std::vector<uint8_t>(
+                  expected_sample.data(),
+                  expected_sample.data() + expected_sample.data_size()),
+              std::vector<uint8_t>(sample.data(),
+                                   sample.data() + sample.data_size()));
+    EXPECT_EQ(expected_sample.decrypt_config()->iv(),
+              sample.decrypt_config()->iv());
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(ProtectionSchemes,
+                        EncryptionHandlerThreadPoolTest,
+                        Values(FOURCC_cenc,
+                               FOURCC_cens,
+                               FOURCC_cbc1,
+                               FOURCC_cbcs));
+
+class EncryptionHandlerSegmentsInFlightTest : public EncryptionHandlerTest {
+ public:
+  void SetUp() override {
+    EncryptionHandlerTest::SetUp();
+    EncryptionParams encryption_params;
+    encryption_params.clear_lead_in_seconds = 0;
+    SetUpEncryptionHandler(encryption_params);
+    encryption_handler_->set_encryption_thread_pool(&thread_pool_);
+
+    EXPECT_CALL(mock_key_source_, GetKey(_, _))
+        .WillOnce(DoAll(SetArgPointee<1>(GetMockEncryptionKey()),
+                        Return(Status::OK)));
+    ASSERT_OK(Process(StreamData::FromStreamInfo(
+        kStreamIndex, GetVideoStreamInfo(kTimeScale, kCodecH264))));
+  }
+
+  // Processes the samples of the |segment_index|-th segment and its segment
+  // info.
+  Status ProcessSegment(int segment_index) {
+    const std::vector<uint8_t> data(100, static_cast<uint8_t>(segment_index));
+    for (int i = 0; i < kNumSamplesPerSegment; ++i) {
+      const int64_t timestamp =
+          (segment_index * kNumSamplesPerSegment + i) * kSampleDuration;
+      RETURN_IF_ERROR(Process(StreamData::FromMediaSample(
+          kStreamIndex, GetMediaSample(timestamp, kSampleDuration, kIsKeyFrame,
+                                       data.data(), data.size()))));
+    }
+    const int64_t segment_duration = kNumSamplesPerSegment * kSampleDuration;
+    return Process(StreamData::FromSegmentInfo(
+        kStreamIndex, GetSegmentInfo(segment_index * segment_duration,
+                                     segment_duration, !kIsSubsegment)));
+  }
+
+  size_t NumOutputSegments() {
+    size_t num_segments = 0;
+    for (const auto& stream_data : GetOutputStreamDataVector()) {
+      if (stream_data->segment_info)
+        ++num_segments;
+    }
+    return num_segments;
+  }
+
+ protected:
+  const int kNumSamplesPerSegment = 5;
+  WorkStealingThreadPool thread_pool_{2};
+};
+
+TEST_F(EncryptionHandlerSegmentsInFlightTest, DelaysSegmentsByDefault) {
+  ASSERT_OK(ProcessSegment(0));
+  ASSERT_OK(ProcessSegment(1));
+  EXPECT_EQ(0u, NumOutputSegments());
+  // Dispatched once two segments follow it.
+  ASSERT_OK(ProcessSegment(2));
+  EXPECT_EQ(1u, NumOutputSegments());
+  ASSERT_OK(Flush());
+  EXPECT_EQ(3u, NumOutputSegments());
+}
+
+TEST_F(EncryptionHandlerSegmentsInFlightTest, DispatchesEverySegmentIfLive) {
+  encryption_handler_->set_max_segment_ranges_in_flight(0);
+  ASSERT_OK(ProcessSegment(0));
+  EXPECT_EQ(1u, NumOutputSegments());
+  ASSERT_OK(ProcessSegment(1));
+  EXPECT_EQ(2u, NumOutputSegments());
+  // The samples of every segment are out before its segment info.
+  const auto& output_stream_data = GetOutputStreamDataVector();
+  ASSERT_EQ(2u * (kNumSamplesPerSegment + 1), output_stream_data.size());
+  EXPECT_TRUE(output_stream_data[kNumSamplesPerSegment]->segment_info);
+  EXPECT_TRUE(output_stream_data.back()->segment_info);
+}
+
 class EncryptionHandlerTrackTypeTest : public EncryptionHandlerTest {};
 
 TEST_F(EncryptionHandlerTrackTypeTest, AudioTrackType) {
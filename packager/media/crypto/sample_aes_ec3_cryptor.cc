@@ -10,6 +10,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/decrypt_config.h"
 
 namespace shaka {
 namespace media {
@@ -90,21 +91,16 @@ bool SampleAesEc3Cryptor::CryptInternal(const uint8_t* text,
   // encrypted.
   const size_t kLeadingClearBytesSize = 16u;
 
+  // The residual block is left untouched (copied without
+  // encryption/decryption). No need to do special handling here.
+  std::vector<SubsampleEntry> subsamples;
+  subsamples.reserve(syncframe_sizes.size());
   for (size_t syncframe_size : syncframe_sizes) {
-    memcpy(crypt_text, text, std::min(syncframe_size, kLeadingClearBytesSize));
-    if (syncframe_size > kLeadingClearBytesSize) {
-      // The residual block is left untouched (copied without
-      // encryption/decryption). No need to do special handling here.
-      if (!cryptor_->Crypt(text + kLeadingClearBytesSize,
-                           syncframe_size - kLeadingClearBytesSize,
-                           crypt_text + kLeadingClearBytesSize)) {
-        return false;
-      }
-    }
-    text += syncframe_size;
-    crypt_text += syncframe_size;
+    const size_t clear_bytes = std::min(syncframe_size, kLeadingClearBytesSize);
+    subsamples.emplace_back(static_cast<uint16_t>(clear_bytes),
+                            static_cast<uint32_t>(syncframe_size - clear_bytes));
   }
-  return true;
+  return cryptor_->CryptSubsamples(text, text_size, subsamples, crypt_text);
 }
 
 void SampleAesEc3Cryptor::SetIvInternal() {
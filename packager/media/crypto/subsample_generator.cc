@@ -210,6 +210,7 @@ Status SubsampleGenerator::Initialize(FourCC protection_scheme,
 Status SubsampleGenerator::GenerateSubsamples(
     const uint8_t* frame,
     size_t frame_size,
+    const std::vector<size_t>& video_slice_header_sizes,
     std::vector<SubsampleEntry>* subsamples) {
   subsamples->clear();
   switch (codec_) {
@@ -219,7 +220,8 @@ Status SubsampleGenerator::GenerateSubsamples(
       FALLTHROUGH_INTENDED;
     case kCodecH265:
     case kCodecH265DolbyVision:
-      return GenerateSubsamplesFromH26xFrame(frame, frame_size, subsamples);
+      return GenerateSubsamplesFromH26xFrame(
+          frame, frame_size, video_slice_header_sizes, subsamples);
     case kCodecVP9:
       if (vp9_subsample_encryption_)
         return GenerateSubsamplesFromVPxFrame(frame, frame_size, subsamples);
@@ -243,6 +245,24 @@ Status SubsampleGenerator::GenerateSubsamples(
   return Status::OK;
 }
 
+bool SubsampleGenerator::IsStateless() const {
+  switch (codec_) {
+    case kCodecAV1:
+      return false;
+    case kCodecH264:
+      FALLTHROUGH_INTENDED;
+    case kCodecH265:
+    case kCodecH265DolbyVision:
+      // |header_parser_| tracks the parameter sets unless there are leading
+      // clear bytes.
+      return leading_clear_bytes_size_ > 0;
+    case kCodecVP9:
+      return !vp9_subsample_encryption_;
+    default:
+      return true;
+  }
+}
+
 void SubsampleGenerator::InjectVpxParserForTesting(
     std::unique_ptr<VPxParser> vpx_parser) {
   vpx_parser_ = std::move(vpx_parser);
@@ -263,7 +283,8 @@ Status SubsampleGenerator::GenerateSubsamplesFromVPxFrame(
     size_t frame_size,
     std::vector<SubsampleEntry>* subsamples) {
   DCHECK(vpx_parser_);
-  std::vector<VPxFrameInfo> vpx_frames;
+  // |vpx_frames_| is reused to avoid an allocation per frame.
+  std::vector<VPxFrameInfo>& vpx_frames = vpx_frames_;
   if (!vpx_parser_->Parse(frame, frame_size, &vpx_frames))
     return Status(error::ENCRYPTION_FAILURE, "Failed to parse vpx frame.");
 
@@ -292,6 +313,7 @@ Status SubsampleGenerator::GenerateSubsamplesFromVPxFrame(
 Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
     const uint8_t* frame,
     size_t frame_size,
+    const std::vector<size_t>& video_slice_header_sizes,
     std::vector<SubsampleEntry>* subsamples) {
   DCHECK_NE(nalu_length_size_, 0u);
   DCHECK(header_parser_);
@@ -305,9 +327,11 @@ Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
 
   Nalu nalu;
   NaluReader::Result result;
+  size_t video_slice_index = 0;
   while ((result = reader.Advance(&nalu)) == NaluReader::kOk) {
     // |header_parser_| is only used if |leading_clear_bytes_size_| is not
-    // availble. See lines below.
+    // availble. See lines below. It still tracks the parameter sets when the
+    // slice header sizes are known, which is cheap.
     if (leading_clear_bytes_size_ == 0 && !header_parser_->ProcessNalu(nalu)) {
       LOG(ERROR) << "Failed to process NAL unit: NAL type = " << nalu.type();
       return Status(error::ENCRYPTION_FAILURE, "Failed to process NAL unit.");
@@ -315,13 +339,20 @@ Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
 
     const size_t nalu_total_size = nalu.header_size() + nalu.payload_size();
     size_t clear_bytes = 0;
+    // The slice header sizes, if known, cover all the video slices.
+    const bool has_video_slice_header_size =
+        nalu.is_video_slice() &&
+        video_slice_index++ < video_slice_header_sizes.size();
     if (nalu.is_video_slice() && nalu_total_size >= min_protected_data_size_) {
       clear_bytes = leading_clear_bytes_size_;
       if (clear_bytes == 0) {
         // For video-slice NAL units, encrypt the video slice.  This skips
         // the frame header.
         const int64_t video_slice_header_size =
-            header_parser_->GetHeaderSize(nalu);
+            has_video_slice_header_size
+                ? static_cast<int64_t>(
+                      video_slice_header_sizes[video_slice_index - 1])
+                : header_parser_->GetHeaderSize(nalu);
         if (video_slice_header_size < 0) {
           LOG(ERROR) << "Failed to read slice header.";
           return Status(error::ENCRYPTION_FAILURE,
@@ -341,6 +372,8 @@ Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
     LOG(ERROR) << "Failed to parse NAL units.";
     return Status(error::ENCRYPTION_FAILURE, "Failed to parse NAL units.");
   }
+  DCHECK(video_slice_header_sizes.empty() ||
+         video_slice_index == video_slice_header_sizes.size());
   return Status::OK;
 }
 
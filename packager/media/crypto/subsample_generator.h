@@ -12,6 +12,7 @@
 
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/codecs/vpx_parser.h"
 #include "packager/status.h"
 
 namespace shaka {
@@ -19,7 +20,6 @@ namespace media {
 
 class AV1Parser;
 class VideoSliceHeaderParser;
-class VPxParser;
 struct SubsampleEntry;
 
 /// Parsing and generating encryption subsamples from bitstreams. Note that the
@@ -53,12 +53,31 @@ class SubsampleGenerator {
   /// (encrypted) frame may be dependent on the previous clear frames.
   /// @param frame points to the start of the frame.
   /// @param frame_size is the size of the frame.
+  /// @param video_slice_header_sizes contains the slice header sizes of the
+  ///        video slice NAL units of an H.264 / H.265 frame, as returned by
+  ///        MediaSample::video_slice_header_sizes(), so they are not parsed
+  ///        again. The slice headers are parsed if it is empty.
   /// @param[out] subsamples will contain the output subsamples on success. It
   ///             will be empty if the frame should be full sample encrypted.
   /// @returns OK on success, an error status otherwise.
-  virtual Status GenerateSubsamples(const uint8_t* frame,
-                                    size_t frame_size,
-                                    std::vector<SubsampleEntry>* subsamples);
+  virtual Status GenerateSubsamples(
+      const uint8_t* frame,
+      size_t frame_size,
+      const std::vector<size_t>& video_slice_header_sizes,
+      std::vector<SubsampleEntry>* subsamples);
+
+  /// @return true if GenerateSubsamples() does not keep any state across
+  ///         frames, i.e. the clear frames do not need to be processed. Only
+  ///         valid after Initialize().
+  virtual bool IsStateless() const;
+
+  /// Same as above, parsing the slice headers if needed.
+  Status GenerateSubsamples(const uint8_t* frame,
+                            size_t frame_size,
+                            std::vector<SubsampleEntry>* subsamples) {
+    return GenerateSubsamples(frame, frame_size, std::vector<size_t>(),
+                              subsamples);
+  }
 
   // Testing injections.
   void InjectVpxParserForTesting(std::unique_ptr<VPxParser> vpx_parser);
@@ -77,6 +96,7 @@ class SubsampleGenerator {
   Status GenerateSubsamplesFromH26xFrame(
       const uint8_t* frame,
       size_t frame_size,
+      const std::vector<size_t>& video_slice_header_sizes,
       std::vector<SubsampleEntry>* subsamples);
   Status GenerateSubsamplesFromAV1Frame(
       const uint8_t* frame,
@@ -99,6 +119,8 @@ class SubsampleGenerator {
 
   // VPx parser for VPx streams.
   std::unique_ptr<VPxParser> vpx_parser_;
+  // The frames of the last VPx sample parsed.
+  std::vector<VPxFrameInfo> vpx_frames_;
   // Video slice header parser for NAL strucutred streams.
   std::unique_ptr<VideoSliceHeaderParser> header_parser_;
   // AV1 parser for AV1 streams.
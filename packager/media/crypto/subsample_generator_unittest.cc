@@ -366,6 +366,70 @@ TEST_P(SubsampleGeneratorTest, H264SubsampleEncryption) {
     EXPECT_THAT(subsamples, ElementsAreArray(kExpectedAlignedSubsamples));
 }
 
+TEST_P(SubsampleGeneratorTest, H264SubsampleEncryptionWithKnownSliceHeaders) {
+  SubsampleGenerator generator(kVP9SubsampleEncryption);
+  ASSERT_OK(
+      generator.Initialize(protection_scheme_, GetVideoStreamInfo(kCodecH264)));
+
+  constexpr uint8_t kFrame[] = {
+      // First NALU (nalu_size = 9).
+      0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+      // Second NALU (nalu_size = 0x25).
+      0x27, 0x25, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+      0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+      0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23,
+      0x24, 0x25, 0x26, 0x27,
+      // Third non-video-slice NALU (nalu_size = 0x32).
+      0x32, 0x67, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+      0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+      0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23,
+      0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+      0x30, 0x31, 0x32};
+  constexpr size_t kFrameSize = sizeof(kFrame);
+  // There are two video slices.
+  const size_t kSliceHeaderSize[] = {4, 5};
+  const SubsampleEntry kExpectedUnalignedSubsamples[] = {
+      // clear_bytes = nalu_length_size (1) + type_size (1) + header_size (4).
+      // encrypted_bytes = nalu_size (9) - type_size (1) - header_size (4).
+      {6, 4},
+      // clear_bytes = nalu_length_size (1) + type_size (1) + header_size (5).
+      // encrypted_bytes = nalu_size (0x27) - type_size (1) - header_size (5).
+      {7, 0x21},
+      // Non-video slice, clear_bytes = nalu_length_size (1) + nalu_size (0x32).
+      // encrypted_bytes = 0.
+      {0x33, 0},
+  };
+  const SubsampleEntry kExpectedAlignedSubsamples[] = {
+      // {6,4},{7,0x21} block aligned => {10,0},{8,0x20}
+      // Then merge consecutive clear-only subsamples.
+      {18, 0x20},
+      {0x33, 0},
+  };
+
+  std::unique_ptr<MockVideoSliceHeaderParser> mock_video_slice_header_parser(
+      new MockVideoSliceHeaderParser);
+  EXPECT_CALL(*mock_video_slice_header_parser, ProcessNalu(_))
+      .Times(AtLeast(2))
+      .WillRepeatedly(Return(true));
+  // The slice headers are not parsed again.
+  EXPECT_CALL(*mock_video_slice_header_parser, GetHeaderSize(_)).Times(0);
+
+  generator.InjectVideoSliceHeaderParserForTesting(
+      std::move(mock_video_slice_header_parser));
+
+  std::vector<SubsampleEntry> subsamples;
+  ASSERT_OK(generator.GenerateSubsamples(
+      kFrame, kFrameSize,
+      std::vector<size_t>(std::begin(kSliceHeaderSize),
+                          std::end(kSliceHeaderSize)),
+      &subsamples));
+  // Align subsamples for all CENC protection schemes except for cbcs.
+  if (protection_scheme_ == FOURCC_cbcs)
+    EXPECT_THAT(subsamples, ElementsAreArray(kExpectedUnalignedSubsamples));
+  else
+    EXPECT_THAT(subsamples, ElementsAreArray(kExpectedAlignedSubsamples));
+}
+
 TEST_P(SubsampleGeneratorTest, AV1ParserFailed) {
   SubsampleGenerator generator(kVP9SubsampleEncryption);
   ASSERT_OK(
@@ -445,6 +509,26 @@ TEST_P(SubsampleGeneratorTest, AACIsFullSampleEncrypted) {
   EXPECT_THAT(subsamples, ElementsAre());
 }
 
+TEST_P(SubsampleGeneratorTest, IsStateless) {
+  SubsampleGenerator aac_generator(kVP9SubsampleEncryption);
+  ASSERT_OK(aac_generator.Initialize(protection_scheme_,
+                                     GetAudioStreamInfo(kCodecAAC)));
+  EXPECT_TRUE(aac_generator.IsStateless());
+
+  SubsampleGenerator vp9_full_sample_generator(!kVP9SubsampleEncryption);
+  ASSERT_OK(vp9_full_sample_generator.Initialize(
+      protection_scheme_, GetVideoStreamInfo(kCodecVP9)));
+  EXPECT_TRUE(vp9_full_sample_generator.IsStateless());
+
+  // The parsers track the parameter sets and the sequence headers.
+  for (Codec codec : {kCodecVP9, kCodecH264, kCodecAV1}) {
+    SubsampleGenerator generator(kVP9SubsampleEncryption);
+    ASSERT_OK(
+        generator.Initialize(protection_scheme_, GetVideoStreamInfo(codec)));
+    EXPECT_FALSE(generator.IsStateless()) << codec;
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(
     CencProtectionSchemes,
     SubsampleGeneratorTest,
@@ -518,5 +602,13 @@ TEST(SampleAesSubsampleGeneratorTest, H264) {
   EXPECT_THAT(subsamples, ElementsAreArray(kExpectedSubsamples));
 }
 
+TEST(SampleAesSubsampleGeneratorTest, IsStateless) {
+  SubsampleGenerator generator(kVP9SubsampleEncryption);
+  // The slices are not parsed with the fixed leading clear bytes.
+  ASSERT_OK(generator.Initialize(kAppleSampleAesProtectionScheme,
+                                 GetVideoStreamInfo(kCodecH264)));
+  EXPECT_TRUE(generator.IsStateless());
+}
+
 }  // namespace media
 }  // namespace shaka
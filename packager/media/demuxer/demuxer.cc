@@ -12,30 +12,59 @@
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/file/file.h"
+#include "packager/file/mapped_file.h"
 #include "packager/media/base/decryptor_source.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/macros.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
 #include "packager/media/formats/mp4/mp4_media_parser.h"
 #include "packager/media/formats/webm/webm_media_parser.h"
 #include "packager/media/formats/webvtt/webvtt_parser.h"
 #include "packager/media/formats/wvm/wvm_media_parser.h"
+#include "packager/metrics/metrics.h"
+#include "packager/metrics/trace_event.h"
 
 namespace {
 // 65KB, sufficient to determine the container and likely all init data.
 const size_t kInitBufSize = 0x10000;
 const size_t kBufSize = 0x200000;  // 2MB
+// The containers identified from their leading bytes are detected as soon as
+// this many bytes are read, instead of waiting for kInitBufSize bytes, which
+// can take a while with network inputs.
+const size_t kMinProbeSize = 0x1000;
 // Maximum number of allowed queued samples. If we are receiving a lot of
 // samples before seeing init_event, something is not right. The number
 // set here is arbitrary though.
 const size_t kQueuedSamplesLimit = 10000;
+// Maximum number of bytes of the media samples queued before init_event, e.g.
+// when the stream info of one of the streams comes late.
+const uint64_t kQueuedBytesLimit = 256 << 20;
+// The number of samples decrypted in parallel at a time, when the samples are
+// decrypted by the demuxer.
+const size_t kDecryptionBatchSize = 64;
 const size_t kInvalidStreamIndex = static_cast<size_t>(-1);
 const size_t kBaseVideoOutputStreamIndex = 0x100;
 const size_t kBaseAudioOutputStreamIndex = 0x200;
 const size_t kBaseTextOutputStreamIndex = 0x300;
 
+// @return true if |container_name| is identified from the leading bytes of
+//         the input, so more bytes would not change the detection.
+bool IsDetectedFromPrefix(shaka::media::MediaContainerName container_name) {
+  switch (container_name) {
+    case shaka::media::CONTAINER_MOV:
+    case shaka::media::CONTAINER_MPEG2TS:
+    case shaka::media::CONTAINER_WEBM:
+    case shaka::media::CONTAINER_WEBVTT:
+      return true;
+    default:
+      return false;
+  }
+}
+
 std::string GetStreamLabel(size_t stream_index) {
   switch (stream_index) {
     case kBaseVideoOutputStreamIndex:
@@ -74,7 +103,7 @@ namespace shaka {
 namespace media {
 
 Demuxer::Demuxer(const std::string& file_name)
-    : file_name_(file_name), buffer_(new uint8_t[kBufSize]) {}
+    : file_name_(file_name), buffer_(kBufSize) {}
 
 Demuxer::~Demuxer() {
   if (media_file_)
@@ -86,12 +115,18 @@ void Demuxer::SetKeySource(std::unique_ptr<KeySource> key_source) {
 }
 
 Status Demuxer::Run() {
+  return CallWithStats([this]() { return RunInternal(); });
+}
+
+Status Demuxer::RunInternal() {
   LOG(INFO) << "Demuxer::Run() on file '" << file_name_ << "'.";
   Status status = InitializeParser();
   // ParserInitEvent callback is called after a few calls to Parse(), which sets
   // up the streams. Only after that, we can verify the outputs below.
-  while (!all_streams_ready_ && status.ok())
+  while (!all_streams_ready_ && !cancelled_ && status.ok())
     status.Update(Parse());
+  if (cancelled_)
+    return Status(error::CANCELLED, "Demuxer run cancelled");
   // If no output is defined, then return success after receiving all stream
   // info.
   if (all_streams_ready_ && output_handlers().empty())
@@ -112,10 +147,13 @@ Status Demuxer::Run() {
 
   while (!cancelled_ && status.ok())
     status.Update(Parse());
-  if (cancelled_ && status.ok())
+  // The reads fail once Cancel() aborts the input.
+  if (cancelled_)
     return Status(error::CANCELLED, "Demuxer run cancelled");
 
   if (status.error_code() == error::END_OF_STREAM) {
+    if (decryptor_source_ && !DecryptAndDispatchSamples())
+      return Status(error::PARSER_FAILURE, "Cannot decrypt samples.");
     for (size_t stream_index : stream_indexes_) {
       status = FlushDownstream(stream_index);
       if (!status.ok())
@@ -128,6 +166,10 @@ Status Demuxer::Run() {
 
 void Demuxer::Cancel() {
   cancelled_ = true;
+  // Unblock the read in progress, e.g. waiting for a live input.
+  base::AutoLock auto_lock(media_file_lock_);
+  if (media_file_)
+    media_file_->Abort();
 }
 
 Status Demuxer::SetHandler(const std::string& stream_label,
@@ -148,39 +190,87 @@ void Demuxer::SetLanguageOverride(const std::string& stream_label,
   language_overrides_[stream_index] = language_override;
 }
 
+void Demuxer::SetKeyFrameIndex(const KeyFrameIndex& key_frame_index,
+                               double start_seconds,
+                               double end_seconds) {
+  container_name_ = key_frame_index.container;
+  read_ranges_ = key_frame_index.GetReadRanges(start_seconds, end_seconds);
+  current_read_range_ = 0;
+}
+
 Status Demuxer::InitializeParser() {
   DCHECK(!media_file_);
   DCHECK(!all_streams_ready_);
 
   LOG(INFO) << "Initialize Demuxer for file '" << file_name_ << "'.";
 
-  media_file_ = File::Open(file_name_.c_str(), "r");
-  if (!media_file_) {
+  if (mmap_input_ && File::IsLocalRegularFile(file_name_.c_str())) {
+    mapped_file_ = MappedFile::Map(file_name_.c_str());
+    if (!mapped_file_) {
+      LOG(WARNING) << "Cannot map file '" << file_name_
+                   << "' in memory. Reading it instead.";
+    }
+  }
+  File* media_file = mapped_file_;
+  if (!media_file)
+    media_file = File::Open(file_name_.c_str(), "r");
+  if (!media_file) {
     return Status(error::FILE_FAILURE,
                   "Cannot open file for reading " + file_name_);
   }
+  {
+    base::AutoLock auto_lock(media_file_lock_);
+    media_file_ = media_file;
+    if (cancelled_)
+      media_file_->Abort();
+  }
 
-  // Read enough bytes before detecting the container.
+  // Read enough bytes before detecting the container, unless it is known
+  // already or identified from the bytes read so far.
+  const bool container_known = container_name_ != CONTAINER_UNKNOWN;
   int64_t bytes_read = 0;
   while (static_cast<size_t>(bytes_read) < kInitBufSize) {
     int64_t read_result =
-        media_file_->Read(buffer_.get() + bytes_read, kInitBufSize);
+        ReadInput(buffer_.data() + bytes_read, kInitBufSize - bytes_read);
     if (read_result < 0)
       return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
     if (read_result == 0)
       break;
     bytes_read += read_result;
+    if (container_known)
+      break;
+    if (static_cast<size_t>(bytes_read) >= kMinProbeSize) {
+      container_name_ = DetermineContainer(buffer_.data(), bytes_read);
+      if (IsDetectedFromPrefix(container_name_))
+        break;
+    }
   }
-  container_name_ = DetermineContainer(buffer_.get(), bytes_read);
+  if (!container_known && !IsDetectedFromPrefix(container_name_))
+    container_name_ = DetermineContainer(buffer_.data(), bytes_read);
 
   // Initialize media parser.
   switch (container_name_) {
-    case CONTAINER_MOV:
-      parser_.reset(new mp4::MP4MediaParser());
+    case CONTAINER_MOV: {
+      std::unique_ptr<mp4::MP4MediaParser> mp4_parser(
+          new mp4::MP4MediaParser());
+      if (key_source_ && num_decryption_threads_ > 0) {
+        mp4_parser->set_defer_decryption(true);
+        decryptor_source_.reset(new DecryptorSource(key_source_.get()));
+        decryption_pool_.reset(
+            new WorkStealingThreadPool(num_decryption_threads_));
+      }
+      parser_ = std::move(mp4_parser);
       break;
-    case CONTAINER_MPEG2TS:
-      parser_.reset(new mp2t::Mp2tMediaParser());
+    }
+    case CONTAINER_MPEG2TS: {
+      std::unique_ptr<mp2t::Mp2tMediaParser> mp2t_parser(
+          new mp2t::Mp2tMediaParser());
+      if (num_ts_demux_threads_ > 0)
+        mp2t_parser->EnableParallelEsParsing(num_ts_demux_threads_);
+      mp2t_parser->set_metrics_input(file_name_);
+      parser_ = std::move(mp2t_parser);
       break;
+    }
       // Widevine classic (WVM) is derived from MPEG2PS. We do not support
       // non-WVM MPEG2PS file, thus we do not differentiate between the two.
       // Every MPEG2PS file is assumed to be WVM file. If it turns out not the
@@ -191,16 +281,20 @@ Status Demuxer::InitializeParser() {
     case CONTAINER_WVM:
       parser_.reset(new wvm::WvmMediaParser());
       break;
-    case CONTAINER_WEBM:
-      parser_.reset(new WebMMediaParser());
+    case CONTAINER_WEBM: {
+      std::unique_ptr<WebMMediaParser> webm_parser(new WebMMediaParser());
+      if (num_webm_demux_threads_ > 0)
+        webm_parser->EnableParallelClusterParsing(num_webm_demux_threads_);
+      parser_ = std::move(webm_parser);
       break;
+    }
     case CONTAINER_WEBVTT:
       parser_.reset(new WebVttParser());
       break;
     case CONTAINER_UNKNOWN: {
       const int64_t kDumpSizeLimit = 512;
       LOG(ERROR) << "Failed to detect the container type from the buffer: "
-                 << base::HexEncode(buffer_.get(),
+                 << base::HexEncode(buffer_.data(),
                                     std::min(bytes_read, kDumpSizeLimit));
       return Status(error::INVALID_ARGUMENT,
                     "Failed to detect the container type.");
@@ -217,14 +311,31 @@ Status Demuxer::InitializeParser() {
       base::Bind(&Demuxer::NewTextSampleEvent, base::Unretained(this)),
       key_source_.get());
 
-  // Handle trailing 'moov'.
-  if (container_name_ == CONTAINER_MOV &&
-      File::IsLocalRegularFile(file_name_.c_str())) {
+  // The input is read sequentially when only some ranges are read.
+  if (container_name_ == CONTAINER_MOV && mapped_file_ &&
+      read_ranges_.empty()) {
+    // The whole file is parsed from the mapping in Parse(), which also handles
+    // trailing 'moov'.
+    parse_mapped_file_ = true;
+    return Status::OK;
+  }
+
+  if (container_name_ == CONTAINER_MOV && random_access_ &&
+      read_ranges_.empty() && File::IsSeekableInput(file_name_.c_str())) {
+    // The file is parsed with positional reads in Parse(), which also handles
+    // trailing 'moov'.
+    parse_with_positional_reads_ = true;
+    return Status::OK;
+  }
+
+  // Handle trailing 'moov'. The ranges read start with the 'moov' box.
+  if (container_name_ == CONTAINER_MOV && read_ranges_.empty() &&
+      File::IsSeekableInput(file_name_.c_str())) {
     // TODO(kqyang): Investigate whether we can reuse the existing file
     // descriptor |media_file_| instead of opening the same file again.
     static_cast<mp4::MP4MediaParser*>(parser_.get())->LoadMoov(file_name_);
   }
-  if (!parser_->Parse(buffer_.get(), bytes_read)) {
+  if (!parser_->Parse(buffer_.data(), bytes_read)) {
     return Status(error::PARSER_FAILURE,
                   "Cannot parse media file " + file_name_);
   }
@@ -277,6 +388,9 @@ void Demuxer::ParserInitEvent(
           stream_info->stream_type() != kStreamVideo) {
         stream_info->set_language(iter->second);
       }
+      // The samples are decrypted by the demuxer.
+      if (decryptor_source_)
+        stream_info->set_is_encrypted(false);
       if (stream_info->is_encrypted()) {
         init_event_status_.Update(Status(error::INVALID_ARGUMENT,
                                          "A decryption key source is not "
@@ -288,10 +402,54 @@ void Demuxer::ParserInitEvent(
     } else {
       track_id_to_stream_index_map_[stream_info->track_id()] =
           kInvalidStreamIndex;
+      parser_->DisableTrack(stream_info->track_id());
     }
     ++base_stream_index;
   }
   all_streams_ready_ = true;
+
+  // Dispatch the queued samples now instead of with the next sample, which
+  // may take a while or never come.
+  if (init_event_status_.ok() && !DispatchQueuedSamples()) {
+    init_event_status_.Update(Status(error::PARSER_FAILURE,
+                                     "Cannot dispatch the queued samples."));
+  }
+}
+
+bool Demuxer::DispatchQueuedSamples() {
+  if (!queued_media_samples_.empty() || !queued_text_samples_.empty()) {
+    VLOG(1) << "Dispatching " << queued_media_samples_.size()
+            << " media samples (" << queued_bytes_ << " bytes) and "
+            << queued_text_samples_.size()
+            << " text samples queued before the stream info of " << file_name_;
+  }
+  while (!queued_media_samples_.empty()) {
+    if (!PushMediaSample(queued_media_samples_.front().track_id,
+                         queued_media_samples_.front().sample)) {
+      return false;
+    }
+    queued_media_samples_.pop_front();
+  }
+  while (!queued_text_samples_.empty()) {
+    if (!PushTextSample(queued_text_samples_.front().track_id,
+                        queued_text_samples_.front().sample)) {
+      return false;
+    }
+    queued_text_samples_.pop_front();
+  }
+  if (queued_bytes_ > 0) {
+    queued_bytes_ = 0;
+    UpdateQueuedBytesGauge();
+  }
+  return true;
+}
+
+void Demuxer::UpdateQueuedBytesGauge() {
+  Metrics::GetInstance()->SetGauge(
+      "shaka_demuxer_queued_sample_bytes",
+      "Bytes of the samples of an input queued until the stream info of all "
+      "its streams is known.",
+      {{"input", file_name_}}, static_cast<double>(queued_bytes_));
 }
 
 bool Demuxer::NewMediaSampleEvent(uint32_t track_id,
@@ -301,20 +459,19 @@ bool Demuxer::NewMediaSampleEvent(uint32_t track_id,
       LOG(ERROR) << "Queued samples limit reached: " << kQueuedSamplesLimit;
       return false;
     }
+    if (queued_bytes_ + sample->data_size() > kQueuedBytesLimit) {
+      LOG(ERROR) << "Queued samples limit reached: " << kQueuedBytesLimit
+                 << " bytes.";
+      return false;
+    }
+    queued_bytes_ += sample->data_size();
+    UpdateQueuedBytesGauge();
     queued_media_samples_.emplace_back(track_id, sample);
     return true;
   }
   if (!init_event_status_.ok()) {
     return false;
   }
-
-  while (!queued_media_samples_.empty()) {
-    if (!PushMediaSample(queued_media_samples_.front().track_id,
-                         queued_media_samples_.front().sample)) {
-      return false;
-    }
-    queued_media_samples_.pop_front();
-  }
   return PushMediaSample(track_id, sample);
 }
 
@@ -331,14 +488,6 @@ bool Demuxer::NewTextSampleEvent(uint32_t track_id,
   if (!init_event_status_.ok()) {
     return false;
   }
-
-  while (!queued_text_samples_.empty()) {
-    if (!PushTextSample(queued_text_samples_.front().track_id,
-                        queued_text_samples_.front().sample)) {
-      return false;
-    }
-    queued_text_samples_.pop_front();
-  }
   return PushTextSample(track_id, sample);
 }
 
@@ -351,6 +500,12 @@ bool Demuxer::PushMediaSample(uint32_t track_id,
   }
   if (stream_index_iter->second == kInvalidStreamIndex)
     return true;
+  if (decryptor_source_) {
+    samples_to_decrypt_.emplace_back(stream_index_iter->second, sample);
+    if (samples_to_decrypt_.size() < kDecryptionBatchSize)
+      return true;
+    return DecryptAndDispatchSamples();
+  }
   Status status = DispatchMediaSample(stream_index_iter->second, sample);
   if (!status.ok()) {
     LOG(ERROR) << "Failed to process sample " << stream_index_iter->second
@@ -378,12 +533,105 @@ bool Demuxer::PushTextSample(uint32_t track_id,
   return true;
 }
 
+bool Demuxer::DecryptAndDispatchSamples() {
+  std::unique_ptr<bool[]> results(new bool[samples_to_decrypt_.size()]);
+  std::vector<base::Closure> tasks;
+  tasks.reserve(samples_to_decrypt_.size());
+  for (size_t i = 0; i < samples_to_decrypt_.size(); ++i) {
+    tasks.push_back(base::Bind(&Demuxer::DecryptSample,
+                               base::Unretained(this),
+                               samples_to_decrypt_[i].second.get(),
+                               &results[i]));
+  }
+  {
+    SHAKA_TRACE_EVENT("demuxer", "Demuxer::DecryptSamples");
+    decryption_pool_->RunTasksAndWait(tasks);
+  }
+
+  std::vector<std::pair<size_t, std::shared_ptr<MediaSample>>> samples;
+  samples.swap(samples_to_decrypt_);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    if (!results[i]) {
+      LOG(ERROR) << "Cannot decrypt samples.";
+      return false;
+    }
+    Status status = DispatchMediaSample(samples[i].first, samples[i].second);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to process sample " << samples[i].first << " "
+                 << status;
+      return false;
+    }
+  }
+  return true;
+}
+
+void Demuxer::DecryptSample(MediaSample* sample, bool* result) {
+  *result = true;
+  if (!sample->decrypt_config())
+    return;
+  const size_t data_size = sample->data_size();
+  std::shared_ptr<uint8_t> decrypted_data =
+      SampleBufferPool::Allocate(data_size);
+  if (!decryptor_source_->DecryptSampleBuffer(sample->decrypt_config(),
+                                              sample->data(), data_size,
+                                              decrypted_data.get())) {
+    *result = false;
+    return;
+  }
+  sample->TransferData(std::move(decrypted_data), data_size);
+  sample->set_decrypt_config(nullptr);
+  sample->set_is_encrypted(false);
+}
+
 Status Demuxer::Parse() {
   DCHECK(media_file_);
   DCHECK(parser_);
-  DCHECK(buffer_);
+  DCHECK(buffer_.data());
+
+  if (parse_mapped_file_) {
+    parse_mapped_file_ = false;
+    SHAKA_TRACE_EVENT("demuxer", "MP4MediaParser::ParseMappedFile");
+    if (!static_cast<mp4::MP4MediaParser*>(parser_.get())
+             ->ParseMappedFile(mapped_file_->data(), mapped_file_->size())) {
+      return Status(error::PARSER_FAILURE,
+                    "Cannot parse media file " + file_name_);
+    }
+    // All the samples are emitted. The next read gets the end of stream.
+    mapped_file_->Seek(mapped_file_->size());
+    return Status::OK;
+  }
+
+  if (parse_with_positional_reads_) {
+    parse_with_positional_reads_ = false;
+    SHAKA_TRACE_EVENT("demuxer", "MP4MediaParser::ParseWithPositionalReads");
+    bool all_samples_parsed = false;
+    if (!static_cast<mp4::MP4MediaParser*>(parser_.get())
+             ->ParseWithPositionalReads(file_name_, &all_samples_parsed)) {
+      return Status(error::PARSER_FAILURE,
+                    "Cannot parse media file " + file_name_);
+    }
+    // If all the samples are emitted, the next read gets the end of stream.
+    // Otherwise, i.e. for fragmented files, read the file from the beginning.
+    const int64_t position = all_samples_parsed ? media_file_->Size() : 0;
+    if (position < 0 || !media_file_->Seek(position))
+      return Status(error::FILE_FAILURE, "Cannot seek file " + file_name_);
+    return Status::OK;
+  }
+
+  // The chunk cannot be reused while samples still reference it, so allocate
+  // a new one for every read. It is recycled through the buffer pool.
+  std::shared_ptr<uint8_t> chunk;
+  uint8_t* read_buffer = buffer_.data();
+  if (zero_copy_) {
+    chunk = SampleBufferPool::Allocate(kBufSize);
+    read_buffer = chunk.get();
+  }
 
-  int64_t bytes_read = media_file_->Read(buffer_.get(), kBufSize);
+  int64_t bytes_read = 0;
+  {
+    SHAKA_TRACE_EVENT("demuxer", "Demuxer::Read");
+    bytes_read = ReadInput(read_buffer, kBufSize);
+  }
   if (bytes_read == 0) {
     if (!parser_->Flush())
       return Status(error::PARSER_FAILURE, "Failed to flush.");
@@ -392,11 +640,39 @@ Status Demuxer::Parse() {
     return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
   }
 
-  return parser_->Parse(buffer_.get(), bytes_read)
+  SHAKA_TRACE_EVENT("demuxer", "MediaParser::Parse");
+  const bool result =
+      chunk ? parser_->ParseChunk(std::move(chunk), bytes_read)
+            : parser_->Parse(read_buffer, bytes_read);
+  return result
              ? Status::OK
              : Status(error::PARSER_FAILURE,
                       "Cannot parse media file " + file_name_);
 }
 
+int64_t Demuxer::ReadInput(uint8_t* buffer, uint64_t size) {
+  if (read_ranges_.empty())
+    return media_file_->Read(buffer, size);
+
+  while (current_read_range_ < read_ranges_.size()) {
+    const KeyFrameIndex::ReadRange& range = read_ranges_[current_read_range_];
+    if (input_position_ >= range.end) {
+      ++current_read_range_;
+      continue;
+    }
+    if (input_position_ < range.begin) {
+      if (!media_file_->Seek(range.begin))
+        return -1;
+      input_position_ = range.begin;
+    }
+    const int64_t bytes_read = media_file_->Read(
+        buffer, std::min(size, range.end - input_position_));
+    if (bytes_read > 0)
+      input_position_ += bytes_read;
+    return bytes_read;
+  }
+  return 0;
+}
+
 }  // namespace media
 }  // namespace shaka
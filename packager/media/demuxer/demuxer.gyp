@@ -15,8 +15,13 @@
       'sources': [
         'demuxer.cc',
         'demuxer.h',
+        'key_frame_index.cc',
+        'key_frame_index.h',
+        'key_frame_scanner.cc',
+        'key_frame_scanner.h',
       ],
       'dependencies': [
+        '../../file/file.gyp:file',
         '../base/media_base.gyp:media_base',
         '../formats/mp2t/mp2t.gyp:mp2t',
         '../formats/mp4/mp4.gyp:mp4',
@@ -31,6 +36,8 @@
       'type': '<(gtest_target_type)',
       'sources': [
         'demuxer_unittest.cc',
+        'key_frame_index_unittest.cc',
+        'key_frame_scanner_unittest.cc',
       ],
       'dependencies': [
         '../../testing/gmock.gyp:gmock',
@@ -7,26 +7,34 @@
 #ifndef PACKAGER_MEDIA_BASE_DEMUXER_H_
 #define PACKAGER_MEDIA_BASE_DEMUXER_H_
 
+#include <atomic>
 #include <deque>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/huge_page_buffer.h"
 #include "packager/media/base/container_names.h"
+#include "packager/media/demuxer/key_frame_index.h"
 #include "packager/media/origin/origin_handler.h"
 #include "packager/status.h"
 
 namespace shaka {
 
 class File;
+class MappedFile;
 
 namespace media {
 
 class Decryptor;
+class DecryptorSource;
 class KeySource;
 class MediaParser;
 class MediaSample;
 class StreamInfo;
+class WorkStealingThreadPool;
 
 /// Demuxer is responsible for extracting elementary stream samples from a
 /// media file, e.g. an ISO BMFF file.
@@ -56,6 +64,12 @@ class Demuxer : public OriginHandler {
   ///         is not initialized.
   MediaContainerName container_name() { return container_name_; }
 
+  /// Set the container of the input, e.g. when it is known from the command
+  /// line, so it is not detected from the content. Must be called before Run.
+  void set_container_name(MediaContainerName container_name) {
+    container_name_ = container_name;
+  }
+
   /// Set the handler for the specified stream.
   /// @param stream_label can be 'audio', 'video', or stream number (zero
   ///        based).
@@ -75,6 +89,57 @@ class Demuxer : public OriginHandler {
     dump_stream_info_ = dump_stream_info;
   }
 
+  /// Enable zero-copy demuxing. Each read goes into a new ref-counted chunk
+  /// and parsers that support it emit samples referencing the chunk instead
+  /// of copying the sample data. A chunk is kept alive until all samples
+  /// referencing it are released.
+  void set_zero_copy(bool zero_copy) { zero_copy_ = zero_copy; }
+
+  /// Map local input files in memory. MP4 inputs are then parsed directly
+  /// from the mapping: the 'moov' box is read wherever it is and the samples
+  /// reference the mapping instead of being read and copied.
+  void set_mmap_input(bool mmap_input) { mmap_input_ = mmap_input; }
+
+  /// Read the samples of local non-fragmented MP4 inputs with positional
+  /// reads, chunk by chunk in decoding time order, instead of reading the
+  /// whole file sequentially. The memory usage is then bounded regardless of
+  /// how the tracks are interleaved in the file.
+  void set_random_access(bool random_access) { random_access_ = random_access; }
+
+  /// Read only the parts of the input with the key frames from
+  /// @a start_seconds to @a end_seconds, as located by @a key_frame_index,
+  /// instead of the whole input. The samples around the range are still
+  /// emitted, so they have to be trimmed downstream. Must be called before
+  /// Run.
+  /// @param key_frame_index is the index of the input.
+  /// @param end_seconds is the end of the range, or zero to read the input to
+  ///        the end.
+  void SetKeyFrameIndex(const KeyFrameIndex& key_frame_index,
+                        double start_seconds,
+                        double end_seconds);
+
+  /// Parse the elementary streams of MPEG-2 TS inputs in parallel on a pool of
+  /// this many threads, one elementary stream at a time per thread. Zero, the
+  /// default, parses them on the demuxer thread.
+  void set_num_ts_demux_threads(uint32_t num_ts_demux_threads) {
+    num_ts_demux_threads_ = num_ts_demux_threads;
+  }
+
+  /// Parse the clusters of WebM inputs in parallel on a pool of this many
+  /// threads, one cluster at a time per thread. Zero, the default, parses them
+  /// on the demuxer thread.
+  void set_num_webm_demux_threads(uint32_t num_webm_demux_threads) {
+    num_webm_demux_threads_ = num_webm_demux_threads;
+  }
+
+  /// Decrypt the samples of encrypted MP4 inputs in parallel on a pool of this
+  /// many threads, in batches, instead of on the demuxer thread while they are
+  /// parsed. The samples are dispatched in order. Zero, the default, decrypts
+  /// them on the demuxer thread. Ignored without a key source.
+  void set_num_decryption_threads(uint32_t num_decryption_threads) {
+    num_decryption_threads_ = num_decryption_threads;
+  }
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
@@ -105,6 +170,9 @@ class Demuxer : public OriginHandler {
     std::shared_ptr<T> sample;
   };
 
+  // Implements Run(), which records its statistics.
+  Status RunInternal();
+
   // Initialize the parser. This method primes the demuxer by parsing portions
   // of the media file to extract stream information.
   // @return OK on success.
@@ -113,26 +181,45 @@ class Demuxer : public OriginHandler {
   // Parser init event.
   void ParserInitEvent(const std::vector<std::shared_ptr<StreamInfo>>& streams);
   // Parser new sample event handler. Queues the samples if init event has not
-  // been received, otherwise calls PushSample() to push the sample to
-  // corresponding stream.
+  // been received, up to a limit, otherwise calls PushSample() to push the
+  // sample to corresponding stream.
   bool NewMediaSampleEvent(uint32_t track_id,
                            std::shared_ptr<MediaSample> sample);
   bool NewTextSampleEvent(uint32_t track_id,
                           std::shared_ptr<TextSample> sample);
+  // Dispatch the samples queued before ParserInitEvent(), in order.
+  bool DispatchQueuedSamples();
+  // Export |queued_bytes_| as a gauge.
+  void UpdateQueuedBytesGauge();
   // Helper function to push the sample to corresponding stream.
   bool PushMediaSample(uint32_t track_id, std::shared_ptr<MediaSample> sample);
   bool PushTextSample(uint32_t track_id, std::shared_ptr<TextSample> sample);
+  // Decrypt the samples in |samples_to_decrypt_| on |decryption_pool_| and
+  // dispatch them, in order.
+  bool DecryptAndDispatchSamples();
+  // Decrypt |sample| in place, if it is encrypted, and set |*result|.
+  void DecryptSample(MediaSample* sample, bool* result);
 
   // Read from the source and send it to the parser.
   Status Parse();
+  // Read up to |size| bytes from |media_file_| into |buffer|, skipping the
+  // parts of the input outside of |read_ranges_|, if any.
+  // @return The number of bytes read, 0 at the end of the input or of the
+  //         last range, or a negative value on error.
+  int64_t ReadInput(uint8_t* buffer, uint64_t size);
 
   std::string file_name_;
   File* media_file_ = nullptr;
+  // Protects the assignment of |media_file_| against Cancel(), which aborts
+  // it from another thread.
+  base::Lock media_file_lock_;
   // A stream is considered ready after receiving the stream info.
   bool all_streams_ready_ = false;
   // Queued samples received in NewSampleEvent() before ParserInitEvent().
   std::deque<QueuedSample<MediaSample>> queued_media_samples_;
   std::deque<QueuedSample<TextSample>> queued_text_samples_;
+  // The bytes of |queued_media_samples_|.
+  uint64_t queued_bytes_ = 0;
   std::unique_ptr<MediaParser> parser_;
   // TrackId -> StreamIndex map.
   std::map<uint32_t, size_t> track_id_to_stream_index_map_;
@@ -142,11 +229,36 @@ class Demuxer : public OriginHandler {
   // StreamIndex -> language_override map.
   std::map<size_t, std::string> language_overrides_;
   MediaContainerName container_name_ = CONTAINER_UNKNOWN;
-  std::unique_ptr<uint8_t[]> buffer_;
+  // Backed by huge pages if enabled by --huge_pages.
+  HugePageBuffer buffer_;
   std::unique_ptr<KeySource> key_source_;
-  bool cancelled_ = false;
+  std::atomic<bool> cancelled_{false};
   // Whether to dump stream info when it is received.
   bool dump_stream_info_ = false;
+  bool zero_copy_ = false;
+  bool mmap_input_ = false;
+  // Set if |media_file_| is a memory mapped file.
+  MappedFile* mapped_file_ = nullptr;
+  // Whether the mapped file is parsed as a whole in the next Parse().
+  bool parse_mapped_file_ = false;
+  bool random_access_ = false;
+  // Whether the file is parsed with positional reads in the next Parse().
+  bool parse_with_positional_reads_ = false;
+  // The ranges of the input to read, in order. The whole input is read if
+  // empty.
+  std::vector<KeyFrameIndex::ReadRange> read_ranges_;
+  size_t current_read_range_ = 0;
+  // The position in |media_file_|, only tracked with |read_ranges_|.
+  uint64_t input_position_ = 0;
+  uint32_t num_ts_demux_threads_ = 0;
+  uint32_t num_webm_demux_threads_ = 0;
+  uint32_t num_decryption_threads_ = 0;
+  // Set if the samples are decrypted in parallel, in DecryptSample().
+  std::unique_ptr<DecryptorSource> decryptor_source_;
+  std::unique_ptr<WorkStealingThreadPool> decryption_pool_;
+  // StreamIndex and sample of the samples waiting for decryption.
+  std::vector<std::pair<size_t, std::shared_ptr<MediaSample>>>
+      samples_to_decrypt_;
   Status init_event_status_;
 };
 
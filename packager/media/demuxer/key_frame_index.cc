@@ -0,0 +1,170 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/key_frame_index.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "packager/file/file.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// 'skfi'.
+const uint32_t kMagic = 0x736b6669;
+const uint8_t kVersion = 1;
+
+// The containers are stored with their own codes, so the format does not
+// depend on the values of MediaContainerName.
+enum ContainerCode : uint8_t {
+  kContainerCodeUnknown = 0,
+  kContainerCodeMp4 = 1,
+  kContainerCodeMpeg2Ts = 2,
+  kContainerCodeWebM = 3,
+};
+
+uint8_t ContainerToCode(MediaContainerName container) {
+  switch (container) {
+    case CONTAINER_MOV:
+      return kContainerCodeMp4;
+    case CONTAINER_MPEG2TS:
+      return kContainerCodeMpeg2Ts;
+    case CONTAINER_WEBM:
+      return kContainerCodeWebM;
+    default:
+      return kContainerCodeUnknown;
+  }
+}
+
+MediaContainerName CodeToContainer(uint8_t code) {
+  switch (code) {
+    case kContainerCodeMp4:
+      return CONTAINER_MOV;
+    case kContainerCodeMpeg2Ts:
+      return CONTAINER_MPEG2TS;
+    case kContainerCodeWebM:
+      return CONTAINER_WEBM;
+    default:
+      return CONTAINER_UNKNOWN;
+  }
+}
+
+}  // namespace
+
+std::vector<uint8_t> KeyFrameIndex::Serialize() const {
+  BufferWriter writer;
+  writer.AppendInt(kMagic);
+  writer.AppendInt(kVersion);
+  writer.AppendInt(ContainerToCode(container));
+  writer.AppendInt(time_scale);
+  writer.AppendInt(header_size);
+  writer.AppendInt(static_cast<uint32_t>(entries.size()));
+  for (const Entry& entry : entries) {
+    writer.AppendInt(entry.timestamp);
+    writer.AppendInt(entry.offset);
+  }
+  return std::vector<uint8_t>(writer.Buffer(), writer.Buffer() + writer.Size());
+}
+
+bool KeyFrameIndex::Parse(const uint8_t* data, size_t data_size) {
+  BufferReader reader(data, data_size);
+  uint32_t magic = 0;
+  uint8_t version = 0;
+  uint8_t container_code = 0;
+  uint32_t num_entries = 0;
+  if (!reader.Read4(&magic) || magic != kMagic || !reader.Read1(&version) ||
+      version != kVersion || !reader.Read1(&container_code) ||
+      !reader.Read4(&time_scale) || !reader.Read8(&header_size) ||
+      !reader.Read4(&num_entries)) {
+    return false;
+  }
+  container = CodeToContainer(container_code);
+  if (container == CONTAINER_UNKNOWN || time_scale == 0)
+    return false;
+
+  const size_t kEntrySize = 16;
+  if (reader.size() - reader.pos() != num_entries * kEntrySize)
+    return false;
+  entries.resize(num_entries);
+  for (Entry& entry : entries) {
+    if (!reader.Read8s(&entry.timestamp) || !reader.Read8(&entry.offset))
+      return false;
+  }
+  return true;
+}
+
+Status KeyFrameIndex::WriteToFile(const std::string& file_name) const {
+  const std::vector<uint8_t> data = Serialize();
+  if (!File::WriteStringToFile(file_name.c_str(),
+                               std::string(data.begin(), data.end()))) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot write key frame index " + file_name);
+  }
+  return Status::OK;
+}
+
+Status KeyFrameIndex::ReadFromFile(const std::string& file_name) {
+  std::string data;
+  if (!File::ReadFileToString(file_name.c_str(), &data)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot read key frame index " + file_name);
+  }
+  if (!Parse(reinterpret_cast<const uint8_t*>(data.data()), data.size())) {
+    return Status(error::PARSER_FAILURE,
+                  "Invalid key frame index " + file_name);
+  }
+  return Status::OK;
+}
+
+std::vector<KeyFrameIndex::ReadRange> KeyFrameIndex::GetReadRanges(
+    double start_seconds,
+    double end_seconds) const {
+  const uint64_t kInputEnd = std::numeric_limits<uint64_t>::max();
+  auto timestamp_less = [](int64_t timestamp, const Entry& entry) {
+    return timestamp < entry.timestamp;
+  };
+
+  // One key frame before the last key frame at or before the start.
+  uint64_t begin = 0;
+  const int64_t start_timestamp =
+      static_cast<int64_t>(start_seconds * time_scale);
+  auto start_iter = std::upper_bound(entries.begin(), entries.end(),
+                                     start_timestamp, timestamp_less);
+  if (start_iter - entries.begin() >= 2)
+    begin = (start_iter - 2)->offset;
+
+  // One key frame after the first key frame at or after the end.
+  uint64_t end = kInputEnd;
+  if (end_seconds > 0) {
+    const int64_t end_timestamp =
+        static_cast<int64_t>(end_seconds * time_scale);
+    auto end_iter = std::lower_bound(
+        entries.begin(), entries.end(), end_timestamp,
+        [](const Entry& entry, int64_t timestamp) {
+          return entry.timestamp < timestamp;
+        });
+    if (end_iter != entries.end() && end_iter + 1 != entries.end())
+      end = (end_iter + 1)->offset;
+  }
+
+  std::vector<ReadRange> ranges;
+  ReadRange range;
+  if (begin > header_size) {
+    range.end = header_size;
+    ranges.push_back(range);
+    range.begin = begin;
+  }
+  range.end = end;
+  ranges.push_back(range);
+  return ranges;
+}
+
+}  // namespace media
+}  // namespace shaka
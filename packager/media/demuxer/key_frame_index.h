@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_DEMUXER_KEY_FRAME_INDEX_H_
+#define PACKAGER_MEDIA_DEMUXER_KEY_FRAME_INDEX_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "packager/media/base/container_names.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// The byte offsets and timestamps of the key frames of an input, so that
+/// the input can be read from a key frame instead of from the beginning, e.g.
+/// to package a time range of a long input. The index is built by a cheap
+/// scan of the input, see ScanKeyFrames(), and stored in a sidecar file.
+struct KeyFrameIndex {
+  /// A position of the input where reading can start.
+  struct Entry {
+    /// The timestamp of the key frame, in @a time_scale units.
+    int64_t timestamp = 0;
+    /// The offset of the key frame in the input, i.e. of the MP4 fragment,
+    /// the WebM cluster or the TS packet that starts with it.
+    uint64_t offset = 0;
+  };
+
+  /// A range of bytes of the input, [begin, end).
+  struct ReadRange {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+  };
+
+  /// Serializes the index to a compact binary format.
+  std::vector<uint8_t> Serialize() const;
+  /// Parses an index serialized by Serialize().
+  /// @return true on success, false otherwise.
+  bool Parse(const uint8_t* data, size_t data_size);
+
+  Status WriteToFile(const std::string& file_name) const;
+  Status ReadFromFile(const std::string& file_name);
+
+  /// @return The ranges of the input to read to get the key frames from
+  ///         @a start_seconds to @a end_seconds: the headers, then the input
+  ///         from a key frame before @a start_seconds to a key frame after
+  ///         @a end_seconds. An @a end_seconds of zero reads to the end of
+  ///         the input. The ranges include one more key frame interval on
+  ///         each side, so the samples of the other streams multiplexed
+  ///         ahead of or behind the key frames are read too.
+  std::vector<ReadRange> GetReadRanges(double start_seconds,
+                                       double end_seconds) const;
+
+  MediaContainerName container = CONTAINER_UNKNOWN;
+  uint32_t time_scale = 0;
+  /// The size of the beginning of the input that has to be parsed before
+  /// reading from a key frame, e.g. up to the end of the MP4 'moov' box.
+  uint64_t header_size = 0;
+  /// The key frames, in increasing offset and timestamp order.
+  std::vector<Entry> entries;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_DEMUXER_KEY_FRAME_INDEX_H_
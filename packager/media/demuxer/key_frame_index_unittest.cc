@@ -0,0 +1,99 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/key_frame_index.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint32_t kTimeScale = 1000;
+const uint64_t kHeaderSize = 100;
+const uint64_t kInputEnd = std::numeric_limits<uint64_t>::max();
+
+// Key frames every second, 1000 bytes apart.
+KeyFrameIndex CreateIndex() {
+  KeyFrameIndex index;
+  index.container = CONTAINER_MPEG2TS;
+  index.time_scale = kTimeScale;
+  index.header_size = kHeaderSize;
+  for (int i = 0; i < 10; ++i) {
+    KeyFrameIndex::Entry entry;
+    entry.timestamp = i * kTimeScale;
+    entry.offset = kHeaderSize + i * 1000;
+    index.entries.push_back(entry);
+  }
+  return index;
+}
+
+}  // namespace
+
+TEST(KeyFrameIndexTest, SerializeAndParse) {
+  const KeyFrameIndex index = CreateIndex();
+  const std::vector<uint8_t> data = index.Serialize();
+
+  KeyFrameIndex parsed_index;
+  ASSERT_TRUE(parsed_index.Parse(data.data(), data.size()));
+  EXPECT_EQ(CONTAINER_MPEG2TS, parsed_index.container);
+  EXPECT_EQ(kTimeScale, parsed_index.time_scale);
+  EXPECT_EQ(kHeaderSize, parsed_index.header_size);
+  ASSERT_EQ(index.entries.size(), parsed_index.entries.size());
+  for (size_t i = 0; i < index.entries.size(); ++i) {
+    EXPECT_EQ(index.entries[i].timestamp, parsed_index.entries[i].timestamp);
+    EXPECT_EQ(index.entries[i].offset, parsed_index.entries[i].offset);
+  }
+}
+
+TEST(KeyFrameIndexTest, ParseTruncated) {
+  const std::vector<uint8_t> data = CreateIndex().Serialize();
+  KeyFrameIndex parsed_index;
+  EXPECT_FALSE(parsed_index.Parse(data.data(), data.size() - 1));
+}
+
+TEST(KeyFrameIndexTest, ParseInvalidMagic) {
+  std::vector<uint8_t> data = CreateIndex().Serialize();
+  data[0] ^= 0xFF;
+  KeyFrameIndex parsed_index;
+  EXPECT_FALSE(parsed_index.Parse(data.data(), data.size()));
+}
+
+TEST(KeyFrameIndexTest, GetReadRanges) {
+  const std::vector<KeyFrameIndex::ReadRange> ranges =
+      CreateIndex().GetReadRanges(4.5, 6.5);
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(0u, ranges[0].begin);
+  EXPECT_EQ(kHeaderSize, ranges[0].end);
+  // From the key frame at 3s to the key frame at 8s.
+  EXPECT_EQ(kHeaderSize + 3000, ranges[1].begin);
+  EXPECT_EQ(kHeaderSize + 8000, ranges[1].end);
+}
+
+TEST(KeyFrameIndexTest, GetReadRangesFromBeginning) {
+  const std::vector<KeyFrameIndex::ReadRange> ranges =
+      CreateIndex().GetReadRanges(1, 3);
+  ASSERT_EQ(1u, ranges.size());
+  EXPECT_EQ(0u, ranges[0].begin);
+  EXPECT_EQ(kHeaderSize + 4000, ranges[0].end);
+}
+
+TEST(KeyFrameIndexTest, GetReadRangesToEnd) {
+  const KeyFrameIndex index = CreateIndex();
+  std::vector<KeyFrameIndex::ReadRange> ranges = index.GetReadRanges(5, 0);
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(kHeaderSize + 4000, ranges[1].begin);
+  EXPECT_EQ(kInputEnd, ranges[1].end);
+
+  ranges = index.GetReadRanges(5, 9);
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(kInputEnd, ranges[1].end);
+}
+
+}  // namespace media
+}  // namespace shaka
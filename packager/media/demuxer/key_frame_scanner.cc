@@ -0,0 +1,639 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/key_frame_scanner.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/container_names.h"
+#include "packager/media/demuxer/key_frame_index.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/box_reader.h"
+#include "packager/media/formats/webm/webm_constants.h"
+#include "packager/media/formats/webm/webm_info_parser.h"
+#include "packager/media/formats/webm/webm_parser.h"
+#include "packager/media/formats/webm/webm_tracks_parser.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Enough to detect the container.
+const size_t kProbeSize = 0x10000;
+
+bool ReadAt(File* file, uint64_t offset, uint64_t size, uint8_t* buffer) {
+  if (!file->Seek(offset))
+    return false;
+  while (size > 0) {
+    const int64_t bytes_read = file->Read(buffer, size);
+    if (bytes_read <= 0)
+      return false;
+    buffer += bytes_read;
+    size -= bytes_read;
+  }
+  return true;
+}
+
+// Adds a key frame to |index|. The key frames out of timestamp order, e.g.
+// after a timestamp discontinuity, are skipped so the index can be searched
+// by timestamp.
+void AddKeyFrame(int64_t timestamp, uint64_t offset, KeyFrameIndex* index) {
+  if (!index->entries.empty() &&
+      timestamp <= index->entries.back().timestamp) {
+    VLOG(1) << "Skipping key frame at offset " << offset
+            << " with out of order timestamp " << timestamp;
+    return;
+  }
+  KeyFrameIndex::Entry entry;
+  entry.timestamp = timestamp;
+  entry.offset = offset;
+  index->entries.push_back(entry);
+}
+
+Status ScanMp4(File* file, KeyFrameIndex* index) {
+  const int64_t file_size = file->Size();
+  if (file_size < 0)
+    return Status(error::FILE_FAILURE, "Cannot get the size of the input.");
+
+  std::unique_ptr<mp4::Movie> moov;
+  uint32_t track_id = 0;
+  mp4::TrackExtends trex;
+  std::vector<uint8_t> box_data;
+  uint64_t position = 0;
+  while (position < static_cast<uint64_t>(file_size)) {
+    const uint64_t kBoxHeaderReadSize = 16;
+    uint8_t header[kBoxHeaderReadSize];
+    const uint64_t header_size = std::min(
+        kBoxHeaderReadSize, static_cast<uint64_t>(file_size) - position);
+    FourCC box_type;
+    uint64_t box_size = 0;
+    bool err = false;
+    if (!ReadAt(file, position, header_size, header) ||
+        !mp4::BoxReader::StartBox(header, header_size, &box_type, &box_size,
+                                  &err) ||
+        box_size == 0) {
+      return Status(error::PARSER_FAILURE, "Cannot read MP4 box header.");
+    }
+
+    if (box_type == FOURCC_moov || box_type == FOURCC_moof) {
+      box_data.resize(box_size);
+      if (!ReadAt(file, position, box_size, box_data.data()))
+        return Status(error::FILE_FAILURE, "Cannot read MP4 box.");
+      std::unique_ptr<mp4::BoxReader> reader(
+          mp4::BoxReader::ReadBox(box_data.data(), box_data.size(), &err));
+      if (!reader)
+        return Status(error::PARSER_FAILURE, "Cannot parse MP4 box.");
+
+      if (box_type == FOURCC_moov) {
+        moov.reset(new mp4::Movie);
+        if (!moov->Parse(reader.get()))
+          return Status(error::PARSER_FAILURE, "Cannot parse 'moov' box.");
+        if (moov->extends.tracks.empty()) {
+          return Status(error::UNIMPLEMENTED,
+                        "Only fragmented MP4 inputs can be indexed.");
+        }
+        if (moov->tracks.empty())
+          return Status(error::PARSER_FAILURE, "No track found.");
+        // The first video track, or the first track.
+        const mp4::Track* track = &moov->tracks[0];
+        for (const mp4::Track& moov_track : moov->tracks) {
+          if (moov_track.media.handler.handler_type == FOURCC_vide) {
+            track = &moov_track;
+            break;
+          }
+        }
+        track_id = track->header.track_id;
+        index->time_scale = track->media.header.timescale;
+        index->header_size = position + box_size;
+        for (const mp4::TrackExtends& track_extends : moov->extends.tracks) {
+          if (track_extends.track_id == track_id)
+            trex = track_extends;
+        }
+      } else {
+        if (!moov)
+          return Status(error::PARSER_FAILURE, "'moof' found before 'moov'.");
+        mp4::MovieFragment moof;
+        if (!moof.Parse(reader.get()))
+          return Status(error::PARSER_FAILURE, "Cannot parse 'moof' box.");
+        for (const mp4::TrackFragment& traf : moof.tracks) {
+          if (traf.header.track_id != track_id)
+            continue;
+          // The demuxer parses the fragments at another position in its
+          // input, so the data offsets have to be relative to them.
+          if (traf.header.flags &
+              mp4::TrackFragmentHeader::kBaseDataOffsetPresentMask) {
+            return Status(error::UNIMPLEMENTED,
+                          "MP4 inputs with explicit base data offsets "
+                          "cannot be indexed.");
+          }
+          if (traf.runs.empty() || traf.decode_time_absent)
+            break;
+          uint32_t flags = trex.default_sample_flags;
+          if (!traf.runs[0].sample_flags.empty()) {
+            flags = traf.runs[0].sample_flags[0];
+          } else if (traf.header.flags & mp4::TrackFragmentHeader::
+                                             kDefaultSampleFlagsPresentMask) {
+            flags = traf.header.default_sample_flags;
+          }
+          if (!(flags & mp4::TrackFragmentHeader::kNonKeySampleMask)) {
+            AddKeyFrame(traf.decode_time.decode_time, position, index);
+          }
+          break;
+        }
+      }
+    }
+    position += box_size;
+  }
+  if (!moov)
+    return Status(error::PARSER_FAILURE, "No 'moov' box found.");
+  return Status::OK;
+}
+
+// Reads the value of an EBML variable size integer, e.g. a track number.
+// @return The size of the integer, or 0 on error.
+int ReadEbmlVint(const uint8_t* data, int size, int64_t* value) {
+  if (size < 1 || data[0] == 0)
+    return 0;
+  int length = 1;
+  while (!(data[0] & (0x80 >> (length - 1))))
+    ++length;
+  if (length > size)
+    return 0;
+  *value = data[0] & (0xFF >> length);
+  for (int i = 1; i < length; ++i)
+    *value = (*value << 8) | data[i];
+  return length;
+}
+
+// Parses the beginning of the content of a Cluster, for its timecode and for
+// whether its first block of |track_number| is a key frame.
+// @return false if not found in |data|.
+bool ParseClusterStart(const uint8_t* data,
+                       int size,
+                       int64_t track_number,
+                       int64_t* timecode,
+                       bool* is_key_frame) {
+  bool timecode_found = false;
+  while (size > 0) {
+    int id = 0;
+    int64_t element_size = 0;
+    const int header_size =
+        WebMParseElementHeader(data, size, &id, &element_size);
+    if (header_size <= 0 || element_size == kWebMUnknownSize)
+      return false;
+    // Only the header of a SimpleBlock is needed, so it can be truncated,
+    // e.g. a large key frame.
+    if (header_size + element_size > size && id != kWebMIdSimpleBlock)
+      return false;
+    const uint8_t* element = data + header_size;
+    const int element_data_size =
+        static_cast<int>(std::min<int64_t>(element_size, size - header_size));
+    data += header_size + element_data_size;
+    size -= header_size + element_data_size;
+
+    if (id == kWebMIdTimecode) {
+      *timecode = 0;
+      for (int i = 0; i < element_data_size; ++i)
+        *timecode = (*timecode << 8) | element[i];
+      timecode_found = true;
+      continue;
+    }
+
+    const uint8_t* block = nullptr;
+    int block_size = 0;
+    bool has_reference = false;
+    bool simple_block_key_frame = false;
+    if (id == kWebMIdSimpleBlock) {
+      block = element;
+      block_size = element_data_size;
+    } else if (id == kWebMIdBlockGroup) {
+      // A Block without ReferenceBlock is a key frame.
+      const uint8_t* child = element;
+      int child_size = element_data_size;
+      while (child_size > 0) {
+        int child_id = 0;
+        int64_t child_element_size = 0;
+        const int child_header_size = WebMParseElementHeader(
+            child, child_size, &child_id, &child_element_size);
+        if (child_header_size <= 0 ||
+            child_header_size + child_element_size > child_size) {
+          return false;
+        }
+        if (child_id == kWebMIdBlock) {
+          block = child + child_header_size;
+          block_size = static_cast<int>(child_element_size);
+        } else if (child_id == kWebMIdReferenceBlock) {
+          has_reference = true;
+        }
+        child += child_header_size + child_element_size;
+        child_size -= child_header_size + child_element_size;
+      }
+    } else {
+      continue;
+    }
+    if (!block)
+      continue;
+
+    int64_t block_track_number = 0;
+    const int track_number_size =
+        ReadEbmlVint(block, block_size, &block_track_number);
+    // The track number is followed by a 16-bit timecode and the flags.
+    if (track_number_size == 0 || track_number_size + 3 > block_size)
+      return false;
+    if (block_track_number != track_number)
+      continue;
+    if (!timecode_found)
+      return false;
+    const int16_t block_timecode = static_cast<int16_t>(
+        (block[track_number_size] << 8) | block[track_number_size + 1]);
+    simple_block_key_frame = (block[track_number_size + 2] & 0x80) != 0;
+    *timecode += block_timecode;
+    *is_key_frame =
+        id == kWebMIdSimpleBlock ? simple_block_key_frame : !has_reference;
+    return true;
+  }
+  return false;
+}
+
+Status ScanWebM(File* file, KeyFrameIndex* index) {
+  const int64_t file_size = file->Size();
+  if (file_size < 0)
+    return Status(error::FILE_FAILURE, "Cannot get the size of the input.");
+
+  // Only the beginning of the clusters is read.
+  const int64_t kClusterProbeSize = 0x4000;
+  // The maximum size of an element header.
+  const int64_t kElementHeaderReadSize = 12;
+
+  int64_t timecode_scale = 0;
+  int64_t track_number = -1;
+  std::vector<uint8_t> buffer;
+  uint64_t position = 0;
+  while (position < static_cast<uint64_t>(file_size)) {
+    uint8_t header[kElementHeaderReadSize];
+    const int header_read_size = static_cast<int>(
+        std::min<uint64_t>(kElementHeaderReadSize, file_size - position));
+    int id = 0;
+    int64_t element_size = 0;
+    if (!ReadAt(file, position, header_read_size, header))
+      return Status(error::FILE_FAILURE, "Cannot read WebM element header.");
+    const int header_size =
+        WebMParseElementHeader(header, header_read_size, &id, &element_size);
+    if (header_size <= 0)
+      return Status(error::PARSER_FAILURE, "Cannot parse WebM element.");
+
+    if (id == kWebMIdSegment) {
+      // Look into the segment.
+      position += header_size;
+      continue;
+    }
+    if (element_size == kWebMUnknownSize) {
+      return Status(error::UNIMPLEMENTED,
+                    "WebM elements of unknown size cannot be indexed.");
+    }
+
+    switch (id) {
+      case kWebMIdInfo:
+      case kWebMIdTracks: {
+        buffer.resize(header_size + element_size);
+        if (!ReadAt(file, position, buffer.size(), buffer.data()))
+          return Status(error::FILE_FAILURE, "Cannot read WebM element.");
+        const int buffer_size = static_cast<int>(buffer.size());
+        if (id == kWebMIdInfo) {
+          WebMInfoParser info_parser;
+          if (info_parser.Parse(buffer.data(), buffer_size) <= 0)
+            return Status(error::PARSER_FAILURE, "Cannot parse WebM Info.");
+          timecode_scale = info_parser.timecode_scale();
+        } else {
+          WebMTracksParser tracks_parser(true);
+          if (tracks_parser.Parse(buffer.data(), buffer_size) <= 0)
+            return Status(error::PARSER_FAILURE, "Cannot parse WebM Tracks.");
+          track_number = tracks_parser.video_track_num() >= 0
+                             ? tracks_parser.video_track_num()
+                             : tracks_parser.audio_track_num();
+        }
+        break;
+      }
+      case kWebMIdCluster: {
+        if (timecode_scale <= 0 || track_number < 0) {
+          return Status(error::PARSER_FAILURE,
+                        "WebM Cluster found before Info and Tracks.");
+        }
+        if (index->header_size == 0)
+          index->header_size = position;
+        buffer.resize(std::min(element_size, kClusterProbeSize));
+        if (!ReadAt(file, position + header_size, buffer.size(),
+                    buffer.data())) {
+          return Status(error::FILE_FAILURE, "Cannot read WebM Cluster.");
+        }
+        int64_t timecode = 0;
+        bool is_key_frame = false;
+        if (ParseClusterStart(buffer.data(), static_cast<int>(buffer.size()),
+                              track_number, &timecode, &is_key_frame) &&
+            is_key_frame) {
+          // In microseconds.
+          AddKeyFrame(timecode * timecode_scale / 1000, position, index);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    position += header_size + element_size;
+  }
+  if (index->header_size == 0)
+    return Status(error::PARSER_FAILURE, "No WebM Cluster found.");
+  index->time_scale = 1000000;
+  return Status::OK;
+}
+
+bool IsTsVideoStreamType(uint8_t stream_type) {
+  // H.264 and H.265.
+  return stream_type == 0x1B || stream_type == 0x24;
+}
+
+bool IsTsAudioStreamType(uint8_t stream_type) {
+  // MPEG-1 audio, ADTS AAC, LATM AAC, AC-3 and E-AC-3.
+  return stream_type == 0x03 || stream_type == 0x04 || stream_type == 0x0F ||
+         stream_type == 0x11 || stream_type == 0x81 || stream_type == 0x87;
+}
+
+// @return true if the PES payload in |data| has an H.264 IDR or an H.265 IRAP
+//         NAL unit.
+bool HasKeyFrameNalu(uint8_t stream_type, const uint8_t* data, size_t size) {
+  for (size_t i = 0; i + 3 < size; ++i) {
+    if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1)
+      continue;
+    const uint8_t nalu_header = data[i + 3];
+    if (stream_type == 0x1B) {
+      if ((nalu_header & 0x1F) == 5)
+        return true;
+    } else {
+      const uint8_t nalu_type = (nalu_header >> 1) & 0x3F;
+      if (nalu_type >= 16 && nalu_type <= 21)
+        return true;
+    }
+  }
+  return false;
+}
+
+// Scans the TS packet headers for the PAT and PMT, then for the PES packets of
+// the first video stream, or of the first audio stream, starting with a key
+// frame.
+class TsKeyFrameScanner {
+ public:
+  explicit TsKeyFrameScanner(KeyFrameIndex* index) : index_(index) {}
+
+  void ProcessPacket(const uint8_t* packet, uint64_t offset) {
+    const bool payload_unit_start = (packet[1] & 0x40) != 0;
+    const int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+    const int adaptation_field_control = (packet[3] >> 4) & 0x3;
+    size_t payload_offset = 4;
+    bool random_access = false;
+    if (adaptation_field_control & 0x2) {
+      const uint8_t adaptation_field_length = packet[4];
+      random_access =
+          adaptation_field_length > 0 && (packet[5] & 0x40) != 0;
+      payload_offset += 1 + adaptation_field_length;
+    }
+    if (!(adaptation_field_control & 0x1) || !payload_unit_start ||
+        payload_offset >= kPacketSize) {
+      return;
+    }
+    const uint8_t* payload = packet + payload_offset;
+    const size_t payload_size = kPacketSize - payload_offset;
+
+    if (pid == 0) {
+      ProcessPat(payload, payload_size);
+    } else if (pid == pmt_pid_ && es_pid_ < 0) {
+      if (ProcessPmt(payload, payload_size))
+        index_->header_size = offset + kPacketSize;
+    } else if (pid == es_pid_) {
+      ProcessPes(payload, payload_size, random_access, offset);
+    }
+  }
+
+  static const size_t kPacketSize = 188;
+
+ private:
+  // @return The section in a payload starting with a pointer field.
+  static const uint8_t* GetSection(const uint8_t* payload,
+                                   size_t payload_size,
+                                   size_t* section_size) {
+    const size_t pointer_field = payload[0];
+    if (1 + pointer_field + 3 > payload_size)
+      return nullptr;
+    const uint8_t* section = payload + 1 + pointer_field;
+    const size_t section_length = ((section[1] & 0x0F) << 8) | section[2];
+    // Only the sections in a single TS packet are supported.
+    if (1 + pointer_field + 3 + section_length > payload_size)
+      return nullptr;
+    *section_size = 3 + section_length;
+    return section;
+  }
+
+  void ProcessPat(const uint8_t* payload, size_t payload_size) {
+    size_t section_size = 0;
+    const uint8_t* section = GetSection(payload, payload_size, &section_size);
+    // 8 bytes of header and 4 bytes of CRC.
+    if (!section || section[0] != 0x00 || section_size < 12)
+      return;
+    for (size_t i = 8; i + 4 <= section_size - 4; i += 4) {
+      const int program_number = (section[i] << 8) | section[i + 1];
+      if (program_number == 0)
+        continue;
+      pmt_pid_ = ((section[i + 2] & 0x1F) << 8) | section[i + 3];
+      return;
+    }
+  }
+
+  bool ProcessPmt(const uint8_t* payload, size_t payload_size) {
+    size_t section_size = 0;
+    const uint8_t* section = GetSection(payload, payload_size, &section_size);
+    if (!section || section[0] != 0x02 || section_size < 16)
+      return false;
+    const size_t program_info_length =
+        ((section[10] & 0x0F) << 8) | section[11];
+    int audio_pid = -1;
+    uint8_t audio_stream_type = 0;
+    for (size_t i = 12 + program_info_length; i + 5 <= section_size - 4;) {
+      const uint8_t stream_type = section[i];
+      const int pid = ((section[i + 1] & 0x1F) << 8) | section[i + 2];
+      const size_t es_info_length =
+          ((section[i + 3] & 0x0F) << 8) | section[i + 4];
+      if (IsTsVideoStreamType(stream_type)) {
+        es_pid_ = pid;
+        stream_type_ = stream_type;
+        return true;
+      }
+      if (audio_pid < 0 && IsTsAudioStreamType(stream_type)) {
+        audio_pid = pid;
+        audio_stream_type = stream_type;
+      }
+      i += 5 + es_info_length;
+    }
+    if (audio_pid < 0)
+      return false;
+    es_pid_ = audio_pid;
+    stream_type_ = audio_stream_type;
+    return true;
+  }
+
+  void ProcessPes(const uint8_t* payload,
+                  size_t payload_size,
+                  bool random_access,
+                  uint64_t offset) {
+    // Start code, stream id, PES packet length, two bytes of flags, header
+    // data length and a PTS.
+    const size_t kPesHeaderWithPtsSize = 14;
+    if (payload_size < kPesHeaderWithPtsSize || payload[0] != 0 ||
+        payload[1] != 0 || payload[2] != 1) {
+      return;
+    }
+    const bool has_pts = (payload[7] & 0x80) != 0;
+    if (!has_pts)
+      return;
+    const uint8_t* pts_data = payload + 9;
+    const uint64_t pts = (static_cast<uint64_t>((pts_data[0] >> 1) & 0x07)
+                          << 30) |
+                         (pts_data[1] << 22) | ((pts_data[2] >> 1) << 15) |
+                         (pts_data[3] << 7) | (pts_data[4] >> 1);
+    const int64_t timestamp = UnrollPts(pts);
+
+    const size_t es_offset = 9 + payload[8];
+    bool is_key_frame = true;
+    if (IsTsVideoStreamType(stream_type_)) {
+      is_key_frame =
+          random_access ||
+          (es_offset < payload_size &&
+           HasKeyFrameNalu(stream_type_, payload + es_offset,
+                           payload_size - es_offset));
+    } else if (!index_->entries.empty() &&
+               timestamp - index_->entries.back().timestamp <
+                   kMinAudioKeyFrameInterval) {
+      // Every audio frame is a key frame. Index one per second.
+      is_key_frame = false;
+    }
+    if (is_key_frame)
+      AddKeyFrame(timestamp, offset, index_);
+  }
+
+  // Removes the 33-bit wrap around of |pts|.
+  int64_t UnrollPts(uint64_t pts) {
+    const int64_t kWrapAround = 1LL << 33;
+    if (previous_timestamp_ < 0) {
+      previous_timestamp_ = pts;
+      return previous_timestamp_;
+    }
+    int64_t timestamp =
+        (previous_timestamp_ & ~(kWrapAround - 1)) + static_cast<int64_t>(pts);
+    if (timestamp - previous_timestamp_ > kWrapAround / 2)
+      timestamp -= kWrapAround;
+    else if (previous_timestamp_ - timestamp > kWrapAround / 2)
+      timestamp += kWrapAround;
+    previous_timestamp_ = timestamp;
+    return timestamp;
+  }
+
+  // One second, in 90 kHz units.
+  static const int64_t kMinAudioKeyFrameInterval = 90000;
+
+  KeyFrameIndex* index_;
+  int pmt_pid_ = -1;
+  int es_pid_ = -1;
+  uint8_t stream_type_ = 0;
+  int64_t previous_timestamp_ = -1;
+};
+
+Status ScanMpeg2Ts(File* file, KeyFrameIndex* index) {
+  const size_t kPacketSize = TsKeyFrameScanner::kPacketSize;
+  const uint8_t kSyncByte = 0x47;
+  const size_t kReadSize = kPacketSize * 4096;
+
+  TsKeyFrameScanner scanner(index);
+  std::vector<uint8_t> buffer(kReadSize);
+  size_t buffer_size = 0;
+  // The offset of the first byte of |buffer| in the input.
+  uint64_t buffer_offset = 0;
+  if (!file->Seek(0))
+    return Status(error::FILE_FAILURE, "Cannot seek the input.");
+  while (true) {
+    const int64_t bytes_read =
+        file->Read(buffer.data() + buffer_size, kReadSize - buffer_size);
+    if (bytes_read < 0)
+      return Status(error::FILE_FAILURE, "Cannot read the input.");
+    if (bytes_read == 0)
+      break;
+    buffer_size += bytes_read;
+
+    size_t position = 0;
+    while (position + kPacketSize <= buffer_size) {
+      if (buffer[position] != kSyncByte) {
+        // Resynchronize on the next sync byte.
+        const void* sync = memchr(&buffer[position + 1], kSyncByte,
+                                  buffer_size - position - 1);
+        position = sync ? static_cast<const uint8_t*>(sync) - buffer.data()
+                        : buffer_size;
+        continue;
+      }
+      scanner.ProcessPacket(&buffer[position], buffer_offset + position);
+      position += kPacketSize;
+    }
+    memmove(buffer.data(), buffer.data() + position, buffer_size - position);
+    buffer_size -= position;
+    buffer_offset += position;
+  }
+  if (index->header_size == 0)
+    return Status(error::PARSER_FAILURE, "No PMT with audio or video found.");
+  index->time_scale = 90000;
+  return Status::OK;
+}
+
+}  // namespace
+
+Status ScanKeyFrames(const std::string& file_name,
+                     KeyFrameIndex* key_frame_index) {
+  DCHECK(key_frame_index);
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name.c_str(), "r"));
+  if (!file)
+    return Status(error::FILE_FAILURE, "Cannot open file " + file_name);
+
+  std::vector<uint8_t> probe(kProbeSize);
+  int64_t probe_size = 0;
+  while (probe_size < static_cast<int64_t>(probe.size())) {
+    const int64_t bytes_read =
+        file->Read(probe.data() + probe_size, probe.size() - probe_size);
+    if (bytes_read < 0)
+      return Status(error::FILE_FAILURE, "Cannot read file " + file_name);
+    if (bytes_read == 0)
+      break;
+    probe_size += bytes_read;
+  }
+
+  *key_frame_index = KeyFrameIndex();
+  key_frame_index->container = DetermineContainer(probe.data(), probe_size);
+  switch (key_frame_index->container) {
+    case CONTAINER_MOV:
+      return ScanMp4(file.get(), key_frame_index);
+    case CONTAINER_MPEG2TS:
+      return ScanMpeg2Ts(file.get(), key_frame_index);
+    case CONTAINER_WEBM:
+      return ScanWebM(file.get(), key_frame_index);
+    default:
+      return Status(error::UNIMPLEMENTED,
+                    "Only MP4, MPEG-2 TS and WebM inputs can be indexed.");
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,37 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_DEMUXER_KEY_FRAME_SCANNER_H_
+#define PACKAGER_MEDIA_DEMUXER_KEY_FRAME_SCANNER_H_
+
+#include <string>
+
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+struct KeyFrameIndex;
+
+/// Builds the key frame index of an input with a cheap scan of its container
+/// structures, without parsing the elementary streams:
+/// - fragmented MP4: the 'moof' boxes, the media data is skipped;
+/// - WebM: the beginning of each Cluster, the rest is skipped;
+/// - MPEG-2 TS: the TS and PES packet headers.
+/// The key frames are the ones of the first video stream, or of the first
+/// audio stream if there is no video stream.
+/// Non-fragmented MP4 inputs are not supported: their samples are already
+/// located by the 'moov' box.
+/// @param file_name is the input to index.
+/// @param[out] key_frame_index is the index of the input on success.
+/// @return OK on success.
+Status ScanKeyFrames(const std::string& file_name,
+                     KeyFrameIndex* key_frame_index);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_DEMUXER_KEY_FRAME_SCANNER_H_
@@ -0,0 +1,79 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/key_frame_scanner.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/media/demuxer/key_frame_index.h"
+#include "packager/media/test/test_data_util.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+void ExpectIncreasing(const KeyFrameIndex& index) {
+  for (size_t i = 1; i < index.entries.size(); ++i) {
+    EXPECT_LT(index.entries[i - 1].timestamp, index.entries[i].timestamp);
+    EXPECT_LT(index.entries[i - 1].offset, index.entries[i].offset);
+  }
+  if (!index.entries.empty())
+    EXPECT_GE(index.entries[0].offset, index.header_size);
+}
+
+}  // namespace
+
+TEST(KeyFrameScannerTest, Mpeg2Ts) {
+  KeyFrameIndex index;
+  ASSERT_OK(ScanKeyFrames(GetTestDataFilePath("bear-640x360.ts").AsUTF8Unsafe(),
+                          &index));
+  EXPECT_EQ(CONTAINER_MPEG2TS, index.container);
+  EXPECT_EQ(90000u, index.time_scale);
+  EXPECT_GT(index.header_size, 0u);
+  EXPECT_GT(index.entries.size(), 1u);
+  ExpectIncreasing(index);
+}
+
+TEST(KeyFrameScannerTest, WebM) {
+  KeyFrameIndex index;
+  ASSERT_OK(ScanKeyFrames(
+      GetTestDataFilePath("bear-640x360.webm").AsUTF8Unsafe(), &index));
+  EXPECT_EQ(CONTAINER_WEBM, index.container);
+  EXPECT_EQ(1000000u, index.time_scale);
+  EXPECT_GT(index.header_size, 0u);
+  ASSERT_FALSE(index.entries.empty());
+  EXPECT_EQ(index.header_size, index.entries[0].offset);
+  ExpectIncreasing(index);
+}
+
+TEST(KeyFrameScannerTest, FragmentedMp4) {
+  KeyFrameIndex index;
+  ASSERT_OK(ScanKeyFrames(
+      GetTestDataFilePath("bear-640x360-av_frag.mp4").AsUTF8Unsafe(), &index));
+  EXPECT_EQ(CONTAINER_MOV, index.container);
+  EXPECT_GT(index.time_scale, 0u);
+  EXPECT_GT(index.header_size, 0u);
+  ASSERT_FALSE(index.entries.empty());
+  ExpectIncreasing(index);
+}
+
+TEST(KeyFrameScannerTest, NonFragmentedMp4) {
+  KeyFrameIndex index;
+  EXPECT_EQ(error::UNIMPLEMENTED,
+            ScanKeyFrames(GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe(),
+                          &index)
+                .error_code());
+}
+
+TEST(KeyFrameScannerTest, FileNotFound) {
+  KeyFrameIndex index;
+  EXPECT_EQ(error::FILE_FAILURE,
+            ScanKeyFrames("file_not_exist.ts", &index).error_code());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -56,6 +56,12 @@ void CombinedMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
   }
 }
 
+void CombinedMuxerListener::OnSegmentEnd(base::TimeTicks last_sample_time) {
+  for (auto& listener : muxer_listeners_) {
+    listener->OnSegmentEnd(last_sample_time);
+  }
+}
+
 void CombinedMuxerListener::OnNewSegment(const std::string& file_name,
                                          int64_t start_time,
                                          int64_t duration,
@@ -65,6 +71,18 @@ void CombinedMuxerListener::OnNewSegment(const std::string& file_name,
   }
 }
 
+void CombinedMuxerListener::OnNewChunk(const std::string& segment_name,
+                                       uint32_t chunk_index,
+                                       int64_t start_time,
+                                       int64_t duration,
+                                       uint64_t start_byte_offset,
+                                       uint64_t size) {
+  for (auto& listener : muxer_listeners_) {
+    listener->OnNewChunk(segment_name, chunk_index, start_time, duration,
+                         start_byte_offset, size);
+  }
+}
+
 void CombinedMuxerListener::OnKeyFrame(int64_t timestamp,
                                        uint64_t start_byte_offset,
                                        uint64_t size) {
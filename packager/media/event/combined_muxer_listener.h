@@ -39,10 +39,17 @@ class CombinedMuxerListener : public MuxerListener {
   void OnSampleDurationReady(uint32_t sample_duration) override;
   void OnMediaEnd(const MediaRanges& media_ranges,
                   float duration_seconds) override;
+  void OnSegmentEnd(base::TimeTicks last_sample_time) override;
   void OnNewSegment(const std::string& file_name,
                     int64_t start_time,
                     int64_t duration,
                     uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  uint32_t chunk_index,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
   void OnKeyFrame(int64_t timestamp, uint64_t start_byte_offset, uint64_t size);
   void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
   /// @}
@@ -10,7 +10,9 @@
 #include "packager/base/logging.h"
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/base/protection_system_specific_info.h"
+#include "packager/media/event/metrics_muxer_listener.h"
 #include "packager/media/event/muxer_listener_internal.h"
 
 namespace shaka {
@@ -86,6 +88,7 @@ void HlsNotifyMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
                                           const StreamInfo& stream_info,
                                           uint32_t time_scale,
                                           ContainerType container_type) {
+  metrics_label_ = GetMetricsStreamLabel(muxer_options);
   std::unique_ptr<MediaInfo> media_info(new MediaInfo);
   if (!internal::GenerateMediaInfo(muxer_options, stream_info, time_scale,
                                    container_type, media_info.get())) {
@@ -225,6 +228,10 @@ void HlsNotifyMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
   event_info_.clear();
 }
 
+void HlsNotifyMuxerListener::OnSegmentEnd(base::TimeTicks last_sample_time) {
+  last_sample_time_ = last_sample_time;
+}
+
 void HlsNotifyMuxerListener::OnNewSegment(const std::string& file_name,
                                           int64_t start_time,
                                           int64_t duration,
@@ -241,7 +248,36 @@ void HlsNotifyMuxerListener::OnNewSegment(const std::string& file_name,
         stream_id_.value(), file_name, start_time, duration,
         kStartingByteOffset, segment_file_size);
     LOG_IF(WARNING, !result) << "Failed to add new segment.";
+    // The segment latency is measured on the main playlist of the stream.
+    if (result && !iframes_only_ && !last_sample_time_.is_null()) {
+      const std::string metrics_label = metrics_label_;
+      const base::TimeTicks last_sample_time = last_sample_time_;
+      hls_notifier_->RunAfterFlush([metrics_label, last_sample_time]() {
+        RecordSegmentLatency(metrics_label, "hls", last_sample_time);
+      });
+    }
+  }
+  last_sample_time_ = base::TimeTicks();
+}
+
+void HlsNotifyMuxerListener::OnNewChunk(const std::string& segment_name,
+                                        uint32_t chunk_index,
+                                        int64_t start_time,
+                                        int64_t duration,
+                                        uint64_t start_byte_offset,
+                                        uint64_t size) {
+  // The chunks are only listed in the playlists updated while the segments are
+  // written, i.e. with multisegment output, if they are shorter than the
+  // segments.
+  if (!media_info_->has_segment_template() ||
+      !media_info_->has_chunk_duration_seconds()) {
+    return;
   }
+  const bool result =
+      hls_notifier_->NotifyNewChunk(stream_id_.value(), segment_name,
+                                    start_time, duration, start_byte_offset,
+                                    size);
+  LOG_IF(WARNING, !result) << "Failed to add new chunk.";
 }
 
 void HlsNotifyMuxerListener::OnKeyFrame(int64_t timestamp,
@@ -64,10 +64,17 @@ class HlsNotifyMuxerListener : public MuxerListener {
   void OnSampleDurationReady(uint32_t sample_duration) override;
   void OnMediaEnd(const MediaRanges& media_ranges,
                   float duration_seconds) override;
+  void OnSegmentEnd(base::TimeTicks last_sample_time) override;
   void OnNewSegment(const std::string& file_name,
                     int64_t start_time,
                     int64_t duration,
                     uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  uint32_t chunk_index,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
   void OnKeyFrame(int64_t timestamp, uint64_t start_byte_offset, uint64_t size);
   void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
   /// @}
@@ -93,6 +100,11 @@ class HlsNotifyMuxerListener : public MuxerListener {
   std::vector<ProtectionSystemSpecificInfo> next_key_system_infos_;
   FourCC protection_scheme_ = FOURCC_NULL;
 
+  // Identifies the stream in the segment latency metrics.
+  std::string metrics_label_;
+  // When the last sample of the segment being finalized entered the muxer.
+  base::TimeTicks last_sample_time_;
+
   // MediaInfo passed to Notifier::OnNewStream(). Mainly for single segment
   // playlists.
   std::unique_ptr<MediaInfo> media_info_;
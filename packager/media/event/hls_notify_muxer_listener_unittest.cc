@@ -47,6 +47,13 @@ class MockHlsNotifier : public hls::HlsNotifier {
                     uint64_t duration,
                     uint64_t start_byte_offset,
                     uint64_t size));
+  MOCK_METHOD6(NotifyNewChunk,
+               bool(uint32_t stream_id,
+                    const std::string& segment_name,
+                    uint64_t start_time,
+                    uint64_t duration,
+                    uint64_t start_byte_offset,
+                    uint64_t size));
   MOCK_METHOD4(NotifyKeyFrame,
                bool(uint32_t stream_id,
                     uint64_t timestamp,
@@ -348,6 +355,49 @@ TEST_F(HlsNotifyMuxerListenerTest, OnNewSegmentAndCueEvent) {
                          kSegmentDuration, kSegmentSize);
 }
 
+TEST_F(HlsNotifyMuxerListenerTest, OnNewChunk) {
+  ON_CALL(mock_notifier_, NotifyNewStream(_, _, _, _, _))
+      .WillByDefault(Return(true));
+  VideoStreamInfoParameters video_params = GetDefaultVideoStreamInfoParams();
+  std::shared_ptr<StreamInfo> video_stream_info =
+      CreateVideoStreamInfo(video_params);
+  MuxerOptions muxer_options;
+  muxer_options.segment_template = "$Number$.mp4";
+  muxer_options.segment_duration_in_seconds = 2;
+  muxer_options.chunk_duration_in_seconds = 0.5;
+  listener_.OnMediaStart(muxer_options, *video_stream_info, 90000,
+                         MuxerListener::kContainerMp4);
+
+  const uint32_t kChunkIndex = 1;
+  const uint64_t kChunkOffset = 1000;
+  const uint64_t kChunkSize = 500;
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewChunk(_, StrEq("new_segment_name10.mp4"),
+                             kSegmentStartTime, kSegmentDuration, kChunkOffset,
+                             kChunkSize));
+  listener_.OnNewChunk("new_segment_name10.mp4", kChunkIndex,
+                       kSegmentStartTime, kSegmentDuration, kChunkOffset,
+                       kChunkSize);
+}
+
+// Verify that the chunks are not notified if the segments are not written in
+// chunks shorter than the segments.
+TEST_F(HlsNotifyMuxerListenerTest, OnNewChunkWithoutChunkDuration) {
+  ON_CALL(mock_notifier_, NotifyNewStream(_, _, _, _, _))
+      .WillByDefault(Return(true));
+  VideoStreamInfoParameters video_params = GetDefaultVideoStreamInfoParams();
+  std::shared_ptr<StreamInfo> video_stream_info =
+      CreateVideoStreamInfo(video_params);
+  MuxerOptions muxer_options;
+  muxer_options.segment_template = "$Number$.mp4";
+  listener_.OnMediaStart(muxer_options, *video_stream_info, 90000,
+                         MuxerListener::kContainerMp4);
+
+  EXPECT_CALL(mock_notifier_, NotifyNewChunk(_, _, _, _, _, _)).Times(0);
+  listener_.OnNewChunk("new_segment_name10.mp4", 0, kSegmentStartTime,
+                       kSegmentDuration, 0, kSegmentSize);
+}
+
 // Verify that the notifier is called for every segment in OnMediaEnd if
 // segment_template is not set.
 TEST_F(HlsNotifyMuxerListenerTest, NoSegmentTemplateOnMediaEnd) {
@@ -18,6 +18,10 @@
         'event_info.h',
         'hls_notify_muxer_listener.cc',
         'hls_notify_muxer_listener.h',
+        'media_info_writer.cc',
+        'media_info_writer.h',
+        'metrics_muxer_listener.cc',
+        'metrics_muxer_listener.h',
         'mpd_notify_muxer_listener.cc',
         'mpd_notify_muxer_listener.h',
         'multi_codec_muxer_listener.cc',
@@ -27,12 +31,18 @@
         'muxer_listener_factory.h',
         'muxer_listener_internal.cc',
         'muxer_listener_internal.h',
+        'ordered_muxer_listener.cc',
+        'ordered_muxer_listener.h',
+        'throttled_progress_listener.cc',
+        'throttled_progress_listener.h',
         'vod_media_info_dump_muxer_listener.cc',
         'vod_media_info_dump_muxer_listener.h',
       ],
       'dependencies': [
         '../../file/file.gyp:file',
+        '../../metrics/metrics.gyp:metrics',
         '../../mpd/mpd.gyp:media_info_proto',
+        '../../third_party/gflags/gflags.gyp:gflags',
         # Depends on full protobuf to read/write with TextFormat.
         '../../third_party/protobuf/protobuf.gyp:protobuf_full_do_not_use',
         '../base/media_base.gyp:media_base',
@@ -61,6 +71,8 @@
         'multi_codec_muxer_listener_unittest.cc',
         'muxer_listener_test_helper.cc',
         'muxer_listener_test_helper.h',
+        'ordered_muxer_listener_unittest.cc',
+        'throttled_progress_listener_unittest.cc',
         'vod_media_info_dump_muxer_listener_unittest.cc',
       ],
       'dependencies': [
@@ -69,6 +81,7 @@
         '../../mpd/mpd.gyp:mpd_mocks',
         '../../testing/gmock.gyp:gmock',
         '../../testing/gtest.gyp:gtest',
+        '../../third_party/gflags/gflags.gyp:gflags',
         # Depends on full protobuf to read/write with TextFormat.
         '../../third_party/protobuf/protobuf.gyp:protobuf_full_do_not_use',
         '../test/media_test.gyp:run_tests_with_atexit_manager',
@@ -0,0 +1,123 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/media_info_writer.h"
+
+#include <gflags/gflags.h>
+#include <google/protobuf/text_format.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/file.h"
+#include "packager/metrics/metrics.h"
+
+DEFINE_bool(binary_media_info,
+            false,
+            "Write the MediaInfo files, e.g. the --output_media_info files, in "
+            "the protobuf binary format instead of the human readable text "
+            "format. It is faster to write, and to read by mpd_generator, "
+            "which reads both formats.");
+
+namespace shaka {
+namespace media {
+
+MediaInfoWriter* MediaInfoWriter::GetInstance() {
+  static MediaInfoWriter instance;
+  return &instance;
+}
+
+MediaInfoWriter::MediaInfoWriter() : task_done_(&lock_) {
+  backlog_gauge_id_ = Metrics::GetInstance()->AddGaugeFunction(
+      "shaka_media_info_write_backlog",
+      "MediaInfo files queued for writing or being written.", {},
+      [this]() { return static_cast<double>(backlog()); });
+}
+
+MediaInfoWriter::~MediaInfoWriter() {
+  Flush();
+  Metrics::GetInstance()->RemoveGaugeFunction(backlog_gauge_id_);
+}
+
+void MediaInfoWriter::Write(const std::string& output_file_path,
+                            const MediaInfo& media_info) {
+  base::AutoLock scoped_lock(lock_);
+  pending_files_[output_file_path] = media_info;
+  if (task_running_)
+    return;
+  task_running_ = true;
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&MediaInfoWriter::WriteTask, base::Unretained(this)),
+      true /* task_is_slow */);
+}
+
+void MediaInfoWriter::Flush() {
+  base::AutoLock scoped_lock(lock_);
+  while (task_running_)
+    task_done_.Wait();
+}
+
+size_t MediaInfoWriter::backlog() const {
+  base::AutoLock scoped_lock(lock_);
+  return pending_files_.size() + num_files_in_progress_;
+}
+
+// static
+bool MediaInfoWriter::WriteToFile(const MediaInfo& media_info,
+                                  const std::string& output_file_path) {
+  std::string output_string;
+  if (FLAGS_binary_media_info) {
+    if (!media_info.SerializeToString(&output_string)) {
+      LOG(ERROR) << "Failed to serialize MediaInfo to string.";
+      return false;
+    }
+  } else if (!google::protobuf::TextFormat::PrintToString(media_info,
+                                                          &output_string)) {
+    LOG(ERROR) << "Failed to serialize MediaInfo to string.";
+    return false;
+  }
+
+  File* file = File::Open(output_file_path.c_str(), "w");
+  if (!file) {
+    LOG(ERROR) << "Failed to open " << output_file_path;
+    return false;
+  }
+  if (file->Write(output_string.data(), output_string.size()) <= 0) {
+    LOG(ERROR) << "Failed to write MediaInfo to file.";
+    file->Close();
+    return false;
+  }
+  if (!file->Close()) {
+    LOG(ERROR) << "Failed to close " << output_file_path;
+    return false;
+  }
+  return true;
+}
+
+void MediaInfoWriter::WriteTask() {
+  base::AutoLock scoped_lock(lock_);
+  while (!pending_files_.empty()) {
+    std::map<std::string, MediaInfo> batch;
+    batch.swap(pending_files_);
+    num_files_in_progress_ = batch.size();
+    {
+      base::AutoUnlock scoped_unlock(lock_);
+      for (const auto& file : batch) {
+        VLOG(2) << "Writing " << file.first;
+        WriteToFile(file.second, file.first);
+      }
+    }
+    num_files_in_progress_ = 0;
+  }
+  task_running_ = false;
+  task_done_.Broadcast();
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,71 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_MEDIA_INFO_WRITER_H_
+#define PACKAGER_MEDIA_EVENT_MEDIA_INFO_WRITER_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+namespace media {
+
+/// Serializes and writes the MediaInfo files, e.g. the --output_media_info
+/// files, on a background thread, so that the muxer threads do not wait for
+/// the serialization and the file writes when the media ends. They are
+/// written in the text format, or in the binary format with
+/// --binary_media_info, which is faster to write and to read by
+/// mpd_generator. Only the latest MediaInfo queued for a file is written.
+/// Thread safe.
+class MediaInfoWriter {
+ public:
+  /// @return the process-wide instance.
+  static MediaInfoWriter* GetInstance();
+
+  /// Queue @a media_info to be written to @a output_file_path.
+  void Write(const std::string& output_file_path, const MediaInfo& media_info);
+
+  /// Wait until the files queued are written, or failed to be written.
+  void Flush();
+
+  /// @return the number of files queued or being written.
+  size_t backlog() const;
+
+  /// Write @a media_info to @a output_file_path on the calling thread.
+  /// @return true on success, false otherwise.
+  static bool WriteToFile(const MediaInfo& media_info,
+                          const std::string& output_file_path);
+
+ private:
+  MediaInfoWriter();
+  ~MediaInfoWriter();
+
+  MediaInfoWriter(const MediaInfoWriter&) = delete;
+  MediaInfoWriter& operator=(const MediaInfoWriter&) = delete;
+
+  // Write the files queued, batch by batch, until there are none left.
+  void WriteTask();
+
+  mutable base::Lock lock_;
+  // Signaled when the background task finishes.
+  base::ConditionVariable task_done_;
+  // Output file path -> latest MediaInfo queued.
+  std::map<std::string, MediaInfo> pending_files_;
+  size_t num_files_in_progress_ = 0;
+  bool task_running_ = false;
+  int64_t backlog_gauge_id_ = 0;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_MEDIA_INFO_WRITER_H_
@@ -0,0 +1,86 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/metrics_muxer_listener.h"
+
+#include "packager/media/base/muxer_util.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace media {
+
+void RecordSegmentLatency(const std::string& stream_label,
+                          const char* stage,
+                          base::TimeTicks last_sample_time) {
+  Metrics::GetInstance()->ObserveLatency(
+      "shaka_segment_latency_seconds",
+      "Time from the last sample of a segment entering the muxer to the stage "
+      "of the segment: finalize when the muxer starts finalizing it, written "
+      "when its file is closed and it is notified, mpd or hls when a manifest "
+      "listing it is written.",
+      {{"stream", stream_label}, {"stage", stage}},
+      base::TimeTicks::Now() - last_sample_time);
+}
+
+void MetricsMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                        const StreamInfo& stream_info,
+                                        uint32_t time_scale,
+                                        ContainerType container_type) {
+  stream_label_ = GetMetricsStreamLabel(muxer_options);
+  time_scale_ = time_scale;
+}
+
+void MetricsMuxerListener::OnSegmentEnd(base::TimeTicks last_sample_time) {
+  last_sample_time_ = last_sample_time;
+  RecordSegmentLatency(stream_label_, "finalize", last_sample_time_);
+}
+
+void MetricsMuxerListener::OnNewSegment(const std::string& file_name,
+                                        int64_t start_time,
+                                        int64_t duration,
+                                        uint64_t segment_file_size) {
+  // The muxers close the segment file right before notifying the segment.
+  if (!last_sample_time_.is_null()) {
+    RecordSegmentLatency(stream_label_, "written", last_sample_time_);
+    last_sample_time_ = base::TimeTicks();
+  }
+
+  const MetricLabels labels = {{"stream", stream_label_}};
+  Metrics* metrics = Metrics::GetInstance();
+  metrics->IncrementCounter("shaka_segments", "Number of segments written.",
+                            labels, 1);
+  metrics->IncrementCounter("shaka_segment_bytes",
+                            "Number of bytes of the segments written.", labels,
+                            static_cast<double>(segment_file_size));
+  if (time_scale_ > 0) {
+    metrics->SetGauge(
+        "shaka_stream_media_time_seconds",
+        "End of the media written so far, in seconds of media time.", labels,
+        static_cast<double>(start_time + duration) / time_scale_);
+  }
+}
+
+void MetricsMuxerListener::OnNewChunk(const std::string& segment_name,
+                                      uint32_t chunk_index,
+                                      int64_t start_time,
+                                      int64_t duration,
+                                      uint64_t start_byte_offset,
+                                      uint64_t size) {
+  const MetricLabels labels = {{"stream", stream_label_}};
+  Metrics* metrics = Metrics::GetInstance();
+  metrics->IncrementCounter("shaka_chunks",
+                            "Number of low latency chunks written.", labels, 1);
+  // The media is available as soon as its chunk is written.
+  if (time_scale_ > 0) {
+    metrics->SetGauge(
+        "shaka_stream_media_time_seconds",
+        "End of the media written so far, in seconds of media time.", labels,
+        static_cast<double>(start_time + duration) / time_scale_);
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,80 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_METRICS_MUXER_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_METRICS_MUXER_LISTENER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+/// Record in the "shaka_segment_latency_seconds" histogram the time from
+/// @a last_sample_time, when the last sample of a segment of the stream
+/// @a stream_label entered the muxer, to now, when the segment reached
+/// @a stage.
+void RecordSegmentLatency(const std::string& stream_label,
+                          const char* stage,
+                          base::TimeTicks last_sample_time);
+
+/// Records the segments written by a muxer in the process-wide Metrics: the
+/// number of segments and low latency chunks, the number of bytes written, the
+/// end of the media written so far and the latency of the segments, labelled
+/// by the output of the stream.
+class MetricsMuxerListener : public MuxerListener {
+ public:
+  MetricsMuxerListener() = default;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override {}
+  void OnEncryptionStart() override {}
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override {}
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override {}
+  void OnSegmentEnd(base::TimeTicks last_sample_time) override;
+  void OnNewSegment(const std::string& file_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  uint32_t chunk_index,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override {}
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override {}
+  /// @}
+
+ private:
+  MetricsMuxerListener(const MetricsMuxerListener&) = delete;
+  MetricsMuxerListener& operator=(const MetricsMuxerListener&) = delete;
+
+  std::string stream_label_;
+  uint32_t time_scale_ = 0;
+  // When the last sample of the segment being finalized entered the muxer.
+  base::TimeTicks last_sample_time_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_METRICS_MUXER_LISTENER_H_
@@ -12,6 +12,8 @@
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/video_stream_info.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/event/metrics_muxer_listener.h"
 #include "packager/media/event/muxer_listener_internal.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_notifier.h"
@@ -62,6 +64,7 @@ void MpdNotifyMuxerListener::OnMediaStart(
     const StreamInfo& stream_info,
     uint32_t time_scale,
     ContainerType container_type) {
+  metrics_label_ = GetMetricsStreamLabel(muxer_options);
   std::unique_ptr<MediaInfo> media_info(new MediaInfo());
   if (!internal::GenerateMediaInfo(muxer_options,
                                    stream_info,
@@ -178,6 +181,10 @@ void MpdNotifyMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
   mpd_notifier_->Flush();
 }
 
+void MpdNotifyMuxerListener::OnSegmentEnd(base::TimeTicks last_sample_time) {
+  last_sample_time_ = last_sample_time;
+}
+
 void MpdNotifyMuxerListener::OnNewSegment(const std::string& file_name,
                                           int64_t start_time,
                                           int64_t duration,
@@ -185,8 +192,17 @@ void MpdNotifyMuxerListener::OnNewSegment(const std::string& file_name,
   if (mpd_notifier_->dash_profile() == DashProfile::kLive) {
     mpd_notifier_->NotifyNewSegment(notification_id_.value(), start_time,
                                     duration, segment_file_size);
-    if (mpd_notifier_->mpd_type() == MpdType::kDynamic)
-      mpd_notifier_->Flush();
+    if (mpd_notifier_->mpd_type() == MpdType::kDynamic) {
+      if (!last_sample_time_.is_null()) {
+        const std::string metrics_label = metrics_label_;
+        const base::TimeTicks last_sample_time = last_sample_time_;
+        mpd_notifier_->RunAfterFlush([metrics_label, last_sample_time]() {
+          RecordSegmentLatency(metrics_label, "mpd", last_sample_time);
+        });
+        last_sample_time_ = base::TimeTicks();
+      }
+      mpd_notifier_->RequestFlush();
+    }
   } else {
     EventInfo event_info;
     event_info.type = EventInfoType::kSegment;
@@ -47,6 +47,7 @@ class MpdNotifyMuxerListener : public MuxerListener {
   void OnSampleDurationReady(uint32_t sample_duration) override;
   void OnMediaEnd(const MediaRanges& media_ranges,
                   float duration_seconds) override;
+  void OnSegmentEnd(base::TimeTicks last_sample_time) override;
   void OnNewSegment(const std::string& file_name,
                     int64_t start_time,
                     int64_t duration,
@@ -74,6 +75,11 @@ class MpdNotifyMuxerListener : public MuxerListener {
   std::vector<std::string> accessibilities_;
   std::vector<std::string> roles_;
 
+  // Identifies the stream in the segment latency metrics.
+  std::string metrics_label_;
+  // When the last sample of the segment being finalized entered the muxer.
+  base::TimeTicks last_sample_time_;
+
   bool is_encrypted_ = false;
   // Storage for values passed to OnEncryptionInfoReady().
   FourCC protection_scheme_ = FOURCC_NULL;
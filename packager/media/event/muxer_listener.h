@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "packager/base/optional.h"
+#include "packager/base/time/time.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/range.h"
 
@@ -113,6 +114,12 @@ class MuxerListener {
   virtual void OnMediaEnd(const MediaRanges& media_ranges,
                           float duration_seconds) = 0;
 
+  /// Called when the muxer starts finalizing a segment, before the segment is
+  /// written and OnNewSegment() is called on it.
+  /// @param last_sample_time is when the last sample of the segment entered
+  ///        the muxer.
+  virtual void OnSegmentEnd(base::TimeTicks last_sample_time) {}
+
   /// Called when a segment has been muxed and the file has been written.
   /// Note: For some implementations, this is used to signal new subsegments.
   /// For example, for generating video on demand (VOD) MPD manifest, this is
@@ -129,6 +136,24 @@ class MuxerListener {
                             int64_t duration,
                             uint64_t segment_file_size) = 0;
 
+  /// Called when a chunk of a segment has been written, before the segment is
+  /// complete, with low latency chunked output. It is called before
+  /// OnNewSegment is called on the containing segment.
+  /// @param segment_name is the name of the segment containing the chunk.
+  /// @param chunk_index is the index of the chunk in the segment, starting
+  ///        from 0.
+  /// @param start_time is the start time of the chunk, relative to the
+  ///        timescale specified by MediaInfo passed to OnMediaStart().
+  /// @param duration is the duration of the chunk, in the same timescale.
+  /// @param start_byte_offset is the offset of the chunk in the segment.
+  /// @param size is the chunk size in bytes.
+  virtual void OnNewChunk(const std::string& segment_name,
+                          uint32_t chunk_index,
+                          int64_t start_time,
+                          int64_t duration,
+                          uint64_t start_byte_offset,
+                          uint64_t size) {}
+
   /// Called when there is a new key frame. For Video only. Note that it should
   /// be called before OnNewSegment is called on the containing segment.
   /// @param timestamp is in terms of the timescale of the media.
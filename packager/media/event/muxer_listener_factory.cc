@@ -13,9 +13,11 @@
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/media/event/combined_muxer_listener.h"
 #include "packager/media/event/hls_notify_muxer_listener.h"
+#include "packager/media/event/metrics_muxer_listener.h"
 #include "packager/media/event/mpd_notify_muxer_listener.h"
 #include "packager/media/event/multi_codec_muxer_listener.h"
 #include "packager/media/event/muxer_listener.h"
+#include "packager/media/event/ordered_muxer_listener.h"
 #include "packager/media/event/vod_media_info_dump_muxer_listener.h"
 #include "packager/mpd/base/mpd_notifier.h"
 
@@ -81,10 +83,14 @@ std::list<std::unique_ptr<MuxerListener>> CreateHlsListenersInternal(
 
 MuxerListenerFactory::MuxerListenerFactory(bool output_media_info,
                                            MpdNotifier* mpd_notifier,
-                                           hls::HlsNotifier* hls_notifier)
+                                           hls::HlsNotifier* hls_notifier,
+                                           bool ordered_notifications)
     : output_media_info_(output_media_info),
       mpd_notifier_(mpd_notifier),
-      hls_notifier_(hls_notifier) {}
+      hls_notifier_(hls_notifier) {
+  if (ordered_notifications && (mpd_notifier_ || hls_notifier_))
+    sequencer_ = std::make_shared<MuxerListenerSequencer>();
+}
 
 std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateListener(
     const StreamData& stream) {
@@ -121,7 +127,18 @@ std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateListener(
     multi_codec_listener->AddListener(std::move(combined_listener));
   }
 
-  return std::move(multi_codec_listener);
+  // The metrics are recorded outside of the MultiCodecMuxerListener so the
+  // segments of multi-codec streams are only counted once.
+  std::unique_ptr<CombinedMuxerListener> listener(new CombinedMuxerListener);
+  if (sequencer_) {
+    listener->AddListener(std::unique_ptr<MuxerListener>(
+        new OrderedMuxerListener(sequencer_, std::move(multi_codec_listener))));
+  } else {
+    listener->AddListener(std::move(multi_codec_listener));
+  }
+  listener->AddListener(
+      std::unique_ptr<MuxerListener>(new MetricsMuxerListener));
+  return std::move(listener);
 }
 
 std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateHlsListener(
@@ -131,8 +148,12 @@ std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateHlsListener(
   }
 
   const int stream_index = stream_index_++;
-  return std::move(
+  std::unique_ptr<MuxerListener> listener = std::move(
       CreateHlsListenersInternal(stream, stream_index, hls_notifier_).front());
+  if (sequencer_) {
+    listener.reset(new OrderedMuxerListener(sequencer_, std::move(listener)));
+  }
+  return listener;
 }
 
 }  // namespace media
@@ -20,6 +20,7 @@ class HlsNotifier;
 
 namespace media {
 class MuxerListener;
+class MuxerListenerSequencer;
 
 /// Factory class for creating MuxerListeners. Will produce a single muxer
 /// listener that will wrap the various muxer listeners that the factory
@@ -62,9 +63,14 @@ class MuxerListenerFactory {
   ///        mpd listener.
   /// @param hls_notifier must be non-null for the combined listener to include
   ///        an HLS listener.
+  /// @param ordered_notifications is true if the notifiers should register
+  ///        the streams in the order their listeners are created, instead of
+  ///        the order the streams start or end, so the manifests do not depend
+  ///        on the thread scheduling. See MuxerListenerSequencer.
   MuxerListenerFactory(bool output_media_info,
                        MpdNotifier* mpd_notifier,
-                       hls::HlsNotifier* hls_notifier);
+                       hls::HlsNotifier* hls_notifier,
+                       bool ordered_notifications);
 
   /// Create a listener for a stream.
   std::unique_ptr<MuxerListener> CreateListener(const StreamData& stream);
@@ -80,6 +86,8 @@ class MuxerListenerFactory {
   bool output_media_info_;
   MpdNotifier* mpd_notifier_;
   hls::HlsNotifier* hls_notifier_;
+  // Shared by the listeners created, if the notifications are ordered.
+  std::shared_ptr<MuxerListenerSequencer> sequencer_;
 
   // A counter to track which stream we are on.
   int stream_index_ = 0;
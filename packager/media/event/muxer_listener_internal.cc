@@ -199,6 +199,13 @@ void SetMediaInfoMuxerOptions(const MuxerOptions& muxer_options,
     if (!muxer_options.output_file_name.empty())
       media_info->set_init_segment_name(muxer_options.output_file_name);
     media_info->set_segment_template(muxer_options.segment_template);
+    if (muxer_options.chunk_duration_in_seconds > 0) {
+      media_info->set_chunk_duration_seconds(
+          muxer_options.chunk_duration_in_seconds);
+      media_info->set_availability_time_offset_seconds(
+          muxer_options.segment_duration_in_seconds -
+          muxer_options.chunk_duration_in_seconds);
+    }
   }
 }
 
@@ -0,0 +1,223 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/ordered_muxer_listener.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/protection_system_specific_info.h"
+#include "packager/media/base/stream_info.h"
+
+namespace shaka {
+namespace media {
+
+MuxerListenerSequencer::MuxerListenerSequencer() {}
+
+MuxerListenerSequencer::~MuxerListenerSequencer() {}
+
+size_t MuxerListenerSequencer::AddListener(MuxerListener* listener) {
+  DCHECK(listener);
+  base::AutoLock auto_lock(lock_);
+  slots_.emplace_back();
+  slots_.back().listener = listener;
+  return slots_.size() - 1;
+}
+
+void MuxerListenerSequencer::Post(size_t slot, EventType type, Event event) {
+  base::AutoLock auto_lock(lock_);
+  DCHECK_LT(slot, slots_.size());
+  Slot& current_slot = slots_[slot];
+  DCHECK(!current_slot.removed);
+  current_slot.pending_events.push_back({type, std::move(event)});
+  DeliverPendingEventsLocked();
+}
+
+void MuxerListenerSequencer::RemoveListener(size_t slot) {
+  base::AutoLock auto_lock(lock_);
+  DCHECK_LT(slot, slots_.size());
+  Slot& current_slot = slots_[slot];
+  if (!current_slot.pending_events.empty()) {
+    LOG(WARNING) << "Forwarding " << current_slot.pending_events.size()
+                 << " held muxer events out of order.";
+  }
+  while (!current_slot.pending_events.empty()) {
+    PendingEvent pending_event = std::move(current_slot.pending_events.front());
+    current_slot.pending_events.pop_front();
+    DeliverLocked(&current_slot, &pending_event);
+  }
+  current_slot.removed = true;
+  current_slot.listener = nullptr;
+  DeliverPendingEventsLocked();
+}
+
+bool MuxerListenerSequencer::CanDeliverLocked(size_t slot,
+                                              EventType type) const {
+  lock_.AssertAcquired();
+  if (type == EventType::kOther)
+    return true;
+  if (type == EventType::kMediaStart && slots_[slot].started)
+    return true;
+  if (type == EventType::kMediaEnd && slots_[slot].ended)
+    return true;
+
+  for (size_t i = 0; i < slot; ++i) {
+    const Slot& previous_slot = slots_[i];
+    if (previous_slot.removed)
+      continue;
+    const bool done = type == EventType::kMediaStart ? previous_slot.started
+                                                     : previous_slot.ended;
+    if (!done)
+      return false;
+  }
+  return true;
+}
+
+void MuxerListenerSequencer::DeliverLocked(Slot* slot,
+                                           PendingEvent* pending_event) {
+  lock_.AssertAcquired();
+  if (pending_event->type == EventType::kMediaStart) {
+    slot->started = true;
+  } else if (pending_event->type == EventType::kMediaEnd) {
+    // A listener may end without having started, e.g. if there was no
+    // sample; it does not hold back the other listeners then.
+    slot->started = true;
+    slot->ended = true;
+  }
+  pending_event->event(slot->listener);
+}
+
+void MuxerListenerSequencer::DeliverPendingEventsLocked() {
+  lock_.AssertAcquired();
+  // A slot only waits for the slots before it, so the slots unblocked by a
+  // delivery are all visited later in the same pass.
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    Slot& slot = slots_[i];
+    while (!slot.pending_events.empty() &&
+           CanDeliverLocked(i, slot.pending_events.front().type)) {
+      PendingEvent pending_event = std::move(slot.pending_events.front());
+      slot.pending_events.pop_front();
+      DeliverLocked(&slot, &pending_event);
+    }
+  }
+}
+
+OrderedMuxerListener::OrderedMuxerListener(
+    std::shared_ptr<MuxerListenerSequencer> sequencer,
+    std::unique_ptr<MuxerListener> listener)
+    : sequencer_(std::move(sequencer)), listener_(std::move(listener)) {
+  DCHECK(sequencer_);
+  slot_ = sequencer_->AddListener(listener_.get());
+}
+
+OrderedMuxerListener::~OrderedMuxerListener() {
+  sequencer_->RemoveListener(slot_);
+}
+
+void OrderedMuxerListener::OnEncryptionInfoReady(
+    bool is_initial_encryption_info,
+    FourCC protection_scheme,
+    const std::vector<uint8_t>& key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<ProtectionSystemSpecificInfo>& key_system_info) {
+  sequencer_->Post(
+      slot_, MuxerListenerSequencer::EventType::kOther,
+      [is_initial_encryption_info, protection_scheme, key_id, iv,
+       key_system_info](MuxerListener* listener) {
+        listener->OnEncryptionInfoReady(is_initial_encryption_info,
+                                        protection_scheme, key_id, iv,
+                                        key_system_info);
+      });
+}
+
+void OrderedMuxerListener::OnEncryptionStart() {
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kOther,
+                   [](MuxerListener* listener) {
+                     listener->OnEncryptionStart();
+                   });
+}
+
+void OrderedMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                        const StreamInfo& stream_info,
+                                        uint32_t time_scale,
+                                        ContainerType container_type) {
+  std::shared_ptr<StreamInfo> stream_info_copy = stream_info.Clone();
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kMediaStart,
+                   [muxer_options, stream_info_copy, time_scale,
+                    container_type](MuxerListener* listener) {
+                     listener->OnMediaStart(muxer_options, *stream_info_copy,
+                                            time_scale, container_type);
+                   });
+}
+
+void OrderedMuxerListener::OnSampleDurationReady(uint32_t sample_duration) {
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kOther,
+                   [sample_duration](MuxerListener* listener) {
+                     listener->OnSampleDurationReady(sample_duration);
+                   });
+}
+
+void OrderedMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
+                                      float duration_seconds) {
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kMediaEnd,
+                   [media_ranges, duration_seconds](MuxerListener* listener) {
+                     listener->OnMediaEnd(media_ranges, duration_seconds);
+                   });
+}
+
+void OrderedMuxerListener::OnSegmentEnd(base::TimeTicks last_sample_time) {
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kOther,
+                   [last_sample_time](MuxerListener* listener) {
+                     listener->OnSegmentEnd(last_sample_time);
+                   });
+}
+
+void OrderedMuxerListener::OnNewSegment(const std::string& file_name,
+                                        int64_t start_time,
+                                        int64_t duration,
+                                        uint64_t segment_file_size) {
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kOther,
+                   [file_name, start_time, duration,
+                    segment_file_size](MuxerListener* listener) {
+                     listener->OnNewSegment(file_name, start_time, duration,
+                                            segment_file_size);
+                   });
+}
+
+void OrderedMuxerListener::OnNewChunk(const std::string& segment_name,
+                                      uint32_t chunk_index,
+                                      int64_t start_time,
+                                      int64_t duration,
+                                      uint64_t start_byte_offset,
+                                      uint64_t size) {
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kOther,
+                   [segment_name, chunk_index, start_time, duration,
+                    start_byte_offset, size](MuxerListener* listener) {
+                     listener->OnNewChunk(segment_name, chunk_index,
+                                          start_time, duration,
+                                          start_byte_offset, size);
+                   });
+}
+
+void OrderedMuxerListener::OnKeyFrame(int64_t timestamp,
+                                      uint64_t start_byte_offset,
+                                      uint64_t size) {
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kOther,
+                   [timestamp, start_byte_offset, size](
+                       MuxerListener* listener) {
+                     listener->OnKeyFrame(timestamp, start_byte_offset, size);
+                   });
+}
+
+void OrderedMuxerListener::OnCueEvent(int64_t timestamp,
+                                      const std::string& cue_data) {
+  sequencer_->Post(slot_, MuxerListenerSequencer::EventType::kOther,
+                   [timestamp, cue_data](MuxerListener* listener) {
+                     listener->OnCueEvent(timestamp, cue_data);
+                   });
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,136 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_ORDERED_MUXER_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_ORDERED_MUXER_LISTENER_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+/// Orders the events of the OrderedMuxerListeners that share it. The first
+/// OnMediaStart() of a listener is forwarded only after the first
+/// OnMediaStart() of every listener added before it, and the same applies to
+/// OnMediaEnd(). The events that follow a held event are held with it, so
+/// each listener still receives its events in the original order.
+/// The manifest notifiers register an output, i.e. assign its Representation,
+/// AdaptationSet or playlist ids and order, when one of these two events is
+/// received. With streams running on their own threads, this makes the
+/// manifests depend on the order the listeners were added rather than on the
+/// thread scheduling. Events are only held, never waited for, so the muxers
+/// are not blocked.
+class MuxerListenerSequencer {
+ public:
+  MuxerListenerSequencer();
+  ~MuxerListenerSequencer();
+
+ private:
+  friend class OrderedMuxerListener;
+
+  enum class EventType { kMediaStart, kMediaEnd, kOther };
+  typedef std::function<void(MuxerListener*)> Event;
+
+  struct PendingEvent {
+    EventType type;
+    Event event;
+  };
+
+  struct Slot {
+    MuxerListener* listener = nullptr;
+    std::deque<PendingEvent> pending_events;
+    bool started = false;
+    bool ended = false;
+    // Set when the listener is destroyed. A removed listener does not hold
+    // back the listeners added after it.
+    bool removed = false;
+  };
+
+  MuxerListenerSequencer(const MuxerListenerSequencer&) = delete;
+  MuxerListenerSequencer& operator=(const MuxerListenerSequencer&) = delete;
+
+  /// @return The slot of @a listener, to be used in the other calls.
+  size_t AddListener(MuxerListener* listener);
+  /// Forwards @a event to the listener of @a slot, now or once it is its turn.
+  void Post(size_t slot, EventType type, Event event);
+  /// Forwards the events still held for @a slot and stops ordering the other
+  /// listeners after it.
+  void RemoveListener(size_t slot);
+
+  bool CanDeliverLocked(size_t slot, EventType type) const;
+  void DeliverLocked(Slot* slot, PendingEvent* pending_event);
+  void DeliverPendingEventsLocked();
+
+  // Held while delivering events, which also serializes the events of the
+  // listeners.
+  base::Lock lock_;
+  std::vector<Slot> slots_;
+};
+
+/// Forwards the events of a muxer to a child MuxerListener in the order
+/// enforced by a MuxerListenerSequencer.
+class OrderedMuxerListener : public MuxerListener {
+ public:
+  /// @param sequencer is shared by the listeners to order; they are ordered
+  ///        by their construction order.
+  /// @param listener is the listener receiving the events.
+  OrderedMuxerListener(std::shared_ptr<MuxerListenerSequencer> sequencer,
+                       std::unique_ptr<MuxerListener> listener);
+  ~OrderedMuxerListener() override;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override;
+  void OnEncryptionStart() override;
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override;
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override;
+  void OnSegmentEnd(base::TimeTicks last_sample_time) override;
+  void OnNewSegment(const std::string& file_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override;
+  void OnNewChunk(const std::string& segment_name,
+                  uint32_t chunk_index,
+                  int64_t start_time,
+                  int64_t duration,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override;
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
+  /// @}
+
+ private:
+  OrderedMuxerListener(const OrderedMuxerListener&) = delete;
+  OrderedMuxerListener& operator=(const OrderedMuxerListener&) = delete;
+
+  std::shared_ptr<MuxerListenerSequencer> sequencer_;
+  std::unique_ptr<MuxerListener> listener_;
+  size_t slot_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_ORDERED_MUXER_LISTENER_H_
@@ -0,0 +1,131 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/ordered_muxer_listener.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/event/muxer_listener_test_helper.h"
+
+namespace shaka {
+namespace media {
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Mock;
+using ::testing::StrictMock;
+
+namespace {
+
+const int64_t kSegmentStartTime = 19283;
+const int64_t kSegmentDuration = 98028;
+const uint64_t kSegmentSize = 756739;
+const uint32_t kTimescale = 90000;
+const float kDurationSeconds = 10.5f;
+MuxerListener::ContainerType kContainer = MuxerListener::kContainerMp4;
+
+}  // namespace
+
+class OrderedMuxerListenerTest : public ::testing::Test {
+ protected:
+  OrderedMuxerListenerTest() {
+    std::shared_ptr<MuxerListenerSequencer> sequencer =
+        std::make_shared<MuxerListenerSequencer>();
+    std::unique_ptr<StrictMock<MockMuxerListener>> child_1(
+        new StrictMock<MockMuxerListener>);
+    child_1_ = child_1.get();
+    std::unique_ptr<StrictMock<MockMuxerListener>> child_2(
+        new StrictMock<MockMuxerListener>);
+    child_2_ = child_2.get();
+    listener_1_.reset(new OrderedMuxerListener(sequencer, std::move(child_1)));
+    listener_2_.reset(new OrderedMuxerListener(sequencer, std::move(child_2)));
+
+    video_stream_info_ =
+        CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+  }
+
+  void StartListener(OrderedMuxerListener* listener) {
+    listener->OnMediaStart(muxer_options_, *video_stream_info_, kTimescale,
+                           kContainer);
+  }
+
+  std::unique_ptr<OrderedMuxerListener> listener_1_;
+  std::unique_ptr<OrderedMuxerListener> listener_2_;
+  StrictMock<MockMuxerListener>* child_1_;
+  StrictMock<MockMuxerListener>* child_2_;
+  MuxerOptions muxer_options_;
+  std::shared_ptr<StreamInfo> video_stream_info_;
+};
+
+TEST_F(OrderedMuxerListenerTest, InOrder) {
+  {
+    InSequence s;
+    EXPECT_CALL(*child_1_, OnMediaStart(_, _, kTimescale, kContainer));
+    EXPECT_CALL(*child_2_, OnMediaStart(_, _, kTimescale, kContainer));
+    EXPECT_CALL(*child_2_, OnNewSegment("2.m4s", kSegmentStartTime,
+                                        kSegmentDuration, kSegmentSize));
+  }
+  StartListener(listener_1_.get());
+  StartListener(listener_2_.get());
+  listener_2_->OnNewSegment("2.m4s", kSegmentStartTime, kSegmentDuration,
+                            kSegmentSize);
+}
+
+TEST_F(OrderedMuxerListenerTest, HoldsMediaStartOfLaterListener) {
+  StartListener(listener_2_.get());
+  listener_2_->OnNewSegment("2.m4s", kSegmentStartTime, kSegmentDuration,
+                            kSegmentSize);
+  Mock::VerifyAndClearExpectations(child_2_);
+
+  InSequence s;
+  EXPECT_CALL(*child_1_, OnMediaStart(_, _, kTimescale, kContainer));
+  EXPECT_CALL(*child_2_, OnMediaStart(_, _, kTimescale, kContainer));
+  EXPECT_CALL(*child_2_, OnNewSegment("2.m4s", kSegmentStartTime,
+                                      kSegmentDuration, kSegmentSize));
+  StartListener(listener_1_.get());
+}
+
+TEST_F(OrderedMuxerListenerTest, HoldsMediaEndOfLaterListener) {
+  EXPECT_CALL(*child_1_, OnMediaStart(_, _, _, _));
+  EXPECT_CALL(*child_2_, OnMediaStart(_, _, _, _));
+  StartListener(listener_1_.get());
+  StartListener(listener_2_.get());
+
+  // The events of the first listener are not held by the second one.
+  EXPECT_CALL(*child_1_, OnNewSegment("1.m4s", kSegmentStartTime,
+                                      kSegmentDuration, kSegmentSize));
+  listener_2_->OnMediaEnd(MuxerListener::MediaRanges(), kDurationSeconds);
+  listener_1_->OnNewSegment("1.m4s", kSegmentStartTime, kSegmentDuration,
+                            kSegmentSize);
+  Mock::VerifyAndClearExpectations(child_1_);
+  Mock::VerifyAndClearExpectations(child_2_);
+
+  InSequence s;
+  EXPECT_CALL(*child_1_, OnMediaEndMock(_, _, _, _, _, _, _, _,
+                                        kDurationSeconds));
+  EXPECT_CALL(*child_2_, OnMediaEndMock(_, _, _, _, _, _, _, _,
+                                        kDurationSeconds));
+  listener_1_->OnMediaEnd(MuxerListener::MediaRanges(), kDurationSeconds);
+}
+
+TEST_F(OrderedMuxerListenerTest, DestroyedListenerDoesNotHoldOthers) {
+  StartListener(listener_2_.get());
+  Mock::VerifyAndClearExpectations(child_2_);
+
+  EXPECT_CALL(*child_2_, OnMediaStart(_, _, kTimescale, kContainer));
+  listener_1_.reset();
+  Mock::VerifyAndClearExpectations(child_2_);
+
+  EXPECT_CALL(*child_2_, OnMediaEndMock(_, _, _, _, _, _, _, _,
+                                        kDurationSeconds));
+  listener_2_->OnMediaEnd(MuxerListener::MediaRanges(), kDurationSeconds);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,66 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/throttled_progress_listener.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+ThrottledProgressListener::ThrottledProgressListener(
+    std::unique_ptr<ProgressListener> listener,
+    base::TimeDelta min_interval,
+    double min_step)
+    : listener_(std::move(listener)),
+      min_interval_(min_interval),
+      min_step_(min_step),
+      wake_up_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+               base::WaitableEvent::InitialState::NOT_SIGNALED),
+      delivery_thread_("ProgressThread",
+                       base::Bind(&ThrottledProgressListener::DeliveryLoop,
+                                  base::Unretained(this))) {
+  DCHECK(listener_);
+  delivery_thread_.Start();
+}
+
+ThrottledProgressListener::~ThrottledProgressListener() {
+  stopping_.store(true);
+  wake_up_.Signal();
+  delivery_thread_.Join();
+  Deliver(latest_progress_.load(std::memory_order_relaxed));
+}
+
+void ThrottledProgressListener::OnProgress(double progress) {
+  latest_progress_.store(progress, std::memory_order_relaxed);
+  if (progress >= 1.0) {
+    Deliver(progress);
+    return;
+  }
+  if (progress - signaled_progress_ >= min_step_) {
+    signaled_progress_ = progress;
+    wake_up_.Signal();
+  }
+}
+
+void ThrottledProgressListener::DeliveryLoop() {
+  while (!stopping_.load()) {
+    wake_up_.TimedWait(min_interval_);
+    Deliver(latest_progress_.load(std::memory_order_relaxed));
+  }
+}
+
+void ThrottledProgressListener::Deliver(double progress) {
+  base::AutoLock scoped_lock(delivery_lock_);
+  if (progress <= delivered_progress_)
+    return;
+  delivered_progress_ = progress;
+  listener_->OnProgress(progress);
+}
+
+}  // namespace media
+}  // namespace shaka
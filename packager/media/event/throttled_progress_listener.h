@@ -0,0 +1,73 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_THROTTLED_PROGRESS_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_THROTTLED_PROGRESS_LISTENER_H_
+
+#include <atomic>
+#include <memory>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/event/progress_listener.h"
+
+namespace shaka {
+namespace media {
+
+/// Forwards the progress updates to a child ProgressListener from a
+/// background thread, so a slow listener, e.g. one doing IPC, does not slow
+/// down the muxer. Only the latest progress is forwarded, once it advanced by
+/// @a min_step or otherwise every @a min_interval. The completion, i.e. a
+/// progress of 1, is forwarded synchronously, so it is received before the
+/// packaging ends. The child receives the updates one at a time, in
+/// increasing order.
+class ThrottledProgressListener : public ProgressListener {
+ public:
+  /// @param listener is the child listener.
+  /// @param min_interval is how often the child receives the updates of a
+  ///        slower progress.
+  /// @param min_step is the progress which is forwarded without waiting.
+  ThrottledProgressListener(std::unique_ptr<ProgressListener> listener,
+                            base::TimeDelta min_interval,
+                            double min_step);
+  /// Forwards the latest progress, if not forwarded yet.
+  ~ThrottledProgressListener() override;
+
+  /// @name ProgressListener implementation overrides.
+  /// @{
+  void OnProgress(double progress) override;
+  /// @}
+
+ private:
+  ThrottledProgressListener(const ThrottledProgressListener&) = delete;
+  ThrottledProgressListener& operator=(const ThrottledProgressListener&) =
+      delete;
+
+  void DeliveryLoop();
+  void Deliver(double progress);
+
+  const std::unique_ptr<ProgressListener> listener_;
+  const base::TimeDelta min_interval_;
+  const double min_step_;
+
+  std::atomic<double> latest_progress_{-1};
+  // The progress which last woke up the delivery thread. Only accessed on the
+  // muxer thread.
+  double signaled_progress_ = 0;
+  // Serializes the calls to |listener_|.
+  base::Lock delivery_lock_;
+  double delivered_progress_ = -1;
+  base::WaitableEvent wake_up_;
+  std::atomic<bool> stopping_{false};
+  ClosureThread delivery_thread_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_THROTTLED_PROGRESS_LISTENER_H_
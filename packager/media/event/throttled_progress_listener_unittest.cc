@@ -0,0 +1,104 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/throttled_progress_listener.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int64_t kLongIntervalInSeconds = 3600;
+
+// Records the progress updates, which are received on another thread.
+class RecordingProgressListener : public ProgressListener {
+ public:
+  RecordingProgressListener(base::Lock* lock,
+                            std::vector<double>* progresses,
+                            base::WaitableEvent* progress_received)
+      : lock_(lock),
+        progresses_(progresses),
+        progress_received_(progress_received) {}
+
+  void OnProgress(double progress) override {
+    base::AutoLock scoped_lock(*lock_);
+    progresses_->push_back(progress);
+    progress_received_->Signal();
+  }
+
+ private:
+  base::Lock* const lock_;
+  std::vector<double>* const progresses_;
+  base::WaitableEvent* const progress_received_;
+};
+
+}  // namespace
+
+class ThrottledProgressListenerTest : public ::testing::Test {
+ public:
+  ThrottledProgressListenerTest()
+      : progress_received_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                           base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+ protected:
+  void CreateListener(double min_step) {
+    listener_.reset(new ThrottledProgressListener(
+        std::unique_ptr<ProgressListener>(new RecordingProgressListener(
+            &lock_, &progresses_, &progress_received_)),
+        base::TimeDelta::FromSeconds(kLongIntervalInSeconds), min_step));
+  }
+
+  std::vector<double> progresses() {
+    base::AutoLock scoped_lock(lock_);
+    return progresses_;
+  }
+
+  base::Lock lock_;
+  std::vector<double> progresses_;
+  base::WaitableEvent progress_received_;
+  std::unique_ptr<ThrottledProgressListener> listener_;
+};
+
+TEST_F(ThrottledProgressListenerTest, CompletionIsDeliveredSynchronously) {
+  CreateListener(1.0);
+  listener_->OnProgress(0.25);
+  listener_->OnProgress(0.5);
+  EXPECT_TRUE(progresses().empty());
+  listener_->OnProgress(1.0);
+  EXPECT_EQ(std::vector<double>({1.0}), progresses());
+
+  listener_.reset();
+  EXPECT_EQ(std::vector<double>({1.0}), progresses());
+}
+
+TEST_F(ThrottledProgressListenerTest, DeliversLatestProgressAfterStep) {
+  CreateListener(0.1);
+  listener_->OnProgress(0.05);
+  listener_->OnProgress(0.2);
+  progress_received_.Wait();
+  EXPECT_EQ(std::vector<double>({0.2}), progresses());
+
+  listener_->OnProgress(0.25);
+  listener_->OnProgress(1.0);
+  EXPECT_EQ(std::vector<double>({0.2, 1.0}), progresses());
+}
+
+TEST_F(ThrottledProgressListenerTest, DeliversLatestProgressOnDestruction) {
+  CreateListener(1.0);
+  listener_->OnProgress(0.25);
+  listener_->OnProgress(0.5);
+  listener_.reset();
+  EXPECT_EQ(std::vector<double>({0.5}), progresses());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,15 +6,13 @@
 
 #include "packager/media/event/vod_media_info_dump_muxer_listener.h"
 
-#include <google/protobuf/text_format.h>
-
 #include <cmath>
 
 #include "packager/base/logging.h"
-#include "packager/file/file.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/event/media_info_writer.h"
 #include "packager/media/event/muxer_listener_internal.h"
 #include "packager/mpd/base/media_info.pb.h"
 
@@ -47,7 +45,6 @@ void VodMediaInfoDumpMuxerListener::OnMediaStart(
     const StreamInfo& stream_info,
     uint32_t time_scale,
     ContainerType container_type) {
-  DCHECK(muxer_options.segment_template.empty());
   media_info_.reset(new MediaInfo());
   if (!internal::GenerateMediaInfo(muxer_options,
                                    stream_info,
@@ -84,7 +81,7 @@ void VodMediaInfoDumpMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
   }
   if (!media_info_->has_bandwidth())
     media_info_->set_bandwidth(max_bitrate_);
-  WriteMediaInfoToFile(*media_info_, output_file_name_);
+  MediaInfoWriter::GetInstance()->Write(output_file_name_, *media_info_);
 }
 
 void VodMediaInfoDumpMuxerListener::OnNewSegment(const std::string& file_name,
@@ -98,6 +95,16 @@ void VodMediaInfoDumpMuxerListener::OnNewSegment(const std::string& file_name,
   const uint64_t bitrate =
       ceil(kBitsInByte * segment_file_size / segment_duration_seconds);
   max_bitrate_ = std::max(max_bitrate_, bitrate);
+
+  // The segments of segmented outputs are recorded so that the media info of
+  // the shards of an output can be merged, see VodShardParams. The segments
+  // of single file outputs are in the index range.
+  if (media_info_->has_segment_template()) {
+    MediaInfo::Segment* segment = media_info_->add_segments();
+    segment->set_start_time(start_time);
+    segment->set_duration(duration);
+    segment->set_size(segment_file_size);
+  }
 }
 
 void VodMediaInfoDumpMuxerListener::OnKeyFrame(int64_t timestamp,
@@ -109,33 +116,5 @@ void VodMediaInfoDumpMuxerListener::OnCueEvent(int64_t timestamp,
   NOTIMPLEMENTED();
 }
 
-// static
-bool VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
-    const MediaInfo& media_info,
-    const std::string& output_file_path) {
-  std::string output_string;
-  if (!google::protobuf::TextFormat::PrintToString(media_info,
-                                                   &output_string)) {
-    LOG(ERROR) << "Failed to serialize MediaInfo to string.";
-    return false;
-  }
-
-  File* file = File::Open(output_file_path.c_str(), "w");
-  if (!file) {
-    LOG(ERROR) << "Failed to open " << output_file_path;
-    return false;
-  }
-  if (file->Write(output_string.data(), output_string.size()) <= 0) {
-    LOG(ERROR) << "Failed to write MediaInfo to file.";
-    file->Close();
-    return false;
-  }
-  if (!file->Close()) {
-    LOG(ERROR) << "Failed to close " << output_file_path;
-    return false;
-  }
-  return true;
-}
-
 }  // namespace media
 }  // namespace shaka
@@ -5,7 +5,7 @@
 // https://developers.google.com/open-source/licenses/bsd
 //
 // Implementation of MuxerListener that converts the info to a MediaInfo
-// protobuf and dumps it to a file.
+// protobuf and dumps it to a file, with MediaInfoWriter.
 // This is specifically for VOD.
 
 #ifndef PACKAGER_MEDIA_EVENT_VOD_MEDIA_INFO_DUMP_MUXER_LISTENER_H_
@@ -54,15 +54,6 @@ class VodMediaInfoDumpMuxerListener : public MuxerListener {
   void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
   /// @}
 
-  /// Write @a media_info to @a output_file_path in human readable format.
-  /// @param media_info is the MediaInfo to write out.
-  /// @param output_file_path is the path of the output file.
-  /// @return true on success, false otherwise.
-  // TODO(rkuroiwa): Move this to muxer_listener_internal and rename
-  // muxer_listener_internal to muxer_listener_util.
-  static bool WriteMediaInfoToFile(const MediaInfo& media_info,
-                                   const std::string& output_file_path);
-
  private:
   std::string output_file_name_;
   std::unique_ptr<MediaInfo> media_info_;
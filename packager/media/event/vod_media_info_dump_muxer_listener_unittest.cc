@@ -4,6 +4,7 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <gflags/gflags.h>
 #include <gmock/gmock.h>
 #include <google/protobuf/text_format.h>
 #include <google/protobuf/util/message_differencer.h>
@@ -17,10 +18,13 @@
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/video_stream_info.h"
+#include "packager/media/event/media_info_writer.h"
 #include "packager/media/event/muxer_listener_test_helper.h"
 #include "packager/media/event/vod_media_info_dump_muxer_listener.h"
 #include "packager/mpd/base/media_info.pb.h"
 
+DECLARE_bool(binary_media_info);
+
 namespace {
 const bool kEnableEncryption = true;
 // '_default_key_id_' (length 16).
@@ -106,6 +110,7 @@ class VodMediaInfoDumpMuxerListenerTest : public ::testing::Test {
   void FireOnMediaEndWithParams(const OnMediaEndParameters& params) {
     // On success, this writes the result to |temp_file_path_|.
     listener_->OnMediaEnd(params.media_ranges, params.duration_seconds);
+    MediaInfoWriter::GetInstance()->Flush();
   }
 
  protected:
@@ -274,5 +279,77 @@ TEST_F(VodMediaInfoDumpMuxerListenerTest, CheckBandwidth) {
               FileContentEqualsProto(kExpectedProtobufOutput));
 }
 
+TEST_F(VodMediaInfoDumpMuxerListenerTest, SegmentedOutputRecordsSegments) {
+  std::shared_ptr<StreamInfo> stream_info =
+      CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+
+  MuxerOptions muxer_options;
+  muxer_options.output_file_name = "init.mp4";
+  muxer_options.segment_template = "segment-$Time$.m4s";
+  const uint32_t kReferenceTimeScale = 1000;
+  listener_->OnMediaStart(muxer_options, *stream_info, kReferenceTimeScale,
+                          MuxerListener::kContainerMp4);
+
+  OnNewSegmentParameters new_segment_param;
+  new_segment_param.start_time = 10000;
+  new_segment_param.duration = 1000;
+  new_segment_param.segment_file_size = 100;
+  FireOnNewSegmentWithParams(new_segment_param);
+  new_segment_param.start_time = 11000;
+  new_segment_param.segment_file_size = 200;
+  FireOnNewSegmentWithParams(new_segment_param);
+
+  OnMediaEndParameters media_end_param;
+  media_end_param.duration_seconds = 2;
+  FireOnMediaEndWithParams(media_end_param);
+
+  const char kExpectedProtobufOutput[] =
+      "bandwidth: 1600\n"
+      "video_info {\n"
+      "  codec: 'avc1.010101'\n"
+      "  width: 720\n"
+      "  height: 480\n"
+      "  time_scale: 10\n"
+      "  pixel_width: 1\n"
+      "  pixel_height: 1\n"
+      "}\n"
+      "reference_time_scale: 1000\n"
+      "container_type: 1\n"
+      "init_segment_name: 'init.mp4'\n"
+      "segment_template: 'segment-$Time$.m4s'\n"
+      "media_duration_seconds: 2\n"
+      "segments {\n"
+      "  start_time: 10000\n"
+      "  duration: 1000\n"
+      "  size: 100\n"
+      "}\n"
+      "segments {\n"
+      "  start_time: 11000\n"
+      "  duration: 1000\n"
+      "  size: 200\n"
+      "}\n";
+  EXPECT_THAT(temp_file_path_.AsUTF8Unsafe(),
+              FileContentEqualsProto(kExpectedProtobufOutput));
+}
+
+TEST_F(VodMediaInfoDumpMuxerListenerTest, BinaryFormat) {
+  FLAGS_binary_media_info = true;
+  std::shared_ptr<StreamInfo> stream_info =
+      CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+  FireOnMediaStartWithDefaultMuxerOptions(*stream_info, !kEnableEncryption);
+  OnMediaEndParameters media_end_param = GetDefaultOnMediaEndParams();
+  FireOnMediaEndWithParams(media_end_param);
+  FLAGS_binary_media_info = false;
+
+  std::string file_content;
+  ASSERT_TRUE(File::ReadFileToString(temp_file_path_.AsUTF8Unsafe().c_str(),
+                                     &file_content));
+  MediaInfo media_info;
+  ASSERT_TRUE(media_info.ParseFromString(file_content));
+  EXPECT_EQ("test_output_file_name.mp4", media_info.media_file_name());
+  EXPECT_EQ(10.5, media_info.media_duration_seconds());
+  EXPECT_EQ(720u, media_info.video_info().width());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -223,6 +223,26 @@ bool DvbImageBuilder::AddPixel(BitDepth bit_depth,
   return true;
 }
 
+bool DvbImageBuilder::AddPixels(BitDepth bit_depth,
+                                uint8_t byte_code,
+                                size_t count,
+                                bool is_top_rows) {
+  if (count == 0)
+    return true;
+  auto& pos = is_top_rows ? top_pos_ : bottom_pos_;
+  if (pos.x + count > max_width_ || pos.y >= max_height_) {
+    LOG(ERROR) << "DVB-sub image cannot fit in region/window";
+    return false;
+  }
+
+  std::fill_n(&pixels_[pos.y * max_width_ + pos.x], count,
+              color_space_->GetColor(bit_depth, byte_code));
+  pos.x = static_cast<uint16_t>(pos.x + count);
+  if (pos.x > width_)
+    width_ = pos.x;
+  return true;
+}
+
 void DvbImageBuilder::NewRow(bool is_top_rows) {
   auto& pos = is_top_rows ? top_pos_ : bottom_pos_;
   pos.x = 0;
@@ -101,6 +101,12 @@ class DvbImageBuilder {
   uint16_t max_height() const { return max_height_; }
 
   bool AddPixel(BitDepth bit_depth, uint8_t byte_code, bool is_top_rows);
+  /// Adds a run of @a count pixels of the same color, looking up the color
+  /// only once.
+  bool AddPixels(BitDepth bit_depth,
+                 uint8_t byte_code,
+                 size_t count,
+                 bool is_top_rows);
   void NewRow(bool is_top_rows);
   /// Copies the top-rows to the bottom rows.
   void MirrorToBottomRows();
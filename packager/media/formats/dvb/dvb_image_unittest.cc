@@ -239,6 +239,26 @@ TEST(DvbImageBuilderTest, ValidatesMaxWidth) {
   ASSERT_FALSE(image.AddPixel(BitDepth::k8Bit, kRedId, kTopRow));
 }
 
+TEST(DvbImageBuilderTest, AddsPixelRuns) {
+  DvbImageColorSpace colors;
+  FillDefaultColorSpace(&colors);
+  const uint16_t kWidth = 4;
+
+  DvbImageBuilder image(&colors, kBlack, kWidth, 2);
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kRedId, 0, kTopRow));
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kRedId, kWidth, kTopRow));
+  // Cannot exceed max_width.
+  ASSERT_FALSE(image.AddPixels(BitDepth::k8Bit, kRedId, 1, kTopRow));
+  image.NewRow(kTopRow);
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kBlueId, 1, kBottomRow));
+  ASSERT_FALSE(image.AddPixels(BitDepth::k8Bit, kBlueId, kWidth, kBottomRow));
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kBlueId, kWidth - 1,
+                              kBottomRow));
+  image.NewRow(kBottomRow);
+
+  CheckImagePixels(&image, kWidth, {kRed, kBlue});
+}
+
 TEST(DvbImageBuilderTest, SupportsInconsistentWidths) {
   DvbImageColorSpace colors;
   FillDefaultColorSpace(&colors);
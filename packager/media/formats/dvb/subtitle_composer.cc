@@ -43,10 +43,28 @@ bool IsTransparent(const RgbaColor* colors, uint16_t width, uint16_t height) {
   return true;
 }
 
-bool GetImageData(const DvbImageBuilder* image,
-                  std::vector<uint8_t>* data,
-                  uint16_t* width,
-                  uint16_t* height) {
+// @return the content of the image, as encoded by GetImageData().
+std::string GetImageKey(const RgbaColor* pixels,
+                        uint16_t stride,
+                        uint16_t width,
+                        uint16_t height) {
+  std::string key;
+  key.reserve(2 * sizeof(uint16_t) +
+              static_cast<size_t>(width) * height * sizeof(RgbaColor));
+  key.append(reinterpret_cast<const char*>(&width), sizeof(width));
+  key.append(reinterpret_cast<const char*>(&height), sizeof(height));
+  for (size_t y = 0; y < height; y++) {
+    key.append(reinterpret_cast<const char*>(pixels + stride * y),
+               width * sizeof(RgbaColor));
+  }
+  return key;
+}
+
+bool GetImageData(const RgbaColor* pixels,
+                  uint16_t stride,
+                  uint16_t width,
+                  uint16_t height,
+                  std::vector<uint8_t>* data) {
   // CAREFUL in this method since this uses long-jumps.  A long-jump causes the
   // execution to jump to another point *without executing returns*.  This
   // causes C++ objects to not get destroyed.  This also causes the same code to
@@ -71,19 +89,14 @@ bool GetImageData(const DvbImageBuilder* image,
   }
   png_set_write_fn(png, data, &PngWriteData, &PngFlushData);
 
-  const RgbaColor* pixels;
-  if (!image->GetPixels(&pixels, width, height))
-    return false;
-  if (IsTransparent(pixels, *width, *height))
-    return true;  // Skip empty/transparent images.
-  png_set_IHDR(png, info, *width, *height, 8, PNG_COLOR_TYPE_RGBA,
+  png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGBA,
                PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
                PNG_FILTER_TYPE_BASE);
   png_write_info(png, info);
 
   const uint8_t* in_data = reinterpret_cast<const uint8_t*>(pixels);
-  for (size_t y = 0; y < *height; y++) {
-    size_t offset = image->max_width() * y * sizeof(RgbaColor);
+  for (size_t y = 0; y < height; y++) {
+    size_t offset = stride * y * sizeof(RgbaColor);
     png_write_row(png, in_data + offset);
   }
   png_write_end(png, nullptr);
@@ -204,7 +217,8 @@ DvbImageBuilder* SubtitleComposer::GetObjectImage(uint16_t object_id) {
 bool SubtitleComposer::GetSamples(
     int64_t start,
     int64_t end,
-    std::vector<std::shared_ptr<TextSample>>* samples) const {
+    std::vector<std::shared_ptr<TextSample>>* samples) {
+  std::unordered_map<std::string, std::vector<uint8_t>> image_cache;
   for (const auto& pair : objects_) {
     auto it = images_.find(pair.first);
     if (it == images_.end()) {
@@ -213,14 +227,28 @@ bool SubtitleComposer::GetSamples(
       continue;
     }
 
+    const RgbaColor* pixels;
     uint16_t width, height;
-    std::vector<uint8_t> image_data;
-    if (!GetImageData(&it->second, &image_data, &width, &height))
+    if (!it->second.GetPixels(&pixels, &width, &height))
       return false;
-    if (image_data.empty()) {
+    if (IsTransparent(pixels, width, height)) {
       VLOG(1) << "Skipping transparent object";
       continue;
     }
+
+    // The same subtitle is usually sent again in the next pages while it is
+    // displayed, so the images of the last page are only encoded once.
+    const uint16_t stride = it->second.max_width();
+    std::string key = GetImageKey(pixels, stride, width, height);
+    std::vector<uint8_t> image_data;
+    auto cached = image_cache_.find(key);
+    if (cached != image_cache_.end()) {
+      image_data = cached->second;
+    } else if (!GetImageData(pixels, stride, width, height, &image_data)) {
+      return false;
+    }
+    image_cache[std::move(key)] = image_data;
+
     TextFragment body({}, image_data);
     DCHECK_LE(width, display_width_);
     DCHECK_LE(height, display_height_);
@@ -241,6 +269,7 @@ bool SubtitleComposer::GetSamples(
         std::make_shared<TextSample>("", start, end, settings, body));
   }
 
+  image_cache_.swap(image_cache);
   return true;
 }
 
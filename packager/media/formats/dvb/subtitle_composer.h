@@ -8,6 +8,7 @@
 #define PACKAGER_MEDIA_DVB_SUBTITLE_COMPOSER_H_
 
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -45,7 +46,7 @@ class SubtitleComposer {
 
   bool GetSamples(int64_t start,
                   int64_t end,
-                  std::vector<std::shared_ptr<TextSample>>* samples) const;
+                  std::vector<std::shared_ptr<TextSample>>* samples);
   void ClearObjects();
 
  private:
@@ -71,6 +72,8 @@ class SubtitleComposer {
   std::unordered_map<uint16_t, DvbImageBuilder> images_;  // Uses object_id.
   uint16_t display_width_;
   uint16_t display_height_;
+  // The PNG images of the objects of the last page, by image content.
+  std::unordered_map<std::string, std::vector<uint8_t>> image_cache_;
 };
 
 }  // namespace media
@@ -143,6 +143,37 @@ TEST(SubtitleComposerTest, ClearObjects) {
   EXPECT_EQ(samples.size(), 1u);
 }
 
+TEST(SubtitleComposerTest, ReusesImagesOfPreviousPage) {
+  const uint8_t kColorSpaceId = 1;
+  const uint16_t kObjectId = 5;
+  const uint16_t kRegionId = 1;
+  const uint8_t kColorId = 10;
+
+  SubtitleComposer composer;
+  std::vector<std::shared_ptr<TextSample>> samples;
+  for (int page = 0; page < 3; page++) {
+    ASSERT_TRUE(composer.SetRegionInfo(kRegionId, kColorSpaceId, 10, 10));
+    ASSERT_TRUE(
+        composer.SetObjectInfo(kObjectId, kRegionId, 0, 0, kNoBgColor));
+    if (page < 2) {
+      CreateDefaultImage(&composer, kObjectId);
+    } else {
+      composer.GetColorSpace(kColorSpaceId)
+          ->SetColor(BitDepth::k8Bit, kColorId, RgbaColor{1, 2, 3, 4});
+      auto* image = composer.GetObjectImage(kObjectId);
+      EXPECT_TRUE(image->AddPixel(BitDepth::k8Bit, kColorId, true));
+      image->NewRow(true);
+    }
+    ASSERT_TRUE(composer.GetSamples(0, 1, &samples));
+    composer.ClearObjects();
+  }
+
+  ASSERT_EQ(samples.size(), 3u);
+  EXPECT_FALSE(samples[0]->body().image.empty());
+  EXPECT_EQ(samples[0]->body().image, samples[1]->body().image);
+  EXPECT_NE(samples[0]->body().image, samples[2]->body().image);
+}
+
 TEST(SubtitleComposerTest, IgnoresEmptyImages) {
   const uint8_t kColorSpaceId = 1;
   const uint16_t kRegionId = 1;
@@ -61,6 +61,10 @@ bool Ac3Header::IsSyncWord(const uint8_t* buf) const {
   return buf[0] == 0x0B && buf[1] == 0x77;
 }
 
+uint8_t Ac3Header::GetSyncWordFirstByte() const {
+  return 0x0B;
+}
+
 size_t Ac3Header::GetMinFrameSize() const {
   // Arbitrary. Actual frame size starts with 96 words.
   const size_t kMinAc3FrameSize = 10u;
@@ -34,6 +34,10 @@ bool AdtsHeader::IsSyncWord(const uint8_t* buf) const {
   return (buf[0] == 0xff) && ((buf[1] & 0xf6) == 0xf0);
 }
 
+uint8_t AdtsHeader::GetSyncWordFirstByte() const {
+  return 0xff;
+}
+
 size_t AdtsHeader::GetMinFrameSize() const {
   return kAdtsHeaderMinSize + 1;
 }
@@ -26,6 +26,11 @@ class AudioHeader {
   /// @return true if corresponds to a syncword.
   virtual bool IsSyncWord(const uint8_t* buf) const = 0;
 
+  /// @return The value of the first byte of every syncword. It lets callers
+  ///         skip to syncword candidates with memchr instead of calling
+  ///         IsSyncWord on every byte.
+  virtual uint8_t GetSyncWordFirstByte() const = 0;
+
   /// @return The minium frame size.
   virtual size_t GetMinFrameSize() const = 0;
 
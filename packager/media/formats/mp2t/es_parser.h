@@ -34,6 +34,11 @@ class EsParser {
                      int64_t pts,
                      int64_t dts) = 0;
 
+  // Called after Parse() once the whole PES packet has been passed to it.
+  // |data_alignment_indicator| tells whether the PES packet was flagged as
+  // starting with an access unit.
+  virtual bool OnPesEnd(bool data_alignment_indicator) { return true; }
+
   // Flush any pending buffer.
   virtual bool Flush() = 0;
 
@@ -5,6 +5,7 @@
 #include "packager/media/formats/mp2t/es_parser_audio.h"
 
 #include <stdint.h>
+#include <string.h>
 
 #include <algorithm>
 #include <list>
@@ -54,7 +55,19 @@ static bool LookForSyncWord(const uint8_t* raw_es,
     return false;
   }
 
+  // In a well-formed stream |pos| is where the previous frame ended, so the
+  // next syncword is expected right there and is verified first. Otherwise,
+  // skip to the next candidate with memchr, which is vectorized by the C
+  // library, instead of testing every byte with IsSyncWord.
+  const uint8_t sync_byte = audio_header->GetSyncWordFirstByte();
   for (int offset = pos; offset < max_offset; offset++) {
+    if (raw_es[offset] != sync_byte) {
+      const uint8_t* candidate = static_cast<const uint8_t*>(
+          memchr(&raw_es[offset], sync_byte, max_offset - offset));
+      if (!candidate)
+        break;
+      offset = static_cast<int>(candidate - raw_es);
+    }
     const uint8_t* cur_buf = &raw_es[offset];
 
     if (!audio_header->IsSyncWord(cur_buf))
@@ -0,0 +1,115 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/es_parser_audio.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/base/timestamp.h"
+#include "packager/media/formats/mp2t/ts_stream_type.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+const uint32_t kPid = 0x101;
+const int64_t kPts = 90000;
+
+const char kAdtsFrame[] =
+    "fff15080429ffcda004c61766335332e33352e30004258892a5361062403"
+    "d040000000001ff9055e9fe77ac56eb1677484e0ef0c3102a39daa8355a5"
+    "37ecab2b156e4ba73ceedb24ea51194e57c9385fa67eca8edc914902e852"
+    "3185b52299516e679fb3768aa9f13ccac5b257410080282c9a50318ec94e"
+    "ba24ea305bafab2b2beab16557ef9ecaa8f17bedea84788c8d42e4b3c65b"
+    "1e7ecae7528b909bc46c76cca73b906ec980ed9f32b25ecd28f43f9516de"
+    "3ff249f23bb9c93e64c4808195f284653c40592c1a8dc847f5f11791fd80"
+    "b18e02c1e1ed9f82c62a1f8ea0f5b6dbf2112c2202973b00de71bb49f906"
+    "ed1bc63768dda378c8f9c6ed1bb48f68dda378c9f68dda3768dda3768de3"
+    "23da3768de31bb492a5361062403d040000000001ff9055e9fe77ac56eb1"
+    "677484e0ef0c3102a39daa8355a537ecab2b156e4ba73ceedb24ea51194e"
+    "57c9385fa67eca8edc914902e8523185b52299516e679fb3768aa9f13cca"
+    "c5b257410080282c9a50318ec94eba24ea305bafab2b2beab16557ef9eca"
+    "a8f17bedea84788c8d42e4b3c65b1e7ecae7528b909bc46c76cca73b906e"
+    "c980ed9f32b25ecd28f43f9516de3ff249f23bb9c93e64c4808195f28465"
+    "3c40592c1a8dc847f5f11791fd80b18e02c1e1ed9f82c62a1f8ea0f5b6db"
+    "f2112c2202973b00de71bb49f906ed1bc63768dda378c8f9c6ed1bb48f68"
+    "dda378c9f68dda3768dda3768de323da3768de31bb4e";
+
+}  // namespace
+
+class EsParserAudioTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_TRUE(base::HexStringToBytes(kAdtsFrame, &adts_frame_));
+    parser_.reset(new EsParserAudio(
+        kPid, TsStreamType::kAdtsAac,
+        base::Bind(&EsParserAudioTest::OnNewStreamInfo,
+                   base::Unretained(this)),
+        base::Bind(&EsParserAudioTest::OnEmitSample, base::Unretained(this)),
+        false));
+  }
+
+ protected:
+  void OnNewStreamInfo(std::shared_ptr<StreamInfo> stream_info) {
+    stream_info_ = stream_info;
+  }
+  void OnEmitSample(std::shared_ptr<MediaSample> sample) {
+    samples_.push_back(sample);
+  }
+
+  void AppendFrames(size_t num_frames, std::vector<uint8_t>* es) {
+    for (size_t i = 0; i < num_frames; ++i)
+      es->insert(es->end(), adts_frame_.begin(), adts_frame_.end());
+  }
+
+  std::vector<uint8_t> adts_frame_;
+  std::unique_ptr<EsParserAudio> parser_;
+  std::shared_ptr<StreamInfo> stream_info_;
+  std::vector<std::shared_ptr<MediaSample>> samples_;
+};
+
+TEST_F(EsParserAudioTest, ConsecutiveFrames) {
+  std::vector<uint8_t> es;
+  AppendFrames(3, &es);
+  ASSERT_TRUE(parser_->Parse(es.data(), static_cast<int>(es.size()), kPts,
+                             kPts));
+  ASSERT_TRUE(stream_info_);
+  ASSERT_EQ(3u, samples_.size());
+  const size_t kHeaderSize = 7;
+  EXPECT_EQ(adts_frame_.size() - kHeaderSize, samples_[0]->data_size());
+  EXPECT_EQ(kPts, samples_[0]->pts());
+  EXPECT_LT(samples_[0]->pts(), samples_[1]->pts());
+}
+
+TEST_F(EsParserAudioTest, SkipsGarbageWithSyncWordFirstByte) {
+  // 0xff is the first byte of the ADTS syncword, but 0xff 0x00 is not a
+  // syncword, so every 0xff in the garbage is a rejected candidate.
+  std::vector<uint8_t> es = {0x00, 0xff, 0x00, 0x12, 0xff, 0x00, 0xff, 0x00};
+  AppendFrames(4, &es);
+
+  // Feed the stream in small pieces so that the search resumes across calls.
+  const size_t kChunkSize = 100;
+  for (size_t offset = 0; offset < es.size(); offset += kChunkSize) {
+    const size_t size = std::min(kChunkSize, es.size() - offset);
+    ASSERT_TRUE(parser_->Parse(es.data() + offset, static_cast<int>(size),
+                               offset == 0 ? kPts : kNoTimestamp,
+                               offset == 0 ? kPts : kNoTimestamp));
+  }
+  EXPECT_EQ(4u, samples_.size());
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
@@ -38,6 +38,7 @@ void EsParserH264::Reset() {
   h264_parser_.reset(new H264Parser());
   last_video_decoder_config_ = std::shared_ptr<StreamInfo>();
   decoder_config_check_pending_ = false;
+  decoder_config_version_ = 0;
   EsParserH26x::Reset();
 }
 
@@ -89,6 +90,9 @@ bool EsParserH264::ProcessNalu(const Nalu& nalu,
         video_slice_info->is_key_frame = is_key_frame;
         video_slice_info->frame_num = shdr.frame_num;
         video_slice_info->pps_id = shdr.pic_parameter_set_id;
+        video_slice_info->slice_header_size = (shdr.header_bit_size + 7) / 8;
+        video_slice_info->is_first_slice_in_picture =
+            shdr.first_mb_in_slice == 0;
       } else if (status == H264Parser::kUnsupportedStream) {
         // Indicate the stream can't be parsed.
         new_stream_info_cb_.Run(nullptr);
@@ -112,6 +116,12 @@ bool EsParserH264::UpdateVideoDecoderConfig(int pps_id) {
   // Update the video decoder configuration if needed.
   if (!decoder_config_check_pending_)
     return true;
+  // The SPSes / PPSes repeated in-band do not change the configuration.
+  if (last_video_decoder_config_ &&
+      h264_parser_->parameter_sets_version() == decoder_config_version_) {
+    decoder_config_check_pending_ = false;
+    return true;
+  }
 
   const H264Pps* pps = h264_parser_->GetPps(pps_id);
   const H264Sps* sps;
@@ -127,6 +137,7 @@ bool EsParserH264::UpdateVideoDecoderConfig(int pps_id) {
     if (!sps)
       return false;
     decoder_config_check_pending_ = false;
+    decoder_config_version_ = h264_parser_->parameter_sets_version();
   }
 
   std::vector<uint8_t> decoder_config_record;
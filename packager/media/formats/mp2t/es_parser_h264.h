@@ -45,6 +45,8 @@ class EsParserH264 : public EsParserH26x {
 
   std::shared_ptr<StreamInfo> last_video_decoder_config_;
   bool decoder_config_check_pending_;
+  // The parameter sets version of |last_video_decoder_config_|.
+  uint64_t decoder_config_version_ = 0;
 
   std::unique_ptr<H264Parser> h264_parser_;
 };
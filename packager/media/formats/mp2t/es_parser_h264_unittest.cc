@@ -2,7 +2,9 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
+#include <string.h>
 
 #include <algorithm>
 #include <vector>
@@ -13,9 +15,12 @@
 #include "packager/media/base/timestamp.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/codecs/h264_parser.h"
+#include "packager/media/codecs/video_slice_header_parser.h"
 #include "packager/media/formats/mp2t/es_parser_h264.h"
 #include "packager/media/test/test_data_util.h"
 
+DECLARE_bool(ts_access_unit_aligned_pes);
+
 namespace shaka {
 namespace media {
 class VideoStreamInfo;
@@ -122,12 +127,16 @@ class EsParserH264Test : public testing::Test {
         first_frame_is_key_frame_(false) {}
 
   void LoadStream(const char* filename);
-  void ProcessPesPackets(const std::vector<Packet>& pes_packets);
+  // |data_aligned| tells whether the PES packets are flagged as starting with
+  // an access unit.
+  void ProcessPesPackets(const std::vector<Packet>& pes_packets,
+                         bool data_aligned = false);
 
   void EmitSample(std::shared_ptr<MediaSample> sample) {
     sample_count_++;
     if (sample_count_ == 1)
       first_frame_is_key_frame_ = sample->is_key_frame();
+    samples_.push_back(std::move(sample));
   }
 
   void NewVideoConfig(std::shared_ptr<StreamInfo> config) {
@@ -149,6 +158,9 @@ class EsParserH264Test : public testing::Test {
   StreamMap stream_map_;
   size_t sample_count_;
   bool first_frame_is_key_frame_;
+  std::vector<std::shared_ptr<MediaSample>> samples_;
+  // The number of samples emitted after each PES packet.
+  std::vector<size_t> sample_counts_after_pes_;
 };
 
 void EsParserH264Test::LoadStream(const char* filename) {
@@ -163,7 +175,8 @@ void EsParserH264Test::LoadStream(const char* filename) {
 }
 
 void EsParserH264Test::ProcessPesPackets(
-    const std::vector<Packet>& pes_packets) {
+    const std::vector<Packet>& pes_packets,
+    bool data_aligned) {
   // Duration of one 25fps video frame in 90KHz clock units.
   const uint32_t kMpegTicksPerFrame = 3600;
 
@@ -195,6 +208,8 @@ void EsParserH264Test::ProcessPesPackets(
 
     ASSERT_TRUE(es_parser.Parse(&stream_[cur_pes_offset],
                                 static_cast<int>(cur_pes_size), pts, dts));
+    ASSERT_TRUE(es_parser.OnPesEnd(data_aligned));
+    sample_counts_after_pes_.push_back(sample_count_);
   }
   es_parser.Flush();
 }
@@ -211,6 +226,41 @@ TEST_F(EsParserH264Test, OneAccessUnitPerPes) {
   EXPECT_TRUE(first_frame_is_key_frame());
 }
 
+TEST_F(EsParserH264Test, OneAccessUnitPerAlignedPes) {
+  google::FlagSaver flag_saver;
+  FLAGS_ts_access_unit_aligned_pes = true;
+  LoadStream("bear.h264");
+
+  std::vector<Packet> pes_packets(access_units_);
+  ProcessPesPackets(pes_packets, true);
+  EXPECT_EQ(sample_count(), access_units_.size());
+  EXPECT_TRUE(first_frame_is_key_frame());
+
+  // An access unit is emitted as soon as the duration of the previous one is
+  // known, i.e. at the end of the PES packet which follows it, instead of
+  // after the start of the next one.
+  ASSERT_EQ(pes_packets.size(), sample_counts_after_pes_.size());
+  for (size_t k = 0; k < sample_counts_after_pes_.size(); k++)
+    EXPECT_EQ(k, sample_counts_after_pes_[k]);
+
+  // The samples are the same as the ones emitted at the start of the next
+  // access unit.
+  std::vector<std::shared_ptr<MediaSample>> aligned_samples;
+  aligned_samples.swap(samples_);
+  sample_count_ = 0;
+  FLAGS_ts_access_unit_aligned_pes = false;
+  ProcessPesPackets(pes_packets, true);
+  ASSERT_EQ(aligned_samples.size(), samples_.size());
+  for (size_t k = 0; k < samples_.size(); k++) {
+    EXPECT_EQ(samples_[k]->dts(), aligned_samples[k]->dts());
+    EXPECT_EQ(samples_[k]->duration(), aligned_samples[k]->duration());
+    EXPECT_EQ(samples_[k]->is_key_frame(), aligned_samples[k]->is_key_frame());
+    ASSERT_EQ(samples_[k]->data_size(), aligned_samples[k]->data_size());
+    EXPECT_EQ(0, memcmp(samples_[k]->data(), aligned_samples[k]->data(),
+                        samples_[k]->data_size()));
+  }
+}
+
 TEST_F(EsParserH264Test, NonAlignedPesPacket) {
   LoadStream("bear.h264");
 
@@ -295,6 +345,36 @@ TEST_F(EsParserH264Test, PixelWidthPixelHeight) {
                 ->pixel_height());
 }
 
+// Verify that the slice header sizes carried by the samples are the ones
+// found by parsing the slice headers of the samples.
+TEST_F(EsParserH264Test, SliceHeaderSizes) {
+  LoadStream("bear.h264");
+  std::vector<Packet> pes_packets(access_units_);
+  ProcessPesPackets(pes_packets);
+
+  const int kVideoTrackId = 0;
+  const VideoStreamInfo* video_stream_info =
+      static_cast<const VideoStreamInfo*>(stream_map_[kVideoTrackId].get());
+  ASSERT_TRUE(video_stream_info);
+  H264VideoSliceHeaderParser header_parser;
+  ASSERT_TRUE(header_parser.Initialize(video_stream_info->codec_config()));
+
+  ASSERT_FALSE(samples_.empty());
+  for (const auto& sample : samples_) {
+    std::vector<size_t> slice_header_sizes;
+    NaluReader reader(Nalu::kH264, video_stream_info->nalu_length_size(),
+                      sample->data(), sample->data_size());
+    Nalu nalu;
+    while (reader.Advance(&nalu) == NaluReader::kOk) {
+      ASSERT_TRUE(header_parser.ProcessNalu(nalu));
+      if (nalu.is_video_slice())
+        slice_header_sizes.push_back(header_parser.GetHeaderSize(nalu));
+    }
+    EXPECT_FALSE(slice_header_sizes.empty());
+    EXPECT_EQ(slice_header_sizes, sample->video_slice_header_sizes());
+  }
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
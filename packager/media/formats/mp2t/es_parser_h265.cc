@@ -41,6 +41,7 @@ void EsParserH265::Reset() {
   h265_parser_.reset(new H265Parser());
   last_video_decoder_config_ = std::shared_ptr<VideoStreamInfo>();
   decoder_config_check_pending_ = false;
+  decoder_config_version_ = 0;
   EsParserH26x::Reset();
 }
 
@@ -93,6 +94,9 @@ bool EsParserH265::ProcessNalu(const Nalu& nalu,
           video_slice_info->is_key_frame = is_key_frame;
           video_slice_info->frame_num = 0;  // frame_num is only for H264.
           video_slice_info->pps_id = shdr.pic_parameter_set_id;
+          video_slice_info->slice_header_size = (shdr.header_bit_size + 7) / 8;
+          video_slice_info->is_first_slice_in_picture =
+              shdr.first_slice_segment_in_pic_flag;
         } else if (status == H265Parser::kUnsupportedStream) {
           // Indicate the stream can't be parsed.
           new_stream_info_cb_.Run(nullptr);
@@ -115,6 +119,12 @@ bool EsParserH265::UpdateVideoDecoderConfig(int pps_id) {
   // Update the video decoder configuration if needed.
   if (!decoder_config_check_pending_)
     return true;
+  // The SPSes / PPSes repeated in-band do not change the configuration.
+  if (last_video_decoder_config_ &&
+      h265_parser_->parameter_sets_version() == decoder_config_version_) {
+    decoder_config_check_pending_ = false;
+    return true;
+  }
 
   const H265Pps* pps = h265_parser_->GetPps(pps_id);
   const H265Sps* sps;
@@ -130,6 +140,7 @@ bool EsParserH265::UpdateVideoDecoderConfig(int pps_id) {
     if (!sps)
       return false;
     decoder_config_check_pending_ = false;
+    decoder_config_version_ = h265_parser_->parameter_sets_version();
   }
 
   std::vector<uint8_t> decoder_config_record;
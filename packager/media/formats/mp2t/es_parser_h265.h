@@ -48,6 +48,8 @@ class EsParserH265 : public EsParserH26x {
   // Last video decoder config.
   std::shared_ptr<StreamInfo> last_video_decoder_config_;
   bool decoder_config_check_pending_;
+  // The parameter sets version of |last_video_decoder_config_|.
+  uint64_t decoder_config_version_ = 0;
 
   std::unique_ptr<H265Parser> h265_parser_;
 };
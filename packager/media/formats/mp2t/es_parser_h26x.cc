@@ -4,17 +4,30 @@
 
 #include "packager/media/formats/mp2t/es_parser_h26x.h"
 
+#include <gflags/gflags.h>
 #include <stdint.h>
 
 #include "packager/base/logging.h"
 #include "packager/base/numerics/safe_conversions.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/offset_byte_queue.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/base/timestamp.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/codecs/h26x_byte_to_unit_stream_converter.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
 
+DEFINE_bool(ts_access_unit_aligned_pes,
+            false,
+            "MPEG-2 TS input only. If it is true, assume that the H.264 and "
+            "H.265 PES packets flagged with data_alignment_indicator hold "
+            "whole access units, and emit each access unit at the end of its "
+            "PES packet instead of when the next one starts, which saves a "
+            "frame of latency. The indicator alone also allows PES packets "
+            "aligned to slices. The assumption is dropped for a stream at the "
+            "first PES packet which is not flagged or which starts in the "
+            "middle of a picture, whose picture is then emitted incomplete.");
+
 namespace shaka {
 namespace media {
 namespace mp2t {
@@ -36,7 +49,8 @@ EsParserH26x::EsParserH26x(
       emit_sample_cb_(emit_sample_cb),
       type_(type),
       es_queue_(new media::OffsetByteQueue()),
-      stream_converter_(std::move(stream_converter)) {}
+      stream_converter_(std::move(stream_converter)),
+      emit_at_pes_end_(FLAGS_ts_access_unit_aligned_pes) {}
 
 EsParserH26x::~EsParserH26x() {}
 
@@ -77,6 +91,28 @@ bool EsParserH26x::Parse(const uint8_t* buf,
   return ParseInternal();
 }
 
+bool EsParserH26x::OnPesEnd(bool data_alignment_indicator) {
+  if (!emit_at_pes_end_)
+    return true;
+  // The PES packet is assumed to hold whole access units, so the access unit
+  // of the PES packet ends with it. Rather than waiting for the next PES packet
+  // to find the end of the access unit, emit it now, which saves a frame of
+  // latency.
+  if (!data_alignment_indicator) {
+    LOG(WARNING) << "[MPEG-2 TS] PID " << pid()
+                 << " PES packets are not aligned to the access units.";
+    emit_at_pes_end_ = false;
+    checking_pes_start_ = false;
+    return true;
+  }
+  RCHECK(EmitAccessUnitAtQueueEnd());
+  // The next PES packet should start with an access unit, which is checked
+  // when its first slice is parsed.
+  checking_pes_start_ = emit_at_pes_end_;
+  pes_start_position_ = es_queue_->tail();
+  return true;
+}
+
 bool EsParserH26x::Flush() {
   DVLOG(1) << "EsParserH26x::Flush";
 
@@ -107,7 +143,8 @@ bool EsParserH26x::Flush() {
 }
 
 void EsParserH26x::Reset() {
-  es_queue_.reset(new media::OffsetByteQueue());
+  // Keep the buffer of the queue to avoid regrowing it after each reset.
+  es_queue_->Reset();
   current_search_position_ = 0;
   current_access_unit_position_ = 0;
   current_video_slice_info_.valid = false;
@@ -115,9 +152,12 @@ void EsParserH26x::Reset() {
   next_access_unit_position_ = 0;
   current_nalu_info_.reset();
   timing_desc_list_.clear();
+  slice_header_size_list_.clear();
   pending_sample_ = std::shared_ptr<MediaSample>();
   pending_sample_duration_ = 0;
   waiting_for_key_frame_ = true;
+  emit_at_pes_end_ = FLAGS_ts_access_unit_aligned_pes;
+  checking_pes_start_ = false;
 }
 
 bool EsParserH26x::SearchForNalu(uint64_t* position, Nalu* nalu) {
@@ -183,79 +223,142 @@ bool EsParserH26x::SearchForNalu(uint64_t* position, Nalu* nalu) {
 bool EsParserH26x::ParseInternal() {
   uint64_t position;
   Nalu nalu;
-  VideoSliceInfo video_slice_info;
-  while (SearchForNalu(&position, &nalu)) {
-    // ITU H.264 sec. 7.4.1.2.3
-    // H264: The first of the NAL units with |can_start_access_unit() == true|
-    //   after the last VCL NAL unit of a primary coded picture specifies the
-    //   start of a new access unit.
-    // ITU H.265 sec. 7.4.2.4.4
-    // H265: The first of the NAL units with |can_start_access_unit() == true|
-    //   after the last VCL NAL unit preceding firstBlPicNalUnit (the first
-    //   VCL NAL unit of a coded picture with nuh_layer_id equal to 0), if
-    //   any, specifies the start of a new access unit.
-    if (nalu.can_start_access_unit()) {
-      if (!next_access_unit_position_set_) {
-        next_access_unit_position_set_ = true;
-        next_access_unit_position_ = position;
-      }
-      RCHECK(ProcessNalu(nalu, &video_slice_info));
-      if (nalu.is_vcl() && !video_slice_info.valid) {
-        // This could happen only if decoder config is not available yet. Drop
-        // this frame.
-        DCHECK(!current_video_slice_info_.valid);
-        next_access_unit_position_set_ = false;
-        continue;
-      }
-    } else if (nalu.is_vcl()) {
-      // This isn't the first VCL NAL unit. Next access unit should start after
-      // this NAL unit.
-      next_access_unit_position_set_ = false;
-      continue;
-    }
+  while (SearchForNalu(&position, &nalu))
+    RCHECK(ProcessNaluAt(position, nalu));
+  return true;
+}
 
-    // AUD shall be the first NAL unit if present. There shall be at most one
-    // AUD in any access unit. We can emit the current access unit which shall
-    // not contain the AUD.
-    if (nalu.is_aud()) {
-      RCHECK(EmitCurrentAccessUnit());
-      continue;
+bool EsParserH26x::ProcessNaluAt(uint64_t position, const Nalu& nalu) {
+  VideoSliceInfo video_slice_info;
+  // ITU H.264 sec. 7.4.1.2.3
+  // H264: The first of the NAL units with |can_start_access_unit() == true|
+  //   after the last VCL NAL unit of a primary coded picture specifies the
+  //   start of a new access unit.
+  // ITU H.265 sec. 7.4.2.4.4
+  // H265: The first of the NAL units with |can_start_access_unit() == true|
+  //   after the last VCL NAL unit preceding firstBlPicNalUnit (the first
+  //   VCL NAL unit of a coded picture with nuh_layer_id equal to 0), if
+  //   any, specifies the start of a new access unit.
+  if (nalu.can_start_access_unit()) {
+    if (!next_access_unit_position_set_) {
+      next_access_unit_position_set_ = true;
+      next_access_unit_position_ = position;
     }
-
-    // We can only determine if the current access unit ends after seeing
-    // another VCL NAL unit.
-    if (!video_slice_info.valid)
-      continue;
-
-    // Check if it is the first VCL NAL unit of a primary coded picture. It is
-    // always true for H265 as nuh_layer_id shall be == 0 at this point.
-    bool is_first_vcl_nalu = true;
-    if (type_ == Nalu::kH264) {
-      if (current_video_slice_info_.valid) {
-        // ITU H.264 sec. 7.4.1.2.4 Detection of the first VCL NAL unit of a
-        // primary coded picture. Only pps_id and frame_num are checked here.
-        is_first_vcl_nalu =
-            video_slice_info.frame_num != current_video_slice_info_.frame_num ||
-            video_slice_info.pps_id != current_video_slice_info_.pps_id;
-      }
+    RCHECK(ProcessNalu(nalu, &video_slice_info));
+    if (nalu.is_video_slice()) {
+      AddSliceHeaderSize(position,
+                         video_slice_info.valid
+                             ? static_cast<int64_t>(
+                                   video_slice_info.slice_header_size)
+                             : -1);
     }
-    if (!is_first_vcl_nalu) {
-      // This isn't the first VCL NAL unit. Next access unit should start after
-      // this NAL unit.
+    if (nalu.is_vcl() && !video_slice_info.valid) {
+      // This could happen only if decoder config is not available yet. Drop
+      // this frame.
+      DCHECK(!current_video_slice_info_.valid);
       next_access_unit_position_set_ = false;
-      continue;
+      return true;
+    }
+    if (checking_pes_start_ && nalu.is_vcl() &&
+        position >= pes_start_position_) {
+      checking_pes_start_ = false;
+      if (!video_slice_info.is_first_slice_in_picture) {
+        // H.222.0 also allows PES packets aligned to slices, so the picture
+        // emitted at the end of the previous PES packet was incomplete. Drop
+        // the rest of it and wait for the next access unit from now on.
+        LOG(WARNING) << "[MPEG-2 TS] PID " << pid()
+                     << " PES packet starts in the middle of a picture. The "
+                        "PES packets are not aligned to the access units.";
+        emit_at_pes_end_ = false;
+        current_video_slice_info_.valid = false;
+        next_access_unit_position_set_ = false;
+        return true;
+      }
     }
+  } else if (nalu.is_vcl()) {
+    // Not parsed, e.g. a slice of an enhancement layer.
+    if (nalu.is_video_slice())
+      AddSliceHeaderSize(position, -1);
+    // This isn't the first VCL NAL unit. Next access unit should start after
+    // this NAL unit.
+    next_access_unit_position_set_ = false;
+    return true;
+  }
 
-    DCHECK(next_access_unit_position_set_);
+  // AUD shall be the first NAL unit if present. There shall be at most one
+  // AUD in any access unit. We can emit the current access unit which shall
+  // not contain the AUD.
+  if (nalu.is_aud()) {
     RCHECK(EmitCurrentAccessUnit());
+    return true;
+  }
 
-    // Delete the data we have already processed.
-    es_queue_->Trim(next_access_unit_position_);
+  // We can only determine if the current access unit ends after seeing
+  // another VCL NAL unit.
+  if (!video_slice_info.valid)
+    return true;
 
-    current_access_unit_position_ = next_access_unit_position_;
-    current_video_slice_info_ = video_slice_info;
+  // Check if it is the first VCL NAL unit of a primary coded picture. It is
+  // always true for H265 as nuh_layer_id shall be == 0 at this point.
+  bool is_first_vcl_nalu = true;
+  if (type_ == Nalu::kH264) {
+    if (current_video_slice_info_.valid) {
+      // ITU H.264 sec. 7.4.1.2.4 Detection of the first VCL NAL unit of a
+      // primary coded picture. Only pps_id and frame_num are checked here.
+      is_first_vcl_nalu =
+          video_slice_info.frame_num != current_video_slice_info_.frame_num ||
+          video_slice_info.pps_id != current_video_slice_info_.pps_id;
+    }
+  }
+  if (!is_first_vcl_nalu) {
+    // This isn't the first VCL NAL unit. Next access unit should start after
+    // this NAL unit.
     next_access_unit_position_set_ = false;
+    return true;
   }
+
+  DCHECK(next_access_unit_position_set_);
+  RCHECK(EmitCurrentAccessUnit());
+
+  // Delete the data we have already processed.
+  es_queue_->Trim(next_access_unit_position_);
+
+  current_access_unit_position_ = next_access_unit_position_;
+  current_video_slice_info_ = video_slice_info;
+  next_access_unit_position_set_ = false;
+  return true;
+}
+
+bool EsParserH26x::EmitAccessUnitAtQueueEnd() {
+  // The last NAL unit ends at the end of the queue.
+  if (current_nalu_info_) {
+    const uint8_t* es;
+    int es_size;
+    es_queue_->PeekAt(current_nalu_info_->position, &es, &es_size);
+    const int nalu_size = es_size - current_nalu_info_->start_code_size;
+    const uint64_t position = current_nalu_info_->position;
+    Nalu nalu;
+    if (nalu_size > 0 &&
+        nalu.Initialize(type_, es + current_nalu_info_->start_code_size,
+                        nalu_size)) {
+      RCHECK(ProcessNaluAt(position, nalu));
+    }
+    current_nalu_info_.reset();
+  }
+  current_search_position_ = es_queue_->tail();
+
+  // The NAL units after the last VCL NAL unit which can start an access unit,
+  // if any, are kept for the next access unit.
+  if (!next_access_unit_position_set_) {
+    next_access_unit_position_set_ = true;
+    next_access_unit_position_ = es_queue_->tail();
+  }
+  RCHECK(EmitCurrentAccessUnit());
+
+  es_queue_->Trim(next_access_unit_position_);
+  current_access_unit_position_ = next_access_unit_position_;
+  if (next_access_unit_position_ == es_queue_->tail())
+    next_access_unit_position_set_ = false;
   return true;
 }
 
@@ -298,12 +401,20 @@ bool EsParserH26x::EmitFrame(int64_t access_unit_pos,
   const uint8_t* es;
   es_queue_->PeekAt(access_unit_pos, &es, &es_size);
 
-  // Convert frame to unit stream format.
+  // Convert frame to unit stream format, directly into the sample buffer if the
+  // converted frame fits, which is the case with 4-byte start codes.
+  std::shared_ptr<uint8_t> sample_data =
+      SampleBufferPool::Allocate(access_unit_size);
+  size_t sample_data_size = 0;
   std::vector<uint8_t> converted_frame;
   if (!stream_converter_->ConvertByteStreamToNalUnitStream(
-          es, access_unit_size, &converted_frame)) {
-    DLOG(ERROR) << "Failure to convert video frame to unit stream format.";
-    return false;
+          es, access_unit_size, sample_data.get(), &sample_data_size)) {
+    sample_data.reset();
+    if (!stream_converter_->ConvertByteStreamToNalUnitStream(
+            es, access_unit_size, &converted_frame)) {
+      DLOG(ERROR) << "Failure to convert video frame to unit stream format.";
+      return false;
+    }
   }
 
   // Update the video decoder configuration if needed.
@@ -311,8 +422,21 @@ bool EsParserH26x::EmitFrame(int64_t access_unit_pos,
 
   // Create the media sample, emitting always the previous sample after
   // calculating its duration.
-  std::shared_ptr<MediaSample> media_sample = MediaSample::CopyFrom(
-      converted_frame.data(), converted_frame.size(), is_key_frame);
+  std::shared_ptr<MediaSample> media_sample;
+  if (sample_data) {
+    media_sample = MediaSample::CreateEmptyMediaSample();
+    media_sample->TransferData(std::move(sample_data), sample_data_size);
+    media_sample->set_is_key_frame(is_key_frame);
+  } else {
+    media_sample = MediaSample::CopyFrom(
+        converted_frame.data(), converted_frame.size(), is_key_frame);
+  }
+  // The conversion keeps all the video slice NAL units, in order.
+  std::vector<size_t> slice_header_sizes;
+  if (TakeSliceHeaderSizes(access_unit_pos, access_unit_pos + access_unit_size,
+                           &slice_header_sizes)) {
+    media_sample->set_video_slice_header_sizes(std::move(slice_header_sizes));
+  }
   media_sample->set_dts(current_timing_desc.dts);
   media_sample->set_pts(current_timing_desc.pts);
   if (pending_sample_) {
@@ -346,6 +470,32 @@ bool EsParserH26x::EmitFrame(int64_t access_unit_pos,
   return true;
 }
 
+void EsParserH26x::AddSliceHeaderSize(uint64_t position,
+                                      int64_t slice_header_size) {
+  slice_header_size_list_.emplace_back(position, slice_header_size);
+}
+
+bool EsParserH26x::TakeSliceHeaderSizes(
+    uint64_t begin_position,
+    uint64_t end_position,
+    std::vector<size_t>* slice_header_sizes) {
+  bool known = true;
+  while (!slice_header_size_list_.empty() &&
+         slice_header_size_list_.front().first < end_position) {
+    // The NAL units before the access unit, if any, belong to frames which
+    // were dropped.
+    const std::pair<uint64_t, int64_t>& entry = slice_header_size_list_.front();
+    if (entry.first >= begin_position) {
+      if (entry.second < 0)
+        known = false;
+      else
+        slice_header_sizes->push_back(static_cast<size_t>(entry.second));
+    }
+    slice_header_size_list_.pop_front();
+  }
+  return known;
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -10,6 +10,7 @@
 #include <deque>
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "packager/base/callback.h"
 #include "packager/base/compiler_specific.h"
@@ -35,6 +36,7 @@ class EsParserH26x : public EsParser {
 
   // EsParser implementation overrides.
   bool Parse(const uint8_t* buf, int size, int64_t pts, int64_t dts) override;
+  bool OnPesEnd(bool data_alignment_indicator) override;
   bool Flush() override;
   void Reset() override;
 
@@ -46,6 +48,11 @@ class EsParserH26x : public EsParser {
     // only for H.264).
     int pps_id = 0;
     int frame_num = 0;
+    // The size of the slice header, excluding the NAL unit header.
+    size_t slice_header_size = 0;
+    // Whether it is the first slice of its picture, i.e. first_mb_in_slice
+    // is 0 for H.264 and first_slice_segment_in_pic_flag is set for H.265.
+    bool is_first_slice_in_picture = false;
   };
 
   const H26xByteToUnitStreamConverter* stream_converter() const {
@@ -87,6 +94,15 @@ class EsParserH26x : public EsParser {
   // Return true if successful.
   bool ParseInternal();
 
+  // Processes the complete NAL unit at |position| in the ES queue.
+  // Return true if successful.
+  bool ProcessNaluAt(uint64_t position, const Nalu& nalu);
+
+  // Ends the current access unit at the end of the ES queue and emits it,
+  // without waiting for the start of the next access unit.
+  // Return true if successful.
+  bool EmitAccessUnitAtQueueEnd();
+
   // Emit the current access unit if exists.
   bool EmitCurrentAccessUnit();
 
@@ -97,6 +113,16 @@ class EsParserH26x : public EsParser {
                  bool is_key_frame,
                  int pps_id);
 
+  // Records the slice header size of a video slice NAL unit at |position|,
+  // or -1 if it is unknown.
+  void AddSliceHeaderSize(uint64_t position, int64_t slice_header_size);
+  // Takes the slice header sizes of the access unit in
+  // [|begin_position|, |end_position|). Returns false if any of them is
+  // unknown.
+  bool TakeSliceHeaderSizes(uint64_t begin_position,
+                            uint64_t end_position,
+                            std::vector<size_t>* slice_header_sizes);
+
   // Callback to pass the frames.
   EmitSampleCB emit_sample_cb_;
 
@@ -106,6 +132,9 @@ class EsParserH26x : public EsParser {
   // Bytes of the ES stream that have not been emitted yet.
   std::unique_ptr<media::OffsetByteQueue> es_queue_;
   std::list<std::pair<int64_t, TimingDesc>> timing_desc_list_;
+  // Position -> slice header size of the video slice NAL units not emitted
+  // yet, so the subsamples can be generated without parsing them again.
+  std::list<std::pair<uint64_t, int64_t>> slice_header_size_list_;
 
   // Parser state.
   // The position of the search head.
@@ -131,6 +160,16 @@ class EsParserH26x : public EsParser {
 
   // Indicates whether waiting for first key frame.
   bool waiting_for_key_frame_ = true;
+
+  // Whether the access units are emitted at the end of their PES packets, set
+  // with --ts_access_unit_aligned_pes until a PES packet is seen which does
+  // not start with an access unit.
+  bool emit_at_pes_end_ = false;
+  // Whether the first NAL units of the PES packet being parsed, which start
+  // at |pes_start_position_|, still have to be checked to start an access
+  // unit.
+  bool checking_pes_start_ = false;
+  uint64_t pes_start_position_ = 0;
 };
 
 }  // namespace mp2t
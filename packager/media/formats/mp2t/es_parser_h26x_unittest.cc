@@ -4,6 +4,7 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include <vector>
@@ -16,6 +17,8 @@
 #include "packager/media/codecs/h26x_byte_to_unit_stream_converter.h"
 #include "packager/media/formats/mp2t/es_parser_h26x.h"
 
+DECLARE_bool(ts_access_unit_aligned_pes);
+
 namespace shaka {
 namespace media {
 namespace mp2t {
@@ -38,6 +41,11 @@ enum H26xNaluType {
   kH264VclFrame1 = Nalu::H264_NonIDRSlice | (1 << 6),
   kH264VclFrame2 = Nalu::H264_NonIDRSlice | (2 << 6),
   kH264VclFrame3 = Nalu::H264_NonIDRSlice | (3 << 6),
+  // The third bit tells that it is not the first slice of its picture.
+  kH264VclFrame1SecondSlice = Nalu::H264_NonIDRSlice | (5 << 6),
+  kH264VclFrame3SecondSlice = Nalu::H264_NonIDRSlice | (7 << 6),
+  // Set on the NAL units which are expected to be dropped.
+  kDropped = 1 << 10,
   kH264VclKeyFrame = Nalu::H264_IDRSlice | kH264RefIdc,
 
   kH265Aud = Nalu::H265_AUD,
@@ -53,6 +61,8 @@ enum H26xNaluType {
 
   // Used to separate expected access units.
   kSeparator = 0xff,
+  // Used to separate PES packets in an access unit.
+  kPesSeparator = 0xfe,
 };
 
 class FakeByteToUnitStreamConverter : public H26xByteToUnitStreamConverter {
@@ -106,6 +116,14 @@ class TestableEsParser : public EsParserH26x {
       // for testing purpose, the frame_num is coded in the first byte of
       // payload.
       video_slice_info->frame_num = nalu.data()[nalu.header_size()];
+      video_slice_info->is_first_slice_in_picture = true;
+      if (codec_type_ == Nalu::kH264) {
+        // It is followed by a bit set for the slices which do not start their
+        // picture.
+        video_slice_info->frame_num &= 3;
+        video_slice_info->is_first_slice_in_picture =
+            !(nalu.data()[nalu.header_size()] & 4);
+      }
     }
     return true;
   }
@@ -163,7 +181,16 @@ class EsParserH26xTest : public testing::Test {
                const H26xNaluType* types,
                size_t types_count);
 
-  // Returns the vector of samples data j
+  // Runs a test like RunTest(), passing each access unit to the parser as PES
+  // packets flagged with the data_alignment_indicator. The PES packets of an
+  // access unit are separated by |kPesSeparator|, and only the first one has
+  // a timestamp.
+  void RunAlignedPesTest(Nalu::CodecType codec_type,
+                         const H26xNaluType* types,
+                         size_t types_count);
+
+  // Returns the vector of samples data j. An access unit is split at
+  // |kPesSeparator| in the returned data, but not in |samples_|.
   std::vector<std::vector<uint8_t>> BuildSamplesData(Nalu::CodecType codec_type,
                                                      const H26xNaluType* types,
                                                      size_t types_count);
@@ -189,6 +216,9 @@ class EsParserH26xTest : public testing::Test {
   std::vector<std::vector<uint8_t>> samples_;
   size_t sample_count_;
   bool has_stream_info_;
+  // The number of samples emitted after each PES packet in
+  // RunAlignedPesTest().
+  std::vector<size_t> sample_counts_after_pes_;
 };
 
 // Return AnnexB samples data and stores NAL Unit samples data in |samples_|,
@@ -206,7 +236,10 @@ std::vector<std::vector<uint8_t>> EsParserH26xTest::BuildSamplesData(
   std::vector<uint8_t> annex_b_sample_data;
   CHECK_EQ(kSeparator, types[0]);
   for (size_t k = 1; k < types_count; k++) {
-    if (types[k] == kSeparator) {
+    if (types[k] == kPesSeparator) {
+      samples_data.push_back(annex_b_sample_data);
+      annex_b_sample_data.clear();
+    } else if (types[k] == kSeparator) {
       // We should not be emitting samples until we see a key frame.
       if (seen_key_frame)
         samples_.push_back(nal_unit_sample_data);
@@ -226,12 +259,14 @@ std::vector<std::vector<uint8_t>> EsParserH26xTest::BuildSamplesData(
       std::vector<uint8_t> es_data =
           CreateNalu(codec_type, types[k], static_cast<uint8_t>(k));
 
-      nal_unit_sample_data.push_back(0);
-      nal_unit_sample_data.push_back(0);
-      nal_unit_sample_data.push_back(0);
-      nal_unit_sample_data.push_back(static_cast<uint8_t>(es_data.size()));
-      nal_unit_sample_data.insert(nal_unit_sample_data.end(), es_data.begin(),
-                                  es_data.end());
+      if (!(types[k] & kDropped)) {
+        nal_unit_sample_data.push_back(0);
+        nal_unit_sample_data.push_back(0);
+        nal_unit_sample_data.push_back(0);
+        nal_unit_sample_data.push_back(static_cast<uint8_t>(es_data.size()));
+        nal_unit_sample_data.insert(nal_unit_sample_data.end(),
+                                    es_data.begin(), es_data.end());
+      }
 
       es_data.insert(es_data.begin(), kStartCode,
                      kStartCode + arraysize(kStartCode));
@@ -278,6 +313,42 @@ void EsParserH26xTest::RunTest(Nalu::CodecType codec_type,
   es_parser.Flush();
 }
 
+void EsParserH26xTest::RunAlignedPesTest(Nalu::CodecType codec_type,
+                                          const H26xNaluType* types,
+                                          size_t types_count) {
+  // Duration of one 25fps video frame in 90KHz clock units.
+  const uint32_t kMpegTicksPerFrame = 3600;
+
+  TestableEsParser es_parser(
+      codec_type,
+      base::Bind(&EsParserH26xTest::NewVideoConfig, base::Unretained(this)),
+      base::Bind(&EsParserH26xTest::EmitSample, base::Unretained(this)));
+
+  std::vector<bool> starts_access_unit;
+  for (size_t k = 0; k < types_count; k++) {
+    if (types[k] == kSeparator || types[k] == kPesSeparator)
+      starts_access_unit.push_back(types[k] == kSeparator);
+  }
+  const std::vector<std::vector<uint8_t>> pes_data =
+      BuildSamplesData(codec_type, types, types_count);
+  ASSERT_EQ(starts_access_unit.size(), pes_data.size());
+
+  int64_t timestamp = 0;
+  for (size_t k = 0; k < pes_data.size(); k++) {
+    int64_t pts = kNoTimestamp;
+    if (starts_access_unit[k]) {
+      pts = timestamp;
+      timestamp += kMpegTicksPerFrame;
+    }
+    ASSERT_TRUE(es_parser.Parse(pes_data[k].data(),
+                                static_cast<int>(pes_data[k].size()), pts,
+                                pts));
+    ASSERT_TRUE(es_parser.OnPesEnd(true));
+    sample_counts_after_pes_.push_back(sample_count_);
+  }
+  es_parser.Flush();
+}
+
 TEST_F(EsParserH26xTest, H265BasicSupport) {
   const H26xNaluType kData[] = {
     kSeparator, kH265Aud, kH265Sps, kH265VclKeyFrame,
@@ -453,6 +524,63 @@ TEST_F(EsParserH26xTest, H264DoesNotStartOnRsv) {
   EXPECT_TRUE(has_stream_info_);
 }
 
+// H.222.0 also allows the PES packets flagged with the data_alignment_indicator
+// to be aligned to slices.
+TEST_F(EsParserH26xTest, H264PictureSplitAcrossAlignedPes) {
+  const H26xNaluType kData[] = {
+    kSeparator, kH264Aud, kH264Sps, kH264VclKeyFrame,
+    kSeparator, kH264Aud, kH264VclFrame1,
+    kPesSeparator, kH264VclFrame1SecondSlice,
+    kSeparator, kH264Aud, kH264VclFrame2,
+  };
+
+  RunAlignedPesTest(Nalu::kH264, kData, arraysize(kData));
+  // The picture is emitted as a whole, once the next one starts.
+  EXPECT_EQ(3u, sample_count_);
+  EXPECT_EQ(std::vector<size_t>({0, 1, 1, 2}), sample_counts_after_pes_);
+}
+
+TEST_F(EsParserH26xTest, H264AccessUnitAlignedPes) {
+  google::FlagSaver flag_saver;
+  FLAGS_ts_access_unit_aligned_pes = true;
+
+  const H26xNaluType kData[] = {
+    kSeparator, kH264Aud, kH264Sps, kH264VclKeyFrame,
+    kSeparator, kH264Aud, kH264VclFrame1,
+    kSeparator, kH264Sei, kH264VclFrame2,
+  };
+
+  RunAlignedPesTest(Nalu::kH264, kData, arraysize(kData));
+  // Each access unit is emitted at the end of its PES packet.
+  EXPECT_EQ(3u, sample_count_);
+  EXPECT_EQ(std::vector<size_t>({1, 2, 3}), sample_counts_after_pes_);
+}
+
+TEST_F(EsParserH26xTest, H264AccessUnitAlignedPesStopsAtPictureSplit) {
+  google::FlagSaver flag_saver;
+  FLAGS_ts_access_unit_aligned_pes = true;
+
+  const H26xNaluType kData[] = {
+    kSeparator, kH264Aud, kH264Sps, kH264VclKeyFrame,
+    kSeparator, kH264Aud, kH264VclFrame1,
+    kPesSeparator, static_cast<H26xNaluType>(kH264VclFrame1SecondSlice |
+                                             kDropped),
+    kSeparator, kH264Aud, kH264VclFrame2,
+    kSeparator, kH264Aud, kH264VclFrame3,
+    kPesSeparator, kH264VclFrame3SecondSlice,
+    kSeparator, kH264Aud, kH264VclFrame0,
+  };
+
+  // The first slice of the first split picture was emitted before the split
+  // was seen, and its second slice is dropped. The access units are emitted
+  // once the next one starts from then on, so the next split picture is
+  // emitted as a whole.
+  RunAlignedPesTest(Nalu::kH264, kData, arraysize(kData));
+  EXPECT_EQ(5u, sample_count_);
+  EXPECT_EQ(std::vector<size_t>({1, 2, 2, 2, 3, 3, 4}),
+            sample_counts_after_pes_);
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
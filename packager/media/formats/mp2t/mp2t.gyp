@@ -65,6 +65,8 @@
         '../../base/media_base.gyp:media_base',
         '../../crypto/crypto.gyp:crypto',
         '../../codecs/codecs.gyp:codecs',
+        '../../../metrics/metrics.gyp:metrics',
+        '../../../third_party/gflags/gflags.gyp:gflags',
         '../dvb/dvb.gyp:dvb',
       ],
     },
@@ -74,6 +76,7 @@
       'sources': [
         'ac3_header_unittest.cc',
         'adts_header_unittest.cc',
+        'es_parser_audio_unittest.cc',
         'es_parser_h264_unittest.cc',
         'es_parser_h26x_unittest.cc',
         'mp2t_media_parser_unittest.cc',
@@ -86,6 +89,7 @@
       'dependencies': [
         '../../../testing/gtest.gyp:gtest',
         '../../../testing/gmock.gyp:gmock',
+        '../../../third_party/gflags/gflags.gyp:gflags',
         '../../codecs/codecs.gyp:codecs',
         '../../event/media_event.gyp:mock_muxer_listener',
         '../../test/media_test.gyp:media_test_support',
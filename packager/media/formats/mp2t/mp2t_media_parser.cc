@@ -4,12 +4,16 @@
 
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "packager/base/bind.h"
+#include "packager/base/strings/string_number_conversions.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/base/text_sample.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/media/formats/mp2t/es_parser.h"
 #include "packager/media/formats/mp2t/es_parser_audio.h"
 #include "packager/media/formats/mp2t/es_parser_dvb.h"
@@ -22,11 +26,20 @@
 #include "packager/media/formats/mp2t/ts_section_pes.h"
 #include "packager/media/formats/mp2t/ts_section_pmt.h"
 #include "packager/media/formats/mp2t/ts_stream_type.h"
+#include "packager/metrics/metrics.h"
 
 namespace shaka {
 namespace media {
 namespace mp2t {
 
+namespace {
+// The minimum video time between two heartbeats sent to the text streams.
+const int64_t kTextHeartbeatInterval = kMpeg2Timescale;
+// Maximum number of bytes of the samples queued until the stream info of all
+// the PIDs is known, e.g. when a PID lacks the headers it needs.
+const uint64_t kQueuedBytesLimit = 256 << 20;
+}  // namespace
+
 class PidState {
  public:
   enum PidType {
@@ -45,6 +58,21 @@ class PidState {
   // Return true if successful.
   bool PushTsPacket(const TsPacket& ts_packet);
 
+  // Check the continuity counter of the TS packet against the previous TS
+  // packet of the PID. Return false if TS packets were lost or reordered.
+  bool CheckContinuity(const TsPacket& ts_packet);
+
+  // Queue a copy of the TS packet at |ts_packet_data|, to be parsed later with
+  // ParseQueuedTsPackets().
+  void QueueTsPacket(const uint8_t* ts_packet_data);
+  bool HasQueuedTsPackets() const { return !queued_ts_packets_.empty(); }
+  // Parse the queued TS packets with |sample_buffer_pool| installed, which may
+  // be NULL. May run on a worker thread: the section parser callbacks must
+  // only touch the state of this PID. The result is in
+  // queued_ts_packets_parsed().
+  void ParseQueuedTsPackets(SampleBufferPool* sample_buffer_pool);
+  bool queued_ts_packets_parsed() const { return queued_ts_packets_parsed_; }
+
   // Flush the PID state (possibly emitting some pending frames)
   // and reset its state.
   bool Flush();
@@ -73,6 +101,11 @@ class PidState {
 
   std::deque<std::shared_ptr<MediaSample>> media_sample_queue_;
   std::deque<std::shared_ptr<TextSample>> text_sample_queue_;
+  // The stream infos from the ES parser, when it runs on a worker thread.
+  std::vector<std::shared_ptr<StreamInfo>> stream_info_queue_;
+
+  std::vector<uint8_t> queued_ts_packets_;
+  bool queued_ts_packets_parsed_ = true;
 
   bool enable_;
   int continuity_counter_;
@@ -98,14 +131,6 @@ bool PidState::PushTsPacket(const TsPacket& ts_packet) {
   if (!enable_)
     return true;
 
-  int expected_continuity_counter = (continuity_counter_ + 1) % 16;
-  if (continuity_counter_ >= 0 &&
-      ts_packet.continuity_counter() != expected_continuity_counter) {
-    LOG(ERROR) << "TS discontinuity detected for pid: " << pid_;
-    // TODO(tinskip): Handle discontinuity better.
-    return false;
-  }
-
   bool status = section_parser_->Parse(
       ts_packet.payload_unit_start_indicator(),
       ts_packet.payload(),
@@ -121,6 +146,42 @@ bool PidState::PushTsPacket(const TsPacket& ts_packet) {
   return status;
 }
 
+bool PidState::CheckContinuity(const TsPacket& ts_packet) {
+  // The continuity counter is only incremented by the TS packets with a
+  // payload. A TS packet may be sent twice with the same counter.
+  if (ts_packet.payload_size() == 0)
+    return true;
+  const int previous_continuity_counter = continuity_counter_;
+  continuity_counter_ = ts_packet.continuity_counter();
+  return previous_continuity_counter < 0 ||
+         ts_packet.discontinuity_indicator() ||
+         continuity_counter_ == previous_continuity_counter ||
+         continuity_counter_ == (previous_continuity_counter + 1) % 16;
+}
+
+void PidState::QueueTsPacket(const uint8_t* ts_packet_data) {
+  queued_ts_packets_.insert(queued_ts_packets_.end(), ts_packet_data,
+                            ts_packet_data + TsPacket::kPacketSize);
+}
+
+void PidState::ParseQueuedTsPackets(SampleBufferPool* sample_buffer_pool) {
+  ScopedSampleBufferPool scoped_sample_buffer_pool(sample_buffer_pool);
+  queued_ts_packets_parsed_ = true;
+  for (size_t pos = 0; pos < queued_ts_packets_.size();
+       pos += TsPacket::kPacketSize) {
+    // The TS packets were parsed once before being queued, so this does not
+    // fail.
+    std::unique_ptr<TsPacket> ts_packet(TsPacket::Parse(
+        queued_ts_packets_.data() + pos, TsPacket::kPacketSize));
+    DCHECK(ts_packet);
+    if (!ts_packet || !PushTsPacket(*ts_packet)) {
+      queued_ts_packets_parsed_ = false;
+      break;
+    }
+  }
+  queued_ts_packets_.clear();
+}
+
 bool PidState::Flush() {
   RCHECK(section_parser_->Flush());
   ResetState();
@@ -150,11 +211,17 @@ void PidState::ResetState() {
 
 Mp2tMediaParser::Mp2tMediaParser()
     : sbr_in_mimetype_(false),
+      pid_table_(TsSection::kPidMax + 1),
       is_initialized_(false) {
 }
 
 Mp2tMediaParser::~Mp2tMediaParser() {}
 
+void Mp2tMediaParser::EnableParallelEsParsing(size_t num_threads) {
+  DCHECK(pids_.empty());
+  es_parser_pool_.reset(new WorkStealingThreadPool(num_threads));
+}
+
 void Mp2tMediaParser::Init(const InitCB& init_cb,
                            const NewMediaSampleCB& new_media_sample_cb,
                            const NewTextSampleCB& new_text_sample_cb,
@@ -179,8 +246,11 @@ bool Mp2tMediaParser::Flush() {
     PidState* pid_state = pair.second.get();
     RCHECK(pid_state->Flush());
   }
+  EmitQueuedStreamInfos();
   bool result = EmitRemainingSamples();
   pids_.clear();
+  last_text_heartbeat_time_ = kNoTimestamp;
+  std::fill(pid_table_.begin(), pid_table_.end(), nullptr);
 
   // Remove any bytes left in the TS buffer.
   // (i.e. any partial TS packet => less than 188 bytes).
@@ -210,6 +280,16 @@ bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
       continue;
     }
 
+    // Skip the TS packets that would be ignored without parsing them. The PID
+    // is in the 13 bits following the sync byte and three flags.
+    const int pid = ((ts_buffer[1] & 0x1f) << 8) | ts_buffer[2];
+    PidState* pid_state = pid_table_[pid];
+    if (!pid_state && pid != TsSection::kPidPat) {
+      DVLOG(LOG_LEVEL_TS) << "Ignoring TS packet for pid: " << pid;
+      ts_byte_queue_.Pop(TsPacket::kPacketSize);
+      continue;
+    }
+
     // Parse the TS header, skipping 1 byte if the header is invalid.
     std::unique_ptr<TsPacket> ts_packet(
         TsPacket::Parse(ts_buffer, ts_buffer_size));
@@ -223,32 +303,89 @@ bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
         << " start_unit=" << ts_packet->payload_unit_start_indicator();
 
     // Parse the section.
-    auto it = pids_.find(ts_packet->pid());
-    if (it == pids_.end() &&
-        ts_packet->pid() == TsSection::kPidPat) {
+    if (!pid_state) {
+      DCHECK_EQ(ts_packet->pid(), TsSection::kPidPat);
       // Create the PAT state here if needed.
       std::unique_ptr<TsSection> pat_section_parser(new TsSectionPat(
           base::Bind(&Mp2tMediaParser::RegisterPmt, base::Unretained(this))));
       std::unique_ptr<PidState> pat_pid_state(new PidState(
           ts_packet->pid(), PidState::kPidPat, std::move(pat_section_parser)));
       pat_pid_state->Enable();
-      it = pids_.emplace(ts_packet->pid(), std::move(pat_pid_state)).first;
+      pid_state = pat_pid_state.get();
+      pid_table_[ts_packet->pid()] = pid_state;
+      pids_.emplace(ts_packet->pid(), std::move(pat_pid_state));
     }
-
-    if (it != pids_.end()) {
-      RCHECK(it->second->PushTsPacket(*ts_packet));
+    // The TS packets lost or reordered, e.g. on a UDP input, are only
+    // counted: the section parsers recover on their own.
+    if (pid_state->IsEnabled() && !pid_state->CheckContinuity(*ts_packet)) {
+      LOG(WARNING) << "TS discontinuity detected for pid: " << pid;
+      if (!metrics_input_.empty()) {
+        Metrics::GetInstance()->IncrementCounter(
+            "shaka_ts_continuity_errors",
+            "TS packets of an input with an unexpected continuity counter, "
+            "i.e. TS packets lost or reordered.",
+            {{"input", metrics_input_}}, 1);
+      }
+    }
+    // In parallel mode, the PES packets are parsed together after the loop,
+    // each PID on its own thread.
+    if (es_parser_pool_ && pid_state->pid_type() != PidState::kPidPat &&
+        pid_state->pid_type() != PidState::kPidPmt) {
+      pid_state->QueueTsPacket(ts_buffer);
     } else {
-      DVLOG(LOG_LEVEL_TS) << "Ignoring TS packet for pid: " << ts_packet->pid();
+      RCHECK(pid_state->PushTsPacket(*ts_packet));
     }
 
     // Go to the next packet.
     ts_byte_queue_.Pop(TsPacket::kPacketSize);
   }
+  RCHECK(ParseQueuedTsPackets());
 
   // Emit the A/V buffers that kept accumulating during TS parsing.
   return EmitRemainingSamples();
 }
 
+bool Mp2tMediaParser::ParseQueuedTsPackets() {
+  if (!es_parser_pool_)
+    return true;
+
+  std::vector<base::Closure> tasks;
+  for (const auto& pair : pids_) {
+    if (pair.second->HasQueuedTsPackets()) {
+      tasks.push_back(base::Bind(&PidState::ParseQueuedTsPackets,
+                                 base::Unretained(pair.second.get()),
+                                 SampleBufferPool::Current()));
+    }
+  }
+  es_parser_pool_->RunTasksAndWait(tasks);
+
+  bool result = true;
+  for (const auto& pair : pids_) {
+    if (!pair.second->queued_ts_packets_parsed())
+      result = false;
+  }
+  EmitQueuedStreamInfos();
+  return result;
+}
+
+void Mp2tMediaParser::EmitQueuedStreamInfos() {
+  for (const auto& pair : pids_) {
+    std::vector<std::shared_ptr<StreamInfo>> stream_infos;
+    stream_infos.swap(pair.second->stream_info_queue_);
+    for (std::shared_ptr<StreamInfo>& stream_info : stream_infos)
+      OnNewStreamInfo(pair.first, std::move(stream_info));
+  }
+}
+
+void Mp2tMediaParser::DisableTrack(uint32_t track_id) {
+  // The track ID is the PID of the PES packets of the track. The state of the
+  // PID is kept, as the track may be disabled from one of its callbacks.
+  if (track_id > TsSection::kPidMax)
+    return;
+  disabled_pids_[track_id] = true;
+  pid_table_[track_id] = nullptr;
+}
+
 void Mp2tMediaParser::RegisterPmt(int program_number, int pmt_pid) {
   DVLOG(1) << "RegisterPmt:"
            << " program_number=" << program_number
@@ -270,7 +407,9 @@ void Mp2tMediaParser::RegisterPmt(int program_number, int pmt_pid) {
   std::unique_ptr<PidState> pmt_pid_state(
       new PidState(pmt_pid, PidState::kPidPmt, std::move(pmt_section_parser)));
   pmt_pid_state->Enable();
-  pids_.emplace(pmt_pid, std::move(pmt_pid_state));
+  auto result = pids_.emplace(pmt_pid, std::move(pmt_pid_state));
+  if (result.second)
+    pid_table_[pmt_pid] = result.first->second.get();
 }
 
 void Mp2tMediaParser::RegisterPes(int pmt_pid,
@@ -287,8 +426,12 @@ void Mp2tMediaParser::RegisterPes(int pmt_pid,
   // Create a stream parser corresponding to the stream type.
   PidState::PidType pid_type = PidState::kPidVideoPes;
   std::unique_ptr<EsParser> es_parser;
-  auto on_new_stream = base::Bind(&Mp2tMediaParser::OnNewStreamInfo,
-                                  base::Unretained(this), pes_pid);
+  // The stream infos from an ES parser running on a worker thread are queued
+  // until all the workers are done, as the initialization looks at all PIDs.
+  auto on_new_stream =
+      base::Bind(es_parser_pool_ ? &Mp2tMediaParser::QueueNewStreamInfo
+                                 : &Mp2tMediaParser::OnNewStreamInfo,
+                 base::Unretained(this), pes_pid);
   auto on_emit_media = base::Bind(&Mp2tMediaParser::OnEmitMediaSample,
                                   base::Unretained(this), pes_pid);
   auto on_emit_text = base::Bind(&Mp2tMediaParser::OnEmitTextSample,
@@ -331,6 +474,8 @@ void Mp2tMediaParser::RegisterPes(int pmt_pid,
   std::unique_ptr<PidState> pes_pid_state(
       new PidState(pes_pid, pid_type, std::move(pes_section_parser)));
   pes_pid_state->Enable();
+  if (!disabled_pids_[pes_pid])
+    pid_table_[pes_pid] = pes_pid_state.get();
   pids_.emplace(pes_pid, std::move(pes_pid_state));
 }
 
@@ -354,12 +499,25 @@ void Mp2tMediaParser::OnNewStreamInfo(
   } else {
     LOG(WARNING) << "Ignoring unsupported stream with pid=" << pes_pid;
     pid_state->second->Disable();
+    pid_table_[pes_pid] = nullptr;
   }
 
   // Finish initialization if all streams have configs.
   FinishInitializationIfNeeded();
 }
 
+void Mp2tMediaParser::QueueNewStreamInfo(
+    uint32_t pes_pid,
+    std::shared_ptr<StreamInfo> new_stream_info) {
+  auto pid_state = pids_.find(pes_pid);
+  if (pid_state == pids_.end()) {
+    LOG(ERROR) << "PID State for new stream not found (pid = " << pes_pid
+               << ").";
+    return;
+  }
+  pid_state->second->stream_info_queue_.push_back(std::move(new_stream_info));
+}
+
 bool Mp2tMediaParser::FinishInitializationIfNeeded() {
   // Nothing to be done if already initialized.
   if (is_initialized_)
@@ -433,7 +591,28 @@ bool Mp2tMediaParser::EmitRemainingSamples() {
 
   // No buffer should be sent until fully initialized.
   if (!is_initialized_)
-    return true;
+    return CheckQueuedSamples();
+  if (queued_bytes_ > 0) {
+    queued_bytes_ = 0;
+    UpdateQueuedBytesGauge();
+  }
+
+  // The text streams, e.g. DVB subtitles, are sparse: they are sent the video
+  // time as a heartbeat, at most every |kTextHeartbeatInterval|, so their
+  // segments are emitted as the video progresses.
+  int64_t video_time = kNoTimestamp;
+  for (const auto& pid_pair : pids_) {
+    if (pid_pair.second->pid_type() != PidState::kPidVideoPes)
+      continue;
+    for (const auto& sample : pid_pair.second->media_sample_queue_)
+      video_time = std::max(video_time, sample->pts());
+  }
+  const bool send_text_heartbeat =
+      video_time != kNoTimestamp &&
+      (last_text_heartbeat_time_ == kNoTimestamp ||
+       video_time >= last_text_heartbeat_time_ + kTextHeartbeatInterval);
+  if (send_text_heartbeat)
+    last_text_heartbeat_time_ = video_time;
 
   // Buffer emission.
   for (const auto& pid_pair : pids_) {
@@ -446,11 +625,59 @@ bool Mp2tMediaParser::EmitRemainingSamples() {
       RCHECK(new_text_sample_cb_.Run(pid_pair.first, sample));
     }
     pid_pair.second->text_sample_queue_.clear();
+
+    if (send_text_heartbeat &&
+        pid_pair.second->pid_type() == PidState::kPidTextPes &&
+        pid_pair.second->IsEnabled()) {
+      RCHECK(new_text_sample_cb_.Run(pid_pair.first,
+                                     TextSample::CreateHeartbeat(video_time)));
+    }
   }
 
   return true;
 }
 
+bool Mp2tMediaParser::CheckQueuedSamples() {
+  uint64_t queued_bytes = 0;
+  for (const auto& pid_pair : pids_) {
+    for (const auto& sample : pid_pair.second->media_sample_queue_)
+      queued_bytes += sample->data_size();
+  }
+  if (queued_bytes == queued_bytes_)
+    return true;
+  queued_bytes_ = queued_bytes;
+  UpdateQueuedBytesGauge();
+  if (queued_bytes_ <= kQueuedBytesLimit)
+    return true;
+
+  std::string pids_without_config;
+  for (const auto& pid_pair : pids_) {
+    const PidState::PidType pid_type = pid_pair.second->pid_type();
+    if ((pid_type == PidState::kPidAudioPes ||
+         pid_type == PidState::kPidVideoPes ||
+         pid_type == PidState::kPidTextPes) &&
+        pid_pair.second->IsEnabled() && !pid_pair.second->config()) {
+      if (!pids_without_config.empty())
+        pids_without_config += ", ";
+      pids_without_config += base::IntToString(pid_pair.first);
+    }
+  }
+  LOG(ERROR) << "Queued samples limit reached: " << kQueuedBytesLimit
+             << " bytes. No stream info for PIDs " << pids_without_config
+             << ".";
+  return false;
+}
+
+void Mp2tMediaParser::UpdateQueuedBytesGauge() {
+  if (metrics_input_.empty())
+    return;
+  Metrics::GetInstance()->SetGauge(
+      "shaka_demuxer_queued_sample_bytes",
+      "Bytes of the samples of an input queued until the stream info of all "
+      "its streams is known.",
+      {{"input", metrics_input_}}, static_cast<double>(queued_bytes_));
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -9,28 +9,43 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "packager/media/base/byte_queue.h"
 #include "packager/media/base/media_parser.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/timestamp.h"
+#include "packager/media/formats/mp2t/ts_section.h"
 #include "packager/media/formats/mp2t/ts_stream_type.h"
 
 namespace shaka {
 namespace media {
 
 class MediaSample;
+class WorkStealingThreadPool;
 
 namespace mp2t {
 
 class PidState;
 class TsPacket;
-class TsSection;
 
 class Mp2tMediaParser : public MediaParser {
  public:
   Mp2tMediaParser();
   ~Mp2tMediaParser() override;
 
+  /// Parse the PES packets of each PID, i.e. run the ES parsers, in parallel on
+  /// a pool of threads. The samples are still emitted in the same order, on
+  /// the thread calling Parse() or Flush(). Must be called before parsing.
+  /// @param num_threads is the number of threads of the pool. A value of zero
+  ///        means the number of processors.
+  void EnableParallelEsParsing(size_t num_threads);
+
+  /// Count the TS continuity counter errors in the metrics.
+  /// @param input is the name of the input in the metrics.
+  void set_metrics_input(const std::string& input) { metrics_input_ = input; }
+
   /// @name MediaParser implementation overrides.
   /// @{
   void Init(const InitCB& init_cb,
@@ -39,6 +54,7 @@ class Mp2tMediaParser : public MediaParser {
             KeySource* decryption_key_source) override;
   bool Flush() override WARN_UNUSED_RESULT;
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  void DisableTrack(uint32_t track_id) override;
   /// @}
 
  private:
@@ -60,6 +76,15 @@ class Mp2tMediaParser : public MediaParser {
   // changed.
   void OnNewStreamInfo(uint32_t pes_pid,
                        std::shared_ptr<StreamInfo> new_stream_info);
+  // Same as OnNewStreamInfo(), but called from a worker thread in parallel
+  // mode. The stream info is queued for EmitQueuedStreamInfos().
+  void QueueNewStreamInfo(uint32_t pes_pid,
+                          std::shared_ptr<StreamInfo> new_stream_info);
+  void EmitQueuedStreamInfos();
+
+  // In parallel mode, parse the TS packets queued by Parse() for each PID on
+  // the pool, then handle the stream infos found. Return true if successful.
+  bool ParseQueuedTsPackets();
 
   // Callback invoked by the ES media parser
   // to emit a new audio/video access unit.
@@ -72,6 +97,11 @@ class Mp2tMediaParser : public MediaParser {
   bool FinishInitializationIfNeeded();
 
   bool EmitRemainingSamples();
+  // Update |queued_bytes_| while not initialized. Return false if too many
+  // samples are queued.
+  bool CheckQueuedSamples();
+  // Export |queued_bytes_| as a gauge, if the metrics are recorded.
+  void UpdateQueuedBytesGauge();
 
   /// Set the value of the "SBR in mime-type" flag which leads to sample rate
   /// doubling. Default value is false.
@@ -93,8 +123,25 @@ class Mp2tMediaParser : public MediaParser {
   // has a deterministic order.
   std::map<int, std::unique_ptr<PidState>> pids_;
 
+  // The states of the PIDs whose TS packets are parsed, indexed by PID, i.e.
+  // the enabled PIDs in |pids_|. The TS packets of the other PIDs, e.g. of the
+  // other programs or of the disabled tracks, are skipped before being parsed.
+  std::vector<PidState*> pid_table_;
+  // Runs the ES parsers in parallel mode.
+  std::unique_ptr<WorkStealingThreadPool> es_parser_pool_;
+  // The name of the input in the metrics, if they are recorded.
+  std::string metrics_input_;
+
+  // The PIDs of the tracks disabled with DisableTrack().
+  std::bitset<TsSection::kPidMax + 1> disabled_pids_;
+
   // Whether |init_cb_| has been invoked.
   bool is_initialized_;
+  // The bytes of the media samples queued until |init_cb_| is invoked.
+  uint64_t queued_bytes_ = 0;
+
+  // The video time of the last heartbeat sent to the text streams.
+  int64_t last_text_heartbeat_time_ = kNoTimestamp;
 
   // A map used to track unsupported stream types and make sure the error is
   // only logged once.
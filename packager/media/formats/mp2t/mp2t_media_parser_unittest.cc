@@ -16,7 +16,9 @@
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
+#include "packager/media/formats/mp2t/ts_packet.h"
 #include "packager/media/test/test_data_util.h"
+#include "packager/metrics/metrics.h"
 
 namespace shaka {
 namespace media {
@@ -41,6 +43,7 @@ class Mp2tMediaParserTest : public testing::Test {
   int video_frame_count_;
   int64_t video_min_dts_;
   int64_t video_max_dts_;
+  bool disable_audio_tracks_ = false;
 
   bool AppendData(const uint8_t* data, size_t length) {
     return parser_->Parse(data, static_cast<int>(length));
@@ -66,6 +69,8 @@ class Mp2tMediaParserTest : public testing::Test {
     for (const auto& stream_info : stream_infos) {
       DVLOG(1) << stream_info->ToString();
       stream_map_[stream_info->track_id()] = stream_info;
+      if (disable_audio_tracks_ && stream_info->stream_type() == kStreamAudio)
+        parser_->DisableTrack(stream_info->track_id());
     }
   }
 
@@ -163,6 +168,79 @@ TEST_F(Mp2tMediaParserTest, TimestampWrapAround) {
   EXPECT_GT(video_max_dts_, static_cast<int64_t>(1) << 33);
 }
 
+// The samples are the same with the ES parsers running on other threads.
+TEST_F(Mp2tMediaParserTest, ParallelEsParsing) {
+  ParseMpeg2TsFile("bear-640x360.ts", 512);
+  EXPECT_TRUE(parser_->Flush());
+  const int audio_frame_count = audio_frame_count_;
+  const int64_t video_min_dts = video_min_dts_;
+  const int64_t video_max_dts = video_max_dts_;
+
+  parser_.reset(new Mp2tMediaParser());
+  parser_->EnableParallelEsParsing(2);
+  stream_map_.clear();
+  audio_frame_count_ = 0;
+  video_frame_count_ = 0;
+  video_min_dts_ = kNoTimestamp;
+  video_max_dts_ = kNoTimestamp;
+  ParseMpeg2TsFile("bear-640x360.ts", 512);
+  EXPECT_EQ(79, video_frame_count_);
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+  EXPECT_EQ(audio_frame_count, audio_frame_count_);
+  EXPECT_EQ(video_min_dts, video_min_dts_);
+  EXPECT_EQ(video_max_dts, video_max_dts_);
+}
+
+TEST_F(Mp2tMediaParserTest, DisableTrack) {
+  ParseMpeg2TsFile("bear-640x360.ts", 512);
+  EXPECT_TRUE(parser_->Flush());
+  const int audio_frame_count = audio_frame_count_;
+  ASSERT_GT(audio_frame_count, 0);
+
+  // Only the audio frames parsed before the audio track is disabled, right
+  // after initialization, are emitted.
+  parser_.reset(new Mp2tMediaParser());
+  stream_map_.clear();
+  audio_frame_count_ = 0;
+  video_frame_count_ = 0;
+  video_min_dts_ = kNoTimestamp;
+  video_max_dts_ = kNoTimestamp;
+  disable_audio_tracks_ = true;
+  ParseMpeg2TsFile("bear-640x360.ts", 512);
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+  EXPECT_LT(audio_frame_count_, audio_frame_count);
+}
+
+TEST_F(Mp2tMediaParserTest, ContinuityErrors) {
+  std::vector<uint8_t> buffer = ReadTestDataFile("bear-640x360.ts");
+  ASSERT_EQ(0u, buffer.size() % TsPacket::kPacketSize);
+  // Simulate the loss of a TS packet by incrementing the continuity counters
+  // of the next TS packets of its PID, leaving the payloads intact.
+  const size_t kLostPacket = 100;
+  uint8_t* lost_packet = &buffer[kLostPacket * TsPacket::kPacketSize];
+  const int lost_pid = ((lost_packet[1] & 0x1f) << 8) | lost_packet[2];
+  for (size_t pos = kLostPacket * TsPacket::kPacketSize; pos < buffer.size();
+       pos += TsPacket::kPacketSize) {
+    uint8_t* packet = &buffer[pos];
+    if ((((packet[1] & 0x1f) << 8) | packet[2]) == lost_pid)
+      packet[3] = (packet[3] & 0xf0) | ((packet[3] + 1) & 0x0f);
+  }
+
+  Metrics::GetInstance()->Clear();
+  parser_->set_metrics_input("bear-640x360.ts");
+  InitializeParser();
+  EXPECT_TRUE(AppendDataInPieces(buffer.data(), buffer.size(), 512));
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+  EXPECT_NE(std::string::npos,
+            Metrics::GetInstance()->ToOpenMetrics().find(
+                "shaka_ts_continuity_errors_total{input=\"bear-640x360.ts\"} "
+                "1\n"));
+  Metrics::GetInstance()->Clear();
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
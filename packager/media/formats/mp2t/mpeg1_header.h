@@ -22,6 +22,7 @@ class Mpeg1Header : public AudioHeader {
   /// @name AudioHeader implementation overrides.
   /// @{
   bool IsSyncWord(const uint8_t* buf) const override;
+  uint8_t GetSyncWordFirstByte() const override;
   size_t GetMinFrameSize() const override;
   size_t GetSamplesPerFrame() const override;
   bool Parse(const uint8_t* mpeg1_frame, size_t mpeg1_frame_size) override;
@@ -13,6 +13,15 @@ namespace mp2t {
 PesPacket::PesPacket() {}
 PesPacket::~PesPacket() {}
 
+size_t PesPacket::payload_size() const {
+  if (spans_.empty())
+    return data_.size();
+  size_t size = 0;
+  for (const DataSpan& span : spans_)
+    size += span.size;
+  return size;
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
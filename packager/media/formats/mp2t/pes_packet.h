@@ -8,9 +8,11 @@
 #define PACKAGER_MEDIA_FORMATS_MP2T_PES_PACKET_H_
 
 #include <stdint.h>
+#include <memory>
 #include <vector>
 
 #include "packager/base/macros.h"
+#include "packager/media/base/data_span.h"
 
 namespace shaka {
 namespace media {
@@ -55,6 +57,20 @@ class PesPacket {
   /// @return mutable data for this PES.
   std::vector<uint8_t>* mutable_data() { return &data_; }
 
+  /// @return the spans the payload is made of. The bytes of the null spans are
+  ///         in data(), in order. If there are no spans, the payload is
+  ///         data().
+  const std::vector<DataSpan>& spans() const { return spans_; }
+  /// @return mutable spans for this PES.
+  std::vector<DataSpan>* mutable_spans() { return &spans_; }
+  /// @param data_owner keeps the buffer the spans point into alive.
+  void set_data_owner(std::shared_ptr<const uint8_t> data_owner) {
+    data_owner_ = std::move(data_owner);
+  }
+
+  /// @return the size of the payload.
+  size_t payload_size() const;
+
  private:
   uint8_t stream_id_ = 0;
 
@@ -64,6 +80,8 @@ class PesPacket {
   bool is_key_frame_ = false;
 
   std::vector<uint8_t> data_;
+  std::vector<DataSpan> spans_;
+  std::shared_ptr<const uint8_t> data_owner_;
 
   DISALLOW_COPY_AND_ASSIGN(PesPacket);
 };
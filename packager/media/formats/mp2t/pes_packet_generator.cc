@@ -105,15 +105,20 @@ bool PesPacketGenerator::PushSample(const MediaSample& sample) {
     if (sample.decrypt_config())
       subsamples = sample.decrypt_config()->subsamples();
     const bool kEscapeEncryptedNalu = true;
-    std::vector<uint8_t> byte_stream;
-    if (!converter_->ConvertUnitToByteStreamWithSubsamples(
+    // The NAL units are not copied to the PES packet, which points into the
+    // sample instead, until TsWriter copies them into the TS packets.
+    std::vector<uint8_t> inserted_data;
+    std::vector<DataSpan> spans;
+    if (!converter_->ConvertUnitToByteStreamSpans(
             sample.data(), sample.data_size(), sample.is_key_frame(),
-            kEscapeEncryptedNalu, &byte_stream, &subsamples)) {
+            kEscapeEncryptedNalu, &inserted_data, &spans, &subsamples)) {
       LOG(ERROR) << "Failed to convert sample to byte stream.";
       return false;
     }
 
-    current_processing_pes_->mutable_data()->swap(byte_stream);
+    current_processing_pes_->mutable_data()->swap(inserted_data);
+    current_processing_pes_->mutable_spans()->swap(spans);
+    current_processing_pes_->set_data_owner(sample.shared_data());
     current_processing_pes_->set_stream_id(kVideoStreamId);
     pes_packets_.push_back(std::move(current_processing_pes_));
     return true;
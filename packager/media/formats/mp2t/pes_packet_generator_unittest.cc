@@ -101,12 +101,13 @@ class MockNalUnitToByteStreamConverter : public NalUnitToByteStreamConverter {
   MOCK_METHOD2(Initialize,
                bool(const uint8_t* decoder_configuration_data,
                     size_t decoder_configuration_data_size));
-  MOCK_METHOD6(ConvertUnitToByteStreamWithSubsamples,
+  MOCK_METHOD7(ConvertUnitToByteStreamSpans,
                bool(const uint8_t* sample,
                     size_t sample_size,
                     bool is_key_frame,
                     bool escape_encrypted_nalu,
-                    std::vector<uint8_t>* output,
+                    std::vector<uint8_t>* inserted_data,
+                    std::vector<DataSpan>* spans,
                     std::vector<SubsampleEntry>* subsamples));
 };
 
@@ -207,9 +208,9 @@ TEST_F(PesPacketGeneratorTest, AddVideoSample) {
 
   std::unique_ptr<MockNalUnitToByteStreamConverter> mock(
       new MockNalUnitToByteStreamConverter());
-  EXPECT_CALL(*mock, ConvertUnitToByteStreamWithSubsamples(
+  EXPECT_CALL(*mock, ConvertUnitToByteStreamSpans(
                          _, arraysize(kAnyData), kIsKeyFrame,
-                         kEscapeEncryptedNalu, _, Pointee(IsEmpty())))
+                         kEscapeEncryptedNalu, _, _, Pointee(IsEmpty())))
       .WillOnce(DoAll(SetArgPointee<4>(expected_data), Return(true)));
 
   UseMockNalUnitToByteStreamConverter(std::move(mock));
@@ -254,9 +255,9 @@ TEST_F(PesPacketGeneratorTest, AddEncryptedVideoSample) {
 
   std::unique_ptr<MockNalUnitToByteStreamConverter> mock(
       new MockNalUnitToByteStreamConverter());
-  EXPECT_CALL(*mock, ConvertUnitToByteStreamWithSubsamples(
+  EXPECT_CALL(*mock, ConvertUnitToByteStreamSpans(
                          _, arraysize(kAnyData), kIsKeyFrame,
-                         kEscapeEncryptedNalu, _, Pointee(Eq(subsamples))))
+                         kEscapeEncryptedNalu, _, _, Pointee(Eq(subsamples))))
       .WillOnce(DoAll(SetArgPointee<4>(expected_data), Return(true)));
 
   UseMockNalUnitToByteStreamConverter(std::move(mock));
@@ -287,9 +288,9 @@ TEST_F(PesPacketGeneratorTest, AddVideoSampleFailedToConvert) {
   std::vector<uint8_t> expected_data(kAnyData, kAnyData + arraysize(kAnyData));
   std::unique_ptr<MockNalUnitToByteStreamConverter> mock(
       new MockNalUnitToByteStreamConverter());
-  EXPECT_CALL(*mock, ConvertUnitToByteStreamWithSubsamples(
+  EXPECT_CALL(*mock, ConvertUnitToByteStreamSpans(
                          _, arraysize(kAnyData), kIsKeyFrame,
-                         kEscapeEncryptedNalu, _, Pointee(IsEmpty())))
+                         kEscapeEncryptedNalu, _, _, Pointee(IsEmpty())))
       .WillOnce(Return(false));
 
   UseMockNalUnitToByteStreamConverter(std::move(mock));
@@ -372,9 +373,9 @@ TEST_F(PesPacketGeneratorTest, TimeStampScaling) {
 
   std::unique_ptr<MockNalUnitToByteStreamConverter> mock(
       new MockNalUnitToByteStreamConverter());
-  EXPECT_CALL(*mock, ConvertUnitToByteStreamWithSubsamples(
+  EXPECT_CALL(*mock, ConvertUnitToByteStreamSpans(
                          _, arraysize(kAnyData), kIsKeyFrame,
-                         kEscapeEncryptedNalu, _, Pointee(IsEmpty())))
+                         kEscapeEncryptedNalu, _, _, Pointee(IsEmpty())))
       .WillOnce(Return(true));
 
   UseMockNalUnitToByteStreamConverter(std::move(mock));
@@ -111,16 +111,18 @@ uint32_t Crc32Mpeg2(const uint8_t* data, size_t data_size) {
   return crc;
 }
 
-void WritePmtToBuffer(const uint8_t* pmt,
-                      size_t pmt_size,
-                      ContinuityCounter* continuity_counter,
-                      BufferWriter* writer) {
+// Puts |pmt| into TS packets, to be appended to the segments with
+// AppendTsPackets().
+void WritePmtToTsPackets(const BufferWriter& pmt, BufferWriter* packets) {
   const bool kPayloadUnitStartIndicator = true;
   const bool kHasPcr = true;
   const uint64_t kAnyPcrBase = 0;
-  WritePayloadToBufferWriter(pmt, pmt_size, kPayloadUnitStartIndicator,
+  // The continuity counters are rewritten when the packets are appended.
+  ContinuityCounter unused_continuity_counter;
+  WritePayloadToBufferWriter(pmt.Buffer(), pmt.Size(),
+                             kPayloadUnitStartIndicator,
                              ProgramMapTableWriter::kPmtPid, !kHasPcr,
-                             kAnyPcrBase, continuity_counter, writer);
+                             kAnyPcrBase, &unused_continuity_counter, packets);
 }
 
 void WritePrivateDataIndicatorDescriptor(FourCC fourcc, BufferWriter* output) {
@@ -215,7 +217,7 @@ void WritePmtWithParameters(uint8_t stream_type,
 ProgramMapTableWriter::ProgramMapTableWriter(Codec codec) : codec_(codec) {}
 
 bool ProgramMapTableWriter::EncryptedSegmentPmt(BufferWriter* writer) {
-  if (encrypted_pmt_.Size() == 0) {
+  if (encrypted_pmt_packets_.Size() == 0) {
     TsStreamType stream_type;
     switch (codec_) {
       case kCodecH264:
@@ -239,20 +241,20 @@ bool ProgramMapTableWriter::EncryptedSegmentPmt(BufferWriter* writer) {
     if (!WriteDescriptors(&descriptors))
       return false;
 
-    const bool has_clear_lead = clear_pmt_.Size() > 0;
+    const bool has_clear_lead = clear_pmt_packets_.Size() > 0;
+    BufferWriter pmt;
     WritePmtWithParameters(static_cast<uint8_t>(stream_type),
                            has_clear_lead ? kVersion1 : kVersion0, kCurrent,
-                           descriptors.Buffer(), descriptors.Size(),
-                           &encrypted_pmt_);
-    DCHECK_NE(encrypted_pmt_.Size(), 0u);
+                           descriptors.Buffer(), descriptors.Size(), &pmt);
+    WritePmtToTsPackets(pmt, &encrypted_pmt_packets_);
+    DCHECK_NE(encrypted_pmt_packets_.Size(), 0u);
   }
-  WritePmtToBuffer(encrypted_pmt_.Buffer(), encrypted_pmt_.Size(),
-                   &continuity_counter_, writer);
+  AppendTsPackets(encrypted_pmt_packets_, &continuity_counter_, writer);
   return true;
 }
 
 bool ProgramMapTableWriter::ClearSegmentPmt(BufferWriter* writer) {
-  if (clear_pmt_.Size() == 0) {
+  if (clear_pmt_packets_.Size() == 0) {
     TsStreamType stream_type;
     switch (codec_) {
       case kCodecH264:
@@ -275,12 +277,13 @@ bool ProgramMapTableWriter::ClearSegmentPmt(BufferWriter* writer) {
         return false;
     }
 
+    BufferWriter pmt;
     WritePmtWithParameters(static_cast<uint8_t>(stream_type), kVersion0,
-                           kCurrent, nullptr, 0, &clear_pmt_);
-    DCHECK_NE(clear_pmt_.Size(), 0u);
+                           kCurrent, nullptr, 0, &pmt);
+    WritePmtToTsPackets(pmt, &clear_pmt_packets_);
+    DCHECK_NE(clear_pmt_packets_.Size(), 0u);
   }
-  WritePmtToBuffer(clear_pmt_.Buffer(), clear_pmt_.Size(), &continuity_counter_,
-                   writer);
+  AppendTsPackets(clear_pmt_packets_, &continuity_counter_, writer);
   return true;
 }
 
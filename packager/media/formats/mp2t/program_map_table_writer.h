@@ -57,8 +57,10 @@ class ProgramMapTableWriter {
 
   const Codec codec_;
   ContinuityCounter continuity_counter_;
-  BufferWriter clear_pmt_;
-  BufferWriter encrypted_pmt_;
+  // The TS packets with the PMTs, written once and appended to each segment
+  // with the next continuity counters.
+  BufferWriter clear_pmt_packets_;
+  BufferWriter encrypted_pmt_packets_;
 };
 
 /// ProgramMapTableWriter for video codecs.
@@ -90,6 +90,27 @@ TEST_F(ProgramMapTableWriterTest, ClearH264) {
                           kPmtH264, arraysize(kPmtH264), buffer.Buffer()));
 }
 
+// The PMT packets are written once, so only their continuity counters change
+// across the segments.
+TEST_F(ProgramMapTableWriterTest, ClearH264ContinuityCounter) {
+  VideoProgramMapTableWriter writer(kCodecH264);
+  BufferWriter first_buffer;
+  writer.ClearSegmentPmt(&first_buffer);
+  ASSERT_EQ(kTsPacketSize, first_buffer.Size());
+  std::vector<uint8_t> expected(first_buffer.Buffer(),
+                                first_buffer.Buffer() + kTsPacketSize);
+
+  const int kNumSegments = 20;
+  for (int i = 1; i < kNumSegments; ++i) {
+    BufferWriter buffer;
+    writer.ClearSegmentPmt(&buffer);
+    // Adaptation field and payload are both present. The counter wraps at 16.
+    expected[3] = static_cast<uint8_t>(0x30 | (i % 16));
+    EXPECT_EQ(expected, std::vector<uint8_t>(buffer.Buffer(),
+                                             buffer.Buffer() + buffer.Size()));
+  }
+}
+
 // Verify that PSI for encrypted segments after clear lead is generated
 // correctly.
 TEST_F(ProgramMapTableWriterTest, EncryptedSegmentsAfterClearLeadH264) {
@@ -28,8 +28,9 @@ Status TsMuxer::InitializeMuxer() {
 }
 
 Status TsMuxer::Finalize() {
+  Status status = segmenter_->Finalize();
   FireOnMediaEndEvent();
-  return segmenter_->Finalize();
+  return status;
 }
 
 Status TsMuxer::AddMediaSample(size_t stream_id, const MediaSample& sample) {
@@ -47,10 +48,11 @@ Status TsMuxer::AddMediaSample(size_t stream_id, const MediaSample& sample) {
 Status TsMuxer::FinalizeSegment(size_t stream_id,
                                 const SegmentInfo& segment_info) {
   DCHECK_EQ(stream_id, 0u);
-  return segment_info.is_subsegment
-             ? Status::OK
-             : segmenter_->FinalizeSegment(segment_info.start_timestamp,
-                                           segment_info.duration);
+  if (segment_info.is_subsegment)
+    return Status::OK;
+  total_duration_ += segment_info.duration;
+  return segmenter_->FinalizeSegment(segment_info.start_timestamp,
+                                     segment_info.duration);
 }
 
 void TsMuxer::FireOnMediaStartEvent() {
@@ -64,10 +66,10 @@ void TsMuxer::FireOnMediaEndEvent() {
   if (!muxer_listener())
     return;
 
-  // For now, there is no single file TS segmenter. So all the values passed
-  // here are left empty.
-  MuxerListener::MediaRanges range;
-  muxer_listener()->OnMediaEnd(range, 0);
+  // The ranges are only set in single file mode.
+  muxer_listener()->OnMediaEnd(
+      segmenter_->media_ranges(),
+      static_cast<float>(total_duration_) / streams().front()->time_scale());
 }
 
 }  // namespace mp2t
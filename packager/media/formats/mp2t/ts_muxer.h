@@ -36,6 +36,8 @@ class TsMuxer : public Muxer {
   std::unique_ptr<TsSegmenter> segmenter_;
   int64_t sample_durations_[2];
   int64_t num_samples_ = 0;
+  // Sum of the durations of the segments, in the input stream's time scale.
+  uint64_t total_duration_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(TsMuxer);
 };
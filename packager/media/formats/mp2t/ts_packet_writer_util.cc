@@ -6,6 +6,10 @@
 
 #include "packager/media/formats/mp2t/ts_packet_writer_util.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/formats/mp2t/continuity_counter.h"
@@ -56,17 +60,18 @@ const uint8_t kPaddingBytes[] = {
 static_assert(arraysize(kPaddingBytes) >= kTsPacketMaximumPayloadSize,
               "Padding array is not big enough.");
 
+// Writes the adaptation field at |output| and returns its size.
 // |remaining_data_size| is the amount of data that has to be written. This may
 // be bigger than a TS packet size.
 // |remaining_data_size| matters if it is short and requires padding.
-void WriteAdaptationField(bool has_pcr,
-                          uint64_t pcr_base,
-                          size_t remaining_data_size,
-                          BufferWriter* writer) {
+size_t WriteAdaptationField(bool has_pcr,
+                            uint64_t pcr_base,
+                            size_t remaining_data_size,
+                            uint8_t* output) {
   // Special case where a TS packet requires 1 byte padding.
   if (!has_pcr && remaining_data_size == kTsPacketMaximumPayloadSize - 1) {
-    writer->AppendInt(static_cast<uint8_t>(0));
-    return;
+    output[0] = 0;
+    return 1;
   }
 
   // The size of the field itself.
@@ -85,11 +90,11 @@ void WriteAdaptationField(bool has_pcr,
     }
   }
 
-  writer->AppendInt(static_cast<uint8_t>(adaptation_field_length));
+  uint8_t* const start = output;
+  *output++ = static_cast<uint8_t>(adaptation_field_length);
   int remaining_bytes = static_cast<int>(adaptation_field_length);
-  writer->AppendInt(static_cast<uint8_t>(
-      // All flags except PCR_flag are 0.
-      static_cast<uint8_t>(has_pcr) << 4));
+  // All flags except PCR_flag are 0.
+  *output++ = static_cast<uint8_t>(static_cast<uint8_t>(has_pcr) << 4);
   remaining_bytes -= 1;
 
   if (has_pcr) {
@@ -98,16 +103,36 @@ void WriteAdaptationField(bool has_pcr,
         static_cast<uint32_t>(pcr_base >> 1);
     const uint16_t pcr_last_bit_reserved_and_pcr_extension =
         ((pcr_base & 1) << 15) | 0x7e00;  // Set the 6 reserved bits to '1'
-    writer->AppendInt(most_significant_32bits_pcr);
-    writer->AppendInt(pcr_last_bit_reserved_and_pcr_extension);
+    *output++ = static_cast<uint8_t>(most_significant_32bits_pcr >> 24);
+    *output++ = static_cast<uint8_t>(most_significant_32bits_pcr >> 16);
+    *output++ = static_cast<uint8_t>(most_significant_32bits_pcr >> 8);
+    *output++ = static_cast<uint8_t>(most_significant_32bits_pcr);
+    *output++ = static_cast<uint8_t>(pcr_last_bit_reserved_and_pcr_extension >>
+                                     8);
+    *output++ = static_cast<uint8_t>(pcr_last_bit_reserved_and_pcr_extension);
     remaining_bytes -= kPcrFieldsSize;
   }
   DCHECK_GE(remaining_bytes, 0);
-  if (remaining_bytes == 0)
-    return;
+  if (remaining_bytes > 0) {
+    DCHECK_GE(static_cast<int>(arraysize(kPaddingBytes)), remaining_bytes);
+    memcpy(output, kPaddingBytes, remaining_bytes);
+    output += remaining_bytes;
+  }
+  return output - start;
+}
 
-  DCHECK_GE(static_cast<int>(arraysize(kPaddingBytes)), remaining_bytes);
-  writer->AppendArray(kPaddingBytes, remaining_bytes);
+// @return the number of TS packets needed for |payload_size| bytes.
+size_t GetNumTsPackets(size_t payload_size, bool has_pcr) {
+  // The adaptation field with PCR takes the length, flags and PCR fields.
+  const size_t kTsPacketMaxPayloadWithPcr =
+      kTsPacketMaximumPayloadSize - 2 - kPcrFieldsSize;
+  const size_t first_packet_payload_size =
+      has_pcr ? kTsPacketMaxPayloadWithPcr : kTsPacketMaximumPayloadSize;
+  if (payload_size <= first_packet_payload_size)
+    return 1;
+  const size_t remaining_payload_size = payload_size - first_packet_payload_size;
+  return 1 + (remaining_payload_size + kTsPacketMaximumPayloadSize - 1) /
+                 kTsPacketMaximumPayloadSize;
 }
 
 }  // namespace
@@ -120,44 +145,96 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
                                 uint64_t pcr_base,
                                 ContinuityCounter* continuity_counter,
                                 BufferWriter* writer) {
-  size_t payload_bytes_written = 0;
+  const DataSpan payload_span = {payload, payload_size};
+  WritePayloadToBufferWriter(&payload_span, 1, payload_unit_start_indicator,
+                             pid, has_pcr, pcr_base, continuity_counter,
+                             writer);
+}
 
-  do {
-    const bool must_write_adaptation_header = has_pcr;
-    const size_t bytes_left = payload_size - payload_bytes_written;
-    const bool has_adaptation_field = must_write_adaptation_header ||
-                                      bytes_left < kTsPacketMaximumPayloadSize;
+void WritePayloadToBufferWriter(const DataSpan* payload_spans,
+                                size_t num_payload_spans,
+                                bool payload_unit_start_indicator,
+                                int pid,
+                                bool has_pcr,
+                                uint64_t pcr_base,
+                                ContinuityCounter* continuity_counter,
+                                BufferWriter* writer) {
+  size_t payload_size = 0;
+  for (size_t i = 0; i < num_payload_spans; ++i) {
+    DCHECK(payload_spans[i].data || payload_spans[i].size == 0);
+    payload_size += payload_spans[i].size;
+  }
 
-    writer->AppendInt(kSyncByte);
-    writer->AppendInt(static_cast<uint16_t>(
-        // transport_error_indicator and transport_priority are both '0'.
-        static_cast<int>(payload_unit_start_indicator) << 14 | pid));
+  // The packets of the whole payload are written directly into the output
+  // buffer, grown once for all of them.
+  const size_t num_packets = GetNumTsPackets(payload_size, has_pcr);
+  uint8_t* output = writer->Extend(num_packets * kTsPacketSize);
+  size_t payload_bytes_written = 0;
+  // The position of the next payload byte in the spans.
+  size_t span_index = 0;
+  size_t span_offset = 0;
 
+  for (size_t i = 0; i < num_packets; ++i) {
+    uint8_t* const packet = output + i * kTsPacketSize;
+    const size_t bytes_left = payload_size - payload_bytes_written;
+    const bool has_adaptation_field =
+        has_pcr || bytes_left < kTsPacketMaximumPayloadSize;
+
+    packet[0] = kSyncByte;
+    // transport_error_indicator and transport_priority are both '0'.
+    packet[1] = static_cast<uint8_t>(
+        static_cast<int>(payload_unit_start_indicator) << 6 | (pid >> 8));
+    packet[2] = static_cast<uint8_t>(pid);
     const uint8_t adaptation_field_control =
         ((has_adaptation_field ? 1 : 0) << 1) | ((bytes_left != 0) ? 1 : 0);
     // transport_scrambling_control is '00'.
-    writer->AppendInt(static_cast<uint8_t>(adaptation_field_control << 4 |
-                                           continuity_counter->GetNext()));
+    packet[3] = static_cast<uint8_t>(adaptation_field_control << 4 |
+                                     continuity_counter->GetNext());
 
+    size_t header_size = kTsPacketHeaderSize;
     if (has_adaptation_field) {
-      const size_t before = writer->Size();
-      WriteAdaptationField(has_pcr, pcr_base, bytes_left, writer);
-      const size_t bytes_for_adaptation_field = writer->Size() - before;
-
-      const size_t write_bytes =
-          kTsPacketMaximumPayloadSize - bytes_for_adaptation_field;
-      writer->AppendArray(payload + payload_bytes_written, write_bytes);
-      payload_bytes_written += write_bytes;
-    } else {
-      writer->AppendArray(payload + payload_bytes_written,
-                          kTsPacketMaximumPayloadSize);
-      payload_bytes_written += kTsPacketMaximumPayloadSize;
+      header_size += WriteAdaptationField(has_pcr, pcr_base, bytes_left,
+                                          packet + kTsPacketHeaderSize);
     }
+    const size_t write_bytes = kTsPacketSize - header_size;
+    DCHECK_LE(write_bytes, bytes_left);
+    uint8_t* packet_payload = packet + header_size;
+    size_t packet_payload_left = write_bytes;
+    while (packet_payload_left > 0) {
+      DCHECK_LT(span_index, num_payload_spans);
+      const DataSpan& span = payload_spans[span_index];
+      const size_t copy_bytes =
+          std::min(packet_payload_left, span.size - span_offset);
+      memcpy(packet_payload, span.data + span_offset, copy_bytes);
+      packet_payload += copy_bytes;
+      packet_payload_left -= copy_bytes;
+      span_offset += copy_bytes;
+      if (span_offset == span.size) {
+        ++span_index;
+        span_offset = 0;
+      }
+    }
+    payload_bytes_written += write_bytes;
 
     // Once written, not needed for this payload.
     has_pcr = false;
     payload_unit_start_indicator = false;
-  } while (payload_bytes_written < payload_size);
+  }
+  DCHECK_EQ(payload_bytes_written, payload_size);
+}
+
+void AppendTsPackets(const BufferWriter& packets,
+                     ContinuityCounter* continuity_counter,
+                     BufferWriter* output) {
+  DCHECK_EQ(packets.Size() % kTsPacketSize, 0u);
+  uint8_t* const packet_output = output->Extend(packets.Size());
+  memcpy(packet_output, packets.Buffer(), packets.Size());
+  for (size_t offset = 0; offset < packets.Size(); offset += kTsPacketSize) {
+    // continuity_counter is the 4 LSBs of the 4th byte of the header.
+    uint8_t* const header_byte = packet_output + offset + 3;
+    *header_byte = static_cast<uint8_t>((*header_byte & 0xF0) |
+                                        continuity_counter->GetNext());
+  }
 }
 
 }  // namespace mp2t
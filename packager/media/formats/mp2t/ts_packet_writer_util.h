@@ -12,6 +12,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "packager/media/base/data_span.h"
+
 namespace shaka {
 namespace media {
 
@@ -40,6 +42,30 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
                                 ContinuityCounter* continuity_counter,
                                 BufferWriter* output);
 
+/// Same as above, but the payload is the concatenation of @a payload_spans,
+/// which are copied straight into the TS packets. None of the spans may be
+/// null.
+/// @param payload_spans points to the spans of the payload.
+/// @param num_payload_spans is the number of spans.
+void WritePayloadToBufferWriter(const DataSpan* payload_spans,
+                                size_t num_payload_spans,
+                                bool payload_unit_start_indicator,
+                                int pid,
+                                bool has_pcr,
+                                uint64_t pcr_base,
+                                ContinuityCounter* continuity_counter,
+                                BufferWriter* output);
+
+/// Appends TS packets written ahead of time, e.g. the PSI packets which are
+/// the same in every segment, to @a output. Only their continuity counters are
+/// rewritten, with the next values of @a continuity_counter.
+/// @param packets is the TS packets to append.
+/// @param continuity_counter is the continuity_counter for these TS packets.
+/// @param output is where the TS packets get written.
+void AppendTsPackets(const BufferWriter& packets,
+                     ContinuityCounter* continuity_counter,
+                     BufferWriter* output);
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -162,6 +162,10 @@ bool TsSectionPes::Emit(bool emit_for_unknown_size) {
   int pes_packet_length =
       (static_cast<int>(raw_pes[4]) << 8) |
       (static_cast<int>(raw_pes[5]));
+  // Grow the queue once to the size of the whole PES instead of doubling it
+  // as the TS packets come in. The queue keeps its capacity across PES.
+  if (pes_packet_length != 0)
+    pes_byte_queue_.Reserve(pes_packet_length + 6);
   if ((pes_packet_length == 0 && !emit_for_unknown_size) ||
       (pes_packet_length != 0 && raw_pes_size < pes_packet_length + 6)) {
     // Wait for more data to come either because:
@@ -305,7 +309,9 @@ bool TsSectionPes::ParseInternal(const uint8_t* raw_pes, int raw_pes_size) {
       << " pts=" << media_pts
       << " dts=" << media_dts
       << " data_alignment_indicator=" << data_alignment_indicator;
-  return es_parser_->Parse(&raw_pes[es_offset], es_size, media_pts, media_dts);
+  RCHECK(
+      es_parser_->Parse(&raw_pes[es_offset], es_size, media_pts, media_dts));
+  return es_parser_->OnPesEnd(data_alignment_indicator != 0);
 }
 
 void TsSectionPes::ResetPesState() {
@@ -39,14 +39,18 @@ TsSegmenter::TsSegmenter(const MuxerOptions& options, MuxerListener* listener)
       listener_(listener),
       transport_stream_timestamp_offset_(
           options.transport_stream_timestamp_offset_ms * kTsTimescale / 1000),
+      segment_indexer_(options),
       pes_packet_generator_(
           new PesPacketGenerator(transport_stream_timestamp_offset_)) {}
 
 TsSegmenter::~TsSegmenter() {}
 
 Status TsSegmenter::Initialize(const StreamInfo& stream_info) {
-  if (muxer_options_.segment_template.empty())
-    return Status(error::MUXER_FAILURE, "Segment template not specified.");
+  if (muxer_options_.segment_template.empty() &&
+      muxer_options_.output_file_name.empty()) {
+    return Status(error::MUXER_FAILURE,
+                  "Neither segment template nor output file specified.");
+  }
   if (!pes_packet_generator_->Initialize(stream_info)) {
     return Status(error::MUXER_FAILURE,
                   "Failed to initialize PesPacketGenerator.");
@@ -65,10 +69,28 @@ Status TsSegmenter::Initialize(const StreamInfo& stream_info) {
     audio_codec_config_ = stream_info.codec_config();
 
   timescale_scale_ = kTsTimescale / stream_info.time_scale();
+
+  if (muxer_options_.segment_template.empty()) {
+    const std::string& file_name = muxer_options_.output_file_name;
+    output_file_.reset(File::Open(file_name.c_str(), "w"));
+    if (!output_file_) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot open file for write " + file_name);
+    }
+  }
   return Status::OK;
 }
 
 Status TsSegmenter::Finalize() {
+  if (!output_file_)
+    return Status::OK;
+  const std::string file_name = output_file_->file_name();
+  if (!output_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
   return Status::OK;
 }
 
@@ -176,13 +198,44 @@ Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
   // be false.
   if (!segment_started_)
     return Status::OK;
-  std::string segment_path =
-        GetSegmentName(muxer_options_.segment_template, segment_start_timestamp_,
-                       segment_number_++, muxer_options_.bandwidth);
+  std::string segment_path = muxer_options_.output_file_name;
+  if (!output_file_) {
+    uint32_t segment_index = 0;
+    RETURN_IF_ERROR(segment_indexer_.Next(segment_start_timestamp_,
+                                          kTsTimescale, &segment_index));
+    segment_path =
+        GetSegmentName(muxer_options_.segment_template,
+                       segment_start_timestamp_, segment_index,
+                       muxer_options_.bandwidth);
+  }
 
   const int64_t file_size = segment_buffer_.Size();
-  std::unique_ptr<File, FileCloser> segment_file;
-  segment_file.reset(File::Open(segment_path.c_str(), "w"));
+  RETURN_IF_ERROR(WriteSegment(segment_path));
+
+  if (listener_) {
+    listener_->OnNewSegment(segment_path,
+                            start_timestamp * timescale_scale_ +
+                                transport_stream_timestamp_offset_,
+                            duration * timescale_scale_, file_size);
+  }
+  segment_started_ = false;
+
+  return Status::OK;
+}
+
+Status TsSegmenter::WriteSegment(const std::string& segment_path) {
+  if (output_file_) {
+    Range range;
+    range.start = media_ranges_.subsegment_ranges.empty()
+                      ? 0
+                      : (media_ranges_.subsegment_ranges.back().end + 1);
+    range.end = range.start + segment_buffer_.Size() - 1;
+    media_ranges_.subsegment_ranges.push_back(range);
+    return segment_buffer_.WriteToFile(output_file_.get());
+  }
+
+  std::unique_ptr<File, FileCloser> segment_file(
+      File::Open(segment_path.c_str(), "w"));
   if (!segment_file) {
     return Status(error::FILE_FAILURE,
                   "Cannot open file for write " + segment_path);
@@ -196,15 +249,6 @@ Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
         "Cannot close file " + segment_path +
         ", possibly file permission issue or running out of disk space.");
   }
-
-  if (listener_) {
-    listener_->OnNewSegment(segment_path,
-                            start_timestamp * timescale_scale_ +
-                                transport_stream_timestamp_offset_,
-                            duration * timescale_scale_, file_size);
-  }
-  segment_started_ = false;
-
   return Status::OK;
 }
 
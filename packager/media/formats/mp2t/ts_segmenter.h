@@ -9,7 +9,10 @@
 
 #include <memory>
 #include "packager/file/file.h"
+#include "packager/file/file_closer.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/event/muxer_listener.h"
 #include "packager/media/formats/mp2t/pes_packet_generator.h"
 #include "packager/media/formats/mp2t/ts_writer.h"
 #include "packager/status.h"
@@ -18,13 +21,13 @@ namespace shaka {
 namespace media {
 
 class KeySource;
-class MuxerListener;
 
 namespace mp2t {
 
-// TODO(rkuroiwa): For now, this implements multifile segmenter. Like other
-// make this an abstract super class and implement multifile and single file
-// segmenters.
+/// Writes one file per segment if MuxerOptions::segment_template is set.
+/// Otherwise appends the segments to the single file
+/// MuxerOptions::output_file_name, and records their byte ranges in
+/// media_ranges(), which HLS uses for EXT-X-BYTERANGE.
 class TsSegmenter {
  public:
   // TODO(rkuroiwa): Add progress listener?
@@ -40,7 +43,7 @@ class TsSegmenter {
   /// @return OK on success.
   Status Initialize(const StreamInfo& stream_info);
 
-  /// Finalize the segmenter.
+  /// Finalize the segmenter. This closes the output file in single file mode.
   /// @return OK on success.
   Status Finalize();
 
@@ -60,6 +63,12 @@ class TsSegmenter {
   // as the segment start timestamp and duration could be tracked locally.
   Status FinalizeSegment(uint64_t start_timestamp, uint64_t duration);
 
+  /// @return The byte ranges of the segments written to the output file in
+  ///         single file mode, or no ranges in multi-file mode.
+  const MuxerListener::MediaRanges& media_ranges() const {
+    return media_ranges_;
+  }
+
   /// Only for testing.
   void InjectTsWriterForTesting(std::unique_ptr<TsWriter> writer);
 
@@ -76,6 +85,10 @@ class TsSegmenter {
   // Writes PES packets (carried in TsPackets) to a buffer.
   Status WritePesPackets();
 
+  // Writes |segment_buffer_| to its own file at |segment_path|, or appends it
+  // to |output_file_| in single file mode.
+  Status WriteSegment(const std::string& segment_path);
+
   const MuxerOptions& muxer_options_;
   MuxerListener* const listener_;
 
@@ -89,12 +102,17 @@ class TsSegmenter {
   double timescale_scale_ = 1.0;
 
   // Used for segment template.
-  uint64_t segment_number_ = 0;
+  SegmentIndexer segment_indexer_;
 
   std::unique_ptr<TsWriter> ts_writer_;
 
   BufferWriter segment_buffer_;
 
+  // The file all the segments are appended to in single file mode, and the
+  // byte ranges of the segments in it.
+  std::unique_ptr<File, FileCloser> output_file_;
+  MuxerListener::MediaRanges media_ranges_;
+
   // Set to true if segment_buffer_ is initialized, set to false after
   // FinalizeSegment() succeeds.
   bool segment_started_ = false;
@@ -7,6 +7,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/mock_muxer_listener.h"
@@ -411,6 +413,76 @@ TEST_F(TsSegmenterTest, EncryptedSample) {
   EXPECT_OK(segmenter.AddSample(*sample2));
 }
 
+// In single file mode, the segments are appended to the output file and their
+// byte ranges are recorded.
+TEST_F(TsSegmenterTest, SingleFile) {
+  std::shared_ptr<VideoStreamInfo> stream_info(new VideoStreamInfo(
+      kTrackId, kTimeScale, kDuration, kH264Codec,
+      H26xStreamFormat::kAnnexbByteStream, kCodecString, kExtraData,
+      arraysize(kExtraData), kWidth, kHeight, kPixelWidth, kPixelHeight,
+      kTransferCharacteristics, kTrickPlayFactor, kNaluLengthSize, kLanguage,
+      kIsEncrypted));
+  const char kOutputFile[] = "memory://single_file.ts";
+  MuxerOptions options;
+  options.output_file_name = kOutputFile;
+
+  MockMuxerListener mock_listener;
+  TsSegmenter segmenter(options, &mock_listener);
+
+  ON_CALL(*mock_ts_writer_, NewSegment(_)).WillByDefault(Return(true));
+  ON_CALL(*mock_ts_writer_, AddPesPacketMock(_, _))
+      .WillByDefault(Return(true));
+  ON_CALL(*mock_pes_packet_generator_, Initialize(_))
+      .WillByDefault(Return(true));
+  ON_CALL(*mock_pes_packet_generator_, PushSample(_))
+      .WillByDefault(Return(true));
+  ON_CALL(*mock_pes_packet_generator_, Flush()).WillByDefault(Return(true));
+  ON_CALL(*mock_pes_packet_generator_, GetNextPesPacketMock())
+      .WillByDefault(::testing::Invoke([]() { return new PesPacket(); }));
+
+  // One PES packet in each AddSample(), none in each FinalizeSegment().
+  Sequence ready_pes_sequence;
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_CALL(*mock_pes_packet_generator_, NumberOfReadyPesPackets())
+        .InSequence(ready_pes_sequence)
+        .WillOnce(Return(1u))
+        .WillOnce(Return(0u))
+        .WillOnce(Return(0u));
+  }
+
+  EXPECT_CALL(mock_listener,
+              OnNewSegment(kOutputFile, _, _, arraysize(kAnyData)))
+      .Times(2);
+
+  std::shared_ptr<MediaSample> sample =
+      MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
+  sample->set_duration(kTimeScale * 2);
+
+  segmenter.InjectPesPacketGeneratorForTesting(
+      std::move(mock_pes_packet_generator_));
+  EXPECT_OK(segmenter.Initialize(*stream_info));
+  segmenter.InjectTsWriterForTesting(std::move(mock_ts_writer_));
+  EXPECT_OK(segmenter.AddSample(*sample));
+  EXPECT_OK(segmenter.FinalizeSegment(0, sample->duration()));
+  EXPECT_OK(segmenter.AddSample(*sample));
+  EXPECT_OK(segmenter.FinalizeSegment(sample->duration(), sample->duration()));
+  EXPECT_OK(segmenter.Finalize());
+
+  const std::vector<Range>& ranges =
+      segmenter.media_ranges().subsegment_ranges;
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(0u, ranges[0].start);
+  EXPECT_EQ(arraysize(kAnyData) - 1, ranges[0].end);
+  EXPECT_EQ(arraysize(kAnyData), ranges[1].start);
+  EXPECT_EQ(2 * arraysize(kAnyData) - 1, ranges[1].end);
+
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(kOutputFile, &content));
+  std::string expected(std::begin(kAnyData), std::end(kAnyData));
+  EXPECT_EQ(expected + expected, content);
+  MemoryFile::DeleteAll();
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -6,8 +6,6 @@
 
 #include "packager/media/formats/mp2t/ts_writer.h"
 
-#include <algorithm>
-
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_sample.h"
@@ -47,22 +45,21 @@ const uint8_t kPat[] = {
 const bool kHasPcr = true;
 const bool kPayloadUnitStartIndicator = true;
 
-// This is the size of the first few fields in a TS packet, i.e. TS packet size
-// without adaptation field or the payload.
-const int kTsPacketHeaderSize = 4;
-const int kTsPacketSize = 188;
-const int kTsPacketMaximumPayloadSize =
-    kTsPacketSize - kTsPacketHeaderSize;
+// The maximum size of a PES packet header.
+const int kMaxPesPacketHeaderSize = 19;
 
 const size_t kMaxPesPacketLengthValue = 0xFFFF;
 
-void WritePatToBuffer(const uint8_t* pat,
-                      int pat_size,
-                      ContinuityCounter* continuity_counter,
-                      BufferWriter* writer) {
+// Puts |pat| into TS packets, to be appended to the segments with
+// AppendTsPackets().
+void WritePatToTsPackets(const uint8_t* pat,
+                         int pat_size,
+                         BufferWriter* packets) {
   const int kPatPid = 0;
+  // The continuity counters are rewritten when the packets are appended.
+  ContinuityCounter unused_continuity_counter;
   WritePayloadToBufferWriter(pat, pat_size, kPayloadUnitStartIndicator, kPatPid,
-                             !kHasPcr, 0, continuity_counter, writer);
+                             !kHasPcr, 0, &unused_continuity_counter, packets);
 }
 
 // The only difference between writing PTS or DTS is the leading bits.
@@ -90,94 +87,89 @@ void WritePtsOrDts(uint8_t leading_bits,
 bool WritePesToBuffer(const PesPacket& pes,
                       ContinuityCounter* continuity_counter,
                       BufferWriter* current_buffer) {
-  // The size of the length field.
-  const int kAdaptationFieldLengthSize = 1;
-  // The size of the flags field.
-  const int kAdaptationFieldHeaderSize = 1;
-  const int kPcrFieldSize = 6;
-  const int kTsPacketMaxPayloadWithPcr =
-      kTsPacketMaximumPayloadSize - kAdaptationFieldLengthSize -
-      kAdaptationFieldHeaderSize - kPcrFieldSize;
   const uint64_t pcr_base = pes.has_dts() ? pes.dts() : pes.pts();
   const int pid = ProgramMapTableWriter::kElementaryPid;
 
-  // This writer will hold part of PES packet after PES_packet_length field.
-  BufferWriter pes_header_writer;
+  uint8_t pes_header_data_length = 0;
+  if (pes.has_pts())
+    pes_header_data_length += 5;
+  if (pes.has_dts())
+    pes_header_data_length += 5;
+  // The size of the part of PES packet header after PES_packet_length field.
+  const size_t pes_header_size = 3 + pes_header_data_length;
+
+  // Put the PES packet's header into a buffer.
+  BufferWriter pes_header_buffer(kMaxPesPacketHeaderSize);
+  pes_header_buffer.AppendNBytes(static_cast<uint64_t>(0x000001), 3);
+  pes_header_buffer.AppendInt(pes.stream_id());
+  const size_t pes_packet_length = pes.payload_size() + pes_header_size;
+  pes_header_buffer.AppendInt(static_cast<uint16_t>(
+      pes_packet_length > kMaxPesPacketLengthValue ? 0 : pes_packet_length));
   // The first bit must be '10' for PES with video or audio stream id. The other
   // flags (bits) don't matter so they are 0.
-  pes_header_writer.AppendInt(static_cast<uint8_t>(0x80));
-  pes_header_writer.AppendInt(
+  pes_header_buffer.AppendInt(static_cast<uint8_t>(0x80));
+  pes_header_buffer.AppendInt(
       static_cast<uint8_t>(static_cast<int>(pes.has_pts()) << 7 |
                            static_cast<int>(pes.has_dts()) << 6
                            // Other fields are all 0.
                            ));
-  uint8_t pes_header_data_length = 0;
-  if (pes.has_pts())
-    pes_header_data_length += 5;
-  if (pes.has_dts())
-    pes_header_data_length += 5;
-  pes_header_writer.AppendInt(pes_header_data_length);
+  pes_header_buffer.AppendInt(pes_header_data_length);
 
   if (pes.has_pts() && pes.has_dts()) {
-    WritePtsOrDts(0x03, pes.pts(), &pes_header_writer);
-    WritePtsOrDts(0x01, pes.dts(), &pes_header_writer);
+    WritePtsOrDts(0x03, pes.pts(), &pes_header_buffer);
+    WritePtsOrDts(0x01, pes.dts(), &pes_header_buffer);
   } else if (pes.has_pts()) {
-    WritePtsOrDts(0x02, pes.pts(), &pes_header_writer);
+    WritePtsOrDts(0x02, pes.pts(), &pes_header_buffer);
   }
 
-  // Put the first TS packet's payload into a buffer. This contains the PES
-  // packet's header.
-  BufferWriter first_ts_packet_buffer(kTsPacketSize);
-  first_ts_packet_buffer.AppendNBytes(static_cast<uint64_t>(0x000001), 3);
-  first_ts_packet_buffer.AppendInt(pes.stream_id());
-  const size_t pes_packet_length = pes.data().size() + pes_header_writer.Size();
-  first_ts_packet_buffer.AppendInt(static_cast<uint16_t>(
-      pes_packet_length > kMaxPesPacketLengthValue ? 0 : pes_packet_length));
-  first_ts_packet_buffer.AppendBuffer(pes_header_writer);
-
-  const size_t available_payload =
-      kTsPacketMaxPayloadWithPcr - first_ts_packet_buffer.Size();
-  const size_t bytes_consumed = std::min(pes.data().size(), available_payload);
-  first_ts_packet_buffer.AppendArray(pes.data().data(), bytes_consumed);
-
-  BufferWriter output_writer;
-  WritePayloadToBufferWriter(first_ts_packet_buffer.Buffer(),
-                             first_ts_packet_buffer.Size(),
-                             kPayloadUnitStartIndicator, pid, kHasPcr, pcr_base,
-                             continuity_counter, &output_writer);
-
-  const size_t remaining_pes_data_size = pes.data().size() - bytes_consumed;
-  if (remaining_pes_data_size > 0) {
-    WritePayloadToBufferWriter(pes.data().data() + bytes_consumed,
-                               remaining_pes_data_size,
-                               !kPayloadUnitStartIndicator, pid, !kHasPcr, 0,
-                               continuity_counter, &output_writer);
+  // The PES packet header and the payload spans are packetized without being
+  // copied together first.
+  std::vector<DataSpan> payload_spans;
+  payload_spans.reserve(1 + pes.spans().size());
+  payload_spans.push_back(
+      {pes_header_buffer.Buffer(), pes_header_buffer.Size()});
+  if (pes.spans().empty()) {
+    payload_spans.push_back({pes.data().data(), pes.data().size()});
+  } else {
+    const uint8_t* next_inserted_byte = pes.data().data();
+    for (const DataSpan& span : pes.spans()) {
+      if (span.data) {
+        payload_spans.push_back(span);
+      } else {
+        payload_spans.push_back({next_inserted_byte, span.size});
+        next_inserted_byte += span.size;
+      }
+    }
   }
 
-  current_buffer->AppendBuffer(output_writer);
+  // The TS packets are written directly to |current_buffer|.
+  WritePayloadToBufferWriter(payload_spans.data(), payload_spans.size(),
+                             kPayloadUnitStartIndicator, pid, kHasPcr, pcr_base,
+                             continuity_counter, current_buffer);
   return true;
 }
 
 }  // namespace
 
 TsWriter::TsWriter(std::unique_ptr<ProgramMapTableWriter> pmt_writer)
-    : pmt_writer_(std::move(pmt_writer)) {}
+    : pmt_writer_(std::move(pmt_writer)) {
+  WritePatToTsPackets(kPat, arraysize(kPat), &pat_packets_);
+}
 
 TsWriter::~TsWriter() {}
 
 bool TsWriter::NewSegment(BufferWriter* buffer) {
-  BufferWriter psi;
-  WritePatToBuffer(kPat, arraysize(kPat), &pat_continuity_counter_, &psi);
+  // The PSI is written straight into |buffer|, which is discarded on failure.
+  AppendTsPackets(pat_packets_, &pat_continuity_counter_, buffer);
   if (encrypted_) {
-    if (!pmt_writer_->EncryptedSegmentPmt(&psi)) {
+    if (!pmt_writer_->EncryptedSegmentPmt(buffer)) {
       return false;
     }
   } else {
-    if (!pmt_writer_->ClearSegmentPmt(&psi)) {
+    if (!pmt_writer_->ClearSegmentPmt(buffer)) {
       return false;
     }
   }
-  buffer->AppendBuffer(psi);
 
   return true;
 }
@@ -54,6 +54,9 @@ class TsWriter {
   // True if further segments generated by this instance should be encrypted.
   bool encrypted_ = false;
 
+  // The TS packets with the PAT, appended to each segment with the next
+  // continuity counters.
+  BufferWriter pat_packets_;
   ContinuityCounter pat_continuity_counter_;
   ContinuityCounter elementary_stream_continuity_counter_;
 
@@ -378,6 +378,56 @@ TEST_F(TsWriterTest, BigPesPacket) {
   EXPECT_EQ(2, (buffer_writer.Buffer()[4 * 188 + 3] & 0xF));
 }
 
+// A PES packet made of spans is written like the same payload in data().
+TEST_F(TsWriterTest, PesPacketWithSpans) {
+  // Spread the payload over a few TS packets, with spans crossing their
+  // boundaries.
+  std::vector<uint8_t> sample_data(500);
+  for (size_t i = 0; i < sample_data.size(); ++i)
+    sample_data[i] = static_cast<uint8_t>(i);
+  const std::vector<uint8_t> inserted_data = {0x00, 0x00, 0x00, 0x01,
+                                              0x09, 0xF0, 0x00, 0x00};
+
+  std::unique_ptr<PesPacket> pes(new PesPacket());
+  pes->set_pts(0x900);
+  pes->set_dts(0x900);
+  *pes->mutable_data() = inserted_data;
+  *pes->mutable_spans() = {{nullptr, 6},
+                           {sample_data.data(), 200},
+                           {nullptr, 2},
+                           {sample_data.data() + 200, 300}};
+  EXPECT_EQ(508u, pes->payload_size());
+
+  std::unique_ptr<PesPacket> expected_pes(new PesPacket());
+  expected_pes->set_pts(0x900);
+  expected_pes->set_dts(0x900);
+  std::vector<uint8_t>* expected_data = expected_pes->mutable_data();
+  expected_data->assign(inserted_data.begin(), inserted_data.begin() + 6);
+  expected_data->insert(expected_data->end(), sample_data.begin(),
+                        sample_data.begin() + 200);
+  expected_data->insert(expected_data->end(), inserted_data.begin() + 6,
+                        inserted_data.end());
+  expected_data->insert(expected_data->end(), sample_data.begin() + 200,
+                        sample_data.end());
+
+  TsWriter ts_writer(std::unique_ptr<ProgramMapTableWriter>(
+      new VideoProgramMapTableWriter(kCodecForTesting)));
+  BufferWriter buffer_writer;
+  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+
+  TsWriter expected_ts_writer(std::unique_ptr<ProgramMapTableWriter>(
+      new VideoProgramMapTableWriter(kCodecForTesting)));
+  BufferWriter expected_buffer_writer;
+  EXPECT_TRUE(expected_ts_writer.AddPesPacket(std::move(expected_pes),
+                                              &expected_buffer_writer));
+
+  EXPECT_EQ(std::vector<uint8_t>(
+                expected_buffer_writer.Buffer(),
+                expected_buffer_writer.Buffer() + expected_buffer_writer.Size()),
+            std::vector<uint8_t>(buffer_writer.Buffer(),
+                                 buffer_writer.Buffer() + buffer_writer.Size()));
+}
+
 // Bug found in code review. It should check whether PTS is present not whether
 // PTS (implicilty) cast to bool is true.
 TEST_F(TsWriterTest, PesPtsZeroNoDts) {
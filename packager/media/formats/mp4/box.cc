@@ -25,10 +25,15 @@ bool Box::Parse(BoxReader* reader) {
 void Box::Write(BufferWriter* writer) {
   DCHECK(writer);
   // Compute and update box size.
-  uint32_t size = ComputeSize();
-  DCHECK_EQ(size, box_size_);
+  ComputeSize();
+  WriteWithComputedSize(writer);
+}
+
+void Box::WriteWithComputedSize(BufferWriter* writer) {
+  DCHECK(writer);
 
   size_t buffer_size_before_write = writer->Size();
+  writer->Reserve(box_size_);
   BoxBuffer buffer(writer);
   CHECK(ReadWriteInternal(&buffer));
   DCHECK_EQ(box_size_, writer->Size() - buffer_size_before_write)
@@ -36,6 +36,13 @@ struct Box {
   /// @param writer points to a BufferWriter object which wraps the buffer for
   ///        writing.
   void Write(BufferWriter* writer);
+  /// Write the box to buffer with the box sizes computed by the last call to
+  /// ComputeSize, which saves walking the child boxes again, e.g. for a 'moof'
+  /// whose size is needed for the data offsets before it is written. The box
+  /// must not be modified in a way that changes its size in between.
+  /// @param writer points to a BufferWriter object which wraps the buffer for
+  ///        writing.
+  void WriteWithComputedSize(BufferWriter* writer);
   /// Write the box header to buffer. This function calls ComputeSize internally
   /// to compute and update box size.
   /// @param writer points to a BufferWriter object which wraps the buffer for
@@ -343,6 +343,13 @@ bool SampleEncryption::ReadWriteInternal(BoxBuffer* buffer) {
     return false;
   }
 
+  if (!buffer->Reading() && serialized_entry_count > 0) {
+    DCHECK(sample_encryption_entries.empty());
+    RCHECK(buffer->ReadWriteUInt32(&serialized_entry_count));
+    return buffer->ReadWriteVector(&serialized_entries,
+                                   serialized_entries.size());
+  }
+
   uint32_t sample_count =
       static_cast<uint32_t>(sample_encryption_entries.size());
   RCHECK(buffer->ReadWriteUInt32(&sample_count));
@@ -356,6 +363,12 @@ bool SampleEncryption::ReadWriteInternal(BoxBuffer* buffer) {
 }
 
 size_t SampleEncryption::ComputeSizeInternal() {
+  if (serialized_entry_count > 0) {
+    DCHECK(IsIvSizeValid(iv_size));
+    return HeaderSize() + sizeof(serialized_entry_count) +
+           serialized_entries.size();
+  }
+
   const uint32_t sample_count =
       static_cast<uint32_t>(sample_encryption_entries.size());
   if (sample_count == 0) {
@@ -394,6 +407,56 @@ bool SampleEncryption::ParseFromSampleEncryptionData(
   return true;
 }
 
+bool SampleEncryption::AppendSerializedEntry(
+    const std::vector<uint8_t>& initialization_vector,
+    const std::vector<SubsampleEntry>& subsamples,
+    uint32_t* entry_size) {
+  const bool has_subsamples = !subsamples.empty();
+  if (serialized_entry_count == 0) {
+    iv_size = static_cast<uint8_t>(initialization_vector.size());
+    if (has_subsamples)
+      flags |= kUseSubsampleEncryption;
+    else
+      flags &= ~kUseSubsampleEncryption;
+  } else if (initialization_vector.size() != iv_size ||
+             has_subsamples != ((flags & kUseSubsampleEncryption) != 0)) {
+    LOG(ERROR) << "Sample encryption entries with different IV sizes or "
+                  "with and without subsamples are not supported.";
+    return false;
+  }
+  RCHECK(IsIvSizeValid(iv_size));
+  RCHECK(subsamples.size() <= std::numeric_limits<uint16_t>::max());
+
+  const size_t old_size = serialized_entries.size();
+  serialized_entries.insert(serialized_entries.end(),
+                            initialization_vector.begin(),
+                            initialization_vector.end());
+  if (has_subsamples) {
+    const uint16_t subsample_count = static_cast<uint16_t>(subsamples.size());
+    serialized_entries.push_back(static_cast<uint8_t>(subsample_count >> 8));
+    serialized_entries.push_back(static_cast<uint8_t>(subsample_count));
+    for (const SubsampleEntry& subsample : subsamples) {
+      serialized_entries.push_back(
+          static_cast<uint8_t>(subsample.clear_bytes >> 8));
+      serialized_entries.push_back(static_cast<uint8_t>(subsample.clear_bytes));
+      for (int shift = 24; shift >= 0; shift -= 8) {
+        serialized_entries.push_back(
+            static_cast<uint8_t>(subsample.cipher_bytes >> shift));
+      }
+    }
+  }
+  ++serialized_entry_count;
+  *entry_size = static_cast<uint32_t>(serialized_entries.size() - old_size);
+  return true;
+}
+
+void SampleEncryption::ClearSerializedEntries() {
+  serialized_entries.clear();
+  serialized_entry_count = 0;
+  iv_size = kInvalidIvSize;
+  flags &= ~kUseSubsampleEncryption;
+}
+
 OriginalFormat::OriginalFormat() = default;
 OriginalFormat::~OriginalFormat() = default;
 
@@ -1158,50 +1221,75 @@ FourCC SampleTable::BoxType() const {
 
 bool SampleTable::ReadWriteInternal(BoxBuffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) && buffer->PrepareChildren() &&
-         buffer->ReadWriteChild(&description) &&
-         buffer->ReadWriteChild(&decoding_time_to_sample) &&
-         buffer->TryReadWriteChild(&composition_time_to_sample) &&
-         buffer->ReadWriteChild(&sample_to_chunk));
+         buffer->ReadWriteChild(&description));
 
   if (buffer->Reading()) {
     BoxReader* reader = buffer->reader();
     DCHECK(reader);
 
-    // Either SampleSize or CompactSampleSize must present.
-    if (reader->ChildExist(&sample_size)) {
-      RCHECK(reader->ReadChild(&sample_size));
+    RCHECK(reader->ReadChild(&sample_to_chunk));
+    if (reader->defer_sample_tables()) {
+      deferred_data = reader->data();
+      deferred_size = reader->size();
     } else {
-      CompactSampleSize compact_sample_size;
-      RCHECK(reader->ReadChild(&compact_sample_size));
-      sample_size.sample_size = 0;
-      sample_size.sample_count =
-          static_cast<uint32_t>(compact_sample_size.sizes.size());
-      sample_size.sizes.swap(compact_sample_size.sizes);
+      RCHECK(ReadSampleTables(reader));
     }
+    RCHECK(reader->TryReadChildren(&sample_group_descriptions) &&
+           reader->TryReadChildren(&sample_to_groups));
+    return true;
+  }
 
-    // Either ChunkOffset or ChunkLargeOffset must present.
-    if (reader->ChildExist(&chunk_large_offset)) {
-      RCHECK(reader->ReadChild(&chunk_large_offset));
-    } else {
-      ChunkOffset chunk_offset;
-      RCHECK(reader->ReadChild(&chunk_offset));
-      chunk_large_offset.offsets.swap(chunk_offset.offsets);
-    }
+  RCHECK(buffer->ReadWriteChild(&decoding_time_to_sample) &&
+         buffer->TryReadWriteChild(&composition_time_to_sample) &&
+         buffer->ReadWriteChild(&sample_to_chunk) &&
+         buffer->ReadWriteChild(&sample_size) &&
+         buffer->ReadWriteChild(&chunk_large_offset) &&
+         buffer->TryReadWriteChild(&sync_sample));
+  for (auto& sample_group_description : sample_group_descriptions)
+    RCHECK(buffer->ReadWriteChild(&sample_group_description));
+  for (auto& sample_to_group : sample_to_groups)
+    RCHECK(buffer->ReadWriteChild(&sample_to_group));
+  return true;
+}
+
+bool SampleTable::ParseDeferredTables() {
+  if (!deferred_data)
+    return true;
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(
+      BoxReader::ReadBox(deferred_data, deferred_size, &err));
+  deferred_data = nullptr;
+  deferred_size = 0;
+  RCHECK(reader && reader->ScanChildren());
+  return ReadSampleTables(reader.get());
+}
+
+bool SampleTable::ReadSampleTables(BoxReader* reader) {
+  RCHECK(reader->ReadChild(&decoding_time_to_sample) &&
+         reader->TryReadChild(&composition_time_to_sample));
+
+  // Either SampleSize or CompactSampleSize must present.
+  if (reader->ChildExist(&sample_size)) {
+    RCHECK(reader->ReadChild(&sample_size));
   } else {
-    RCHECK(buffer->ReadWriteChild(&sample_size) &&
-           buffer->ReadWriteChild(&chunk_large_offset));
+    CompactSampleSize compact_sample_size;
+    RCHECK(reader->ReadChild(&compact_sample_size));
+    sample_size.sample_size = 0;
+    sample_size.sample_count =
+        static_cast<uint32_t>(compact_sample_size.sizes.size());
+    sample_size.sizes.swap(compact_sample_size.sizes);
   }
-  RCHECK(buffer->TryReadWriteChild(&sync_sample));
-  if (buffer->Reading()) {
-    RCHECK(buffer->reader()->TryReadChildren(&sample_group_descriptions) &&
-           buffer->reader()->TryReadChildren(&sample_to_groups));
+
+  // Either ChunkOffset or ChunkLargeOffset must present.
+  if (reader->ChildExist(&chunk_large_offset)) {
+    RCHECK(reader->ReadChild(&chunk_large_offset));
   } else {
-    for (auto& sample_group_description : sample_group_descriptions)
-      RCHECK(buffer->ReadWriteChild(&sample_group_description));
-    for (auto& sample_to_group : sample_to_groups)
-      RCHECK(buffer->ReadWriteChild(&sample_to_group));
+    ChunkOffset chunk_offset;
+    RCHECK(reader->ReadChild(&chunk_offset));
+    chunk_large_offset.offsets.swap(chunk_offset.offsets);
   }
-  return true;
+
+  return reader->TryReadChild(&sync_sample);
 }
 
 size_t SampleTable::ComputeSizeInternal() {
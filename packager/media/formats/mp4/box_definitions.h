@@ -120,12 +120,30 @@ struct SampleEncryption : FullBox {
       uint8_t iv_size,
       std::vector<SampleEncryptionEntry>* sample_encryption_entries) const;
 
+  /// Append a sample encryption entry to @a serialized_entries, in the format
+  /// it is written in, instead of adding it to @a sample_encryption_entries.
+  /// The first entry sets @a iv_size and the subsample encryption flag; the
+  /// following entries must be consistent with them.
+  /// @param[out] entry_size receives the size of the serialized entry.
+  /// @return true on success, false if the entry is inconsistent.
+  bool AppendSerializedEntry(const std::vector<uint8_t>& initialization_vector,
+                             const std::vector<SubsampleEntry>& subsamples,
+                             uint32_t* entry_size);
+  /// Clear the serialized entries, keeping the capacity of the buffer, and
+  /// reset @a iv_size and the subsample encryption flag.
+  void ClearSerializedEntries();
+
   /// We may not know @a iv_size before reading this box. In this case, we will
   /// store sample encryption data for parsing later when @a iv_size is known.
   std::vector<uint8_t> sample_encryption_data;
 
   uint8_t iv_size = kInvalidIvSize;
   std::vector<SampleEncryptionEntry> sample_encryption_entries;
+
+  /// The entries appended by AppendSerializedEntry() and their count. They are
+  /// written instead of @a sample_encryption_entries if there is any.
+  std::vector<uint8_t> serialized_entries;
+  uint32_t serialized_entry_count = 0;
 };
 
 struct OriginalFormat : Box {
@@ -576,6 +594,22 @@ struct SampleTable : Box {
   SyncSample sync_sample;
   std::vector<SampleGroupDescription> sample_group_descriptions;
   std::vector<SampleToGroup> sample_to_groups;
+
+  /// Parse the sample tables left unparsed when the box was read with
+  /// BoxReader::defer_sample_tables(). Does nothing if there are none.
+  /// @return true on success, false otherwise.
+  bool ParseDeferredTables();
+
+  /// The content of the box, with 'stts', 'ctts', 'stsz' or 'stz2', 'stco' or
+  /// 'co64' and 'stss' unparsed, if the box was read with
+  /// BoxReader::defer_sample_tables(). 'stsd', 'stsc', 'sgpd' and 'sbgp' are
+  /// always parsed. Points into the buffer of the reader, so it is only valid
+  /// as long as that buffer is.
+  const uint8_t* deferred_data = nullptr;
+  size_t deferred_size = 0;
+
+ private:
+  bool ReadSampleTables(BoxReader* reader);
 };
 
 struct MediaHeader : FullBox {
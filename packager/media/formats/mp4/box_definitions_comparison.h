@@ -53,7 +53,9 @@ inline bool operator==(const SampleEncryptionEntry& lhs,
 inline bool operator==(const SampleEncryption& lhs,
                        const SampleEncryption& rhs) {
   return lhs.iv_size == rhs.iv_size &&
-         lhs.sample_encryption_entries == rhs.sample_encryption_entries;
+         lhs.sample_encryption_entries == rhs.sample_encryption_entries &&
+         lhs.serialized_entries == rhs.serialized_entries &&
+         lhs.serialized_entry_count == rhs.serialized_entry_count;
 }
 
 inline bool operator==(const OriginalFormat& lhs, const OriginalFormat& rhs) {
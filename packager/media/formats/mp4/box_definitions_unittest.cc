@@ -1121,6 +1121,21 @@ TYPED_TEST_P(BoxDefinitionsTestGeneral, WriteModifyWrite) {
   ASSERT_EQ(box, box_readback);
 }
 
+TYPED_TEST_P(BoxDefinitionsTestGeneral, WriteWithComputedSize) {
+  TypeParam box;
+  LOG(INFO) << "Processing " << FourCCToString(box.BoxType());
+  this->Fill(&box);
+  box.Write(this->buffer_.get());
+
+  BufferWriter buffer;
+  ASSERT_EQ(this->buffer_->Size(), box.ComputeSize());
+  box.WriteWithComputedSize(&buffer);
+  EXPECT_EQ(std::vector<uint8_t>(this->buffer_->Buffer(),
+                                 this->buffer_->Buffer() + this->buffer_->Size()),
+            std::vector<uint8_t>(buffer.Buffer(),
+                                 buffer.Buffer() + buffer.Size()));
+}
+
 TYPED_TEST_P(BoxDefinitionsTestGeneral, Empty) {
   TypeParam box;
   LOG(INFO) << "Processing " << FourCCToString(box.BoxType());
@@ -1135,6 +1150,7 @@ REGISTER_TYPED_TEST_CASE_P(BoxDefinitionsTestGeneral,
                            WriteHeader,
                            WriteReadbackCompare,
                            WriteModifyWrite,
+                           WriteWithComputedSize,
                            Empty);
 
 INSTANTIATE_TYPED_TEST_CASE_P(BoxDefinitionTypedTests,
@@ -1362,6 +1378,27 @@ TEST_F(BoxDefinitionsTest, TrackEncryptionConstantIv) {
   ASSERT_EQ(tenc, tenc_readback);
 }
 
+TEST_F(BoxDefinitionsTest, SampleTableWithDeferredTables) {
+  SampleTable stbl;
+  Fill(&stbl);
+  stbl.Write(buffer_.get());
+
+  SampleTable stbl_readback;
+  stbl_readback.description.type = kSampleDescriptionTrackType;
+  std::unique_ptr<BoxReader> reader(CreateReader());
+  reader->set_defer_sample_tables(true);
+  ASSERT_TRUE(reader->ScanChildren() && reader->ReadChild(&stbl_readback));
+  ASSERT_TRUE(stbl_readback.deferred_data);
+  EXPECT_EQ(stbl.description, stbl_readback.description);
+  EXPECT_EQ(stbl.sample_to_chunk, stbl_readback.sample_to_chunk);
+  EXPECT_TRUE(stbl_readback.decoding_time_to_sample.decoding_time.empty());
+  EXPECT_TRUE(stbl_readback.sample_size.sizes.empty());
+
+  ASSERT_TRUE(stbl_readback.ParseDeferredTables());
+  EXPECT_FALSE(stbl_readback.deferred_data);
+  ASSERT_EQ(stbl, stbl_readback);
+}
+
 TEST_F(BoxDefinitionsTest, SampleEncryptionWithIvKnownWhenReading) {
   SampleEncryption senc;
   Fill(&senc);
@@ -1381,6 +1418,36 @@ TEST_F(BoxDefinitionsTest, SampleEncryptionWithIvKnownWhenReading) {
   ASSERT_EQ(senc, senc_readback);
 }
 
+TEST_F(BoxDefinitionsTest, SampleEncryptionWithSerializedEntries) {
+  SampleEncryption senc;
+  Fill(&senc);
+
+  SampleEncryption serialized_senc;
+  for (const SampleEncryptionEntry& entry : senc.sample_encryption_entries) {
+    uint32_t entry_size = 0;
+    ASSERT_TRUE(serialized_senc.AppendSerializedEntry(
+        entry.initialization_vector, entry.subsamples, &entry_size));
+    EXPECT_EQ(entry.ComputeSize(), entry_size);
+  }
+  EXPECT_EQ(senc.ComputeSize(), serialized_senc.ComputeSize());
+  serialized_senc.Write(buffer_.get());
+
+  SampleEncryption senc_readback;
+  senc_readback.iv_size = senc.iv_size;
+  ASSERT_TRUE(ReadBack(&senc_readback));
+  ASSERT_EQ(senc.sample_encryption_entries,
+            senc_readback.sample_encryption_entries);
+
+  // The IV size must not change between the entries of a fragment.
+  uint32_t entry_size = 0;
+  EXPECT_FALSE(serialized_senc.AppendSerializedEntry(
+      std::vector<uint8_t>(16), std::vector<SubsampleEntry>(), &entry_size));
+
+  serialized_senc.ClearSerializedEntries();
+  EXPECT_EQ(0u, serialized_senc.serialized_entry_count);
+  EXPECT_TRUE(serialized_senc.serialized_entries.empty());
+}
+
 TEST_F(BoxDefinitionsTest, SampleEncryptionWithIvUnknownWhenReading) {
   SampleEncryption senc;
   Fill(&senc);
@@ -24,10 +24,10 @@ BoxReader::BoxReader(const uint8_t* buf, size_t size)
 }
 
 BoxReader::~BoxReader() {
-  if (scanned_ && !children_.empty()) {
-    for (ChildMap::iterator itr = children_.begin(); itr != children_.end();
-         ++itr) {
-      DVLOG(1) << "Skipping unknown box: " << FourCCToString(itr->first);
+  if (scanned_) {
+    for (const Child& entry : children_) {
+      if (!entry.read)
+        DVLOG(1) << "Skipping unknown box: " << FourCCToString(entry.type);
     }
   }
 }
@@ -69,16 +69,14 @@ bool BoxReader::ScanChildren() {
   scanned_ = true;
 
   while (pos() < size()) {
-    std::unique_ptr<BoxReader> child(
-        new BoxReader(&data()[pos()], size() - pos()));
+    BoxReader child(&data()[pos()], size() - pos());
     bool err;
-    if (!child->ReadHeader(&err))
+    if (!child.ReadHeader(&err))
       return false;
 
-    FourCC box_type = child->type();
-    size_t box_size = child->size();
-    children_.insert(std::pair<FourCC, std::unique_ptr<BoxReader>>(
-        box_type, std::move(child)));
+    FourCC box_type = child.type();
+    size_t box_size = child.size();
+    children_.push_back({box_type, pos(), box_size, false});
     VLOG(2) << "Child " << FourCCToString(box_type) << " size 0x" << std::hex
             << box_size << std::dec;
     RCHECK(SkipBytes(box_size));
@@ -91,24 +89,46 @@ bool BoxReader::ReadChild(Box* child) {
   DCHECK(scanned_);
   FourCC child_type = child->BoxType();
 
-  ChildMap::iterator itr = children_.find(child_type);
-  RCHECK(itr != children_.end());
+  Child* entry = FindChild(child_type);
+  RCHECK(entry);
   DVLOG(2) << "Found a " << FourCCToString(child_type) << " box.";
-  RCHECK(child->Parse(itr->second.get()));
-  children_.erase(itr);
-  return true;
+  return ParseChild(entry, child);
 }
 
 bool BoxReader::ChildExist(Box* child) {
-  return children_.count(child->BoxType()) > 0;
+  return FindChild(child->BoxType()) != nullptr;
 }
 
 bool BoxReader::TryReadChild(Box* child) {
-  if (!children_.count(child->BoxType()))
+  if (!FindChild(child->BoxType()))
     return true;
   return ReadChild(child);
 }
 
+BoxReader::Child* BoxReader::FindChild(FourCC type) {
+  for (size_t i = first_unread_child_; i < children_.size(); ++i) {
+    Child& entry = children_[i];
+    if (entry.type == type && !entry.read)
+      return &entry;
+  }
+  return nullptr;
+}
+
+bool BoxReader::ParseChild(Child* entry, Box* child) {
+  entry->read = true;
+  while (first_unread_child_ < children_.size() &&
+         children_[first_unread_child_].read) {
+    ++first_unread_child_;
+  }
+  // The header was validated by ScanChildren(), so reading it again does not
+  // fail.
+  BoxReader child_reader(&data()[entry->offset], entry->size);
+  bool err;
+  RCHECK(child_reader.ReadHeader(&err));
+  child_reader.set_defer_sample_tables(defer_sample_tables_);
+  return child->Parse(&child_reader);
+}
+
 bool BoxReader::ReadHeader(bool* err) {
   uint64_t size = 0;
   *err = false;
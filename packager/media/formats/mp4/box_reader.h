@@ -5,7 +5,6 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP4_BOX_READER_H_
 #define PACKAGER_MEDIA_FORMATS_MP4_BOX_READER_H_
 
-#include <map>
 #include <memory>
 #include <vector>
 
@@ -99,6 +98,14 @@ class BoxReader : public BufferReader {
 
   FourCC type() const { return type_; }
 
+  /// Whether the 'stbl' boxes read through this reader, or through the readers
+  /// of its descendants, keep their sample tables unparsed. See
+  /// SampleTable::ParseDeferredTables().
+  void set_defer_sample_tables(bool defer_sample_tables) {
+    defer_sample_tables_ = defer_sample_tables;
+  }
+  bool defer_sample_tables() const { return defer_sample_tables_; }
+
  private:
   BoxReader(const uint8_t* buf, size_t size);
 
@@ -111,14 +118,32 @@ class BoxReader : public BufferReader {
   // true, the error is unrecoverable and the stream should be aborted.
   bool ReadHeader(bool* err);
 
-  FourCC type_;
+  // A child box found by ScanChildren().
+  struct Child {
+    FourCC type;
+    // The position and size of the box, including its header, in the buffer.
+    size_t offset;
+    size_t size;
+    // Whether the child has been read.
+    bool read;
+  };
+
+  // Returns the first child of |type| not read yet, or NULL if there is none.
+  Child* FindChild(FourCC type);
+  // Parses |child| from |entry| and marks it read.
+  bool ParseChild(Child* entry, Box* child);
 
-  typedef std::multimap<FourCC, std::unique_ptr<BoxReader>> ChildMap;
+  FourCC type_;
 
-  // The set of child box FourCCs and their corresponding buffer readers. Only
-  // valid if scanned_ is true.
-  ChildMap children_;
+  // The child boxes in the order of the buffer. Only valid if scanned_ is
+  // true. The children are looked up linearly, as boxes have a few children.
+  std::vector<Child> children_;
+  // Index of the first child not read yet. The children are usually read in
+  // the order of the buffer, so the lookups start from there instead of
+  // walking over the children read already.
+  size_t first_unread_child_ = 0;
   bool scanned_;
+  bool defer_sample_tables_ = false;
 
   DISALLOW_COPY_AND_ASSIGN(BoxReader);
 };
@@ -138,15 +163,21 @@ bool BoxReader::TryReadChildren(std::vector<T>* children) {
   children->resize(1);
   FourCC child_type = (*children)[0].BoxType();
 
-  ChildMap::iterator start_itr = children_.lower_bound(child_type);
-  ChildMap::iterator end_itr = children_.upper_bound(child_type);
-  children->resize(std::distance(start_itr, end_itr));
+  const size_t first_child = first_unread_child_;
+  size_t num_children = 0;
+  for (size_t i = first_child; i < children_.size(); ++i) {
+    if (children_[i].type == child_type && !children_[i].read)
+      ++num_children;
+  }
+  children->resize(num_children);
   typename std::vector<T>::iterator child_itr = children->begin();
-  for (ChildMap::iterator itr = start_itr; itr != end_itr; ++itr) {
-    RCHECK(child_itr->Parse(itr->second.get()));
+  for (size_t i = first_child; i < children_.size(); ++i) {
+    Child& entry = children_[i];
+    if (entry.type != child_type || entry.read)
+      continue;
+    RCHECK(ParseChild(&entry, &*child_itr));
     ++child_itr;
   }
-  children_.erase(start_itr, end_itr);
 
   DVLOG(2) << "Found " << children->size() << " " << FourCCToString(child_type)
            << " boxes.";
@@ -163,6 +194,7 @@ bool BoxReader::ReadAllChildren(std::vector<T>* children) {
     bool err;
     if (!child_reader.ReadHeader(&err))
       return false;
+    child_reader.set_defer_sample_tables(defer_sample_tables_);
 
     T child;
     RCHECK(child.Parse(&child_reader));
@@ -151,7 +151,9 @@ TEST_F(BoxReaderTest, ScanChildrenTest) {
   EXPECT_TRUE(reader->SkipBytes(16) && reader->ScanChildren());
 
   FreeBox free;
+  EXPECT_TRUE(reader->ChildExist(&free));
   EXPECT_TRUE(reader->ReadChild(&free));
+  EXPECT_FALSE(reader->ChildExist(&free));
   EXPECT_FALSE(reader->ReadChild(&free));
   EXPECT_TRUE(reader->TryReadChild(&free));
 
@@ -159,6 +161,8 @@ TEST_F(BoxReaderTest, ScanChildrenTest) {
 
   EXPECT_TRUE(reader->ReadChildren(&kids));
   EXPECT_EQ(2u, kids.size());
+  EXPECT_EQ(0xdeadbeef, kids[0].val);  // Ensure order is preserved.
+  EXPECT_EQ(0xfacecafe, kids[1].val);
   kids.clear();
   EXPECT_FALSE(reader->ReadChildren(&kids));
   EXPECT_TRUE(reader->TryReadChildren(&kids));
@@ -14,6 +14,7 @@
 #include "packager/media/base/media_sample.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/key_frame_info.h"
+#include "packager/metrics/trace_event.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -31,18 +32,39 @@ int64_t GetSeekPreroll(const StreamInfo& stream_info) {
   return audio_stream_info.seek_preroll_ns();
 }
 
-void NewSampleEncryptionEntry(const DecryptConfig& decrypt_config,
+// Append |value| to |entries|, clearing |all_equal| if it differs from the
+// first entry.
+template <typename T>
+void AddSampleEntry(T value, std::vector<T>* entries, bool* all_equal) {
+  if (!entries->empty() && value != entries->front())
+    *all_equal = false;
+  entries->push_back(value);
+}
+
+// Reserve room for |count| entries in |entries|, keeping the growth geometric.
+template <typename T>
+void ReserveEntries(size_t count, std::vector<T>* entries) {
+  if (count > entries->capacity())
+    entries->reserve(std::max(count, entries->capacity() * 2));
+}
+
+// Serialize the sample encryption entry into 'senc' as it is written, and
+// add its size to 'saiz'.
+bool NewSampleEncryptionEntry(const DecryptConfig& decrypt_config,
                               bool use_constant_iv,
-                              TrackFragment* traf) {
-  SampleEncryption& sample_encryption = traf->sample_encryption;
-  SampleEncryptionEntry sample_encryption_entry;
-  if (!use_constant_iv)
-    sample_encryption_entry.initialization_vector = decrypt_config.iv();
-  sample_encryption_entry.subsamples = decrypt_config.subsamples();
-  sample_encryption.sample_encryption_entries.push_back(
-      sample_encryption_entry);
-  traf->auxiliary_size.sample_info_sizes.push_back(
-      sample_encryption_entry.ComputeSize());
+                              TrackFragment* traf,
+                              bool* same_sample_info_sizes) {
+  static const std::vector<uint8_t> kNoIv;
+  uint32_t entry_size = 0;
+  if (!traf->sample_encryption.AppendSerializedEntry(
+          use_constant_iv ? kNoIv : decrypt_config.iv(),
+          decrypt_config.subsamples(), &entry_size)) {
+    return false;
+  }
+  AddSampleEntry(static_cast<uint8_t>(entry_size),
+                 &traf->auxiliary_size.sample_info_sizes,
+                 same_sample_info_sizes);
+  return true;
 }
 
 }  // namespace
@@ -54,6 +76,9 @@ Fragmenter::Fragmenter(std::shared_ptr<const StreamInfo> stream_info,
       traf_(traf),
       edit_list_offset_(edit_list_offset),
       seek_preroll_(GetSeekPreroll(*stream_info_)),
+      is_video_(stream_info_->stream_type() == kStreamVideo),
+      use_constant_iv_(
+          !stream_info_->encryption_config().constant_iv.empty()),
       earliest_presentation_time_(kInvalidTime),
       first_sap_time_(kInvalidTime) {
   DCHECK(stream_info_);
@@ -63,42 +88,78 @@ Fragmenter::Fragmenter(std::shared_ptr<const StreamInfo> stream_info,
 Fragmenter::~Fragmenter() {}
 
 Status Fragmenter::AddSample(const MediaSample& sample) {
+  if (!fragment_initialized_)
+    RETURN_IF_ERROR(InitializeFragment(sample.dts()));
+  return AddSampleToFragment(sample);
+}
+
+Status Fragmenter::AddSamples(
+    const std::vector<std::shared_ptr<const MediaSample>>& samples) {
+  if (samples.empty())
+    return Status::OK;
+  if (!fragment_initialized_)
+    RETURN_IF_ERROR(InitializeFragment(samples.front()->dts()));
+
+  // Grow the sample tables and the fragment data once for the whole batch.
+  size_t data_size = 0;
+  for (const auto& sample : samples)
+    data_size += sample->data_size();
+  data_->Reserve(data_size);
+
+  TrackFragmentRun& run = traf_->runs[0];
+  const size_t sample_count = run.sample_sizes.size() + samples.size();
+  ReserveEntries(sample_count, &run.sample_sizes);
+  ReserveEntries(sample_count, &run.sample_durations);
+  ReserveEntries(sample_count, &run.sample_flags);
+  ReserveEntries(sample_count, &run.sample_composition_time_offsets);
+  if (samples.front()->decrypt_config())
+    ReserveEntries(sample_count, &traf_->auxiliary_size.sample_info_sizes);
+
+  for (const auto& sample : samples)
+    RETURN_IF_ERROR(AddSampleToFragment(*sample));
+  return Status::OK;
+}
+
+Status Fragmenter::AddSampleToFragment(const MediaSample& sample) {
+  DCHECK(fragment_initialized_);
   const int64_t pts = sample.pts();
   const int64_t dts = sample.dts();
   const int64_t duration = sample.duration();
   if (duration == 0)
     LOG(WARNING) << "Unexpected sample with zero duration @ dts " << dts;
 
-  if (!fragment_initialized_)
-    RETURN_IF_ERROR(InitializeFragment(dts));
-
   if (sample.side_data_size() > 0)
     LOG(WARNING) << "MP4 samples do not support side data. Side data ignored.";
 
   // Fill in sample parameters. It will be optimized later.
-  traf_->runs[0].sample_sizes.push_back(
-      static_cast<uint32_t>(sample.data_size()));
-  traf_->runs[0].sample_durations.push_back(duration);
-  traf_->runs[0].sample_flags.push_back(
-      sample.is_key_frame() ? 0 : TrackFragmentHeader::kNonKeySampleMask);
-
-  if (sample.decrypt_config()) {
-    NewSampleEncryptionEntry(
-        *sample.decrypt_config(),
-        !stream_info_->encryption_config().constant_iv.empty(), traf_);
+  TrackFragmentRun& run = traf_->runs[0];
+  AddSampleEntry(static_cast<uint32_t>(sample.data_size()), &run.sample_sizes,
+                 &same_sample_sizes_);
+  AddSampleEntry(static_cast<uint32_t>(duration), &run.sample_durations,
+                 &same_sample_durations_);
+  AddSampleEntry(static_cast<uint32_t>(
+                     sample.is_key_frame()
+                         ? 0
+                         : TrackFragmentHeader::kNonKeySampleMask),
+                 &run.sample_flags, &same_sample_flags_);
+
+  if (sample.decrypt_config() &&
+      !NewSampleEncryptionEntry(*sample.decrypt_config(), use_constant_iv_,
+                                traf_, &same_sample_info_sizes_)) {
+    return Status(error::MUXER_FAILURE,
+                  "Failed to add the sample encryption entry.");
   }
 
-  if (stream_info_->stream_type() == StreamType::kStreamVideo &&
-      sample.is_key_frame()) {
+  if (is_video_ && sample.is_key_frame()) {
     key_frame_infos_.push_back(
         {static_cast<uint64_t>(pts), data_->Size(), sample.data_size()});
   }
 
   data_->AppendArray(sample.data(), sample.data_size());
 
-  traf_->runs[0].sample_composition_time_offsets.push_back(pts - dts);
+  run.sample_composition_time_offsets.push_back(pts - dts);
   if (pts != dts)
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
+    run.flags |= TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
 
   // Exclude the part of sample with negative pts out of duration calculation as
   // they are not presented.
@@ -136,12 +197,25 @@ Status Fragmenter::InitializeFragment(int64_t first_sample_dts) {
   const int64_t dts_before_edit = first_sample_dts + edit_list_offset_;
   traf_->decode_time.decode_time = dts_before_edit;
 
-  traf_->runs.clear();
+  // Reuse the run, so that its sample tables keep their capacity from the
+  // previous fragment.
   traf_->runs.resize(1);
-  traf_->runs[0].flags = TrackFragmentRun::kDataOffsetPresentMask;
+  TrackFragmentRun& run = traf_->runs[0];
+  run.version = 0;
+  run.flags = TrackFragmentRun::kDataOffsetPresentMask;
+  run.sample_count = 0;
+  run.data_offset = 0;
+  run.sample_flags.clear();
+  run.sample_sizes.clear();
+  run.sample_durations.clear();
+  run.sample_composition_time_offsets.clear();
+  same_sample_durations_ = true;
+  same_sample_sizes_ = true;
+  same_sample_flags_ = true;
+  same_sample_info_sizes_ = true;
   traf_->auxiliary_size.sample_info_sizes.clear();
   traf_->auxiliary_offset.offsets.clear();
-  traf_->sample_encryption.sample_encryption_entries.clear();
+  traf_->sample_encryption.ClearSerializedEntries();
   traf_->sample_group_descriptions.clear();
   traf_->sample_to_groups.clear();
   traf_->header.sample_description_index = 1;  // 1-based.
@@ -151,12 +225,31 @@ Status Fragmenter::InitializeFragment(int64_t first_sample_dts) {
   fragment_duration_ = 0;
   earliest_presentation_time_ = kInvalidTime;
   first_sap_time_ = kInvalidTime;
-  data_.reset(new BufferWriter());
+  // Keep the buffer, which is reserved for the expected fragment size.
+  if (data_)
+    data_->Clear();
+  else
+    data_.reset(new BufferWriter());
   key_frame_infos_.clear();
   return Status::OK;
 }
 
+std::unique_ptr<BufferWriter> Fragmenter::ReleaseData() {
+  // The estimate follows the largest recent fragments and decays slowly when
+  // the fragments get smaller. Reserving it, with some headroom, for the next
+  // fragment saves the reallocations and copies of large fragments while the
+  // samples are appended.
+  const size_t size = data_ ? data_->Size() : 0;
+  data_size_estimate_ =
+      std::max(size, data_size_estimate_ - data_size_estimate_ / 8);
+  std::unique_ptr<BufferWriter> data(
+      new BufferWriter(data_size_estimate_ + data_size_estimate_ / 8));
+  data_.swap(data);
+  return data;
+}
+
 Status Fragmenter::FinalizeFragment() {
+  SHAKA_TRACE_EVENT("mp4", "Fragmenter::FinalizeFragment");
   if (stream_info_->is_encrypted()) {
     Status status = FinalizeFragmentForEncryption();
     if (!status.ok())
@@ -166,20 +259,21 @@ Status Fragmenter::FinalizeFragment() {
   // Optimize trun box.
   traf_->runs[0].sample_count =
       static_cast<uint32_t>(traf_->runs[0].sample_sizes.size());
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_durations,
+  if (OptimizeSampleEntries(same_sample_durations_,
+                            &traf_->runs[0].sample_durations,
                             &traf_->header.default_sample_duration)) {
     traf_->header.flags |=
         TrackFragmentHeader::kDefaultSampleDurationPresentMask;
   } else {
     traf_->runs[0].flags |= TrackFragmentRun::kSampleDurationPresentMask;
   }
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_sizes,
+  if (OptimizeSampleEntries(same_sample_sizes_, &traf_->runs[0].sample_sizes,
                             &traf_->header.default_sample_size)) {
     traf_->header.flags |= TrackFragmentHeader::kDefaultSampleSizePresentMask;
   } else {
     traf_->runs[0].flags |= TrackFragmentRun::kSampleSizePresentMask;
   }
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_flags,
+  if (OptimizeSampleEntries(same_sample_flags_, &traf_->runs[0].sample_flags,
                             &traf_->header.default_sample_flags)) {
     traf_->header.flags |= TrackFragmentHeader::kDefaultSampleFlagsPresentMask;
   } else {
@@ -238,7 +332,7 @@ void Fragmenter::GenerateSegmentReference(SegmentReference* reference) const {
 
 Status Fragmenter::FinalizeFragmentForEncryption() {
   SampleEncryption& sample_encryption = traf_->sample_encryption;
-  if (sample_encryption.sample_encryption_entries.empty()) {
+  if (sample_encryption.serialized_entry_count == 0) {
     // This fragment is not encrypted.
     // There are two sample description entries, an encrypted entry and a clear
     // entry, are generated. The 1-based clear entry index is always 2.
@@ -246,21 +340,17 @@ Status Fragmenter::FinalizeFragmentForEncryption() {
     traf_->header.sample_description_index = kClearSampleDescriptionIndex;
     return Status::OK;
   }
-  if (sample_encryption.sample_encryption_entries.size() !=
+  if (sample_encryption.serialized_entry_count !=
       traf_->runs[0].sample_sizes.size()) {
     LOG(ERROR) << "Partially encrypted segment is not supported";
     return Status(error::MUXER_FAILURE,
                   "Partially encrypted segment is not supported.");
   }
 
-  const SampleEncryptionEntry& sample_encryption_entry =
-      sample_encryption.sample_encryption_entries.front();
+  // The IV size and the subsample encryption flag were set by the first entry.
   const bool use_subsample_encryption =
-      !sample_encryption_entry.subsamples.empty();
-  if (use_subsample_encryption)
-    traf_->sample_encryption.flags |= SampleEncryption::kUseSubsampleEncryption;
-  traf_->sample_encryption.iv_size = static_cast<uint8_t>(
-      sample_encryption_entry.initialization_vector.size());
+      (sample_encryption.flags & SampleEncryption::kUseSubsampleEncryption) !=
+      0;
 
   // The offset will be adjusted in Segmenter after knowing moof size.
   traf_->auxiliary_offset.offsets.push_back(0);
@@ -269,8 +359,8 @@ Status Fragmenter::FinalizeFragmentForEncryption() {
   SampleAuxiliaryInformationSize& saiz = traf_->auxiliary_size;
   saiz.sample_count = static_cast<uint32_t>(saiz.sample_info_sizes.size());
   DCHECK_EQ(saiz.sample_info_sizes.size(),
-            traf_->sample_encryption.sample_encryption_entries.size());
-  if (!OptimizeSampleEntries(&saiz.sample_info_sizes,
+            traf_->sample_encryption.serialized_entry_count);
+  if (!OptimizeSampleEntries(same_sample_info_sizes_, &saiz.sample_info_sizes,
                              &saiz.default_sample_info_size)) {
     saiz.default_sample_info_size = 0;
   }
@@ -7,6 +7,7 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP4_FRAGMENTER_H_
 #define PACKAGER_MEDIA_FORMATS_MP4_FRAGMENTER_H_
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -45,6 +46,14 @@ class Fragmenter {
   /// @return OK on success, an error status otherwise.
   Status AddSample(const MediaSample& sample);
 
+  /// Add consecutive samples to the fragmenter at once, e.g. the short frames
+  /// of an audio stream, so that the sample tables and the fragment data grow
+  /// once for all of them.
+  /// @param samples contains the samples to be added, in decoding order.
+  /// @return OK on success, an error status otherwise.
+  Status AddSamples(
+      const std::vector<std::shared_ptr<const MediaSample>>& samples);
+
   /// Initialize the fragment with default data.
   /// @param first_sample_dts specifies the decoding timestamp for the first
   ///        sample for this fragment.
@@ -67,6 +76,10 @@ class Fragmenter {
   bool fragment_initialized() const { return fragment_initialized_; }
   bool fragment_finalized() const { return fragment_finalized_; }
   BufferWriter* data() { return data_.get(); }
+  /// Transfer the fragment data to the caller, without copying it. The
+  /// fragmenter is left with an empty data buffer, reserved for the size of
+  /// the previous fragments.
+  std::unique_ptr<BufferWriter> ReleaseData();
   const std::vector<KeyFrameInfo>& key_frame_infos() const {
     return key_frame_infos_;
   }
@@ -75,12 +88,17 @@ class Fragmenter {
   TrackFragment* traf() { return traf_; }
 
   /// Optimize sample entries table. If all values in @a entries are identical,
-  /// then @a entries is cleared and the value is assigned to @a default_value;
-  /// otherwise it is a NOP. Return true if the table is optimized.
+  /// as tracked in @a all_equal while the entries were added, then @a entries
+  /// is cleared and the value is assigned to @a default_value; otherwise it is
+  /// a NOP. Return true if the table is optimized.
   template <typename T>
-  bool OptimizeSampleEntries(std::vector<T>* entries, T* default_value);
+  bool OptimizeSampleEntries(bool all_equal,
+                             std::vector<T>* entries,
+                             T* default_value);
 
  private:
+  // Add |sample| to the initialized fragment.
+  Status AddSampleToFragment(const MediaSample& sample);
   Status FinalizeFragmentForEncryption();
   // Check if the current fragment starts with SAP.
   bool StartsWithSAP() const;
@@ -89,32 +107,45 @@ class Fragmenter {
   TrackFragment* traf_ = nullptr;
   int64_t edit_list_offset_ = 0;
   int64_t seek_preroll_ = 0;
+  // Resolved once from |stream_info_| rather than for every sample.
+  const bool is_video_ = false;
+  const bool use_constant_iv_ = false;
   bool fragment_initialized_ = false;
   bool fragment_finalized_ = false;
   int64_t fragment_duration_ = 0;
   int64_t earliest_presentation_time_ = 0;
   int64_t first_sap_time_ = 0;
   std::unique_ptr<BufferWriter> data_;
+  // Estimated size of the fragment data, from the previous fragments.
+  size_t data_size_estimate_ = 0;
   // Saves key frames information, for Video.
   std::vector<KeyFrameInfo> key_frame_infos_;
+  // Whether the entries of the sample tables of the current fragment are all
+  // equal so far, so that FinalizeFragment() does not walk the tables again.
+  bool same_sample_durations_ = true;
+  bool same_sample_sizes_ = true;
+  bool same_sample_flags_ = true;
+  bool same_sample_info_sizes_ = true;
 
   DISALLOW_COPY_AND_ASSIGN(Fragmenter);
 };
 
 template <typename T>
-bool Fragmenter::OptimizeSampleEntries(std::vector<T>* entries,
+bool Fragmenter::OptimizeSampleEntries(bool all_equal,
+                                       std::vector<T>* entries,
                                        T* default_value) {
   DCHECK(entries);
   DCHECK(default_value);
   DCHECK(!entries->empty());
 
-  typename std::vector<T>::const_iterator it = entries->begin();
-  T value = *it;
-  for (; it < entries->end(); ++it)
-    if (value != *it)
-      return false;
+  const T value = entries->front();
+  DCHECK_EQ(all_equal, std::all_of(entries->begin(), entries->end(),
+                                   [value](T entry) { return entry == value; }));
+  if (!all_equal)
+    return false;
 
-  // Clear |entries| if it contains only one value.
+  // Clear |entries| if it contains only one value. The capacity is kept for
+  // the next fragment.
   entries->clear();
   *default_value = value;
   return true;
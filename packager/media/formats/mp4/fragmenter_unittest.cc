@@ -0,0 +1,102 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/fragmenter.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+const uint32_t kTimeScale = 48000;
+const int64_t kSampleDuration = 1024;
+const size_t kNumSamples = 20;
+// AAC-LC, 48 kHz, stereo.
+const uint8_t kAacCodecConfig[] = {0x11, 0x90};
+
+std::shared_ptr<StreamInfo> GetAacStreamInfo() {
+  return std::make_shared<AudioStreamInfo>(
+      1 /* track_id */, kTimeScale, 0 /* duration */, kCodecAAC, "mp4a.40.2",
+      kAacCodecConfig, sizeof(kAacCodecConfig), 16 /* sample_bits */,
+      2 /* num_channels */, 48000 /* sampling_frequency */,
+      0 /* seek_preroll_ns */, 0 /* codec_delay_ns */, 0 /* max_bitrate */,
+      0 /* avg_bitrate */, "eng", false /* is_encrypted */);
+}
+
+// Audio frames of varying sizes, so the sample size table is not optimized.
+std::vector<std::shared_ptr<const MediaSample>> GetSamples() {
+  std::vector<std::shared_ptr<const MediaSample>> samples;
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    const std::vector<uint8_t> data(100 + i * 7, static_cast<uint8_t>(i));
+    std::shared_ptr<MediaSample> sample =
+        MediaSample::CopyFrom(data.data(), data.size(), true /* is_key_frame */);
+    sample->set_dts(i * kSampleDuration);
+    sample->set_pts(i * kSampleDuration);
+    sample->set_duration(kSampleDuration);
+    samples.push_back(sample);
+  }
+  return samples;
+}
+
+std::vector<uint8_t> Serialize(TrackFragment* traf, BufferWriter* data) {
+  BufferWriter writer;
+  traf->Write(&writer);
+  writer.AppendBuffer(*data);
+  return std::vector<uint8_t>(writer.Buffer(), writer.Buffer() + writer.Size());
+}
+
+}  // namespace
+
+TEST(FragmenterTest, AddSamplesMatchesAddSample) {
+  const std::vector<std::shared_ptr<const MediaSample>> samples = GetSamples();
+
+  TrackFragment traf;
+  Fragmenter fragmenter(GetAacStreamInfo(), &traf, 0 /* edit_list_offset */);
+  for (const auto& sample : samples)
+    ASSERT_OK(fragmenter.AddSample(*sample));
+  ASSERT_OK(fragmenter.FinalizeFragment());
+
+  TrackFragment batched_traf;
+  Fragmenter batched_fragmenter(GetAacStreamInfo(), &batched_traf,
+                                0 /* edit_list_offset */);
+  // In two batches, as the batches of a fragment cut by a subsegment.
+  ASSERT_OK(batched_fragmenter.AddSamples(std::vector<
+      std::shared_ptr<const MediaSample>>(samples.begin(),
+                                          samples.begin() + 5)));
+  ASSERT_OK(batched_fragmenter.AddSamples(std::vector<
+      std::shared_ptr<const MediaSample>>(samples.begin() + 5, samples.end())));
+  ASSERT_OK(batched_fragmenter.FinalizeFragment());
+
+  EXPECT_EQ(kNumSamples, batched_traf.runs[0].sample_count);
+  EXPECT_EQ(fragmenter.fragment_duration(),
+            batched_fragmenter.fragment_duration());
+  EXPECT_EQ(fragmenter.earliest_presentation_time(),
+            batched_fragmenter.earliest_presentation_time());
+  EXPECT_EQ(Serialize(&traf, fragmenter.data()),
+            Serialize(&batched_traf, batched_fragmenter.data()));
+}
+
+TEST(FragmenterTest, AddNoSamples) {
+  TrackFragment traf;
+  Fragmenter fragmenter(GetAacStreamInfo(), &traf, 0 /* edit_list_offset */);
+  ASSERT_OK(fragmenter.AddSamples({}));
+  EXPECT_FALSE(fragmenter.fragment_initialized());
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
@@ -62,7 +62,9 @@
         'chunk_info_iterator_unittest.cc',
         'composition_offset_iterator_unittest.cc',
         'decoding_time_iterator_unittest.cc',
+        'fragmenter_unittest.cc',
         'mp4_media_parser_unittest.cc',
+        'multi_segment_segmenter_unittest.cc',
         'sync_sample_iterator_unittest.cc',
         'track_run_iterator_unittest.cc',
       ],
@@ -71,6 +73,8 @@
         '../../../testing/gtest.gyp:gtest',
         '../../../testing/gmock.gyp:gmock',
         '../../../third_party/gflags/gflags.gyp:gflags',
+        '../../base/media_base.gyp:media_handler_test_base',
+        '../../event/media_event.gyp:mock_muxer_listener',
         '../../test/media_test.gyp:media_test_support',
         'mp4',
       ]
@@ -19,6 +19,7 @@
 #include "packager/media/base/macros.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/rcheck.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/base/video_util.h"
 #include "packager/media/codecs/ac3_audio_util.h"
@@ -168,6 +169,20 @@ bool UpdateCodecStringForDolbyVision(
 
 const uint64_t kNanosecondsPerSecond = 1000000000ull;
 
+// Read |size| bytes at |offset| of |file| into |buffer|.
+bool ReadAt(File* file, uint64_t offset, uint64_t size, uint8_t* buffer) {
+  if (!file->Seek(offset))
+    return false;
+  while (size > 0) {
+    const int64_t bytes_read = file->Read(buffer, size);
+    if (bytes_read <= 0)
+      return false;
+    buffer += bytes_read;
+    size -= bytes_read;
+  }
+  return true;
+}
+
 }  // namespace
 
 MP4MediaParser::MP4MediaParser()
@@ -191,7 +206,7 @@ void MP4MediaParser::Init(const InitCB& init_cb,
   init_cb_ = init_cb;
   new_sample_cb_ = new_media_sample_cb;
   decryption_key_source_ = decryption_key_source;
-  if (decryption_key_source)
+  if (decryption_key_source && !defer_decryption_)
     decryptor_source_.reset(new DecryptorSource(decryption_key_source));
 }
 
@@ -243,6 +258,21 @@ bool MP4MediaParser::Parse(const uint8_t* buf, int size) {
   return true;
 }
 
+bool MP4MediaParser::ParseChunk(std::shared_ptr<const uint8_t> chunk,
+                                int size) {
+  current_chunk_head_ = queue_.tail();
+  current_chunk_tail_ = current_chunk_head_ + size;
+  current_chunk_ = chunk;
+  const bool result = Parse(chunk.get(), size);
+  // Samples emitted from |chunk| hold their own references.
+  current_chunk_.reset();
+  return result;
+}
+
+void MP4MediaParser::DisableTrack(uint32_t track_id) {
+  disabled_tracks_.insert(track_id);
+}
+
 bool MP4MediaParser::LoadMoov(const std::string& file_path) {
   std::unique_ptr<File, FileCloser> file(
       File::OpenWithNoBuffering(file_path.c_str(), "r"));
@@ -318,6 +348,190 @@ bool MP4MediaParser::LoadMoov(const std::string& file_path) {
   return true;
 }
 
+bool MP4MediaParser::ParseMappedFile(std::shared_ptr<const uint8_t> data,
+                                     uint64_t size) {
+  DCHECK_EQ(state_, kParsingBoxes);
+  DCHECK(data);
+
+  // Parse 'moov' first, wherever it is, so 'mdat' boxes before it do not need
+  // to be skipped over or read.
+  uint64_t position = 0;
+  while (position < size && !moov_) {
+    FourCC box_type;
+    uint64_t box_size = 0;
+    bool err = false;
+    if (!BoxReader::StartBox(data.get() + position, size - position, &box_type,
+                             &box_size, &err) ||
+        box_size == 0) {
+      LOG(ERROR) << "Could not find 'moov' box.";
+      return false;
+    }
+    if (box_type == FOURCC_moov) {
+      std::unique_ptr<BoxReader> reader(
+          BoxReader::ReadBox(data.get() + position, size - position, &err));
+      RCHECK(reader && ParseMoov(reader.get()));
+    }
+    position += box_size;
+  }
+  RCHECK(moov_);
+
+  // Samples described in 'moov', i.e. non-fragmented files.
+  RCHECK(EmitMappedSamples(data, size));
+
+  // Samples described in 'moof' boxes, if any.
+  position = 0;
+  while (position < size) {
+    FourCC box_type;
+    uint64_t box_size = 0;
+    bool err = false;
+    if (!BoxReader::StartBox(data.get() + position, size - position, &box_type,
+                             &box_size, &err) ||
+        box_size == 0) {
+      // Ignore a truncated last box, as when reading the file progressively.
+      break;
+    }
+    if (box_type == FOURCC_moof) {
+      std::unique_ptr<BoxReader> reader(
+          BoxReader::ReadBox(data.get() + position, size - position, &err));
+      moof_head_ = position;
+      RCHECK(reader && ParseMoof(reader.get()));
+      RCHECK(EmitMappedSamples(data, size));
+    }
+    position += box_size;
+  }
+  ChangeState(kParsingBoxes);
+  return true;
+}
+
+bool MP4MediaParser::ParseWithPositionalReads(const std::string& file_path,
+                                              bool* all_samples_parsed) {
+  DCHECK_EQ(state_, kParsingBoxes);
+  DCHECK(all_samples_parsed);
+  *all_samples_parsed = false;
+
+  std::unique_ptr<File, FileCloser> file(
+      File::OpenWithNoBuffering(file_path.c_str(), "r"));
+  if (!file) {
+    LOG(ERROR) << "Unable to open media file '" << file_path << "'";
+    return false;
+  }
+  const int64_t file_size = file->Size();
+  if (file_size <= 0) {
+    LOG(ERROR) << "Unable to get the size of media file '" << file_path << "'";
+    return false;
+  }
+
+  // Locate and parse 'moov' by reading box headers only.
+  uint64_t file_position = 0;
+  while (!moov_) {
+    const uint64_t kBoxHeaderReadSize = 16;
+    if (file_position >= static_cast<uint64_t>(file_size)) {
+      LOG(ERROR) << "Could not find 'moov' box in file '" << file_path << "'";
+      return false;
+    }
+    uint8_t header[kBoxHeaderReadSize];
+    const uint64_t header_size = std::min(
+        kBoxHeaderReadSize, static_cast<uint64_t>(file_size) - file_position);
+    FourCC box_type;
+    uint64_t box_size = 0;
+    bool err = false;
+    if (!ReadAt(file.get(), file_position, header_size, header) ||
+        !BoxReader::StartBox(header, header_size, &box_type, &box_size,
+                             &err) ||
+        box_size == 0) {
+      LOG(ERROR) << "Could not start box from file '" << file_path << "'";
+      return false;
+    }
+    if (box_type == FOURCC_moov) {
+      std::vector<uint8_t> moov_data(box_size);
+      if (!ReadAt(file.get(), file_position, box_size, moov_data.data())) {
+        LOG(ERROR) << "Error reading 'moov' contents from file '" << file_path
+                   << "'";
+        return false;
+      }
+      std::unique_ptr<BoxReader> reader(
+          BoxReader::ReadBox(moov_data.data(), moov_data.size(), &err));
+      RCHECK(reader && ParseMoov(reader.get()));
+    }
+    file_position += box_size;
+  }
+
+  if (!moov_->extends.tracks.empty()) {
+    // Fragmented file. The samples are described by the 'moof' boxes, which
+    // are parsed by reading the file sequentially.
+    queue_.Reset();  // So that we don't need to adjust data offsets.
+    mdat_tail_ = 0;  // So it will skip boxes until mdat.
+    return true;
+  }
+
+  // Read one chunk at a time, in decoding time order across the tracks, so
+  // only the chunks being emitted are in memory.
+  runs_->SortRunsByStartTime();
+  while (runs_->IsRunValid()) {
+    if (!runs_->IsSampleValid() || (!runs_->is_audio() && !runs_->is_video())) {
+      runs_->AdvanceRun();
+      continue;
+    }
+    if (runs_->AuxInfoNeedsToBeCached()) {
+      std::vector<uint8_t> aux_info(runs_->aux_info_size());
+      RCHECK(ReadAt(file.get(), runs_->aux_info_offset(), aux_info.size(),
+                    aux_info.data()));
+      RCHECK(runs_->CacheAuxInfo(aux_info.data(), aux_info.size()));
+      continue;
+    }
+    const int64_t chunk_offset = runs_->run_data_offset();
+    const int64_t chunk_size = runs_->run_data_size();
+    if (chunk_offset < 0 || chunk_offset + chunk_size > file_size) {
+      LOG(ERROR) << "Chunk at offset " << chunk_offset
+                 << " is beyond the end of the file.";
+      return false;
+    }
+    std::shared_ptr<uint8_t> chunk = SampleBufferPool::Allocate(chunk_size);
+    if (!ReadAt(file.get(), chunk_offset, chunk_size, chunk.get())) {
+      LOG(ERROR) << "Error reading chunk at offset " << chunk_offset
+                 << " from file '" << file_path << "'";
+      return false;
+    }
+    while (runs_->IsSampleValid()) {
+      RCHECK(EmitSample(chunk.get() + (runs_->sample_offset() - chunk_offset),
+                        chunk));
+    }
+    runs_->AdvanceRun();
+  }
+  *all_samples_parsed = true;
+  ChangeState(kParsingBoxes);
+  return true;
+}
+
+bool MP4MediaParser::EmitMappedSamples(
+    const std::shared_ptr<const uint8_t>& data,
+    uint64_t size) {
+  while (runs_->IsRunValid()) {
+    if (!runs_->IsSampleValid() || (!runs_->is_audio() && !runs_->is_video())) {
+      runs_->AdvanceRun();
+      continue;
+    }
+    if (runs_->AuxInfoNeedsToBeCached()) {
+      const int64_t aux_info_offset = runs_->aux_info_offset() + moof_head_;
+      RCHECK(aux_info_offset >= 0 &&
+             aux_info_offset + runs_->aux_info_size() <=
+                 static_cast<int64_t>(size));
+      RCHECK(runs_->CacheAuxInfo(data.get() + aux_info_offset,
+                                 runs_->aux_info_size()));
+      continue;
+    }
+    const int64_t sample_offset = runs_->sample_offset() + moof_head_;
+    if (sample_offset < 0 ||
+        sample_offset + runs_->sample_size() > static_cast<int64_t>(size)) {
+      LOG(ERROR) << "Sample at offset " << sample_offset
+                 << " is beyond the end of the file.";
+      return false;
+    }
+    RCHECK(EmitSample(data.get() + sample_offset, data));
+  }
+  return true;
+}
+
 bool MP4MediaParser::ParseBox(bool* err) {
   const uint8_t* buf;
   int size;
@@ -374,7 +588,10 @@ bool MP4MediaParser::ParseMoov(BoxReader* reader) {
   if (moov_)
     return true;  // Already parsed the 'moov' box.
 
+  // The sample tables are parsed after |init_cb_|, which may disable tracks,
+  // as they are usually the bulk of 'moov'.
   moov_.reset(new Movie);
+  reader->set_defer_sample_tables(true);
   RCHECK(moov_->Parse(reader));
   runs_.reset();
 
@@ -725,6 +942,10 @@ bool MP4MediaParser::ParseMoov(BoxReader* reader) {
   }
 
   init_cb_.Run(streams);
+  for (Track& track : moov_->tracks) {
+    if (disabled_tracks_.count(track.header.track_id) == 0)
+      RCHECK(track.media.information.sample_table.ParseDeferredTables());
+  }
   if (!FetchKeysIfNecessary(moov_->pssh))
     return false;
   runs_.reset(new TrackRunIterator(moov_.get()));
@@ -825,6 +1046,18 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
   }
 
   const uint8_t* media_data = buf;
+  std::shared_ptr<const uint8_t> owner;
+  if (current_chunk_ && sample_offset >= current_chunk_head_ &&
+      sample_offset + runs_->sample_size() <= current_chunk_tail_) {
+    media_data = current_chunk_.get() + (sample_offset - current_chunk_head_);
+    owner = current_chunk_;
+  }
+  *err = !EmitSample(media_data, std::move(owner));
+  return !*err;
+}
+
+bool MP4MediaParser::EmitSample(const uint8_t* media_data,
+                                std::shared_ptr<const uint8_t> owner) {
   const size_t media_data_size = runs_->sample_size();
   // Use a dummy data size of 0 to avoid copying overhead.
   // Actual media data is set later.
@@ -833,11 +1066,8 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
       MediaSample::CopyFrom(media_data, kDummyDataSize, runs_->is_keyframe()));
 
   if (runs_->is_encrypted()) {
-    std::shared_ptr<uint8_t> decrypted_media_data(
-        new uint8_t[media_data_size], std::default_delete<uint8_t[]>());
     std::unique_ptr<DecryptConfig> decrypt_config = runs_->GetDecryptConfig();
     if (!decrypt_config) {
-      *err = true;
       LOG(ERROR) << "Missing decrypt config.";
       return false;
     }
@@ -849,16 +1079,19 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
       stream_sample->set_decrypt_config(std::move(decrypt_config));
       stream_sample->set_is_encrypted(true);
     } else {
+      std::shared_ptr<uint8_t> decrypted_media_data =
+          SampleBufferPool::Allocate(media_data_size);
       if (!decryptor_source_->DecryptSampleBuffer(decrypt_config.get(),
                                                   media_data, media_data_size,
                                                   decrypted_media_data.get())) {
-        *err = true;
         LOG(ERROR) << "Cannot decrypt samples.";
         return false;
       }
       stream_sample->TransferData(std::move(decrypted_media_data),
                                   media_data_size);
     }
+  } else if (owner) {
+    stream_sample->ShareData(std::move(owner), media_data, media_data_size);
   } else {
     stream_sample->SetData(media_data, media_data_size);
   }
@@ -875,7 +1108,6 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
            << ", size=" << runs_->sample_size();
 
   if (!new_sample_cb_.Run(runs_->track_id(), stream_sample)) {
-    *err = true;
     LOG(ERROR) << "Failed to process the sample.";
     return false;
   }
@@ -11,6 +11,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <vector>
 
 #include "packager/base/callback_forward.h"
@@ -40,6 +41,9 @@ class MP4MediaParser : public MediaParser {
             KeySource* decryption_key_source) override;
   bool Flush() override WARN_UNUSED_RESULT;
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  bool ParseChunk(std::shared_ptr<const uint8_t> chunk,
+                  int size) override WARN_UNUSED_RESULT;
+  void DisableTrack(uint32_t track_id) override;
   /// @}
 
   /// Handles ISO-BMFF containers which have the 'moov' box trailing the
@@ -50,6 +54,37 @@ class MP4MediaParser : public MediaParser {
   /// @return true if successful, false otherwise.
   bool LoadMoov(const std::string& file_path);
 
+  /// Parse a whole ISO-BMFF file which is in memory, e.g. memory mapped. The
+  /// 'moov' box is parsed directly wherever it is in the file and the samples
+  /// are emitted referencing @a data, without copying nor buffering.
+  /// @param data is the content of the file.
+  /// @param size is the size of the file.
+  /// @return true if successful, false otherwise.
+  bool ParseMappedFile(std::shared_ptr<const uint8_t> data,
+                       uint64_t size) WARN_UNUSED_RESULT;
+
+  /// Parse a seekable ISO-BMFF file with positional reads. For non-fragmented
+  /// files, the sample tables in 'moov' are used to read the chunks one by
+  /// one, in decoding time order across the tracks, so the memory usage is
+  /// bounded by the chunk size regardless of how the tracks are interleaved
+  /// in the file. Fragmented files are left to be parsed with Parse() after
+  /// the 'moov' box is parsed.
+  /// @param file_path is the path to the media file to be parsed.
+  /// @param[out] all_samples_parsed is set to true if all the samples have
+  ///             been emitted, or false if the rest of the file should be
+  ///             passed to Parse() from the beginning.
+  /// @return true if successful, false otherwise.
+  bool ParseWithPositionalReads(const std::string& file_path,
+                                bool* all_samples_parsed) WARN_UNUSED_RESULT;
+
+  /// Emit the encrypted samples with their decrypt config instead of
+  /// decrypting them, even if there is a decryption key source, e.g. for the
+  /// caller to decrypt them in parallel. The keys are still fetched from the
+  /// key source. Must be called before Init().
+  void set_defer_decryption(bool defer_decryption) {
+    defer_decryption_ = defer_decryption;
+  }
+
  private:
   enum State {
     kWaitingForInit,
@@ -78,6 +113,13 @@ class MP4MediaParser : public MediaParser {
   bool EmitConfigs();
 
   bool EnqueueSample(bool* err);
+  // Emit the current sample of |runs_|, which is at |media_data|. The sample
+  // references |owner| instead of copying the data if it is not null.
+  bool EmitSample(const uint8_t* media_data,
+                  std::shared_ptr<const uint8_t> owner);
+  // Emit the samples of |runs_| from the file content |data|.
+  bool EmitMappedSamples(const std::shared_ptr<const uint8_t>& data,
+                         uint64_t size);
 
   void Reset();
 
@@ -86,9 +128,16 @@ class MP4MediaParser : public MediaParser {
   NewMediaSampleCB new_sample_cb_;
   KeySource* decryption_key_source_;
   std::unique_ptr<DecryptorSource> decryptor_source_;
+  bool defer_decryption_ = false;
 
   OffsetByteQueue queue_;
 
+  // The chunk being parsed in ParseChunk() and its stream offset. Samples
+  // fully contained in it are emitted as views into it instead of copies.
+  std::shared_ptr<const uint8_t> current_chunk_;
+  int64_t current_chunk_head_ = 0;
+  int64_t current_chunk_tail_ = 0;
+
   // These two parameters are only valid in the |kEmittingSegments| state.
   //
   // |moof_head_| is the offset of the start of the most recently parsed moof
@@ -102,6 +151,10 @@ class MP4MediaParser : public MediaParser {
   std::unique_ptr<Movie> moov_;
   std::unique_ptr<TrackRunIterator> runs_;
 
+  // The tracks disabled with DisableTrack(). The sample tables of the tracks
+  // disabled when |init_cb_| is invoked are not parsed.
+  std::set<uint32_t> disabled_tracks_;
+
   DISALLOW_COPY_AND_ASSIGN(MP4MediaParser);
 };
 
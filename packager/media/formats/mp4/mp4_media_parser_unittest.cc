@@ -53,6 +53,12 @@ class MP4MediaParserTest : public testing::Test {
   std::unique_ptr<MP4MediaParser> parser_;
   size_t num_streams_;
   size_t num_samples_;
+  // Range of the chunk being parsed in AppendChunk().
+  const uint8_t* chunk_begin_ = nullptr;
+  const uint8_t* chunk_end_ = nullptr;
+  size_t num_shared_samples_ = 0;
+  // Whether the video tracks are disabled when the parser is initialized.
+  bool disable_video_ = false;
 
   bool AppendData(const uint8_t* data, size_t length) {
     return parser_->Parse(data, static_cast<int>(length));
@@ -73,10 +79,38 @@ class MP4MediaParserTest : public testing::Test {
     return true;
   }
 
+  bool AppendChunk(const uint8_t* data, size_t length) {
+    std::shared_ptr<uint8_t> chunk(new uint8_t[length],
+                                   std::default_delete<uint8_t[]>());
+    memcpy(chunk.get(), data, length);
+    chunk_begin_ = chunk.get();
+    chunk_end_ = chunk.get() + length;
+    const bool result =
+        parser_->ParseChunk(std::move(chunk), static_cast<int>(length));
+    chunk_begin_ = chunk_end_ = nullptr;
+    return result;
+  }
+
+  bool ParseMappedFile(const std::string& filename) {
+    InitializeParser(NULL);
+    std::vector<uint8_t> buffer = ReadTestDataFile(filename);
+    std::shared_ptr<uint8_t> data(new uint8_t[buffer.size()],
+                                  std::default_delete<uint8_t[]>());
+    memcpy(data.get(), buffer.data(), buffer.size());
+    chunk_begin_ = data.get();
+    chunk_end_ = data.get() + buffer.size();
+    const bool result =
+        parser_->ParseMappedFile(std::move(data), buffer.size());
+    chunk_begin_ = chunk_end_ = nullptr;
+    return result;
+  }
+
   void InitF(const std::vector<std::shared_ptr<StreamInfo>>& streams) {
     for (const auto& stream_info : streams) {
       DVLOG(2) << stream_info->ToString();
       stream_map_[stream_info->track_id()] = stream_info;
+      if (disable_video_ && stream_info->stream_type() == kStreamVideo)
+        parser_->DisableTrack(stream_info->track_id());
     }
     num_streams_ = streams.size();
     num_samples_ = 0;
@@ -86,6 +120,10 @@ class MP4MediaParserTest : public testing::Test {
     DVLOG(2) << "Track Id: " << track_id << " "
              << sample->ToString();
     ++num_samples_;
+    if (sample->data() >= chunk_begin_ &&
+        sample->data() + sample->data_size() <= chunk_end_) {
+      ++num_shared_samples_;
+    }
     return true;
   }
 
@@ -171,6 +209,87 @@ TEST_F(MP4MediaParserTest,
                 ->pixel_height());
 }
 
+TEST_F(MP4MediaParserTest, ZeroCopyChunkAppend) {
+  InitializeParser(NULL);
+  std::vector<uint8_t> buffer = ReadTestDataFile("bear-640x360-av_frag.mp4");
+  EXPECT_TRUE(AppendChunk(buffer.data(), buffer.size()));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+  // Every sample is contained in the single chunk.
+  EXPECT_EQ(201u, num_shared_samples_);
+}
+
+TEST_F(MP4MediaParserTest, ZeroCopyChunkAppendInPieces) {
+  InitializeParser(NULL);
+  std::vector<uint8_t> buffer = ReadTestDataFile("bear-640x360-av_frag.mp4");
+  const size_t kChunkSize = 4096;
+  for (size_t pos = 0; pos < buffer.size(); pos += kChunkSize) {
+    ASSERT_TRUE(AppendChunk(buffer.data() + pos,
+                            std::min(kChunkSize, buffer.size() - pos)));
+  }
+  // Samples spanning chunks are copied.
+  EXPECT_EQ(201u, num_samples_);
+  EXPECT_LT(num_shared_samples_, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, ParseWithPositionalReads) {
+  InitializeParser(NULL);
+  bool all_samples_parsed = false;
+  EXPECT_TRUE(parser_->ParseWithPositionalReads(
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe(),
+      &all_samples_parsed));
+  EXPECT_TRUE(all_samples_parsed);
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, ParseWithPositionalReadsTrailingMoov) {
+  InitializeParser(NULL);
+  bool all_samples_parsed = false;
+  EXPECT_TRUE(parser_->ParseWithPositionalReads(
+      GetTestDataFilePath("bear-640x360-trailing-moov.mp4").AsUTF8Unsafe(),
+      &all_samples_parsed));
+  EXPECT_TRUE(all_samples_parsed);
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, ParseWithPositionalReadsFragmentedFile) {
+  InitializeParser(NULL);
+  bool all_samples_parsed = true;
+  EXPECT_TRUE(parser_->ParseWithPositionalReads(
+      GetTestDataFilePath("bear-640x360-av_frag.mp4").AsUTF8Unsafe(),
+      &all_samples_parsed));
+  EXPECT_FALSE(all_samples_parsed);
+  EXPECT_EQ(2u, num_streams_);
+
+  // The rest of the file is parsed sequentially.
+  std::vector<uint8_t> buffer = ReadTestDataFile("bear-640x360-av_frag.mp4");
+  EXPECT_TRUE(AppendDataInPieces(buffer.data(), buffer.size(), 512));
+  EXPECT_EQ(201u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, MappedFile) {
+  EXPECT_TRUE(ParseMappedFile("bear-640x360.mp4"));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+  EXPECT_EQ(201u, num_shared_samples_);
+}
+
+TEST_F(MP4MediaParserTest, MappedFileWithTrailingMoov) {
+  EXPECT_TRUE(ParseMappedFile("bear-640x360-trailing-moov.mp4"));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+  EXPECT_EQ(201u, num_shared_samples_);
+}
+
+TEST_F(MP4MediaParserTest, MappedFragmentedFile) {
+  EXPECT_TRUE(ParseMappedFile("bear-640x360-av_frag.mp4"));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+  EXPECT_EQ(201u, num_shared_samples_);
+}
+
 TEST_F(MP4MediaParserTest, BytewiseAppend) {
   // Ensure no incremental errors occur when parsing
   EXPECT_TRUE(ParseMP4File("bear-640x360-av_frag.mp4", 1));
@@ -178,6 +297,22 @@ TEST_F(MP4MediaParserTest, BytewiseAppend) {
   EXPECT_EQ(201u, num_samples_);
 }
 
+// The samples are emitted as soon as their data is appended, e.g. for a live
+// low latency CMAF input, not once the whole 'mdat' is.
+TEST_F(MP4MediaParserTest, SamplesEmittedBeforeEndOfMdat) {
+  InitializeParser(NULL);
+  std::vector<uint8_t> buffer = ReadTestDataFile("bear-640x360-av_frag.mp4");
+  // The video run of the last fragment ends here, followed by an audio run of
+  // 10 samples which ends the last 'mdat'.
+  const size_t kEndOfLastVideoRun = 200831;
+  ASSERT_LT(kEndOfLastVideoRun, buffer.size());
+  EXPECT_TRUE(AppendDataInPieces(buffer.data(), kEndOfLastVideoRun, 512));
+  EXPECT_EQ(191u, num_samples_);
+  EXPECT_TRUE(AppendDataInPieces(buffer.data() + kEndOfLastVideoRun,
+                                 buffer.size() - kEndOfLastVideoRun, 512));
+  EXPECT_EQ(201u, num_samples_);
+}
+
 TEST_F(MP4MediaParserTest, MultiFragmentAppend) {
   // Large size ensures multiple fragments are appended in one call (size is
   // larger than this particular test file)
@@ -240,6 +375,26 @@ TEST_F(MP4MediaParserTest, NON_FRAGMENTED_MP4) {
   EXPECT_EQ(201u, num_samples_);
 }
 
+TEST_F(MP4MediaParserTest, NonFragmentedMp4WithDisabledTrack) {
+  disable_video_ = true;
+  EXPECT_TRUE(ParseMP4File("bear-640x360.mp4", 512));
+  EXPECT_EQ(2u, num_streams_);
+  // Only the audio samples.
+  EXPECT_EQ(119u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, ParseWithPositionalReadsWithDisabledTrack) {
+  disable_video_ = true;
+  InitializeParser(NULL);
+  bool all_samples_parsed = false;
+  EXPECT_TRUE(parser_->ParseWithPositionalReads(
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe(),
+      &all_samples_parsed));
+  EXPECT_TRUE(all_samples_parsed);
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(119u, num_samples_);
+}
+
 TEST_F(MP4MediaParserTest, CencWithoutDecryptionSource) {
   EXPECT_TRUE(ParseMP4File("bear-640x360-v_frag-cenc-aux.mp4", 512));
   EXPECT_EQ(1u, num_streams_);
@@ -172,6 +172,9 @@ Status MP4Muxer::Finalize() {
     return Status::OK;
   }
 
+  for (size_t i = 0; i < pending_audio_samples_.size(); ++i)
+    RETURN_IF_ERROR(AddPendingAudioSamples(i));
+
   Status segmenter_finalized = segmenter_->Finalize();
 
   if (!segmenter_finalized.ok())
@@ -192,15 +195,47 @@ Status MP4Muxer::AddMediaSample(size_t stream_id, const MediaSample& sample) {
   return segmenter_->AddSample(stream_id, sample);
 }
 
+Status MP4Muxer::AddSharedMediaSample(
+    size_t stream_id,
+    std::shared_ptr<const MediaSample> sample) {
+  if (streams()[stream_id]->stream_type() != kStreamAudio)
+    return AddMediaSample(stream_id, *sample);
+
+  if (to_be_initialized_) {
+    RETURN_IF_ERROR(UpdateEditListOffsetFromSample(*sample));
+    RETURN_IF_ERROR(DelayInitializeMuxer());
+    to_be_initialized_ = false;
+  }
+  if (pending_audio_samples_.size() <= stream_id)
+    pending_audio_samples_.resize(streams().size());
+  pending_audio_samples_[stream_id].push_back(std::move(sample));
+  return Status::OK;
+}
+
 Status MP4Muxer::FinalizeSegment(size_t stream_id,
                                  const SegmentInfo& segment_info) {
   DCHECK(segmenter_);
   VLOG(3) << "Finalizing " << (segment_info.is_subsegment ? "sub" : "")
           << "segment " << segment_info.start_timestamp << " duration "
           << segment_info.duration;
+  RETURN_IF_ERROR(AddPendingAudioSamples(stream_id));
   return segmenter_->FinalizeSegment(stream_id, segment_info);
 }
 
+Status MP4Muxer::AddPendingAudioSamples(size_t stream_id) {
+  if (stream_id >= pending_audio_samples_.size() ||
+      pending_audio_samples_[stream_id].empty()) {
+    return Status::OK;
+  }
+  DCHECK(segmenter_);
+  // Clearing keeps the capacity for the next fragment.
+  std::vector<std::shared_ptr<const MediaSample>>& samples =
+      pending_audio_samples_[stream_id];
+  Status status = segmenter_->AddSamples(stream_id, samples);
+  samples.clear();
+  return status;
+}
+
 Status MP4Muxer::DelayInitializeMuxer() {
   DCHECK(!streams().empty());
 
@@ -648,6 +683,16 @@ void MP4Muxer::FireOnMediaStartEvent() {
   DCHECK(!streams().empty()) << "Media started without a stream.";
 
   const uint32_t timescale = segmenter_->GetReferenceTimeScale();
+  const std::string stored_init_segment_name =
+      segmenter_->GetStoredInitSegmentName();
+  if (!stored_init_segment_name.empty()) {
+    // The manifests reference the init segment in the store.
+    MuxerOptions muxer_options = options();
+    muxer_options.output_file_name = stored_init_segment_name;
+    muxer_listener()->OnMediaStart(muxer_options, *streams().front(),
+                                   timescale, MuxerListener::kContainerMp4);
+    return;
+  }
   muxer_listener()->OnMediaStart(options(), *streams().front(), timescale,
                                  MuxerListener::kContainerMp4);
 }
@@ -666,6 +711,12 @@ void MP4Muxer::FireOnMediaEndEvent() {
 }
 
 uint64_t MP4Muxer::IsoTimeNow() {
+  // The init segments in the store are shared across jobs, so they do not
+  // carry the time they were generated.
+  if (!options().segment_template.empty() &&
+      !options().mp4_params.init_segment_store.empty()) {
+    return 0;
+  }
   // Time in seconds from Jan. 1, 1904 to epoch time, i.e. Jan. 1, 1970.
   const uint64_t kIsomTimeOffset = 2082844800l;
   return kIsomTimeOffset +
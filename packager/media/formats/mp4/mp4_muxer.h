@@ -40,10 +40,15 @@ class MP4Muxer : public Muxer {
   Status InitializeMuxer() override;
   Status Finalize() override;
   Status AddMediaSample(size_t stream_id, const MediaSample& sample) override;
+  Status AddSharedMediaSample(
+      size_t stream_id,
+      std::shared_ptr<const MediaSample> sample) override;
   Status FinalizeSegment(size_t stream_id,
                          const SegmentInfo& segment_info) override;
 
   Status DelayInitializeMuxer();
+  // Add the audio samples held for |stream_id| to the segmenter.
+  Status AddPendingAudioSamples(size_t stream_id);
   Status UpdateEditListOffsetFromSample(const MediaSample& sample);
 
   // Generate Audio/Video Track box.
@@ -72,6 +77,11 @@ class MP4Muxer : public Muxer {
   base::Optional<int64_t> edit_list_offset_;
 
   std::unique_ptr<Segmenter> segmenter_;
+  // The audio samples of the current fragment, per stream, added to the
+  // segmenter in one batch when the fragment ends. Audio frames are short and
+  // many, so the per-sample bookkeeping is amortized over the batch.
+  std::vector<std::vector<std::shared_ptr<const MediaSample>>>
+      pending_audio_samples_;
 
   DISALLOW_COPY_AND_ASSIGN(MP4Muxer);
 };
@@ -12,7 +12,9 @@
 #include "packager/base/strings/string_util.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/media/base/buffer_chain.h"
 #include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/init_segment_store.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/media/event/muxer_listener.h"
@@ -29,7 +31,7 @@ MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options,
                                              std::unique_ptr<Movie> moov)
     : Segmenter(options, std::move(ftyp), std::move(moov)),
       styp_(new SegmentType),
-      num_segments_(0) {
+      segment_indexer_(options) {
   // Use the same brands for styp as ftyp.
   styp_->major_brand = Segmenter::ftyp()->major_brand;
   styp_->compatible_brands = Segmenter::ftyp()->compatible_brands;
@@ -56,24 +58,73 @@ std::vector<Range> MultiSegmentSegmenter::GetSegmentRanges() {
   return std::vector<Range>();
 }
 
+std::string MultiSegmentSegmenter::GetStoredInitSegmentName() const {
+  return stored_init_segment_name_;
+}
+
 Status MultiSegmentSegmenter::DoInitialize() {
-  return WriteInitSegment();
+  if (options().mp4_params.low_latency_chunked_output &&
+      options().mp4_params.generate_sidx_in_media_segments) {
+    LOG(WARNING) << "'sidx' is not generated in media segments with low "
+                    "latency chunked output.";
+  }
+  RETURN_IF_ERROR(WriteInitSegment());
+  PrepareNextSegmentFile();
+  return Status::OK;
 }
 
 Status MultiSegmentSegmenter::DoFinalize() {
   // Update init segment with media duration set.
   RETURN_IF_ERROR(WriteInitSegment());
+  if (num_chunks_ > 0) {
+    LOG(INFO) << "Wrote " << num_chunks_ << " low latency chunks for '"
+              << options().output_file_name << "'. Chunk write latency: average "
+              << (total_chunk_latency_ / num_chunks_).InMillisecondsF()
+              << " ms, max " << max_chunk_latency_.InMillisecondsF() << " ms.";
+  }
   SetComplete();
   return Status::OK;
 }
 
 Status MultiSegmentSegmenter::DoFinalizeSegment() {
-  return WriteSegment();
+  if (!options().mp4_params.low_latency_chunked_output)
+    return WriteSegment();
+
+  // All the fragments have been written already.
+  DCHECK(segment_file_);
+  DCHECK_EQ(fragment_buffer()->Size(), 0u);
+  num_key_frames_reported_ = 0;
+  const uint64_t segment_size = segment_bytes_written_;
+  segment_bytes_written_ = 0;
+  return CloseSegmentFile(std::move(segment_file_), segment_file_name_,
+                          segment_size);
+}
+
+Status MultiSegmentSegmenter::DoFinalizeFragment() {
+  if (!options().mp4_params.low_latency_chunked_output)
+    return Status::OK;
+  return WriteChunk();
 }
 
 Status MultiSegmentSegmenter::WriteInitSegment() {
   DCHECK(ftyp());
   DCHECK(moov());
+  const std::string& init_segment_store =
+      options().mp4_params.init_segment_store;
+  // The stored init segment may be shared with other outputs, so it is not
+  // updated with the media duration in the end.
+  if (!init_segment_store.empty() && !stored_init_segment_name_.empty())
+    return Status::OK;
+
+  std::unique_ptr<BufferWriter> buffer(new BufferWriter);
+  ftyp()->Write(buffer.get());
+  moov()->Write(buffer.get());
+  if (!init_segment_store.empty()) {
+    return InitSegmentStore(init_segment_store)
+        .Store(buffer->Buffer(), buffer->Size(), "mp4",
+               &stored_init_segment_name_, nullptr);
+  }
+
   // Generate the output file with init segment.
   std::unique_ptr<File, FileCloser> file(
       File::Open(options().output_file_name.c_str(), "w"));
@@ -81,45 +132,17 @@ Status MultiSegmentSegmenter::WriteInitSegment() {
     return Status(error::FILE_FAILURE,
                   "Cannot open file for write " + options().output_file_name);
   }
-  std::unique_ptr<BufferWriter> buffer(new BufferWriter);
-  ftyp()->Write(buffer.get());
-  moov()->Write(buffer.get());
   return buffer->WriteToFile(file.get());
 }
 
 Status MultiSegmentSegmenter::WriteSegment() {
   DCHECK(sidx());
   DCHECK(fragment_buffer());
-  DCHECK(styp_);
-
-  DCHECK(!sidx()->references.empty());
-  // earliest_presentation_time is the earliest presentation time of any access
-  // unit in the reference stream in the first subsegment.
-  sidx()->earliest_presentation_time =
-      sidx()->references[0].earliest_presentation_time;
 
   std::unique_ptr<BufferWriter> buffer(new BufferWriter());
   std::unique_ptr<File, FileCloser> file;
   std::string file_name;
-  if (options().segment_template.empty()) {
-    // Append the segment to output file if segment template is not specified.
-    file_name = options().output_file_name.c_str();
-    file.reset(File::Open(file_name.c_str(), "a"));
-    if (!file) {
-      return Status(error::FILE_FAILURE, "Cannot open file for append " +
-                                             options().output_file_name);
-    }
-  } else {
-    file_name = GetSegmentName(options().segment_template,
-                               sidx()->earliest_presentation_time,
-                               num_segments_++, options().bandwidth);
-    file.reset(File::Open(file_name.c_str(), "w"));
-    if (!file) {
-      return Status(error::FILE_FAILURE,
-                    "Cannot open file for write " + file_name);
-    }
-    styp_->Write(buffer.get());
-  }
+  RETURN_IF_ERROR(OpenSegmentFile(buffer.get(), &file, &file_name));
 
   if (options().mp4_params.generate_sidx_in_media_segments)
     sidx()->Write(buffer.get());
@@ -128,7 +151,6 @@ Status MultiSegmentSegmenter::WriteSegment() {
   const size_t segment_size = segment_header_size + fragment_buffer()->Size();
   DCHECK_NE(segment_size, 0u);
 
-  RETURN_IF_ERROR(buffer->WriteToFile(file.get()));
   if (muxer_listener()) {
     for (const KeyFrameInfo& key_frame_info : key_frame_infos()) {
       muxer_listener()->OnKeyFrame(
@@ -137,8 +159,111 @@ Status MultiSegmentSegmenter::WriteSegment() {
           key_frame_info.size);
     }
   }
+  // Write the segment header and the fragments with a single call.
+  fragment_buffer()->PrependBuffer(std::move(buffer));
   RETURN_IF_ERROR(fragment_buffer()->WriteToFile(file.get()));
 
+  return CloseSegmentFile(std::move(file), file_name, segment_size);
+}
+
+Status MultiSegmentSegmenter::WriteChunk() {
+  DCHECK(sidx());
+  DCHECK(fragment_buffer());
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+
+  std::unique_ptr<BufferWriter> buffer(new BufferWriter());
+  if (!segment_file_) {
+    RETURN_IF_ERROR(
+        OpenSegmentFile(buffer.get(), &segment_file_, &segment_file_name_));
+  }
+  const uint64_t chunk_offset = segment_bytes_written_ + buffer->Size();
+
+  // The key frame offsets are relative to the fragments written since the
+  // last chunk, which starts after the segment header if this is the first
+  // chunk.
+  if (muxer_listener()) {
+    for (size_t i = num_key_frames_reported_; i < key_frame_infos().size();
+         ++i) {
+      const KeyFrameInfo& key_frame_info = key_frame_infos()[i];
+      muxer_listener()->OnKeyFrame(
+          key_frame_info.timestamp,
+          chunk_offset + key_frame_info.start_byte_offset,
+          key_frame_info.size);
+    }
+  }
+  num_key_frames_reported_ = key_frame_infos().size();
+
+  fragment_buffer()->PrependBuffer(std::move(buffer));
+  const uint64_t chunk_size = fragment_buffer()->Size();
+  RETURN_IF_ERROR(fragment_buffer()->WriteToFile(segment_file_.get()));
+  // Push the chunk to the output, e.g. as an HTTP chunk, without waiting for
+  // the rest of the segment.
+  if (!segment_file_->Flush()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot flush file " + segment_file_name_);
+  }
+  if (muxer_listener()) {
+    // There is a reference per fragment, i.e. per chunk, of the segment.
+    const uint32_t chunk_index =
+        static_cast<uint32_t>(sidx()->references.size() - 1);
+    const SegmentReference& reference = sidx()->references.back();
+    muxer_listener()->OnNewChunk(
+        segment_file_name_, chunk_index, reference.earliest_presentation_time,
+        reference.subsegment_duration, segment_bytes_written_, chunk_size);
+  }
+  segment_bytes_written_ += chunk_size;
+
+  const base::TimeDelta latency = base::TimeTicks::Now() - start_time;
+  ++num_chunks_;
+  total_chunk_latency_ += latency;
+  max_chunk_latency_ = std::max(max_chunk_latency_, latency);
+  VLOG(2) << "Wrote chunk of " << chunk_size << " bytes to "
+          << segment_file_name_ << " in " << latency.InMillisecondsF()
+          << " ms.";
+  return Status::OK;
+}
+
+Status MultiSegmentSegmenter::OpenSegmentFile(
+    BufferWriter* buffer,
+    std::unique_ptr<File, FileCloser>* file,
+    std::string* file_name) {
+  DCHECK(styp_);
+  DCHECK(!sidx()->references.empty());
+  // earliest_presentation_time is the earliest presentation time of any access
+  // unit in the reference stream in the first subsegment.
+  sidx()->earliest_presentation_time =
+      sidx()->references[0].earliest_presentation_time;
+
+  if (options().segment_template.empty()) {
+    // Append the segment to output file if segment template is not specified.
+    *file_name = options().output_file_name;
+    file->reset(File::Open(file_name->c_str(), "a"));
+    if (!*file) {
+      return Status(error::FILE_FAILURE, "Cannot open file for append " +
+                                             options().output_file_name);
+    }
+  } else {
+    uint32_t segment_index = 0;
+    RETURN_IF_ERROR(segment_indexer_.Next(sidx()->earliest_presentation_time,
+                                          sidx()->timescale, &segment_index));
+    *file_name = GetSegmentName(options().segment_template,
+                                sidx()->earliest_presentation_time,
+                                segment_index, options().bandwidth);
+    file->reset(File::Open(file_name->c_str(), "w"));
+    if (!*file) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot open file for write " + *file_name);
+    }
+    styp_->Write(buffer);
+  }
+  return Status::OK;
+}
+
+Status MultiSegmentSegmenter::CloseSegmentFile(
+    std::unique_ptr<File, FileCloser> file,
+    const std::string& file_name,
+    uint64_t segment_size) {
   // Close the file, which also does flushing, to make sure the file is written
   // before manifest is updated.
   if (!file.release()->Close()) {
@@ -147,6 +272,7 @@ Status MultiSegmentSegmenter::WriteSegment() {
         "Cannot close file " + file_name +
             ", possibly file permission issue or running out of disk space.");
   }
+  PrepareNextSegmentFile();
 
   uint64_t segment_duration = 0;
   // ISO/IEC 23009-1:2012: the value shall be identical to sum of the the
@@ -165,6 +291,14 @@ Status MultiSegmentSegmenter::WriteSegment() {
   return Status::OK;
 }
 
+void MultiSegmentSegmenter::PrepareNextSegmentFile() {
+  // The name of the next segment is only known once it starts, but its
+  // server, if any, is known already.
+  File::PrepareForWrite(options().segment_template.empty()
+                            ? options().output_file_name.c_str()
+                            : options().segment_template.c_str());
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
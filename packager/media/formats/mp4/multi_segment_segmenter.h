@@ -7,6 +7,9 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 #define PACKAGER_MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 
+#include "packager/base/time/time.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/formats/mp4/segmenter.h"
 
 namespace shaka {
@@ -19,7 +22,9 @@ struct SegmentType;
 /// media segments, which can contain multiple fragments. The generated segments
 /// are written to files defined by @b MuxerOptions.segment_template if
 /// specified; otherwise, the segments are appended to the main output file
-/// specified by @b MuxerOptions.output_file_name.
+/// specified by @b MuxerOptions.output_file_name. If
+/// @b Mp4OutputParams.low_latency_chunked_output is set, each fragment is
+/// written and flushed to the segment file as soon as it is finalized.
 class MultiSegmentSegmenter : public Segmenter {
  public:
   MultiSegmentSegmenter(const MuxerOptions& options,
@@ -32,6 +37,7 @@ class MultiSegmentSegmenter : public Segmenter {
   bool GetInitRange(size_t* offset, size_t* size) override;
   bool GetIndexRange(size_t* offset, size_t* size) override;
   std::vector<Range> GetSegmentRanges() override;
+  std::string GetStoredInitSegmentName() const override;
   /// @}
 
  private:
@@ -39,13 +45,45 @@ class MultiSegmentSegmenter : public Segmenter {
   Status DoInitialize() override;
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
+  Status DoFinalizeFragment() override;
 
   // Write segment to file.
   Status WriteInitSegment();
   Status WriteSegment();
 
+  // Open the file of the current segment into |file| and write the segment
+  // header, if any, to |buffer|.
+  Status OpenSegmentFile(BufferWriter* buffer,
+                         std::unique_ptr<File, FileCloser>* file,
+                         std::string* file_name);
+  // Close |file| and notify the listener of the new segment.
+  Status CloseSegmentFile(std::unique_ptr<File, FileCloser> file,
+                          const std::string& file_name,
+                          uint64_t segment_size);
+
+  // Prepare the output for the file of the next segment, e.g. open a
+  // connection to its server, while the segment is produced.
+  void PrepareNextSegmentFile();
+
+  // Low latency chunked output: write the fragment in |fragment_buffer()| to
+  // the current segment file, opening it for the first fragment.
+  Status WriteChunk();
+
   std::unique_ptr<SegmentType> styp_;
-  uint32_t num_segments_;
+  SegmentIndexer segment_indexer_;
+  // The name of the init segment in the init segment store, if any.
+  std::string stored_init_segment_name_;
+
+  // Low latency chunked output state of the current segment.
+  std::unique_ptr<File, FileCloser> segment_file_;
+  std::string segment_file_name_;
+  uint64_t segment_bytes_written_ = 0;
+  size_t num_key_frames_reported_ = 0;
+  // Time taken to write and flush the chunks, including the time blocked on
+  // the output.
+  uint64_t num_chunks_ = 0;
+  base::TimeDelta total_chunk_latency_;
+  base::TimeDelta max_chunk_latency_;
 
   DISALLOW_COPY_AND_ASSIGN(MultiSegmentSegmenter);
 };
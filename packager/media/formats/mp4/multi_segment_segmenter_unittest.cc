@@ -0,0 +1,260 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/public/buffer_callback_params.h"
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/formats/mp4/mp4_muxer.h"
+#include "packager/status_macros.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+
+const size_t kInputCount = 1;
+const size_t kOutputCount = 0;
+const size_t kInputIndex = 0;
+const size_t kStreamIndex = 0;
+
+const uint32_t kTimeScale = 1000;
+const int64_t kSampleDuration = 100;
+const size_t kSamplesPerFragment = 5;
+const int64_t kFragmentDuration = kSampleDuration * kSamplesPerFragment;
+// Two fragments per segment.
+const int64_t kSegmentDuration = 2 * kFragmentDuration;
+const bool kIsSubsegment = true;
+
+const char kInitSegmentName[] = "init.mp4";
+const char kSegmentTemplate[] = "segment-$Number$.m4s";
+const char kFirstSegmentName[] = "segment-1.m4s";
+
+// Collects the outputs delivered on each flush of the callback files.
+class FakeOutputSink : public OutputSink {
+ public:
+  struct Output {
+    std::vector<uint8_t> data;
+    bool is_complete = false;
+  };
+
+  void OnOutput(const std::string& name,
+                std::shared_ptr<const std::vector<uint8_t>> data,
+                bool is_complete) override {
+    Output& output = outputs_[name];
+    output.data.insert(output.data.end(), data->begin(), data->end());
+    output.is_complete = is_complete;
+  }
+
+  const Output& GetOutput(const std::string& name) { return outputs_[name]; }
+
+ private:
+  std::map<std::string, Output> outputs_;
+};
+
+struct Box {
+  std::string type;
+  uint64_t offset;
+};
+
+// Returns the top level boxes in |data|.
+std::vector<Box> GetBoxes(const std::vector<uint8_t>& data) {
+  std::vector<Box> boxes;
+  uint64_t offset = 0;
+  while (offset + 8 <= data.size()) {
+    const uint32_t size = (static_cast<uint32_t>(data[offset]) << 24) |
+                          (data[offset + 1] << 16) | (data[offset + 2] << 8) |
+                          data[offset + 3];
+    boxes.push_back(
+        {std::string(data.begin() + offset + 4, data.begin() + offset + 8),
+         offset});
+    if (size < 8)
+      break;
+    offset += size;
+  }
+  EXPECT_EQ(data.size(), offset);
+  return boxes;
+}
+
+std::vector<std::string> GetBoxTypes(const std::vector<uint8_t>& data) {
+  std::vector<std::string> types;
+  for (const Box& box : GetBoxes(data))
+    types.push_back(box.type);
+  return types;
+}
+
+std::vector<uint64_t> GetBoxOffsets(const std::vector<uint8_t>& data,
+                                    const std::string& type) {
+  std::vector<uint64_t> offsets;
+  for (const Box& box : GetBoxes(data)) {
+    if (box.type == type)
+      offsets.push_back(box.offset);
+  }
+  return offsets;
+}
+
+}  // namespace
+
+// Tests the low latency chunked output of MultiSegmentSegmenter, through
+// MP4Muxer. The outputs are callback files, whose data reaches the sink only
+// when they are flushed or closed.
+class MultiSegmentSegmenterTest : public MediaHandlerTestBase {
+ protected:
+  void SetUp() override {
+    output_sink_ = std::make_shared<FakeOutputSink>();
+    callback_params_.output_sink = output_sink_;
+
+    MuxerOptions muxer_options;
+    muxer_options.output_file_name =
+        File::MakeCallbackFileName(callback_params_, kInitSegmentName);
+    muxer_options.segment_template =
+        File::MakeCallbackFileName(callback_params_, kSegmentTemplate);
+    muxer_options.mp4_params.low_latency_chunked_output = true;
+    // Ignored with low latency chunked output.
+    muxer_options.mp4_params.generate_sidx_in_media_segments = true;
+
+    std::unique_ptr<NiceMock<MockMuxerListener>> muxer_listener(
+        new NiceMock<MockMuxerListener>);
+    muxer_listener_ = muxer_listener.get();
+
+    std::shared_ptr<MP4Muxer> muxer = std::make_shared<MP4Muxer>(muxer_options);
+    muxer->SetMuxerListener(std::move(muxer_listener));
+    ASSERT_OK(SetUpAndInitializeGraph(muxer, kInputCount, kOutputCount));
+
+    ASSERT_OK(Input(kInputIndex)
+                  ->Dispatch(StreamData::FromStreamInfo(
+                      kStreamIndex,
+                      GetVideoStreamInfo(kTimeScale, kCodecH264))));
+  }
+
+  // Dispatches the samples of a fragment, starting with a key frame.
+  Status DispatchFragmentSamples(int64_t start_timestamp) {
+    for (size_t i = 0; i < kSamplesPerFragment; ++i) {
+      const bool is_key_frame = i == 0;
+      Status status = Input(kInputIndex)
+                          ->Dispatch(StreamData::FromMediaSample(
+                              kStreamIndex,
+                              GetMediaSample(
+                                  start_timestamp + i * kSampleDuration,
+                                  kSampleDuration, is_key_frame)));
+      if (!status.ok())
+        return status;
+    }
+    return Status::OK;
+  }
+
+  Status DispatchSegmentInfo(int64_t start_timestamp,
+                             int64_t duration,
+                             bool is_subsegment) {
+    return Input(kInputIndex)
+        ->Dispatch(StreamData::FromSegmentInfo(
+            kStreamIndex,
+            GetSegmentInfo(start_timestamp, duration, is_subsegment)));
+  }
+
+  // Dispatches a segment of two fragments.
+  Status DispatchSegment() {
+    RETURN_IF_ERROR(DispatchFragmentSamples(0));
+    RETURN_IF_ERROR(DispatchSegmentInfo(0, kFragmentDuration, kIsSubsegment));
+    RETURN_IF_ERROR(DispatchFragmentSamples(kFragmentDuration));
+    return DispatchSegmentInfo(0, kSegmentDuration, !kIsSubsegment);
+  }
+
+  const FakeOutputSink::Output& GetSegment() {
+    return output_sink_->GetOutput(kFirstSegmentName);
+  }
+
+  BufferCallbackParams callback_params_;
+  std::shared_ptr<FakeOutputSink> output_sink_;
+  MockMuxerListener* muxer_listener_ = nullptr;
+};
+
+TEST_F(MultiSegmentSegmenterTest, WritesEachFragmentWhenFinalized) {
+  EXPECT_CALL(*muxer_listener_, OnNewSegment(_, _, _, _)).Times(0);
+  ASSERT_OK(DispatchFragmentSamples(0));
+  ASSERT_OK(DispatchSegmentInfo(0, kFragmentDuration, kIsSubsegment));
+
+  // The first fragment was flushed to the output before the segment ended.
+  EXPECT_EQ(std::vector<std::string>({"styp", "moof", "mdat"}),
+            GetBoxTypes(GetSegment().data));
+  EXPECT_FALSE(GetSegment().is_complete);
+  testing::Mock::VerifyAndClearExpectations(muxer_listener_);
+
+  EXPECT_CALL(*muxer_listener_, OnNewSegment(_, _, _, _));
+  ASSERT_OK(DispatchFragmentSamples(kFragmentDuration));
+  ASSERT_OK(DispatchSegmentInfo(0, kSegmentDuration, !kIsSubsegment));
+
+  EXPECT_EQ(std::vector<std::string>({"styp", "moof", "mdat", "moof", "mdat"}),
+            GetBoxTypes(GetSegment().data));
+  EXPECT_TRUE(GetSegment().is_complete);
+}
+
+TEST_F(MultiSegmentSegmenterTest, OmitsSidx) {
+  ASSERT_OK(DispatchSegment());
+  // 'sidx' is requested but cannot precede the fragments already sent.
+  EXPECT_EQ(std::vector<std::string>({"styp", "moof", "mdat", "moof", "mdat"}),
+            GetBoxTypes(GetSegment().data));
+}
+
+TEST_F(MultiSegmentSegmenterTest, ReportsChunksAndKeyFramesInSegment) {
+  std::vector<uint64_t> key_frame_offsets;
+  EXPECT_CALL(*muxer_listener_, OnKeyFrame(_, _, _))
+      .WillRepeatedly(Invoke(
+          [&key_frame_offsets](int64_t timestamp, uint64_t start_byte_offset,
+                               uint64_t size) {
+            key_frame_offsets.push_back(start_byte_offset);
+          }));
+  std::vector<uint64_t> chunk_offsets;
+  uint64_t chunks_size = 0;
+  EXPECT_CALL(*muxer_listener_, OnNewChunk(_, _, _, _, _, _))
+      .WillRepeatedly(Invoke([&chunk_offsets, &chunks_size](
+                                 const std::string& segment_name,
+                                 uint32_t chunk_index, int64_t start_time,
+                                 int64_t duration, uint64_t start_byte_offset,
+                                 uint64_t size) {
+        EXPECT_EQ(chunk_offsets.size(), chunk_index);
+        chunk_offsets.push_back(start_byte_offset);
+        chunks_size += size;
+      }));
+  uint64_t segment_size = 0;
+  EXPECT_CALL(*muxer_listener_, OnNewSegment(_, _, _, _))
+      .WillOnce(Invoke([&segment_size](const std::string& segment_name,
+                                       int64_t start_time, int64_t duration,
+                                       uint64_t segment_file_size) {
+        segment_size = segment_file_size;
+      }));
+
+  ASSERT_OK(DispatchSegment());
+
+  const std::vector<uint8_t>& segment = GetSegment().data;
+  // The key frame of the second fragment is reported at its offset in the
+  // segment, not in the chunk.
+  const std::vector<uint64_t> moof_offsets = GetBoxOffsets(segment, "moof");
+  ASSERT_EQ(2u, moof_offsets.size());
+  EXPECT_EQ(moof_offsets, key_frame_offsets);
+  // The first chunk includes the segment header.
+  EXPECT_EQ(std::vector<uint64_t>({0, moof_offsets[1]}), chunk_offsets);
+  EXPECT_EQ(segment.size(), chunks_size);
+  EXPECT_EQ(segment.size(), segment_size);
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
@@ -8,13 +8,16 @@
 
 #include <algorithm>
 
+#include "packager/base/bind.h"
 #include "packager/base/logging.h"
+#include "packager/media/base/buffer_chain.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/id3_tag.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/media/chunking/chunking_handler.h"
 #include "packager/media/event/progress_listener.h"
 #include "packager/media/formats/mp4/box_definitions.h"
@@ -34,6 +37,10 @@ uint64_t Rescale(uint64_t time_in_old_scale,
   return static_cast<double>(time_in_old_scale) / old_scale * new_scale;
 }
 
+void FinalizeFragment(Fragmenter* fragmenter, Status* status) {
+  *status = fragmenter->FinalizeFragment();
+}
+
 }  // namespace
 
 Segmenter::Segmenter(const MuxerOptions& options,
@@ -43,7 +50,7 @@ Segmenter::Segmenter(const MuxerOptions& options,
       ftyp_(std::move(ftyp)),
       moov_(std::move(moov)),
       moof_(new MovieFragment()),
-      fragment_buffer_(new BufferWriter()),
+      fragment_buffer_(new BufferChain()),
       sidx_(new SegmentIndex()) {}
 
 Segmenter::~Segmenter() {}
@@ -80,6 +87,12 @@ Status Segmenter::Initialize(
         new Fragmenter(streams[i], &moof_->tracks[i], edit_list_offset));
   }
 
+  if (options_.mp4_params.finalize_fragments_in_parallel &&
+      streams.size() > 1) {
+    finalize_pool_.reset(new WorkStealingThreadPool(streams.size()));
+    fragments_ended_.resize(streams.size(), false);
+  }
+
   // Choose the first stream if there is no VIDEO.
   if (sidx_->reference_id == 0)
     sidx_->reference_id = 1;
@@ -129,7 +142,8 @@ Status Segmenter::AddSample(size_t stream_id, const MediaSample& sample) {
 
   DCHECK_LT(stream_id, fragmenters_.size());
   Fragmenter* fragmenter = fragmenters_[stream_id].get();
-  if (fragmenter->fragment_finalized()) {
+  if (fragmenter->fragment_finalized() ||
+      (finalize_pool_ && fragments_ended_[stream_id])) {
     return Status(error::FRAGMENT_FINALIZED,
                   "Current fragment is finalized already.");
   }
@@ -144,6 +158,36 @@ Status Segmenter::AddSample(size_t stream_id, const MediaSample& sample) {
   return Status::OK;
 }
 
+Status Segmenter::AddSamples(
+    size_t stream_id,
+    const std::vector<std::shared_ptr<const MediaSample>>& samples) {
+  if (samples.empty())
+    return Status::OK;
+  const int64_t first_sample_duration = samples.front()->duration();
+  if (moov_->extends.tracks[stream_id].default_sample_duration == 0) {
+    moov_->extends.tracks[stream_id].default_sample_duration =
+        first_sample_duration;
+  }
+
+  DCHECK_LT(stream_id, fragmenters_.size());
+  Fragmenter* fragmenter = fragmenters_[stream_id].get();
+  if (fragmenter->fragment_finalized() ||
+      (finalize_pool_ && fragments_ended_[stream_id])) {
+    return Status(error::FRAGMENT_FINALIZED,
+                  "Current fragment is finalized already.");
+  }
+
+  Status status = fragmenter->AddSamples(samples);
+  if (!status.ok())
+    return status;
+
+  if (sample_duration_ == 0)
+    sample_duration_ = first_sample_duration;
+  for (const auto& sample : samples)
+    stream_durations_[stream_id] += sample->duration();
+  return Status::OK;
+}
+
 Status Segmenter::FinalizeSegment(size_t stream_id,
                                   const SegmentInfo& segment_info) {
   if (segment_info.key_rotation_encryption_config) {
@@ -155,7 +199,17 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
   DCHECK_LT(stream_id, fragmenters_.size());
   Fragmenter* fragmenter = fragmenters_[stream_id].get();
   DCHECK(fragmenter);
-  Status status = fragmenter->FinalizeFragment();
+  Status status;
+  if (finalize_pool_) {
+    fragments_ended_[stream_id] = true;
+    if (std::find(fragments_ended_.begin(), fragments_ended_.end(), false) !=
+        fragments_ended_.end()) {
+      return Status::OK;
+    }
+    status = FinalizeFragmentsInParallel();
+  } else {
+    status = fragmenter->FinalizeFragment();
+  }
   if (!status.ok())
     return status;
 
@@ -175,7 +229,7 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
     TrackFragment& traf = moof_->tracks[i];
     if (traf.auxiliary_offset.offsets.size() > 0) {
       DCHECK_EQ(traf.auxiliary_offset.offsets.size(), 1u);
-      DCHECK(!traf.sample_encryption.sample_encryption_entries.empty());
+      DCHECK_GT(traf.sample_encryption.serialized_entry_count, 0u);
 
       next_traf_position += traf.box_size();
       // SampleEncryption 'senc' box should be the last box in 'traf'.
@@ -198,9 +252,14 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
 
   const uint64_t moof_start_offset = fragment_buffer_->Size();
 
-  // Write the fragment to buffer.
-  moof_->Write(fragment_buffer_.get());
-  mdat.WriteHeader(fragment_buffer_.get());
+  // Write the fragment header to buffer. The fragment data is chained after it
+  // without copying. |data_offset| is the size of the header.
+  std::unique_ptr<BufferWriter> fragment_header(new BufferWriter(data_offset));
+  // The box sizes were computed above and the offsets filled in since do not
+  // change them.
+  moof_->WriteWithComputedSize(fragment_header.get());
+  mdat.WriteHeader(fragment_header.get());
+  fragment_buffer_->AppendBuffer(std::move(fragment_header));
 
   bool first_key_frame = true;
   for (const std::unique_ptr<Fragmenter>& fragmenter : fragmenters_) {
@@ -216,7 +275,7 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
           {key_frame_info.timestamp, moof_start_offset,
            fragment_buffer_->Size() - moof_start_offset + key_frame_info.size});
     }
-    fragment_buffer_->AppendBuffer(*fragmenter->data());
+    fragment_buffer_->AppendBuffer(fragmenter->ReleaseData());
   }
 
   // Increase sequence_number for next fragment.
@@ -224,6 +283,10 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
 
   for (std::unique_ptr<Fragmenter>& fragmenter : fragmenters_)
     fragmenter->ClearFragmentFinalized();
+  std::fill(fragments_ended_.begin(), fragments_ended_.end(), false);
+  status = DoFinalizeFragment();
+  if (!status.ok())
+    return status;
   if (!segment_info.is_subsegment) {
     Status status = DoFinalizeSegment();
     // Reset segment information to initial state.
@@ -268,6 +331,25 @@ void Segmenter::SetComplete() {
   progress_listener_->OnProgress(1.0);
 }
 
+Status Segmenter::DoFinalizeFragment() {
+  return Status::OK;
+}
+
+Status Segmenter::FinalizeFragmentsInParallel() {
+  std::vector<Status> statuses(fragmenters_.size());
+  std::vector<base::Closure> tasks;
+  for (size_t i = 0; i < fragmenters_.size(); ++i) {
+    tasks.push_back(
+        base::Bind(&FinalizeFragment, fragmenters_[i].get(), &statuses[i]));
+  }
+  finalize_pool_->RunTasksAndWait(tasks);
+  for (const Status& status : statuses) {
+    if (!status.ok())
+      return status;
+  }
+  return Status::OK;
+}
+
 uint32_t Segmenter::GetReferenceStreamId() {
   DCHECK(sidx_);
   return sidx_->reference_id - 1;
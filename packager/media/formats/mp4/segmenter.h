@@ -9,6 +9,7 @@
 
 #include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "packager/base/optional.h"
@@ -24,11 +25,12 @@ struct EncryptionConfig;
 struct MuxerOptions;
 struct SegmentInfo;
 
-class BufferWriter;
+class BufferChain;
 class MediaSample;
 class MuxerListener;
 class ProgressListener;
 class StreamInfo;
+class WorkStealingThreadPool;
 
 namespace mp4 {
 
@@ -70,6 +72,14 @@ class Segmenter {
   /// @return OK on success, an error status otherwise.
   Status AddSample(size_t stream_id, const MediaSample& sample);
 
+  /// Add consecutive samples to the indicated stream at once.
+  /// @param stream_id is the zero-based stream index.
+  /// @param samples contains the samples to be added, in decoding order.
+  /// @return OK on success, an error status otherwise.
+  Status AddSamples(
+      size_t stream_id,
+      const std::vector<std::shared_ptr<const MediaSample>>& samples);
+
   /// Finalize the segment / subsegment.
   /// @param stream_id is the zero-based stream index.
   /// @param is_subsegment indicates if it is a subsegment (fragment).
@@ -91,6 +101,11 @@ class Segmenter {
   // Otherwise, a vector of ranges for the media segments are returned.
   virtual std::vector<Range> GetSegmentRanges() = 0;
 
+  /// @return the name of the init segment in the init segment store, see
+  ///         @b Mp4OutputParams.init_segment_store, or an empty string if the
+  ///         init segment is not stored there.
+  virtual std::string GetStoredInitSegmentName() const { return ""; }
+
   uint32_t GetReferenceTimeScale() const;
 
   /// @return The total length, in seconds, of segmented media files.
@@ -109,7 +124,7 @@ class Segmenter {
   const MuxerOptions& options() const { return options_; }
   FileType* ftyp() { return ftyp_.get(); }
   Movie* moov() { return moov_.get(); }
-  BufferWriter* fragment_buffer() { return fragment_buffer_.get(); }
+  BufferChain* fragment_buffer() { return fragment_buffer_.get(); }
   SegmentIndex* sidx() { return sidx_.get(); }
   MuxerListener* muxer_listener() { return muxer_listener_; }
   uint64_t progress_target() { return progress_target_; }
@@ -125,9 +140,15 @@ class Segmenter {
   virtual Status DoInitialize() = 0;
   virtual Status DoFinalize() = 0;
   virtual Status DoFinalizeSegment() = 0;
+  // Called when a fragment has been added to |fragment_buffer_|, before
+  // DoFinalizeSegment() if it is the last fragment of the segment.
+  virtual Status DoFinalizeFragment();
 
   uint32_t GetReferenceStreamId();
 
+  // Finalizes the fragments of all the streams on |finalize_pool_|.
+  Status FinalizeFragmentsInParallel();
+
   void FinalizeFragmentForKeyRotation(
       size_t stream_id,
       bool fragment_encrypted,
@@ -137,9 +158,14 @@ class Segmenter {
   std::unique_ptr<FileType> ftyp_;
   std::unique_ptr<Movie> moov_;
   std::unique_ptr<MovieFragment> moof_;
-  std::unique_ptr<BufferWriter> fragment_buffer_;
+  std::unique_ptr<BufferChain> fragment_buffer_;
   std::unique_ptr<SegmentIndex> sidx_;
   std::vector<std::unique_ptr<Fragmenter>> fragmenters_;
+  // Only set if the fragments are finalized in parallel, see
+  // Mp4OutputParams::finalize_fragments_in_parallel. The fragments of the
+  // streams in |fragments_ended_| are finalized when all of them have ended.
+  std::unique_ptr<WorkStealingThreadPool> finalize_pool_;
+  std::vector<bool> fragments_ended_;
   MuxerListener* muxer_listener_ = nullptr;
   ProgressListener* progress_listener_ = nullptr;
   uint64_t progress_target_ = 0u;
@@ -7,9 +7,11 @@
 #include "packager/media/formats/mp4/single_segment_segmenter.h"
 
 #include <algorithm>
+#include <limits>
 
 #include "packager/file/file.h"
 #include "packager/file/file_util.h"
+#include "packager/media/base/buffer_chain.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/event/progress_listener.h"
@@ -19,6 +21,19 @@
 namespace shaka {
 namespace media {
 namespace mp4 {
+namespace {
+
+const size_t kFreeBoxHeaderSize = 8;
+
+// Write a 'free' box of |size| bytes, which players skip.
+void WriteFreeBox(uint64_t size, BufferWriter* buffer) {
+  DCHECK_GE(size, kFreeBoxHeaderSize);
+  buffer->AppendInt(static_cast<uint32_t>(size));
+  buffer->AppendInt(static_cast<uint32_t>(FOURCC_free));
+  buffer->AppendVector(std::vector<uint8_t>(size - kFreeBoxHeaderSize, 0));
+}
+
+}  // namespace
 
 SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options,
                                                std::unique_ptr<FileType> ftyp,
@@ -28,6 +43,8 @@ SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options,
 SingleSegmentSegmenter::~SingleSegmentSegmenter() {
   if (temp_file_)
     temp_file_.release()->Close();
+  if (output_file_)
+    output_file_.release()->Close();
   if (!temp_file_name_.empty()) {
     if (!File::Delete(temp_file_name_.c_str()))
       LOG(ERROR) << "Unable to delete temporary file " << temp_file_name_;
@@ -70,6 +87,15 @@ std::vector<Range> SingleSegmentSegmenter::GetSegmentRanges() {
 }
 
 Status SingleSegmentSegmenter::DoInitialize() {
+  if (options().mp4_params.reserved_subsegments > 0) {
+    Status status;
+    if (InitializeReservedHeader(&status))
+      return status;
+    LOG(WARNING) << "Cannot reserve space for the header in '"
+                 << options().output_file_name
+                 << "'. Writing to a temporary file instead.";
+  }
+
   // Single segment segmentation involves two stages:
   //   Stage 1: Create media subsegments from media samples
   //   Stage 2: Update media header (moov) which involves copying of media
@@ -88,13 +114,22 @@ Status SingleSegmentSegmenter::DoInitialize() {
 }
 
 Status SingleSegmentSegmenter::DoFinalize() {
-  DCHECK(temp_file_);
+  DCHECK(temp_file_ || output_file_);
   DCHECK(ftyp());
   DCHECK(moov());
   DCHECK(vod_sidx_);
 
-  // Close the temp file to prepare for reading later.
-  if (!temp_file_.release()->Close()) {
+  if (output_file_) {
+    Status status;
+    if (FinalizeReservedHeader(&status))
+      return status;
+    LOG(WARNING) << "The header does not fit in the space reserved in '"
+                 << options().output_file_name << "'. Rewriting the file.";
+    status = MoveSubsegmentsToTempFile();
+    if (!status.ok())
+      return status;
+  } else if (!temp_file_.release()->Close()) {
+    // Close the temp file to prepare for reading later.
     return Status(
         error::FILE_FAILURE,
         "Cannot close the temp file " + temp_file_name_ +
@@ -216,9 +251,10 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
                                    key_frame_info.size);
     }
   }
-  // Append fragment buffer to temp file.
+  // Append fragment buffer to the output or temp file.
   size_t segment_size = fragment_buffer()->Size();
-  Status status = fragment_buffer()->WriteToFile(temp_file_.get());
+  Status status = fragment_buffer()->WriteToFile(
+      output_file_ ? output_file_.get() : temp_file_.get());
   if (!status.ok()) return status;
 
   UpdateProgress(vod_ref.subsegment_duration);
@@ -231,6 +267,122 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
   return Status::OK;
 }
 
+bool SingleSegmentSegmenter::InitializeReservedHeader(Status* status) {
+  // The header is the largest at the end, with 64-bit durations and times.
+  const uint64_t fragment_duration = moov()->extends.header.fragment_duration;
+  moov()->extends.header.fragment_duration =
+      std::numeric_limits<uint64_t>::max();
+  reserved_header_size_ = ftyp()->ComputeSize() + moov()->ComputeSize();
+  moov()->extends.header.fragment_duration = fragment_duration;
+
+  if (options().mp4_params.generate_sidx_in_media_segments) {
+    SegmentIndex sidx;
+    sidx.earliest_presentation_time = std::numeric_limits<uint64_t>::max();
+    sidx.references.resize(options().mp4_params.reserved_subsegments);
+    reserved_header_size_ += sidx.ComputeSize();
+  }
+  // Leave room for a 'free' box, which fills the space left in the end.
+  reserved_header_size_ += kFreeBoxHeaderSize;
+
+  output_file_.reset(File::Open(options().output_file_name.c_str(), "w"));
+  if (!output_file_) {
+    *status = Status(error::FILE_FAILURE,
+                     "Cannot open file to write " + options().output_file_name);
+    return true;
+  }
+  // Make sure the header can be written in place when finalizing.
+  if (!output_file_->Seek(0)) {
+    output_file_.release()->Close();
+    return false;
+  }
+
+  BufferWriter buffer;
+  WriteFreeBox(reserved_header_size_, &buffer);
+  *status = buffer.WriteToFile(output_file_.get());
+  return true;
+}
+
+bool SingleSegmentSegmenter::FinalizeReservedHeader(Status* status) {
+  const bool generate_sidx =
+      options().mp4_params.generate_sidx_in_media_segments;
+  const uint64_t header_size =
+      ftyp()->ComputeSize() + moov()->ComputeSize() +
+      (generate_sidx ? vod_sidx_->ComputeSize() : 0);
+  if (header_size > reserved_header_size_)
+    return false;
+  const uint64_t free_box_size = reserved_header_size_ - header_size;
+  if (free_box_size > 0 && free_box_size < kFreeBoxHeaderSize)
+    return false;
+
+  // The 'free' box is between the header and the first subsegment.
+  vod_sidx_->first_offset = free_box_size;
+
+  BufferWriter buffer;
+  ftyp()->WriteWithComputedSize(&buffer);
+  moov()->WriteWithComputedSize(&buffer);
+  // The version of 'sidx' depends on |first_offset|, set after its size.
+  if (generate_sidx)
+    vod_sidx_->Write(&buffer);
+  if (free_box_size > 0)
+    WriteFreeBox(free_box_size, &buffer);
+  DCHECK_EQ(reserved_header_size_, buffer.Size());
+
+  LOG(INFO) << "Update media header (moov) in '" << options().output_file_name
+            << "'.";
+
+  if (!output_file_->Seek(0)) {
+    *status = Status(error::FILE_FAILURE,
+                     "Cannot seek in file " + options().output_file_name);
+    return true;
+  }
+  *status = buffer.WriteToFile(output_file_.get());
+  if (!status->ok())
+    return true;
+  if (!output_file_.release()->Close()) {
+    *status = Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + options().output_file_name +
+            ", possibly file permission issue or running out of disk space.");
+    return true;
+  }
+  SetComplete();
+  return true;
+}
+
+Status SingleSegmentSegmenter::MoveSubsegmentsToTempFile() {
+  if (!output_file_.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + options().output_file_name);
+  }
+  if (!TempFilePath(options().temp_dir, &temp_file_name_))
+    return Status(error::FILE_FAILURE, "Unable to create temporary file.");
+
+  // The file is not buffered, so it can be copied in the kernel.
+  std::unique_ptr<File, FileCloser> file(File::OpenWithNoBuffering(
+      options().output_file_name.c_str(), "r"));
+  if (!file || !file->Seek(reserved_header_size_)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to read " + options().output_file_name);
+  }
+  std::unique_ptr<File, FileCloser> temp_file(
+      File::Open(temp_file_name_.c_str(), "w"));
+  if (!temp_file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to write " + temp_file_name_);
+  }
+  if (File::CopyFile(file.get(), temp_file.get()) < 0) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to copy file " + options().output_file_name);
+  }
+  if (!temp_file.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close the temp file " + temp_file_name_ +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  return Status::OK;
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
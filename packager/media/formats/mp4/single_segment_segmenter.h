@@ -25,6 +25,11 @@ namespace mp4 {
 /// is, the Segmenter tries to end subsegment/fragment at the first sample with
 /// overall subsegment/fragment duration not smaller than defined duration and
 /// yet meet SAP requirements.
+/// The subsegments are written to a temporary file which is copied to the
+/// output file after the header (ftyp, moov and sidx). If
+/// @b Mp4OutputParams.reserved_subsegments is set, space for the header is
+/// reserved at the beginning of the output file instead, so the subsegments
+/// are written to the output file directly.
 class SingleSegmentSegmenter : public Segmenter {
  public:
   SingleSegmentSegmenter(const MuxerOptions& options,
@@ -45,9 +50,23 @@ class SingleSegmentSegmenter : public Segmenter {
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
 
+  // Open the output file and write a placeholder for the header. Returns false
+  // if the output file does not support seeking.
+  bool InitializeReservedHeader(Status* status);
+  // Write the header to the space reserved at the beginning of the output
+  // file. Returns false if it does not fit.
+  bool FinalizeReservedHeader(Status* status);
+  // Move the subsegments written to the output file to the temp file, to
+  // rewrite the output file from scratch.
+  Status MoveSubsegmentsToTempFile();
+
   std::unique_ptr<SegmentIndex> vod_sidx_;
   std::string temp_file_name_;
   std::unique_ptr<File, FileCloser> temp_file_;
+  // Set if the subsegments are written to the output file directly, after
+  // |reserved_header_size_| bytes reserved for the header.
+  std::unique_ptr<File, FileCloser> output_file_;
+  uint64_t reserved_header_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(SingleSegmentSegmenter);
 };
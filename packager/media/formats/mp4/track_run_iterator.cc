@@ -46,7 +46,16 @@ struct SampleInfo {
 
 struct TrackRunInfo {
   uint32_t track_id;
+  // Empty for the runs of 'moov', i.e. the chunks of non-fragmented mp4,
+  // whose samples are generated from |sample_table| when the run is reached.
   std::vector<SampleInfo> samples;
+  const SampleTable* sample_table;
+  // The index of the first sample of the run in the track, and the number of
+  // samples in the run.
+  uint32_t first_sample_index;
+  uint32_t sample_count;
+  // The size of the data of all the samples in the run.
+  int64_t data_size;
   int64_t timescale;
   int64_t start_dts;
   int64_t sample_start_offset;
@@ -72,6 +81,10 @@ struct TrackRunInfo {
 
 TrackRunInfo::TrackRunInfo()
     : track_id(0),
+      sample_table(NULL),
+      first_sample_index(0),
+      sample_count(0),
+      data_size(0),
       timescale(-1),
       start_dts(-1),
       sample_start_offset(-1),
@@ -83,8 +96,74 @@ TrackRunInfo::TrackRunInfo()
       aux_info_total_size(0) {}
 TrackRunInfo::~TrackRunInfo() {}
 
+// Generates the SampleInfo of the samples of a track from the sample tables
+// in 'moov', so only the samples of the current run are in memory instead of
+// the samples of the whole track. The samples are expected to be read in
+// decoding order, as it is the order of the runs of a track in either sort
+// order; reading an earlier sample restarts from the first sample. The tables
+// are validated by TrackRunIterator::Init().
+class SampleTableReader {
+ public:
+  explicit SampleTableReader(const SampleTable& sample_table)
+      : sample_table_(sample_table) {
+    Rewind();
+  }
+
+  // Fills |samples| with the |sample_count| samples from |first_sample|.
+  void ReadSamples(uint32_t first_sample,
+                   uint32_t sample_count,
+                   std::vector<SampleInfo>* samples) {
+    if (first_sample < sample_index_)
+      Rewind();
+    while (sample_index_ < first_sample)
+      AdvanceSample();
+
+    const SampleSize& sample_size = sample_table_.sample_size;
+    samples->resize(sample_count);
+    for (SampleInfo& sample : *samples) {
+      sample.size = sample_size.sample_size != 0
+                        ? sample_size.sample_size
+                        : sample_size.sizes[sample_index_];
+      sample.duration = decoding_time_->sample_delta();
+      sample.cts_offset =
+          has_composition_offset_ ? composition_offset_->sample_offset() : 0;
+      sample.is_keyframe = sync_sample_->IsSyncSample();
+      AdvanceSample();
+    }
+  }
+
+ private:
+  void Rewind() {
+    decoding_time_.reset(
+        new DecodingTimeIterator(sample_table_.decoding_time_to_sample));
+    composition_offset_.reset(new CompositionOffsetIterator(
+        sample_table_.composition_time_to_sample));
+    has_composition_offset_ = composition_offset_->IsValid();
+    sync_sample_.reset(new SyncSampleIterator(sample_table_.sync_sample));
+    sample_index_ = 0;
+  }
+
+  void AdvanceSample() {
+    // The iterators fail to advance past the last sample only.
+    decoding_time_->AdvanceSample();
+    if (has_composition_offset_)
+      composition_offset_->AdvanceSample();
+    sync_sample_->AdvanceSample();
+    ++sample_index_;
+  }
+
+  const SampleTable& sample_table_;
+  std::unique_ptr<DecodingTimeIterator> decoding_time_;
+  std::unique_ptr<CompositionOffsetIterator> composition_offset_;
+  bool has_composition_offset_ = false;
+  std::unique_ptr<SyncSampleIterator> sync_sample_;
+  uint32_t sample_index_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleTableReader);
+};
+
 TrackRunIterator::TrackRunIterator(const Movie* moov)
-    : moov_(moov), sample_dts_(0), sample_offset_(0) {
+    : moov_(moov), samples_(NULL), sample_dts_(0), sample_offset_(0) {
   CHECK(moov);
 }
 
@@ -156,8 +235,23 @@ class CompareMinTrackRunDataOffset {
   }
 };
 
+// Orders track runs by the decoding time of their first sample, in seconds.
+class CompareTrackRunStartTime {
+ public:
+  bool operator()(const TrackRunInfo& a, const TrackRunInfo& b) {
+    const double a_start_time = static_cast<double>(a.start_dts) / a.timescale;
+    const double b_start_time = static_cast<double>(b.start_dts) / b.timescale;
+    if (a_start_time != b_start_time)
+      return a_start_time < b_start_time;
+    if (a.track_id != b.track_id)
+      return a.track_id < b.track_id;
+    return a.sample_start_offset < b.sample_start_offset;
+  }
+};
+
 bool TrackRunIterator::Init() {
   runs_.clear();
+  sample_table_readers_.clear();
 
   for (std::vector<Track>::const_iterator trak = moov_->tracks.begin();
        trak != moov_->tracks.end(); ++trak) {
@@ -167,6 +261,11 @@ bool TrackRunIterator::Init() {
       DVLOG(1) << "Skipping unhandled track type";
       continue;
     }
+    if (trak->media.information.sample_table.deferred_data) {
+      DVLOG(1) << "Skipping track " << trak->header.track_id
+               << " with unparsed sample tables";
+      continue;
+    }
 
     DecodingTimeIterator decoding_time(
         trak->media.information.sample_table.decoding_time_to_sample);
@@ -241,19 +340,20 @@ bool TrackRunIterator::Init() {
                    .default_is_protected == 0);
       }
 
+      // The samples are generated by a SampleTableReader when the run is
+      // reached. Only walk through the tables here, to validate them and to
+      // find the start time of the next run.
       uint32_t samples_per_chunk = chunk_info.samples_per_chunk();
-      tri.samples.resize(samples_per_chunk);
+      tri.sample_table = &trak->media.information.sample_table;
+      tri.first_sample_index = sample_index;
+      tri.sample_count = samples_per_chunk;
       for (uint32_t k = 0; k < samples_per_chunk; ++k) {
-        SampleInfo& sample = tri.samples[k];
-        sample.size = sample_size.sample_size != 0
-                          ? sample_size.sample_size
-                          : sample_size.sizes[sample_index];
-        sample.duration = decoding_time.sample_delta();
-        sample.cts_offset =
-            has_composition_offset ? composition_offset.sample_offset() : 0;
-        sample.is_keyframe = sync_sample.IsSyncSample();
-
-        run_start_dts += sample.duration;
+        RCHECK(sample_size.sample_size != 0 ||
+               sample_index < sample_size.sizes.size());
+        tri.data_size += sample_size.sample_size != 0
+                             ? sample_size.sample_size
+                             : sample_size.sizes[sample_index];
+        run_start_dts += decoding_time.sample_delta();
 
         // Advance to next sample. Should success except for last sample.
         ++sample_index;
@@ -281,8 +381,15 @@ bool TrackRunIterator::Init() {
   return true;
 }
 
+void TrackRunIterator::SortRunsByStartTime() {
+  std::sort(runs_.begin(), runs_.end(), CompareTrackRunStartTime());
+  run_itr_ = runs_.begin();
+  ResetRun();
+}
+
 bool TrackRunIterator::Init(const MovieFragment& moof) {
   runs_.clear();
+  sample_table_readers_.clear();
 
   next_fragment_start_dts_.resize(moof.tracks.size(), 0);
   for (size_t i = 0; i < moof.tracks.size(); i++) {
@@ -418,10 +525,12 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
         }
       }
 
+      tri.sample_count = trun.sample_count;
       tri.samples.resize(trun.sample_count);
       for (size_t k = 0; k < trun.sample_count; k++) {
         PopulateSampleInfo(*trex, traf.header, trun, k, &tri.samples[k]);
         run_start_dts += tri.samples[k].duration;
+        tri.data_size += tri.samples[k].size;
       }
       runs_.push_back(tri);
       sample_count_sum += trun.sample_count;
@@ -445,7 +554,18 @@ void TrackRunIterator::ResetRun() {
     return;
   sample_dts_ = run_itr_->start_dts;
   sample_offset_ = run_itr_->sample_start_offset;
-  sample_itr_ = run_itr_->samples.begin();
+  if (run_itr_->sample_table) {
+    std::unique_ptr<SampleTableReader>& reader =
+        sample_table_readers_[run_itr_->track_id];
+    if (!reader)
+      reader.reset(new SampleTableReader(*run_itr_->sample_table));
+    reader->ReadSamples(run_itr_->first_sample_index, run_itr_->sample_count,
+                        &run_samples_);
+    samples_ = &run_samples_;
+  } else {
+    samples_ = &run_itr_->samples;
+  }
+  sample_itr_ = samples_->begin();
 }
 
 void TrackRunIterator::AdvanceSample() {
@@ -469,9 +589,9 @@ bool TrackRunIterator::CacheAuxInfo(const uint8_t* buf, int buf_size) {
 
   std::vector<SampleEncryptionEntry>& sample_encryption_entries =
       runs_[run_itr_ - runs_.begin()].sample_encryption_entries;
-  sample_encryption_entries.resize(run_itr_->samples.size());
+  sample_encryption_entries.resize(run_itr_->sample_count);
   int64_t pos = 0;
-  for (size_t i = 0; i < run_itr_->samples.size(); i++) {
+  for (size_t i = 0; i < run_itr_->sample_count; i++) {
     int info_size = run_itr_->aux_info_default_size;
     if (!info_size)
       info_size = run_itr_->aux_info_sizes[i];
@@ -491,7 +611,7 @@ bool TrackRunIterator::CacheAuxInfo(const uint8_t* buf, int buf_size) {
 bool TrackRunIterator::IsRunValid() const { return run_itr_ != runs_.end(); }
 
 bool TrackRunIterator::IsSampleValid() const {
-  return IsRunValid() && (sample_itr_ != run_itr_->samples.end());
+  return IsRunValid() && (sample_itr_ != samples_->end());
 }
 
 // Because tracks are in sorted order and auxiliary information is cached when
@@ -561,6 +681,16 @@ const VideoSampleEntry& TrackRunIterator::video_description() const {
   return *run_itr_->video_description;
 }
 
+int64_t TrackRunIterator::run_data_offset() const {
+  DCHECK(IsRunValid());
+  return run_itr_->sample_start_offset;
+}
+
+int64_t TrackRunIterator::run_data_size() const {
+  DCHECK(IsRunValid());
+  return run_itr_->data_size;
+}
+
 int64_t TrackRunIterator::sample_offset() const {
   DCHECK(IsSampleValid());
   return sample_offset_;
@@ -602,7 +732,7 @@ std::unique_ptr<DecryptConfig> TrackRunIterator::GetDecryptConfig() {
   std::vector<uint8_t> iv;
   std::vector<SubsampleEntry> subsamples;
 
-  size_t sample_idx = sample_itr_ - run_itr_->samples.begin();
+  size_t sample_idx = sample_itr_ - samples_->begin();
   if (sample_idx < run_itr_->sample_encryption_entries.size()) {
     const SampleEncryptionEntry& sample_encryption_entry =
         run_itr_->sample_encryption_entries[sample_idx];
@@ -634,8 +764,15 @@ std::unique_ptr<DecryptConfig> TrackRunIterator::GetDecryptConfig() {
       return std::unique_ptr<DecryptConfig>();
     }
   }
+  // The key id is usually the same for all the samples of the track, so it is
+  // shared by their decrypt configs.
+  std::shared_ptr<const std::vector<uint8_t>>& key_id = key_ids_[track_id()];
+  if (!key_id || *key_id != track_encryption().default_kid) {
+    key_id = std::make_shared<const std::vector<uint8_t>>(
+        track_encryption().default_kid);
+  }
   return std::unique_ptr<DecryptConfig>(new DecryptConfig(
-      track_encryption().default_kid, iv, subsamples, protection_scheme,
+      key_id, std::move(iv), std::move(subsamples), protection_scheme,
       track_encryption().default_crypt_byte_block,
       track_encryption().default_skip_byte_block));
 }
@@ -18,6 +18,7 @@ class DecryptConfig;
 
 namespace mp4 {
 
+class SampleTableReader;
 struct SampleInfo;
 struct TrackRunInfo;
 
@@ -40,6 +41,11 @@ class TrackRunIterator {
   /// @return true on success, false otherwise.
   bool Init(const MovieFragment& moof);
 
+  /// Order the runs by the decoding time of their first sample instead of by
+  /// their data offset, interleaving the tracks, and rewind the iterator to
+  /// the first run. Runs are usually chunks for non-fragmented mp4.
+  void SortRunsByStartTime();
+
   /// @return true if the iterator points to a valid run, false if past the
   ///         last run.
   bool IsRunValid() const;
@@ -80,6 +86,11 @@ class TrackRunIterator {
   bool is_encrypted() const;
   bool is_audio() const;
   bool is_video() const;
+  /// @return the offset of the data of the first sample in the run.
+  int64_t run_data_offset() const;
+  /// @return the size of the data of all the samples in the run, which are
+  ///         contiguous.
+  int64_t run_data_size() const;
   /// @}
 
   /// Only valid if is_audio() is true.
@@ -112,7 +123,13 @@ class TrackRunIterator {
 
   std::vector<TrackRunInfo> runs_;
   std::vector<TrackRunInfo>::const_iterator run_itr_;
+  // The samples of the current run, which are either in the run or generated
+  // in |run_samples_| with |sample_table_readers_|.
+  const std::vector<SampleInfo>* samples_;
   std::vector<SampleInfo>::const_iterator sample_itr_;
+  std::vector<SampleInfo> run_samples_;
+  // TrackId => reader of the sample tables of the track.
+  std::map<uint32_t, std::unique_ptr<SampleTableReader>> sample_table_readers_;
 
   // Track the start dts of the next segment, only useful if decode_time box is
   // absent.
@@ -124,6 +141,10 @@ class TrackRunIterator {
   // TrackId => adjustment map.
   std::map<uint32_t, int64_t> timestamp_adjustment_map_;
 
+  // TrackId => key id of the last decrypt config of the track, shared with
+  // the next ones.
+  std::map<uint32_t, std::shared_ptr<const std::vector<uint8_t>>> key_ids_;
+
   DISALLOW_COPY_AND_ASSIGN(TrackRunIterator);
 };
 
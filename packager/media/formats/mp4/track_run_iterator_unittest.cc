@@ -351,6 +351,91 @@ TEST_F(TrackRunIteratorTest, BasicOperationTest) {
   EXPECT_FALSE(iter_->IsRunValid());
 }
 
+TEST_F(TrackRunIteratorTest, SortRunsByStartTimeTest) {
+  iter_.reset(new TrackRunIterator(&moov_));
+  MovieFragment moof = CreateFragment();
+  ASSERT_TRUE(iter_->Init(moof));
+
+  // Runs start at 0s (track 1), 0.4s (track 2) and 0.2133s (track 1).
+  iter_->SortRunsByStartTime();
+  EXPECT_TRUE(iter_->IsRunValid());
+  EXPECT_EQ(iter_->track_id(), 1u);
+  EXPECT_EQ(iter_->run_data_offset(), 100);
+  EXPECT_EQ(iter_->run_data_size(), kSumAscending1 + 10);
+  EXPECT_EQ(iter_->dts(), 0);
+
+  iter_->AdvanceRun();
+  EXPECT_EQ(iter_->track_id(), 1u);
+  EXPECT_EQ(iter_->run_data_offset(), 10000);
+  EXPECT_EQ(iter_->run_data_size(), 10 * 4);
+  EXPECT_EQ(iter_->sample_offset(), 10000);
+  EXPECT_EQ(iter_->dts(), 1024 * 10);
+
+  iter_->AdvanceRun();
+  EXPECT_EQ(iter_->track_id(), 2u);
+  EXPECT_EQ(iter_->run_data_offset(), 200);
+  EXPECT_EQ(iter_->run_data_size(), kSumAscending1 + 10);
+  EXPECT_EQ(iter_->dts(), moof.tracks[1].decode_time.decode_time);
+
+  iter_->AdvanceRun();
+  EXPECT_FALSE(iter_->IsRunValid());
+}
+
+TEST_F(TrackRunIteratorTest, NonFragmentedTest) {
+  // Three chunks of the video track, of 2, 3 and 2 samples, in the reverse
+  // order of the file, so the samples of the chunks are not generated in
+  // decoding order.
+  SampleTable& stbl = moov_.tracks[1].media.information.sample_table;
+  stbl.sample_to_chunk.chunk_info = {{1, 2, 1}, {2, 3, 1}, {3, 2, 1}};
+  stbl.decoding_time_to_sample.decoding_time = {{4, 100}, {3, 200}};
+  stbl.composition_time_to_sample.composition_offset = {{2, 0}, {5, 30}};
+  stbl.sample_size.sample_count = 7;
+  stbl.sample_size.sizes = {1, 2, 3, 4, 5, 6, 7};
+  stbl.chunk_large_offset.offsets = {3000, 2000, 1000};
+  stbl.sync_sample.sample_number = {1, 5};
+
+  const int64_t kDts[] = {0, 100, 200, 300, 400, 600, 800};
+  const int64_t kCtsOffsets[] = {0, 0, 30, 30, 30, 30, 30};
+  const uint32_t kFirstSamples[] = {5, 2, 0};
+  const int64_t kRunDataSizes[] = {13, 12, 3};
+  const int64_t kRunDataOffsets[] = {1000, 2000, 3000};
+
+  iter_.reset(new TrackRunIterator(&moov_));
+  ASSERT_TRUE(iter_->Init());
+  for (size_t run = 0; run < 3; ++run) {
+    ASSERT_TRUE(iter_->IsRunValid());
+    EXPECT_EQ(2u, iter_->track_id());
+    EXPECT_EQ(kRunDataOffsets[run], iter_->run_data_offset());
+    EXPECT_EQ(kRunDataSizes[run], iter_->run_data_size());
+    int64_t sample_offset = kRunDataOffsets[run];
+    for (uint32_t i = kFirstSamples[run]; iter_->IsSampleValid(); ++i) {
+      EXPECT_EQ(sample_offset, iter_->sample_offset());
+      EXPECT_EQ(static_cast<int>(i + 1), iter_->sample_size());
+      EXPECT_EQ(kDts[i], iter_->dts());
+      EXPECT_EQ(kDts[i] + kCtsOffsets[i], iter_->cts());
+      EXPECT_EQ(i < 4 ? 100 : 200, iter_->duration());
+      EXPECT_EQ(i == 0 || i == 4, iter_->is_keyframe());
+      sample_offset += iter_->sample_size();
+      iter_->AdvanceSample();
+    }
+    EXPECT_EQ(kRunDataOffsets[run] + kRunDataSizes[run], sample_offset);
+    iter_->AdvanceRun();
+  }
+  EXPECT_FALSE(iter_->IsRunValid());
+
+  // In decoding order.
+  iter_->SortRunsByStartTime();
+  for (int64_t dts : kDts) {
+    if (!iter_->IsSampleValid())
+      iter_->AdvanceRun();
+    ASSERT_TRUE(iter_->IsSampleValid());
+    EXPECT_EQ(dts, iter_->dts());
+    iter_->AdvanceSample();
+  }
+  iter_->AdvanceRun();
+  EXPECT_FALSE(iter_->IsRunValid());
+}
+
 TEST_F(TrackRunIteratorTest, TrackExtendsDefaultsTest) {
   moov_.extends.tracks[0].default_sample_duration = 50;
   moov_.extends.tracks[0].default_sample_size = 3;
@@ -577,7 +662,10 @@ TEST_F(TrackRunIteratorTest,
   EXPECT_EQ(config->subsamples()[0].clear_bytes, 1u);
   EXPECT_EQ(config->subsamples()[0].cipher_bytes, 2u);
   iter_->AdvanceSample();
+  std::unique_ptr<DecryptConfig> first_config = std::move(config);
   config = iter_->GetDecryptConfig();
+  // The key id is shared by the decrypt configs of the track.
+  EXPECT_EQ(&first_config->key_id(), &config->key_id());
   EXPECT_EQ(std::vector<uint8_t>(kIv2, kIv2 + arraysize(kIv2)), config->iv());
   EXPECT_EQ(config->subsamples().size(), 2u);
   EXPECT_EQ(config->subsamples()[0].clear_bytes, 1u);
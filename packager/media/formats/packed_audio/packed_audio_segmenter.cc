@@ -67,11 +67,10 @@ Status PackedAudioSegmenter::AddSample(const MediaSample& sample) {
   }
 
   if (adts_converter_) {
-    std::vector<uint8_t> audio_frame;
     if (!adts_converter_->ConvertToADTS(sample.data(), sample.data_size(),
-                                        &audio_frame))
+                                        &adts_frame_))
       return Status(error::MUXER_FAILURE, "Failed to convert to ADTS.");
-    segment_buffer_.AppendArray(audio_frame.data(), audio_frame.size());
+    segment_buffer_.AppendArray(adts_frame_.data(), adts_frame_.size());
   } else {
     segment_buffer_.AppendArray(sample.data(), sample.data_size());
   }
@@ -18,8 +18,8 @@ PackedAudioWriter::PackedAudioWriter(const MuxerOptions& muxer_options)
       transport_stream_timestamp_offset_(
           muxer_options.transport_stream_timestamp_offset_ms *
           kPackedAudioTimescale / 1000),
-      segmenter_(new PackedAudioSegmenter(transport_stream_timestamp_offset_)) {
-}
+      segmenter_(new PackedAudioSegmenter(transport_stream_timestamp_offset_)),
+      segment_indexer_(muxer_options) {}
 
 PackedAudioWriter::~PackedAudioWriter() = default;
 
@@ -75,11 +75,15 @@ Status PackedAudioWriter::FinalizeSegment(size_t stream_id,
 
   const uint64_t segment_timestamp =
       segment_info.start_timestamp * segmenter_->TimescaleScale();
-  std::string segment_path =
-      options().segment_template.empty()
-          ? options().output_file_name
-          : GetSegmentName(options().segment_template, segment_timestamp,
-                           segment_number_++, options().bandwidth);
+  std::string segment_path = options().output_file_name;
+  if (!options().segment_template.empty()) {
+    uint32_t segment_index = 0;
+    RETURN_IF_ERROR(segment_indexer_.Next(
+        segment_timestamp, kPackedAudioTimescale, &segment_index));
+    segment_path = GetSegmentName(options().segment_template,
+                                  segment_timestamp, segment_index,
+                                  options().bandwidth);
+  }
 
   // Save |segment_size| as it will be cleared after writing.
   const size_t segment_size = segmenter_->segment_buffer()->Size();
@@ -53,6 +53,7 @@ void TtmlGenerator::Initialize(const std::map<std::string, TextRegion>& regions,
   regions_ = regions;
   language_ = language;
   time_scale_ = time_scale;
+  head_.reset();
 }
 
 void TtmlGenerator::AddSample(const TextSample& sample) {
@@ -69,26 +70,31 @@ bool TtmlGenerator::Dump(std::string* result) const {
   RCHECK(root.SetStringAttribute("xmlns:tts",
                                  "http://www.w3.org/ns/ttml#styling"));
 
-  bool did_log = false;
-  xml::XmlNode head("head");
   RCHECK(root.SetStringAttribute("xml:lang", language_));
-  for (const auto& pair : regions_) {
-    if (!did_log && (pair.second.region_anchor_x.value != 0 &&
-                     pair.second.region_anchor_y.value != 0)) {
-      LOG(WARNING) << "TTML doesn't support non-0 region anchor";
-      did_log = true;
+  // The head only depends on the regions, so it is built once and shared by
+  // the documents of all the segments.
+  if (!head_) {
+    std::unique_ptr<xml::XmlNode> head(new xml::XmlNode("head"));
+    bool did_log = false;
+    for (const auto& pair : regions_) {
+      if (!did_log && (pair.second.region_anchor_x.value != 0 &&
+                       pair.second.region_anchor_y.value != 0)) {
+        LOG(WARNING) << "TTML doesn't support non-0 region anchor";
+        did_log = true;
+      }
+
+      xml::XmlNode region("region");
+      const auto origin =
+          ToTtmlSize(pair.second.window_anchor_x, pair.second.window_anchor_y);
+      const auto extent = ToTtmlSize(pair.second.width, pair.second.height);
+      RCHECK(region.SetStringAttribute("xml:id", pair.first));
+      RCHECK(region.SetStringAttribute("tts:origin", origin));
+      RCHECK(region.SetStringAttribute("tts:extent", extent));
+      RCHECK(head->AddChild(std::move(region)));
     }
-
-    xml::XmlNode region("region");
-    const auto origin =
-        ToTtmlSize(pair.second.window_anchor_x, pair.second.window_anchor_y);
-    const auto extent = ToTtmlSize(pair.second.width, pair.second.height);
-    RCHECK(region.SetStringAttribute("xml:id", pair.first));
-    RCHECK(region.SetStringAttribute("tts:origin", origin));
-    RCHECK(region.SetStringAttribute("tts:extent", extent));
-    RCHECK(head.AddChild(std::move(region)));
+    head_ = std::move(head);
   }
-  RCHECK(root.AddChild(std::move(head)));
+  RCHECK(root.AddChild(*head_));
 
   size_t image_count = 0;
   xml::XmlNode metadata("metadata");
@@ -9,6 +9,7 @@
 
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 
 #include "packager/media/base/text_sample.h"
@@ -50,6 +51,8 @@ class TtmlGenerator {
   uint32_t time_scale_;
   // This is modified in "const" methods to create unique IDs.
   mutable uint32_t region_id_ = 0;
+  // The <head> element, built by the first Dump() call.
+  mutable std::unique_ptr<xml::XmlNode> head_;
 };
 
 }  // namespace ttml
@@ -326,6 +326,38 @@ TEST_F(TtmlMuxerTest, HandlesReset) {
   ASSERT_EQ(results, kExpectedOutput2);
 }
 
+TEST_F(TtmlMuxerTest, HandlesRegionsAcrossSegments) {
+  const char* kExpectedHead =
+      "  <head>\n"
+      "    <region xml:id=\"foo\" tts:origin=\"20px 40px\" "
+      "tts:extent=\"22% 33%\"/>\n"
+      "  </head>\n";
+
+  TextRegion region;
+  region.width = TextNumber(22, TextUnitType::kPercent);
+  region.height = TextNumber(33, TextUnitType::kPercent);
+  region.window_anchor_x = TextNumber(20, TextUnitType::kPixels);
+  region.window_anchor_y = TextNumber(40, TextUnitType::kPixels);
+
+  TtmlGenerator generator;
+  generator.Initialize({{"foo", region}}, "", kMsTimeScale);
+  for (int64_t start : {5000, 8000}) {
+    generator.Reset();
+    generator.AddSample(TextSample(kNoId, start, start + 1000,
+                                   DefaultSettings(),
+                                   TextFragment(kNoStyles, "foo")));
+    std::string results;
+    ASSERT_TRUE(generator.Dump(&results));
+    EXPECT_THAT(results, testing::HasSubstr(kExpectedHead));
+  }
+
+  // The head is rebuilt with the new regions.
+  generator.Initialize({}, "", kMsTimeScale);
+  std::string results;
+  ASSERT_TRUE(generator.Dump(&results));
+  EXPECT_THAT(results, testing::HasSubstr("  <head/>\n"));
+}
+
 TEST_F(TtmlMuxerTest, HandlesImage) {
   const char* kExpectedOutput =
       "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
@@ -24,8 +24,15 @@ namespace webm {
 Status UpdateTrackForEncryption(const std::vector<uint8_t>& key_id,
                                 mkvmuxer::Track* track);
 
+/// The headroom to reserve in front of the encrypted samples so that
+/// UpdateFrameForEncryption() does not copy them. It fits the header of the
+/// whole-frame encryption and of the partitioned encryption with up to 13
+/// partitions.
+const size_t kEncryptedFrameHeadroom = 64;
+
 /// Update the frame with signal bytes and encryption information if it is
-/// encrypted.
+/// encrypted. The header is written in the headroom of the sample data if it
+/// fits, otherwise the sample data is copied.
 void UpdateFrameForEncryption(MediaSample* sample);
 
 }  // namespace webm
@@ -7,6 +7,7 @@
 #include "packager/media/formats/webm/encryptor.h"
 
 #include <gtest/gtest.h>
+#include <string.h>
 #include <memory>
 #include "packager/media/base/media_sample.h"
 #include "packager/media/formats/webm/webm_constants.h"
@@ -55,6 +56,31 @@ TEST(EncryptionUtilTest, SampleNotEncrypted) {
                                  sample->data() + sample->data_size()));
 }
 
+TEST(EncryptionUtilTest, SampleHeaderWrittenInHeadroom) {
+  const size_t kHeadroom = kEncryptedFrameHeadroom;
+  std::shared_ptr<uint8_t> buffer(new uint8_t[kHeadroom + sizeof(kData)],
+                                  std::default_delete<uint8_t[]>());
+  memcpy(buffer.get() + kHeadroom, kData, sizeof(kData));
+  auto sample = MediaSample::CreateEmptyMediaSample();
+  sample->TransferData(buffer, kHeadroom, sizeof(kData));
+  sample->set_is_encrypted(true);
+  sample->set_decrypt_config(std::unique_ptr<DecryptConfig>(
+      new DecryptConfig(std::vector<uint8_t>(kKeyId, kKeyId + sizeof(kKeyId)),
+                        std::vector<uint8_t>(kIv, kIv + sizeof(kIv)),
+                        std::vector<SubsampleEntry>())));
+
+  UpdateFrameForEncryption(sample.get());
+  const size_t kHeaderSize = sizeof(kIv) + 1;
+  ASSERT_EQ(sizeof(kData) + kHeaderSize, sample->data_size());
+  // Not copied.
+  EXPECT_EQ(buffer.get() + kHeadroom - kHeaderSize, sample->data());
+  EXPECT_EQ(kHeadroom - kHeaderSize, sample->data_headroom());
+  EXPECT_EQ(kWebMEncryptedSignal, sample->data()[0]);
+  EXPECT_EQ(std::vector<uint8_t>(kData, kData + sizeof(kData)),
+            std::vector<uint8_t>(sample->data() + kHeaderSize,
+                                 sample->data() + sample->data_size()));
+}
+
 namespace {
 
 const SubsampleEntry kSubsamples1[] = {
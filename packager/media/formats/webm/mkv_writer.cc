@@ -8,10 +8,20 @@
 
 namespace shaka {
 namespace media {
+namespace {
+// Writes are buffered up to this size, which holds the Clusters of most audio
+// streams and the short Clusters of video streams.
+const size_t kMaxBufferSize = 4 << 20;  // 4MB.
+}  // namespace
 
 MkvWriter::MkvWriter() : position_(0) {}
 
-MkvWriter::~MkvWriter() {}
+MkvWriter::~MkvWriter() {
+  // The file may be read back after the writer is destroyed without Close(),
+  // e.g. the temp file of TwoPassSingleSegmentSegmenter.
+  if (file_ && !FlushBuffer())
+    LOG(ERROR) << "Failed to write to " << file_->file_name();
+}
 
 Status MkvWriter::Open(const std::string& name) {
   DCHECK(!file_);
@@ -28,6 +38,10 @@ Status MkvWriter::Open(const std::string& name) {
 
 Status MkvWriter::Close() {
   const std::string file_name = file_->file_name();
+  if (!FlushBuffer()) {
+    file_.reset();
+    return Status(error::FILE_FAILURE, "Failed to write to " + file_name);
+  }
   if (!file_.release()->Close()) {
     return Status(
         error::FILE_FAILURE,
@@ -40,19 +54,11 @@ Status MkvWriter::Close() {
 mkvmuxer::int32 MkvWriter::Write(const void* buf, mkvmuxer::uint32 len) {
   DCHECK(file_);
 
-  const char* data = reinterpret_cast<const char*>(buf);
-  int64_t total_bytes_written = 0;
-  while (total_bytes_written < len) {
-    const int64_t written =
-        file_->Write(data + total_bytes_written, len - total_bytes_written);
-    if (written < 0)
-      return written;
-
-    total_bytes_written += written;
-  }
-
-  DCHECK_EQ(total_bytes_written, len);
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(buf);
+  buffer_.insert(buffer_.end(), data, data + len);
   position_ += len;
+  if (buffer_.size() >= kMaxBufferSize && !FlushBuffer())
+    return -1;
   return 0;
 }
 
@@ -62,6 +68,8 @@ int64_t MkvWriter::WriteFromFile(File* source) {
 
 int64_t MkvWriter::WriteFromFile(File* source, int64_t max_copy) {
   DCHECK(file_);
+  if (!FlushBuffer())
+    return -1;
 
   const int64_t size = File::CopyFile(source, file_.get(), max_copy);
   if (size < 0)
@@ -77,6 +85,8 @@ mkvmuxer::int64 MkvWriter::Position() const {
 
 mkvmuxer::int32 MkvWriter::Position(mkvmuxer::int64 position) {
   DCHECK(file_);
+  if (!FlushBuffer())
+    return -1;
 
   if (file_->Seek(position)) {
     position_ = position;
@@ -93,5 +103,19 @@ bool MkvWriter::Seekable() const {
 void MkvWriter::ElementStartNotify(mkvmuxer::uint64 element_id,
                                    mkvmuxer::int64 position) {}
 
+bool MkvWriter::FlushBuffer() {
+  const uint8_t* data = buffer_.data();
+  int64_t bytes_left = buffer_.size();
+  while (bytes_left > 0) {
+    const int64_t written = file_->Write(data, bytes_left);
+    if (written <= 0)
+      return false;
+    data += written;
+    bytes_left -= written;
+  }
+  buffer_.clear();
+  return true;
+}
+
 }  // namespace media
 }  // namespace shaka
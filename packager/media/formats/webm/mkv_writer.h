@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "packager/file/file_closer.h"
 #include "packager/status.h"
@@ -18,6 +19,10 @@ namespace shaka {
 namespace media {
 
 /// An implementation of IMkvWriter using our File type.
+/// mkvmuxer writes every element, and every frame of a Cluster, with a few
+/// small writes. These are buffered in memory and written to the file in one
+/// call before a seek, e.g. when mkvmuxer goes back to write the size of a
+/// finished Cluster, or when the buffer is full.
 class MkvWriter : public mkvmuxer::IMkvWriter {
  public:
   MkvWriter();
@@ -28,7 +33,8 @@ class MkvWriter : public mkvmuxer::IMkvWriter {
   /// @param name The path to the file to open.
   /// @return Whether the operation succeeded.
   Status Open(const std::string& name);
-  /// Closes the file.  MUST call Open before calling any other methods.
+  /// Closes the file, after writing the buffered data.  MUST call Open before
+  /// calling any other methods.
   Status Close();
 
   /// Writes out @a len bytes of @a buf.
@@ -61,7 +67,12 @@ class MkvWriter : public mkvmuxer::IMkvWriter {
   File* file() { return file_.get(); }
 
  private:
+  // Writes the buffered data to the file.
+  // @return true on success.
+  bool FlushBuffer();
+
   std::unique_ptr<File, FileCloser> file_;
+  std::vector<uint8_t> buffer_;
   // Keep track of the position and whether we can seek.
   mkvmuxer::int64 position_;
   bool seekable_;
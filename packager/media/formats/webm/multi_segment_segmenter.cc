@@ -18,7 +18,7 @@ namespace media {
 namespace webm {
 
 MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options)
-    : Segmenter(options), num_segment_(0) {}
+    : Segmenter(options), segment_indexer_(options) {}
 
 MultiSegmentSegmenter::~MultiSegmentSegmenter() {}
 
@@ -46,8 +46,6 @@ Status MultiSegmentSegmenter::FinalizeSegment(uint64_t start_timestamp,
     if (!File::Delete(temp_file_name_.c_str()))
       return Status(error::FILE_FAILURE, "Failure to delete memory file.");
 
-    num_segment_++;
-
     if (muxer_listener()) {
       const uint64_t size = cluster()->Size();
       muxer_listener()->OnNewSegment(segment_name, start_timestamp,
@@ -88,13 +86,17 @@ Status MultiSegmentSegmenter::DoFinalize() {
 Status MultiSegmentSegmenter::NewSegment(uint64_t start_timestamp,
                                          bool is_subsegment) {
   if (!is_subsegment) {
+    Status status =
+        segment_indexer_.Next(start_timestamp, time_scale(), &num_segment_);
+    if (!status.ok())
+      return status;
     temp_file_name_ =
         "memory://" + GetSegmentName(options().segment_template,
                                      start_timestamp, num_segment_,
                                      options().bandwidth);
 
     writer_.reset(new MkvWriter);
-    Status status = writer_->Open(temp_file_name_);
+    status = writer_->Open(temp_file_name_);
 
     if (!status.ok())
       return status;
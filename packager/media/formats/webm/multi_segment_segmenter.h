@@ -9,6 +9,7 @@
 
 #include <memory>
 
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/formats/webm/mkv_writer.h"
 #include "packager/media/formats/webm/segmenter.h"
 #include "packager/status.h"
@@ -47,7 +48,9 @@ class MultiSegmentSegmenter : public Segmenter {
   Status NewSegment(uint64_t start_timestamp, bool is_subsegment) override;
 
   std::unique_ptr<MkvWriter> writer_;
-  uint32_t num_segment_;
+  SegmentIndexer segment_indexer_;
+  // The number of the current segment.
+  uint32_t num_segment_ = 0;
   std::string temp_file_name_;
 
   DISALLOW_COPY_AND_ASSIGN(MultiSegmentSegmenter);
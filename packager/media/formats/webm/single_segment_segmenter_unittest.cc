@@ -6,6 +6,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include "packager/file/file.h"
 #include "packager/media/formats/webm/segmenter_test_base.h"
 
 namespace shaka {
@@ -289,5 +290,69 @@ TEST_F(SingleSegmentSegmenterTest, ReallyLargeTimestamp) {
   }
 }
 
+TEST_F(SingleSegmentSegmenterTest, ReservesSpaceForCues) {
+  MuxerOptions options = CreateMuxerOptions();
+  options.segment_duration_in_seconds = 5;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  // Write the samples to the Segmenter.
+  for (int i = 0; i < 8; i++) {
+    if (i == 5) {
+      ASSERT_OK(segmenter_->FinalizeSegment(0, 5 * kDuration, !kSubsegment));
+    }
+    std::shared_ptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(*sample));
+  }
+  ASSERT_OK(
+      segmenter_->FinalizeSegment(5 * kDuration, 8 * kDuration, !kSubsegment));
+  ASSERT_OK(segmenter_->Finalize());
+
+  // The Cues are before the Clusters, which end the file.
+  uint64_t index_start = 0;
+  uint64_t index_end = 0;
+  ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+  const std::vector<Range> ranges = segmenter_->GetSegmentRanges();
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_LT(index_end, ranges[0].start);
+  EXPECT_EQ(ranges.back().end + 1,
+            static_cast<uint64_t>(File::GetFileSize(OutputFileName().c_str())));
+
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  ASSERT_EQ(2u, parser.cluster_count());
+  EXPECT_EQ(5u, parser.GetFrameCountForCluster(0));
+  EXPECT_EQ(3u, parser.GetFrameCountForCluster(1));
+}
+
+TEST_F(SingleSegmentSegmenterTest, CuesDoNotFitReservedSpace) {
+  MuxerOptions options = CreateMuxerOptions();
+  // Far fewer clusters are expected than written.
+  options.segment_duration_in_seconds = 100;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  // Write the samples to the Segmenter, one per segment.
+  for (int i = 0; i < 8; i++) {
+    std::shared_ptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(*sample));
+    ASSERT_OK(segmenter_->FinalizeSegment(i * kDuration, kDuration,
+                                          !kSubsegment));
+  }
+  ASSERT_OK(segmenter_->Finalize());
+
+  // The Cues are written after the Clusters instead.
+  uint64_t index_start = 0;
+  uint64_t index_end = 0;
+  ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+  const std::vector<Range> ranges = segmenter_->GetSegmentRanges();
+  ASSERT_EQ(8u, ranges.size());
+  EXPECT_EQ(ranges.back().end + 1, index_start);
+
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  ASSERT_EQ(8u, parser.cluster_count());
+}
+
 }  // namespace media
 }  // namespace shaka
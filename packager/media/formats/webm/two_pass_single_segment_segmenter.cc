@@ -7,6 +7,7 @@
 #include "packager/media/formats/webm/two_pass_single_segment_segmenter.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include "packager/file/file_util.h"
 #include "packager/media/base/media_sample.h"
@@ -20,6 +21,16 @@ namespace shaka {
 namespace media {
 namespace webm {
 namespace {
+// The size of the Cues element header: the ID and an 8 byte size.
+const uint64_t kCuesHeaderSize = 12;
+// A Void element takes at least two bytes, so a space can be filled with a
+// Void element if it is either empty or at least this large.
+const uint64_t kMinVoidSize = 2;
+// More Clusters than the segment duration suggests are expected, since the
+// segments are cut at the key frames after the segment boundaries.
+const double kClusterCountMargin = 1.1;
+const uint64_t kExtraClusters = 2;
+
 // Cues will be inserted before clusters. All clusters will be shifted down by
 // the size of cues. However, cluster positions affect the size of cues. This
 // function adjusts cues size iteratively until it is stable.
@@ -69,6 +80,29 @@ TwoPassSingleSegmentSegmenter::TwoPassSingleSegmentSegmenter(
 TwoPassSingleSegmentSegmenter::~TwoPassSingleSegmentSegmenter() {}
 
 Status TwoPassSingleSegmentSegmenter::DoInitialize() {
+  std::unique_ptr<MkvWriter> output(new MkvWriter);
+  Status status = output->Open(options().output_file_name);
+  if (!status.ok())
+    return status;
+
+  const uint64_t reserved_cues_size = EstimateCuesSize();
+  if (reserved_cues_size > 0 && output->Seekable()) {
+    set_writer(std::move(output));
+    status = SingleSegmentSegmenter::DoInitialize();
+    if (!status.ok())
+      return status;
+
+    reserved_cues_pos_ = writer()->Position();
+    reserved_cues_size_ = reserved_cues_size;
+    if (mkvmuxer::WriteVoidElement(writer(), reserved_cues_size_) !=
+        reserved_cues_size_) {
+      return Status(error::FILE_FAILURE, "Error reserving space for Cues.");
+    }
+    seek_head()->set_cluster_pos(writer()->Position() - segment_payload_pos());
+    return Status::OK;
+  }
+  output_writer_ = std::move(output);
+
   // Assume the amount of time to copy the temp file as the same amount
   // of time as to make it.
   set_progress_target(duration() * 2);
@@ -76,7 +110,7 @@ Status TwoPassSingleSegmentSegmenter::DoInitialize() {
   if (!TempFilePath(options().temp_dir, &temp_file_name_))
     return Status(error::FILE_FAILURE, "Unable to create temporary file.");
   std::unique_ptr<MkvWriter> temp(new MkvWriter);
-  Status status = temp->Open(temp_file_name_);
+  status = temp->Open(temp_file_name_);
   if (!status.ok())
     return status;
   set_writer(std::move(temp));
@@ -85,6 +119,9 @@ Status TwoPassSingleSegmentSegmenter::DoInitialize() {
 }
 
 Status TwoPassSingleSegmentSegmenter::DoFinalize() {
+  if (reserved_cues_size_ > 0)
+    return FinalizeWithReservedCues();
+
   const uint64_t header_size = init_end() + 1;
   const uint64_t cues_pos = header_size - segment_payload_pos();
   const uint64_t cues_size = UpdateCues(cues());
@@ -92,10 +129,8 @@ Status TwoPassSingleSegmentSegmenter::DoFinalize() {
   seek_head()->set_cluster_pos(cues_pos + cues_size);
 
   // Write the header to the real output file.
-  std::unique_ptr<MkvWriter> real_writer(new MkvWriter);
-  Status status = real_writer->Open(options().output_file_name);
-  if (!status.ok())
-    return status;
+  std::unique_ptr<MkvWriter> real_writer = std::move(output_writer_);
+  DCHECK(real_writer);
 
   const uint64_t file_size = writer()->Position() + cues_size;
   Status temp = WriteSegmentHeader(file_size, real_writer.get());
@@ -111,10 +146,11 @@ Status TwoPassSingleSegmentSegmenter::DoFinalize() {
   DCHECK_EQ(real_writer->Position(),
             static_cast<int64_t>(segment_payload_pos() + cues_pos + cues_size));
 
-  // Close the temp file and open it for reading.
+  // Close the temp file and open it for reading. It is not buffered, so the
+  // clusters can be copied in the kernel.
   set_writer(std::unique_ptr<MkvWriter>());
   std::unique_ptr<File, FileCloser> temp_reader(
-      File::Open(temp_file_name_.c_str(), "r"));
+      File::OpenWithNoBuffering(temp_file_name_.c_str(), "r"));
   if (!temp_reader)
     return Status(error::FILE_FAILURE, "Error opening temp file.");
 
@@ -137,6 +173,58 @@ Status TwoPassSingleSegmentSegmenter::DoFinalize() {
   return real_writer->Close();
 }
 
+uint64_t TwoPassSingleSegmentSegmenter::EstimateCuesSize() {
+  const double segment_duration = options().segment_duration_in_seconds;
+  if (duration() == 0 || time_scale() == 0 || segment_duration <= 0)
+    return 0;
+  const double duration_in_seconds =
+      static_cast<double>(duration()) / time_scale();
+  const uint64_t num_clusters =
+      static_cast<uint64_t>(std::ceil(duration_in_seconds / segment_duration *
+                                      kClusterCountMargin)) +
+      kExtraClusters;
+
+  // The largest CuePoint, with a timecode and a Cluster position that take
+  // eight bytes each.
+  mkvmuxer::CuePoint cue_point;
+  cue_point.set_time(UINT64_C(1) << 56);
+  cue_point.set_track(track_id());
+  cue_point.set_cluster_pos(UINT64_C(1) << 56);
+  return kCuesHeaderSize + num_clusters * cue_point.Size();
+}
+
+Status TwoPassSingleSegmentSegmenter::FinalizeWithReservedCues() {
+  // The Clusters are already at their final positions, so are the Cues.
+  const uint64_t cues_size = cues()->Size();
+  if (cues_size != reserved_cues_size_ &&
+      cues_size + kMinVoidSize > reserved_cues_size_) {
+    LOG(WARNING) << "Cues of " << cues_size << " bytes do not fit in the "
+                 << reserved_cues_size_
+                 << " bytes reserved. Writing them after the Clusters.";
+    return SingleSegmentSegmenter::DoFinalize();
+  }
+
+  const uint64_t file_size = writer()->Position();
+  writer()->Position(reserved_cues_pos_);
+  set_index_start(reserved_cues_pos_);
+  seek_head()->set_cues_pos(reserved_cues_pos_ - segment_payload_pos());
+  if (!cues()->Write(writer()))
+    return Status(error::FILE_FAILURE, "Error writing Cues data.");
+  set_index_end(writer()->Position() - 1);
+
+  // Fill the rest of the reserved space.
+  const uint64_t void_size = reserved_cues_size_ - cues_size;
+  if (void_size > 0 &&
+      mkvmuxer::WriteVoidElement(writer(), void_size) != void_size) {
+    return Status(error::FILE_FAILURE, "Error writing Void element.");
+  }
+
+  writer()->Position(0);
+  Status status = WriteSegmentHeader(file_size, writer());
+  status.Update(writer()->Close());
+  return status;
+}
+
 bool TwoPassSingleSegmentSegmenter::CopyFileWithClusterRewrite(
     File* source,
     MkvWriter* dest,
@@ -21,8 +21,18 @@ struct MuxerOptions;
 
 namespace webm {
 
-/// An implementation of a Segmenter for a single-segment that performs two
-/// passes.  This does not use seeking and is used for non-seekable files.
+/// An implementation of a Segmenter for a single-segment that puts the Cues
+/// before the Clusters.
+///
+/// If the output is seekable and the number of Clusters can be estimated, this
+/// reserves space for the Cues with a Void element after the header, writes the
+/// Clusters directly to the output and writes the Cues into the reserved space
+/// at the end. If the Cues do not fit, they are written after the Clusters
+/// instead.
+///
+/// Otherwise this performs two passes: the Clusters are written to a temp file,
+/// which is copied to the output after the Cues. This does not use seeking and
+/// is used for non-seekable files.
 class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
  public:
   explicit TwoPassSingleSegmentSegmenter(const MuxerOptions& options);
@@ -41,7 +51,21 @@ class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
                                   MkvWriter* dest,
                                   uint64_t last_size);
 
+  // Returns the size to reserve for the Cues, or zero if the number of
+  // Clusters cannot be estimated.
+  uint64_t EstimateCuesSize();
+
+  // Writes the Cues into the space reserved before the Clusters.
+  Status FinalizeWithReservedCues();
+
   std::string temp_file_name_;
+  // The output file. Only set in two pass mode, when the Clusters are written
+  // to the temp file.
+  std::unique_ptr<MkvWriter> output_writer_;
+  // The position and the size of the Void element reserved for the Cues. The
+  // size is zero in two pass mode.
+  uint64_t reserved_cues_pos_ = 0;
+  uint64_t reserved_cues_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(TwoPassSingleSegmentSegmenter);
 };
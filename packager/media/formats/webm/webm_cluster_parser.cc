@@ -10,6 +10,7 @@
 #include "packager/base/logging.h"
 #include "packager/base/sys_byteorder.h"
 #include "packager/media/base/decrypt_config.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/base/timestamp.h"
 #include "packager/media/codecs/vp8_parser.h"
 #include "packager/media/codecs/vp9_parser.h"
@@ -40,7 +41,8 @@ WebMClusterParser::WebMClusterParser(
     const MediaParser::NewMediaSampleCB& new_sample_cb,
     const MediaParser::InitCB& init_cb,
     KeySource* decryption_key_source)
-    : timecode_multiplier_(timecode_scale /
+    : timecode_scale_(timecode_scale),
+      timecode_multiplier_(timecode_scale /
                            static_cast<double>(kMicrosecondsPerMillisecond)),
       audio_stream_info_(audio_stream_info),
       video_stream_info_(video_stream_info),
@@ -129,12 +131,55 @@ int WebMClusterParser::Parse(const uint8_t* buf, int size) {
   return result;
 }
 
+std::unique_ptr<WebMClusterParser> WebMClusterParser::CreateQueuingParser()
+    const {
+  // Only the track numbers of the text tracks are used.
+  WebMTracksParser::TextTracks text_tracks;
+  for (const auto& pair : text_track_map_)
+    text_tracks[pair.first] = TextTrackConfig();
+  std::unique_ptr<WebMClusterParser> parser(new WebMClusterParser(
+      timecode_scale_, audio_stream_info_, video_stream_info_, vp_config_,
+      audio_.default_duration(), video_.default_duration(), text_tracks,
+      ignored_tracks_, audio_encryption_key_id_, video_encryption_key_id_,
+      MediaParser::NewMediaSampleCB(), MediaParser::InitCB(), nullptr));
+  parser->queue_samples_ = true;
+  return parser;
+}
+
+bool WebMClusterParser::EmitQueuedSamples(WebMClusterParser* queuing_parser) {
+  DCHECK(queuing_parser->queue_samples_);
+  std::vector<std::pair<int, std::shared_ptr<MediaSample>>> samples;
+  samples.swap(queuing_parser->queued_samples_);
+  for (const auto& pair : samples) {
+    Track* track = nullptr;
+    if (pair.first == audio_.track_num())
+      track = &audio_;
+    else if (pair.first == video_.track_num())
+      track = &video_;
+    else
+      track = FindTextTrack(pair.first);
+    DCHECK(track);
+    if (!track || !track->EmitBuffer(pair.second))
+      return false;
+  }
+  if (queuing_parser->cluster_start_time_ != kNoTimestamp)
+    cluster_start_time_ = queuing_parser->cluster_start_time_;
+  return true;
+}
+
+void WebMClusterParser::SetCurrentChunk(std::shared_ptr<const uint8_t> chunk,
+                                        const uint8_t* begin,
+                                        int size) {
+  current_chunk_ = std::move(chunk);
+  current_chunk_begin_ = current_chunk_ ? begin : nullptr;
+  current_chunk_size_ = current_chunk_ ? size : 0;
+}
+
 WebMParserClient* WebMClusterParser::OnListStart(int id) {
   if (id == kWebMIdCluster) {
     cluster_timecode_ = -1;
     cluster_start_time_ = kNoTimestamp;
   } else if (id == kWebMIdBlockGroup) {
-    block_data_.reset();
     block_data_size_ = -1;
     block_duration_ = -1;
     discard_padding_ = -1;
@@ -160,10 +205,9 @@ bool WebMClusterParser::OnListEnd(int id) {
   }
 
   bool result = ParseBlock(
-      false, block_data_.get(), block_data_size_, block_additional_data_.get(),
+      false, block_data_.data(), block_data_size_, block_additional_data_.get(),
       block_additional_data_size_, block_duration_,
       discard_padding_set_ ? discard_padding_ : 0, reference_block_set_);
-  block_data_.reset();
   block_data_size_ = -1;
   block_duration_ = -1;
   block_add_id_ = -1;
@@ -248,13 +292,13 @@ bool WebMClusterParser::OnBinary(int id, const uint8_t* data, int size) {
       return ParseBlock(true, data, size, NULL, 0, -1, 0, false);
 
     case kWebMIdBlock:
-      if (block_data_) {
+      if (block_data_size_ != -1) {
         LOG(ERROR) << "More than 1 Block in a BlockGroup is not "
                       "supported.";
         return false;
       }
-      block_data_.reset(new uint8_t[size]);
-      memcpy(block_data_.get(), data, size);
+      // The BlockGroup may end in a later Parse() call, so keep a copy.
+      block_data_.assign(data, data + size);
       block_data_size_ = size;
       return true;
 
@@ -386,14 +430,14 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
 
     if (decrypt_config) {
       if (!decryptor_source_) {
-        buffer->SetData(media_data, media_data_size);
+        SetSampleData(media_data, media_data_size, buffer.get());
         // If the demuxer does not have the decryptor_source_, store
         // decrypt_config so that the demuxed sample can be decrypted later.
         buffer->set_decrypt_config(std::move(decrypt_config));
         buffer->set_is_encrypted(true);
       } else {
-        std::shared_ptr<uint8_t> decrypted_media_data(
-            new uint8_t[media_data_size], std::default_delete<uint8_t[]>());
+        std::shared_ptr<uint8_t> decrypted_media_data =
+            SampleBufferPool::Allocate(media_data_size);
         if (!decryptor_source_->DecryptSampleBuffer(
                 decrypt_config.get(), media_data, media_data_size,
                 decrypted_media_data.get())) {
@@ -403,7 +447,7 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
         buffer->TransferData(std::move(decrypted_media_data), media_data_size);
       }
     } else {
-      buffer->SetData(media_data, media_data_size);
+      SetSampleData(media_data, media_data_size, buffer.get());
     }
   } else {
     std::string id, settings, content;
@@ -479,6 +523,10 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
     }
   }
 
+  if (queue_samples_) {
+    queued_samples_.emplace_back(track_num, buffer);
+    return true;
+  }
   return track->EmitBuffer(buffer);
 }
 
@@ -620,6 +668,19 @@ int64_t WebMClusterParser::Track::GetDurationEstimate() {
   return duration;
 }
 
+void WebMClusterParser::SetSampleData(const uint8_t* data,
+                                      int size,
+                                      MediaSample* sample) {
+  if (current_chunk_ && data >= current_chunk_begin_ &&
+      data + size <= current_chunk_begin_ + current_chunk_size_) {
+    sample->ShareData(current_chunk_,
+                      current_chunk_.get() + (data - current_chunk_begin_),
+                      size);
+    return;
+  }
+  sample->SetData(data, size);
+}
+
 void WebMClusterParser::ResetTextTracks() {
   for (TextTrackMap::iterator it = text_track_map_.begin();
        it != text_track_map_.end();
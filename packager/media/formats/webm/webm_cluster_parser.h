@@ -10,6 +10,8 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "packager/base/compiler_specific.h"
 #include "packager/media/base/decryptor_source.h"
@@ -45,6 +47,8 @@ class WebMClusterParser : public WebMParserClient {
     ~Track();
 
     int track_num() const { return track_num_; }
+    bool is_video() const { return is_video_; }
+    int64_t default_duration() const { return default_duration_; }
 
     // If |last_added_buffer_missing_duration_| is set, updates its duration
     // relative to |buffer|'s timestamp, and emits it and unsets
@@ -148,11 +152,34 @@ class WebMClusterParser : public WebMParserClient {
   /// @return The number of bytes parsed on success.
   int Parse(const uint8_t* buf, int size);
 
+  /// Tells the parser that the data passed to the following Parse() calls in
+  /// [@a begin, @a begin + @a size) is a copy of the ref-counted @a chunk.
+  /// Samples in that range share memory with @a chunk instead of copying the
+  /// sample data out. Pass a null @a chunk to go back to copying.
+  void SetCurrentChunk(std::shared_ptr<const uint8_t> chunk,
+                       const uint8_t* begin,
+                       int size);
+
   int64_t cluster_start_time() const { return cluster_start_time_; }
 
   /// @return true if the last Parse() call stopped at the end of a cluster.
   bool cluster_ended() const { return cluster_ended_; }
 
+  /// @return true if the streams are initialized, i.e. init_cb was called.
+  bool initialized() const { return initialized_; }
+
+  /// Creates a parser for the same tracks, which queues the samples of the
+  /// clusters it parses instead of emitting them. It does not call init_cb
+  /// nor decrypt. Its Parse() can then run on another thread, concurrently
+  /// with this parser, and EmitQueuedSamples() emits the samples afterwards.
+  std::unique_ptr<WebMClusterParser> CreateQueuingParser() const;
+
+  /// Emits the samples queued by @a queuing_parser, created by
+  /// CreateQueuingParser(), as if this parser had parsed the clusters, so that
+  /// the durations are derived across the clusters in the same way.
+  /// @return true on success, false otherwise.
+  bool EmitQueuedSamples(WebMClusterParser* queuing_parser) WARN_UNUSED_RESULT;
+
  private:
   // WebMParserClient methods.
   WebMParserClient* OnListStart(int id) override;
@@ -179,6 +206,10 @@ class WebMClusterParser : public WebMParserClient {
                int64_t discard_padding,
                bool is_key_frame);
 
+  // Points |sample| at |data| in the current chunk if it is in there, or at a
+  // copy of |data| otherwise.
+  void SetSampleData(const uint8_t* data, int size, MediaSample* sample);
+
   // Resets the Track objects associated with each text track.
   void ResetTextTracks();
 
@@ -186,6 +217,7 @@ class WebMClusterParser : public WebMParserClient {
   // if that track num is not a text track.
   Track* FindTextTrack(int track_num);
 
+  int64_t timecode_scale_;
   // Multiplier used to convert timecodes into microseconds.
   double timecode_multiplier_;
 
@@ -206,8 +238,14 @@ class WebMClusterParser : public WebMParserClient {
   bool initialized_;
   MediaParser::InitCB init_cb_;
 
+  // The chunk set by SetCurrentChunk(), and where it is in the parsed data.
+  std::shared_ptr<const uint8_t> current_chunk_;
+  const uint8_t* current_chunk_begin_ = nullptr;
+  int current_chunk_size_ = 0;
+
   int64_t last_block_timecode_ = -1;
-  std::unique_ptr<uint8_t[]> block_data_;
+  // The Block of the current BlockGroup. Reused across BlockGroups.
+  std::vector<uint8_t> block_data_;
   int block_data_size_ = -1;
   int64_t block_duration_ = -1;
   int64_t block_add_id_ = -1;
@@ -226,6 +264,12 @@ class WebMClusterParser : public WebMParserClient {
   int64_t cluster_start_time_;
   bool cluster_ended_ = false;
 
+  // Set in the parsers created by CreateQueuingParser(). The samples are then
+  // queued in |queued_samples_| with their track numbers, instead of being
+  // emitted by the Track objects.
+  bool queue_samples_ = false;
+  std::vector<std::pair<int, std::shared_ptr<MediaSample>>> queued_samples_;
+
   Track audio_;
   Track video_;
   TextTrackMap text_track_map_;
@@ -682,6 +682,49 @@ TEST_F(WebMClusterParserTest, ParseSimpleBlockAndBlockGroupMixture) {
   ASSERT_TRUE(VerifyBuffers(kBlockInfo, block_count));
 }
 
+TEST_F(WebMClusterParserTest, SharesSampleDataWithCurrentChunk) {
+  const BlockInfo kBlockInfo[] = {
+      {kAudioTrackNum, 0, 23, true, NULL, 0, false},
+      {kAudioTrackNum, 23, 23, false, NULL, 0, false},
+  };
+  int block_count = arraysize(kBlockInfo);
+  std::unique_ptr<Cluster> cluster(CreateCluster(0, kBlockInfo, block_count));
+  std::shared_ptr<uint8_t> chunk(new uint8_t[cluster->size()],
+                                 std::default_delete<uint8_t[]>());
+  memcpy(chunk.get(), cluster->data(), cluster->size());
+
+  parser_->SetCurrentChunk(chunk, chunk.get(), cluster->size());
+  int result = parser_->Parse(chunk.get(), cluster->size());
+  EXPECT_EQ(cluster->size(), result);
+  ASSERT_EQ(2u, audio_buffers_.size());
+
+  // The SimpleBlock is shared with the chunk. The Block of a BlockGroup is
+  // copied as the BlockGroup may span Parse() calls.
+  const uint8_t* chunk_end = chunk.get() + cluster->size();
+  EXPECT_GE(audio_buffers_[0]->data(), chunk.get());
+  EXPECT_LT(audio_buffers_[0]->data(), chunk_end);
+  EXPECT_TRUE(audio_buffers_[1]->data() < chunk.get() ||
+              audio_buffers_[1]->data() >= chunk_end);
+  ASSERT_TRUE(VerifyBuffers(kBlockInfo, block_count));
+}
+
+TEST_F(WebMClusterParserTest, QueuingParser) {
+  int block_count = arraysize(kDefaultBlockInfo);
+  std::unique_ptr<Cluster> cluster(
+      CreateCluster(0, kDefaultBlockInfo, block_count));
+
+  std::unique_ptr<WebMClusterParser> queuing_parser =
+      parser_->CreateQueuingParser();
+  int result = queuing_parser->Parse(cluster->data(), cluster->size());
+  EXPECT_EQ(cluster->size(), result);
+  EXPECT_TRUE(queuing_parser->cluster_ended());
+  EXPECT_TRUE(audio_buffers_.empty());
+  EXPECT_TRUE(video_buffers_.empty());
+
+  ASSERT_TRUE(parser_->EmitQueuedSamples(queuing_parser.get()));
+  ASSERT_TRUE(VerifyBuffers(kDefaultBlockInfo, block_count));
+}
+
 TEST_F(WebMClusterParserTest, IgnoredTracks) {
   std::set<int64_t> ignored_tracks;
   ignored_tracks.insert(kTextTrackNum);
@@ -6,11 +6,14 @@
 
 #include <string>
 
+#include "packager/base/bind.h"
 #include "packager/base/callback.h"
 #include "packager/base/callback_helpers.h"
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/sample_buffer_pool.h"
 #include "packager/media/base/timestamp.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/media/formats/webm/webm_cluster_parser.h"
 #include "packager/media/formats/webm/webm_constants.h"
 #include "packager/media/formats/webm/webm_content_encodings.h"
@@ -20,11 +23,30 @@
 namespace shaka {
 namespace media {
 
+// A complete cluster to be parsed on a worker thread.
+struct WebMMediaParser::QueuedCluster {
+  void Parse() {
+    parser->SetCurrentChunk(data, data.get(), size);
+    parsed = parser->Parse(data.get(), size) == size && parser->cluster_ended();
+    parser->SetCurrentChunk(nullptr, nullptr, 0);
+  }
+
+  std::shared_ptr<const uint8_t> data;
+  int size = 0;
+  std::unique_ptr<WebMClusterParser> parser;
+  bool parsed = false;
+};
+
 WebMMediaParser::WebMMediaParser()
     : state_(kWaitingForInit), unknown_segment_size_(false) {}
 
 WebMMediaParser::~WebMMediaParser() {}
 
+void WebMMediaParser::EnableParallelClusterParsing(size_t num_threads) {
+  DCHECK_EQ(state_, kWaitingForInit);
+  cluster_parser_pool_.reset(new WorkStealingThreadPool(num_threads));
+}
+
 void WebMMediaParser::Init(const InitCB& init_cb,
                            const NewMediaSampleCB& new_media_sample_cb,
                            const NewTextSampleCB& new_text_sample_cb,
@@ -45,9 +67,10 @@ bool WebMMediaParser::Flush() {
   DCHECK_NE(state_, kWaitingForInit);
 
   byte_queue_.Reset();
-  bool result = true;
+  bool result = ParseQueuedClusters();
+  in_cluster_ = false;
   if (cluster_parser_)
-    result = cluster_parser_->Flush();
+    result = cluster_parser_->Flush() && result;
   if (state_ == kParsingClusters) {
     ChangeState(kParsingHeaders);
   }
@@ -60,14 +83,27 @@ bool WebMMediaParser::Parse(const uint8_t* buf, int size) {
   if (state_ == kError)
     return false;
 
-  byte_queue_.Push(buf, size);
-
   int result = 0;
   int bytes_parsed = 0;
   const uint8_t* cur = NULL;
   int cur_size = 0;
 
+  // Parse |buf| in place if there is nothing left over from the previous
+  // calls, and only queue what is not parsed.
   byte_queue_.Peek(&cur, &cur_size);
+  const bool parse_in_place = cur_size == 0;
+  if (parse_in_place) {
+    cur = buf;
+    cur_size = size;
+  } else {
+    byte_queue_.Push(buf, size);
+    byte_queue_.Peek(&cur, &cur_size);
+  }
+  if (current_chunk_) {
+    current_chunk_begin_ = cur + cur_size - size;
+    current_chunk_size_ = size;
+  }
+
   while (cur_size > 0) {
     State oldState = state_;
     switch (state_) {
@@ -98,10 +134,27 @@ bool WebMMediaParser::Parse(const uint8_t* buf, int size) {
     bytes_parsed += result;
   }
 
-  byte_queue_.Pop(bytes_parsed);
+  if (parse_in_place) {
+    if (cur_size > 0)
+      byte_queue_.Push(cur, cur_size);
+  } else {
+    byte_queue_.Pop(bytes_parsed);
+  }
   return true;
 }
 
+bool WebMMediaParser::ParseChunk(std::shared_ptr<const uint8_t> chunk,
+                                 int size) {
+  current_chunk_ = std::move(chunk);
+  const bool result = Parse(current_chunk_.get(), size);
+  current_chunk_.reset();
+  current_chunk_begin_ = nullptr;
+  current_chunk_size_ = 0;
+  if (cluster_parser_)
+    cluster_parser_->SetCurrentChunk(nullptr, nullptr, 0);
+  return result;
+}
+
 void WebMMediaParser::ChangeState(State new_state) {
   DVLOG(1) << "ChangeState() : " << state_ << " -> " << new_state;
   state_ = new_state;
@@ -156,7 +209,10 @@ int WebMMediaParser::ParseInfoAndTracks(const uint8_t* data, int size) {
       return result;
       break;
     case kWebMIdInfo:
-      // We've found the element we are looking for.
+      // We've found the element we are looking for. The queued clusters
+      // belong to the previous segment.
+      if (!ParseQueuedClusters())
+        return -1;
       break;
     default: {
       LOG(ERROR) << "Unexpected element ID 0x" << std::hex << id;
@@ -223,6 +279,32 @@ int WebMMediaParser::ParseCluster(const uint8_t* data, int size) {
   if (!cluster_parser_)
     return -1;
 
+  // Only whole clusters of known size are parsed in parallel, after the
+  // streams have been initialized.
+  if (cluster_parser_pool_ && !in_cluster_ && !decryption_key_source_ &&
+      cluster_parser_->initialized()) {
+    int id;
+    int64_t element_size;
+    int result = WebMParseElementHeader(data, size, &id, &element_size);
+    if (result <= 0)
+      return result;
+    if (id == kWebMIdCluster && element_size != kWebMUnknownSize) {
+      const int64_t cluster_size = result + element_size;
+      if (size < cluster_size)
+        return 0;
+      if (!QueueCluster(data, static_cast<int>(cluster_size)))
+        return -1;
+      ChangeState(kParsingHeaders);
+      return cluster_size;
+    }
+  }
+
+  // The queued clusters come first.
+  if (!ParseQueuedClusters())
+    return -1;
+
+  cluster_parser_->SetCurrentChunk(current_chunk_, current_chunk_begin_,
+                                   current_chunk_size_);
   int bytes_parsed = cluster_parser_->Parse(data, size);
   if (bytes_parsed < 0)
     return bytes_parsed;
@@ -231,10 +313,57 @@ int WebMMediaParser::ParseCluster(const uint8_t* data, int size) {
   if (cluster_ended) {
     ChangeState(kParsingHeaders);
   }
+  if (bytes_parsed > 0)
+    in_cluster_ = !cluster_ended;
 
   return bytes_parsed;
 }
 
+bool WebMMediaParser::QueueCluster(const uint8_t* data, int size) {
+  std::unique_ptr<QueuedCluster> cluster(new QueuedCluster);
+  if (current_chunk_ && data >= current_chunk_begin_ &&
+      data + size <= current_chunk_begin_ + current_chunk_size_) {
+    cluster->data = std::shared_ptr<const uint8_t>(
+        current_chunk_,
+        current_chunk_.get() + (data - current_chunk_begin_));
+  } else {
+    std::shared_ptr<uint8_t> copy = SampleBufferPool::Allocate(size);
+    memcpy(copy.get(), data, size);
+    cluster->data = std::move(copy);
+  }
+  cluster->size = size;
+  cluster->parser = cluster_parser_->CreateQueuingParser();
+  queued_clusters_.push_back(std::move(cluster));
+
+  if (queued_clusters_.size() < cluster_parser_pool_->num_threads())
+    return true;
+  return ParseQueuedClusters();
+}
+
+bool WebMMediaParser::ParseQueuedClusters() {
+  if (queued_clusters_.empty())
+    return true;
+
+  std::vector<std::unique_ptr<QueuedCluster>> clusters;
+  clusters.swap(queued_clusters_);
+  std::vector<base::Closure> tasks;
+  for (const auto& cluster : clusters) {
+    tasks.push_back(
+        base::Bind(&QueuedCluster::Parse, base::Unretained(cluster.get())));
+  }
+  cluster_parser_pool_->RunTasksAndWait(tasks);
+
+  for (const auto& cluster : clusters) {
+    if (!cluster->parsed) {
+      LOG(ERROR) << "Failed to parse cluster.";
+      return false;
+    }
+    if (!cluster_parser_->EmitQueuedSamples(cluster->parser.get()))
+      return false;
+  }
+  return true;
+}
+
 bool WebMMediaParser::FetchKeysIfNecessary(
     const std::string& audio_encryption_key_id,
     const std::string& video_encryption_key_id) {
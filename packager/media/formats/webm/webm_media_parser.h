@@ -5,6 +5,9 @@
 #ifndef PACKAGER_MEDIA_FORMATS_WEBM_WEBM_MEDIA_PARSER_H_
 #define PACKAGER_MEDIA_FORMATS_WEBM_WEBM_MEDIA_PARSER_H_
 
+#include <memory>
+#include <vector>
+
 #include "packager/base/callback_forward.h"
 #include "packager/base/compiler_specific.h"
 #include "packager/media/base/byte_queue.h"
@@ -14,12 +17,24 @@ namespace shaka {
 namespace media {
 
 class WebMClusterParser;
+class WorkStealingThreadPool;
 
 class WebMMediaParser : public MediaParser {
  public:
   WebMMediaParser();
   ~WebMMediaParser() override;
 
+  /// Parse the clusters in parallel on a pool of threads. Clusters of known
+  /// size, as in files with Cues, are independent: complete clusters are
+  /// queued and parsed together, one cluster per task. The samples are still
+  /// emitted in the same order, on the thread calling Parse() or Flush().
+  /// The first cluster, which initializes the streams, and clusters of
+  /// unknown size, as in live streams, are parsed serially. Ignored if the
+  /// samples are decrypted. Must be called before parsing.
+  /// @param num_threads is the number of threads of the pool. A value of zero
+  ///        means the number of processors.
+  void EnableParallelClusterParsing(size_t num_threads);
+
   /// @name MediaParser implementation overrides.
   /// @{
   void Init(const InitCB& init_cb,
@@ -28,6 +43,8 @@ class WebMMediaParser : public MediaParser {
             KeySource* decryption_key_source) override;
   bool Flush() override WARN_UNUSED_RESULT;
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  bool ParseChunk(std::shared_ptr<const uint8_t> chunk,
+                  int size) override WARN_UNUSED_RESULT;
   /// @}
 
  private:
@@ -59,6 +76,14 @@ class WebMMediaParser : public MediaParser {
   // Returning > 0 indicates success & the number of bytes parsed.
   int ParseCluster(const uint8_t* data, int size);
 
+  // In parallel mode, queue the complete cluster in |data| to be parsed on the
+  // pool by ParseQueuedClusters(). Parses the queued clusters if there is one
+  // per thread. Returns false on error.
+  bool QueueCluster(const uint8_t* data, int size);
+  // Parse the queued clusters on the pool and emit their samples in order.
+  // Returns false on error.
+  bool ParseQueuedClusters();
+
   // Fetch keys for the input key ids. Returns true on success, false otherwise.
   bool FetchKeysIfNecessary(const std::string& audio_encryption_key_id,
                             const std::string& video_encryption_key_id);
@@ -74,6 +99,19 @@ class WebMMediaParser : public MediaParser {
   std::unique_ptr<WebMClusterParser> cluster_parser_;
   ByteQueue byte_queue_;
 
+  // Set if the clusters are parsed in parallel.
+  std::unique_ptr<WorkStealingThreadPool> cluster_parser_pool_;
+  struct QueuedCluster;
+  std::vector<std::unique_ptr<QueuedCluster>> queued_clusters_;
+  // Whether |cluster_parser_| is in the middle of a cluster.
+  bool in_cluster_ = false;
+
+  // The chunk being parsed in ParseChunk() and where its bytes are in the
+  // data being parsed. Blocks fully contained in it share its memory.
+  std::shared_ptr<const uint8_t> current_chunk_;
+  const uint8_t* current_chunk_begin_ = nullptr;
+  int current_chunk_size_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(WebMMediaParser);
 };
 
@@ -25,8 +25,10 @@ Status TextPadder::InitializeInternal() {
 
 Status TextPadder::Process(std::unique_ptr<StreamData> data) {
   DCHECK_EQ(data->stream_index, kStreamIndex);
+  // The heartbeats are not cues, so they do not need any padding.
   const bool is_text_sample =
-      data->stream_data_type == StreamDataType::kTextSample;
+      data->stream_data_type == StreamDataType::kTextSample &&
+      !data->text_sample->is_heartbeat();
   return is_text_sample ? OnTextSample(std::move(data))
                         : Dispatch(std::move(data));
 }
@@ -68,7 +68,7 @@ void LineReader::Flush() {
   should_flush_ = true;
 }
 
-BlockReader::BlockReader() : should_flush_(false) {}
+BlockReader::BlockReader() : temp_size_(0), should_flush_(false) {}
 
 void BlockReader::PushData(const uint8_t* data, size_t data_size) {
   source_.PushData(data, data_size);
@@ -82,21 +82,28 @@ bool BlockReader::Next(std::vector<std::string>* out) {
   // Read through lines until a non-empty line is found. With a non-empty
   // line is found, start adding the lines to the output and once an empty
   // line if found again, stop adding lines and exit.
-  std::string line;
-  while (source_.Next(&line)) {
-    if (!temp_.empty() && line.empty()) {
+  // The lines are read in place, in the strings of the previous block, so
+  // their buffers are reused.
+  while (true) {
+    if (temp_size_ == temp_.size())
+      temp_.emplace_back();
+    std::string* line = &temp_[temp_size_];
+    if (!source_.Next(line))
+      break;
+    if (temp_size_ > 0 && line->empty()) {
       end_block = true;
       break;
     }
-    if (!line.empty()) {
-      temp_.emplace_back(std::move(line));
-    }
+    if (!line->empty())
+      temp_size_++;
   }
 
-  if (!end_block && (!should_flush_ || temp_.empty()))
+  if (!end_block && (!should_flush_ || temp_size_ == 0))
     return false;
 
-  *out = std::move(temp_);
+  temp_.resize(temp_size_);
+  out->swap(temp_);
+  temp_size_ = 0;
   return true;
 }
 
@@ -46,7 +46,8 @@ class BlockReader {
 
   /// Pushes data onto the end of the buffer.
   void PushData(const uint8_t* data, size_t data_size);
-  /// Reads the next block from the buffer.
+  /// Reads the next block from the buffer. Passing the same vector to each
+  /// call reuses the strings of the previous block.
   /// @return True if a block is read, false if there is no block in the buffer.
   bool Next(std::vector<std::string>* out);
   /// Indicates that no more data is coming and that calls to Next should
@@ -58,7 +59,9 @@ class BlockReader {
   BlockReader operator=(const BlockReader&) = delete;
 
   LineReader source_;
+  // The lines of the current block are the first |temp_size_| strings.
   std::vector<std::string> temp_;
+  size_t temp_size_;
   bool should_flush_;
 };
 
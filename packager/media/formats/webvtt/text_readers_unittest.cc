@@ -178,5 +178,32 @@ TEST(TextReadersTest, ReadBlocksMultipleReads) {
   EXPECT_THAT(block, ElementsAre("block 1", "block 2"));
 }
 
+TEST(TextReadersTest, ReadBlocksOfDifferentSizes) {
+  const uint8_t text[] =
+      "block 1 - line 1\n"
+      "block 1 - line 2\n"
+      "\n"
+      "block 2\n"
+      "\n"
+      "block 3 - line 1\n"
+      "block 3 - line 2\n"
+      "block 3 - line 3\n";
+
+  BlockReader reader;
+  reader.PushData(text, sizeof(text) - 1);
+  reader.Flush();
+
+  // The same vector is reused for all the blocks.
+  std::vector<std::string> block;
+  ASSERT_TRUE(reader.Next(&block));
+  EXPECT_THAT(block, ElementsAre("block 1 - line 1", "block 1 - line 2"));
+  ASSERT_TRUE(reader.Next(&block));
+  EXPECT_THAT(block, ElementsAre("block 2"));
+  ASSERT_TRUE(reader.Next(&block));
+  EXPECT_THAT(block, ElementsAre("block 3 - line 1", "block 3 - line 2",
+                                 "block 3 - line 3"));
+  ASSERT_FALSE(reader.Next(&block));
+}
+
 }  // namespace media
 }  // namespace shaka
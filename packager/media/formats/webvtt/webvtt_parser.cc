@@ -10,6 +10,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_piece.h"
 #include "packager/base/strings/string_split.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/media/base/text_stream_info.h"
@@ -398,7 +399,8 @@ bool WebVttParser::ParseCueWithId(const std::vector<std::string>& block) {
 bool WebVttParser::ParseCue(const std::string& id,
                             const std::string* block,
                             size_t block_size) {
-  const std::vector<std::string> time_and_style = base::SplitString(
+  // The pieces point into |block|, so only the cue payload is copied.
+  const std::vector<base::StringPiece> time_and_style = base::SplitStringPiece(
       block[0], " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
 
   uint64_t start_time = 0;
@@ -440,12 +442,12 @@ bool WebVttParser::ParseCue(const std::string& id,
   TextSettings settings;
   for (size_t i = 3; i < time_and_style.size(); i++) {
     const auto pos = time_and_style[i].find(':');
-    if (pos == std::string::npos) {
+    if (pos == base::StringPiece::npos) {
       continue;
     }
 
-    const std::string key = time_and_style[i].substr(0, pos);
-    const std::string value = time_and_style[i].substr(pos + 1);
+    const std::string key = time_and_style[i].substr(0, pos).as_string();
+    const std::string value = time_and_style[i].substr(pos + 1).as_string();
     ParseSettings(key, value, &settings);
   }
 
@@ -70,15 +70,6 @@ void WriteSample(const TextSample& sample, BufferWriter* out) {
   box.Write(out);
 }
 
-void WriteSamples(const std::list<const TextSample*>& samples,
-                  BufferWriter* writer) {
-  DCHECK_GE(samples.size(), 0u);
-
-  for (const auto& sample : samples) {
-    WriteSample(*sample, writer);
-  }
-}
-
 void WriteEmptySample(BufferWriter* writer) {
   mp4::VTTEmptyCueBox box;
   box.Write(writer);
@@ -180,8 +171,27 @@ Status WebVttToMp4Handler::OnTextSample(
   return Status::OK;
 }
 
+void WebVttToMp4Handler::UpdateCueBoxes() {
+  std::map<const TextSample*, CueBox> cue_boxes;
+  for (const auto& sample : current_segment_) {
+    auto iter = cue_boxes_.find(sample.get());
+    if (iter != cue_boxes_.end()) {
+      cue_boxes[sample.get()] = std::move(iter->second);
+      continue;
+    }
+    BufferWriter writer;
+    WriteSample(*sample, &writer);
+    CueBox& cue_box = cue_boxes[sample.get()];
+    cue_box.sample = sample;
+    cue_box.data.assign(writer.Buffer(), writer.Buffer() + writer.Size());
+  }
+  cue_boxes_.swap(cue_boxes);
+}
+
 Status WebVttToMp4Handler::DispatchCurrentSegment(int64_t segment_start,
                                                   int64_t segment_end) {
+  UpdateCueBoxes();
+
   // Active will hold all the samples that are "on screen" for the current
   // section of time.
   std::list<const TextSample*> active;
@@ -252,7 +262,10 @@ Status WebVttToMp4Handler::MergeDispatchSamples(
   box_writer_.Clear();
 
   if (state.size()) {
-    WriteSamples(state, &box_writer_);
+    for (const TextSample* sample : state) {
+      DCHECK(cue_boxes_.find(sample) != cue_boxes_.end());
+      box_writer_.AppendVector(cue_boxes_[sample].data);
+    }
   } else {
     WriteEmptySample(&box_writer_);
   }
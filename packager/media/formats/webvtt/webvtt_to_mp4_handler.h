@@ -10,7 +10,9 @@
 #include <stdint.h>
 
 #include <list>
+#include <map>
 #include <queue>
+#include <vector>
 
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_handler.h"
@@ -43,8 +45,22 @@ class WebVttToMp4Handler : public MediaHandler {
                               int64_t end_in_seconds,
                               const std::list<const TextSample*>& state);
 
+  // Serializes the 'vttc' boxes of the samples of |current_segment_| which
+  // are not in |cue_boxes_| yet, and drops the boxes of the samples gone.
+  void UpdateCueBoxes();
+
   std::list<std::shared_ptr<const TextSample>> current_segment_;
 
+  // The serialized 'vttc' box of a text sample, kept while the sample is in
+  // the segments. A cue spanning several sections or segments is serialized
+  // once.
+  struct CueBox {
+    // Keeps the sample, which is the key in |cue_boxes_|, alive.
+    std::shared_ptr<const TextSample> sample;
+    std::vector<uint8_t> data;
+  };
+  std::map<const TextSample*, CueBox> cue_boxes_;
+
   // This is the current state of the box we are writing.
   BufferWriter box_writer_;
 };
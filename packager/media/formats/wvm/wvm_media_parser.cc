@@ -4,6 +4,8 @@
 
 #include "packager/media/formats/wvm/wvm_media_parser.h"
 
+#include <string.h>
+
 #include <map>
 #include <sstream>
 #include <vector>
@@ -131,11 +133,19 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
 
   while (read_ptr < end) {
     switch (parse_state_) {
-      case StartCode1:
-        if (*read_ptr == kStartCode1) {
-          parse_state_ = StartCode2;
+      case StartCode1: {
+        // Skip to the next candidate start code in one scan rather than
+        // through the state machine, one byte per iteration.
+        const uint8_t* start_code = reinterpret_cast<const uint8_t*>(
+            memchr(read_ptr, kStartCode1, end - read_ptr));
+        if (!start_code) {
+          read_ptr = end;
+          continue;
         }
+        read_ptr = start_code;
+        parse_state_ = StartCode2;
         break;
+      }
       case StartCode2:
         if (*read_ptr == kStartCode2) {
           parse_state_ = StartCode3;
@@ -7,6 +7,8 @@
 #ifndef PACKAGER_MEDIA_PUBLIC_AD_CUE_GENERATOR_PARAMS_H_
 #define PACKAGER_MEDIA_PUBLIC_AD_CUE_GENERATOR_PARAMS_H_
 
+#include <stdint.h>
+
 #include <vector>
 
 namespace shaka {
@@ -23,6 +25,12 @@ struct Cuepoint {
 struct AdCueGeneratorParams {
   /// List of cuepoints.
   std::vector<Cuepoint> cue_points;
+
+  /// The maximum size, in bytes, of the samples an input may buffer while
+  /// waiting for a sync point, e.g. when its video has a gap. Once reached, the
+  /// pending cue is promoted at the time of the samples buffered rather than at
+  /// a video key frame. 0 means no limit.
+  uint64_t max_buffered_bytes_per_input = 0;
 };
 
 }  // namespace shaka
@@ -25,6 +25,19 @@ struct ChunkingParams {
   /// Setting to subsegment_sap_aligned to true but segment_sap_aligned to false
   /// is not allowed.
   bool subsegment_sap_aligned = true;
+
+  /// Number the segments from their timestamps, i.e. the first segment
+  /// generated is numbered with its start time divided by the segment
+  /// duration, instead of from zero. The manifests are numbered the same way.
+  /// With inputs timestamped from a common clock, e.g. the epoch, redundant
+  /// packagers of the same live input then generate interchangeable segments
+  /// and manifests, whenever they are started.
+  bool segment_numbers_from_timestamps = false;
+  /// A key frame this many seconds before a segment boundary starts the new
+  /// segment, so that jitter in the key frame positions of the input does not
+  /// shift the segment boundaries from one packager to another. Should be
+  /// small compared to the segment duration.
+  double segment_alignment_tolerance_in_seconds = 0;
 };
 
 }  // namespace shaka
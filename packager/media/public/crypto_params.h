@@ -98,6 +98,16 @@ struct WidevineEncryptionParams {
   std::vector<uint8_t> group_id;
   /// Enables entitlement license when set to true.
   bool enable_entitlement_license;
+  /// Number of crypto periods whose keys are requested in each key rotation
+  /// request.
+  uint32_t crypto_period_count = 10;
+  /// Number of crypto periods whose keys are fetched ahead of the current
+  /// crypto period. If zero, the keys of five requests are fetched ahead.
+  uint32_t crypto_period_lookahead = 0;
+  /// Fetch the keys in the background while the inputs are probed, instead of
+  /// in Packager::Initialize(). If the request fails, the error is returned
+  /// by Packager::Run().
+  bool fetch_keys_in_background = false;
 };
 
 /// PlayReady encryption parameters.
@@ -117,6 +127,10 @@ struct PlayReadyEncryptionParams {
   std::string client_cert_private_key_file;
   /// Password to the private key file.
   std::string client_cert_private_key_password;
+  /// Fetch the keys in the background while the inputs are probed, instead of
+  /// in Packager::Initialize(). If the request fails, the error is returned
+  /// by Packager::Run().
+  bool fetch_keys_in_background = false;
 };
 
 /// Raw key encryption/decryption parameters, i.e. with key parameters provided.
@@ -160,6 +174,18 @@ struct EncryptionParams {
 
   /// Clear lead duration in seconds.
   double clear_lead_in_seconds = 0;
+  /// How long the Widevine and PlayReady key server responses are cached in
+  /// seconds. The cache is shared by all the packager instances in the process,
+  /// so the instances packaging the same content with the same policy and
+  /// crypto periods share the key server requests. Zero disables the cache.
+  uint32_t key_cache_ttl_in_seconds = 0;
+  /// If not empty, the cached key server responses are also kept in this
+  /// directory, encrypted with `key_cache_encryption_key`, so re-packaging the
+  /// same content in a later process skips the requests while the responses
+  /// are not expired. Requires `key_cache_ttl_in_seconds`.
+  std::string key_cache_dir;
+  /// The AES-GCM key of the entries in `key_cache_dir`, 16 or 32 bytes.
+  std::vector<uint8_t> key_cache_encryption_key;
   /// The protection scheme: "cenc", "cens", "cbc1", "cbcs".
   static constexpr uint32_t kProtectionSchemeCenc = 0x63656E63;
   static constexpr uint32_t kProtectionSchemeCbc1 = 0x63626331;
@@ -182,6 +208,10 @@ struct EncryptionParams {
   double crypto_period_duration_in_seconds = kNoKeyRotation;
   /// Enable/disable subsample encryption for VP9.
   bool vp9_subsample_encryption = true;
+  /// If non-zero, the samples of every (sub)segment are encrypted in parallel
+  /// on a pool of this many threads shared by all the streams, and dispatched
+  /// in order once the (sub)segment is complete.
+  uint32_t num_encryption_threads = 0;
 
   /// Encrypted stream information that is used to determine stream label.
   struct EncryptedStreamAttributes {
@@ -0,0 +1,35 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_PUBLIC_LIVE_CHECKPOINT_PARAMS_H_
+#define PACKAGER_MEDIA_PUBLIC_LIVE_CHECKPOINT_PARAMS_H_
+
+#include <string>
+
+namespace shaka {
+
+/// Parameters to checkpoint the manifests of a live channel, so that a
+/// restarted packager resumes the channel instead of starting a new
+/// presentation: the segments in the live window, the media sequence numbers
+/// and the segment numbering are restored, and the manifests keep the same
+/// availability start time. The input must continue with the timestamps of
+/// the previous run, e.g. a live encoder feed using the wall clock.
+/// Key rotation is resumed from the timestamps, which determine the crypto
+/// periods; the clear lead is not applied again after a restart.
+struct LiveCheckpointParams {
+  /// The file the checkpoint is written to, atomically. Checkpointing is
+  /// disabled if empty.
+  std::string checkpoint_file;
+  /// The checkpoint is written every this many seconds while running, and at
+  /// the end of the run. Must be positive if `checkpoint_file` is set.
+  double checkpoint_period_in_seconds = 10;
+  /// Resume from `checkpoint_file`, if it exists, on start.
+  bool resume = false;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_PUBLIC_LIVE_CHECKPOINT_PARAMS_H_
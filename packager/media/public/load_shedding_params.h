@@ -0,0 +1,37 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_PUBLIC_LOAD_SHEDDING_PARAMS_H_
+#define PACKAGER_MEDIA_PUBLIC_LOAD_SHEDDING_PARAMS_H_
+
+#include <functional>
+#include <string>
+
+namespace shaka {
+
+/// Load shedding parameters for live packaging. The lag of an output is the
+/// wall clock time elapsed since its first sample minus the media time of its
+/// completed segments, i.e. how far the output fell behind real time. When an
+/// output lags too much, the outputs are stopped one at a time, in this
+/// order, until the packager keeps up again: the trick play outputs, the text
+/// outputs, then the video renditions from the lowest resolution up. The
+/// audio outputs and the highest video rendition are never stopped. A stopped
+/// output completes its current segment and is not updated afterwards.
+struct LoadSheddingParams {
+  /// If positive, an output is stopped when an output lags by more than this
+  /// many seconds. After an output is stopped, the next one is not stopped
+  /// before this many more seconds, so the lag can settle.
+  double max_lag_in_seconds = 0;
+  /// If set, called on the packaging threads when an output is stopped, with
+  /// the output file name, or the segment template for segmented outputs,
+  /// and the lag which caused it.
+  std::function<void(const std::string& output, double lag_in_seconds)>
+      output_shed_callback;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_PUBLIC_LOAD_SHEDDING_PARAMS_H_
@@ -7,6 +7,10 @@
 #ifndef PACKAGER_MEDIA_PUBLIC_MP4_OUTPUT_PARAMS_H_
 #define PACKAGER_MEDIA_PUBLIC_MP4_OUTPUT_PARAMS_H_
 
+#include <stdint.h>
+
+#include <string>
+
 namespace shaka {
 
 /// MP4 (ISO-BMFF) output related parameters.
@@ -20,6 +24,32 @@ struct Mp4OutputParams {
   /// Note that it is required by spec if segment_template contains $Times$
   /// specifier.
   bool generate_sidx_in_media_segments = true;
+  /// Single segment output only. If non-zero, space is reserved at the
+  /// beginning of the output file for a header with up to this many
+  /// subsegments, so the media data is written to the output file directly
+  /// instead of being copied from a temporary file in the end. Falls back to
+  /// the temporary file if there are more subsegments.
+  uint32_t reserved_subsegments = 0;
+  /// Multiple segment output only. If enabled, each fragment (CMAF chunk) is
+  /// written to the segment file as soon as it is finalized, with the segment
+  /// file kept open until the segment is complete, so the chunks can be
+  /// delivered with low latency, e.g. with HTTP chunked transfer encoding.
+  /// 'sidx' is not generated in the media segments in this mode.
+  bool low_latency_chunked_output = false;
+  /// Multiplexed output only, i.e. with several streams in one output. If
+  /// enabled, the fragments of the streams are finalized in parallel, once the
+  /// fragments of all the streams have ended, instead of one by one as each
+  /// of them ends. This shortens the work done at each fragment boundary, e.g.
+  /// the finalization of the encrypted fragments.
+  bool finalize_fragments_in_parallel = false;
+  /// Multiple segment output only. If not empty, the init segments are written
+  /// to this directory instead, named after the SHA-256 hash of their
+  /// content, and the manifests reference them there. An init segment which
+  /// is already in the directory, e.g. written by another job with the same
+  /// codec configuration and key, is not written again. The init segments do
+  /// not carry the creation time nor the media duration in this mode, so they
+  /// are byte-identical across jobs.
+  std::string init_segment_store;
 };
 
 }  // namespace shaka
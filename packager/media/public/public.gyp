@@ -16,7 +16,10 @@
         'ad_cue_generator_params.h',
         'chunking_params.h',
         'crypto_params.h',
+        'live_checkpoint_params.h',
+        'load_shedding_params.h',
         'mp4_output_params.h',
+        'vod_shard_params.h',
       ],
     },
   ],
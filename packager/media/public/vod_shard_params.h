@@ -0,0 +1,33 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_PUBLIC_VOD_SHARD_PARAMS_H_
+#define PACKAGER_MEDIA_PUBLIC_VOD_SHARD_PARAMS_H_
+
+namespace shaka {
+
+/// Parameters to package a time range, or shard, of a VOD input, so that the
+/// shards of a long title can be packaged on different machines. Each shard
+/// starts at the first key frame at or after its start time and ends before
+/// the first key frame at or after its end time, so consecutive shards cover
+/// the input exactly once. The segments keep the timestamps of the input, so
+/// with start and end times on segment boundaries, the shards produce the
+/// same segments as a single run.
+/// Only audio and video streams with segment templates using $Time$ are
+/// supported. The shards are merged with mpd_generator, from the media info
+/// written for each shard with --output_media_info.
+struct VodShardParams {
+  /// The start time of the shard, in seconds. Must be a multiple of the
+  /// segment duration.
+  double start_time_in_seconds = 0;
+  /// If positive, the end time of the shard, in seconds. Must be a multiple of
+  /// the segment duration. Otherwise the shard ends with the input.
+  double end_time_in_seconds = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_PUBLIC_VOD_SHARD_PARAMS_H_
@@ -6,22 +6,87 @@
 
 #include "packager/media/replicator/replicator.h"
 
+#include <iterator>
+
+#include "packager/base/bind.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/lock_free_queue.h"
+#include "packager/status_macros.h"
+
 namespace shaka {
 namespace media {
 
+struct Replicator::OutputWorker {
+  OutputWorker(size_t output_stream_index, size_t queue_size)
+      : output_stream_index(output_stream_index),
+        queue(queue_size),
+        flushed(base::WaitableEvent::ResetPolicy::MANUAL,
+                base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  const size_t output_stream_index;
+  // A null message requests a flush. The message is shared by the workers.
+  LockFreeQueue<std::shared_ptr<StreamData>> queue;
+  // Signaled after the downstream handler is flushed.
+  base::WaitableEvent flushed;
+  Status flush_status;
+  std::unique_ptr<ClosureThread> thread;
+};
+
+Replicator::Replicator() : Replicator(0) {}
+
+Replicator::Replicator(size_t output_queue_size)
+    : output_queue_size_(output_queue_size) {}
+
+Replicator::~Replicator() {
+  for (auto& worker : workers_)
+    worker->queue.Stop();
+  // The threads are joined when destroyed.
+  workers_.clear();
+}
+
 Status Replicator::InitializeInternal() {
+  if (output_queue_size_ == 0)
+    return Status::OK;
+
+  for (auto& out : output_handlers()) {
+    std::unique_ptr<OutputWorker> worker(
+        new OutputWorker(out.first, output_queue_size_));
+    worker->thread.reset(new ClosureThread(
+        "ReplicatorOutput",
+        base::Bind(&Replicator::OutputTask, base::Unretained(this),
+                   base::Unretained(worker.get()))));
+    worker->thread->Start();
+    workers_.push_back(std::move(worker));
+  }
   return Status::OK;
 }
 
 Status Replicator::Process(std::unique_ptr<StreamData> stream_data) {
   Status status;
 
-  for (auto& out : output_handlers()) {
-    std::unique_ptr<StreamData> copy(new StreamData(*stream_data));
-    copy->stream_index = out.first;
+  if (!workers_.empty()) {
+    RETURN_IF_ERROR(worker_status());
+    // The workers send their own copies, so one shared message is queued.
+    std::shared_ptr<StreamData> shared_stream_data(std::move(stream_data));
+    for (auto& worker : workers_)
+      RETURN_IF_ERROR(worker->queue.Push(shared_stream_data, kInfiniteTimeout));
+    return Status::OK;
+  }
 
+  // The copies share the payloads, which are immutable; a handler which
+  // modifies a sample, e.g. to encrypt it, creates a new one. The last output
+  // gets the original message.
+  if (output_handlers().empty())
+    return status;
+  const auto last_output = std::prev(output_handlers().end());
+  for (auto it = output_handlers().begin(); it != last_output; ++it) {
+    std::unique_ptr<StreamData> copy(new StreamData(*stream_data));
+    copy->stream_index = it->first;
     status.Update(Dispatch(std::move(copy)));
   }
+  stream_data->stream_index = last_output->first;
+  status.Update(Dispatch(std::move(stream_data)));
 
   return status;
 }
@@ -32,7 +97,57 @@ bool Replicator::ValidateOutputStreamIndex(size_t stream_index) const {
 
 Status Replicator::OnFlushRequest(size_t input_stream_index) {
   DCHECK_EQ(input_stream_index, 0u);
-  return FlushAllDownstreams();
+  if (workers_.empty())
+    return FlushAllDownstreams();
+
+  for (auto& worker : workers_)
+    RETURN_IF_ERROR(worker->queue.Push(nullptr, kInfiniteTimeout));
+
+  Status status;
+  for (auto& worker : workers_) {
+    worker->flushed.Wait();
+    status.Update(worker->flush_status);
+  }
+  status.Update(worker_status());
+  return status;
+}
+
+void Replicator::OutputTask(OutputWorker* worker) {
+  while (true) {
+    std::shared_ptr<StreamData> stream_data;
+    if (!worker->queue.Pop(&stream_data, kInfiniteTimeout).ok() ||
+        worker->queue.Stopped()) {
+      return;
+    }
+
+    if (!stream_data) {
+      worker->flush_status = FlushDownstream(worker->output_stream_index);
+      worker->flushed.Signal();
+      return;
+    }
+
+    // Keep draining the queue after an error so Process() does not block.
+    if (!worker_status().ok())
+      continue;
+
+    // The last worker to get the message, which the others have released,
+    // takes it over instead of copying it.
+    std::unique_ptr<StreamData> copy(
+        stream_data.use_count() == 1 ? new StreamData(std::move(*stream_data))
+                                     : new StreamData(*stream_data));
+    stream_data.reset();
+    copy->stream_index = worker->output_stream_index;
+    Status status = Dispatch(std::move(copy));
+    if (!status.ok()) {
+      base::AutoLock scoped_lock(lock_);
+      worker_status_.Update(status);
+    }
+  }
+}
+
+Status Replicator::worker_status() {
+  base::AutoLock scoped_lock(lock_);
+  return worker_status_;
 }
 
 }  // namespace media
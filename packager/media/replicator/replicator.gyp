@@ -20,5 +20,19 @@
         '../base/media_base.gyp:media_base',
       ],
     },
+    {
+      'target_name': 'replicator_unittest',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'replicator_unittest.cc',
+      ],
+      'dependencies': [
+        '../../testing/gtest.gyp:gtest',
+        '../../testing/gmock.gyp:gmock',
+        '../base/media_base.gyp:media_handler_test_base',
+        '../test/media_test.gyp:media_test_support',
+        'replicator',
+      ]
+    },
   ],
 }
@@ -7,6 +7,10 @@
 #ifndef PACKAGER_MEDIA_REPLICATOR_HANDLER_H_
 #define PACKAGER_MEDIA_REPLICATOR_HANDLER_H_
 
+#include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/media_handler.h"
 
 namespace shaka {
@@ -17,11 +21,37 @@ namespace media {
 /// they are the original message. It is the responsibility of downstream
 /// handlers to make a copy before modifying the message.
 class Replicator : public MediaHandler {
+ public:
+  /// Create a replicator which sends the messages to the downstream handlers
+  /// on the calling thread.
+  Replicator();
+  /// Create a replicator which sends the messages to each downstream handler
+  /// on its own thread, so the outputs are processed in parallel.
+  /// @param output_queue_size is the maximum number of messages queued for
+  ///        each output. Process() blocks when a queue is full. Zero means
+  ///        the messages are sent on the calling thread.
+  explicit Replicator(size_t output_queue_size);
+  ~Replicator() override;
+
  private:
+  struct OutputWorker;
+
   Status InitializeInternal() override;
   Status Process(std::unique_ptr<StreamData> stream_data) override;
   bool ValidateOutputStreamIndex(size_t stream_index) const override;
   Status OnFlushRequest(size_t input_stream_index) override;
+
+  // Sends the messages queued for |worker| downstream, until a flush or stop.
+  void OutputTask(OutputWorker* worker);
+  Status worker_status();
+
+  const size_t output_queue_size_;
+  std::vector<std::unique_ptr<OutputWorker>> workers_;
+  base::Lock lock_;
+  // The first error returned by the downstream handlers of the workers.
+  Status worker_status_;
+
+  DISALLOW_COPY_AND_ASSIGN(Replicator);
 };
 
 }  // namespace media
@@ -0,0 +1,92 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/replicator/replicator.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Sequence;
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kStreamIndex = 0;
+const size_t kInputs = 1;
+const size_t kOutputs = 3;
+const size_t kInput = 0;
+const uint32_t kTimeScale = 1000;
+const int64_t kDuration = 100;
+const bool kKeyFrame = true;
+const bool kEncrypted = true;
+const int kNumSamples = 20;
+
+}  // namespace
+
+class ReplicatorTest : public MediaHandlerTestBase,
+                       public ::testing::WithParamInterface<size_t> {};
+
+TEST_P(ReplicatorTest, SendsAllMessagesInOrderToEachOutput) {
+  ASSERT_OK(SetUpAndInitializeGraph(std::make_shared<Replicator>(GetParam()),
+                                    kInputs, kOutputs));
+
+  for (size_t output = 0; output < kOutputs; ++output) {
+    Sequence sequence;
+    EXPECT_CALL(*Output(output),
+                OnProcess(IsStreamInfo(kStreamIndex, kTimeScale, !kEncrypted,
+                                       _)))
+        .InSequence(sequence);
+    for (int i = 0; i < kNumSamples; ++i) {
+      EXPECT_CALL(*Output(output),
+                  OnProcess(IsMediaSample(kStreamIndex, i * kDuration,
+                                          kDuration, !kEncrypted, kKeyFrame)))
+          .InSequence(sequence);
+    }
+    EXPECT_CALL(*Output(output), OnFlush(kStreamIndex)).InSequence(sequence);
+  }
+
+  ASSERT_OK(Input(kInput)->Dispatch(
+      StreamData::FromStreamInfo(kStreamIndex, GetAudioStreamInfo(kTimeScale))));
+  for (int i = 0; i < kNumSamples; ++i) {
+    ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, kKeyFrame))));
+  }
+  // Returns after all the outputs are flushed.
+  ASSERT_OK(Input(kInput)->FlushAllDownstreams());
+}
+
+TEST_P(ReplicatorTest, OutputsShareThePayloads) {
+  ASSERT_OK(SetUpAndInitializeGraph(std::make_shared<Replicator>(GetParam()),
+                                    kInputs, kOutputs));
+
+  std::shared_ptr<MediaSample> sample =
+      GetMediaSample(0, kDuration, kKeyFrame);
+  const uint8_t* const payload = sample->data();
+  for (size_t output = 0; output < kOutputs; ++output) {
+    EXPECT_CALL(*Output(output), OnProcess(_))
+        .WillOnce(Invoke([payload](const StreamData* stream_data) {
+          // No replica pays for a copy of the payload.
+          EXPECT_EQ(payload, stream_data->media_sample->data());
+        }));
+    EXPECT_CALL(*Output(output), OnFlush(kStreamIndex));
+  }
+
+  ASSERT_OK(Input(kInput)->Dispatch(
+      StreamData::FromMediaSample(kStreamIndex, std::move(sample))));
+  ASSERT_OK(Input(kInput)->FlushAllDownstreams());
+}
+
+INSTANTIATE_TEST_CASE_P(OutputQueueSizes,
+                        ReplicatorTest,
+                        ::testing::Values(0u, 1u, 4u));
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,223 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/memory_file.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/raw_key_source.h"
+#include "packager/media/base/sample_buffer_pool.h"
+#include "packager/media/chunking/chunking_handler.h"
+#include "packager/media/crypto/encryption_handler.h"
+#include "packager/media/formats/mp2t/ts_muxer.h"
+#include "packager/media/formats/mp4/mp4_muxer.h"
+#include "packager/media/test/allocation_counter.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint32_t kTimeScale = 1000;
+const int64_t kSampleDuration = 20;
+// The samples sent before counting, so that the init segment is written and
+// the pools and buffers of the handlers have grown to their steady size.
+const size_t kWarmUpSamples = 200;
+const size_t kCountedSamples = 1000;
+
+// The allocations allowed per sample in the steady state, including the
+// segments written every 50 samples. Each budget is the count the test records
+// as the "allocations_per_sample" property plus at most kAllocationMargin, so
+// that a new allocation per sample fails the test, and a budget left above
+// that after the hot paths allocate less fails it too.
+const double kAllocationMargin = 1;
+const double kClearMp4AllocationBudget = 4;
+const double kEncryptedMp4AllocationBudget = 10;
+const double kTsAllocationBudget = 6;
+
+// AAC-LC, 44.1 kHz, stereo.
+const uint8_t kAacCodecConfig[] = {0x12, 0x10};
+
+const uint8_t kKeyId[] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+const uint8_t kKey[] = {
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+};
+const uint8_t kIv[] = {
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+};
+
+}  // namespace
+
+// Sends samples through the main pipelines and fails if the steady state
+// allocates more per sample than its budget, so the pooling and zero-copy
+// work on the hot paths does not regress unnoticed.
+class AllocationBudgetTest : public MediaHandlerTestBase {
+ protected:
+  // The jobs run with a buffer pool installed on their thread, so the sample
+  // buffers are recycled like in the packager.
+  void SetUp() override {
+    scoped_buffer_pool_.reset(new ScopedSampleBufferPool(&buffer_pool_));
+  }
+
+  void TearDown() override {
+    MemoryFile::DeleteAll();
+    scoped_buffer_pool_.reset();
+  }
+
+  std::shared_ptr<StreamInfo> GetAacStreamInfo() const {
+    return std::make_shared<AudioStreamInfo>(
+        1 /* track_id */, kTimeScale, 0 /* duration */, kCodecAAC, "mp4a.40.2",
+        kAacCodecConfig, sizeof(kAacCodecConfig), 16 /* sample_bits */,
+        2 /* num_channels */, 44100 /* sampling_frequency */,
+        0 /* seek_preroll_ns */, 0 /* codec_delay_ns */, 0 /* max_bitrate */,
+        0 /* avg_bitrate */, "eng", false /* is_encrypted */);
+  }
+
+  std::shared_ptr<MediaHandler> GetChunkingHandler() const {
+    ChunkingParams chunking_params;
+    chunking_params.segment_duration_in_seconds = 1;
+    return std::make_shared<ChunkingHandler>(chunking_params);
+  }
+
+  std::shared_ptr<MediaHandler> GetEncryptionHandler() {
+    RawKeyParams raw_key;
+    raw_key.iv.assign(kIv, kIv + sizeof(kIv));
+    raw_key.key_map[""].key_id.assign(kKeyId, kKeyId + sizeof(kKeyId));
+    raw_key.key_map[""].key.assign(kKey, kKey + sizeof(kKey));
+    key_source_ = RawKeySource::Create(raw_key);
+
+    EncryptionParams encryption_params;
+    encryption_params.key_provider = KeyProvider::kRawKey;
+    encryption_params.raw_key = raw_key;
+    encryption_params.stream_label_func =
+        [](const EncryptionParams::EncryptedStreamAttributes&) {
+          return std::string();
+        };
+    return std::make_shared<EncryptionHandler>(encryption_params,
+                                               key_source_.get());
+  }
+
+  MuxerOptions GetMuxerOptions(const std::string& name,
+                               const std::string& extension) const {
+    MuxerOptions muxer_options;
+    muxer_options.segment_template =
+        "memory://allocation/" + name + "_$Number$." + extension;
+    if (extension != "ts")
+      muxer_options.output_file_name = "memory://allocation/" + name + ".mp4";
+    return muxer_options;
+  }
+
+  // Sends the stream info and |kWarmUpSamples| samples through |handlers|,
+  // then |kCountedSamples| more samples while counting the allocations.
+  // @return the number of allocations per counted sample.
+  double GetAllocationsPerSample(
+      std::shared_ptr<StreamInfo> stream_info,
+      const std::vector<std::shared_ptr<MediaHandler>>& handlers) {
+    auto input = std::make_shared<FakeInputMediaHandler>();
+    std::vector<std::shared_ptr<MediaHandler>> chain = {input};
+    chain.insert(chain.end(), handlers.begin(), handlers.end());
+    EXPECT_OK(MediaHandler::Chain(chain));
+    EXPECT_OK(input->Initialize());
+    EXPECT_OK(input->Dispatch(StreamData::FromStreamInfo(0, stream_info)));
+
+    // The samples are created upfront, as the demuxer would have allocated
+    // them.
+    std::vector<std::unique_ptr<StreamData>> samples;
+    for (size_t i = 0; i < kWarmUpSamples + kCountedSamples; ++i) {
+      samples.push_back(StreamData::FromMediaSample(
+          0, GetMediaSample(i * kSampleDuration, kSampleDuration,
+                            true /* is_keyframe */)));
+    }
+    for (size_t i = 0; i < kWarmUpSamples; ++i)
+      EXPECT_OK(input->Dispatch(std::move(samples[i])));
+
+    uint64_t allocations = 0;
+    {
+      AllocationCounter counter;
+      for (size_t i = kWarmUpSamples; i < samples.size(); ++i)
+        EXPECT_OK(input->Dispatch(std::move(samples[i])));
+      allocations = counter.allocations();
+    }
+    EXPECT_OK(input->FlushAllDownstreams());
+    const double allocations_per_sample =
+        static_cast<double>(allocations) / kCountedSamples;
+    RecordProperty("allocations_per_sample",
+                   std::to_string(allocations_per_sample));
+    return allocations_per_sample;
+  }
+
+  static void ExpectWithinBudget(double allocations_per_sample,
+                                 double budget) {
+    EXPECT_LE(allocations_per_sample, budget)
+        << allocations_per_sample << " allocations per sample.";
+    EXPECT_GE(allocations_per_sample + kAllocationMargin, budget)
+        << "Only " << allocations_per_sample
+        << " allocations per sample. Lower the budget.";
+  }
+
+ private:
+  std::unique_ptr<KeySource> key_source_;
+  SampleBufferPool buffer_pool_;
+  std::unique_ptr<ScopedSampleBufferPool> scoped_buffer_pool_;
+};
+
+TEST_F(AllocationBudgetTest, CountsAllocations) {
+  AllocationCounter counter;
+  std::unique_ptr<std::string> allocated(new std::string(100, 'a'));
+  EXPECT_GE(counter.allocations(), 1u);
+  EXPECT_GE(counter.allocated_bytes(), 100u);
+}
+
+TEST_F(AllocationBudgetTest, SampleBufferPoolHitDoesNotAllocate) {
+  SampleBufferPool pool;
+  // The first buffer and its control block come from the heap, then go back
+  // to the pool.
+  pool.Acquire(1000);
+  AllocationCounter counter;
+  {
+    std::shared_ptr<uint8_t> buffer = pool.Acquire(1000);
+    std::shared_ptr<uint8_t> copy = buffer;
+  }
+  EXPECT_EQ(1u, pool.hits());
+  EXPECT_EQ(0u, counter.allocations());
+}
+
+TEST_F(AllocationBudgetTest, ClearMp4) {
+  const double allocations_per_sample = GetAllocationsPerSample(
+      GetAacStreamInfo(),
+      {GetChunkingHandler(),
+       std::make_shared<mp4::MP4Muxer>(GetMuxerOptions("clear", "m4s"))});
+  ExpectWithinBudget(allocations_per_sample, kClearMp4AllocationBudget);
+}
+
+TEST_F(AllocationBudgetTest, EncryptedMp4) {
+  const double allocations_per_sample = GetAllocationsPerSample(
+      GetAacStreamInfo(),
+      {GetChunkingHandler(), GetEncryptionHandler(),
+       std::make_shared<mp4::MP4Muxer>(GetMuxerOptions("encrypted", "m4s"))});
+  ExpectWithinBudget(allocations_per_sample, kEncryptedMp4AllocationBudget);
+}
+
+TEST_F(AllocationBudgetTest, Ts) {
+  const double allocations_per_sample = GetAllocationsPerSample(
+      GetAacStreamInfo(),
+      {GetChunkingHandler(),
+       std::make_shared<mp2t::TsMuxer>(GetMuxerOptions("clear", "ts"))});
+  ExpectWithinBudget(allocations_per_sample, kTsAllocationBudget);
+}
+
+}  // namespace media
+}  // namespace shaka
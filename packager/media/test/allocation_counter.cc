@@ -0,0 +1,101 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/test/allocation_counter.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+namespace {
+
+std::atomic<int> g_num_counters{0};
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+void* Allocate(size_t size) {
+  if (g_num_counters.load(std::memory_order_relaxed) > 0) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  // malloc(0) may return null.
+  return malloc(size > 0 ? size : 1);
+}
+
+void* AllocateOrDie(size_t size) {
+  void* ptr = Allocate(size);
+  // Logging would allocate.
+  if (!ptr)
+    abort();
+  return ptr;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  return AllocateOrDie(size);
+}
+
+void* operator new[](size_t size) {
+  return AllocateOrDie(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+namespace shaka {
+namespace media {
+
+AllocationCounter::AllocationCounter()
+    : start_allocations_(g_allocations.load()),
+      start_allocated_bytes_(g_allocated_bytes.load()) {
+  g_num_counters.fetch_add(1);
+}
+
+AllocationCounter::~AllocationCounter() {
+  g_num_counters.fetch_sub(1);
+}
+
+uint64_t AllocationCounter::allocations() const {
+  return g_allocations.load() - start_allocations_;
+}
+
+uint64_t AllocationCounter::allocated_bytes() const {
+  return g_allocated_bytes.load() - start_allocated_bytes_;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,41 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_TEST_ALLOCATION_COUNTER_H_
+#define PACKAGER_MEDIA_TEST_ALLOCATION_COUNTER_H_
+
+#include <stdint.h>
+
+namespace shaka {
+namespace media {
+
+/// Counts the heap allocations made with operator new, on any thread, while
+/// it is alive, e.g. to check that the steady state of a MediaHandler graph
+/// does not regress to allocating more per sample. Linking it replaces the
+/// global operator new and delete of the test binary; they only count while
+/// a counter is alive.
+class AllocationCounter {
+ public:
+  AllocationCounter();
+  ~AllocationCounter();
+
+  /// @return the number of allocations since the counter was created.
+  uint64_t allocations() const;
+  /// @return the number of bytes allocated since the counter was created.
+  uint64_t allocated_bytes() const;
+
+ private:
+  AllocationCounter(const AllocationCounter&) = delete;
+  AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+  const uint64_t start_allocations_;
+  const uint64_t start_allocated_bytes_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_TEST_ALLOCATION_COUNTER_H_
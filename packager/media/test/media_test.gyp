@@ -31,5 +31,33 @@
         'run_tests_with_atexit_manager',
       ],
     },
+    {
+      # Replaces the global operator new and delete of the binaries linking it.
+      'target_name': 'allocation_counter',
+      'type': 'static_library',
+      'sources': [
+        'allocation_counter.cc',
+        'allocation_counter.h',
+      ],
+    },
+    {
+      'target_name': 'allocation_budget_unittest',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'allocation_budget_unittest.cc',
+      ],
+      'dependencies': [
+        '../../file/file.gyp:file',
+        '../../testing/gtest.gyp:gtest',
+        '../base/media_base.gyp:media_base',
+        '../base/media_base.gyp:media_handler_test_base',
+        '../chunking/chunking.gyp:chunking',
+        '../crypto/crypto.gyp:crypto',
+        '../formats/mp2t/mp2t.gyp:mp2t',
+        '../formats/mp4/mp4.gyp:mp4',
+        'allocation_counter',
+        'run_tests_with_atexit_manager',
+      ],
+    },
   ],
 }
@@ -300,5 +300,60 @@ TEST_F(TrickPlayHandlerTest, TrickTrackWithSamplesAndSegments) {
   ASSERT_OK(Flush());
 }
 
+// This test makes sure that a handler with several factors outputs a trick
+// play stream per factor.
+TEST_F(TrickPlayHandlerTest, MultipleFactors) {
+  const size_t kTwoOutputs = 2;
+  const size_t kOutput1Index = 1;
+  const uint32_t kTrickPlayFactor0 = 1u;
+  const uint32_t kTrickPlayFactor1 = 2u;
+
+  const int64_t kFrameDuration = 100;
+  const int64_t kFrame0 = 0;
+  const int64_t kFrame1 = 100;
+  const int64_t kFrame2 = 200;
+  const int64_t kFrame3 = 300;
+
+  // Every frame is a key frame.
+  const int64_t kPlayRate0 = 1;
+  const int64_t kPlayRate1 = 2;
+  const int64_t kTrickPlayDuration1 = kFrameDuration * 2;
+
+  auto handler = std::make_shared<TrickPlayHandler>(kTrickPlayFactor0);
+  handler->AddFactor(kTrickPlayFactor1);
+  ASSERT_OK(MediaHandlerTestBase::SetUpAndInitializeGraph(handler, kInputCount,
+                                                          kTwoOutputs));
+
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(kOutputIndex),
+                OnProcess(IsVideoStream(_, kTrickPlayFactor0, kPlayRate0)));
+    for (int64_t frame : {kFrame0, kFrame1, kFrame2, kFrame3}) {
+      EXPECT_CALL(
+          *Output(kOutputIndex),
+          OnProcess(IsMediaSample(_, frame, kFrameDuration, _, kKeyFrame)));
+    }
+    EXPECT_CALL(*Output(kOutputIndex), OnFlush(_));
+  }
+
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(kOutput1Index),
+                OnProcess(IsVideoStream(_, kTrickPlayFactor1, kPlayRate1)));
+    EXPECT_CALL(*Output(kOutput1Index),
+                OnProcess(IsMediaSample(_, kFrame0, kTrickPlayDuration1, _,
+                                        kKeyFrame)));
+    EXPECT_CALL(*Output(kOutput1Index),
+                OnProcess(IsMediaSample(_, kFrame2, kTrickPlayDuration1, _,
+                                        kKeyFrame)));
+    EXPECT_CALL(*Output(kOutput1Index), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchVideoInfo());
+  for (int64_t frame : {kFrame0, kFrame1, kFrame2, kFrame3})
+    ASSERT_OK(DispatchSample(frame, kFrameDuration, kKeyFrame));
+  ASSERT_OK(Flush());
+}
+
 }  // namespace media
 }  // namespace shaka
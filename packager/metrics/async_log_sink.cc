@@ -0,0 +1,283 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/async_log_sink.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace {
+
+// The pending messages are written at least this often.
+const int64_t kFlushIntervalMs = 50;
+
+std::atomic<AsyncLogSink*> g_sink{nullptr};
+
+}  // namespace
+
+struct AsyncLogSink::Record {
+  uint64_t sequence_number;
+  std::string message;
+
+  bool operator<(const Record& other) const {
+    return sequence_number < other.sequence_number;
+  }
+};
+
+// A single producer, single consumer ring buffer of messages, each stored as
+// its sequence number, its size and its bytes. Only the logging thread writes
+// to it and only the flusher, holding |lock_|, reads from it.
+class AsyncLogSink::ThreadBuffer {
+ public:
+  explicit ThreadBuffer(size_t capacity) : data_(capacity) {}
+
+  size_t capacity() const { return data_.size(); }
+
+  // Returns false if there is not enough free space.
+  bool TryWrite(uint64_t sequence_number, const std::string& message) {
+    const uint32_t size = static_cast<uint32_t>(message.size());
+    const uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    const uint64_t read_pos = read_pos_.load(std::memory_order_acquire);
+    if (capacity() - (write_pos - read_pos) <
+        sizeof(sequence_number) + sizeof(size) + size) {
+      return false;
+    }
+    uint64_t pos = write_pos;
+    Copy(&sequence_number, sizeof(sequence_number), &pos);
+    Copy(&size, sizeof(size), &pos);
+    Copy(message.data(), size, &pos);
+    write_pos_.store(pos, std::memory_order_release);
+    return true;
+  }
+
+  // Returns true if more than half of the buffer is used.
+  bool IsHalfFull() const {
+    return 2 * (write_pos_.load(std::memory_order_relaxed) -
+                read_pos_.load(std::memory_order_relaxed)) >
+           capacity();
+  }
+
+  void Drain(std::vector<Record>* records) {
+    const uint64_t write_pos = write_pos_.load(std::memory_order_acquire);
+    uint64_t pos = read_pos_.load(std::memory_order_relaxed);
+    while (pos < write_pos) {
+      Record record;
+      uint32_t size = 0;
+      Read(&record.sequence_number, sizeof(record.sequence_number), &pos);
+      Read(&size, sizeof(size), &pos);
+      record.message.resize(size);
+      Read(&record.message[0], size, &pos);
+      records->push_back(std::move(record));
+    }
+    read_pos_.store(pos, std::memory_order_release);
+  }
+
+  // Set when the logging thread requested a flush, until the next Drain().
+  std::atomic<bool> flush_requested{false};
+
+ private:
+  void Copy(const void* source, size_t size, uint64_t* pos) {
+    const size_t offset = *pos % capacity();
+    const size_t first_chunk_size = std::min(size, capacity() - offset);
+    memcpy(&data_[offset], source, first_chunk_size);
+    memcpy(data_.data(), static_cast<const char*>(source) + first_chunk_size,
+           size - first_chunk_size);
+    *pos += size;
+  }
+
+  void Read(void* destination, size_t size, uint64_t* pos) {
+    const size_t offset = *pos % capacity();
+    const size_t first_chunk_size = std::min(size, capacity() - offset);
+    memcpy(destination, &data_[offset], first_chunk_size);
+    memcpy(static_cast<char*>(destination) + first_chunk_size, data_.data(),
+           size - first_chunk_size);
+    *pos += size;
+  }
+
+  std::vector<char> data_;
+  std::atomic<uint64_t> write_pos_{0};
+  std::atomic<uint64_t> read_pos_{0};
+};
+
+// Owned by a thread_local of the logging thread, to release its buffer when
+// the thread exits.
+class AsyncLogSink::ThreadBufferHolder {
+ public:
+  ThreadBufferHolder() {}
+  ~ThreadBufferHolder() { Reset(nullptr, nullptr); }
+
+  AsyncLogSink* sink() const { return sink_; }
+  ThreadBuffer* buffer() const { return buffer_; }
+
+  void Reset(AsyncLogSink* sink, ThreadBuffer* buffer) {
+    if (sink_)
+      sink_->ReleaseThreadBuffer(buffer_);
+    sink_ = sink;
+    buffer_ = buffer;
+  }
+
+ private:
+  // Sinks are never deleted, so this stays valid.
+  AsyncLogSink* sink_ = nullptr;
+  ThreadBuffer* buffer_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadBufferHolder);
+};
+
+class AsyncLogSink::FlusherThread : public base::SimpleThread {
+ public:
+  explicit FlusherThread(AsyncLogSink* sink)
+      : base::SimpleThread("AsyncLogSink"), sink_(sink) {}
+
+  void Run() override { sink_->FlusherLoop(); }
+
+ private:
+  AsyncLogSink* const sink_;
+};
+
+AsyncLogSink::AsyncLogSink(size_t buffer_size_per_thread, FILE* output)
+    : buffer_size_per_thread_(buffer_size_per_thread),
+      output_(output),
+      flush_requested_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                       base::WaitableEvent::InitialState::NOT_SIGNALED),
+      flusher_thread_(new FlusherThread(this)) {
+  DCHECK_GT(buffer_size_per_thread_, 0u);
+  flusher_thread_->Start();
+}
+
+AsyncLogSink::~AsyncLogSink() {}
+
+// static
+void AsyncLogSink::Install(size_t buffer_size_per_thread, FILE* output) {
+  Uninstall();
+  g_sink.store(new AsyncLogSink(buffer_size_per_thread, output));
+  logging::SetLogMessageHandler(&AsyncLogSink::HandleLogMessage);
+}
+
+// static
+void AsyncLogSink::Uninstall() {
+  AsyncLogSink* sink = g_sink.exchange(nullptr);
+  if (!sink)
+    return;
+  logging::SetLogMessageHandler(nullptr);
+  sink->stopping_.store(true);
+  sink->flush_requested_.Signal();
+  sink->flusher_thread_->Join();
+  base::AutoLock scoped_lock(sink->lock_);
+  sink->FlushLocked();
+}
+
+// static
+void AsyncLogSink::Flush() {
+  AsyncLogSink* sink = g_sink.load();
+  if (!sink)
+    return;
+  base::AutoLock scoped_lock(sink->lock_);
+  sink->FlushLocked();
+}
+
+// static
+uint64_t AsyncLogSink::num_dropped_messages() {
+  AsyncLogSink* sink = g_sink.load();
+  return sink ? sink->num_dropped_messages_.load() : 0;
+}
+
+// static
+bool AsyncLogSink::HandleLogMessage(int severity,
+                                    const char* file,
+                                    int line,
+                                    size_t message_start,
+                                    const std::string& str) {
+  AsyncLogSink* sink = g_sink.load(std::memory_order_acquire);
+  if (!sink)
+    return false;
+  // The default handling of FATAL messages aborts after writing them.
+  if (severity >= logging::LOG_FATAL) {
+    Flush();
+    return false;
+  }
+  return sink->Log(str);
+}
+
+bool AsyncLogSink::Log(const std::string& str) {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  if (str.size() + sizeof(uint64_t) + sizeof(uint32_t) > buffer->capacity())
+    return false;
+  if (!buffer->TryWrite(next_sequence_number_.fetch_add(1), str))
+    num_dropped_messages_.fetch_add(1, std::memory_order_relaxed);
+  if (buffer->IsHalfFull() && !buffer->flush_requested.exchange(true))
+    flush_requested_.Signal();
+  return true;
+}
+
+void AsyncLogSink::FlusherLoop() {
+  while (!stopping_.load()) {
+    flush_requested_.TimedWait(
+        base::TimeDelta::FromMilliseconds(kFlushIntervalMs));
+    base::AutoLock scoped_lock(lock_);
+    FlushLocked();
+  }
+}
+
+void AsyncLogSink::FlushLocked() {
+  lock_.AssertAcquired();
+  std::vector<Record> records;
+  for (const std::unique_ptr<ThreadBuffer>& buffer : thread_buffers_) {
+    buffer->Drain(&records);
+    buffer->flush_requested.store(false);
+  }
+  std::sort(records.begin(), records.end());
+  for (const Record& record : records)
+    fwrite(record.message.data(), 1, record.message.size(), output_);
+
+  bool written = !records.empty();
+  const uint64_t num_dropped_messages = num_dropped_messages_.load();
+  if (num_dropped_messages > num_reported_dropped_messages_) {
+    written = true;
+    fprintf(output_,
+            "%llu log messages dropped as the log buffers were full.\n",
+            static_cast<unsigned long long>(num_dropped_messages -
+                                            num_reported_dropped_messages_));
+    num_reported_dropped_messages_ = num_dropped_messages;
+  }
+  if (written)
+    fflush(output_);
+}
+
+AsyncLogSink::ThreadBuffer* AsyncLogSink::GetThreadBuffer() {
+  static thread_local ThreadBufferHolder holder;
+  if (holder.sink() != this) {
+    std::unique_ptr<ThreadBuffer> buffer(
+        new ThreadBuffer(buffer_size_per_thread_));
+    ThreadBuffer* thread_buffer = buffer.get();
+    {
+      base::AutoLock scoped_lock(lock_);
+      thread_buffers_.push_back(std::move(buffer));
+    }
+    holder.Reset(this, thread_buffer);
+  }
+  return holder.buffer();
+}
+
+void AsyncLogSink::ReleaseThreadBuffer(ThreadBuffer* buffer) {
+  base::AutoLock scoped_lock(lock_);
+  // Write the remaining messages of the thread in order with the others.
+  FlushLocked();
+  auto iter = std::find_if(thread_buffers_.begin(), thread_buffers_.end(),
+                           [buffer](const std::unique_ptr<ThreadBuffer>& item) {
+                             return item.get() == buffer;
+                           });
+  DCHECK(iter != thread_buffers_.end());
+  thread_buffers_.erase(iter);
+}
+
+}  // namespace shaka
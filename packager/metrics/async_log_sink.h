@@ -0,0 +1,96 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_ASYNC_LOG_SINK_H_
+#define PACKAGER_METRICS_ASYNC_LOG_SINK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+
+namespace shaka {
+
+/// Takes over the output of LOG / VLOG so that logging does not block the
+/// logging threads on the output, e.g. with verbose logging enabled during
+/// live packaging. A message is copied to a ring buffer of the logging thread,
+/// without taking any lock, and written out by a background thread, which
+/// sorts the messages of all the threads in the order they were logged. The
+/// messages logged while the buffer of a thread is full are dropped and
+/// counted. FATAL messages are written synchronously, after the pending
+/// messages.
+class AsyncLogSink {
+ public:
+  /// Route the log messages to a new sink until Uninstall() is called. The
+  /// sinks are never deleted, as other threads may still be logging.
+  /// @param buffer_size_per_thread is the size of the ring buffer of each
+  ///        logging thread, in bytes. Messages larger than it are written
+  ///        synchronously.
+  /// @param output is where the messages are written, e.g. stderr.
+  static void Install(size_t buffer_size_per_thread, FILE* output);
+  /// Write the pending messages and restore the synchronous logging.
+  static void Uninstall();
+  /// Write the pending messages, if a sink is installed.
+  static void Flush();
+
+  /// @return the number of messages dropped so far, if a sink is installed.
+  static uint64_t num_dropped_messages();
+
+ private:
+  class ThreadBuffer;
+  class ThreadBufferHolder;
+  struct Record;
+
+  AsyncLogSink(size_t buffer_size_per_thread, FILE* output);
+  ~AsyncLogSink();
+
+  static bool HandleLogMessage(int severity,
+                               const char* file,
+                               int line,
+                               size_t message_start,
+                               const std::string& str);
+
+  // Returns false if the message was not buffered and should be written
+  // synchronously.
+  bool Log(const std::string& str);
+  void FlusherLoop();
+  void FlushLocked();
+  ThreadBuffer* GetThreadBuffer();
+  // Write the pending messages and delete |buffer|, whose thread is exiting or
+  // logging to another sink.
+  void ReleaseThreadBuffer(ThreadBuffer* buffer);
+
+  const size_t buffer_size_per_thread_;
+  FILE* const output_;
+  // Orders the messages across threads.
+  std::atomic<uint64_t> next_sequence_number_{0};
+  std::atomic<uint64_t> num_dropped_messages_{0};
+  uint64_t num_reported_dropped_messages_ = 0;
+
+  // Protects |thread_buffers_| and serializes the flushes.
+  base::Lock lock_;
+  // The buffers of the threads logging to this sink. A buffer is flushed and
+  // removed when its thread exits.
+  std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers_;
+  // Signaled to wake up the flusher early, e.g. when a buffer gets half full.
+  base::WaitableEvent flush_requested_;
+  std::atomic<bool> stopping_{false};
+  class FlusherThread;
+  std::unique_ptr<FlusherThread> flusher_thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncLogSink);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_ASYNC_LOG_SINK_H_
@@ -0,0 +1,94 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/async_log_sink.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <thread>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace {
+
+std::string ReadAll(FILE* file) {
+  std::string content;
+  rewind(file);
+  char buffer[4096];
+  while (size_t size = fread(buffer, 1, sizeof(buffer), file))
+    content.append(buffer, size);
+  return content;
+}
+
+}  // namespace
+
+class AsyncLogSinkTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    output_ = tmpfile();
+    ASSERT_TRUE(output_);
+  }
+
+  void TearDown() override {
+    AsyncLogSink::Uninstall();
+    fclose(output_);
+  }
+
+  FILE* output_ = nullptr;
+};
+
+TEST_F(AsyncLogSinkTest, WritesMessagesInOrder) {
+  AsyncLogSink::Install(1 << 16, output_);
+  LOG(WARNING) << "first message";
+  std::thread([]() { LOG(WARNING) << "second message"; }).join();
+  LOG(WARNING) << "third message";
+  AsyncLogSink::Uninstall();
+
+  const std::string content = ReadAll(output_);
+  const size_t first = content.find("first message");
+  const size_t second = content.find("second message");
+  const size_t third = content.find("third message");
+  ASSERT_NE(std::string::npos, first);
+  ASSERT_NE(std::string::npos, second);
+  ASSERT_NE(std::string::npos, third);
+  EXPECT_LT(first, second);
+  EXPECT_LT(second, third);
+}
+
+TEST_F(AsyncLogSinkTest, DropsMessagesWhenBufferIsFull) {
+  AsyncLogSink::Install(256, output_);
+  // Logged faster than the flusher wakes up.
+  for (int i = 0; i < 1000; ++i)
+    LOG(WARNING) << "message " << i;
+  AsyncLogSink::Flush();
+  EXPECT_GT(AsyncLogSink::num_dropped_messages(), 0u);
+  AsyncLogSink::Uninstall();
+
+  const std::string content = ReadAll(output_);
+  EXPECT_NE(std::string::npos, content.find("message 0"));
+  EXPECT_NE(std::string::npos, content.find("log messages dropped"));
+}
+
+TEST_F(AsyncLogSinkTest, FlushesBufferWhenThreadExits) {
+  AsyncLogSink::Install(1 << 16, output_);
+  std::thread([]() { LOG(WARNING) << "exiting thread message"; }).join();
+  // Written when the buffer of the thread is released, without a flush.
+  EXPECT_NE(std::string::npos,
+            ReadAll(output_).find("exiting thread message"));
+}
+
+TEST_F(AsyncLogSinkTest, NotUsedAfterUninstall) {
+  AsyncLogSink::Install(1 << 16, output_);
+  AsyncLogSink::Uninstall();
+  LOG(WARNING) << "synchronous message";
+  AsyncLogSink::Flush();
+  EXPECT_EQ(std::string::npos,
+            ReadAll(output_).find("synchronous message"));
+}
+
+}  // namespace shaka
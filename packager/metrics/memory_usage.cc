@@ -0,0 +1,73 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/memory_usage.h"
+
+#include <map>
+#include <memory>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+namespace {
+
+// The totals of the subsystems. They are never removed, so the pointers stay
+// valid and the gauges can read them without locking.
+class SubsystemTotals {
+ public:
+  static SubsystemTotals* GetInstance() {
+    static SubsystemTotals instance;
+    return &instance;
+  }
+
+  std::atomic<int64_t>* Get(const std::string& subsystem) {
+    base::AutoLock scoped_lock(lock_);
+    std::unique_ptr<std::atomic<int64_t>>& total = totals_[subsystem];
+    if (!total) {
+      total.reset(new std::atomic<int64_t>(0));
+      std::atomic<int64_t>* total_bytes = total.get();
+      Metrics::GetInstance()->AddGaugeFunction(
+          "shaka_memory_usage_bytes",
+          "Approximate bytes used by a subsystem, e.g. by the segment "
+          "histories of the playlists.",
+          {{"subsystem", subsystem}}, [total_bytes]() {
+            return static_cast<double>(
+                total_bytes->load(std::memory_order_relaxed));
+          });
+    }
+    return total.get();
+  }
+
+ private:
+  base::Lock lock_;
+  std::map<std::string, std::unique_ptr<std::atomic<int64_t>>> totals_;
+};
+
+}  // namespace
+
+MemoryUsage::MemoryUsage(const std::string& subsystem)
+    : total_bytes_(SubsystemTotals::GetInstance()->Get(subsystem)) {}
+
+MemoryUsage::~MemoryUsage() {
+  Set(0);
+}
+
+void MemoryUsage::Set(uint64_t bytes) {
+  total_bytes_->fetch_add(static_cast<int64_t>(bytes) -
+                              static_cast<int64_t>(bytes_),
+                          std::memory_order_relaxed);
+  bytes_ = bytes;
+}
+
+// static
+uint64_t MemoryUsage::GetSubsystemBytes(const std::string& subsystem) {
+  return static_cast<uint64_t>(
+      SubsystemTotals::GetInstance()->Get(subsystem)->load(
+          std::memory_order_relaxed));
+}
+
+}  // namespace shaka
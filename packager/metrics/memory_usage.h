@@ -0,0 +1,48 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_MEMORY_USAGE_H_
+#define PACKAGER_METRICS_MEMORY_USAGE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+namespace shaka {
+
+/// Accounts for the approximate memory used by an object, e.g. by the segment
+/// history of a live playlist, in the total of its subsystem. The totals are
+/// exported as the gauge shaka_memory_usage_bytes{subsystem="..."}, so the
+/// memory of a long running session can be checked to reach a steady state.
+/// The totals are thread safe, an instance is not.
+class MemoryUsage {
+ public:
+  /// @param subsystem names the subsystem, e.g. "hls_segment_history".
+  explicit MemoryUsage(const std::string& subsystem);
+  /// Removes the bytes of this instance from the total of its subsystem.
+  ~MemoryUsage();
+
+  /// Set the approximate number of bytes used by this instance.
+  void Set(uint64_t bytes);
+
+  /// @return the number of bytes set on this instance.
+  uint64_t bytes() const { return bytes_; }
+
+  /// @return the total number of bytes used by @a subsystem.
+  static uint64_t GetSubsystemBytes(const std::string& subsystem);
+
+ private:
+  MemoryUsage(const MemoryUsage&) = delete;
+  MemoryUsage& operator=(const MemoryUsage&) = delete;
+
+  std::atomic<int64_t>* const total_bytes_;
+  uint64_t bytes_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_MEMORY_USAGE_H_
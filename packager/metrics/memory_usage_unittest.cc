@@ -0,0 +1,41 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/memory_usage.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "packager/metrics/metrics.h"
+
+namespace shaka {
+
+TEST(MemoryUsageTest, SubsystemTotal) {
+  const char kSubsystem[] = "test_total";
+  MemoryUsage usage1(kSubsystem);
+  std::unique_ptr<MemoryUsage> usage2(new MemoryUsage(kSubsystem));
+  usage1.Set(100);
+  usage2->Set(20);
+  EXPECT_EQ(120u, MemoryUsage::GetSubsystemBytes(kSubsystem));
+  usage1.Set(50);
+  EXPECT_EQ(50u, usage1.bytes());
+  EXPECT_EQ(70u, MemoryUsage::GetSubsystemBytes(kSubsystem));
+  // The bytes of an instance are released with it.
+  usage2.reset();
+  EXPECT_EQ(50u, MemoryUsage::GetSubsystemBytes(kSubsystem));
+  EXPECT_EQ(0u, MemoryUsage::GetSubsystemBytes("test_other"));
+}
+
+TEST(MemoryUsageTest, Gauge) {
+  MemoryUsage usage("test_gauge");
+  usage.Set(1234);
+  EXPECT_NE(std::string::npos,
+            Metrics::GetInstance()->ToOpenMetrics().find(
+                "shaka_memory_usage_bytes{subsystem=\"test_gauge\"} 1234\n"));
+}
+
+}  // namespace shaka
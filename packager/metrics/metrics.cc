@@ -0,0 +1,269 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/metrics.h"
+
+#include <cmath>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace {
+
+// Upper bounds of the buckets of the latency histograms, in seconds. The last
+// bucket, "+Inf", is implied.
+const double kLatencyBuckets[] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25,
+                                  0.5,   1,    2.5,   5,    10,  30};
+const size_t kNumLatencyBuckets = arraysize(kLatencyBuckets) + 1;
+
+std::string EscapeLabelValue(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        escaped += c;
+        break;
+    }
+  }
+  return escaped;
+}
+
+std::string FormatLabels(const MetricLabels& labels) {
+  if (labels.empty())
+    return "";
+  std::string formatted = "{";
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if (i > 0)
+      formatted += ",";
+    formatted += labels[i].first + "=\"" + EscapeLabelValue(labels[i].second) +
+                 "\"";
+  }
+  formatted += "}";
+  return formatted;
+}
+
+// Add the "le" label of a histogram bucket to the formatted |labels|.
+std::string AddBucketLabel(const std::string& labels,
+                           const std::string& upper_bound) {
+  const std::string bucket_label = "le=\"" + upper_bound + "\"}";
+  if (labels.empty())
+    return "{" + bucket_label;
+  return labels.substr(0, labels.size() - 1) + "," + bucket_label;
+}
+
+std::string FormatValue(double value) {
+  // Print integral values, e.g. counts and bytes, exactly.
+  if (value == std::floor(value) && std::fabs(value) < 1e15)
+    return base::StringPrintf("%lld", static_cast<long long>(value));
+  return base::StringPrintf("%.9g", value);
+}
+
+}  // namespace
+
+Metrics* Metrics::GetInstance() {
+  static Metrics instance;
+  return &instance;
+}
+
+Metrics::Metrics() {}
+
+Metrics::~Metrics() {}
+
+void Metrics::IncrementCounter(const std::string& name,
+                               const char* help,
+                               const MetricLabels& labels,
+                               double value) {
+  DCHECK_GE(value, 0);
+  base::AutoLock scoped_lock(lock_);
+  Series* series = GetSeries(name, Type::kCounter, help, labels);
+  if (series)
+    series->value += value;
+}
+
+void Metrics::SetGauge(const std::string& name,
+                       const char* help,
+                       const MetricLabels& labels,
+                       double value) {
+  base::AutoLock scoped_lock(lock_);
+  Series* series = GetSeries(name, Type::kGauge, help, labels);
+  if (series)
+    series->value = value;
+}
+
+int Metrics::AddGaugeFunction(const std::string& name,
+                              const char* help,
+                              const MetricLabels& labels,
+                              const GaugeFunction& function) {
+  base::AutoLock scoped_lock(lock_);
+  Series* series = GetSeries(name, Type::kGauge, help, labels);
+  if (series)
+    series->function = function;
+  const int id = next_gauge_function_id_++;
+  gauge_functions_[id] = std::make_pair(name, FormatLabels(labels));
+  return id;
+}
+
+void Metrics::RemoveGaugeFunction(int id) {
+  base::AutoLock scoped_lock(lock_);
+  auto it = gauge_functions_.find(id);
+  if (it == gauge_functions_.end())
+    return;
+  auto family_it = families_.find(it->second.first);
+  if (family_it != families_.end())
+    family_it->second.series.erase(it->second.second);
+  gauge_functions_.erase(it);
+}
+
+void Metrics::ObserveDuration(const std::string& name,
+                              const char* help,
+                              const MetricLabels& labels,
+                              base::TimeDelta duration) {
+  base::AutoLock scoped_lock(lock_);
+  Series* series = GetSeries(name, Type::kSummary, help, labels);
+  if (series) {
+    ++series->count;
+    series->value += duration.InSecondsF();
+  }
+}
+
+void Metrics::ObserveLatency(const std::string& name,
+                             const char* help,
+                             const MetricLabels& labels,
+                             base::TimeDelta latency) {
+  const double seconds = latency.InSecondsF();
+  size_t bucket = 0;
+  while (bucket < arraysize(kLatencyBuckets) &&
+         seconds > kLatencyBuckets[bucket]) {
+    ++bucket;
+  }
+  base::AutoLock scoped_lock(lock_);
+  Series* series = GetSeries(name, Type::kHistogram, help, labels);
+  if (!series)
+    return;
+  if (series->bucket_counts.empty())
+    series->bucket_counts.resize(kNumLatencyBuckets);
+  ++series->bucket_counts[bucket];
+  ++series->count;
+  series->value += seconds;
+}
+
+std::string Metrics::ToOpenMetrics() const {
+  base::AutoLock scoped_lock(lock_);
+  std::string output;
+  for (const auto& family_pair : families_) {
+    const std::string& name = family_pair.first;
+    const Family& family = family_pair.second;
+    if (family.series.empty())
+      continue;
+    const char* type = "counter";
+    switch (family.type) {
+      case Type::kCounter:
+        break;
+      case Type::kGauge:
+        type = "gauge";
+        break;
+      case Type::kSummary:
+        type = "summary";
+        break;
+      case Type::kHistogram:
+        type = "histogram";
+        break;
+    }
+    base::StringAppendF(&output, "# TYPE %s %s\n", name.c_str(), type);
+    base::StringAppendF(&output, "# HELP %s %s\n", name.c_str(),
+                        family.help.c_str());
+    for (const auto& series_pair : family.series) {
+      const std::string& labels = series_pair.first;
+      const Series& series = series_pair.second;
+      switch (family.type) {
+        case Type::kCounter:
+          output += name + "_total" + labels + " " +
+                    FormatValue(series.value) + "\n";
+          break;
+        case Type::kGauge:
+          output += name + labels + " " +
+                    FormatValue(series.function ? series.function()
+                                                : series.value) +
+                    "\n";
+          break;
+        case Type::kSummary:
+          output += name + "_count" + labels + " " +
+                    FormatValue(static_cast<double>(series.count)) + "\n";
+          output += name + "_sum" + labels + " " + FormatValue(series.value) +
+                    "\n";
+          break;
+        case Type::kHistogram: {
+          int64_t cumulative_count = 0;
+          for (size_t i = 0; i < series.bucket_counts.size(); ++i) {
+            cumulative_count += series.bucket_counts[i];
+            const std::string upper_bound =
+                i < arraysize(kLatencyBuckets) ? FormatValue(kLatencyBuckets[i])
+                                               : "+Inf";
+            output += name + "_bucket" + AddBucketLabel(labels, upper_bound) +
+                      " " +
+                      FormatValue(static_cast<double>(cumulative_count)) +
+                      "\n";
+          }
+          output += name + "_count" + labels + " " +
+                    FormatValue(static_cast<double>(series.count)) + "\n";
+          output += name + "_sum" + labels + " " + FormatValue(series.value) +
+                    "\n";
+          break;
+        }
+      }
+    }
+  }
+  output += "# EOF\n";
+  return output;
+}
+
+double Metrics::GetSum(const std::string& name) const {
+  base::AutoLock scoped_lock(lock_);
+  auto it = families_.find(name);
+  if (it == families_.end())
+    return 0;
+  double sum = 0;
+  for (const auto& series : it->second.series) {
+    if (!series.second.function)
+      sum += series.second.value;
+  }
+  return sum;
+}
+
+void Metrics::Clear() {
+  base::AutoLock scoped_lock(lock_);
+  families_.clear();
+  gauge_functions_.clear();
+}
+
+Metrics::Series* Metrics::GetSeries(const std::string& name,
+                                    Type type,
+                                    const char* help,
+                                    const MetricLabels& labels) {
+  lock_.AssertAcquired();
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    it = families_.insert(std::make_pair(name, Family())).first;
+    it->second.type = type;
+    it->second.help = help;
+  } else if (it->second.type != type) {
+    LOG(DFATAL) << "Metric " << name << " is used with different types.";
+    return nullptr;
+  }
+  return &it->second.series[FormatLabels(labels)];
+}
+
+}  // namespace shaka
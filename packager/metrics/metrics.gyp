@@ -0,0 +1,45 @@
+# Copyright 2020 Google LLC. All rights reserved.
+#
+# Use of this source code is governed by a BSD-style
+# license that can be found in the LICENSE file or at
+# https://developers.google.com/open-source/licenses/bsd
+
+{
+  'variables': {
+    'shaka_code': 1,
+  },
+  'targets': [
+    {
+      'target_name': 'metrics',
+      'type': '<(component)',
+      'sources': [
+        'async_log_sink.cc',
+        'async_log_sink.h',
+        'memory_usage.cc',
+        'memory_usage.h',
+        'metrics.cc',
+        'metrics.h',
+        'trace_event.cc',
+        'trace_event.h',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+      ],
+    },
+    {
+      'target_name': 'metrics_unittest',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'async_log_sink_unittest.cc',
+        'memory_usage_unittest.cc',
+        'metrics_unittest.cc',
+        'trace_event_unittest.cc',
+      ],
+      'dependencies': [
+        '../testing/gtest.gyp:gtest',
+        '../testing/gtest.gyp:gtest_main',
+        'metrics',
+      ],
+    },
+  ],
+}
@@ -0,0 +1,130 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_METRICS_H_
+#define PACKAGER_METRICS_METRICS_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// Label names and values of a time series, e.g. {{"stream", "audio.mp4"}}.
+typedef std::vector<std::pair<std::string, std::string>> MetricLabels;
+
+/// A process-wide registry of metrics, shared by all the packager instances
+/// in the process, which can be exported in the OpenMetrics (Prometheus) text
+/// format. A metric family is created when it is first updated; @a help is
+/// only used then. Thread safe.
+class Metrics {
+ public:
+  /// Computes the value of a gauge when the metrics are exported. It is called
+  /// with the registry locked, so it must not access the registry.
+  typedef std::function<double()> GaugeFunction;
+
+  /// @return the process-wide instance.
+  static Metrics* GetInstance();
+
+  /// Add @a value to a counter. @a name should not include the "_total"
+  /// suffix, which is added in the output.
+  void IncrementCounter(const std::string& name,
+                        const char* help,
+                        const MetricLabels& labels,
+                        double value);
+
+  /// Set the value of a gauge.
+  void SetGauge(const std::string& name,
+                const char* help,
+                const MetricLabels& labels,
+                double value);
+
+  /// Add a gauge computed by @a function every time the metrics are exported,
+  /// until it is removed with RemoveGaugeFunction().
+  /// @return an id to pass to RemoveGaugeFunction().
+  int AddGaugeFunction(const std::string& name,
+                       const char* help,
+                       const MetricLabels& labels,
+                       const GaugeFunction& function);
+  void RemoveGaugeFunction(int id);
+
+  /// Record a duration in a summary (a count and a sum of the durations, in
+  /// seconds). @a name should end with "_seconds".
+  void ObserveDuration(const std::string& name,
+                       const char* help,
+                       const MetricLabels& labels,
+                       base::TimeDelta duration);
+
+  /// Record a latency in a histogram, in seconds, with buckets from 5 ms to
+  /// 30 s. @a name should end with "_seconds".
+  void ObserveLatency(const std::string& name,
+                      const char* help,
+                      const MetricLabels& labels,
+                      base::TimeDelta latency);
+
+  /// @return the sum of the values of all the series of a counter, a gauge,
+  ///         a summary or a histogram, e.g. the total time of a summary across its labels,
+  ///         or 0 if there is no such metric. The gauge functions are not
+  ///         included.
+  double GetSum(const std::string& name) const;
+
+  /// @return the metrics in the OpenMetrics text format.
+  std::string ToOpenMetrics() const;
+
+  /// Remove all the metrics. Used in tests.
+  void Clear();
+
+ private:
+  enum class Type { kCounter, kGauge, kSummary, kHistogram };
+
+  struct Series {
+    double value = 0;
+    // Only used by summaries and histograms.
+    int64_t count = 0;
+    // Only used by histograms: the number of observations in each bucket,
+    // not cumulated.
+    std::vector<int64_t> bucket_counts;
+    // Only used by gauge functions.
+    GaugeFunction function;
+  };
+
+  struct Family {
+    Type type = Type::kCounter;
+    std::string help;
+    // Formatted labels -> series.
+    std::map<std::string, Series> series;
+  };
+
+  Metrics();
+  ~Metrics();
+
+  // Find or create the series, or return null if |name| is already used by a
+  // family of a different type.
+  Series* GetSeries(const std::string& name,
+                    Type type,
+                    const char* help,
+                    const MetricLabels& labels);
+
+  mutable base::Lock lock_;
+  std::map<std::string, Family> families_;
+  // Id of a gauge function -> its family name and formatted labels.
+  std::map<int, std::pair<std::string, std::string>> gauge_functions_;
+  int next_gauge_function_id_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(Metrics);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_METRICS_H_
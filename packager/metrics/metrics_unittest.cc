@@ -0,0 +1,132 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/metrics.h"
+
+#include <gtest/gtest.h>
+
+namespace shaka {
+
+class MetricsTest : public testing::Test {
+ protected:
+  void SetUp() override { Metrics::GetInstance()->Clear(); }
+  void TearDown() override { Metrics::GetInstance()->Clear(); }
+
+  Metrics* metrics() { return Metrics::GetInstance(); }
+};
+
+TEST_F(MetricsTest, Empty) {
+  EXPECT_EQ("# EOF\n", metrics()->ToOpenMetrics());
+}
+
+TEST_F(MetricsTest, Counter) {
+  metrics()->IncrementCounter("shaka_segments", "Segments.",
+                              {{"stream", "a.mp4"}}, 1);
+  metrics()->IncrementCounter("shaka_segments", "Segments.",
+                              {{"stream", "a.mp4"}}, 2);
+  metrics()->IncrementCounter("shaka_segments", "Segments.",
+                              {{"stream", "b.mp4"}}, 1);
+  EXPECT_EQ(
+      "# TYPE shaka_segments counter\n"
+      "# HELP shaka_segments Segments.\n"
+      "shaka_segments_total{stream=\"a.mp4\"} 3\n"
+      "shaka_segments_total{stream=\"b.mp4\"} 1\n"
+      "# EOF\n",
+      metrics()->ToOpenMetrics());
+}
+
+TEST_F(MetricsTest, GaugeAndSummary) {
+  metrics()->SetGauge("shaka_media_time_seconds", "Media time.", {}, 1.5);
+  metrics()->ObserveDuration("shaka_write_seconds", "Write time.",
+                             {{"type", "mpd"}},
+                             base::TimeDelta::FromMilliseconds(250));
+  metrics()->ObserveDuration("shaka_write_seconds", "Write time.",
+                             {{"type", "mpd"}},
+                             base::TimeDelta::FromMilliseconds(500));
+  EXPECT_EQ(
+      "# TYPE shaka_media_time_seconds gauge\n"
+      "# HELP shaka_media_time_seconds Media time.\n"
+      "shaka_media_time_seconds 1.5\n"
+      "# TYPE shaka_write_seconds summary\n"
+      "# HELP shaka_write_seconds Write time.\n"
+      "shaka_write_seconds_count{type=\"mpd\"} 2\n"
+      "shaka_write_seconds_sum{type=\"mpd\"} 0.75\n"
+      "# EOF\n",
+      metrics()->ToOpenMetrics());
+}
+
+TEST_F(MetricsTest, Histogram) {
+  const MetricLabels labels = {{"stream", "a.mp4"}, {"stage", "written"}};
+  for (int64_t milliseconds : {3, 200, 200, 45000}) {
+    metrics()->ObserveLatency("shaka_latency_seconds", "Latency.", labels,
+                              base::TimeDelta::FromMilliseconds(milliseconds));
+  }
+  EXPECT_EQ(
+      "# TYPE shaka_latency_seconds histogram\n"
+      "# HELP shaka_latency_seconds Latency.\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"0.005\"} 1\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"0.01\"} 1\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"0.025\"} 1\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"0.05\"} 1\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"0.1\"} 1\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"0.25\"} 3\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"0.5\"} 3\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"1\"} 3\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"2.5\"} 3\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"5\"} 3\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"10\"} 3\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"30\"} 3\n"
+      "shaka_latency_seconds_bucket{stream=\"a.mp4\",stage=\"written\","
+      "le=\"+Inf\"} 4\n"
+      "shaka_latency_seconds_count{stream=\"a.mp4\",stage=\"written\"} 4\n"
+      "shaka_latency_seconds_sum{stream=\"a.mp4\",stage=\"written\"} "
+      "45.403\n"
+      "# EOF\n",
+      metrics()->ToOpenMetrics());
+  EXPECT_DOUBLE_EQ(45.403, metrics()->GetSum("shaka_latency_seconds"));
+}
+
+TEST_F(MetricsTest, GetSum) {
+  metrics()->ObserveDuration("shaka_write_seconds", "Write time.",
+                             {{"type", "mpd"}},
+                             base::TimeDelta::FromMilliseconds(250));
+  metrics()->ObserveDuration("shaka_write_seconds", "Write time.",
+                             {{"type", "m3u8"}},
+                             base::TimeDelta::FromMilliseconds(500));
+  EXPECT_DOUBLE_EQ(0.75, metrics()->GetSum("shaka_write_seconds"));
+  EXPECT_EQ(0, metrics()->GetSum("shaka_unknown_seconds"));
+}
+
+TEST_F(MetricsTest, GaugeFunction) {
+  double value = 10;
+  const int id = metrics()->AddGaugeFunction(
+      "shaka_bytes", "Bytes.", {{"file", "a\"b"}},
+      [&value]() { return value; });
+  value = 20;
+  EXPECT_EQ(
+      "# TYPE shaka_bytes gauge\n"
+      "# HELP shaka_bytes Bytes.\n"
+      "shaka_bytes{file=\"a\\\"b\"} 20\n"
+      "# EOF\n",
+      metrics()->ToOpenMetrics());
+
+  metrics()->RemoveGaugeFunction(id);
+  EXPECT_EQ("# EOF\n", metrics()->ToOpenMetrics());
+}
+
+}  // namespace shaka
@@ -0,0 +1,136 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/trace_event.h"
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/platform_thread.h"
+
+namespace shaka {
+namespace {
+
+// Bounds the memory used by a thread, about 40MB. Later events are dropped.
+const size_t kMaxEventsPerThread = 1 << 20;
+
+std::string EscapeJsonString(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+          escaped += base::StringPrintf("\\u%04x", c);
+        else
+          escaped += c;
+        break;
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+TraceLog* TraceLog::GetInstance() {
+  static TraceLog instance;
+  return &instance;
+}
+
+TraceLog::TraceLog() {}
+
+TraceLog::~TraceLog() {}
+
+void TraceLog::Enable() {
+  base::AutoLock scoped_lock(lock_);
+  for (const auto& buffer : thread_buffers_) {
+    base::AutoLock buffer_lock(buffer->lock);
+    buffer->events.clear();
+    buffer->num_dropped_events = 0;
+  }
+  origin_ = base::TimeTicks::Now();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void TraceLog::Disable() {
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+void TraceLog::AddEvent(const char* category,
+                        const char* name,
+                        base::TimeTicks start_time,
+                        base::TimeDelta duration) {
+  if (!enabled())
+    return;
+  ThreadBuffer* buffer = GetThreadBuffer();
+  base::AutoLock scoped_lock(buffer->lock);
+  if (buffer->events.size() >= kMaxEventsPerThread) {
+    ++buffer->num_dropped_events;
+    return;
+  }
+  buffer->events.push_back({category, name, start_time, duration});
+}
+
+std::string TraceLog::ToJson() const {
+  base::AutoLock scoped_lock(lock_);
+  std::string json = "{\"traceEvents\": [";
+  const char* separator = "\n";
+  for (const auto& buffer : thread_buffers_) {
+    base::AutoLock buffer_lock(buffer->lock);
+    if (buffer->events.empty())
+      continue;
+    const long long thread_id = static_cast<long long>(buffer->thread_id);
+    base::StringAppendF(&json,
+                        "%s{\"name\": \"thread_name\", \"ph\": \"M\", "
+                        "\"pid\": 1, \"tid\": %lld, "
+                        "\"args\": {\"name\": \"%s\"}}",
+                        separator, thread_id,
+                        EscapeJsonString(buffer->thread_name).c_str());
+    separator = ",\n";
+    for (const Event& event : buffer->events) {
+      // Events recorded before Enable() completed may start before |origin_|.
+      if (event.start_time < origin_)
+        continue;
+      base::StringAppendF(
+          &json,
+          ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+          "\"ts\": %lld, \"dur\": %lld, \"pid\": 1, \"tid\": %lld}",
+          event.name, event.category,
+          static_cast<long long>((event.start_time - origin_).InMicroseconds()),
+          static_cast<long long>(event.duration.InMicroseconds()), thread_id);
+    }
+    if (buffer->num_dropped_events > 0) {
+      LOG(WARNING) << buffer->num_dropped_events
+                   << " trace events dropped on thread " << buffer->thread_name;
+    }
+  }
+  json += "\n]}\n";
+  return json;
+}
+
+TraceLog::ThreadBuffer* TraceLog::GetThreadBuffer() {
+  static thread_local ThreadBuffer* thread_buffer = nullptr;
+  if (!thread_buffer) {
+    std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+    buffer->thread_id = base::PlatformThread::CurrentId();
+    const char* thread_name = base::PlatformThread::GetName();
+    buffer->thread_name = thread_name && *thread_name
+                              ? thread_name
+                              : base::StringPrintf(
+                                    "Thread %lld",
+                                    static_cast<long long>(buffer->thread_id));
+    thread_buffer = buffer.get();
+    base::AutoLock scoped_lock(lock_);
+    thread_buffers_.push_back(std::move(buffer));
+  }
+  return thread_buffer;
+}
+
+}  // namespace shaka
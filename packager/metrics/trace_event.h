@@ -0,0 +1,116 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_METRICS_TRACE_EVENT_H_
+#define PACKAGER_METRICS_TRACE_EVENT_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// Records the duration of the enclosing scope in the TraceLog, if tracing is
+/// enabled. @a category and @a name must be string literals.
+#define SHAKA_TRACE_EVENT(category, name)                        \
+  ::shaka::ScopedTraceEvent SHAKA_TRACE_EVENT_UNIQUE(trace_event_)( \
+      category, name)
+#define SHAKA_TRACE_EVENT_UNIQUE(prefix) \
+  SHAKA_TRACE_EVENT_CONCAT(prefix, __LINE__)
+#define SHAKA_TRACE_EVENT_CONCAT(a, b) SHAKA_TRACE_EVENT_CONCAT_INNER(a, b)
+#define SHAKA_TRACE_EVENT_CONCAT_INNER(a, b) a##b
+
+/// A process-wide log of trace events, which can be exported in the Chrome
+/// trace event format, for chrome://tracing or https://ui.perfetto.dev. The
+/// events are buffered per thread, so recording them does not contend between
+/// threads. Thread safe.
+class TraceLog {
+ public:
+  /// @return the process-wide instance.
+  static TraceLog* GetInstance();
+
+  /// Start recording, discarding the events recorded before.
+  void Enable();
+  /// Stop recording. The recorded events are kept.
+  void Disable();
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /// Record an event of the calling thread. Dropped if tracing is disabled.
+  void AddEvent(const char* category,
+                const char* name,
+                base::TimeTicks start_time,
+                base::TimeDelta duration);
+
+  /// @return the recorded events in the Chrome trace event JSON format.
+  std::string ToJson() const;
+
+ private:
+  struct Event {
+    const char* category;
+    const char* name;
+    base::TimeTicks start_time;
+    base::TimeDelta duration;
+  };
+
+  struct ThreadBuffer {
+    int64_t thread_id = 0;
+    std::string thread_name;
+    // Only contended by ToJson() and Enable().
+    base::Lock lock;
+    std::vector<Event> events;
+    int64_t num_dropped_events = 0;
+  };
+
+  TraceLog();
+  ~TraceLog();
+
+  // Get the buffer of the calling thread, creating it on first use.
+  ThreadBuffer* GetThreadBuffer();
+
+  std::atomic<bool> enabled_{false};
+  mutable base::Lock lock_;
+  base::TimeTicks origin_;
+  // The buffers are never deleted, as exited threads may still have events.
+  std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceLog);
+};
+
+/// Records the time between its construction and destruction in the TraceLog.
+/// Use SHAKA_TRACE_EVENT instead of using it directly.
+class ScopedTraceEvent {
+ public:
+  ScopedTraceEvent(const char* category, const char* name)
+      : category_(category), name_(name) {
+    if (TraceLog::GetInstance()->enabled())
+      start_time_ = base::TimeTicks::Now();
+  }
+
+  ~ScopedTraceEvent() {
+    if (!start_time_.is_null()) {
+      TraceLog::GetInstance()->AddEvent(category_, name_, start_time_,
+                                        base::TimeTicks::Now() - start_time_);
+    }
+  }
+
+ private:
+  const char* category_;
+  const char* name_;
+  base::TimeTicks start_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_METRICS_TRACE_EVENT_H_
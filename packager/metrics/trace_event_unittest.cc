@@ -0,0 +1,86 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/metrics/trace_event.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace shaka {
+namespace {
+
+size_t CountOccurrences(const std::string& text, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+class TraceLogTest : public testing::Test {
+ protected:
+  void TearDown() override { TraceLog::GetInstance()->Disable(); }
+};
+
+TEST_F(TraceLogTest, NotRecordedWhenDisabled) {
+  TraceLog::GetInstance()->Enable();
+  TraceLog::GetInstance()->Disable();
+  { SHAKA_TRACE_EVENT("test", "Disabled"); }
+  EXPECT_EQ("{\"traceEvents\": [\n]}\n", TraceLog::GetInstance()->ToJson());
+}
+
+TEST_F(TraceLogTest, RecordsScopes) {
+  TraceLog::GetInstance()->Enable();
+  {
+    SHAKA_TRACE_EVENT("test", "Outer");
+    SHAKA_TRACE_EVENT("test", "Inner");
+  }
+  TraceLog::GetInstance()->Disable();
+
+  const std::string json = TraceLog::GetInstance()->ToJson();
+  EXPECT_EQ(1u, CountOccurrences(json, "\"name\": \"thread_name\""));
+  EXPECT_EQ(1u, CountOccurrences(json, "\"name\": \"Outer\", \"cat\": "
+                                       "\"test\", \"ph\": \"X\""));
+  EXPECT_EQ(1u, CountOccurrences(json, "\"name\": \"Inner\""));
+}
+
+TEST_F(TraceLogTest, EnableDiscardsPreviousEvents) {
+  TraceLog::GetInstance()->Enable();
+  { SHAKA_TRACE_EVENT("test", "First"); }
+  TraceLog::GetInstance()->Enable();
+  { SHAKA_TRACE_EVENT("test", "Second"); }
+
+  const std::string json = TraceLog::GetInstance()->ToJson();
+  EXPECT_EQ(0u, CountOccurrences(json, "\"First\""));
+  EXPECT_EQ(1u, CountOccurrences(json, "\"Second\""));
+}
+
+TEST_F(TraceLogTest, MultipleThreads) {
+  const int kNumThreads = 4;
+  const int kNumEvents = 100;
+  TraceLog::GetInstance()->Enable();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([]() {
+      for (int j = 0; j < kNumEvents; ++j)
+        SHAKA_TRACE_EVENT("test", "Event");
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  const std::string json = TraceLog::GetInstance()->ToJson();
+  EXPECT_EQ(static_cast<size_t>(kNumThreads),
+            CountOccurrences(json, "\"thread_name\""));
+  EXPECT_EQ(static_cast<size_t>(kNumThreads * kNumEvents),
+            CountOccurrences(json, "\"name\": \"Event\""));
+}
+
+}  // namespace shaka
@@ -190,6 +190,7 @@ Representation* AdaptationSet::AddRepresentation(const MediaInfo& media_info) {
     return NULL;
   }
   UpdateFromMediaInfo(media_info);
+  cached_xml_.reset();
   Representation* representation_ptr = new_representation.get();
   representation_map_[representation_ptr->id()] = std::move(new_representation);
   return representation_ptr;
@@ -205,6 +206,7 @@ Representation* AdaptationSet::CopyRepresentation(
       new Representation(representation, std::move(listener)));
 
   UpdateFromMediaInfo(new_representation->GetMediaInfo());
+  cached_xml_.reset();
   Representation* representation_ptr = new_representation.get();
   representation_map_[representation_ptr->id()] = std::move(new_representation);
   return representation_ptr;
@@ -214,21 +216,28 @@ void AdaptationSet::AddContentProtectionElement(
     const ContentProtectionElement& content_protection_element) {
   content_protection_elements_.push_back(content_protection_element);
   RemoveDuplicateAttributes(&content_protection_elements_.back());
+  content_protection_xml_.reset();
+  cached_xml_.reset();
 }
 
 void AdaptationSet::UpdateContentProtectionPssh(const std::string& drm_uuid,
                                                 const std::string& pssh) {
+  base::AutoLock auto_lock(representation_update_lock_);
   UpdateContentProtectionPsshHelper(drm_uuid, pssh,
                                     &content_protection_elements_);
+  content_protection_xml_.reset();
+  cached_xml_.reset();
 }
 
 void AdaptationSet::AddAccessibility(const std::string& scheme,
                                      const std::string& value) {
   accessibilities_.push_back(Accessibility{scheme, value});
+  cached_xml_.reset();
 }
 
 void AdaptationSet::AddRole(Role role) {
   roles_.insert(role);
+  cached_xml_.reset();
 }
 
 // Creates a copy of <AdaptationSet> xml element, iterate thru all the
@@ -238,6 +247,9 @@ void AdaptationSet::AddRole(Role role) {
 // example, if AdaptationSet@width is set, then Representation@width is
 // redundant and should not be set.
 base::Optional<xml::XmlNode> AdaptationSet::GetXml() {
+  if (!xml_changed())
+    return cached_xml_;
+
   xml::AdaptationSetXmlNode adaptation_set;
 
   bool suppress_representation_width = false;
@@ -310,10 +322,16 @@ base::Optional<xml::XmlNode> AdaptationSet::GetXml() {
     return base::nullopt;
   }
 
-  if (!adaptation_set.AddContentProtectionElements(
-          content_protection_elements_)) {
-    return base::nullopt;
+  if (!content_protection_xml_) {
+    std::vector<xml::XmlNode> content_protection_xml;
+    if (!xml::RepresentationBaseXmlNode::GenerateContentProtectionNodes(
+            content_protection_elements_, &content_protection_xml)) {
+      return base::nullopt;
+    }
+    content_protection_xml_ = std::move(content_protection_xml);
   }
+  if (!adaptation_set.AddContentProtectionNodes(*content_protection_xml_))
+    return base::nullopt;
 
   std::string trick_play_reference_ids;
   for (const AdaptationSet* adaptation_set : trick_play_references_) {
@@ -370,18 +388,31 @@ base::Optional<xml::XmlNode> AdaptationSet::GetXml() {
       return base::nullopt;
   }
 
+  cached_xml_.emplace(adaptation_set);
   return std::move(adaptation_set);
 }
 
+bool AdaptationSet::xml_changed() const {
+  if (!cached_xml_)
+    return true;
+  for (const auto& representation_pair : representation_map_) {
+    if (representation_pair.second->xml_changed())
+      return true;
+  }
+  return false;
+}
+
 void AdaptationSet::ForceSetSegmentAlignment(bool segment_alignment) {
   segments_aligned_ =
       segment_alignment ? kSegmentAlignmentTrue : kSegmentAlignmentFalse;
   force_set_segment_alignment_ = true;
+  cached_xml_.reset();
 }
 
 void AdaptationSet::AddAdaptationSetSwitching(
     const AdaptationSet* adaptation_set) {
   switchable_adaptation_sets_.push_back(adaptation_set);
+  cached_xml_.reset();
 }
 
 // For dynamic MPD, storing all start_time and duration will out-of-memory
@@ -393,22 +424,27 @@ void AdaptationSet::AddAdaptationSetSwitching(
 void AdaptationSet::OnNewSegmentForRepresentation(uint32_t representation_id,
                                                   uint64_t start_time,
                                                   uint64_t duration) {
+  base::AutoLock auto_lock(representation_update_lock_);
   if (mpd_options_.mpd_type == MpdType::kDynamic) {
     CheckDynamicSegmentAlignment(representation_id, start_time, duration);
   } else {
     representation_segment_start_times_[representation_id].push_back(
         start_time);
   }
+  cached_xml_.reset();
 }
 
 void AdaptationSet::OnSetFrameRateForRepresentation(uint32_t representation_id,
                                                     uint32_t frame_duration,
                                                     uint32_t timescale) {
+  base::AutoLock auto_lock(representation_update_lock_);
   RecordFrameRate(frame_duration, timescale);
+  cached_xml_.reset();
 }
 
 void AdaptationSet::AddTrickPlayReference(const AdaptationSet* adaptation_set) {
   trick_play_references_.push_back(adaptation_set);
+  cached_xml_.reset();
 }
 
 const std::list<Representation*> AdaptationSet::GetRepresentations() const {
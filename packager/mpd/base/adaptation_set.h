@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "packager/base/optional.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/mpd/base/xml/xml_node.h"
 
 namespace shaka {
@@ -106,10 +107,17 @@ class AdaptationSet {
 
   /// Makes a copy of AdaptationSet xml element with its child Representation
   /// and ContentProtection elements.
+  /// The element is cached and reused until the AdaptationSet or one of its
+  /// Representations changes.
   /// @return On success returns a non-NULL scoped_xml_ptr. Otherwise returns a
   ///         NULL scoped_xml_ptr.
   base::Optional<xml::XmlNode> GetXml();
 
+  /// @return true if the element returned by the last GetXml() call is stale,
+  ///         i.e. the AdaptationSet or one of its Representations changed
+  ///         since.
+  bool xml_changed() const;
+
   /// Forces the (sub)segmentAlignment field to be set to @a segment_alignment.
   /// Use this if you are certain that the (sub)segments are alinged/unaligned
   /// for the AdaptationSet.
@@ -129,7 +137,10 @@ class AdaptationSet {
 
   /// Set AdaptationSet@id.
   /// @param id is the new ID to be set.
-  void set_id(uint32_t id) { id_ = id; }
+  void set_id(uint32_t id) {
+    id_ = id;
+    cached_xml_.reset();
+  }
 
   /// Notifies the AdaptationSet instance that a new (sub)segment was added to
   /// the Representation with @a representation_id.
@@ -241,6 +252,10 @@ class AdaptationSet {
   void RecordFrameRate(uint32_t frame_duration, uint32_t timescale);
 
   std::list<ContentProtectionElement> content_protection_elements_;
+  // The ContentProtection elements generated for |content_protection_elements_|,
+  // which are kept across the MPD updates until the elements change, e.g. on
+  // an encryption update.
+  base::Optional<std::vector<xml::XmlNode>> content_protection_xml_;
   // representation_id => Representation map. It also keeps the representations_
   // sorted by default.
   std::map<uint32_t, std::unique_ptr<Representation>> representation_map_;
@@ -313,6 +328,17 @@ class AdaptationSet {
   // and HD videos in different AdaptationSets can share the same trick play
   // stream.
   std::vector<const AdaptationSet*> trick_play_references_;
+
+  // Guards the state updated on behalf of a Representation, i.e. in
+  // UpdateContentProtectionPssh(), OnNewSegmentForRepresentation() and
+  // OnSetFrameRateForRepresentation(), which may be called concurrently for
+  // different Representations.
+  base::Lock representation_update_lock_;
+
+  // The element returned by the last GetXml() call. It is reset when the
+  // AdaptationSet changes; the changes of the Representations are tracked by
+  // the Representations.
+  base::Optional<xml::XmlNode> cached_xml_;
 };
 
 }  // namespace shaka
@@ -146,6 +146,45 @@ TEST_F(AdaptationSetTest, CopyRepresentation) {
   ASSERT_TRUE(new_representation);
 }
 
+// Verify that the element is reused until the AdaptationSet or one of its
+// Representations changes.
+TEST_F(AdaptationSetTest, GetXmlCachedUntilChanged) {
+  const char kVideoMediaInfo[] =
+      "video_info {\n"
+      "  codec: 'avc1'\n"
+      "  width: 1280\n"
+      "  height: 720\n"
+      "  time_scale: 10\n"
+      "  frame_duration: 10\n"
+      "  pixel_width: 1\n"
+      "  pixel_height: 1\n"
+      "}\n"
+      "reference_time_scale: 10\n"
+      "container_type: CONTAINER_MP4\n";
+
+  auto adaptation_set = CreateAdaptationSet(kNoLanguage);
+  Representation* representation =
+      adaptation_set->AddRepresentation(ConvertToMediaInfo(kVideoMediaInfo));
+  ASSERT_TRUE(representation);
+  EXPECT_TRUE(adaptation_set->xml_changed());
+  EXPECT_THAT(adaptation_set->GetXml(), Not(AttributeSet("id")));
+  EXPECT_FALSE(adaptation_set->xml_changed());
+
+  adaptation_set->set_id(1);
+  EXPECT_TRUE(adaptation_set->xml_changed());
+  EXPECT_THAT(adaptation_set->GetXml(), AttributeEqual("id", "1"));
+  EXPECT_FALSE(adaptation_set->xml_changed());
+
+  const int64_t kStartTime = 0;
+  const int64_t kDuration = 10;
+  const uint64_t kSize = 1000;
+  representation->AddNewSegment(kStartTime, kDuration, kSize);
+  EXPECT_TRUE(adaptation_set->xml_changed());
+  adaptation_set->GetXml();
+  EXPECT_FALSE(adaptation_set->xml_changed());
+  EXPECT_FALSE(representation->xml_changed());
+}
+
 // Verify that language passed to the constructor sets the @lang field is set.
 TEST_F(AdaptationSetTest, CheckLanguageAttributeSet) {
   auto adaptation_set = CreateAdaptationSet("en");
@@ -44,6 +44,9 @@ void BandwidthEstimator::AddBlock(uint64_t size_in_bytes, double duration) {
       max_bitrate_ =
           std::max(max_bitrate_, GetBitrate(block, target_block_duration_));
     }
+    // The initial blocks are no longer needed, so the memory used does not
+    // depend on the number of blocks.
+    std::vector<Block>().swap(initial_blocks_);
     return;
   }
   max_bitrate_ = std::max(max_bitrate_, GetBitrate({size_in_bits, duration},
@@ -57,12 +60,11 @@ uint64_t BandwidthEstimator::Estimate() const {
 }
 
 uint64_t BandwidthEstimator::Max() const {
-  if (max_bitrate_ != 0)
+  if (max_bitrate_ != 0 || target_block_duration_ != 0)
     return max_bitrate_;
 
   // We don't have the |target_block_duration_| yet. Calculate a target
   // duration from the current available blocks.
-  DCHECK(target_block_duration_ == 0);
   const double target_block_duration = GetAverageBlockDuration();
 
   // Calculate maximum bitrate with the target duration calculated above.
@@ -13,6 +13,10 @@
 
 namespace shaka {
 
+/// Estimates the average and the peak bandwidth of a stream from its blocks,
+/// e.g. its segments. The memory used and the cost of AddBlock() are constant,
+/// only the first blocks, which determine the target block duration, are
+/// kept.
 class BandwidthEstimator {
  public:
   BandwidthEstimator();
@@ -48,6 +52,7 @@ class BandwidthEstimator {
   // the block duration is less than 50% of target block duration.
   uint64_t GetBitrate(const Block& block, double target_block_duration) const;
 
+  // Released once |target_block_duration_| is estimated from them.
   std::vector<Block> initial_blocks_;
   // Target block duration will be estimated from the average duration of the
   // initial blocks.
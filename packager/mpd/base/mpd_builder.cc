@@ -7,15 +7,16 @@
 #include "packager/mpd/base/mpd_builder.h"
 
 #include <algorithm>
+#include <iterator>
 
 #include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
 #include "packager/base/optional.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/base/synchronization/lock.h"
 #include "packager/base/time/default_clock.h"
 #include "packager/base/time/time.h"
+#include "packager/file/tee_file.h"
 #include "packager/media/base/rcheck.h"
 #include "packager/mpd/base/adaptation_set.h"
 #include "packager/mpd/base/mpd_utils.h"
@@ -97,7 +98,8 @@ bool SetIfPositive(const char* attr_name, double value, XmlNode* mpd) {
 std::string MakePathRelative(const std::string& media_path,
                              const FilePath& parent_path) {
   FilePath relative_path;
-  const FilePath child_path = FilePath::FromUTF8Unsafe(media_path);
+  const FilePath child_path =
+      FilePath::FromUTF8Unsafe(TeeFile::GetFirstFileName(media_path));
   const bool is_child =
       parent_path.AppendRelativePath(child_path, &relative_path);
   if (!is_child)
@@ -105,32 +107,6 @@ std::string MakePathRelative(const std::string& media_path,
   return relative_path.NormalizePathSeparatorsTo('/').AsUTF8Unsafe();
 }
 
-// Spooky static initialization/cleanup of libxml.
-class LibXmlInitializer {
- public:
-  LibXmlInitializer() : initialized_(false) {
-    base::AutoLock lock(lock_);
-    if (!initialized_) {
-      xmlInitParser();
-      initialized_ = true;
-    }
-  }
-
-  ~LibXmlInitializer() {
-    base::AutoLock lock(lock_);
-    if (initialized_) {
-      xmlCleanupParser();
-      initialized_ = false;
-    }
-  }
-
- private:
-  base::Lock lock_;
-  bool initialized_;
-
-  DISALLOW_COPY_AND_ASSIGN(LibXmlInitializer);
-};
-
 }  // namespace
 
 MpdBuilder::MpdBuilder(const MpdOptions& mpd_options)
@@ -158,8 +134,6 @@ Period* MpdBuilder::GetOrCreatePeriod(double start_time_in_seconds) {
 
 bool MpdBuilder::ToString(std::string* output) {
   DCHECK(output);
-  static LibXmlInitializer lib_xml_initializer;
-
   auto mpd = GenerateMpd();
   if (!mpd)
     return false;
@@ -193,6 +167,8 @@ base::Optional<xml::XmlNode> MpdBuilder::GenerateMpd() {
     // case of only one period, Period@duration is redundant as it is identical
     // to Mpd Duration so the convention is not to output Period@duration.
     output_period_duration = periods_.size() > 1;
+  } else {
+    RemovePeriodsOutsideTimeShiftBuffer();
   }
 
   for (const auto& period : periods_) {
@@ -281,6 +257,11 @@ bool MpdBuilder::AddDynamicMpdInfo(XmlNode* mpd_node) {
 
   // 'availabilityStartTime' is required for dynamic profile. Calculate if
   // not already calculated.
+  if (availability_start_time_.empty() &&
+      mpd_options_.mpd_params.segment_numbers_from_timestamps) {
+    // The epoch, so that redundant packagers generate the same MPD.
+    availability_start_time_ = "1970-01-01T00:00:00Z";
+  }
   if (availability_start_time_.empty()) {
     double earliest_presentation_time;
     if (GetEarliestTimestamp(&earliest_presentation_time)) {
@@ -362,6 +343,41 @@ bool MpdBuilder::GetEarliestTimestamp(double* timestamp_seconds) {
   return true;
 }
 
+void MpdBuilder::RemovePeriodsOutsideTimeShiftBuffer() {
+  DCHECK_EQ(MpdType::kDynamic, mpd_options_.mpd_type);
+  const double time_shift_buffer_depth =
+      mpd_options_.mpd_params.time_shift_buffer_depth;
+  // availabilityStartTime is derived from the first Period, so it has to be
+  // set before the first Period is removed.
+  if (time_shift_buffer_depth <= 0 || periods_.size() < 2 ||
+      availability_start_time_.empty()) {
+    return;
+  }
+
+  double latest_end_time = -1;
+  double end_time = 0;
+  for (const auto* adaptation_set : periods_.back()->GetAdaptationSets()) {
+    for (const auto* representation : adaptation_set->GetRepresentations()) {
+      if (representation->GetStartAndEndTimestamps(nullptr, &end_time))
+        latest_end_time = std::max(latest_end_time, end_time);
+    }
+  }
+  if (latest_end_time < 0)
+    return;
+
+  // A Period ends when the next one starts.
+  const double time_shift_buffer_start =
+      latest_end_time - time_shift_buffer_depth;
+  while (periods_.size() > 1 &&
+         (*std::next(periods_.begin()))->start_time_in_seconds() <=
+             time_shift_buffer_start) {
+    VLOG(1) << "Removing Period starting at "
+            << periods_.front()->start_time_in_seconds()
+            << " outside of the time shift buffer.";
+    periods_.pop_front();
+  }
+}
+
 void MpdBuilder::UpdatePeriodDurationAndPresentationTimestamp() {
   DCHECK_EQ(MpdType::kStatic, mpd_options_.mpd_type);
 
@@ -416,9 +432,9 @@ void MpdBuilder::MakePathsRelativeToMpd(const std::string& mpd_path,
                                         MediaInfo* media_info) {
   DCHECK(media_info);
   const std::string kFileProtocol("file://");
-  std::string mpd_file_path = (mpd_path.find(kFileProtocol) == 0)
-                                  ? mpd_path.substr(kFileProtocol.size())
-                                  : mpd_path;
+  std::string mpd_file_path = TeeFile::GetFirstFileName(mpd_path);
+  if (mpd_file_path.find(kFileProtocol) == 0)
+    mpd_file_path = mpd_file_path.substr(kFileProtocol.size());
 
   if (!mpd_file_path.empty()) {
     const FilePath mpd_dir(FilePath::FromUTF8Unsafe(mpd_file_path)
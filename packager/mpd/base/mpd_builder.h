@@ -5,8 +5,6 @@
 // https://developers.google.com/open-source/licenses/bsd
 //
 /// All the methods that are virtual are virtual for mocking.
-/// NOTE: Inclusion of this module will cause xmlInitParser and xmlCleanupParser
-///       to be called at static initialization / deinitialization time.
 
 #ifndef MPD_BASE_MPD_BUILDER_H_
 #define MPD_BASE_MPD_BUILDER_H_
@@ -66,6 +64,20 @@ class MpdBuilder {
   static void MakePathsRelativeToMpd(const std::string& mpd_path,
                                      MediaInfo* media_info);
 
+  /// @return MPD@availabilityStartTime of a dynamic MPD. Empty until the MPD
+  ///         is first generated with segments.
+  const std::string& availability_start_time() const {
+    return availability_start_time_;
+  }
+  /// Sets MPD@availabilityStartTime, e.g. to resume a live MPD after a
+  /// restart.
+  void set_availability_start_time(const std::string& availability_start_time) {
+    availability_start_time_ = availability_start_time;
+  }
+
+  /// @return The number of Periods.
+  size_t num_periods() const { return periods_.size(); }
+
   // Inject a |clock| that returns the current time.
   /// This is for testing.
   void InjectClockForTesting(std::unique_ptr<base::Clock> clock) {
@@ -114,6 +126,10 @@ class MpdBuilder {
   // Update Period durations and presentation timestamps.
   void UpdatePeriodDurationAndPresentationTimestamp();
 
+  // Removes the Periods which ended before the time shift buffer of a
+  // 'dynamic' MPD. The live Period is never removed.
+  void RemovePeriodsOutsideTimeShiftBuffer();
+
   MpdOptions mpd_options_;
   std::list<std::unique_ptr<Period>> periods_;
 
@@ -15,6 +15,7 @@
 #include "packager/version/version.h"
 
 using ::testing::HasSubstr;
+using ::testing::Not;
 
 namespace shaka {
 
@@ -258,6 +259,38 @@ TEST_F(LiveMpdBuilderTest, MultiplePeriodCheckXmlTest) {
                                  "  <Period id=\"2\" start=\"PT8S\"/>\n"));
 }
 
+TEST_F(LiveMpdBuilderTest, RemovePeriodsOutsideTimeShiftBuffer) {
+  const double kPeriod1StartTimeSeconds = 0.0;
+  const double kPeriod2StartTimeSeconds = 10.0;
+  const double kPeriod3StartTimeSeconds = 20.0;
+  const double kSegmentDurationSeconds = 10.0;
+  mutable_mpd_options()->mpd_params.time_shift_buffer_depth = 15.0;
+
+  Period* period = mpd_.GetOrCreatePeriod(kPeriod1StartTimeSeconds);
+  AddSegmentToPeriod(kPeriod1StartTimeSeconds, kSegmentDurationSeconds,
+                     period);
+  period = mpd_.GetOrCreatePeriod(kPeriod2StartTimeSeconds);
+  AddSegmentToPeriod(kPeriod2StartTimeSeconds, kSegmentDurationSeconds,
+                     period);
+  period = mpd_.GetOrCreatePeriod(kPeriod3StartTimeSeconds);
+  AddSegmentToPeriod(kPeriod3StartTimeSeconds, kSegmentDurationSeconds,
+                     period);
+
+  // The first Period ends at 10 seconds, before the time shift buffer which
+  // starts at 30 - 15 = 15 seconds.
+  std::string mpd_doc;
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+  EXPECT_EQ(2u, mpd_.num_periods());
+  EXPECT_THAT(mpd_doc, Not(HasSubstr("<Period id=\"0\"")));
+  EXPECT_THAT(mpd_doc, HasSubstr("<Period id=\"1\" start=\"PT10S\">\n"));
+  EXPECT_THAT(mpd_doc, HasSubstr("<Period id=\"2\" start=\"PT20S\">\n"));
+
+  // The Periods which did not change are written again from the output kept.
+  std::string updated_mpd_doc;
+  ASSERT_TRUE(mpd_.ToString(&updated_mpd_doc));
+  EXPECT_EQ(mpd_doc, updated_mpd_doc);
+}
+
 // Check whether the attributes are set correctly for dynamic <MPD> element.
 // This test must use ASSERT_EQ for comparison because XmlEqual() cannot
 // handle namespaces correctly yet.
@@ -11,6 +11,7 @@
 #define MPD_BASE_MPD_NOTIFIER_H_
 
 #include <stdint.h>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -19,6 +20,7 @@
 
 namespace shaka {
 
+class ManifestCheckpoint;
 class MediaInfo;
 struct ContentProtectionElement;
 
@@ -104,6 +106,29 @@ class MpdNotifier {
   /// forces a flush.
   virtual bool Flush() = 0;
 
+  /// Request the MPD to be written after an update, e.g. a new segment in a
+  /// dynamic MPD. By default, the MPD is flushed right away. Implementations
+  /// may instead coalesce the requests and write the MPD asynchronously.
+  virtual void RequestFlush() { Flush(); }
+
+  /// Run @a callback once the MPD is written with the updates notified so far,
+  /// e.g. to measure when a new segment is advertised. Call it after the
+  /// update and before RequestFlush(). Notifiers which do not track their
+  /// writes drop the callback, which is the default.
+  virtual void RunAfterFlush(std::function<void()> callback) {}
+
+  /// Saves the state of a live MPD, so that a restarted packager can resume
+  /// it with ResumeFromCheckpoint(). Does nothing by default.
+  /// @param[out] checkpoint gets the state of the Representations and of the
+  ///             MPD.
+  virtual void SaveCheckpoint(ManifestCheckpoint* checkpoint) {}
+
+  /// Resumes a live MPD from the state saved by SaveCheckpoint() in a previous
+  /// run. Must be called before any container is added. The segments of a
+  /// new container are restored if its segment template matches one of
+  /// @a checkpoint. Does nothing by default.
+  virtual void ResumeFromCheckpoint(const ManifestCheckpoint& checkpoint) {}
+
   /// @return include_mspr_pro option flag
   bool include_mspr_pro() const { return mpd_options_.mpd_params.include_mspr_pro; }
 
@@ -8,7 +8,10 @@
 
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
+#include "packager/base/time/time.h"
 #include "packager/file/file.h"
+#include "packager/file/precompressed_file_writer.h"
+#include "packager/metrics/metrics.h"
 #include "packager/mpd/base/mpd_utils.h"
 
 namespace shaka {
@@ -16,6 +19,7 @@ namespace shaka {
 bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
   CHECK(!output_path.empty());
 
+  const base::TimeTicks start_time = base::TimeTicks::Now();
   std::string mpd;
   if (!mpd_builder->ToString(&mpd)) {
     LOG(ERROR) << "Failed to write MPD to string.";
@@ -26,6 +30,10 @@ bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
     LOG(ERROR) << "Failed to write mpd to: " << output_path;
     return false;
   }
+  PrecompressedFileWriter::GetInstance()->Write(output_path, mpd);
+  Metrics::GetInstance()->ObserveDuration(
+      "shaka_manifest_write_seconds", "Time to generate and write manifests.",
+      {{"type", "mpd"}}, base::TimeTicks::Now() - start_time);
   return true;
 }
 
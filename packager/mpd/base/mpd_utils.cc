@@ -145,6 +145,12 @@ std::string GetBaseCodec(const MediaInfo& media_info) {
 
 std::string GetAdaptationSetKey(const MediaInfo& media_info,
                                 bool ignore_codec) {
+  return GetAdaptationSetKey(media_info, ignore_codec, false);
+}
+
+std::string GetAdaptationSetKey(const MediaInfo& media_info,
+                                bool ignore_codec,
+                                bool ignore_trick_play) {
   std::string key;
 
   if (media_info.has_video_info()) {
@@ -168,7 +174,7 @@ std::string GetAdaptationSetKey(const MediaInfo& media_info,
 
   // Trick play streams of the same original stream, but possibly with
   // different trick_play_factors, belong to the same trick play AdaptationSet.
-  if (media_info.video_info().has_playback_rate()) {
+  if (!ignore_trick_play && media_info.video_info().has_playback_rate()) {
     key.append(":trick_play");
   }
 
@@ -327,7 +333,7 @@ const char kMarlinUUID[] = "5e629af5-38da-4063-8977-97ffbd9902d4";
 const char kFairPlayUUID[] = "29701fe4-3cc7-4a34-8c5b-ae90c7439a47";
 // String representation of media::kPlayReadySystemId.
 const char kPlayReadyUUID[] = "9a04f079-9840-4286-ab92-e65be0885f95";
-// It is RECOMMENDED to include the @value attribute with name and version "MSPR 2.0".
+// It is RECOMMENDED to include the @value attribute with name and version "MSPR 2.0".
 // See https://docs.microsoft.com/en-us/playready/specifications/mpeg-dash-playready#221-general.
 const char kContentProtectionValueMSPR20[] = "MSPR 2.0";
 
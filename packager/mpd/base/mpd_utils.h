@@ -50,6 +50,12 @@ std::string GetBaseCodec(const MediaInfo& media_info);
 // Returns a key made from the characteristics that separate AdaptationSets.
 std::string GetAdaptationSetKey(const MediaInfo& media_info, bool ignore_codec);
 
+// Same as above, but, if |ignore_trick_play| is true, gives trick play streams
+// the key of their original stream, without copying |media_info|.
+std::string GetAdaptationSetKey(const MediaInfo& media_info,
+                                bool ignore_codec,
+                                bool ignore_trick_play);
+
 std::string SecondsToXmlDuration(double seconds);
 
 // Tries to get "duration" attribute from |node|. On success |duration| is set.
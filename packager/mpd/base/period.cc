@@ -6,6 +6,8 @@
 
 #include "packager/mpd/base/period.h"
 
+#include <algorithm>
+
 #include "packager/base/stl_util.h"
 #include "packager/mpd/base/adaptation_set.h"
 #include "packager/mpd/base/mpd_options.h"
@@ -77,7 +79,7 @@ AdaptationSet* Period::GetOrCreateAdaptationSet(
   // Set duration if it is not set. It may be updated later from duration
   // calculated from segments.
   if (duration_seconds_ == 0)
-    duration_seconds_ = media_info.media_duration_seconds();
+    set_duration_seconds(media_info.media_duration_seconds());
 
   const std::string key = GetAdaptationSetKey(
       media_info, mpd_options_.mpd_params.allow_codec_switching);
@@ -117,10 +119,20 @@ AdaptationSet* Period::GetOrCreateAdaptationSet(
   AdaptationSet* adaptation_set_ptr = new_adaptation_set.get();
   adaptation_sets.push_back(adaptation_set_ptr);
   adaptation_sets_.emplace_back(std::move(new_adaptation_set));
+  cached_xml_.reset();
   return adaptation_set_ptr;
 }
 
 base::Optional<xml::XmlNode> Period::GetXml(bool output_period_duration) {
+  if (cached_xml_ &&
+      cached_xml_output_period_duration_ == output_period_duration &&
+      std::none_of(adaptation_sets_.begin(), adaptation_sets_.end(),
+                   [](const std::unique_ptr<AdaptationSet>& adaptation_set) {
+                     return adaptation_set->xml_changed();
+                   })) {
+    return cached_xml_;
+  }
+
   adaptation_sets_.sort(
       [](const std::unique_ptr<AdaptationSet>& adaptation_set_a,
          const std::unique_ptr<AdaptationSet>& adaptation_set_b) {
@@ -154,6 +166,11 @@ base::Optional<xml::XmlNode> Period::GetXml(bool output_period_duration) {
       return base::nullopt;
     }
   }
+  // The Periods before the live one do not change anymore, so they are only
+  // serialized once.
+  period.KeepSerialized();
+  cached_xml_.emplace(period);
+  cached_xml_output_period_duration_ = output_period_duration;
   return period;
 }
 
@@ -287,10 +304,9 @@ AdaptationSet* Period::FindMatchingAdaptationSetForTrickPlay(
 
 std::string Period::GetAdaptationSetKeyForTrickPlay(
     const MediaInfo& media_info) {
-  MediaInfo media_info_no_trickplay = media_info;
-  media_info_no_trickplay.mutable_video_info()->clear_playback_rate();
-  return GetAdaptationSetKey(media_info_no_trickplay,
-                             mpd_options_.mpd_params.allow_codec_switching);
+  return GetAdaptationSetKey(media_info,
+                             mpd_options_.mpd_params.allow_codec_switching,
+                             true);
 }
 
 void Period::ProtectedAdaptationSetMap::Register(
@@ -44,6 +44,8 @@ class Period {
       bool content_protection_in_adaptation_set);
 
   /// Generates <Period> xml element with its child AdaptationSet elements.
+  /// The element is cached and reused until the Period or one of its
+  /// AdaptationSets changes.
   /// @return On success returns a non-NULL scoped_xml_ptr. Otherwise returns a
   ///         NULL scoped_xml_ptr.
   base::Optional<xml::XmlNode> GetXml(bool output_period_duration);
@@ -59,6 +61,8 @@ class Period {
 
   /// Set period duration.
   void set_duration_seconds(double duration_seconds) {
+    if (duration_seconds_ != duration_seconds)
+      cached_xml_.reset();
     duration_seconds_ = duration_seconds;
   }
 
@@ -134,6 +138,13 @@ class Period {
   // AdaptationSet.
   std::map<std::string, std::list<AdaptationSet*>> trickplay_cache_;
 
+  // The element returned by the last GetXml() call, and the
+  // |output_period_duration| it was generated with. It is reset when the
+  // Period changes; the changes of the AdaptationSets are tracked by the
+  // AdaptationSets.
+  base::Optional<xml::XmlNode> cached_xml_;
+  bool cached_xml_output_period_duration_ = false;
+
   // Tracks ProtectedContent in AdaptationSet.
   class ProtectedAdaptationSetMap {
    public:
@@ -12,7 +12,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/file/file.h"
+#include "packager/file/file_deleter.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/base/mpd_utils.h"
@@ -108,6 +108,7 @@ Representation::Representation(
   codecs_ = representation.codecs_;
 
   start_number_ = representation.start_number_;
+  start_number_set_ = representation.start_number_set_;
   for (const SegmentInfo& segment_info : representation.segment_infos_)
     start_number_ += segment_info.repeat + 1;
 }
@@ -160,12 +161,16 @@ void Representation::AddContentProtectionElement(
     const ContentProtectionElement& content_protection_element) {
   content_protection_elements_.push_back(content_protection_element);
   RemoveDuplicateAttributes(&content_protection_elements_.back());
+  content_protection_xml_.reset();
+  cached_xml_.reset();
 }
 
 void Representation::UpdateContentProtectionPssh(const std::string& drm_uuid,
                                                  const std::string& pssh) {
   UpdateContentProtectionPsshHelper(drm_uuid, pssh,
                                     &content_protection_elements_);
+  content_protection_xml_.reset();
+  cached_xml_.reset();
 }
 
 void Representation::AddNewSegment(int64_t start_time,
@@ -186,11 +191,66 @@ void Representation::AddNewSegment(int64_t start_time,
   if (state_change_listener_)
     state_change_listener_->OnNewSegmentForRepresentation(start_time, duration);
 
+  // Number the segments like the muxer, see media::SegmentIndexer.
+  if (!start_number_set_ &&
+      mpd_options_.mpd_params.segment_numbers_from_timestamps) {
+    uint32_t segment_index = 0;
+    // The muxer fails on the segment first.
+    LOG_IF(ERROR, !media::GetTimelineSegmentIndex(
+                      start_time, media_info_.reference_time_scale(),
+                      mpd_options_.mpd_params.target_segment_duration,
+                      &segment_index))
+        << "The segment number does not fit in 32 bits.";
+    start_number_ = segment_index + 1;
+  }
+  start_number_set_ = true;
+
   AddSegmentInfo(start_time, duration);
   current_buffer_depth_ += segment_infos_.back().duration;
 
   bandwidth_estimator_.AddBlock(
       size, static_cast<double>(duration) / media_info_.reference_time_scale());
+  cached_xml_.reset();
+  UpdateHistoryMemoryUsage();
+}
+
+void Representation::SaveCheckpoint(
+    RepresentationCheckpoint* checkpoint) const {
+  checkpoint->set_start_number(start_number_);
+  uint32_t num_segments = 0;
+  for (const SegmentInfo& segment_info : segment_infos_) {
+    RepresentationCheckpoint::SegmentInfo* saved_segment_info =
+        checkpoint->add_segment_infos();
+    saved_segment_info->set_start_time(segment_info.start_time);
+    saved_segment_info->set_duration(segment_info.duration);
+    saved_segment_info->set_repeat(segment_info.repeat);
+    num_segments += segment_info.repeat + 1;
+  }
+  // |start_number_| is the $Number$ of the first segment, i.e. its index plus
+  // one.
+  checkpoint->set_next_segment_index(start_number_ - 1 + num_segments);
+}
+
+void Representation::RestoreCheckpoint(
+    const RepresentationCheckpoint& checkpoint) {
+  DCHECK(segment_infos_.empty());
+  start_number_ = checkpoint.start_number();
+  start_number_set_ = true;
+  current_buffer_depth_ = 0;
+  for (const RepresentationCheckpoint::SegmentInfo& saved_segment_info :
+       checkpoint.segment_infos()) {
+    SegmentInfo segment_info = {saved_segment_info.start_time(),
+                                saved_segment_info.duration(),
+                                saved_segment_info.repeat()};
+    segment_infos_.push_back(segment_info);
+    current_buffer_depth_ += segment_info.duration * (segment_info.repeat + 1);
+  }
+  if (!segment_infos_.empty()) {
+    last_segment_info_min_duration_ = segment_infos_.back().duration;
+    last_segment_info_max_duration_ = segment_infos_.back().duration;
+  }
+  cached_xml_.reset();
+  UpdateHistoryMemoryUsage();
 }
 
 void Representation::SetSampleDuration(uint32_t frame_duration) {
@@ -198,6 +258,7 @@ void Representation::SetSampleDuration(uint32_t frame_duration) {
   // Text is required to have exactly the same segment duration.
   if (media_info_.has_audio_info() || media_info_.has_video_info())
     frame_duration_ = frame_duration;
+  cached_xml_.reset();
 
   if (media_info_.has_video_info()) {
     media_info_.mutable_video_info()->set_frame_duration(frame_duration);
@@ -230,6 +291,12 @@ base::Optional<xml::XmlNode> Representation::GetXml() {
 
   DCHECK(!(HasVODOnlyFields(media_info_) && HasLiveOnlyFields(media_info_)));
 
+  if (cached_xml_ &&
+      cached_xml_suppression_flags_ == output_suppression_flags_) {
+    output_suppression_flags_ = 0;
+    return cached_xml_;
+  }
+
   xml::RepresentationXmlNode representation;
   // Mandatory fields for Representation.
   if (!representation.SetId(id_) ||
@@ -259,10 +326,16 @@ base::Optional<xml::XmlNode> Representation::GetXml() {
     return base::nullopt;
   }
 
-  if (!representation.AddContentProtectionElements(
-          content_protection_elements_)) {
-    return base::nullopt;
+  if (!content_protection_xml_) {
+    std::vector<xml::XmlNode> content_protection_xml;
+    if (!xml::RepresentationBaseXmlNode::GenerateContentProtectionNodes(
+            content_protection_elements_, &content_protection_xml)) {
+      return base::nullopt;
+    }
+    content_protection_xml_ = std::move(content_protection_xml);
   }
+  if (!representation.AddContentProtectionNodes(*content_protection_xml_))
+    return base::nullopt;
 
   if (HasVODOnlyFields(media_info_) &&
       !representation.AddVODOnlyInfo(media_info_)) {
@@ -279,6 +352,8 @@ base::Optional<xml::XmlNode> Representation::GetXml() {
   // TODO(rkuroiwa): It is likely that all representations have the exact same
   // SegmentTemplate. Optimize and propagate the tag up to AdaptationSet level.
 
+  cached_xml_.emplace(representation);
+  cached_xml_suppression_flags_ = output_suppression_flags_;
   output_suppression_flags_ = 0;
   return std::move(representation);
 }
@@ -293,6 +368,7 @@ void Representation::SetPresentationTimeOffset(
   if (pto <= 0)
     return;
   media_info_.set_presentation_time_offset(pto);
+  cached_xml_.reset();
 }
 
 bool Representation::GetStartAndEndTimestamps(
@@ -342,18 +418,14 @@ void Representation::AddSegmentInfo(int64_t start_time, int64_t duration) {
     // Make it continuous if the segment start time is close to previous segment
     // end time.
     if (ApproximiatelyEqual(previous_segment_end_time, start_time)) {
-      const int64_t segment_end_time_for_same_duration =
-          previous_segment_end_time + previous.duration;
       const int64_t actual_segment_end_time = start_time + duration;
-      // Consider the segments having identical duration if the segment end time
-      // is close to calculated segment end time by assuming identical duration.
-      if (ApproximiatelyEqual(segment_end_time_for_same_duration,
-                              actual_segment_end_time)) {
-        ++segment_infos_.back().repeat;
-      } else {
+      // Consider the segments having identical duration if there is a
+      // duration which keeps the segment end times close to the actual ones.
+      if (!ExtendLastSegmentInfo(actual_segment_end_time)) {
         segment_infos_.push_back(
             {previous_segment_end_time,
              actual_segment_end_time - previous_segment_end_time, kNoRepeat});
+        SetLastSegmentInfoDurationRange(actual_segment_end_time);
       }
       return;
     }
@@ -380,11 +452,56 @@ void Representation::AddSegmentInfo(int64_t start_time, int64_t duration) {
   }
 
   segment_infos_.push_back({start_time, adjusted_duration, kNoRepeat});
+  SetLastSegmentInfoDurationRange(start_time + duration);
+}
+
+bool Representation::ExtendLastSegmentInfo(int64_t segment_end_time) {
+  SegmentInfo& last = segment_infos_.back();
+  const int64_t num_segments = last.repeat + 2;
+  const int64_t elapsed = segment_end_time - last.start_time;
+  const int64_t error_threshold = GetErrorThreshold();
+  // Keep the durations which put the end of the new segment within the error
+  // threshold too, rounding the smallest one up.
+  const int64_t min_duration =
+      std::max(last_segment_info_min_duration_,
+               (elapsed - error_threshold + num_segments - 1) / num_segments);
+  const int64_t max_duration =
+      std::min(last_segment_info_max_duration_,
+               (elapsed + error_threshold) / num_segments);
+  if (min_duration > max_duration)
+    return false;
+
+  // Change the duration as little as possible, e.g. to keep the target
+  // duration set by AdjustDuration(). The segments already counted in
+  // |current_buffer_depth_| are updated.
+  const int64_t new_duration =
+      std::min(std::max(last.duration, min_duration), max_duration);
+  current_buffer_depth_ += (new_duration - last.duration) * (last.repeat + 1);
+  last.duration = new_duration;
+  ++last.repeat;
+  last_segment_info_min_duration_ = min_duration;
+  last_segment_info_max_duration_ = max_duration;
+  return true;
+}
+
+void Representation::SetLastSegmentInfoDurationRange(
+    int64_t segment_end_time) {
+  const SegmentInfo& last = segment_infos_.back();
+  const int64_t elapsed = segment_end_time - last.start_time;
+  const int64_t error_threshold = GetErrorThreshold();
+  last_segment_info_min_duration_ =
+      std::min(last.duration, std::max<int64_t>(1, elapsed - error_threshold));
+  last_segment_info_max_duration_ =
+      std::max(last.duration, elapsed + error_threshold);
 }
 
 bool Representation::ApproximiatelyEqual(int64_t time1, int64_t time2) const {
+  return std::abs(time1 - time2) <= GetErrorThreshold();
+}
+
+int64_t Representation::GetErrorThreshold() const {
   if (!allow_approximate_segment_timeline_)
-    return time1 == time2;
+    return 0;
 
   // It is not always possible to align segment duration to target duration
   // exactly. For example, for AAC with sampling rate of 44100, there are always
@@ -397,11 +514,9 @@ bool Representation::ApproximiatelyEqual(int64_t time1, int64_t time2) const {
   const double kErrorThresholdSeconds = 0.05;
 
   // So we consider two times equal if they differ by less than one sample.
-  const uint32_t error_threshold =
-      std::min(frame_duration_,
-               static_cast<uint32_t>(kErrorThresholdSeconds *
-                                     media_info_.reference_time_scale()));
-  return std::abs(time1 - time2) <= error_threshold;
+  return std::min(frame_duration_,
+                  static_cast<uint32_t>(kErrorThresholdSeconds *
+                                        media_info_.reference_time_scale()));
 }
 
 int64_t Representation::AdjustDuration(int64_t duration) const {
@@ -429,27 +544,37 @@ void Representation::SlideWindow() {
   if (current_buffer_depth_ <= time_shift_buffer_depth)
     return;
 
-  std::list<SegmentInfo>::iterator first = segment_infos_.begin();
-  std::list<SegmentInfo>::iterator last = first;
-  for (; last != segment_infos_.end(); ++last) {
-    // Remove the current segment only if it falls completely out of time shift
+  while (!segment_infos_.empty()) {
+    SegmentInfo& first = segment_infos_.front();
+    // Remove the first segment only if it falls completely out of time shift
     // buffer range.
-    while (last->repeat >= 0 &&
-           current_buffer_depth_ - last->duration >= time_shift_buffer_depth) {
-      current_buffer_depth_ -= last->duration;
-      RemoveOldSegment(&*last);
-      start_number_++;
-    }
-    if (last->repeat >= 0)
+    if (current_buffer_depth_ - first.duration < time_shift_buffer_depth)
       break;
+    current_buffer_depth_ -= first.duration;
+    RemoveOldSegment(&first);
+    start_number_++;
+    if (first.repeat < 0)
+      segment_infos_.pop_front();
   }
-  segment_infos_.erase(first, last);
+}
+
+void Representation::UpdateHistoryMemoryUsage() {
+  uint64_t bytes = segment_infos_.size() * sizeof(SegmentInfo);
+  for (const std::string& segment_name : segments_to_be_removed_)
+    bytes += sizeof(segment_name) + segment_name.capacity();
+  history_memory_usage_.Set(bytes);
 }
 
 void Representation::RemoveOldSegment(SegmentInfo* segment_info) {
   int64_t segment_start_time = segment_info->start_time;
   segment_info->start_time += segment_info->duration;
   segment_info->repeat--;
+  // The range of durations is relative to the former start time, so the
+  // duration of the last entry does not change anymore.
+  if (segment_info == &segment_infos_.back()) {
+    last_segment_info_min_duration_ = segment_info->duration;
+    last_segment_info_max_duration_ = segment_info->duration;
+  }
 
   if (mpd_options_.mpd_params.preserved_segments_outside_live_window == 0)
     return;
@@ -459,12 +584,7 @@ void Representation::RemoveOldSegment(SegmentInfo* segment_info) {
                             start_number_ - 1, media_info_.bandwidth()));
   while (segments_to_be_removed_.size() >
          mpd_options_.mpd_params.preserved_segments_outside_live_window) {
-    VLOG(2) << "Deleting " << segments_to_be_removed_.front();
-    if (!File::Delete(segments_to_be_removed_.front().c_str())) {
-      LOG(WARNING) << "Failed to delete " << segments_to_be_removed_.front()
-                   << "; Will retry later.";
-      break;
-    }
+    FileDeleter::GetInstance()->Delete(segments_to_be_removed_.front());
     segments_to_be_removed_.pop_front();
   }
 }
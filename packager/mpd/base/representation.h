@@ -11,11 +11,15 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "packager/base/optional.h"
+#include "packager/metrics/memory_usage.h"
 #include "packager/mpd/base/bandwidth_estimator.h"
+#include "packager/mpd/base/manifest_checkpoint.pb.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/segment_info.h"
 #include "packager/mpd/base/xml/xml_node.h"
@@ -111,7 +115,8 @@ class Representation {
   /// @return MediaInfo for the Representation.
   virtual const MediaInfo& GetMediaInfo() const;
 
-  /// @return Copy of <Representation>.
+  /// @return Copy of <Representation>. The element is cached and reused until
+  ///         the Representation changes.
   base::Optional<xml::XmlNode> GetXml();
 
   /// By calling this methods, the next time GetXml() is
@@ -141,7 +146,29 @@ class Representation {
   /// @return ID number for <Representation>.
   uint32_t id() const { return id_; }
 
-  void set_media_info(const MediaInfo& media_info) { media_info_ = media_info; }
+  /// Saves the segments of the Representation, except its segment template
+  /// which is set by the caller.
+  void SaveCheckpoint(RepresentationCheckpoint* checkpoint) const;
+  /// Restores the segments saved by SaveCheckpoint() in a previous run, so
+  /// the new segments are added after them. Must be called before any
+  /// segment is added.
+  void RestoreCheckpoint(const RepresentationCheckpoint& checkpoint);
+
+  void set_media_info(const MediaInfo& media_info) {
+    media_info_ = media_info;
+    cached_xml_.reset();
+  }
+
+  /// Same as above, but takes over the content of |media_info| instead of
+  /// copying it.
+  void set_media_info(MediaInfo&& media_info) {
+    media_info_.Swap(&media_info);
+    cached_xml_.reset();
+  }
+
+  /// @return true if the element returned by the last GetXml() call is stale,
+  ///         i.e. the Representation changed since.
+  bool xml_changed() const { return !cached_xml_; }
 
  protected:
   /// @param media_info is a MediaInfo containing information on the media.
@@ -180,11 +207,25 @@ class Representation {
   // |allow_approximate_segment_timeline_| is set.
   void AddSegmentInfo(int64_t start_time, int64_t duration);
 
+  // Merge the segment ending at |segment_end_time| into the last entry of
+  // |segment_infos_| if a duration of the entry keeps the end of all its
+  // segments approximately equal to the actual ones, e.g. alternating 1.984s
+  // and 2.005s AAC segments. The duration may be updated. Returns false if
+  // there is no such duration.
+  bool ExtendLastSegmentInfo(int64_t segment_end_time);
+
+  // Set the range of durations of the last entry of |segment_infos_|, which
+  // has one segment ending at |segment_end_time|.
+  void SetLastSegmentInfoDurationRange(int64_t segment_end_time);
+
   // Check if two timestamps are approximately equal if
   // |allow_approximate_segment_timeline_| is set; Otherwise check whether the
   // two times match.
   bool ApproximiatelyEqual(int64_t time1, int64_t time2) const;
 
+  // Returns the largest difference of approximately equal timestamps.
+  int64_t GetErrorThreshold() const;
+
   // Return adjusted duration if |allow_aproximate_segment_timeline_or_duration|
   // is set; otherwise duration is returned without adjustment.
   int64_t AdjustDuration(int64_t duration) const;
@@ -196,6 +237,9 @@ class Representation {
   // Remove the first segment in |segment_info|.
   void RemoveOldSegment(SegmentInfo* segment_info);
 
+  // Update |history_memory_usage_| after the segment history changes.
+  void UpdateHistoryMemoryUsage();
+
   // Note: Because 'mimeType' is a required field for a valid MPD, these return
   // strings.
   std::string GetVideoMimeType() const;
@@ -209,10 +253,17 @@ class Representation {
   // any logic using this can assume only one set.
   MediaInfo media_info_;
   std::list<ContentProtectionElement> content_protection_elements_;
+  // The ContentProtection elements generated for |content_protection_elements_|,
+  // which are kept across the MPD updates until the elements change, e.g. on
+  // an encryption update.
+  base::Optional<std::vector<xml::XmlNode>> content_protection_xml_;
 
   int64_t current_buffer_depth_ = 0;
   // TODO(kqyang): Address sliding window issue with multiple periods.
-  std::list<SegmentInfo> segment_infos_;
+  // Run-length encoded like the SegmentTimeline: new segments are merged into
+  // the last entry and old segments are evicted from the first entry, so a
+  // deque makes both constant time.
+  std::deque<SegmentInfo> segment_infos_;
   // A list to hold the file names of the segments to be removed temporarily.
   // Once a file is actually removed, it is removed from the list.
   std::list<std::string> segments_to_be_removed_;
@@ -226,6 +277,10 @@ class Representation {
   // startNumber attribute for SegmentTemplate.
   // Starts from 1.
   uint32_t start_number_ = 1;
+  // Set once the first segment is added or a checkpoint is restored, as
+  // |start_number_| is derived from the first segment with
+  // MpdParams::segment_numbers_from_timestamps.
+  bool start_number_set_ = false;
 
   // If this is not null, then Representation is responsible for calling the
   // right methods at right timings.
@@ -234,12 +289,25 @@ class Representation {
   // Bit vector for tracking witch attributes should not be output.
   int output_suppression_flags_ = 0;
 
+  // The element returned by the last GetXml() call, and the suppression flags
+  // it was generated with. It is reset when the Representation changes.
+  base::Optional<xml::XmlNode> cached_xml_;
+  int cached_xml_suppression_flags_ = 0;
+
+  // Accounts for the memory used by |segment_infos_| and
+  // |segments_to_be_removed_|.
+  MemoryUsage history_memory_usage_{"dash_segment_history"};
+
   // When set to true, allows segments to have slightly different durations (up
   // to one sample).
   const bool allow_approximate_segment_timeline_ = false;
   // Segments with duration difference less than one frame duration are
   // considered to have the same duration.
   uint32_t frame_duration_ = 0;
+  // The durations of the last entry of |segment_infos_| which keep the end of
+  // each of its segments approximately equal to the actual ones.
+  int64_t last_segment_info_min_duration_ = 0;
+  int64_t last_segment_info_max_duration_ = 0;
 };
 
 }  // namespace shaka
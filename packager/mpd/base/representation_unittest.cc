@@ -14,6 +14,7 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/file/file_deleter.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/test/mpd_builder_test_helper.h"
 #include "packager/mpd/test/xml_compare.h"
@@ -393,6 +394,85 @@ TEST_F(RepresentationTest, SuppressRepresentationAttributes) {
   EXPECT_THAT(no_frame_rate, AttributeEqual("height", "480"));
 }
 
+// Verify that the element is reused until the Representation changes.
+TEST_F(RepresentationTest, GetXmlCachedUntilChanged) {
+  const char kTestMediaInfo[] =
+      "video_info {\n"
+      "  codec: 'avc1'\n"
+      "  width: 720\n"
+      "  height: 480\n"
+      "  time_scale: 10\n"
+      "  frame_duration: 10\n"
+      "  pixel_width: 1\n"
+      "  pixel_height: 1\n"
+      "}\n"
+      "reference_time_scale: 10\n"
+      "container_type: 1\n";
+
+  auto representation = CreateRepresentation(
+      ConvertToMediaInfo(kTestMediaInfo), kAnyRepresentationId, NoListener());
+  EXPECT_TRUE(representation->xml_changed());
+  EXPECT_THAT(representation->GetXml(), AttributeEqual("bandwidth", "0"));
+  EXPECT_FALSE(representation->xml_changed());
+  EXPECT_THAT(representation->GetXml(), AttributeEqual("bandwidth", "0"));
+
+  // The suppression flags are part of the cached state.
+  representation->SuppressOnce(Representation::kSuppressWidth);
+  EXPECT_THAT(representation->GetXml(), Not(AttributeSet("width")));
+  EXPECT_THAT(representation->GetXml(), AttributeEqual("width", "720"));
+
+  const int64_t kStartTime = 0;
+  const int64_t kDuration = 10;
+  const uint64_t kSize = 1000;
+  representation->AddNewSegment(kStartTime, kDuration, kSize);
+  EXPECT_TRUE(representation->xml_changed());
+  EXPECT_THAT(representation->GetXml(), AttributeEqual("bandwidth", "8000"));
+  EXPECT_FALSE(representation->xml_changed());
+}
+
+// The ContentProtection elements are reused across the updates of the
+// Representation until they change.
+TEST_F(RepresentationTest, ContentProtectionXmlKeptUntilEncryptionUpdate) {
+  const char kTestMediaInfo[] =
+      "video_info {\n"
+      "  codec: 'avc1'\n"
+      "  width: 720\n"
+      "  height: 480\n"
+      "  time_scale: 10\n"
+      "}\n"
+      "reference_time_scale: 10\n"
+      "container_type: 1\n";
+  const char kDrmUuid[] = "edef8ba9-79d6-4ace-a3c8-27dcd51d21ed";
+
+  auto representation = CreateRepresentation(
+      ConvertToMediaInfo(kTestMediaInfo), kAnyRepresentationId, NoListener());
+  ContentProtectionElement content_protection;
+  content_protection.scheme_id_uri = std::string("urn:uuid:") + kDrmUuid;
+  Element pssh;
+  pssh.name = "cenc:pssh";
+  pssh.content = "cHNzaA==";
+  content_protection.subelements.push_back(pssh);
+  representation->AddContentProtectionElement(content_protection);
+
+  auto xml = representation->GetXml();
+  ASSERT_TRUE(xml);
+  const std::string first_output = xml->ToString("");
+  EXPECT_NE(std::string::npos, first_output.find("cHNzaA=="));
+
+  representation->AddNewSegment(0, 10, 1000);
+  xml = representation->GetXml();
+  ASSERT_TRUE(xml);
+  EXPECT_NE(std::string::npos, xml->ToString("").find("cHNzaA=="));
+
+  // The PSSH element is removed on an encryption update.
+  representation->UpdateContentProtectionPssh(kDrmUuid, "bmV3IHBzc2g=");
+  xml = representation->GetXml();
+  ASSERT_TRUE(xml);
+  const std::string updated_output = xml->ToString("");
+  EXPECT_NE(std::string::npos, updated_output.find(kDrmUuid));
+  EXPECT_EQ(std::string::npos, updated_output.find("cHNzaA=="));
+}
+
 TEST_F(RepresentationTest, CheckRepresentationId) {
   const MediaInfo video_media_info = GetTestMediaInfo(kFileNameVideoMediaInfo1);
   const uint32_t kRepresentationId = 1;
@@ -535,6 +615,48 @@ TEST_F(SegmentTemplateTest, RepresentationClone) {
   EXPECT_THAT(cloned_representation->GetXml(), XmlNodeEqual(kExpectedXml));
 }
 
+// A Representation restored from a checkpoint continues the segment timeline
+// and the segment numbering of the original one.
+TEST_F(SegmentTemplateTest, RestoreCheckpoint) {
+  const int64_t kStartTime = 88;
+  const int64_t kDuration = 10;
+  const uint64_t kSize = 128;
+  AddSegments(kStartTime, kDuration, kSize, 0);
+  AddSegments(kStartTime + kDuration, kDuration * 2, kSize, 2);
+
+  RepresentationCheckpoint checkpoint;
+  representation_->SaveCheckpoint(&checkpoint);
+  EXPECT_EQ(4u, checkpoint.next_segment_index());
+
+  auto restored_representation =
+      CreateRepresentation(ConvertToMediaInfo(GetDefaultMediaInfo()),
+                           kAnyRepresentationId, NoListener());
+  ASSERT_TRUE(restored_representation->Init());
+  restored_representation->RestoreCheckpoint(checkpoint);
+
+  RepresentationCheckpoint restored_checkpoint;
+  restored_representation->SaveCheckpoint(&restored_checkpoint);
+  EXPECT_EQ(checkpoint.SerializeAsString(),
+            restored_checkpoint.SerializeAsString());
+
+  double start_timestamp;
+  double end_timestamp;
+  ASSERT_TRUE(restored_representation->GetStartAndEndTimestamps(
+      &start_timestamp, &end_timestamp));
+  EXPECT_EQ(static_cast<double>(kStartTime) / kDefaultTimeScale,
+            start_timestamp);
+  EXPECT_EQ(static_cast<double>(kStartTime + kDuration * 7) / kDefaultTimeScale,
+            end_timestamp);
+
+  restored_representation->AddNewSegment(kStartTime + kDuration * 7,
+                                         kDuration * 2, kSize);
+  restored_checkpoint.Clear();
+  restored_representation->SaveCheckpoint(&restored_checkpoint);
+  EXPECT_EQ(5u, restored_checkpoint.next_segment_index());
+  ASSERT_EQ(2, restored_checkpoint.segment_infos_size());
+  EXPECT_EQ(3, restored_checkpoint.segment_infos(1).repeat());
+}
+
 TEST_F(SegmentTemplateTest, PresentationTimeOffset) {
   const int64_t kStartTime = 0;
   const int64_t kDuration = 10;
@@ -851,9 +973,11 @@ TEST_P(ApproximateSegmentTimelineTest, SegmentsWithSimilarDurations2) {
 
   std::string expected_s_elements;
   if (allow_approximate_segment_timeline_) {
-    expected_s_elements =
-        "<S t=\"0\" d=\"10\" r=\"1\"/>"
-        "<S t=\"20\" d=\"13\"/>";
+    // The duration is updated to keep the segment end times within one sample
+    // of the actual ones.
+    int kNumSegments = 3;
+    expected_s_elements = base::StringPrintf(kSElementTemplate, kStartTime,
+                                             kDurationLarger, kNumSegments - 1);
   } else {
     int kNumSegments = 3;
     expected_s_elements = base::StringPrintf(kSElementTemplate, kStartTime,
@@ -863,6 +987,36 @@ TEST_P(ApproximateSegmentTimelineTest, SegmentsWithSimilarDurations2) {
               XmlNodeEqual(ExpectedXml(expected_s_elements)));
 }
 
+// Segment durations alternating around a duration other than the target
+// duration, e.g. 1.984s and 2.005s for AAC, are merged too.
+TEST_P(ApproximateSegmentTimelineTest, SegmentsWithAlternatingDurations) {
+  const int64_t kStartTime = 0;
+  const int64_t kDurationSmaller = kScaledTargetSegmentDuration + 2;
+  const int64_t kDurationLarger = kScaledTargetSegmentDuration + 4;
+  const int kNumSegments = 8;
+  const uint64_t kSize = 128;
+  int64_t segment_start_time = kStartTime;
+  std::string exact_s_elements;
+  for (int i = 0; i < kNumSegments; ++i) {
+    const int64_t duration = i % 2 == 0 ? kDurationSmaller : kDurationLarger;
+    AddSegments(segment_start_time, duration, kSize, 0);
+    exact_s_elements += base::StringPrintf(kSElementTemplateWithoutR,
+                                           segment_start_time, duration);
+    segment_start_time += duration;
+  }
+
+  std::string expected_s_elements;
+  if (allow_approximate_segment_timeline_) {
+    expected_s_elements = base::StringPrintf(
+        kSElementTemplate, kStartTime, (kDurationSmaller + kDurationLarger) / 2,
+        kNumSegments - 1);
+  } else {
+    expected_s_elements = exact_s_elements;
+  }
+  EXPECT_THAT(representation_->GetXml(),
+              XmlNodeEqual(ExpectedXml(expected_s_elements)));
+}
+
 TEST_P(ApproximateSegmentTimelineTest, FillSmallGap) {
   const int64_t kStartTime = 0;
   const int64_t kDuration = kScaledTargetSegmentDuration;
@@ -1279,6 +1433,7 @@ class RepresentationDeleteSegmentsTest : public SegmentTimelineTestBase {
   }
 
   bool SegmentDeleted(const std::string& segment_name) {
+    FileDeleter::GetInstance()->Flush();
     std::unique_ptr<File, FileCloser> file_closer(
         File::Open(segment_name.c_str(), "r"));
     return file_closer.get() == nullptr;
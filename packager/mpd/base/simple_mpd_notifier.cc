@@ -6,8 +6,16 @@
 
 #include "packager/mpd/base/simple_mpd_notifier.h"
 
+#include "packager/base/bind.h"
+#include "packager/base/bind_helpers.h"
 #include "packager/base/logging.h"
 #include "packager/base/stl_util.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+#include "packager/file/precompressed_file_writer.h"
+#include "packager/media/base/auto_lock_all.h"
+#include "packager/metrics/metrics.h"
+#include "packager/metrics/trace_event.h"
 #include "packager/mpd/base/adaptation_set.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
@@ -25,6 +33,15 @@ SimpleMpdNotifier::SimpleMpdNotifier(const MpdOptions& mpd_options)
           mpd_options.mpd_params.generate_dash_if_iop_compliant_mpd) {
   for (const std::string& base_url : mpd_options.mpd_params.base_urls)
     mpd_builder_->AddBaseUrl(base_url);
+  if (mpd_options.mpd_params.update_coalescing_window > 0 &&
+      mpd_options.mpd_type == MpdType::kDynamic) {
+    update_runner_.reset(new media::CoalescingTaskRunner(
+        "MpdWriter",
+        base::TimeDelta::FromSecondsD(
+            mpd_options.mpd_params.update_coalescing_window),
+        base::Bind(base::IgnoreResult(&SimpleMpdNotifier::WriteMpd),
+                   base::Unretained(this))));
+  }
 }
 
 SimpleMpdNotifier::~SimpleMpdNotifier() {}
@@ -45,6 +62,11 @@ bool SimpleMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
   MpdBuilder::MakePathsRelativeToMpd(output_path_, &adjusted_media_info);
 
   base::AutoLock auto_lock(lock_);
+  // The new Representation may change the state of its AdaptationSet shared
+  // with the other Representations.
+  media::AutoLockAll representation_locks(GetRepresentationLocks());
+  // Recorded while the locks are held, to show the lock hold time.
+  SHAKA_TRACE_EVENT("mpd", "SimpleMpdNotifier::NotifyNewContainer");
   const double kPeriodStartTimeSeconds = 0.0;
   Period* period = mpd_builder_->GetOrCreatePeriod(kPeriodStartTimeSeconds);
   DCHECK(period);
@@ -58,28 +80,28 @@ bool SimpleMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
   if (!representation)
     return false;
 
-  *container_id = representation->id();
-  if (content_protection_in_adaptation_set_) {
-    // ContentProtection elements are already added to AdaptationSet above.
-    // Use RepresentationId to AdaptationSet map to update ContentProtection
-    // in AdaptationSet in NotifyEncryptionUpdate.
-    representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
-  } else {
-    AddContentProtectionElements(media_info, representation);
+  // Resume the segments of the Representation from the previous run.
+  auto checkpoint_iter =
+      representation_checkpoints_.find(media_info.segment_template());
+  if (checkpoint_iter != representation_checkpoints_.end()) {
+    representation->RestoreCheckpoint(checkpoint_iter->second);
+    representation_checkpoints_.erase(checkpoint_iter);
   }
-  representation_map_[representation->id()] = representation;
+
+  *container_id = representation->id();
+  AddRepresentationEntry(representation, adaptation_set,
+                         media_info.segment_template());
   return true;
 }
 
 bool SimpleMpdNotifier::NotifySampleDuration(uint32_t container_id,
                                              uint32_t sample_duration) {
-  base::AutoLock auto_lock(lock_);
-  auto it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
+  RepresentationEntry* entry = GetRepresentationEntry(container_id);
+  if (!entry)
     return false;
-  }
-  it->second->SetSampleDuration(sample_duration);
+  base::AutoLock auto_lock(entry->lock);
+  SHAKA_TRACE_EVENT("mpd", "SimpleMpdNotifier::NotifySampleDuration");
+  entry->representation->SetSampleDuration(sample_duration);
   return true;
 }
 
@@ -87,13 +109,12 @@ bool SimpleMpdNotifier::NotifyNewSegment(uint32_t container_id,
                                          uint64_t start_time,
                                          uint64_t duration,
                                          uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
+  RepresentationEntry* entry = GetRepresentationEntry(container_id);
+  if (!entry)
     return false;
-  }
-  it->second->AddNewSegment(start_time, duration, size);
+  base::AutoLock auto_lock(entry->lock);
+  SHAKA_TRACE_EVENT("mpd", "SimpleMpdNotifier::NotifyNewSegment");
+  entry->representation->AddNewSegment(start_time, duration, size);
   return true;
 }
 
@@ -105,9 +126,11 @@ bool SimpleMpdNotifier::NotifyCueEvent(uint32_t container_id,
     LOG(ERROR) << "Unexpected container_id: " << container_id;
     return false;
   }
-  Representation* original_representation = it->second;
-  AdaptationSet* original_adaptation_set =
-      representation_id_to_adaptation_set_[container_id];
+  // A new Period is created, so the MPD structure changes.
+  media::AutoLockAll representation_locks(GetRepresentationLocks());
+  SHAKA_TRACE_EVENT("mpd", "SimpleMpdNotifier::NotifyCueEvent");
+  Representation* original_representation = it->second->representation;
+  AdaptationSet* original_adaptation_set = it->second->adaptation_set;
 
   const MediaInfo& media_info = original_representation->GetMediaInfo();
   const double period_start_time_seconds =
@@ -129,15 +152,8 @@ bool SimpleMpdNotifier::NotifyCueEvent(uint32_t container_id,
   if (!representation)
     return false;
 
-  if (content_protection_in_adaptation_set_) {
-    // ContentProtection elements are already added to AdaptationSet above.
-    // Use RepresentationId to AdaptationSet map to update ContentProtection
-    // in AdaptationSet in NotifyEncryptionUpdate.
-    representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
-  } else {
-    AddContentProtectionElements(media_info, representation);
-  }
-  representation_map_[representation->id()] = representation;
+  AddRepresentationEntry(representation, adaptation_set,
+                         it->second->segment_template);
   return true;
 }
 
@@ -146,44 +162,159 @@ bool SimpleMpdNotifier::NotifyEncryptionUpdate(
     const std::string& drm_uuid,
     const std::vector<uint8_t>& new_key_id,
     const std::vector<uint8_t>& new_pssh) {
-  base::AutoLock auto_lock(lock_);
-  auto it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
+  RepresentationEntry* entry = GetRepresentationEntry(container_id);
+  if (!entry)
     return false;
-  }
+  base::AutoLock auto_lock(entry->lock);
+  SHAKA_TRACE_EVENT("mpd", "SimpleMpdNotifier::NotifyEncryptionUpdate");
 
   if (content_protection_in_adaptation_set_) {
-    AdaptationSet* adaptation_set_for_representation =
-        representation_id_to_adaptation_set_[it->second->id()];
-    adaptation_set_for_representation->UpdateContentProtectionPssh(
+    entry->adaptation_set->UpdateContentProtectionPssh(
         drm_uuid, Uint8VectorToBase64(new_pssh));
   } else {
-    it->second->UpdateContentProtectionPssh(drm_uuid,
-                                            Uint8VectorToBase64(new_pssh));
+    entry->representation->UpdateContentProtectionPssh(
+        drm_uuid, Uint8VectorToBase64(new_pssh));
   }
   return true;
 }
 
 bool SimpleMpdNotifier::NotifyMediaInfoUpdate(uint32_t container_id,
                                               const MediaInfo& media_info) {
-  base::AutoLock auto_lock(lock_);
-  auto it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
+  RepresentationEntry* entry = GetRepresentationEntry(container_id);
+  if (!entry)
     return false;
-  }
 
   MediaInfo adjusted_media_info(media_info);
   MpdBuilder::MakePathsRelativeToMpd(output_path_, &adjusted_media_info);
 
-  it->second->set_media_info(adjusted_media_info);
+  base::AutoLock auto_lock(entry->lock);
+  SHAKA_TRACE_EVENT("mpd", "SimpleMpdNotifier::NotifyMediaInfoUpdate");
+  entry->representation->set_media_info(std::move(adjusted_media_info));
   return true;
 }
 
 bool SimpleMpdNotifier::Flush() {
+  return WriteMpd();
+}
+
+void SimpleMpdNotifier::RequestFlush() {
+  if (update_runner_)
+    update_runner_->Request();
+  else
+    Flush();
+}
+
+void SimpleMpdNotifier::RunAfterFlush(std::function<void()> callback) {
+  base::AutoLock auto_lock(lock_);
+  flush_callbacks_.push_back(std::move(callback));
+}
+
+void SimpleMpdNotifier::SaveCheckpoint(ManifestCheckpoint* checkpoint) {
+  base::AutoLock auto_lock(lock_);
+  media::AutoLockAll representation_locks(GetRepresentationLocks());
+  // The Periods started by the ad cues cannot be resumed.
+  if (mpd_builder_->num_periods() > 1) {
+    LOG_IF(WARNING, !multi_period_checkpoint_skipped_)
+        << "The MPD has multiple Periods and is not checkpointed.";
+    multi_period_checkpoint_skipped_ = true;
+    return;
+  }
+  checkpoint->set_availability_start_time(
+      mpd_builder_->availability_start_time());
+  for (const auto& entry_pair : representation_map_) {
+    const RepresentationEntry& entry = *entry_pair.second;
+    // Only the segmented outputs are live.
+    if (entry.segment_template.empty())
+      continue;
+    RepresentationCheckpoint* representation_checkpoint =
+        checkpoint->add_representations();
+    representation_checkpoint->set_segment_template(entry.segment_template);
+    entry.representation->SaveCheckpoint(representation_checkpoint);
+  }
+}
+
+void SimpleMpdNotifier::ResumeFromCheckpoint(
+    const ManifestCheckpoint& checkpoint) {
+  base::AutoLock auto_lock(lock_);
+  DCHECK(representation_map_.empty());
+  mpd_builder_->set_availability_start_time(
+      checkpoint.availability_start_time());
+  for (const RepresentationCheckpoint& representation_checkpoint :
+       checkpoint.representations()) {
+    representation_checkpoints_[representation_checkpoint.segment_template()] =
+        representation_checkpoint;
+  }
+}
+
+SimpleMpdNotifier::RepresentationEntry*
+SimpleMpdNotifier::GetRepresentationEntry(uint32_t container_id) {
   base::AutoLock auto_lock(lock_);
-  return WriteMpdToFile(output_path_, mpd_builder_.get());
+  auto it = representation_map_.find(container_id);
+  if (it == representation_map_.end()) {
+    LOG(ERROR) << "Unexpected container_id: " << container_id;
+    return nullptr;
+  }
+  return it->second.get();
+}
+
+std::vector<base::Lock*> SimpleMpdNotifier::GetRepresentationLocks() {
+  lock_.AssertAcquired();
+  std::vector<base::Lock*> locks;
+  locks.reserve(representation_map_.size());
+  for (auto& entry_pair : representation_map_)
+    locks.push_back(&entry_pair.second->lock);
+  return locks;
+}
+
+void SimpleMpdNotifier::AddRepresentationEntry(
+    Representation* representation,
+    AdaptationSet* adaptation_set,
+    const std::string& segment_template) {
+  lock_.AssertAcquired();
+  // ContentProtection elements are already added to AdaptationSet if
+  // |content_protection_in_adaptation_set_| is true. The AdaptationSet in the
+  // entry is used to update them in NotifyEncryptionUpdate.
+  if (!content_protection_in_adaptation_set_)
+    AddContentProtectionElements(representation->GetMediaInfo(),
+                                 representation);
+  std::unique_ptr<RepresentationEntry> entry(new RepresentationEntry);
+  entry->representation = representation;
+  entry->adaptation_set = adaptation_set;
+  entry->segment_template = segment_template;
+  representation_map_[representation->id()] = std::move(entry);
+}
+
+bool SimpleMpdNotifier::WriteMpd() {
+  base::AutoLock write_lock(write_lock_);
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  std::string mpd;
+  // The callbacks registered so far, whose updates are in this MPD.
+  std::vector<std::function<void()>> flush_callbacks;
+  {
+    base::AutoLock auto_lock(lock_);
+    media::AutoLockAll representation_locks(GetRepresentationLocks());
+    SHAKA_TRACE_EVENT("mpd", "SimpleMpdNotifier::WriteMpd");
+    if (!mpd_builder_->ToString(&mpd)) {
+      LOG(ERROR) << "Failed to write MPD to string.";
+      return false;
+    }
+    flush_callbacks.swap(flush_callbacks_);
+  }
+  if (!File::WriteFileAtomically(output_path_.c_str(), mpd)) {
+    LOG(ERROR) << "Failed to write mpd to: " << output_path_;
+    // Run them after the next write instead.
+    base::AutoLock auto_lock(lock_);
+    flush_callbacks_.insert(flush_callbacks_.begin(), flush_callbacks.begin(),
+                            flush_callbacks.end());
+    return false;
+  }
+  PrecompressedFileWriter::GetInstance()->Write(output_path_, mpd);
+  Metrics::GetInstance()->ObserveDuration(
+      "shaka_manifest_write_seconds", "Time to generate and write manifests.",
+      {{"type", "mpd"}}, base::TimeTicks::Now() - start_time);
+  for (const auto& callback : flush_callbacks)
+    callback();
+  return true;
 }
 
 }  // namespace shaka
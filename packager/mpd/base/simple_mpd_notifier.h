@@ -7,12 +7,15 @@
 #ifndef MPD_BASE_SIMPLE_MPD_NOTIFIER_H_
 #define MPD_BASE_SIMPLE_MPD_NOTIFIER_H_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "packager/base/synchronization/lock.h"
+#include "packager/media/base/coalescing_task_runner.h"
+#include "packager/mpd/base/manifest_checkpoint.pb.h"
 #include "packager/mpd/base/mpd_notifier.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
 
@@ -25,7 +28,9 @@ class Representation;
 struct MpdOptions;
 
 /// A simple MpdNotifier implementation which receives muxer listener event and
-/// generates an Mpd file.
+/// generates an Mpd file. This is thread safe. The notifications of different
+/// Representations do not block each other, except while the MPD is
+/// generated.
 class SimpleMpdNotifier : public MpdNotifier {
  public:
   explicit SimpleMpdNotifier(const MpdOptions& mpd_options);
@@ -50,6 +55,12 @@ class SimpleMpdNotifier : public MpdNotifier {
   bool NotifyMediaInfoUpdate(uint32_t container_id,
                              const MediaInfo& media_info) override;
   bool Flush() override;
+  /// Writes the MPD on a dedicated thread if
+  /// MpdParams::update_coalescing_window is positive, coalescing the requests.
+  void RequestFlush() override;
+  void RunAfterFlush(std::function<void()> callback) override;
+  void SaveCheckpoint(ManifestCheckpoint* checkpoint) override;
+  void ResumeFromCheckpoint(const ManifestCheckpoint& checkpoint) override;
   /// @}
 
  private:
@@ -58,9 +69,43 @@ class SimpleMpdNotifier : public MpdNotifier {
 
   friend class SimpleMpdNotifierTest;
 
+  struct RepresentationEntry {
+    Representation* representation = nullptr;
+    // The AdaptationSet containing |representation|. This is for updating the
+    // PSSH.
+    AdaptationSet* adaptation_set = nullptr;
+    // The segment template of the output, as given to the muxer, which
+    // identifies the Representation in the checkpoints.
+    std::string segment_template;
+    // Guards |representation|. The notifications of the Representation only
+    // hold this lock.
+    base::Lock lock;
+  };
+
   // Testing only method. Returns a pointer to MpdBuilder.
   MpdBuilder* MpdBuilderForTesting() const { return mpd_builder_.get(); }
 
+  // Find the entry of a Representation. |lock_| is only held during the
+  // lookup. The entries are never removed, so the result stays valid.
+  // @return the entry, or null if |container_id| is unknown.
+  RepresentationEntry* GetRepresentationEntry(uint32_t container_id);
+
+  // @return the locks of all the Representations, in Representation ID order.
+  // |lock_| must be held. Holding all of them, with |lock_|, is required to
+  // change the structure of the MPD or to generate it.
+  std::vector<base::Lock*> GetRepresentationLocks();
+
+  // Add a new Representation to |representation_map_|. |lock_| and the locks
+  // of all the Representations must be held.
+  void AddRepresentationEntry(Representation* representation,
+                              AdaptationSet* adaptation_set,
+                              const std::string& segment_template);
+
+  // Generate the MPD and write it. The MPD is generated with all the locks
+  // held but written without them, so the notifications are not blocked on
+  // I/O.
+  bool WriteMpd();
+
   // Testing only method. Sets mpd_builder_.
   void SetMpdBuilderForTesting(std::unique_ptr<MpdBuilder> mpd_builder) {
     mpd_builder_ = std::move(mpd_builder);
@@ -70,13 +115,29 @@ class SimpleMpdNotifier : public MpdNotifier {
   std::string output_path_;
   std::unique_ptr<MpdBuilder> mpd_builder_;
   bool content_protection_in_adaptation_set_ = true;
+  // Guards |mpd_builder_| except the Representations, and
+  // |representation_map_|. Acquired before the locks of the Representations.
   base::Lock lock_;
 
   uint32_t next_adaptation_set_id_ = 0;
-  // Maps Representation ID to Representation.
-  std::map<uint32_t, Representation*> representation_map_;
-  // Maps Representation ID to AdaptationSet. This is for updating the PSSH.
-  std::map<uint32_t, AdaptationSet*> representation_id_to_adaptation_set_;
+  // Maps Representation ID to its entry. Maps to unique_ptr so the entries do
+  // not move.
+  std::map<uint32_t, std::unique_ptr<RepresentationEntry>> representation_map_;
+  // The Representation checkpoints to restore, by segment template, see
+  // ResumeFromCheckpoint().
+  std::map<std::string, RepresentationCheckpoint> representation_checkpoints_;
+  // Whether a checkpoint was skipped because of multiple Periods.
+  bool multi_period_checkpoint_skipped_ = false;
+  // The callbacks to run once the MPD is written, see RunAfterFlush().
+  // Guarded by |lock_|.
+  std::vector<std::function<void()>> flush_callbacks_;
+
+  // Serializes the writes of the MPD, so an older MPD never overwrites a newer
+  // one. Acquired before |lock_|.
+  base::Lock write_lock_;
+  // Not null if the MPD updates are coalesced. Declared last so it is stopped
+  // before the other members are destroyed.
+  std::unique_ptr<media::CoalescingTaskRunner> update_runner_;
 };
 
 }  // namespace shaka
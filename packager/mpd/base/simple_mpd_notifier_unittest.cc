@@ -195,6 +195,42 @@ TEST_F(SimpleMpdNotifierTest, NotifyNewSegment) {
                                         kSegmentDuration, kSegmentSize));
 }
 
+// Verify that the callbacks run once the MPD is written, and only once.
+TEST_F(SimpleMpdNotifierTest, RunAfterFlush) {
+  SimpleMpdNotifier notifier(empty_mpd_option_);
+  uint32_t container_id;
+  EXPECT_TRUE(notifier.NotifyNewContainer(valid_media_info1_, &container_id));
+
+  int num_calls = 0;
+  notifier.RunAfterFlush([&num_calls]() { ++num_calls; });
+  EXPECT_EQ(0, num_calls);
+  EXPECT_TRUE(notifier.Flush());
+  EXPECT_EQ(1, num_calls);
+  EXPECT_TRUE(notifier.Flush());
+  EXPECT_EQ(1, num_calls);
+}
+
+// Verify that the flush requests of a dynamic MPD are coalesced, and that a
+// pending request is written when the notifier is destroyed.
+TEST_F(SimpleMpdNotifierTest, RequestFlushCoalesced) {
+  MpdOptions mpd_options = empty_mpd_option_;
+  mpd_options.mpd_type = MpdType::kDynamic;
+  // Long enough that the requests below are not written before the notifier
+  // is destroyed.
+  mpd_options.mpd_params.update_coalescing_window = 100;
+  std::unique_ptr<SimpleMpdNotifier> notifier(
+      new SimpleMpdNotifier(mpd_options));
+
+  std::unique_ptr<MockMpdBuilder> mock_mpd_builder(new MockMpdBuilder());
+  EXPECT_CALL(*mock_mpd_builder, ToString(_)).WillOnce(Return(true));
+  SetMpdBuilder(notifier.get(), std::move(mock_mpd_builder));
+
+  notifier->RequestFlush();
+  notifier->RequestFlush();
+  notifier->RequestFlush();
+  notifier.reset();
+}
+
 TEST_F(SimpleMpdNotifierTest, NotifyCueEvent) {
   SimpleMpdNotifier notifier(empty_mpd_option_);
 
@@ -15,12 +15,14 @@
 #include "packager/base/logging.h"
 #include "packager/base/macros.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/base/sys_byteorder.h"
 #include "packager/media/base/rcheck.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_utils.h"
 #include "packager/mpd/base/segment_info.h"
 #include "packager/mpd/base/xml/scoped_xml_ptr.h"
+#include "packager/mpd/base/xml/xml_writer.h"
 
 DEFINE_bool(segment_template_constant_duration,
             false,
@@ -48,9 +50,41 @@ std::string RangeToString(const Range& range) {
          base::Uint64ToString(range.end());
 }
 
+// Spooky static initialization/cleanup of libxml.
+class LibXmlInitializer {
+ public:
+  LibXmlInitializer() : initialized_(false) {
+    base::AutoLock lock(lock_);
+    if (!initialized_) {
+      xmlInitParser();
+      initialized_ = true;
+    }
+  }
+
+  ~LibXmlInitializer() {
+    base::AutoLock lock(lock_);
+    if (initialized_) {
+      xmlCleanupParser();
+      initialized_ = false;
+    }
+  }
+
+ private:
+  base::Lock lock_;
+  bool initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(LibXmlInitializer);
+};
+
+// libxml2 is only used for the content with references and to verify the
+// output, so it is initialized on first use instead of for every process.
+void InitializeLibXml() {
+  static LibXmlInitializer lib_xml_initializer;
+}
+
 // Check if segments are continuous and all segments except the last one are of
 // the same duration.
-bool IsTimelineConstantDuration(const std::list<SegmentInfo>& segment_infos,
+bool IsTimelineConstantDuration(const std::deque<SegmentInfo>& segment_infos,
                                 uint32_t start_number) {
   if (!FLAGS_segment_template_constant_duration)
     return false;
@@ -76,7 +110,7 @@ bool IsTimelineConstantDuration(const std::list<SegmentInfo>& segment_infos,
   return expected_last_segment_start_time == last_segment.start_time;
 }
 
-bool PopulateSegmentTimeline(const std::list<SegmentInfo>& segment_infos,
+bool PopulateSegmentTimeline(const std::deque<SegmentInfo>& segment_infos,
                              XmlNode* segment_timeline) {
   for (const SegmentInfo& segment_info : segment_infos) {
     XmlNode s_element("S");
@@ -98,53 +132,151 @@ void CollectNamespaceFromName(const std::string& name,
     namespaces->insert(name.substr(0, pos));
 }
 
-void TraverseAttrsAndCollectNamespaces(const xmlAttr* attr,
-                                       std::set<std::string>* namespaces) {
-  for (const xmlAttr* cur_attr = attr; cur_attr; cur_attr = cur_attr->next) {
-    CollectNamespaceFromName(reinterpret_cast<const char*>(cur_attr->name),
-                             namespaces);
-  }
-}
-
-void TraverseNodesAndCollectNamespaces(const xmlNode* node,
-                                       std::set<std::string>* namespaces) {
-  for (const xmlNode* cur_node = node; cur_node; cur_node = cur_node->next) {
-    CollectNamespaceFromName(reinterpret_cast<const char*>(cur_node->name),
-                             namespaces);
-
-    TraverseNodesAndCollectNamespaces(cur_node->children, namespaces);
-    TraverseAttrsAndCollectNamespaces(cur_node->properties, namespaces);
-  }
-}
-
 }  // namespace
 
 namespace xml {
 
+// The nodes are kept in a light weight tree, which is written directly with
+// XmlWriter, instead of in a libxml2 tree, which needs many more allocations
+// and has to be copied to a document to be serialized. The tree mirrors the
+// libxml2 tree the same calls would build, so the output is the same.
+// Copies of an XmlNode share their tree until one of them is modified, so that
+// the unchanged parts of a manifest can be kept and reused cheaply.
 class XmlNode::Impl {
  public:
-  scoped_xml_ptr<xmlNode> node;
+  enum class Type { kElement, kText, kEntityReference };
+
+  explicit Impl(Type type) : type(type) {}
+  // Copies the node, sharing its children.
+  Impl(const Impl& other)
+      : type(other.type),
+        name(other.name),
+        text(other.text),
+        attributes(other.attributes),
+        children(other.children),
+        keep_serialized(other.keep_serialized) {}
+
+  // Write the node and its descendants.
+  void Write(XmlWriter* writer) const;
+  // Write the element and its descendants, ignoring |serialized|.
+  void WriteElement(XmlWriter* writer) const;
+  // @return the node and its descendants as a libxml2 tree.
+  scoped_xml_ptr<xmlNode> ToLibxmlNode() const;
+  void CollectNamespaces(std::set<std::string>* namespaces) const;
+  // @return true if the element has text or entity reference children, in
+  //         which case libxml2 does not indent its content.
+  bool HasTextContent() const;
+
+  const Type type;
+  // The name of an element, or of the entity of an entity reference.
+  std::string name;
+  // The content of a text node.
+  std::string text;
+  // The attributes of an element, in the order they are first set.
+  std::vector<std::pair<std::string, std::string>> attributes;
+  std::vector<std::shared_ptr<const Impl>> children;
+  // The libxml2 tree returned by GetRawPtr().
+  mutable scoped_xml_ptr<xmlNode> raw_node;
+  // Set by KeepSerialized(). |serialized| is the output of the element, in the
+  // XmlWriter::ChildContext() |serialized_context|, once written.
+  bool keep_serialized = false;
+  mutable std::string serialized;
+  mutable size_t serialized_context = std::numeric_limits<size_t>::max();
 };
 
-XmlNode::XmlNode(const std::string& name) : impl_(new Impl) {
-  impl_->node.reset(xmlNewNode(NULL, BAD_CAST name.c_str()));
-  DCHECK(impl_->node);
+void XmlNode::Impl::Write(XmlWriter* writer) const {
+  switch (type) {
+    case Type::kText:
+      writer->WriteText(text);
+      return;
+    case Type::kEntityReference:
+      writer->WriteEntityReference(name);
+      return;
+    case Type::kElement:
+      break;
+  }
+  if (keep_serialized) {
+    const size_t context = writer->ChildContext();
+    if (serialized_context == context) {
+      writer->WriteSerializedChild(serialized);
+      return;
+    }
+    const size_t position = writer->StartSerializedChild();
+    WriteElement(writer);
+    serialized = writer->GetOutputSince(position);
+    serialized_context = context;
+    return;
+  }
+  WriteElement(writer);
+}
+
+void XmlNode::Impl::WriteElement(XmlWriter* writer) const {
+  writer->StartElement(name, HasTextContent());
+  for (const auto& attribute : attributes)
+    writer->WriteAttribute(attribute.first, attribute.second);
+  for (const auto& child : children)
+    child->Write(writer);
+  writer->EndElement();
+}
+
+scoped_xml_ptr<xmlNode> XmlNode::Impl::ToLibxmlNode() const {
+  switch (type) {
+    case Type::kText:
+      return scoped_xml_ptr<xmlNode>(xmlNewText(BAD_CAST text.c_str()));
+    case Type::kEntityReference:
+      return scoped_xml_ptr<xmlNode>(
+          xmlNewReference(nullptr, BAD_CAST name.c_str()));
+    case Type::kElement:
+      break;
+  }
+  scoped_xml_ptr<xmlNode> node(xmlNewNode(nullptr, BAD_CAST name.c_str()));
+  DCHECK(node);
+  for (const auto& attribute : attributes) {
+    xmlSetProp(node.get(), BAD_CAST attribute.first.c_str(),
+               BAD_CAST attribute.second.c_str());
+  }
+  for (const auto& child : children)
+    xmlAddChild(node.get(), child->ToLibxmlNode().release());
+  return node;
+}
+
+void XmlNode::Impl::CollectNamespaces(
+    std::set<std::string>* namespaces) const {
+  if (type == Type::kText)
+    return;
+  CollectNamespaceFromName(name, namespaces);
+  for (const auto& child : children)
+    child->CollectNamespaces(namespaces);
+  for (const auto& attribute : attributes)
+    CollectNamespaceFromName(attribute.first, namespaces);
+}
+
+bool XmlNode::Impl::HasTextContent() const {
+  for (const auto& child : children) {
+    if (child->type != Type::kElement)
+      return true;
+  }
+  return false;
+}
+
+XmlNode::XmlNode(const std::string& name)
+    : impl_(std::make_shared<Impl>(Impl::Type::kElement)) {
+  impl_->name = name;
 }
 
+XmlNode::XmlNode(const XmlNode&) = default;
+
 XmlNode::XmlNode(XmlNode&&) = default;
 
 XmlNode::~XmlNode() {}
 
+XmlNode& XmlNode::operator=(const XmlNode&) = default;
+
 XmlNode& XmlNode::operator=(XmlNode&&) = default;
 
 bool XmlNode::AddChild(XmlNode child) {
-  DCHECK(impl_->node);
-  DCHECK(child.impl_->node);
-  RCHECK(xmlAddChild(impl_->node.get(), child.impl_->node.get()));
-
-  // Reaching here means the ownership of |child| transfered to |node|.
-  // Release the pointer so that it doesn't get destructed in this scope.
-  ignore_result(child.impl_->node.release());
+  DCHECK(child.impl_);
+  MutableImpl()->children.push_back(std::move(child.impl_));
   return true;
 }
 
@@ -160,45 +292,40 @@ bool XmlNode::AddElements(const std::vector<Element>& elements) {
                                            attribute_it->second));
     }
 
-    // Note that somehow |SetContent| needs to be called before |AddElements|
+    // Note that |SetContent| needs to be called before |AddElements|
     // otherwise the added children will be overwritten by the content.
     child_node.SetContent(child_element.content);
 
     // Recursively set children for the child.
     RCHECK(child_node.AddElements(child_element.subelements));
 
-    if (!xmlAddChild(impl_->node.get(), child_node.impl_->node.get())) {
-      LOG(ERROR) << "Failed to set child " << child_element.name
-                 << " to parent element "
-                 << reinterpret_cast<const char*>(impl_->node->name);
-      return false;
-    }
-    // Reaching here means the ownership of |child_node| transfered to |node|.
-    // Release the pointer so that it doesn't get destructed in this scope.
-    child_node.impl_->node.release();
+    RCHECK(AddChild(std::move(child_node)));
   }
   return true;
 }
 
 bool XmlNode::SetStringAttribute(const std::string& attribute_name,
                                  const std::string& attribute) {
-  DCHECK(impl_->node);
-  return xmlSetProp(impl_->node.get(), BAD_CAST attribute_name.c_str(),
-                    BAD_CAST attribute.c_str()) != nullptr;
+  Impl* impl = MutableImpl();
+  // Like libxml2, setting an existing attribute keeps its position.
+  for (auto& existing_attribute : impl->attributes) {
+    if (existing_attribute.first == attribute_name) {
+      existing_attribute.second = attribute;
+      return true;
+    }
+  }
+  impl->attributes.emplace_back(attribute_name, attribute);
+  return true;
 }
 
 bool XmlNode::SetIntegerAttribute(const std::string& attribute_name,
                                   uint64_t number) {
-  DCHECK(impl_->node);
-  return xmlSetProp(impl_->node.get(), BAD_CAST attribute_name.c_str(),
-                    BAD_CAST(base::Uint64ToString(number).c_str())) != nullptr;
+  return SetStringAttribute(attribute_name, base::Uint64ToString(number));
 }
 
 bool XmlNode::SetFloatingPointAttribute(const std::string& attribute_name,
                                         double number) {
-  DCHECK(impl_->node);
-  return xmlSetProp(impl_->node.get(), BAD_CAST attribute_name.c_str(),
-                    BAD_CAST(base::DoubleToString(number).c_str())) != nullptr;
+  return SetStringAttribute(attribute_name, base::DoubleToString(number));
 }
 
 bool XmlNode::SetId(uint32_t id) {
@@ -206,32 +333,73 @@ bool XmlNode::SetId(uint32_t id) {
 }
 
 void XmlNode::AddContent(const std::string& content) {
-  DCHECK(impl_->node);
-  xmlNodeAddContent(impl_->node.get(), BAD_CAST content.c_str());
+  // Like libxml2, empty content is ignored and adjacent text is merged.
+  if (content.empty())
+    return;
+  Impl* impl = MutableImpl();
+  std::shared_ptr<Impl> text;
+  if (!impl->children.empty() &&
+      impl->children.back()->type == Impl::Type::kText) {
+    text = std::make_shared<Impl>(*impl->children.back());
+    impl->children.pop_back();
+  } else {
+    text = std::make_shared<Impl>(Impl::Type::kText);
+  }
+  text->text += content;
+  impl->children.push_back(std::move(text));
 }
 
 void XmlNode::SetContent(const std::string& content) {
-  DCHECK(impl_->node);
-  xmlNodeSetContent(impl_->node.get(), BAD_CAST content.c_str());
+  Impl* impl = MutableImpl();
+  impl->children.clear();
+  // Without references, the content is a single text node, if not empty, as
+  // with AddContent().
+  if (content.find('&') == std::string::npos) {
+    AddContent(content);
+    return;
+  }
+  // Unlike AddContent(), libxml2 parses the character and entity references in
+  // the content, so let it parse it. The content is short, e.g. a URL.
+  InitializeLibXml();
+  xmlNode* nodes = xmlStringGetNodeList(nullptr, BAD_CAST content.c_str());
+  for (const xmlNode* node = nodes; node; node = node->next) {
+    if (node->type == XML_TEXT_NODE) {
+      auto text = std::make_shared<Impl>(Impl::Type::kText);
+      text->text = reinterpret_cast<const char*>(node->content);
+      impl->children.push_back(std::move(text));
+    } else if (node->type == XML_ENTITY_REF_NODE) {
+      auto reference = std::make_shared<Impl>(Impl::Type::kEntityReference);
+      reference->name = reinterpret_cast<const char*>(node->name);
+      impl->children.push_back(std::move(reference));
+    }
+  }
+  xmlFreeNodeList(nodes);
 }
 
 std::set<std::string> XmlNode::ExtractReferencedNamespaces() const {
   std::set<std::string> namespaces;
-  TraverseNodesAndCollectNamespaces(impl_->node.get(), &namespaces);
+  impl_->CollectNamespaces(&namespaces);
   return namespaces;
 }
 
 std::string XmlNode::ToString(const std::string& comment) const {
-  // Create an xmlDoc from xmlNodePtr. The node is copied so ownership does not
-  // transfer.
+  XmlWriter writer;
+  if (!comment.empty())
+    writer.WriteComment(comment);
+  impl_->Write(&writer);
+  return writer.TakeOutput();
+}
+
+std::string XmlNode::ToStringWithLibxml(const std::string& comment) const {
+  InitializeLibXml();
   xml::scoped_xml_ptr<xmlDoc> doc(xmlNewDoc(BAD_CAST "1.0"));
   if (comment.empty()) {
-    xmlDocSetRootElement(doc.get(), xmlCopyNode(impl_->node.get(), true));
+    xmlDocSetRootElement(doc.get(), impl_->ToLibxmlNode().release());
   } else {
     xml::scoped_xml_ptr<xmlNode> comment_xml(
         xmlNewDocComment(doc.get(), BAD_CAST comment.c_str()));
     xmlDocSetRootElement(doc.get(), comment_xml.get());
-    xmlAddSibling(comment_xml.release(), xmlCopyNode(impl_->node.get(), true));
+    xmlAddSibling(comment_xml.release(), impl_->ToLibxmlNode().release());
   }
 
   // Format the xmlDoc to string.
@@ -246,16 +414,33 @@ std::string XmlNode::ToString(const std::string& comment) const {
 }
 
 bool XmlNode::GetAttribute(const std::string& name, std::string* value) const {
-  xml::scoped_xml_ptr<xmlChar> str(
-      xmlGetProp(impl_->node.get(), BAD_CAST name.c_str()));
-  if (!str)
-    return false;
-  *value = reinterpret_cast<const char*>(str.get());
-  return true;
+  for (const auto& attribute : impl_->attributes) {
+    if (attribute.first == name) {
+      *value = attribute.second;
+      return true;
+    }
+  }
+  return false;
 }
 
 xmlNode* XmlNode::GetRawPtr() const {
-  return impl_->node.get();
+  InitializeLibXml();
+  impl_->raw_node = impl_->ToLibxmlNode();
+  return impl_->raw_node.get();
+}
+
+void XmlNode::KeepSerialized() {
+  MutableImpl()->keep_serialized = true;
+}
+
+XmlNode::Impl* XmlNode::MutableImpl() {
+  DCHECK(impl_);
+  if (impl_.use_count() > 1)
+    impl_ = std::make_shared<Impl>(*impl_);
+  // The output kept is not valid anymore.
+  impl_->serialized.clear();
+  impl_->serialized_context = std::numeric_limits<size_t>::max();
+  return impl_.get();
 }
 
 RepresentationBaseXmlNode::RepresentationBaseXmlNode(const std::string& name)
@@ -264,10 +449,32 @@ RepresentationBaseXmlNode::~RepresentationBaseXmlNode() {}
 
 bool RepresentationBaseXmlNode::AddContentProtectionElements(
     const std::list<ContentProtectionElement>& content_protection_elements) {
-  for (const auto& elem : content_protection_elements) {
-    RCHECK(AddContentProtectionElement(elem));
+  std::vector<XmlNode> nodes;
+  RCHECK(GenerateContentProtectionNodes(content_protection_elements, &nodes));
+  return AddContentProtectionNodes(nodes);
+}
+
+bool RepresentationBaseXmlNode::AddContentProtectionNodes(
+    const std::vector<XmlNode>& nodes) {
+  for (const XmlNode& node : nodes) {
+    // The copy shares the tree, and the output kept, of |node|.
+    RCHECK(AddChild(node));
   }
+  return true;
+}
 
+// static
+bool RepresentationBaseXmlNode::GenerateContentProtectionNodes(
+    const std::list<ContentProtectionElement>& content_protection_elements,
+    std::vector<XmlNode>* nodes) {
+  DCHECK(nodes);
+  nodes->clear();
+  for (const auto& elem : content_protection_elements) {
+    XmlNode content_protection_node("ContentProtection");
+    RCHECK(GenerateContentProtectionNode(elem, &content_protection_node));
+    content_protection_node.KeepSerialized();
+    nodes->push_back(std::move(content_protection_node));
+  }
   return true;
 }
 
@@ -294,25 +501,25 @@ bool RepresentationBaseXmlNode::AddDescriptor(
   return AddChild(std::move(descriptor));
 }
 
-bool RepresentationBaseXmlNode::AddContentProtectionElement(
-    const ContentProtectionElement& content_protection_element) {
-  XmlNode content_protection_node("ContentProtection");
-
+// static
+bool RepresentationBaseXmlNode::GenerateContentProtectionNode(
+    const ContentProtectionElement& content_protection_element,
+    XmlNode* content_protection_node) {
   // @value is an optional attribute.
   if (!content_protection_element.value.empty()) {
-    RCHECK(content_protection_node.SetStringAttribute(
+    RCHECK(content_protection_node->SetStringAttribute(
         "value", content_protection_element.value));
   }
-  RCHECK(content_protection_node.SetStringAttribute(
+  RCHECK(content_protection_node->SetStringAttribute(
       "schemeIdUri", content_protection_element.scheme_id_uri));
 
   for (const auto& pair : content_protection_element.additional_attributes) {
-    RCHECK(content_protection_node.SetStringAttribute(pair.first, pair.second));
+    RCHECK(
+        content_protection_node->SetStringAttribute(pair.first, pair.second));
   }
 
-  RCHECK(content_protection_node.AddElements(
-      content_protection_element.subelements));
-  return AddChild(std::move(content_protection_node));
+  return content_protection_node->AddElements(
+      content_protection_element.subelements);
 }
 
 AdaptationSetXmlNode::AdaptationSetXmlNode()
@@ -432,7 +639,7 @@ bool RepresentationXmlNode::AddVODOnlyInfo(const MediaInfo& media_info) {
 
 bool RepresentationXmlNode::AddLiveOnlyInfo(
     const MediaInfo& media_info,
-    const std::list<SegmentInfo>& segment_infos,
+    const std::deque<SegmentInfo>& segment_infos,
     uint32_t start_number) {
   XmlNode segment_template("SegmentTemplate");
   if (media_info.has_reference_time_scale()) {
@@ -456,6 +663,16 @@ bool RepresentationXmlNode::AddLiveOnlyInfo(
     RCHECK(segment_template.SetIntegerAttribute("startNumber", start_number));
   }
 
+  // The segments written in low latency chunks can be requested before they
+  // are complete (LL-DASH).
+  if (media_info.availability_time_offset_seconds() > 0) {
+    RCHECK(segment_template.SetFloatingPointAttribute(
+        "availabilityTimeOffset",
+        media_info.availability_time_offset_seconds()));
+    RCHECK(segment_template.SetStringAttribute("availabilityTimeComplete",
+                                               "false"));
+  }
+
   if (!segment_infos.empty()) {
     // Don't use SegmentTimeline if all segments except the last one are of
     // the same duration.
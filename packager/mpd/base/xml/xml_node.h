@@ -4,15 +4,18 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 //
-// Classes to wrap XML operations. XmlNode is a generic wrapper class for
-// XmlNode in libxml2. There are also MPD XML specific classes as well.
+// Classes to wrap XML operations. XmlNode is a generic XML element, which is
+// serialized like libxml2 would. There are also MPD XML specific classes as
+// well.
 
 #ifndef MPD_BASE_XML_XML_NODE_H_
 #define MPD_BASE_XML_XML_NODE_H_
 
 #include <stdint.h>
 
+#include <deque>
 #include <list>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -46,9 +49,13 @@ class XmlNode {
   /// Make an XML element.
   /// @param name is the name of the element, which should not be NULL.
   explicit XmlNode(const std::string& name);
+  /// Copies are cheap: the copies share the element and its descendants until
+  /// one of them is modified.
+  XmlNode(const XmlNode&);
   XmlNode(XmlNode&&);
   virtual ~XmlNode();
 
+  XmlNode& operator=(const XmlNode&);
   XmlNode& operator=(XmlNode&&);
 
   /// Add a child element to this element.
@@ -92,6 +99,11 @@ class XmlNode {
   ///        be added to the element.
   void SetContent(const std::string& content);
 
+  /// Keep the output of the element once it is written by ToString(), so
+  /// that writing it again, or writing its copies, until it is modified only
+  /// appends the output kept, e.g. for a Period which does not change anymore.
+  void KeepSerialized();
+
   /// @return namespaces used in the node and its descendents.
   std::set<std::string> ExtractReferencedNamespaces() const;
 
@@ -99,6 +111,10 @@ class XmlNode {
   /// @return A string containing the XML.
   std::string ToString(const std::string& comment) const;
 
+  /// Same as ToString(), but through a libxml2 document, which is much slower.
+  /// Only used to verify and benchmark ToString().
+  std::string ToStringWithLibxml(const std::string& comment) const;
+
   /// Gets the attribute with the given name.
   /// @param name The name of the attribute to get.
   /// @param value [OUT] where to put the resulting value.
@@ -114,9 +130,10 @@ class XmlNode {
   // libxml types to define the scoped_xml_ptr type.  This allows us to only
   // include libxml headers in a few source files.
   class Impl;
-  std::unique_ptr<Impl> impl_;
+  // Returns |impl_|, after copying it if it is shared with another XmlNode.
+  Impl* MutableImpl();
 
-  DISALLOW_COPY_AND_ASSIGN(XmlNode);
+  std::shared_ptr<Impl> impl_;
 };
 
 /// This corresponds to RepresentationBaseType in MPD. RepresentationBaseType is
@@ -129,6 +146,19 @@ class RepresentationBaseXmlNode : public XmlNode {
       const std::list<ContentProtectionElement>& content_protection_elements)
       WARN_UNUSED_RESULT;
 
+  /// Add ContentProtection elements generated by
+  /// GenerateContentProtectionNodes(), e.g. kept across the MPD updates while
+  /// the ContentProtectionElements do not change.
+  bool AddContentProtectionNodes(const std::vector<XmlNode>& nodes)
+      WARN_UNUSED_RESULT;
+
+  /// Generate the ContentProtection elements for
+  /// @a content_protection_elements. The output of the elements is kept once
+  /// written, so that adding them again is cheap.
+  static bool GenerateContentProtectionNodes(
+      const std::list<ContentProtectionElement>& content_protection_elements,
+      std::vector<XmlNode>* nodes) WARN_UNUSED_RESULT;
+
   /// @param scheme_id_uri is content of the schemeIdUri attribute.
   /// @param value is the content of value attribute.
   bool AddSupplementalProperty(const std::string& scheme_id_uri,
@@ -151,9 +181,9 @@ class RepresentationBaseXmlNode : public XmlNode {
                      const std::string& value) WARN_UNUSED_RESULT;
 
  private:
-  bool AddContentProtectionElement(
-      const ContentProtectionElement& content_protection_element)
-      WARN_UNUSED_RESULT;
+  static bool GenerateContentProtectionNode(
+      const ContentProtectionElement& content_protection_element,
+      XmlNode* content_protection_node) WARN_UNUSED_RESULT;
 
   DISALLOW_COPY_AND_ASSIGN(RepresentationBaseXmlNode);
 };
@@ -211,7 +241,7 @@ class RepresentationXmlNode : public RepresentationBaseXmlNode {
   /// @param segment_infos is a set of SegmentInfos. This method assumes that
   ///        SegmentInfos are sorted by its start time.
   bool AddLiveOnlyInfo(const MediaInfo& media_info,
-                       const std::list<SegmentInfo>& segment_infos,
+                       const std::deque<SegmentInfo>& segment_infos,
                        uint32_t start_number) WARN_UNUSED_RESULT;
 
  private:
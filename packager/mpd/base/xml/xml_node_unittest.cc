@@ -172,6 +172,97 @@ TEST(XmlNodeTest, ExtractReferencedNamespacesFromAttributes) {
               ElementsAre("child_attribute_ns", "root_attribute_ns"));
 }
 
+// ToString() writes the XML directly; make sure that it is the same as what
+// libxml2 outputs.
+TEST(XmlNodeTest, ToStringSameAsLibxml) {
+  XmlNode root("root");
+  ASSERT_TRUE(root.SetStringAttribute("a", "1"));
+  ASSERT_TRUE(root.SetStringAttribute("b", "<\"&\t\n>"));
+  // Overwriting an attribute keeps its position.
+  ASSERT_TRUE(root.SetIntegerAttribute("a", 2));
+
+  XmlNode escaped_content("escaped");
+  escaped_content.AddContent("<a&b>\r");
+  XmlNode merged_content("merged");
+  merged_content.AddContent("first");
+  merged_content.AddContent("");
+  merged_content.AddContent(" second");
+  XmlNode empty_content("empty");
+  empty_content.AddContent("");
+  XmlNode references("references");
+  references.SetContent("a&amp;b&foo;&#x41;c");
+  XmlNode mixed_content("mixed");
+  mixed_content.SetContent("text");
+  XmlNode grand_child("grand_child");
+  grand_child.SetContent("");
+  ASSERT_TRUE(grand_child.AddChild(XmlNode("great_grand_child")));
+  ASSERT_TRUE(mixed_content.AddChild(std::move(grand_child)));
+  mixed_content.AddContent("more text");
+
+  XmlNode nested("nested");
+  ASSERT_TRUE(nested.AddChild(std::move(mixed_content)));
+  ASSERT_TRUE(nested.AddChild(XmlNode("sibling")));
+
+  ASSERT_TRUE(root.AddChild(std::move(escaped_content)));
+  ASSERT_TRUE(root.AddChild(std::move(merged_content)));
+  ASSERT_TRUE(root.AddChild(std::move(empty_content)));
+  ASSERT_TRUE(root.AddChild(std::move(references)));
+  ASSERT_TRUE(root.AddChild(std::move(nested)));
+
+  EXPECT_EQ(root.ToStringWithLibxml(""), root.ToString(""));
+  EXPECT_EQ(root.ToStringWithLibxml("comment"), root.ToString("comment"));
+}
+
+// Copies share their tree until modified; make sure that modifying a copy does
+// not modify the original.
+TEST(XmlNodeTest, CopyOnWrite) {
+  XmlNode child("child");
+  child.AddContent("content");
+  XmlNode root("root");
+  ASSERT_TRUE(root.SetStringAttribute("a", "1"));
+  ASSERT_TRUE(root.AddChild(child));
+
+  XmlNode copy(root);
+  ASSERT_TRUE(copy.SetStringAttribute("a", "2"));
+  ASSERT_TRUE(copy.AddChild(XmlNode("other_child")));
+  child.AddContent(" more content");
+
+  EXPECT_THAT(root,
+              XmlNodeEqual("<root a=\"1\"><child>content</child></root>"));
+  EXPECT_THAT(copy, XmlNodeEqual("<root a=\"2\"><child>content</child>"
+                                 "<other_child/></root>"));
+  EXPECT_THAT(child, XmlNodeEqual("<child>content more content</child>"));
+}
+
+// The output kept by KeepSerialized() is only reused where it is the same as
+// the output written again.
+TEST(XmlNodeTest, KeepSerialized) {
+  XmlNode kept("kept");
+  ASSERT_TRUE(kept.SetStringAttribute("a", "1"));
+  ASSERT_TRUE(kept.AddChild(XmlNode("child")));
+  kept.KeepSerialized();
+
+  XmlNode root("root");
+  ASSERT_TRUE(root.AddChild(kept));
+  XmlNode nested("nested");
+  ASSERT_TRUE(nested.AddChild(kept));
+  ASSERT_TRUE(root.AddChild(std::move(nested)));
+  XmlNode mixed("mixed");
+  mixed.SetContent("text");
+  ASSERT_TRUE(mixed.AddChild(kept));
+  ASSERT_TRUE(root.AddChild(std::move(mixed)));
+
+  const std::string expected = root.ToStringWithLibxml("");
+  EXPECT_EQ(expected, root.ToString(""));
+  EXPECT_EQ(expected, root.ToString(""));
+  EXPECT_EQ(kept.ToStringWithLibxml(""), kept.ToString(""));
+
+  // Modifying the node drops the output kept.
+  ASSERT_TRUE(kept.SetStringAttribute("a", "2"));
+  EXPECT_EQ(kept.ToStringWithLibxml(""), kept.ToString(""));
+  EXPECT_EQ(expected, root.ToString(""));
+}
+
 // Verify that AddContentProtectionElements work.
 // xmlReadMemory() (used in XmlEqual()) doesn't like XML fragments that have
 // namespaces without context, e.g. <cenc:pssh> element.
@@ -367,7 +458,7 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfo) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
@@ -388,7 +479,7 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfoNonZeroStartTime) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kNonZeroStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
@@ -412,7 +503,7 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfoMatchingStartTimeAndNumber) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kNonZeroStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
@@ -438,7 +529,7 @@ TEST_F(LiveSegmentTimelineTest, AllSegmentsSameDurationExpectLastOne) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 0;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
@@ -465,7 +556,7 @@ TEST_F(LiveSegmentTimelineTest, SecondSegmentInfoNonZeroRepeat) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 1;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
@@ -497,7 +588,7 @@ TEST_F(LiveSegmentTimelineTest, TwoSegmentInfoWithGap) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 0;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
@@ -523,7 +614,7 @@ TEST_F(LiveSegmentTimelineTest, LastSegmentNumberSupplementalProperty) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
@@ -543,5 +634,30 @@ TEST_F(LiveSegmentTimelineTest, LastSegmentNumberSupplementalProperty) {
   FLAGS_dash_add_last_segment_number_when_needed = false;
 }
 
+TEST_F(LiveSegmentTimelineTest, AvailabilityTimeOffset) {
+  const uint32_t kStartNumber = 1;
+  const uint64_t kStartTime = 0;
+  const uint64_t kDuration = 100;
+  const uint64_t kRepeat = 9;
+
+  std::deque<SegmentInfo> segment_infos = {
+      {kStartTime, kDuration, kRepeat},
+  };
+  media_info_.set_availability_time_offset_seconds(1.8);
+  RepresentationXmlNode representation;
+  ASSERT_TRUE(
+      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+
+  EXPECT_THAT(
+      representation,
+      XmlNodeEqual("<Representation>"
+                   "  <SegmentTemplate media=\"$Number$.m4s\" "
+                   "                   startNumber=\"1\" "
+                   "                   availabilityTimeOffset=\"1.8\" "
+                   "                   availabilityTimeComplete=\"false\" "
+                   "                   duration=\"100\"/>"
+                   "</Representation>"));
+}
+
 }  // namespace xml
 }  // namespace shaka
@@ -0,0 +1,199 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/xml/xml_writer.h"
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace xml {
+namespace {
+
+// Same as libxml2, which indents by two spaces per level up to 30 levels.
+const char kIndent[] = "  ";
+const size_t kIndentSize = sizeof(kIndent) - 1;
+const size_t kMaxIndentLevel = 60 / kIndentSize;
+
+void AppendEscapedText(const std::string& text, std::string* output) {
+  for (char c : text) {
+    switch (c) {
+      case '<':
+        output->append("&lt;");
+        break;
+      case '>':
+        output->append("&gt;");
+        break;
+      case '&':
+        output->append("&amp;");
+        break;
+      case '\r':
+        output->append("&#13;");
+        break;
+      default:
+        output->push_back(c);
+        break;
+    }
+  }
+}
+
+void AppendEscapedAttribute(const std::string& value, std::string* output) {
+  for (char c : value) {
+    switch (c) {
+      case '\n':
+        output->append("&#10;");
+        break;
+      case '\r':
+        output->append("&#13;");
+        break;
+      case '\t':
+        output->append("&#9;");
+        break;
+      case '"':
+        output->append("&quot;");
+        break;
+      case '<':
+        output->append("&lt;");
+        break;
+      case '>':
+        output->append("&gt;");
+        break;
+      case '&':
+        output->append("&amp;");
+        break;
+      default:
+        output->push_back(c);
+        break;
+    }
+  }
+}
+
+}  // namespace
+
+XmlWriter::XmlWriter() {
+  output_ = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+}
+
+XmlWriter::~XmlWriter() {}
+
+void XmlWriter::WriteComment(const std::string& comment) {
+  DCHECK(open_elements_.empty());
+  output_ += "<!--";
+  output_ += comment;
+  output_ += "-->";
+  EndChild();
+}
+
+void XmlWriter::StartElement(const std::string& name, bool has_text_content) {
+  StartChild();
+  if (IndentChildren())
+    WriteIndent(open_elements_.size());
+  output_ += '<';
+  output_ += name;
+
+  OpenElement element;
+  element.name = name;
+  element.indent_children = IndentChildren() && !has_text_content;
+  open_elements_.push_back(std::move(element));
+}
+
+void XmlWriter::WriteAttribute(const std::string& name,
+                               const std::string& value) {
+  DCHECK(!open_elements_.empty());
+  DCHECK(open_elements_.back().start_tag_open);
+  output_ += ' ';
+  output_ += name;
+  output_ += "=\"";
+  AppendEscapedAttribute(value, &output_);
+  output_ += '"';
+}
+
+void XmlWriter::WriteText(const std::string& text) {
+  DCHECK(!open_elements_.empty());
+  DCHECK(!open_elements_.back().indent_children);
+  StartChild();
+  AppendEscapedText(text, &output_);
+}
+
+void XmlWriter::WriteEntityReference(const std::string& name) {
+  DCHECK(!open_elements_.empty());
+  DCHECK(!open_elements_.back().indent_children);
+  StartChild();
+  output_ += '&';
+  output_ += name;
+  output_ += ';';
+}
+
+void XmlWriter::EndElement() {
+  DCHECK(!open_elements_.empty());
+  const OpenElement& element = open_elements_.back();
+  if (element.start_tag_open) {
+    output_ += "/>";
+  } else {
+    if (element.indent_children)
+      WriteIndent(open_elements_.size() - 1);
+    output_ += "</";
+    output_ += element.name;
+    output_ += '>';
+  }
+  open_elements_.pop_back();
+  EndChild();
+}
+
+std::string XmlWriter::TakeOutput() {
+  DCHECK(open_elements_.empty());
+  return std::move(output_);
+}
+
+size_t XmlWriter::StartSerializedChild() {
+  StartChild();
+  return output_.size();
+}
+
+std::string XmlWriter::GetOutputSince(size_t position) const {
+  DCHECK_LE(position, output_.size());
+  return output_.substr(position);
+}
+
+void XmlWriter::WriteSerializedChild(const std::string& child) {
+  StartChild();
+  output_ += child;
+}
+
+size_t XmlWriter::ChildContext() const {
+  return open_elements_.size() * 2 + (IndentChildren() ? 1 : 0);
+}
+
+void XmlWriter::StartChild() {
+  if (open_elements_.empty())
+    return;
+  OpenElement& parent = open_elements_.back();
+  if (!parent.start_tag_open)
+    return;
+  output_ += '>';
+  if (parent.indent_children)
+    output_ += '\n';
+  parent.start_tag_open = false;
+}
+
+void XmlWriter::EndChild() {
+  if (IndentChildren())
+    output_ += '\n';
+}
+
+void XmlWriter::WriteIndent(size_t level) {
+  const size_t num_levels = std::min(level, kMaxIndentLevel);
+  for (size_t i = 0; i < num_levels; ++i)
+    output_ += kIndent;
+}
+
+bool XmlWriter::IndentChildren() const {
+  return open_elements_.empty() || open_elements_.back().indent_children;
+}
+
+}  // namespace xml
+}  // namespace shaka
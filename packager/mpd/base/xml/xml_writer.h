@@ -0,0 +1,100 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_XML_XML_WRITER_H_
+#define MPD_BASE_XML_XML_WRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+
+namespace shaka {
+namespace xml {
+
+/// Writes an XML document directly to a string, without building a document
+/// tree. The output is identical to the output of libxml2's
+/// xmlDocDumpFormatMemoryEnc() in UTF-8 for the same document: the elements
+/// are indented by two spaces per level, except in the elements with text
+/// content, where whitespace is significant.
+class XmlWriter {
+ public:
+  /// Writes the XML declaration.
+  XmlWriter();
+  ~XmlWriter();
+
+  /// Write a comment. Comments can only be written outside of the root
+  /// element.
+  void WriteComment(const std::string& comment);
+
+  /// Start an element, as a child of the current element if any.
+  /// @param has_text_content indicates whether the element has text or
+  ///        entity reference children, which disables the indentation within
+  ///        the element.
+  void StartElement(const std::string& name, bool has_text_content);
+
+  /// Write an attribute of the current element. Attributes must be written
+  /// before the children of the element.
+  void WriteAttribute(const std::string& name, const std::string& value);
+
+  /// Write text in the current element. It is escaped as needed.
+  void WriteText(const std::string& text);
+
+  /// Write a reference to an entity, i.e. "&name;", in the current element.
+  void WriteEntityReference(const std::string& name);
+
+  /// End the current element.
+  void EndElement();
+
+  /// @return the document. All the elements must be ended.
+  std::string TakeOutput();
+
+  /// Start a child of the current element, e.g. an element, whose output can
+  /// be kept with GetOutputSince() and written again, e.g. by another writer,
+  /// with WriteSerializedChild().
+  /// @return The position of the child in the output.
+  size_t StartSerializedChild();
+
+  /// @return The output from @a position, returned by StartSerializedChild().
+  std::string GetOutputSince(size_t position) const;
+
+  /// Write a child serialized by a writer in the same ChildContext().
+  void WriteSerializedChild(const std::string& child);
+
+  /// @return A value identifying the nesting level and the indentation of the
+  ///         children of the current element, which their output depends on.
+  size_t ChildContext() const;
+
+ private:
+  struct OpenElement {
+    std::string name;
+    // Whether the children of the element are indented.
+    bool indent_children = false;
+    // Whether the start tag is still open, i.e. no child is written yet.
+    bool start_tag_open = true;
+  };
+
+  // Close the start tag of the current element if needed, before writing a
+  // child.
+  void StartChild();
+  // Write a line break after a child of the current element, or after a top
+  // level node, if needed.
+  void EndChild();
+  void WriteIndent(size_t level);
+  // Whether the children of the current element, or the top level nodes, are
+  // indented.
+  bool IndentChildren() const;
+
+  std::string output_;
+  std::vector<OpenElement> open_elements_;
+
+  DISALLOW_COPY_AND_ASSIGN(XmlWriter);
+};
+
+}  // namespace xml
+}  // namespace shaka
+
+#endif  // MPD_BASE_XML_XML_WRITER_H_
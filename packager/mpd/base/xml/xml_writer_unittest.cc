@@ -0,0 +1,137 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/xml/xml_writer.h"
+
+#include <gtest/gtest.h>
+#include <libxml/tree.h>
+
+#include "packager/mpd/base/xml/scoped_xml_ptr.h"
+
+namespace shaka {
+namespace xml {
+namespace {
+
+// Serializes |doc| the way XmlWriter output is meant to match.
+std::string LibxmlToString(xmlDoc* doc) {
+  int doc_str_size = 0;
+  xmlChar* doc_str = nullptr;
+  xmlDocDumpFormatMemoryEnc(doc, &doc_str, &doc_str_size, "UTF-8", 1);
+  std::string output(doc_str, doc_str + doc_str_size);
+  xmlFree(doc_str);
+  return output;
+}
+
+}  // namespace
+
+TEST(XmlWriterTest, EmptyElement) {
+  XmlWriter writer;
+  writer.StartElement("A", false);
+  writer.EndElement();
+  EXPECT_EQ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<A/>\n",
+            writer.TakeOutput());
+}
+
+TEST(XmlWriterTest, IndentsChildren) {
+  XmlWriter writer;
+  writer.WriteComment("comment");
+  writer.StartElement("A", false);
+  writer.WriteAttribute("a", "1");
+  writer.StartElement("B", false);
+  writer.StartElement("C", false);
+  writer.WriteAttribute("c", "2");
+  writer.WriteAttribute("d", "3");
+  writer.EndElement();
+  writer.EndElement();
+  writer.StartElement("D", false);
+  writer.EndElement();
+  writer.EndElement();
+  EXPECT_EQ(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<!--comment-->\n"
+      "<A a=\"1\">\n"
+      "  <B>\n"
+      "    <C c=\"2\" d=\"3\"/>\n"
+      "  </B>\n"
+      "  <D/>\n"
+      "</A>\n",
+      writer.TakeOutput());
+}
+
+TEST(XmlWriterTest, DoesNotIndentTextContent) {
+  XmlWriter writer;
+  writer.StartElement("A", false);
+  writer.StartElement("B", true);
+  writer.WriteText("text");
+  writer.StartElement("C", false);
+  writer.StartElement("D", false);
+  writer.EndElement();
+  writer.EndElement();
+  writer.WriteEntityReference("entity");
+  writer.EndElement();
+  writer.EndElement();
+  EXPECT_EQ(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<A>\n"
+      "  <B>text<C><D/></C>&entity;</B>\n"
+      "</A>\n",
+      writer.TakeOutput());
+}
+
+TEST(XmlWriterTest, Escapes) {
+  XmlWriter writer;
+  writer.StartElement("A", true);
+  writer.WriteAttribute("a", "<&>\"'\t\r\n\xc3\xa9");
+  writer.WriteText("<&>\"'\t\r\n\xc3\xa9");
+  writer.EndElement();
+  EXPECT_EQ(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<A a=\"&lt;&amp;&gt;&quot;'&#9;&#13;&#10;\xc3\xa9\">"
+      "&lt;&amp;&gt;\"'\t&#13;\n\xc3\xa9</A>\n",
+      writer.TakeOutput());
+}
+
+// Verifies that the output is the same as libxml2's for the same document,
+// including the indentation limit of deep documents.
+TEST(XmlWriterTest, SameAsLibxml) {
+  const int kDepth = 40;
+  XmlWriter writer;
+  scoped_xml_ptr<xmlDoc> doc(xmlNewDoc(BAD_CAST "1.0"));
+  xmlNode* parent = xmlNewNode(nullptr, BAD_CAST "Root");
+  xmlDocSetRootElement(doc.get(), parent);
+  xmlAddPrevSibling(parent,
+                    xmlNewDocComment(doc.get(), BAD_CAST " generated "));
+  writer.WriteComment(" generated ");
+  writer.StartElement("Root", false);
+  for (int i = 0; i < kDepth; ++i) {
+    const std::string name = "E" + std::to_string(i);
+    const std::string value = "v&\"" + std::to_string(i);
+    xmlNode* node = xmlNewChild(parent, nullptr, BAD_CAST name.c_str(),
+                                nullptr);
+    xmlSetProp(node, BAD_CAST "attr", BAD_CAST value.c_str());
+    xmlNewChild(parent, nullptr, BAD_CAST "Sibling", nullptr);
+    writer.StartElement(name, false);
+    writer.WriteAttribute("attr", value);
+    parent = node;
+  }
+  xmlNode* text_element =
+      xmlNewChild(parent, nullptr, BAD_CAST "Text", nullptr);
+  xmlNodeAddContent(text_element, BAD_CAST "a<b");
+  writer.StartElement("Text", true);
+  writer.WriteText("a<b");
+  writer.EndElement();
+  for (int i = 0; i < kDepth; ++i) {
+    writer.EndElement();
+    writer.StartElement("Sibling", false);
+    writer.EndElement();
+  }
+  writer.EndElement();
+
+  EXPECT_EQ(LibxmlToString(doc.get()), writer.TakeOutput());
+}
+
+}  // namespace xml
+}  // namespace shaka
@@ -23,6 +23,18 @@
       },
       'includes': ['../protoc.gypi'],
     },
+    {
+      'target_name': 'manifest_checkpoint_proto',
+      'type': 'static_library',
+      'sources': [
+        'base/manifest_checkpoint.proto',
+      ],
+      'variables': {
+        'proto_in_dir': 'base',
+        'proto_out_dir': 'packager/mpd/base',
+      },
+      'includes': ['../protoc.gypi'],
+    },
     {
       # Used by both MPD and HLS. It should really be moved to a common
       # directory shared by MPD and HLS.
@@ -62,20 +74,25 @@
         'base/xml/scoped_xml_ptr.h',
         'base/xml/xml_node.cc',
         'base/xml/xml_node.h',
+        'base/xml/xml_writer.cc',
+        'base/xml/xml_writer.h',
         'public/mpd_params.h',
       ],
       'dependencies': [
         '../base/base.gyp:base',
         '../file/file.gyp:file',
         '../media/base/media_base.gyp:media_base',
+        '../metrics/metrics.gyp:metrics',
         '../third_party/gflags/gflags.gyp:gflags',
         '../third_party/libxml/libxml.gyp:libxml',
         '../version/version.gyp:version',
         'manifest_base',
+        'manifest_checkpoint_proto',
         'media_info_proto',
       ],
       'export_dependent_settings': [
         '../third_party/libxml/libxml.gyp:libxml',
+        'manifest_checkpoint_proto',
         'media_info_proto',
       ],
     },
@@ -105,6 +122,7 @@
         'base/representation_unittest.cc',
         'base/simple_mpd_notifier_unittest.cc',
         'base/xml/xml_node_unittest.cc',
+        'base/xml/xml_writer_unittest.cc',
         'test/mpd_builder_test_helper.cc',
         'test/mpd_builder_test_helper.h',
         'test/xml_compare.cc',
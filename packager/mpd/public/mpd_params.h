@@ -67,10 +67,12 @@ struct MpdParams {
   /// For live profile only.
   /// If enabled, segments with close duration (i.e. with difference less than
   /// one sample) are considered to have the same duration. This enables
-  /// MPD generator to generate less SegmentTimeline entries. If all segments
-  /// are of the same duration except the last one, we will do further
-  /// optimization to use SegmentTemplate@duration instead and omit
-  /// SegmentTimeline completely.
+  /// MPD generator to generate less SegmentTimeline entries. Alternating
+  /// durations, e.g. 1.984s and 2.005s AAC segments, share one entry with their
+  /// average duration as long as each segment stays within one sample of the
+  /// timeline. If all segments are of the same duration except the last one,
+  /// we will do further optimization to use SegmentTemplate@duration instead
+  /// and omit SegmentTimeline completely.
   /// Ignored if $Time$ is used in segment template, since $Time$ requires
   /// accurate Segment Timeline.
   bool allow_approximate_segment_timeline = false;
@@ -87,6 +89,17 @@ struct MpdParams {
   /// <ContentProtection ...> element alongside with <cenc:pssh>
   /// when using PlayReady protection system.
   bool include_mspr_pro = true;
+  /// For dynamic MPD only. If positive, the MPD updates after new segments
+  /// are written by a dedicated thread, at most once per this many seconds,
+  /// instead of by the muxer thread of every segment. The MPD is then up to
+  /// this much behind the segments.
+  double update_coalescing_window = 0;
+  /// For dynamic MPD only. Number the segments from their timestamps, like
+  /// the muxers with ChunkingParams::segment_numbers_from_timestamps, and
+  /// set availabilityStartTime to the epoch instead of deriving it from the
+  /// time the first segment is generated. The inputs are expected to be
+  /// timestamped from the epoch. It will be populated from ChunkingParams.
+  bool segment_numbers_from_timestamps = false;
 };
 
 }  // namespace shaka
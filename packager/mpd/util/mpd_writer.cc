@@ -7,9 +7,13 @@
 #include "packager/mpd/util/mpd_writer.h"
 
 #include <gflags/gflags.h>
+#include <google/protobuf/io/tokenizer.h>
 #include <google/protobuf/text_format.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <map>
+
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
 #include "packager/file/file.h"
@@ -38,6 +42,62 @@ class SimpleMpdNotifierFactory : public MpdNotifierFactory {
   }
 };
 
+// Ignores the errors of parsing the binary MediaInfo files as text.
+class SilentErrorCollector : public ::google::protobuf::io::ErrorCollector {
+ public:
+  void AddError(int line,
+                ::google::protobuf::io::ColumnNumber column,
+                const std::string& message) override {}
+};
+
+// Parses |file_content| in the text format, or in the binary format written
+// with --binary_media_info.
+bool ParseMediaInfo(const std::string& file_content, MediaInfo* media_info) {
+  SilentErrorCollector error_collector;
+  ::google::protobuf::TextFormat::Parser parser;
+  parser.RecordErrorsTo(&error_collector);
+  return parser.ParseFromString(file_content, media_info) ||
+         media_info->ParseFromString(file_content);
+}
+
+// The shards of a VOD output, see VodShardParams, share the segment template of
+// the output. Merges their media infos into one with the segments of all the
+// shards.
+std::list<MediaInfo> MergeShards(const std::list<MediaInfo>& media_infos) {
+  std::list<MediaInfo> merged_media_infos;
+  std::map<std::string, MediaInfo*> merged_outputs;
+  for (const MediaInfo& media_info : media_infos) {
+    if (media_info.segments_size() == 0) {
+      merged_media_infos.push_back(media_info);
+      continue;
+    }
+    auto iter = merged_outputs.find(media_info.segment_template());
+    if (iter == merged_outputs.end()) {
+      merged_media_infos.push_back(media_info);
+      merged_outputs[media_info.segment_template()] =
+          &merged_media_infos.back();
+      continue;
+    }
+    MediaInfo* merged_media_info = iter->second;
+    merged_media_info->set_bandwidth(
+        std::max(merged_media_info->bandwidth(), media_info.bandwidth()));
+    merged_media_info->set_media_duration_seconds(
+        merged_media_info->media_duration_seconds() +
+        media_info.media_duration_seconds());
+    for (const MediaInfo::Segment& segment : media_info.segments())
+      *merged_media_info->add_segments() = segment;
+  }
+
+  for (auto& merged_output : merged_outputs) {
+    auto* segments = merged_output.second->mutable_segments();
+    std::sort(segments->begin(), segments->end(),
+              [](const MediaInfo::Segment& a, const MediaInfo::Segment& b) {
+                return a.start_time() < b.start_time();
+              });
+  }
+  return merged_media_infos;
+}
+
 }  // namespace
 
 MpdWriter::MpdWriter() : notifier_factory_(new SimpleMpdNotifierFactory()) {}
@@ -51,9 +111,8 @@ bool MpdWriter::AddFile(const std::string& media_info_path) {
   }
 
   MediaInfo media_info;
-  if (!::google::protobuf::TextFormat::ParseFromString(file_content,
-                                                       &media_info)) {
-    LOG(ERROR) << "Failed to parse " << file_content << " to MediaInfo.";
+  if (!ParseMediaInfo(file_content, &media_info)) {
+    LOG(ERROR) << "Failed to parse " << media_info_path << " to MediaInfo.";
     return false;
   }
 
@@ -72,6 +131,21 @@ bool MpdWriter::WriteMpdToFile(const char* file_name) {
   mpd_options.mpd_params.mpd_output = file_name;
   mpd_options.mpd_params.generate_dash_if_iop_compliant_mpd =
       FLAGS_generate_dash_if_iop_compliant_mpd;
+
+  const std::list<MediaInfo> media_infos = MergeShards(media_infos_);
+  const size_t num_segmented_outputs = std::count_if(
+      media_infos.begin(), media_infos.end(), [](const MediaInfo& media_info) {
+        return media_info.has_segment_template();
+      });
+  if (num_segmented_outputs > 0) {
+    if (num_segmented_outputs != media_infos.size()) {
+      LOG(ERROR) << "Cannot mix single file and segmented outputs.";
+      return false;
+    }
+    // The segment templates of the shards are listed in a static MPD.
+    mpd_options.dash_profile = DashProfile::kLive;
+  }
+
   std::unique_ptr<MpdNotifier> notifier =
       notifier_factory_->Create(mpd_options);
   if (!notifier->Init()) {
@@ -79,13 +153,24 @@ bool MpdWriter::WriteMpdToFile(const char* file_name) {
     return false;
   }
 
-  for (const MediaInfo& media_info : media_infos_) {
-    uint32_t unused_conatiner_id;
-    if (!notifier->NotifyNewContainer(media_info, &unused_conatiner_id)) {
+  for (const MediaInfo& media_info : media_infos) {
+    MediaInfo media_info_without_segments = media_info;
+    media_info_without_segments.clear_segments();
+    uint32_t container_id;
+    if (!notifier->NotifyNewContainer(media_info_without_segments,
+                                      &container_id)) {
       LOG(ERROR) << "Failed to add MediaInfo for media file: "
                  << media_info.media_file_name();
       return false;
     }
+    for (const MediaInfo::Segment& segment : media_info.segments()) {
+      if (!notifier->NotifyNewSegment(container_id, segment.start_time(),
+                                      segment.duration(), segment.size())) {
+        LOG(ERROR) << "Failed to add segment for "
+                   << media_info.segment_template();
+        return false;
+      }
+    }
   }
 
   if (!notifier->Flush()) {
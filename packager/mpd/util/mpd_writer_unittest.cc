@@ -5,10 +5,14 @@
 // https://developers.google.com/open-source/licenses/bsd
 
 #include <gmock/gmock.h>
+#include <google/protobuf/text_format.h>
 #include <gtest/gtest.h>
 
 #include "packager/base/files/file_util.h"
+#include "packager/base/strings/stringprintf.h"
 #include "packager/base/path_service.h"
+#include "packager/file/file.h"
+#include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mock_mpd_notifier.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/test/mpd_builder_test_helper.h"
@@ -17,8 +21,11 @@
 namespace shaka {
 
 using ::testing::_;
+using ::testing::DoAll;
+using ::testing::InSequence;
 using ::testing::Invoke;
 using ::testing::Return;
+using ::testing::SetArgPointee;
 
 namespace {
 
@@ -53,6 +60,55 @@ class TestMpdNotifierFactory : public MpdNotifierFactory {
   std::vector<std::string> expected_base_urls_;
 };
 
+const char kShardMediaInfoFormat[] =
+    "bandwidth: %d\n"
+    "video_info {\n"
+    "  codec: 'avc1.010101'\n"
+    "  width: 720\n"
+    "  height: 480\n"
+    "  time_scale: 10\n"
+    "}\n"
+    "reference_time_scale: 1000\n"
+    "container_type: 1\n"
+    "init_segment_name: 'init.mp4'\n"
+    "segment_template: 'segment-$Time$.m4s'\n"
+    "media_duration_seconds: %d\n"
+    "%s";
+
+MATCHER_P2(MediaInfoWithoutSegments, bandwidth, media_duration_seconds, "") {
+  return arg.bandwidth() == static_cast<uint32_t>(bandwidth) &&
+         arg.media_duration_seconds() == media_duration_seconds &&
+         arg.segments_size() == 0;
+}
+
+// Expects the media infos of two shards of an output to be merged.
+class ShardsMpdNotifierFactory : public MpdNotifierFactory {
+ public:
+  std::unique_ptr<MpdNotifier> Create(const MpdOptions& mpd_options) override {
+    EXPECT_EQ(DashProfile::kLive, mpd_options.dash_profile);
+    EXPECT_EQ(MpdType::kStatic, mpd_options.mpd_type);
+
+    const uint32_t kContainerId = 5;
+    std::unique_ptr<MockMpdNotifier> mock_notifier(
+        new MockMpdNotifier(mpd_options));
+    InSequence s;
+    EXPECT_CALL(*mock_notifier, Init()).WillOnce(Return(true));
+    EXPECT_CALL(*mock_notifier,
+                NotifyNewContainer(MediaInfoWithoutSegments(2400, 3), _))
+        .WillOnce(DoAll(SetArgPointee<1>(kContainerId), Return(true)));
+    EXPECT_CALL(*mock_notifier, NotifyNewSegment(kContainerId, 0, 1000, 100))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_notifier,
+                NotifyNewSegment(kContainerId, 1000, 1000, 200))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_notifier,
+                NotifyNewSegment(kContainerId, 2000, 1000, 300))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_notifier, Flush()).WillOnce(Return(true));
+    return std::move(mock_notifier);
+  }
+};
+
 }  // namespace
 
 class MpdWriterTest : public ::testing::Test {
@@ -67,6 +123,11 @@ class MpdWriterTest : public ::testing::Test {
     mpd_writer_.SetMpdNotifierFactoryForTest(std::move(notifier_factory_));
   }
 
+  void SetMpdNotifierFactoryForTest(
+      std::unique_ptr<MpdNotifierFactory> notifier_factory) {
+    mpd_writer_.SetMpdNotifierFactoryForTest(std::move(notifier_factory));
+  }
+
   std::unique_ptr<TestMpdNotifierFactory> notifier_factory_;
   MpdWriter mpd_writer_;
 };
@@ -98,4 +159,47 @@ TEST_F(MpdWriterTest, WriteMpdToFile) {
   EXPECT_TRUE(mpd_writer_.WriteMpdToFile(mpd_file_path.AsUTF8Unsafe().c_str()));
 }
 
+// Verify that the media info files written with --binary_media_info are read,
+// along with the text ones.
+TEST_F(MpdWriterTest, ReadsBinaryMediaInfo) {
+  std::string text_media_info;
+  ASSERT_TRUE(File::ReadFileToString(
+      GetTestDataFilePath(kFileNameVideoMediaInfo1).AsUTF8Unsafe().c_str(),
+      &text_media_info));
+  MediaInfo media_info;
+  ASSERT_TRUE(::google::protobuf::TextFormat::ParseFromString(text_media_info,
+                                                              &media_info));
+  const char kBinaryMediaInfoFile[] = "memory://binary.media_info";
+  ASSERT_TRUE(File::WriteStringToFile(kBinaryMediaInfoFile,
+                                      media_info.SerializeAsString()));
+
+  SetMpdNotifierFactoryForTest();
+  EXPECT_TRUE(mpd_writer_.AddFile(kBinaryMediaInfoFile));
+  EXPECT_TRUE(mpd_writer_.AddFile(
+      GetTestDataFilePath(kFileNameVideoMediaInfo2).AsUTF8Unsafe()));
+  EXPECT_TRUE(mpd_writer_.WriteMpdToFile("memory://output.mpd"));
+}
+
+// Verify that the media infos of the shards of an output are merged, even if
+// they are not added in order.
+TEST_F(MpdWriterTest, MergesShards) {
+  const std::string kSecondShard = base::StringPrintf(
+      kShardMediaInfoFormat, 2400, 1,
+      "segments { start_time: 2000 duration: 1000 size: 300 }\n");
+  const std::string kFirstShard = base::StringPrintf(
+      kShardMediaInfoFormat, 1600, 2,
+      "segments { start_time: 0 duration: 1000 size: 100 }\n"
+      "segments { start_time: 1000 duration: 1000 size: 200 }\n");
+  const char kSecondShardFile[] = "memory://shard2.media_info";
+  const char kFirstShardFile[] = "memory://shard1.media_info";
+  ASSERT_TRUE(File::WriteStringToFile(kSecondShardFile, kSecondShard));
+  ASSERT_TRUE(File::WriteStringToFile(kFirstShardFile, kFirstShard));
+
+  SetMpdNotifierFactoryForTest(std::unique_ptr<MpdNotifierFactory>(
+      new ShardsMpdNotifierFactory));
+  EXPECT_TRUE(mpd_writer_.AddFile(kSecondShardFile));
+  EXPECT_TRUE(mpd_writer_.AddFile(kFirstShardFile));
+  EXPECT_TRUE(mpd_writer_.WriteMpdToFile("memory://output.mpd"));
+}
+
 }  // namespace shaka
@@ -7,6 +7,8 @@
 #include "packager/packager.h"
 
 #include <algorithm>
+#include <cmath>
+#include <map>
 
 #include "packager/app/job_manager.h"
 #include "packager/app/libcrypto_threading.h"
@@ -14,38 +16,56 @@
 #include "packager/app/packager_util.h"
 #include "packager/app/single_thread_job_manager.h"
 #include "packager/app/stream_descriptor.h"
+#include "packager/app/thread_pool_job_manager.h"
 #include "packager/base/at_exit.h"
+#include "packager/base/bind.h"
 #include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
 #include "packager/base/optional.h"
 #include "packager/base/path_service.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/waitable_event.h"
 #include "packager/base/threading/simple_thread.h"
 #include "packager/base/time/clock.h"
 #include "packager/file/file.h"
+#include "packager/file/file_deleter.h"
+#include "packager/file/null_file.h"
+#include "packager/file/precompressed_file_writer.h"
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/hls/base/simple_hls_notifier.h"
+#include "packager/media/base/async_queue_handler.h"
 #include "packager/media/base/cc_stream_filter.h"
 #include "packager/media/base/container_names.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/fourccs.h"
+#include "packager/media/base/handler_stats.h"
+#include "packager/media/base/key_cache.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/language_utils.h"
+#include "packager/media/base/load_shedder.h"
 #include "packager/media/base/muxer.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/work_stealing_thread_pool.h"
 #include "packager/media/chunking/chunking_handler.h"
 #include "packager/media/chunking/cue_alignment_handler.h"
 #include "packager/media/chunking/text_chunker.h"
+#include "packager/media/chunking/time_range_handler.h"
 #include "packager/media/crypto/encryption_handler.h"
 #include "packager/media/demuxer/demuxer.h"
+#include "packager/media/demuxer/key_frame_index.h"
+#include "packager/media/event/media_info_writer.h"
 #include "packager/media/event/muxer_listener_factory.h"
-#include "packager/media/event/vod_media_info_dump_muxer_listener.h"
 #include "packager/media/formats/ttml/ttml_to_mp4_handler.h"
+#include "packager/media/formats/webm/encryptor.h"
 #include "packager/media/formats/webvtt/text_padder.h"
 #include "packager/media/formats/webvtt/webvtt_to_mp4_handler.h"
 #include "packager/media/replicator/replicator.h"
 #include "packager/media/trick_play/trick_play_handler.h"
+#include "packager/metrics/metrics.h"
+#include "packager/metrics/trace_event.h"
+#include "packager/mpd/base/manifest_checkpoint.pb.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/simple_mpd_notifier.h"
@@ -118,6 +138,12 @@ bool DetermineTextFileCodec(const std::string& file, std::string* out) {
   return false;
 }
 
+MediaContainerName GetInputFormat(const StreamDescriptor& descriptor) {
+  if (!descriptor.input_format.empty())
+    return DetermineContainerFromFormatName(descriptor.input_format);
+  return DetermineContainerFromFileName(descriptor.input);
+}
+
 MediaContainerName GetOutputFormat(const StreamDescriptor& descriptor) {
   if (!descriptor.output_format.empty()) {
     MediaContainerName format =
@@ -168,7 +194,7 @@ MediaContainerName GetTextOutputCodec(const StreamDescriptor& descriptor) {
   if (output_container != CONTAINER_MOV)
     return output_container;
 
-  const auto input_container = DetermineContainerFromFileName(descriptor.input);
+  const auto input_container = GetInputFormat(descriptor);
   if (base::EqualsCaseInsensitiveASCII(descriptor.output_format, "vtt+mp4") ||
       base::EqualsCaseInsensitiveASCII(descriptor.output_format,
                                        "webvtt+mp4")) {
@@ -197,12 +223,39 @@ bool IsTextStream(const StreamDescriptor& stream) {
   return output_format == CONTAINER_WEBVTT || output_format == CONTAINER_TTML;
 }
 
+// Live inputs are read until the sender closes them or ends the playlist.
+bool IsLiveInput(const StreamDescriptor& descriptor) {
+  return base::StartsWith(descriptor.input, kUdpFilePrefix,
+                          base::CompareCase::SENSITIVE) ||
+         base::StartsWith(descriptor.input, kSrtFilePrefix,
+                          base::CompareCase::SENSITIVE) ||
+         base::StartsWith(descriptor.input, kHlsHttpFilePrefix,
+                          base::CompareCase::SENSITIVE) ||
+         base::StartsWith(descriptor.input, kHlsHttpsFilePrefix,
+                          base::CompareCase::SENSITIVE);
+}
+
+bool HasLiveInputs(const std::vector<StreamDescriptor>& stream_descriptors) {
+  for (const StreamDescriptor& descriptor : stream_descriptors) {
+    if (IsLiveInput(descriptor))
+      return true;
+  }
+  return false;
+}
+
 Status ValidateStreamDescriptor(bool dump_stream_info,
                                 const StreamDescriptor& stream) {
   if (stream.input.empty()) {
     return Status(error::INVALID_ARGUMENT, "Stream input not specified.");
   }
 
+  if (!stream.input_format.empty() &&
+      DetermineContainerFromFormatName(stream.input_format) ==
+          CONTAINER_UNKNOWN) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Unsupported input format " + stream.input_format + ".");
+  }
+
   // The only time a stream can have no outputs, is when dump stream info is
   // set.
   if (dump_stream_info && stream.output.empty() &&
@@ -234,17 +287,11 @@ Status ValidateStreamDescriptor(bool dump_stream_info,
     return Status(error::INVALID_ARGUMENT, "Unsupported output format.");
   }
   if (output_format == MediaContainerName::CONTAINER_MPEG2TS) {
-    if (stream.segment_template.empty()) {
-      return Status(
-          error::INVALID_ARGUMENT,
-          "Please specify 'segment_template'. Single file TS output is "
-          "not supported.");
-    }
-
     // Right now the init segment is saved in |output| for multi-segment
     // content. However, for TS all segments must be self-initializing so
-    // there cannot be an init segment.
-    if (stream.output.length()) {
+    // there cannot be an init segment. Without 'segment_template', |output|
+    // is the single file the segments are appended to.
+    if (stream.segment_template.length() && stream.output.length()) {
       return Status(error::INVALID_ARGUMENT,
                     "All TS segments must be self-initializing. Stream "
                     "descriptors 'output' or 'init_segment' are not allowed.");
@@ -290,6 +337,59 @@ Status ValidateStreamDescriptor(bool dump_stream_info,
   return Status::OK;
 }
 
+bool IsVodShard(const VodShardParams& vod_shard_params) {
+  return vod_shard_params.start_time_in_seconds > 0 ||
+         vod_shard_params.end_time_in_seconds > 0;
+}
+
+Status ValidateVodShardParams(
+    const PackagingParams& packaging_params,
+    const std::vector<StreamDescriptor>& stream_descriptors) {
+  const VodShardParams& shard_params = packaging_params.vod_shard_params;
+  const double start = shard_params.start_time_in_seconds;
+  const double end = shard_params.end_time_in_seconds;
+  if (start < 0 || end < 0) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Shard start and end times cannot be negative.");
+  }
+  if (end > 0 && end <= start) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Shard end time must be after the start time.");
+  }
+  // The segments are aligned to multiples of the segment duration, which
+  // makes the segments of the shards match the ones of a single run.
+  const double segment_duration =
+      packaging_params.chunking_params.segment_duration_in_seconds;
+  for (double boundary : {start, end}) {
+    const double segments = boundary / segment_duration;
+    if (std::fabs(segments - std::round(segments)) > 1e-6) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Shard start and end times must be multiples of the "
+                    "segment duration.");
+    }
+  }
+
+  for (const auto& descriptor : stream_descriptors) {
+    if (IsTextStream(descriptor)) {
+      return Status(error::UNIMPLEMENTED,
+                    "Text streams cannot be packaged in shards. Package them "
+                    "in a separate run.");
+    }
+    // With $Number$, every shard would number its segments from 1.
+    if (descriptor.segment_template.find("$Time") == std::string::npos) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Packaging in shards requires segment templates with "
+                    "$Time$.");
+    }
+    // The media info is dumped next to the init segment.
+    if (descriptor.output.empty()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Packaging in shards requires init segments.");
+    }
+  }
+  return Status::OK;
+}
+
 Status ValidateParams(const PackagingParams& packaging_params,
                       const std::vector<StreamDescriptor>& stream_descriptors) {
   if (!packaging_params.chunking_params.segment_sap_aligned &&
@@ -358,7 +458,70 @@ Status ValidateParams(const PackagingParams& packaging_params,
     }
   }
 
-  if (packaging_params.output_media_info && !on_demand_dash_profile) {
+  const bool vod_shard = IsVodShard(packaging_params.vod_shard_params);
+  if (vod_shard) {
+    RETURN_IF_ERROR(
+        ValidateVodShardParams(packaging_params, stream_descriptors));
+  } else {
+    for (const auto& descriptor : stream_descriptors) {
+      if (!descriptor.key_frame_index.empty()) {
+        return Status(error::INVALID_ARGUMENT,
+                      "key_frame_index is only used when packaging in "
+                      "shards.");
+      }
+    }
+  }
+
+  const LiveCheckpointParams& checkpoint_params =
+      packaging_params.live_checkpoint_params;
+  if (checkpoint_params.resume && checkpoint_params.checkpoint_file.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Resuming from a checkpoint requires a checkpoint file.");
+  }
+  if (!checkpoint_params.checkpoint_file.empty()) {
+    if (on_demand_dash_profile || vod_shard) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Checkpoints are only supported for live packaging "
+                    "(using segment_template).");
+    }
+    if (checkpoint_params.checkpoint_period_in_seconds <= 0) {
+      return Status(error::INVALID_ARGUMENT,
+                    "The checkpoint period must be positive.");
+    }
+  }
+
+  const ChunkingParams& chunking_params = packaging_params.chunking_params;
+  const double tolerance =
+      chunking_params.segment_alignment_tolerance_in_seconds;
+  if (tolerance < 0 ||
+      (tolerance > 0 &&
+       tolerance * 2 >= chunking_params.segment_duration_in_seconds)) {
+    return Status(error::INVALID_ARGUMENT,
+                  "The segment alignment tolerance must be less than half of "
+                  "the segment duration.");
+  }
+  if (chunking_params.segment_numbers_from_timestamps) {
+    if (on_demand_dash_profile || vod_shard) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Segment numbers from timestamps are only supported for "
+                    "live packaging (using segment_template).");
+    }
+    // The cue points shift the segment boundaries away from the timeline.
+    if (!packaging_params.ad_cue_generator_params.cue_points.empty()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Segment numbers from timestamps are not supported with "
+                    "ad cues.");
+    }
+    if (packaging_params.hls_params.media_sequence_number > 0) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Segment numbers from timestamps cannot be used with a "
+                    "forced HLS media sequence number.");
+    }
+  }
+
+  // The media info of the shards records their segments to be merged.
+  if (packaging_params.output_media_info && !on_demand_dash_profile &&
+      !vod_shard) {
     // TODO(rkuroiwa, kqyang): Support partial media info dump for live.
     return Status(error::UNIMPLEMENTED,
                   "--output_media_info is only supported for on-demand profile "
@@ -441,6 +604,176 @@ bool StreamInfoToTextMediaInfo(const StreamDescriptor& stream_descriptor,
   return true;
 }
 
+// Record the statistics of |handler| in |handler_stats|, if it is not null.
+void AddHandlerStats(const std::string& handler_name,
+                     const StreamDescriptor& stream,
+                     HandlerStatsRegistry* handler_stats,
+                     MediaHandler* handler) {
+  if (!handler_stats || !handler)
+    return;
+  handler->set_stats(handler_stats->Create(
+      handler_name + "[" + stream.input + ":" + stream.stream_selector + "]"));
+}
+
+void WriteHandlerStats(const HandlerStatsRegistry* handler_stats,
+                       const std::string& output) {
+  if (!File::WriteFileAtomically(output.c_str(), handler_stats->ToJson()))
+    LOG(WARNING) << "Failed to write handler statistics to " << output;
+}
+
+// The stage of the packaging of a handler, from its statistics name.
+const char* GetBenchmarkStage(const std::string& handler_stats_name) {
+  const std::string handler_name =
+      handler_stats_name.substr(0, handler_stats_name.find('['));
+  if (handler_name == "Demuxer")
+    return "demux";
+  if (handler_name == "ChunkingHandler" || handler_name == "TextChunker" ||
+      handler_name == "CueAlignmentHandler" ||
+      handler_name == "TimeRangeHandler" || handler_name == "TextPadder") {
+    return "chunk";
+  }
+  if (handler_name == "EncryptionHandler")
+    return "encrypt";
+  if (handler_name == "Muxer")
+    return "mux";
+  return "other";
+}
+
+// Log the time spent per stage of the packaging at the end of a run with
+// PackagingParams::benchmark_null_output.
+void LogBenchmarkStats(const HandlerStatsRegistry& handler_stats,
+                       base::TimeDelta run_time) {
+  struct StageStats {
+    int64_t num_samples = 0;
+    int64_t num_bytes = 0;
+    base::TimeDelta time;
+    base::TimeDelta cpu_time;
+  };
+  const char* const kStages[] = {"demux", "chunk", "encrypt", "mux", "other"};
+  std::map<std::string, StageStats> stages;
+  for (const HandlerStats::Snapshot& snapshot : handler_stats.GetSnapshots()) {
+    StageStats& stage = stages[GetBenchmarkStage(snapshot.name)];
+    stage.num_samples += snapshot.num_samples;
+    stage.num_bytes += snapshot.num_bytes;
+    stage.time += snapshot.total_time;
+    stage.cpu_time += snapshot.total_cpu_time;
+  }
+
+  const uint64_t output_bytes = NullFile::total_bytes_written();
+  LOG(INFO) << "Benchmark: " << run_time.InSecondsF() << " s, "
+            << output_bytes << " bytes output ("
+            << output_bytes / std::max(run_time.InSecondsF(), 1e-6) / 1e6
+            << " MB/s).";
+  for (const char* stage_name : kStages) {
+    auto it = stages.find(stage_name);
+    if (it == stages.end())
+      continue;
+    const StageStats& stage = it->second;
+    LOG(INFO) << "Benchmark stage " << stage_name << ": "
+              << stage.time.InSecondsF() << " s, CPU "
+              << stage.cpu_time.InSecondsF() << " s, " << stage.num_samples
+              << " samples, " << stage.num_bytes << " bytes.";
+  }
+  // The manifests are mostly updated by the muxers, so this time is also
+  // included in the mux stage.
+  LOG(INFO) << "Benchmark stage manifest: "
+            << Metrics::GetInstance()->GetSum("shaka_manifest_write_seconds")
+            << " s.";
+}
+
+void WriteMetrics(const std::string& output) {
+  if (!File::WriteFileAtomically(output.c_str(),
+                                 Metrics::GetInstance()->ToOpenMetrics())) {
+    LOG(WARNING) << "Failed to write metrics to " << output;
+  }
+}
+
+void WriteTrace(const std::string& output) {
+  if (!File::WriteFileAtomically(output.c_str(),
+                                 TraceLog::GetInstance()->ToJson())) {
+    LOG(WARNING) << "Failed to write trace events to " << output;
+  }
+}
+
+Status FlushNotifiers(hls::HlsNotifier* hls_notifier,
+                      MpdNotifier* mpd_notifier) {
+  if (hls_notifier && !hls_notifier->Flush())
+    return Status(error::INVALID_ARGUMENT, "Failed to flush Hls.");
+  if (mpd_notifier && !mpd_notifier->Flush())
+    return Status(error::INVALID_ARGUMENT, "Failed to flush Mpd.");
+  // Finish deleting the segments which fell out of the live windows.
+  FileDeleter::GetInstance()->Flush();
+  // Finish writing the precompressed manifests.
+  PrecompressedFileWriter::GetInstance()->Flush();
+  return Status::OK;
+}
+
+void WriteCheckpoint(hls::HlsNotifier* hls_notifier,
+                     MpdNotifier* mpd_notifier,
+                     const std::string& output) {
+  ManifestCheckpoint checkpoint;
+  if (mpd_notifier)
+    mpd_notifier->SaveCheckpoint(&checkpoint);
+  if (hls_notifier)
+    hls_notifier->SaveCheckpoint(&checkpoint);
+  if (!File::WriteFileAtomically(output.c_str(),
+                                 checkpoint.SerializeAsString())) {
+    LOG(WARNING) << "Failed to write checkpoint to " << output;
+  }
+}
+
+// Resume the manifests from the checkpoint in |checkpoint_file|, if it
+// exists, and the segment numbering of the muxers created by
+// |muxer_factory|. |resumed| is set to whether a checkpoint is resumed.
+Status ResumeFromCheckpoint(const std::string& checkpoint_file,
+                            hls::HlsNotifier* hls_notifier,
+                            MpdNotifier* mpd_notifier,
+                            MuxerFactory* muxer_factory,
+                            bool* resumed) {
+  *resumed = false;
+  std::string data;
+  if (!File::ReadFileToString(checkpoint_file.c_str(), &data)) {
+    LOG(WARNING) << "Cannot read checkpoint " << checkpoint_file
+                 << ", starting a new presentation.";
+    return Status::OK;
+  }
+  ManifestCheckpoint checkpoint;
+  if (!checkpoint.ParseFromString(data)) {
+    return Status(error::PARSER_FAILURE,
+                  "Invalid checkpoint " + checkpoint_file);
+  }
+  if (mpd_notifier)
+    mpd_notifier->ResumeFromCheckpoint(checkpoint);
+  if (hls_notifier)
+    hls_notifier->ResumeFromCheckpoint(checkpoint);
+
+  // The DASH and HLS outputs of a stream share its segments, so they have
+  // the same numbering unless only one of the manifests were written.
+  std::map<std::string, uint32_t> first_segment_indices;
+  for (const RepresentationCheckpoint& representation :
+       checkpoint.representations()) {
+    uint32_t& index = first_segment_indices[representation.segment_template()];
+    index = std::max(index, representation.next_segment_index());
+  }
+  for (const MediaPlaylistCheckpoint& media_playlist :
+       checkpoint.media_playlists()) {
+    uint32_t& index = first_segment_indices[media_playlist.segment_template()];
+    index = std::max(index, media_playlist.next_segment_index());
+  }
+  muxer_factory->SetFirstSegmentIndices(first_segment_indices);
+  LOG(INFO) << "Resuming from checkpoint " << checkpoint_file;
+  *resumed = true;
+  return Status::OK;
+}
+
+// Call |write| every |period| until |stop| is signaled.
+void WritePeriodically(const base::Closure& write,
+                       base::TimeDelta period,
+                       base::WaitableEvent* stop) {
+  while (!stop->TimedWait(period))
+    write.Run();
+}
+
 /// Create a new demuxer handler for the given stream. If a demuxer cannot be
 /// created, an error will be returned. If a demuxer can be created, this
 /// |new_demuxer| will be set and Status::OK will be returned.
@@ -449,6 +782,30 @@ Status CreateDemuxer(const StreamDescriptor& stream,
                      std::shared_ptr<Demuxer>* new_demuxer) {
   std::shared_ptr<Demuxer> demuxer = std::make_shared<Demuxer>(stream.input);
   demuxer->set_dump_stream_info(packaging_params.test_params.dump_stream_info);
+  demuxer->set_zero_copy(packaging_params.zero_copy_demux);
+  demuxer->set_mmap_input(packaging_params.mmap_input);
+  demuxer->set_random_access(packaging_params.mp4_random_access_demux);
+  if (!stream.input_format.empty()) {
+    demuxer->set_container_name(
+        DetermineContainerFromFormatName(stream.input_format));
+  }
+  // Only the part of the input around the shard is read.
+  if (!stream.key_frame_index.empty()) {
+    DCHECK(IsVodShard(packaging_params.vod_shard_params));
+    KeyFrameIndex key_frame_index;
+    RETURN_IF_ERROR(key_frame_index.ReadFromFile(stream.key_frame_index));
+    demuxer->SetKeyFrameIndex(
+        key_frame_index,
+        packaging_params.vod_shard_params.start_time_in_seconds,
+        packaging_params.vod_shard_params.end_time_in_seconds);
+  }
+  if (!packaging_params.single_threaded) {
+    demuxer->set_num_ts_demux_threads(packaging_params.num_ts_demux_threads);
+    demuxer->set_num_webm_demux_threads(
+        packaging_params.num_webm_demux_threads);
+    demuxer->set_num_decryption_threads(
+        packaging_params.num_decryption_threads);
+  }
 
   if (packaging_params.decryption_params.key_provider != KeyProvider::kNone) {
     std::unique_ptr<KeySource> decryption_key_source(
@@ -468,7 +825,8 @@ Status CreateDemuxer(const StreamDescriptor& stream,
 std::shared_ptr<MediaHandler> CreateEncryptionHandler(
     const PackagingParams& packaging_params,
     const StreamDescriptor& stream,
-    KeySource* key_source) {
+    KeySource* key_source,
+    WorkStealingThreadPool* encryption_thread_pool) {
   if (stream.skip_encryption) {
     return nullptr;
   }
@@ -506,7 +864,19 @@ std::shared_ptr<MediaHandler> CreateEncryptionHandler(
         kDefaultMaxHdPixels, kDefaultMaxUhd1Pixels, std::placeholders::_1);
   }
 
-  return std::make_shared<EncryptionHandler>(encryption_params, key_source);
+  std::shared_ptr<EncryptionHandler> encryption_handler =
+      std::make_shared<EncryptionHandler>(encryption_params, key_source);
+  encryption_handler->set_encryption_thread_pool(encryption_thread_pool);
+  // Keeping (sub)segments in flight delays them by a few (sub)segment
+  // durations, which only VOD outputs can afford.
+  if (IsLiveInput(stream) ||
+      packaging_params.mp4_output_params.low_latency_chunked_output) {
+    encryption_handler->set_max_segment_ranges_in_flight(0);
+  }
+  // Room for the WebM frame headers, so the encrypted samples are not copied.
+  if (GetOutputFormat(stream) == CONTAINER_WEBM)
+    encryption_handler->set_sample_headroom(webm::kEncryptedFrameHeadroom);
+  return encryption_handler;
 }
 
 std::unique_ptr<MediaHandler> CreateTextChunker(
@@ -571,8 +941,8 @@ Status CreateTtmlJobs(
       }
 
       if (packaging_params.output_media_info) {
-        VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
-            text_media_info, stream.output + kMediaInfoSuffix);
+        MediaInfoWriter::GetInstance()->Write(
+            stream.output + kMediaInfoSuffix, text_media_info);
       }
     }
   }
@@ -584,9 +954,11 @@ Status CreateAudioVideoJobs(
     const std::vector<std::reference_wrapper<const StreamDescriptor>>& streams,
     const PackagingParams& packaging_params,
     KeySource* encryption_key_source,
+    WorkStealingThreadPool* encryption_thread_pool,
     SyncPointQueue* sync_points,
     MuxerListenerFactory* muxer_listener_factory,
     MuxerFactory* muxer_factory,
+    HandlerStatsRegistry* handler_stats,
     JobManager* job_manager) {
   DCHECK(muxer_listener_factory);
   DCHECK(muxer_factory);
@@ -596,27 +968,46 @@ Status CreateAudioVideoJobs(
   // order.
   std::map<std::string, std::shared_ptr<Demuxer>> sources;
   std::map<std::string, std::shared_ptr<MediaHandler>> cue_aligners;
+  std::map<std::string, int> numa_nodes;
 
   for (const StreamDescriptor& stream : streams) {
     bool seen_input_before = sources.find(stream.input) != sources.end();
+    if (stream.numa_node >= 0 && !numa_nodes.count(stream.input))
+      numa_nodes[stream.input] = stream.numa_node;
     if (seen_input_before) {
       continue;
     }
 
     RETURN_IF_ERROR(
         CreateDemuxer(stream, packaging_params, &sources[stream.input]));
-    cue_aligners[stream.input] =
-        sync_points ? std::make_shared<CueAlignmentHandler>(sync_points)
-                    : nullptr;
+    if (handler_stats) {
+      sources[stream.input]->set_stats(
+          handler_stats->Create("Demuxer[" + stream.input + "]"));
+    }
+    if (sync_points) {
+      auto cue_aligner = std::make_shared<CueAlignmentHandler>(sync_points);
+      cue_aligner->set_max_buffered_bytes(
+          packaging_params.ad_cue_generator_params
+              .max_buffered_bytes_per_input);
+      cue_aligner->set_metrics_input(stream.input);
+      cue_aligners[stream.input] = std::move(cue_aligner);
+    }
+    AddHandlerStats("CueAlignmentHandler", stream, handler_stats,
+                    cue_aligners[stream.input].get());
   }
 
   for (auto& source : sources) {
-    job_manager->Add("RemuxJob", source.second);
+    const auto numa_node = numa_nodes.find(source.first);
+    job_manager->Add("RemuxJob", source.second,
+                     numa_node == numa_nodes.end() ? -1 : numa_node->second);
   }
 
   // Replicators are shared among all streams with the same input and stream
   // selector.
   std::shared_ptr<MediaHandler> replicator;
+  // So are the trick play handlers, which have an output per trick play
+  // factor. The trick play streams follow their main stream.
+  std::shared_ptr<TrickPlayHandler> trick_play_handler;
 
   std::string previous_input;
   std::string previous_selector;
@@ -647,23 +1038,59 @@ Status CreateAudioVideoJobs(
         demuxer->SetLanguageOverride(stream.stream_selector, stream.language);
       }
 
+      const uint32_t pipeline_queue_size =
+          packaging_params.single_threaded
+              ? 0
+              : packaging_params.pipeline_queue_size;
+
       std::vector<std::shared_ptr<MediaHandler>> handlers;
       if (is_text) {
         handlers.emplace_back(
             std::make_shared<TextPadder>(kDefaultTextZeroBiasMs));
+        AddHandlerStats("TextPadder", stream, handler_stats,
+                        handlers.back().get());
       }
       if (sync_points) {
         handlers.emplace_back(cue_aligner);
       }
+      if (pipeline_queue_size > 0) {
+        // Decouple the processing from the demuxing. The cue aligner is
+        // shared by the streams of the input, so it stays on the demuxer
+        // thread.
+        handlers.emplace_back(
+            std::make_shared<AsyncQueueHandler>(pipeline_queue_size));
+      }
       if (!is_text) {
+        if (IsVodShard(packaging_params.vod_shard_params)) {
+          handlers.emplace_back(std::make_shared<TimeRangeHandler>(
+              packaging_params.vod_shard_params));
+          AddHandlerStats("TimeRangeHandler", stream, handler_stats,
+                          handlers.back().get());
+        }
         handlers.emplace_back(std::make_shared<ChunkingHandler>(
             packaging_params.chunking_params));
-        handlers.emplace_back(CreateEncryptionHandler(packaging_params, stream,
-                                                      encryption_key_source));
+        AddHandlerStats("ChunkingHandler", stream, handler_stats,
+                        handlers.back().get());
+        handlers.emplace_back(
+            CreateEncryptionHandler(packaging_params, stream,
+                                    encryption_key_source,
+                                    encryption_thread_pool));
+        AddHandlerStats("EncryptionHandler", stream, handler_stats,
+                        handlers.back().get());
+        if (pipeline_queue_size > 0) {
+          // Decouple the muxing from the processing.
+          handlers.emplace_back(
+              std::make_shared<AsyncQueueHandler>(pipeline_queue_size));
+        }
       }
 
-      replicator = std::make_shared<Replicator>();
+      replicator = std::make_shared<Replicator>(
+          packaging_params.single_threaded
+              ? 0
+              : packaging_params.parallel_output_queue_size);
+      AddHandlerStats("Replicator", stream, handler_stats, replicator.get());
       handlers.emplace_back(replicator);
+      trick_play_handler.reset();
 
       RETURN_IF_ERROR(MediaHandler::Chain(handlers));
       RETURN_IF_ERROR(demuxer->SetHandler(stream.stream_selector, handlers[0]));
@@ -682,14 +1109,24 @@ Status CreateAudioVideoJobs(
     std::unique_ptr<MuxerListener> muxer_listener =
         muxer_listener_factory->CreateListener(ToMuxerListenerData(stream));
     muxer->SetMuxerListener(std::move(muxer_listener));
+    AddHandlerStats("Muxer", stream, handler_stats, muxer.get());
 
     std::vector<std::shared_ptr<MediaHandler>> handlers;
-    handlers.emplace_back(replicator);
 
-    // Trick play is optional.
-    if (stream.trick_play_factor) {
-      handlers.emplace_back(
-          std::make_shared<TrickPlayHandler>(stream.trick_play_factor));
+    // Trick play is optional. The key frames are extracted once for all the
+    // trick play factors of the stream.
+    if (stream.trick_play_factor && trick_play_handler) {
+      trick_play_handler->AddFactor(stream.trick_play_factor);
+      handlers.emplace_back(trick_play_handler);
+    } else {
+      handlers.emplace_back(replicator);
+      if (stream.trick_play_factor) {
+        trick_play_handler =
+            std::make_shared<TrickPlayHandler>(stream.trick_play_factor);
+        AddHandlerStats("TrickPlayHandler", stream, handler_stats,
+                        trick_play_handler.get());
+        handlers.emplace_back(trick_play_handler);
+      }
     }
 
     if (stream.cc_index >= 0) {
@@ -701,6 +1138,8 @@ Status CreateAudioVideoJobs(
         (!stream.segment_template.empty() || output_format == CONTAINER_MOV)) {
       handlers.emplace_back(
           CreateTextChunker(packaging_params.chunking_params));
+      AddHandlerStats("TextChunker", stream, handler_stats,
+                      handlers.back().get());
     }
 
     if (is_text && output_format == CONTAINER_MOV) {
@@ -723,9 +1162,11 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
                      const PackagingParams& packaging_params,
                      MpdNotifier* mpd_notifier,
                      KeySource* encryption_key_source,
+                     WorkStealingThreadPool* encryption_thread_pool,
                      SyncPointQueue* sync_points,
                      MuxerListenerFactory* muxer_listener_factory,
                      MuxerFactory* muxer_factory,
+                     HandlerStatsRegistry* handler_stats,
                      JobManager* job_manager) {
   DCHECK(muxer_factory);
   DCHECK(muxer_listener_factory);
@@ -740,7 +1181,7 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
   bool has_non_transport_audio_video_streams = false;
 
   for (const StreamDescriptor& stream : stream_descriptors) {
-    const auto input_container = DetermineContainerFromFileName(stream.input);
+    const auto input_container = GetInputFormat(stream);
     const auto output_format = GetOutputFormat(stream);
     if (input_container == CONTAINER_TTML) {
       ttml_streams.push_back(stream);
@@ -785,8 +1226,9 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
   RETURN_IF_ERROR(CreateTtmlJobs(ttml_streams, packaging_params, sync_points,
                                  muxer_factory, mpd_notifier, job_manager));
   RETURN_IF_ERROR(CreateAudioVideoJobs(
-      audio_video_streams, packaging_params, encryption_key_source, sync_points,
-      muxer_listener_factory, muxer_factory, job_manager));
+      audio_video_streams, packaging_params, encryption_key_source,
+      encryption_thread_pool, sync_points, muxer_listener_factory,
+      muxer_factory, handler_stats, job_manager));
 
   // Initialize processing graph.
   return job_manager->InitializeJobs();
@@ -798,6 +1240,21 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
 struct Packager::PackagerInternal {
   media::FakeClock fake_clock;
   std::unique_ptr<KeySource> encryption_key_source;
+  // Shared by all the encryption handlers. Declared before |job_manager| so
+  // it outlives the jobs.
+  std::unique_ptr<media::WorkStealingThreadPool> encryption_thread_pool;
+  // Not null if the load shedding is enabled. Used by the muxers.
+  std::unique_ptr<media::LoadShedder> load_shedder;
+  // Not null if the handler statistics are enabled.
+  std::unique_ptr<media::HandlerStatsRegistry> handler_stats;
+  std::string handler_stats_output;
+  base::TimeDelta handler_stats_update_period;
+  std::string metrics_output;
+  base::TimeDelta metrics_update_period;
+  std::string trace_file;
+  bool benchmark_null_output = false;
+  std::string checkpoint_file;
+  base::TimeDelta checkpoint_period;
   std::unique_ptr<MpdNotifier> mpd_notifier;
   std::unique_ptr<hls::HlsNotifier> hls_notifier;
   BufferCallbackParams buffer_callback_params;
@@ -825,10 +1282,22 @@ Status Packager::Initialize(
         packaging_params.test_params.injected_library_version);
   }
 
+  // Process wide, as the files are opened by name everywhere.
+  if (packaging_params.benchmark_null_output)
+    NullFile::set_discard_outputs(true);
+
   std::unique_ptr<PackagerInternal> internal(new PackagerInternal);
 
   // Create encryption key source if needed.
   if (packaging_params.encryption_params.key_provider != KeyProvider::kNone) {
+    // Process wide, as the key cache is shared by all the instances.
+    if (!packaging_params.encryption_params.key_cache_dir.empty() &&
+        !media::KeyCache::GetInstance()->SetPersistentStore(
+            packaging_params.encryption_params.key_cache_dir,
+            packaging_params.encryption_params.key_cache_encryption_key)) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Invalid key_cache_encryption_key.");
+    }
     internal->encryption_key_source = CreateEncryptionKeySource(
         static_cast<media::FourCC>(
             packaging_params.encryption_params.protection_scheme),
@@ -847,10 +1316,16 @@ Status Packager::Initialize(
       packaging_params.chunking_params.segment_duration_in_seconds;
   mpd_params.target_segment_duration = target_segment_duration;
   hls_params.target_segment_duration = target_segment_duration;
+  // Redundant packagers number the manifests from the timestamps too.
+  const bool segment_numbers_from_timestamps =
+      packaging_params.chunking_params.segment_numbers_from_timestamps;
+  mpd_params.segment_numbers_from_timestamps = segment_numbers_from_timestamps;
+  hls_params.segment_numbers_from_timestamps = segment_numbers_from_timestamps;
 
   // Store callback params to make it available during packaging.
   internal->buffer_callback_params = packaging_params.buffer_callback_params;
-  if (internal->buffer_callback_params.write_func) {
+  if (internal->buffer_callback_params.write_func ||
+      internal->buffer_callback_params.output_sink) {
     mpd_params.mpd_output = File::MakeCallbackFileName(
         internal->buffer_callback_params, mpd_params.mpd_output);
     hls_params.master_playlist_output = File::MakeCallbackFileName(
@@ -896,9 +1371,15 @@ Status Packager::Initialize(
   if (packaging_params.single_threaded) {
     internal->job_manager.reset(
         new SingleThreadJobManager(std::move(sync_points)));
+  } else if (packaging_params.num_worker_threads > 0) {
+    internal->job_manager.reset(new ThreadPoolJobManager(
+        std::move(sync_points), packaging_params.num_worker_threads,
+        HasLiveInputs(stream_descriptors)));
   } else {
     internal->job_manager.reset(new JobManager(std::move(sync_points)));
   }
+  internal->job_manager->set_numa_aware_placement(
+      packaging_params.numa_aware_jobs);
 
   std::vector<StreamDescriptor> streams_for_jobs;
 
@@ -911,7 +1392,8 @@ Status Packager::Initialize(
                                               descriptor.input);
     }
 
-    if (internal->buffer_callback_params.write_func) {
+    if (internal->buffer_callback_params.write_func ||
+        internal->buffer_callback_params.output_sink) {
       copy.output = File::MakeCallbackFileName(internal->buffer_callback_params,
                                                descriptor.output);
       copy.segment_template = File::MakeCallbackFileName(
@@ -935,16 +1417,69 @@ Status Packager::Initialize(
   if (packaging_params.test_params.inject_fake_clock) {
     muxer_factory.OverrideClock(&internal->fake_clock);
   }
+  if (packaging_params.load_shedding_params.max_lag_in_seconds > 0) {
+    internal->load_shedder.reset(new media::LoadShedder(
+        base::TimeDelta::FromSecondsD(
+            packaging_params.load_shedding_params.max_lag_in_seconds),
+        packaging_params.load_shedding_params.output_shed_callback));
+    muxer_factory.SetLoadShedder(internal->load_shedder.get());
+  }
+
+  // The clear lead only applies to the start of a channel, not to its
+  // resumption.
+  const PackagingParams* job_packaging_params = &packaging_params;
+  PackagingParams resumed_packaging_params;
+  const LiveCheckpointParams& checkpoint_params =
+      packaging_params.live_checkpoint_params;
+  if (checkpoint_params.resume) {
+    bool resumed = false;
+    RETURN_IF_ERROR(media::ResumeFromCheckpoint(
+        checkpoint_params.checkpoint_file, internal->hls_notifier.get(),
+        internal->mpd_notifier.get(), &muxer_factory, &resumed));
+    if (resumed) {
+      resumed_packaging_params = packaging_params;
+      resumed_packaging_params.encryption_params.clear_lead_in_seconds = 0;
+      job_packaging_params = &resumed_packaging_params;
+    }
+  }
+  internal->checkpoint_file = checkpoint_params.checkpoint_file;
+  internal->checkpoint_period = base::TimeDelta::FromSecondsD(
+      checkpoint_params.checkpoint_period_in_seconds);
 
   media::MuxerListenerFactory muxer_listener_factory(
       packaging_params.output_media_info, internal->mpd_notifier.get(),
-      internal->hls_notifier.get());
+      internal->hls_notifier.get(), packaging_params.deterministic_manifests);
+
+  if (internal->encryption_key_source &&
+      packaging_params.encryption_params.num_encryption_threads > 0) {
+    internal->encryption_thread_pool.reset(new media::WorkStealingThreadPool(
+        packaging_params.encryption_params.num_encryption_threads));
+  }
+
+  if (!packaging_params.handler_stats_output.empty()) {
+    internal->handler_stats.reset(new media::HandlerStatsRegistry);
+    internal->handler_stats_output = packaging_params.handler_stats_output;
+    internal->handler_stats_update_period = base::TimeDelta::FromSecondsD(
+        packaging_params.handler_stats_update_period_in_seconds);
+  }
+  if (packaging_params.benchmark_null_output) {
+    // The time per stage comes from the handler statistics.
+    if (!internal->handler_stats)
+      internal->handler_stats.reset(new media::HandlerStatsRegistry);
+    internal->benchmark_null_output = true;
+  }
+  internal->metrics_output = packaging_params.metrics_output;
+  internal->metrics_update_period = base::TimeDelta::FromSecondsD(
+      packaging_params.metrics_update_period_in_seconds);
+  internal->trace_file = packaging_params.trace_file;
 
   RETURN_IF_ERROR(media::CreateAllJobs(
-      streams_for_jobs, packaging_params, internal->mpd_notifier.get(),
+      streams_for_jobs, *job_packaging_params, internal->mpd_notifier.get(),
       internal->encryption_key_source.get(),
+      internal->encryption_thread_pool.get(),
       internal->job_manager->sync_points(), &muxer_listener_factory,
-      &muxer_factory, internal->job_manager.get()));
+      &muxer_factory, internal->handler_stats.get(),
+      internal->job_manager.get()));
 
   internal_ = std::move(internal);
   return Status::OK;
@@ -954,17 +1489,93 @@ Status Packager::Run() {
   if (!internal_)
     return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
 
-  RETURN_IF_ERROR(internal_->job_manager->RunJobs());
+  if (!internal_->trace_file.empty())
+    TraceLog::GetInstance()->Enable();
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+
+  // Write the handler statistics and the metrics periodically while the jobs
+  // run.
+  base::WaitableEvent stop_periodic_updates(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  std::unique_ptr<media::ClosureThread> handler_stats_thread;
+  if (internal_->handler_stats &&
+      internal_->handler_stats_update_period > base::TimeDelta()) {
+    handler_stats_thread.reset(new media::ClosureThread(
+        "HandlerStats",
+        base::Bind(&media::WritePeriodically,
+                   base::Bind(&media::WriteHandlerStats,
+                              internal_->handler_stats.get(),
+                              internal_->handler_stats_output),
+                   internal_->handler_stats_update_period,
+                   &stop_periodic_updates)));
+    handler_stats_thread->Start();
+  }
+  std::unique_ptr<media::ClosureThread> metrics_thread;
+  if (!internal_->metrics_output.empty() &&
+      internal_->metrics_update_period > base::TimeDelta()) {
+    metrics_thread.reset(new media::ClosureThread(
+        "Metrics", base::Bind(&media::WritePeriodically,
+                              base::Bind(&media::WriteMetrics,
+                                         internal_->metrics_output),
+                              internal_->metrics_update_period,
+                              &stop_periodic_updates)));
+    metrics_thread->Start();
+  }
+  std::unique_ptr<media::ClosureThread> checkpoint_thread;
+  if (!internal_->checkpoint_file.empty()) {
+    checkpoint_thread.reset(new media::ClosureThread(
+        "Checkpoint", base::Bind(&media::WritePeriodically,
+                                 base::Bind(&media::WriteCheckpoint,
+                                            internal_->hls_notifier.get(),
+                                            internal_->mpd_notifier.get(),
+                                            internal_->checkpoint_file),
+                                 internal_->checkpoint_period,
+                                 &stop_periodic_updates)));
+    checkpoint_thread->Start();
+  }
 
-  if (internal_->hls_notifier) {
-    if (!internal_->hls_notifier->Flush())
-      return Status(error::INVALID_ARGUMENT, "Failed to flush Hls.");
+  Status status = internal_->job_manager->RunJobs();
+
+  stop_periodic_updates.Signal();
+  if (handler_stats_thread)
+    handler_stats_thread->Join();
+  if (metrics_thread)
+    metrics_thread->Join();
+  if (checkpoint_thread)
+    checkpoint_thread->Join();
+  if (!internal_->handler_stats_output.empty()) {
+    media::WriteHandlerStats(internal_->handler_stats.get(),
+                             internal_->handler_stats_output);
   }
-  if (internal_->mpd_notifier) {
-    if (!internal_->mpd_notifier->Flush())
-      return Status(error::INVALID_ARGUMENT, "Failed to flush Mpd.");
+  // Finish writing the media info files of the outputs.
+  media::MediaInfoWriter::GetInstance()->Flush();
+  if (status.ok()) {
+    status = media::FlushNotifiers(internal_->hls_notifier.get(),
+                                   internal_->mpd_notifier.get());
   }
-  return Status::OK;
+  if (!internal_->checkpoint_file.empty()) {
+    media::WriteCheckpoint(internal_->hls_notifier.get(),
+                           internal_->mpd_notifier.get(),
+                           internal_->checkpoint_file);
+  }
+
+  // Written after the final manifest updates, so they are included.
+  if (!internal_->trace_file.empty()) {
+    TraceLog::GetInstance()->Disable();
+    media::WriteTrace(internal_->trace_file);
+  }
+  if (!internal_->metrics_output.empty())
+    media::WriteMetrics(internal_->metrics_output);
+  if (internal_->benchmark_null_output) {
+    media::LogBenchmarkStats(*internal_->handler_stats,
+                             base::TimeTicks::Now() - start_time);
+  }
+  return status;
+}
+
+std::future<Status> Packager::RunAsync() {
+  return std::async(std::launch::async, [this]() { return Run(); });
 }
 
 void Packager::Cancel() {
@@ -972,6 +1583,8 @@ void Packager::Cancel() {
     LOG(INFO) << "Not yet initialized. Return directly.";
     return;
   }
+  if (internal_->encryption_key_source)
+    internal_->encryption_key_source->Cancel();
   internal_->job_manager->CancelJobs();
 }
 
@@ -979,6 +1592,16 @@ std::string Packager::GetLibraryVersion() {
   return GetPackagerVersion();
 }
 
+std::string Packager::GetMetrics() {
+  return Metrics::GetInstance()->ToOpenMetrics();
+}
+
+double Packager::GetCpuTimeInSeconds() const {
+  if (!internal_)
+    return 0;
+  return internal_->job_manager->cpu_time().InSecondsF();
+}
+
 std::string Packager::DefaultStreamLabelFunction(
     int max_sd_pixels,
     int max_hd_pixels,
@@ -24,6 +24,8 @@
         'app/packager_util.h',
         'app/single_thread_job_manager.cc',
         'app/single_thread_job_manager.h',
+        'app/thread_pool_job_manager.cc',
+        'app/thread_pool_job_manager.h',
         'packager.cc',
         'packager.h',
       ],
@@ -46,6 +48,7 @@
         'media/public/public.gyp:public',
         'media/replicator/replicator.gyp:replicator',
         'media/trick_play/trick_play.gyp:trick_play',
+        'metrics/metrics.gyp:metrics',
         'mpd/mpd.gyp:mpd_builder',
         'third_party/boringssl/boringssl.gyp:boringssl',
         'version/version.gyp:version',
@@ -81,6 +84,8 @@
         'app/muxer_flags.cc',
         'app/muxer_flags.h',
         'app/packager_main.cc',
+        'app/packaging_job_queue.cc',
+        'app/packaging_job_queue.h',
         'app/playready_key_encryption_flags.cc',
         'app/playready_key_encryption_flags.h',
         'app/raw_key_encryption_flags.cc',
@@ -102,6 +107,8 @@
         'base/base.gyp:base',
         'file/file.gyp:file',
         'libpackager',
+        'media/base/media_base.gyp:media_base',
+        'metrics/metrics.gyp:metrics',
         'third_party/gflags/gflags.gyp:gflags',
         'tools/license_notice.gyp:license_notice',
       ],
@@ -113,6 +120,22 @@
         }],
       ],
     },
+    {
+      'target_name': 'key_frame_indexer',
+      'type': 'executable',
+      'sources': [
+        'app/key_frame_indexer.cc',
+        'app/vlog_flags.cc',
+        'app/vlog_flags.h',
+      ],
+      'dependencies': [
+        'base/base.gyp:base',
+        'media/demuxer/demuxer.gyp:demuxer',
+        'third_party/gflags/gflags.gyp:gflags',
+        'tools/license_notice.gyp:license_notice',
+        'version/version.gyp:version',
+      ],
+    },
     {
       'target_name': 'mpd_generator',
       'type': 'executable',
@@ -124,6 +147,7 @@
       ],
       'dependencies': [
         'base/base.gyp:base',
+        'media/base/media_base.gyp:media_base',
         'mpd/mpd.gyp:mpd_util',
         'third_party/gflags/gflags.gyp:gflags',
         'tools/license_notice.gyp:license_notice',
@@ -149,6 +173,7 @@
         'destination': '<(PRODUCT_DIR)',
         'files': [
           'app/test/packager_app.py',
+          'app/test/packager_benchmark.py',
           'app/test/packager_test.py',
           'app/test/test_env.py',
         ],
@@ -206,6 +231,8 @@
       'target_name': 'packager_builder_tests',
       'type': 'none',
       'dependencies': [
+        'benchmarks/benchmarks.gyp:benchmark_unittest',
+        'benchmarks/benchmarks.gyp:packager_benchmarks',
         'file/file.gyp:file_unittest',
         'hls/hls.gyp:hls_unittest',
         'media/base/media_base.gyp:media_base_unittest',
@@ -222,7 +249,10 @@
         'media/formats/webm/webm.gyp:webm_unittest',
         'media/formats/webvtt/webvtt.gyp:webvtt_unittest',
         'media/formats/wvm/wvm.gyp:wvm_unittest',
+        'media/replicator/replicator.gyp:replicator_unittest',
+        'media/test/media_test.gyp:allocation_budget_unittest',
         'media/trick_play/trick_play.gyp:trick_play_unittest',
+        'metrics/metrics.gyp:metrics_unittest',
         'mpd/mpd.gyp:mpd_unittest',
         'packager_test',
         'status_unittest',
@@ -7,6 +7,8 @@
 #ifndef PACKAGER_PACKAGER_H_
 #define PACKAGER_PACKAGER_H_
 
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
@@ -16,7 +18,10 @@
 #include "packager/media/public/ad_cue_generator_params.h"
 #include "packager/media/public/chunking_params.h"
 #include "packager/media/public/crypto_params.h"
+#include "packager/media/public/live_checkpoint_params.h"
+#include "packager/media/public/load_shedding_params.h"
 #include "packager/media/public/mp4_output_params.h"
+#include "packager/media/public/vod_shard_params.h"
 #include "packager/mpd/public/mpd_params.h"
 #include "packager/status.h"
 
@@ -46,6 +51,12 @@ struct PackagingParams {
   uint32_t transport_stream_timestamp_offset_ms = 0;
   /// Chunking (segmentation) related parameters.
   ChunkingParams chunking_params;
+  /// Load shedding parameters for live packaging.
+  LoadSheddingParams load_shedding_params;
+  /// Parameters to package a time range of a VOD input.
+  VodShardParams vod_shard_params;
+  /// Parameters to checkpoint a live channel and resume it after a restart.
+  LiveCheckpointParams live_checkpoint_params;
 
   /// Out of band cuepoint parameters.
   AdCueGeneratorParams ad_cue_generator_params;
@@ -56,6 +67,96 @@ struct PackagingParams {
   /// Only use a single thread to generate output.  This is useful in tests to
   /// avoid non-deterministic outputs.
   bool single_threaded = false;
+  /// Register the outputs in the manifests in stream descriptor order instead
+  /// of the order in which they start or complete, which depends on the thread
+  /// scheduling. This makes the VOD manifests identical across runs without
+  /// `single_threaded`. The manifest updates of an output are held until the
+  /// outputs before it have started, or completed for VOD manifests.
+  bool deterministic_manifests = false;
+  /// If non-zero, run the packaging jobs on a work-stealing pool of this many
+  /// threads instead of one thread per input stream. Every job runs on one
+  /// thread until it ends, so with live inputs or cue alignment, Run() fails
+  /// if there are more jobs than threads. Ignored if `single_threaded` is set.
+  uint32_t num_worker_threads = 0;
+  /// Pin the packaging jobs to the NUMA nodes of the host, round robin, so
+  /// their threads do not migrate across sockets and their sample buffers
+  /// are allocated from local memory. Jobs whose streams set `numa_node` are
+  /// pinned to that node instead. Ignored if `single_threaded` is set.
+  bool numa_aware_jobs = false;
+  /// Let demuxed samples reference the input read buffers instead of copying
+  /// the sample data out. Data is copied at most once, when a downstream
+  /// handler needs to modify it, e.g. for encryption. Currently only
+  /// effective for MP4 inputs.
+  bool zero_copy_demux = false;
+  /// Map local input files in memory instead of reading them. MP4 inputs are
+  /// parsed directly from the mapping, without reading through the 'mdat'
+  /// boxes to reach a trailing 'moov' and without copying the samples.
+  bool mmap_input = false;
+  /// Read the samples of local non-fragmented MP4 inputs with positional
+  /// reads, chunk by chunk in decoding time order across the tracks, instead
+  /// of reading the files sequentially. Memory usage is then bounded by the
+  /// chunk size even if the tracks are poorly interleaved.
+  bool mp4_random_access_demux = false;
+  /// If non-zero, the elementary streams of MPEG-2 TS inputs, e.g. the video,
+  /// audio and subtitle PIDs of a broadcast capture, are parsed in parallel on
+  /// a pool of this many threads per input. Ignored if `single_threaded` is
+  /// set.
+  uint32_t num_ts_demux_threads = 0;
+  /// If non-zero, the clusters of WebM inputs with Cues, e.g. a long VP9
+  /// mezzanine, are parsed in parallel on a pool of this many threads per
+  /// input. Ignored if `single_threaded` is set.
+  uint32_t num_webm_demux_threads = 0;
+  /// If non-zero, the samples of encrypted MP4 inputs are decrypted in
+  /// parallel on a pool of this many threads per input, instead of on the
+  /// demuxer thread. Only used with a decryption key provider. Ignored if
+  /// `single_threaded` is set.
+  uint32_t num_decryption_threads = 0;
+  /// If non-zero, the outputs of a stream, e.g. the outputs of different
+  /// formats or trick play factors, are processed in parallel, each on its
+  /// own thread fed by a queue of up to this many messages. Ignored if
+  /// `single_threaded` is set.
+  uint32_t parallel_output_queue_size = 0;
+  /// If non-zero, the demuxing, the processing (chunking and encryption) and
+  /// the muxing of each stream run on separate threads, connected by queues of
+  /// up to this many messages. Ignored if `single_threaded` is set.
+  uint32_t pipeline_queue_size = 0;
+  /// If not empty, the statistics of the media handlers, i.e. the messages,
+  /// samples and bytes processed, the time and CPU time spent, and the p50 /
+  /// p99 latency per message, are written to this file as JSON at the end of
+  /// the run.
+  std::string handler_stats_output;
+  /// If positive and `handler_stats_output` is set, the statistics are also
+  /// written every this many seconds while running, e.g. in live packaging.
+  double handler_stats_update_period_in_seconds = 0;
+  /// If set, the process-wide metrics, see Packager::GetMetrics(), are written
+  /// to this file at the end of the run.
+  std::string metrics_output;
+  /// If positive and `metrics_output` is set, the metrics are also written
+  /// every this many seconds while running.
+  double metrics_update_period_in_seconds = 0;
+  /// If set, trace events of the packaging hot paths, e.g. the demuxer reads,
+  /// the parsing, the encryption of the samples, the fragment finalization,
+  /// the file I/O and the MPD updates, are recorded per thread and written to
+  /// this file at the end of the run, in the Chrome trace event format which
+  /// can be loaded in chrome://tracing or https://ui.perfetto.dev.
+  std::string trace_file;
+  /// If set, all the outputs of the process, i.e. the media files, the
+  /// manifests and the other files written, are discarded and only their
+  /// bytes are counted, and the time spent per stage of the packaging
+  /// (demux, chunk, encrypt, mux and manifest) is logged at the end of the
+  /// run. This measures the compute throughput of the packaging without the
+  /// cost of the storage. The outputs read back, e.g. the temporary files,
+  /// read as zeros.
+  bool benchmark_null_output = false;
+  /// If set, called with the progress of each output, from 0 to 1, as it is
+  /// packaged. It is called with the output file name, or the segment template
+  /// for segmented outputs. It is called from a background thread of each
+  /// output, every 500 ms or sooner if the progress advanced by 1%, so a
+  /// slow callback does not slow down the packaging. The completion is
+  /// reported before Packager::Run() returns. Only the MP4 and WebM outputs
+  /// of inputs with a known duration report their progress.
+  std::function<void(const std::string& output, double progress)>
+      progress_callback;
   /// DASH MPD related parameters.
   MpdParams mpd_params;
   /// HLS related parameters.
@@ -77,6 +178,14 @@ struct StreamDescriptor {
   /// Input/source media file path or network stream URL. Required.
   std::string input;
 
+  /// Optional value which specifies the input container format, e.g. "ts".
+  /// If specified, the container is not detected from the input content.
+  std::string input_format;
+  /// Optional key frame index of the input, generated by key_frame_indexer.
+  /// When packaging a time range of the input, see VodShardParams, only the
+  /// part of the input around the time range is read.
+  std::string key_frame_index;
+
   /// Stream selector, can be `audio`, `video`, `text` or a zero based stream
   /// index. Required.
   std::string stream_selector;
@@ -113,6 +222,9 @@ struct StreamDescriptor {
   /// formats, there are multiple "channels" in a single stream. This allows
   /// selecting only one channel.
   int32_t cc_index = -1;
+  /// Optional NUMA node to run the packaging job of the input on. The first
+  /// stream of an input with a non-negative value sets the node of the job.
+  int32_t numa_node = -1;
 
   /// Required for audio when outputting HLS. It defines the name of the output
   /// stream, which is not necessarily the same as output. This is used as the
@@ -160,12 +272,33 @@ class SHAKA_EXPORT Packager {
   /// @return OK on success, an appropriate error code on failure.
   Status Run();
 
+  /// Same as Run(), but runs the pipeline on a new thread and returns
+  /// immediately. The Packager must outlive the returned future.
+  /// @return a future holding the status of the run.
+  std::future<Status> RunAsync();
+
   /// Cancel packaging. Note that it has to be called from another thread.
+  /// The reads of the inputs and the waits for the keys of the next crypto
+  /// periods in progress are interrupted, so the jobs exit promptly.
   void Cancel();
 
   /// @return The version of the library.
   static std::string GetLibraryVersion();
 
+  /// @return the metrics of the process in the OpenMetrics (Prometheus) text
+  ///         format: the segments and bytes written per stream, the segment
+  ///         finalization, manifest write and key fetch latencies, and the
+  ///         occupancy of the output caches. The metrics are shared by all
+  ///         the packagers in the process. Can be called from any thread,
+  ///         e.g. to serve them over HTTP while packaging.
+  static std::string GetMetrics();
+
+  /// @return the CPU time used by the packaging jobs so far, in seconds, e.g.
+  ///         to account the CPU share of the packagers of a process. It is
+  ///         updated when Run() returns. The helper threads of the jobs, e.g.
+  ///         the I/O threads, are not included.
+  double GetCpuTimeInSeconds() const;
+
   /// Default stream label function implementation.
   /// @param max_sd_pixels The threshold to determine whether a video track
   ///                      should be considered as SD. If the max pixels per
@@ -7,6 +7,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <map>
+#include <mutex>
+
 #include "packager/packager.h"
 
 using testing::_;
@@ -112,6 +115,15 @@ TEST_F(PackagerTest, Success) {
   ASSERT_EQ(Status::OK, packager.Run());
 }
 
+TEST_F(PackagerTest, CpuTime) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  EXPECT_EQ(0, packager.GetCpuTimeInSeconds());
+  ASSERT_EQ(Status::OK, packager.Run());
+  EXPECT_GT(packager.GetCpuTimeInSeconds(), 0);
+}
+
 TEST_F(PackagerTest, MissingStreamDescriptors) {
   std::vector<StreamDescriptor> stream_descriptors;
   Packager packager;
@@ -266,6 +278,53 @@ TEST_F(PackagerTest, ReadFromBufferFailed) {
   ASSERT_EQ(error::FILE_FAILURE, packager.Run().error_code());
 }
 
+TEST_F(PackagerTest, RunAsyncWithProgress) {
+  auto packaging_params = SetupPackagingParams();
+  std::mutex mutex;
+  std::map<std::string, double> progress_map;
+  packaging_params.progress_callback = [&mutex, &progress_map](
+                                           const std::string& output,
+                                           double progress) {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_GE(progress, progress_map[output]);
+    progress_map[output] = progress;
+  };
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(packaging_params, SetupStreamDescriptors()));
+  std::future<Status> status = packager.RunAsync();
+  ASSERT_EQ(Status::OK, status.get());
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(1.0, progress_map[GetFullPath(kOutputVideo)]);
+  EXPECT_EQ(1.0, progress_map[GetFullPath(kOutputAudio)]);
+}
+
+TEST_F(PackagerTest, CancelBeforeRunAsync) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  packager.Cancel();
+  EXPECT_EQ(error::CANCELLED, packager.RunAsync().get().error_code());
+}
+
+TEST_F(PackagerTest, LiveInputsWithFewerWorkerThreadsThanJobs) {
+  auto packaging_params = SetupPackagingParams();
+  packaging_params.num_worker_threads = 1;
+
+  // A live HLS input never ends, so the job without a worker thread would
+  // never run.
+  auto stream_descriptors = SetupStreamDescriptors();
+  for (StreamDescriptor& stream_descriptor : stream_descriptors)
+    stream_descriptor.input = "hls+http://localhost/live.m3u8";
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(packaging_params, stream_descriptors));
+  EXPECT_EQ(error::INVALID_ARGUMENT, packager.Run().error_code());
+}
+
 // TODO(kqyang): Add more tests.
 
 }  // namespace shaka